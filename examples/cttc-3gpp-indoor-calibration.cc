@@ -730,6 +730,8 @@ Nr3gppIndoorCalibration::Run (double centralFrequencyBand, double bandwidthBand,
 
   Simulator::Stop (simTime);
   Simulator::Run ();
+  NS_LOG_INFO ("Beamforming searches run: " << idealBeamformingHelper->GetCacheMisses () <<
+               ", skipped: " << idealBeamformingHelper->GetCacheHits ());
   Simulator::Destroy ();
 }
 
@@ -35,6 +35,12 @@
  * The example will print on-screen the end-to-end result of one (or two) flows,
  * as well as writing them on a file.
  *
+ * With --fullBuffer, there is no EPC, no IP stack and no application: the
+ * bearers use the saturation mode of the RLC (LteRlcSm), that always has
+ * data to send, in DL and in UL. The example then prints the DL throughput
+ * of each UE, from the transport blocks correctly received by its PHY after
+ * udpAppStartTime. Use it for air-interface capacity runs.
+ *
  * \code{.unparsed}
 $ ./ns3 run "cttc-nr-demo --PrintHelp"
     \endcode
@@ -70,6 +76,25 @@ using namespace ns3;
  */
 NS_LOG_COMPONENT_DEFINE ("CttcNrDemo");
 
+/*
+ * Bytes of the DL transport blocks correctly received by each UE (identified
+ * by cell ID and RNTI) after the start time, in the full-buffer mode
+ */
+static std::map<std::pair<uint64_t, uint16_t>, uint64_t> g_fullBufferRxBytes;
+static Time g_fullBufferStartTime; //!< Start of the measure of the full-buffer mode
+
+/*
+ * Sink of the RxPacketTraceUe trace of the UE PHYs, in the full-buffer mode
+ */
+static void
+FullBufferRxPacketTraceUe ([[maybe_unused]] std::string context, RxPacketTraceParams params)
+{
+  if (!params.m_corrupt && Simulator::Now () >= g_fullBufferStartTime)
+    {
+      g_fullBufferRxBytes[std::make_pair (params.m_cellId, params.m_rnti)] += params.m_tbSize;
+    }
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -83,6 +108,7 @@ main (int argc, char *argv[])
   uint16_t ueNumPergNb = 2;
   bool logging = false;
   bool doubleOperationalBand = true;
+  bool fullBuffer = false;
 
   // Traffic parameters (that we will use inside this script):
   uint32_t udpPacketSizeULL = 100;
@@ -129,6 +155,10 @@ main (int argc, char *argv[])
                 "If true, simulate two operational bands with one CC for each band,"
                 "and each CC will have 1 BWP that spans the entire CC.",
                 doubleOperationalBand);
+  cmd.AddValue ("fullBuffer",
+                "If true, use saturated RLC buffers instead of the EPC and the UDP "
+                "applications",
+                fullBuffer);
   cmd.AddValue ("packetSizeUll",
                 "packet size in bytes to be used by ultra low latency traffic",
                 udpPacketSizeULL);
@@ -256,18 +286,23 @@ main (int argc, char *argv[])
   /*
    * Setup the NR module. We create the various helpers needed for the
    * NR simulation:
-   * - EpcHelper, which will setup the core network
+   * - EpcHelper, which will setup the core network (not in the full-buffer
+   * mode: without EPC, NrHelper uses the saturation mode of the RLC)
    * - IdealBeamformingHelper, which takes care of the beamforming part
    * - NrHelper, which takes care of creating and connecting the various
    * part of the NR stack
    */
-  Ptr<NrPointToPointEpcHelper> epcHelper = CreateObject<NrPointToPointEpcHelper> ();
+  Ptr<NrPointToPointEpcHelper> epcHelper;
   Ptr<IdealBeamformingHelper> idealBeamformingHelper = CreateObject<IdealBeamformingHelper>();
   Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
 
   // Put the pointers inside nrHelper
   nrHelper->SetBeamformingHelper (idealBeamformingHelper);
-  nrHelper->SetEpcHelper (epcHelper);
+  if (!fullBuffer)
+    {
+      epcHelper = CreateObject<NrPointToPointEpcHelper> ();
+      nrHelper->SetEpcHelper (epcHelper);
+    }
 
   /*
    * Spectrum division. We create two operational bands, each of them containing
@@ -362,7 +397,10 @@ main (int argc, char *argv[])
   idealBeamformingHelper->SetAttribute ("BeamformingMethod", TypeIdValue (DirectPathBeamforming::GetTypeId ()));
 
   // Core latency
-  epcHelper->SetAttribute ("S1uLinkDelay", TimeValue (MilliSeconds (0)));
+  if (epcHelper != nullptr)
+    {
+      epcHelper->SetAttribute ("S1uLinkDelay", TimeValue (MilliSeconds (0)));
+    }
 
   // Antennas for all the UEs
   nrHelper->SetUeAntennaAttribute ("NumRows", UintegerValue (2));
@@ -450,6 +488,65 @@ main (int argc, char *argv[])
       DynamicCast<NrUeNetDevice> (*it)->UpdateConfig ();
     }
 
+  if (fullBuffer)
+    {
+      // attach UEs to the closest eNB, and activate a saturated bearer for each
+      nrHelper->AttachToClosestEnb (ueLowLatNetDev, enbNetDev);
+      nrHelper->AttachToClosestEnb (ueVoiceNetDev, enbNetDev);
+      nrHelper->ActivateDataRadioBearer (ueLowLatNetDev, EpsBearer (EpsBearer::NGBR_LOW_LAT_EMBB));
+      nrHelper->ActivateDataRadioBearer (ueVoiceNetDev, EpsBearer (EpsBearer::GBR_CONV_VOICE));
+
+      g_fullBufferStartTime = udpAppStartTime;
+      Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUePhy/NrSpectrumPhyList/*/RxPacketTraceUe",
+                       MakeCallback (&FullBufferRxPacketTraceUe));
+
+      Simulator::Stop (simTime);
+      Simulator::Run ();
+
+      std::ofstream outFile;
+      std::string filename = outputDir + "/" + simTag;
+      outFile.open (filename.c_str (), std::ofstream::out | std::ofstream::trunc);
+      if (!outFile.is_open ())
+        {
+          std::cerr << "Can't open file " << filename << std::endl;
+          return 1;
+        }
+
+      outFile.setf (std::ios_base::fixed);
+
+      double duration = (simTime - udpAppStartTime).GetSeconds ();
+      double averageThroughput = 0.0;
+      for (const auto &ue : g_fullBufferRxBytes)
+        {
+          double throughput = ue.second * 8.0 / duration / 1000 / 1000;
+          averageThroughput += throughput;
+          outFile << "UE (cell " << ue.first.first << ", RNTI " << ue.first.second << ")
+";
+          outFile << "  Rx Bytes:   " << ue.second << "
+";
+          outFile << "  Throughput: " << throughput << " Mbps
+";
+        }
+      if (!g_fullBufferRxBytes.empty ())
+        {
+          averageThroughput /= g_fullBufferRxBytes.size ();
+        }
+      outFile << "
+
+  Mean UE throughput: " << averageThroughput << "
+";
+      outFile.close ();
+
+      std::ifstream f (filename.c_str ());
+      if (f.is_open ())
+        {
+          std::cout << f.rdbuf ();
+        }
+
+      Simulator::Destroy ();
+      return 0;
+    }
+
   // From here, it is standard NS3. In the future, we will create helpers
   // for this part as well.
 
@@ -0,0 +1,200 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+
+#include <ns3/command-line.h>
+#include <ns3/rng-seed-manager.h>
+
+#include "lena-lte-comparison.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <thread>
+
+/**
+ * \file lena-lte-comparison-multi-seed.cc
+ * \ingroup examples
+ *
+ * Campaign driver for lena-lte-comparison: it runs numRuns runs (firstRun,
+ * firstRun + 1, ...) of the same configuration, numProcesses at a time.
+ *
+ * What does not depend on the run (the parsed site file, its effective ISD,
+ * the shared error model) is built once, by LenaLteComparisonPrepare, and
+ * then each run is a process forked from this one, which shares it
+ * copy-on-write. All the runs write their statistics, with their seed and
+ * run, to the same database, outputDir/simTag.db; the other outputs of a
+ * run are tagged simTag-run<N>.
+ *
+ * \code
+ *   ./ns3 run "lena-lte-comparison-multi-seed --useSiteFile=1 --siteFile=example-sites.104.csv --numRuns=16"
+ * \endcode
+ */
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+  Parameters params;
+  uint32_t firstRun = 1;
+  uint32_t numRuns = 4;
+  uint32_t numProcesses = std::max (1U, std::thread::hardware_concurrency ());
+
+  CommandLine cmd (__FILE__);
+
+  cmd.AddValue ("scenario",
+                "The urban scenario string (UMa,UMi,RMa)",
+                params.scenario);
+  cmd.AddValue ("numRings",
+                "The number of rings around the central site",
+                params.numOuterRings);
+  cmd.AddValue ("ueNumPergNb",
+                "The number of UE per cell or gNB in multiple-ue topology",
+                params.ueNumPergNb);
+  cmd.AddValue ("siteFile",
+                "Path to file of tower coordinates (instead of hexagonal grid)",
+                params.baseStationFile);
+  cmd.AddValue ("useSiteFile",
+                "If true, it will be used site file, otherwise it will be used "
+                "numRings parameter to create scenario.",
+                params.useSiteFile);
+  cmd.AddValue ("appGenerationTime",
+                "Duration applications will generate traffic.",
+                params.appGenerationTime);
+  cmd.AddValue ("numerologyBwp",
+                "The numerology to be used (NR only)",
+                params.numerologyBwp);
+  cmd.AddValue ("pattern",
+                "The TDD pattern to use",
+                params.pattern);
+  cmd.AddValue ("direction",
+                "The flow direction (DL or UL)",
+                params.direction);
+  cmd.AddValue ("simulator",
+                "The cellular network simulator to use: LENA or 5GLENA",
+                params.simulator);
+  cmd.AddValue ("technology",
+                "The radio access network technology (LTE or NR)",
+                params.radioNetwork);
+  cmd.AddValue ("operationMode",
+                "The network operation mode can be TDD or FDD",
+                params.operationMode);
+  cmd.AddValue ("simTag",
+                "tag to be appended to output filenames to distinguish simulation campaigns",
+                params.simTag);
+  cmd.AddValue ("outputDir",
+                "directory where to store simulation results",
+                params.outputDir);
+  cmd.AddValue ("errorModelType",
+                "Error model type: ns3::NrEesmCcT1, ns3::NrEesmCcT2, ns3::NrEesmIrT1, ns3::NrEesmIrT2, ns3::NrLteMiErrorModel",
+                params.errorModel);
+  cmd.AddValue ("calibration",
+                "disable a bunch of things to make LENA and NR_LTE comparable",
+                params.calibration);
+  cmd.AddValue ("trafficScenario",
+                "0: saturation (80 Mbps/20 MHz), 1: latency (1 pkt of 12 bytes), 2: low-load (1 Mbps), 3: medium-load (20Mbps)",
+                params.trafficScenario);
+  cmd.AddValue ("scheduler",
+                "PF: Proportional Fair, RR: Round-Robin",
+                params.scheduler);
+  cmd.AddValue ("bandwidth",
+                "BW in MHz for each BWP (integer value): valid values are 20, 10, 5",
+                params.bandwidthMHz);
+  cmd.AddValue ("freqScenario",
+                "0: NON_OVERLAPPING (each sector in different freq), 1: OVERLAPPING (same freq for all sectors)",
+                params.freqScenario);
+  cmd.AddValue ("downtiltAngle",
+                "Base station antenna down tilt angle (deg)",
+                params.downtiltAngle);
+  cmd.AddValue ("enableUlPc",
+                "Whether to enable or disable UL power control",
+                params.enableUlPc);
+  cmd.AddValue ("powerAllocation",
+                "Power allocation can be a)UniformPowerAllocBw or b)UniformPowerAllocUsed.",
+                params.powerAllocation);
+  cmd.AddValue ("firstRun",
+                "The run number of the first run",
+                firstRun);
+  cmd.AddValue ("numRuns",
+                "The number of runs",
+                numRuns);
+  cmd.AddValue ("numProcesses",
+                "The number of runs simulated at the same time",
+                numProcesses);
+
+  // Parse the command line
+  cmd.Parse (argc, argv);
+  params.Validate ();
+  numProcesses = std::max (1U, numProcesses);
+
+  std::cout << params;
+
+  // Shared by all the runs: nothing here may start a thread, as the runs
+  // are forked
+  LenaLteComparisonPrepare (params);
+  std::cout.flush ();
+
+  const std::string dbFile = params.outputDir + "/" + params.simTag + ".db";
+  std::map<pid_t, uint32_t> running;  // run of each child
+  uint32_t numFailed = 0;
+
+  auto waitOne = [&running, &numFailed] ()
+    {
+      int status = 0;
+      pid_t pid = wait (&status);
+      if (pid < 0)
+        {
+          numFailed += running.size ();
+          running.clear ();
+          return;
+        }
+      uint32_t run = running[pid];
+      running.erase (pid);
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+        {
+          std::cerr << "Run " << run << " failed" << std::endl;
+          ++numFailed;
+        }
+      else
+        {
+          std::cout << "Run " << run << " done" << std::endl;
+        }
+    };
+
+  for (uint32_t run = firstRun; run < firstRun + numRuns; ++run)
+    {
+      if (running.size () >= numProcesses)
+        {
+          waitOne ();
+        }
+
+      pid_t pid = fork ();
+      if (pid < 0)
+        {
+          std::cerr << "Could not fork the run " << run << std::endl;
+          ++numFailed;
+          continue;
+        }
+      if (pid == 0)
+        {
+          Parameters runParams = params;
+          runParams.simTag = params.simTag + "-run" + std::to_string (run);
+          runParams.dbFile = dbFile;
+          RngSeedManager::SetRun (run);
+          LenaLteComparison (runParams);
+          std::cout.flush ();
+          _exit (0);
+        }
+      running.emplace (pid, run);
+    }
+
+  while (!running.empty ())
+    {
+      waitOne ();
+    }
+
+  std::cout << numRuns - numFailed << " of " << numRuns << " runs done, results in " << dbFile << std::endl;
+  return numFailed == 0 ? 0 : 1;
+}
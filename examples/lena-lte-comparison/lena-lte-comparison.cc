@@ -252,18 +252,19 @@ LenaLteComparison (const Parameters &params)
     }
 
   std::cout << "  statistics\n";
-  SQLiteOutput db (params.outputDir + "/" + params.simTag + ".db");
+  SQLiteOutput db (params.dbFile != "" ? params.dbFile : params.outputDir + "/" + params.simTag + ".db");
+  NrSqliteStatsSink statsSink (&db);
   SinrOutputStats sinrStats;
   PowerOutputStats ueTxPowerStats;
   PowerOutputStats gnbRxPowerStats;
   SlotOutputStats slotStats;
   RbOutputStats rbStats;
 
-  sinrStats.SetDb (&db);
-  ueTxPowerStats.SetDb (&db, "ueTxPower");
-  slotStats.SetDb (&db);
-  rbStats.SetDb (&db);
-  gnbRxPowerStats.SetDb (&db, "gnbRxPower");
+  sinrStats.SetDb (&statsSink);
+  ueTxPowerStats.SetDb (&statsSink, "ueTxPower");
+  slotStats.SetDb (&statsSink);
+  rbStats.SetDb (&statsSink);
+  gnbRxPowerStats.SetDb (&statsSink, "gnbRxPower");
 
   /*
    * Check if the frequency and numerology are in the allowed range.
@@ -809,6 +810,26 @@ LenaLteComparison (const Parameters &params)
   Simulator::Destroy ();
 }
 
+void
+LenaLteComparisonPrepare (const Parameters &params)
+{
+  if (params.baseStationFile != "" and params.useSiteFile)
+    {
+      FileScenarioHelper::Preload (params.baseStationFile);
+    }
+
+  // Same default as LenaV2Utils::SetLenaV2SimulatorParameters
+  if (params.simulator == "5GLENA")
+    {
+      std::string errorModel = params.errorModel;
+      if (errorModel == "")
+        {
+          errorModel = params.radioNetwork == "LTE" ? "ns3::LenaErrorModel" : "ns3::NrEesmCcT2";
+        }
+      NrErrorModel::GetShared (TypeId::LookupByName (errorModel));
+    }
+}
+
 std::ostream &
 operator << (std::ostream & os, const Parameters & parameters)
 {
@@ -990,6 +1011,10 @@ operator << (std::ostream & os, const Parameters & parameters)
   MSG ("");
   MSG ("Output file name") << p.simTag;
   MSG ("Output directory") << p.outputDir;
+  if (p.dbFile != "")
+    {
+      MSG ("Output database") << p.dbFile;
+    }
   MSG ("Logging") << (p.logging ? "ON" : "off");
   MSG ("Trace file generation") << (p.traces ? "ON" : "off");
   MSG ("");
@@ -61,6 +61,7 @@ struct Parameters
   // Where we will store the output files.
   std::string simTag = "default";
   std::string outputDir = "./";
+  std::string dbFile = ""; // database of the results, outputDir/simTag.db when empty
 
   // Error models
   std::string errorModel = "";
@@ -92,6 +93,14 @@ struct Parameters
 
 extern void LenaLteComparison (const Parameters &params);
 
+/**
+ * Build, once for the whole process, what LenaLteComparison computes the
+ * same way whatever the seed and the run: the parsed site file and its
+ * effective ISD, and the shared error model. A campaign that forks a
+ * process per run calls it before forking.
+ */
+extern void LenaLteComparisonPrepare (const Parameters &params);
+
 } // namespace ns3
 
 #endif // LENA_LTE_COMPARISON_H
@@ -22,7 +22,7 @@
 #include <inttypes.h>
 #include <vector>
 
-#include <ns3/sqlite-output.h>
+#include <ns3/nr-sqlite-stats-sink.h>
 #include <ns3/spectrum-value.h>
 #include <ns3/sfnsf.h>
 #include <ns3/nstime.h>
@@ -33,8 +33,8 @@ namespace ns3 {
  * \brief Class to collect and store the transmission power values obtained from a simulation
  *
  * The class is meant to store in a database the values from UE or GNB during
- * a simulation. The class contains a cache, that after some time is written
- * to the disk.
+ * a simulation. The values are queued in a NrSqliteStatsSink, that writes
+ * them to the disk in batches.
  *
  * \see SetDb
  * \see SavePower
@@ -50,10 +50,10 @@ public:
 
   /**
    * \brief Install the output dabase.
-   * \param db database pointer
+   * \param sink the sink of the output database
    * \param tableName name of the table where the values will be stored
    *
-   * The db pointer must be valid through all the lifespan of the class. The
+   * The sink pointer must be valid through all the lifespan of the class. The
    * method creates, if not exists, a table for storing the values. The table
    * will contain the following columns:
    *
@@ -72,7 +72,7 @@ public:
    * the same name, also clean existing values that has the same
    * Seed/Run pair.
    */
-  void SetDb (SQLiteOutput *db, const std::string& tableName = "power");
+  void SetDb (NrSqliteStatsSink *sink, const std::string& tableName = "power");
 
   /**
    * \brief Store power values
@@ -91,35 +91,13 @@ public:
                   uint16_t bwpId, uint16_t cellId);
 
   /**
-   * \brief Force the cache write to disk, emptying the cache itself.
+   * \brief Force the write to disk of the queued values.
    */
   void EmptyCache ();
 
 private:
-
-  struct PowerResultCache
-  {
-    uint16_t frame;
-    uint8_t subFrame;
-    uint16_t slot;
-    uint16_t rnti;
-    uint64_t imsi;
-    uint16_t bwpId;
-    uint16_t cellId;
-    double txPowerRb;
-    double txPowerTotal;
-    uint32_t rbNumActive;
-    uint32_t rbNumTotal;
-  };
-
-  static void
-  DeleteWhere (SQLiteOutput *p, uint32_t seed, uint32_t run, const std::string &table);
-
-  void WriteCache ();
-
-  SQLiteOutput *m_db;                           //!< DB pointer
-  std::vector<PowerResultCache> m_powerCache;   //!< Result cache
-  std::string m_tableName;                      //!< Table name
+  NrSqliteStatsSink *m_sink {nullptr};        //!< Output sink
+  uint32_t m_table {0};                       //!< Table identifier in the sink
 };
 
 } // namespace ns3
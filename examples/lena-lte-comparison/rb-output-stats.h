@@ -22,7 +22,7 @@
 #include <inttypes.h>
 #include <vector>
 
-#include <ns3/sqlite-output.h>
+#include <ns3/nr-sqlite-stats-sink.h>
 #include <ns3/sfnsf.h>
 
 namespace ns3 {
@@ -44,10 +44,10 @@ public:
 
   /**
    * \brief Install the output dabase.
-   * \param db database pointer
+   * \param sink the sink of the output database
    * \param tableName name of the table where the values will be stored
    *
-   *  The db pointer must be valid through all the lifespan of the class. The
+   * The sink pointer must be valid through all the lifespan of the class. The
    * method creates, if not exists, a table for storing the values. The table
    * will contain the following columns:
    *
@@ -65,7 +65,7 @@ public:
    * the same name, also clean existing values that has the same
    * Seed/Run pair.
    */
-  void SetDb (SQLiteOutput *db, const std::string& tableName = "rbStats");
+  void SetDb (NrSqliteStatsSink *sink, const std::string& tableName = "rbStats");
 
   /**
    * \brief Save the slot statistics
@@ -77,33 +77,13 @@ public:
                     uint16_t bwpId, uint16_t cellId);
 
   /**
-   * \brief Force the cache write to disk, emptying the cache itself.
+   * \brief Force the write to disk of the queued values.
    */
   void EmptyCache ();
 
 private:
-  static void
-  DeleteWhere (SQLiteOutput *p, uint32_t seed, uint32_t run, const std::string &table);
-
-  void WriteCache ();
-
-  struct RbCache
-  {
-    SfnSf sfnSf;
-    uint8_t sym;
-    std::vector<int> rbUsed;
-    uint16_t cellId;
-    uint16_t bwpId;
-
-    uint32_t GetSize ()
-    {
-      return sizeof (RbCache) + (rbUsed.size () * sizeof(int));
-    }
-  };
-
-  SQLiteOutput *m_db;                         //!< DB pointer
-  std::vector<RbCache> m_slotCache;           //!< Result cache
-  std::string m_tableName;                    //!< Table name
+  NrSqliteStatsSink *m_sink {nullptr};        //!< Output sink
+  uint32_t m_table {0};                       //!< Table identifier in the sink
 };
 
 } // namespace ns3
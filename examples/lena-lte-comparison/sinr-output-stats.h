@@ -22,7 +22,7 @@
 #include <inttypes.h>
 #include <vector>
 
-#include <ns3/sqlite-output.h>
+#include <ns3/nr-sqlite-stats-sink.h>
 
 namespace ns3 {
 
@@ -30,8 +30,8 @@ namespace ns3 {
  * \brief Class to collect and store the SINR values obtained from a simulation
  *
  * The class is meant to store in a database the SINR values from UE or GNB during
- * a simulation. The class contains a cache, that after some time is written
- * to the disk.
+ * a simulation. The values are queued in a NrSqliteStatsSink, that writes
+ * them to the disk in batches.
  *
  * \see SetDb
  * \see SaveSinr
@@ -47,10 +47,10 @@ public:
 
   /**
    * \brief Install the output dabase.
-   * \param db database pointer
+   * \param sink the sink of the output database
    * \param tableName name of the table where the values will be stored
    *
-   *  The db pointer must be valid through all the lifespan of the class. The
+   * The sink pointer must be valid through all the lifespan of the class. The
    * method creates, if not exists, a table for storing the values. The table
    * will contain the following columns:
    *
@@ -65,7 +65,7 @@ public:
    * the same name, also clean existing values that has the same
    * Seed/Run pair.
    */
-  void SetDb (SQLiteOutput *db, const std::string& tableName = "sinr");
+  void SetDb (NrSqliteStatsSink *sink, const std::string& tableName = "sinr");
 
   /**
    * \brief Store the SINR values
@@ -74,36 +74,19 @@ public:
    * \param avgSinr Average SINR
    * \param bwpId BWP ID
    *
-   * The method saves the result in a cache, and if it is necessary, writes the
-   * cache to disk before emptying it.
+   * The method queues the result in the sink, that writes it to disk with
+   * the next batch.
    */
   void SaveSinr (uint16_t cellId, uint16_t rnti, double avgSinr, uint16_t bwpId);
 
   /**
-   * \brief Force the cache write to disk, emptying the cache itself.
+   * \brief Force the write to disk of the queued values.
    */
   void EmptyCache ();
 
 private:
-  static void
-  DeleteWhere (SQLiteOutput *p, uint32_t seed, uint32_t run, const std::string &table);
-
-  void WriteCache ();
-
-  struct SinrResultCache
-  {
-    SinrResultCache (uint16_t c, uint16_t b, uint16_t r, double s)
-      : cellId (c), bwpId (b), rnti (r), avgSinr (s) {}
-
-    uint16_t cellId {0};
-    uint16_t bwpId {0};
-    uint16_t rnti {0};
-    double avgSinr {0.0};
-  };
-
-  SQLiteOutput *m_db;                         //!< DB pointer
-  std::vector<SinrResultCache> m_sinrCache;   //!< Result cache
-  std::string m_tableName;                    //!< Table name
+  NrSqliteStatsSink *m_sink {nullptr};        //!< Output sink
+  uint32_t m_table {0};                       //!< Table identifier in the sink
 };
 
 } // namespace ns3
@@ -22,7 +22,7 @@
 #include <inttypes.h>
 #include <vector>
 
-#include <ns3/sqlite-output.h>
+#include <ns3/nr-sqlite-stats-sink.h>
 #include <ns3/sfnsf.h>
 
 namespace ns3 {
@@ -31,8 +31,8 @@ namespace ns3 {
  * \brief Class to collect and store the SINR values obtained from a simulation
  *
  * The class is meant to store in a database the SINR values from UE or GNB during
- * a simulation. The class contains a cache, that after some time is written
- * to the disk.
+ * a simulation. The values are queued in a NrSqliteStatsSink, that writes
+ * them to the disk in batches.
  *
  * \see SetDb
  * \see SaveSinr
@@ -48,10 +48,10 @@ public:
 
   /**
    * \brief Install the output dabase.
-   * \param db database pointer
+   * \param sink the sink of the output database
    * \param tableName name of the table where the values will be stored
    *
-   *  The db pointer must be valid through all the lifespan of the class. The
+   * The sink pointer must be valid through all the lifespan of the class. The
    * method creates, if not exists, a table for storing the values. The table
    * will contain the following columns:
    *
@@ -71,7 +71,7 @@ public:
    * the same name, also clean existing values that has the same
    * Seed/Run pair.
    */
-  void SetDb (SQLiteOutput *db, const std::string& tableName = "slotStats");
+  void SetDb (NrSqliteStatsSink *sink, const std::string& tableName = "slotStats");
 
   /**
    * \brief Save the slot statistics
@@ -90,31 +90,13 @@ public:
                       uint16_t cellId);
 
   /**
-   * \brief Force the cache write to disk, emptying the cache itself.
+   * \brief Force the write to disk of the queued values.
    */
   void EmptyCache ();
 
 private:
-  static void
-  DeleteWhere (SQLiteOutput *p, uint32_t seed, uint32_t run, const std::string &table);
-
-  void WriteCache ();
-
-  struct SlotCache
-  {
-    SfnSf sfnSf;
-    uint32_t scheduledUe;
-    uint32_t usedReg;
-    uint32_t usedSym;
-    uint32_t availableRb;
-    uint32_t availableSym;
-    uint16_t bwpId;
-    uint16_t cellId;
-  };
-
-  SQLiteOutput *m_db;                         //!< DB pointer
-  std::vector<SlotCache> m_slotCache;         //!< Result cache
-  std::string m_tableName;                    //!< Table name
+  NrSqliteStatsSink *m_sink {nullptr};        //!< Output sink
+  uint32_t m_table {0};                       //!< Table identifier in the sink
 };
 
 } // namespace ns3
@@ -0,0 +1,315 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * \ingroup examples
+ * \file nr-beamforming-benchmark.cc
+ *
+ * Micro-benchmark of the beamforming algorithms. For each gNB array size
+ * (NxN, from --antennaSizes) and each angle step (--angleSteps), a gNB and a
+ * UE (with a --ueRows x --ueColumns array) are installed at a fixed distance,
+ * and the GetBeamformingVectors method of each algorithm of --algorithms is
+ * called --calls times:
+ * - CellScan: CellScanBeamforming, with the angle step as BeamSearchAngleStep;
+ * - DirectPath: DirectPathBeamforming (the angle step is not used);
+ * - Realistic: RealisticBeamformingAlgorithm, with the angle step as
+ *   BeamSearchAngleStep, and no SRS report (the estimation noise does not
+ *   change the cost).
+ *
+ * \code{.unparsed}
+$ ./ns3 run "nr-beamforming-benchmark --antennaSizes=2,4,8,16 --angleSteps=30,10 --algorithms=CellScan,Realistic"
+    \endcode
+ *
+ * The program prints the time (ns/call) and the number of heap allocations
+ * (heap allocs/call) of a call. The channel matrix of the link is generated
+ * by a call before the measure. The long-term components are cached by
+ * CachedThreeGppSpectrumPropagationLossModel: set
+ * --ns3::CachedThreeGppSpectrumPropagationLossModel::LongTermCacheSize=0
+ * to measure the calls without the cache.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/antenna-module.h"
+#include "ns3/nr-module.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+using namespace ns3;
+
+/**
+ * \brief Number of calls to the global operator new of this program
+ */
+static std::atomic<uint64_t> g_heapAllocations {0};
+
+void *
+operator new (std::size_t size)
+{
+  ++g_heapAllocations;
+  void *p = std::malloc (size == 0 ? 1 : size);
+  if (p == nullptr)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, [[maybe_unused]] std::size_t size) noexcept
+{
+  std::free (p);
+}
+
+/**
+ * \brief The configuration of a run
+ */
+struct BenchmarkConfig
+{
+  uint32_t m_ueRows {2};            //!< Rows of the UE array
+  uint32_t m_ueColumns {2};         //!< Columns of the UE array
+  uint32_t m_calls {10};            //!< Measured calls
+  double m_distance {50.0};         //!< Horizontal distance between the gNB and the UE (m)
+  double m_frequency {28e9};        //!< Central frequency (Hz)
+  double m_bandwidth {100e6};       //!< Bandwidth (Hz)
+};
+
+/**
+ * \brief The result of a run
+ */
+struct BenchmarkResult
+{
+  double m_nsPerCall {0.0};              //!< Time per call
+  double m_heapAllocationsPerCall {0.0}; //!< Heap allocations per call
+};
+
+/**
+ * \brief Install a gNB and a UE, and measure the calls of an algorithm
+ * \param algorithm CellScan, DirectPath or Realistic
+ * \param antennaSize the number of rows and columns of the gNB array
+ * \param angleStep the BeamSearchAngleStep of the algorithm
+ * \param config the configuration
+ * \return the measures
+ */
+static BenchmarkResult
+RunAlgorithm (const std::string &algorithm, uint32_t antennaSize, double angleStep,
+              const BenchmarkConfig &config)
+{
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (1);
+  ueNodes.Create (1);
+
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 10.0));
+  positionAlloc->Add (Vector (config.m_distance, config.m_distance / 2, 1.5));
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.Install (NodeContainer (gnbNodes, ueNodes));
+
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  CcBwpCreator::SimpleOperationBandConf bandConf (config.m_frequency, config.m_bandwidth, 1,
+                                                  BandwidthPartInfo::UMa_LoS);
+  CcBwpCreator ccBwpCreator;
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  nrHelper->SetGnbAntennaAttribute ("NumRows", UintegerValue (antennaSize));
+  nrHelper->SetGnbAntennaAttribute ("NumColumns", UintegerValue (antennaSize));
+  nrHelper->SetUeAntennaAttribute ("NumRows", UintegerValue (config.m_ueRows));
+  nrHelper->SetUeAntennaAttribute ("NumColumns", UintegerValue (config.m_ueColumns));
+  nrHelper->SetGnbBeamManagerTypeId (RealisticBfManager::GetTypeId ());
+
+  NetDeviceContainer gnbDevs = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  NetDeviceContainer ueDevs = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  Ptr<NrGnbNetDevice> gnbDev = DynamicCast<NrGnbNetDevice> (gnbDevs.Get (0));
+  Ptr<NrUeNetDevice> ueDev = DynamicCast<NrUeNetDevice> (ueDevs.Get (0));
+  gnbDev->UpdateConfig ();
+  ueDev->UpdateConfig ();
+
+  Ptr<NrSpectrumPhy> gnbSpectrumPhy = nrHelper->GetGnbPhy (gnbDev, 0)->GetSpectrumPhy (0);
+  Ptr<NrSpectrumPhy> ueSpectrumPhy = nrHelper->GetUePhy (ueDev, 0)->GetSpectrumPhy (0);
+
+  std::function<BeamformingVectorPair ()> call;
+  Ptr<IdealBeamformingAlgorithm> ideal;
+  Ptr<RealisticBeamformingAlgorithm> realistic;
+  if (algorithm == "CellScan")
+    {
+      ideal = CreateObjectWithAttributes<CellScanBeamforming> ("BeamSearchAngleStep", DoubleValue (angleStep));
+    }
+  else if (algorithm == "DirectPath")
+    {
+      ideal = CreateObject<DirectPathBeamforming> ();
+    }
+  else if (algorithm == "Realistic")
+    {
+      realistic = CreateObject<RealisticBeamformingAlgorithm> ();
+      realistic->SetBeamSearchAngleStep (angleStep);
+      realistic->Install (gnbDev, ueDev, gnbSpectrumPhy, ueSpectrumPhy, gnbDev->GetScheduler (0));
+    }
+  else
+    {
+      NS_ABORT_MSG ("Unknown algorithm " << algorithm);
+    }
+  if (ideal != nullptr)
+    {
+      call = [&] () { return ideal->GetBeamformingVectors (gnbSpectrumPhy, ueSpectrumPhy); };
+    }
+  else
+    {
+      call = [&] () { return realistic->GetBeamformingVectors (); };
+    }
+
+  // The channel of the link is generated out of the measure
+  call ();
+
+  uint64_t heapBefore = g_heapAllocations;
+  auto start = std::chrono::steady_clock::now ();
+  for (uint32_t i = 0; i < config.m_calls; ++i)
+    {
+      call ();
+    }
+  auto end = std::chrono::steady_clock::now ();
+
+  BenchmarkResult result;
+  result.m_nsPerCall = std::chrono::duration<double, std::nano> (end - start).count () / config.m_calls;
+  result.m_heapAllocationsPerCall = static_cast<double> (g_heapAllocations - heapBefore) / config.m_calls;
+
+  Simulator::Destroy ();
+  return result;
+}
+
+/**
+ * \brief Parse a comma-separated list of numbers
+ * \param list the list
+ * \return the numbers
+ */
+template <typename T>
+static std::vector<T>
+ParseList (const std::string &list)
+{
+  std::vector<T> values;
+  std::stringstream ss (list);
+  std::string item;
+  while (std::getline (ss, item, ','))
+    {
+      std::stringstream value (item);
+      T v;
+      value >> v;
+      values.push_back (v);
+    }
+  return values;
+}
+
+int
+main (int argc, char *argv[])
+{
+  BenchmarkConfig config;
+  std::string algorithms = "CellScan,DirectPath,Realistic";
+  std::string antennaSizes = "2,4,8,16";
+  std::string angleSteps = "30,10";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("algorithms",
+                "Comma-separated list of algorithms: CellScan, DirectPath, Realistic",
+                algorithms);
+  cmd.AddValue ("antennaSizes",
+                "Comma-separated list of sizes N of the NxN gNB array",
+                antennaSizes);
+  cmd.AddValue ("angleSteps",
+                "Comma-separated list of BeamSearchAngleStep values (degrees)",
+                angleSteps);
+  cmd.AddValue ("ueRows",
+                "Number of rows of the UE array",
+                config.m_ueRows);
+  cmd.AddValue ("ueColumns",
+                "Number of columns of the UE array",
+                config.m_ueColumns);
+  cmd.AddValue ("calls",
+                "Number of measured calls",
+                config.m_calls);
+  cmd.AddValue ("distance",
+                "Horizontal distance between the gNB and the UE (m)",
+                config.m_distance);
+  cmd.AddValue ("frequency",
+                "Central frequency (Hz)",
+                config.m_frequency);
+  cmd.AddValue ("bandwidth",
+                "Bandwidth (Hz)",
+                config.m_bandwidth);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (config.m_calls == 0, "Nothing to measure");
+
+  std::cout << std::left << std::setw (12) << "algorithm"
+            << std::right << std::setw (8) << "array"
+            << std::setw (8) << "step"
+            << std::setw (16) << "ns/call"
+            << std::setw (20) << "heap allocs/call" << std::endl;
+
+  std::stringstream list (algorithms);
+  std::string algorithm;
+  while (std::getline (list, algorithm, ','))
+    {
+      for (uint32_t size : ParseList<uint32_t> (antennaSizes))
+        {
+          std::vector<double> steps = ParseList<double> (angleSteps);
+          if (algorithm == "DirectPath")
+            {
+              steps.resize (1); // Not used by the algorithm
+            }
+          for (double step : steps)
+            {
+              BenchmarkResult result = RunAlgorithm (algorithm, size, step, config);
+              std::ostringstream array;
+              array << size << "x" << size;
+              std::ostringstream stepText;
+              if (algorithm == "DirectPath")
+                {
+                  stepText << "-";
+                }
+              else
+                {
+                  stepText << step;
+                }
+              std::cout << std::left << std::setw (12) << algorithm
+                        << std::right << std::setw (8) << array.str ()
+                        << std::setw (8) << stepText.str ()
+                        << std::fixed << std::setprecision (1)
+                        << std::setw (16) << result.m_nsPerCall
+                        << std::setw (20) << result.m_heapAllocationsPerCall << std::endl;
+            }
+        }
+    }
+
+  return 0;
+}
@@ -0,0 +1,81 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * \ingroup examples
+ * \file nr-binary-trace-converter.cc
+ *
+ * Converts a binary trace file, written by NrPhyRxTrace when its
+ * OutputFormat attribute is set to Binary, to tab-separated text or CSV.
+ *
+ * \code{.unparsed}
+$ ./ns3 run "nr-binary-trace-converter --input=RxPacketTrace.bin --output=RxPacketTrace.csv --format=csv"
+    \endcode
+ *
+ * If the output file is not given, the text is written to the standard output.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/nr-module.h"
+#include <fstream>
+#include <iostream>
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+  std::string input;
+  std::string output;
+  std::string format = "txt";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("input",
+                "The binary trace file",
+                input);
+  cmd.AddValue ("output",
+                "The output file; if empty, the standard output is used",
+                output);
+  cmd.AddValue ("format",
+                "The output format: txt (tab-separated) or csv",
+                format);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (input.empty (), "Please specify the input file with --input");
+  NS_ABORT_MSG_IF (format != "txt" && format != "csv", "Unknown format " << format);
+
+  NrBinaryTraceReader reader;
+  NS_ABORT_MSG_IF (!reader.Open (input), "Could not read " << input);
+
+  char separator = format == "csv" ? ',' : '\t';
+  uint64_t records = 0;
+  if (output.empty ())
+    {
+      records = reader.ConvertToText (std::cout, separator);
+    }
+  else
+    {
+      std::ofstream os (output.c_str ());
+      NS_ABORT_MSG_IF (!os.is_open (), "Could not open " << output);
+      records = reader.ConvertToText (os, separator);
+      std::cerr << "Converted " << records << " records to " << output << std::endl;
+    }
+
+  return 0;
+}
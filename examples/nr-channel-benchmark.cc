@@ -0,0 +1,288 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * \ingroup examples
+ * \file nr-channel-benchmark.cc
+ *
+ * Micro-benchmark of the generation of the 3GPP channel matrices by
+ * ThreeGppChannelModelParam, and of the computation of the received PSD
+ * (long-term component and fast fading) by
+ * ThreeGppSpectrumPropagationLossModel, without PHY or devices. For each gNB
+ * array size (NxN, from --antennaSizes), with a UE array of --ueRows x
+ * --ueColumns, the program measures:
+ * - new link: ThreeGppChannelModelParam::GetChannel for a link that was
+ *   never requested (new channel parameters and new channel matrix);
+ * - update: GetChannel for a link that is due for an update, one
+ *   UpdatePeriod after the previous request;
+ * - fading: CalcRxPowerSpectralDensity over --rbs RBs, with the beams of the
+ *   previous call (the long-term component is reused);
+ * - long term + fading: CalcRxPowerSpectralDensity, with a beam of the gNB
+ *   that changes at every call (the long-term component is recomputed).
+ *
+ * \code{.unparsed}
+$ ./ns3 run "nr-channel-benchmark --antennaSizes=2,4,8,16 --scenario=UMa --rbs=273"
+    \endcode
+ *
+ * The program prints the time (ns/call) and the number of heap allocations
+ * (allocs/call) of each kind of call.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/antenna-module.h"
+#include "ns3/spectrum-module.h"
+#include "ns3/nr-module.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+using namespace ns3;
+
+/**
+ * \brief Number of calls to the global operator new of this program
+ */
+static std::atomic<uint64_t> g_heapAllocations {0};
+
+void *
+operator new (std::size_t size)
+{
+  ++g_heapAllocations;
+  void *p = std::malloc (size == 0 ? 1 : size);
+  if (p == nullptr)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, [[maybe_unused]] std::size_t size) noexcept
+{
+  std::free (p);
+}
+
+/**
+ * \brief The configuration of a run
+ */
+struct BenchmarkConfig
+{
+  uint32_t m_ueRows {1};            //!< Rows of the UE array
+  uint32_t m_ueColumns {2};         //!< Columns of the UE array
+  uint32_t m_calls {100};           //!< Measured calls of each kind
+  uint32_t m_rbs {273};             //!< RBs of the PSD
+  double m_frequency {28e9};        //!< Central frequency (Hz)
+  std::string m_scenario {"UMa"};   //!< Scenario of the channel model
+};
+
+/**
+ * \brief A measure
+ */
+struct Measure
+{
+  std::chrono::nanoseconds m_elapsed {0}; //!< Time spent in the calls
+  uint64_t m_heapAllocations {0};         //!< Heap allocations in the calls
+  uint32_t m_calls {0};                   //!< Number of calls
+
+  /**
+   * \brief Measure a call
+   * \param f the call
+   */
+  template <typename F>
+  void Add (F f)
+  {
+    uint64_t heapBefore = g_heapAllocations;
+    auto start = std::chrono::steady_clock::now ();
+    f ();
+    auto end = std::chrono::steady_clock::now ();
+    m_elapsed += std::chrono::duration_cast<std::chrono::nanoseconds> (end - start);
+    m_heapAllocations += g_heapAllocations - heapBefore;
+    ++m_calls;
+  }
+
+  /**
+   * \brief Print the time and the allocations per call
+   * \param os the output stream
+   */
+  void Print (std::ostream &os) const
+  {
+    double calls = std::max<uint32_t> (m_calls, 1);
+    os << std::fixed << std::setprecision (1)
+       << std::setw (14) << m_elapsed.count () / calls
+       << std::setw (14) << m_heapAllocations / calls;
+  }
+};
+
+/**
+ * \brief Create a node at a position
+ * \param position the position
+ * \return the mobility model of the node
+ */
+static Ptr<MobilityModel>
+CreateNodeAt (const Vector &position)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<MobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (position);
+  node->AggregateObject (mobility);
+  return mobility;
+}
+
+/**
+ * \brief Measure the channel calls with a gNB array size
+ * \param antennaSize the number of rows and columns of the gNB array
+ * \param config the configuration
+ */
+static void
+RunAntennaSize (uint32_t antennaSize, const BenchmarkConfig &config)
+{
+  const Time updatePeriod = MilliSeconds (1);
+  Ptr<ThreeGppChannelModelParam> channelModel = CreateObject<ThreeGppChannelModelParam> ();
+  channelModel->SetAttribute ("Frequency", DoubleValue (config.m_frequency));
+  channelModel->SetAttribute ("Scenario", StringValue (config.m_scenario));
+  channelModel->SetAttribute ("ChannelConditionModel", PointerValue (CreateObject<AlwaysLosChannelConditionModel> ()));
+  channelModel->SetAttribute ("UpdatePeriod", TimeValue (updatePeriod));
+  channelModel->AssignStreams (1);
+
+  Ptr<ThreeGppSpectrumPropagationLossModel> lossModel = CreateObject<ThreeGppSpectrumPropagationLossModel> ();
+  lossModel->SetAttribute ("ChannelModel", PointerValue (channelModel));
+
+  Ptr<UniformPlanarArray> gnbAntenna =
+    CreateObjectWithAttributes<UniformPlanarArray> ("NumRows", UintegerValue (antennaSize),
+                                                    "NumColumns", UintegerValue (antennaSize));
+  Ptr<UniformPlanarArray> ueAntenna =
+    CreateObjectWithAttributes<UniformPlanarArray> ("NumRows", UintegerValue (config.m_ueRows),
+                                                    "NumColumns", UintegerValue (config.m_ueColumns));
+  Ptr<MobilityModel> gnb = CreateNodeAt (Vector (0.0, 0.0, 25.0));
+
+  Measure newLink;
+  Measure update;
+  Measure fading;
+  Measure longTerm;
+
+  // A new UE at every call
+  for (uint32_t i = 0; i < config.m_calls; ++i)
+    {
+      Ptr<MobilityModel> ue = CreateNodeAt (Vector (50.0 + i, 20.0, 1.5));
+      newLink.Add ([&] () { channelModel->GetChannel (gnb, ue, gnbAntenna, ueAntenna); });
+    }
+
+  // The same UE, once every update period
+  Ptr<MobilityModel> ue = CreateNodeAt (Vector (100.0, -30.0, 1.5));
+  channelModel->GetChannel (gnb, ue, gnbAntenna, ueAntenna);
+  for (uint32_t i = 1; i <= config.m_calls; ++i)
+    {
+      Simulator::Schedule (updatePeriod * i, [&] ()
+        {
+          update.Add ([&] () { channelModel->GetChannel (gnb, ue, gnbAntenna, ueAntenna); });
+        });
+    }
+  Simulator::Run ();
+
+  // The PSD over the RBs, with two beams of the gNB
+  Ptr<const SpectrumModel> model = NrSpectrumValueHelper::GetSpectrumModel (config.m_rbs, config.m_frequency, 30e3);
+  Ptr<SpectrumValue> txPsd = Create<SpectrumValue> (model);
+  *txPsd = 1e-9;
+  std::array<complexVector_t, 2> gnbBeams {CreateDirectPathBfv (gnb, ue, gnbAntenna),
+                                           CreateDirectionalBfv (gnbAntenna, 0, 90.0)};
+  ueAntenna->SetBeamformingVector (CreateDirectPathBfv (ue, gnb, ueAntenna));
+  gnbAntenna->SetBeamformingVector (gnbBeams[0]);
+  lossModel->CalcRxPowerSpectralDensity (txPsd, gnb, ue, gnbAntenna, ueAntenna);
+  for (uint32_t i = 0; i < config.m_calls; ++i)
+    {
+      fading.Add ([&] () { lossModel->CalcRxPowerSpectralDensity (txPsd, gnb, ue, gnbAntenna, ueAntenna); });
+    }
+  for (uint32_t i = 0; i < config.m_calls; ++i)
+    {
+      gnbAntenna->SetBeamformingVector (gnbBeams[(i + 1) % 2]);
+      longTerm.Add ([&] () { lossModel->CalcRxPowerSpectralDensity (txPsd, gnb, ue, gnbAntenna, ueAntenna); });
+    }
+
+  std::ostringstream array;
+  array << antennaSize << "x" << antennaSize;
+  std::cout << std::right << std::setw (8) << array.str ();
+  newLink.Print (std::cout);
+  update.Print (std::cout);
+  fading.Print (std::cout);
+  longTerm.Print (std::cout);
+  std::cout << std::endl;
+
+  Simulator::Destroy ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  BenchmarkConfig config;
+  std::string antennaSizes = "2,4,8,16";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("antennaSizes",
+                "Comma-separated list of sizes N of the NxN gNB array",
+                antennaSizes);
+  cmd.AddValue ("ueRows",
+                "Number of rows of the UE array",
+                config.m_ueRows);
+  cmd.AddValue ("ueColumns",
+                "Number of columns of the UE array",
+                config.m_ueColumns);
+  cmd.AddValue ("calls",
+                "Number of measured calls of each kind",
+                config.m_calls);
+  cmd.AddValue ("rbs",
+                "Number of RBs of the PSD",
+                config.m_rbs);
+  cmd.AddValue ("frequency",
+                "Central frequency (Hz)",
+                config.m_frequency);
+  cmd.AddValue ("scenario",
+                "Scenario of the channel model (RMa, UMa, UMi-StreetCanyon, InH-OfficeOpen, ...)",
+                config.m_scenario);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (config.m_calls == 0 || config.m_rbs == 0, "Nothing to measure");
+
+  std::cout << "times in ns/call, heap allocations in allocs/call" << std::endl
+            << std::right << std::setw (8) << "array"
+            << std::setw (28) << "new link"
+            << std::setw (28) << "update"
+            << std::setw (28) << "fading"
+            << std::setw (28) << "long term + fading" << std::endl;
+
+  std::stringstream list (antennaSizes);
+  std::string item;
+  while (std::getline (list, item, ','))
+    {
+      RunAntennaSize (static_cast<uint32_t> (std::stoul (item)), config);
+    }
+
+  return 0;
+}
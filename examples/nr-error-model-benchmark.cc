@@ -0,0 +1,347 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * \ingroup examples
+ * \file nr-error-model-benchmark.cc
+ *
+ * Micro-benchmark of the error models and of the AMC, and generator of
+ * BLER curves. Every error model in the list is driven directly, without
+ * PHY or channel, with synthetic SINR vectors: --sinrVectors vectors of
+ * --rbs RBs, whose SINR is drawn uniformly in --sinrDb +/- --sinrSpreadDb.
+ *
+ * \code{.unparsed}
+$ ./ns3 run "nr-error-model-benchmark --errorModels=NrEesmIrT1,NrEesmCcT2 --rbs=100 --mcs=20 --harqDepth=2"
+    \endcode
+ *
+ * For each error model, the program prints the time per call (ns/call) of:
+ * - NrErrorModel::GetTbDecodificationStats, for a TB of MCS --mcs over all
+ *   the RBs, with a history of --harqDepth previous transmissions (each one
+ *   with another of the SINR vectors);
+ * - NrAmc::CreateCqiFeedbackWbTdma, with the error model as ErrorModelType;
+ * - NrAmc::CalculateTbSize, over all the MCSs and numbers of RBs.
+ *
+ * With --blerCurves=<file>, the program also writes, for each error model,
+ * each MCS and each SINR from --sinrMin to --sinrMax by --sinrStep (flat
+ * over the RBs, the same for the --harqDepth previous transmissions), the
+ * TBLER of a TB of that MCS over all the RBs.
+ *
+ * The attributes of the error models and of the AMC can be changed as usual,
+ * e.g. --ns3::NrEesmErrorModel::BlerMapping=Fit or
+ * --ns3::NrAmc::CqiSearchMode=Binary, to compare their variants.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/nr-module.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+/**
+ * \brief The configuration of a run
+ */
+struct BenchmarkConfig
+{
+  uint32_t m_rbs {100};             //!< Number of RBs of the TB
+  uint32_t m_mcs {10};              //!< MCS of the TB
+  uint32_t m_harqDepth {0};         //!< Previous transmissions of the TB
+  uint32_t m_calls {20000};         //!< Measured calls of each method
+  uint32_t m_sinrVectors {64};      //!< Number of SINR vectors
+  double m_sinrDb {10.0};           //!< Mean SINR (dB)
+  double m_sinrSpreadDb {5.0};      //!< Half-width of the SINR distribution (dB)
+  double m_sinrMin {-10.0};         //!< First SINR of the BLER curves (dB)
+  double m_sinrMax {30.0};          //!< Last SINR of the BLER curves (dB)
+  double m_sinrStep {0.5};          //!< SINR step of the BLER curves (dB)
+};
+
+/**
+ * \brief The result of a run
+ */
+struct BenchmarkResult
+{
+  double m_errorModelNs {0.0};   //!< ns per call of GetTbDecodificationStats
+  double m_cqiNs {0.0};          //!< ns per call of CreateCqiFeedbackWbTdma
+  double m_tbSizeNs {0.0};       //!< ns per call of CalculateTbSize
+  double m_meanTbler {0.0};      //!< Mean TBLER of the measured calls
+};
+
+/**
+ * \brief Prevents the compiler from removing the measured calls
+ */
+static volatile double g_sink = 0.0;
+
+/**
+ * \brief Create an error model and an AMC that uses it
+ * \param errorModelType the TypeId of the error model
+ * \param amc the AMC (output)
+ * \return the error model
+ */
+static Ptr<NrErrorModel>
+CreateErrorModel (const TypeId &errorModelType, Ptr<NrAmc> &amc)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (errorModelType);
+  Ptr<NrErrorModel> errorModel = DynamicCast<NrErrorModel> (factory.Create ());
+  NS_ABORT_MSG_IF (errorModel == nullptr, "Can't create a NrErrorModel from type "
+                   << errorModelType.GetName ());
+  amc = CreateObject<NrAmc> ();
+  amc->SetAttribute ("AmcModel", EnumValue (NrAmc::ErrorModel));
+  amc->SetAttribute ("ErrorModelType", TypeIdValue (errorModelType));
+  amc->SetDlMode ();
+  return errorModel;
+}
+
+/**
+ * \brief Build the history of a TB, transmitted before with other SINRs
+ * \param errorModel the error model
+ * \param sinrs the SINR vectors of the previous transmissions
+ * \param map the RB map
+ * \param size the TB size
+ * \param mcs the MCS
+ * \return the history
+ */
+static NrErrorModel::NrErrorModelHistory
+BuildHistory (const Ptr<NrErrorModel> &errorModel, const std::vector<SpectrumValue> &sinrs,
+              const std::vector<int> &map, uint32_t size, uint8_t mcs)
+{
+  NrErrorModel::NrErrorModelHistory history;
+  for (const SpectrumValue &sinr : sinrs)
+    {
+      history.push_back (errorModel->GetTbDecodificationStats (sinr, map, size, mcs, history));
+    }
+  return history;
+}
+
+/**
+ * \brief Measure the calls of an error model and of its AMC
+ * \param errorModelType the TypeId of the error model
+ * \param config the configuration
+ * \param sinrs the SINR vectors
+ * \return the measures
+ */
+static BenchmarkResult
+RunErrorModel (const TypeId &errorModelType, const BenchmarkConfig &config,
+               const std::vector<SpectrumValue> &sinrs)
+{
+  Ptr<NrAmc> amc;
+  Ptr<NrErrorModel> errorModel = CreateErrorModel (errorModelType, amc);
+  uint8_t mcs = static_cast<uint8_t> (std::min<uint32_t> (config.m_mcs, errorModel->GetMaxMcs ()));
+
+  std::vector<int> map (config.m_rbs);
+  for (uint32_t rb = 0; rb < config.m_rbs; ++rb)
+    {
+      map[rb] = static_cast<int> (rb);
+    }
+  uint32_t size = amc->CalculateTbSize (mcs, config.m_rbs);
+
+  // The history of each call is built beforehand, out of the measure
+  std::vector<NrErrorModel::NrErrorModelHistory> histories;
+  for (uint32_t v = 0; v < sinrs.size (); ++v)
+    {
+      std::vector<SpectrumValue> previous;
+      for (uint32_t h = 1; h <= config.m_harqDepth; ++h)
+        {
+          previous.push_back (sinrs[(v + h) % sinrs.size ()]);
+        }
+      histories.emplace_back (BuildHistory (errorModel, previous, map, size, mcs));
+    }
+
+  BenchmarkResult result;
+  double tbler = 0.0;
+  auto start = std::chrono::steady_clock::now ();
+  for (uint32_t call = 0; call < config.m_calls; ++call)
+    {
+      uint32_t v = call % sinrs.size ();
+      tbler += errorModel->GetTbDecodificationStats (sinrs[v], map, size, mcs, histories[v])->m_tbler;
+    }
+  auto end = std::chrono::steady_clock::now ();
+  result.m_errorModelNs = std::chrono::duration<double, std::nano> (end - start).count () / config.m_calls;
+  result.m_meanTbler = tbler / config.m_calls;
+
+  uint32_t cqiSum = 0;
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t call = 0; call < config.m_calls; ++call)
+    {
+      uint8_t mcsWb;
+      cqiSum += amc->CreateCqiFeedbackWbTdma (sinrs[call % sinrs.size ()], mcsWb);
+      cqiSum += mcsWb;
+    }
+  end = std::chrono::steady_clock::now ();
+  result.m_cqiNs = std::chrono::duration<double, std::nano> (end - start).count () / config.m_calls;
+
+  uint64_t tbSizeSum = 0;
+  uint32_t numMcs = amc->GetMaxMcs () + 1;
+  start = std::chrono::steady_clock::now ();
+  for (uint32_t call = 0; call < config.m_calls; ++call)
+    {
+      tbSizeSum += amc->CalculateTbSize (static_cast<uint8_t> (call % numMcs),
+                                         1 + (call / numMcs) % config.m_rbs);
+    }
+  end = std::chrono::steady_clock::now ();
+  result.m_tbSizeNs = std::chrono::duration<double, std::nano> (end - start).count () / config.m_calls;
+
+  g_sink = g_sink + tbler + cqiSum + tbSizeSum;
+  return result;
+}
+
+/**
+ * \brief Write the BLER curves of an error model
+ * \param errorModelType the TypeId of the error model
+ * \param config the configuration
+ * \param model the spectrum model, one band per RB
+ * \param out the output file
+ */
+static void
+WriteBlerCurves (const TypeId &errorModelType, const BenchmarkConfig &config,
+                 const Ptr<const SpectrumModel> &model, std::ostream &out)
+{
+  Ptr<NrAmc> amc;
+  Ptr<NrErrorModel> errorModel = CreateErrorModel (errorModelType, amc);
+
+  std::vector<int> map (config.m_rbs);
+  for (uint32_t rb = 0; rb < config.m_rbs; ++rb)
+    {
+      map[rb] = static_cast<int> (rb);
+    }
+
+  for (uint32_t mcs = 0; mcs <= errorModel->GetMaxMcs (); ++mcs)
+    {
+      uint32_t size = amc->CalculateTbSize (static_cast<uint8_t> (mcs), config.m_rbs);
+      for (double sinrDb = config.m_sinrMin; sinrDb <= config.m_sinrMax + 1e-9; sinrDb += config.m_sinrStep)
+        {
+          SpectrumValue sinr (model);
+          sinr = std::pow (10.0, sinrDb / 10.0);
+          std::vector<SpectrumValue> previous (config.m_harqDepth, sinr);
+          NrErrorModel::NrErrorModelHistory history =
+            BuildHistory (errorModel, previous, map, size, static_cast<uint8_t> (mcs));
+          double tbler = errorModel->GetTbDecodificationStats (sinr, map, size,
+                                                               static_cast<uint8_t> (mcs),
+                                                               history)->m_tbler;
+          out << errorModelType.GetName ().substr (5) << "\t" << mcs << "\t" << config.m_harqDepth
+              << "\t" << sinrDb << "\t" << tbler << "\n";
+        }
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  BenchmarkConfig config;
+  std::string errorModels = "NrEesmIrT1,NrEesmIrT2,NrEesmCcT1,NrEesmCcT2,NrLteMiErrorModel";
+  std::string blerCurves;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("errorModels",
+                "Comma-separated list of error models, e.g. NrEesmIrT1,NrLteMiErrorModel",
+                errorModels);
+  cmd.AddValue ("rbs",
+                "Number of RBs of the TB",
+                config.m_rbs);
+  cmd.AddValue ("mcs",
+                "MCS of the TB (limited to the maximum MCS of each error model)",
+                config.m_mcs);
+  cmd.AddValue ("harqDepth",
+                "Number of previous transmissions of the TB (HARQ history)",
+                config.m_harqDepth);
+  cmd.AddValue ("calls",
+                "Number of measured calls of each method",
+                config.m_calls);
+  cmd.AddValue ("sinrVectors",
+                "Number of synthetic SINR vectors",
+                config.m_sinrVectors);
+  cmd.AddValue ("sinrDb",
+                "Mean SINR of the synthetic SINR vectors (dB)",
+                config.m_sinrDb);
+  cmd.AddValue ("sinrSpreadDb",
+                "The SINR of each RB is drawn uniformly in sinrDb +/- sinrSpreadDb (dB)",
+                config.m_sinrSpreadDb);
+  cmd.AddValue ("blerCurves",
+                "File of the BLER curves; empty to not compute them",
+                blerCurves);
+  cmd.AddValue ("sinrMin",
+                "First SINR of the BLER curves (dB)",
+                config.m_sinrMin);
+  cmd.AddValue ("sinrMax",
+                "Last SINR of the BLER curves (dB)",
+                config.m_sinrMax);
+  cmd.AddValue ("sinrStep",
+                "SINR step of the BLER curves (dB)",
+                config.m_sinrStep);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (config.m_rbs == 0, "At least one RB is needed");
+  NS_ABORT_MSG_IF (config.m_calls == 0 || config.m_sinrVectors == 0, "Nothing to measure");
+  NS_ABORT_MSG_IF (config.m_sinrStep <= 0, "The SINR step must be positive");
+
+  Ptr<const SpectrumModel> model = NrSpectrumValueHelper::GetSpectrumModel (config.m_rbs, 28e9, 30e3);
+
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  random->SetStream (1);
+  std::vector<SpectrumValue> sinrs;
+  for (uint32_t v = 0; v < config.m_sinrVectors; ++v)
+    {
+      SpectrumValue sinr (model);
+      for (auto it = sinr.ValuesBegin (); it != sinr.ValuesEnd (); ++it)
+        {
+          double sinrDb = config.m_sinrDb + random->GetValue (-config.m_sinrSpreadDb, config.m_sinrSpreadDb);
+          *it = std::pow (10.0, sinrDb / 10.0);
+        }
+      sinrs.emplace_back (std::move (sinr));
+    }
+
+  std::ofstream curves;
+  if (!blerCurves.empty ())
+    {
+      curves.open (blerCurves.c_str ());
+      NS_ABORT_MSG_IF (!curves.is_open (), "Can't open file " << blerCurves);
+      curves << "% errorModel\tMCS\tharqDepth\tSINR(dB)\tTBLER" << std::endl;
+    }
+
+  std::cout << std::left << std::setw (20) << "error model"
+            << std::right << std::setw (16) << "TBLER ns/call"
+            << std::setw (16) << "CQI ns/call"
+            << std::setw (16) << "TBS ns/call"
+            << std::setw (12) << "mean TBLER" << std::endl;
+
+  std::stringstream list (errorModels);
+  std::string name;
+  while (std::getline (list, name, ','))
+    {
+      TypeId errorModelType = TypeId::LookupByName ("ns3::" + name);
+      BenchmarkResult result = RunErrorModel (errorModelType, config, sinrs);
+      std::cout << std::left << std::setw (20) << name
+                << std::right << std::fixed << std::setprecision (1)
+                << std::setw (16) << result.m_errorModelNs
+                << std::setw (16) << result.m_cqiNs
+                << std::setw (16) << result.m_tbSizeNs
+                << std::setprecision (4) << std::setw (12) << result.m_meanTbler << std::endl;
+      if (curves.is_open ())
+        {
+          WriteBlerCurves (errorModelType, config, model, curves);
+        }
+    }
+
+  Simulator::Destroy ();
+  return 0;
+}
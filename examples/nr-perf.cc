@@ -0,0 +1,743 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * \ingroup examples
+ * \file nr-perf.cc
+ *
+ * End-to-end performance benchmark of the module. The program runs a fixed
+ * matrix of scenarios, each one in its own process (so that the peak memory
+ * of a scenario does not include the ones before it):
+ *
+ * - single-cell-10, single-cell-100, single-cell-500: one gNB and 10, 100 or
+ *   500 UEs, as in cttc-nr-demo;
+ * - hex-7, hex-19: a HexagonalGridScenarioHelper layout of 7 or 19 sites,
+ *   with one cell per site and --uesPerCell UEs per cell;
+ * - mimo: one gNB and --uesPerCell UEs with dual-polarized arrays and two
+ *   streams, as in cttc-nr-mimo-demo;
+ * - realistic-bf: one gNB and --uesPerCell UEs with the SRS-based realistic
+ *   beamforming, as in cttc-realistic-beamforming;
+ * - rem: the generation of a coverage-area REM of --remResolution x
+ *   --remResolution points over the single-cell deployment.
+ *
+ * All the simulations use full-buffer traffic in DL and UL (the saturation
+ * mode of the RLC, as cttc-nr-demo --fullBuffer), so that the time is spent
+ * in the air interface. A subset of the scenarios can be run with
+ * --scenarios.
+ *
+ * \code{.unparsed}
+$ ./ns3 run "nr-perf --scenarios=single-cell-10,hex-7 --simTime=1s --output=perf.json"
+$ ./ns3 run "nr-perf --baseline=perf.json --tolerance=0.1"
+    \endcode
+ *
+ * For each scenario, the program reports the wall time of the simulation per
+ * simulated second, the number of simulator events per wall-clock second,
+ * the peak resident set size and, if the module is built with
+ * NR_PERF_PROFILING, the share of the wall time spent in the scheduler, in
+ * the spectrum PHY and interference, in the error model and in the channel
+ * (the spectrum propagation loss models of the module), from NrPerfProfiler.
+ * The time to build the scenario is reported apart, and it is not part of
+ * the other measures.
+ *
+ * The report is written in JSON, with one line per scenario. With
+ * --baseline, the report of a previous run is read, and every scenario
+ * whose wall time per simulated second or peak memory grew by more than
+ * --tolerance is reported as a regression; the program then returns 1.
+ *
+ * With --alternative, the program checks an optimized or approximate mode
+ * instead of measuring: each scenario is run in this process twice, with the
+ * defaults of the command line and with the defaults of --alternative
+ * ("ns3::Type::Attribute=value" pairs, separated by ';'), and the
+ * RxPacketTrace and MAC scheduling records of the runs are compared by
+ * NrEquivalenceChecker. With --kpiTolerance=0 the records must be identical;
+ * otherwise, the KPIs of each direction must be within that relative
+ * tolerance. The program returns 1 if a scenario fails the check.
+ *
+ * \code{.unparsed}
+$ ./ns3 run "nr-perf --scenarios=single-cell-10 --simTime=100ms --alternative=ns3::NrEesmErrorModel::SinrExpKernel=FastExp --kpiTolerance=0.01"
+    \endcode
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/nr-module.h"
+#include "ns3/antenna-module.h"
+#include "ns3/nr-equivalence-checker.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#if defined (__unix__) || defined (__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define NR_PERF_HAVE_FORK 1
+#endif
+
+using namespace ns3;
+
+/**
+ * \brief A scenario of the benchmark
+ */
+struct PerfScenario
+{
+  std::string m_name;        //!< Name of the scenario
+  uint8_t m_rings {0};       //!< Outer rings of sites of the hexagonal grid
+  uint32_t m_uesPerCell {0}; //!< UEs per cell (0: --uesPerCell)
+  bool m_mimo {false};       //!< Dual-polarized arrays and two streams
+  bool m_realisticBf {false}; //!< SRS-based realistic beamforming
+  bool m_rem {false};        //!< Generate a REM instead of running the traffic
+};
+
+/**
+ * \brief The configuration common to all the scenarios
+ */
+struct PerfConfig
+{
+  Time m_simTime {MilliSeconds (500)}; //!< Simulated time of each scenario
+  uint32_t m_uesPerCell {10};          //!< UEs per cell of the scenarios without a fixed number
+  uint16_t m_remResolution {40};       //!< Points per side of the REM
+  double m_frequency {3.5e9};          //!< Central frequency
+  double m_bandwidth {40e6};           //!< Bandwidth
+  uint16_t m_numerology {1};           //!< Numerology
+  Ptr<NrRunRecorder> m_recorder;       //!< Records the traces of the run, if set
+};
+
+/**
+ * \brief The measures of a scenario
+ */
+struct PerfResult
+{
+  uint32_t m_cells {0};          //!< Number of cells
+  uint32_t m_ues {0};            //!< Number of UEs
+  double m_setupSeconds {0.0};   //!< Wall time to build the scenario
+  double m_wallSeconds {0.0};    //!< Wall time of Simulator::Run
+  double m_simSeconds {0.0};     //!< Simulated time
+  uint64_t m_events {0};         //!< Simulator events executed
+  uint64_t m_peakRssKb {0};      //!< Peak resident set size
+  uint64_t m_remPoints {0};      //!< Points of the REM, if any
+  std::array<double, NrPerfProfiler::NUM_SUBSYSTEMS> m_share {}; //!< Share of the wall time per subsystem
+};
+
+/**
+ * \return the scenarios of the benchmark
+ */
+static std::vector<PerfScenario>
+GetScenarios ()
+{
+  std::vector<PerfScenario> scenarios;
+  for (uint32_t ues : {10, 100, 500})
+    {
+      PerfScenario s;
+      s.m_name = "single-cell-" + std::to_string (ues);
+      s.m_uesPerCell = ues;
+      scenarios.push_back (s);
+    }
+  PerfScenario hex7;
+  hex7.m_name = "hex-7";
+  hex7.m_rings = 1;
+  scenarios.push_back (hex7);
+  PerfScenario hex19;
+  hex19.m_name = "hex-19";
+  hex19.m_rings = 3;
+  scenarios.push_back (hex19);
+  PerfScenario mimo;
+  mimo.m_name = "mimo";
+  mimo.m_mimo = true;
+  scenarios.push_back (mimo);
+  PerfScenario realisticBf;
+  realisticBf.m_name = "realistic-bf";
+  realisticBf.m_realisticBf = true;
+  scenarios.push_back (realisticBf);
+  PerfScenario rem;
+  rem.m_name = "rem";
+  rem.m_rem = true;
+  scenarios.push_back (rem);
+  return scenarios;
+}
+
+/**
+ * \return the peak resident set size of the process, in kB, or 0 if unknown
+ */
+static uint64_t
+GetPeakRssKb ()
+{
+#ifdef NR_PERF_HAVE_FORK
+  struct rusage usage;
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+      return static_cast<uint64_t> (usage.ru_maxrss) / 1024;
+#else
+      return static_cast<uint64_t> (usage.ru_maxrss);
+#endif
+    }
+#endif
+  return 0;
+}
+
+/**
+ * \brief Build a scenario, and run it
+ * \param scenario the scenario
+ * \param config the common configuration
+ * \return the measures
+ */
+static PerfResult
+RunScenario (const PerfScenario &scenario, const PerfConfig &config)
+{
+  auto setupStart = std::chrono::steady_clock::now ();
+  PerfResult result;
+  int64_t randomStream = 1;
+
+  Config::SetDefault ("ns3::ThreeGppChannelModel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+  // Without --fork, the scenarios run one after the other in this process:
+  // every default that a scenario changes is set by all of them
+  Config::SetDefault ("ns3::ThreeGppSpectrumPropagationLossModel::ChannelModel",
+                      StringValue (scenario.m_mimo ? "ns3::ThreeGppChannelModelParam"
+                                                   : "ns3::ThreeGppChannelModel"));
+
+  // The deployment: one cell per site
+  ScenarioParameters scenarioParams;
+  scenarioParams.SetScenarioParameters ("UMi");
+  scenarioParams.SetSectorization (ScenarioParameters::SINGLE);
+  HexagonalGridScenarioHelper gridScenario;
+  gridScenario.SetScenarioParameters (scenarioParams);
+  gridScenario.SetNumRings (scenario.m_rings);
+  uint32_t uesPerCell = scenario.m_uesPerCell > 0 ? scenario.m_uesPerCell : config.m_uesPerCell;
+  gridScenario.SetUtNumber (uesPerCell * gridScenario.GetNumSites ());
+  randomStream += gridScenario.AssignStreams (randomStream);
+  gridScenario.CreateScenario ();
+  NodeContainer gnbNodes = gridScenario.GetBaseStations ();
+  NodeContainer ueNodes = gridScenario.GetUserTerminals ();
+  result.m_cells = gnbNodes.GetN ();
+  result.m_ues = ueNodes.GetN ();
+
+  // No EPC: the bearers use the saturation mode of the RLC
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  Ptr<BeamformingHelperBase> beamformingHelper;
+  if (scenario.m_realisticBf)
+    {
+      beamformingHelper = CreateObject<RealisticBeamformingHelper> ();
+      beamformingHelper->SetBeamformingMethod (RealisticBeamformingAlgorithm::GetTypeId ());
+      nrHelper->SetGnbBeamManagerTypeId (RealisticBfManager::GetTypeId ());
+      nrHelper->SetSchedulerAttribute ("SrsSymbols", UintegerValue (1));
+    }
+  else
+    {
+      beamformingHelper = CreateObject<IdealBeamformingHelper> ();
+      beamformingHelper->SetBeamformingMethod (DirectPathBeamforming::GetTypeId ());
+    }
+  nrHelper->SetBeamformingHelper (beamformingHelper);
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (config.m_frequency, config.m_bandwidth, 1,
+                                                  BandwidthPartInfo::UMi_StreetCanyon);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->SetChannelConditionModelAttribute ("UpdatePeriod", TimeValue (MilliSeconds (0)));
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  nrHelper->SetGnbPhyAttribute ("Numerology", UintegerValue (config.m_numerology));
+  if (scenario.m_mimo)
+    {
+      nrHelper->SetGnbAntennaAttribute ("NumRows", UintegerValue (2));
+      nrHelper->SetGnbAntennaAttribute ("NumColumns", UintegerValue (2));
+      nrHelper->SetGnbAntennaAttribute ("AntennaElement", PointerValue (CreateObject<ThreeGppAntennaModel> ()));
+      nrHelper->SetUeAntennaAttribute ("NumRows", UintegerValue (1));
+      nrHelper->SetUeAntennaAttribute ("NumColumns", UintegerValue (1));
+      nrHelper->SetUeAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+      nrHelper->SetUePhyAttribute ("UseFixedRi", BooleanValue (false));
+      nrHelper->SetDlErrorModel ("ns3::NrEesmIrT2");
+      nrHelper->SetUlErrorModel ("ns3::NrEesmIrT2");
+      nrHelper->SetGnbDlAmcAttribute ("AmcModel", EnumValue (NrAmc::ErrorModel));
+      nrHelper->SetGnbUlAmcAttribute ("AmcModel", EnumValue (NrAmc::ErrorModel));
+    }
+  else
+    {
+      nrHelper->SetGnbAntennaAttribute ("NumRows", UintegerValue (4));
+      nrHelper->SetGnbAntennaAttribute ("NumColumns", UintegerValue (8));
+      nrHelper->SetGnbAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+      nrHelper->SetUeAntennaAttribute ("NumRows", UintegerValue (2));
+      nrHelper->SetUeAntennaAttribute ("NumColumns", UintegerValue (4));
+      nrHelper->SetUeAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+    }
+
+  uint8_t subArrays = scenario.m_mimo ? 2 : 1;
+  NetDeviceContainer gnbNetDev = nrHelper->InstallGnbDevice (gnbNodes, allBwps, subArrays);
+  NetDeviceContainer ueNetDev = nrHelper->InstallUeDevice (ueNodes, allBwps, subArrays);
+  randomStream += nrHelper->AssignStreams (gnbNetDev, randomStream);
+  randomStream += nrHelper->AssignStreams (ueNetDev, randomStream);
+
+  if (scenario.m_mimo)
+    {
+      // The two sub-arrays of every device are cross-polarized
+      auto setPolarization = [] (Ptr<NrPhy> phy)
+        {
+          ObjectVectorValue spectrumPhys;
+          phy->GetAttribute ("NrSpectrumPhyList", spectrumPhys);
+          for (uint32_t i = 0; i < spectrumPhys.GetN (); ++i)
+            {
+              Ptr<NrSpectrumPhy> spectrumPhy = spectrumPhys.Get (i)->GetObject<NrSpectrumPhy> ();
+              spectrumPhy->GetAntenna ()->GetObject<UniformPlanarArray> ()->SetAttribute ("PolSlantAngle",
+                                                                                         DoubleValue (i * M_PI / 2));
+            }
+        };
+      for (uint32_t i = 0; i < gnbNetDev.GetN (); ++i)
+        {
+          setPolarization (nrHelper->GetGnbPhy (gnbNetDev.Get (i), 0));
+        }
+      for (uint32_t i = 0; i < ueNetDev.GetN (); ++i)
+        {
+          setPolarization (nrHelper->GetUePhy (ueNetDev.Get (i), 0));
+        }
+    }
+
+  for (auto it = gnbNetDev.Begin (); it != gnbNetDev.End (); ++it)
+    {
+      DynamicCast<NrGnbNetDevice> (*it)->UpdateConfig ();
+    }
+  for (auto it = ueNetDev.Begin (); it != ueNetDev.End (); ++it)
+    {
+      DynamicCast<NrUeNetDevice> (*it)->UpdateConfig ();
+    }
+
+  nrHelper->AttachToClosestEnb (ueNetDev, gnbNetDev);
+  nrHelper->ActivateDataRadioBearer (ueNetDev, EpsBearer (EpsBearer::NGBR_LOW_LAT_EMBB));
+
+  Ptr<NrRadioEnvironmentMapHelper> remHelper;
+  if (scenario.m_rem)
+    {
+      // The REM helper stops the simulation when the map is done
+      double side = gridScenario.GetHexagonalCellRadius () * 2;
+      remHelper = CreateObject<NrRadioEnvironmentMapHelper> ();
+      remHelper->SetMinX (-side);
+      remHelper->SetMaxX (side);
+      remHelper->SetResX (config.m_remResolution);
+      remHelper->SetMinY (-side);
+      remHelper->SetMaxY (side);
+      remHelper->SetResY (config.m_remResolution);
+      remHelper->SetZ (1.5);
+      remHelper->SetSimTag ("nr-perf");
+      remHelper->SetRemMode (NrRadioEnvironmentMapHelper::COVERAGE_AREA);
+      remHelper->CreateRem (gnbNetDev, ueNetDev.Get (0), 0);
+      result.m_remPoints = static_cast<uint64_t> (config.m_remResolution) * config.m_remResolution;
+    }
+  else
+    {
+      Simulator::Stop (config.m_simTime);
+    }
+
+  if (config.m_recorder != nullptr)
+    {
+      config.m_recorder->Connect ();
+    }
+
+  auto runStart = std::chrono::steady_clock::now ();
+  result.m_setupSeconds = std::chrono::duration<double> (runStart - setupStart).count ();
+  NrPerfProfiler::Reset ();
+  uint64_t eventsBefore = Simulator::GetEventCount ();
+
+  Simulator::Run ();
+
+  auto runEnd = std::chrono::steady_clock::now ();
+  result.m_wallSeconds = std::chrono::duration<double> (runEnd - runStart).count ();
+  result.m_simSeconds = Simulator::Now ().GetSeconds ();
+  result.m_events = Simulator::GetEventCount () - eventsBefore;
+  result.m_peakRssKb = GetPeakRssKb ();
+  if (result.m_wallSeconds > 0)
+    {
+      for (uint32_t s = 0; s < NrPerfProfiler::NUM_SUBSYSTEMS; ++s)
+        {
+          double ns = static_cast<double> (NrPerfProfiler::GetTimeNs (static_cast<NrPerfProfiler::Subsystem> (s)));
+          result.m_share[s] = ns / 1e9 / result.m_wallSeconds;
+        }
+    }
+
+  Simulator::Destroy ();
+  return result;
+}
+
+/**
+ * \brief Write the report of a scenario as a JSON object, in one line
+ * \param name the name of the scenario
+ * \param result the measures
+ * \return the JSON object
+ */
+static std::string
+ToJson (const std::string &name, const PerfResult &result)
+{
+  std::ostringstream os;
+  os << std::setprecision (9);
+  os << "{\"name\": \"" << name << "\""
+     << ", \"cells\": " << result.m_cells
+     << ", \"ues\": " << result.m_ues
+     << ", \"setupSeconds\": " << result.m_setupSeconds
+     << ", \"wallSeconds\": " << result.m_wallSeconds
+     << ", \"simSeconds\": " << result.m_simSeconds
+     << ", \"wallPerSimSecond\": "
+     << (result.m_simSeconds > 0 ? result.m_wallSeconds / result.m_simSeconds : 0.0)
+     << ", \"events\": " << result.m_events
+     << ", \"eventsPerSecond\": "
+     << (result.m_wallSeconds > 0 ? result.m_events / result.m_wallSeconds : 0.0)
+     << ", \"peakRssKb\": " << result.m_peakRssKb;
+  if (result.m_remPoints > 0)
+    {
+      os << ", \"remPoints\": " << result.m_remPoints
+         << ", \"wallPerRemPoint\": " << result.m_wallSeconds / result.m_remPoints;
+    }
+  if (NR_PERF_PROFILING != 0)
+    {
+      double other = 1.0;
+      os << ", \"cpuShare\": {";
+      for (uint32_t s = 0; s < NrPerfProfiler::NUM_SUBSYSTEMS; ++s)
+        {
+          os << "\"" << NrPerfProfiler::GetSubsystemName (static_cast<NrPerfProfiler::Subsystem> (s))
+             << "\": " << result.m_share[s] << ", ";
+          other -= result.m_share[s];
+        }
+      os << "\"other\": " << std::max (0.0, other) << "}";
+    }
+  os << "}";
+  return os.str ();
+}
+
+/**
+ * \brief Run a scenario in a child process, if possible
+ * \param scenario the scenario
+ * \param config the common configuration
+ * \param fork whether to run the scenario in a child process
+ * \return the JSON object of the scenario, or an error object
+ */
+static std::string
+RunScenarioInProcess (const PerfScenario &scenario, const PerfConfig &config, bool fork)
+{
+#ifdef NR_PERF_HAVE_FORK
+  if (fork)
+    {
+      std::cout.flush ();
+      int fds[2];
+      NS_ABORT_MSG_IF (pipe (fds) != 0, "Could not create the pipe of scenario " << scenario.m_name);
+      pid_t pid = ::fork ();
+      NS_ABORT_MSG_IF (pid < 0, "Could not fork scenario " << scenario.m_name);
+      if (pid == 0)
+        {
+          close (fds[0]);
+          std::string json = ToJson (scenario.m_name, RunScenario (scenario, config));
+          json += "\n";
+          size_t written = 0;
+          while (written < json.size ())
+            {
+              ssize_t n = write (fds[1], json.data () + written, json.size () - written);
+              if (n <= 0)
+                {
+                  _exit (1);
+                }
+              written += static_cast<size_t> (n);
+            }
+          close (fds[1]);
+          _exit (0);
+        }
+      close (fds[1]);
+      std::string json;
+      char buffer[4096];
+      ssize_t n;
+      while ((n = read (fds[0], buffer, sizeof (buffer))) > 0)
+        {
+          json.append (buffer, static_cast<size_t> (n));
+        }
+      close (fds[0]);
+      int status = 0;
+      waitpid (pid, &status, 0);
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != 0 || json.empty ())
+        {
+          return "{\"name\": \"" + scenario.m_name + "\", \"error\": \"the scenario did not complete\"}";
+        }
+      return json.substr (0, json.find ('\n'));
+    }
+#endif
+  return ToJson (scenario.m_name, RunScenario (scenario, config));
+}
+
+/**
+ * \brief Read a numeric field of a one-line JSON object written by ToJson
+ * \param line the line
+ * \param field the name of the field
+ * \param value the value, if found
+ * \return true if the field was found
+ */
+static bool
+ReadField (const std::string &line, const std::string &field, double *value)
+{
+  std::string key = "\"" + field + "\": ";
+  size_t pos = line.find (key);
+  if (pos == std::string::npos)
+    {
+      return false;
+    }
+  char *end = nullptr;
+  const char *start = line.c_str () + pos + key.size ();
+  *value = std::strtod (start, &end);
+  return end != start;
+}
+
+/**
+ * \brief Read the name of a one-line JSON object written by ToJson
+ * \param line the line
+ * \return the name, or an empty string
+ */
+static std::string
+ReadName (const std::string &line)
+{
+  std::string key = "{\"name\": \"";
+  size_t pos = line.find (key);
+  if (pos == std::string::npos)
+    {
+      return "";
+    }
+  pos += key.size ();
+  return line.substr (pos, line.find ('"', pos) - pos);
+}
+
+/**
+ * \brief Set a list of defaults
+ * \param defaults the "ns3::Type::Attribute=value" pairs, separated by ';'
+ * \return the list of the previous values of the same defaults
+ */
+static std::string
+SetDefaults (const std::string &defaults)
+{
+  std::ostringstream previous;
+  std::stringstream list (defaults);
+  std::string item;
+  while (std::getline (list, item, ';'))
+    {
+      size_t eq = item.find ('=');
+      size_t sep = item.rfind ("::", eq);
+      NS_ABORT_MSG_IF (eq == std::string::npos || sep == std::string::npos,
+                       "Invalid default " << item);
+      TypeId tid = TypeId::LookupByName (item.substr (0, sep));
+      TypeId::AttributeInformation info;
+      NS_ABORT_MSG_IF (!tid.LookupAttributeByName (item.substr (sep + 2, eq - sep - 2), &info),
+                       "Unknown attribute " << item);
+      previous << (previous.tellp () > 0 ? ";" : "") << item.substr (0, eq) << "="
+               << info.initialValue->SerializeToString (info.checker);
+      Config::SetDefault (item.substr (0, eq), StringValue (item.substr (eq + 1)));
+    }
+  return previous.str ();
+}
+
+/**
+ * \brief Run a scenario in this process with the current defaults and with
+ * the alternative ones, and compare the records
+ * \param scenario the scenario
+ * \param config the common configuration
+ * \param alternative the defaults of the alternative mode
+ * \param kpiTolerance the relative tolerance of the KPIs; 0 for identical records
+ * \param json the JSON object of the scenario
+ * \return true if the scenario passes the check
+ */
+static bool
+CheckEquivalence (const PerfScenario &scenario, PerfConfig config,
+                  const std::string &alternative, double kpiTolerance, std::string *json)
+{
+  std::array<Ptr<NrRunRecorder>, 2> records;
+  for (uint32_t run = 0; run < records.size (); ++run)
+    {
+      std::string previous = run == 1 ? SetDefaults (alternative) : "";
+      // The random variables that are not assigned a stream get the same ones
+      RngSeedManager::ResetNextStreamIndex ();
+      config.m_recorder = CreateObject<NrRunRecorder> ();
+      RunScenario (scenario, config);
+      config.m_recorder->Sort ();
+      records.at (run) = config.m_recorder;
+      SetDefaults (previous);
+    }
+
+  NrEquivalenceChecker::Result result = NrEquivalenceChecker::Compare (records.at (0), records.at (1),
+                                                                       kpiTolerance);
+  bool passed = kpiTolerance > 0 ? result.m_withinTolerance : result.m_identical;
+  if (!passed)
+    {
+      std::cerr << "Scenario " << scenario.m_name << " differs: " << result.m_report << std::endl;
+    }
+
+  std::ostringstream os;
+  os << std::setprecision (9);
+  os << "{\"name\": \"" << scenario.m_name << "\""
+     << ", \"identical\": " << (result.m_identical ? "true" : "false")
+     << ", \"withinTolerance\": " << (result.m_withinTolerance ? "true" : "false");
+  for (uint32_t dir = 0; dir < 2; ++dir)
+    {
+      os << ", \"" << (dir == 0 ? "dl" : "ul") << "\": {";
+      for (uint32_t kpi = 0; kpi < NrEquivalenceChecker::NUM_KPIS; ++kpi)
+        {
+          os << (kpi > 0 ? ", " : "") << "\""
+             << NrEquivalenceChecker::GetKpiName (static_cast<NrEquivalenceChecker::Kpi> (kpi))
+             << "\": [" << result.m_baseline[dir][kpi] << ", " << result.m_alternative[dir][kpi] << "]";
+        }
+      os << "}";
+    }
+  os << "}";
+  *json = os.str ();
+  return passed;
+}
+
+int
+main (int argc, char *argv[])
+{
+  PerfConfig config;
+  std::string scenarios;
+  std::string output;
+  std::string baseline;
+  double tolerance = 0.1;
+  bool fork = true;
+  std::string alternative;
+  double kpiTolerance = 0.0;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("scenarios",
+                "Comma-separated list of the scenarios to run; empty for all of them "
+                "(single-cell-10, single-cell-100, single-cell-500, hex-7, hex-19, "
+                "mimo, realistic-bf, rem)",
+                scenarios);
+  cmd.AddValue ("simTime",
+                "Simulated time of each scenario",
+                config.m_simTime);
+  cmd.AddValue ("uesPerCell",
+                "UEs per cell of the hex, mimo, realistic-bf and rem scenarios",
+                config.m_uesPerCell);
+  cmd.AddValue ("remResolution",
+                "Points per side of the REM of the rem scenario",
+                config.m_remResolution);
+  cmd.AddValue ("numerology",
+                "The numerology",
+                config.m_numerology);
+  cmd.AddValue ("output",
+                "File of the JSON report; empty for the standard output",
+                output);
+  cmd.AddValue ("baseline",
+                "JSON report of a previous run, to compare with",
+                baseline);
+  cmd.AddValue ("tolerance",
+                "Relative growth of the wall time per simulated second, or of the "
+                "peak memory, over the baseline that is a regression",
+                tolerance);
+  cmd.AddValue ("fork",
+                "Run each scenario in its own process (needed for a meaningful "
+                "peak memory per scenario)",
+                fork);
+  cmd.AddValue ("alternative",
+                "Defaults of an alternative mode to check against the current one "
+                "(\"ns3::Type::Attribute=value\" pairs, separated by ';'); the "
+                "scenarios are then compared instead of measured",
+                alternative);
+  cmd.AddValue ("kpiTolerance",
+                "Relative tolerance of the KPIs of the --alternative check; 0 "
+                "for identical records",
+                kpiTolerance);
+  cmd.Parse (argc, argv);
+
+  std::vector<PerfScenario> selected;
+  for (const auto & scenario : GetScenarios ())
+    {
+      if (scenarios.empty () || ("," + scenarios + ",").find ("," + scenario.m_name + ",") != std::string::npos)
+        {
+          selected.push_back (scenario);
+        }
+    }
+  NS_ABORT_MSG_IF (selected.empty (), "No scenario matches " << scenarios);
+
+  std::map<std::string, std::string> baselineLines;
+  if (!baseline.empty ())
+    {
+      std::ifstream in (baseline);
+      NS_ABORT_MSG_IF (!in.is_open (), "Can't open the baseline " << baseline);
+      std::string line;
+      while (std::getline (in, line))
+        {
+          std::string name = ReadName (line);
+          if (!name.empty ())
+            {
+              baselineLines[name] = line;
+            }
+        }
+    }
+
+  std::ofstream outFile;
+  if (!output.empty ())
+    {
+      outFile.open (output, std::ofstream::out | std::ofstream::trunc);
+      NS_ABORT_MSG_IF (!outFile.is_open (), "Can't open the output " << output);
+    }
+  std::ostream &out = output.empty () ? std::cout : outFile;
+
+  out << "{\"nrPerf\": 1, \"profiling\": " << (NR_PERF_PROFILING != 0 ? "true" : "false")
+      << ", \"simTime\": " << config.m_simTime.GetSeconds ()
+      << ", \"scenarios\": [" << std::endl;
+
+  uint32_t regressions = 0;
+  for (size_t i = 0; i < selected.size (); ++i)
+    {
+      if (!alternative.empty ())
+        {
+          std::string line;
+          if (!CheckEquivalence (selected.at (i), config, alternative, kpiTolerance, &line))
+            {
+              ++regressions;
+            }
+          out << line << (i + 1 < selected.size () ? "," : "") << std::endl;
+          continue;
+        }
+
+      std::string line = RunScenarioInProcess (selected.at (i), config, fork);
+      out << line << (i + 1 < selected.size () ? "," : "") << std::endl;
+
+      auto it = baselineLines.find (selected.at (i).m_name);
+      if (it == baselineLines.end ())
+        {
+          continue;
+        }
+      for (const std::string field : {"wallPerSimSecond", "peakRssKb"})
+        {
+          double now = 0.0;
+          double before = 0.0;
+          if (ReadField (line, field, &now) && ReadField (it->second, field, &before)
+              && before > 0 && now > before * (1 + tolerance))
+            {
+              std::cerr << "Regression in " << selected.at (i).m_name << ": " << field
+                        << " " << before << " -> " << now << std::endl;
+              ++regressions;
+            }
+        }
+    }
+
+  out << "]}" << std::endl;
+
+  return regressions > 0 ? 1 : 0;
+}
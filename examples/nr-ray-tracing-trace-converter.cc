@@ -0,0 +1,64 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * \ingroup examples
+ * \file nr-ray-tracing-trace-converter.cc
+ *
+ * Converts, once, a text ray-tracing trace of model/Raytracing to the
+ * binary format that RayTracingTrace maps in memory.
+ *
+ * \code{.unparsed}
+$ ./ns3 run "nr-ray-tracing-trace-converter --input=contrib/nr/model/Raytracing/traces10cm.txt --output=traces10cm.bin"
+    \endcode
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/nr-module.h"
+#include <iostream>
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+  std::string input;
+  std::string output;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("input",
+                "The text ray-tracing trace",
+                input);
+  cmd.AddValue ("output",
+                "The binary ray-tracing trace to write",
+                output);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (input.empty (), "Please specify the input file with --input");
+  NS_ABORT_MSG_IF (output.empty (), "Please specify the output file with --output");
+
+  NS_ABORT_MSG_IF (!RayTracingTrace::ConvertTextToBinary (input, output),
+                   "Could not convert " << input);
+
+  RayTracingTrace trace;
+  NS_ABORT_MSG_IF (!trace.Open (output), "Could not read back " << output);
+  std::cout << "Converted " << trace.GetNumSamples () << " samples to " << output << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,569 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * \ingroup examples
+ * \file nr-scheduler-benchmark.cc
+ *
+ * Micro-benchmark of the NrMacSchedulerNs3 schedulers. Every scheduler in
+ * the list is driven directly through its NrMacSchedSapProvider and
+ * NrMacCschedSapProvider, without PHY, MAC or channel: a fake MAC gives,
+ * in every slot, full-buffer RLC and BSR reports, synthetic DL CQI (WB, or
+ * SB with --subbandCqi) and UL CQI, and the HARQ feedback (with a NACK
+ * probability of --bler) of the DCI produced in the previous slots.
+ *
+ * \code{.unparsed}
+$ ./ns3 run "nr-scheduler-benchmark --schedulers=OfdmaPF,TdmaRR --ues=64 --beams=4 --rbgs=51 --streams=2"
+    \endcode
+ *
+ * For each scheduler, the program prints the time spent in the SAP calls of
+ * a slot (ns/slot), the number of DL and UL data DCI in a slot
+ * (allocations/slot) and the number of heap allocations done during the
+ * SAP calls of a slot (heap allocs/slot). The first --warmupSlots slots
+ * are not measured. The heap allocations are counted by replacing the
+ * global operator new in this program.
+ *
+ * If the module is built with NR_SCHEDULER_PHASE_TIMING, the program also
+ * prints the mean time of each phase of ScheduleDl and ScheduleUl, from the
+ * histograms of the scheduler (warm-up slots included).
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/nr-module.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+using namespace ns3;
+
+/**
+ * \brief Number of calls to the global operator new of this program
+ */
+static std::atomic<uint64_t> g_heapAllocations {0};
+
+void *
+operator new (std::size_t size)
+{
+  ++g_heapAllocations;
+  void *p = std::malloc (size == 0 ? 1 : size);
+  if (p == nullptr)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, [[maybe_unused]] std::size_t size) noexcept
+{
+  std::free (p);
+}
+
+/**
+ * \brief The fake MAC: answers to the scheduler queries, and keeps the DCI
+ * of every slot to generate their feedback
+ */
+class BenchmarkMacSchedSapUser : public NrMacSchedSapUser
+{
+public:
+  /**
+   * \brief A data DCI, with the slot in which it is transmitted
+   */
+  struct SentDci
+  {
+    SfnSf m_sfnSf;                               //!< The slot of the DCI
+    std::shared_ptr<DciInfoElementTdma> m_dci;   //!< The DCI
+  };
+
+  /**
+   * \brief Constructor
+   * \param numRbPerRbg number of RB per RBG
+   * \param model the spectrum model, one band per RB
+   * \param numerology the numerology
+   */
+  BenchmarkMacSchedSapUser (uint32_t numRbPerRbg, Ptr<const SpectrumModel> model, uint8_t numerology)
+    : m_numRbPerRbg (numRbPerRbg), m_model (model), m_numerology (numerology)
+  {
+  }
+
+  virtual void SchedConfigInd (const struct SchedConfigIndParameters& params) override
+  {
+    for (const auto & varTti : params.m_slotAllocInfo.m_varTtiAllocInfo)
+      {
+        if (varTti.m_dci->m_type != DciInfoElementTdma::DATA || varTti.m_dci->m_rnti == 0)
+          {
+            continue;
+          }
+        ++m_allocations;
+        SentDci sent {params.m_sfnSf, varTti.m_dci};
+        if (varTti.m_dci->m_format == DciInfoElementTdma::DL)
+          {
+            m_dlDci.emplace_back (std::move (sent));
+          }
+        else
+          {
+            m_ulDci.emplace_back (std::move (sent));
+          }
+      }
+  }
+
+  virtual Ptr<const SpectrumModel> GetSpectrumModel () const override
+  {
+    return m_model;
+  }
+
+  virtual uint32_t GetNumRbPerRbg () const override
+  {
+    return m_numRbPerRbg;
+  }
+
+  virtual uint8_t GetNumHarqProcess () const override
+  {
+    return 20;
+  }
+
+  virtual uint16_t GetBwpId () const override
+  {
+    return 0;
+  }
+
+  virtual uint16_t GetCellId () const override
+  {
+    return 0;
+  }
+
+  virtual uint32_t GetSymbolsPerSlot () const override
+  {
+    return 14;
+  }
+
+  virtual Time GetSlotPeriod () const override
+  {
+    return MicroSeconds (1000 >> m_numerology);
+  }
+
+  virtual double GetBeamCoupling ([[maybe_unused]] const BeamConfId &a,
+                                  [[maybe_unused]] const BeamConfId &b) const override
+  {
+    return -1.0;
+  }
+
+  std::vector<SentDci> m_dlDci;   //!< DL data DCI without feedback yet
+  std::vector<SentDci> m_ulDci;   //!< UL data DCI without feedback yet
+  uint64_t m_allocations {0};     //!< Number of data DCI received
+
+private:
+  uint32_t m_numRbPerRbg;            //!< Number of RB per RBG
+  Ptr<const SpectrumModel> m_model;  //!< The spectrum model
+  uint8_t m_numerology;              //!< The numerology
+};
+
+/**
+ * \brief The fake MAC for the configuration primitives: nothing to do
+ */
+class BenchmarkMacCschedSapUser : public NrMacCschedSapUser
+{
+public:
+  virtual void CschedCellConfigCnf ([[maybe_unused]] const struct CschedCellConfigCnfParameters& params) override {}
+  virtual void CschedUeConfigCnf ([[maybe_unused]] const struct CschedUeConfigCnfParameters& params) override {}
+  virtual void CschedLcConfigCnf ([[maybe_unused]] const struct CschedLcConfigCnfParameters& params) override {}
+  virtual void CschedLcReleaseCnf ([[maybe_unused]] const struct CschedLcReleaseCnfParameters& params) override {}
+  virtual void CschedUeReleaseCnf ([[maybe_unused]] const struct CschedUeReleaseCnfParameters& params) override {}
+  virtual void CschedUeConfigUpdateInd ([[maybe_unused]] const struct CschedUeConfigUpdateIndParameters& params) override {}
+  virtual void CschedCellConfigUpdateInd ([[maybe_unused]] const struct CschedCellConfigUpdateIndParameters& params) override {}
+};
+
+/**
+ * \brief The configuration of a run
+ */
+struct BenchmarkConfig
+{
+  uint32_t m_ues {16};              //!< Number of UEs
+  uint32_t m_beams {1};             //!< Number of beams (UEs are spread over them)
+  uint32_t m_rbgs {51};             //!< Number of RBGs
+  uint32_t m_rbPerRbg {1};          //!< Number of RB per RBG
+  uint32_t m_streams {1};           //!< Number of DL MIMO streams reported by the UEs
+  uint32_t m_numerology {1};        //!< Numerology
+  uint32_t m_slots {10000};         //!< Measured slots
+  uint32_t m_warmupSlots {100};     //!< Slots not measured
+  uint32_t m_ulDelay {2};           //!< Slots between the UL scheduling and the UL slot
+  double m_bler {0.1};              //!< Probability of a NACK
+  bool m_subbandCqi {false};        //!< Report SB CQI instead of WB
+  std::string m_rbgAssignment;      //!< RbgAssignmentMode of the OFDMA schedulers (empty: default)
+};
+
+/**
+ * \brief The result of a run
+ */
+struct BenchmarkResult
+{
+  double m_nsPerSlot {0.0};              //!< Time spent in the SAP calls per slot
+  double m_allocationsPerSlot {0.0};     //!< Data DCI per slot
+  double m_heapAllocationsPerSlot {0.0}; //!< Heap allocations in the SAP calls per slot
+  std::array<std::array<double, NrMacSchedulerPhaseTimes::NUM_PHASES>, 2> m_phaseNs {}; //!< Mean time of each phase, UL (0) and DL (1)
+};
+
+/**
+ * \brief Run a scheduler for the configured number of slots
+ * \param schedulerType the TypeId name of the scheduler
+ * \param config the configuration
+ * \return the measures
+ */
+static BenchmarkResult
+RunScheduler (const std::string &schedulerType, const BenchmarkConfig &config)
+{
+  ObjectFactory schedFactory;
+  schedFactory.SetTypeId (schedulerType);
+  Ptr<NrMacSchedulerNs3> sched = DynamicCast<NrMacSchedulerNs3> (schedFactory.Create ());
+  NS_ABORT_MSG_IF (sched == nullptr, "Can't create a NrMacSchedulerNs3 from type " + schedulerType);
+  if (!config.m_rbgAssignment.empty ())
+    {
+      sched->SetAttributeFailSafe ("RbgAssignmentMode", StringValue (config.m_rbgAssignment));
+    }
+
+  uint32_t numRbs = config.m_rbgs * config.m_rbPerRbg;
+  double scs = 15e3 * std::pow (2, config.m_numerology);
+  Ptr<const SpectrumModel> model = NrSpectrumValueHelper::GetSpectrumModel (numRbs, 28e9, scs);
+
+  BenchmarkMacSchedSapUser macSap (config.m_rbPerRbg, model, config.m_numerology);
+  BenchmarkMacCschedSapUser macCsap;
+  sched->SetMacSchedSapUser (&macSap);
+  sched->SetMacCschedSapUser (&macCsap);
+  sched->InstallDlAmc (CreateObject<NrAmc> ());
+  sched->InstallUlAmc (CreateObject<NrAmc> ());
+
+  NrMacSchedSapProvider *provider = sched->GetMacSchedSapProvider ();
+  NrMacCschedSapProvider *cprovider = sched->GetMacCschedSapProvider ();
+
+  NrMacCschedSapProvider::CschedCellConfigReqParameters cellParams;
+  cellParams.m_ulBandwidth = config.m_rbgs;
+  cellParams.m_dlBandwidth = config.m_rbgs;
+  cprovider->CschedCellConfigReq (cellParams);
+
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  random->SetStream (1);
+
+  // The reports of the UEs do not change during the run: the quality of
+  // each UE is drawn once, and gives its CQI and its UL SINR
+  NrMacSchedSapProvider::SchedDlCqiInfoReqParameters dlCqi;
+  NrMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters bsr;
+  std::vector<NrMacSchedSapProvider::SchedDlRlcBufferReqParameters> rlc;
+  std::vector<std::vector<NrStorageReal>> ulSinr;
+  for (uint16_t rnti = 1; rnti <= config.m_ues; ++rnti)
+    {
+      uint32_t beam = (rnti - 1) % config.m_beams;
+      NrMacCschedSapProvider::CschedUeConfigReqParameters ueParams;
+      ueParams.m_rnti = rnti;
+      ueParams.m_beamConfId = BeamConfId (BeamId (static_cast<uint16_t> (beam), 90.0),
+                                          BeamId::GetEmptyBeamId ());
+      cprovider->CschedUeConfigReq (ueParams);
+
+      NrMacCschedSapProvider::CschedLcConfigReqParameters lcParams;
+      lcParams.m_rnti = rnti;
+      lcParams.m_reconfigureFlag = false;
+      LogicalChannelConfigListElement_s lc;
+      lc.m_logicalChannelIdentity = 3;
+      lc.m_logicalChannelGroup = 1;
+      lc.m_direction = LogicalChannelConfigListElement_s::DIR_BOTH;
+      lc.m_qosBearerType = LogicalChannelConfigListElement_s::QBT_NON_GBR;
+      lc.m_qci = 9;
+      lcParams.m_logicalChannelConfigList.emplace_back (lc);
+      cprovider->CschedLcConfigReq (lcParams);
+
+      double quality = random->GetValue (0.0, 1.0);
+
+      DlCqiInfo cqi;
+      cqi.m_rnti = rnti;
+      cqi.m_ri = static_cast<uint8_t> (config.m_streams);
+      cqi.m_wbCqi.assign (config.m_streams, static_cast<uint8_t> (1 + std::lround (quality * 14)));
+      if (config.m_subbandCqi)
+        {
+          cqi.m_cqiType = DlCqiInfo::SB;
+          for (uint32_t rbg = 0; rbg < config.m_rbgs; ++rbg)
+            {
+              int32_t sb = cqi.m_wbCqi.at (0) + random->GetInteger (0, 4) - 2;
+              cqi.m_sbCqi.push_back (static_cast<uint8_t> (std::max (1, std::min (15, sb))));
+            }
+        }
+      dlCqi.m_cqiList.emplace_back (std::move (cqi));
+
+      NrMacSchedSapProvider::SchedDlRlcBufferReqParameters rlcParams;
+      rlcParams.m_rnti = rnti;
+      rlcParams.m_logicalChannelIdentity = 3;
+      rlcParams.m_rlcTransmissionQueueSize = 1000000;
+      rlcParams.m_rlcTransmissionQueueHolDelay = 0;
+      rlcParams.m_rlcRetransmissionQueueSize = 0;
+      rlcParams.m_rlcRetransmissionHolDelay = 0;
+      rlcParams.m_rlcStatusPduSize = 0;
+      rlc.emplace_back (rlcParams);
+
+      MacCeElement ce;
+      ce.m_rnti = rnti;
+      ce.m_macCeType = MacCeElement::BSR;
+      ce.m_macCeValue.m_bufferStatus = {0, NrMacShortBsrCe::FromBytesToLevel (1000000), 0, 0};
+      bsr.m_macCeList.emplace_back (std::move (ce));
+
+      double sinrDb = -5.0 + quality * 30.0;
+      ulSinr.emplace_back (numRbs, std::pow (10.0, sinrDb / 10.0));
+    }
+
+  std::vector<DlHarqInfo> dlHarq;
+  std::vector<UlHarqInfo> ulHarq;
+  std::vector<NrMacSchedSapProvider::SchedUlCqiInfoReqParameters> ulCqi;
+
+  SfnSf dlSfn (0, 0, 0, static_cast<uint8_t> (config.m_numerology));
+  std::chrono::nanoseconds elapsed {0};
+  uint64_t heapAllocations = 0;
+  uint64_t allocations = 0;
+
+  for (uint32_t slot = 0; slot < config.m_warmupSlots + config.m_slots; ++slot)
+    {
+      // The feedback of the slots that are already in the past
+      dlHarq.clear ();
+      ulHarq.clear ();
+      ulCqi.clear ();
+      auto isPast = [&dlSfn] (const BenchmarkMacSchedSapUser::SentDci &sent)
+        {
+          return sent.m_sfnSf.Normalize () < dlSfn.Normalize ();
+        };
+      for (const auto & sent : macSap.m_dlDci)
+        {
+          if (!isPast (sent))
+            {
+              continue;
+            }
+          DlHarqInfo harq;
+          harq.m_rnti = sent.m_dci->m_rnti;
+          harq.m_harqProcessId = sent.m_dci->m_harqProcess;
+          harq.m_bwpIndex = 0;
+          for (size_t stream = 0; stream < sent.m_dci->m_tbSize.size (); ++stream)
+            {
+              if (sent.m_dci->m_tbSize.at (stream) == 0)
+                {
+                  harq.m_harqStatus.push_back (DlHarqInfo::NONE);
+                }
+              else
+                {
+                  harq.m_harqStatus.push_back (random->GetValue () < config.m_bler ? DlHarqInfo::NACK
+                                                                                    : DlHarqInfo::ACK);
+                }
+              harq.m_numRetx.push_back (sent.m_dci->m_rv.at (stream));
+            }
+          dlHarq.emplace_back (std::move (harq));
+        }
+      for (const auto & sent : macSap.m_ulDci)
+        {
+          if (!isPast (sent))
+            {
+              continue;
+            }
+          UlHarqInfo harq;
+          harq.m_rnti = sent.m_dci->m_rnti;
+          harq.m_harqProcessId = sent.m_dci->m_harqProcess;
+          harq.m_bwpIndex = 0;
+          harq.m_receptionStatus = random->GetValue () < config.m_bler ? UlHarqInfo::NotOk
+                                                                       : UlHarqInfo::Ok;
+          harq.m_numRetx = sent.m_dci->m_rv.at (0);
+          ulHarq.emplace_back (std::move (harq));
+
+          // One UL CQI for all the allocations that start at the same symbol
+          bool found = false;
+          for (const auto & v : ulCqi)
+            {
+              found = found || (v.m_sfnSf == sent.m_sfnSf && v.m_symStart == sent.m_dci->m_symStart);
+            }
+          if (!found)
+            {
+              NrMacSchedSapProvider::SchedUlCqiInfoReqParameters cqi;
+              cqi.m_sfnSf = sent.m_sfnSf;
+              cqi.m_symStart = sent.m_dci->m_symStart;
+              cqi.m_ulCqi.m_type = UlCqiInfo::PUSCH;
+              cqi.m_ulCqi.m_sinr = ulSinr.at (sent.m_dci->m_rnti - 1);
+              ulCqi.emplace_back (std::move (cqi));
+            }
+        }
+      macSap.m_dlDci.erase (std::remove_if (macSap.m_dlDci.begin (), macSap.m_dlDci.end (), isPast),
+                            macSap.m_dlDci.end ());
+      macSap.m_ulDci.erase (std::remove_if (macSap.m_ulDci.begin (), macSap.m_ulDci.end (), isPast),
+                            macSap.m_ulDci.end ());
+
+      NrMacSchedSapProvider::SchedDlTriggerReqParameters dlTrigger;
+      dlTrigger.m_snfSf = dlSfn;
+      dlTrigger.m_slotType = LteNrTddSlotType::F;
+      dlTrigger.m_dlHarqInfoList = dlHarq;
+      NrMacSchedSapProvider::SchedUlTriggerReqParameters ulTrigger;
+      ulTrigger.m_snfSf = dlSfn.GetFutureSfnSf (config.m_ulDelay);
+      ulTrigger.m_slotType = LteNrTddSlotType::F;
+      ulTrigger.m_ulHarqInfoList = ulHarq;
+      dlCqi.m_sfnsf = dlSfn;
+      bsr.m_sfnSf = dlSfn;
+
+      // The DCI of the slot are kept until their feedback, out of the measure
+      macSap.m_dlDci.reserve (macSap.m_dlDci.size () + 2 * config.m_ues);
+      macSap.m_ulDci.reserve (macSap.m_ulDci.size () + 2 * config.m_ues);
+
+      uint64_t allocationsBefore = macSap.m_allocations;
+      uint64_t heapBefore = g_heapAllocations;
+      auto start = std::chrono::steady_clock::now ();
+
+      // Same order as in NrGnbMac: UL indication, then DL indication
+      for (const auto & v : ulCqi)
+        {
+          provider->SchedUlCqiInfoReq (v);
+        }
+      provider->SchedUlMacCtrlInfoReq (bsr);
+      provider->SchedUlTriggerReq (ulTrigger);
+      provider->SchedDlCqiInfoReq (dlCqi);
+      for (const auto & v : rlc)
+        {
+          provider->SchedDlRlcBufferReq (v);
+        }
+      provider->SchedDlTriggerReq (dlTrigger);
+
+      auto end = std::chrono::steady_clock::now ();
+      if (slot >= config.m_warmupSlots)
+        {
+          elapsed += std::chrono::duration_cast<std::chrono::nanoseconds> (end - start);
+          heapAllocations += g_heapAllocations - heapBefore;
+          allocations += macSap.m_allocations - allocationsBefore;
+        }
+
+      dlSfn.Add (1);
+    }
+
+  BenchmarkResult result;
+  if (config.m_slots > 0)
+    {
+      result.m_nsPerSlot = static_cast<double> (elapsed.count ()) / config.m_slots;
+      result.m_allocationsPerSlot = static_cast<double> (allocations) / config.m_slots;
+      result.m_heapAllocationsPerSlot = static_cast<double> (heapAllocations) / config.m_slots;
+    }
+  for (uint32_t dir = 0; dir < 2; ++dir)
+    {
+      for (uint32_t phase = 0; phase < NrMacSchedulerPhaseTimes::NUM_PHASES; ++phase)
+        {
+          const NrMacSchedulerPhaseHistogram &histogram =
+            sched->GetPhaseHistogram (dir == 1, static_cast<NrMacSchedulerPhaseTimes::Phase> (phase));
+          if (histogram.GetTotal () > 0)
+            {
+              result.m_phaseNs[dir][phase] = static_cast<double> (histogram.GetSum ()) / histogram.GetTotal ();
+            }
+        }
+    }
+  return result;
+}
+
+int
+main (int argc, char *argv[])
+{
+  BenchmarkConfig config;
+  std::string schedulers = "OfdmaPF,OfdmaRR,OfdmaMR,TdmaPF,TdmaRR,TdmaMR";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("schedulers",
+                "Comma-separated list of schedulers, e.g. OfdmaPF,TdmaRR",
+                schedulers);
+  cmd.AddValue ("ues",
+                "Number of UEs",
+                config.m_ues);
+  cmd.AddValue ("beams",
+                "Number of beams; the UEs are spread over them",
+                config.m_beams);
+  cmd.AddValue ("rbgs",
+                "Number of RBGs of the band",
+                config.m_rbgs);
+  cmd.AddValue ("rbPerRbg",
+                "Number of RB per RBG",
+                config.m_rbPerRbg);
+  cmd.AddValue ("streams",
+                "Number of DL MIMO streams reported by the UEs (1 to 4)",
+                config.m_streams);
+  cmd.AddValue ("numerology",
+                "The numerology",
+                config.m_numerology);
+  cmd.AddValue ("slots",
+                "Number of measured slots",
+                config.m_slots);
+  cmd.AddValue ("warmupSlots",
+                "Number of slots before the measure",
+                config.m_warmupSlots);
+  cmd.AddValue ("bler",
+                "Probability of a NACK in the HARQ feedback",
+                config.m_bler);
+  cmd.AddValue ("subbandCqi",
+                "Report SB CQI instead of WB CQI",
+                config.m_subbandCqi);
+  cmd.AddValue ("rbgAssignment",
+                "RbgAssignmentMode of the OFDMA schedulers (SortLoop, Heap, BestRbg or Soa); "
+                "empty for the default",
+                config.m_rbgAssignment);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (config.m_ues == 0 || config.m_ues > 65000, "Invalid number of UEs " << config.m_ues);
+  NS_ABORT_MSG_IF (config.m_beams == 0, "At least one beam is needed");
+  NS_ABORT_MSG_IF (config.m_rbgs == 0 || config.m_rbPerRbg == 0, "Invalid band");
+  NS_ABORT_MSG_IF (config.m_streams == 0 || config.m_streams > NR_MAX_STREAMS,
+                   "Only 1 to " << +NR_MAX_STREAMS << " streams are supported");
+
+  std::cout << std::left << std::setw (12) << "scheduler"
+            << std::right << std::setw (14) << "ns/slot"
+            << std::setw (20) << "allocations/slot"
+            << std::setw (20) << "heap allocs/slot" << std::endl;
+
+  std::stringstream list (schedulers);
+  std::string name;
+  while (std::getline (list, name, ','))
+    {
+      BenchmarkResult result = RunScheduler ("ns3::NrMacScheduler" + name, config);
+      std::cout << std::left << std::setw (12) << name
+                << std::right << std::fixed << std::setprecision (1)
+                << std::setw (14) << result.m_nsPerSlot
+                << std::setw (20) << result.m_allocationsPerSlot
+                << std::setw (20) << result.m_heapAllocationsPerSlot << std::endl;
+      if (NR_SCHEDULER_PHASE_TIMING != 0)
+        {
+          for (uint32_t dir = 0; dir < 2; ++dir)
+            {
+              std::cout << "  " << (dir == 1 ? "DL" : "UL") << " ns/slot per phase:";
+              for (uint32_t phase = 0; phase < NrMacSchedulerPhaseTimes::NUM_PHASES; ++phase)
+                {
+                  std::cout << " " << NrMacSchedulerPhaseTimes::GetPhaseName (static_cast<NrMacSchedulerPhaseTimes::Phase> (phase))
+                            << "=" << result.m_phaseNs[dir][phase];
+                }
+              std::cout << std::endl;
+            }
+        }
+    }
+
+  Simulator::Destroy ();
+  return 0;
+}
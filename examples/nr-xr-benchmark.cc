@@ -0,0 +1,244 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * \ingroup examples
+ * \file nr-xr-benchmark.cc
+ *
+ * XR / cloud gaming benchmark of the scheduler. The gNBs are placed by
+ * GridScenarioHelper on --gNbRows x --gNbColumns, and every gNB serves
+ * --uesPerGnb UEs, each one receiving in DL the XR traffic of TR 38.838
+ * from a remote host (XrTrafficApplication): --fps frames per second of
+ * mean size --bitRate / --fps, with the jitter and the frame size spread of
+ * the TR, split in packets sent at once. The traffic is bursty and must
+ * meet a deadline: a frame counts only if all its packets arrive within
+ * --pdb from its generation.
+ *
+ * \code{.unparsed}
+$ ./ns3 run "nr-xr-benchmark --gNbRows=2 --gNbColumns=2 --uesPerGnb=50 --fps=60 --bitRate=30Mb/s --scheduler=OfdmaPF"
+    \endcode
+ *
+ * The XrTrafficSink of every UE aggregates the frame statistics online. At
+ * the end, the program prints, over all the UEs, the share of frames on
+ * time, the mean and the 99th percentile of the frame latency, and the
+ * share of satisfied UEs (with at least --satisfaction of their frames on
+ * time, 99% in the TR capacity evaluation). It also prints the wall time
+ * per simulated second and the number of simulator events per wall-clock
+ * second, so that the scenario can be used to track the performance of the
+ * scheduler under this load. With --coalesceVarTti, the PHYs schedule their
+ * varTTIs with CoalesceVarTtiEvents, and the number of events drops.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/antenna-module.h"
+#include "ns3/nr-module.h"
+#include "ns3/xr-traffic-application.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("NrXrBenchmark");
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t gNbRows = 1;
+  uint32_t gNbColumns = 1;
+  uint32_t uesPerGnb = 10;
+  double fps = 60.0;
+  std::string bitRate = "30Mb/s";
+  Time pdb = MilliSeconds (10);
+  double satisfaction = 0.99;
+  std::string scheduler = "OfdmaPF";
+  uint16_t numerology = 1;
+  double frequency = 3.5e9;
+  double bandwidth = 100e6;
+  double totalTxPower = 40;
+  Time simTime = Seconds (1);
+  Time appStartTime = MilliSeconds (400);
+  uint32_t packetSize = 1500;
+  bool coalesceVarTti = false;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("gNbRows", "Rows of gNBs of the grid", gNbRows);
+  cmd.AddValue ("gNbColumns", "Columns of gNBs of the grid", gNbColumns);
+  cmd.AddValue ("uesPerGnb", "UEs per gNB", uesPerGnb);
+  cmd.AddValue ("fps", "Frames per second of the XR traffic", fps);
+  cmd.AddValue ("bitRate", "Mean bit rate of the XR traffic of a UE", bitRate);
+  cmd.AddValue ("pdb", "Packet delay budget of a frame", pdb);
+  cmd.AddValue ("satisfaction", "Share of frames on time of a satisfied UE", satisfaction);
+  cmd.AddValue ("scheduler", "Scheduler, e.g. OfdmaPF, OfdmaRR, TdmaPF", scheduler);
+  cmd.AddValue ("numerology", "Numerology", numerology);
+  cmd.AddValue ("frequency", "Central frequency", frequency);
+  cmd.AddValue ("bandwidth", "Bandwidth", bandwidth);
+  cmd.AddValue ("totalTxPower", "Total TX power of a gNB, in dBm", totalTxPower);
+  cmd.AddValue ("simTime", "Simulated time", simTime);
+  cmd.AddValue ("packetSize", "Maximum size of the packets of a frame", packetSize);
+  cmd.AddValue ("coalesceVarTti", "Schedule the varTTIs of the PHYs in one event per boundary "
+                "(CoalesceVarTtiEvents)", coalesceVarTti);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_IF (simTime <= appStartTime + pdb, "The simulation is too short");
+  int64_t randomStream = 1;
+
+  GridScenarioHelper gridScenario;
+  gridScenario.SetRows (gNbRows);
+  gridScenario.SetColumns (gNbColumns);
+  gridScenario.SetHorizontalBsDistance (50.0);
+  gridScenario.SetVerticalBsDistance (50.0);
+  gridScenario.SetBsHeight (10.0);
+  gridScenario.SetUtHeight (1.5);
+  gridScenario.SetSectorization (GridScenarioHelper::SINGLE);
+  gridScenario.SetBsNumber (gNbRows * gNbColumns);
+  gridScenario.SetUtNumber (uesPerGnb * gNbRows * gNbColumns);
+  gridScenario.SetScenarioHeight (50.0 * gNbRows);
+  gridScenario.SetScenarioLength (50.0 * gNbColumns);
+  randomStream += gridScenario.AssignStreams (randomStream);
+  gridScenario.CreateScenario ();
+  NodeContainer ueNodes = gridScenario.GetUserTerminals ();
+
+  Ptr<NrPointToPointEpcHelper> epcHelper = CreateObject<NrPointToPointEpcHelper> ();
+  Ptr<IdealBeamformingHelper> beamformingHelper = CreateObject<IdealBeamformingHelper> ();
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  nrHelper->SetBeamformingHelper (beamformingHelper);
+  nrHelper->SetEpcHelper (epcHelper);
+  epcHelper->SetAttribute ("S1uLinkDelay", TimeValue (MilliSeconds (0)));
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (frequency, bandwidth, 1, BandwidthPartInfo::UMi_StreetCanyon);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  Config::SetDefault ("ns3::ThreeGppChannelModel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+  nrHelper->SetChannelConditionModelAttribute ("UpdatePeriod", TimeValue (MilliSeconds (0)));
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  beamformingHelper->SetAttribute ("BeamformingMethod", TypeIdValue (DirectPathBeamforming::GetTypeId ()));
+  nrHelper->SetSchedulerTypeId (TypeId::LookupByName ("ns3::NrMacScheduler" + scheduler));
+  nrHelper->SetGnbPhyAttribute ("Numerology", UintegerValue (numerology));
+  nrHelper->SetGnbPhyAttribute ("TxPower", DoubleValue (totalTxPower));
+  nrHelper->SetGnbPhyAttribute ("CoalesceVarTtiEvents", BooleanValue (coalesceVarTti));
+  nrHelper->SetUePhyAttribute ("CoalesceVarTtiEvents", BooleanValue (coalesceVarTti));
+  nrHelper->SetUeAntennaAttribute ("NumRows", UintegerValue (2));
+  nrHelper->SetUeAntennaAttribute ("NumColumns", UintegerValue (4));
+  nrHelper->SetUeAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+  nrHelper->SetGnbAntennaAttribute ("NumRows", UintegerValue (4));
+  nrHelper->SetGnbAntennaAttribute ("NumColumns", UintegerValue (8));
+  nrHelper->SetGnbAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+
+  NetDeviceContainer gnbNetDev = nrHelper->InstallGnbDevice (gridScenario.GetBaseStations (), allBwps);
+  NetDeviceContainer ueNetDev = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  randomStream += nrHelper->AssignStreams (gnbNetDev, randomStream);
+  randomStream += nrHelper->AssignStreams (ueNetDev, randomStream);
+  for (auto it = gnbNetDev.Begin (); it != gnbNetDev.End (); ++it)
+    {
+      DynamicCast<NrGnbNetDevice> (*it)->UpdateConfig ();
+    }
+  for (auto it = ueNetDev.Begin (); it != ueNetDev.End (); ++it)
+    {
+      DynamicCast<NrUeNetDevice> (*it)->UpdateConfig ();
+    }
+
+  // The remote host, behind the PGW
+  Ptr<Node> pgw = epcHelper->GetPgwNode ();
+  NodeContainer remoteHostContainer;
+  remoteHostContainer.Create (1);
+  Ptr<Node> remoteHost = remoteHostContainer.Get (0);
+  InternetStackHelper internet;
+  internet.Install (remoteHostContainer);
+  PointToPointHelper p2ph;
+  p2ph.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("100Gb/s")));
+  p2ph.SetDeviceAttribute ("Mtu", UintegerValue (2500));
+  p2ph.SetChannelAttribute ("Delay", TimeValue (Seconds (0.000)));
+  NetDeviceContainer internetDevices = p2ph.Install (pgw, remoteHost);
+  Ipv4AddressHelper ipv4h;
+  Ipv4StaticRoutingHelper ipv4RoutingHelper;
+  ipv4h.SetBase ("1.0.0.0", "255.0.0.0");
+  ipv4h.Assign (internetDevices);
+  Ptr<Ipv4StaticRouting> remoteHostStaticRouting = ipv4RoutingHelper.GetStaticRouting (remoteHost->GetObject<Ipv4> ());
+  remoteHostStaticRouting->AddNetworkRouteTo (Ipv4Address ("7.0.0.0"), Ipv4Mask ("255.0.0.0"), 1);
+  internet.Install (ueNodes);
+  Ipv4InterfaceContainer ueIpIface = epcHelper->AssignUeIpv4Address (ueNetDev);
+  for (uint32_t j = 0; j < ueNodes.GetN (); ++j)
+    {
+      Ptr<Ipv4StaticRouting> ueStaticRouting = ipv4RoutingHelper.GetStaticRouting (ueNodes.Get (j)->GetObject<Ipv4> ());
+      ueStaticRouting->SetDefaultRoute (epcHelper->GetUeDefaultGatewayAddress (), 1);
+    }
+  nrHelper->AttachToClosestEnb (ueNetDev, gnbNetDev);
+
+  // The XR traffic, on the default bearer of every UE. The sinks stop a
+  // budget after the sources, so that the last frames can arrive.
+  const uint16_t port = 4000;
+  std::vector<Ptr<XrTrafficSink> > sinks;
+  for (uint32_t i = 0; i < ueNodes.GetN (); ++i)
+    {
+      Ptr<XrTrafficSink> sink = CreateObject<XrTrafficSink> ();
+      sink->SetAttribute ("Local", AddressValue (InetSocketAddress (Ipv4Address::GetAny (), port)));
+      sink->SetAttribute ("PacketDelayBudget", TimeValue (pdb));
+      ueNodes.Get (i)->AddApplication (sink);
+      sink->SetStartTime (appStartTime);
+      sink->SetStopTime (simTime);
+      sinks.push_back (sink);
+
+      Ptr<XrTrafficApplication> source = CreateObject<XrTrafficApplication> ();
+      source->SetAttribute ("Remote", AddressValue (InetSocketAddress (ueIpIface.GetAddress (i), port)));
+      source->SetAttribute ("Fps", DoubleValue (fps));
+      source->SetAttribute ("DataRate", DataRateValue (DataRate (bitRate)));
+      source->SetAttribute ("PacketSize", UintegerValue (packetSize));
+      randomStream += source->AssignStreams (randomStream);
+      remoteHost->AddApplication (source);
+      source->SetStartTime (appStartTime);
+      source->SetStopTime (simTime - pdb);
+    }
+
+  Simulator::Stop (simTime + MilliSeconds (1));
+  auto start = std::chrono::steady_clock::now ();
+  uint64_t eventsBefore = Simulator::GetEventCount ();
+  Simulator::Run ();
+  double wallSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+  uint64_t events = Simulator::GetEventCount () - eventsBefore;
+
+  XrFrameStats total;
+  uint32_t satisfied = 0;
+  for (const auto &sink : sinks)
+    {
+      const XrFrameStats &stats = sink->GetStats ();
+      total.Merge (stats);
+      satisfied += stats.GetFrames () > 0 && stats.GetReliability () >= satisfaction ? 1 : 0;
+    }
+
+  double simSeconds = simTime.GetSeconds ();
+  std::cout << std::fixed << std::setprecision (3)
+            << "cells: " << gnbNetDev.GetN () << ", UEs: " << ueNodes.GetN ()
+            << ", scheduler: " << scheduler << ", " << fps << " fps at " << bitRate << std::endl
+            << "frames: " << total.GetFrames () << ", on time: " << 100.0 * total.GetReliability () << "%" << std::endl
+            << "frame latency: mean " << total.GetMeanLatency ().GetSeconds () * 1e3 << " ms, 99th percentile "
+            << total.GetLatencyPercentile (99.0).GetSeconds () * 1e3 << " ms" << std::endl
+            << "satisfied UEs: " << 100.0 * satisfied / ueNodes.GetN () << "%" << std::endl
+            << "wall time per simulated second: " << wallSeconds / simSeconds << " s, events: " << events
+            << ", events per second: " << (wallSeconds > 0 ? events / wallSeconds : 0.0) << std::endl;
+
+  Simulator::Destroy ();
+  return 0;
+}
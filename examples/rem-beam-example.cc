@@ -84,6 +84,8 @@ main (int argc, char *argv[])
   double yMax = 1000.0;
   uint16_t yRes = 100;
   std::string simTag = "";
+  bool analytic = false;
+  std::string layerCacheDir = "";
 
   CommandLine cmd (__FILE__);
   cmd.AddValue ("simTag",
@@ -119,6 +121,14 @@ main (int argc, char *argv[])
   cmd.AddValue ("yRes",
                 "The resolution on the y axis of the rem map",
                 yRes);
+  cmd.AddValue ("analytic",
+                "If true, the beams are drawn with their LOS array gains and the free "
+                "space path loss instead of a 3GPP channel realization per point",
+                analytic);
+  cmd.AddValue ("layerCacheDir",
+                "With analytic, the directory in which the gain layers of the gNBs are "
+                "kept, so that the next runs only calculate the ones that changed",
+                layerCacheDir);
 
   cmd.Parse (argc, argv);
 
@@ -207,6 +217,11 @@ main (int argc, char *argv[])
   remHelper->SetResY (yRes);
   remHelper->SetSimTag (simTag);
   remHelper->SetRemMode (NrRadioEnvironmentMapHelper::BEAM_SHAPE);
+  if (analytic)
+    {
+      remHelper->SetBeamShapeModel (NrRadioEnvironmentMapHelper::ANALYTIC_FREE_SPACE);
+      remHelper->SetAttribute ("LayerCacheDir", StringValue (layerCacheDir));
+    }
 
   //configure beam that will be shown in REM map
   DynamicCast<NrGnbNetDevice> (gnbNetDev.Get (0))->GetPhy (0)->GetSpectrumPhy(0)->GetBeamManager ()->SetSector (sector, theta);
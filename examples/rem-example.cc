@@ -140,6 +140,7 @@ main (int argc, char *argv[])
   double yMax = 50.0;
   uint16_t yRes = 50;
   double z = 1.5;
+  uint32_t remWorkers = 1;
 
   CommandLine cmd (__FILE__);
   cmd.AddValue ("remMode",
@@ -268,6 +269,9 @@ main (int argc, char *argv[])
   cmd.AddValue ("z",
                 "The z coordinate of the rem map",
                 z);
+  cmd.AddValue ("remWorkers",
+                "The number of worker processes that calculate the rem map",
+                remWorkers);
 
   cmd.Parse (argc, argv);
 
@@ -629,6 +633,7 @@ main (int argc, char *argv[])
   remHelper->SetResY (yRes);
   remHelper->SetZ (z);
   remHelper->SetSimTag (simTag);
+  remHelper->SetNumWorkers (remWorkers);
 
   gnbNetDev.Get (0)->GetObject<NrGnbNetDevice> ()->GetPhy (remBwpId)->GetSpectrumPhy(0)->GetBeamManager ()->ChangeBeamformingVector (ueNetDev.Get (0));
 
@@ -97,6 +97,21 @@ protected:
                         const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
                         const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const;
 
+  /**
+   * \brief Saves the beamforming vectors of a pair of devices in their beam
+   * managers, and makes the UE use its new vector
+   * \param gNbDev a pointer to a gNB device
+   * \param ueDev a pointer to a UE device
+   * \param [in] gnbSpectrumPhy the spectrum phy of the gNB
+   * \param [in] ueSpectrumPhy the spectrum phy of the UE
+   * \param [in] bfPair the beamforming vector pair of the gNB and the UE
+   */
+  void SetBeamformingVectors (const Ptr<NrGnbNetDevice>& gNbDev,
+                              const Ptr<NrUeNetDevice>& ueDev,
+                              const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                              const Ptr<NrSpectrumPhy>& ueSpectrumPhy,
+                              const BeamformingVectorPair &bfPair) const;
+
   /**
    * \brief Function that will call the configured algorithm for the specified devices and obtain
    * the beamforming vectors for each of them.
@@ -20,10 +20,14 @@
  */
 #include "file-scenario-helper.h"
 #include <ns3/core-module.h>
+#include <ns3/csv-reader.h>
 #include <ns3/mobility-module.h>
 
 #include <cmath>  // M_PI (but non-standard)
+#include <fstream>
+#include <map>
 #include <sstream>
+#include <utility>
 
 using namespace ns3;
 
@@ -35,21 +39,21 @@ namespace {
  * (BS) and user terminals (UT). Positions and cell
  * radius must be given in meters
  *
- * \param sitePositioner Site position allocator
- * \param utPositioner Vector of user terminals positions
+ * \param sitePositions Vector of site positions
+ * \param utPositions Vector of user terminals positions
  * \param numSectors the plot deployment sector parameter
  * \param maxRadius the plot deployment max radius
  * \param effIsd the plot deployment ISD
  */
 static void
-PlotDeployment (const Ptr<const ListPositionAllocator> &sitePositioner,
-                const Ptr<const ListPositionAllocator> &utPositioner,
+PlotDeployment (const std::vector<Vector> &sitePositions,
+                const std::vector<Vector> &utPositions,
                 const std::size_t numSectors,
                 const double maxRadius,
                 const double effIsd)
 {
-  std::size_t numSites = sitePositioner->GetSize ();
-  std::size_t numUts = utPositioner->GetSize ();
+  std::size_t numSites = sitePositions.size ();
+  std::size_t numUts = utPositions.size ();
   std::size_t numCells = numSites * numSectors;
 
   NS_ASSERT (numSites);
@@ -83,9 +87,8 @@ PlotDeployment (const Ptr<const ListPositionAllocator> &sitePositioner,
   /** \todo: Need to recalculate ranges if the scenario origin is different to (0,0) */
 
   // Plo the UEs first, so the sector arrows are on top
-  for (std::size_t utId = 0; utId < numUts; ++utId)
+  for (const Vector &utPos : utPositions)
     {
-      Vector utPos = utPositioner->GetNext ();
       // set label at xPos, yPos, zPos "" point pointtype 7 pointsize 2
       topologyOutfile << "set label at " << utPos.x << " , " << utPos.y <<
           " point pointtype 7 pointsize 0.5 center" << std::endl;
@@ -101,7 +104,7 @@ PlotDeployment (const Ptr<const ListPositionAllocator> &sitePositioner,
 
   for (std::size_t siteId = 0; siteId < numSites; ++siteId)
     {
-      Vector site = sitePositioner->GetNext ();
+      const Vector &site = sitePositions[siteId];
 
       for (std::size_t sector = 0; sector < numSectors; ++sector)
         {
@@ -135,6 +138,28 @@ PlotDeployment (const Ptr<const ListPositionAllocator> &sitePositioner,
 
 }  // PlotDeployment ()
 
+/**
+ * \brief A row of a file of positions
+ */
+struct SiteRow
+{
+  double x;   //!< X coordinate
+  double y;   //!< Y coordinate
+  bool hasZ;  //!< True if the row gives the Z coordinate
+  double z;   //!< Z coordinate, if given
+};
+
+/**
+ * \brief The rows of the files read by this process, by path and delimiter
+ * \return the rows of each file
+ */
+std::map<std::pair<std::string, char>, std::vector<SiteRow> > &
+GetFileCache ()
+{
+  static std::map<std::pair<std::string, char>, std::vector<SiteRow> > cache;
+  return cache;
+}
+
 }  // unnamed namespace
 
 
@@ -149,13 +174,84 @@ void
 FileScenarioHelper::Add (const std::string filePath,
                          char delimiter /* = ',' */)
 {
-  if (! m_bsPositioner)
+  auto &cache = GetFileCache ();
+  auto it = cache.find (std::make_pair (filePath, delimiter));
+  if (it == cache.end ())
+    {
+      // Same format as ListPositionAllocator::Add, read in one pass
+      std::vector<SiteRow> rows;
+      CsvReader csv (filePath, delimiter);
+      while (csv.FetchNextRow ())
+        {
+          if (csv.ColumnCount () == 1)
+            {
+              // comment line
+              continue;
+            }
+
+          SiteRow row {0, 0, csv.ColumnCount () > 2, 0};
+          bool ok = csv.GetValue (0, row.x);
+          NS_ASSERT_MSG (ok, "failed reading x in row " << csv.RowNumber () << " of " << filePath);
+          ok = csv.GetValue (1, row.y);
+          NS_ASSERT_MSG (ok, "failed reading y in row " << csv.RowNumber () << " of " << filePath);
+          if (row.hasZ)
+            {
+              ok = csv.GetValue (2, row.z);
+              NS_ASSERT_MSG (ok, "failed reading z in row " << csv.RowNumber () << " of " << filePath);
+            }
+          rows.push_back (row);
+        }
+      it = cache.emplace (std::make_pair (filePath, delimiter), std::move (rows)).first;
+    }
+
+  for (const auto &row : it->second)
     {
-      m_bsPositioner = CreateObject<ListPositionAllocator> ();
+      m_sitePositions.push_back (Vector (row.x, row.y, row.hasZ ? row.z : m_bsHeight));
     }
-  m_bsPositioner->Add (filePath, m_bsHeight, delimiter);
-  auto numSites = m_bsPositioner->GetSize ();
-  SetSitesNumber (numSites);
+  SetSitesNumber (m_sitePositions.size ());
+}
+
+void
+FileScenarioHelper::Preload (const std::string &filePath,
+                             char delimiter /* = ',' */)
+{
+  FileScenarioHelper helper;
+  helper.Add (filePath, delimiter);
+  GetEffectiveIsd (helper.m_sitePositions);
+}
+
+double
+FileScenarioHelper::GetEffectiveIsd (const std::vector<Vector> &sitePositions)
+{
+  static std::vector<std::pair<std::vector<Vector>, double> > cache;
+  for (const auto &entry : cache)
+    {
+      if (entry.first == sitePositions)
+        {
+          return entry.second;
+        }
+    }
+
+  double effIsd = 0;
+  for (auto v = sitePositions.begin ();
+       v != sitePositions.end ();
+       ++v)
+    {
+      auto w = v;
+      ++w;
+      for ( ; w < sitePositions.end(); ++w)
+        {
+          NS_ASSERT (w != v);
+          double range = (*w - *v).GetLength ();
+          effIsd += range;
+
+        }  // for w : sitePositions
+
+    }  // for v : sitePositions
+  double numSites = static_cast<double> (sitePositions.size ());
+  effIsd /= numSites * (numSites - 1) / 2;
+  cache.emplace_back (sitePositions, effIsd);
+  return effIsd;
 }
 
 void
@@ -179,7 +275,7 @@ FileScenarioHelper::GetSitePosition (std::size_t cellId) const
 void
 FileScenarioHelper::CreateScenario ()
 {
-  NS_ASSERT_MSG (m_bsPositioner,
+  NS_ASSERT_MSG (!m_sitePositions.empty (),
                  "Must Add() a position file before CreateScenario()");
 
   //NS_ASSERT_MSG (m_numSites > 0,
@@ -201,67 +297,25 @@ FileScenarioHelper::CreateScenario ()
   // Accumulate maxRadius and effIsd
   double maxRadius = 0;
   // For effective ISD we have to iterate over all pairs of towers :(
-  // so cache the positions from m_bsPositioner
-  std::cout << "      reserving sitePositions" << std::endl;
-  std::vector<Vector> sitePositions;
-  sitePositions.reserve (m_numSites);
-
-  // Position the BS cells
-  std::cout << "      creating bsPositions" << std::endl;
-  Ptr<ListPositionAllocator> bsPositions = CreateObject<ListPositionAllocator> ();
-  std::size_t cellId = 0;
-  for (std::size_t siteId = 0; siteId < m_numSites; ++siteId)
-    {
-      Vector site = m_bsPositioner->GetNext ();
-      sitePositions.push_back (site);
+  const std::vector<Vector> &sitePositions = m_sitePositions;
 
+  // Each BS is at the position of a site, in turn: the antenna offset of
+  // the sectors is not applied
+  std::cout << "      BS mobility" << std::endl;
+  std::vector<Vector> bsPositions;
+  bsPositions.reserve (m_numBs);
+  for (std::size_t cellId = 0; cellId < m_numBs; ++cellId)
+    {
+      const Vector &site = sitePositions[cellId % m_numSites];
       maxRadius = std::max (maxRadius, std::abs(site.x));
       maxRadius = std::max (maxRadius, std::abs(site.y));
-
-      std::cout << "        sectors for site " << siteId << std::endl;
-      for (std::size_t sector = 0; sector < sectors; ++sector)
-        {
-          Vector bs {site};
-          double angle = GetAntennaOrientationRadians(cellId);
-          bs.x += m_antennaOffset * cos (angle);
-          bs.y += m_antennaOffset * sin (angle);
-
-          bsPositions->Add (bs);
-          ++cellId;
-
-        }  // for cell
-
-    }  // for site
-  NS_ASSERT_MSG (cellId == m_numBs,
-                 "Computed positions for " << cellId <<
-                 " cells, expected " << m_numBs);
-
-
-  std::cout << "      BS mobility" << std::endl;
-  MobilityHelper mobility;
-  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-  mobility.SetPositionAllocator (m_bsPositioner);
-  mobility.Install (m_bs);
+      bsPositions.push_back (site);
+    }
+  InstallConstantPositions (m_bs, bsPositions);
 
   // Compute effective ISD
-  double effIsd = 0;
   std::cout << "      computing average Isd..." << std::flush;
-  for (auto v = sitePositions.begin ();
-       v != sitePositions.end ();
-       ++v)
-    {
-      auto w = v;
-      ++w;
-      for ( ; w < sitePositions.end(); ++w)
-        {
-          NS_ASSERT (w != v);
-          double range = (*w - *v).GetLength ();
-          effIsd += range;
-
-        }  // for w : sitePositions
-
-    }  // for v : sitePositions
-  effIsd /= m_numSites * (m_numSites - 1) / 2;
+  double effIsd = GetEffectiveIsd (sitePositions);
   std::cout << effIsd << std::endl;
 
 
@@ -289,7 +343,9 @@ FileScenarioHelper::CreateScenario ()
   theta->SetStream (RngSeedManager::GetNextStreamIndex ());
   std::cout << "done" << std::endl;
 
-  Ptr<ListPositionAllocator> utPositioner = CreateObject<ListPositionAllocator> ();;
+  const double halfWidth = 2 * M_PI / sectors / 2;
+  std::vector<Vector> utPositions;
+  utPositions.reserve (m_numUt);
   for (uint32_t utId = 0; utId < m_numUt; ++utId)
     {
       auto cellId = GetCellIndex (utId);
@@ -300,25 +356,21 @@ FileScenarioHelper::CreateScenario ()
       // See https://stackoverflow.com/questions/5837572
       double d = std::sqrt (r->GetValue ());
       double boreSight = GetAntennaOrientationRadians (cellId);
-      double halfWidth = 2 * M_PI / sectors / 2;
-      theta->SetAttribute ("Min", DoubleValue (boreSight - halfWidth));
-      theta->SetAttribute ("Max", DoubleValue (boreSight + halfWidth));
-      double t = theta->GetValue ();
+      double t = theta->GetValue (boreSight - halfWidth, boreSight + halfWidth);
 
       Vector utPos (cellPos);
       utPos.x += d * cos (t);
       utPos.y += d * sin (t);
       utPos.z = m_utHeight;
 
-      utPositioner->Add (utPos);
+      utPositions.push_back (utPos);
     }
 
   std::cout << "      UE mobility" << std::endl;
-  mobility.SetPositionAllocator (utPositioner);
-  mobility.Install (m_ut);
+  InstallConstantPositions (m_ut, utPositions);
 
   std::cout << "      plot deployment" << std::endl;
-  PlotDeployment (m_bsPositioner, utPositioner, sectors, maxRadius, outerR);
+  PlotDeployment (sitePositions, utPositions, sectors, maxRadius, outerR);
 
   m_scenarioCreated = true;
 }
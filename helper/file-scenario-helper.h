@@ -22,16 +22,12 @@
 #define FILE_SCENARIO_HELPER_H
 
 #include "node-distribution-scenario-interface.h"
-#include <ns3/ptr.h>
 #include <ns3/vector.h>
 
 #include <vector>
 
 namespace ns3 {
 
-// Forward declaration
-class ListPositionAllocator;
-
 /**
  * @brief The FileScenarioHelper class
  *
@@ -68,6 +64,21 @@ public:
   void Add (const std::string filePath,
             char delimiter = ',');
 
+  /**
+   * \brief Read a file of positions, and compute its effective ISD, once
+   * for the whole process.
+   *
+   * The following Add() of the same file, and the CreateScenario() of
+   * exactly its sites, take them from memory. A campaign that forks a
+   * process per run calls it before forking, so that the runs share the
+   * parsed sites.
+   *
+   * \param [in] filePath The path to the input file.
+   * \param [in] delimiter The delimiter character; see CsvReader.
+   */
+  static void Preload (const std::string &filePath,
+                       char delimiter = ',');
+
   /**
    * \brief Get the site position corresponding to a given cell.
    * \param cellId the cell ID of the antenna
@@ -88,14 +99,21 @@ private:
    */
   void CheckScenario (const char * where) const;
 
+  /**
+   * \brief Get the mean distance between all the pairs of sites,
+   * computed once for each set of sites of the process.
+   * \param sitePositions The positions of the sites.
+   * \return The effective ISD.
+   */
+  static double GetEffectiveIsd (const std::vector<Vector> &sitePositions);
+
   /** Have we created the scenario yet? */
   bool m_scenarioCreated {false};
 
   /**
-   * The position allocator holding the actual site positions
-   * read from the file.
+   * The site positions read from the files.
    */
-  Ptr<ListPositionAllocator> m_bsPositioner;
+  std::vector<Vector> m_sitePositions;
 
 };
 
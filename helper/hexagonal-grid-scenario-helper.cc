@@ -18,9 +18,10 @@
  */
 #include "hexagonal-grid-scenario-helper.h"
 #include <ns3/double.h>
-#include <ns3/mobility-helper.h>
+#include <ns3/node.h>
 #include "ns3/constant-velocity-mobility-model.h"
 #include <cmath>
+#include <fstream>
 
 namespace ns3 {
 
@@ -102,15 +103,15 @@ std::vector<double> HexagonalGridScenarioHelper::siteAngles {0, // 0 ring
  * \param cellRadius Hexagonal cell radius in meters
  */
 static void
-PlotHexagonalDeployment (const Ptr<const ListPositionAllocator> &sitePosVector,
-                         const Ptr<const ListPositionAllocator> &cellCenterVector,
-                         const Ptr<const ListPositionAllocator> &utPosVector,
+PlotHexagonalDeployment (const std::vector<Vector> &sitePosVector,
+                         const std::vector<Vector> &cellCenterVector,
+                         const std::vector<Vector> &utPosVector,
                          double cellRadius)
 {
-  uint16_t numCells = cellCenterVector->GetSize ();
-  uint16_t numSites = sitePosVector->GetSize ();
+  uint16_t numCells = cellCenterVector.size ();
+  uint16_t numSites = sitePosVector.size ();
   uint16_t numSectors = numCells / numSites;
-  uint16_t numUts = utPosVector->GetSize ();
+  std::size_t numUts = utPosVector.size ();
   NS_ASSERT_MSG (numCells > 0, "no cells");
   NS_ASSERT_MSG (numSites > 0, "no sites");
   NS_ASSERT_MSG (numUts > 0,   "no uts");
@@ -138,19 +139,15 @@ PlotHexagonalDeployment (const Ptr<const ListPositionAllocator> &sitePosVector,
   double arrowLength = cellRadius/4.0;  //<! Control the arrow length that indicates the orientation of the sectorized antenna
   std::vector<double> hx {0.0,-0.5,-0.5,0.0,0.5,0.5,0.0};   //<! Hexagon vertices in x-axis
   std::vector<double> hy {-1.0,-0.5,0.5,1.0,0.5,-0.5,-1.0}; //<! Hexagon vertices in y-axis
-  Vector sitePos;
 
   for (uint16_t cellId = 0; cellId < numCells; ++cellId)
     {
-      Vector cellPos = cellCenterVector->GetNext ();
+      const Vector &cellPos = cellCenterVector[cellId];
       double angleDeg = 30 + 120 * (cellId % 3);
       double angleRad = angleDeg * M_PI / 180;
       double x, y;
 
-      if (cellId % numSectors == 0)
-        {
-          sitePos = sitePosVector->GetNext ();
-        }
+      const Vector &sitePos = sitePosVector[cellId / numSectors];
       topologyOutfile << "set arrow " << cellId + 1 << " from " << sitePos.x
           << "," << sitePos.y << " rto " << arrowLength * std::cos(angleRad)
       << "," << arrowLength * std::sin(angleRad) << " arrowstyle 1 \n";
@@ -179,9 +176,8 @@ PlotHexagonalDeployment (const Ptr<const ListPositionAllocator> &sitePosVector,
 
     }
 
-  for (uint16_t utId = 0; utId < numUts; ++utId)
+  for (const Vector &utPos : utPosVector)
     {
-      Vector utPos = utPosVector->GetNext ();
 //      set label at xPos, yPos, zPos "" point pointtype 7 pointsize 2
       topologyOutfile << "set label at " << utPos.x << " , " << utPos.y <<
           " point pointtype 7 pointsize 0.2 center" << std::endl;
@@ -285,101 +281,11 @@ HexagonalGridScenarioHelper::GetHexagonalCellCenter (const Vector &sitePos,
 
 
 void
-HexagonalGridScenarioHelper::CreateScenario ()
-{
-  m_hexagonalRadius = m_isd / 3;
-
-  m_bs.Create (m_numBs);
-  m_ut.Create (m_numUt);
-
-  NS_ASSERT (m_isd > 0);
-  NS_ASSERT (m_numRings < 6);
-  NS_ASSERT (m_hexagonalRadius > 0);
-  NS_ASSERT (m_bsHeight >= 0.0);
-  NS_ASSERT (m_utHeight >= 0.0);
-  NS_ASSERT (m_bs.GetN () > 0);
-  NS_ASSERT (m_ut.GetN () > 0);
-
-  MobilityHelper mobility;
-  Ptr<ListPositionAllocator> bsPosVector = CreateObject<ListPositionAllocator> ();
-  Ptr<ListPositionAllocator> bsCenterVector = CreateObject<ListPositionAllocator> ();
-  Ptr<ListPositionAllocator> sitePosVector = CreateObject<ListPositionAllocator> ();
-  Ptr<ListPositionAllocator> utPosVector = CreateObject<ListPositionAllocator> ();
-
-  // BS position
-  for (uint16_t cellId = 0; cellId < m_numBs; cellId++)
-    {
-      uint16_t siteIndex = GetSiteIndex (cellId);
-      Vector sitePos (m_centralPos);
-      const double dist = siteDistances.at(siteIndex);
-      const double angleRad = siteAngles.at(siteIndex) * M_PI / 180;
-      sitePos.x += m_isd * dist * cos(angleRad);
-      sitePos.y += m_isd * dist * sin(angleRad);
-      sitePos.z = m_bsHeight;
-
-      if (GetSectorIndex (cellId) == 0)
-        {
-          sitePosVector->Add (sitePos);
-        }
-
-      // FIXME: Until sites can have more than one antenna array, it is necessary to apply some distance offset from the site center (gNBs cannot have the same location)
-      Vector bsPos = GetAntennaPosition (sitePos, cellId);
-
-      bsPosVector->Add (bsPos);
-
-      // Store cell center position for plotting the deployment
-      Vector cellCenterPos = GetHexagonalCellCenter (bsPos, cellId);
-      bsCenterVector->Add (cellCenterPos);
-
-      //What about the antenna orientation? It should be dealt with when installing the gNB
-    }
-
-  // To allocate UEs, I need the center of the hexagonal cell.
-  // Allocate UE around the disk of radius isd/3, the diameter of a the
-  // hexagon representing the footprint of a single sector.
-  // Reduce this radius by the min BS-UT distance, to respect that standoff
-  // at the one corner of the sector hexagon where the sector antenna lies.
-  // This results in UTs uniformly distributed in a disc centered on
-  // the sector hexagon; there are no UTs near the vertices of the hexagon.
-  // Spread UEs inside the inner hexagonal radius
-  // Need to weight r to get uniform in the sector hexagon
-  // See https://stackoverflow.com/questions/5837572
-  // Set max = radius^2 here, then take sqrt below
-  const double outerR = m_hexagonalRadius * std::sqrt(3) / 2 - m_minBsUtDistance;
-  m_r->SetAttribute ("Min", DoubleValue (0));
-  m_r->SetAttribute ("Max", DoubleValue (outerR * outerR));
-  m_theta->SetAttribute ("Min", DoubleValue (-1.0 * M_PI));
-  m_theta->SetAttribute ("Max", DoubleValue (M_PI));
-
-  // UT position
-
-  for (uint32_t utId = 0; utId < m_ut.GetN(); ++utId)
-    {
-      double d = std::sqrt (m_r->GetValue ());
-      double t = m_theta->GetValue ();
-
-      // Vector utPos (cellCenterPos);
-      Vector utPos (bsCenterVector->GetNext ());
-      utPos.x += d * cos (t);
-      utPos.y += d * sin (t);
-      utPos.z = m_utHeight;
-
-      utPosVector->Add (utPos);
-    }
-
-  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-  mobility.SetPositionAllocator (bsPosVector);
-  mobility.Install (m_bs);
-
-  mobility.SetPositionAllocator (utPosVector);
-  mobility.Install (m_ut);
-
-  PlotHexagonalDeployment (sitePosVector, bsCenterVector, utPosVector, m_hexagonalRadius);
-
-}
-
-void
-HexagonalGridScenarioHelper::CreateScenarioWithMobility (const Vector &speed, double percentage)
+HexagonalGridScenarioHelper::CreatePositions (double percentage,
+                                              std::vector<Vector> *sitePosVector,
+                                              std::vector<Vector> *bsPosVector,
+                                              std::vector<Vector> *bsCenterVector,
+                                              std::vector<Vector> *utPosVector)
 {
   m_hexagonalRadius = m_isd / 3;
 
@@ -393,15 +299,13 @@ HexagonalGridScenarioHelper::CreateScenarioWithMobility (const Vector &speed, do
   NS_ASSERT (m_utHeight >= 0.0);
   NS_ASSERT (m_bs.GetN () > 0);
   NS_ASSERT (m_ut.GetN () > 0);
-  NS_ASSERT_MSG (percentage >=0 || percentage <=1, "Percentage must between 0"
-                                                   " and 1");
+  NS_ASSERT_MSG (percentage >= 0 && percentage <= 1, "Percentage must between 0"
+                                                     " and 1");
 
-  MobilityHelper mobility;
-  MobilityHelper ueMobility;
-  Ptr<ListPositionAllocator> bsPosVector = CreateObject<ListPositionAllocator> ();
-  Ptr<ListPositionAllocator> bsCenterVector = CreateObject<ListPositionAllocator> ();
-  Ptr<ListPositionAllocator> sitePosVector = CreateObject<ListPositionAllocator> ();
-  Ptr<ListPositionAllocator> utPosVector = CreateObject<ListPositionAllocator> ();
+  sitePosVector->reserve (m_numSites);
+  bsPosVector->reserve (m_numBs);
+  bsCenterVector->reserve (m_numBs);
+  utPosVector->reserve (m_numUt);
 
   // BS position
   for (uint16_t cellId = 0; cellId < m_numBs; cellId++)
@@ -416,17 +320,17 @@ HexagonalGridScenarioHelper::CreateScenarioWithMobility (const Vector &speed, do
 
       if (GetSectorIndex (cellId) == 0)
         {
-          sitePosVector->Add (sitePos);
+          sitePosVector->push_back (sitePos);
         }
 
       // FIXME: Until sites can have more than one antenna array, it is necessary to apply some distance offset from the site center (gNBs cannot have the same location)
       Vector bsPos = GetAntennaPosition (sitePos, cellId);
 
-      bsPosVector->Add (bsPos);
+      bsPosVector->push_back (bsPos);
 
       // Store cell center position for plotting the deployment
       Vector cellCenterPos = GetHexagonalCellCenter (bsPos, cellId);
-      bsCenterVector->Add (cellCenterPos);
+      bsCenterVector->push_back (cellCenterPos);
 
       //What about the antenna orientation? It should be dealt with when installing the gNB
     }
@@ -448,21 +352,17 @@ HexagonalGridScenarioHelper::CreateScenarioWithMobility (const Vector &speed, do
   m_theta->SetAttribute ("Min", DoubleValue (-1.0 * M_PI));
   m_theta->SetAttribute ("Max", DoubleValue (M_PI));
 
-  // UT position
+  // UT position, with the draws in the same order as they always were, so
+  // that a given seed and run keep giving the same deployment
 
-  uint32_t numUesWithRandomUtHeight = 0;
-  if (percentage != 0)
-    {
-      numUesWithRandomUtHeight = percentage * m_ut.GetN ();
-    }
+  uint32_t numUesWithRandomUtHeight = percentage * m_ut.GetN ();
 
   for (uint32_t utId = 0; utId < m_ut.GetN (); ++utId)
     {
       double d = std::sqrt (m_r->GetValue ());
       double t = m_theta->GetValue ();
 
-      // Vector utPos (cellCenterPos);
-      Vector utPos (bsCenterVector->GetNext ());
+      Vector utPos ((*bsCenterVector)[utId % m_numBs]);
       utPos.x += d * cos (t);
       utPos.y += d * sin (t);
 
@@ -480,28 +380,45 @@ HexagonalGridScenarioHelper::CreateScenarioWithMobility (const Vector &speed, do
           utPos.z = m_utHeight;
         }
 
-      utPosVector->Add (utPos);
+      utPosVector->push_back (utPos);
     }
+}
+
+void
+HexagonalGridScenarioHelper::CreateScenario ()
+{
+  std::vector<Vector> sitePosVector;
+  std::vector<Vector> bsPosVector;
+  std::vector<Vector> bsCenterVector;
+  std::vector<Vector> utPosVector;
+  CreatePositions (0.0, &sitePosVector, &bsPosVector, &bsCenterVector, &utPosVector);
+
+  InstallConstantPositions (m_bs, bsPosVector);
+  InstallConstantPositions (m_ut, utPosVector);
 
-  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-  mobility.SetPositionAllocator (bsPosVector);
-  mobility.Install (m_bs);
+  PlotHexagonalDeployment (sitePosVector, bsCenterVector, utPosVector, m_hexagonalRadius);
+}
 
-  //mobility.SetPositionAllocator (utPosVector);
-  //mobility.Install (m_ut);
+void
+HexagonalGridScenarioHelper::CreateScenarioWithMobility (const Vector &speed, double percentage)
+{
+  std::vector<Vector> sitePosVector;
+  std::vector<Vector> bsPosVector;
+  std::vector<Vector> bsCenterVector;
+  std::vector<Vector> utPosVector;
+  CreatePositions (percentage, &sitePosVector, &bsPosVector, &bsCenterVector, &utPosVector);
 
-  ueMobility.SetMobilityModel ("ns3::ConstantVelocityMobilityModel");
-  ueMobility.SetPositionAllocator (utPosVector);
-  ueMobility.Install (m_ut);
+  InstallConstantPositions (m_bs, bsPosVector);
 
   for (uint32_t i = 0; i < m_ut.GetN (); i++)
     {
-      m_ut.Get (i)->GetObject<ConstantVelocityMobilityModel> ()->SetVelocity (speed);
+      Ptr<ConstantVelocityMobilityModel> mobility = CreateObject<ConstantVelocityMobilityModel> ();
+      m_ut.Get (i)->AggregateObject (mobility);
+      mobility->SetPosition (utPosVector[i]);
+      mobility->SetVelocity (speed);
     }
 
-
   PlotHexagonalDeployment (sitePosVector, bsCenterVector, utPosVector, m_hexagonalRadius);
-
 }
 
 int64_t
@@ -512,4 +429,19 @@ HexagonalGridScenarioHelper::AssignStreams (int64_t stream)
   return 2;
 }
 
+Ptr<NrWrapAroundModel>
+HexagonalGridScenarioHelper::GetWrapAroundModel ()
+{
+  if (m_wrapAround == nullptr)
+    {
+      NS_ABORT_MSG_IF (m_bs.GetN () == 0, "The scenario has not been created");
+      NS_ABORT_MSG_IF (m_numRings != 1 && m_numRings != 3,
+                       "Wrap-around needs 1 or 3 rings, not " << +m_numRings);
+      m_wrapAround = CreateObject<NrWrapAroundModel> ();
+      m_wrapAround->SetCluster (m_isd, m_numSites);
+      m_wrapAround->Install (m_bs);
+    }
+  return m_wrapAround;
+}
+
 } // namespace ns3
@@ -22,6 +22,7 @@
 #include "node-distribution-scenario-interface.h"
 #include <ns3/vector.h>
 #include <ns3/random-variable-stream.h>
+#include <ns3/nr-wrap-around-model.h>
 
 namespace ns3 {
 
@@ -110,7 +111,34 @@ public:
    */
   int64_t AssignStreams (int64_t stream);
 
+  /**
+   * \brief Get the wrap-around model of the deployment
+   *
+   * The first call, after CreateScenario or CreateScenarioWithMobility,
+   * creates the model and the nodes of the copies of the BSs (after all the
+   * nodes of the scenario). Only the deployments of 1 and 3 rings (7 and 19
+   * sites) can be wrapped. Pass the model to NrHelper::SetWrapAroundModel
+   * before NrHelper::InitializeOperationBand.
+   *
+   * \return the wrap-around model
+   */
+  Ptr<NrWrapAroundModel> GetWrapAroundModel ();
+
 private:
+  /**
+   * \brief Create the nodes, and compute the positions of the deployment
+   * \param percentage Percentage (decimal) of UEs with random antenna height > 1.5 m
+   * \param sitePosVector the position of each site
+   * \param bsPosVector the position of each BS
+   * \param bsCenterVector the center of the hexagon of each BS
+   * \param utPosVector the position of each UT
+   */
+  void CreatePositions (double percentage,
+                        std::vector<Vector> *sitePosVector,
+                        std::vector<Vector> *bsPosVector,
+                        std::vector<Vector> *bsCenterVector,
+                        std::vector<Vector> *utPosVector);
+
   uint8_t m_numRings {0};  //!< Number of outer rings of sites around the central site
   Vector m_centralPos {Vector (0,0,0)};     //!< Central site position
   double m_hexagonalRadius {0.0};  //!< Cell radius
@@ -120,6 +148,7 @@ private:
 
   Ptr<UniformRandomVariable> m_r; //!< random variable used for the random generation of the radius
   Ptr<UniformRandomVariable> m_theta; //!< random variable used for the generation of angle
+  Ptr<NrWrapAroundModel> m_wrapAround; //!< The wrap-around model, created by GetWrapAroundModel
 };
 
 } // namespace ns3
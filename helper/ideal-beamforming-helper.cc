@@ -28,6 +28,24 @@
 #include <ns3/beam-manager.h>
 #include <ns3/vector.h>
 #include <ns3/nr-spectrum-phy.h>
+#include <ns3/nr-counters.h>
+#include <ns3/boolean.h>
+#include <ns3/mobility-model.h>
+#include <ns3/three-gpp-spectrum-propagation-loss-model.h>
+#include <ns3/uinteger.h>
+#include <ns3/double.h>
+#include <ns3/enum.h>
+#include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+
+#if defined (__unix__) || defined (__APPLE__)
+#include <sys/wait.h>
+#include <unistd.h>
+#define NR_IDEAL_BF_HAVE_FORK 1
+#endif
 
 namespace ns3{
 
@@ -44,6 +62,13 @@ IdealBeamformingHelper::~IdealBeamformingHelper ()
 {
   NS_LOG_FUNCTION (this);
   m_beamformingAlgorithm = nullptr;
+  m_cache.clear ();
+  for (const auto &watched : m_mobilityToPairs)
+    {
+      ConstCast<MobilityModel> (watched.first)->TraceDisconnectWithoutContext ("CourseChange",
+                                                                              MakeCallback (&IdealBeamformingHelper::CourseChanged, this));
+    }
+  m_mobilityToPairs.clear ();
 }
 
 void
@@ -72,6 +97,55 @@ IdealBeamformingHelper::GetTypeId (void)
                       MakeTimeAccessor (&IdealBeamformingHelper::SetPeriodicity,
                                         &IdealBeamformingHelper::GetPeriodicity),
                       MakeTimeChecker())
+      .AddAttribute ("BeamformingCache",
+                     "If true, the beamforming vectors of a gNB-UE pair are computed "
+                     "again only if one of the devices moved or if their 3GPP channel "
+                     "matrix was regenerated, otherwise the previous ones are reused.",
+                      BooleanValue (true),
+                      MakeBooleanAccessor (&IdealBeamformingHelper::SetBeamformingCache,
+                                           &IdealBeamformingHelper::GetBeamformingCache),
+                      MakeBooleanChecker ())
+      .AddAttribute ("NumWorkers",
+                     "Number of worker processes that run the beamforming algorithm "
+                     "for the gNB-UE pairs at each periodic update. With 1, the "
+                     "update runs in the simulation process.",
+                      UintegerValue (1),
+                      MakeUintegerAccessor (&IdealBeamformingHelper::SetNumWorkers,
+                                            &IdealBeamformingHelper::GetNumWorkers),
+                      MakeUintegerChecker<uint32_t> (1))
+      .AddAttribute ("UpdateBatchSize",
+                     "Number of gNB-UE pairs updated by each event of the periodic "
+                     "update. The events are evenly spread over BeamformingPeriodicity, "
+                     "so that each pair is still updated once per period. With 0, all "
+                     "the pairs are updated in one event at each period.",
+                      UintegerValue (0),
+                      MakeUintegerAccessor (&IdealBeamformingHelper::SetUpdateBatchSize,
+                                            &IdealBeamformingHelper::GetUpdateBatchSize),
+                      MakeUintegerChecker<uint32_t> ())
+      .AddAttribute ("UpdatePolicy",
+                     "When the beamforming vectors are updated: Periodic runs the algorithm "
+                     "for all the pairs at each BeamformingPeriodicity; MobilityTriggered "
+                     "runs it only for the pairs whose devices moved beyond the thresholds "
+                     "or whose 3GPP channel matrix was regenerated, checked at the course "
+                     "changes of the devices and at each BeamformingPeriodicity.",
+                      EnumValue (IdealBeamformingHelper::PERIODIC),
+                      MakeEnumAccessor (&IdealBeamformingHelper::SetUpdatePolicy,
+                                        &IdealBeamformingHelper::GetUpdatePolicy),
+                      MakeEnumChecker (IdealBeamformingHelper::PERIODIC, "Periodic",
+                                       IdealBeamformingHelper::MOBILITY_TRIGGERED, "MobilityTriggered"))
+      .AddAttribute ("MobilityDistanceThreshold",
+                     "With the MobilityTriggered policy, distance in meters that the gNB "
+                     "or the UE must move since the last search of a pair to search again.",
+                      DoubleValue (1.0),
+                      MakeDoubleAccessor (&IdealBeamformingHelper::m_distanceThreshold),
+                      MakeDoubleChecker<double> (0.0))
+      .AddAttribute ("MobilityAngleThreshold",
+                     "With the MobilityTriggered policy, angle in degrees by which the "
+                     "direction between the gNB and the UE must turn since the last "
+                     "search of a pair to search again.",
+                      DoubleValue (5.0),
+                      MakeDoubleAccessor (&IdealBeamformingHelper::m_angleThreshold),
+                      MakeDoubleChecker<double> (0.0, 180.0))
       ;
     return tid;
 }
@@ -99,9 +173,17 @@ IdealBeamformingHelper::AddBeamformingTask (const Ptr<NrGnbNetDevice>& gnbDev,
            Ptr<NrSpectrumPhy> gnbSpectrumPhy = gnbDev->GetPhy (ccId)->GetSpectrumPhy (arrayIndex);
            Ptr<NrSpectrumPhy> ueSpectrumPhy = ueDev->GetPhy (ccId)->GetSpectrumPhy (arrayIndex);
 
-           m_spectrumPhyPairToDevicePair [std::make_pair (gnbSpectrumPhy, ueSpectrumPhy)] = std::make_pair (gnbDev, ueDev);
+           SpectrumPhyPair pair = std::make_pair (gnbSpectrumPhy, ueSpectrumPhy);
+           m_spectrumPhyPairToDevicePair [pair] = std::make_pair (gnbDev, ueDev);
 
            RunTask (gnbDev, ueDev, gnbSpectrumPhy, ueSpectrumPhy);
+
+           WatchMobility (gnbSpectrumPhy->GetMobility (), pair);
+           WatchMobility (ueSpectrumPhy->GetMobility (), pair);
+           if (m_updatePolicy == MOBILITY_TRIGGERED)
+             {
+               RecordPairState (pair, GetChannelMatrix (gnbSpectrumPhy, ueSpectrumPhy));
+             }
          }
 
      }
@@ -114,10 +196,261 @@ IdealBeamformingHelper::Run () const
   NS_LOG_INFO ("Running the beamforming method. There are :" <<
                m_spectrumPhyPairToDevicePair.size()<<" tasks.");
 
-  for (const auto& task : m_spectrumPhyPairToDevicePair)
+  std::vector<TaskIterator> tasks;
+  tasks.reserve (m_spectrumPhyPairToDevicePair.size ());
+  for (auto it = m_spectrumPhyPairToDevicePair.begin (); it != m_spectrumPhyPairToDevicePair.end (); ++it)
+    {
+      tasks.push_back (it);
+    }
+  RunTasks (tasks);
+}
+
+void
+IdealBeamformingHelper::RunTasks (const std::vector<TaskIterator> &tasks) const
+{
+  NS_LOG_FUNCTION (this << tasks.size ());
+
+  if (m_numWorkers <= 1 || tasks.size () < 2)
+    {
+      for (const auto& task : tasks)
+        {
+          RunTask (task->second.first, task->second.second, task->first.first, task->first.second);
+        }
+      NS_LOG_INFO ("Beamforming cache hits: " << m_cacheHits << " misses: " << m_cacheMisses);
+      return;
+    }
+
+  // Update the channels and look up the cache in the order of the serial
+  // update, so that the random variables are drawn in the same order
+  std::vector<BeamformingVectorPair> bfvs (tasks.size ());
+  std::vector<Ptr<const MatrixBasedChannelModel::ChannelMatrix> > channels (bfvs.size ());
+  std::vector<size_t> pending;
+  std::vector<SpectrumPhyPair> pendingPairs;
+  for (size_t i = 0; i < tasks.size (); ++i)
+    {
+      const SpectrumPhyPair &pair = tasks[i]->first;
+      channels[i] = GetChannelMatrix (pair.first, pair.second);
+      if (!m_cacheEnabled || !FindCachedVectors (pair.first, pair.second, channels[i], &bfvs[i]))
+        {
+          pending.push_back (i);
+          pendingPairs.push_back (pair);
+        }
+    }
+
+  std::vector<BeamformingVectorPair> pendingBfvs;
+  if (pendingPairs.size () < 2 || !GetBeamformingVectorsInWorkers (pendingPairs, &pendingBfvs))
     {
-      RunTask (task.second.first, task.second.second, task.first.first, task.first.second);
+      pendingBfvs.clear ();
+      for (const auto &pair : pendingPairs)
+        {
+          pendingBfvs.push_back (m_beamformingAlgorithm->GetBeamformingVectors (pair.first, pair.second));
+        }
     }
+  for (size_t p = 0; p < pending.size (); ++p)
+    {
+      bfvs[pending[p]] = pendingBfvs[p];
+      NrCounters::Add (pendingPairs[p].first->GetCellId (), pendingPairs[p].first->GetBwpId (),
+                       NrCounters::BEAMFORMING_SEARCHES);
+      if (m_cacheEnabled)
+        {
+          StoreCachedVectors (pendingPairs[p].first, pendingPairs[p].second,
+                              channels[pending[p]], pendingBfvs[p]);
+        }
+    }
+
+  for (size_t i = 0; i < tasks.size (); ++i)
+    {
+      const auto &task = *tasks[i];
+      NS_LOG_INFO (" Run beamforming task for gNB:" << task.second.first->GetNode() -> GetId() <<
+                   " and UE:"<< task.second.second->GetNode()->GetId () );
+      SetBeamformingVectors (task.second.first, task.second.second,
+                             task.first.first, task.first.second, bfvs[i]);
+    }
+
+  NS_LOG_INFO ("Beamforming cache hits: " << m_cacheHits << " misses: " << m_cacheMisses);
+}
+
+void
+IdealBeamformingHelper::RunNextBatch ()
+{
+  NS_LOG_FUNCTION (this);
+
+  // The pairs are kept in a map: the batch starts from the first pair not
+  // before the next one of the previous batch, so that the pairs added in
+  // the meantime are simply visited in order
+  std::vector<TaskIterator> tasks;
+  auto it = m_spectrumPhyPairToDevicePair.lower_bound (m_nextTask);
+  while (tasks.size () < m_updateBatchSize && tasks.size () < m_spectrumPhyPairToDevicePair.size ())
+    {
+      if (it == m_spectrumPhyPairToDevicePair.end ())
+        {
+          it = m_spectrumPhyPairToDevicePair.begin ();
+        }
+      tasks.push_back (it++);
+    }
+  m_nextTask = it != m_spectrumPhyPairToDevicePair.end () ? it->first : SpectrumPhyPair ();
+
+  NS_LOG_INFO ("Running a batch of " << tasks.size () << " of the " <<
+               m_spectrumPhyPairToDevicePair.size () << " beamforming tasks");
+  RunTasks (tasks);
+}
+
+void
+IdealBeamformingHelper::RunTriggeredTasks (const std::set<SpectrumPhyPair> &candidates)
+{
+  NS_LOG_FUNCTION (this << candidates.size ());
+
+  std::vector<TaskIterator> tasks;
+  std::vector<Ptr<const MatrixBasedChannelModel::ChannelMatrix> > channels;
+  for (const auto &pair : candidates)
+    {
+      auto it = m_spectrumPhyPairToDevicePair.find (pair);
+      if (it == m_spectrumPhyPairToDevicePair.end ())
+        {
+          continue;
+        }
+      Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel = GetChannelMatrix (pair.first, pair.second);
+      if (IsUpdateTriggered (pair, channel))
+        {
+          tasks.push_back (it);
+          channels.push_back (channel);
+        }
+    }
+
+  NS_LOG_INFO ("Mobility triggered " << tasks.size () << " of the " <<
+               candidates.size () << " checked beamforming tasks");
+  if (tasks.empty ())
+    {
+      return;
+    }
+  RunTasks (tasks);
+  for (size_t i = 0; i < tasks.size (); ++i)
+    {
+      RecordPairState (tasks[i]->first, channels[i]);
+    }
+}
+
+void
+IdealBeamformingHelper::RunCourseChangedTasks ()
+{
+  NS_LOG_FUNCTION (this);
+  std::set<SpectrumPhyPair> candidates;
+  candidates.swap (m_courseChangedPairs);
+  RunTriggeredTasks (candidates);
+}
+
+void
+IdealBeamformingHelper::CourseChanged (Ptr<const MobilityModel> mobility)
+{
+  NS_LOG_FUNCTION (this << mobility);
+  if (m_updatePolicy != MOBILITY_TRIGGERED)
+    {
+      return;
+    }
+
+  auto it = m_mobilityToPairs.find (mobility);
+  if (it == m_mobilityToPairs.end ())
+    {
+      return;
+    }
+  m_courseChangedPairs.insert (it->second.begin (), it->second.end ());
+
+  // The course changes of the same instant (e.g., several devices updated
+  // by the same mobility event) are checked together
+  if (!m_courseChangeEvent.IsRunning ())
+    {
+      m_courseChangeEvent = Simulator::ScheduleNow (&IdealBeamformingHelper::RunCourseChangedTasks, this);
+    }
+}
+
+void
+IdealBeamformingHelper::WatchMobility (const Ptr<MobilityModel> &mobility, const SpectrumPhyPair &pair)
+{
+  NS_LOG_FUNCTION (this << mobility);
+  if (mobility == nullptr)
+    {
+      return;
+    }
+
+  auto it = m_mobilityToPairs.find (mobility);
+  if (it == m_mobilityToPairs.end ())
+    {
+      mobility->TraceConnectWithoutContext ("CourseChange",
+                                            MakeCallback (&IdealBeamformingHelper::CourseChanged, this));
+      it = m_mobilityToPairs.emplace (mobility, std::vector<SpectrumPhyPair> ()).first;
+    }
+  if (std::find (it->second.begin (), it->second.end (), pair) == it->second.end ())
+    {
+      it->second.push_back (pair);
+    }
+}
+
+bool
+IdealBeamformingHelper::IsUpdateTriggered (const SpectrumPhyPair &pair,
+                                           Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel) const
+{
+  auto it = m_pairStates.find (pair);
+  if (it == m_pairStates.end ())
+    {
+      return true;
+    }
+  const PairState &state = it->second;
+
+  if (state.m_channel != channel
+      || (channel != nullptr && state.m_channelGeneratedTime != channel->m_generatedTime))
+    {
+      NS_LOG_LOGIC ("The channel of the pair was regenerated");
+      return true;
+    }
+
+  Vector gnbPosition = pair.first->GetMobility ()->GetPosition ();
+  Vector uePosition = pair.second->GetMobility ()->GetPosition ();
+  if (CalculateDistance (state.m_gnbPosition, gnbPosition) > m_distanceThreshold
+      || CalculateDistance (state.m_uePosition, uePosition) > m_distanceThreshold)
+    {
+      NS_LOG_LOGIC ("A device of the pair moved beyond the distance threshold");
+      return true;
+    }
+
+  Vector before = state.m_uePosition - state.m_gnbPosition;
+  Vector now = uePosition - gnbPosition;
+  double norms = std::sqrt ((before.x * before.x + before.y * before.y + before.z * before.z)
+                            * (now.x * now.x + now.y * now.y + now.z * now.z));
+  if (norms > 0)
+    {
+      double cosAngle = (before.x * now.x + before.y * now.y + before.z * now.z) / norms;
+      double angle = std::acos (std::max (-1.0, std::min (1.0, cosAngle))) * 180.0 / M_PI;
+      if (angle > m_angleThreshold)
+        {
+          NS_LOG_LOGIC ("The direction of the pair turned beyond the angle threshold");
+          return true;
+        }
+    }
+
+  return false;
+}
+
+void
+IdealBeamformingHelper::RecordPairState (const SpectrumPhyPair &pair,
+                                         Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel)
+{
+  PairState &state = m_pairStates[pair];
+  state.m_gnbPosition = pair.first->GetMobility ()->GetPosition ();
+  state.m_uePosition = pair.second->GetMobility ()->GetPosition ();
+  state.m_channel = channel;
+  state.m_channelGeneratedTime = channel != nullptr ? channel->m_generatedTime : Time ();
+}
+
+/**
+ * \brief Check if two positions are the same
+ * \param a a position
+ * \param b another position
+ * \return true if the coordinates of a and b are equal
+ */
+static bool
+IsSamePosition (const Vector &a, const Vector &b)
+{
+  return a.x == b.x && a.y == b.y && a.z == b.z;
 }
 
 BeamformingVectorPair
@@ -125,7 +458,348 @@ IdealBeamformingHelper::GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpec
                                                const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const
 {
   NS_LOG_FUNCTION (this);
-  return m_beamformingAlgorithm->GetBeamformingVectors (gnbSpectrumPhy, ueSpectrumPhy);
+  if (!m_cacheEnabled)
+    {
+      NrCounters::Add (gnbSpectrumPhy->GetCellId (), gnbSpectrumPhy->GetBwpId (), NrCounters::BEAMFORMING_SEARCHES);
+      return m_beamformingAlgorithm->GetBeamformingVectors (gnbSpectrumPhy, ueSpectrumPhy);
+    }
+
+  Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel = GetChannelMatrix (gnbSpectrumPhy, ueSpectrumPhy);
+  BeamformingVectorPair bfvs;
+  if (!FindCachedVectors (gnbSpectrumPhy, ueSpectrumPhy, channel, &bfvs))
+    {
+      NrCounters::Add (gnbSpectrumPhy->GetCellId (), gnbSpectrumPhy->GetBwpId (), NrCounters::BEAMFORMING_SEARCHES);
+      bfvs = m_beamformingAlgorithm->GetBeamformingVectors (gnbSpectrumPhy, ueSpectrumPhy);
+      StoreCachedVectors (gnbSpectrumPhy, ueSpectrumPhy, channel, bfvs);
+    }
+  return bfvs;
+}
+
+Ptr<const MatrixBasedChannelModel::ChannelMatrix>
+IdealBeamformingHelper::GetChannelMatrix (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                          const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const
+{
+  Ptr<ThreeGppSpectrumPropagationLossModel> threeGppSplm =
+    DynamicCast<ThreeGppSpectrumPropagationLossModel> (gnbSpectrumPhy->GetSpectrumChannel ()->GetPhasedArraySpectrumPropagationLossModel ());
+  if (threeGppSplm == nullptr)
+    {
+      return nullptr;
+    }
+  return threeGppSplm->GetChannelModel ()->GetChannel (gnbSpectrumPhy->GetMobility (),
+                                                      ueSpectrumPhy->GetMobility (),
+                                                      gnbSpectrumPhy->GetAntenna ()->GetObject<PhasedArrayModel> (),
+                                                      ueSpectrumPhy->GetAntenna ()->GetObject<PhasedArrayModel> ());
+}
+
+bool
+IdealBeamformingHelper::FindCachedVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                           const Ptr<NrSpectrumPhy>& ueSpectrumPhy,
+                                           Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel,
+                                           BeamformingVectorPair *bfvs) const
+{
+  // With the 3GPP channel, the vectors also depend on the channel realization
+  auto it = m_cache.find (std::make_pair (gnbSpectrumPhy, ueSpectrumPhy));
+  if (it != m_cache.end ()
+      && IsSamePosition (it->second.m_gnbPosition, gnbSpectrumPhy->GetMobility ()->GetPosition ())
+      && IsSamePosition (it->second.m_uePosition, ueSpectrumPhy->GetMobility ()->GetPosition ())
+      && it->second.m_channel == channel
+      && (channel == nullptr || it->second.m_channelGeneratedTime == channel->m_generatedTime))
+    {
+      ++m_cacheHits;
+      NS_LOG_LOGIC ("Reusing the beamforming vectors of the pair");
+      *bfvs = it->second.m_bfvs;
+      return true;
+    }
+
+  ++m_cacheMisses;
+  return false;
+}
+
+void
+IdealBeamformingHelper::StoreCachedVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                            const Ptr<NrSpectrumPhy>& ueSpectrumPhy,
+                                            Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel,
+                                            const BeamformingVectorPair &bfvs) const
+{
+  CacheEntry &entry = m_cache[std::make_pair (gnbSpectrumPhy, ueSpectrumPhy)];
+  entry.m_gnbPosition = gnbSpectrumPhy->GetMobility ()->GetPosition ();
+  entry.m_uePosition = ueSpectrumPhy->GetMobility ()->GetPosition ();
+  entry.m_channel = channel;
+  entry.m_channelGeneratedTime = channel != nullptr ? channel->m_generatedTime : Time ();
+  entry.m_bfvs = bfvs;
+}
+
+#ifdef NR_IDEAL_BF_HAVE_FORK
+
+/**
+ * \brief Write a buffer to a file descriptor, retrying on partial writes
+ * \param fd the file descriptor
+ * \param buf the buffer
+ * \param size the size of the buffer
+ * \return true if the whole buffer was written
+ */
+static bool
+WriteAll (int fd, const void *buf, size_t size)
+{
+  const char *p = static_cast<const char*> (buf);
+  while (size > 0)
+    {
+      ssize_t n = write (fd, p, size);
+      if (n < 0 && errno == EINTR)
+        {
+          continue;
+        }
+      if (n <= 0)
+        {
+          return false;
+        }
+      p += n;
+      size -= static_cast<size_t> (n);
+    }
+  return true;
+}
+
+/**
+ * \brief Read a buffer from a file descriptor, retrying on partial reads
+ * \param fd the file descriptor
+ * \param buf the buffer
+ * \param size the size of the buffer
+ * \return true if the whole buffer was read
+ */
+static bool
+ReadAll (int fd, void *buf, size_t size)
+{
+  char *p = static_cast<char*> (buf);
+  while (size > 0)
+    {
+      ssize_t n = read (fd, p, size);
+      if (n < 0 && errno == EINTR)
+        {
+          continue;
+        }
+      if (n <= 0)
+        {
+          return false;
+        }
+      p += n;
+      size -= static_cast<size_t> (n);
+    }
+  return true;
+}
+
+/**
+ * \brief Write a beamforming vector to a file descriptor
+ * \param fd the file descriptor
+ * \param bfv the beamforming vector
+ * \return true if the vector was written
+ */
+static bool
+WriteBeamformingVector (int fd, const BeamformingVector &bfv)
+{
+  uint64_t size = bfv.first.size ();
+  uint16_t sector = bfv.second.GetSector ();
+  double elevation = bfv.second.GetElevation ();
+  return WriteAll (fd, &size, sizeof (size))
+         && WriteAll (fd, bfv.first.data (), size * sizeof (bfv.first[0]))
+         && WriteAll (fd, &sector, sizeof (sector))
+         && WriteAll (fd, &elevation, sizeof (elevation));
+}
+
+/**
+ * \brief Read a beamforming vector from a file descriptor
+ * \param fd the file descriptor
+ * \param bfv the beamforming vector
+ * \return true if the vector was read
+ */
+static bool
+ReadBeamformingVector (int fd, BeamformingVector *bfv)
+{
+  uint64_t size = 0;
+  uint16_t sector = 0;
+  double elevation = 0;
+  if (!ReadAll (fd, &size, sizeof (size)))
+    {
+      return false;
+    }
+  bfv->first.resize (size);
+  if (!ReadAll (fd, bfv->first.data (), size * sizeof (bfv->first[0]))
+      || !ReadAll (fd, &sector, sizeof (sector))
+      || !ReadAll (fd, &elevation, sizeof (elevation)))
+    {
+      return false;
+    }
+  bfv->second = BeamId (sector, elevation);
+  return true;
+}
+
+bool
+IdealBeamformingHelper::GetBeamformingVectorsInWorkers (const std::vector<SpectrumPhyPair> &pairs,
+                                                        std::vector<BeamformingVectorPair> *bfvs) const
+{
+  NS_LOG_FUNCTION (this << m_numWorkers << pairs.size ());
+
+  std::cout << std::flush;
+  std::cerr << std::flush;
+  fflush (nullptr);
+
+  const size_t numPairs = pairs.size ();
+  const size_t numWorkers = std::min<size_t> (m_numWorkers, numPairs);
+  std::vector<pid_t> pids;
+  std::vector<int> fds;
+
+  for (size_t w = 0; w < numWorkers; ++w)
+    {
+      size_t begin = numPairs * w / numWorkers;
+      size_t end = numPairs * (w + 1) / numWorkers;
+
+      int pipeFds[2];
+      pid_t pid = -1;
+      if (pipe (pipeFds) == 0)
+        {
+          pid = fork ();
+          if (pid < 0)
+            {
+              close (pipeFds[0]);
+              close (pipeFds[1]);
+            }
+        }
+      if (pid < 0)
+        {
+          // Nothing has been received yet: stop the workers already started
+          for (size_t v = 0; v < pids.size (); ++v)
+            {
+              close (fds[v]);
+              waitpid (pids[v], nullptr, 0);
+            }
+          NS_LOG_WARN ("Could not start the beamforming worker " << w <<
+                       ", running the beamforming algorithm serially");
+          return false;
+        }
+
+      if (pid == 0)
+        {
+          close (pipeFds[0]);
+          for (int fd : fds)
+            {
+              close (fd);
+            }
+          for (size_t i = begin; i < end; ++i)
+            {
+              BeamformingVectorPair bfPair = m_beamformingAlgorithm->GetBeamformingVectors (pairs[i].first,
+                                                                                            pairs[i].second);
+              if (!WriteBeamformingVector (pipeFds[1], bfPair.first)
+                  || !WriteBeamformingVector (pipeFds[1], bfPair.second))
+                {
+                  _exit (1);
+                }
+            }
+          close (pipeFds[1]);
+          _exit (0);
+        }
+
+      close (pipeFds[1]);
+      pids.push_back (pid);
+      fds.push_back (pipeFds[0]);
+    }
+
+  // Each worker writes its chunk in order: read the workers one after the other
+  bfvs->resize (numPairs);
+  for (size_t w = 0; w < numWorkers; ++w)
+    {
+      size_t begin = numPairs * w / numWorkers;
+      size_t end = numPairs * (w + 1) / numWorkers;
+      bool ok = true;
+      for (size_t i = begin; i < end && ok; ++i)
+        {
+          ok = ReadBeamformingVector (fds[w], &(*bfvs)[i].first)
+               && ReadBeamformingVector (fds[w], &(*bfvs)[i].second);
+        }
+      close (fds[w]);
+      int status = 0;
+      waitpid (pids[w], &status, 0);
+      NS_ABORT_MSG_IF (!ok || !WIFEXITED (status) || WEXITSTATUS (status) != 0,
+                       "Beamforming worker " << w << " failed");
+    }
+  return true;
+}
+
+#else // NR_IDEAL_BF_HAVE_FORK
+
+bool
+IdealBeamformingHelper::GetBeamformingVectorsInWorkers (const std::vector<SpectrumPhyPair> &,
+                                                        std::vector<BeamformingVectorPair> *) const
+{
+  NS_LOG_WARN ("Worker processes are not supported on this platform, "
+               "running the beamforming algorithm serially");
+  return false;
+}
+
+#endif // NR_IDEAL_BF_HAVE_FORK
+
+void
+IdealBeamformingHelper::SetBeamformingCache (bool enable)
+{
+  NS_LOG_FUNCTION (this << enable);
+  m_cacheEnabled = enable;
+  m_cache.clear ();
+}
+
+bool
+IdealBeamformingHelper::GetBeamformingCache () const
+{
+  return m_cacheEnabled;
+}
+
+uint64_t
+IdealBeamformingHelper::GetCacheHits () const
+{
+  return m_cacheHits;
+}
+
+uint64_t
+IdealBeamformingHelper::GetCacheMisses () const
+{
+  return m_cacheMisses;
+}
+
+void
+IdealBeamformingHelper::SetNumWorkers (uint32_t numWorkers)
+{
+  NS_LOG_FUNCTION (this << numWorkers);
+  NS_ABORT_MSG_IF (numWorkers == 0, "At least one worker is needed");
+  m_numWorkers = numWorkers;
+}
+
+uint32_t
+IdealBeamformingHelper::GetNumWorkers () const
+{
+  return m_numWorkers;
+}
+
+void
+IdealBeamformingHelper::SetUpdateBatchSize (uint32_t batchSize)
+{
+  NS_LOG_FUNCTION (this << batchSize);
+  m_updateBatchSize = batchSize;
+}
+
+uint32_t
+IdealBeamformingHelper::GetUpdateBatchSize () const
+{
+  return m_updateBatchSize;
+}
+
+void
+IdealBeamformingHelper::SetUpdatePolicy (UpdatePolicy policy)
+{
+  NS_LOG_FUNCTION (this << policy);
+  m_updatePolicy = policy;
+}
+
+IdealBeamformingHelper::UpdatePolicy
+IdealBeamformingHelper::GetUpdatePolicy () const
+{
+  return m_updatePolicy;
 }
 
 void
@@ -134,6 +808,7 @@ IdealBeamformingHelper::SetBeamformingMethod (const TypeId &beamformingMethod)
   NS_LOG_FUNCTION (this);
   NS_ASSERT (beamformingMethod.IsChildOf (IdealBeamformingAlgorithm::GetTypeId ()));
   m_algorithmFactory.SetTypeId (beamformingMethod);
+  m_cache.clear ();
 }
 
 void
@@ -142,10 +817,35 @@ IdealBeamformingHelper::ExpireBeamformingTimer ()
   NS_LOG_FUNCTION (this);
   NS_LOG_INFO ("Beamforming timer expired; programming a beamforming");
 
-  Run (); //Run beamforming tasks
   m_beamformingTimer.Cancel (); // Cancel any previous beamforming event
-  m_beamformingTimer = Simulator::Schedule (m_beamformingPeriodicity,
-                                            &IdealBeamformingHelper::ExpireBeamformingTimer, this);
+
+  if (m_updatePolicy == MOBILITY_TRIGGERED)
+    {
+      std::set<SpectrumPhyPair> candidates;
+      for (const auto &task : m_spectrumPhyPairToDevicePair)
+        {
+          candidates.insert (candidates.end (), task.first);
+        }
+      RunTriggeredTasks (candidates);
+      m_beamformingTimer = Simulator::Schedule (m_beamformingPeriodicity,
+                                                &IdealBeamformingHelper::ExpireBeamformingTimer, this);
+      return;
+    }
+
+  size_t numTasks = m_spectrumPhyPairToDevicePair.size ();
+  if (m_updateBatchSize == 0 || numTasks <= m_updateBatchSize)
+    {
+      Run (); //Run beamforming tasks
+      m_beamformingTimer = Simulator::Schedule (m_beamformingPeriodicity,
+                                                &IdealBeamformingHelper::ExpireBeamformingTimer, this);
+      return;
+    }
+
+  // Staggered update: one batch per step, as many steps per period as batches
+  RunNextBatch ();
+  int64_t numBatches = static_cast<int64_t> ((numTasks + m_updateBatchSize - 1) / m_updateBatchSize);
+  Time step = TimeStep (std::max<int64_t> (m_beamformingPeriodicity.GetTimeStep () / numBatches, 1));
+  m_beamformingTimer = Simulator::Schedule (step, &IdealBeamformingHelper::ExpireBeamformingTimer, this);
 }
 
 void
@@ -21,6 +21,9 @@
 #include <ns3/nstime.h>
 #include "ns3/event-id.h"
 #include <ns3/beamforming-vector.h>
+#include <ns3/matrix-based-channel-model.h>
+#include <ns3/vector.h>
+#include <set>
 
 #ifndef SRC_NR_HELPER_IDEAL_BEAMFORMING_HELPER_H_
 #define SRC_NR_HELPER_IDEAL_BEAMFORMING_HELPER_H_
@@ -30,10 +33,44 @@ namespace ns3 {
 class NrGnbNetDevice;
 class NrUeNetDevice;
 class IdealBeamformingAlgorithm;
+class MobilityModel;
 
 /**
  * \ingroup helper
  * \brief The IdealBeamformingHelper class
+ *
+ * The beamforming vectors of each gNB-UE pair are kept in a cache, and the
+ * beamforming algorithm runs again for the pair only when the gNB or the UE
+ * moved, or when its 3GPP channel matrix was regenerated (attribute
+ * BeamformingCache). GetCacheHits and GetCacheMisses count how many times
+ * the search was skipped or run.
+ *
+ * With NumWorkers greater than one, the periodic update forks that many
+ * worker processes, each running the beamforming algorithm for a part of
+ * the pairs whose vectors are not cached; the parent process then applies
+ * all the vectors in the order of the tasks. The channel matrices of the
+ * pairs are updated by the parent before forking, in the same order as in
+ * the serial update, so that the results do not depend on the number of
+ * workers. Processes are used instead of threads because the simulator
+ * objects (reference counts, lazily filled channel caches) are not
+ * thread-safe.
+ *
+ * With UpdateBatchSize greater than zero, the periodic update is staggered:
+ * instead of updating all the pairs in one event at each period, the helper
+ * updates UpdateBatchSize pairs at a time, round-robin in the order of the
+ * tasks, in events evenly spread over the period. Each pair is still updated
+ * once per period, but the cost of each event is bounded, and the beams of
+ * the network do not all change at the same instant.
+ *
+ * With UpdatePolicy set to MobilityTriggered, the algorithm runs again for a
+ * pair only when one of its devices moved more than MobilityDistanceThreshold
+ * since the last search, when the direction between them turned more than
+ * MobilityAngleThreshold, or when their 3GPP channel matrix was regenerated.
+ * The pairs of a device are checked as soon as its mobility model notifies a
+ * course change, and all the pairs are checked at each BeamformingPeriodicity,
+ * to catch the devices that move without changing course and the regenerated
+ * channels; the check only compares the state of the pair recorded at the
+ * last search. UpdateBatchSize does not apply in this mode.
  */
 class IdealBeamformingHelper : public BeamformingHelperBase
 {
@@ -53,6 +90,15 @@ public:
    */
   static TypeId GetTypeId (void);
 
+  /**
+   * \brief When the beamforming vectors of the pairs are updated
+   */
+  enum UpdatePolicy
+  {
+    PERIODIC,          //!< All the pairs at each BeamformingPeriodicity
+    MOBILITY_TRIGGERED //!< Only the pairs that moved, or whose channel was regenerated
+  };
+
   /**
    * \brief SetBeamformingMethod
    * \param beamformingMethod
@@ -70,6 +116,69 @@ public:
    */
   Time GetPeriodicity () const;
 
+  /**
+   * \brief Enable or disable the cache of the beamforming vectors
+   * \param enable true to reuse the vectors of the pairs whose channel did
+   * not change
+   */
+  void SetBeamformingCache (bool enable);
+
+  /**
+   * \brief Get whether the cache of the beamforming vectors is enabled
+   * \return true if the cache is enabled
+   */
+  bool GetBeamformingCache () const;
+
+  /**
+   * \brief Get the number of beamforming tasks that reused the cached vectors
+   * \return the number of cache hits
+   */
+  uint64_t GetCacheHits () const;
+
+  /**
+   * \brief Get the number of beamforming tasks that ran the beamforming
+   * algorithm, with the cache enabled
+   * \return the number of cache misses
+   */
+  uint64_t GetCacheMisses () const;
+
+  /**
+   * \brief Set the number of worker processes of the periodic update
+   * \param numWorkers the number of worker processes; 1 runs the update in
+   * the simulation process
+   */
+  void SetNumWorkers (uint32_t numWorkers);
+
+  /**
+   * \brief Get the number of worker processes of the periodic update
+   * \return the number of worker processes
+   */
+  uint32_t GetNumWorkers () const;
+
+  /**
+   * \brief Set the number of pairs updated by each event of the staggered update
+   * \param batchSize the number of pairs; 0 updates all the pairs at once
+   */
+  void SetUpdateBatchSize (uint32_t batchSize);
+
+  /**
+   * \brief Get the number of pairs updated by each event of the staggered update
+   * \return the number of pairs; 0 if the update is not staggered
+   */
+  uint32_t GetUpdateBatchSize () const;
+
+  /**
+   * \brief Set the update policy of the beamforming vectors
+   * \param policy the update policy
+   */
+  void SetUpdatePolicy (UpdatePolicy policy);
+
+  /**
+   * \brief Get the update policy of the beamforming vectors
+   * \return the update policy
+   */
+  UpdatePolicy GetUpdatePolicy () const;
+
   /**
    * \brief Run beamforming task
    */
@@ -99,15 +208,155 @@ protected:
   virtual BeamformingVectorPair GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
                                                        const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const override;
 
+  typedef std::pair<Ptr<NrSpectrumPhy>, Ptr<NrSpectrumPhy> > SpectrumPhyPair;
+  typedef std::pair<Ptr<NrGnbNetDevice>, Ptr<NrUeNetDevice> > DevicePair; //!< The list of beamforming tasks to be executed
+  typedef std::map <SpectrumPhyPair, DevicePair>::const_iterator TaskIterator; //!< A beamforming task
+
+  /**
+   * \brief Run some beamforming tasks, in the workers if there are more than one
+   * \param tasks the tasks, in the order in which the vectors are applied
+   */
+  void RunTasks (const std::vector<TaskIterator> &tasks) const;
+
+  /**
+   * \brief Run the next UpdateBatchSize tasks of the staggered update
+   */
+  void RunNextBatch ();
+
+  /**
+   * \brief Run the tasks of the pairs whose state changed beyond the
+   * thresholds since their last search (MobilityTriggered policy)
+   * \param candidates the pairs to check
+   */
+  void RunTriggeredTasks (const std::set<SpectrumPhyPair> &candidates);
+
+  /**
+   * \brief Check the pairs of the devices whose course changed
+   */
+  void RunCourseChangedTasks ();
+
+  /**
+   * \brief Course change notification of the mobility model of a device
+   * \param mobility the mobility model
+   */
+  void CourseChanged (Ptr<const MobilityModel> mobility);
+
+  /**
+   * \brief Connect to the course changes of a mobility model, once
+   * \param mobility the mobility model
+   * \param pair the pair whose device has the mobility model
+   */
+  void WatchMobility (const Ptr<MobilityModel> &mobility, const SpectrumPhyPair &pair);
+
+  /**
+   * \brief Check if the state of a pair changed beyond the thresholds since
+   * its last search
+   * \param pair the pair
+   * \param channel the current channel matrix of the pair, if any
+   * \return true if the beamforming algorithm should run again for the pair
+   */
+  bool IsUpdateTriggered (const SpectrumPhyPair &pair,
+                          Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel) const;
+
+  /**
+   * \brief Record the state of a pair at its search
+   * \param pair the pair
+   * \param channel the channel matrix of the pair, if any
+   */
+  void RecordPairState (const SpectrumPhyPair &pair,
+                        Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel);
+
+  /**
+   * \brief Get the 3GPP channel matrix of a pair, updating it if needed
+   * \param gnbSpectrumPhy the spectrum phy of the gNB
+   * \param ueSpectrumPhy the spectrum phy of the UE
+   * \return the channel matrix, or nullptr if the channel is not a
+   * ThreeGppSpectrumPropagationLossModel
+   */
+  Ptr<const MatrixBasedChannelModel::ChannelMatrix> GetChannelMatrix (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                                                      const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const;
+
+  /**
+   * \brief Look up the cached vectors of a pair, and count the hit or miss
+   * \param gnbSpectrumPhy the spectrum phy of the gNB
+   * \param ueSpectrumPhy the spectrum phy of the UE
+   * \param channel the current channel matrix of the pair, if any
+   * \param bfvs the cached vectors, if they are still valid
+   * \return true if the cached vectors are still valid
+   */
+  bool FindCachedVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                          const Ptr<NrSpectrumPhy>& ueSpectrumPhy,
+                          Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel,
+                          BeamformingVectorPair *bfvs) const;
+
+  /**
+   * \brief Store the vectors of a pair in the cache
+   * \param gnbSpectrumPhy the spectrum phy of the gNB
+   * \param ueSpectrumPhy the spectrum phy of the UE
+   * \param channel the channel matrix used for the vectors, if any
+   * \param bfvs the vectors
+   */
+  void StoreCachedVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                           const Ptr<NrSpectrumPhy>& ueSpectrumPhy,
+                           Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel,
+                           const BeamformingVectorPair &bfvs) const;
+
+  /**
+   * \brief Run the beamforming algorithm for some pairs in worker processes
+   * \param pairs the spectrum phys of the pairs
+   * \param bfvs the vectors of each pair
+   * \return false if the workers could not be started; nothing has been
+   * computed then
+   */
+  bool GetBeamformingVectorsInWorkers (const std::vector<SpectrumPhyPair> &pairs,
+                                       std::vector<BeamformingVectorPair> *bfvs) const;
+
   Time m_beamformingPeriodicity; //!< The beamforming periodicity or how frequently beamforming tasks will be executed
   EventId m_beamformingTimer; //!< Beamforming timer that is used to schedule periodical beamforming vector updates
   Ptr<IdealBeamformingAlgorithm> m_beamformingAlgorithm; //!< The beamforming algorithm that will be used
 
-  typedef std::pair<Ptr<NrSpectrumPhy>, Ptr<NrSpectrumPhy> > SpectrumPhyPair;
-  typedef std::pair<Ptr<NrGnbNetDevice>, Ptr<NrUeNetDevice> > DevicePair; //!< The list of beamforming tasks to be executed
-
   std::map <SpectrumPhyPair, DevicePair> m_spectrumPhyPairToDevicePair;
 
+  /**
+   * \brief Beamforming vectors of a pair, and the state of the pair when
+   * they were computed
+   */
+  struct CacheEntry
+  {
+    Vector m_gnbPosition;                                         //!< Position of the gNB
+    Vector m_uePosition;                                          //!< Position of the UE
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> m_channel;  //!< 3GPP channel matrix, if any
+    Time m_channelGeneratedTime;                                  //!< Generation time of m_channel
+    BeamformingVectorPair m_bfvs;                                 //!< The beamforming vectors
+  };
+
+  bool m_cacheEnabled {true};                          //!< The BeamformingCache attribute
+  mutable std::map <SpectrumPhyPair, CacheEntry> m_cache; //!< Cached vectors, per pair
+  mutable uint64_t m_cacheHits {0};                    //!< Number of cache hits
+  mutable uint64_t m_cacheMisses {0};                  //!< Number of cache misses
+  uint32_t m_numWorkers {1};                           //!< The NumWorkers attribute
+  uint32_t m_updateBatchSize {0};                      //!< The UpdateBatchSize attribute
+  SpectrumPhyPair m_nextTask;                          //!< First task of the next batch of the staggered update
+
+  /**
+   * \brief State of a pair at the last search, for the MobilityTriggered policy
+   */
+  struct PairState
+  {
+    Vector m_gnbPosition;                                         //!< Position of the gNB
+    Vector m_uePosition;                                          //!< Position of the UE
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> m_channel;  //!< 3GPP channel matrix, if any
+    Time m_channelGeneratedTime;                                  //!< Generation time of m_channel
+  };
+
+  UpdatePolicy m_updatePolicy {PERIODIC};              //!< The UpdatePolicy attribute
+  double m_distanceThreshold {1.0};                    //!< The MobilityDistanceThreshold attribute, in m
+  double m_angleThreshold {5.0};                       //!< The MobilityAngleThreshold attribute, in degrees
+  std::map <SpectrumPhyPair, PairState> m_pairStates;  //!< State of each pair at its last search
+  std::map <Ptr<const MobilityModel>, std::vector<SpectrumPhyPair> > m_mobilityToPairs; //!< Pairs of each watched mobility model
+  std::set<SpectrumPhyPair> m_courseChangedPairs;      //!< Pairs to check at the next course change event
+  EventId m_courseChangeEvent;                         //!< Event that checks m_courseChangedPairs
+
 };
 
 }; //ns3 namespace
@@ -18,6 +18,8 @@
  */
 
 #include "node-distribution-scenario-interface.h"
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/node.h>
 
 #include <cmath>  // cos, sin, M_PI (non-standard)
 
@@ -40,6 +42,26 @@ NodeDistributionScenarioInterface::GetUserTerminals () const
   return m_ut;
 }
 
+void
+NodeDistributionScenarioInterface::InstallConstantPositions (const NodeContainer &nodes,
+                                                             const std::vector<Vector> &positions)
+{
+  NS_ASSERT_MSG (nodes.GetN () == positions.size (),
+                 "Got " << positions.size () << " positions for " << nodes.GetN () << " nodes");
+  for (uint32_t i = 0; i < nodes.GetN (); ++i)
+    {
+      // As MobilityHelper::Install, keep the model of a node that has one
+      Ptr<Node> node = nodes.Get (i);
+      Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
+      if (mobility == nullptr)
+        {
+          mobility = CreateObject<ConstantPositionMobilityModel> ();
+          node->AggregateObject (mobility);
+        }
+      mobility->SetPosition (positions[i]);
+    }
+}
+
 void
 NodeDistributionScenarioInterface::SetSitesNumber (std::size_t n)
 {
@@ -23,6 +23,8 @@
 #include <ns3/node-container.h>
 #include <ns3/vector.h>
 
+#include <vector>
+
 namespace ns3 {
 
 /**
@@ -139,6 +141,17 @@ public:
   uint16_t GetCellIndex (std::size_t ueId) const;
 
 protected:
+  /**
+   * \brief Aggregate a ConstantPositionMobilityModel to each node
+   * \param nodes the nodes
+   * \param positions the position of each node
+   *
+   * Same result as MobilityHelper::Install with a ListPositionAllocator, but
+   * without the ObjectFactory and the allocator copy of each position. A
+   * node that already has a mobility model keeps it, at the new position.
+   */
+  static void InstallConstantPositions (const NodeContainer &nodes,
+                                        const std::vector<Vector> &positions);
 
   std::size_t m_numSites; //!< Number of sites with base stations
   std::size_t m_numBs; //!< Number of base stations to create
@@ -28,6 +28,7 @@
 
 #include "nr-bearer-stats-calculator.h"
 #include "ns3/string.h"
+#include "ns3/enum.h"
 #include "ns3/nstime.h"
 #include <ns3/log.h>
 #include <vector>
@@ -98,6 +99,15 @@ NrBearerStatsCalculator::GetTypeId (void)
                    StringValue ("NrUlPdcpStatsE2E.txt"),
                    MakeStringAccessor (&NrBearerStatsCalculator::m_ulPdcpOutputFilename),
                    MakeStringChecker ())
+    .AddAttribute ("Compression",
+                   "Compression of the output files, which get the extension of "
+                   "the format. Zstd falls back to Gzip, and Gzip to None, if the "
+                   "module was built without the library.",
+                   EnumValue (NrTraceFile::NONE),
+                   MakeEnumAccessor (&NrBearerStatsCalculator::m_compression),
+                   MakeEnumChecker (NrTraceFile::NONE, "None",
+                                    NrTraceFile::GZIP, "Gzip",
+                                    NrTraceFile::ZSTD, "Zstd"))
   ;
   return tid;
 }
@@ -110,6 +120,8 @@ NrBearerStatsCalculator::DoDispose ()
     {
       ShowResults ();
     }
+  m_ulOutFile.close ();
+  m_dlOutFile.close ();
 }
 
 void
@@ -138,18 +150,41 @@ NrBearerStatsCalculator::GetEpoch () const
   return m_epochDuration;
 }
 
+NrBearerStatsCalculator::BearerStats &
+NrBearerStatsCalculator::GetBearer (uint64_t imsi, uint8_t lcid)
+{
+  ImsiLcidPair_t p (imsi, lcid);
+  auto it = m_bearerIndex.find (p);
+  if (it != m_bearerIndex.end ())
+    {
+      return m_bearers[it->second];
+    }
+  NS_LOG_DEBUG (this << " Creating stats for IMSI " << imsi << " and LCID " << (uint32_t) lcid);
+  m_bearerIndex.emplace (p, m_bearers.size ());
+  m_bearers.emplace_back ();
+  m_bearers.back ().m_imsiLcid = p;
+  return m_bearers.back ();
+}
+
+const NrBearerStatsCalculator::BearerStats *
+NrBearerStatsCalculator::FindBearer (uint64_t imsi, uint8_t lcid) const
+{
+  auto it = m_bearerIndex.find (ImsiLcidPair_t (imsi, lcid));
+  return it == m_bearerIndex.end () ? nullptr : &m_bearers[it->second];
+}
+
 void
 NrBearerStatsCalculator::UlTxPdu (uint16_t cellId, uint64_t imsi, uint16_t rnti, uint8_t lcid, uint32_t packetSize)
 {
   NS_LOG_FUNCTION (this);
 
-  ImsiLcidPair_t p (imsi, lcid);
   if (Simulator::Now () >= m_startTime)
     {
-      m_ulCellId[p] = cellId;
-      m_flowId[p] = LteFlowId_t (rnti, lcid);
-      m_ulTxPackets[p]++;
-      m_ulTxData[p] += packetSize;
+      BearerStats &bearer = GetBearer (imsi, lcid);
+      bearer.m_ul.m_cellId = cellId;
+      bearer.m_flowId = LteFlowId_t (rnti, lcid);
+      bearer.m_ul.m_txPackets++;
+      bearer.m_ul.m_txData += packetSize;
     }
   m_pendingOutput = true;
 }
@@ -159,13 +194,13 @@ NrBearerStatsCalculator::DlTxPdu (uint16_t cellId, uint64_t imsi, uint16_t rnti,
 {
   NS_LOG_FUNCTION (this);
 
-  ImsiLcidPair_t p (imsi, lcid);
   if (Simulator::Now () >= m_startTime)
     {
-      m_dlCellId[p] = cellId;
-      m_flowId[p] = LteFlowId_t (rnti, lcid);
-      m_dlTxPackets[p]++;
-      m_dlTxData[p] += packetSize;
+      BearerStats &bearer = GetBearer (imsi, lcid);
+      bearer.m_dl.m_cellId = cellId;
+      bearer.m_flowId = LteFlowId_t (rnti, lcid);
+      bearer.m_dl.m_txPackets++;
+      bearer.m_dl.m_txData += packetSize;
     }
   m_pendingOutput = true;
 }
@@ -176,22 +211,14 @@ NrBearerStatsCalculator::UlRxPdu (uint16_t cellId, uint64_t imsi, uint16_t rnti,
 {
   NS_LOG_FUNCTION (this);
 
-  ImsiLcidPair_t p (imsi, lcid);
   if (Simulator::Now () >= m_startTime)
     {
-      m_ulCellId[p] = cellId;
-      m_ulRxPackets[p]++;
-      m_ulRxData[p] += packetSize;
-
-      Uint64StatsMap::iterator it = m_ulDelay.find (p);
-      if (it == m_ulDelay.end ())
-        {
-          NS_LOG_DEBUG (this << " Creating UL stats calculators for IMSI " << p.m_imsi << " and LCID " << (uint32_t) p.m_lcId);
-          m_ulDelay[p] = CreateObject<MinMaxAvgTotalCalculator<uint64_t> > ();
-          m_ulPduSize[p] = CreateObject<MinMaxAvgTotalCalculator<uint32_t> > ();
-        }
-      m_ulDelay[p]->Update (delay);
-      m_ulPduSize[p]->Update (packetSize);
+      BearerStats &bearer = GetBearer (imsi, lcid);
+      bearer.m_ul.m_cellId = cellId;
+      bearer.m_ul.m_rxPackets++;
+      bearer.m_ul.m_rxData += packetSize;
+      bearer.m_ul.m_delay.Update (delay);
+      bearer.m_ul.m_pduSize.Update (packetSize);
     }
   m_pendingOutput = true;
 }
@@ -201,22 +228,14 @@ NrBearerStatsCalculator::DlRxPdu (uint16_t cellId, uint64_t imsi, uint16_t rnti,
 {
   NS_LOG_FUNCTION (this);
 
-  ImsiLcidPair_t p (imsi, lcid);
   if (Simulator::Now () >= m_startTime)
     {
-      m_dlCellId[p] = cellId;
-      m_dlRxPackets[p]++;
-      m_dlRxData[p] += packetSize;
-
-      Uint64StatsMap::iterator it = m_dlDelay.find (p);
-      if (it == m_dlDelay.end ())
-        {
-          NS_LOG_DEBUG (this << " Creating DL stats calculators for IMSI " << p.m_imsi << " and LCID " << (uint32_t) p.m_lcId);
-          m_dlDelay[p] = CreateObject<MinMaxAvgTotalCalculator<uint64_t> > ();
-          m_dlPduSize[p] = CreateObject<MinMaxAvgTotalCalculator<uint32_t> > ();
-        }
-      m_dlDelay[p]->Update (delay);
-      m_dlPduSize[p]->Update (packetSize);
+      BearerStats &bearer = GetBearer (imsi, lcid);
+      bearer.m_dl.m_cellId = cellId;
+      bearer.m_dl.m_rxPackets++;
+      bearer.m_dl.m_rxData += packetSize;
+      bearer.m_dl.m_delay.Update (delay);
+      bearer.m_dl.m_pduSize.Update (packetSize);
     }
   m_pendingOutput = true;
 }
@@ -227,146 +246,92 @@ NrBearerStatsCalculator::ShowResults (void)
   NS_LOG_FUNCTION (this << GetUlOutputFilename ().c_str () << GetDlOutputFilename ().c_str ());
   NS_LOG_INFO ("Write bearer stats to " << GetUlOutputFilename ().c_str () << " and in " << GetDlOutputFilename ().c_str ());
 
-  std::ofstream ulOutFile;
-  std::ofstream dlOutFile;
-
   if (m_firstWrite == true)
     {
-      ulOutFile.open (GetUlOutputFilename ().c_str ());
-      if (!ulOutFile.is_open ())
+      m_ulOutFile.open (GetUlOutputFilename (), m_compression);
+      if (!m_ulOutFile.is_open ())
         {
           NS_LOG_ERROR ("Can't open file " << GetUlOutputFilename ().c_str ());
           return;
         }
 
-      dlOutFile.open (GetDlOutputFilename ().c_str ());
-      if (!dlOutFile.is_open ())
+      m_dlOutFile.open (GetDlOutputFilename (), m_compression);
+      if (!m_dlOutFile.is_open ())
         {
           NS_LOG_ERROR ("Can't open file " << GetDlOutputFilename ().c_str ());
+          m_ulOutFile.close ();
           return;
         }
       m_firstWrite = false;
-      ulOutFile << "% start(s)\tend(s)\tCellId\tIMSI\tRNTI\tLCID\tnTxPDUs\tTxBytes\tnRxPDUs\tRxBytes\t";
-      ulOutFile << "delay(s)\tstdDev(s)\tmin(s)\tmax(s)\t";
-      ulOutFile << "PduSize\tstdDev\tmin\tmax";
-      ulOutFile << std::endl;
-      dlOutFile << "% start(s)\tend(s)\tCellId\tIMSI\tRNTI\tLCID\tnTxPDUs\tTxBytes\tnRxPDUs\tRxBytes\t";
-      dlOutFile << "delay(s)\tstdDev(s)\tmin(s)\tmax(s)\t";
-      dlOutFile << "PduSize\tstdDev\tmin\tmax";
-      dlOutFile << std::endl;
-    }
-  else
-    {
-      ulOutFile.open (GetUlOutputFilename ().c_str (), std::ios_base::app);
-      if (!ulOutFile.is_open ())
-        {
-          NS_LOG_ERROR ("Can't open file " << GetUlOutputFilename ().c_str ());
-          return;
-        }
-
-      dlOutFile.open (GetDlOutputFilename ().c_str (), std::ios_base::app);
-      if (!dlOutFile.is_open ())
-        {
-          NS_LOG_ERROR ("Can't open file " << GetDlOutputFilename ().c_str ());
-          return;
-        }
+      m_ulOutFile << "% start(s)\tend(s)\tCellId\tIMSI\tRNTI\tLCID\tnTxPDUs\tTxBytes\tnRxPDUs\tRxBytes\t";
+      m_ulOutFile << "delay(s)\tstdDev(s)\tmin(s)\tmax(s)\t";
+      m_ulOutFile << "PduSize\tstdDev\tmin\tmax";
+      m_ulOutFile << std::endl;
+      m_dlOutFile << "% start(s)\tend(s)\tCellId\tIMSI\tRNTI\tLCID\tnTxPDUs\tTxBytes\tnRxPDUs\tRxBytes\t";
+      m_dlOutFile << "delay(s)\tstdDev(s)\tmin(s)\tmax(s)\t";
+      m_dlOutFile << "PduSize\tstdDev\tmin\tmax";
+      m_dlOutFile << std::endl;
     }
 
-  WriteUlResults (ulOutFile);
-  WriteDlResults (dlOutFile);
+  WriteUlResults (m_ulOutFile);
+  WriteDlResults (m_dlOutFile);
   m_pendingOutput = false;
 
 }
 
 void
-NrBearerStatsCalculator::WriteUlResults (std::ofstream& outFile)
+NrBearerStatsCalculator::WriteUlResults (std::ostream& outFile)
 {
   NS_LOG_FUNCTION (this);
-
-  // Get the unique IMSI / LCID list
-
-  std::vector < ImsiLcidPair_t > pairVector;
-  for (Uint32Map::iterator it = m_ulTxPackets.begin (); it != m_ulTxPackets.end (); ++it)
-    {
-      if (find (pairVector.begin (), pairVector.end (), (*it).first) == pairVector.end ())
-        {
-          pairVector.push_back ((*it).first);
-        }
-    }
-
-  Time endTime = m_startTime + m_epochDuration;
-  for (std::vector<ImsiLcidPair_t>::iterator it = pairVector.begin (); it != pairVector.end (); ++it)
-    {
-      ImsiLcidPair_t p = *it;
-      outFile << m_startTime.GetSeconds () << "\t";
-      outFile << endTime.GetSeconds () << "\t";
-      outFile << GetUlCellId (p.m_imsi, p.m_lcId) << "\t";
-      outFile << p.m_imsi << "\t";
-      outFile << m_flowId[p].m_rnti << "\t";
-      outFile << (uint32_t) m_flowId[p].m_lcId << "\t";
-      outFile << GetUlTxPackets (p.m_imsi, p.m_lcId) << "\t";
-      outFile << GetUlTxData (p.m_imsi, p.m_lcId) << "\t";
-      outFile << GetUlRxPackets (p.m_imsi, p.m_lcId) << "\t";
-      outFile << GetUlRxData (p.m_imsi, p.m_lcId) << "\t";
-      std::vector<double> stats = GetUlDelayStats (p.m_imsi, p.m_lcId);
-      for (std::vector<double>::iterator it = stats.begin (); it != stats.end (); ++it)
-        {
-          outFile << (*it) * 1e-9 << "\t";
-        }
-      stats = GetUlPduSizeStats (p.m_imsi, p.m_lcId);
-      for (std::vector<double>::iterator it = stats.begin (); it != stats.end (); ++it)
-        {
-          outFile << (*it) << "\t";
-        }
-      outFile << std::endl;
-    }
-
-  outFile.close ();
+  WriteResults (outFile, &BearerStats::m_ul);
 }
 
 void
-NrBearerStatsCalculator::WriteDlResults (std::ofstream& outFile)
+NrBearerStatsCalculator::WriteDlResults (std::ostream& outFile)
 {
   NS_LOG_FUNCTION (this);
+  WriteResults (outFile, &BearerStats::m_dl);
+}
 
-  // Get the unique IMSI list
-  std::vector < ImsiLcidPair_t > pairVector;
-  for (Uint32Map::iterator it = m_dlTxPackets.begin (); it != m_dlTxPackets.end (); ++it)
+void
+NrBearerStatsCalculator::WriteResults (std::ostream& outFile, DirectionStats BearerStats::*dir)
+{
+  // The bearers that transmitted in the epoch, by IMSI and LCID
+  std::vector<const BearerStats *> bearers;
+  for (const auto &bearer : m_bearers)
     {
-      if (find (pairVector.begin (), pairVector.end (), (*it).first) == pairVector.end ())
+      if ((bearer.*dir).m_txPackets > 0)
         {
-          pairVector.push_back ((*it).first);
+          bearers.push_back (&bearer);
         }
     }
+  std::sort (bearers.begin (), bearers.end (),
+             [] (const BearerStats *a, const BearerStats *b) { return a->m_imsiLcid < b->m_imsiLcid; });
 
   Time endTime = m_startTime + m_epochDuration;
-  for (std::vector<ImsiLcidPair_t>::iterator pair = pairVector.begin (); pair != pairVector.end (); ++pair)
+  for (const BearerStats *bearer : bearers)
     {
-      ImsiLcidPair_t p = *pair;
+      const DirectionStats &stats = bearer->*dir;
       outFile << m_startTime.GetSeconds () << "\t";
       outFile << endTime.GetSeconds () << "\t";
-      outFile << GetDlCellId (p.m_imsi, p.m_lcId) << "\t";
-      outFile << p.m_imsi << "\t";
-      outFile << m_flowId[p].m_rnti << "\t";
-      outFile << (uint32_t) m_flowId[p].m_lcId << "\t";
-      outFile << GetDlTxPackets (p.m_imsi, p.m_lcId) << "\t";
-      outFile << GetDlTxData (p.m_imsi, p.m_lcId) << "\t";
-      outFile << GetDlRxPackets (p.m_imsi, p.m_lcId) << "\t";
-      outFile << GetDlRxData (p.m_imsi, p.m_lcId) << "\t";
-      std::vector<double> stats = GetDlDelayStats (p.m_imsi, p.m_lcId);
-      for (std::vector<double>::iterator it = stats.begin (); it != stats.end (); ++it)
+      outFile << stats.m_cellId << "\t";
+      outFile << bearer->m_imsiLcid.m_imsi << "\t";
+      outFile << bearer->m_flowId.m_rnti << "\t";
+      outFile << (uint32_t) bearer->m_flowId.m_lcId << "\t";
+      outFile << stats.m_txPackets << "\t";
+      outFile << stats.m_txData << "\t";
+      outFile << stats.m_rxPackets << "\t";
+      outFile << stats.m_rxData << "\t";
+      for (double value : stats.m_delay.GetStats ())
         {
-          outFile << (*it) * 1e-9 << "\t";
+          outFile << value * 1e-9 << "\t";
         }
-      stats = GetDlPduSizeStats (p.m_imsi, p.m_lcId);
-      for (std::vector<double>::iterator it = stats.begin (); it != stats.end (); ++it)
+      for (double value : stats.m_pduSize.GetStats ())
         {
-          outFile << (*it) << "\t";
+          outFile << value << "\t";
         }
       outFile << std::endl;
     }
-
-  outFile.close ();
 }
 
 void
@@ -374,19 +339,11 @@ NrBearerStatsCalculator::ResetResults (void)
 {
   NS_LOG_FUNCTION (this);
 
-  m_ulTxPackets.erase (m_ulTxPackets.begin (), m_ulTxPackets.end ());
-  m_ulRxPackets.erase (m_ulRxPackets.begin (), m_ulRxPackets.end ());
-  m_ulRxData.erase (m_ulRxData.begin (), m_ulRxData.end ());
-  m_ulTxData.erase (m_ulTxData.begin (), m_ulTxData.end ());
-  m_ulDelay.erase (m_ulDelay.begin (), m_ulDelay.end ());
-  m_ulPduSize.erase (m_ulPduSize.begin (), m_ulPduSize.end ());
-
-  m_dlTxPackets.erase (m_dlTxPackets.begin (), m_dlTxPackets.end ());
-  m_dlRxPackets.erase (m_dlRxPackets.begin (), m_dlRxPackets.end ());
-  m_dlRxData.erase (m_dlRxData.begin (), m_dlRxData.end ());
-  m_dlTxData.erase (m_dlTxData.begin (), m_dlTxData.end ());
-  m_dlDelay.erase (m_dlDelay.begin (), m_dlDelay.end ());
-  m_dlPduSize.erase (m_dlPduSize.begin (), m_dlPduSize.end ());
+  for (auto &bearer : m_bearers)
+    {
+      bearer.m_ul.ResetEpoch ();
+      bearer.m_dl.ResetEpoch ();
+    }
 }
 
 void
@@ -412,201 +369,138 @@ uint32_t
 NrBearerStatsCalculator::GetUlTxPackets (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  return m_ulTxPackets[p];
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? 0 : bearer->m_ul.m_txPackets;
 }
 
 uint32_t
 NrBearerStatsCalculator::GetUlRxPackets (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  return m_ulRxPackets[p];
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? 0 : bearer->m_ul.m_rxPackets;
 }
 
 uint64_t
 NrBearerStatsCalculator::GetUlTxData (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  return m_ulTxData[p];
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? 0 : bearer->m_ul.m_txData;
 }
 
 uint64_t
 NrBearerStatsCalculator::GetUlRxData (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  return m_ulRxData[p];
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? 0 : bearer->m_ul.m_rxData;
+}
+
+uint32_t
+NrBearerStatsCalculator::GetUlCellId (uint64_t imsi, uint8_t lcid)
+{
+  NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? 0 : bearer->m_ul.m_cellId;
 }
 
 double
 NrBearerStatsCalculator::GetUlDelay (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  Uint64StatsMap::iterator it = m_ulDelay.find (p);
-  if (it == m_ulDelay.end ())
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  if (bearer == nullptr || bearer->m_ul.m_delay.GetCount () == 0)
     {
       NS_LOG_ERROR ("UL delay for " << imsi << " - " << (uint16_t) lcid << " not found");
       return 0;
-
     }
-  return m_ulDelay[p]->getMean ();
+  return bearer->m_ul.m_delay.GetMean ();
 }
 
 std::vector<double>
 NrBearerStatsCalculator::GetUlDelayStats (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  std::vector<double> stats;
-  Uint64StatsMap::iterator it = m_ulDelay.find (p);
-  if (it == m_ulDelay.end ())
-    {
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      return stats;
-
-    }
-  stats.push_back (m_ulDelay[p]->getMean ());
-  stats.push_back (m_ulDelay[p]->getStddev ());
-  stats.push_back (m_ulDelay[p]->getMin ());
-  stats.push_back (m_ulDelay[p]->getMax ());
-  return stats;
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? Accumulator ().GetStats () : bearer->m_ul.m_delay.GetStats ();
 }
 
 std::vector<double>
 NrBearerStatsCalculator::GetUlPduSizeStats (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  std::vector<double> stats;
-  Uint32StatsMap::iterator it = m_ulPduSize.find (p);
-  if (it == m_ulPduSize.end ())
-    {
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      return stats;
-
-    }
-  stats.push_back (m_ulPduSize[p]->getMean ());
-  stats.push_back (m_ulPduSize[p]->getStddev ());
-  stats.push_back (m_ulPduSize[p]->getMin ());
-  stats.push_back (m_ulPduSize[p]->getMax ());
-  return stats;
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? Accumulator ().GetStats () : bearer->m_ul.m_pduSize.GetStats ();
 }
 
 uint32_t
 NrBearerStatsCalculator::GetDlTxPackets (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  return m_dlTxPackets[p];
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? 0 : bearer->m_dl.m_txPackets;
 }
 
 uint32_t
 NrBearerStatsCalculator::GetDlRxPackets (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  return m_dlRxPackets[p];
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? 0 : bearer->m_dl.m_rxPackets;
 }
 
 uint64_t
 NrBearerStatsCalculator::GetDlTxData (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  return m_dlTxData[p];
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? 0 : bearer->m_dl.m_txData;
 }
 
 uint64_t
 NrBearerStatsCalculator::GetDlRxData (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  return m_dlRxData[p];
-}
-
-uint32_t
-NrBearerStatsCalculator::GetUlCellId (uint64_t imsi, uint8_t lcid)
-{
-  NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  return m_ulCellId[p];
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? 0 : bearer->m_dl.m_rxData;
 }
 
 uint32_t
 NrBearerStatsCalculator::GetDlCellId (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  return m_dlCellId[p];
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? 0 : bearer->m_dl.m_cellId;
 }
 
 double
 NrBearerStatsCalculator::GetDlDelay (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  Uint64StatsMap::iterator it = m_dlDelay.find (p);
-  if (it == m_dlDelay.end ())
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  if (bearer == nullptr || bearer->m_dl.m_delay.GetCount () == 0)
     {
-      NS_LOG_ERROR ("DL delay for " << imsi << " not found");
+      NS_LOG_ERROR ("DL delay for " << imsi << " - " << (uint16_t) lcid << " not found");
       return 0;
     }
-  return m_dlDelay[p]->getMean ();
+  return bearer->m_dl.m_delay.GetMean ();
 }
 
 std::vector<double>
 NrBearerStatsCalculator::GetDlDelayStats (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  std::vector<double> stats;
-  Uint64StatsMap::iterator it = m_dlDelay.find (p);
-  if (it == m_dlDelay.end ())
-    {
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      return stats;
-
-    }
-  stats.push_back (m_dlDelay[p]->getMean ());
-  stats.push_back (m_dlDelay[p]->getStddev ());
-  stats.push_back (m_dlDelay[p]->getMin ());
-  stats.push_back (m_dlDelay[p]->getMax ());
-  return stats;
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? Accumulator ().GetStats () : bearer->m_dl.m_delay.GetStats ();
 }
 
 std::vector<double>
 NrBearerStatsCalculator::GetDlPduSizeStats (uint64_t imsi, uint8_t lcid)
 {
   NS_LOG_FUNCTION (this << imsi << (uint16_t) lcid);
-  ImsiLcidPair_t p (imsi, lcid);
-  std::vector<double> stats;
-  Uint32StatsMap::iterator it = m_dlPduSize.find (p);
-  if (it == m_dlPduSize.end ())
-    {
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      stats.push_back (0.0);
-      return stats;
-
-    }
-  stats.push_back (m_dlPduSize[p]->getMean ());
-  stats.push_back (m_dlPduSize[p]->getStddev ());
-  stats.push_back (m_dlPduSize[p]->getMin ());
-  stats.push_back (m_dlPduSize[p]->getMax ());
-  return stats;
+  const BearerStats *bearer = FindBearer (imsi, lcid);
+  return bearer == nullptr ? Accumulator ().GetStats () : bearer->m_dl.m_pduSize.GetStats ();
 }
 
 
@@ -35,24 +35,15 @@
 #include "ns3/basic-data-calculators.h"
 #include "ns3/lte-common.h"
 #include <string>
-#include <map>
+#include <unordered_map>
+#include <vector>
 #include <fstream>
+#include <cmath>
+#include <algorithm>
 #include "nr-bearer-stats-simple.h"
+#include "nr-trace-file.h"
 
 namespace ns3 {
-/// Container: (IMSI, LCID) pair, uint32_t
-typedef std::map<ImsiLcidPair_t, uint32_t> Uint32Map;
-/// Container: (IMSI, LCID) pair, uint64_t
-typedef std::map<ImsiLcidPair_t, uint64_t> Uint64Map;
-/// Container: (IMSI, LCID) pair, uint32_t calculator
-typedef std::map<ImsiLcidPair_t, Ptr<MinMaxAvgTotalCalculator<uint32_t> > > Uint32StatsMap;
-/// Container: (IMSI, LCID) pair, uint64_t calculator
-typedef std::map<ImsiLcidPair_t, Ptr<MinMaxAvgTotalCalculator<uint64_t> > > Uint64StatsMap;
-/// Container: (IMSI, LCID) pair, double
-typedef std::map<ImsiLcidPair_t, double> DoubleMap;
-/// Container: (IMSI, LCID) pair, LteFlowId_t
-typedef std::map<ImsiLcidPair_t, LteFlowId_t> FlowIdMap;
-
 /**
  * \ingroup utils
  *
@@ -280,23 +271,21 @@ private:
    * Called after each epoch to write collected
    * statistics to output files. During first call
    * it opens output files and write columns descriptions.
-   * During next calls it opens output files in append mode.
+   * The files stay open until the calculator is disposed.
    */
   void ShowResults (void);
   /**
-   * Writes collected statistics to UL output file and
-   * closes UL output file.
-   * @param outFile ofstream for UL statistics
+   * Writes collected statistics to UL output file.
+   * @param outFile stream for UL statistics
    */
-  void WriteUlResults (std::ofstream& outFile);
+  void WriteUlResults (std::ostream& outFile);
   /**
-   * Writes collected statistics to DL output file and
-   * closes DL output file.
-   * @param outFile ofstream for DL statistics
+   * Writes collected statistics to DL output file.
+   * @param outFile stream for DL statistics
    */
-  void WriteDlResults (std::ofstream& outFile);
+  void WriteDlResults (std::ostream& outFile);
   /**
-   * Erases collected statistics
+   * Resets the collected statistics of the epoch, keeping the bearers
    */
   void ResetResults (void);
   /**
@@ -311,22 +300,148 @@ private:
    */
   void EndEpoch (void);
 
+  /**
+   * \brief Min, max, average and standard deviation of the values of an epoch
+   *
+   * Same results as MinMaxAvgTotalCalculator, without being an Object.
+   */
+  class Accumulator
+  {
+  public:
+    /**
+     * \brief Add a value
+     * \param value the value
+     */
+    void Update (double value)
+    {
+      ++m_count;
+      m_total += value;
+      if (m_count == 1)
+        {
+          m_min = value;
+          m_max = value;
+          m_mean = value;
+          m_s = 0.0;
+        }
+      else
+        {
+          m_min = std::min (m_min, value);
+          m_max = std::max (m_max, value);
+          // Knuth, The Art of Computer Programming, Vol. 2, eq. (15) and (16)
+          double prevMean = m_mean;
+          m_mean = prevMean + (value - prevMean) / m_count;
+          m_s += (value - prevMean) * (value - m_mean);
+        }
+    }
+    /**
+     * \brief Forget all the values
+     */
+    void Reset ()
+    {
+      *this = Accumulator ();
+    }
+    /**
+     * \return the number of values
+     */
+    uint32_t GetCount () const
+    {
+      return m_count;
+    }
+    /**
+     * \return the average of the values
+     */
+    double GetMean () const
+    {
+      return m_count > 0 ? m_total / m_count : 0.0;
+    }
+    /**
+     * \return the average, the standard deviation, the min and the max of the values
+     */
+    std::vector<double> GetStats () const
+    {
+      double variance = m_count > 1 ? m_s / (m_count - 1) : 0.0;
+      return {GetMean (), std::sqrt (variance), m_min, m_max};
+    }
+  private:
+    uint32_t m_count {0}; //!< Number of values
+    double m_total {0.0}; //!< Sum of the values
+    double m_min {0.0};   //!< Min of the values
+    double m_max {0.0};   //!< Max of the values
+    double m_mean {0.0};  //!< Running mean, for the variance
+    double m_s {0.0};     //!< Running sum of the squared differences from the mean
+  };
+  /**
+   * \brief The counters of a bearer in one direction
+   */
+  struct DirectionStats
+  {
+    uint32_t m_cellId {0};     //!< Last cell ID, kept across the epochs
+    uint32_t m_txPackets {0};  //!< Number of TX packets in the epoch
+    uint32_t m_rxPackets {0};  //!< Number of RX packets in the epoch
+    uint64_t m_txData {0};     //!< Amount of TX data in the epoch
+    uint64_t m_rxData {0};     //!< Amount of RX data in the epoch
+    Accumulator m_delay;       //!< Delay in the epoch
+    Accumulator m_pduSize;     //!< PDU size in the epoch
+    /**
+     * \brief Reset the counters of the epoch
+     */
+    void ResetEpoch ()
+    {
+      m_txPackets = 0;
+      m_rxPackets = 0;
+      m_txData = 0;
+      m_rxData = 0;
+      m_delay.Reset ();
+      m_pduSize.Reset ();
+    }
+  };
+  /**
+   * \brief The counters of an (IMSI, LCID) pair
+   */
+  struct BearerStats
+  {
+    ImsiLcidPair_t m_imsiLcid; //!< The (IMSI, LCID) pair
+    LteFlowId_t m_flowId;      //!< (RNTI, LCID) of the last transmission
+    DirectionStats m_dl;       //!< DL counters
+    DirectionStats m_ul;       //!< UL counters
+  };
+  /**
+   * \brief Hash of an (IMSI, LCID) pair
+   */
+  struct ImsiLcidHash
+  {
+    /**
+     * \param p the (IMSI, LCID) pair
+     * \return the hash
+     */
+    size_t operator() (const ImsiLcidPair_t &p) const
+    {
+      return std::hash<uint64_t> () ((p.m_imsi << 8) ^ p.m_lcId);
+    }
+  };
+  /**
+   * Gets the counters of a bearer, and adds them if the bearer is new
+   * @param imsi IMSI of the UE
+   * @param lcid LCID
+   * @return the counters of the bearer
+   */
+  BearerStats & GetBearer (uint64_t imsi, uint8_t lcid);
+  /**
+   * Finds the counters of a bearer
+   * @param imsi IMSI of the UE
+   * @param lcid LCID
+   * @return the counters of the bearer, or nullptr if the bearer is not known
+   */
+  const BearerStats * FindBearer (uint64_t imsi, uint8_t lcid) const;
+  /**
+   * Writes the statistics of the bearers that transmitted in the epoch
+   * @param outFile stream for the statistics
+   * @param dir the direction to write (BearerStats::m_dl or BearerStats::m_ul)
+   */
+  void WriteResults (std::ostream& outFile, DirectionStats BearerStats::*dir);
   EventId m_endEpochEvent; //!< Event id for next end epoch event
-  FlowIdMap m_flowId; //!< List of FlowIds, ie. (RNTI, LCID) by (IMSI, LCID) pair
-  Uint32Map m_dlCellId; //!< List of DL CellIds by (IMSI, LCID) pair
-  Uint32Map m_dlTxPackets; //!< Number of DL TX Packets by (IMSI, LCID) pair
-  Uint32Map m_dlRxPackets; //!< Number of DL RX Packets by (IMSI, LCID) pair
-  Uint64Map m_dlTxData; //!< Amount of DL TX Data by (IMSI, LCID) pair
-  Uint64Map m_dlRxData; //!< Amount of DL RX Data by (IMSI, LCID) pair
-  Uint64StatsMap m_dlDelay; //!< DL delay by (IMSI, LCID) pair
-  Uint32StatsMap m_dlPduSize; //!< DL PDU Size by (IMSI, LCID) pair
-  Uint32Map m_ulCellId; //!< List of UL CellIds by (IMSI, LCID) pair
-  Uint32Map m_ulTxPackets; //!< Number of UL TX Packets by (IMSI, LCID) pair
-  Uint32Map m_ulRxPackets; //!< Number of UL RX Packets by (IMSI, LCID) pair
-  Uint64Map m_ulTxData; //!< Amount of UL TX Data by (IMSI, LCID) pair
-  Uint64Map m_ulRxData; //!< Amount of UL RX Data by (IMSI, LCID) pair
-  Uint64StatsMap m_ulDelay; //!< UL delay by (IMSI, LCID) pair
-  Uint32StatsMap m_ulPduSize; //!< UL PDU Size by (IMSI, LCID) pair
+  std::vector<BearerStats> m_bearers; //!< Counters of all the bearers seen, in order of appearance
+  std::unordered_map<ImsiLcidPair_t, size_t, ImsiLcidHash> m_bearerIndex; //!< Index in m_bearers of each (IMSI, LCID) pair
   /**
    * Start time of the on going epoch
    */
@@ -363,8 +478,9 @@ private:
    * Name of the file where the uplink PDCP statistics will be saved
    */
   std::string m_ulPdcpOutputFilename;
-  std::ofstream m_dlOutFile;
-  std::ofstream m_ulOutFile;
+  NrTraceFile m_dlOutFile; //!< DL output file, open from the first epoch until disposed
+  NrTraceFile m_ulOutFile; //!< UL output file, open from the first epoch until disposed
+  NrTraceFile::Compression m_compression {NrTraceFile::NONE}; //!< The `Compression` attribute
 };
 
 } // namespace ns3
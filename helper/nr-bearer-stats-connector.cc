@@ -30,12 +30,16 @@
 #include "nr-bearer-stats-connector.h"
 
 #include <ns3/log.h>
+#include <ns3/node-list.h>
+#include <ns3/pointer.h>
+#include <ns3/object-map.h>
 
 
 #include <ns3/lte-enb-rrc.h>
 #include <ns3/lte-enb-net-device.h>
 #include <ns3/lte-ue-rrc.h>
 #include <ns3/lte-ue-net-device.h>
+#include <ns3/lte-radio-bearer-info.h>
 
 namespace ns3 {
 
@@ -67,49 +71,46 @@ public:
 /**
  * Callback function for DL TX statistics for both RLC and PDCP
  * /param arg
- * /param path
  * /param rnti
  * /param lcid
  * /param packetSize
  */
 void
-DlTxPduCallback (Ptr<NrBoundCallbackArgument> arg, std::string path,
+DlTxPduCallback (Ptr<NrBoundCallbackArgument> arg,
                  uint16_t rnti, uint8_t lcid, uint32_t packetSize)
 {
-  NS_LOG_FUNCTION (path << rnti << (uint16_t)lcid << packetSize);
+  NS_LOG_FUNCTION (rnti << (uint16_t)lcid << packetSize);
   arg->stats->DlTxPdu (arg->cellId, arg->imsi, rnti, lcid, packetSize);
 }
 
 /**
  * Callback function for DL RX statistics for both RLC and PDCP
  * /param arg
- * /param path
  * /param rnti
  * /param lcid
  * /param packetSize
  * /param delay
  */
 void
-DlRxPduCallback (Ptr<NrBoundCallbackArgument> arg, std::string path,
+DlRxPduCallback (Ptr<NrBoundCallbackArgument> arg,
                  uint16_t rnti, uint8_t lcid, uint32_t packetSize, uint64_t delay)
 {
-  NS_LOG_FUNCTION (path << rnti << (uint16_t)lcid << packetSize << delay);
+  NS_LOG_FUNCTION (rnti << (uint16_t)lcid << packetSize << delay);
   arg->stats->DlRxPdu (arg->cellId, arg->imsi, rnti, lcid, packetSize, delay);
 }
 
 /**
  * Callback function for UL TX statistics for both RLC and PDCP
  * /param arg
- * /param path
  * /param rnti
  * /param lcid
  * /param packetSize
  */
 void
-UlTxPduCallback (Ptr<NrBoundCallbackArgument> arg, std::string path,
+UlTxPduCallback (Ptr<NrBoundCallbackArgument> arg,
                  uint16_t rnti, uint8_t lcid, uint32_t packetSize)
 {
-  NS_LOG_FUNCTION (path << rnti << (uint16_t)lcid << packetSize);
+  NS_LOG_FUNCTION (rnti << (uint16_t)lcid << packetSize);
 
   arg->stats->UlTxPdu (arg->cellId, arg->imsi, rnti, lcid, packetSize);
 }
@@ -117,21 +118,90 @@ UlTxPduCallback (Ptr<NrBoundCallbackArgument> arg, std::string path,
 /**
  * Callback function for UL RX statistics for both RLC and PDCP
  * /param arg
- * /param path
  * /param rnti
  * /param lcid
  * /param packetSize
  * /param delay
  */
 void
-UlRxPduCallback (Ptr<NrBoundCallbackArgument> arg, std::string path,
+UlRxPduCallback (Ptr<NrBoundCallbackArgument> arg,
                  uint16_t rnti, uint8_t lcid, uint32_t packetSize, uint64_t delay)
 {
-  NS_LOG_FUNCTION (path << rnti << (uint16_t)lcid << packetSize << delay);
+  NS_LOG_FUNCTION (rnti << (uint16_t)lcid << packetSize << delay);
 
   arg->stats->UlRxPdu (arg->cellId, arg->imsi, rnti, lcid, packetSize, delay);
 }
 
+/**
+ * The radio bearers of a UE whose PDU traces are connected
+ */
+enum NrStatsBearers
+{
+  NR_STATS_SRB0 = 1, //!< The SRB0
+  NR_STATS_SRB1 = 2, //!< The SRB1
+  NR_STATS_DRB = 4   //!< All the DRBs
+};
+
+/**
+ * Connect the PDU traces of the RLC or PDCP of some radio bearers of a UE
+ *
+ * The bearers are read from the attributes Srb0, Srb1 and
+ * DataRadioBearerMap of the owner, without resolving any Config path; the
+ * bearers that are not set up yet, and the SRB0 PDCP, are skipped.
+ *
+ * \param owner the LteUeRrc of the UE, or its UeManager at the eNB
+ * \param bearers the bearers, as a mask of NrStatsBearers
+ * \param pdcp true for the PDCP traces, false for the RLC traces
+ * \param txSink the sink of the TxPDU traces
+ * \param rxSink the sink of the RxPDU traces
+ */
+void
+ConnectPduTraces (const Ptr<Object> &owner, uint8_t bearers, bool pdcp,
+                  const Callback<void, uint16_t, uint8_t, uint32_t> &txSink,
+                  const Callback<void, uint16_t, uint8_t, uint32_t, uint64_t> &rxSink)
+{
+  std::vector<Ptr<LteRadioBearerInfo> > infos;
+  for (const auto & srb : {std::make_pair (NR_STATS_SRB0, "Srb0"), std::make_pair (NR_STATS_SRB1, "Srb1")})
+    {
+      if (bearers & srb.first)
+        {
+          PointerValue info;
+          owner->GetAttribute (srb.second, info);
+          infos.push_back (info.Get<LteRadioBearerInfo> ());
+        }
+    }
+  if (bearers & NR_STATS_DRB)
+    {
+      ObjectMapValue drbs;
+      owner->GetAttribute ("DataRadioBearerMap", drbs);
+      for (auto it = drbs.Begin (); it != drbs.End (); ++it)
+        {
+          infos.push_back (DynamicCast<LteRadioBearerInfo> (it->second));
+        }
+    }
+
+  for (const auto & info : infos)
+    {
+      if (info == nullptr)
+        {
+          continue;
+        }
+      Ptr<Object> layer;
+      if (pdcp)
+        {
+          layer = info->m_pdcp;
+        }
+      else
+        {
+          layer = info->m_rlc;
+        }
+      if (layer != nullptr)
+        {
+          layer->TraceConnectWithoutContext ("TxPDU", txSink);
+          layer->TraceConnectWithoutContext ("RxPDU", rxSink);
+        }
+    }
+}
 
 
 NrBearerStatsConnector::NrBearerStatsConnector ()
@@ -159,105 +229,119 @@ NrBearerStatsConnector::EnsureConnected ()
   NS_LOG_FUNCTION (this);
   if (!m_connected)
     {
-      Config::Connect ("/NodeList/*/DeviceList/*/LteEnbRrc/NewUeContext",
-                       MakeBoundCallback (&NrBearerStatsConnector::NotifyNewUeContextEnb, this));
-      Config::Connect ("/NodeList/*/DeviceList/*/LteUeRrc/RandomAccessSuccessful",
-                       MakeBoundCallback (&NrBearerStatsConnector::NotifyRandomAccessSuccessfulUe, this));
-      Config::Connect ("/NodeList/*/DeviceList/*/LteEnbRrc/ConnectionReconfiguration",
-                       MakeBoundCallback (&NrBearerStatsConnector::NotifyConnectionReconfigurationEnb, this));
-      Config::Connect ("/NodeList/*/DeviceList/*/LteUeRrc/ConnectionReconfiguration",
-                       MakeBoundCallback (&NrBearerStatsConnector::NotifyConnectionReconfigurationUe, this));
-      Config::Connect ("/NodeList/*/DeviceList/*/LteEnbRrc/HandoverStart",
-                       MakeBoundCallback (&NrBearerStatsConnector::NotifyHandoverStartEnb, this));
-      Config::Connect ("/NodeList/*/DeviceList/*/LteUeRrc/HandoverStart",
-                       MakeBoundCallback (&NrBearerStatsConnector::NotifyHandoverStartUe, this));
-      Config::Connect ("/NodeList/*/DeviceList/*/LteEnbRrc/HandoverEndOk",
-                       MakeBoundCallback (&NrBearerStatsConnector::NotifyHandoverEndOkEnb, this));
-      Config::Connect ("/NodeList/*/DeviceList/*/LteUeRrc/HandoverEndOk",
-                       MakeBoundCallback (&NrBearerStatsConnector::NotifyHandoverEndOkUe, this));
+      // The RRC of each device is bound to the sinks, which then reach the
+      // bearers through it instead of through a path built from the context
+      for (auto node = NodeList::Begin (); node != NodeList::End (); ++node)
+        {
+          for (uint32_t i = 0; i < (*node)->GetNDevices (); ++i)
+            {
+              Ptr<NetDevice> device = (*node)->GetDevice (i);
+              PointerValue rrcValue;
+              if (device->GetAttributeFailSafe ("LteEnbRrc", rrcValue) && rrcValue.Get<LteEnbRrc> () != nullptr)
+                {
+                  Ptr<LteEnbRrc> rrc = rrcValue.Get<LteEnbRrc> ();
+                  rrc->TraceConnectWithoutContext ("NewUeContext",
+                                                   MakeBoundCallback (&NrBearerStatsConnector::NotifyNewUeContextEnb, this, rrc));
+                  rrc->TraceConnectWithoutContext ("ConnectionReconfiguration",
+                                                   MakeBoundCallback (&NrBearerStatsConnector::NotifyConnectionReconfigurationEnb, this, rrc));
+                  rrc->TraceConnectWithoutContext ("HandoverStart",
+                                                   MakeBoundCallback (&NrBearerStatsConnector::NotifyHandoverStartEnb, this, rrc));
+                  rrc->TraceConnectWithoutContext ("HandoverEndOk",
+                                                   MakeBoundCallback (&NrBearerStatsConnector::NotifyHandoverEndOkEnb, this, rrc));
+                }
+              else if (device->GetAttributeFailSafe ("LteUeRrc", rrcValue) && rrcValue.Get<LteUeRrc> () != nullptr)
+                {
+                  Ptr<LteUeRrc> rrc = rrcValue.Get<LteUeRrc> ();
+                  rrc->TraceConnectWithoutContext ("RandomAccessSuccessful",
+                                                   MakeBoundCallback (&NrBearerStatsConnector::NotifyRandomAccessSuccessfulUe, this, rrc));
+                  rrc->TraceConnectWithoutContext ("ConnectionReconfiguration",
+                                                   MakeBoundCallback (&NrBearerStatsConnector::NotifyConnectionReconfigurationUe, this, rrc));
+                  rrc->TraceConnectWithoutContext ("HandoverStart",
+                                                   MakeBoundCallback (&NrBearerStatsConnector::NotifyHandoverStartUe, this, rrc));
+                  rrc->TraceConnectWithoutContext ("HandoverEndOk",
+                                                   MakeBoundCallback (&NrBearerStatsConnector::NotifyHandoverEndOkUe, this, rrc));
+                }
+            }
+        }
       m_connected = true;
     }
 }
 
 void
-NrBearerStatsConnector::NotifyRandomAccessSuccessfulUe (NrBearerStatsConnector* c, std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::NotifyRandomAccessSuccessfulUe (NrBearerStatsConnector* c, Ptr<LteUeRrc> rrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
-  c->ConnectSrb0Traces (context, imsi, cellId, rnti);
+  c->ConnectSrb0Traces (rrc, imsi, cellId, rnti);
 }
 
 void
-NrBearerStatsConnector::NotifyConnectionSetupUe (NrBearerStatsConnector* c, std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::NotifyConnectionSetupUe (NrBearerStatsConnector* c, Ptr<LteUeRrc> rrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
-  c->ConnectSrb1TracesUe (context, imsi, cellId, rnti);
+  c->ConnectSrb1TracesUe (rrc, imsi, cellId, rnti);
 }
 
 void
-NrBearerStatsConnector::NotifyConnectionReconfigurationUe (NrBearerStatsConnector* c, std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::NotifyConnectionReconfigurationUe (NrBearerStatsConnector* c, Ptr<LteUeRrc> rrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
-  c->ConnectTracesUeIfFirstTime (context, imsi, cellId, rnti);
+  c->ConnectTracesUeIfFirstTime (rrc, imsi, cellId, rnti);
 }
 
 void
-NrBearerStatsConnector::NotifyHandoverStartUe (NrBearerStatsConnector* c, std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti, uint16_t targetCellId)
+NrBearerStatsConnector::NotifyHandoverStartUe (NrBearerStatsConnector* c, Ptr<LteUeRrc> rrc, uint64_t imsi, uint16_t cellId, uint16_t rnti, uint16_t targetCellId)
 {
-  c->DisconnectTracesUe (context, imsi, cellId, rnti);
+  c->DisconnectTracesUe (rrc, imsi, cellId, rnti);
 }
 
 void
-NrBearerStatsConnector::NotifyHandoverEndOkUe (NrBearerStatsConnector* c, std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::NotifyHandoverEndOkUe (NrBearerStatsConnector* c, Ptr<LteUeRrc> rrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
-  c->ConnectTracesUe (context, imsi, cellId, rnti);
+  c->ConnectTracesUe (rrc, imsi, cellId, rnti);
 }
 
 void
-NrBearerStatsConnector::NotifyNewUeContextEnb (NrBearerStatsConnector* c, std::string context, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::NotifyNewUeContextEnb (NrBearerStatsConnector* c, Ptr<LteEnbRrc> rrc, uint16_t cellId, uint16_t rnti)
 {
-  c->StoreUeManagerPath (context, cellId, rnti);
+  c->StoreUeManager (rrc, cellId, rnti);
 }
 
 void
-NrBearerStatsConnector::NotifyConnectionReconfigurationEnb (NrBearerStatsConnector* c, std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::NotifyConnectionReconfigurationEnb (NrBearerStatsConnector* c, Ptr<LteEnbRrc> rrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
-  c->ConnectTracesEnbIfFirstTime (context, imsi, cellId, rnti);
+  c->ConnectTracesEnbIfFirstTime (rrc, imsi, cellId, rnti);
 }
 
 void
-NrBearerStatsConnector::NotifyHandoverStartEnb (NrBearerStatsConnector* c, std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti, uint16_t targetCellId)
+NrBearerStatsConnector::NotifyHandoverStartEnb (NrBearerStatsConnector* c, Ptr<LteEnbRrc> rrc, uint64_t imsi, uint16_t cellId, uint16_t rnti, uint16_t targetCellId)
 {
-  c->DisconnectTracesEnb (context, imsi, cellId, rnti);
+  c->DisconnectTracesEnb (rrc, imsi, cellId, rnti);
 }
 
 void
-NrBearerStatsConnector::NotifyHandoverEndOkEnb (NrBearerStatsConnector* c, std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::NotifyHandoverEndOkEnb (NrBearerStatsConnector* c, Ptr<LteEnbRrc> rrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
-  c->ConnectTracesEnb (context, imsi, cellId, rnti);
+  c->ConnectTracesEnb (rrc, imsi, cellId, rnti);
 }
 
 void
-NrBearerStatsConnector::StoreUeManagerPath (std::string context, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::StoreUeManager (Ptr<LteEnbRrc> enbRrc, uint16_t cellId, uint16_t rnti)
 {
-  NS_LOG_FUNCTION (this << context << cellId << rnti);
-  std::ostringstream ueManagerPath;
-  ueManagerPath <<  context.substr (0, context.rfind ("/")) << "/UeMap/" << (uint32_t) rnti;
+  NS_LOG_FUNCTION (this << enbRrc << cellId << rnti);
   CellIdRnti key;
   key.cellId = cellId;
   key.rnti = rnti;
-  m_ueManagerPathByCellIdRnti[key] = ueManagerPath.str ();
+  m_ueManagerByCellIdRnti[key] = enbRrc->GetUeManager (rnti);
 }
 
 void
-NrBearerStatsConnector::ConnectSrb0Traces (std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::ConnectSrb0Traces (Ptr<LteUeRrc> ueRrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
   NS_LOG_FUNCTION (this << imsi << cellId << rnti);
-  std::string ueRrcPath =  context.substr (0, context.rfind ("/"));
   CellIdRnti key;
   key.cellId = cellId;
   key.rnti = rnti;
-  std::map<CellIdRnti, std::string>::iterator it = m_ueManagerPathByCellIdRnti.find (key);
-  NS_ASSERT (it != m_ueManagerPathByCellIdRnti.end ());
-  std::string ueManagerPath = it->second;
-  NS_LOG_LOGIC (this << " ueManagerPath: " << ueManagerPath);
-  m_ueManagerPathByCellIdRnti.erase (it);
+  std::map<CellIdRnti, Ptr<UeManager> >::iterator it = m_ueManagerByCellIdRnti.find (key);
+  NS_ASSERT (it != m_ueManagerByCellIdRnti.end ());
+  Ptr<UeManager> ueManager = it->second;
+  m_ueManagerByCellIdRnti.erase (it);
 
   if (m_rlcStats)
     {
@@ -266,31 +350,12 @@ NrBearerStatsConnector::ConnectSrb0Traces (std::string context, uint64_t imsi, u
       arg->cellId = cellId;
       arg->stats = m_rlcStats;
 
-      // diconnect eventually previously connected SRB0 both at UE and eNB
-      Config::Disconnect (ueRrcPath + "/Srb0/LteRlc/TxPDU",
-                          MakeBoundCallback (&UlTxPduCallback, arg));
-      Config::Disconnect (ueRrcPath + "/Srb0/LteRlc/RxPDU",
-                          MakeBoundCallback (&DlRxPduCallback, arg));
-      Config::Disconnect (ueManagerPath + "/Srb0/LteRlc/TxPDU",
-                          MakeBoundCallback (&DlTxPduCallback, arg));
-      Config::Disconnect (ueManagerPath + "/Srb0/LteRlc/RxPDU",
-                          MakeBoundCallback (&UlRxPduCallback, arg));
-
       // connect SRB0 both at UE and eNB
-      Config::Connect (ueRrcPath + "/Srb0/LteRlc/TxPDU",
-                       MakeBoundCallback (&UlTxPduCallback, arg));
-      Config::Connect (ueRrcPath + "/Srb0/LteRlc/RxPDU",
-                       MakeBoundCallback (&DlRxPduCallback, arg));
-      Config::Connect (ueManagerPath + "/Srb0/LteRlc/TxPDU",
-                       MakeBoundCallback (&DlTxPduCallback, arg));
-      Config::Connect (ueManagerPath + "/Srb0/LteRlc/RxPDU",
-                       MakeBoundCallback (&UlRxPduCallback, arg));
-
+      ConnectPduTraces (ueRrc, NR_STATS_SRB0, false,
+                        MakeBoundCallback (&UlTxPduCallback, arg), MakeBoundCallback (&DlRxPduCallback, arg));
       // connect SRB1 at eNB only (at UE SRB1 will be setup later)
-      Config::Connect (ueManagerPath + "/Srb1/LteRlc/TxPDU",
-                       MakeBoundCallback (&DlTxPduCallback, arg));
-      Config::Connect (ueManagerPath + "/Srb1/LteRlc/RxPDU",
-                       MakeBoundCallback (&UlRxPduCallback, arg));
+      ConnectPduTraces (ueManager, NR_STATS_SRB0 | NR_STATS_SRB1, false,
+                        MakeBoundCallback (&DlTxPduCallback, arg), MakeBoundCallback (&UlRxPduCallback, arg));
     }
   if (m_pdcpStats)
     {
@@ -300,15 +365,13 @@ NrBearerStatsConnector::ConnectSrb0Traces (std::string context, uint64_t imsi, u
       arg->stats = m_pdcpStats;
 
       // connect SRB1 at eNB only (at UE SRB1 will be setup later)
-      Config::Connect (ueManagerPath + "/Srb1/LtePdcp/RxPDU",
-                       MakeBoundCallback (&UlRxPduCallback, arg));
-      Config::Connect (ueManagerPath + "/Srb1/LtePdcp/TxPDU",
-                       MakeBoundCallback (&DlTxPduCallback, arg));
+      ConnectPduTraces (ueManager, NR_STATS_SRB1, true,
+                        MakeBoundCallback (&DlTxPduCallback, arg), MakeBoundCallback (&UlRxPduCallback, arg));
     }
 }
 
 void
-NrBearerStatsConnector::ConnectSrb1TracesUe (std::string ueRrcPath, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::ConnectSrb1TracesUe (Ptr<LteUeRrc> ueRrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
   NS_LOG_FUNCTION (this << imsi << cellId << rnti);
   if (m_rlcStats)
@@ -317,10 +380,8 @@ NrBearerStatsConnector::ConnectSrb1TracesUe (std::string ueRrcPath, uint64_t ims
       arg->imsi = imsi;
       arg->cellId = cellId;
       arg->stats = m_rlcStats;
-      Config::Connect (ueRrcPath + "/Srb1/LteRlc/TxPDU",
-                       MakeBoundCallback (&UlTxPduCallback, arg));
-      Config::Connect (ueRrcPath + "/Srb1/LteRlc/RxPDU",
-                       MakeBoundCallback (&DlRxPduCallback, arg));
+      ConnectPduTraces (ueRrc, NR_STATS_SRB1, false,
+                        MakeBoundCallback (&UlTxPduCallback, arg), MakeBoundCallback (&DlRxPduCallback, arg));
     }
   if (m_pdcpStats)
     {
@@ -328,56 +389,45 @@ NrBearerStatsConnector::ConnectSrb1TracesUe (std::string ueRrcPath, uint64_t ims
       arg->imsi = imsi;
       arg->cellId = cellId;
       arg->stats = m_pdcpStats;
-      Config::Connect (ueRrcPath + "/Srb1/LtePdcp/RxPDU",
-                       MakeBoundCallback (&DlRxPduCallback, arg));
-      Config::Connect (ueRrcPath + "/Srb1/LtePdcp/TxPDU",
-                       MakeBoundCallback (&UlTxPduCallback, arg));
+      ConnectPduTraces (ueRrc, NR_STATS_SRB1, true,
+                        MakeBoundCallback (&UlTxPduCallback, arg), MakeBoundCallback (&DlRxPduCallback, arg));
     }
 }
 
 void
-NrBearerStatsConnector::ConnectTracesUeIfFirstTime (std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::ConnectTracesUeIfFirstTime (Ptr<LteUeRrc> ueRrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
-  NS_LOG_FUNCTION (this << context);
+  NS_LOG_FUNCTION (this << ueRrc);
   if (m_imsiSeenUe.find (imsi) == m_imsiSeenUe.end ())
     {
       m_imsiSeenUe.insert (imsi);
-      ConnectTracesUe (context, imsi, cellId, rnti);
+      ConnectTracesUe (ueRrc, imsi, cellId, rnti);
     }
 }
 
 void
-NrBearerStatsConnector::ConnectTracesEnbIfFirstTime (std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::ConnectTracesEnbIfFirstTime (Ptr<LteEnbRrc> enbRrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
-  NS_LOG_FUNCTION (this << context);
+  NS_LOG_FUNCTION (this << enbRrc);
   if (m_imsiSeenEnb.find (imsi) == m_imsiSeenEnb.end ())
     {
       m_imsiSeenEnb.insert (imsi);
-      ConnectTracesEnb (context, imsi, cellId, rnti);
+      ConnectTracesEnb (enbRrc, imsi, cellId, rnti);
     }
 }
 
 void
-NrBearerStatsConnector::ConnectTracesUe (std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::ConnectTracesUe (Ptr<LteUeRrc> ueRrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
-  NS_LOG_FUNCTION (this << context);
-  NS_LOG_LOGIC (this << "expected context should match /NodeList/*/DeviceList/*/LteUeRrc/");
-  std::string basePath = context.substr (0, context.rfind ("/"));
+  NS_LOG_FUNCTION (this << ueRrc);
   if (m_rlcStats)
     {
       Ptr<NrBoundCallbackArgument> arg = Create<NrBoundCallbackArgument> ();
       arg->imsi = imsi;
       arg->cellId = cellId;
       arg->stats = m_rlcStats;
-      Config::Connect (basePath + "/DataRadioBearerMap/*/LteRlc/TxPDU",
-                       MakeBoundCallback (&UlTxPduCallback, arg));
-      Config::Connect (basePath + "/DataRadioBearerMap/*/LteRlc/RxPDU",
-                       MakeBoundCallback (&DlRxPduCallback, arg));
-      Config::Connect (basePath + "/Srb1/LteRlc/TxPDU",
-                       MakeBoundCallback (&UlTxPduCallback, arg));
-      Config::Connect (basePath + "/Srb1/LteRlc/RxPDU",
-                       MakeBoundCallback (&DlRxPduCallback, arg));
-
+      ConnectPduTraces (ueRrc, NR_STATS_DRB | NR_STATS_SRB1, false,
+                        MakeBoundCallback (&UlTxPduCallback, arg), MakeBoundCallback (&DlRxPduCallback, arg));
     }
   if (m_pdcpStats)
     {
@@ -385,42 +435,24 @@ NrBearerStatsConnector::ConnectTracesUe (std::string context, uint64_t imsi, uin
       arg->imsi = imsi;
       arg->cellId = cellId;
       arg->stats = m_pdcpStats;
-      Config::Connect (basePath + "/DataRadioBearerMap/*/LtePdcp/RxPDU",
-                       MakeBoundCallback (&DlRxPduCallback, arg));
-      Config::Connect (basePath + "/DataRadioBearerMap/*/LtePdcp/TxPDU",
-                       MakeBoundCallback (&UlTxPduCallback, arg));
-      Config::Connect (basePath + "/Srb1/LtePdcp/RxPDU",
-                       MakeBoundCallback (&DlRxPduCallback, arg));
-      Config::Connect (basePath + "/Srb1/LtePdcp/TxPDU",
-                       MakeBoundCallback (&UlTxPduCallback, arg));
+      ConnectPduTraces (ueRrc, NR_STATS_DRB | NR_STATS_SRB1, true,
+                        MakeBoundCallback (&UlTxPduCallback, arg), MakeBoundCallback (&DlRxPduCallback, arg));
     }
 }
 
 void
-NrBearerStatsConnector::ConnectTracesEnb (std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::ConnectTracesEnb (Ptr<LteEnbRrc> enbRrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
-  NS_LOG_FUNCTION (this << context);
-  NS_LOG_LOGIC (this << "expected context  should match /NodeList/*/DeviceList/*/LteEnbRrc/");
-  std::ostringstream basePath;
-  basePath <<  context.substr (0, context.rfind ("/")) << "/UeMap/" << (uint32_t) rnti;
+  NS_LOG_FUNCTION (this << enbRrc);
+  Ptr<UeManager> ueManager = enbRrc->GetUeManager (rnti);
   if (m_rlcStats)
     {
       Ptr<NrBoundCallbackArgument> arg = Create<NrBoundCallbackArgument> ();
       arg->imsi = imsi;
       arg->cellId = cellId;
       arg->stats = m_rlcStats;
-      Config::Connect (basePath.str () + "/DataRadioBearerMap/*/LteRlc/RxPDU",
-                       MakeBoundCallback (&UlRxPduCallback, arg));
-      Config::Connect (basePath.str () + "/DataRadioBearerMap/*/LteRlc/TxPDU",
-                       MakeBoundCallback (&DlTxPduCallback, arg));
-      Config::Connect (basePath.str () + "/Srb0/LteRlc/RxPDU",
-                       MakeBoundCallback (&UlRxPduCallback, arg));
-      Config::Connect (basePath.str () + "/Srb0/LteRlc/TxPDU",
-                       MakeBoundCallback (&DlTxPduCallback, arg));
-      Config::Connect (basePath.str () + "/Srb1/LteRlc/RxPDU",
-                       MakeBoundCallback (&UlRxPduCallback, arg));
-      Config::Connect (basePath.str () + "/Srb1/LteRlc/TxPDU",
-                       MakeBoundCallback (&DlTxPduCallback, arg));
+      ConnectPduTraces (ueManager, NR_STATS_DRB | NR_STATS_SRB0 | NR_STATS_SRB1, false,
+                        MakeBoundCallback (&DlTxPduCallback, arg), MakeBoundCallback (&UlRxPduCallback, arg));
     }
   if (m_pdcpStats)
     {
@@ -428,26 +460,20 @@ NrBearerStatsConnector::ConnectTracesEnb (std::string context, uint64_t imsi, ui
       arg->imsi = imsi;
       arg->cellId = cellId;
       arg->stats = m_pdcpStats;
-      Config::Connect (basePath.str () + "/DataRadioBearerMap/*/LtePdcp/TxPDU",
-                       MakeBoundCallback (&DlTxPduCallback, arg));
-      Config::Connect (basePath.str () + "/DataRadioBearerMap/*/LtePdcp/RxPDU",
-                       MakeBoundCallback (&UlRxPduCallback, arg));
-      Config::Connect (basePath.str () + "/Srb1/LtePdcp/TxPDU",
-                       MakeBoundCallback (&DlTxPduCallback, arg));
-      Config::Connect (basePath.str () + "/Srb1/LtePdcp/RxPDU",
-                       MakeBoundCallback (&UlRxPduCallback, arg));
+      ConnectPduTraces (ueManager, NR_STATS_DRB | NR_STATS_SRB1, true,
+                        MakeBoundCallback (&DlTxPduCallback, arg), MakeBoundCallback (&UlRxPduCallback, arg));
     }
 }
 
 void
-NrBearerStatsConnector::DisconnectTracesUe (std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::DisconnectTracesUe (Ptr<LteUeRrc> ueRrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
   NS_LOG_FUNCTION (this);
 }
 
 
 void
-NrBearerStatsConnector::DisconnectTracesEnb (std::string context, uint64_t imsi, uint16_t cellId, uint16_t rnti)
+NrBearerStatsConnector::DisconnectTracesEnb (Ptr<LteEnbRrc> enbRrc, uint64_t imsi, uint16_t cellId, uint16_t rnti)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -0,0 +1,347 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-binary-trace.h"
+#include "nr-trace-queue.h"
+#include <ns3/log.h>
+#include <ns3/fatal-error.h>
+#include <ns3/abort.h>
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrBinaryTrace");
+
+static const char NR_BINARY_TRACE_MAGIC[4] = {'N', 'R', 'B', 'T'};
+static const uint16_t NR_BINARY_TRACE_VERSION = 1;
+static const uint32_t NR_BINARY_TRACE_BOM = 0x01020304;
+
+/**
+ * \brief Read an unaligned value from a record
+ * \param p pointer to the value
+ * \return the value
+ */
+template <typename T>
+static T
+LoadValue (const char *p)
+{
+  T v;
+  std::memcpy (&v, p, sizeof (T));
+  return v;
+}
+
+uint32_t
+NrBinaryTraceColumn::GetSize (Type type)
+{
+  switch (type)
+    {
+    case UINT8:
+      return 1;
+    case UINT16:
+      return 2;
+    case UINT32:
+      return 4;
+    case UINT64:
+      return 8;
+    case DOUBLE:
+      return 8;
+    }
+  NS_FATAL_ERROR ("Unknown column type " << +type);
+  return 0;
+}
+
+void
+NrBinaryTraceWriter::Open (const std::string &fileName,
+                           const std::vector<NrBinaryTraceColumn> &columns)
+{
+  NS_LOG_FUNCTION (this << fileName);
+  NS_ABORT_MSG_IF (columns.empty (), "A binary trace needs at least one column");
+  NS_ABORT_MSG_IF (columns.size () > std::numeric_limits<uint16_t>::max (),
+                   "Too many columns: " << columns.size ());
+
+  m_file.open (fileName.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!m_file.is_open ())
+    {
+      NS_FATAL_ERROR ("Could not open tracefile " << fileName);
+    }
+
+  m_columns = columns;
+  uint32_t recordSize = 0;
+  for (const auto &c : m_columns)
+    {
+      recordSize += NrBinaryTraceColumn::GetSize (c.m_type);
+    }
+  m_record.assign (recordSize, 0);
+  m_offset = 0;
+  m_column = 0;
+
+  uint16_t numColumns = static_cast<uint16_t> (m_columns.size ());
+  m_file.write (NR_BINARY_TRACE_MAGIC, sizeof (NR_BINARY_TRACE_MAGIC));
+  m_file.write (reinterpret_cast<const char*> (&NR_BINARY_TRACE_VERSION), sizeof (NR_BINARY_TRACE_VERSION));
+  m_file.write (reinterpret_cast<const char*> (&NR_BINARY_TRACE_BOM), sizeof (NR_BINARY_TRACE_BOM));
+  m_file.write (reinterpret_cast<const char*> (&numColumns), sizeof (numColumns));
+  for (const auto &c : m_columns)
+    {
+      NS_ABORT_MSG_IF (c.m_name.size () > std::numeric_limits<uint8_t>::max (),
+                       "Column name too long: " << c.m_name);
+      uint8_t type = c.m_type;
+      uint8_t nameLength = static_cast<uint8_t> (c.m_name.size ());
+      m_file.write (reinterpret_cast<const char*> (&type), sizeof (type));
+      m_file.write (reinterpret_cast<const char*> (&nameLength), sizeof (nameLength));
+      m_file.write (c.m_name.data (), nameLength);
+    }
+}
+
+bool
+NrBinaryTraceWriter::IsOpen () const
+{
+  return m_file.is_open ();
+}
+
+void
+NrBinaryTraceWriter::SetAsync (bool async)
+{
+  NS_LOG_FUNCTION (this << async);
+  if (m_async && !async)
+    {
+      NrTraceQueue::Get ().Flush ();
+    }
+  m_async = async;
+}
+
+void
+NrBinaryTraceWriter::Close ()
+{
+  if (m_file.is_open ())
+    {
+      if (m_async)
+        {
+          NrTraceQueue::Get ().Flush ();
+        }
+      m_file.close ();
+    }
+}
+
+void
+NrBinaryTraceWriter::EndRecord ()
+{
+  NS_ASSERT_MSG (m_column == m_columns.size (), "Incomplete record: " << m_column <<
+                 " values for " << m_columns.size () << " columns");
+  if (m_async)
+    {
+      NrTraceQueue::Get ().Push (&m_file, m_record.data (), static_cast<uint32_t> (m_record.size ()));
+    }
+  else
+    {
+      m_file.write (m_record.data (), m_record.size ());
+    }
+  m_offset = 0;
+  m_column = 0;
+}
+
+bool
+NrBinaryTraceReader::Open (const std::string &fileName)
+{
+  NS_LOG_FUNCTION (this << fileName);
+
+  // Without a valid header, ReadRecord must fail instead of reading empty records
+  m_columns.clear ();
+  m_record.clear ();
+  if (m_file.is_open ())
+    {
+      m_file.close ();
+    }
+  m_file.clear ();
+
+  m_file.open (fileName.c_str (), std::ios::in | std::ios::binary);
+  if (!m_file.is_open ())
+    {
+      NS_LOG_ERROR ("Could not open " << fileName);
+      return false;
+    }
+
+  char magic[sizeof (NR_BINARY_TRACE_MAGIC)];
+  uint16_t version = 0;
+  uint32_t bom = 0;
+  uint16_t numColumns = 0;
+  m_file.read (magic, sizeof (magic));
+  m_file.read (reinterpret_cast<char*> (&version), sizeof (version));
+  m_file.read (reinterpret_cast<char*> (&bom), sizeof (bom));
+  m_file.read (reinterpret_cast<char*> (&numColumns), sizeof (numColumns));
+
+  if (!m_file || std::memcmp (magic, NR_BINARY_TRACE_MAGIC, sizeof (magic)) != 0)
+    {
+      NS_LOG_ERROR (fileName << " is not a binary trace file");
+      return false;
+    }
+  if (version != NR_BINARY_TRACE_VERSION)
+    {
+      NS_LOG_ERROR ("Unsupported binary trace version " << version);
+      return false;
+    }
+  if (bom != NR_BINARY_TRACE_BOM)
+    {
+      NS_LOG_ERROR (fileName << " was written on a host with a different byte order");
+      return false;
+    }
+  if (numColumns == 0)
+    {
+      // A record of 0 bytes would be read forever
+      NS_LOG_ERROR ("Malformed header in " << fileName << ": no columns");
+      return false;
+    }
+
+  std::vector<NrBinaryTraceColumn> columns;
+  uint32_t recordSize = 0;
+  for (uint16_t i = 0; i < numColumns; ++i)
+    {
+      uint8_t type = 0;
+      uint8_t nameLength = 0;
+      m_file.read (reinterpret_cast<char*> (&type), sizeof (type));
+      m_file.read (reinterpret_cast<char*> (&nameLength), sizeof (nameLength));
+      std::string name (nameLength, '\0');
+      m_file.read (&name[0], nameLength);
+      if (!m_file)
+        {
+          NS_LOG_ERROR ("Malformed header in " << fileName << ": truncated column " << i);
+          return false;
+        }
+      if (type > NrBinaryTraceColumn::DOUBLE)
+        {
+          NS_LOG_ERROR ("Malformed header in " << fileName << ": unknown type " << +type <<
+                        " of column " << i);
+          return false;
+        }
+      NrBinaryTraceColumn c;
+      c.m_name = name;
+      c.m_type = static_cast<NrBinaryTraceColumn::Type> (type);
+      columns.push_back (c);
+      recordSize += NrBinaryTraceColumn::GetSize (c.m_type);
+    }
+  m_columns.swap (columns);
+  m_record.assign (recordSize, 0);
+  return true;
+}
+
+const std::vector<NrBinaryTraceColumn> &
+NrBinaryTraceReader::GetColumns () const
+{
+  return m_columns;
+}
+
+bool
+NrBinaryTraceReader::ReadRawRecord ()
+{
+  if (m_record.empty ())
+    {
+      return false;
+    }
+  m_file.read (m_record.data (), m_record.size ());
+  return static_cast<size_t> (m_file.gcount ()) == m_record.size ();
+}
+
+bool
+NrBinaryTraceReader::ReadRecord (std::vector<double> *values)
+{
+  if (!ReadRawRecord ())
+    {
+      return false;
+    }
+
+  values->resize (m_columns.size ());
+  uint32_t offset = 0;
+  for (size_t i = 0; i < m_columns.size (); ++i)
+    {
+      const char *p = m_record.data () + offset;
+      switch (m_columns[i].m_type)
+        {
+        case NrBinaryTraceColumn::UINT8:
+          values->at (i) = LoadValue<uint8_t> (p);
+          break;
+        case NrBinaryTraceColumn::UINT16:
+          values->at (i) = LoadValue<uint16_t> (p);
+          break;
+        case NrBinaryTraceColumn::UINT32:
+          values->at (i) = LoadValue<uint32_t> (p);
+          break;
+        case NrBinaryTraceColumn::UINT64:
+          values->at (i) = static_cast<double> (LoadValue<uint64_t> (p));
+          break;
+        case NrBinaryTraceColumn::DOUBLE:
+          values->at (i) = LoadValue<double> (p);
+          break;
+        }
+      offset += NrBinaryTraceColumn::GetSize (m_columns[i].m_type);
+    }
+  return true;
+}
+
+void
+NrBinaryTraceReader::PrintValue (std::ostream &os, uint32_t offset,
+                                 NrBinaryTraceColumn::Type type) const
+{
+  const char *p = m_record.data () + offset;
+  switch (type)
+    {
+    case NrBinaryTraceColumn::UINT8:
+      os << +LoadValue<uint8_t> (p);
+      break;
+    case NrBinaryTraceColumn::UINT16:
+      os << LoadValue<uint16_t> (p);
+      break;
+    case NrBinaryTraceColumn::UINT32:
+      os << LoadValue<uint32_t> (p);
+      break;
+    case NrBinaryTraceColumn::UINT64:
+      os << LoadValue<uint64_t> (p);
+      break;
+    case NrBinaryTraceColumn::DOUBLE:
+      os << LoadValue<double> (p);
+      break;
+    }
+}
+
+uint64_t
+NrBinaryTraceReader::ConvertToText (std::ostream &os, char separator)
+{
+  for (size_t i = 0; i < m_columns.size (); ++i)
+    {
+      os << (i == 0 ? "" : std::string (1, separator)) << m_columns[i].m_name;
+    }
+  os << "\n";
+
+  uint64_t records = 0;
+  while (ReadRawRecord ())
+    {
+      uint32_t offset = 0;
+      for (size_t i = 0; i < m_columns.size (); ++i)
+        {
+          if (i > 0)
+            {
+              os << separator;
+            }
+          PrintValue (os, offset, m_columns[i].m_type);
+          offset += NrBinaryTraceColumn::GetSize (m_columns[i].m_type);
+        }
+      os << "\n";
+      ++records;
+    }
+  return records;
+}
+
+} // namespace ns3
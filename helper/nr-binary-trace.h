@@ -0,0 +1,215 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_BINARY_TRACE_H
+#define NR_BINARY_TRACE_H
+
+#include <ns3/assert.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup helper
+ * \brief Column description of a binary trace file
+ *
+ * A binary trace file starts with a self-describing header:
+ *
+ * - the magic string "NRBT" (4 bytes);
+ * - the format version (uint16_t);
+ * - the byte-order mark 0x01020304 (uint32_t), written in the byte order
+ * of the host that produced the file;
+ * - the number of columns (uint16_t);
+ * - for each column, its type (uint8_t), the length of its name (uint8_t)
+ * and the name itself (without terminator).
+ *
+ * The header is followed by fixed-width records, one per trace sample, in
+ * which the columns are packed without padding in the order of the header.
+ */
+struct NrBinaryTraceColumn
+{
+  /**
+   * \brief Type of the values stored in a column
+   */
+  enum Type : uint8_t
+  {
+    UINT8 = 0,
+    UINT16 = 1,
+    UINT32 = 2,
+    UINT64 = 3,
+    DOUBLE = 4
+  };
+
+  std::string m_name;   //!< Name of the column
+  Type m_type;          //!< Type of the column
+
+  /**
+   * \brief Get the size, in bytes, of a value of a given type
+   * \param type the column type
+   * \return the size of the value
+   */
+  static uint32_t GetSize (Type type);
+};
+
+/**
+ * \ingroup helper
+ * \brief Writer of binary trace files
+ *
+ * Usage:
+ * \code
+ *   writer.Open ("trace.bin", {{"time", NrBinaryTraceColumn::DOUBLE},
+ *                              {"rnti", NrBinaryTraceColumn::UINT16}});
+ *   writer.Add<double> (t).Add<uint16_t> (rnti).EndRecord ();
+ * \endcode
+ *
+ * The values must be added in the column order, with a C++ type whose size
+ * matches the column type.
+ *
+ * \see NrBinaryTraceColumn for the file format
+ * \see NrBinaryTraceReader
+ */
+class NrBinaryTraceWriter
+{
+public:
+  /**
+   * \brief Open the file and write the header
+   * \param fileName the name of the file
+   * \param columns the columns of each record
+   */
+  void Open (const std::string &fileName, const std::vector<NrBinaryTraceColumn> &columns);
+
+  /**
+   * \return true if the file is open
+   */
+  bool IsOpen () const;
+
+  /**
+   * \brief Write the records through NrTraceQueue, on its thread
+   *
+   * The header is always written by Open. Close waits for the queued
+   * records.
+   *
+   * \param async if true, the records are queued instead of written
+   */
+  void SetAsync (bool async);
+
+  /**
+   * \brief Close the file
+   */
+  void Close ();
+
+  /**
+   * \brief Add the value of the next column of the current record
+   * \param value the value
+   * \return a reference to this writer
+   */
+  template <typename T>
+  NrBinaryTraceWriter & Add (T value)
+  {
+    NS_ASSERT_MSG (m_column < m_columns.size (), "Too many values in the record");
+    NS_ASSERT_MSG (sizeof (T) == NrBinaryTraceColumn::GetSize (m_columns.at (m_column).m_type),
+                   "Wrong type for column " << m_columns.at (m_column).m_name);
+    std::memcpy (m_record.data () + m_offset, &value, sizeof (T));
+    m_offset += sizeof (T);
+    ++m_column;
+    return *this;
+  }
+
+  /**
+   * \brief Write the current record to the file
+   */
+  void EndRecord ();
+
+private:
+  std::ofstream m_file;                       //!< Output file
+  std::vector<NrBinaryTraceColumn> m_columns; //!< Columns of the records
+  std::vector<char> m_record;                 //!< Record being filled
+  uint32_t m_offset {0};                      //!< Write offset in m_record
+  uint32_t m_column {0};                      //!< Next column in m_record
+  bool m_async {false};                       //!< Whether the records go through NrTraceQueue
+};
+
+/**
+ * \ingroup helper
+ * \brief Reader of the binary trace files written by NrBinaryTraceWriter
+ *
+ * It checks the header and converts the records to text, for example:
+ * \code
+ *   NrBinaryTraceReader reader;
+ *   reader.Open ("trace.bin");
+ *   reader.ConvertToText (std::cout, ',');
+ * \endcode
+ */
+class NrBinaryTraceReader
+{
+public:
+  /**
+   * \brief Open a file and read its header
+   * \param fileName the name of the file
+   * \return false if the file could not be opened or if it is not a valid
+   * binary trace file: wrong magic string, version or byte order, no
+   * columns, or a column of unknown type. Then ReadRecord returns false.
+   */
+  bool Open (const std::string &fileName);
+
+  /**
+   * \return the columns of the file
+   */
+  const std::vector<NrBinaryTraceColumn> & GetColumns () const;
+
+  /**
+   * \brief Read the next record
+   * \param values the values of the record, one per column, converted to double
+   * \return false at the end of the file
+   */
+  bool ReadRecord (std::vector<double> *values);
+
+  /**
+   * \brief Write the header and all the remaining records as text
+   * \param os the output stream
+   * \param separator the separator between columns ('\\t' or ',')
+   * \return the number of records written
+   */
+  uint64_t ConvertToText (std::ostream &os, char separator);
+
+private:
+  /**
+   * \brief Read the next record in m_record
+   * \return false at the end of the file
+   */
+  bool ReadRawRecord ();
+  /**
+   * \brief Write a value of m_record as text
+   * \param os the output stream
+   * \param offset the offset of the value in m_record
+   * \param type the type of the value
+   */
+  void PrintValue (std::ostream &os, uint32_t offset, NrBinaryTraceColumn::Type type) const;
+
+  std::ifstream m_file;                       //!< Input file
+  std::vector<NrBinaryTraceColumn> m_columns; //!< Columns of the records
+  std::vector<char> m_record;                 //!< Last record read
+};
+
+} // namespace ns3
+
+#endif // NR_BINARY_TRACE_H
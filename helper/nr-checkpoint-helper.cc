@@ -0,0 +1,315 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-checkpoint-helper.h"
+#include "nr-helper.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/mobility-model.h>
+#include <ns3/net-device-container.h>
+#include <ns3/node.h>
+#include <ns3/nr-gnb-net-device.h>
+#include <ns3/nr-ue-net-device.h>
+#include <ns3/nr-gnb-phy.h>
+#include <ns3/nr-ue-phy.h>
+#include <ns3/nr-spectrum-phy.h>
+#include <ns3/beam-manager.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrCheckpointHelper");
+
+static const std::string CHECKPOINT_MAGIC = "nr-checkpoint"; //!< First word of a checkpoint
+static const uint32_t CHECKPOINT_VERSION = 1;                //!< Version of the format
+
+/**
+ * \brief Get the mobility model of the node of a device
+ * \param device the device
+ * \return the mobility model
+ */
+static Ptr<MobilityModel>
+GetMobility (const Ptr<NetDevice> &device)
+{
+  Ptr<MobilityModel> mobility = device->GetNode ()->GetObject<MobilityModel> ();
+  NS_ABORT_MSG_IF (mobility == nullptr,
+                   "The node " << device->GetNode ()->GetId () << " has no mobility model");
+  return mobility;
+}
+
+/**
+ * \brief Write the beamforming vector that a beam manager saved for a device
+ * \param os the output stream
+ * \param prefix the beginning of the line
+ * \param beamManager the beam manager
+ * \param device the device
+ */
+static void
+WriteBeam (std::ostream &os, const std::string &prefix, const Ptr<BeamManager> &beamManager,
+           const Ptr<NetDevice> &device)
+{
+  if (!beamManager->HasBeamformingVector (device))
+    {
+      return;
+    }
+  BeamId beamId = beamManager->GetBeamId (device);
+  complexVector_t vector = beamManager->GetBeamformingVector (device);
+  os << prefix << " " << beamId.GetSector () << " " << beamId.GetElevation () << " " << vector.size ();
+  for (const auto &weight : vector)
+    {
+      os << " " << weight.real () << " " << weight.imag ();
+    }
+  os << "\n";
+}
+
+/**
+ * \brief Read a word, and abort if it is not the expected one
+ * \param is the input stream
+ * \param expected the expected word
+ * \param fileName the file, for the message
+ */
+static void
+ReadKeyword (std::istream &is, const std::string &expected, const std::string &fileName)
+{
+  std::string word;
+  is >> word;
+  NS_ABORT_MSG_IF (word != expected,
+                   "Expected \"" << expected << "\" in " << fileName << ", got \"" << word << "\"");
+}
+
+void
+NrCheckpointHelper::Save (const std::string &fileName, const NetDeviceContainer &gnbDevices,
+                          const NetDeviceContainer &ueDevices, bool saveBeams)
+{
+  NS_LOG_FUNCTION (fileName << gnbDevices.GetN () << ueDevices.GetN () << saveBeams);
+
+  std::ofstream os (fileName, std::ios_base::out | std::ios_base::trunc);
+  NS_ABORT_MSG_IF (!os.is_open (), "Can't open " << fileName);
+  os << std::setprecision (std::numeric_limits<double>::max_digits10);
+
+  os << CHECKPOINT_MAGIC << " " << CHECKPOINT_VERSION << "\n";
+
+  std::map<Ptr<const NetDevice>, uint32_t> gnbIndex;
+  os << "gnbs " << gnbDevices.GetN () << "\n";
+  for (uint32_t i = 0; i < gnbDevices.GetN (); ++i)
+    {
+      Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice> (gnbDevices.Get (i));
+      NS_ABORT_MSG_IF (gnb == nullptr, "The device " << i << " is not a gNB");
+      gnbIndex.emplace (gnb, i);
+
+      Vector pos = GetMobility (gnb)->GetPosition ();
+      os << "gnb " << i << " " << pos.x << " " << pos.y << " " << pos.z << " "
+         << gnb->GetCcMapSize () << "\n";
+      for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize (); ++bwp)
+        {
+          Ptr<NrGnbPhy> phy = gnb->GetPhy (bwp);
+          os << "bwp " << bwp << " " << phy->GetNumerology () << " "
+             << phy->GetCentralFrequency () << " " << phy->GetChannelBandwidth () << "\n";
+        }
+    }
+
+  os << "ues " << ueDevices.GetN () << "\n";
+  for (uint32_t i = 0; i < ueDevices.GetN (); ++i)
+    {
+      Ptr<NrUeNetDevice> ue = DynamicCast<NrUeNetDevice> (ueDevices.Get (i));
+      NS_ABORT_MSG_IF (ue == nullptr, "The device " << i << " is not a UE");
+
+      int64_t servingGnb = -1;
+      if (ue->GetTargetEnb () != nullptr)
+        {
+          auto it = gnbIndex.find (ue->GetTargetEnb ());
+          NS_ABORT_MSG_IF (it == gnbIndex.end (),
+                           "The UE " << i << " is attached to a gNB that is not in the container");
+          servingGnb = it->second;
+        }
+
+      Vector pos = GetMobility (ue)->GetPosition ();
+      os << "ue " << i << " " << pos.x << " " << pos.y << " " << pos.z << " " << servingGnb << "\n";
+    }
+
+  if (saveBeams)
+    {
+      for (uint32_t i = 0; i < ueDevices.GetN (); ++i)
+        {
+          Ptr<NrUeNetDevice> ue = DynamicCast<NrUeNetDevice> (ueDevices.Get (i));
+          if (ue->GetTargetEnb () == nullptr)
+            {
+              continue;
+            }
+          Ptr<NetDevice> gnb = gnbDevices.Get (gnbIndex.at (ue->GetTargetEnb ()));
+          Ptr<NrGnbNetDevice> gnbDev = DynamicCast<NrGnbNetDevice> (gnb);
+
+          for (uint32_t bwp = 0; bwp < ue->GetCcMapSize (); ++bwp)
+            {
+              uint8_t streams = std::min (gnbDev->GetPhy (bwp)->GetNumberOfStreams (),
+                                          ue->GetPhy (bwp)->GetNumberOfStreams ());
+              for (uint32_t stream = 0; stream < streams; ++stream)
+                {
+                  std::string prefix = "beam " + std::to_string (i) + " " + std::to_string (bwp) +
+                    " " + std::to_string (stream);
+                  WriteBeam (os, prefix + " gnb",
+                             gnbDev->GetPhy (bwp)->GetSpectrumPhy (stream)->GetBeamManager (), ue);
+                  WriteBeam (os, prefix + " ue",
+                             ue->GetPhy (bwp)->GetSpectrumPhy (stream)->GetBeamManager (), gnb);
+                }
+            }
+        }
+    }
+
+  NS_ABORT_MSG_IF (!os.good (), "Error while writing " << fileName);
+}
+
+void
+NrCheckpointHelper::Restore (const std::string &fileName, const Ptr<NrHelper> &nrHelper,
+                             const NetDeviceContainer &gnbDevices, const NetDeviceContainer &ueDevices)
+{
+  NS_LOG_FUNCTION (fileName << gnbDevices.GetN () << ueDevices.GetN ());
+
+  std::ifstream is (fileName);
+  NS_ABORT_MSG_IF (!is.is_open (), "Can't open " << fileName);
+
+  uint32_t version = 0;
+  ReadKeyword (is, CHECKPOINT_MAGIC, fileName);
+  is >> version;
+  NS_ABORT_MSG_IF (version != CHECKPOINT_VERSION,
+                   "Unsupported version " << version << " of " << fileName);
+
+  uint32_t numGnbs = 0;
+  ReadKeyword (is, "gnbs", fileName);
+  is >> numGnbs;
+  NS_ABORT_MSG_IF (numGnbs != gnbDevices.GetN (),
+                   fileName << " has " << numGnbs << " gNBs, the scenario " << gnbDevices.GetN ());
+  for (uint32_t i = 0; i < numGnbs; ++i)
+    {
+      Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice> (gnbDevices.Get (i));
+      NS_ABORT_MSG_IF (gnb == nullptr, "The device " << i << " is not a gNB");
+
+      uint32_t index = 0;
+      Vector pos;
+      uint32_t numBwps = 0;
+      ReadKeyword (is, "gnb", fileName);
+      is >> index >> pos.x >> pos.y >> pos.z >> numBwps;
+      NS_ABORT_MSG_IF (!is || index != i, "Wrong gNB " << i << " in " << fileName);
+      NS_ABORT_MSG_IF (numBwps != gnb->GetCcMapSize (),
+                       "The gNB " << i << " has " << gnb->GetCcMapSize () << " BWPs, "
+                       << numBwps << " in " << fileName);
+
+      for (uint32_t bwp = 0; bwp < numBwps; ++bwp)
+        {
+          uint32_t bwpIndex = 0;
+          uint16_t numerology = 0;
+          double centralFrequency = 0.0;
+          uint32_t bandwidth = 0;
+          ReadKeyword (is, "bwp", fileName);
+          is >> bwpIndex >> numerology >> centralFrequency >> bandwidth;
+          NS_ABORT_MSG_IF (!is || bwpIndex != bwp, "Wrong BWP " << bwp << " of the gNB " << i
+                           << " in " << fileName);
+
+          Ptr<NrGnbPhy> phy = gnb->GetPhy (bwp);
+          NS_ABORT_MSG_IF (numerology != phy->GetNumerology ()
+                           || centralFrequency != phy->GetCentralFrequency ()
+                           || bandwidth != phy->GetChannelBandwidth (),
+                           "The BWP " << bwp << " of the gNB " << i << " is not the one of " << fileName);
+        }
+
+      GetMobility (gnb)->SetPosition (pos);
+    }
+
+  uint32_t numUes = 0;
+  ReadKeyword (is, "ues", fileName);
+  is >> numUes;
+  NS_ABORT_MSG_IF (numUes != ueDevices.GetN (),
+                   fileName << " has " << numUes << " UEs, the scenario " << ueDevices.GetN ());
+  std::vector<int64_t> servingGnb (numUes, -1);
+  for (uint32_t i = 0; i < numUes; ++i)
+    {
+      Ptr<NrUeNetDevice> ue = DynamicCast<NrUeNetDevice> (ueDevices.Get (i));
+      NS_ABORT_MSG_IF (ue == nullptr, "The device " << i << " is not a UE");
+      NS_ABORT_MSG_IF (ue->GetTargetEnb () != nullptr, "The UE " << i << " is already attached");
+
+      uint32_t index = 0;
+      Vector pos;
+      ReadKeyword (is, "ue", fileName);
+      is >> index >> pos.x >> pos.y >> pos.z >> servingGnb[i];
+      NS_ABORT_MSG_IF (!is || index != i, "Wrong UE " << i << " in " << fileName);
+      NS_ABORT_MSG_IF (servingGnb[i] >= static_cast<int64_t> (numGnbs),
+                       "The UE " << i << " is attached to the unknown gNB " << servingGnb[i]);
+
+      GetMobility (ue)->SetPosition (pos);
+    }
+
+  // All the nodes are in place before the attachment runs the beamforming
+  for (uint32_t i = 0; i < numUes; ++i)
+    {
+      if (servingGnb[i] >= 0)
+        {
+          nrHelper->AttachToEnb (ueDevices.Get (i), gnbDevices.Get (servingGnb[i]));
+        }
+    }
+
+  std::string word;
+  while (is >> word)
+    {
+      NS_ABORT_MSG_IF (word != "beam", "Expected \"beam\" in " << fileName << ", got \"" << word << "\"");
+
+      uint32_t ueIndex = 0;
+      uint32_t bwp = 0;
+      uint32_t stream = 0;
+      std::string side;
+      uint16_t sector = 0;
+      double elevation = 0.0;
+      size_t size = 0;
+      is >> ueIndex >> bwp >> stream >> side >> sector >> elevation >> size;
+      NS_ABORT_MSG_IF (!is || ueIndex >= numUes || servingGnb[ueIndex] < 0,
+                       "Wrong beam of the UE " << ueIndex << " in " << fileName);
+
+      complexVector_t vector (size);
+      for (auto &weight : vector)
+        {
+          double re = 0.0;
+          double im = 0.0;
+          is >> re >> im;
+          weight = std::complex<double> (re, im);
+        }
+      NS_ABORT_MSG_IF (!is, "Wrong beam of the UE " << ueIndex << " in " << fileName);
+
+      Ptr<NetDevice> ue = ueDevices.Get (ueIndex);
+      Ptr<NetDevice> gnb = gnbDevices.Get (servingGnb[ueIndex]);
+      Ptr<BeamManager> beamManager;
+      Ptr<NetDevice> peer;
+      if (side == "gnb")
+        {
+          beamManager = DynamicCast<NrGnbNetDevice> (gnb)->GetPhy (bwp)->GetSpectrumPhy (stream)->GetBeamManager ();
+          peer = ue;
+        }
+      else
+        {
+          NS_ABORT_MSG_IF (side != "ue", "Wrong side " << side << " of a beam in " << fileName);
+          beamManager = DynamicCast<NrUeNetDevice> (ue)->GetPhy (bwp)->GetSpectrumPhy (stream)->GetBeamManager ();
+          peer = gnb;
+        }
+      beamManager->SaveBeamformingVector (BeamformingVector (vector, BeamId (sector, elevation)), peer);
+    }
+}
+
+} // namespace ns3
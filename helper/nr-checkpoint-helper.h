@@ -0,0 +1,89 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef NR_CHECKPOINT_HELPER_H
+#define NR_CHECKPOINT_HELPER_H
+
+#include <ns3/ptr.h>
+#include <string>
+
+namespace ns3 {
+
+class NetDeviceContainer;
+class NrHelper;
+
+/**
+ * \ingroup helper
+ * \brief Save and restore the deployment of an NR scenario
+ *
+ * A checkpoint is a text file with:
+ * - the position of each gNB and UE node;
+ * - the BWPs of each gNB (numerology, central frequency and bandwidth), to
+ *   check that the restored scenario has the same configuration;
+ * - the gNB to which each UE is attached;
+ * - the beamforming vectors that the gNB and the UE saved for each other,
+ *   in each BWP and stream, if asked.
+ *
+ * Restore works on the devices of a scenario built in the same way as
+ * the saved one (same number of devices, in the same order, with the same
+ * BWPs), and that is not attached yet: it moves the nodes, attaches the
+ * UEs with NrHelper::AttachToEnb, and then overwrites the vectors
+ * computed by the beamforming helper with the saved ones.
+ *
+ * Only the deployment is saved: the RRC, the schedulers, the HARQ
+ * processes and the events of the simulator start from scratch. The
+ * saved vectors are the right ones for the channel realizations of the
+ * saved run, that is with the same seed and run number.
+ *
+ * \code
+ *   // First run: attach, then save
+ *   nrHelper->AttachToClosestEnb (ueDevices, gnbDevices);
+ *   NrCheckpointHelper::Save ("deployment.txt", gnbDevices, ueDevices, true);
+ *
+ *   // Later runs: restore instead of attaching
+ *   NrCheckpointHelper::Restore ("deployment.txt", nrHelper, gnbDevices, ueDevices);
+ * \endcode
+ */
+class NrCheckpointHelper
+{
+public:
+  /**
+   * \brief Save the deployment of a scenario
+   * \param fileName the file
+   * \param gnbDevices the gNB devices
+   * \param ueDevices the UE devices
+   * \param saveBeams save the beamforming vectors too
+   */
+  static void Save (const std::string &fileName, const NetDeviceContainer &gnbDevices,
+                    const NetDeviceContainer &ueDevices, bool saveBeams);
+
+  /**
+   * \brief Restore a saved deployment
+   * \param fileName the file written by Save
+   * \param nrHelper the helper that installed the devices, used to attach the UEs
+   * \param gnbDevices the gNB devices, installed as the saved ones
+   * \param ueDevices the UE devices, installed as the saved ones and not attached
+   */
+  static void Restore (const std::string &fileName, const Ptr<NrHelper> &nrHelper,
+                       const NetDeviceContainer &gnbDevices, const NetDeviceContainer &ueDevices);
+};
+
+} // namespace ns3
+
+#endif /* NR_CHECKPOINT_HELPER_H */
@@ -0,0 +1,265 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-distributed-helper.h"
+#include "nr-helper.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/simulator.h>
+#include <ns3/mpi-interface.h>
+#include <ns3/nr-gnb-phy.h>
+#include <ns3/nr-load-model-net-device.h>
+#include <ns3/nr-load-model-phy.h>
+#include <mpi.h>
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrDistributedHelper");
+
+NrDistributedHelper::NrDistributedHelper ()
+{
+  if (MpiInterface::IsEnabled ())
+    {
+      m_rank = MpiInterface::GetSystemId ();
+      m_numRanks = MpiInterface::GetSize ();
+    }
+}
+
+uint32_t
+NrDistributedHelper::GetRank () const
+{
+  return m_rank;
+}
+
+uint32_t
+NrDistributedHelper::GetNumRanks () const
+{
+  return m_numRanks;
+}
+
+void
+NrDistributedHelper::Partition (const std::vector<Vector> &positions)
+{
+  NS_LOG_FUNCTION (this << positions.size ());
+  NS_ABORT_MSG_IF (positions.size () < m_numRanks,
+                   "Only " << positions.size () << " sites for " << m_numRanks << " ranks");
+  m_siteRanks = Partition (positions, m_numRanks);
+  m_sites.clear ();
+  m_sites.resize (positions.size ());
+}
+
+std::vector<uint32_t>
+NrDistributedHelper::Partition (const std::vector<Vector> &positions, uint32_t numClusters)
+{
+  NS_ABORT_MSG_IF (numClusters == 0, "No cluster");
+  std::vector<uint32_t> clusters (positions.size (), 0);
+  std::vector<uint32_t> sites (positions.size ());
+  std::iota (sites.begin (), sites.end (), 0);
+
+  // Split the sites [begin, end) in the clusters [first, first + count)
+  std::function<void (size_t, size_t, uint32_t, uint32_t)> split =
+    [&] (size_t begin, size_t end, uint32_t first, uint32_t count)
+    {
+      if (count == 1 || end - begin <= 1)
+        {
+          for (size_t i = begin; i < end; ++i)
+            {
+              clusters[sites[i]] = first;
+            }
+          return;
+        }
+
+      double xMin = positions[sites[begin]].x;
+      double xMax = xMin;
+      double yMin = positions[sites[begin]].y;
+      double yMax = yMin;
+      for (size_t i = begin; i < end; ++i)
+        {
+          xMin = std::min (xMin, positions[sites[i]].x);
+          xMax = std::max (xMax, positions[sites[i]].x);
+          yMin = std::min (yMin, positions[sites[i]].y);
+          yMax = std::max (yMax, positions[sites[i]].y);
+        }
+      bool alongX = xMax - xMin >= yMax - yMin;
+      std::stable_sort (sites.begin () + begin, sites.begin () + end,
+                        [&positions, alongX] (uint32_t a, uint32_t b)
+                        {
+                          return alongX ? positions[a].x < positions[b].x : positions[a].y < positions[b].y;
+                        });
+
+      uint32_t lowCount = count / 2;
+      size_t middle = begin + (end - begin) * lowCount / count;
+      split (begin, middle, first, lowCount);
+      split (middle, end, first + lowCount, count - lowCount);
+    };
+  split (0, sites.size (), 0, numClusters);
+  return clusters;
+}
+
+uint32_t
+NrDistributedHelper::GetSiteRank (uint32_t site) const
+{
+  NS_ABORT_MSG_IF (site >= m_siteRanks.size (), "Unknown site " << site << ", call Partition first");
+  return m_siteRanks[site];
+}
+
+bool
+NrDistributedHelper::IsLocal (uint32_t site) const
+{
+  return GetSiteRank (site) == m_rank;
+}
+
+void
+NrDistributedHelper::AddLocalSite (uint32_t site, const NetDeviceContainer &gnbDevices)
+{
+  NS_LOG_FUNCTION (this << site);
+  NS_ABORT_MSG_IF (!IsLocal (site), "The site " << site << " is simulated by the rank " << GetSiteRank (site));
+  m_sites[site].m_added = true;
+  m_sites[site].m_devices = gnbDevices;
+}
+
+void
+NrDistributedHelper::AddRemoteSite (uint32_t site, const NetDeviceContainer &loadDevices)
+{
+  NS_LOG_FUNCTION (this << site);
+  NS_ABORT_MSG_IF (IsLocal (site), "The site " << site << " is simulated by this rank");
+  m_sites[site].m_added = true;
+  m_sites[site].m_devices = loadDevices;
+}
+
+void
+NrDistributedHelper::Start (Time stopTime)
+{
+  NS_LOG_FUNCTION (this << stopTime);
+
+  // One entry per BWP of each sector, in the order of the sites: the same
+  // on all the ranks, whether the sector is local or not
+  m_loads.clear ();
+  m_remotePhys.clear ();
+  for (uint32_t site = 0; site < m_sites.size (); ++site)
+    {
+      NS_ABORT_MSG_IF (!m_sites[site].m_added, "The site " << site << " was not added");
+      for (auto it = m_sites[site].m_devices.Begin (); it != m_sites[site].m_devices.End (); ++it)
+        {
+          if (IsLocal (site))
+            {
+              for (uint32_t bwp = 0; bwp < NrHelper::GetNumberBwp (*it); ++bwp)
+                {
+                  Ptr<NrGnbPhy> phy = NrHelper::GetGnbPhy (*it, bwp);
+                  if (m_slotPeriod.IsZero ())
+                    {
+                      m_slotPeriod = phy->GetSlotPeriod ();
+                    }
+                  uint32_t entry = static_cast<uint32_t> (m_loads.size ());
+                  phy->TraceConnectWithoutContext ("SlotDataStats",
+                                                   MakeBoundCallback (&NrDistributedHelper::SlotDataStats, this, entry));
+                  m_loads.push_back (0.0);
+                  m_remotePhys.push_back (nullptr);
+                }
+            }
+          else
+            {
+              Ptr<NrLoadModelNetDevice> device = DynamicCast<NrLoadModelNetDevice> (*it);
+              NS_ABORT_MSG_IF (device == nullptr, "The sectors of the site " << site << " are not NrLoadModelNetDevice");
+              for (uint32_t bwp = 0; bwp < device->GetNumPhys (); ++bwp)
+                {
+                  m_loads.push_back (0.0);
+                  m_remotePhys.push_back (device->GetPhy (static_cast<uint8_t> (bwp)));
+                }
+            }
+        }
+    }
+  NS_ABORT_MSG_IF (m_slotPeriod.IsZero (), "No local gNB");
+
+  // a different layout would mix up the loads of the sectors
+  if (m_numRanks > 1)
+    {
+      unsigned long numEntries = m_loads.size ();
+      unsigned long minEntries = 0;
+      unsigned long maxEntries = 0;
+      MPI_Allreduce (&numEntries, &minEntries, 1, MPI_UNSIGNED_LONG, MPI_MIN, MpiInterface::GetCommunicator ());
+      MPI_Allreduce (&numEntries, &maxEntries, 1, MPI_UNSIGNED_LONG, MPI_MAX, MpiInterface::GetCommunicator ());
+      NS_ABORT_MSG_IF (minEntries != maxEntries,
+                       "The ranks have different sectors or BWPs: " << minEntries << " to " << maxEntries << " entries");
+    }
+
+  m_stopTime = stopTime;
+  if (m_slotPeriod < m_stopTime)
+    {
+      Simulator::Schedule (m_slotPeriod, &NrDistributedHelper::Exchange, this);
+    }
+}
+
+uint64_t
+NrDistributedHelper::GetNumExchanges () const
+{
+  return m_numExchanges;
+}
+
+void
+NrDistributedHelper::SlotDataStats (NrDistributedHelper *helper, uint32_t entry,
+                                    [[maybe_unused]] const SfnSf &sfnSf,
+                                    [[maybe_unused]] uint32_t scheduledUe, uint32_t usedReg,
+                                    [[maybe_unused]] uint32_t usedSym, uint32_t availableRb,
+                                    uint32_t availableSym, [[maybe_unused]] uint16_t bwpId,
+                                    [[maybe_unused]] uint16_t cellId)
+{
+  uint32_t availableReg = availableRb * availableSym;
+  helper->m_loads[entry] = availableReg == 0 ? 0.0 : std::min (1.0, static_cast<double> (usedReg) / availableReg);
+}
+
+void
+NrDistributedHelper::Exchange ()
+{
+  NS_LOG_FUNCTION (this);
+
+  // Each rank gives the loads of its sectors, and zero for the others
+  if (m_numRanks > 1)
+    {
+      std::vector<double> local (m_loads.size (), 0.0);
+      for (size_t i = 0; i < m_loads.size (); ++i)
+        {
+          if (m_remotePhys[i] == nullptr)
+            {
+              local[i] = m_loads[i];
+            }
+        }
+      MPI_Allreduce (local.data (), m_loads.data (), static_cast<int> (m_loads.size ()), MPI_DOUBLE, MPI_SUM,
+                     MpiInterface::GetCommunicator ());
+    }
+  for (size_t i = 0; i < m_loads.size (); ++i)
+    {
+      if (m_remotePhys[i] != nullptr)
+        {
+          m_remotePhys[i]->SetLoadFactor (m_loads[i]);
+        }
+    }
+  ++m_numExchanges;
+
+  // the ranks stop exchanging at the same slot
+  if (Simulator::Now () + m_slotPeriod < m_stopTime)
+    {
+      Simulator::Schedule (m_slotPeriod, &NrDistributedHelper::Exchange, this);
+    }
+}
+
+} // namespace ns3
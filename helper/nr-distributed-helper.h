@@ -0,0 +1,206 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_DISTRIBUTED_HELPER_H
+#define NR_DISTRIBUTED_HELPER_H
+
+#include <ns3/net-device-container.h>
+#include <ns3/nstime.h>
+#include <ns3/ptr.h>
+#include <ns3/vector.h>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+class SfnSf;
+class NrLoadModelPhy;
+
+/**
+ * \ingroup helper
+ * \brief Run a multi-site NR scenario on several MPI ranks, each one
+ * simulating a cluster of sites
+ *
+ * The sites are partitioned over the ranks by Partition, in clusters of
+ * neighbouring sites. Every rank runs the same script: it installs the full
+ * gNBs (and their UEs) of the sites of its cluster, and an interference-only
+ * NrLoadModelNetDevice for each sector of the other sites, with the same
+ * BWPs. At the end of every slot, the ranks exchange the load of the last
+ * slot of each of their sectors (the fraction of the resource elements of
+ * the slot used for data, from the SlotDataStats trace of NrGnbPhy), and
+ * each rank sets it as the load factor of the load-model sectors that stand
+ * for the other ranks. The interference of the other clusters is then the
+ * one of their actual load, one slot late: the slot is the lookahead of
+ * the exchange.
+ *
+ * The ranks do not share any channel nor packet: the default simulator is
+ * used on each of them, and the exchange, a collective MPI operation, keeps
+ * them in step. Only the DL interference between the clusters is modelled;
+ * the UEs must attach to the gNBs of their own cluster.
+ *
+ * \code
+ *   MpiInterface::Enable (&argc, &argv);
+ *   NrDistributedHelper distributed;
+ *   distributed.Partition (sitePositions);
+ *   for (uint32_t site = 0; site < sitePositions.size (); ++site)
+ *     {
+ *       if (distributed.IsLocal (site))
+ *         {
+ *           distributed.AddLocalSite (site, nrHelper->InstallGnbDevice (siteNodes[site], allBwps));
+ *         }
+ *       else
+ *         {
+ *           distributed.AddRemoteSite (site, nrHelper->InstallLoadModelDevice (siteNodes[site], allBwps));
+ *         }
+ *     }
+ *   distributed.Start (simTime);
+ *   Simulator::Stop (simTime);
+ *   Simulator::Run ();
+ * \endcode
+ *
+ * It is only built when ns-3 is configured with MPI.
+ */
+class NrDistributedHelper
+{
+public:
+  /**
+   * \brief Create the helper for the ranks of MpiInterface, or a single
+   * rank when MPI is not enabled
+   */
+  NrDistributedHelper ();
+
+  /**
+   * \return the rank of this process
+   */
+  uint32_t GetRank () const;
+
+  /**
+   * \return the number of ranks
+   */
+  uint32_t GetNumRanks () const;
+
+  /**
+   * \brief Split the sites in clusters of neighbouring sites, one per rank
+   *
+   * The clusters are made by recursive coordinate bisection: the sites are
+   * split along the longest side of their bounding box, in proportion to
+   * the number of ranks of each half. The clusters have about the same
+   * number of sites, and do not depend on the rank.
+   *
+   * \param positions the position of each site
+   */
+  void Partition (const std::vector<Vector> &positions);
+
+  /**
+   * \brief Split the sites in clusters of neighbouring sites
+   * \param positions the position of each site
+   * \param numClusters the number of clusters
+   * \return the cluster of each site
+   */
+  static std::vector<uint32_t> Partition (const std::vector<Vector> &positions, uint32_t numClusters);
+
+  /**
+   * \param site the index of the site
+   * \return the rank that simulates the site
+   */
+  uint32_t GetSiteRank (uint32_t site) const;
+
+  /**
+   * \param site the index of the site
+   * \return true if the site is simulated by this rank
+   */
+  bool IsLocal (uint32_t site) const;
+
+  /**
+   * \brief Set the gNBs of a site of this rank
+   * \param site the index of the site
+   * \param gnbDevices the NrGnbNetDevice of each sector of the site
+   */
+  void AddLocalSite (uint32_t site, const NetDeviceContainer &gnbDevices);
+
+  /**
+   * \brief Set the interference-only gNBs of a site of another rank
+   * \param site the index of the site
+   * \param loadDevices the NrLoadModelNetDevice of each sector of the site,
+   * in the order of the gNBs of the rank of the site
+   */
+  void AddRemoteSite (uint32_t site, const NetDeviceContainer &loadDevices);
+
+  /**
+   * \brief Schedule the exchanges of the loads, at the end of each slot
+   * before stopTime
+   *
+   * All the sites must be added. The ranks must call it with the same
+   * stopTime, and use the same numerology.
+   *
+   * \param stopTime the time at which the simulation stops
+   */
+  void Start (Time stopTime);
+
+  /**
+   * \return the number of exchanges done
+   */
+  uint64_t GetNumExchanges () const;
+
+private:
+  /**
+   * \brief Store the load of a slot of a local sector
+   * \param helper the helper
+   * \param entry the index of the sector in the exchanged loads
+   * \param sfnSf the slot
+   * \param scheduledUe the number of scheduled UEs
+   * \param usedReg the number of used resource elements (1 RB x 1 symbol)
+   * \param usedSym the number of used symbols
+   * \param availableRb the number of RBs
+   * \param availableSym the number of symbols available for data
+   * \param bwpId the BWP
+   * \param cellId the cell
+   */
+  static void SlotDataStats (NrDistributedHelper *helper, uint32_t entry, const SfnSf &sfnSf,
+                             uint32_t scheduledUe, uint32_t usedReg, uint32_t usedSym, uint32_t availableRb, uint32_t availableSym,
+                             uint16_t bwpId, uint16_t cellId);
+
+  /**
+   * \brief Exchange the loads of the last slot with the other ranks, and
+   * schedule the next exchange
+   */
+  void Exchange ();
+
+  /**
+   * \brief The sectors of a site
+   */
+  struct Site
+  {
+    bool m_added {false};                       //!< True once the site is added
+    NetDeviceContainer m_devices;               //!< The gNBs, or the load-model gNBs
+  };
+
+  uint32_t m_rank {0};                          //!< The rank of this process
+  uint32_t m_numRanks {1};                      //!< The number of ranks
+  std::vector<uint32_t> m_siteRanks;            //!< The rank of each site
+  std::vector<Site> m_sites;                    //!< The sectors of each site
+  std::vector<double> m_loads;                  //!< The load of each BWP of each sector, in the order of the sites
+  std::vector<Ptr<NrLoadModelPhy>> m_remotePhys; //!< The load-model PHY of each entry, null for the local ones
+  Time m_slotPeriod;                            //!< The period of the exchanges
+  Time m_stopTime;                              //!< No exchange from this time
+  uint64_t m_numExchanges {0};                  //!< The number of exchanges done
+};
+
+} // namespace ns3
+
+#endif // NR_DISTRIBUTED_HELPER_H
@@ -0,0 +1,331 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-equivalence-checker.h"
+
+#include <ns3/log.h>
+#include <ns3/config.h>
+#include <ns3/rng-seed-manager.h>
+#include <ns3/simulator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <tuple>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrEquivalenceChecker");
+
+NS_OBJECT_ENSURE_REGISTERED (NrRunRecorder);
+
+bool
+NrRunRecorder::PhyEntry::operator== (const PhyEntry &o) const
+{
+  return m_time == o.m_time && m_isUl == o.m_isUl && m_cellId == o.m_cellId
+         && m_bwpId == o.m_bwpId && m_rnti == o.m_rnti && m_streamId == o.m_streamId
+         && m_symStart == o.m_symStart && m_numSym == o.m_numSym && m_tbSize == o.m_tbSize
+         && m_mcs == o.m_mcs && m_rv == o.m_rv && m_sinr == o.m_sinr && m_tbler == o.m_tbler
+         && m_corrupt == o.m_corrupt;
+}
+
+bool
+NrRunRecorder::PhyEntry::operator< (const PhyEntry &o) const
+{
+  return std::tie (m_time, m_isUl, m_cellId, m_bwpId, m_rnti, m_streamId, m_symStart)
+         < std::tie (o.m_time, o.m_isUl, o.m_cellId, o.m_bwpId, o.m_rnti, o.m_streamId, o.m_symStart);
+}
+
+bool
+NrRunRecorder::MacEntry::operator== (const MacEntry &o) const
+{
+  return m_time == o.m_time && m_isUl == o.m_isUl && m_context == o.m_context
+         && m_info.m_frameNum == o.m_info.m_frameNum && m_info.m_subframeNum == o.m_info.m_subframeNum
+         && m_info.m_slotNum == o.m_info.m_slotNum && m_info.m_symStart == o.m_info.m_symStart
+         && m_info.m_numSym == o.m_info.m_numSym && m_info.m_streamId == o.m_info.m_streamId
+         && m_info.m_rnti == o.m_info.m_rnti && m_info.m_mcs == o.m_info.m_mcs
+         && m_info.m_tbSize == o.m_info.m_tbSize && m_info.m_bwpId == o.m_info.m_bwpId
+         && m_info.m_ndi == o.m_info.m_ndi && m_info.m_rv == o.m_info.m_rv
+         && m_info.m_harqId == o.m_info.m_harqId && m_info.m_numRbg == o.m_info.m_numRbg;
+}
+
+bool
+NrRunRecorder::MacEntry::operator< (const MacEntry &o) const
+{
+  return std::tie (m_time, m_isUl, m_context, m_info.m_rnti, m_info.m_streamId, m_info.m_symStart)
+         < std::tie (o.m_time, o.m_isUl, o.m_context, o.m_info.m_rnti, o.m_info.m_streamId,
+                     o.m_info.m_symStart);
+}
+
+NrRunRecorder::NrRunRecorder ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrRunRecorder::~NrRunRecorder ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+NrRunRecorder::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrRunRecorder")
+    .SetParent<Object> ()
+    .SetGroupName ("nr")
+    .AddConstructor<NrRunRecorder> ()
+  ;
+  return tid;
+}
+
+void
+NrRunRecorder::Connect ()
+{
+  NS_LOG_FUNCTION (this);
+  Config::ConnectFailSafe ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUePhy/NrSpectrumPhyList/*/RxPacketTraceUe",
+                           MakeBoundCallback (&NrRunRecorder::RxPacketTraceUe, Ptr<NrRunRecorder> (this)));
+  Config::ConnectFailSafe ("/NodeList/*/DeviceList/*/BandwidthPartMap/*/NrGnbPhy/NrSpectrumPhyList/*/RxPacketTraceEnb",
+                           MakeBoundCallback (&NrRunRecorder::RxPacketTraceEnb, Ptr<NrRunRecorder> (this)));
+  Config::ConnectFailSafe ("/NodeList/*/DeviceList/*/BandwidthPartMap/*/NrGnbMac/DlScheduling",
+                           MakeBoundCallback (&NrRunRecorder::DlScheduling, Ptr<NrRunRecorder> (this)));
+  Config::ConnectFailSafe ("/NodeList/*/DeviceList/*/BandwidthPartMap/*/NrGnbMac/UlScheduling",
+                           MakeBoundCallback (&NrRunRecorder::UlScheduling, Ptr<NrRunRecorder> (this)));
+}
+
+void
+NrRunRecorder::Sort ()
+{
+  std::stable_sort (m_phy.begin (), m_phy.end ());
+  std::stable_sort (m_mac.begin (), m_mac.end ());
+}
+
+const std::vector<NrRunRecorder::PhyEntry> &
+NrRunRecorder::GetPhyEntries () const
+{
+  return m_phy;
+}
+
+const std::vector<NrRunRecorder::MacEntry> &
+NrRunRecorder::GetMacEntries () const
+{
+  return m_mac;
+}
+
+void
+NrRunRecorder::AddPhy (bool isUl, const RxPacketTraceParams &params)
+{
+  PhyEntry entry;
+  entry.m_time = Simulator::Now ().GetTimeStep ();
+  entry.m_isUl = isUl;
+  entry.m_cellId = static_cast<uint16_t> (params.m_cellId);
+  entry.m_bwpId = params.m_bwpId;
+  entry.m_rnti = params.m_rnti;
+  entry.m_streamId = params.m_streamId;
+  entry.m_symStart = params.m_symStart;
+  entry.m_numSym = params.m_numSym;
+  entry.m_tbSize = params.m_tbSize;
+  entry.m_mcs = params.m_mcs;
+  entry.m_rv = params.m_rv;
+  entry.m_sinr = params.m_sinr;
+  entry.m_tbler = params.m_tbler;
+  entry.m_corrupt = params.m_corrupt;
+  m_phy.push_back (entry);
+}
+
+void
+NrRunRecorder::RxPacketTraceUe (Ptr<NrRunRecorder> recorder, [[maybe_unused]] std::string context,
+                                RxPacketTraceParams params)
+{
+  recorder->AddPhy (false, params);
+}
+
+void
+NrRunRecorder::RxPacketTraceEnb (Ptr<NrRunRecorder> recorder, [[maybe_unused]] std::string context,
+                                 RxPacketTraceParams params)
+{
+  recorder->AddPhy (true, params);
+}
+
+void
+NrRunRecorder::DlScheduling (Ptr<NrRunRecorder> recorder, std::string context,
+                             NrSchedulingCallbackInfo info)
+{
+  recorder->m_mac.push_back ({Simulator::Now ().GetTimeStep (), false, context, info});
+}
+
+void
+NrRunRecorder::UlScheduling (Ptr<NrRunRecorder> recorder, std::string context,
+                             NrSchedulingCallbackInfo info)
+{
+  recorder->m_mac.push_back ({Simulator::Now ().GetTimeStep (), true, context, info});
+}
+
+void
+NrEquivalenceChecker::SetScenario (const std::function<void ()> &scenario)
+{
+  m_scenario = scenario;
+}
+
+void
+NrEquivalenceChecker::SetTolerance (double tolerance)
+{
+  NS_ABORT_MSG_IF (tolerance < 0, "The tolerance can't be negative");
+  m_tolerance = tolerance;
+}
+
+Ptr<NrRunRecorder>
+NrEquivalenceChecker::RunMode (const std::function<void ()> &mode) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (!m_scenario, "No scenario to run");
+  // The random variables that get no explicit stream take the same
+  // automatic streams in every run, as long as they are created in the same order
+  Config::Reset ();
+  RngSeedManager::ResetNextStreamIndex ();
+  mode ();
+  m_scenario ();
+  Ptr<NrRunRecorder> record = CreateObject<NrRunRecorder> ();
+  record->Connect ();
+  Simulator::Run ();
+  Simulator::Destroy ();
+  record->Sort ();
+  return record;
+}
+
+NrEquivalenceChecker::Result
+NrEquivalenceChecker::Run (const std::function<void ()> &baseline,
+                           const std::function<void ()> &alternative) const
+{
+  NS_LOG_FUNCTION (this);
+  Ptr<NrRunRecorder> baselineRecord = RunMode (baseline);
+  Ptr<NrRunRecorder> alternativeRecord = RunMode (alternative);
+  Config::Reset ();
+  return Compare (baselineRecord, alternativeRecord, m_tolerance);
+}
+
+NrEquivalenceChecker::Kpis
+NrEquivalenceChecker::GetKpis (const Ptr<const NrRunRecorder> &record)
+{
+  Kpis kpis {};
+  std::array<double, 2> sinrSum {};
+  std::array<double, 2> corrupt {};
+  for (const NrRunRecorder::PhyEntry &entry : record->GetPhyEntries ())
+    {
+      auto &k = kpis[entry.m_isUl ? 1 : 0];
+      k[TBS] += 1;
+      k[MEAN_MCS] += entry.m_mcs;
+      sinrSum[entry.m_isUl ? 1 : 0] += entry.m_sinr;
+      if (entry.m_corrupt)
+        {
+          corrupt[entry.m_isUl ? 1 : 0] += 1;
+        }
+      else
+        {
+          k[GOODPUT] += entry.m_tbSize;
+        }
+    }
+  for (const NrRunRecorder::MacEntry &entry : record->GetMacEntries ())
+    {
+      kpis[entry.m_isUl ? 1 : 0][ALLOCATED_BYTES] += entry.m_info.m_tbSize;
+    }
+  for (uint32_t dir = 0; dir < 2; ++dir)
+    {
+      auto &k = kpis[dir];
+      if (k[TBS] > 0)
+        {
+          k[TBLER] = corrupt[dir] / k[TBS];
+          k[MEAN_MCS] /= k[TBS];
+          k[MEAN_SINR_DB] = 10 * std::log10 (sinrSum[dir] / k[TBS]);
+        }
+    }
+  return kpis;
+}
+
+std::string
+NrEquivalenceChecker::GetKpiName (Kpi kpi)
+{
+  static const char *names[NUM_KPIS] = {"TBs", "TBLER", "goodputBytes", "meanSinrDb",
+                                        "meanMcs", "allocatedBytes"};
+  return names[kpi];
+}
+
+NrEquivalenceChecker::Result
+NrEquivalenceChecker::Compare (const Ptr<const NrRunRecorder> &baseline,
+                               const Ptr<const NrRunRecorder> &alternative, double tolerance)
+{
+  Result result;
+  std::ostringstream report;
+
+  const auto &phyA = baseline->GetPhyEntries ();
+  const auto &phyB = alternative->GetPhyEntries ();
+  const auto &macA = baseline->GetMacEntries ();
+  const auto &macB = alternative->GetMacEntries ();
+  auto phyDiff = std::mismatch (phyA.begin (), phyA.end (), phyB.begin (), phyB.end ());
+  auto macDiff = std::mismatch (macA.begin (), macA.end (), macB.begin (), macB.end ());
+  result.m_identical = phyDiff.first == phyA.end () && phyDiff.second == phyB.end ()
+                       && macDiff.first == macA.end () && macDiff.second == macB.end ();
+
+  if (phyDiff.first != phyA.end () || phyDiff.second != phyB.end ())
+    {
+      report << "RxPacketTrace differs at entry " << std::distance (phyA.begin (), phyDiff.first)
+             << " of " << phyA.size () << " and " << phyB.size ();
+      const auto &e = phyDiff.first != phyA.end () ? *phyDiff.first : *phyDiff.second;
+      report << " (time " << TimeStep (e.m_time).GetSeconds () << " s, cell " << e.m_cellId
+             << ", RNTI " << e.m_rnti << ", " << (e.m_isUl ? "UL" : "DL") << ")\n";
+    }
+  if (macDiff.first != macA.end () || macDiff.second != macB.end ())
+    {
+      report << "MAC scheduling differs at entry " << std::distance (macA.begin (), macDiff.first)
+             << " of " << macA.size () << " and " << macB.size ();
+      const auto &e = macDiff.first != macA.end () ? *macDiff.first : *macDiff.second;
+      report << " (time " << TimeStep (e.m_time).GetSeconds () << " s, RNTI " << e.m_info.m_rnti
+             << ", " << (e.m_isUl ? "UL" : "DL") << ", " << e.m_context << ")\n";
+    }
+
+  result.m_baseline = GetKpis (baseline);
+  result.m_alternative = GetKpis (alternative);
+  result.m_withinTolerance = true;
+  for (uint32_t dir = 0; dir < 2; ++dir)
+    {
+      for (uint32_t kpi = 0; kpi < NUM_KPIS; ++kpi)
+        {
+          double a = result.m_baseline[dir][kpi];
+          double b = result.m_alternative[dir][kpi];
+          double diff = std::abs (a - b);
+          if (kpi != TBLER && kpi != MEAN_SINR_DB)
+            {
+              diff /= std::max (std::abs (a), 1e-12);
+            }
+          if (kpi == MEAN_SINR_DB)
+            {
+              // A relative tolerance on a dB value has no meaning: compare the linear values
+              diff = std::abs (std::pow (10.0, (b - a) / 10) - 1);
+            }
+          if (diff > tolerance)
+            {
+              result.m_withinTolerance = false;
+              report << (dir == 0 ? "DL " : "UL ") << GetKpiName (static_cast<Kpi> (kpi))
+                     << ": " << a << " vs " << b << "\n";
+            }
+        }
+    }
+  result.m_report = report.str ();
+  return result;
+}
+
+} // namespace ns3
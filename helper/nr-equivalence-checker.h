@@ -0,0 +1,290 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_EQUIVALENCE_CHECKER_H
+#define NR_EQUIVALENCE_CHECKER_H
+
+#include <ns3/object.h>
+#include <ns3/nr-phy-mac-common.h>
+
+#include <array>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup helper
+ * \brief Records the RxPacketTrace and the MAC scheduling traces of a run
+ *
+ * Connect connects the RxPacketTraceUe, RxPacketTraceEnb, DlScheduling and
+ * UlScheduling traces of all the NR devices installed so far. The records
+ * are kept in memory, and compared by NrEquivalenceChecker.
+ */
+class NrRunRecorder : public Object
+{
+public:
+  /**
+   * \brief A TB received by a PHY
+   */
+  struct PhyEntry
+  {
+    int64_t m_time {0};         //!< Reception time (time steps)
+    bool m_isUl {false};        //!< True if received by a gNB
+    uint16_t m_cellId {0};      //!< Cell ID
+    uint16_t m_bwpId {0};       //!< BWP ID
+    uint16_t m_rnti {0};        //!< RNTI
+    uint8_t m_streamId {0};     //!< Stream
+    uint8_t m_symStart {0};     //!< First symbol
+    uint8_t m_numSym {0};       //!< Number of symbols
+    uint32_t m_tbSize {0};      //!< TB size (bytes)
+    uint8_t m_mcs {0};          //!< MCS
+    uint8_t m_rv {0};           //!< RV
+    double m_sinr {0.0};        //!< Mean SINR (linear)
+    double m_tbler {0.0};       //!< TBLER
+    bool m_corrupt {false};     //!< True if the TB was corrupted
+
+    /**
+     * \param o another entry
+     * \return true if every field is equal
+     */
+    bool operator== (const PhyEntry &o) const;
+    /**
+     * \param o another entry
+     * \return true if the entry is before o in the order of the comparison
+     */
+    bool operator< (const PhyEntry &o) const;
+  };
+
+  /**
+   * \brief An allocation made by a gNB MAC
+   */
+  struct MacEntry
+  {
+    int64_t m_time {0};           //!< Scheduling time (time steps)
+    bool m_isUl {false};          //!< True for the UlScheduling trace
+    std::string m_context;        //!< Context of the trace, which identifies the MAC
+    NrSchedulingCallbackInfo m_info; //!< The allocation
+
+    /**
+     * \param o another entry
+     * \return true if every field is equal
+     */
+    bool operator== (const MacEntry &o) const;
+    /**
+     * \param o another entry
+     * \return true if the entry is before o in the order of the comparison
+     */
+    bool operator< (const MacEntry &o) const;
+  };
+
+  NrRunRecorder ();
+  ~NrRunRecorder () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Connect the traces of all the NR devices installed so far
+   */
+  void Connect ();
+
+  /**
+   * \brief Sort the records, so that two runs that fire the same traces in a
+   * different order within the same time step compare equal
+   */
+  void Sort ();
+
+  /**
+   * \return the TBs received
+   */
+  const std::vector<PhyEntry> & GetPhyEntries () const;
+
+  /**
+   * \return the allocations
+   */
+  const std::vector<MacEntry> & GetMacEntries () const;
+
+private:
+  /**
+   * \brief Trace sink of RxPacketTraceUe
+   * \param recorder the recorder
+   * \param context the context (unused)
+   * \param params the reception
+   */
+  static void RxPacketTraceUe (Ptr<NrRunRecorder> recorder, std::string context,
+                               RxPacketTraceParams params);
+  /**
+   * \brief Trace sink of RxPacketTraceEnb
+   * \param recorder the recorder
+   * \param context the context (unused)
+   * \param params the reception
+   */
+  static void RxPacketTraceEnb (Ptr<NrRunRecorder> recorder, std::string context,
+                                RxPacketTraceParams params);
+  /**
+   * \brief Trace sink of DlScheduling
+   * \param recorder the recorder
+   * \param context the context
+   * \param info the allocation
+   */
+  static void DlScheduling (Ptr<NrRunRecorder> recorder, std::string context,
+                            NrSchedulingCallbackInfo info);
+  /**
+   * \brief Trace sink of UlScheduling
+   * \param recorder the recorder
+   * \param context the context
+   * \param info the allocation
+   */
+  static void UlScheduling (Ptr<NrRunRecorder> recorder, std::string context,
+                            NrSchedulingCallbackInfo info);
+
+  /**
+   * \brief Record a reception
+   * \param isUl true if received by a gNB
+   * \param params the reception
+   */
+  void AddPhy (bool isUl, const RxPacketTraceParams &params);
+
+  std::vector<PhyEntry> m_phy;   //!< The TBs received
+  std::vector<MacEntry> m_mac;   //!< The allocations
+};
+
+/**
+ * \ingroup helper
+ * \brief Runs a scenario in a baseline and in an alternative mode, and
+ * compares their traces
+ *
+ * The modes that are meant to be exact (caches, search strategies,
+ * allocators, parallel execution) must give the same records: the same TBs,
+ * with the same SINR and TBLER to the last bit, and the same allocations.
+ * The modes that are approximations are compared through the KPIs of each
+ * direction, each one within a relative tolerance.
+ *
+ * \code{.cpp}
+ *   NrEquivalenceChecker checker;
+ *   checker.SetScenario (&BuildScenario);   // builds, and calls Simulator::Stop
+ *   NrEquivalenceChecker::Result r = checker.Run ([] () {},
+ *     [] () { Config::SetDefault ("ns3::NrAmc::CqiSearchMode", StringValue ("Binary")); });
+ *   NS_TEST_ASSERT_MSG_EQ (r.m_identical, true, r.m_report);
+ * \endcode
+ *
+ * Every run starts from Config::Reset and
+ * RngSeedManager::ResetNextStreamIndex, so the defaults set by a mode or a
+ * scenario are not seen by the next run, and the random variables created
+ * in the same order get the same streams. A scenario that is run in its own
+ * way (e.g. by the nr-perf benchmark) can use NrRunRecorder and Compare
+ * directly.
+ */
+class NrEquivalenceChecker
+{
+public:
+  /**
+   * \brief The KPIs of a direction
+   */
+  enum Kpi
+  {
+    TBS = 0,          //!< Number of TBs received
+    TBLER,            //!< Ratio of corrupted TBs
+    GOODPUT,          //!< Bytes of the TBs received without error
+    MEAN_SINR_DB,     //!< Mean SINR of the TBs (dB)
+    MEAN_MCS,         //!< Mean MCS of the TBs
+    ALLOCATED_BYTES,  //!< Bytes allocated by the MACs
+    NUM_KPIS
+  };
+
+  /**
+   * \brief The KPIs of a run, DL (0) and UL (1)
+   */
+  typedef std::array<std::array<double, NUM_KPIS>, 2> Kpis;
+
+  /**
+   * \brief The result of a comparison
+   */
+  struct Result
+  {
+    bool m_identical {false};    //!< True if the records are equal
+    bool m_withinTolerance {false}; //!< True if every KPI is within the tolerance
+    Kpis m_baseline {};          //!< KPIs of the baseline run
+    Kpis m_alternative {};       //!< KPIs of the alternative run
+    std::string m_report;        //!< The first difference of the records, and the KPIs out of tolerance
+  };
+
+  /**
+   * \brief Set the scenario: it builds the devices and the traffic, and
+   * calls Simulator::Stop, but not Simulator::Run
+   * \param scenario the scenario
+   */
+  void SetScenario (const std::function<void ()> &scenario);
+
+  /**
+   * \brief Set the relative tolerance of the KPIs (absolute for the TBLER)
+   * \param tolerance the tolerance
+   */
+  void SetTolerance (double tolerance);
+
+  /**
+   * \brief Run the scenario in two modes, and compare the records
+   * \param baseline configures the baseline mode (e.g. Config::SetDefault)
+   * \param alternative configures the alternative mode
+   * \return the result
+   */
+  Result Run (const std::function<void ()> &baseline, const std::function<void ()> &alternative) const;
+
+  /**
+   * \brief Run the scenario in a mode
+   * \param mode configures the mode
+   * \return the records of the run, sorted
+   */
+  Ptr<NrRunRecorder> RunMode (const std::function<void ()> &mode) const;
+
+  /**
+   * \brief Compute the KPIs of a run
+   * \param record the records of the run
+   * \return the KPIs
+   */
+  static Kpis GetKpis (const Ptr<const NrRunRecorder> &record);
+
+  /**
+   * \brief Compare the records of two runs
+   * \param baseline the records of the baseline run, sorted
+   * \param alternative the records of the alternative run, sorted
+   * \param tolerance the relative tolerance of the KPIs (absolute for the TBLER)
+   * \return the result
+   */
+  static Result Compare (const Ptr<const NrRunRecorder> &baseline,
+                         const Ptr<const NrRunRecorder> &alternative, double tolerance);
+
+  /**
+   * \param kpi the KPI
+   * \return the name of the KPI
+   */
+  static std::string GetKpiName (Kpi kpi);
+
+private:
+  std::function<void ()> m_scenario; //!< The scenario
+  double m_tolerance {0.0};          //!< The tolerance of the KPIs
+};
+
+} // namespace ns3
+
+#endif // NR_EQUIVALENCE_CHECKER_H
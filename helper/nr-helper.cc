@@ -23,15 +23,23 @@
 #include <ns3/multi-model-spectrum-channel.h>
 #include <ns3/lte-ue-rrc.h>
 #include <ns3/lte-chunk-processor.h>
+#include <ns3/nr-chunk-processor.h>
 #include <ns3/epc-ue-nas.h>
 #include <ns3/names.h>
+#include <ns3/channel-list.h>
+#include <ns3/node-list.h>
 #include <ns3/nr-rrc-protocol-ideal.h>
 #include <ns3/nr-gnb-mac.h>
 #include <ns3/nr-gnb-phy.h>
+#include <ns3/nr-slot-timing-engine.h>
 #include <ns3/nr-ue-phy.h>
 #include <ns3/nr-ue-mac.h>
 #include <ns3/nr-gnb-net-device.h>
 #include <ns3/nr-ue-net-device.h>
+#include <ns3/nr-load-model-net-device.h>
+#include <ns3/nr-load-model-phy.h>
+#include <ns3/nr-coupling-gain-engine.h>
+#include <ns3/nr-pathloss-map-propagation-loss-model.h>
 #include <ns3/nr-ch-access-manager.h>
 #include <ns3/bandwidth-part-gnb.h>
 #include <ns3/bwp-manager-gnb.h>
@@ -47,9 +55,16 @@
 #include <ns3/beam-manager.h>
 #include <ns3/three-gpp-propagation-loss-model.h>
 #include <ns3/three-gpp-spectrum-propagation-loss-model.h>
+#include <ns3/distance-based-three-gpp-spectrum-propagation-loss-model.h>
+#include <ns3/cached-three-gpp-spectrum-propagation-loss-model.h>
 #include <ns3/three-gpp-channel-model.h>
 #include <ns3/buildings-channel-condition-model.h>
+#include <ns3/nr-building-index.h>
+#include <ns3/nr-los-field-channel-condition-model.h>
 #include <ns3/nr-mac-scheduler-tdma-rr.h>
+#include <ns3/nr-icic-algorithm.h>
+#include <ns3/nr-dynamic-tdd-controller.h>
+#include <ns3/nr-cached-antenna-model.h>
 #include <ns3/bwp-manager-algorithm.h>
 #include <ns3/three-gpp-v2v-propagation-loss-model.h>
 #include <ns3/three-gpp-v2v-channel-condition-model.h>
@@ -76,6 +91,7 @@ NrHelper::NrHelper (void)
   m_gnbSpectrumFactory.SetTypeId (NrSpectrumPhy::GetTypeId ());
   m_uePhyFactory.SetTypeId (NrUePhy::GetTypeId ());
   m_gnbPhyFactory.SetTypeId (NrGnbPhy::GetTypeId ());
+  m_loadModelPhyFactory.SetTypeId (NrLoadModelPhy::GetTypeId ());
   m_ueChannelAccessManagerFactory.SetTypeId (NrAlwaysOnAccessManager::GetTypeId ());
   m_gnbChannelAccessManagerFactory.SetTypeId (NrAlwaysOnAccessManager::GetTypeId ());
   m_schedFactory.SetTypeId (NrMacSchedulerTdmaRR::GetTypeId ());
@@ -87,13 +103,15 @@ NrHelper::NrHelper (void)
   m_gnbDlAmcFactory.SetTypeId (NrAmc::GetTypeId ());
   m_gnbBeamManagerFactory.SetTypeId (BeamManager::GetTypeId());
   m_ueBeamManagerFactory.SetTypeId (BeamManager::GetTypeId());
-  m_spectrumPropagationFactory.SetTypeId (ThreeGppSpectrumPropagationLossModel::GetTypeId ());
+  m_spectrumPropagationFactory.SetTypeId (CachedThreeGppSpectrumPropagationLossModel::GetTypeId ());
 
   // Initialization that is there just because the user can configure attribute
   // through the helper methods without making it sad that no TypeId is set.
   // When the TypeId is changed, the user-set attribute will be maintained.
   m_pathlossModelFactory.SetTypeId (ThreeGppPropagationLossModel::GetTypeId ());
   m_channelConditionModelFactory.SetTypeId (ThreeGppChannelConditionModel::GetTypeId ());
+  m_pathlossMapFactory.SetTypeId (NrPathlossMapPropagationLossModel::GetTypeId ());
+  m_dynamicTddFactory.SetTypeId (NrDynamicTddController::GetTypeId ());
 
   Config::SetDefault ("ns3::EpsBearer::Release", UintegerValue (15));
 
@@ -119,12 +137,71 @@ NrHelper::GetTypeId (void)
                    BooleanValue (true),
                    MakeBooleanAccessor (&NrHelper::m_harqEnabled),
                    MakeBooleanChecker ())
+    .AddAttribute ("InstantAttach",
+                   "If true, the UEs attached by the helper do the random access "
+                   "directly with the gNB MAC, without preamble and RAR over the air. "
+                   "The RRC connection and the bearers are set up as usual",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrHelper::m_instantAttach),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ShareBwpChannelModels",
+                   "If true, InitializeOperationBand creates the propagation loss "
+                   "and the fading (3GPP channel) models once for all the BWPs with "
+                   "the same scenario and central frequency, so the channel matrices "
+                   "are generated and stored once. Each BWP still has its own "
+                   "spectrum channel. The BWPs sharing the models should use the same "
+                   "antenna configuration",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrHelper::m_shareBwpChannelModels),
+                   MakeBooleanChecker ())
+    .AddAttribute ("SpatialLosField",
+                   "If true, the BWPs of the RMa, UMa, UMi-StreetCanyon and InH "
+                   "scenarios (not their LoS, nLoS and Buildings variants) use a "
+                   "NrLosFieldChannelConditionModel: the LOS condition of a UE comes "
+                   "from a spatially correlated field around each gNB, shared with "
+                   "the REM, instead of an independent draw per link",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrHelper::m_spatialLosField),
+                   MakeBooleanChecker ())
+    .AddAttribute ("AlignBwpSlots",
+                   "If true, the PHYs of the BWPs of each gNB share an NrSlotTimingEngine: "
+                   "the slot boundaries of different BWPs (e.g., with different numerologies) "
+                   "that fall at the same instant are run in one simulator event",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrHelper::m_alignBwpSlots),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LowFootprintUe",
+                   "If true, the spectrum phys of the UE streams other than the first "
+                   "one, which never receive the DL control, are installed without the "
+                   "control interference object and its RS power and DL CTRL SINR "
+                   "chunk processors. It only matters with more than one stream",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrHelper::m_lowFootprintUe),
+                   MakeBooleanChecker ())
+    .AddAttribute ("RbsPerPsdBand",
+                   "Number of consecutive RBs of each band of the PSDs of the gNB and UE "
+                   "PHYs (see NrPhy::SetRbsPerPsdBand). With more than one, the channel "
+                   "and the interference are computed per band (e.g., 4 to 8 bands over "
+                   "the bandwidth for large scale runs) and each RB gets the SINR of its "
+                   "band, while the scheduler, the AMC, the error model and the HARQ still "
+                   "work per RB. 1 (the default) keeps one band per RB",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&NrHelper::m_rbsPerPsdBand),
+                   MakeUintegerChecker<uint32_t> (1))
     ;
   return tid;
 }
 
 typedef std::function<void (ObjectFactory *, ObjectFactory *)> InitPathLossFn;
 
+static bool
+IsSpatialLosFieldScenario (BandwidthPartInfo::Scenario scenario)
+{
+  return scenario == BandwidthPartInfo::RMa || scenario == BandwidthPartInfo::UMa
+         || scenario == BandwidthPartInfo::UMi_StreetCanyon || scenario == BandwidthPartInfo::InH_OfficeOpen
+         || scenario == BandwidthPartInfo::InH_OfficeMixed;
+}
+
 static void
 InitRma (ObjectFactory *pathlossModelFactory, ObjectFactory *channelConditionModelFactory)
 {
@@ -235,14 +312,14 @@ static void
 InitUmaBuildings (ObjectFactory *pathlossModelFactory, ObjectFactory *channelConditionModelFactory)
 {
   pathlossModelFactory->SetTypeId (ThreeGppUmaPropagationLossModel::GetTypeId ());
-  channelConditionModelFactory->SetTypeId (BuildingsChannelConditionModel::GetTypeId ());
+  channelConditionModelFactory->SetTypeId (NrBuildingsChannelConditionModel::GetTypeId ());
 }
 
 static void
 InitUmiBuildings (ObjectFactory *pathlossModelFactory, ObjectFactory *channelConditionModelFactory)
 {
   pathlossModelFactory->SetTypeId (ThreeGppUmiStreetCanyonPropagationLossModel::GetTypeId ());
-  channelConditionModelFactory->SetTypeId (BuildingsChannelConditionModel::GetTypeId ());
+  channelConditionModelFactory->SetTypeId (NrBuildingsChannelConditionModel::GetTypeId ());
 }
 
 static void
@@ -292,11 +369,31 @@ NrHelper::InitializeOperationBand (OperationBandInfo *band, uint8_t flags)
     {
       for (const auto & bwp : cc->m_bwp)
         {
+          SharedChannelModels *shared = nullptr;
+          if (m_shareBwpChannelModels)
+            {
+              shared = &m_sharedChannelModels[std::make_pair (bwp->m_scenario, bwp->m_centralFrequency)];
+              if (bwp->m_propagation == nullptr && flags & INIT_PROPAGATION)
+                {
+                  bwp->m_propagation = shared->m_propagation;
+                }
+              if (bwp->m_3gppChannel == nullptr && flags & INIT_FADING)
+                {
+                  bwp->m_3gppChannel = shared->m_3gppChannel;
+                }
+            }
+
           // Initialize the type ID of the factories by calling the relevant
           // static function defined above and stored inside the lookup table
           initLookupTable.at (bwp->m_scenario) (&m_pathlossModelFactory, &m_channelConditionModelFactory);
 
-          auto channelConditionModel  = m_channelConditionModelFactory.Create<ChannelConditionModel>();
+          ObjectFactory channelConditionModelFactory = m_channelConditionModelFactory;
+          if (m_spatialLosField && IsSpatialLosFieldScenario (bwp->m_scenario))
+            {
+              channelConditionModelFactory.SetTypeId (NrLosFieldChannelConditionModel::GetTypeId ());
+              channelConditionModelFactory.Set ("Scenario", StringValue (bwp->GetScenario ()));
+            }
+          auto channelConditionModel  = channelConditionModelFactory.Create<ChannelConditionModel>();
 
           if (bwp->m_propagation == nullptr && flags & INIT_PROPAGATION)
             {
@@ -314,11 +411,69 @@ NrHelper::InitializeOperationBand (OperationBandInfo *band, uint8_t flags)
               DynamicCast<ThreeGppSpectrumPropagationLossModel> (bwp->m_3gppChannel)->SetChannelModelAttribute ("ChannelConditionModel", PointerValue (channelConditionModel));
             }
 
+          if (m_wrapAround != nullptr && bwp->m_3gppChannel != nullptr)
+            {
+              Ptr<CachedThreeGppSpectrumPropagationLossModel> cached =
+                DynamicCast<CachedThreeGppSpectrumPropagationLossModel> (bwp->m_3gppChannel);
+              NS_ABORT_MSG_IF (cached == nullptr,
+                               "Wrap-around needs a CachedThreeGppSpectrumPropagationLossModel");
+              cached->SetWrapAroundModel (m_wrapAround);
+            }
+
+          if (shared != nullptr)
+            {
+              // The first models of a scenario and frequency are the shared ones
+              if (shared->m_propagation == nullptr)
+                {
+                  shared->m_propagation = bwp->m_propagation;
+                }
+              if (shared->m_3gppChannel == nullptr)
+                {
+                  shared->m_3gppChannel = bwp->m_3gppChannel;
+                }
+            }
+
           if (bwp->m_channel == nullptr && flags & INIT_CHANNEL)
             {
+              NS_ABORT_MSG_IF (m_pathlossMaps && m_wrapAround != nullptr,
+                               "The path loss maps do not support the wrap-around");
               bwp->m_channel = m_channelFactory.Create<SpectrumChannel> ();
-              bwp->m_channel->AddPropagationLossModel (bwp->m_propagation);
+              if (m_wrapAround != nullptr && bwp->m_propagation != nullptr)
+                {
+                  // The users of bwp->m_propagation keep the 3GPP model
+                  Ptr<NrWrapAroundPropagationLossModel> wrapper = CreateObject<NrWrapAroundPropagationLossModel> ();
+                  wrapper->SetPropagationLossModel (bwp->m_propagation);
+                  wrapper->SetWrapAroundModel (m_wrapAround);
+                  bwp->m_channel->AddPropagationLossModel (wrapper);
+                }
+              else if (m_pathlossMaps && bwp->m_propagation != nullptr)
+                {
+                  // The users of bwp->m_propagation keep the 3GPP model
+                  Ptr<NrPathlossMapPropagationLossModel> maps =
+                    m_pathlossMapFactory.Create<NrPathlossMapPropagationLossModel> ();
+                  maps->SetPropagationLossModel (bwp->m_propagation);
+                  bwp->m_channel->AddPropagationLossModel (maps);
+                }
+              else
+                {
+                  bwp->m_channel->AddPropagationLossModel (bwp->m_propagation);
+                }
               bwp->m_channel->AddPhasedArraySpectrumPropagationLossModel (bwp->m_3gppChannel);
+
+              Ptr<DistanceBasedThreeGppSpectrumPropagationLossModel> distanceBased =
+                DynamicCast<DistanceBasedThreeGppSpectrumPropagationLossModel> (bwp->m_3gppChannel);
+              // The cull is appended to the propagation models of the channel:
+              // do it once if they are shared
+              bool culled = shared != nullptr && shared->m_culled
+                && shared->m_propagation == bwp->m_propagation;
+              if (distanceBased != nullptr && ! culled)
+                {
+                  distanceBased->CullOutOfRangeReceivers (bwp->m_channel);
+                  if (shared != nullptr && shared->m_propagation == bwp->m_propagation)
+                    {
+                      shared->m_culled = true;
+                    }
+                }
             }
         }
     }
@@ -461,11 +616,12 @@ NrHelper::InstallUeDevice (const NodeContainer &c,
 {
   NS_LOG_FUNCTION (this);
   Initialize ();    // Run DoInitialize (), if necessary
+  const std::vector<BwpInstallParams> params = GetBwpInstallParams (allBwps);
   NetDeviceContainer devices;
   for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
     {
       Ptr<Node> node = *i;
-      Ptr<NetDevice> device = InstallSingleUeDevice (node, allBwps, numberOfStreams);
+      Ptr<NetDevice> device = InstallSingleUeDevice (node, allBwps, params, numberOfStreams);
       device->SetAddress (Mac48Address::Allocate ());
       devices.Add (device);
     }
@@ -480,17 +636,77 @@ NrHelper::InstallGnbDevice (const NodeContainer & c,
 {
   NS_LOG_FUNCTION (this);
   Initialize ();    // Run DoInitialize (), if necessary
+  const std::vector<BwpInstallParams> params = GetBwpInstallParams (allBwps);
   NetDeviceContainer devices;
   for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
     {
       Ptr<Node> node = *i;
-      Ptr<NetDevice> device = InstallSingleGnbDevice (node, allBwps, numberOfStreams);
+      Ptr<NetDevice> device = InstallSingleGnbDevice (node, allBwps, params, numberOfStreams);
       device->SetAddress (Mac48Address::Allocate ());
       devices.Add (device);
     }
   return devices;
 }
 
+NetDeviceContainer
+NrHelper::InstallLoadModelDevice (const NodeContainer &c,
+                                  const std::vector<std::reference_wrapper<BandwidthPartInfoPtr> > &allBwps)
+{
+  NS_LOG_FUNCTION (this);
+  Initialize ();    // Run DoInitialize (), if necessary
+  const std::vector<BwpInstallParams> params = GetBwpInstallParams (allBwps);
+  NetDeviceContainer devices;
+  for (NodeContainer::Iterator i = c.Begin (); i != c.End (); ++i)
+    {
+      Ptr<Node> node = *i;
+      Ptr<MobilityModel> mm = node->GetObject<MobilityModel> ();
+      NS_ASSERT_MSG (mm, "MobilityModel needs to be set on node before calling NrHelper::InstallLoadModelDevice ()");
+
+      Ptr<NrLoadModelNetDevice> dev = CreateObject<NrLoadModelNetDevice> ();
+      dev->SetNode (node);
+      node->AddDevice (dev);
+      for (uint32_t bwpId = 0; bwpId < allBwps.size (); ++bwpId)
+        {
+          Ptr<NrLoadModelPhy> phy = m_loadModelPhyFactory.Create<NrLoadModelPhy> ();
+          phy->SetAntenna (m_gnbAntennaFactory.Create<UniformPlanarArray> ());
+          phy->SetDevice (dev);
+          phy->SetMobility (mm);
+          phy->SetChannel (allBwps[bwpId].get ()->m_channel);
+          phy->Configure (params[bwpId].m_centralFrequency, allBwps[bwpId].get ()->m_channelBandwidth,
+                          m_rbsPerPsdBand);
+          phy->ScheduleStartEventLoop (node->GetId ());
+          dev->AddPhy (phy);
+        }
+      dev->SetAddress (Mac48Address::Allocate ());
+      devices.Add (dev);
+    }
+  return devices;
+}
+
+std::vector<NrHelper::BwpInstallParams>
+NrHelper::GetBwpInstallParams (const std::vector<std::reference_wrapper<BandwidthPartInfoPtr> > &allBwps)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  std::vector<BwpInstallParams> params;
+  params.reserve (allBwps.size ());
+  for (const auto &bwp : allBwps)
+    {
+      NS_ASSERT (bwp.get ()->m_channel != nullptr);
+
+      BwpInstallParams p;
+      DoubleValue frequency;
+      bool res = bwp.get ()->m_propagation->GetAttributeFailSafe ("Frequency", frequency);
+      NS_ASSERT_MSG (res, "Propagation model without Frequency attribute");
+      p.m_centralFrequency = frequency.Get ();
+
+      double bwInKhz = bwp.get ()->m_channelBandwidth / 1000.0;
+      NS_ABORT_MSG_IF (bwInKhz/100.0 > 65535.0, "A bandwidth of " << bwInKhz/100.0 << " kHz cannot be represented");
+      p.m_bandwidth = static_cast<uint16_t> (bwInKhz / 100);
+      params.push_back (p);
+    }
+  return params;
+}
+
 Ptr<NrUeMac>
 NrHelper::CreateUeMac () const
 {
@@ -501,6 +717,7 @@ NrHelper::CreateUeMac () const
 
 Ptr<NrUePhy>
 NrHelper::CreateUePhy (const Ptr<Node> &n, const std::unique_ptr<BandwidthPartInfo> &bwp,
+                           const BwpInstallParams &params,
                            const Ptr<NrUeNetDevice> &dev,
                            const NrSpectrumPhy::NrPhyRxCtrlEndOkCallback &phyRxCtrlCallback,
                            uint8_t numberOfStreams)
@@ -508,13 +725,8 @@ NrHelper::CreateUePhy (const Ptr<Node> &n, const std::unique_ptr<BandwidthPartIn
   NS_LOG_FUNCTION (this);
 
   Ptr<NrUePhy> phy = m_uePhyFactory.Create <NrUePhy> ();
-
-  NS_ASSERT (bwp->m_channel != nullptr);
-
-  DoubleValue frequency;
-  bool res = bwp->m_propagation->GetAttributeFailSafe ("Frequency", frequency);
-  NS_ASSERT_MSG (res, "Propagation model without Frequency attribute");
-  phy->InstallCentralFrequency (frequency.Get ());
+  phy->InstallCentralFrequency (params.m_centralFrequency);
+  phy->SetRbsPerPsdBand (m_rbsPerPsdBand);
 
   phy->ScheduleStartEventLoop (n->GetId (), 0, 0, 0);
 
@@ -545,18 +757,26 @@ NrHelper::CreateUePhy (const Ptr<Node> &n, const std::unique_ptr<BandwidthPartIn
           cam->SetNrSpectrumPhy (channelPhy); // TODO currently we connect CAM only to the first stream
         }
 
-      Ptr<LteChunkProcessor> pData = Create<LteChunkProcessor> ();
+      Ptr<LteChunkProcessor> pData = Create<NrChunkProcessor> ();
       pData->AddCallback (MakeCallback (&NrSpectrumPhy::GenerateDlCqiReport, channelPhy));
       pData->AddCallback (MakeCallback (&NrSpectrumPhy::UpdateSinrPerceived, channelPhy));
       channelPhy->AddDataSinrChunkProcessor (pData);
 
-      Ptr<LteChunkProcessor> pRs = Create<LteChunkProcessor> ();
-      pRs->AddCallback (MakeCallback (&NrSpectrumPhy::ReportRsReceivedPower, channelPhy));
-      channelPhy->AddRsPowerChunkProcessor (pRs);
+      if (m_lowFootprintUe && streamIndex > 0)
+        {
+          // The DL control is only sent on the first stream
+          channelPhy->DisableDlCtrlReception ();
+        }
+      else
+        {
+          Ptr<LteChunkProcessor> pRs = Create<LteChunkProcessor> ();
+          pRs->AddCallback (MakeCallback (&NrSpectrumPhy::ReportRsReceivedPower, channelPhy));
+          channelPhy->AddRsPowerChunkProcessor (pRs);
 
-      Ptr<LteChunkProcessor> pSinr = Create<LteChunkProcessor> ();
-      pSinr->AddCallback (MakeCallback (&NrSpectrumPhy::ReportDlCtrlSinr, channelPhy));
-      channelPhy->AddDlCtrlSinrChunkProcessor (pSinr);
+          Ptr<LteChunkProcessor> pSinr = Create<LteChunkProcessor> ();
+          pSinr->AddCallback (MakeCallback (&NrSpectrumPhy::ReportDlCtrlSinr, channelPhy));
+          channelPhy->AddDlCtrlSinrChunkProcessor (pSinr);
+        }
 
       channelPhy->SetChannel (bwp->m_channel);
       channelPhy->InstallPhy (phy);
@@ -574,10 +794,13 @@ NrHelper::CreateUePhy (const Ptr<Node> &n, const std::unique_ptr<BandwidthPartIn
 
 Ptr<NetDevice>
 NrHelper::InstallSingleUeDevice (const Ptr<Node> &n,
-                                     const std::vector<std::reference_wrapper<BandwidthPartInfoPtr> > allBwps,
+                                     const std::vector<std::reference_wrapper<BandwidthPartInfoPtr> > &allBwps,
+                                     const std::vector<BwpInstallParams> &params,
                                      uint8_t numberOfStreams)
 {
   NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (numberOfStreams == 0 || numberOfStreams > NR_MAX_STREAMS,
+                   "The number of streams must be between 1 and " << +NR_MAX_STREAMS);
 
   Ptr<NrUeNetDevice> dev = m_ueNetDeviceFactory.Create<NrUeNetDevice> ();
   dev->SetNode (n);
@@ -588,17 +811,15 @@ NrHelper::InstallSingleUeDevice (const Ptr<Node> &n,
   for (uint32_t bwpId = 0; bwpId < allBwps.size (); ++bwpId)
     {
       Ptr <BandwidthPartUe> cc =  CreateObject<BandwidthPartUe> ();
-      double bwInKhz = allBwps[bwpId].get()->m_channelBandwidth / 1000.0;
-      NS_ABORT_MSG_IF (bwInKhz/100.0 > 65535.0, "A bandwidth of " << bwInKhz/100.0 << " kHz cannot be represented");
-      cc->SetUlBandwidth (static_cast<uint16_t> (bwInKhz / 100));
-      cc->SetDlBandwidth (static_cast<uint16_t> (bwInKhz / 100));
+      cc->SetUlBandwidth (params[bwpId].m_bandwidth);
+      cc->SetDlBandwidth (params[bwpId].m_bandwidth);
       cc->SetDlEarfcn (0); // Used for nothing..
       cc->SetUlEarfcn (0); // Used for nothing..
 
       auto mac = CreateUeMac ();
       cc->SetMac (mac);
 
-      auto phy = CreateUePhy (n, allBwps[bwpId].get(), dev, std::bind (&NrUeNetDevice::RouteIngoingCtrlMsgs, dev,
+      auto phy = CreateUePhy (n, allBwps[bwpId].get(), params[bwpId], dev, std::bind (&NrUeNetDevice::RouteIngoingCtrlMsgs, dev,
                                          std::placeholders::_1, bwpId), numberOfStreams);
 
       if (m_harqEnabled)
@@ -712,6 +933,7 @@ NrHelper::InstallSingleUeDevice (const Ptr<Node> &n,
 
 Ptr<NrGnbPhy>
 NrHelper::CreateGnbPhy (const Ptr<Node> &n, const std::unique_ptr<BandwidthPartInfo> &bwp,
+                           const BwpInstallParams &params,
                            const Ptr<NrGnbNetDevice> &dev,
                            const NrSpectrumPhy::NrPhyRxCtrlEndOkCallback &phyEndCtrlCallback,
                            uint8_t numberOfStreams)
@@ -719,11 +941,8 @@ NrHelper::CreateGnbPhy (const Ptr<Node> &n, const std::unique_ptr<BandwidthPartI
   NS_LOG_FUNCTION (this);
 
   Ptr<NrGnbPhy> phy = m_gnbPhyFactory.Create <NrGnbPhy> ();
-
-  DoubleValue frequency;
-  bool res = bwp->m_propagation->GetAttributeFailSafe ("Frequency", frequency);
-  NS_ASSERT_MSG (res, "Propagation model without Frequency attribute");
-  phy->InstallCentralFrequency (frequency.Get ());
+  phy->InstallCentralFrequency (params.m_centralFrequency);
+  phy->SetRbsPerPsdBand (m_rbsPerPsdBand);
 
   phy->ScheduleStartEventLoop (n->GetId (), 0, 0, 0);
 
@@ -753,7 +972,7 @@ NrHelper::CreateGnbPhy (const Ptr<Node> &n, const std::unique_ptr<BandwidthPartI
       channelPhy->InstallPhy (phy); // each NrSpectrumPhy should have a pointer to its NrPhy device, in this case NrGnbPhy
       channelPhy->SetStreamId (streamIndex);
 
-      Ptr<LteChunkProcessor> pData = Create<LteChunkProcessor> (); // create pData chunk processor per NrSpectrumPhy
+      Ptr<LteChunkProcessor> pData = Create<NrChunkProcessor> (); // create pData chunk processor per NrSpectrumPhy
       Ptr<LteChunkProcessor> pSrs = Create<LteChunkProcessor> ();  // create pSrs per processor per NrSpectrumPhy
       if (!m_snrTest)
         {
@@ -771,6 +990,7 @@ NrHelper::CreateGnbPhy (const Ptr<Node> &n, const std::unique_ptr<BandwidthPartI
 
       Ptr<BeamManager> beamManager = m_gnbBeamManagerFactory.Create<BeamManager>();
       beamManager->Configure (antenna);
+      beamManager->SetBeamChangeCallback (MakeCallback (&NrGnbPhy::ReportBeamChange, phy));
       channelPhy->SetBeamManager (beamManager);
       phy->InstallSpectrumPhy (channelPhy); // finally let know phy that there is this spectrum phy
 
@@ -799,16 +1019,38 @@ NrHelper::CreateGnbSched ()
 
   sched->InstallDlAmc (dlAmc);
   sched->InstallUlAmc (ulAmc);
+  if (m_icicFactory.IsTypeIdSet ())
+    {
+      sched->SetAttribute ("IcicAlgorithm", PointerValue (m_icicFactory.Create<NrIcicAlgorithm> ()));
+    }
 
   return sched;
 }
 
+void
+NrHelper::ConnectBwpManagerAlgorithm (const Ptr<BwpManagerAlgorithmDynamic> &algorithm,
+                                      const Ptr<NrMacScheduler> &scheduler) const
+{
+  NS_LOG_FUNCTION (this);
+
+  bool connected = scheduler->TraceConnectWithoutContext ("SlotLoad",
+                                                          MakeCallback (&BwpManagerAlgorithmDynamic::ReportSlotLoad,
+                                                                        algorithm));
+  connected = connected && scheduler->TraceConnectWithoutContext ("DlWbCqi",
+                                                                  MakeCallback (&BwpManagerAlgorithmDynamic::ReportDlWbCqi,
+                                                                                algorithm));
+  NS_ABORT_MSG_IF (! connected, "BwpManagerAlgorithmDynamic needs a scheduler derived from NrMacSchedulerNs3");
+}
+
 Ptr<NetDevice>
 NrHelper::InstallSingleGnbDevice (const Ptr<Node> &n,
-                                      const std::vector<std::reference_wrapper<BandwidthPartInfoPtr> > allBwps,
+                                      const std::vector<std::reference_wrapper<BandwidthPartInfoPtr> > &allBwps,
+                                      const std::vector<BwpInstallParams> &params,
                                       uint8_t numberOfStreams)
 {
   NS_ABORT_MSG_IF (m_cellIdCounter == 65535, "max num gNBs exceeded");
+  NS_ABORT_MSG_IF (numberOfStreams == 0 || numberOfStreams > NR_MAX_STREAMS,
+                   "The number of streams must be between 1 and " << +NR_MAX_STREAMS);
 
   Ptr<NrGnbNetDevice> dev = m_gnbNetDeviceFactory.Create<NrGnbNetDevice> ();
 
@@ -825,16 +1067,13 @@ NrHelper::InstallSingleGnbDevice (const Ptr<Node> &n,
     {
       NS_LOG_DEBUG ("Creating BandwidthPart, id = " << bwpId);
       Ptr <BandwidthPartGnb> cc =  CreateObject<BandwidthPartGnb> ();
-      double bwInKhz = allBwps[bwpId].get()->m_channelBandwidth / 1000.0;
-      NS_ABORT_MSG_IF (bwInKhz/100.0 > 65535.0, "A bandwidth of " << bwInKhz/100.0 << " kHz cannot be represented");
-
-      cc->SetUlBandwidth (static_cast<uint16_t> (bwInKhz / 100));
-      cc->SetDlBandwidth (static_cast<uint16_t> (bwInKhz / 100));
+      cc->SetUlBandwidth (params[bwpId].m_bandwidth);
+      cc->SetDlBandwidth (params[bwpId].m_bandwidth);
       cc->SetDlEarfcn (0); // Argh... handover not working
       cc->SetUlEarfcn (0); // Argh... handover not working
       cc->SetCellId (m_cellIdCounter++);
 
-      auto phy = CreateGnbPhy (n, allBwps[bwpId].get(), dev,
+      auto phy = CreateGnbPhy (n, allBwps[bwpId].get(), params[bwpId], dev,
                                std::bind (&NrGnbNetDevice::RouteIngoingCtrlMsgs,
                                           dev, std::placeholders::_1, bwpId), numberOfStreams);
       phy->SetBwpId (bwpId);
@@ -859,9 +1098,29 @@ NrHelper::InstallSingleGnbDevice (const Ptr<Node> &n,
       ccMap.insert (std::make_pair (bwpId, cc));
     }
 
+  if (m_alignBwpSlots)
+    {
+      Ptr<NrSlotTimingEngine> slotTimingEngine = CreateObject<NrSlotTimingEngine> ();
+      for (const auto &cc : ccMap)
+        {
+          cc.second->GetPhy ()->SetSlotTimingEngine (slotTimingEngine);
+        }
+    }
+
   Ptr<LteEnbRrc> rrc = CreateObject<LteEnbRrc> ();
   Ptr<LteEnbComponentCarrierManager> ccmEnbManager = DynamicCast<LteEnbComponentCarrierManager> (CreateObject<BwpManagerGnb> ());
-  DynamicCast<BwpManagerGnb> (ccmEnbManager)->SetBwpManagerAlgorithm (m_gnbBwpManagerAlgoFactory.Create <BwpManagerAlgorithm> ());
+  Ptr<BwpManagerAlgorithm> bwpAlgorithm = m_gnbBwpManagerAlgoFactory.Create <BwpManagerAlgorithm> ();
+  DynamicCast<BwpManagerGnb> (ccmEnbManager)->SetBwpManagerAlgorithm (bwpAlgorithm);
+
+  // The dynamic algorithm is fed by the load and CQI seen by the schedulers
+  Ptr<BwpManagerAlgorithmDynamic> dynamicAlgorithm = DynamicCast<BwpManagerAlgorithmDynamic> (bwpAlgorithm);
+  if (dynamicAlgorithm != nullptr)
+    {
+      for (const auto &cc : ccMap)
+        {
+          ConnectBwpManagerAlgorithm (dynamicAlgorithm, cc.second->GetScheduler ());
+        }
+    }
 
   // Convert Enb carrier map to only PhyConf map
   // we want to make RRC to be generic, to be able to work with any type of carriers, not only strictly LTE carriers
@@ -981,34 +1240,49 @@ void
 NrHelper::AttachToClosestEnb (NetDeviceContainer ueDevices, NetDeviceContainer enbDevices)
 {
   NS_LOG_FUNCTION (this);
+  NS_ASSERT_MSG (enbDevices.GetN () > 0, "empty enb device container");
+
+  AttachToClosestEnb (ueDevices, enbDevices, NrSiteIndex (enbDevices));
+}
+
+void
+NrHelper::AttachToClosestEnb (NetDeviceContainer ueDevices, NetDeviceContainer enbDevices,
+                              const NrSiteIndex &enbIndex)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (enbIndex.GetN () != enbDevices.GetN (),
+                   "The index must have a site for each gNB device");
 
   for (NetDeviceContainer::Iterator i = ueDevices.Begin (); i != ueDevices.End (); i++)
     {
-      AttachToClosestEnb (*i, enbDevices);
+      Vector uepos = (*i)->GetNode ()->GetObject<MobilityModel> ()->GetPosition ();
+      AttachToEnb (*i, enbDevices.Get (enbIndex.FindNearest (uepos)));
     }
 }
 
 void
-NrHelper::AttachToClosestEnb (Ptr<NetDevice> ueDevice, NetDeviceContainer enbDevices)
+NrHelper::AttachToBestServer (NetDeviceContainer ueDevices, NetDeviceContainer enbDevices,
+                              const Ptr<const NrCouplingGainEngine> &engine)
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT_MSG (enbDevices.GetN () > 0, "empty enb device container");
-  Vector uepos = ueDevice->GetNode ()->GetObject<MobilityModel> ()->GetPosition ();
-  double minDistance = std::numeric_limits<double>::infinity ();
-  Ptr<NetDevice> closestEnbDevice;
-  for (NetDeviceContainer::Iterator i = enbDevices.Begin (); i != enbDevices.End (); ++i)
+
+  for (NetDeviceContainer::Iterator i = ueDevices.Begin (); i != ueDevices.End (); i++)
     {
-      Vector enbpos = (*i)->GetNode ()->GetObject<MobilityModel> ()->GetPosition ();
-      double distance = CalculateDistance (uepos, enbpos);
-      if (distance < minDistance)
+      uint32_t ueIndex = engine->GetUeIndex (*i);
+      Ptr<NetDevice> best;
+      double bestGain = 0.0;
+      for (NetDeviceContainer::Iterator j = enbDevices.Begin (); j != enbDevices.End (); j++)
         {
-          minDistance = distance;
-          closestEnbDevice = *i;
+          double gain = engine->GetBestCouplingGain (engine->GetGnbIndex (*j), ueIndex);
+          if (best == nullptr || gain > bestGain)
+            {
+              best = *j;
+              bestGain = gain;
+            }
         }
+      AttachToEnb (*i, best);
     }
-  NS_ASSERT (closestEnbDevice != 0);
-
-  AttachToEnb (ueDevice, closestEnbDevice);
 }
 
 
@@ -1034,10 +1308,28 @@ NrHelper::AttachToEnb (const Ptr<NetDevice> &ueDevice,
       ueNetDev->GetPhy (i)->SetSymbolsPerSlot (enbNetDev->GetPhy (i)->GetSymbolsPerSlot ());
       ueNetDev->GetPhy (i)->SetNumerology (enbNetDev->GetPhy(i)->GetNumerology ());
       ueNetDev->GetPhy (i)->SetPattern (enbNetDev->GetPhy (i)->GetPattern ());
+      enbNetDev->GetPhy (i)->ForwardTddPatternChange (ueNetDev->GetPhy (i));
+      if (m_instantAttach)
+        {
+          ueNetDev->GetMac (i)->SetIdealRandomAccessCallback (MakeCallback (&NrGnbMac::IdealRandomAccess,
+                                                                            enbNetDev->GetMac (i)));
+        }
       Ptr<EpcUeNas> ueNas = ueNetDev->GetNas ();
       ueNas->Connect (enbNetDev->GetBwpId (i), enbNetDev->GetEarfcn (i));
     }
 
+  Ptr<BwpManagerAlgorithmDynamic> dynamicAlgorithm =
+      DynamicCast<BwpManagerAlgorithmDynamic> (ueNetDev->GetBwpManager ()->GetBwpManagerAlgorithm ());
+  if (dynamicAlgorithm != nullptr)
+    {
+      // The UE routes the UL bytes, so it follows the UL load of its gNB
+      dynamicAlgorithm->SetAttribute ("LoadDirection", EnumValue (BwpManagerAlgorithmDynamic::UL));
+      for (uint32_t i = 0; i < enbNetDev->GetCcMapSize (); ++i)
+        {
+          ConnectBwpManagerAlgorithm (dynamicAlgorithm, enbNetDev->GetScheduler (i));
+        }
+    }
+
   if (m_epcHelper)
     {
       // activate default EPS bearer
@@ -1156,6 +1448,13 @@ NrHelper::SetGnbPhyAttribute(const std::string &n, const AttributeValue &v)
   m_gnbPhyFactory.Set (n, v);
 }
 
+void
+NrHelper::SetLoadModelPhyAttribute (const std::string &n, const AttributeValue &v)
+{
+  NS_LOG_FUNCTION (this);
+  m_loadModelPhyFactory.Set (n, v);
+}
+
 void
 NrHelper::SetUeAntennaAttribute (const std::string &n, const AttributeValue &v)
 {
@@ -1170,6 +1469,40 @@ NrHelper::SetGnbAntennaAttribute (const std::string &n, const AttributeValue &v)
   m_gnbAntennaFactory.Set (n, v);
 }
 
+/**
+ * \brief Create the table of an element, and build it
+ * \param element the element
+ * \param resolution the step of the table, in degrees
+ * \return the table
+ */
+static Ptr<NrCachedAntennaModel>
+CreateElementLut (const Ptr<AntennaModel> &element, double resolution)
+{
+  Ptr<NrCachedAntennaModel> lut = CreateObject<NrCachedAntennaModel> ();
+  lut->SetElement (element);
+  lut->SetResolution (resolution);
+  lut->BuildTable ();
+  return lut;
+}
+
+Ptr<NrCachedAntennaModel>
+NrHelper::SetUeAntennaElementLut (const Ptr<AntennaModel> &element, double resolution)
+{
+  NS_LOG_FUNCTION (this << element << resolution);
+  Ptr<NrCachedAntennaModel> lut = CreateElementLut (element, resolution);
+  m_ueAntennaFactory.Set ("AntennaElement", PointerValue (lut));
+  return lut;
+}
+
+Ptr<NrCachedAntennaModel>
+NrHelper::SetGnbAntennaElementLut (const Ptr<AntennaModel> &element, double resolution)
+{
+  NS_LOG_FUNCTION (this << element << resolution);
+  Ptr<NrCachedAntennaModel> lut = CreateElementLut (element, resolution);
+  m_gnbAntennaFactory.Set ("AntennaElement", PointerValue (lut));
+  return lut;
+}
+
 void
 NrHelper::SetUeChannelAccessManagerTypeId (const TypeId &typeId)
 {
@@ -1233,6 +1566,143 @@ NrHelper::SetPathlossAttribute(const std::string &n, const AttributeValue &v)
   m_pathlossModelFactory.Set (n, v);
 }
 
+void
+NrHelper::SetWrapAroundModel (const Ptr<NrWrapAroundModel> &model)
+{
+  NS_LOG_FUNCTION (this << model);
+  m_wrapAround = model;
+}
+
+void
+NrHelper::EnablePathlossMaps ()
+{
+  NS_LOG_FUNCTION (this);
+  m_pathlossMaps = true;
+}
+
+void
+NrHelper::SetPathlossMapAttribute (const std::string &n, const AttributeValue &v)
+{
+  NS_LOG_FUNCTION (this);
+  m_pathlossMapFactory.Set (n, v);
+}
+
+void
+NrHelper::GeneratePathlossMaps (const NetDeviceContainer &gnbDevices)
+{
+  NS_LOG_FUNCTION (this);
+
+  std::vector<Ptr<NrPathlossMapPropagationLossModel>> maps;
+  auto addSite = [&maps] (const Ptr<SpectrumChannel> &channel, const Ptr<MobilityModel> &mobility)
+    {
+      Ptr<NrPathlossMapPropagationLossModel> map =
+        DynamicCast<NrPathlossMapPropagationLossModel> (channel->GetPropagationLossModel ());
+      NS_ABORT_MSG_IF (map == nullptr, "The channel has no path loss maps: see EnablePathlossMaps");
+      map->AddSite (mobility);
+      if (std::find (maps.begin (), maps.end (), map) == maps.end ())
+        {
+          maps.push_back (map);
+        }
+    };
+
+  for (auto it = gnbDevices.Begin (); it != gnbDevices.End (); ++it)
+    {
+      if (Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice> (*it))
+        {
+          for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize (); ++bwp)
+            {
+              Ptr<NrSpectrumPhy> phy = gnb->GetPhy (bwp)->GetSpectrumPhy ();
+              addSite (phy->GetSpectrumChannel (), phy->GetMobility ());
+            }
+        }
+      else if (Ptr<NrLoadModelNetDevice> loadModel = DynamicCast<NrLoadModelNetDevice> (*it))
+        {
+          for (uint32_t bwp = 0; bwp < loadModel->GetNumPhys (); ++bwp)
+            {
+              Ptr<NrLoadModelPhy> phy = loadModel->GetPhy (bwp);
+              addSite (phy->GetSpectrumChannel (), phy->GetMobility ());
+            }
+        }
+      else
+        {
+          NS_ABORT_MSG ("Device " << (*it)->GetIfIndex () << " is not a NrGnbNetDevice nor a NrLoadModelNetDevice");
+        }
+    }
+
+  for (const auto &map : maps)
+    {
+      map->Generate ();
+    }
+}
+
+void
+NrHelper::SetIcicAlgorithmTypeId (const TypeId &typeId)
+{
+  NS_LOG_FUNCTION (this);
+  m_icicFactory.SetTypeId (typeId);
+}
+
+void
+NrHelper::SetIcicAlgorithmAttribute (const std::string &n, const AttributeValue &v)
+{
+  NS_LOG_FUNCTION (this);
+  m_icicFactory.Set (n, v);
+}
+
+void
+NrHelper::ConnectIcicNeighbours (const NetDeviceContainer &gnbDevices, double maxDistance)
+{
+  NS_LOG_FUNCTION (maxDistance);
+
+  for (auto it = gnbDevices.Begin (); it != gnbDevices.End (); ++it)
+    {
+      Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice> (*it);
+      NS_ABORT_MSG_IF (gnb == nullptr, "Device " << (*it)->GetIfIndex () << " is not a NrGnbNetDevice");
+      Vector position = gnb->GetNode ()->GetObject<MobilityModel> ()->GetPosition ();
+      for (auto other = gnbDevices.Begin (); other != gnbDevices.End (); ++other)
+        {
+          Ptr<NrGnbNetDevice> neighbour = DynamicCast<NrGnbNetDevice> (*other);
+          if (neighbour == gnb || neighbour == nullptr
+              || CalculateDistance (position, neighbour->GetNode ()->GetObject<MobilityModel> ()->GetPosition ()) > maxDistance)
+            {
+              continue;
+            }
+          for (uint32_t bwp = 0; bwp < std::min (gnb->GetCcMapSize (), neighbour->GetCcMapSize ()); ++bwp)
+            {
+              Ptr<NrIcicAlgorithm> icic = DynamicCast<NrMacSchedulerNs3> (gnb->GetScheduler (bwp))->GetIcicAlgorithm ();
+              Ptr<NrIcicAlgorithm> neighbourIcic = DynamicCast<NrMacSchedulerNs3> (neighbour->GetScheduler (bwp))->GetIcicAlgorithm ();
+              if (icic != nullptr && neighbourIcic != nullptr)
+                {
+                  icic->AddNeighbour (neighbourIcic);
+                }
+            }
+        }
+    }
+}
+
+void
+NrHelper::SetDynamicTddAttribute (const std::string &n, const AttributeValue &v)
+{
+  NS_LOG_FUNCTION (this);
+  m_dynamicTddFactory.Set (n, v);
+}
+
+Ptr<NrDynamicTddController>
+NrHelper::EnableDynamicTdd (const NetDeviceContainer &gnbDevices, uint32_t bwpIndex)
+{
+  NS_LOG_FUNCTION (this << bwpIndex);
+
+  Ptr<NrDynamicTddController> controller = m_dynamicTddFactory.Create<NrDynamicTddController> ();
+  for (auto it = gnbDevices.Begin (); it != gnbDevices.End (); ++it)
+    {
+      Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice> (*it);
+      NS_ABORT_MSG_IF (gnb == nullptr, "Device " << (*it)->GetIfIndex () << " is not a NrGnbNetDevice");
+      NS_ABORT_MSG_IF (bwpIndex >= gnb->GetCcMapSize (), "The gNB has no BWP " << bwpIndex);
+      controller->AddCell (gnb->GetPhy (bwpIndex), DynamicCast<NrMacSchedulerNs3> (gnb->GetScheduler (bwpIndex)));
+    }
+  return controller;
+}
+
 void
 NrHelper::SetGnbDlAmcAttribute (const std::string &n, const AttributeValue &v)
 {
@@ -1315,6 +1785,15 @@ NrHelper::AssignStreams (NetDeviceContainer c, int64_t stream)
                 }
             }
         }
+
+      Ptr<NrLoadModelNetDevice> loadModel = DynamicCast<NrLoadModelNetDevice> (netDevice);
+      if (loadModel)
+        {
+          for (uint32_t bwp = 0; bwp < loadModel->GetNumPhys (); bwp++)
+            {
+              currentStream += loadModel->GetPhy (bwp)->AssignStreams (currentStream);
+            }
+        }
     }
 
   return (currentStream - stream);
@@ -1323,7 +1802,8 @@ NrHelper::AssignStreams (NetDeviceContainer c, int64_t stream)
 int64_t
 NrHelper::DoAssignStreamsToChannelObjects (Ptr<NrSpectrumPhy> phy, int64_t currentStream)
 {
-  Ptr<ThreeGppPropagationLossModel> propagationLossModel = DynamicCast<ThreeGppPropagationLossModel> (phy->GetSpectrumChannel ()->GetPropagationLossModel ());
+  Ptr<ThreeGppPropagationLossModel> propagationLossModel =
+    DynamicCast<ThreeGppPropagationLossModel> (NrWrapAroundPropagationLossModel::Unwrap (phy->GetSpectrumChannel ()->GetPropagationLossModel ()));
   NS_ASSERT (propagationLossModel != nullptr);
 
   int64_t initialStream = currentStream;
@@ -1346,6 +1826,17 @@ NrHelper::DoAssignStreamsToChannelObjects (Ptr<NrSpectrumPhy> phy, int64_t curre
       m_channelObjectsWithAssignedStreams.push_back (channelConditionModel);
     }
 
+  Ptr<NrPathlossMapPropagationLossModel> maps =
+    DynamicCast<NrPathlossMapPropagationLossModel> (phy->GetSpectrumChannel ()->GetPropagationLossModel ());
+  if (maps != nullptr
+      && std::find (m_channelObjectsWithAssignedStreams.begin (),
+                    m_channelObjectsWithAssignedStreams.end (),
+                    maps) == m_channelObjectsWithAssignedStreams.end ())
+    {
+      currentStream += maps->AssignStreams (currentStream);
+      m_channelObjectsWithAssignedStreams.push_back (maps);
+    }
+
   Ptr<ThreeGppSpectrumPropagationLossModel> spectrumLossModel = DynamicCast<ThreeGppSpectrumPropagationLossModel> (phy->GetSpectrumChannel ()->GetPhasedArraySpectrumPropagationLossModel ());
 
   if (spectrumLossModel)
@@ -1513,6 +2004,14 @@ NrHelper::EnableTraces (void)
   EnablePathlossTraces ();
 }
 
+void
+NrHelper::SetTraceFilter (const NrTraceFilter &filter)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (filter.m_samplingPeriod == 0, "The sampling period must be at least 1");
+  m_traceFilter = filter;
+}
+
 Ptr<NrPhyRxTrace>
 NrHelper::GetPhyRxTrace (void)
 {
@@ -1523,11 +2022,11 @@ void
 NrHelper::EnableDlDataPhyTraces (void)
 {
   //NS_LOG_FUNCTION_NOARGS ();
-  Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUePhy/DlDataSinr",
-                   MakeBoundCallback (&NrPhyRxTrace::DlDataSinrCallback, m_phyStats));
+  ConnectDeviceTraces (UE_PHY, "DlDataSinr",
+                       MakeBoundCallback (&NrPhyRxTrace::DlDataSinrCallback, m_phyStats));
 
-  Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUePhy/NrSpectrumPhyList/*/RxPacketTraceUe",
-                   MakeBoundCallback (&NrPhyRxTrace::RxPacketTraceUeCallback, m_phyStats));
+  ConnectDeviceTraces (UE_SPECTRUM_PHY, "RxPacketTraceUe",
+                       MakeBoundCallback (&NrPhyRxTrace::RxPacketTraceUeCallback, m_phyStats));
 }
 
 
@@ -1535,57 +2034,57 @@ void
 NrHelper::EnableDlCtrlPhyTraces (void)
 {
   //NS_LOG_FUNCTION_NOARGS ();
-  Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUePhy/DlCtrlSinr",
-                   MakeBoundCallback (&NrPhyRxTrace::DlCtrlSinrCallback, m_phyStats));
+  ConnectDeviceTraces (UE_PHY, "DlCtrlSinr",
+                       MakeBoundCallback (&NrPhyRxTrace::DlCtrlSinrCallback, m_phyStats));
 }
 
 void
 NrHelper::EnableGnbPhyCtrlMsgsTraces (void)
 {
-  Config::Connect ("/NodeList/*/DeviceList/*/BandwidthPartMap/*/NrGnbPhy/GnbPhyRxedCtrlMsgsTrace",
-                   MakeBoundCallback (&NrPhyRxTrace::RxedGnbPhyCtrlMsgsCallback, m_phyStats));
-  Config::Connect ("/NodeList/*/DeviceList/*/BandwidthPartMap/*/NrGnbPhy/GnbPhyTxedCtrlMsgsTrace",
-                   MakeBoundCallback (&NrPhyRxTrace::TxedGnbPhyCtrlMsgsCallback, m_phyStats));
+  ConnectDeviceTraces (GNB_PHY, "GnbPhyRxedCtrlMsgsTrace",
+                       MakeBoundCallback (&NrPhyRxTrace::RxedGnbPhyCtrlMsgsCallback, m_phyStats));
+  ConnectDeviceTraces (GNB_PHY, "GnbPhyTxedCtrlMsgsTrace",
+                       MakeBoundCallback (&NrPhyRxTrace::TxedGnbPhyCtrlMsgsCallback, m_phyStats));
 }
 
 void
 NrHelper::EnableGnbMacCtrlMsgsTraces (void)
 {
-  Config::Connect ("/NodeList/*/DeviceList/*/BandwidthPartMap/*/NrGnbMac/GnbMacRxedCtrlMsgsTrace",
-                   MakeBoundCallback (&NrMacRxTrace::RxedGnbMacCtrlMsgsCallback, m_macStats));
+  ConnectDeviceTraces (GNB_MAC, "GnbMacRxedCtrlMsgsTrace",
+                       MakeBoundCallback (&NrMacRxTrace::RxedGnbMacCtrlMsgsCallback, m_macStats));
 
-  Config::Connect ("/NodeList/*/DeviceList/*/BandwidthPartMap/*/NrGnbMac/GnbMacTxedCtrlMsgsTrace",
-                   MakeBoundCallback (&NrMacRxTrace::TxedGnbMacCtrlMsgsCallback, m_macStats));
+  ConnectDeviceTraces (GNB_MAC, "GnbMacTxedCtrlMsgsTrace",
+                       MakeBoundCallback (&NrMacRxTrace::TxedGnbMacCtrlMsgsCallback, m_macStats));
 }
 
 void
 NrHelper::EnableUePhyCtrlMsgsTraces (void)
 {
-  Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUePhy/UePhyRxedCtrlMsgsTrace",
-                   MakeBoundCallback (&NrPhyRxTrace::RxedUePhyCtrlMsgsCallback, m_phyStats));
-  Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUePhy/UePhyTxedCtrlMsgsTrace",
-                   MakeBoundCallback (&NrPhyRxTrace::TxedUePhyCtrlMsgsCallback, m_phyStats));
-  Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUePhy/UePhyRxedDlDciTrace",
-                   MakeBoundCallback (&NrPhyRxTrace::RxedUePhyDlDciCallback, m_phyStats));
-  Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUePhy/UePhyTxedHarqFeedbackTrace",
-                   MakeBoundCallback (&NrPhyRxTrace::TxedUePhyHarqFeedbackCallback, m_phyStats));
+  ConnectDeviceTraces (UE_PHY, "UePhyRxedCtrlMsgsTrace",
+                       MakeBoundCallback (&NrPhyRxTrace::RxedUePhyCtrlMsgsCallback, m_phyStats));
+  ConnectDeviceTraces (UE_PHY, "UePhyTxedCtrlMsgsTrace",
+                       MakeBoundCallback (&NrPhyRxTrace::TxedUePhyCtrlMsgsCallback, m_phyStats));
+  ConnectDeviceTraces (UE_PHY, "UePhyRxedDlDciTrace",
+                       MakeBoundCallback (&NrPhyRxTrace::RxedUePhyDlDciCallback, m_phyStats));
+  ConnectDeviceTraces (UE_PHY, "UePhyTxedHarqFeedbackTrace",
+                       MakeBoundCallback (&NrPhyRxTrace::TxedUePhyHarqFeedbackCallback, m_phyStats));
 }
 
 void
 NrHelper::EnableUeMacCtrlMsgsTraces (void)
 {
-  Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUeMac/UeMacRxedCtrlMsgsTrace",
-                   MakeBoundCallback (&NrMacRxTrace::RxedUeMacCtrlMsgsCallback, m_macStats));
-  Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUeMac/UeMacTxedCtrlMsgsTrace",
-                   MakeBoundCallback (&NrMacRxTrace::TxedUeMacCtrlMsgsCallback, m_macStats));
+  ConnectDeviceTraces (UE_MAC, "UeMacRxedCtrlMsgsTrace",
+                       MakeBoundCallback (&NrMacRxTrace::RxedUeMacCtrlMsgsCallback, m_macStats));
+  ConnectDeviceTraces (UE_MAC, "UeMacTxedCtrlMsgsTrace",
+                       MakeBoundCallback (&NrMacRxTrace::TxedUeMacCtrlMsgsCallback, m_macStats));
 }
 
 void
 NrHelper::EnableUlPhyTraces (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  Config::Connect ("/NodeList/*/DeviceList/*/BandwidthPartMap/*/NrGnbPhy/NrSpectrumPhyList/*/RxPacketTraceEnb",
-                   MakeBoundCallback (&NrPhyRxTrace::RxPacketTraceEnbCallback, m_phyStats));
+  ConnectDeviceTraces (GNB_SPECTRUM_PHY, "RxPacketTraceEnb",
+                       MakeBoundCallback (&NrPhyRxTrace::RxPacketTraceEnbCallback, m_phyStats));
 }
 
 void
@@ -1610,8 +2109,8 @@ void
 NrHelper::EnableTransportBlockTrace ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  Config::Connect ("/NodeList/*/DeviceList/*/ComponentCarrierMapUe/*/NrUePhy/ReportDownlinkTbSize",
-                   MakeBoundCallback (&NrPhyRxTrace::ReportDownLinkTBSize, m_phyStats));
+  ConnectDeviceTraces (UE_PHY, "ReportDownlinkTbSize",
+                       MakeBoundCallback (&NrPhyRxTrace::ReportDownLinkTBSize, m_phyStats));
 }
 
 
@@ -1662,25 +2161,300 @@ void
 NrHelper::EnableDlMacSchedTraces ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  Config::Connect ("/NodeList/*/DeviceList/*/BandwidthPartMap/*/NrGnbMac/DlScheduling",
-                   MakeBoundCallback (&NrMacSchedulingStats::DlSchedulingCallback, m_macSchedStats));
+  ConnectMacSchedTraces ("DlScheduling", &NrMacSchedulingStats::DlSchedulingCellCallback);
 }
 
 void
 NrHelper::EnableUlMacSchedTraces ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  Config::Connect ("/NodeList/*/DeviceList/*/BandwidthPartMap/*/NrGnbMac/UlScheduling",
-                   MakeBoundCallback (&NrMacSchedulingStats::UlSchedulingCallback, m_macSchedStats));
+  ConnectMacSchedTraces ("UlScheduling", &NrMacSchedulingStats::UlSchedulingCellCallback);
+}
+
+void
+NrHelper::ConnectMacSchedTraces (const std::string &traceName,
+                                 void (*sink) (Ptr<NrMacSchedulingStats>, uint16_t, NrSchedulingCallbackInfo))
+{
+  NS_LOG_FUNCTION (this << traceName);
+  // The cell ID is bound to the sink, and the IMSI comes from the table that
+  // the stats keep from the RRC events: no path is built or looked up
+  m_macSchedStats->SetTraceFilter (m_traceFilter);
+  for (auto node = NodeList::Begin (); node != NodeList::End (); ++node)
+    {
+      for (uint32_t i = 0; i < (*node)->GetNDevices (); ++i)
+        {
+          Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice> ((*node)->GetDevice (i));
+          if (gnb == nullptr)
+            {
+              continue;
+            }
+          uint16_t cellId = gnb->GetCellId ();
+          if (!m_traceFilter.SelectsCell (cellId))
+            {
+              continue;
+            }
+          m_macSchedStats->ConnectRrc (cellId, gnb->GetRrc ());
+          for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize (); ++bwp)
+            {
+              if (!m_traceFilter.SelectsBwp (static_cast<uint16_t> (bwp)))
+                {
+                  continue;
+                }
+              gnb->GetMac (static_cast<uint8_t> (bwp))->TraceConnectWithoutContext (traceName,
+                  MakeBoundCallback (sink, m_macSchedStats, cellId));
+            }
+        }
+    }
+}
+
+void
+NrHelper::ConnectDeviceTraces (TraceSourceOwner owner, const std::string &traceName,
+                               const CallbackBase &sink) const
+{
+  NS_LOG_FUNCTION (owner << traceName);
+  std::vector<Ptr<ObjectBase> > sources;
+  for (auto node = NodeList::Begin (); node != NodeList::End (); ++node)
+    {
+      for (uint32_t i = 0; i < (*node)->GetNDevices (); ++i)
+        {
+          Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice> ((*node)->GetDevice (i));
+          Ptr<NrUeNetDevice> ue = DynamicCast<NrUeNetDevice> ((*node)->GetDevice (i));
+          if (gnb != nullptr && (owner == GNB_PHY || owner == GNB_MAC || owner == GNB_SPECTRUM_PHY)
+              && m_traceFilter.SelectsCell (gnb->GetCellId ()))
+            {
+              for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize (); ++bwp)
+                {
+                  if (!m_traceFilter.SelectsBwp (static_cast<uint16_t> (bwp)))
+                    {
+                      continue;
+                    }
+                  Ptr<NrGnbPhy> phy = gnb->GetPhy (static_cast<uint8_t> (bwp));
+                  if (owner == GNB_PHY)
+                    {
+                      sources.push_back (phy);
+                    }
+                  else if (owner == GNB_MAC)
+                    {
+                      sources.push_back (gnb->GetMac (static_cast<uint8_t> (bwp)));
+                    }
+                  else
+                    {
+                      for (uint8_t stream = 0; stream < phy->GetNumberOfStreams (); ++stream)
+                        {
+                          sources.push_back (phy->GetSpectrumPhy (stream));
+                        }
+                    }
+                }
+            }
+          else if (ue != nullptr && (owner == UE_PHY || owner == UE_MAC || owner == UE_SPECTRUM_PHY)
+                   && m_traceFilter.SelectsImsi (ue->GetImsi ())
+                   && m_traceFilter.SelectsCell (ue->GetCellId ()))
+            {
+              for (uint32_t bwp = 0; bwp < ue->GetCcMapSize (); ++bwp)
+                {
+                  if (!m_traceFilter.SelectsBwp (static_cast<uint16_t> (bwp)))
+                    {
+                      continue;
+                    }
+                  Ptr<NrUePhy> phy = ue->GetPhy (static_cast<uint8_t> (bwp));
+                  if (owner == UE_PHY)
+                    {
+                      sources.push_back (phy);
+                    }
+                  else if (owner == UE_MAC)
+                    {
+                      sources.push_back (ue->GetMac (static_cast<uint8_t> (bwp)));
+                    }
+                  else
+                    {
+                      for (uint8_t stream = 0; stream < phy->GetNumberOfStreams (); ++stream)
+                        {
+                          sources.push_back (phy->GetSpectrumPhy (stream));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+  for (const auto & source : sources)
+    {
+      bool connected = source->TraceConnect (traceName, std::string (), sink);
+      NS_ABORT_MSG_UNLESS (connected, "Can't connect to the trace source " << traceName);
+    }
 }
 
 void
 NrHelper::EnablePathlossTraces ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  Config::Connect ("/ChannelList/*/$ns3::SpectrumChannel/PathLoss",
-                   MakeBoundCallback (&NrPhyRxTrace::PathlossTraceCallback, m_phyStats));
+  for (auto channel = ChannelList::Begin (); channel != ChannelList::End (); ++channel)
+    {
+      Ptr<SpectrumChannel> spectrumChannel = DynamicCast<SpectrumChannel> (*channel);
+      if (spectrumChannel != nullptr)
+        {
+          spectrumChannel->TraceConnect ("PathLoss", std::string (),
+                                         MakeBoundCallback (&NrPhyRxTrace::PathlossTraceCallback, m_phyStats));
+        }
+    }
+
+}
+
+void
+NrHelper::EnablePhyRxKpiStats (const Time &epochDuration)
+{
+  NS_LOG_FUNCTION (this << epochDuration);
+  NS_ABORT_MSG_IF (m_phyRxKpiStats != nullptr, "The PHY RX KPIs are already enabled");
+  m_phyRxKpiStats = CreateObject<NrPhyRxKpiStats> ();
+  m_phyRxKpiStats->SetAttribute ("EpochDuration", TimeValue (epochDuration));
+  ConnectDeviceTraces (UE_SPECTRUM_PHY, "RxPacketTraceUe",
+                       MakeBoundCallback (&NrPhyRxKpiStats::RxPacketTraceUeCallback, m_phyRxKpiStats));
+  ConnectDeviceTraces (GNB_SPECTRUM_PHY, "RxPacketTraceEnb",
+                       MakeBoundCallback (&NrPhyRxKpiStats::RxPacketTraceEnbCallback, m_phyRxKpiStats));
+  m_phyRxKpiStats->Start ();
+}
+
+Ptr<NrPhyRxKpiStats>
+NrHelper::GetPhyRxKpiStats () const
+{
+  return m_phyRxKpiStats;
+}
+
+void
+NrHelper::EnableLatencyBreakdownStats ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_latencyBreakdownStats != nullptr, "The latency breakdown is already enabled");
+  NrLatencyTag::SetEnabled (true);
+  m_latencyBreakdownStats = CreateObject<NrLatencyBreakdownStats> ();
+  ConnectDeviceTraces (UE_MAC, "DlLatencyBreakdown",
+                       MakeBoundCallback (&NrLatencyBreakdownStats::DlLatencyCallback,
+                                          m_latencyBreakdownStats));
+  ConnectDeviceTraces (GNB_MAC, "UlLatencyBreakdown",
+                       MakeBoundCallback (&NrLatencyBreakdownStats::UlLatencyCallback,
+                                          m_latencyBreakdownStats));
+  m_latencyBreakdownStats->Start ();
+}
+
+Ptr<NrLatencyBreakdownStats>
+NrHelper::GetLatencyBreakdownStats () const
+{
+  return m_latencyBreakdownStats;
+}
+
+void
+NrHelper::EnableMetricsExporter (const Time &interval)
+{
+  NS_LOG_FUNCTION (this << interval);
+  NS_ABORT_MSG_IF (m_metricsExporter != nullptr, "The metrics exporter is already enabled");
+  m_metricsExporter = CreateObject<NrMetricsExporter> ();
+  m_metricsExporter->SetAttribute ("Interval", TimeValue (interval));
+  for (auto node = NodeList::Begin (); node != NodeList::End (); ++node)
+    {
+      for (uint32_t i = 0; i < (*node)->GetNDevices (); ++i)
+        {
+          Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice> ((*node)->GetDevice (i));
+          if (gnb != nullptr && m_traceFilter.SelectsCell (gnb->GetCellId ()))
+            {
+              m_metricsExporter->AddGnb (gnb);
+            }
+        }
+    }
+  m_metricsExporter->Start ();
+}
+
+Ptr<NrMetricsExporter>
+NrHelper::GetMetricsExporter () const
+{
+  return m_metricsExporter;
+}
+
+void
+NrHelper::EnableCounters (const Time &dumpPeriod, const std::string &fileName)
+{
+  NS_LOG_FUNCTION (this << dumpPeriod << fileName);
+  NrCounters::SetEnabled (true);
+  if (dumpPeriod.IsStrictlyPositive ())
+    {
+      NrCounters::StartPeriodicDump (dumpPeriod, fileName);
+    }
+}
+
+NrCounters::Snapshot
+NrHelper::GetCounters () const
+{
+  return NrCounters::GetSnapshot ();
+}
+
+void
+NrHelper::PrintMemoryReport (std::ostream &os, const NetDeviceContainer &gnbDevices,
+                             const NetDeviceContainer &ueDevices) const
+{
+  NS_LOG_FUNCTION (this);
 
+  struct Component
+  {
+    std::string m_name;        //!< Name of the component
+    uint64_t m_instances {0};  //!< Number of instances
+    uint64_t m_bytes {0};      //!< Estimated bytes of all the instances
+  };
+  std::vector<Component> components {{"NrUeNetDevice"}, {"NrUeMac"}, {"NrUePhy"},
+                                     {"NrSpectrumPhy (UE)"}, {"NrInterference (UE)"},
+                                     {"NrMacSchedulerUeInfo (gNB)"}};
+
+  for (auto it = ueDevices.Begin (); it != ueDevices.End (); ++it)
+    {
+      Ptr<NrUeNetDevice> ueDev = DynamicCast<NrUeNetDevice> (*it);
+      NS_ABORT_MSG_IF (ueDev == nullptr, "PrintMemoryReport expects NrUeNetDevice in the UE container");
+      components[0].m_instances += 1;
+      components[0].m_bytes += sizeof (NrUeNetDevice);
+      for (uint32_t bwp = 0; bwp < ueDev->GetCcMapSize (); ++bwp)
+        {
+          components[1].m_instances += 1;
+          components[1].m_bytes += sizeof (NrUeMac);
+          Ptr<NrUePhy> phy = ueDev->GetPhy (static_cast<uint8_t> (bwp));
+          components[2].m_instances += 1;
+          components[2].m_bytes += sizeof (NrUePhy);
+          for (uint8_t stream = 0; stream < phy->GetNumberOfStreams (); ++stream)
+            {
+              Ptr<NrSpectrumPhy> spectrumPhy = phy->GetSpectrumPhy (stream);
+              components[3].m_instances += 1;
+              components[3].m_bytes += spectrumPhy->GetMemoryUsage ();
+              components[4].m_instances += 1;
+              components[4].m_bytes += spectrumPhy->GetInterferenceMemoryUsage ();
+            }
+        }
+    }
+
+  for (auto it = gnbDevices.Begin (); it != gnbDevices.End (); ++it)
+    {
+      Ptr<NrGnbNetDevice> gnbDev = DynamicCast<NrGnbNetDevice> (*it);
+      NS_ABORT_MSG_IF (gnbDev == nullptr, "PrintMemoryReport expects NrGnbNetDevice in the gNB container");
+      for (uint32_t bwp = 0; bwp < gnbDev->GetCcMapSize (); ++bwp)
+        {
+          Ptr<NrMacSchedulerNs3> sched = DynamicCast<NrMacSchedulerNs3> (gnbDev->GetScheduler (static_cast<uint8_t> (bwp)));
+          if (sched != nullptr)
+            {
+              components[5].m_instances += sched->GetNumberOfUes ();
+              components[5].m_bytes += sched->GetUeMemoryUsage ();
+            }
+        }
+    }
+
+  // The sizes are estimates: the objects and the containers that grow with
+  // the simulation (spectrum values, event buffers, HARQ processes) are
+  // counted, the allocator overhead and the objects shared with others
+  // (channel, antennas, error model outputs) are not
+  uint64_t numUes = std::max<uint64_t> (1, ueDevices.GetN ());
+  uint64_t total = 0;
+  os << "% component\tinstances\tbytes\tbytesPerUe" << std::endl;
+  for (const auto & c : components)
+    {
+      os << c.m_name << "\t" << c.m_instances << "\t" << c.m_bytes << "\t"
+         << c.m_bytes / numUes << std::endl;
+      total += c.m_bytes;
+    }
+  os << "total\t-\t" << total << "\t" << total / numUes << std::endl;
 }
 
 } // namespace ns3
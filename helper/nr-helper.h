@@ -30,9 +30,17 @@
 #include <ns3/three-gpp-propagation-loss-model.h>
 #include <ns3/three-gpp-spectrum-propagation-loss-model.h>
 #include <ns3/nr-spectrum-phy.h>
+#include <ns3/nr-counters.h>
 #include "ideal-beamforming-helper.h"
 #include "cc-bwp-helper.h"
 #include "nr-mac-scheduling-stats.h"
+#include "nr-site-index.h"
+#include "nr-trace-filter.h"
+#include "nr-phy-rx-kpi-stats.h"
+#include "nr-latency-breakdown-stats.h"
+#include "nr-metrics-exporter.h"
+#include <ns3/nr-wrap-around-model.h>
+#include <unordered_map>
 
 namespace ns3 {
 
@@ -51,9 +59,15 @@ class ComponentCarrier;
 class NrMacScheduler;
 class NrGnbNetDevice;
 class NrUeNetDevice;
+class NrLoadModelNetDevice;
+class NrCouplingGainEngine;
 class NrUeMac;
 class BwpManagerGnb;
 class BwpManagerUe;
+class BwpManagerAlgorithmDynamic;
+class NrDynamicTddController;
+class NrCachedAntennaModel;
+class AntennaModel;
 
 /**
  * \ingroup helper
@@ -198,9 +212,13 @@ class BwpManagerUe;
  *
  * \section helper_attachment Attachment of UEs to GNBs
  *
- * We provide two methods to attach a set of UE to a GNB: AttachToClosestEnb()
- * and AttachToEnb(). Through these function, you will manually attach one or
- * more UEs to a specified GNB.
+ * We provide three methods to attach a set of UE to a GNB: AttachToClosestEnb(),
+ * AttachToBestServer() and AttachToEnb(). Through these function, you will
+ * manually attach one or more UEs to a specified GNB.
+ * With the attribute InstantAttach, the random access of these UEs is done
+ * directly between the UE and gNB MACs, without the preamble and the RAR: a
+ * large number of UEs connects in the first instants of the simulation,
+ * with the same RRC and bearer setup.
  *
  * \section helper_Traces Traces
  *
@@ -251,6 +269,23 @@ public:
                                        const std::vector<std::reference_wrapper<BandwidthPartInfoPtr>> allBwps,
                                        uint8_t numberOfPanels = 1);
 
+  /**
+   * \brief Install one (or more) interference-only gNBs
+   *
+   * Each node gets a NrLoadModelNetDevice, with a NrLoadModelPhy per BWP
+   * that transmits a synthetic signal in each slot, with the antenna of the
+   * gNBs (SetGnbAntennaAttribute) and the attributes set with
+   * SetLoadModelPhyAttribute. They have no MAC, scheduler nor UE, and do not
+   * need UpdateConfig nor an EPC: use them for the outer rings of a
+   * deployment, whose only role is to interfere with the inner cells.
+   *
+   * \param c Node container with the interfering gNBs
+   * \param allBwps The spectrum configuration that comes from CcBwpHelper
+   * \return a NetDeviceContainer with the net devices that have been installed.
+   */
+  NetDeviceContainer InstallLoadModelDevice (const NodeContainer &c,
+                                             const std::vector<std::reference_wrapper<BandwidthPartInfoPtr>> &allBwps);
+
   /**
    * \brief Get the number of configured BWP for a specific GNB NetDevice
    * \param gnbDevice The GNB NetDevice, obtained from InstallGnbDevice()
@@ -311,6 +346,30 @@ public:
    * \param enbDevices GNB devices from which the algorithm has to select the closest
    */
   void AttachToClosestEnb (NetDeviceContainer ueDevices, NetDeviceContainer enbDevices);
+  /**
+   * \brief Attach the UE specified to the closest GNB, found through an index
+   *
+   * The index can be reused for many calls while the GNBs do not move.
+   *
+   * \param ueDevices UE devices to attach
+   * \param enbDevices GNB devices from which the algorithm has to select the closest
+   * \param enbIndex the index of the positions of enbDevices, in the same order
+   */
+  void AttachToClosestEnb (NetDeviceContainer ueDevices, NetDeviceContainer enbDevices,
+                           const NrSiteIndex &enbIndex);
+  /**
+   * \brief Attach the UE specified to the GNB with the highest coupling gain
+   *
+   * The gain of each GNB is the one of its best beam, from the table of the
+   * engine: Install and Update must have been called on it with these
+   * devices.
+   *
+   * \param ueDevices UE devices to attach
+   * \param enbDevices GNB devices from which the algorithm has to select the best one
+   * \param engine the coupling gains of the devices
+   */
+  void AttachToBestServer (NetDeviceContainer ueDevices, NetDeviceContainer enbDevices,
+                           const Ptr<const NrCouplingGainEngine> &engine);
   /**
    * \brief Attach a UE to a particular GNB
    * \param ueDevice the UE device
@@ -328,6 +387,23 @@ public:
    */
   void EnableTraces ();
 
+  /**
+   * \brief Select the UEs, cells and BWPs whose traces are connected by the
+   * following calls to EnableTraces and to the Enable*Traces methods
+   *
+   * The filter is applied when the traces are connected: the trace sources
+   * of the devices that are not selected are not connected, so their
+   * events cost nothing. The UE traces are filtered by IMSI, by the cell
+   * to which the UE is attached when the trace is connected, and by BWP.
+   * The gNB traces are filtered by cell and BWP; the IMSI is also applied
+   * to the MAC scheduling traces, whose stats know the IMSI of each RNTI
+   * (NrMacSchedulingStats::SetTraceFilter). The other gNB traces, the
+   * pathloss traces and the RLC/PDCP traces are not filtered by IMSI.
+   *
+   * \param filter the filter
+   */
+  void SetTraceFilter (const NrTraceFilter &filter);
+
   /**
    * \brief Activate a Data Radio Bearer on a given UE devices
    *
@@ -531,6 +607,19 @@ public:
    */
   void SetGnbPhyAttribute (const std::string &n, const AttributeValue &v);
 
+  /**
+   * \brief Set an attribute for the PHY of the interference-only gNBs,
+   * before it is created.
+   *
+   * The numerology, RB overhead and pattern should be the ones of the gNBs.
+   *
+   * \param n the name of the attribute
+   * \param v the value of the attribute
+   *
+   * \see NrLoadModelPhy
+   */
+  void SetLoadModelPhyAttribute (const std::string &n, const AttributeValue &v);
+
   /**
    * \brief Set an attribute for the UE antenna, before it is created.
    *
@@ -551,6 +640,33 @@ public:
    */
   void SetGnbAntennaAttribute (const std::string &n, const AttributeValue &v);
 
+  /**
+   * \brief Use a table of the gain of an element for the elements of the
+   * UE antennas, before they are created.
+   *
+   * The table is built at once, and its error against the element is
+   * logged (NrCachedAntennaModel, level info).
+   *
+   * \param element the element, e.g., a ThreeGppAntennaModel
+   * \param resolution the step of the table, in degrees
+   * \return the tabulated element, shared by all the UE antennas
+   *
+   * \see NrCachedAntennaModel
+   */
+  Ptr<NrCachedAntennaModel> SetUeAntennaElementLut (const Ptr<AntennaModel> &element, double resolution);
+
+  /**
+   * \brief Use a table of the gain of an element for the elements of the
+   * gNB antennas, before they are created.
+   *
+   * \param element the element, e.g., a ThreeGppAntennaModel
+   * \param resolution the step of the table, in degrees
+   * \return the tabulated element, shared by all the gNB antennas
+   *
+   * \see SetUeAntennaElementLut
+   */
+  Ptr<NrCachedAntennaModel> SetGnbAntennaElementLut (const Ptr<AntennaModel> &element, double resolution);
+
   /**
    * \brief Set the TypeId of the UE Channel Access Manager. Works only before it is created.
    *
@@ -610,6 +726,9 @@ public:
 
   /*
    * \brief Sets the TypeId of the PhasedArraySpectrumPropagationLossModel to be used
+   *
+   * The default is CachedThreeGppSpectrumPropagationLossModel.
+   *
    * \param typeId Type of the object
    */
   void SetPhasedArraySpectrumPropagationLossModelTypeId (const TypeId &typeId);
@@ -646,6 +765,98 @@ public:
    */
   void SetPathlossAttribute (const std::string &n, const AttributeValue &v);
 
+  /**
+   * \brief Set the wrap-around model of the channels created by
+   * InitializeOperationBand (call it before)
+   *
+   * The spectrum channels then compute the path loss between the image of
+   * the site nearest to the other node, through a
+   * NrWrapAroundPropagationLossModel in front of the 3GPP path loss model,
+   * and the CachedThreeGppSpectrumPropagationLossModel (the only fading model
+   * supported) computes the channel between the same positions.
+   *
+   * \param model the wrap-around model, e.g. from
+   * HexagonalGridScenarioHelper::GetWrapAroundModel
+   */
+  void SetWrapAroundModel (const Ptr<NrWrapAroundModel> &model);
+
+  /**
+   * \brief Put a NrPathlossMapPropagationLossModel in front of the 3GPP path
+   * loss model of the channels created by the next calls to
+   * InitializeOperationBand
+   *
+   * The losses between the gNBs and the UEs are then taken from rasters,
+   * computed by GeneratePathlossMaps. The maps cannot be used with the
+   * wrap-around.
+   */
+  void EnablePathlossMaps ();
+
+  /**
+   * \brief Set an attribute of the path loss maps, before they are created
+   * \param n the name of the attribute
+   * \param v the value of the attribute
+   *
+   * \see NrPathlossMapPropagationLossModel
+   */
+  void SetPathlossMapAttribute (const std::string &n, const AttributeValue &v);
+
+  /**
+   * \brief Compute the path loss maps of some gNBs, in all their BWPs
+   *
+   * Call it when the gNBs are at their final positions, and after
+   * AssignStreams, which assigns the streams of the shadowing fields.
+   *
+   * \param gnbDevices the NrGnbNetDevice and NrLoadModelNetDevice devices
+   */
+  void GeneratePathlossMaps (const NetDeviceContainer &gnbDevices);
+
+  /**
+   * \brief Give an ICIC algorithm of this type to the schedulers created
+   * from now on, one per cell
+   * \param typeId the type of the algorithm
+   *
+   * \see NrIcicFrequencyReuse
+   */
+  void SetIcicAlgorithmTypeId (const TypeId &typeId);
+
+  /**
+   * \brief Set an attribute of the ICIC algorithms, before they are created
+   * \param n the name of the attribute
+   * \param v the value of the attribute
+   *
+   * The attributes that differ between the cells, as the SubBand of
+   * NrIcicFrequencyReuse, are set on the algorithm of each scheduler, see
+   * NrMacSchedulerNs3::GetIcicAlgorithm.
+   */
+  void SetIcicAlgorithmAttribute (const std::string &n, const AttributeValue &v);
+
+  /**
+   * \brief Make neighbours the ICIC algorithms of the same BWP of the gNBs
+   * that are not farther than a distance
+   * \param gnbDevices the gNB devices
+   * \param maxDistance the maximum distance between two neighbours (m)
+   */
+  static void ConnectIcicNeighbours (const NetDeviceContainer &gnbDevices, double maxDistance);
+
+  /**
+   * \brief Set an attribute of the dynamic TDD controllers, before they are
+   * created
+   * \param n the name of the attribute
+   * \param v the value of the attribute
+   *
+   * \see NrDynamicTddController
+   */
+  void SetDynamicTddAttribute (const std::string &n, const AttributeValue &v);
+
+  /**
+   * \brief Let a NrDynamicTddController choose the TDD pattern of a BWP of
+   * some gNBs from their DL and UL buffers
+   * \param gnbDevices the gNB devices, with a TDD pattern
+   * \param bwpIndex the index of the BWP
+   * \return the controller
+   */
+  Ptr<NrDynamicTddController> EnableDynamicTdd (const NetDeviceContainer &gnbDevices, uint32_t bwpIndex = 0);
+
   /**
    * Set an attribute for the GNB DL AMC, before it is created.
    *
@@ -828,6 +1039,90 @@ public:
    */
   void EnablePathlossTraces ();
 
+  /**
+   * \brief Aggregate the receptions of the RxPacketTraceUe (DL) and
+   * RxPacketTraceEnb (UL) traces in per-UE KPIs (see NrPhyRxKpiStats)
+   *
+   * Only the KPIs are written, at the end of each epoch or of the
+   * simulation, instead of one line per TB. The devices are selected by
+   * the filter given to SetTraceFilter.
+   *
+   * \param epochDuration if positive, the KPIs are written and reset every epoch
+   */
+  void EnablePhyRxKpiStats (const Time &epochDuration = Seconds (0));
+
+  /**
+   * \return the KPI aggregator, or nullptr if EnablePhyRxKpiStats was not called
+   */
+  Ptr<NrPhyRxKpiStats> GetPhyRxKpiStats () const;
+
+  /**
+   * \brief Collect per-bearer histograms of the components of the latency
+   * of the MAC PDUs (see NrLatencyBreakdownStats)
+   *
+   * It enables the stamping of the PDUs by the MACs (NrLatencyTag), for all
+   * the devices, and connects the DlLatencyBreakdown and UlLatencyBreakdown
+   * traces of the devices selected by the filter given to SetTraceFilter.
+   * The histograms are written when the simulator is destroyed.
+   */
+  void EnableLatencyBreakdownStats ();
+
+  /**
+   * \return the latency histograms, or nullptr if EnableLatencyBreakdownStats was not called
+   */
+  Ptr<NrLatencyBreakdownStats> GetLatencyBreakdownStats () const;
+
+  /**
+   * \brief Export live metrics in the OpenMetrics text format (see NrMetricsExporter)
+   *
+   * The exporter samples the gNBs selected by the filter given to
+   * SetTraceFilter, and the NrCounters if they are enabled, every interval of
+   * wall-clock time. Its probes keep the simulator busy: the simulation has to
+   * be ended by Simulator::Stop.
+   *
+   * \param interval the wall-clock time between two samples
+   */
+  void EnableMetricsExporter (const Time &interval = Seconds (10));
+
+  /**
+   * \return the metrics exporter, or nullptr if EnableMetricsExporter was not called
+   */
+  Ptr<NrMetricsExporter> GetMetricsExporter () const;
+
+  /**
+   * \brief Enable the activity counters of the module (see NrCounters)
+   *
+   * The counters are global to the simulation: they count the activity of
+   * every cell and BWP, including the ones installed by other helpers.
+   *
+   * \param dumpPeriod if positive, the counters are written to a file every period
+   * \param fileName the name of the file
+   */
+  void EnableCounters (const Time &dumpPeriod = Seconds (0),
+                       const std::string &fileName = "NrCounters.txt");
+
+  /**
+   * \brief Get the value of the activity counters
+   * \return the counters of every cell and BWP since they were enabled
+   */
+  NrCounters::Snapshot GetCounters () const;
+
+  /**
+   * \brief Print an estimate of the memory used by the UEs, per component
+   *
+   * For each component (UE device, MAC, PHY, spectrum phys, interference
+   * objects, and the representation of the UEs in the gNB schedulers) it
+   * prints the number of instances, the bytes and the bytes per UE. The
+   * bytes are estimates: the objects and their growing containers are
+   * counted, the allocator overhead and the shared objects are not.
+   *
+   * \param os the output stream
+   * \param gnbDevices the gNB devices
+   * \param ueDevices the UE devices
+   */
+  void PrintMemoryReport (std::ostream &os, const NetDeviceContainer &gnbDevices,
+                          const NetDeviceContainer &ueDevices) const;
+
   /**
     * Assign a fixed random variable stream number to the random variables used.
     *
@@ -872,26 +1167,96 @@ private:
    */
   void DoDeActivateDedicatedEpsBearer (Ptr<NetDevice> ueDevice, Ptr<NetDevice> enbDevice, uint8_t bearerId);
 
+  /**
+   * \brief Connect a sink of NrMacSchedulingStats to a scheduling trace of all the gNB MACs
+   *
+   * The sink is bound to the stats and to the cell ID of the gNB, and the
+   * stats are connected to the RRC of the gNB to know the IMSI of the UEs.
+   *
+   * \param traceName the name of the trace source of NrGnbMac
+   * \param sink the trace sink
+   */
+  void ConnectMacSchedTraces (const std::string &traceName,
+                              void (*sink) (Ptr<NrMacSchedulingStats>, uint16_t, NrSchedulingCallbackInfo));
+
+  /**
+   * \brief The objects of the NR devices that own the trace sources
+   */
+  enum TraceSourceOwner
+  {
+    GNB_PHY,          //!< The NrGnbPhy of each BWP of the gNBs
+    GNB_MAC,          //!< The NrGnbMac of each BWP of the gNBs
+    GNB_SPECTRUM_PHY, //!< The NrSpectrumPhy of each stream of the gNB PHYs
+    UE_PHY,           //!< The NrUePhy of each BWP of the UEs
+    UE_MAC,           //!< The NrUeMac of each BWP of the UEs
+    UE_SPECTRUM_PHY   //!< The NrSpectrumPhy of each stream of the UE PHYs
+  };
+
+  /**
+   * \brief Connect a trace sink to a trace source of all the NR devices
+   *
+   * The devices are found in the node list, and the trace source of each
+   * object is connected directly, with an empty context, instead of
+   * resolving a wildcard Config path. The sinks take the cell, BWP and
+   * RNTI from the arguments of the trace.
+   *
+   * Only the devices and the BWPs selected by the filter given to
+   * SetTraceFilter are connected.
+   *
+   * \param owner the objects that own the trace source
+   * \param traceName the name of the trace source
+   * \param sink the trace sink, whose first argument is the (empty) context
+   */
+  void ConnectDeviceTraces (TraceSourceOwner owner, const std::string &traceName,
+                            const CallbackBase &sink) const;
+
+  /**
+   * \brief The values of a BWP used by the PHYs and the BWPs of the devices
+   */
+  struct BwpInstallParams
+  {
+    double m_centralFrequency {0.0}; //!< Central frequency, from the propagation model
+    uint16_t m_bandwidth {0};        //!< Bandwidth, in multiples of 100 kHz
+  };
+
+  /**
+   * \brief Read and check once, for all the devices of a container, the values of the BWPs
+   * \param allBwps the BWPs
+   * \return the values of each BWP
+   */
+  static std::vector<BwpInstallParams>
+  GetBwpInstallParams (const std::vector<std::reference_wrapper<BandwidthPartInfoPtr>> &allBwps);
+
   Ptr<NrGnbPhy> CreateGnbPhy (const Ptr<Node> &n, const std::unique_ptr<BandwidthPartInfo> &bwp,
+                                  const BwpInstallParams &params,
                                   const Ptr<NrGnbNetDevice> &dev,
                                   const NrSpectrumPhy::NrPhyRxCtrlEndOkCallback &phyEndCtrlCallback,
                                   uint8_t numberOfPanels);
   Ptr<NrMacScheduler> CreateGnbSched ();
+  /**
+   * \brief Feed a dynamic BWP manager algorithm with the load and CQI traces of a scheduler
+   * \param algorithm the algorithm
+   * \param scheduler the scheduler of one BWP
+   */
+  void ConnectBwpManagerAlgorithm (const Ptr<BwpManagerAlgorithmDynamic> &algorithm,
+                                   const Ptr<NrMacScheduler> &scheduler) const;
   Ptr<NrGnbMac> CreateGnbMac ();
 
   Ptr<NrUeMac> CreateUeMac () const;
   Ptr<NrUePhy> CreateUePhy (const Ptr<Node> &n, const std::unique_ptr<BandwidthPartInfo> &bwp,
+                                const BwpInstallParams &params,
                                 const Ptr<NrUeNetDevice> &dev,
                                 const NrSpectrumPhy::NrPhyRxCtrlEndOkCallback &phyRxCtrlCallback,
                                 uint8_t numberOfPanels);
 
   Ptr<NetDevice> InstallSingleUeDevice (const Ptr<Node> &n,
-                                        const std::vector<std::reference_wrapper<BandwidthPartInfoPtr>> allBwps,
+                                        const std::vector<std::reference_wrapper<BandwidthPartInfoPtr>> &allBwps,
+                                        const std::vector<BwpInstallParams> &params,
                                         uint8_t numberOfPanels);
   Ptr<NetDevice> InstallSingleGnbDevice (const Ptr<Node> &n,
-                                         const std::vector<std::reference_wrapper<BandwidthPartInfoPtr>> allBwps,
+                                         const std::vector<std::reference_wrapper<BandwidthPartInfoPtr>> &allBwps,
+                                         const std::vector<BwpInstallParams> &params,
                                          uint8_t numberOfPanels);
-  void AttachToClosestEnb (Ptr<NetDevice> ueDevice, NetDeviceContainer enbDevices);
 
   std::map<uint8_t, ComponentCarrier> GetBandwidthPartMap ();
 
@@ -904,6 +1269,7 @@ private:
   ObjectFactory m_gnbSpectrumFactory;   //!< GNB spectrum factory
   ObjectFactory m_uePhyFactory;         //!< UE PHY factory
   ObjectFactory m_gnbPhyFactory;        //!< GNB PHY factory
+  ObjectFactory m_loadModelPhyFactory;  //!< Interference-only gNB PHY factory
   ObjectFactory m_ueChannelAccessManagerFactory; //!< UE Channel access manager factory
   ObjectFactory m_gnbChannelAccessManagerFactory; //!< GNB Channel access manager factory
   ObjectFactory m_schedFactory;         //!< Scheduler factory
@@ -927,6 +1293,46 @@ private:
 
   bool m_harqEnabled {false};
   bool m_snrTest {false};
+  bool m_instantAttach {false}; //!< Random access without preamble and RAR (attribute)
+  bool m_shareBwpChannelModels {false}; //!< Share the channel models of the BWPs with the same scenario and frequency (attribute)
+  bool m_spatialLosField {false}; //!< Use a NrLosFieldChannelConditionModel in the 3GPP scenarios (attribute)
+  bool m_alignBwpSlots {false}; //!< Run the aligned slot boundaries of the BWPs of a gNB in one event (attribute)
+  bool m_lowFootprintUe {false}; //!< Install the UE streams after the first without DL control reception (attribute)
+  uint32_t m_rbsPerPsdBand {1}; //!< Number of RBs of each band of the PSDs of the PHYs (attribute)
+
+  /**
+   * \brief Key of the channel models shared between BWPs: scenario and central frequency
+   */
+  typedef std::pair<BandwidthPartInfo::Scenario, double> SharedChannelModelsKey;
+
+  /**
+   * \brief Hash of SharedChannelModelsKey
+   */
+  struct SharedChannelModelsKeyHash
+  {
+    /**
+     * \brief Hash the key
+     * \param key the key
+     * \return the hash of the scenario combined with the hash of the frequency
+     */
+    size_t operator() (const SharedChannelModelsKey &key) const
+    {
+      size_t h = std::hash<int> () (static_cast<int> (key.first));
+      return h ^ (std::hash<double> () (key.second) + 0x9e3779b9 + (h << 6) + (h >> 2));
+    }
+  };
+
+  /**
+   * \brief Channel models shared between the BWPs with the same key
+   */
+  struct SharedChannelModels
+  {
+    Ptr<PropagationLossModel> m_propagation;                  //!< Propagation model
+    Ptr<PhasedArraySpectrumPropagationLossModel> m_3gppChannel; //!< Fading model
+    bool m_culled {false}; //!< True if the out of range cull has been added to m_propagation
+  };
+
+  std::unordered_map<SharedChannelModelsKey, SharedChannelModels, SharedChannelModelsKeyHash> m_sharedChannelModels; //!< Models shared between BWPs
 
   Ptr<NrPhyRxTrace> m_phyStats; //!< Pointer to the PhyRx stats
   Ptr<NrMacRxTrace> m_macStats; //!< Pointer to the MacRx stats
@@ -937,6 +1343,15 @@ private:
   std::map<uint8_t, ComponentCarrier> m_componentCarrierPhyParams; //!< component carrier map
   std::vector< Ptr <Object> > m_channelObjectsWithAssignedStreams; //!< channel and propagation objects to which NrHelper has assigned streams in order to avoid double assignments
   Ptr<NrMacSchedulingStats> m_macSchedStats; //!<< Pointer to NrMacStatsCalculator
+  NrTraceFilter m_traceFilter; //!< Selection of the traced devices, see SetTraceFilter
+  Ptr<NrPhyRxKpiStats> m_phyRxKpiStats; //!< Per-UE KPIs of the receptions, see EnablePhyRxKpiStats
+  Ptr<NrLatencyBreakdownStats> m_latencyBreakdownStats; //!< Latency histograms, see EnableLatencyBreakdownStats
+  Ptr<NrMetricsExporter> m_metricsExporter; //!< Live metrics, see EnableMetricsExporter
+  Ptr<NrWrapAroundModel> m_wrapAround;      //!< Wrap-around of the channels, see SetWrapAroundModel
+  bool m_pathlossMaps {false};              //!< True to create the path loss maps, see EnablePathlossMaps
+  ObjectFactory m_pathlossMapFactory;       //!< Path loss maps factory
+  ObjectFactory m_icicFactory;              //!< ICIC algorithm factory, see SetIcicAlgorithmTypeId
+  ObjectFactory m_dynamicTddFactory;        //!< Dynamic TDD controller factory, see EnableDynamicTdd
 };
 
 }
@@ -0,0 +1,239 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-ideal-epc-helper.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/simulator.h>
+#include <ns3/node.h>
+#include <ns3/ipv4.h>
+#include <ns3/ipv6.h>
+#include <ns3/ipv4-header.h>
+#include <ns3/ipv6-header.h>
+#include <ns3/ipv4-l3-protocol.h>
+#include <ns3/ipv6-l3-protocol.h>
+#include <ns3/virtual-net-device.h>
+#include <ns3/eps-bearer-tag.h>
+#include <ns3/lte-enb-rrc.h>
+#include <ns3/lte-ue-rrc.h>
+#include <ns3/nr-gnb-net-device.h>
+#include <ns3/nr-ue-net-device.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrIdealEpcHelper");
+
+NS_OBJECT_ENSURE_REGISTERED (NrIdealEpcHelper);
+
+NrIdealEpcHelper::NrIdealEpcHelper () : NrPointToPointEpcHelper ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrIdealEpcHelper::~NrIdealEpcHelper ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+NrIdealEpcHelper::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrIdealEpcHelper")
+    .SetParent<NrPointToPointEpcHelper> ()
+    .SetGroupName ("nr")
+    .AddConstructor<NrIdealEpcHelper> ()
+    .AddAttribute ("CoreDelay",
+                   "The delay of the data between the PGW and the gNBs, in both directions",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&NrIdealEpcHelper::m_coreDelay),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+void
+NrIdealEpcHelper::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_tunDevice = nullptr;
+  m_gnbs.clear ();
+  m_ues.clear ();
+  m_imsiByIpv4.clear ();
+  m_imsiByIpv6.clear ();
+  NrPointToPointEpcHelper::DoDispose ();
+}
+
+void
+NrIdealEpcHelper::AddEnb (Ptr<Node> enbNode, Ptr<NetDevice> lteEnbNetDevice,
+                          std::vector<uint16_t> cellIds)
+{
+  NS_LOG_FUNCTION (this << enbNode << lteEnbNetDevice);
+
+  NrPointToPointEpcHelper::AddEnb (enbNode, lteEnbNetDevice, cellIds);
+
+  Ptr<NrGnbNetDevice> gnb = DynamicCast<NrGnbNetDevice> (lteEnbNetDevice);
+  NS_ABORT_MSG_IF (gnb == nullptr, "NrIdealEpcHelper works only with NrGnbNetDevice");
+  for (uint16_t cellId : cellIds)
+    {
+      m_gnbs[cellId] = gnb;
+    }
+
+  // The UL packets come here instead of going to the S1-U socket
+  gnb->GetRrc ()->SetForwardUpCallback (MakeCallback (&NrIdealEpcHelper::RecvFromGnb, this));
+
+  // The DL packets routed by the PGW come here instead of going to the PGW
+  // application
+  if (m_tunDevice == nullptr)
+    {
+      Ptr<Node> pgw = GetPgwNode ();
+      for (uint32_t i = 0; i < pgw->GetNDevices () && m_tunDevice == nullptr; ++i)
+        {
+          m_tunDevice = DynamicCast<VirtualNetDevice> (pgw->GetDevice (i));
+        }
+      NS_ABORT_MSG_IF (m_tunDevice == nullptr, "The PGW has no TUN device");
+      m_tunDevice->SetSendCallback (MakeCallback (&NrIdealEpcHelper::RecvFromTunDevice, this));
+    }
+}
+
+uint8_t
+NrIdealEpcHelper::ActivateEpsBearer (Ptr<NetDevice> ueLteDevice, uint64_t imsi,
+                                     Ptr<EpcTft> tft, EpsBearer bearer)
+{
+  NS_LOG_FUNCTION (this << ueLteDevice << imsi);
+
+  uint8_t bid = NrPointToPointEpcHelper::ActivateEpsBearer (ueLteDevice, imsi, tft, bearer);
+
+  UeInfo &ue = m_ues[imsi];
+  ue.m_device = DynamicCast<NrUeNetDevice> (ueLteDevice);
+  NS_ABORT_MSG_IF (ue.m_device == nullptr, "NrIdealEpcHelper works only with NrUeNetDevice");
+  ue.m_classifier.Add (tft, bid);
+
+  // The address of the UE, as the PGW application learns it
+  Ptr<Node> ueNode = ueLteDevice->GetNode ();
+  Ptr<Ipv4> ueIpv4 = ueNode->GetObject<Ipv4> ();
+  Ptr<Ipv6> ueIpv6 = ueNode->GetObject<Ipv6> ();
+  int32_t interface = ueIpv4 != nullptr ? ueIpv4->GetInterfaceForDevice (ueLteDevice) : -1;
+  int32_t interface6 = ueIpv6 != nullptr ? ueIpv6->GetInterfaceForDevice (ueLteDevice) : -1;
+  if (interface >= 0 && ueIpv4->GetNAddresses (interface) == 1)
+    {
+      m_imsiByIpv4[ueIpv4->GetAddress (interface, 0).GetLocal ()] = imsi;
+    }
+  else if (interface6 >= 0 && ueIpv6->GetNAddresses (interface6) == 2)
+    {
+      m_imsiByIpv6[ueIpv6->GetAddress (interface6, 1).GetAddress ()] = imsi;
+    }
+
+  return bid;
+}
+
+bool
+NrIdealEpcHelper::RecvFromTunDevice (Ptr<Packet> packet, [[maybe_unused]] const Address &source,
+                                     [[maybe_unused]] const Address &dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (this << packet << protocolNumber);
+
+  std::map<uint64_t, UeInfo>::iterator ueIt = m_ues.end ();
+  if (protocolNumber == Ipv4L3Protocol::PROT_NUMBER)
+    {
+      Ipv4Header ipv4Header;
+      packet->PeekHeader (ipv4Header);
+      auto it = m_imsiByIpv4.find (ipv4Header.GetDestination ());
+      if (it != m_imsiByIpv4.end ())
+        {
+          ueIt = m_ues.find (it->second);
+        }
+    }
+  else if (protocolNumber == Ipv6L3Protocol::PROT_NUMBER)
+    {
+      Ipv6Header ipv6Header;
+      packet->PeekHeader (ipv6Header);
+      auto it = m_imsiByIpv6.find (ipv6Header.GetDestination ());
+      if (it != m_imsiByIpv6.end ())
+        {
+          ueIt = m_ues.find (it->second);
+        }
+    }
+  if (ueIt == m_ues.end ())
+    {
+      NS_LOG_WARN ("Unknown UE, discarding the packet");
+      return true;
+    }
+
+  uint32_t bid = ueIt->second.m_classifier.Classify (packet, EpcTft::DOWNLINK, protocolNumber);
+  if (bid == 0)
+    {
+      NS_LOG_WARN ("No matching bearer for this packet, discarding it");
+      return true;
+    }
+
+  Ptr<LteUeRrc> ueRrc = ueIt->second.m_device->GetRrc ();
+  auto gnbIt = m_gnbs.find (ueRrc->GetCellId ());
+  if (gnbIt == m_gnbs.end () || ueRrc->GetRnti () == 0)
+    {
+      NS_LOG_WARN ("The UE " << ueIt->first << " is not attached, discarding the packet");
+      return true;
+    }
+
+  Simulator::ScheduleWithContext (gnbIt->second->GetNode ()->GetId (), m_coreDelay,
+                                  &NrIdealEpcHelper::SendToGnb, this, packet, gnbIt->second,
+                                  ueRrc->GetRnti (), static_cast<uint8_t> (bid));
+  return true;
+}
+
+void
+NrIdealEpcHelper::SendToGnb (Ptr<Packet> packet, Ptr<NrGnbNetDevice> gnb, uint16_t rnti,
+                             uint8_t bid) const
+{
+  NS_LOG_FUNCTION (this << packet << rnti << +bid);
+
+  if (!gnb->GetRrc ()->HasUeManager (rnti))
+    {
+      NS_LOG_WARN ("The UE " << rnti << " left the gNB, discarding the packet");
+      return;
+    }
+  packet->AddPacketTag (EpsBearerTag (rnti, bid));
+  gnb->GetRrc ()->SendData (packet);
+}
+
+void
+NrIdealEpcHelper::RecvFromGnb (Ptr<Packet> packet)
+{
+  NS_LOG_FUNCTION (this << packet);
+
+  EpsBearerTag tag;
+  packet->RemovePacketTag (tag);
+
+  uint8_t ipType;
+  packet->CopyData (&ipType, 1);
+  ipType = (ipType >> 4) & 0x0f;
+  uint16_t protocolNumber = ipType == 0x06 ? Ipv6L3Protocol::PROT_NUMBER : Ipv4L3Protocol::PROT_NUMBER;
+
+  Simulator::ScheduleWithContext (m_tunDevice->GetNode ()->GetId (), m_coreDelay,
+                                  &NrIdealEpcHelper::SendToPgw, this, packet, protocolNumber);
+}
+
+void
+NrIdealEpcHelper::SendToPgw (Ptr<Packet> packet, uint16_t protocolNumber) const
+{
+  NS_LOG_FUNCTION (this << packet << protocolNumber);
+  m_tunDevice->Receive (packet, protocolNumber, m_tunDevice->GetAddress (),
+                        m_tunDevice->GetAddress (), NetDevice::PACKET_HOST);
+}
+
+} // namespace ns3
@@ -0,0 +1,146 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_IDEAL_EPC_HELPER_H
+#define NR_IDEAL_EPC_HELPER_H
+
+#include <ns3/nr-point-to-point-epc-helper.h>
+#include <ns3/epc-tft-classifier.h>
+#include <ns3/ipv4-address.h>
+#include <ns3/ipv6-address.h>
+#include <ns3/nstime.h>
+#include <map>
+
+namespace ns3 {
+
+class NrGnbNetDevice;
+class NrUeNetDevice;
+class VirtualNetDevice;
+
+/**
+ * \ingroup helper
+ *
+ * \brief An EPC with an ideal user plane, for studies that do not evaluate the core
+ *
+ * The control plane is the one of NrPointToPointEpcHelper: the MME, the SGW
+ * and the PGW set up the bearers, and the X2 links are used for the
+ * handovers. The data, instead, do not go through the S1-U and S5 links, and
+ * are not encapsulated in GTP-U:
+ *
+ * - in DL, the packets routed by the PGW to the UEs are classified with the
+ * TFTs of the bearers of the destination UE, as the PGW does, and given
+ * after the delay CoreDelay to the RRC of the gNB that serves the UE;
+ * - in UL, the packets that the gNB RRC forwards up are given after the
+ * delay CoreDelay to the IP stack of the PGW.
+ *
+ * The usage is the same as NrPointToPointEpcHelper:
+ *
+\verbatim
+  Ptr<NrIdealEpcHelper> epcHelper = CreateObject<NrIdealEpcHelper> ();
+  epcHelper->SetAttribute ("CoreDelay", TimeValue (MilliSeconds (1)));
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  nrHelper->SetEpcHelper (epcHelper);
+\endverbatim
+ *
+ * The remote hosts are connected to the PGW, and the UEs get their
+ * addresses, as with NrPointToPointEpcHelper. The attributes of the S1-U
+ * links have no effect on the data.
+ *
+ * \see NrPointToPointEpcHelper
+ */
+class NrIdealEpcHelper : public NrPointToPointEpcHelper
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrIdealEpcHelper ();
+
+  /**
+   * \brief Destructor
+   */
+  virtual ~NrIdealEpcHelper () override;
+
+  /**
+   *  \brief Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  virtual void AddEnb (Ptr<Node> enbNode, Ptr<NetDevice> lteEnbNetDevice,
+                       std::vector<uint16_t> cellIds) override;
+  virtual uint8_t ActivateEpsBearer (Ptr<NetDevice> ueLteDevice, uint64_t imsi,
+                                     Ptr<EpcTft> tft, EpsBearer bearer) override;
+
+protected:
+  virtual void DoDispose (void) override;
+
+private:
+  /**
+   * \brief The bearers of a UE
+   */
+  struct UeInfo
+  {
+    Ptr<NrUeNetDevice> m_device;     //!< The UE device
+    EpcTftClassifier m_classifier;   //!< The DL TFTs, with the bearer ID as identifier
+  };
+
+  /**
+   * \brief Receive a DL packet from the IP stack of the PGW
+   * \param packet the packet, with its IP header
+   * \param source the source address
+   * \param dest the destination address
+   * \param protocolNumber the protocol number of the packet
+   * \return true
+   */
+  bool RecvFromTunDevice (Ptr<Packet> packet, const Address &source,
+                          const Address &dest, uint16_t protocolNumber);
+
+  /**
+   * \brief Receive an UL packet from the RRC of a gNB
+   * \param packet the packet, with its EpsBearerTag
+   */
+  void RecvFromGnb (Ptr<Packet> packet);
+
+  /**
+   * \brief Give a DL packet to the RRC of a gNB
+   * \param packet the packet
+   * \param gnb the gNB that served the UE when the PGW received the packet
+   * \param rnti the RNTI of the UE in the gNB
+   * \param bid the bearer ID
+   */
+  void SendToGnb (Ptr<Packet> packet, Ptr<NrGnbNetDevice> gnb, uint16_t rnti, uint8_t bid) const;
+
+  /**
+   * \brief Give an UL packet to the IP stack of the PGW
+   * \param packet the packet
+   * \param protocolNumber the protocol number of the packet
+   */
+  void SendToPgw (Ptr<Packet> packet, uint16_t protocolNumber) const;
+
+  Time m_coreDelay;                                   //!< The delay between the PGW and the gNBs
+  Ptr<VirtualNetDevice> m_tunDevice;                  //!< The TUN device of the PGW
+  std::map<uint16_t, Ptr<NrGnbNetDevice>> m_gnbs;     //!< The gNB of each cell ID
+  std::map<uint64_t, UeInfo> m_ues;                   //!< The UEs with a bearer, by IMSI
+  std::map<Ipv4Address, uint64_t> m_imsiByIpv4;       //!< The IMSI of each UE IPv4 address
+  std::map<Ipv6Address, uint64_t> m_imsiByIpv6;       //!< The IMSI of each UE IPv6 address
+};
+
+} // namespace ns3
+
+#endif // NR_IDEAL_EPC_HELPER_H
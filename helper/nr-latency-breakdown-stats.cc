@@ -0,0 +1,206 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-latency-breakdown-stats.h"
+
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/string.h>
+#include <ns3/uinteger.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrLatencyBreakdownStats");
+
+NS_OBJECT_ENSURE_REGISTERED (NrLatencyBreakdownStats);
+
+NrLatencyBreakdownStats::NrLatencyBreakdownStats ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrLatencyBreakdownStats::~NrLatencyBreakdownStats ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+NrLatencyBreakdownStats::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrLatencyBreakdownStats")
+    .SetParent<Object> ()
+    .SetGroupName ("nr")
+    .AddConstructor<NrLatencyBreakdownStats> ()
+    .AddAttribute ("BinWidth",
+                   "Width of the bins of the latency histograms",
+                   TimeValue (MicroSeconds (125)),
+                   MakeTimeAccessor (&NrLatencyBreakdownStats::m_binWidth),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("NumBins",
+                   "Number of bins of the latency histograms. The last one also "
+                   "counts the longer latencies.",
+                   UintegerValue (800),
+                   MakeUintegerAccessor (&NrLatencyBreakdownStats::m_numBins),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("OutputFilename",
+                   "Name of the file of the statistics of each bearer and component",
+                   StringValue ("NrLatencyBreakdown.txt"),
+                   MakeStringAccessor (&NrLatencyBreakdownStats::m_outputFilename),
+                   MakeStringChecker ())
+    .AddAttribute ("HistogramFilename",
+                   "Name of the file of the latency histograms",
+                   StringValue ("NrLatencyBreakdownHistograms.txt"),
+                   MakeStringAccessor (&NrLatencyBreakdownStats::m_histogramFilename),
+                   MakeStringChecker ())
+  ;
+  return tid;
+}
+
+void
+NrLatencyBreakdownStats::Start ()
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::ScheduleDestroy (&NrLatencyBreakdownStats::WriteResults,
+                              Ptr<NrLatencyBreakdownStats> (this));
+}
+
+void
+NrLatencyBreakdownStats::Add (Direction direction, const NrLatencyBreakdown &breakdown)
+{
+  Bearer &bearer = m_bearers[BearerKey (breakdown.m_cellId, breakdown.m_rnti,
+                                        breakdown.m_lcid, direction)];
+  ++bearer.m_pdus;
+  if (breakdown.m_numTx > 1)
+    {
+      ++bearer.m_harqPdus;
+    }
+
+  const std::array<Time, NUM_COMPONENTS> latencies {breakdown.m_queue, breakdown.m_harq,
+                                                    breakdown.m_air, breakdown.m_total};
+  for (uint32_t c = 0; c < NUM_COMPONENTS; ++c)
+    {
+      Histogram &histogram = bearer.m_histograms[c];
+      if (histogram.m_bins.empty ())
+        {
+          histogram.m_bins.resize (m_numBins, 0);
+        }
+      int64_t bin = latencies[c].GetTimeStep () / m_binWidth.GetTimeStep ();
+      ++histogram.m_bins[std::min<int64_t> (std::max<int64_t> (bin, 0), m_numBins - 1)];
+      histogram.m_sum += latencies[c];
+      histogram.m_max = std::max (histogram.m_max, latencies[c]);
+    }
+}
+
+const NrLatencyBreakdownStats::Bearer *
+NrLatencyBreakdownStats::GetBearer (uint16_t cellId, uint16_t rnti, uint8_t lcid,
+                                    Direction direction) const
+{
+  auto it = m_bearers.find (BearerKey (cellId, rnti, lcid, direction));
+  return it != m_bearers.end () ? &it->second : nullptr;
+}
+
+Time
+NrLatencyBreakdownStats::GetPercentile (const Histogram &histogram, double p) const
+{
+  uint64_t count = 0;
+  for (uint32_t bins : histogram.m_bins)
+    {
+      count += bins;
+    }
+  uint64_t rank = static_cast<uint64_t> (std::ceil (p * count));
+  uint64_t cumulative = 0;
+  for (uint32_t i = 0; i < histogram.m_bins.size (); ++i)
+    {
+      cumulative += histogram.m_bins[i];
+      if (cumulative >= rank && cumulative > 0)
+        {
+          return i + 1 < histogram.m_bins.size () ? TimeStep (m_binWidth.GetTimeStep () * (i + 1))
+                                                 : histogram.m_max;
+        }
+    }
+  return Time (0);
+}
+
+void
+NrLatencyBreakdownStats::WriteResults ()
+{
+  NS_LOG_FUNCTION (this);
+  std::ofstream outFile (m_outputFilename.c_str ());
+  std::ofstream histogramFile (m_histogramFilename.c_str ());
+  if (!outFile.is_open () || !histogramFile.is_open ())
+    {
+      NS_LOG_ERROR ("Can't open file " << m_outputFilename << " or " << m_histogramFilename);
+      return;
+    }
+  outFile << "% cellId\tRNTI\tLCID\tdir\tcomponent\tPDUs\tharqPDUs\tmean(ms)\tp50(ms)"
+          << "\tp95(ms)\tp99(ms)\tmax(ms)" << std::endl;
+  histogramFile << "% cellId\tRNTI\tLCID\tdir\tcomponent\tbin(ms)\tcount" << std::endl;
+
+  static const char *names[NUM_COMPONENTS] = {"queue", "harq", "air", "total"};
+  for (const auto &it : m_bearers)
+    {
+      const Bearer &bearer = it.second;
+      std::ostringstream id;
+      id << std::get<0> (it.first) << "\t" << std::get<1> (it.first) << "\t"
+         << +std::get<2> (it.first) << "\t" << (std::get<3> (it.first) == DL ? "DL" : "UL");
+
+      for (uint32_t c = 0; c < NUM_COMPONENTS; ++c)
+        {
+          const Histogram &histogram = bearer.m_histograms[c];
+          outFile << id.str () << "\t" << names[c] << "\t" << bearer.m_pdus << "\t"
+                  << bearer.m_harqPdus << "\t"
+                  << histogram.m_sum.GetSeconds () * 1e3 / bearer.m_pdus << "\t"
+                  << GetPercentile (histogram, 0.5).GetSeconds () * 1e3 << "\t"
+                  << GetPercentile (histogram, 0.95).GetSeconds () * 1e3 << "\t"
+                  << GetPercentile (histogram, 0.99).GetSeconds () * 1e3 << "\t"
+                  << histogram.m_max.GetSeconds () * 1e3 << "\n";
+
+          for (uint32_t i = 0; i < histogram.m_bins.size (); ++i)
+            {
+              if (histogram.m_bins[i] > 0)
+                {
+                  histogramFile << id.str () << "\t" << names[c] << "\t"
+                                << TimeStep (m_binWidth.GetTimeStep () * i).GetSeconds () * 1e3 << "\t"
+                                << histogram.m_bins[i] << "\n";
+                }
+            }
+        }
+    }
+}
+
+void
+NrLatencyBreakdownStats::DlLatencyCallback (Ptr<NrLatencyBreakdownStats> stats,
+                                            [[maybe_unused]] std::string path,
+                                            const NrLatencyBreakdown &breakdown)
+{
+  stats->Add (DL, breakdown);
+}
+
+void
+NrLatencyBreakdownStats::UlLatencyCallback (Ptr<NrLatencyBreakdownStats> stats,
+                                            [[maybe_unused]] std::string path,
+                                            const NrLatencyBreakdown &breakdown)
+{
+  stats->Add (UL, breakdown);
+}
+
+} // namespace ns3
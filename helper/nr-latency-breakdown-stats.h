@@ -0,0 +1,175 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_LATENCY_BREAKDOWN_STATS_H
+#define NR_LATENCY_BREAKDOWN_STATS_H
+
+#include <ns3/object.h>
+#include <ns3/nstime.h>
+#include <ns3/nr-latency-tag.h>
+
+#include <array>
+#include <fstream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup helper
+ * \brief Per-bearer histograms of the components of the latency of the PDUs
+ *
+ * It is fed by the DlLatencyBreakdown trace of NrUeMac and the
+ * UlLatencyBreakdown trace of NrGnbMac, see
+ * NrHelper::EnableLatencyBreakdownStats, and keeps for each cell, RNTI, LC
+ * ID and direction a fixed-bin histogram of each component of the latency
+ * of the PDUs decoded (see NrLatencyTag):
+ * - queue: from the PDCP timestamp of the first SDU of the PDU to its first
+ *   transmission by the MAC, i.e. the RLC queueing and the wait for a grant;
+ * - HARQ: from the first to the last transmission of the PDU;
+ * - air: from the last transmission by the MAC to the decoding, i.e. the
+ *   L1-L2 latency, K0 or K2, and the transmission;
+ * - total: the sum of the three.
+ *
+ * The bins are BinWidth wide, and the last one also counts the longer
+ * latencies. When the simulator is destroyed, OutputFilename gets one line
+ * per bearer and component, with the mean, the percentiles (upper edge of
+ * their bin) and the maximum, and HistogramFilename the non-empty bins.
+ */
+class NrLatencyBreakdownStats : public Object
+{
+public:
+  /**
+   * \brief Direction of the PDUs
+   */
+  enum Direction
+  {
+    DL = 0, //!< Decoded by the UE
+    UL = 1  //!< Decoded by the gNB
+  };
+
+  /**
+   * \brief The components of the latency
+   */
+  enum Component
+  {
+    QUEUE = 0, //!< RLC queueing and wait for a grant
+    HARQ,      //!< HARQ retransmissions
+    AIR,       //!< L1-L2 latency, K0 or K2, and transmission
+    TOTAL,     //!< Sum of the others
+    NUM_COMPONENTS
+  };
+
+  /**
+   * \brief Histogram of a component of the latency
+   */
+  struct Histogram
+  {
+    std::vector<uint32_t> m_bins; //!< Number of PDUs in each bin
+    Time m_sum;                   //!< Sum of the latencies
+    Time m_max;                   //!< Maximum latency
+  };
+
+  /**
+   * \brief The latency of the PDUs of a bearer in a direction
+   */
+  struct Bearer
+  {
+    uint64_t m_pdus {0};       //!< Number of PDUs
+    uint64_t m_harqPdus {0};   //!< Number of PDUs transmitted more than once
+    std::array<Histogram, NUM_COMPONENTS> m_histograms; //!< Histogram of each component
+  };
+
+  NrLatencyBreakdownStats ();
+  ~NrLatencyBreakdownStats () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Write the results when the simulator is destroyed
+   */
+  void Start ();
+
+  /**
+   * \brief Add a decoded PDU
+   * \param direction the direction
+   * \param breakdown the latency breakdown of the PDU
+   */
+  void Add (Direction direction, const NrLatencyBreakdown &breakdown);
+
+  /**
+   * \param cellId the cell ID
+   * \param rnti the RNTI
+   * \param lcid the LC ID
+   * \param direction the direction
+   * \return the latencies of the bearer, or nullptr if none of its PDUs was decoded
+   */
+  const Bearer * GetBearer (uint16_t cellId, uint16_t rnti, uint8_t lcid, Direction direction) const;
+
+  /**
+   * \brief Percentile of a histogram
+   * \param histogram the histogram
+   * \param p the percentile, in (0, 1]
+   * \return the upper edge of the bin of the percentile, the maximum latency
+   * if it is in the last bin, or zero if the histogram is empty
+   */
+  Time GetPercentile (const Histogram &histogram, double p) const;
+
+  /**
+   * \brief Trace sink for the DlLatencyBreakdown trace of NrUeMac
+   * \param stats the stats
+   * \param path the context (unused)
+   * \param breakdown the latency breakdown of the PDU
+   */
+  static void DlLatencyCallback (Ptr<NrLatencyBreakdownStats> stats, std::string path,
+                                 const NrLatencyBreakdown &breakdown);
+
+  /**
+   * \brief Trace sink for the UlLatencyBreakdown trace of NrGnbMac
+   * \param stats the stats
+   * \param path the context (unused)
+   * \param breakdown the latency breakdown of the PDU
+   */
+  static void UlLatencyCallback (Ptr<NrLatencyBreakdownStats> stats, std::string path,
+                                 const NrLatencyBreakdown &breakdown);
+
+private:
+  /**
+   * \brief Write the histograms to the files
+   */
+  void WriteResults ();
+
+  /// The key of a bearer: cell ID, RNTI, LC ID and direction
+  typedef std::tuple<uint16_t, uint16_t, uint8_t, uint8_t> BearerKey;
+
+  std::map<BearerKey, Bearer> m_bearers; //!< Latencies of the bearers, in order
+  Time m_binWidth;                       //!< The `BinWidth` attribute
+  uint32_t m_numBins;                    //!< The `NumBins` attribute
+  std::string m_outputFilename;          //!< The `OutputFilename` attribute
+  std::string m_histogramFilename;       //!< The `HistogramFilename` attribute
+};
+
+} // namespace ns3
+
+#endif // NR_LATENCY_BREAKDOWN_STATS_H
@@ -22,6 +22,7 @@
 #include <ns3/simulator.h>
 #include <stdio.h>
 #include <fstream>
+#include <ns3/enum.h>
 
 namespace ns3 {
 
@@ -29,14 +30,16 @@ NS_LOG_COMPONENT_DEFINE ("NrMacRxTrace");
 
 NS_OBJECT_ENSURE_REGISTERED (NrMacRxTrace);
 
-std::ofstream NrMacRxTrace::m_rxedGnbMacCtrlMsgsFile;
+NrTraceFile::Compression NrMacRxTrace::m_compression = NrTraceFile::NONE;
+
+NrTraceFile NrMacRxTrace::m_rxedGnbMacCtrlMsgsFile;
 std::string NrMacRxTrace::m_rxedGnbMacCtrlMsgsFileName;
-std::ofstream NrMacRxTrace::m_txedGnbMacCtrlMsgsFile;
+NrTraceFile NrMacRxTrace::m_txedGnbMacCtrlMsgsFile;
 std::string NrMacRxTrace::m_txedGnbMacCtrlMsgsFileName;
 
-std::ofstream NrMacRxTrace::m_rxedUeMacCtrlMsgsFile;
+NrTraceFile NrMacRxTrace::m_rxedUeMacCtrlMsgsFile;
 std::string NrMacRxTrace::m_rxedUeMacCtrlMsgsFileName;
-std::ofstream NrMacRxTrace::m_txedUeMacCtrlMsgsFile;
+NrTraceFile NrMacRxTrace::m_txedUeMacCtrlMsgsFile;
 std::string NrMacRxTrace::m_txedUeMacCtrlMsgsFileName;
 
 NrMacRxTrace::NrMacRxTrace ()
@@ -72,10 +75,25 @@ NrMacRxTrace::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::NrMacRxTrace")
     .SetParent<Object> ()
     .AddConstructor<NrMacRxTrace> ()
+    .AddAttribute ("Compression",
+                   "Compression of the files, which get the extension of the "
+                   "format. Zstd falls back to Gzip, and Gzip to None, if the "
+                   "module was built without the library.",
+                   EnumValue (NrTraceFile::NONE),
+                   MakeEnumAccessor (&NrMacRxTrace::SetCompression),
+                   MakeEnumChecker (NrTraceFile::NONE, "None",
+                                    NrTraceFile::GZIP, "Gzip",
+                                    NrTraceFile::ZSTD, "Zstd"))
   ;
   return tid;
 }
 
+void
+NrMacRxTrace::SetCompression (NrTraceFile::Compression compression)
+{
+  m_compression = compression;
+}
+
 void
 NrMacRxTrace::RxedGnbMacCtrlMsgsCallback (Ptr<NrMacRxTrace> macStats, std::string path,
                                               SfnSf sfn, uint16_t nodeId, uint16_t rnti,
@@ -84,7 +102,7 @@ NrMacRxTrace::RxedGnbMacCtrlMsgsCallback (Ptr<NrMacRxTrace> macStats, std::strin
   if (!m_rxedGnbMacCtrlMsgsFile.is_open ())
       {
         m_rxedGnbMacCtrlMsgsFileName = "RxedGnbMacCtrlMsgsTrace.txt";
-        m_rxedGnbMacCtrlMsgsFile.open (m_rxedGnbMacCtrlMsgsFileName.c_str ());
+        m_rxedGnbMacCtrlMsgsFile.open (m_rxedGnbMacCtrlMsgsFileName, m_compression);
         m_rxedGnbMacCtrlMsgsFile << "Time" << "\t" << "Entity" << "\t" <<
                                     "Frame" << "\t" << "SF" << "\t" << "Slot" <<
                                     "\t" << "VarTTI" << "\t" << "nodeId" <<
@@ -139,7 +157,7 @@ NrMacRxTrace::TxedGnbMacCtrlMsgsCallback (Ptr<NrMacRxTrace> macStats, std::strin
   if (!m_txedGnbMacCtrlMsgsFile.is_open ())
       {
         m_txedGnbMacCtrlMsgsFileName = "TxedGnbMacCtrlMsgsTrace.txt";
-        m_txedGnbMacCtrlMsgsFile.open (m_txedGnbMacCtrlMsgsFileName.c_str ());
+        m_txedGnbMacCtrlMsgsFile.open (m_txedGnbMacCtrlMsgsFileName, m_compression);
         m_txedGnbMacCtrlMsgsFile << "Time" << "\t" << "Entity" << "\t" <<
                                     "Frame" << "\t" << "SF" << "\t" << "Slot" <<
                                     "\t" << "VarTTI" "\t" << "nodeId" <<
@@ -183,7 +201,7 @@ NrMacRxTrace::RxedUeMacCtrlMsgsCallback (Ptr<NrMacRxTrace> macStats, std::string
   if (!m_rxedUeMacCtrlMsgsFile.is_open ())
       {
         m_rxedUeMacCtrlMsgsFileName = "RxedUeMacCtrlMsgsTrace.txt";
-        m_rxedUeMacCtrlMsgsFile.open (m_rxedUeMacCtrlMsgsFileName.c_str ());
+        m_rxedUeMacCtrlMsgsFile.open (m_rxedUeMacCtrlMsgsFileName, m_compression);
         m_rxedUeMacCtrlMsgsFile << "Time" << "\t" << "Entity" << "\t" <<
                                    "Frame" << "\t" << "SF" << "\t" << "Slot" <<
                                    "\t" << "VarTTI" << "\t" << "nodeId" <<
@@ -230,7 +248,7 @@ NrMacRxTrace::TxedUeMacCtrlMsgsCallback (Ptr<NrMacRxTrace> macStats, std::string
   if (!m_txedUeMacCtrlMsgsFile.is_open ())
       {
         m_txedUeMacCtrlMsgsFileName = "TxedUeMacCtrlMsgsTrace.txt";
-        m_txedUeMacCtrlMsgsFile.open (m_txedUeMacCtrlMsgsFileName.c_str ());
+        m_txedUeMacCtrlMsgsFile.open (m_txedUeMacCtrlMsgsFileName, m_compression);
         m_txedUeMacCtrlMsgsFile << "Time" << "\t" << "Entity" << "\t" <<
                                    "Frame" << "\t" << "SF" <<
                                    "\t" << "Slot" << "\t" << "VarTTI" <<
@@ -25,6 +25,7 @@
 #include <ns3/nr-phy-mac-common.h>
 #include <ns3/nr-control-messages.h>
 #include <ns3/nr-gnb-mac.h>
+#include <ns3/nr-trace-file.h>
 #include <iostream>
 
 namespace ns3 {
@@ -100,16 +101,27 @@ public:
                                          SfnSf sfn, uint16_t nodeId, uint16_t rnti,
                                          uint8_t bwpId, Ptr<const NrControlMessage> msg);
 
+  /**
+   * \brief Set the compression of the files
+   *
+   * It is used for the files opened after the call, that get the extension
+   * of the compression.
+   *
+   * \param compression the compression
+   */
+  void SetCompression (NrTraceFile::Compression compression);
+
 private:
+  static NrTraceFile::Compression m_compression; //!< The `Compression` attribute.
 
-  static std::ofstream m_rxedGnbMacCtrlMsgsFile;
+  static NrTraceFile m_rxedGnbMacCtrlMsgsFile;
   static std::string m_rxedGnbMacCtrlMsgsFileName;
-  static std::ofstream m_txedGnbMacCtrlMsgsFile;
+  static NrTraceFile m_txedGnbMacCtrlMsgsFile;
   static std::string m_txedGnbMacCtrlMsgsFileName;
 
-  static std::ofstream m_rxedUeMacCtrlMsgsFile;
+  static NrTraceFile m_rxedUeMacCtrlMsgsFile;
   static std::string m_rxedUeMacCtrlMsgsFileName;
-  static std::ofstream m_txedUeMacCtrlMsgsFile;
+  static NrTraceFile m_txedUeMacCtrlMsgsFile;
   static std::string m_txedUeMacCtrlMsgsFileName;
 };
 
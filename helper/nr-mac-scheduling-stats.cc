@@ -19,10 +19,13 @@
  */
 
 #include "ns3/string.h"
+#include "ns3/enum.h"
 #include <ns3/simulator.h>
 #include <ns3/log.h>
 #include "nr-mac-scheduling-stats.h"
 
+#include <algorithm>
+
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("NrMacSchedulingStats");
@@ -59,10 +62,55 @@ NrMacSchedulingStats::GetTypeId (void)
                    StringValue ("NrUlMacStats.txt"),
                    MakeStringAccessor (&NrMacSchedulingStats::SetUlOutputFilename),
                    MakeStringChecker ())
+    .AddAttribute ("Compression",
+                   "Compression of the output files, which get the extension of "
+                   "the format. Zstd falls back to Gzip, and Gzip to None, if the "
+                   "module was built without the library.",
+                   EnumValue (NrTraceFile::NONE),
+                   MakeEnumAccessor (&NrMacSchedulingStats::m_compression),
+                   MakeEnumChecker (NrTraceFile::NONE, "None",
+                                    NrTraceFile::GZIP, "Gzip",
+                                    NrTraceFile::ZSTD, "Zstd"))
+    .AddAttribute ("Mode",
+                   "Output of the statistics: one line per allocation, per-slot "
+                   "totals and periodic per-UE summaries, or both.",
+                   EnumValue (NrMacSchedulingStats::PER_ALLOCATION),
+                   MakeEnumAccessor (&NrMacSchedulingStats::m_mode),
+                   MakeEnumChecker (NrMacSchedulingStats::PER_ALLOCATION, "PerAllocation",
+                                    NrMacSchedulingStats::AGGREGATED, "Aggregated",
+                                    NrMacSchedulingStats::BOTH, "Both"))
+    .AddAttribute ("SummaryInterval",
+                   "Interval of the per-UE summaries of the aggregated mode. "
+                   "With zero, one summary of the whole simulation is written "
+                   "when the simulator is destroyed.",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&NrMacSchedulingStats::m_summaryInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("SlotOutputFilename",
+                   "Name of the file of the per-slot totals of the aggregated mode.",
+                   StringValue ("NrMacSlotStats.txt"),
+                   MakeStringAccessor (&NrMacSchedulingStats::m_slotOutputFilename),
+                   MakeStringChecker ())
+    .AddAttribute ("UeOutputFilename",
+                   "Name of the file of the per-UE summaries of the aggregated mode.",
+                   StringValue ("NrMacUeStats.txt"),
+                   MakeStringAccessor (&NrMacSchedulingStats::m_ueOutputFilename),
+                   MakeStringChecker ())
   ;
   return tid;
 }
 
+void
+NrMacSchedulingStats::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_summaryEvent.Cancel ();
+  WriteAggregatedResults ();
+  m_slotOutFile.close ();
+  m_ueOutFile.close ();
+  NrStatsCalculator::DoDispose ();
+}
+
 void
 NrMacSchedulingStats::SetUlOutputFilename (std::string outputFilename)
 {
@@ -92,12 +140,20 @@ NrMacSchedulingStats::DlScheduling (uint16_t cellId, uint64_t imsi, const NrSche
 {
   NS_LOG_FUNCTION (this << cellId << imsi << traceInfo.m_frameNum << traceInfo.m_subframeNum <<
                    traceInfo.m_rnti << (uint32_t) traceInfo.m_mcs << traceInfo.m_tbSize);
+  if (m_mode != PER_ALLOCATION)
+    {
+      Aggregate (true, cellId, imsi, traceInfo);
+      if (m_mode == AGGREGATED)
+        {
+          return;
+        }
+    }
   NS_LOG_INFO ("Write DL Mac Stats in " << GetDlOutputFilename ().c_str ());
 
-  std::ofstream outFile;
+  NrTraceFile &outFile = m_dlOutFile;
   if ( m_dlFirstWrite == true )
     {
-      outFile.open (GetDlOutputFilename ().c_str ());
+      outFile.open (GetDlOutputFilename (), m_compression);
       if (!outFile.is_open ())
         {
           NS_LOG_ERROR ("Can't open file " << GetDlOutputFilename ().c_str ());
@@ -107,15 +163,6 @@ NrMacSchedulingStats::DlScheduling (uint16_t cellId, uint64_t imsi, const NrSche
       outFile << "% time(s)\tcellId\tbwpId\tIMSI\tRNTI\tframe\tsframe\tslot\tsymStart\tnumSym\tstream\tharqId\tndi\trv\tmcs\ttbSize";
       outFile << std::endl;
     }
-  else
-    {
-      outFile.open (GetDlOutputFilename ().c_str (),  std::ios_base::app);
-      if (!outFile.is_open ())
-        {
-          NS_LOG_ERROR ("Can't open file " << GetDlOutputFilename ().c_str ());
-          return;
-        }
-    }
 
   outFile << Simulator::Now ().GetSeconds () << "\t";
   outFile << (uint32_t) cellId << "\t";
@@ -133,7 +180,6 @@ NrMacSchedulingStats::DlScheduling (uint16_t cellId, uint64_t imsi, const NrSche
   outFile << (uint32_t) traceInfo.m_rv << "\t";
   outFile << (uint32_t) traceInfo.m_mcs << "\t";
   outFile << traceInfo.m_tbSize << std::endl;
-  outFile.close ();
 }
 
 void
@@ -141,12 +187,20 @@ NrMacSchedulingStats::UlScheduling (uint16_t cellId, uint64_t imsi, const NrSche
 {
   NS_LOG_FUNCTION (this << cellId << imsi << traceInfo.m_frameNum << traceInfo.m_subframeNum
                         << traceInfo.m_rnti << (uint32_t) traceInfo.m_mcs << traceInfo.m_tbSize);
+  if (m_mode != PER_ALLOCATION)
+    {
+      Aggregate (false, cellId, imsi, traceInfo);
+      if (m_mode == AGGREGATED)
+        {
+          return;
+        }
+    }
   NS_LOG_INFO ("Write UL Mac Stats in " << GetUlOutputFilename ().c_str ());
 
-  std::ofstream outFile;
+  NrTraceFile &outFile = m_ulOutFile;
   if ( m_ulFirstWrite == true )
     {
-      outFile.open (GetUlOutputFilename ().c_str ());
+      outFile.open (GetUlOutputFilename (), m_compression);
       if (!outFile.is_open ())
         {
           NS_LOG_ERROR ("Can't open file " << GetUlOutputFilename ().c_str ());
@@ -156,15 +210,6 @@ NrMacSchedulingStats::UlScheduling (uint16_t cellId, uint64_t imsi, const NrSche
       outFile << "% time(s)\tcellId\tbwpId\tIMSI\tRNTI\tframe\tsframe\tslot\tsymStart\tnumSym\tstream\tharqId\tndi\trv\tmcs\ttbSize";
       outFile << std::endl;
     }
-  else
-    {
-      outFile.open (GetUlOutputFilename ().c_str (),  std::ios_base::app);
-      if (!outFile.is_open ())
-        {
-          NS_LOG_ERROR ("Can't open file " << GetUlOutputFilename ().c_str ());
-          return;
-        }
-    }
 
   outFile << Simulator::Now ().GetSeconds () << "\t";
   outFile << (uint32_t) cellId << "\t";
@@ -182,7 +227,185 @@ NrMacSchedulingStats::UlScheduling (uint16_t cellId, uint64_t imsi, const NrSche
   outFile << (uint32_t) traceInfo.m_rv << "\t";
   outFile << (uint32_t) traceInfo.m_mcs << "\t";
   outFile << traceInfo.m_tbSize << std::endl;
-  outFile.close ();
+}
+
+void
+NrMacSchedulingStats::AddToTotals (Totals &totals, const NrSchedulingCallbackInfo &traceInfo)
+{
+  ++totals.m_allocations;
+  totals.m_rbgs += traceInfo.m_numRbg;
+  totals.m_bytes += traceInfo.m_tbSize;
+  totals.m_mcsSum += traceInfo.m_mcs;
+  if (traceInfo.m_ndi == 1)
+    {
+      ++totals.m_newTbs;
+    }
+  else
+    {
+      ++totals.m_harqTbs;
+    }
+}
+
+void
+NrMacSchedulingStats::Aggregate (bool isDl, uint16_t cellId, uint64_t imsi,
+                                 const NrSchedulingCallbackInfo &traceInfo)
+{
+  NS_LOG_FUNCTION (this << isDl << cellId << imsi);
+  if (traceInfo.m_tbSize == 0)
+    {
+      return; // Stream without TB
+    }
+
+  if (!m_aggregationStarted)
+    {
+      m_aggregationStarted = true;
+      m_summaryStart = Simulator::Now ();
+      if (m_summaryInterval.IsStrictlyPositive ())
+        {
+          m_summaryEvent = Simulator::Schedule (m_summaryInterval,
+                                                &NrMacSchedulingStats::WriteUeSummary, this);
+        }
+      // The last slots and summary are written when the simulator is destroyed
+      Simulator::ScheduleDestroy (&NrMacSchedulingStats::WriteAggregatedResults,
+                                  Ptr<NrMacSchedulingStats> (this));
+    }
+
+  uint32_t key = (static_cast<uint32_t> (cellId) << 16)
+    | (static_cast<uint32_t> (traceInfo.m_bwpId) << 1) | (isDl ? 0 : 1);
+
+  // All the allocations of a slot are notified together: a new slot number
+  // closes the previous slot
+  SlotTotals &slot = m_slots[key];
+  if (slot.m_frameNum != traceInfo.m_frameNum || slot.m_subframeNum != traceInfo.m_subframeNum
+      || slot.m_slotNum != traceInfo.m_slotNum)
+    {
+      WriteSlot (key, slot);
+      slot.m_frameNum = traceInfo.m_frameNum;
+      slot.m_subframeNum = traceInfo.m_subframeNum;
+      slot.m_slotNum = traceInfo.m_slotNum;
+      slot.m_time = Simulator::Now ();
+    }
+  if (std::find (slot.m_rntis.begin (), slot.m_rntis.end (), traceInfo.m_rnti) == slot.m_rntis.end ())
+    {
+      slot.m_rntis.push_back (traceInfo.m_rnti);
+    }
+  AddToTotals (slot.m_totals, traceInfo);
+
+  auto &ue = m_ueTotals[std::make_pair (key, imsi)];
+  ue.first = traceInfo.m_rnti;
+  AddToTotals (ue.second, traceInfo);
+}
+
+void
+NrMacSchedulingStats::WriteTotals (std::ostream &outFile, const Totals &totals)
+{
+  outFile << totals.m_allocations << "\t";
+  outFile << totals.m_rbgs << "\t";
+  outFile << totals.m_bytes << "\t";
+  outFile << static_cast<double> (totals.m_mcsSum) / totals.m_allocations << "\t";
+  outFile << totals.m_newTbs << "\t";
+  outFile << totals.m_harqTbs;
+}
+
+void
+NrMacSchedulingStats::WriteSlot (uint32_t key, SlotTotals &slot)
+{
+  if (slot.m_totals.m_allocations == 0)
+    {
+      return;
+    }
+
+  if (!m_slotOutFile.is_open ())
+    {
+      m_slotOutFile.open (m_slotOutputFilename, m_compression);
+      if (!m_slotOutFile.is_open ())
+        {
+          NS_LOG_ERROR ("Can't open file " << m_slotOutputFilename);
+          return;
+        }
+      m_slotOutFile << "% time(s)\tcellId\tbwpId\tdirection\tframe\tsframe\tslot\tnumUe"
+                       "\tnumAlloc\tnumRbg\tbytes\tmeanMcs\tnewTb\tharqTb" << std::endl;
+    }
+
+  m_slotOutFile << slot.m_time.GetSeconds () << "\t";
+  m_slotOutFile << (key >> 16) << "\t";
+  m_slotOutFile << ((key >> 1) & 0xFF) << "\t";
+  m_slotOutFile << ((key & 1) ? "UL" : "DL") << "\t";
+  m_slotOutFile << slot.m_frameNum << "\t";
+  m_slotOutFile << (uint32_t) slot.m_subframeNum << "\t";
+  m_slotOutFile << slot.m_slotNum << "\t";
+  m_slotOutFile << slot.m_rntis.size () << "\t";
+  WriteTotals (m_slotOutFile, slot.m_totals);
+  m_slotOutFile << "\n";
+
+  slot.m_rntis.clear ();
+  slot.m_totals = Totals ();
+}
+
+void
+NrMacSchedulingStats::WriteUeSummary ()
+{
+  NS_LOG_FUNCTION (this);
+  Time interval = Simulator::Now () - m_summaryStart;
+
+  if (!m_ueTotals.empty () && !m_ueOutFile.is_open ())
+    {
+      m_ueOutFile.open (m_ueOutputFilename, m_compression);
+      if (!m_ueOutFile.is_open ())
+        {
+          NS_LOG_ERROR ("Can't open file " << m_ueOutputFilename);
+          m_ueTotals.clear ();
+        }
+      else
+        {
+          m_ueOutFile << "% time(s)\tcellId\tbwpId\tdirection\tIMSI\tRNTI"
+                         "\tnumAlloc\tnumRbg\tbytes\tmeanMcs\tnewTb\tharqTb\tthroughput(Mbps)"
+                      << std::endl;
+        }
+    }
+
+  for (const auto &it : m_ueTotals)
+    {
+      uint32_t key = it.first.first;
+      const Totals &totals = it.second.second;
+      m_ueOutFile << Simulator::Now ().GetSeconds () << "\t";
+      m_ueOutFile << (key >> 16) << "\t";
+      m_ueOutFile << ((key >> 1) & 0xFF) << "\t";
+      m_ueOutFile << ((key & 1) ? "UL" : "DL") << "\t";
+      m_ueOutFile << it.first.second << "\t";
+      m_ueOutFile << it.second.first << "\t";
+      WriteTotals (m_ueOutFile, totals);
+      m_ueOutFile << "\t";
+      m_ueOutFile << (interval.IsStrictlyPositive ()
+                      ? totals.m_bytes * 8.0 / interval.GetSeconds () / 1e6 : 0.0);
+      m_ueOutFile << "\n";
+    }
+
+  m_ueTotals.clear ();
+  m_summaryStart = Simulator::Now ();
+  if (m_summaryInterval.IsStrictlyPositive ())
+    {
+      m_summaryEvent = Simulator::Schedule (m_summaryInterval,
+                                            &NrMacSchedulingStats::WriteUeSummary, this);
+    }
+}
+
+void
+NrMacSchedulingStats::WriteAggregatedResults ()
+{
+  NS_LOG_FUNCTION (this);
+  for (auto &it : m_slots)
+    {
+      WriteSlot (it.first, it.second);
+    }
+  m_summaryEvent.Cancel ();
+  if (!m_ueTotals.empty ())
+    {
+      WriteUeSummary ();
+      m_summaryEvent.Cancel ();
+    }
+  m_slotOutFile.flush ();
+  m_ueOutFile.flush ();
 }
 
 void
@@ -249,5 +472,36 @@ NrMacSchedulingStats::UlSchedulingCallback (Ptr<NrMacSchedulingStats> macStats,
   macStats->UlScheduling (cellId, imsi, traceInfo);
 }
 
+void
+NrMacSchedulingStats::SetTraceFilter (const NrTraceFilter &filter)
+{
+  NS_LOG_FUNCTION (this);
+  m_traceFilter = filter;
+}
+
+void
+NrMacSchedulingStats::DlSchedulingCellCallback (Ptr<NrMacSchedulingStats> macStats, uint16_t cellId,
+                                                NrSchedulingCallbackInfo traceInfo)
+{
+  NS_LOG_FUNCTION (macStats << cellId);
+  uint64_t imsi = macStats->GetImsi (cellId, traceInfo.m_rnti);
+  if (macStats->m_traceFilter.SelectsImsi (imsi))
+    {
+      macStats->DlScheduling (cellId, imsi, traceInfo);
+    }
+}
+
+void
+NrMacSchedulingStats::UlSchedulingCellCallback (Ptr<NrMacSchedulingStats> macStats, uint16_t cellId,
+                                                NrSchedulingCallbackInfo traceInfo)
+{
+  NS_LOG_FUNCTION (macStats << cellId);
+  uint64_t imsi = macStats->GetImsi (cellId, traceInfo.m_rnti);
+  if (macStats->m_traceFilter.SelectsImsi (imsi))
+    {
+      macStats->UlScheduling (cellId, imsi, traceInfo);
+    }
+}
+
 
 } // namespace ns3
@@ -23,10 +23,16 @@
 
 #include "ns3/nr-stats-calculator.h"
 #include "ns3/nstime.h"
+#include "ns3/event-id.h"
 #include "ns3/uinteger.h"
 #include <string>
 #include <fstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
 #include "ns3/nr-gnb-mac.h"
+#include "ns3/nr-trace-file.h"
+#include "ns3/nr-trace-filter.h"
 
 namespace ns3 {
 
@@ -45,10 +51,33 @@ namespace ns3 {
  *   - Stream id
  *   - MCS
  *   - Size of transport block
+ *
+ * With many UEs, this is hundreds of lines per slot and cell. The attribute
+ * Mode selects instead, or in addition, an aggregated output:
+ *   - SlotOutputFilename: one line per slot, cell, BWP and direction, with
+ *     the number of scheduled UEs, of allocations, of RBGs, the bytes, the
+ *     mean MCS, and the number of new and of HARQ retransmitted TBs;
+ *   - UeOutputFilename: every SummaryInterval, one line per UE scheduled in
+ *     the interval, BWP and direction, with the same totals and the
+ *     scheduled throughput.
+ *
+ * The totals of a slot are written when the next slot of the same cell, BWP
+ * and direction is scheduled, and the remaining ones when the simulator is
+ * destroyed.
  */
 class NrMacSchedulingStats : public NrStatsCalculator
 {
 public:
+  /**
+   * \brief The output of the scheduling statistics
+   */
+  enum Mode
+  {
+    PER_ALLOCATION, //!< One line per allocation
+    AGGREGATED,     //!< Per-slot totals and periodic per-UE summaries
+    BOTH            //!< Both outputs
+  };
+
   /**
    * Constructor
    */
@@ -130,7 +159,112 @@ public:
    */
   static void UlSchedulingCallback (Ptr<NrMacSchedulingStats> macStats, std::string path, NrSchedulingCallbackInfo traceInfo);
 
+  /**
+   * Trace sink for the ns3::NrGnbMac::DlScheduling trace source, connected
+   * without context
+   *
+   * The IMSI is taken from the table kept by ConnectRrc, that must be
+   * called for the cell.
+   *
+   * \param macStats the pointer to the MAC stats
+   * \param cellId the cell ID of the gNB
+   * \param traceInfo NrSchedulingCallbackInfo structure containing all downlink
+   *        information that is generated when DlScheduling trace is fired
+   */
+  static void DlSchedulingCellCallback (Ptr<NrMacSchedulingStats> macStats, uint16_t cellId, NrSchedulingCallbackInfo traceInfo);
+
+  /**
+   * Trace sink for the ns3::NrGnbMac::UlScheduling trace source, connected
+   * without context
+   *
+   * \see DlSchedulingCellCallback
+   *
+   * \param macStats the pointer to the MAC stats
+   * \param cellId the cell ID of the gNB
+   * \param traceInfo - all the traces information in a single structure
+   */
+  static void UlSchedulingCellCallback (Ptr<NrMacSchedulingStats> macStats, uint16_t cellId, NrSchedulingCallbackInfo traceInfo);
+
+  /**
+   * \brief Set the UEs written by DlSchedulingCellCallback and UlSchedulingCellCallback
+   *
+   * Only the IMSI part of the filter is used: the cells and the BWPs are
+   * selected by connecting only their trace sources.
+   *
+   * \param filter the filter
+   */
+  void SetTraceFilter (const NrTraceFilter &filter);
+
+protected:
+  void DoDispose () override;
+
 private:
+  /**
+   * \brief Totals of the allocations of a slot, or of a UE in a summary interval
+   */
+  struct Totals
+  {
+    uint32_t m_allocations {0}; //!< Number of allocations
+    uint64_t m_rbgs {0};        //!< Sum of the RBGs of the allocations
+    uint64_t m_bytes {0};       //!< Sum of the TB sizes
+    uint64_t m_mcsSum {0};      //!< Sum of the MCS
+    uint32_t m_newTbs {0};      //!< Number of new TBs
+    uint32_t m_harqTbs {0};     //!< Number of HARQ retransmitted TBs
+  };
+
+  /**
+   * \brief Totals of the slot being scheduled in a cell, BWP and direction
+   */
+  struct SlotTotals
+  {
+    uint16_t m_frameNum {UINT16_MAX}; //!< Frame number
+    uint8_t m_subframeNum {0};        //!< Subframe number
+    uint16_t m_slotNum {0};           //!< Slot number
+    Time m_time;                      //!< Time of the first allocation
+    std::vector<uint16_t> m_rntis;    //!< RNTIs scheduled in the slot
+    Totals m_totals;                  //!< Totals of the allocations
+  };
+
+  /**
+   * \brief Add an allocation to the per-slot and per-UE totals
+   * \param isDl true for the DL, false for the UL
+   * \param cellId the cell ID
+   * \param imsi the IMSI of the UE
+   * \param traceInfo the allocation
+   */
+  void Aggregate (bool isDl, uint16_t cellId, uint64_t imsi, const NrSchedulingCallbackInfo &traceInfo);
+
+  /**
+   * \brief Write the totals of a slot, and clear them
+   * \param key the cell, BWP and direction of the slot
+   * \param slot the totals of the slot
+   */
+  void WriteSlot (uint32_t key, SlotTotals &slot);
+
+  /**
+   * \brief Write the per-UE totals of the summary interval, and clear them
+   */
+  void WriteUeSummary ();
+
+  /**
+   * \brief Write the totals of the slots not written yet, and the last summary
+   */
+  void WriteAggregatedResults ();
+
+  /**
+   * \brief Write the common columns of a line of the aggregated files
+   * \param outFile the file
+   * \param totals the totals to write
+   */
+  static void WriteTotals (std::ostream &outFile, const Totals &totals);
+
+  /**
+   * \brief Add an allocation to totals
+   * \param totals the totals
+   * \param traceInfo the allocation
+   */
+  static void AddToTotals (Totals &totals, const NrSchedulingCallbackInfo &traceInfo);
+
   /**
    * When writing DL MAC statistics first time to file,
    * columns description is added. Then next lines are
@@ -147,6 +281,24 @@ private:
    */
   bool m_ulFirstWrite;
 
+  NrTraceFile m_dlOutFile; //!< DL output file, open from the first write
+  NrTraceFile m_ulOutFile; //!< UL output file, open from the first write
+  NrTraceFile::Compression m_compression {NrTraceFile::NONE}; //!< The `Compression` attribute
+  NrTraceFilter m_traceFilter; //!< UEs written by the cell callbacks
+
+  Mode m_mode {PER_ALLOCATION}; //!< The `Mode` attribute
+  Time m_summaryInterval;       //!< The `SummaryInterval` attribute
+  std::string m_slotOutputFilename; //!< The `SlotOutputFilename` attribute
+  std::string m_ueOutputFilename;   //!< The `UeOutputFilename` attribute
+  NrTraceFile m_slotOutFile;    //!< Per-slot file, open from the first write
+  NrTraceFile m_ueOutFile;      //!< Per-UE file, open from the first write
+  bool m_aggregationStarted {false}; //!< True after the first aggregated allocation
+  Time m_summaryStart;          //!< Start of the current summary interval
+  EventId m_summaryEvent;       //!< Event of the end of the summary interval
+  /// Slot being scheduled, by cell, BWP and direction
+  std::unordered_map<uint32_t, SlotTotals> m_slots;
+  /// Totals of the summary interval, by cell, BWP, direction and IMSI, in order
+  std::map<std::pair<uint32_t, uint64_t>, std::pair<uint16_t, Totals>> m_ueTotals;
 };
 
 } // namespace ns3
@@ -0,0 +1,474 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-metrics-exporter.h"
+
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/string.h>
+#include <ns3/uinteger.h>
+#include <ns3/nr-gnb-net-device.h>
+#include <ns3/nr-gnb-mac.h>
+#include <ns3/nr-mac-scheduler-ns3.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrMetricsExporter");
+
+NS_OBJECT_ENSURE_REGISTERED (NrMetricsExporter);
+
+NrMetricsExporter::NrMetricsExporter ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrMetricsExporter::~NrMetricsExporter ()
+{
+  NS_LOG_FUNCTION (this);
+  Stop ();
+}
+
+TypeId
+NrMetricsExporter::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrMetricsExporter")
+    .SetParent<Object> ()
+    .SetGroupName ("nr")
+    .AddConstructor<NrMetricsExporter> ()
+    .AddAttribute ("Interval",
+                   "Wall-clock time between two samples",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&NrMetricsExporter::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("ProbePeriod",
+                   "Simulation time between two checks of the wall clock",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&NrMetricsExporter::m_probePeriod),
+                   MakeTimeChecker (NanoSeconds (1)))
+    .AddAttribute ("OutputFilename",
+                   "Name of the file replaced by each sample. Empty to write no file.",
+                   StringValue ("NrMetrics.prom"),
+                   MakeStringAccessor (&NrMetricsExporter::m_outputFilename),
+                   MakeStringChecker ())
+    .AddAttribute ("Port",
+                   "TCP port of 127.0.0.1 where the last sample is served over "
+                   "HTTP. Zero to not serve it.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrMetricsExporter::m_port),
+                   MakeUintegerChecker<uint16_t> ())
+  ;
+  return tid;
+}
+
+void
+NrMetricsExporter::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_probeEvent.Cancel ();
+  Stop ();
+  m_cells.clear ();
+  Object::DoDispose ();
+}
+
+void
+NrMetricsExporter::AddGnb (const Ptr<NrGnbNetDevice> &gnb)
+{
+  NS_LOG_FUNCTION (this << gnb);
+  for (uint32_t bwp = 0; bwp < gnb->GetCcMapSize (); ++bwp)
+    {
+      uint32_t index = static_cast<uint32_t> (m_cells.size ());
+      CellActivity cell;
+      cell.m_cellId = gnb->GetCellId ();
+      cell.m_bwpId = static_cast<uint16_t> (bwp);
+      cell.m_scheduler = DynamicCast<NrMacSchedulerNs3> (gnb->GetScheduler (static_cast<uint8_t> (bwp)));
+      m_cells.push_back (cell);
+
+      Ptr<NrGnbMac> mac = gnb->GetMac (static_cast<uint8_t> (bwp));
+      mac->TraceConnectWithoutContext ("DlScheduling",
+                                       MakeBoundCallback (&NrMetricsExporter::DlSchedulingCallback,
+                                                          Ptr<NrMetricsExporter> (this), index));
+      mac->TraceConnectWithoutContext ("UlScheduling",
+                                       MakeBoundCallback (&NrMetricsExporter::UlSchedulingCallback,
+                                                          Ptr<NrMetricsExporter> (this), index));
+    }
+}
+
+void
+NrMetricsExporter::Start ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_writer.joinable (), "The metrics exporter is already started");
+
+  int server = -1;
+  if (m_port > 0)
+    {
+      server = OpenServer ();
+      if (server < 0)
+        {
+          NS_LOG_ERROR ("Can't serve the metrics on the port " << m_port);
+        }
+    }
+
+  m_wallStart = std::chrono::steady_clock::now ();
+  m_lastSampleWall = m_wallStart;
+  m_lastSampleSim = Simulator::Now ();
+  m_lastSampleEvents = Simulator::GetEventCount ();
+  m_stop = false;
+  // The writer thread serves the socket between the samples, and closes it
+  m_serverSocket = server;
+  m_writer = std::thread ([this, server] () {
+    WriterLoop ();
+    if (server >= 0)
+      {
+        close (server);
+      }
+  });
+
+  m_probeEvent = Simulator::Schedule (m_probePeriod, &NrMetricsExporter::Probe, this);
+  // The last sample is taken, and written, when the simulator is destroyed
+  Simulator::ScheduleDestroy (&NrMetricsExporter::Sample, Ptr<NrMetricsExporter> (this));
+  Simulator::ScheduleDestroy (&NrMetricsExporter::Stop, Ptr<NrMetricsExporter> (this));
+}
+
+void
+NrMetricsExporter::Probe ()
+{
+  auto now = std::chrono::steady_clock::now ();
+  if (now - m_lastSampleWall >= std::chrono::nanoseconds (m_interval.GetNanoSeconds ()))
+    {
+      Sample ();
+    }
+  m_probeEvent = Simulator::Schedule (m_probePeriod, &NrMetricsExporter::Probe, this);
+}
+
+void
+NrMetricsExporter::AddAllocation (uint32_t index, bool isDl, const NrSchedulingCallbackInfo &info)
+{
+  if (info.m_tbSize == 0)
+    {
+      return; // Stream without TB
+    }
+  CellActivity &cell = m_cells[index];
+  uint32_t dir = isDl ? 0 : 1;
+  cell.m_rntis[dir].insert (info.m_rnti);
+  cell.m_bytes[dir] += info.m_tbSize;
+  if (info.m_ndi == 1)
+    {
+      ++cell.m_newTbs[dir];
+    }
+  else
+    {
+      ++cell.m_retxTbs[dir];
+    }
+}
+
+void
+NrMetricsExporter::DlSchedulingCallback (Ptr<NrMetricsExporter> exporter, uint32_t index,
+                                         NrSchedulingCallbackInfo info)
+{
+  exporter->AddAllocation (index, true, info);
+}
+
+void
+NrMetricsExporter::UlSchedulingCallback (Ptr<NrMetricsExporter> exporter, uint32_t index,
+                                         NrSchedulingCallbackInfo info)
+{
+  exporter->AddAllocation (index, false, info);
+}
+
+void
+NrMetricsExporter::Sample ()
+{
+  NS_LOG_FUNCTION (this);
+  auto now = std::chrono::steady_clock::now ();
+  double wall = std::chrono::duration<double> (now - m_lastSampleWall).count ();
+  double sim = (Simulator::Now () - m_lastSampleSim).GetSeconds ();
+
+  SampleValues sample;
+  sample.m_simTime = Simulator::Now ().GetSeconds ();
+  sample.m_wallTime = std::chrono::duration<double> (now - m_wallStart).count ();
+  sample.m_events = Simulator::GetEventCount ();
+  if (wall > 0)
+    {
+      sample.m_eventRate = (sample.m_events - m_lastSampleEvents) / wall;
+      sample.m_speed = sim / wall;
+    }
+
+  sample.m_cells.reserve (m_cells.size ());
+  for (CellActivity &cell : m_cells)
+    {
+      CellSample values;
+      values.m_cellId = cell.m_cellId;
+      values.m_bwpId = cell.m_bwpId;
+      if (cell.m_scheduler != nullptr)
+        {
+          values.m_attachedUes = cell.m_scheduler->GetNumberOfUes ();
+          values.m_buffered = {cell.m_scheduler->GetBufferedBytes (true),
+                               cell.m_scheduler->GetBufferedBytes (false)};
+        }
+      for (uint32_t dir = 0; dir < 2; ++dir)
+        {
+          values.m_activeUes[dir] = static_cast<uint32_t> (cell.m_rntis[dir].size ());
+          values.m_throughput[dir] = sim > 0 ? cell.m_bytes[dir] * 8.0 / sim : 0.0;
+          uint64_t tbs = cell.m_newTbs[dir] + cell.m_retxTbs[dir];
+          values.m_retxRatio[dir] = tbs > 0 ? static_cast<double> (cell.m_retxTbs[dir]) / tbs : 0.0;
+          cell.m_rntis[dir].clear ();
+        }
+      cell.m_bytes = {};
+      cell.m_newTbs = {};
+      cell.m_retxTbs = {};
+      sample.m_cells.push_back (values);
+    }
+
+  if (NrCounters::IsEnabled ())
+    {
+      sample.m_counters = NrCounters::GetSnapshot ();
+    }
+
+  m_lastSampleWall = now;
+  m_lastSampleSim = Simulator::Now ();
+  m_lastSampleEvents = sample.m_events;
+
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_sample = std::move (sample);
+    m_pending = true;
+  }
+  m_cv.notify_one ();
+}
+
+std::string
+NrMetricsExporter::GetText () const
+{
+  std::lock_guard<std::mutex> lock (m_mutex);
+  return m_text;
+}
+
+std::string
+NrMetricsExporter::Format (const SampleValues &sample)
+{
+  std::ostringstream os;
+  os.precision (12);
+  auto family = [&os] (const char *name, const char *type, const char *help)
+  {
+    os << "# TYPE " << name << " " << type << "\n# HELP " << name << " " << help << "\n";
+  };
+
+  family ("nr_simulation_time_seconds", "gauge", "Simulation time");
+  os << "nr_simulation_time_seconds " << sample.m_simTime << "\n";
+  family ("nr_wall_time_seconds", "gauge", "Wall-clock time since the start of the exporter");
+  os << "nr_wall_time_seconds " << sample.m_wallTime << "\n";
+  family ("nr_simulator_events", "counter", "Events run by the simulator");
+  os << "nr_simulator_events_total " << sample.m_events << "\n";
+  family ("nr_simulator_event_rate", "gauge", "Events per wall-clock second since the last sample");
+  os << "nr_simulator_event_rate " << sample.m_eventRate << "\n";
+  family ("nr_simulation_speed", "gauge",
+          "Simulation seconds per wall-clock second since the last sample");
+  os << "nr_simulation_speed " << sample.m_speed << "\n";
+
+  auto perCell = [&] (const char *name, const char *type, const char *help, auto value)
+  {
+    family (name, type, help);
+    for (const CellSample &cell : sample.m_cells)
+      {
+        os << name << "{cell=\"" << cell.m_cellId << "\",bwp=\"" << cell.m_bwpId << "\"} "
+           << value (cell) << "\n";
+      }
+  };
+  auto perDirection = [&] (const char *name, const char *help, auto value)
+  {
+    family (name, "gauge", help);
+    for (const CellSample &cell : sample.m_cells)
+      {
+        for (uint32_t dir = 0; dir < 2; ++dir)
+          {
+            os << name << "{cell=\"" << cell.m_cellId << "\",bwp=\"" << cell.m_bwpId
+               << "\",direction=\"" << (dir == 0 ? "dl" : "ul") << "\"} " << value (cell, dir)
+               << "\n";
+          }
+      }
+  };
+
+  perCell ("nr_attached_ues", "gauge", "UEs known by the scheduler",
+           [] (const CellSample &cell) { return cell.m_attachedUes; });
+  perDirection ("nr_active_ues", "UEs scheduled since the last sample",
+                [] (const CellSample &cell, uint32_t dir) { return cell.m_activeUes[dir]; });
+  perDirection ("nr_scheduled_throughput_bps", "Bits scheduled per simulation second since the last sample",
+                [] (const CellSample &cell, uint32_t dir) { return cell.m_throughput[dir]; });
+  perDirection ("nr_harq_retx_ratio", "Ratio of HARQ retransmissions among the TBs since the last sample",
+                [] (const CellSample &cell, uint32_t dir) { return cell.m_retxRatio[dir]; });
+  perDirection ("nr_buffered_bytes", "Bytes in the buffers of the UEs known by the scheduler",
+                [] (const CellSample &cell, uint32_t dir) { return cell.m_buffered[dir]; });
+
+  if (!sample.m_counters.empty ())
+    {
+      family ("nr_activity", "counter", "NrCounters of the cell and BWP");
+      for (const auto &it : sample.m_counters)
+        {
+          for (uint32_t c = 0; c < NrCounters::NUM_COUNTERS; ++c)
+            {
+              os << "nr_activity_total{cell=\"" << it.first.first << "\",bwp=\""
+                 << it.first.second << "\",counter=\""
+                 << NrCounters::GetCounterName (static_cast<NrCounters::Counter> (c)) << "\"} "
+                 << it.second[c] << "\n";
+            }
+        }
+    }
+  os << "# EOF\n";
+  return os.str ();
+}
+
+void
+NrMetricsExporter::WriteFile (const std::string &text) const
+{
+  if (m_outputFilename.empty ())
+    {
+      return;
+    }
+  // The readers never see a partial file
+  std::string tmpName = m_outputFilename + ".tmp";
+  std::ofstream file (tmpName.c_str (), std::ios_base::out | std::ios_base::trunc);
+  file << text;
+  file.close ();
+  if (file)
+    {
+      std::rename (tmpName.c_str (), m_outputFilename.c_str ());
+    }
+}
+
+int
+NrMetricsExporter::OpenServer () const
+{
+  int server = socket (AF_INET, SOCK_STREAM, 0);
+  if (server < 0)
+    {
+      return -1;
+    }
+  int reuse = 1;
+  setsockopt (server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof (reuse));
+
+  sockaddr_in address {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons (m_port);
+  address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (bind (server, reinterpret_cast<sockaddr *> (&address), sizeof (address)) != 0
+      || listen (server, 4) != 0
+      || fcntl (server, F_SETFL, fcntl (server, F_GETFL, 0) | O_NONBLOCK) != 0)
+    {
+      close (server);
+      return -1;
+    }
+  return server;
+}
+
+void
+NrMetricsExporter::Serve (int server)
+{
+  int client;
+  while ((client = accept (server, nullptr, nullptr)) >= 0)
+    {
+      // Wait for the request, whatever it is, for a short time
+      timeval timeout {0, 200000};
+      setsockopt (client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout));
+      setsockopt (client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof (timeout));
+      char request[4096];
+      [[maybe_unused]] ssize_t received = recv (client, request, sizeof (request), 0);
+
+      std::string body = GetText ();
+      std::ostringstream response;
+      response << "HTTP/1.0 200 OK\r\n"
+               << "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+               << "Content-Length: " << body.size () << "\r\n"
+               << "Connection: close\r\n\r\n"
+               << body;
+      std::string data = response.str ();
+      size_t sent = 0;
+      while (sent < data.size ())
+        {
+#ifdef MSG_NOSIGNAL
+          ssize_t n = send (client, data.data () + sent, data.size () - sent, MSG_NOSIGNAL);
+#else
+          ssize_t n = send (client, data.data () + sent, data.size () - sent, 0);
+#endif
+          if (n <= 0)
+            {
+              break;
+            }
+          sent += static_cast<size_t> (n);
+        }
+      close (client);
+    }
+}
+
+void
+NrMetricsExporter::WriterLoop ()
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (true)
+    {
+      // With a server, wake up often enough to answer the requests
+      m_cv.wait_for (lock, std::chrono::milliseconds (m_serverSocket >= 0 ? 100 : 1000),
+                     [this] () { return m_pending || m_stop; });
+      if (m_pending)
+        {
+          SampleValues sample = std::move (m_sample);
+          m_pending = false;
+          lock.unlock ();
+          std::string text = Format (sample);
+          WriteFile (text);
+          lock.lock ();
+          m_text = std::move (text);
+        }
+      if (m_stop)
+        {
+          break;
+        }
+      if (m_serverSocket >= 0)
+        {
+          lock.unlock ();
+          Serve (m_serverSocket);
+          lock.lock ();
+        }
+    }
+}
+
+void
+NrMetricsExporter::Stop ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_one ();
+  if (m_writer.joinable ())
+    {
+      m_writer.join ();
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,235 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_METRICS_EXPORTER_H
+#define NR_METRICS_EXPORTER_H
+
+#include <ns3/object.h>
+#include <ns3/nstime.h>
+#include <ns3/event-id.h>
+#include <ns3/nr-phy-mac-common.h>
+#include <ns3/nr-counters.h>
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace ns3 {
+
+class NrGnbNetDevice;
+class NrMacSchedulerNs3;
+
+/**
+ * \ingroup helper
+ * \brief Exports live metrics of the simulation in the OpenMetrics text format
+ *
+ * Every Interval of wall-clock time, the exporter samples, in the
+ * simulator thread:
+ * - the simulation time, the wall-clock time, the events run by the
+ *   simulator, and the simulation speed and event rate since the last sample;
+ * - for each cell and BWP added with AddGnb: the UEs attached to the
+ *   scheduler, the UEs scheduled, the scheduled throughput and the ratio of
+ *   HARQ retransmissions among the TBs since the last sample, and the bytes
+ *   in the DL and UL buffers known by the scheduler;
+ * - the NrCounters, if they are enabled.
+ *
+ * The wall clock is checked by an event every ProbePeriod of simulation
+ * time, that only reads a clock when no sample is due. The sample is copied
+ * to a writer thread, that formats it and replaces OutputFilename
+ * atomically (write and rename), so that the simulator thread never waits
+ * for the file system. With a non-zero Port, the writer thread also serves
+ * the last sample over HTTP on 127.0.0.1, to be scraped by Prometheus.
+ * A last sample is taken when the simulator is destroyed.
+ */
+class NrMetricsExporter : public Object
+{
+public:
+  NrMetricsExporter ();
+  ~NrMetricsExporter () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Sample the schedulers and the MAC scheduling traces of a gNB
+   * \param gnb the gNB
+   */
+  void AddGnb (const Ptr<NrGnbNetDevice> &gnb);
+
+  /**
+   * \brief Start the probes, the writer thread and the HTTP server
+   */
+  void Start ();
+
+  /**
+   * \brief Take a sample now, and give it to the writer thread
+   */
+  void Sample ();
+
+  /**
+   * \brief Format the last sample in the OpenMetrics text format
+   * \return the text, terminated by "# EOF"
+   */
+  std::string GetText () const;
+
+protected:
+  void DoDispose () override;
+
+private:
+  /**
+   * \brief The activity of a cell and BWP since the last sample
+   */
+  struct CellActivity
+  {
+    uint16_t m_cellId {0};                     //!< Cell ID
+    uint16_t m_bwpId {0};                      //!< BWP ID
+    Ptr<NrMacSchedulerNs3> m_scheduler;        //!< The scheduler, if it is a NrMacSchedulerNs3
+    std::array<std::unordered_set<uint16_t>, 2> m_rntis; //!< RNTIs scheduled, in the DL and the UL
+    std::array<uint64_t, 2> m_bytes {};        //!< Bytes scheduled, in the DL and the UL
+    std::array<uint64_t, 2> m_newTbs {};       //!< New TBs, in the DL and the UL
+    std::array<uint64_t, 2> m_retxTbs {};      //!< Retransmitted TBs, in the DL and the UL
+  };
+
+  /**
+   * \brief The values of a cell and BWP in a sample
+   */
+  struct CellSample
+  {
+    uint16_t m_cellId {0};                     //!< Cell ID
+    uint16_t m_bwpId {0};                      //!< BWP ID
+    uint32_t m_attachedUes {0};                //!< UEs of the scheduler
+    std::array<uint32_t, 2> m_activeUes {};    //!< UEs scheduled, in the DL and the UL
+    std::array<double, 2> m_throughput {};     //!< Scheduled throughput (bit/s), in the DL and the UL
+    std::array<double, 2> m_retxRatio {};      //!< Ratio of retransmitted TBs, in the DL and the UL
+    std::array<uint64_t, 2> m_buffered {};     //!< Bytes in the buffers, in the DL and the UL
+  };
+
+  /**
+   * \brief A sample, copied to the writer thread
+   */
+  struct SampleValues
+  {
+    double m_simTime {0};        //!< Simulation time (s)
+    double m_wallTime {0};       //!< Wall-clock time since Start (s)
+    uint64_t m_events {0};       //!< Events run by the simulator
+    double m_eventRate {0};      //!< Events per wall-clock second since the last sample
+    double m_speed {0};          //!< Simulation seconds per wall-clock second since the last sample
+    std::vector<CellSample> m_cells; //!< Values of the cells and BWPs
+    NrCounters::Snapshot m_counters; //!< NrCounters, if enabled
+  };
+
+  /**
+   * \brief Check the wall clock, sample if due, and schedule the next probe
+   */
+  void Probe ();
+
+  /**
+   * \brief Add an allocation to the activity of a cell and BWP
+   * \param index the index of the cell and BWP in m_cells
+   * \param isDl true for the DL
+   * \param info the allocation
+   */
+  void AddAllocation (uint32_t index, bool isDl, const NrSchedulingCallbackInfo &info);
+
+  /**
+   * \brief Trace sink of the DlScheduling trace of a MAC
+   * \param exporter the exporter
+   * \param index the index of the cell and BWP in m_cells
+   * \param info the allocation
+   */
+  static void DlSchedulingCallback (Ptr<NrMetricsExporter> exporter, uint32_t index,
+                                    NrSchedulingCallbackInfo info);
+
+  /**
+   * \brief Trace sink of the UlScheduling trace of a MAC
+   * \param exporter the exporter
+   * \param index the index of the cell and BWP in m_cells
+   * \param info the allocation
+   */
+  static void UlSchedulingCallback (Ptr<NrMetricsExporter> exporter, uint32_t index,
+                                    NrSchedulingCallbackInfo info);
+
+  /**
+   * \brief Format a sample
+   * \param sample the sample
+   * \return the text
+   */
+  static std::string Format (const SampleValues &sample);
+
+  /**
+   * \brief Write the samples to the file, and serve them, until stopped
+   */
+  void WriterLoop ();
+
+  /**
+   * \brief Open the HTTP server socket
+   * \return the socket, or -1 on error
+   */
+  int OpenServer () const;
+
+  /**
+   * \brief Answer the pending HTTP requests with the last sample
+   * \param server the server socket
+   */
+  void Serve (int server);
+
+  /**
+   * \brief Write a text to OutputFilename, through a temporary file
+   * \param text the text
+   */
+  void WriteFile (const std::string &text) const;
+
+  /**
+   * \brief Stop the writer thread, after it wrote the pending sample
+   */
+  void Stop ();
+
+  Time m_interval;              //!< The `Interval` attribute (wall clock)
+  Time m_probePeriod;           //!< The `ProbePeriod` attribute (simulation time)
+  std::string m_outputFilename; //!< The `OutputFilename` attribute
+  uint16_t m_port {0};          //!< The `Port` attribute
+
+  std::vector<CellActivity> m_cells; //!< Activity of the cells and BWPs
+  EventId m_probeEvent;              //!< Next probe
+  std::chrono::steady_clock::time_point m_wallStart;      //!< Wall-clock time of Start
+  std::chrono::steady_clock::time_point m_lastSampleWall; //!< Wall-clock time of the last sample
+  Time m_lastSampleSim;              //!< Simulation time of the last sample
+  uint64_t m_lastSampleEvents {0};   //!< Events run at the last sample
+
+  mutable std::mutex m_mutex;        //!< Protects the members below
+  std::condition_variable m_cv;      //!< Wakes up the writer thread
+  bool m_pending {false};            //!< True if m_sample was not written yet
+  bool m_stop {false};               //!< True when the writer thread has to stop
+  SampleValues m_sample;             //!< The last sample
+  std::string m_text;                //!< The last sample, formatted
+  std::thread m_writer;              //!< The writer thread
+  int m_serverSocket {-1};           //!< The HTTP server socket, or -1
+};
+
+} // namespace ns3
+
+#endif // NR_METRICS_EXPORTER_H
@@ -0,0 +1,347 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-phy-rx-kpi-stats.h"
+
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrPhyRxKpiStats");
+
+NS_OBJECT_ENSURE_REGISTERED (NrPhyRxKpiStats);
+
+NrP2Quantile::NrP2Quantile (double p)
+  : m_p (p)
+{
+  m_np = {0, 2 * p, 4 * p, 2 + 2 * p, 4};
+  m_dn = {0, p / 2, p, (1 + p) / 2, 1};
+  m_n = {0, 1, 2, 3, 4};
+}
+
+void
+NrP2Quantile::Add (double x)
+{
+  if (m_count < 5)
+    {
+      m_q[m_count++] = x;
+      if (m_count == 5)
+        {
+          std::sort (m_q.begin (), m_q.end ());
+        }
+      return;
+    }
+  ++m_count;
+
+  // Find the cell of the sample, and move the markers above it
+  uint32_t k;
+  if (x < m_q[0])
+    {
+      m_q[0] = x;
+      k = 0;
+    }
+  else if (x >= m_q[4])
+    {
+      m_q[4] = x;
+      k = 3;
+    }
+  else
+    {
+      k = 0;
+      while (x >= m_q[k + 1])
+        {
+          ++k;
+        }
+    }
+  for (uint32_t i = k + 1; i < 5; ++i)
+    {
+      m_n[i] += 1;
+    }
+  for (uint32_t i = 0; i < 5; ++i)
+    {
+      m_np[i] += m_dn[i];
+    }
+
+  // Adjust the heights of the middle markers that are off their position
+  for (uint32_t i = 1; i < 4; ++i)
+    {
+      double d = m_np[i] - m_n[i];
+      if ((d >= 1 && m_n[i + 1] - m_n[i] > 1) || (d <= -1 && m_n[i - 1] - m_n[i] < -1))
+        {
+          double ds = d >= 0 ? 1.0 : -1.0;
+          double q = Parabolic (i, ds);
+          if (m_q[i - 1] < q && q < m_q[i + 1])
+            {
+              m_q[i] = q;
+            }
+          else
+            {
+              m_q[i] = Linear (i, ds);
+            }
+          m_n[i] += ds;
+        }
+    }
+}
+
+double
+NrP2Quantile::Parabolic (uint32_t i, double d) const
+{
+  return m_q[i] + d / (m_n[i + 1] - m_n[i - 1])
+         * ((m_n[i] - m_n[i - 1] + d) * (m_q[i + 1] - m_q[i]) / (m_n[i + 1] - m_n[i])
+            + (m_n[i + 1] - m_n[i] - d) * (m_q[i] - m_q[i - 1]) / (m_n[i] - m_n[i - 1]));
+}
+
+double
+NrP2Quantile::Linear (uint32_t i, double d) const
+{
+  uint32_t j = d > 0 ? i + 1 : i - 1;
+  return m_q[i] + d * (m_q[j] - m_q[i]) / (m_n[j] - m_n[i]);
+}
+
+double
+NrP2Quantile::Get () const
+{
+  if (m_count == 0)
+    {
+      return std::numeric_limits<double>::quiet_NaN ();
+    }
+  if (m_count < 5)
+    {
+      std::array<double, 5> sorted = m_q;
+      std::sort (sorted.begin (), sorted.begin () + m_count);
+      auto rank = static_cast<uint64_t> (std::ceil (m_p * m_count));
+      return sorted[rank > 0 ? rank - 1 : 0];
+    }
+  return m_q[2];
+}
+
+uint64_t
+NrP2Quantile::GetCount () const
+{
+  return m_count;
+}
+
+NrPhyRxKpiStats::NrPhyRxKpiStats ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrPhyRxKpiStats::~NrPhyRxKpiStats ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+NrPhyRxKpiStats::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrPhyRxKpiStats")
+    .SetParent<Object> ()
+    .SetGroupName ("nr")
+    .AddConstructor<NrPhyRxKpiStats> ()
+    .AddAttribute ("EpochDuration",
+                   "Duration of the epochs over which the KPIs are aggregated. "
+                   "With zero, the KPIs of the whole simulation are written when "
+                   "the simulator is destroyed.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&NrPhyRxKpiStats::m_epochDuration),
+                   MakeTimeChecker ())
+    .AddAttribute ("OutputFilename",
+                   "Name of the file of the KPIs of each UE and direction",
+                   StringValue ("NrPhyRxKpi.txt"),
+                   MakeStringAccessor (&NrPhyRxKpiStats::m_outputFilename),
+                   MakeStringChecker ())
+    .AddAttribute ("HistogramFilename",
+                   "Name of the file of the SINR, MCS and TB size histograms",
+                   StringValue ("NrPhyRxKpiHistograms.txt"),
+                   MakeStringAccessor (&NrPhyRxKpiStats::m_histogramFilename),
+                   MakeStringChecker ())
+  ;
+  return tid;
+}
+
+void
+NrPhyRxKpiStats::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_endEpochEvent.Cancel ();
+  m_outFile.close ();
+  m_histogramFile.close ();
+  Object::DoDispose ();
+}
+
+void
+NrPhyRxKpiStats::Start ()
+{
+  NS_LOG_FUNCTION (this);
+  m_epochStart = Simulator::Now ();
+  if (m_epochDuration.IsStrictlyPositive ())
+    {
+      m_endEpochEvent = Simulator::Schedule (m_epochDuration, &NrPhyRxKpiStats::EndEpoch, this);
+    }
+  // The last epoch is written when the simulator is destroyed, at the stop time
+  Simulator::ScheduleDestroy (&NrPhyRxKpiStats::WriteResults, Ptr<NrPhyRxKpiStats> (this));
+}
+
+uint64_t
+NrPhyRxKpiStats::GetKey (uint16_t cellId, uint16_t rnti, Direction direction)
+{
+  return (static_cast<uint64_t> (cellId) << 32) | (static_cast<uint64_t> (rnti) << 8) | direction;
+}
+
+void
+NrPhyRxKpiStats::Add (Direction direction, const RxPacketTraceParams &params)
+{
+  Kpi &kpi = m_kpis[GetKey (static_cast<uint16_t> (params.m_cellId), params.m_rnti, direction)];
+  ++kpi.m_tbs;
+  if (params.m_corrupt)
+    {
+      ++kpi.m_corruptTbs;
+    }
+  else
+    {
+      kpi.m_rxBytes += params.m_tbSize;
+    }
+  kpi.m_mcsSum += params.m_mcs;
+
+  double sinrDb = 10 * std::log10 (std::max (params.m_sinr, 1e-10));
+  int32_t sinrBin = static_cast<int32_t> (std::floor (sinrDb)) - SINR_MIN_DB;
+  ++kpi.m_sinrHistogram[std::min<int32_t> (std::max (sinrBin, 0), SINR_BINS - 1)];
+  ++kpi.m_mcsHistogram[std::min<uint32_t> (params.m_mcs, MCS_BINS - 1)];
+  uint32_t tbsBin = 0;
+  for (uint32_t size = params.m_tbSize; size > 1; size >>= 1)
+    {
+      ++tbsBin;
+    }
+  ++kpi.m_tbsHistogram[std::min (tbsBin, TBS_BINS - 1)];
+
+  kpi.m_sinrP5.Add (sinrDb);
+  kpi.m_sinrP50.Add (sinrDb);
+  kpi.m_sinrP95.Add (sinrDb);
+}
+
+const NrPhyRxKpiStats::Kpi *
+NrPhyRxKpiStats::GetKpi (uint16_t cellId, uint16_t rnti, Direction direction) const
+{
+  auto it = m_kpis.find (GetKey (cellId, rnti, direction));
+  return it != m_kpis.end () ? &it->second : nullptr;
+}
+
+void
+NrPhyRxKpiStats::EndEpoch ()
+{
+  NS_LOG_FUNCTION (this);
+  WriteResults ();
+  m_endEpochEvent = Simulator::Schedule (m_epochDuration, &NrPhyRxKpiStats::EndEpoch, this);
+}
+
+void
+NrPhyRxKpiStats::WriteResults ()
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_outFile.is_open ())
+    {
+      m_outFile.open (m_outputFilename.c_str ());
+      m_histogramFile.open (m_histogramFilename.c_str ());
+      if (!m_outFile.is_open () || !m_histogramFile.is_open ())
+        {
+          NS_LOG_ERROR ("Can't open file " << m_outputFilename << " or " << m_histogramFilename);
+          m_outFile.close ();
+          m_histogramFile.close ();
+          return;
+        }
+      m_outFile << "% start(s)\tend(s)\tcellId\tRNTI\tdir\tTBs\tcorruptTBs\tBLER\trxBytes\t"
+                << "thr(Mbps)\tavgMcs\tsinrP5(dB)\tsinrP50(dB)\tsinrP95(dB)" << std::endl;
+      m_histogramFile << "% start(s)\tend(s)\tcellId\tRNTI\tdir\tmetric\tbin\tcount" << std::endl;
+    }
+
+  // The UEs in the order of cell, RNTI and direction
+  std::vector<uint64_t> keys;
+  keys.reserve (m_kpis.size ());
+  for (const auto &it : m_kpis)
+    {
+      keys.push_back (it.first);
+    }
+  std::sort (keys.begin (), keys.end ());
+
+  double start = m_epochStart.GetSeconds ();
+  double end = Simulator::Now ().GetSeconds ();
+  for (uint64_t key : keys)
+    {
+      const Kpi &kpi = m_kpis.at (key);
+      uint16_t cellId = static_cast<uint16_t> (key >> 32);
+      uint16_t rnti = static_cast<uint16_t> (key >> 8);
+      const char *dir = (key & 0xFF) == DL ? "DL" : "UL";
+
+      m_outFile << start << "\t" << end << "\t" << cellId << "\t" << rnti << "\t" << dir << "\t"
+                << kpi.m_tbs << "\t" << kpi.m_corruptTbs << "\t"
+                << static_cast<double> (kpi.m_corruptTbs) / kpi.m_tbs << "\t"
+                << kpi.m_rxBytes << "\t"
+                << (end > start ? kpi.m_rxBytes * 8.0 / (end - start) / 1e6 : 0.0) << "\t"
+                << static_cast<double> (kpi.m_mcsSum) / kpi.m_tbs << "\t"
+                << kpi.m_sinrP5.Get () << "\t" << kpi.m_sinrP50.Get () << "\t"
+                << kpi.m_sinrP95.Get () << "\n";
+
+      auto writeHistogram = [&] (const char *metric, const uint32_t *bins, uint32_t size,
+                                 auto lowerEdge)
+      {
+        for (uint32_t i = 0; i < size; ++i)
+          {
+            if (bins[i] > 0)
+              {
+                m_histogramFile << start << "\t" << end << "\t" << cellId << "\t" << rnti << "\t"
+                                << dir << "\t" << metric << "\t" << lowerEdge (i) << "\t"
+                                << bins[i] << "\n";
+              }
+          }
+      };
+      writeHistogram ("SINR", kpi.m_sinrHistogram.data (), SINR_BINS,
+                      [] (uint32_t i) { return static_cast<int64_t> (i) + SINR_MIN_DB; });
+      writeHistogram ("MCS", kpi.m_mcsHistogram.data (), MCS_BINS,
+                      [] (uint32_t i) { return static_cast<int64_t> (i); });
+      writeHistogram ("TBS", kpi.m_tbsHistogram.data (), TBS_BINS,
+                      [] (uint32_t i) { return i == 0 ? 0 : static_cast<int64_t> (1) << i; });
+    }
+  m_outFile.flush ();
+  m_histogramFile.flush ();
+
+  m_kpis.clear ();
+  m_epochStart = Simulator::Now ();
+}
+
+void
+NrPhyRxKpiStats::RxPacketTraceUeCallback (Ptr<NrPhyRxKpiStats> stats, [[maybe_unused]] std::string path,
+                                          RxPacketTraceParams params)
+{
+  stats->Add (DL, params);
+}
+
+void
+NrPhyRxKpiStats::RxPacketTraceEnbCallback (Ptr<NrPhyRxKpiStats> stats, [[maybe_unused]] std::string path,
+                                           RxPacketTraceParams params)
+{
+  stats->Add (UL, params);
+}
+
+} // namespace ns3
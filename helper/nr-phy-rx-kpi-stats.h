@@ -0,0 +1,231 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_PHY_RX_KPI_STATS_H
+#define NR_PHY_RX_KPI_STATS_H
+
+#include <ns3/object.h>
+#include <ns3/nstime.h>
+#include <ns3/event-id.h>
+#include <ns3/nr-phy-mac-common.h>
+
+#include <array>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+namespace ns3 {
+
+/**
+ * \ingroup helper
+ * \brief Streaming estimator of a quantile, with the P-square algorithm
+ *
+ * The estimator keeps five markers (Jain and Chlamtac, "The P2 algorithm
+ * for dynamic calculation of quantiles and histograms without storing
+ * observations", 1985): the memory and the cost of each sample are
+ * constant. The first five samples are kept, and the quantile is exact
+ * until then.
+ */
+class NrP2Quantile
+{
+public:
+  /**
+   * \brief Constructor
+   * \param p the quantile to estimate, in (0, 1)
+   */
+  NrP2Quantile (double p = 0.5);
+
+  /**
+   * \brief Add a sample
+   * \param x the sample
+   */
+  void Add (double x);
+
+  /**
+   * \return the estimate of the quantile, or NaN without samples
+   */
+  double Get () const;
+
+  /**
+   * \return the number of samples
+   */
+  uint64_t GetCount () const;
+
+private:
+  /**
+   * \brief Parabolic prediction of the height of a marker
+   * \param i the marker
+   * \param d the direction of the move (-1 or 1)
+   * \return the new height
+   */
+  double Parabolic (uint32_t i, double d) const;
+
+  /**
+   * \brief Linear prediction of the height of a marker
+   * \param i the marker
+   * \param d the direction of the move (-1 or 1)
+   * \return the new height
+   */
+  double Linear (uint32_t i, double d) const;
+
+  double m_p;                       //!< The quantile
+  uint64_t m_count {0};             //!< Number of samples
+  std::array<double, 5> m_q {};     //!< Heights of the markers
+  std::array<double, 5> m_n {};     //!< Positions of the markers
+  std::array<double, 5> m_np {};    //!< Desired positions of the markers
+  std::array<double, 5> m_dn {};    //!< Increments of the desired positions
+};
+
+/**
+ * \ingroup helper
+ * \brief Per-UE KPIs of the transport blocks received, aggregated online
+ *
+ * It is fed by the RxPacketTraceUe (DL) and RxPacketTraceEnb (UL) traces
+ * of NrSpectrumPhy, see NrHelper::EnablePhyRxKpiStats, and keeps, for each
+ * cell, RNTI and direction, the counters of the TBs, fixed-bin histograms
+ * of the SINR, the MCS and the TB size, and streaming estimates of the
+ * 5th, 50th and 95th percentiles of the SINR. Nothing is formatted in the
+ * trace sinks.
+ *
+ * At the end of each epoch (attribute EpochDuration), or once when the
+ * simulator is destroyed if the epoch is zero, the KPIs of the UEs that
+ * received in the epoch are written, and reset:
+ * - OutputFilename: one line per UE and direction, with the number of TBs,
+ *   of corrupted TBs, the BLER, the bytes received without errors, the
+ *   throughput over the epoch, the average MCS and the SINR percentiles;
+ * - HistogramFilename: one line per non-empty bin of the histograms. The
+ *   SINR bins are 1 dB wide, from -20 dB to 50 dB, and the samples out of
+ *   range go to the first or the last bin; the MCS bins hold one MCS; the
+ *   TB size bins go from 2^k to 2^(k+1) - 1 bytes.
+ */
+class NrPhyRxKpiStats : public Object
+{
+public:
+  /**
+   * \brief Direction of the transport blocks
+   */
+  enum Direction
+  {
+    DL = 0, //!< Received by the UE
+    UL = 1  //!< Received by the gNB
+  };
+
+  static constexpr uint32_t SINR_BINS = 70;   //!< Number of SINR bins, of 1 dB
+  static constexpr int32_t SINR_MIN_DB = -20; //!< Lower edge of the first SINR bin
+  static constexpr uint32_t MCS_BINS = 32;    //!< Number of MCS bins
+  static constexpr uint32_t TBS_BINS = 32;    //!< Number of TB size bins, one per power of 2
+
+  /**
+   * \brief The KPIs of a UE in a direction, in the current epoch
+   */
+  struct Kpi
+  {
+    uint64_t m_tbs {0};        //!< Number of TBs
+    uint64_t m_corruptTbs {0}; //!< Number of corrupted TBs
+    uint64_t m_rxBytes {0};    //!< Bytes of the TBs received without errors
+    uint64_t m_mcsSum {0};     //!< Sum of the MCS of the TBs
+    std::array<uint32_t, SINR_BINS> m_sinrHistogram {}; //!< Histogram of the SINR
+    std::array<uint32_t, MCS_BINS> m_mcsHistogram {};   //!< Histogram of the MCS
+    std::array<uint32_t, TBS_BINS> m_tbsHistogram {};   //!< Histogram of the TB size
+    NrP2Quantile m_sinrP5 {0.05};  //!< 5th percentile of the SINR (dB)
+    NrP2Quantile m_sinrP50 {0.5};  //!< Median of the SINR (dB)
+    NrP2Quantile m_sinrP95 {0.95}; //!< 95th percentile of the SINR (dB)
+  };
+
+  NrPhyRxKpiStats ();
+  ~NrPhyRxKpiStats () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Start the epochs, and write the last one when the simulator is destroyed
+   */
+  void Start ();
+
+  /**
+   * \brief Add a received TB
+   * \param direction the direction
+   * \param params the parameters of the reception
+   */
+  void Add (Direction direction, const RxPacketTraceParams &params);
+
+  /**
+   * \param cellId the cell ID
+   * \param rnti the RNTI
+   * \param direction the direction
+   * \return the KPIs of the UE in the current epoch, or nullptr if it received nothing
+   */
+  const Kpi * GetKpi (uint16_t cellId, uint16_t rnti, Direction direction) const;
+
+  /**
+   * \brief Write the KPIs of the epoch, and start a new one
+   */
+  void EndEpoch ();
+
+  /**
+   * \brief Trace sink for the RxPacketTraceUe trace of NrSpectrumPhy
+   * \param stats the stats
+   * \param path the context (unused)
+   * \param params the parameters of the reception
+   */
+  static void RxPacketTraceUeCallback (Ptr<NrPhyRxKpiStats> stats, std::string path,
+                                       RxPacketTraceParams params);
+
+  /**
+   * \brief Trace sink for the RxPacketTraceEnb trace of NrSpectrumPhy
+   * \param stats the stats
+   * \param path the context (unused)
+   * \param params the parameters of the reception
+   */
+  static void RxPacketTraceEnbCallback (Ptr<NrPhyRxKpiStats> stats, std::string path,
+                                        RxPacketTraceParams params);
+
+protected:
+  void DoDispose () override;
+
+private:
+  /**
+   * \param cellId the cell ID
+   * \param rnti the RNTI
+   * \param direction the direction
+   * \return the key of the UE in m_kpis
+   */
+  static uint64_t GetKey (uint16_t cellId, uint16_t rnti, Direction direction);
+
+  /**
+   * \brief Write the KPIs of the epoch to the files
+   */
+  void WriteResults ();
+
+  std::unordered_map<uint64_t, Kpi> m_kpis; //!< KPIs of the epoch, by cell, RNTI and direction
+  Time m_epochDuration;                     //!< The `EpochDuration` attribute
+  Time m_epochStart;                        //!< Start of the current epoch
+  EventId m_endEpochEvent;                  //!< Event of the end of the epoch
+  std::string m_outputFilename;             //!< The `OutputFilename` attribute
+  std::string m_histogramFilename;          //!< The `HistogramFilename` attribute
+  std::ofstream m_outFile;                  //!< KPI file, open from the first epoch
+  std::ofstream m_histogramFile;            //!< Histogram file, open from the first epoch
+};
+
+} // namespace ns3
+
+#endif // NR_PHY_RX_KPI_STATS_H
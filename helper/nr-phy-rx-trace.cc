@@ -34,6 +34,9 @@
 #include <ns3/nr-gnb-net-device.h>
 #include <stdio.h>
 #include <ns3/string.h>
+#include <ns3/uinteger.h>
+#include <ns3/enum.h>
+#include <ns3/boolean.h>
 
 namespace ns3 {
 
@@ -41,33 +44,50 @@ NS_LOG_COMPONENT_DEFINE ("NrPhyRxTrace");
 
 NS_OBJECT_ENSURE_REGISTERED (NrPhyRxTrace);
 
-std::ofstream NrPhyRxTrace::m_dlDataSinrFile;
+NrTraceFile NrPhyRxTrace::m_dlDataSinrFile;
 std::string NrPhyRxTrace::m_dlDataSinrFileName;
 
-std::ofstream NrPhyRxTrace::m_dlCtrlSinrFile;
+NrTraceFile NrPhyRxTrace::m_dlCtrlSinrFile;
 std::string NrPhyRxTrace::m_dlCtrlSinrFileName;
 
-std::ofstream NrPhyRxTrace::m_rxPacketTraceFile;
+NrTraceFile NrPhyRxTrace::m_rxPacketTraceFile;
 std::string NrPhyRxTrace::m_rxPacketTraceFilename;
 std::string NrPhyRxTrace::m_simTag;
-
-std::ofstream NrPhyRxTrace::m_rxedGnbPhyCtrlMsgsFile;
+uint32_t NrPhyRxTrace::m_perFileBufferSize = 64 * 1024;
+std::chrono::steady_clock::duration NrPhyRxTrace::m_perFileFlushPeriod = std::chrono::seconds (1);
+std::chrono::steady_clock::time_point NrPhyRxTrace::m_perFileLastFlush;
+std::map<std::string, NrPhyRxTrace::PerFileSink> NrPhyRxTrace::m_perFileSinks;
+NrPhyRxTrace::OutputFormat NrPhyRxTrace::m_outputFormat = NrPhyRxTrace::TEXT;
+bool NrPhyRxTrace::m_asyncOutput = false;
+uint32_t NrPhyRxTrace::m_asyncQueueSize = 16 * 1024;
+NrTraceQueue::Backpressure NrPhyRxTrace::m_asyncBackpressure = NrTraceQueue::BLOCK;
+uint32_t NrPhyRxTrace::m_asyncSamplingPeriod = 10;
+NrTraceFile::Compression NrPhyRxTrace::m_compression = NrTraceFile::NONE;
+bool NrPhyRxTrace::m_asyncQueueConfigured = false;
+
+NrTraceFile NrPhyRxTrace::m_rxedGnbPhyCtrlMsgsFile;
 std::string NrPhyRxTrace::m_rxedGnbPhyCtrlMsgsFileName;
-std::ofstream NrPhyRxTrace::m_txedGnbPhyCtrlMsgsFile;
+NrTraceFile NrPhyRxTrace::m_txedGnbPhyCtrlMsgsFile;
 std::string NrPhyRxTrace::m_txedGnbPhyCtrlMsgsFileName;
 
-std::ofstream NrPhyRxTrace::m_rxedUePhyCtrlMsgsFile;
+NrTraceFile NrPhyRxTrace::m_rxedUePhyCtrlMsgsFile;
 std::string NrPhyRxTrace::m_rxedUePhyCtrlMsgsFileName;
-std::ofstream NrPhyRxTrace::m_txedUePhyCtrlMsgsFile;
+NrTraceFile NrPhyRxTrace::m_txedUePhyCtrlMsgsFile;
 std::string NrPhyRxTrace::m_txedUePhyCtrlMsgsFileName;
-std::ofstream NrPhyRxTrace::m_rxedUePhyDlDciFile;
+NrTraceFile NrPhyRxTrace::m_rxedUePhyDlDciFile;
 std::string NrPhyRxTrace::m_rxedUePhyDlDciFileName;
 
-std::ofstream NrPhyRxTrace::m_dlPathlossFile;
+NrTraceFile NrPhyRxTrace::m_dlPathlossFile;
 std::string NrPhyRxTrace::m_dlPathlossFileName;
-std::ofstream NrPhyRxTrace::m_ulPathlossFile;
+NrTraceFile NrPhyRxTrace::m_ulPathlossFile;
 std::string NrPhyRxTrace::m_ulPathlossFileName;
 
+NrBinaryTraceWriter NrPhyRxTrace::m_dlDataSinrBinFile;
+NrBinaryTraceWriter NrPhyRxTrace::m_dlCtrlSinrBinFile;
+NrBinaryTraceWriter NrPhyRxTrace::m_rxPacketTraceBinFile;
+NrBinaryTraceWriter NrPhyRxTrace::m_dlPathlossBinFile;
+NrBinaryTraceWriter NrPhyRxTrace::m_ulPathlossBinFile;
+
 
 NrPhyRxTrace::NrPhyRxTrace ()
 {
@@ -124,6 +144,14 @@ NrPhyRxTrace::~NrPhyRxTrace ()
     {
       m_ulPathlossFile.close ();
     }
+
+  m_dlDataSinrBinFile.Close ();
+  m_dlCtrlSinrBinFile.Close ();
+  m_rxPacketTraceBinFile.Close ();
+  m_dlPathlossBinFile.Close ();
+  m_ulPathlossBinFile.Close ();
+
+  ClosePerFileSinks ();
 }
 
 TypeId
@@ -138,6 +166,69 @@ NrPhyRxTrace::GetTypeId (void)
                    StringValue (""),
                    MakeStringAccessor (&NrPhyRxTrace::SetSimTag),
                    MakeStringChecker ())
+    .AddAttribute ("PerFileBufferSize",
+                   "Size (in bytes) of the buffer attached to each per-UE and "
+                   "per-cell output file (e.g., UE_<imsi>_UL_SINR_dB.txt). "
+                   "These files stay open until the trace object or the simulator "
+                   "is destroyed, and are written to disk when the buffer is full "
+                   "or at each PerFileFlushPeriod. "
+                   "A value of 0 disables the buffering.",
+                   UintegerValue (64 * 1024),
+                   MakeUintegerAccessor (&NrPhyRxTrace::SetPerFileBufferSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("PerFileFlushPeriod",
+                   "Wall-clock period of the flush of the per-UE and per-cell "
+                   "output files, checked at each write, so that the data of a "
+                   "long run reaches the disk while it runs. A value of 0 "
+                   "flushes only when the buffer is full.",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&NrPhyRxTrace::SetPerFileFlushPeriod),
+                   MakeTimeChecker (Seconds (0)))
+    .AddAttribute ("OutputFormat",
+                   "Format of the RxPacketTrace, DlDataSinr, DlCtrlSinr and "
+                   "Dl/UlPathlossTrace files. The binary files (.bin) have a "
+                   "self-describing header followed by fixed-width records, and "
+                   "can be converted to text with NrBinaryTraceReader.",
+                   EnumValue (NrPhyRxTrace::TEXT),
+                   MakeEnumAccessor (&NrPhyRxTrace::SetOutputFormat,
+                                     &NrPhyRxTrace::GetOutputFormat),
+                   MakeEnumChecker (NrPhyRxTrace::TEXT, "Text",
+                                    NrPhyRxTrace::BINARY, "Binary"))
+    .AddAttribute ("AsyncOutput",
+                   "Write the records of the binary files on a dedicated "
+                   "thread (see NrTraceQueue), instead of in the trace callbacks.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrPhyRxTrace::SetAsyncOutput),
+                   MakeBooleanChecker ())
+    .AddAttribute ("AsyncQueueSize",
+                   "Number of records that can wait for the writing thread",
+                   UintegerValue (16 * 1024),
+                   MakeUintegerAccessor (&NrPhyRxTrace::SetAsyncQueueSize),
+                   MakeUintegerChecker<uint32_t> (2))
+    .AddAttribute ("AsyncBackpressure",
+                   "What happens to a record when the queue of the writing thread "
+                   "is full: the record is dropped, the simulation waits, or, above "
+                   "half full, only one record out of AsyncSamplingPeriod is queued",
+                   EnumValue (NrTraceQueue::BLOCK),
+                   MakeEnumAccessor (&NrPhyRxTrace::SetAsyncBackpressure),
+                   MakeEnumChecker (NrTraceQueue::DROP, "Drop",
+                                    NrTraceQueue::BLOCK, "Block",
+                                    NrTraceQueue::SAMPLE, "Sample"))
+    .AddAttribute ("AsyncSamplingPeriod",
+                   "With AsyncBackpressure equal to Sample, one record out of this "
+                   "number is queued when the queue is more than half full",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&NrPhyRxTrace::SetAsyncSamplingPeriod),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Compression",
+                   "Compression of the text files, which get the extension of the "
+                   "format. Zstd falls back to Gzip, and Gzip to None, if the "
+                   "module was built without the library.",
+                   EnumValue (NrTraceFile::NONE),
+                   MakeEnumAccessor (&NrPhyRxTrace::SetCompression),
+                   MakeEnumChecker (NrTraceFile::NONE, "None",
+                                    NrTraceFile::GZIP, "Gzip",
+                                    NrTraceFile::ZSTD, "Zstd"))
   ;
   return tid;
 }
@@ -148,17 +239,264 @@ NrPhyRxTrace::SetSimTag (const std::string &simTag)
   m_simTag = simTag;
 }
 
+void
+NrPhyRxTrace::SetOutputFormat (OutputFormat format)
+{
+  m_outputFormat = format;
+}
+
+NrPhyRxTrace::OutputFormat
+NrPhyRxTrace::GetOutputFormat () const
+{
+  return m_outputFormat;
+}
+
+void
+NrPhyRxTrace::SetAsyncOutput (bool asyncOutput)
+{
+  m_asyncOutput = asyncOutput;
+}
+
+void
+NrPhyRxTrace::SetAsyncQueueSize (uint32_t queueSize)
+{
+  m_asyncQueueSize = queueSize;
+}
+
+void
+NrPhyRxTrace::SetAsyncBackpressure (NrTraceQueue::Backpressure backpressure)
+{
+  m_asyncBackpressure = backpressure;
+}
+
+void
+NrPhyRxTrace::SetAsyncSamplingPeriod (uint32_t samplingPeriod)
+{
+  m_asyncSamplingPeriod = samplingPeriod;
+}
+
+void
+NrPhyRxTrace::SetCompression (NrTraceFile::Compression compression)
+{
+  m_compression = compression;
+}
+
+void
+NrPhyRxTrace::SetAsync (NrBinaryTraceWriter &writer)
+{
+  if (!m_asyncOutput)
+    {
+      return;
+    }
+  if (!m_asyncQueueConfigured)
+    {
+      NrTraceQueue::Get ().Configure (m_asyncQueueSize, m_asyncBackpressure, m_asyncSamplingPeriod);
+      m_asyncQueueConfigured = true;
+    }
+  writer.SetAsync (true);
+}
+
+void
+NrPhyRxTrace::SetPerFileBufferSize (uint32_t bufferSize)
+{
+  m_perFileBufferSize = bufferSize;
+}
+
+void
+NrPhyRxTrace::SetPerFileFlushPeriod (const Time &period)
+{
+  m_perFileFlushPeriod = std::chrono::nanoseconds (period.GetNanoSeconds ());
+}
+
+FILE *
+NrPhyRxTrace::GetPerFileSink (const std::string &fileName)
+{
+  if (m_perFileFlushPeriod.count () > 0 && !m_perFileSinks.empty ())
+    {
+      auto now = std::chrono::steady_clock::now ();
+      if (now - m_perFileLastFlush >= m_perFileFlushPeriod)
+        {
+          FlushPerFileSinks ();
+          m_perFileLastFlush = now;
+        }
+    }
+
+  auto it = m_perFileSinks.find (fileName);
+  if (it != m_perFileSinks.end ())
+    {
+      return it->second.m_file;
+    }
+
+  if (m_perFileSinks.empty ())
+    {
+      // The buffers are static: close the files while they are alive
+      Simulator::ScheduleDestroy (&NrPhyRxTrace::ClosePerFileSinks);
+      m_perFileLastFlush = std::chrono::steady_clock::now ();
+    }
+
+  PerFileSink &sink = m_perFileSinks[fileName];
+  sink.m_file = fopen (fileName.c_str (), "a");
+  if (sink.m_file == nullptr)
+    {
+      NS_FATAL_ERROR ("Could not open tracefile " << fileName);
+    }
+
+  // setvbuf must be called before any other operation on the stream. The
+  // buffer is owned by the sink, and it is never resized while the file is open.
+  if (m_perFileBufferSize > 0)
+    {
+      sink.m_buffer.resize (m_perFileBufferSize);
+      setvbuf (sink.m_file, sink.m_buffer.data (), _IOFBF, sink.m_buffer.size ());
+    }
+  else
+    {
+      setvbuf (sink.m_file, nullptr, _IONBF, 0);
+    }
+
+  return sink.m_file;
+}
+
+void
+NrPhyRxTrace::WriteBinarySinr (NrBinaryTraceWriter &writer, const std::string &prefix,
+                               uint16_t cellId, uint16_t rnti, double avgSinr,
+                               uint16_t bwpId, uint8_t streamId)
+{
+  if (!writer.IsOpen ())
+    {
+      std::ostringstream oss;
+      oss << prefix << m_simTag.c_str () << ".bin";
+      writer.Open (oss.str (), {{"Time", NrBinaryTraceColumn::DOUBLE},
+                                {"CellId", NrBinaryTraceColumn::UINT16},
+                                {"RNTI", NrBinaryTraceColumn::UINT16},
+                                {"BWPId", NrBinaryTraceColumn::UINT16},
+                                {"StreamId", NrBinaryTraceColumn::UINT8},
+                                {"SINR(dB)", NrBinaryTraceColumn::DOUBLE}});
+      SetAsync (writer);
+    }
+
+  writer.Add<double> (Simulator::Now ().GetSeconds ())
+        .Add<uint16_t> (cellId)
+        .Add<uint16_t> (rnti)
+        .Add<uint16_t> (bwpId)
+        .Add<uint8_t> (streamId)
+        .Add<double> (10 * log10 (avgSinr))
+        .EndRecord ();
+}
+
+void
+NrPhyRxTrace::WriteBinaryRxPacketTrace (uint8_t direction, const RxPacketTraceParams &params)
+{
+  if (!m_rxPacketTraceBinFile.IsOpen ())
+    {
+      std::ostringstream oss;
+      oss << "RxPacketTrace" << m_simTag.c_str () << ".bin";
+      m_rxPacketTraceBinFile.Open (oss.str (), {{"Time", NrBinaryTraceColumn::DOUBLE},
+                                                {"direction", NrBinaryTraceColumn::UINT8},
+                                                {"frame", NrBinaryTraceColumn::UINT32},
+                                                {"subF", NrBinaryTraceColumn::UINT8},
+                                                {"slot", NrBinaryTraceColumn::UINT16},
+                                                {"1stSym", NrBinaryTraceColumn::UINT8},
+                                                {"nSymbol", NrBinaryTraceColumn::UINT8},
+                                                {"cellId", NrBinaryTraceColumn::UINT64},
+                                                {"bwpId", NrBinaryTraceColumn::UINT16},
+                                                {"streamId", NrBinaryTraceColumn::UINT8},
+                                                {"rnti", NrBinaryTraceColumn::UINT16},
+                                                {"tbSize", NrBinaryTraceColumn::UINT32},
+                                                {"mcs", NrBinaryTraceColumn::UINT8},
+                                                {"rv", NrBinaryTraceColumn::UINT8},
+                                                {"SINR(dB)", NrBinaryTraceColumn::DOUBLE},
+                                                {"CQI", NrBinaryTraceColumn::UINT8},
+                                                {"corrupt", NrBinaryTraceColumn::UINT8},
+                                                {"TBler", NrBinaryTraceColumn::DOUBLE}});
+      SetAsync (m_rxPacketTraceBinFile);
+    }
+
+  m_rxPacketTraceBinFile.Add<double> (Simulator::Now ().GetNanoSeconds () / (double) 1e9)
+                        .Add<uint8_t> (direction)
+                        .Add<uint32_t> (params.m_frameNum)
+                        .Add<uint8_t> (params.m_subframeNum)
+                        .Add<uint16_t> (params.m_slotNum)
+                        .Add<uint8_t> (params.m_symStart)
+                        .Add<uint8_t> (params.m_numSym)
+                        .Add<uint64_t> (params.m_cellId)
+                        .Add<uint16_t> (params.m_bwpId)
+                        .Add<uint8_t> (params.m_streamId)
+                        .Add<uint16_t> (params.m_rnti)
+                        .Add<uint32_t> (params.m_tbSize)
+                        .Add<uint8_t> (params.m_mcs)
+                        .Add<uint8_t> (params.m_rv)
+                        .Add<double> (10 * log10 (params.m_sinr))
+                        .Add<uint8_t> (params.m_cqi)
+                        .Add<uint8_t> (params.m_corrupt ? 1 : 0)
+                        .Add<double> (params.m_tbler)
+                        .EndRecord ();
+}
+
+void
+NrPhyRxTrace::WriteBinaryPathloss (NrBinaryTraceWriter &writer, const std::string &prefix,
+                                   uint16_t cellId, uint16_t bwpId, uint8_t txStreamId,
+                                   uint64_t imsi, uint8_t rxStreamId, double lossDb)
+{
+  if (!writer.IsOpen ())
+    {
+      std::ostringstream oss;
+      oss << prefix << m_simTag.c_str () << ".bin";
+      writer.Open (oss.str (), {{"Time(sec)", NrBinaryTraceColumn::DOUBLE},
+                                {"CellId", NrBinaryTraceColumn::UINT16},
+                                {"BwpId", NrBinaryTraceColumn::UINT16},
+                                {"txStreamId", NrBinaryTraceColumn::UINT8},
+                                {"IMSI", NrBinaryTraceColumn::UINT64},
+                                {"rxStreamId", NrBinaryTraceColumn::UINT8},
+                                {"pathLoss(dB)", NrBinaryTraceColumn::DOUBLE}});
+      SetAsync (writer);
+    }
+
+  writer.Add<double> (Simulator::Now ().GetSeconds ())
+        .Add<uint16_t> (cellId)
+        .Add<uint16_t> (bwpId)
+        .Add<uint8_t> (txStreamId)
+        .Add<uint64_t> (imsi)
+        .Add<uint8_t> (rxStreamId)
+        .Add<double> (lossDb)
+        .EndRecord ();
+}
+
+void
+NrPhyRxTrace::FlushPerFileSinks ()
+{
+  for (auto &it : m_perFileSinks)
+    {
+      fflush (it.second.m_file);
+    }
+}
+
+void
+NrPhyRxTrace::ClosePerFileSinks ()
+{
+  for (auto &it : m_perFileSinks)
+    {
+      fclose (it.second.m_file);
+    }
+  m_perFileSinks.clear ();
+}
+
 void
 NrPhyRxTrace::DlDataSinrCallback ([[maybe_unused]]Ptr<NrPhyRxTrace> phyStats, [[maybe_unused]] std::string path,
                                   uint16_t cellId, uint16_t rnti, double avgSinr, uint16_t bwpId, uint8_t streamId)
 {
   NS_LOG_INFO ("UE" << rnti << "of " << cellId << " over bwp ID " << bwpId << "->Generate RsrpSinrTrace");
+  if (m_outputFormat == BINARY)
+    {
+      WriteBinarySinr (m_dlDataSinrBinFile, "DlDataSinr", cellId, rnti, avgSinr, bwpId, streamId);
+      return;
+    }
+
   if (!m_dlDataSinrFile.is_open ())
       {
         std::ostringstream oss;
         oss << "DlDataSinr" << m_simTag.c_str () << ".txt";
         m_dlDataSinrFileName = oss.str ();
-        m_dlDataSinrFile.open (m_dlDataSinrFileName.c_str ());
+        m_dlDataSinrFile.open (m_dlDataSinrFileName, m_compression);
 
         m_dlDataSinrFile << "Time" << "\t" << "CellId" << "\t" << "RNTI" << "\t" << "BWPId"
                        << "\t" << "StreamId" << "\t" << "SINR(dB)" << std::endl;
@@ -181,12 +519,18 @@ NrPhyRxTrace::DlCtrlSinrCallback ([[maybe_unused]] Ptr<NrPhyRxTrace> phyStats, [
 {
   NS_LOG_INFO ("UE" << rnti << "of " << cellId << " over bwp ID " << bwpId << "->Generate RsrpSinrTrace");
 
+  if (m_outputFormat == BINARY)
+    {
+      WriteBinarySinr (m_dlCtrlSinrBinFile, "DlCtrlSinr", cellId, rnti, avgSinr, bwpId, streamId);
+      return;
+    }
+
   if (!m_dlCtrlSinrFile.is_open ())
       {
         std::ostringstream oss;
         oss << "DlCtrlSinr" << m_simTag.c_str () << ".txt";
         m_dlCtrlSinrFileName = oss.str ();
-        m_dlCtrlSinrFile.open (m_dlCtrlSinrFileName.c_str ());
+        m_dlCtrlSinrFile.open (m_dlCtrlSinrFileName, m_compression);
 
         m_dlCtrlSinrFile << "Time" << "\t" << "CellId" << "\t" << "RNTI" << "\t" << "BWPId"
                        << "\t" << "StreamId" << "\t" << "SINR(dB)" << std::endl;
@@ -209,10 +553,9 @@ NrPhyRxTrace::UlSinrTraceCallback (Ptr<NrPhyRxTrace> phyStats, std::string path,
   NS_LOG_INFO ("UE" << imsi << "->Generate UlSinrTrace");
   uint64_t tti_count = Now ().GetMicroSeconds () / 125;
   uint32_t rb_count = 1;
-  FILE* log_file;
   char fname[255];
-  sprintf (fname, "UE_%llu_UL_SINR_dB.txt", (long long unsigned ) imsi);
-  log_file = fopen (fname, "a");
+  snprintf (fname, sizeof (fname), "UE_%llu_UL_SINR_dB.txt", (long long unsigned ) imsi);
+  FILE* log_file = GetPerFileSink (fname);
   Values::iterator it = sinr.ValuesBegin ();
   while (it != sinr.ValuesEnd ())
     {
@@ -221,8 +564,6 @@ NrPhyRxTrace::UlSinrTraceCallback (Ptr<NrPhyRxTrace> phyStats, std::string path,
       rb_count++;
       it++;
     }
-  fflush (log_file);
-  fclose (log_file);
   //phyStats->ReportInterferenceTrace (imsi, sinr);
   //phyStats->ReportPowerTrace (imsi, power);
 }
@@ -237,7 +578,7 @@ NrPhyRxTrace::RxedGnbPhyCtrlMsgsCallback (Ptr<NrPhyRxTrace> phyStats, std::strin
         std::ostringstream oss;
         oss << "RxedGnbPhyCtrlMsgsTrace" << m_simTag.c_str () << ".txt";
         m_rxedGnbPhyCtrlMsgsFileName = oss.str ();
-        m_rxedGnbPhyCtrlMsgsFile.open (m_rxedGnbPhyCtrlMsgsFileName.c_str ());
+        m_rxedGnbPhyCtrlMsgsFile.open (m_rxedGnbPhyCtrlMsgsFileName, m_compression);
 
         m_rxedGnbPhyCtrlMsgsFile << "Time" << "\t" << "Entity"  << "\t" <<
                                     "Frame" << "\t" << "SF" << "\t" << "Slot" <<
@@ -299,7 +640,7 @@ NrPhyRxTrace::TxedGnbPhyCtrlMsgsCallback (Ptr<NrPhyRxTrace> phyStats, std::strin
         std::ostringstream oss;
         oss << "TxedGnbPhyCtrlMsgsTrace" << m_simTag.c_str () << ".txt";
         m_txedGnbPhyCtrlMsgsFileName = oss.str ();
-        m_txedGnbPhyCtrlMsgsFile.open (m_txedGnbPhyCtrlMsgsFileName.c_str ());
+        m_txedGnbPhyCtrlMsgsFile.open (m_txedGnbPhyCtrlMsgsFileName, m_compression);
 
         m_txedGnbPhyCtrlMsgsFile << "Time" << "\t" << "Entity" << "\t" <<
                                     "Frame" << "\t" << "SF" << "\t" << "Slot" <<
@@ -356,7 +697,7 @@ NrPhyRxTrace::RxedUePhyCtrlMsgsCallback (Ptr<NrPhyRxTrace> phyStats, std::string
         std::ostringstream oss;
         oss << "RxedUePhyCtrlMsgsTrace" << m_simTag.c_str () << ".txt";
         m_rxedUePhyCtrlMsgsFileName = oss.str ();
-        m_rxedUePhyCtrlMsgsFile.open (m_rxedUePhyCtrlMsgsFileName.c_str ());
+        m_rxedUePhyCtrlMsgsFile.open (m_rxedUePhyCtrlMsgsFileName, m_compression);
 
         m_rxedUePhyCtrlMsgsFile << "Time" << "\t" << "Entity" << "\t" <<
                                    "Frame" << "\t" << "SF" << "\t" << "Slot" <<
@@ -413,7 +754,7 @@ NrPhyRxTrace::TxedUePhyCtrlMsgsCallback (Ptr<NrPhyRxTrace> phyStats, std::string
         std::ostringstream oss;
         oss << "TxedUePhyCtrlMsgsTrace" << m_simTag.c_str () << ".txt";
         m_txedUePhyCtrlMsgsFileName = oss.str ();
-        m_txedUePhyCtrlMsgsFile.open (m_txedUePhyCtrlMsgsFileName.c_str ());
+        m_txedUePhyCtrlMsgsFile.open (m_txedUePhyCtrlMsgsFileName, m_compression);
 
         m_txedUePhyCtrlMsgsFile << "Time" << "\t" << "Entity" << "\t" <<
                                    "Frame" << "\t" << "SF" << "\t" << "Slot" <<
@@ -475,7 +816,7 @@ NrPhyRxTrace::RxedUePhyDlDciCallback (Ptr<NrPhyRxTrace> phyStats, std::string pa
         std::ostringstream oss;
         oss << "RxedUePhyDlDciTrace" << m_simTag.c_str () << ".txt";
         m_rxedUePhyDlDciFileName = oss.str ();
-        m_rxedUePhyDlDciFile.open (m_rxedUePhyDlDciFileName.c_str ());
+        m_rxedUePhyDlDciFile.open (m_rxedUePhyDlDciFileName, m_compression);
 
         m_rxedUePhyDlDciFile << "Time" << "\t" << "Entity"  << "\t" << "Frame" <<
                                 "\t" << "SF" << "\t" << "Slot" << "\t" <<
@@ -508,7 +849,7 @@ NrPhyRxTrace::TxedUePhyHarqFeedbackCallback (Ptr<NrPhyRxTrace> phyStats, std::st
         std::ostringstream oss;
         oss << "RxedUePhyDlDciTrace" << m_simTag.c_str () << ".txt";
         m_rxedUePhyDlDciFileName = oss.str ();
-        m_rxedUePhyDlDciFile.open (m_rxedUePhyDlDciFileName.c_str ());
+        m_rxedUePhyDlDciFile.open (m_rxedUePhyDlDciFileName, m_compression);
 
         m_rxedUePhyDlDciFile << "Time" << "\t" << "Entity"  << "\t" << "Frame" <<
                                 "\t" << "SF" << "\t" << "Slot" << "\t" <<
@@ -536,10 +877,9 @@ NrPhyRxTrace::ReportInterferenceTrace (uint64_t imsi, SpectrumValue& sinr)
 {
   uint64_t tti_count = Now ().GetMicroSeconds () / 125;
   uint32_t rb_count = 1;
-  FILE* log_file;
   char fname[255];
-  sprintf (fname, "UE_%llu_SINR_dB.txt", (long long unsigned ) imsi);
-  log_file = fopen (fname, "a");
+  snprintf (fname, sizeof (fname), "UE_%llu_SINR_dB.txt", (long long unsigned ) imsi);
+  FILE* log_file = GetPerFileSink (fname);
   Values::iterator it = sinr.ValuesBegin ();
   while (it != sinr.ValuesEnd ())
     {
@@ -548,8 +888,6 @@ NrPhyRxTrace::ReportInterferenceTrace (uint64_t imsi, SpectrumValue& sinr)
       rb_count++;
       it++;
     }
-  fflush (log_file);
-  fclose (log_file);
 }
 
 void
@@ -558,10 +896,9 @@ NrPhyRxTrace::ReportPowerTrace (uint64_t imsi, SpectrumValue& power)
 
   uint32_t tti_count = Now ().GetMicroSeconds () / 125;
   uint32_t rb_count = 1;
-  FILE* log_file;
   char fname[255];
-  printf (fname, "UE_%llu_ReceivedPower_dB.txt", (long long unsigned) imsi);
-  log_file = fopen (fname, "a");
+  snprintf (fname, sizeof (fname), "UE_%llu_ReceivedPower_dB.txt", (long long unsigned) imsi);
+  FILE* log_file = GetPerFileSink (fname);
   Values::iterator it = power.ValuesBegin ();
   while (it != power.ValuesEnd ())
     {
@@ -569,8 +906,6 @@ NrPhyRxTrace::ReportPowerTrace (uint64_t imsi, SpectrumValue& power)
       rb_count++;
       it++;
     }
-  fflush (log_file);
-  fclose (log_file);
 }
 
 void
@@ -598,10 +933,9 @@ NrPhyRxTrace::ReportDownLinkTBSize (Ptr<NrPhyRxTrace> phyStats, std::string path
 void
 NrPhyRxTrace::ReportPacketCountUe (UePhyPacketCountParameter param)
 {
-  FILE* log_file;
   char fname[255];
-  sprintf (fname,"UE_%llu_Packet_Trace.txt", (long long unsigned) param.m_imsi);
-  log_file = fopen (fname, "a");
+  snprintf (fname, sizeof (fname), "UE_%llu_Packet_Trace.txt", (long long unsigned) param.m_imsi);
+  FILE* log_file = GetPerFileSink (fname);
   if (param.m_isTx)
     {
       fprintf (log_file, "%d\t%d\t%d\n", param.m_subframeno, param.m_noBytes, 0);
@@ -610,19 +944,14 @@ NrPhyRxTrace::ReportPacketCountUe (UePhyPacketCountParameter param)
     {
       fprintf (log_file, "%d\t%d\t%d\n", param.m_subframeno, 0, param.m_noBytes);
     }
-
-  fflush (log_file);
-  fclose (log_file);
-
 }
 
 void
 NrPhyRxTrace::ReportPacketCountEnb (GnbPhyPacketCountParameter param)
 {
-  FILE* log_file;
   char fname[255];
-  sprintf (fname,"BS_%llu_Packet_Trace.txt",(long long unsigned) param.m_cellId);
-  log_file = fopen (fname, "a");
+  snprintf (fname, sizeof (fname), "BS_%llu_Packet_Trace.txt", (long long unsigned) param.m_cellId);
+  FILE* log_file = GetPerFileSink (fname);
   if (param.m_isTx)
     {
       fprintf (log_file, "%d\t%d\t%d\n", param.m_subframeno, param.m_noBytes, 0);
@@ -632,33 +961,34 @@ NrPhyRxTrace::ReportPacketCountEnb (GnbPhyPacketCountParameter param)
       fprintf (log_file, "%d\t%d\t%d\n", param.m_subframeno, 0, param.m_noBytes);
     }
 
-  fflush (log_file);
-  fclose (log_file);
 }
 
 void
 NrPhyRxTrace::ReportDLTbSize (uint64_t imsi, uint64_t tbSize)
 {
-  FILE* log_file;
   char fname[255];
-  sprintf (fname,"UE_%llu_Tb_Size.txt", (long long unsigned) imsi);
-  log_file = fopen (fname, "a");
+  snprintf (fname, sizeof (fname), "UE_%llu_Tb_Size.txt", (long long unsigned) imsi);
+  FILE* log_file = GetPerFileSink (fname);
 
   fprintf (log_file, "%llu \t %llu\n", (long long unsigned )Now ().GetMicroSeconds (), (long long unsigned )tbSize);
   fprintf (log_file, "%lld \t %llu \n",(long long int) Now ().GetMicroSeconds (), (long long unsigned) tbSize);
-  fflush (log_file);
-  fclose (log_file);
 }
 
 void
 NrPhyRxTrace::RxPacketTraceUeCallback (Ptr<NrPhyRxTrace> phyStats, std::string path, RxPacketTraceParams params)
 {
+  if (m_outputFormat == BINARY)
+    {
+      WriteBinaryRxPacketTrace (0, params);
+      return;
+    }
+
   if (!m_rxPacketTraceFile.is_open ())
     {
       std::ostringstream oss;
       oss << "RxPacketTrace" << m_simTag.c_str() << ".txt";
       m_rxPacketTraceFilename = oss.str ();
-      m_rxPacketTraceFile.open (m_rxPacketTraceFilename.c_str ());
+      m_rxPacketTraceFile.open (m_rxPacketTraceFilename, m_compression);
 
       m_rxPacketTraceFile << "Time" << "\t" << "direction" << "\t" <<
                              "frame" << "\t" << "subF" << "\t" << "slot" <<
@@ -715,12 +1045,18 @@ NrPhyRxTrace::RxPacketTraceUeCallback (Ptr<NrPhyRxTrace> phyStats, std::string p
 void
 NrPhyRxTrace::RxPacketTraceEnbCallback (Ptr<NrPhyRxTrace> phyStats, std::string path, RxPacketTraceParams params)
 {
+  if (m_outputFormat == BINARY)
+    {
+      WriteBinaryRxPacketTrace (1, params);
+      return;
+    }
+
   if (!m_rxPacketTraceFile.is_open ())
     {
       std::ostringstream oss;
       oss << "RxPacketTrace" << m_simTag.c_str () << ".txt";
       m_rxPacketTraceFilename = oss.str ();
-      m_rxPacketTraceFile.open (m_rxPacketTraceFilename.c_str ());
+      m_rxPacketTraceFile.open (m_rxPacketTraceFilename, m_compression);
 
       m_rxPacketTraceFile << "Time" << "\t" << "direction" << "\t" <<
                              "frame" << "\t" << "subF" << "\t" << "slot" <<
@@ -782,6 +1118,11 @@ NrPhyRxTrace::PathlossTraceCallback (Ptr<NrPhyRxTrace> phyStats,
 {
   Ptr<NrSpectrumPhy> txNrSpectrumPhy = txPhy->GetObject <NrSpectrumPhy> ();
   Ptr<NrSpectrumPhy> rxNrSpectrumPhy = rxPhy->GetObject <NrSpectrumPhy> ();
+  if (txNrSpectrumPhy == nullptr || rxNrSpectrumPhy == nullptr)
+    {
+      // e.g. the signal of an interference-only gNB (NrLoadModelPhy)
+      return;
+    }
   if (DynamicCast<NrGnbNetDevice> (txNrSpectrumPhy->GetDevice ()) != nullptr)
     {
       // All the gNBs are on the same channel (especially in TDD), therefore,
@@ -832,12 +1173,24 @@ NrPhyRxTrace::WriteDlPathlossTrace (Ptr<NrSpectrumPhy> txNrSpectrumPhy,
                                     Ptr<NrSpectrumPhy> rxNrSpectrumPhy,
                                     double lossDb)
 {
+  if (m_outputFormat == BINARY)
+    {
+      WriteBinaryPathloss (m_dlPathlossBinFile, "DlPathlossTrace",
+                           txNrSpectrumPhy->GetDevice ()->GetObject<NrGnbNetDevice> ()->GetCellId (),
+                           txNrSpectrumPhy->GetBwpId (),
+                           txNrSpectrumPhy->GetStreamId (),
+                           rxNrSpectrumPhy->GetDevice ()->GetObject<NrUeNetDevice> ()->GetImsi (),
+                           rxNrSpectrumPhy->GetStreamId (),
+                           lossDb);
+      return;
+    }
+
   if (!m_dlPathlossFile.is_open ())
       {
         std::ostringstream oss;
         oss << "DlPathlossTrace" << m_simTag.c_str () << ".txt";
         m_dlPathlossFileName = oss.str ();
-        m_dlPathlossFile.open (m_dlPathlossFileName.c_str ());
+        m_dlPathlossFile.open (m_dlPathlossFileName, m_compression);
 
         m_dlPathlossFile << "Time(sec)" << "\t" << "CellId" << "\t"
                          << "BwpId" << "\t"  << "txStreamId "<< "\t"
@@ -865,12 +1218,24 @@ NrPhyRxTrace::WriteUlPathlossTrace (Ptr<NrSpectrumPhy> txNrSpectrumPhy,
                                     Ptr<NrSpectrumPhy> rxNrSpectrumPhy,
                                     double lossDb)
 {
+  if (m_outputFormat == BINARY)
+    {
+      WriteBinaryPathloss (m_ulPathlossBinFile, "UlPathlossTrace",
+                           txNrSpectrumPhy->GetDevice ()->GetObject<NrUeNetDevice> ()->GetCellId (),
+                           txNrSpectrumPhy->GetBwpId (),
+                           txNrSpectrumPhy->GetStreamId (),
+                           txNrSpectrumPhy->GetDevice ()->GetObject<NrUeNetDevice> ()->GetImsi (),
+                           rxNrSpectrumPhy->GetStreamId (),
+                           lossDb);
+      return;
+    }
+
   if (!m_ulPathlossFile.is_open ())
       {
         std::ostringstream oss;
         oss << "UlPathlossTrace" << m_simTag.c_str () << ".txt";
         m_ulPathlossFileName = oss.str ();
-        m_ulPathlossFile.open (m_ulPathlossFileName.c_str ());
+        m_ulPathlossFile.open (m_ulPathlossFileName, m_compression);
 
         m_ulPathlossFile << "Time(sec)" << "\t" << "CellId" << "\t"
                          << "BwpId" << "\t"  << "txStreamId "<< "\t"
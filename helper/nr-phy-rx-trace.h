@@ -35,8 +35,15 @@
 #include <ns3/nr-control-messages.h>
 #include <ns3/nr-spectrum-phy.h>
 #include <ns3/spectrum-phy.h>
+#include <ns3/nr-binary-trace.h>
+#include <ns3/nr-trace-queue.h>
+#include <ns3/nr-trace-file.h>
+#include <ns3/nstime.h>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <vector>
 
 namespace ns3 {
 
@@ -47,6 +54,32 @@ public:
   virtual ~NrPhyRxTrace ();
   static TypeId GetTypeId (void);
 
+  /**
+   * \brief Format of the RxPacketTrace, DlDataSinr, DlCtrlSinr and pathloss
+   * output files
+   */
+  enum OutputFormat
+  {
+    TEXT,   //!< Tab-separated text (.txt)
+    BINARY  //!< Fixed-width binary records (.bin), see NrBinaryTraceColumn
+  };
+
+  /**
+   * \brief Set the output format
+   *
+   * It must be set before the first sample is traced, since the files are
+   * opened when the first sample arrives.
+   *
+   * \param format the output format
+   */
+  void SetOutputFormat (OutputFormat format);
+
+  /**
+   * \brief Get the output format
+   * \return the output format
+   */
+  OutputFormat GetOutputFormat () const;
+
   /**
    * \brief Set simTag that will be contatenated to
    * output file names
@@ -54,6 +87,70 @@ public:
    */
   void SetSimTag (const std::string &simTag);
 
+  /**
+   * \brief Set the size of the user-space buffer attached to each per-UE
+   * (and per-cell) output file
+   *
+   * The per-UE files (e.g., UE_<imsi>_UL_SINR_dB.txt) are opened once and
+   * kept open until this object or the simulator is destroyed; the data is
+   * written to disk when this buffer is full, at each flush period (see
+   * SetPerFileFlushPeriod), or when the file is closed. The value is used
+   * for the files opened after the call.
+   *
+   * \param bufferSize the buffer size, in bytes (0 means unbuffered)
+   */
+  void SetPerFileBufferSize (uint32_t bufferSize);
+
+  /**
+   * \brief Set the period of the flush of the per-UE files
+   *
+   * The period is in wall-clock time, and it is checked at each write: a
+   * simulation event would keep alive the simulations that end when they
+   * run out of events. The data of a run that is killed is then on disk up
+   * to one period before.
+   *
+   * \param period the flush period (0 means flush only when the buffer is full)
+   */
+  void SetPerFileFlushPeriod (const Time &period);
+
+  /**
+   * \brief Set whether the binary records are written on the thread of NrTraceQueue
+   *
+   * It is used for the binary files opened after the call. The queue is
+   * configured with the values of the attributes AsyncQueueSize,
+   * AsyncBackpressure and AsyncSamplingPeriod when the first of them is
+   * opened.
+   *
+   * \param asyncOutput if true, the binary records are queued
+   */
+  void SetAsyncOutput (bool asyncOutput);
+  /**
+   * \brief Set the number of records of NrTraceQueue
+   * \param queueSize the number of records
+   */
+  void SetAsyncQueueSize (uint32_t queueSize);
+  /**
+   * \brief Set what happens to a record when NrTraceQueue is full
+   * \param backpressure the backpressure policy
+   */
+  void SetAsyncBackpressure (NrTraceQueue::Backpressure backpressure);
+  /**
+   * \brief Set the sampling period of the SAMPLE backpressure policy
+   * \param samplingPeriod one record out of samplingPeriod is queued
+   */
+  void SetAsyncSamplingPeriod (uint32_t samplingPeriod);
+
+  /**
+   * \brief Set the compression of the text files
+   *
+   * It is used for the files opened after the call, that get the extension
+   * of the compression (e.g., RxPacketTrace.txt.gz). The per-UE files and
+   * the binary files are not compressed.
+   *
+   * \param compression the compression
+   */
+  void SetCompression (NrTraceFile::Compression compression);
+
   /**
    * \brief Trace sink for DL Average SINR of DATA (in dB).
    * \param [in] phyStats NrPhyRxTrace object
@@ -202,6 +299,78 @@ private:
   void ReportPacketCountUe (UePhyPacketCountParameter param);
   void ReportPacketCountEnb (GnbPhyPacketCountParameter param);
   void ReportDLTbSize (uint64_t imsi, uint64_t tbSize);
+
+  /**
+   * \brief Buffered output file that stays open for the whole simulation
+   */
+  struct PerFileSink
+  {
+    FILE *m_file {nullptr};       //!< The file handle
+    std::vector<char> m_buffer;   //!< The stdio buffer attached to m_file
+  };
+
+  /**
+   * \brief Get the handle of a per-UE (or per-cell) output file
+   *
+   * The file is opened in append mode the first time it is requested, and
+   * a buffer of m_perFileBufferSize bytes is attached to it. The first file
+   * schedules ClosePerFileSinks at the destruction of the simulator, before
+   * the static buffers can be freed. All the files are flushed when the
+   * flush period has elapsed since the last flush.
+   *
+   * \param fileName the name of the file
+   * \return the file handle
+   */
+  static FILE * GetPerFileSink (const std::string &fileName);
+  /**
+   * \brief Write a record of the DlDataSinr or DlCtrlSinr binary trace
+   *
+   * \param [in] writer the binary trace writer
+   * \param [in] prefix the file name prefix, used if the file is not open yet
+   * \param [in] cellId the cell ID
+   * \param [in] rnti the RNTI
+   * \param [in] avgSinr the average SINR (linear)
+   * \param [in] bwpId the BWP ID
+   * \param [in] streamId the stream ID
+   */
+  static void WriteBinarySinr (NrBinaryTraceWriter &writer, const std::string &prefix,
+                               uint16_t cellId, uint16_t rnti, double avgSinr,
+                               uint16_t bwpId, uint8_t streamId);
+  /**
+   * \brief Write a record of the RxPacketTrace binary trace
+   *
+   * \param [in] direction 0 for DL, 1 for UL
+   * \param [in] params the RX packet parameters
+   */
+  static void WriteBinaryRxPacketTrace (uint8_t direction, const RxPacketTraceParams &params);
+  /**
+   * \brief Write a record of the DL or UL pathloss binary trace
+   *
+   * \param [in] writer the binary trace writer
+   * \param [in] prefix the file name prefix, used if the file is not open yet
+   * \param [in] cellId the cell ID
+   * \param [in] bwpId the BWP ID
+   * \param [in] txStreamId the TX stream ID
+   * \param [in] imsi the IMSI of the UE
+   * \param [in] rxStreamId the RX stream ID
+   * \param [in] lossDb the loss value in dB
+   */
+  static void WriteBinaryPathloss (NrBinaryTraceWriter &writer, const std::string &prefix,
+                                   uint16_t cellId, uint16_t bwpId, uint8_t txStreamId,
+                                   uint64_t imsi, uint8_t rxStreamId, double lossDb);
+  /**
+   * \brief Flush and close all the files opened through GetPerFileSink
+   */
+  static void ClosePerFileSinks ();
+  /**
+   * \brief Flush all the files opened through GetPerFileSink
+   */
+  static void FlushPerFileSinks ();
+  /**
+   * \brief Make a binary writer that was just opened use NrTraceQueue, if enabled
+   * \param [in] writer the binary trace writer
+   */
+  static void SetAsync (NrBinaryTraceWriter &writer);
   /**
    * \brief Write DL pathloss values in a file
    *
@@ -225,31 +394,48 @@ private:
 
 
   static std::string m_simTag;   //!< The `SimTag` attribute.
+  static uint32_t m_perFileBufferSize;   //!< The `PerFileBufferSize` attribute.
+  static std::chrono::steady_clock::duration m_perFileFlushPeriod; //!< The `PerFileFlushPeriod` attribute.
+  static std::chrono::steady_clock::time_point m_perFileLastFlush; //!< Wall-clock time of the last flush
+  static OutputFormat m_outputFormat;    //!< The `OutputFormat` attribute.
+  static bool m_asyncOutput;             //!< The `AsyncOutput` attribute.
+  static uint32_t m_asyncQueueSize;      //!< The `AsyncQueueSize` attribute.
+  static NrTraceQueue::Backpressure m_asyncBackpressure; //!< The `AsyncBackpressure` attribute.
+  static uint32_t m_asyncSamplingPeriod; //!< The `AsyncSamplingPeriod` attribute.
+  static bool m_asyncQueueConfigured;    //!< Whether NrTraceQueue was configured
+  static NrTraceFile::Compression m_compression; //!< The `Compression` attribute.
+  static std::map<std::string, PerFileSink> m_perFileSinks; //!< Open per-UE files, by file name
 
-  static std::ofstream m_dlDataSinrFile;
+  static NrTraceFile m_dlDataSinrFile;
   static std::string m_dlDataSinrFileName;
 
-  static std::ofstream m_dlCtrlSinrFile;
+  static NrTraceFile m_dlCtrlSinrFile;
   static std::string m_dlCtrlSinrFileName;
 
-  static std::ofstream m_rxPacketTraceFile;
+  static NrTraceFile m_rxPacketTraceFile;
   static std::string m_rxPacketTraceFilename;
 
-  static std::ofstream m_rxedGnbPhyCtrlMsgsFile;
+  static NrTraceFile m_rxedGnbPhyCtrlMsgsFile;
   static std::string m_rxedGnbPhyCtrlMsgsFileName;
-  static std::ofstream m_txedGnbPhyCtrlMsgsFile;
+  static NrTraceFile m_txedGnbPhyCtrlMsgsFile;
   static std::string m_txedGnbPhyCtrlMsgsFileName;
 
-  static std::ofstream m_rxedUePhyCtrlMsgsFile;
+  static NrTraceFile m_rxedUePhyCtrlMsgsFile;
   static std::string m_rxedUePhyCtrlMsgsFileName;
-  static std::ofstream m_txedUePhyCtrlMsgsFile;
+  static NrTraceFile m_txedUePhyCtrlMsgsFile;
   static std::string m_txedUePhyCtrlMsgsFileName;
-  static std::ofstream m_rxedUePhyDlDciFile;
+  static NrTraceFile m_rxedUePhyDlDciFile;
   static std::string m_rxedUePhyDlDciFileName;
-  static std::ofstream m_dlPathlossFile;
+  static NrTraceFile m_dlPathlossFile;
   static std::string m_dlPathlossFileName;
-  static std::ofstream m_ulPathlossFile;
+  static NrTraceFile m_ulPathlossFile;
   static std::string m_ulPathlossFileName;
+
+  static NrBinaryTraceWriter m_dlDataSinrBinFile;    //!< Binary DlDataSinr trace
+  static NrBinaryTraceWriter m_dlCtrlSinrBinFile;    //!< Binary DlCtrlSinr trace
+  static NrBinaryTraceWriter m_rxPacketTraceBinFile; //!< Binary RxPacketTrace trace
+  static NrBinaryTraceWriter m_dlPathlossBinFile;    //!< Binary DlPathlossTrace trace
+  static NrBinaryTraceWriter m_ulPathlossBinFile;    //!< Binary UlPathlossTrace trace
 };
 
 } /* namespace ns3 */
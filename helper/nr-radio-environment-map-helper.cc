@@ -36,10 +36,23 @@
 #include <ns3/nr-ue-net-device.h>
 #include <ns3/nr-spectrum-phy.h>
 #include "nr-spectrum-value-helper.h"
+#include <ns3/nr-wrap-around-model.h>
+#include <ns3/nr-building-index.h>
+#include <ns3/nr-los-field-channel-condition-model.h>
+#include "nr-rem-compute-backend.h"
 #include <ns3/beamforming-vector.h>
+#include <ns3/uniform-planar-array.h>
+#include <ns3/angles.h>
 #include <ctime>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <functional>
 #include <limits>
+#include <algorithm>
+#include <tuple>
 
 namespace ns3 {
 
@@ -61,6 +74,7 @@ void
 NrRadioEnvironmentMapHelper::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
+  m_computeBackend = nullptr;
 }
 
 TypeId
@@ -159,6 +173,93 @@ NrRadioEnvironmentMapHelper::GetTypeId (void)
                                      TimeValue (MilliSeconds (100)),
                                      MakeTimeAccessor (&NrRadioEnvironmentMapHelper::SetInstallationDelay),
                                      MakeTimeChecker())
+                      .AddAttribute ("NumWorkers",
+                                     "Number of worker processes that evaluate the REM points. "
+                                     "With 1, the points are evaluated serially. The REM values "
+                                     "do not depend on the number of workers.",
+                                     UintegerValue (1),
+                                     MakeUintegerAccessor (&NrRadioEnvironmentMapHelper::SetNumWorkers),
+                                     MakeUintegerChecker<uint32_t> (1))
+                      .AddAttribute ("PropagationModelsLifetime",
+                                     "Lifetime of the temporal propagation models: PerCall creates new models "
+                                     "for each received power calculation, making all of them strictly "
+                                     "independent; PerRealization creates them once for each REM point and "
+                                     "averaging iteration, and shares them among all its calculations.",
+                                     EnumValue (NrRadioEnvironmentMapHelper::PER_CALL),
+                                     MakeEnumAccessor (&NrRadioEnvironmentMapHelper::SetPropagationModelsLifetime,
+                                                       &NrRadioEnvironmentMapHelper::GetPropagationModelsLifetime),
+                                     MakeEnumChecker (NrRadioEnvironmentMapHelper::PER_CALL, "PerCall",
+                                                      NrRadioEnvironmentMapHelper::PER_REALIZATION, "PerRealization"))
+                      .AddAttribute ("BeamShapeModel",
+                                     "Model of the received power of the BEAM_SHAPE maps: FullChannel uses "
+                                     "a 3GPP channel realization for each RTD and REM point; AnalyticFreeSpace "
+                                     "and AnalyticPathLoss use the gains of the configured beams along the "
+                                     "direct path, with the free space path loss or with the one of the "
+                                     "propagation loss model of the channel, for all the REM points at once "
+                                     "(IterForAverage, TileSize, RefinementStep and NumWorkers do not apply).",
+                                     EnumValue (NrRadioEnvironmentMapHelper::FULL_CHANNEL),
+                                     MakeEnumAccessor (&NrRadioEnvironmentMapHelper::SetBeamShapeModel,
+                                                       &NrRadioEnvironmentMapHelper::GetBeamShapeModel),
+                                     MakeEnumChecker (NrRadioEnvironmentMapHelper::FULL_CHANNEL, "FullChannel",
+                                                      NrRadioEnvironmentMapHelper::ANALYTIC_FREE_SPACE, "AnalyticFreeSpace",
+                                                      NrRadioEnvironmentMapHelper::ANALYTIC_PATH_LOSS, "AnalyticPathLoss"))
+                      .AddAttribute ("LayerCacheDir",
+                                     "If not empty, the directory in which the analytic BEAM_SHAPE maps keep "
+                                     "the gain layer of each RTD over the grid, in a file named by the hash "
+                                     "of its configuration (grid, position, frequency, antennas, beams and, "
+                                     "with AnalyticPathLoss, propagation loss model and buildings). A map "
+                                     "then calculates only the layers whose configuration is not in the "
+                                     "directory.",
+                                     StringValue (""),
+                                     MakeStringAccessor (&NrRadioEnvironmentMapHelper::m_layerCacheDir),
+                                     MakeStringChecker ())
+                      .AddAttribute ("ComputeBackend",
+                                     "The backend that evaluates the REM points. If not set, the points "
+                                     "are evaluated by NrRemWorkersBackend with NumWorkers greater than 1, "
+                                     "and by NrRemSerialBackend otherwise.",
+                                     PointerValue (),
+                                     MakePointerAccessor (&NrRadioEnvironmentMapHelper::m_computeBackend),
+                                     MakePointerChecker<NrRemComputeBackend> ())
+                      .AddAttribute ("PointStreamBase",
+                                     "If not negative, the random variables of each REM point use their own "
+                                     "block of streams, starting from PointStreamBase and in the order of "
+                                     "the points in the grid, instead of the next streams of the global "
+                                     "counter. Each point is then independent of the order in which the "
+                                     "points are evaluated (NumWorkers, TileSize, ResumeTiles, "
+                                     "RefinementStep). It must be beyond the streams assigned to the rest "
+                                     "of the simulation.",
+                                     IntegerValue (-1),
+                                     MakeIntegerAccessor (&NrRadioEnvironmentMapHelper::m_pointStreamBase),
+                                     MakeIntegerChecker<int64_t> ())
+                      .AddAttribute ("TileSize",
+                                     "Side, in grid points, of the square tiles in which the REM is calculated. "
+                                     "The values of each tile are appended to nr-rem-<SimTag>-tiles.out as "
+                                     "soon as the tile is done. With 0, the REM is calculated in one go.",
+                                     UintegerValue (0),
+                                     MakeUintegerAccessor (&NrRadioEnvironmentMapHelper::m_tileSize),
+                                     MakeUintegerChecker<uint32_t> ())
+                      .AddAttribute ("ResumeTiles",
+                                     "If true, the tiles saved in nr-rem-<SimTag>-tiles.out by a previous, "
+                                     "interrupted, run of the same REM are not calculated again. The random "
+                                     "variables of the other tiles then differ from the ones of an "
+                                     "uninterrupted run.",
+                                     BooleanValue (false),
+                                     MakeBooleanAccessor (&NrRadioEnvironmentMapHelper::m_resumeTiles),
+                                     MakeBooleanChecker ())
+                      .AddAttribute ("RefinementStep",
+                                     "If greater than 1, one grid line out of RefinementStep is calculated "
+                                     "first; then only the cells of this coarse grid whose corners differ "
+                                     "by more than RefinementThreshold are calculated in full, the others "
+                                     "are interpolated.",
+                                     UintegerValue (0),
+                                     MakeUintegerAccessor (&NrRadioEnvironmentMapHelper::m_refinementStep),
+                                     MakeUintegerChecker<uint32_t> ())
+                      .AddAttribute ("RefinementThreshold",
+                                     "Difference of SNR or SINR (dB) between the corners of a coarse cell "
+                                     "above which the cell is calculated in full.",
+                                     DoubleValue (3.0),
+                                     MakeDoubleAccessor (&NrRadioEnvironmentMapHelper::m_refinementThreshold),
+                                     MakeDoubleChecker<double> (0.0))
     ;
   return tid;
 }
@@ -229,6 +330,37 @@ NrRadioEnvironmentMapHelper::SetInstallationDelay (const Time &installationDelay
   m_installationDelay = installationDelay;
 }
 
+void
+NrRadioEnvironmentMapHelper::SetNumWorkers (uint32_t numWorkers)
+{
+  NS_ABORT_MSG_IF (numWorkers == 0, "At least one worker is needed");
+  m_numWorkers = numWorkers;
+}
+
+void
+NrRadioEnvironmentMapHelper::SetPropagationModelsLifetime (enum PropagationModelsLifetime lifetime)
+{
+  m_propModelsLifetime = lifetime;
+}
+
+NrRadioEnvironmentMapHelper::PropagationModelsLifetime
+NrRadioEnvironmentMapHelper::GetPropagationModelsLifetime () const
+{
+  return m_propModelsLifetime;
+}
+
+void
+NrRadioEnvironmentMapHelper::SetBeamShapeModel (enum BeamShapeModel model)
+{
+  m_beamShapeModel = model;
+}
+
+NrRadioEnvironmentMapHelper::BeamShapeModel
+NrRadioEnvironmentMapHelper::GetBeamShapeModel () const
+{
+  return m_beamShapeModel;
+}
+
 NrRadioEnvironmentMapHelper::RemMode
 NrRadioEnvironmentMapHelper::GetRemMode () const
 {
@@ -363,6 +495,7 @@ void NrRadioEnvironmentMapHelper::ConfigureRtdList (const NetDeviceContainer& rt
       rtd.antenna = m_deviceToAntenna.find (*netDevIt)->second;
 
       rtd.txPower = rtdPhy->GetTxPower ();
+      rtd.frequency = rtdPhy->GetCentralFrequency ();
 
       NS_LOG_DEBUG ("power of UE: " << rtd.txPower);
 
@@ -379,6 +512,23 @@ void NrRadioEnvironmentMapHelper::ConfigureRtdList (const NetDeviceContainer& rt
   NS_ASSERT_MSG (m_remDev.size (),"No RTD devices configured. Check if the RTD "
                                   "devices are on the operating on the same "
                                   "spectrum as RRD device.");
+
+  // The copies of the LOS field model share the fields of the gNBs with
+  // the simulation: the missing ones are drawn here, and not by the workers
+  if (m_losFieldModel != nullptr)
+    {
+      if (m_remMode == UE_COVERAGE)
+        {
+          m_losFieldModel->PrepareSite (m_rrd.mob);
+        }
+      else
+        {
+          for (const auto &rtd : m_remDev)
+            {
+              m_losFieldModel->PrepareSite (rtd.mob);
+            }
+        }
+    }
 }
 
 void
@@ -389,18 +539,25 @@ NrRadioEnvironmentMapHelper::ConfigurePropagationModelsFactories (const Ptr<cons
   Ptr<SpectrumChannel> txSpectrumChannel = txSpectrumPhy->GetSpectrumChannel ();
 
   /***** configure pathloss model factory *****/
-  m_propagationLossModel = txSpectrumChannel->GetPropagationLossModel ();
+  // The REM does not use the wrap-around of the channel, if any
+  m_propagationLossModel = NrWrapAroundPropagationLossModel::Unwrap (txSpectrumChannel->GetPropagationLossModel ());
+  m_propagationLossModelFactory = ConfigureObjectFactory (m_propagationLossModel);
   /***** configure spectrum model factory *****/
   m_phasedArraySpectrumLossModel = txSpectrumChannel->GetPhasedArraySpectrumPropagationLossModel ();
+  m_spectrumLossModelFactory = ConfigureObjectFactory (m_phasedArraySpectrumLossModel);
 
   /***** configure ChannelConditionModel factory if ThreeGppPropagationLossModel propagation model is being used ****/
-  Ptr<ThreeGppPropagationLossModel> propagationLossModel =  DynamicCast<ThreeGppPropagationLossModel> (txSpectrumChannel->GetPropagationLossModel ());
+  Ptr<ThreeGppPropagationLossModel> propagationLossModel =  DynamicCast<ThreeGppPropagationLossModel> (m_propagationLossModel);
   if (propagationLossModel)
     {
       Ptr<ChannelConditionModel> channelConditionModel = propagationLossModel->GetChannelConditionModel ();
       if (channelConditionModel)
         {
           m_channelConditionModelFactory = ConfigureObjectFactory (channelConditionModel);
+          // the indexed model finds the building of the RRD by itself
+          m_losFieldModel = DynamicCast<NrLosFieldChannelConditionModel> (channelConditionModel);
+          m_buildingInfoNeeded = DynamicCast<NrBuildingsChannelConditionModel> (channelConditionModel) == nullptr
+            && m_losFieldModel == nullptr;
         }
       else
         {
@@ -462,6 +619,11 @@ NrRadioEnvironmentMapHelper::ConfigureObjectFactory (const Ptr<Object>& object)
                                "According to REM design it should be created "
                                "as a new object (not copied).");
                 }
+              else if (attributeInfo.name == "WrapAroundModel")
+                {
+                  NS_LOG_INFO ("Skipping to copy WrapAroundModel."
+                               "The REM does not use the wrap-around.");
+                }
               else
                 {
                   NS_LOG_WARN ("This factory has a PointerValue attribute that "
@@ -621,15 +783,34 @@ NrRadioEnvironmentMapHelper::CreateListOfRemPoints ()
 
   NS_LOG_INFO ("m_xStep: " << m_xStep << " m_yStep: " << m_yStep);
 
+  std::vector<double> xs;
   for (double x = m_xMin; x < m_xMax + 0.5*m_xStep; x += m_xStep)
     {
-      for (double y = m_yMin; y < m_yMax + 0.5*m_yStep ; y += m_yStep)
+      xs.push_back (x);
+    }
+  std::vector<double> ys;
+  for (double y = m_yMin; y < m_yMax + 0.5*m_yStep ; y += m_yStep)
+    {
+      ys.push_back (y);
+    }
+
+  m_xNumPoints = static_cast<uint32_t> (xs.size ());
+  m_yNumPoints = static_cast<uint32_t> (ys.size ());
+  m_gridX = xs;
+  m_gridY = ys;
+  m_rem.clear ();
+  m_rem.reserve (xs.size () * ys.size ());
+  m_remGrid.assign (xs.size () * ys.size (), -1);
+
+  for (size_t ix = 0; ix < xs.size (); ++ix)
+    {
+      for (size_t iy = 0; iy < ys.size (); ++iy)
         {
           //In case a REM Point is in the same position as a rtd, ignore this point
           bool isPositionRtd = false;
           for (std::list<RemDevice>::iterator itRtd = m_remDev.begin (); itRtd != m_remDev.end (); ++itRtd)
           {
-            if (itRtd->mob->GetPosition () == Vector (x, y, m_z))
+            if (itRtd->mob->GetPosition () == Vector (xs[ix], ys[iy], m_z))
             {
               isPositionRtd = true;
             }
@@ -639,16 +820,25 @@ NrRadioEnvironmentMapHelper::CreateListOfRemPoints ()
           {
             RemPoint remPoint;
 
-            remPoint.pos.x = x;
-            remPoint.pos.y = y;
+            remPoint.pos.x = xs[ix];
+            remPoint.pos.y = ys[iy];
             remPoint.pos.z = m_z;
 
+            m_remGrid[ix * ys.size () + iy] = static_cast<int64_t> (m_rem.size ());
             m_rem.push_back (remPoint);
           }
         }
     }
 }
 
+NrRadioEnvironmentMapHelper::RemPoint *
+NrRadioEnvironmentMapHelper::GetGridPoint (uint32_t x, uint32_t y)
+{
+  NS_ASSERT (x < m_xNumPoints && y < m_yNumPoints);
+  int64_t index = m_remGrid[static_cast<size_t> (x) * m_yNumPoints + y];
+  return index < 0 ? nullptr : &m_rem[static_cast<size_t> (index)];
+}
+
 void
 NrRadioEnvironmentMapHelper::ConfigureQuasiOmniBfv (RemDevice& device)
 {
@@ -673,8 +863,20 @@ NrRadioEnvironmentMapHelper::ConfigureDirectPathBfv (RemDevice& device,
 Ptr<SpectrumValue>
 NrRadioEnvironmentMapHelper::CalcRxPsdValue (RemDevice& device, RemDevice& otherDevice) const
 {
-  PropagationModels tempPropModels = CreateTemporalPropagationModels ();
+  PropagationModels tempPropModels = m_propModelsLifetime == PER_CALL ?
+    CreateTemporalPropagationModels () : m_sharedPropModels;
 
+  double pathLossDb = tempPropModels.remPropagationLossModelCopy->CalcRxPower (0, device.mob, otherDevice.mob);
+  NS_LOG_DEBUG ("PathlosDb:" << pathLossDb);
+
+  return CalcBeamformedRxPsd (tempPropModels, device, otherDevice,
+                              CalcConvertedTxPsd (device, otherDevice),
+                              DbToRatio (pathLossDb));
+}
+
+Ptr<const SpectrumValue>
+NrRadioEnvironmentMapHelper::CalcConvertedTxPsd (const RemDevice& device, const RemDevice& otherDevice) const
+{
   std::vector<int> activeRbs;
   for (size_t rbId = 0; rbId < device.spectrumModel->GetNumBands(); rbId++)
     {
@@ -703,13 +905,19 @@ NrRadioEnvironmentMapHelper::CalcRxPsdValue (RemDevice& device, RemDevice& other
       convertedTxPsd = converter.Convert (txPsd);
     }
 
+  NS_LOG_DEBUG ("Tx power in dBm:" <<  WToDbm (Integral (*convertedTxPsd)));
+
+  return convertedTxPsd;
+}
+
+Ptr<SpectrumValue>
+NrRadioEnvironmentMapHelper::CalcBeamformedRxPsd (const PropagationModels &models,
+                                                  RemDevice& device, RemDevice& otherDevice,
+                                                  const Ptr<const SpectrumValue> &convertedTxPsd,
+                                                  double pathGainLinear) const
+{
   // Copy TX PSD to RX PSD, they are now equal rxPsd == txPsd
   Ptr<SpectrumValue> rxPsd = convertedTxPsd->Copy ();
-  double pathLossDb = tempPropModels.remPropagationLossModelCopy->CalcRxPower (0, device.mob, otherDevice.mob);
-  double pathGainLinear = DbToRatio (pathLossDb);
-
-  NS_LOG_DEBUG ("Tx power in dBm:" <<  WToDbm (Integral (*convertedTxPsd)));
-  NS_LOG_DEBUG ("PathlosDb:" << pathLossDb);
 
   // Apply now calculated pathloss to rxPsd, now rxPsd < txPsd because we had some losses
   *(rxPsd) *= pathGainLinear;
@@ -717,7 +925,7 @@ NrRadioEnvironmentMapHelper::CalcRxPsdValue (RemDevice& device, RemDevice& other
   NS_LOG_DEBUG ("RX power in dBm after pathloss:" << WToDbm (Integral (*rxPsd)));
 
   // Now we call spectrum model, which in this keys add a beamforming gain
-  rxPsd = tempPropModels.remSpectrumLossModelCopy->DoCalcRxPowerSpectralDensity (rxPsd, device.mob, otherDevice.mob, device.antenna, otherDevice.antenna);
+  rxPsd = models.remSpectrumLossModelCopy->DoCalcRxPowerSpectralDensity (rxPsd, device.mob, otherDevice.mob, device.antenna, otherDevice.antenna);
 
   NS_LOG_DEBUG ("RX power in dBm after fading: " << WToDbm (Integral (*rxPsd)));
 
@@ -871,73 +1079,439 @@ void
 NrRadioEnvironmentMapHelper::CalcBeamShapeRemMap ()
 {
   NS_LOG_FUNCTION (this);
-  uint16_t calcRxPsdCounter = 0;
-
-  uint32_t remSizeNextReport = m_rem.size () / 100;
-  uint32_t remPointCounter = 0;
 
-  for (std::list<RemPoint>::iterator itRemPoint = m_rem.begin ();
-      itRemPoint != m_rem.end ();
-      ++itRemPoint)
+  if (m_beamShapeModel == FULL_CHANNEL)
+    {
+      CalcRemMap (&NrRadioEnvironmentMapHelper::CalcBeamShapeRemPoint);
+    }
+  else
     {
-      //perform calculation m_numOfIterationsToAverage times and get the average value
-      double sumSnr = 0.0, sumSinr = 0.0;
-      double sumSir = 0.0;
-      std::list<double> rxPsdsListPerIt; //list to save the summed rxPower in each RemPoint for each Iteration (linear)
-      m_rrd.mob->SetPosition (itRemPoint->pos);
+      CalcAnalyticBeamShapeRemMap ();
+    }
 
+  auto remEndTime = std::chrono::system_clock::now ();
+  std::chrono::duration<double> remElapsedSeconds = remEndTime - m_remStartTime;
+  NS_LOG_INFO ("REM map created. Total time needed to create the REM map:" <<
+                 remElapsedSeconds.count () / 60 << " minutes.");
+}
+
+void
+NrRadioEnvironmentMapHelper::CalcBeamShapeRemPoint (RemPoint *remPoint)
+{
+  //perform calculation m_numOfIterationsToAverage times and get the average value
+  double sumSnr = 0.0, sumSinr = 0.0;
+  double sumSir = 0.0;
+  std::list<double> rxPsdsListPerIt; //list to save the summed rxPower in each RemPoint for each Iteration (linear)
+  m_rrd.mob->SetPosition (remPoint->pos);
+
+  if (m_buildingInfoNeeded)
+    {
       Ptr <MobilityBuildingInfo> buildingInfo = m_rrd.mob->GetObject <MobilityBuildingInfo> ();
-      buildingInfo->MakeConsistent (m_rrd.mob);
       NS_ASSERT_MSG (buildingInfo, "buildingInfo is null");
+      buildingInfo->MakeConsistent (m_rrd.mob);
+    }
+
+  for (uint16_t i = 0; i < m_numOfIterationsToAverage; i++)
+    {
+      RenewPropagationModels ();
+      std::list <Ptr<SpectrumValue>> receivedPowerList;// RTD node id, rxPsd of the singal coming from that node
+
+      for (std::list<RemDevice>::iterator itRtd = m_remDev.begin ();
+           itRtd != m_remDev.end ();
+           ++itRtd)
+        {
+          // calculate received power from the current RTD device
+          receivedPowerList.push_back (CalcRxPsdValue (*itRtd, m_rrd));
+        } //end for std::list<RemDev>::iterator  (RTDs)
+
+      sumSnr += CalculateMaxSnr (receivedPowerList);
+      sumSinr += CalculateMaxSinr (receivedPowerList);
+      sumSir += CalculateMaxSir (receivedPowerList);
+
+      //Sum all the rxPowers (for this RemPoint) and put the result to the list for each Iteration (linear)
+      rxPsdsListPerIt.push_back (CalculateAggregatedIpsd (receivedPowerList));
+
+      receivedPowerList.clear ();
+    }//end for m_numOfIterationsToAverage  (Average)
+
+  //Sum the rxPower for all the Iterations (linear)
+  double rxPsdsAllIt = SumListElements (rxPsdsListPerIt);
+
+  remPoint->avgSnrDb = sumSnr / static_cast <double> (m_numOfIterationsToAverage);
+  remPoint->avgSinrDb = sumSinr / static_cast <double> (m_numOfIterationsToAverage);
+  remPoint->avgSirDb = sumSir / static_cast <double> (m_numOfIterationsToAverage);
+  //do the average (for the rxPowers in each RemPoint) in linear and then convert to dBm
+  remPoint->avRxPowerDbm = WToDbm (rxPsdsAllIt / static_cast <double> (m_numOfIterationsToAverage));
+
+  NS_LOG_INFO ("Avg snr value saved:" << remPoint->avgSnrDb);
+  NS_LOG_INFO ("Avg sinr value saved:" << remPoint->avgSinrDb);
+  NS_LOG_INFO ("Avg ipsd value saved (dBm):" << remPoint->avRxPowerDbm);
+}
+
+void
+NrRadioEnvironmentMapHelper::CalcArrayGains (const Ptr<const UniformPlanarArray>& antenna,
+                                             const std::vector<Vector>& directions,
+                                             std::vector<double> *gains)
+{
+  PhasedArrayModel::ComplexVector w = antenna->GetBeamformingVector ();
+  NS_ABORT_MSG_IF (w.size () != antenna->GetNumberOfElements (), "Beamforming vector not configured");
+
+  // The points are the inner loop, so that it runs over contiguous arrays
+  size_t numDirections = directions.size ();
+  std::vector<double> dx (numDirections), dy (numDirections), dz (numDirections);
+  for (size_t i = 0; i < numDirections; ++i)
+    {
+      dx[i] = directions[i].x;
+      dy[i] = directions[i].y;
+      dz[i] = directions[i].z;
+    }
+  std::vector<double> sumRe (numDirections, 0.0), sumIm (numDirections, 0.0);
+  for (size_t k = 0; k < w.size (); ++k)
+    {
+      Vector loc = antenna->GetElementLocation (k);
+      double x = 2 * M_PI * loc.x;
+      double y = 2 * M_PI * loc.y;
+      double z = 2 * M_PI * loc.z;
+      double wRe = w[k].real ();
+      double wIm = w[k].imag ();
+      for (size_t i = 0; i < numDirections; ++i)
+        {
+          double phase = dx[i] * x + dy[i] * y + dz[i] * z;
+          double c = std::cos (phase);
+          double s = std::sin (phase);
+          sumRe[i] += wRe * c - wIm * s;
+          sumIm[i] += wRe * s + wIm * c;
+        }
+    }
+
+  gains->resize (numDirections);
+  for (size_t i = 0; i < numDirections; ++i)
+    {
+      (*gains)[i] = sumRe[i] * sumRe[i] + sumIm[i] * sumIm[i];
+    }
+}
+
+double
+NrRadioEnvironmentMapHelper::CalcAnalyticPathGain (const RemDevice& rtd, double distance) const
+{
+  if (m_beamShapeModel == ANALYTIC_PATH_LOSS)
+    {
+      return DbToRatio (m_propagationLossModel->CalcRxPower (0, rtd.mob, m_rrd.mob));
+    }
+
+  // Friis, without gain over 1 in the near field
+  double lambda = 299792458.0 / rtd.frequency;
+  double gain = lambda / (4 * M_PI * distance);
+  return std::min (gain * gain, 1.0);
+}
+
+void
+NrRadioEnvironmentMapHelper::CalcAnalyticBeamShapeRemMap ()
+{
+  NS_LOG_FUNCTION (this << m_beamShapeModel);
+
+  m_remPointsDone = 0;
+  m_remSizeNextReport = static_cast<uint32_t> (m_rem.size () / 100);
+
+  // The RTD terms that do not depend on the REM point: the TX PSD in the
+  // spectrum model of the RRD, its sum (to select the strongest RTD as
+  // CalculateMaxSnr does) and its integral
+  size_t numBands = m_rrd.spectrumModel->GetNumBands ();
+  std::vector<const RemDevice*> rtds;
+  std::vector<double> txPsds;
+  std::vector<double> txSums;
+  std::vector<double> txPowers;
+  for (const auto &rtd : m_remDev)
+    {
+      Ptr<const SpectrumValue> txPsd = CalcConvertedTxPsd (rtd, m_rrd);
+      rtds.push_back (&rtd);
+      txPsds.insert (txPsds.end (), txPsd->ConstValuesBegin (), txPsd->ConstValuesEnd ());
+      txSums.push_back (Sum (*txPsd));
+      txPowers.push_back (Integral (*txPsd));
+    }
+  std::vector<double> noise (m_noisePsd->ConstValuesBegin (), m_noisePsd->ConstValuesEnd ());
+  size_t numRtds = rtds.size ();
+
+  // The gain layer of each RTD, over the whole grid
+  std::vector<std::vector<double> > layers (numRtds);
+  uint32_t numRead = 0;
+  for (size_t r = 0; r < numRtds; ++r)
+    {
+      numRead += GetAnalyticGainLayer (*rtds[r], &layers[r]) ? 1 : 0;
+    }
+  NS_LOG_INFO ("Gain layers read from the cache: " << numRead << ", calculated: " << numRtds - numRead);
+
+  // The same values as CalcBeamShapeRemPoint, from the PSDs of the RTDs
+  // scaled by their gains
+  std::vector<double> gains (numRtds);
+  std::vector<double> rxPsd (numRtds * numBands);
+  std::vector<double> totalPsd (numBands);
+  for (size_t cell = 0; cell < m_remGrid.size (); ++cell)
+    {
+      if (m_remGrid[cell] < 0)
+        {
+          continue;
+        }
 
-      for (uint16_t i = 0; i < m_numOfIterationsToAverage; i++)
+      std::fill (totalPsd.begin (), totalPsd.end (), 0.0);
+      size_t strongest = 0;
+      double rxPower = 0.0;
+      for (size_t r = 0; r < numRtds; ++r)
         {
-          std::list <Ptr<SpectrumValue>> receivedPowerList;// RTD node id, rxPsd of the singal coming from that node
+          gains[r] = layers[r][cell];
+          for (size_t b = 0; b < numBands; ++b)
+            {
+              rxPsd[r * numBands + b] = gains[r] * txPsds[r * numBands + b];
+              totalPsd[b] += rxPsd[r * numBands + b];
+            }
+          if (gains[r] * txSums[r] > gains[strongest] * txSums[strongest])
+            {
+              strongest = r;
+            }
+          rxPower += gains[r] * txPowers[r];
+        }
 
-          for (std::list<RemDevice>::iterator itRtd = m_remDev.begin ();
-               itRtd != m_remDev.end ();
-               ++itRtd)
+      double snr = 0.0;
+      for (size_t b = 0; b < numBands; ++b)
+        {
+          snr += rxPsd[strongest * numBands + b] / noise[b];
+        }
+
+      double maxSinr = 0.0, maxSir = 0.0;
+      for (size_t r = 0; r < numRtds; ++r)
+        {
+          double sinr = 0.0, sir = 0.0;
+          for (size_t b = 0; b < numBands; ++b)
             {
-              calcRxPsdCounter++;
+              double signal = rxPsd[r * numBands + b];
+              double interference = totalPsd[b] - signal;
+              sinr += signal / (interference + noise[b]);
+              // As CalculateSir, the signal alone without interferers
+              sir += numRtds > 1 ? signal / interference : signal;
+            }
+          maxSinr = std::max (maxSinr, sinr);
+          maxSir = std::max (maxSir, sir);
+        }
 
-               // calculate received power from the current RTD device
-              receivedPowerList.push_back (CalcRxPsdValue (*itRtd, m_rrd));
-            } //end for std::list<RemDev>::iterator  (RTDs)
+      RemPoint &remPoint = m_rem[static_cast<size_t> (m_remGrid[cell])];
+      remPoint.avgSnrDb = RatioToDb (snr / numBands);
+      remPoint.avgSinrDb = RatioToDb (maxSinr / numBands);
+      remPoint.avgSirDb = RatioToDb (maxSir / numBands);
+      remPoint.avRxPowerDbm = WToDbm (rxPower);
+      CountRemPointsDone (1);
+    }
+}
 
-          sumSnr += CalculateMaxSnr (receivedPowerList);
-          sumSinr += CalculateMaxSinr (receivedPowerList);
-          sumSir += CalculateMaxSir (receivedPowerList);
+bool
+NrRadioEnvironmentMapHelper::GetAnalyticGainLayer (const RemDevice& rtd, std::vector<double> *layer)
+{
+  NS_LOG_FUNCTION (this);
 
-          //Sum all the rxPowers (for this RemPoint) and put the result to the list for each Iteration (linear)
-          rxPsdsListPerIt.push_back (CalculateAggregatedIpsd (receivedPowerList));
+  std::string fileName;
+  std::string key;
+  if (!m_layerCacheDir.empty ())
+    {
+      key = GetAnalyticLayerKey (rtd);
+      std::ostringstream oss;
+      oss << m_layerCacheDir << "/nr-rem-layer-" << std::hex << std::hash<std::string> {} (key) << ".bin";
+      fileName = oss.str ();
+      if (ReadAnalyticGainLayer (fileName, key, layer))
+        {
+          NS_LOG_LOGIC ("Gain layer read from " << fileName);
+          return true;
+        }
+    }
+
+  CalcAnalyticGainLayer (rtd, layer);
 
-          receivedPowerList.clear ();
-        }//end for m_numOfIterationsToAverage  (Average)
+  if (!fileName.empty ())
+    {
+      WriteAnalyticGainLayer (fileName, key, *layer);
+    }
+  return false;
+}
 
-      //Sum the rxPower for all the Iterations (linear)
-      double rxPsdsAllIt = SumListElements (rxPsdsListPerIt);
+void
+NrRadioEnvironmentMapHelper::CalcAnalyticGainLayer (const RemDevice& rtd, std::vector<double> *layer)
+{
+  NS_LOG_FUNCTION (this);
 
-      itRemPoint->avgSnrDb = sumSnr / static_cast <double> (m_numOfIterationsToAverage);
-      itRemPoint->avgSinrDb = sumSinr / static_cast <double> (m_numOfIterationsToAverage);
-      itRemPoint->avgSirDb = sumSir / static_cast <double> (m_numOfIterationsToAverage);
-      //do the average (for the rxPowers in each RemPoint) in linear and then convert to dBm
-      itRemPoint->avRxPowerDbm = WToDbm (rxPsdsAllIt / static_cast <double> (m_numOfIterationsToAverage));
+  size_t numCells = m_remGrid.size ();
+  layer->resize (numCells);
+  Vector rtdPos = rtd.mob->GetPosition ();
+
+  // Gain of the RTD at each cell of a block: array gains of both ends along
+  // the direct path, element patterns and path gain. The cells at the
+  // position of an RTD are calculated too, so that the layer stays valid
+  // when that RTD moves.
+  const size_t blockSize = 1024;
+  std::vector<Vector> positions, txDirections, rxDirections;
+  std::vector<double> txGains, rxGains, distances;
+  for (size_t first = 0; first < numCells; first += blockSize)
+    {
+      size_t numPoints = std::min (blockSize, numCells - first);
+      positions.resize (numPoints);
+      txDirections.resize (numPoints);
+      rxDirections.resize (numPoints);
+      distances.resize (numPoints);
+      for (size_t i = 0; i < numPoints; ++i)
+        {
+          size_t cell = first + i;
+          positions[i] = Vector (m_gridX[cell / m_yNumPoints], m_gridY[cell % m_yNumPoints], m_z);
+          Vector d = positions[i] - rtdPos;
+          distances[i] = std::max (d.GetLength (), 1e-3);
+          txDirections[i] = Vector (d.x / distances[i], d.y / distances[i], d.z / distances[i]);
+          rxDirections[i] = Vector (-txDirections[i].x, -txDirections[i].y, -txDirections[i].z);
+        }
+      CalcArrayGains (rtd.antenna, txDirections, &txGains);
+      CalcArrayGains (m_rrd.antenna, rxDirections, &rxGains);
 
-      NS_LOG_INFO ("Avg snr value saved:" << itRemPoint->avgSnrDb);
-      NS_LOG_INFO ("Avg sinr value saved:" << itRemPoint->avgSinrDb);
-      NS_LOG_INFO ("Avg ipsd value saved (dBm):" << itRemPoint->avRxPowerDbm);
+      for (size_t i = 0; i < numPoints; ++i)
+        {
+          const Vector &pos = positions[i];
+          double txPhi, txTheta, rxPhi, rxTheta;
+          std::tie (txPhi, txTheta) = rtd.antenna->GetElementFieldPattern (Angles (pos, rtdPos));
+          std::tie (rxPhi, rxTheta) = m_rrd.antenna->GetElementFieldPattern (Angles (rtdPos, pos));
+          double field = txTheta * rxTheta + txPhi * rxPhi;
+          if (m_beamShapeModel == ANALYTIC_PATH_LOSS)
+            {
+              m_rrd.mob->SetPosition (pos);
+              if (m_buildingInfoNeeded)
+                {
+                  m_rrd.mob->GetObject<MobilityBuildingInfo> ()->MakeConsistent (m_rrd.mob);
+                }
+            }
+          (*layer)[first + i] = txGains[i] * rxGains[i] * field * field
+            * CalcAnalyticPathGain (rtd, distances[i]);
+        }
+    }
+}
 
-      if (++remPointCounter == remSizeNextReport)
+std::string
+NrRadioEnvironmentMapHelper::GetAnalyticLayerKey (const RemDevice& rtd) const
+{
+  std::ostringstream oss;
+  oss << std::setprecision (17) << "nr-rem-layer " << m_beamShapeModel
+      << " " << m_xMin << " " << m_xMax << " " << m_xRes
+      << " " << m_yMin << " " << m_yMax << " " << m_yRes << " " << m_z
+      << " | " << rtd.mob->GetPosition () << " " << rtd.frequency << " |";
+  AppendAntennaKey (oss, rtd.antenna);
+  oss << " |";
+  AppendAntennaKey (oss, m_rrd.antenna);
+  if (m_beamShapeModel == ANALYTIC_PATH_LOSS)
+    {
+      oss << " |";
+      AppendAttributesKey (oss, m_propagationLossModel);
+      // The buildings, on which the path loss and the channel condition
+      // may depend: their geometry and their materials
+      for (BuildingList::Iterator it = BuildingList::Begin (); it != BuildingList::End (); ++it)
         {
-          PrintProgressReport (&remSizeNextReport);
+          oss << " | " << (*it)->GetBoundaries () << " " << (*it)->GetBuildingType ()
+              << " " << (*it)->GetExtWallsType () << " " << (*it)->GetNFloors ()
+              << " " << (*it)->GetNRoomsX () << " " << (*it)->GetNRoomsY ();
         }
+    }
+  return oss.str ();
+}
 
-    } //end for std::list<RemPoint>::iterator  (RemPoints)
+void
+NrRadioEnvironmentMapHelper::AppendAntennaKey (std::ostream &os, const Ptr<const UniformPlanarArray>& antenna) const
+{
+  AppendAttributesKey (os, antenna);
+  for (const auto &weight : antenna->GetBeamformingVector ())
+    {
+      os << " " << weight.real () << "," << weight.imag ();
+    }
+}
 
-  auto remEndTime = std::chrono::system_clock::now ();
-  std::chrono::duration<double> remElapsedSeconds = remEndTime - m_remStartTime;
-  NS_LOG_INFO ("REM map created. Total time needed to create the REM map:" <<
-                 remElapsedSeconds.count () / 60 << " minutes.");
+void
+NrRadioEnvironmentMapHelper::AppendAttributesKey (std::ostream &os, const Ptr<const Object>& object) const
+{
+  TypeId tid = object->GetInstanceTypeId ();
+  os << " " << tid.GetName ();
+  while (true)
+    {
+      for (size_t i = 0; i < tid.GetAttributeN (); i++)
+        {
+          ns3::TypeId::AttributeInformation attributeInfo = tid.GetAttribute (i);
+          if (!attributeInfo.accessor->HasGetter ())
+            {
+              continue;
+            }
+          if (attributeInfo.checker->GetValueTypeName () == "ns3::PointerValue")
+            {
+              // The pointed object (e.g. the antenna element) by its attributes
+              PointerValue pointer;
+              object->GetAttribute (attributeInfo.name, pointer);
+              os << " " << attributeInfo.name << "=";
+              if (pointer.GetObject () != nullptr)
+                {
+                  AppendAttributesKey (os, pointer.GetObject ());
+                }
+              continue;
+            }
+          Ptr<AttributeValue> attributeValue = attributeInfo.checker->Create ();
+          object->GetAttribute (attributeInfo.name, *attributeValue);
+          os << " " << attributeInfo.name << "=" << attributeValue->SerializeToString (attributeInfo.checker);
+        }
+      if (!tid.HasParent ())
+        {
+          break;
+        }
+      tid = tid.GetParent ();
+    }
+}
+
+bool
+NrRadioEnvironmentMapHelper::ReadAnalyticGainLayer (const std::string &fileName, const std::string &key,
+                                                    std::vector<double> *layer) const
+{
+  std::ifstream inFile (fileName.c_str (), std::ios_base::in | std::ios_base::binary);
+  if (!inFile.is_open ())
+    {
+      return false;
+    }
+
+  // A file of another configuration with the same hash, or of another grid,
+  // is calculated again (and overwritten)
+  std::string line;
+  uint64_t numCells = 0;
+  if (!std::getline (inFile, line) || line != key
+      || !inFile.read (reinterpret_cast<char*> (&numCells), sizeof (numCells))
+      || numCells != m_remGrid.size ())
+    {
+      NS_LOG_LOGIC ("Gain layer " << fileName << " of another configuration");
+      return false;
+    }
+  layer->resize (numCells);
+  return static_cast<bool> (inFile.read (reinterpret_cast<char*> (layer->data ()),
+                                         static_cast<std::streamsize> (numCells * sizeof (double))));
+}
+
+void
+NrRadioEnvironmentMapHelper::WriteAnalyticGainLayer (const std::string &fileName, const std::string &key,
+                                                     const std::vector<double> &layer) const
+{
+  // Written aside and renamed, so that an interrupted run does not leave a
+  // truncated layer under the final name
+  std::string tmpFileName = fileName + ".tmp";
+  std::ofstream outFile (tmpFileName.c_str (), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  if (!outFile.is_open ())
+    {
+      NS_LOG_WARN ("Can't open file " << tmpFileName << ", the gain layer is not cached");
+      return;
+    }
+  uint64_t numCells = layer.size ();
+  outFile << key << '\n';
+  outFile.write (reinterpret_cast<const char*> (&numCells), sizeof (numCells));
+  outFile.write (reinterpret_cast<const char*> (layer.data ()),
+                 static_cast<std::streamsize> (numCells * sizeof (double)));
+  outFile.close ();
+  if (!outFile || std::rename (tmpFileName.c_str (), fileName.c_str ()) != 0)
+    {
+      NS_LOG_WARN ("Can't write file " << fileName << ", the gain layer is not cached");
+      std::remove (tmpFileName.c_str ());
+    }
 }
 
 double
@@ -994,118 +1568,139 @@ void
 NrRadioEnvironmentMapHelper::CalcCoverageAreaRemMap ()
 {
   NS_LOG_FUNCTION (this);
-  uint16_t calcRxPsdCounter = 0;
-  uint32_t remSizeNextReport = m_rem.size () / 100;
-  uint32_t remPointCounter = 0;
-
-  for (std::list<RemPoint>::iterator itRemPoint = m_rem.begin ();
-      itRemPoint != m_rem.end ();
-      ++itRemPoint)
-    {
-      //perform calculation m_numOfIterationsToAverage times and get the average value
-      double sumSnr = 0.0, sumSinr = 0.0;
-      m_rrd.mob->SetPosition (itRemPoint->pos);
-
-      // all RTDs should point toward that RemPoint with DirectPah beam, this is definition of worst-case scenario
-     for(std::list<RemDevice>::iterator itRtd = m_remDev.begin ();
-         itRtd != m_remDev.end ();
-                ++itRtd)
-        {
-          ConfigureDirectPathBfv (*itRtd, m_rrd, itRtd->antenna);
-        }
 
-      std::list<double> rxPsdsListPerIt; //list to save the summed rxPower in each RemPoint for each Iteration (linear)
+  CalcRemMap (&NrRadioEnvironmentMapHelper::CalcCoverageAreaRemPoint);
 
-      for (uint16_t i = 0; i < m_numOfIterationsToAverage; i++)
-        {
-          std::list<double> sinrsPerBeam; // vector in which we will save sinr per each RRD beam
-          std::list<double> snrsPerBeam; // vector in which we will save snr per each RRD beam
+  auto remEndTime = std::chrono::system_clock::now ();
+  std::chrono::duration<double> remElapsedSeconds = remEndTime - m_remStartTime;
+  NS_LOG_INFO ("REM map created. Total time needed to create the REM map:" <<
+                 remElapsedSeconds.count () / 60 << " minutes.");
+}
 
-          std::list<Ptr<SpectrumValue>> rxPsdsList; //vector in which we will save the sum of rxPowers per remPoint (linear)
+void
+NrRadioEnvironmentMapHelper::CalcCoverageAreaRemPoint (RemPoint *remPoint)
+{
+  //perform calculation m_numOfIterationsToAverage times and get the average value
+  double sumSnr = 0.0, sumSinr = 0.0;
+  m_rrd.mob->SetPosition (remPoint->pos);
 
-          // For each beam configuration at RemPoint/RRD we should calculate SINR, there are as many beam configurations at RemPoint as many RTDs
-          for (std::list<RemDevice>::iterator itRtdBeam = m_remDev.begin (); itRtdBeam != m_remDev.end (); ++itRtdBeam)
-            {
-              //configure RRD beam toward RTD
-              ConfigureDirectPathBfv (m_rrd, *itRtdBeam, m_rrd.antenna);
+  // all RTDs should point toward that RemPoint with DirectPah beam, this is definition of worst-case scenario
+  for (std::list<RemDevice>::iterator itRtd = m_remDev.begin ();
+       itRtd != m_remDev.end ();
+       ++itRtd)
+    {
+      ConfigureDirectPathBfv (*itRtd, m_rrd, itRtd->antenna);
+    }
 
-              //Calculate the received power from this RTD for this RemPoint
-              Ptr<SpectrumValue> receivedPowerFromRtd = CalcRxPsdValue (*itRtdBeam, m_rrd);
-              //and put it to the list of the received powers for this RemPoint (to sum all later)
-              rxPsdsList.push_back (receivedPowerFromRtd);
+  std::list<double> rxPsdsListPerIt; //list to save the summed rxPower in each RemPoint for each Iteration (linear)
 
-              NS_LOG_DEBUG ("beam node: " << itRtdBeam->dev->GetNode ()->GetId () <<
-                            " is Rxed in RemPoint with Rx Power in W: " << (Integral (*receivedPowerFromRtd)));
-              NS_LOG_DEBUG ("RxPower in dBm: " << WToDbm (Integral (*receivedPowerFromRtd)));
+  // The TX PSD of each RTD, converted to the RRD spectrum model, does not
+  // depend on the beams or on the channel: calculate it once per RemPoint
+  std::vector<Ptr<const SpectrumValue>> txPsds;
+  txPsds.reserve (m_remDev.size ());
+  for (const auto &rtd : m_remDev)
+    {
+      txPsds.push_back (CalcConvertedTxPsd (rtd, m_rrd));
+    }
 
-              std::list<Ptr<SpectrumValue>> interferenceSignalsRxPsds;
-              Ptr<SpectrumValue> usefulSignalRxPsd;
+  std::vector<double> pathGains (m_remDev.size ());
 
-              // For this configuration of beam at RRD, we need to calculate RX PSD,
-              // and in order to be able to calculate SINR for that beam,
-              // we need to calculate received PSD for each RTD using this beam at RRD
-              for(std::list<RemDevice>::iterator itRtdCalc = m_remDev.begin (); itRtdCalc != m_remDev.end (); ++itRtdCalc)
-                {
-                  // increase counter de calcRXPsd calls
-                  calcRxPsdCounter++;
-                  // calculate received power from the current RTD device
-                  Ptr<SpectrumValue> receivedPower = CalcRxPsdValue (*itRtdCalc, m_rrd);
+  for (uint16_t i = 0; i < m_numOfIterationsToAverage; i++)
+    {
+      RenewPropagationModels ();
+      std::list<double> sinrsPerBeam; // vector in which we will save sinr per each RRD beam
+      std::list<double> snrsPerBeam; // vector in which we will save snr per each RRD beam
 
-                  // is this received power useful signal (from RTD for which I configured my beam) or is interference signal
+      std::list<Ptr<SpectrumValue>> rxPsdsList; //vector in which we will save the sum of rxPowers per remPoint (linear)
 
-                  if (itRtdBeam->dev->GetNode ()->GetId () == itRtdCalc->dev->GetNode ()->GetId ())
-                    {
-                      if (usefulSignalRxPsd != nullptr)
-                        {
-                          NS_FATAL_ERROR ("Already assigned usefulSignal!");
-                        }
-                      usefulSignalRxPsd = receivedPower;
-                    }
-                  else
-                    {
-                      interferenceSignalsRxPsds.push_back (receivedPower);  //interference
-                    }
+      // With PER_REALIZATION, the path loss of each RTD is the same for all
+      // the RRD beams of this iteration: calculate it once
+      if (m_propModelsLifetime == PER_REALIZATION)
+        {
+          size_t rtdIndex = 0;
+          for (auto &rtd : m_remDev)
+            {
+              pathGains[rtdIndex++] = DbToRatio (m_sharedPropModels.remPropagationLossModelCopy->CalcRxPower (0, rtd.mob, m_rrd.mob));
+            }
+        }
 
-                } //end for std::list<RemDev>::iterator itRtdCalc (RTDs)
+      // For each beam configuration at RemPoint/RRD we should calculate SINR, there are as many beam configurations at RemPoint as many RTDs
+      for (std::list<RemDevice>::iterator itRtdBeam = m_remDev.begin (); itRtdBeam != m_remDev.end (); ++itRtdBeam)
+        {
+          //configure RRD beam toward RTD
+          ConfigureDirectPathBfv (m_rrd, *itRtdBeam, m_rrd.antenna);
+
+          std::list<Ptr<SpectrumValue>> interferenceSignalsRxPsds;
+          Ptr<SpectrumValue> usefulSignalRxPsd;
+
+          // For this configuration of beam at RRD, we need to calculate RX PSD,
+          // and in order to be able to calculate SINR for that beam,
+          // we need to calculate received PSD for each RTD using this beam at RRD.
+          // Each (RTD, beam) PSD is calculated once: the one of the RTD
+          // toward which the beam points is also its received power
+          size_t rtdIndex = 0;
+          for(std::list<RemDevice>::iterator itRtdCalc = m_remDev.begin (); itRtdCalc != m_remDev.end (); ++itRtdCalc, ++rtdIndex)
+            {
+              // calculate received power from the current RTD device
+              Ptr<SpectrumValue> receivedPower;
+              if (m_propModelsLifetime == PER_REALIZATION)
+                {
+                  receivedPower = CalcBeamformedRxPsd (m_sharedPropModels, *itRtdCalc, m_rrd,
+                                                       txPsds[rtdIndex], pathGains[rtdIndex]);
+                }
+              else
+                {
+                  PropagationModels tempPropModels = CreateTemporalPropagationModels ();
+                  double pathLossDb = tempPropModels.remPropagationLossModelCopy->CalcRxPower (0, itRtdCalc->mob, m_rrd.mob);
+                  receivedPower = CalcBeamformedRxPsd (tempPropModels, *itRtdCalc, m_rrd,
+                                                       txPsds[rtdIndex], DbToRatio (pathLossDb));
+                }
 
-              sinrsPerBeam.push_back (CalculateSinr (usefulSignalRxPsd, interferenceSignalsRxPsds));
-              snrsPerBeam.push_back (CalculateSnr (usefulSignalRxPsd));
+              // is this received power useful signal (from RTD for which I configured my beam) or is interference signal
 
-              NS_LOG_INFO ("Done:" <<
-                           (double)calcRxPsdCounter/(m_rem.size()*m_numOfIterationsToAverage*m_remDev.size ()*m_remDev.size()) * 100 <<
-                           " %."); // how many times will be called CalcRxPsdValues
+              if (itRtdBeam->dev->GetNode ()->GetId () == itRtdCalc->dev->GetNode ()->GetId ())
+                {
+                  if (usefulSignalRxPsd != nullptr)
+                    {
+                      NS_FATAL_ERROR ("Already assigned usefulSignal!");
+                    }
+                  usefulSignalRxPsd = receivedPower;
+                  //and put it to the list of the received powers for this RemPoint (to sum all later)
+                  rxPsdsList.push_back (receivedPower);
 
-            } //end for std::list<RemDev>::iterator itRtdBeam (RTDs)
+                  NS_LOG_DEBUG ("beam node: " << itRtdBeam->dev->GetNode ()->GetId () <<
+                                " is Rxed in RemPoint with Rx Power in W: " << (Integral (*receivedPower)));
+                  NS_LOG_DEBUG ("RxPower in dBm: " << WToDbm (Integral (*receivedPower)));
+                }
+              else
+                {
+                  interferenceSignalsRxPsds.push_back (receivedPower);  //interference
+                }
 
-          sumSnr += GetMaxValue (snrsPerBeam);
-          sumSinr += GetMaxValue (sinrsPerBeam);
+            } //end for std::list<RemDev>::iterator itRtdCalc (RTDs)
 
-          //Sum all the rxPowers (for this RemPoint) and put the result to the list for each Iteration (linear)
-          rxPsdsListPerIt.push_back (CalculateAggregatedIpsd (rxPsdsList));
+          sinrsPerBeam.push_back (CalculateSinr (usefulSignalRxPsd, interferenceSignalsRxPsds));
+          snrsPerBeam.push_back (CalculateSnr (usefulSignalRxPsd));
 
-        }//end for m_numOfIterationsToAverage  (Average)
+        } //end for std::list<RemDev>::iterator itRtdBeam (RTDs)
 
-      //Sum the rxPower for all the Iterations (linear)
-      double rxPsdsAllIt = SumListElements (rxPsdsListPerIt);
+      sumSnr += GetMaxValue (snrsPerBeam);
+      sumSinr += GetMaxValue (sinrsPerBeam);
 
-      itRemPoint->avgSnrDb = sumSnr / static_cast <double> (m_numOfIterationsToAverage);
-      itRemPoint->avgSinrDb = sumSinr / static_cast <double> (m_numOfIterationsToAverage);
-      //do the average (for the rxPowers in each RemPoint) in linear and then convert to dBm
-      itRemPoint->avRxPowerDbm = WToDbm (rxPsdsAllIt / static_cast <double> (m_numOfIterationsToAverage));
+      //Sum all the rxPowers (for this RemPoint) and put the result to the list for each Iteration (linear)
+      rxPsdsListPerIt.push_back (CalculateAggregatedIpsd (rxPsdsList));
 
-      if (++remPointCounter == remSizeNextReport)
-        {
-          PrintProgressReport (&remSizeNextReport);
-        }
+    }//end for m_numOfIterationsToAverage  (Average)
 
-      NS_LOG_DEBUG ("itRemPoint->avRxPowerDb  in dB: " << itRemPoint->avRxPowerDbm);
+  //Sum the rxPower for all the Iterations (linear)
+  double rxPsdsAllIt = SumListElements (rxPsdsListPerIt);
 
-    } //end for std::list<RemPoint>::iterator  (RemPoints)
+  remPoint->avgSnrDb = sumSnr / static_cast <double> (m_numOfIterationsToAverage);
+  remPoint->avgSinrDb = sumSinr / static_cast <double> (m_numOfIterationsToAverage);
+  //do the average (for the rxPowers in each RemPoint) in linear and then convert to dBm
+  remPoint->avRxPowerDbm = WToDbm (rxPsdsAllIt / static_cast <double> (m_numOfIterationsToAverage));
 
-  auto remEndTime = std::chrono::system_clock::now ();
-  std::chrono::duration<double> remElapsedSeconds = remEndTime - m_remStartTime;
-  NS_LOG_INFO ("REM map created. Total time needed to create the REM map:" <<
-                 remElapsedSeconds.count () / 60 << " minutes.");
+  NS_LOG_DEBUG ("remPoint->avRxPowerDb  in dB: " << remPoint->avRxPowerDbm);
 }
 
 void
@@ -1128,92 +1723,514 @@ NrRadioEnvironmentMapHelper::PrintProgressReport (uint32_t* remSizeNextReport)
 }
 
 void
-NrRadioEnvironmentMapHelper::CalcUeCoverageRemMap ()
+NrRadioEnvironmentMapHelper::CountRemPointsDone (size_t numPoints)
+{
+  m_remPointsDone += numPoints;
+  while (m_remSizeNextReport > 0 && m_remPointsDone >= m_remSizeNextReport
+         && m_remSizeNextReport <= m_rem.size ())
+    {
+      PrintProgressReport (&m_remSizeNextReport);
+    }
+}
+
+void
+NrRadioEnvironmentMapHelper::CalcRemMap (CalcRemPointFn calcRemPoint)
 {
-    NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << m_tileSize);
 
-    uint32_t remSizeNextReport = m_rem.size () / 100;
-    uint32_t remPointCounter = 0;
+  m_remPointsDone = 0;
+  m_remSizeNextReport = static_cast<uint32_t> (m_rem.size () / 100);
 
-    for (std::list<RemPoint>::iterator itRemPoint = m_rem.begin ();
-        itRemPoint != m_rem.end ();
-        ++itRemPoint)
-      {
-        //perform calculation m_numOfIterationsToAverage times and get the average value
-        double sumSnr = 0.0, sumSinr = 0.0;
-        m_rrd.mob->SetPosition (itRemPoint->pos);
+  if (m_pointStreamBase >= 0)
+    {
+      // Reserve for each point the streams of the largest number of model
+      // sets that a point can create: one per received power calculation
+      // with PER_CALL, at most (RTDs + 1)^2 per averaging iteration
+      m_pointStreamStride = 0;
+      int64_t streamsPerSet = AssignTemporalStreams (CreateTemporalPropagationModels (),
+                                                     m_pointStreamBase);
+      int64_t setsPerPoint = static_cast<int64_t> (m_numOfIterationsToAverage)
+        * static_cast<int64_t> ((m_remDev.size () + 1) * (m_remDev.size () + 1));
+      m_pointStreamStride = streamsPerSet * setsPerPoint;
+      NS_LOG_INFO ("Each REM point uses the streams of its own block of " << m_pointStreamStride);
+    }
 
-        for (uint16_t i = 0; i < m_numOfIterationsToAverage; i++)
-          {
-            std::list<double> sinrsPerBeam; // vector in which we will save sinr per each RRD beam
-            std::list<double> snrsPerBeam; // vector in which we will save snr per each RRD beam
+  if (m_tileSize == 0)
+    {
+      CalcRemRegion (calcRemPoint, 0, m_xNumPoints, 0, m_yNumPoints);
+      return;
+    }
 
-            //"Associate" UE (RemPoint) with this RTD
-            for (std::list<RemDevice>::iterator itRtdAssociated = m_remDev.begin ();
-                 itRtdAssociated != m_remDev.end ();
-                 ++itRtdAssociated)
-              {
-                //configure RRD (RemPoint) beam toward RTD (itRtdAssociated)
-                ConfigureDirectPathBfv (m_rrd, *itRtdAssociated, m_rrd.antenna);
-                //configure RTD (itRtdAssociated) beam toward RRD (RemPoint)
-                ConfigureDirectPathBfv (*itRtdAssociated, m_rrd, itRtdAssociated->antenna);
+  uint32_t xTiles = (m_xNumPoints + m_tileSize - 1) / m_tileSize;
+  uint32_t yTiles = (m_yNumPoints + m_tileSize - 1) / m_tileSize;
+  uint32_t numTiles = xTiles * yTiles;
 
-                std::list<Ptr<SpectrumValue>> interferenceSignalsRxPsds;
-                Ptr<SpectrumValue> usefulSignalRxPsd;
+  std::vector<bool> tileDone (numTiles, false);
+  if (m_resumeTiles)
+    {
+      tileDone = ReadTileCheckpoint (numTiles);
+    }
 
-                for(std::list<RemDevice>::iterator itRtdInterferer = m_remDev.begin ();
-                    itRtdInterferer != m_remDev.end ();
-                    ++itRtdInterferer)
-                  {
-                    if (itRtdAssociated->dev->GetNode ()->GetId () != itRtdInterferer->dev->GetNode ()->GetId ())
-                    {
-                      //configure RTD (itRtdInterferer) beam toward RTD (itRtdAssociated)
-                      ConfigureDirectPathBfv (*itRtdInterferer, *itRtdAssociated, itRtdInterferer->antenna);
+  // Rewrite the checkpoint with the complete tiles only, so that a block
+  // truncated by the previous run does not stay in the middle of the file
+  std::ofstream outFile (GetTileCheckpointFileName ().c_str (), std::ios_base::out | std::ios_base::trunc);
+  NS_ABORT_MSG_IF (!outFile.is_open (), "Can't open file " << GetTileCheckpointFileName ());
+  outFile << "nr-rem-tiles " << m_xNumPoints << " " << m_yNumPoints << " " << m_tileSize
+          << " " << m_refinementStep << " " << m_remMode << std::endl;
 
-                      // calculate received power (interference) from the current RTD device
-                      Ptr<SpectrumValue> receivedPower = CalcRxPsdValue (*itRtdInterferer, *itRtdAssociated);
+  for (uint32_t tile = 0; tile < numTiles; ++tile)
+    {
+      uint32_t xBegin = (tile / yTiles) * m_tileSize;
+      uint32_t yBegin = (tile % yTiles) * m_tileSize;
+      uint32_t xEnd = std::min (xBegin + m_tileSize, m_xNumPoints);
+      uint32_t yEnd = std::min (yBegin + m_tileSize, m_yNumPoints);
 
-                      interferenceSignalsRxPsds.push_back (receivedPower);  //interference
-                    }
-                    else
+      if (tileDone[tile])
+        {
+          NS_LOG_INFO ("Tile " << tile << " read from the checkpoint");
+          size_t numPoints = 0;
+          for (uint32_t x = xBegin; x < xEnd; ++x)
+            {
+              for (uint32_t y = yBegin; y < yEnd; ++y)
+                {
+                  numPoints += GetGridPoint (x, y) != nullptr ? 1 : 0;
+                }
+            }
+          CountRemPointsDone (numPoints);
+        }
+      else
+        {
+          CalcRemRegion (calcRemPoint, xBegin, xEnd, yBegin, yEnd);
+        }
+      WriteTileCheckpoint (outFile, tile, xBegin, xEnd, yBegin, yEnd);
+    }
+
+  outFile.close ();
+}
+
+void
+NrRadioEnvironmentMapHelper::CalcRemRegion (CalcRemPointFn calcRemPoint, uint32_t xBegin,
+                                            uint32_t xEnd, uint32_t yBegin, uint32_t yEnd)
+{
+  NS_LOG_FUNCTION (this << xBegin << xEnd << yBegin << yEnd);
+  NS_ASSERT (xBegin < xEnd && yBegin < yEnd);
+
+  std::vector<RemPoint*> points;
+
+  if (m_refinementStep <= 1)
+    {
+      for (uint32_t x = xBegin; x < xEnd; ++x)
+        {
+          for (uint32_t y = yBegin; y < yEnd; ++y)
+            {
+              RemPoint *remPoint = GetGridPoint (x, y);
+              if (remPoint != nullptr)
+                {
+                  points.push_back (remPoint);
+                }
+            }
+        }
+      CalcRemPoints (calcRemPoint, points);
+      return;
+    }
+
+  // The lines of the coarse grid: every m_refinementStep, plus the last one
+  auto coarseLines = [this] (uint32_t begin, uint32_t end)
+    {
+      std::vector<uint32_t> lines;
+      for (uint32_t i = begin; i < end; i += m_refinementStep)
+        {
+          lines.push_back (i);
+        }
+      if (lines.back () != end - 1)
+        {
+          lines.push_back (end - 1);
+        }
+      return lines;
+    };
+  std::vector<uint32_t> xLines = coarseLines (xBegin, xEnd);
+  std::vector<uint32_t> yLines = coarseLines (yBegin, yEnd);
+
+  // Points of the rectangle already calculated (or interpolated)
+  const uint32_t height = yEnd - yBegin;
+  std::vector<bool> done (static_cast<size_t> (xEnd - xBegin) * height, false);
+  auto isDone = [&] (uint32_t x, uint32_t y)
+    {
+      return done[static_cast<size_t> (x - xBegin) * height + (y - yBegin)];
+    };
+  auto setDone = [&] (uint32_t x, uint32_t y)
+    {
+      done[static_cast<size_t> (x - xBegin) * height + (y - yBegin)] = true;
+    };
+
+  // Coarse grid
+  for (uint32_t x : xLines)
+    {
+      for (uint32_t y : yLines)
+        {
+          RemPoint *remPoint = GetGridPoint (x, y);
+          if (remPoint != nullptr)
+            {
+              points.push_back (remPoint);
+            }
+          setDone (x, y);
+        }
+    }
+  CalcRemPoints (calcRemPoint, points);
+
+  // A cell spans from a coarse line to the next one. With a single line in
+  // a direction, the cells are degenerate in that direction.
+  struct Cell
+  {
+    uint32_t x0, x1, y0, y1;
+  };
+  std::vector<Cell> interpolatedCells;
+  points.clear ();
+  for (size_t a = 0; a < std::max<size_t> (1, xLines.size () - 1); ++a)
+    {
+      for (size_t b = 0; b < std::max<size_t> (1, yLines.size () - 1); ++b)
+        {
+          Cell cell {xLines[a], xLines[std::min (a + 1, xLines.size () - 1)],
+                     yLines[b], yLines[std::min (b + 1, yLines.size () - 1)]};
+          const RemPoint *corners[4] = {GetGridPoint (cell.x0, cell.y0), GetGridPoint (cell.x1, cell.y0),
+                                        GetGridPoint (cell.x0, cell.y1), GetGridPoint (cell.x1, cell.y1)};
+
+          bool refine = false;
+          double minSnr = std::numeric_limits<double>::max ();
+          double maxSnr = std::numeric_limits<double>::lowest ();
+          double minSinr = minSnr, maxSinr = maxSnr;
+          for (const RemPoint *corner : corners)
+            {
+              if (corner == nullptr)
+                {
+                  refine = true;
+                  break;
+                }
+              minSnr = std::min (minSnr, corner->avgSnrDb);
+              maxSnr = std::max (maxSnr, corner->avgSnrDb);
+              minSinr = std::min (minSinr, corner->avgSinrDb);
+              maxSinr = std::max (maxSinr, corner->avgSinrDb);
+            }
+          refine = refine || !(maxSnr - minSnr <= m_refinementThreshold)
+            || !(maxSinr - minSinr <= m_refinementThreshold);
+
+          if (!refine)
+            {
+              interpolatedCells.push_back (cell);
+              continue;
+            }
+          for (uint32_t x = cell.x0; x <= cell.x1; ++x)
+            {
+              for (uint32_t y = cell.y0; y <= cell.y1; ++y)
+                {
+                  if (!isDone (x, y))
                     {
-                      // calculate received power (useful Signal) from the current RRD device
-                      Ptr<SpectrumValue> receivedPower = CalcRxPsdValue (m_rrd, *itRtdAssociated);
-                      if (usefulSignalRxPsd != nullptr)
+                      RemPoint *remPoint = GetGridPoint (x, y);
+                      if (remPoint != nullptr)
                         {
-                          NS_FATAL_ERROR ("Already assigned usefulSignal!");
+                          points.push_back (remPoint);
                         }
-                      usefulSignalRxPsd = receivedPower;
+                      setDone (x, y);
                     }
+                }
+            }
+        }
+    }
+  NS_LOG_INFO ("Refining " << points.size () << " REM points, interpolating "
+               << interpolatedCells.size () << " cells");
+  CalcRemPoints (calcRemPoint, points);
+
+  // The points left are inside cells with smooth corners (or on their
+  // edges): interpolate them bilinearly
+  size_t numInterpolated = 0;
+  for (const auto &cell : interpolatedCells)
+    {
+      const RemPoint *p00 = GetGridPoint (cell.x0, cell.y0);
+      const RemPoint *p10 = GetGridPoint (cell.x1, cell.y0);
+      const RemPoint *p01 = GetGridPoint (cell.x0, cell.y1);
+      const RemPoint *p11 = GetGridPoint (cell.x1, cell.y1);
+      for (uint32_t x = cell.x0; x <= cell.x1; ++x)
+        {
+          for (uint32_t y = cell.y0; y <= cell.y1; ++y)
+            {
+              if (isDone (x, y))
+                {
+                  continue;
+                }
+              setDone (x, y);
+              RemPoint *remPoint = GetGridPoint (x, y);
+              if (remPoint == nullptr)
+                {
+                  continue;
+                }
+              double fx = cell.x1 > cell.x0 ? static_cast<double> (x - cell.x0) / (cell.x1 - cell.x0) : 0.0;
+              double fy = cell.y1 > cell.y0 ? static_cast<double> (y - cell.y0) / (cell.y1 - cell.y0) : 0.0;
+              auto interpolate = [fx, fy, p00, p10, p01, p11] (double RemPoint::*value)
+                {
+                  return (1 - fx) * (1 - fy) * p00->*value + fx * (1 - fy) * p10->*value
+                    + (1 - fx) * fy * p01->*value + fx * fy * p11->*value;
+                };
+              remPoint->avgSnrDb = interpolate (&RemPoint::avgSnrDb);
+              remPoint->avgSinrDb = interpolate (&RemPoint::avgSinrDb);
+              remPoint->avgSirDb = interpolate (&RemPoint::avgSirDb);
+              remPoint->avRxPowerDbm = interpolate (&RemPoint::avRxPowerDbm);
+              ++numInterpolated;
+            }
+        }
+    }
+  CountRemPointsDone (numInterpolated);
+}
 
-                  }//end for std::list<RemDev>::iterator itRtdInterferer (RTD)
+void
+NrRadioEnvironmentMapHelper::CalcRemPoints (CalcRemPointFn calcRemPoint,
+                                            const std::vector<RemPoint*> &points)
+{
+  NS_LOG_FUNCTION (this << points.size ());
 
-                sinrsPerBeam.push_back (CalculateSinr (usefulSignalRxPsd, interferenceSignalsRxPsds));
-                snrsPerBeam.push_back (CalculateSnr (usefulSignalRxPsd));
+  if (points.empty ())
+    {
+      return;
+    }
 
-              }//end for std::list<RemDev>::iterator itRtdAssociated (RTD)
+  if (m_computeBackend == nullptr)
+    {
+      if (m_numWorkers > 1)
+        {
+          m_computeBackend = CreateObjectWithAttributes<NrRemWorkersBackend> ("NumWorkers",
+                                                                              UintegerValue (m_numWorkers));
+        }
+      else
+        {
+          m_computeBackend = CreateObject<NrRemSerialBackend> ();
+        }
+    }
 
-            sumSnr += GetMaxValue (snrsPerBeam);
-            sumSinr += GetMaxValue (sinrsPerBeam);
+  auto calcPoint = [this, calcRemPoint, &points] (size_t i, NrRemComputeBackend::PointValues &values)
+    {
+      StartPointStreams (points[i]);
+      (this->*calcRemPoint) (points[i]);
+      values = {points[i]->avgSnrDb, points[i]->avgSinrDb,
+                points[i]->avgSirDb, points[i]->avRxPowerDbm};
+    };
+  auto storePoint = [this, &points] (size_t i, const NrRemComputeBackend::PointValues &values)
+    {
+      points[i]->avgSnrDb = values[0];
+      points[i]->avgSinrDb = values[1];
+      points[i]->avgSirDb = values[2];
+      points[i]->avRxPowerDbm = values[3];
+      CountRemPointsDone (1);
+    };
+
+  if (!m_computeBackend->CalcPoints (points.size (), calcPoint, storePoint))
+    {
+      NrRemSerialBackend serial;
+      serial.CalcPoints (points.size (), calcPoint, storePoint);
+    }
+}
+
+std::string
+NrRadioEnvironmentMapHelper::GetTileCheckpointFileName () const
+{
+  std::ostringstream oss;
+  oss << "nr-rem-" << m_simTag << "-tiles.out";
+  return oss.str ();
+}
 
-          }//end for m_numOfIterationsToAverage  (Average)
+std::vector<bool>
+NrRadioEnvironmentMapHelper::ReadTileCheckpoint (uint32_t numTiles)
+{
+  NS_LOG_FUNCTION (this << numTiles);
 
-        itRemPoint->avgSnrDb = sumSnr / static_cast <double> (m_numOfIterationsToAverage);
-        itRemPoint->avgSinrDb = sumSinr / static_cast <double> (m_numOfIterationsToAverage);
+  std::vector<bool> tileDone (numTiles, false);
+  std::ifstream inFile (GetTileCheckpointFileName ().c_str ());
+  if (!inFile.is_open ())
+    {
+      NS_LOG_INFO ("No checkpoint file " << GetTileCheckpointFileName () << ", starting from scratch");
+      return tileDone;
+    }
 
-        if (++remPointCounter == remSizeNextReport)
-          {
-            PrintProgressReport (&remSizeNextReport);
-          }
+  std::string line;
+  std::ostringstream header;
+  header << "nr-rem-tiles " << m_xNumPoints << " " << m_yNumPoints << " " << m_tileSize
+         << " " << m_refinementStep << " " << m_remMode;
+  if (!std::getline (inFile, line) || line != header.str ())
+    {
+      NS_ABORT_MSG ("The checkpoint file " << GetTileCheckpointFileName ()
+                    << " belongs to a different REM (\"" << line << "\" instead of \""
+                    << header.str () << "\")");
+    }
+
+  // Each tile is a block "tile <index> <points>", one line per point
+  // "<point index> <snr> <sinr> <sir> <rx power>", and "end <index>"
+  std::vector<std::pair<size_t, RemPoint> > values;
+  while (std::getline (inFile, line))
+    {
+      uint32_t tile = 0;
+      size_t numPoints = 0;
+      std::istringstream tileLine (line);
+      std::string keyword;
+      if (!(tileLine >> keyword >> tile >> numPoints) || keyword != "tile" || tile >= numTiles)
+        {
+          break;
+        }
+
+      values.clear ();
+      for (size_t i = 0; i < numPoints && std::getline (inFile, line); ++i)
+        {
+          // strtod, unlike operator>>, parses inf and nan
+          const char *begin = line.c_str ();
+          char *end = nullptr;
+          size_t index = std::strtoul (begin, &end, 10);
+          RemPoint remPoint;
+          remPoint.avgSnrDb = std::strtod (end, &end);
+          remPoint.avgSinrDb = std::strtod (end, &end);
+          remPoint.avgSirDb = std::strtod (end, &end);
+          remPoint.avRxPowerDbm = std::strtod (end, &end);
+          if (end == begin || index >= m_rem.size ())
+            {
+              break;
+            }
+          values.emplace_back (index, remPoint);
+        }
+
+      std::istringstream endLine;
+      uint32_t endTile = 0;
+      if (values.size () != numPoints || !std::getline (inFile, line))
+        {
+          break;
+        }
+      endLine.str (line);
+      if (!(endLine >> keyword >> endTile) || keyword != "end" || endTile != tile)
+        {
+          break;
+        }
+
+      for (const auto &v : values)
+        {
+          m_rem[v.first].avgSnrDb = v.second.avgSnrDb;
+          m_rem[v.first].avgSinrDb = v.second.avgSinrDb;
+          m_rem[v.first].avgSirDb = v.second.avgSirDb;
+          m_rem[v.first].avRxPowerDbm = v.second.avRxPowerDbm;
+        }
+      tileDone[tile] = true;
+    }
+
+  NS_LOG_INFO ("Read " << std::count (tileDone.begin (), tileDone.end (), true)
+               << " tiles from " << GetTileCheckpointFileName ());
+  return tileDone;
+}
+
+void
+NrRadioEnvironmentMapHelper::WriteTileCheckpoint (std::ofstream &outFile, uint32_t tile,
+                                                  uint32_t xBegin, uint32_t xEnd,
+                                                  uint32_t yBegin, uint32_t yEnd)
+{
+  std::vector<int64_t> indexes;
+  for (uint32_t x = xBegin; x < xEnd; ++x)
+    {
+      for (uint32_t y = yBegin; y < yEnd; ++y)
+        {
+          int64_t index = m_remGrid[static_cast<size_t> (x) * m_yNumPoints + y];
+          if (index >= 0)
+            {
+              indexes.push_back (index);
+            }
+        }
+    }
 
-      }//end for std::list<RemPoint>::iterator  (RemPoints)
+  outFile << std::setprecision (std::numeric_limits<double>::max_digits10);
+  outFile << "tile " << tile << " " << indexes.size () << "\n";
+  for (int64_t index : indexes)
+    {
+      const RemPoint &remPoint = m_rem[static_cast<size_t> (index)];
+      outFile << index << " " << remPoint.avgSnrDb << " " << remPoint.avgSinrDb << " "
+              << remPoint.avgSirDb << " " << remPoint.avRxPowerDbm << "\n";
+    }
+  // The end line marks the block as complete
+  outFile << "end " << tile << std::endl;
+  NS_ABORT_MSG_IF (!outFile, "Could not write the tile " << tile << " to " << GetTileCheckpointFileName ());
+}
 
-    auto remEndTime = std::chrono::system_clock::now ();
-    std::chrono::duration<double> remElapsedSeconds = remEndTime - m_remStartTime;
-    NS_LOG_INFO ("REM map created. Total time needed to create the REM map:" <<
+void
+NrRadioEnvironmentMapHelper::CalcUeCoverageRemMap ()
+{
+  NS_LOG_FUNCTION (this);
+
+  CalcRemMap (&NrRadioEnvironmentMapHelper::CalcUeCoverageRemPoint);
+
+  auto remEndTime = std::chrono::system_clock::now ();
+  std::chrono::duration<double> remElapsedSeconds = remEndTime - m_remStartTime;
+  NS_LOG_INFO ("REM map created. Total time needed to create the REM map:" <<
                  remElapsedSeconds.count () / 60 << " minutes.");
 }
 
+void
+NrRadioEnvironmentMapHelper::CalcUeCoverageRemPoint (RemPoint *remPoint)
+{
+  //perform calculation m_numOfIterationsToAverage times and get the average value
+  double sumSnr = 0.0, sumSinr = 0.0;
+  m_rrd.mob->SetPosition (remPoint->pos);
+
+  for (uint16_t i = 0; i < m_numOfIterationsToAverage; i++)
+    {
+      RenewPropagationModels ();
+      std::list<double> sinrsPerBeam; // vector in which we will save sinr per each RRD beam
+      std::list<double> snrsPerBeam; // vector in which we will save snr per each RRD beam
+
+      //"Associate" UE (RemPoint) with this RTD
+      for (std::list<RemDevice>::iterator itRtdAssociated = m_remDev.begin ();
+           itRtdAssociated != m_remDev.end ();
+           ++itRtdAssociated)
+        {
+          //configure RRD (RemPoint) beam toward RTD (itRtdAssociated)
+          ConfigureDirectPathBfv (m_rrd, *itRtdAssociated, m_rrd.antenna);
+          //configure RTD (itRtdAssociated) beam toward RRD (RemPoint)
+          ConfigureDirectPathBfv (*itRtdAssociated, m_rrd, itRtdAssociated->antenna);
+
+          std::list<Ptr<SpectrumValue>> interferenceSignalsRxPsds;
+          Ptr<SpectrumValue> usefulSignalRxPsd;
+
+          for(std::list<RemDevice>::iterator itRtdInterferer = m_remDev.begin ();
+              itRtdInterferer != m_remDev.end ();
+              ++itRtdInterferer)
+            {
+              if (itRtdAssociated->dev->GetNode ()->GetId () != itRtdInterferer->dev->GetNode ()->GetId ())
+              {
+                //configure RTD (itRtdInterferer) beam toward RTD (itRtdAssociated)
+                ConfigureDirectPathBfv (*itRtdInterferer, *itRtdAssociated, itRtdInterferer->antenna);
+
+                // calculate received power (interference) from the current RTD device
+                Ptr<SpectrumValue> receivedPower = CalcRxPsdValue (*itRtdInterferer, *itRtdAssociated);
+
+                interferenceSignalsRxPsds.push_back (receivedPower);  //interference
+              }
+              else
+              {
+                // calculate received power (useful Signal) from the current RRD device
+                Ptr<SpectrumValue> receivedPower = CalcRxPsdValue (m_rrd, *itRtdAssociated);
+                if (usefulSignalRxPsd != nullptr)
+                  {
+                    NS_FATAL_ERROR ("Already assigned usefulSignal!");
+                  }
+                usefulSignalRxPsd = receivedPower;
+              }
+
+            }//end for std::list<RemDev>::iterator itRtdInterferer (RTD)
+
+          sinrsPerBeam.push_back (CalculateSinr (usefulSignalRxPsd, interferenceSignalsRxPsds));
+          snrsPerBeam.push_back (CalculateSnr (usefulSignalRxPsd));
+
+        }//end for std::list<RemDev>::iterator itRtdAssociated (RTD)
+
+      sumSnr += GetMaxValue (snrsPerBeam);
+      sumSinr += GetMaxValue (sinrsPerBeam);
+
+    }//end for m_numOfIterationsToAverage  (Average)
+
+  remPoint->avgSnrDb = sumSnr / static_cast <double> (m_numOfIterationsToAverage);
+  remPoint->avgSinrDb = sumSinr / static_cast <double> (m_numOfIterationsToAverage);
+}
+
 NrRadioEnvironmentMapHelper::PropagationModels
 NrRadioEnvironmentMapHelper::CreateTemporalPropagationModels () const
 {
@@ -1224,12 +2241,11 @@ NrRadioEnvironmentMapHelper::CreateTemporalPropagationModels () const
   Ptr<ChannelConditionModel> condModelCopy = m_channelConditionModelFactory.Create<ChannelConditionModel> ();
 
   //create rem copy of propagation model
-  ObjectFactory propLossModelFactory = ConfigureObjectFactory (m_propagationLossModel);
-  propModels.remPropagationLossModelCopy = propLossModelFactory.Create <ThreeGppPropagationLossModel> ();
+  propModels.remPropagationLossModelCopy = m_propagationLossModelFactory.Create <ThreeGppPropagationLossModel> ();
   propModels.remPropagationLossModelCopy->SetChannelConditionModel (condModelCopy);
 
   //create rem copy of spectrum loss model
-  ObjectFactory spectrumLossModelFactory = ConfigureObjectFactory (m_phasedArraySpectrumLossModel);
+  ObjectFactory spectrumLossModelFactory = m_spectrumLossModelFactory;
   if (spectrumLossModelFactory.IsTypeIdSet())
     {
       Ptr<MatrixBasedChannelModel> channelModelCopy = m_matrixBasedChannelModelFactory.Create<MatrixBasedChannelModel>();
@@ -1237,9 +2253,54 @@ NrRadioEnvironmentMapHelper::CreateTemporalPropagationModels () const
       spectrumLossModelFactory.Set ("ChannelModel", PointerValue (channelModelCopy));
       propModels.remSpectrumLossModelCopy = spectrumLossModelFactory.Create <ThreeGppSpectrumPropagationLossModel> ();
     }
+
+  if (m_pointStreamBase >= 0 && m_pointStreamStride > 0)
+    {
+      m_nextPointStream += AssignTemporalStreams (propModels, m_nextPointStream);
+      NS_ABORT_MSG_IF (m_nextPointStream > m_pointStreamEnd,
+                       "A REM point used more streams than the ones reserved for it");
+    }
   return propModels;
 }
 
+int64_t
+NrRadioEnvironmentMapHelper::AssignTemporalStreams (const PropagationModels &models, int64_t stream) const
+{
+  int64_t currentStream = stream;
+  currentStream += models.remPropagationLossModelCopy->AssignStreams (currentStream);
+  currentStream += models.remPropagationLossModelCopy->GetChannelConditionModel ()->AssignStreams (currentStream);
+  if (models.remSpectrumLossModelCopy != nullptr)
+    {
+      Ptr<ThreeGppChannelModel> channel = DynamicCast<ThreeGppChannelModel> (models.remSpectrumLossModelCopy->GetChannelModel ());
+      if (channel != nullptr)
+        {
+          currentStream += channel->AssignStreams (currentStream);
+        }
+    }
+  return currentStream - stream;
+}
+
+void
+NrRadioEnvironmentMapHelper::StartPointStreams (const RemPoint *remPoint)
+{
+  if (m_pointStreamBase < 0)
+    {
+      return;
+    }
+  int64_t index = remPoint - m_rem.data ();
+  m_nextPointStream = m_pointStreamBase + index * m_pointStreamStride;
+  m_pointStreamEnd = m_nextPointStream + m_pointStreamStride;
+}
+
+void
+NrRadioEnvironmentMapHelper::RenewPropagationModels ()
+{
+  if (m_propModelsLifetime == PER_REALIZATION)
+    {
+      m_sharedPropModels = CreateTemporalPropagationModels ();
+    }
+}
+
 void
 NrRadioEnvironmentMapHelper::PrintGnuplottableGnbListToFile (const std::string &filename)
 {
@@ -1334,7 +2395,7 @@ NrRadioEnvironmentMapHelper::PrintRemToFile ()
         return;
       }
 
-  for (std::list<RemPoint>::iterator it = m_rem.begin ();
+  for (std::vector<RemPoint>::iterator it = m_rem.begin ();
        it != m_rem.end ();
        ++it)
     {
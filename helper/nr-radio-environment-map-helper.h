@@ -31,6 +31,7 @@
 #include <fstream>
 #include <ns3/mobility-helper.h>
 #include <chrono>
+#include <vector>
 
 namespace ns3 {
 
@@ -41,6 +42,8 @@ class MobilityModel;
 class MobilityHelper;
 class ChannelConditionModel;
 class UniformPlanarArray;
+class NrRemComputeBackend;
+class NrLosFieldChannelConditionModel;
 
 /**
  * \brief Generate a radio environment map
@@ -111,6 +114,24 @@ public:
          UE_COVERAGE
   };
 
+  /**
+   * \brief Lifetime of the temporal propagation models used to calculate
+   * the received power
+   */
+  enum PropagationModelsLifetime {
+         PER_CALL,       //!< New models for each received power calculation (strictly independent)
+         PER_REALIZATION //!< New models for each REM point and averaging iteration, shared by all its links
+  };
+
+  /**
+   * \brief Model of the received power of the BEAM_SHAPE maps
+   */
+  enum BeamShapeModel {
+         FULL_CHANNEL,        //!< 3GPP channel realization of each RTD and REM point
+         ANALYTIC_FREE_SPACE, //!< LOS array factors and free space path loss
+         ANALYTIC_PATH_LOSS   //!< LOS array factors and the path loss of the channel
+  };
+
   /**
    * \brief NrRadioEnvironmentMapHelper constructor
    */
@@ -199,6 +220,85 @@ public:
    */
   void SetInstallationDelay (const Time &installationDelay);
 
+  /**
+   * \brief Sets the number of workers that evaluate the REM points
+   *
+   * With more than one worker, the REM points are split in contiguous
+   * chunks, and each chunk is evaluated by a forked worker process. The
+   * results are exactly the same as with a single worker. On platforms
+   * without fork () the points are always evaluated serially.
+   *
+   * \param numWorkers The number of workers (1 to evaluate the points serially)
+   */
+  void SetNumWorkers (uint32_t numWorkers);
+
+  /**
+   * \brief Sets the lifetime of the temporal propagation models
+   *
+   * With PER_CALL, every received power calculation uses its own channel
+   * condition, propagation loss, channel and spectrum propagation models,
+   * so every link, and every beam pair of the same link, gets an
+   * independent channel realization. With PER_REALIZATION, one set of
+   * models is created for each REM point and averaging iteration, and all
+   * the calculations of that iteration share it (and therefore the
+   * channel realization of each link). The models are never shared between
+   * REM points or iterations, because the channel of a link, once
+   * generated, is not updated when the RRD moves.
+   *
+   * \param lifetime The lifetime of the models
+   */
+  void SetPropagationModelsLifetime (enum PropagationModelsLifetime lifetime);
+
+  /**
+   * \brief Get the lifetime of the temporal propagation models
+   * \return The lifetime of the models
+   */
+  enum PropagationModelsLifetime GetPropagationModelsLifetime () const;
+
+  /**
+   * \brief Sets the model of the received power of the BEAM_SHAPE maps
+   *
+   * With FULL_CHANNEL, the power of every RTD at every REM point comes from a
+   * 3GPP channel realization, as for the other maps. With the analytic
+   * models, it is the transmitted power times the gains of the arrays of
+   * the RTD and of the RRD, with their configured beams, along the direct
+   * path between them, times the path gain: the free space one with
+   * ANALYTIC_FREE_SPACE, the one of the propagation loss model of the channel
+   * (e.g. the rasters of NrHelper::EnablePathlossMaps) with
+   * ANALYTIC_PATH_LOSS. The analytic maps are evaluated block by block of
+   * REM points, in one go: IterForAverage, TileSize, RefinementStep and
+   * NumWorkers do not apply to them. The gain of each RTD over the grid (its
+   * layer) does not depend on the other RTDs nor on the TX power, so that,
+   * with LayerCacheDir, a map after a change of some RTDs only calculates
+   * their layers again.
+   *
+   * \param model The model
+   */
+  void SetBeamShapeModel (enum BeamShapeModel model);
+
+  /**
+   * \brief Get the model of the received power of the BEAM_SHAPE maps
+   * \return The model
+   */
+  enum BeamShapeModel GetBeamShapeModel () const;
+
+  /**
+   * \brief Calculates the power gain of the array factor of an antenna,
+   * with its configured beamforming vector, in several directions
+   *
+   * The gain in the direction u is |sum_k w_k exp (j 2 pi u . r_k)|^2, where
+   * w_k is the weight and r_k the location (in wavelengths) of element k,
+   * without the element pattern: it is N in the direction of a direct-path
+   * beam of N elements.
+   *
+   * \param antenna The antenna
+   * \param directions The unit vectors of the directions
+   * \param gains The gain (linear) in each direction
+   */
+  static void CalcArrayGains (const Ptr<const UniformPlanarArray>& antenna,
+                              const std::vector<Vector>& directions,
+                              std::vector<double> *gains);
+
   /**
    * \brief Get the type of REM Map to be generated
    * \return The type of the map (BeamShape/CoverageArea/UeCoverage)
@@ -381,6 +481,81 @@ private:
    */
   void CalcBeamShapeRemMap ();
 
+  /**
+   * \brief This function generates a BeamShape map with the analytic models:
+   * for each block of REM points and each RTD, the array gains of both ends
+   * along the direct path and the path gain are calculated for all the points
+   * of the block at once.
+   */
+  void CalcAnalyticBeamShapeRemMap ();
+
+  /**
+   * \brief Calculates the path gain of the analytic BeamShape map
+   * \param rtd the RTD
+   * \param distance the 3D distance between the RTD and the RRD
+   * \return the path gain (linear)
+   */
+  double CalcAnalyticPathGain (const RemDevice& rtd, double distance) const;
+
+  /**
+   * \brief Get the gain layer of an RTD, from the cache in LayerCacheDir if
+   * it has the one of the same configuration, and calculated (and saved in
+   * the cache) otherwise
+   * \param rtd the RTD
+   * \param layer the gain (linear) at each grid position, column by column
+   * \return true if the layer has been read from the cache
+   */
+  bool GetAnalyticGainLayer (const RemDevice& rtd, std::vector<double> *layer);
+
+  /**
+   * \brief Calculates the gain layer of an RTD: its gain towards the RRD at
+   * each grid position, as the analytic BeamShape map defines it
+   * \param rtd the RTD
+   * \param layer the gain (linear) at each grid position, column by column
+   */
+  void CalcAnalyticGainLayer (const RemDevice& rtd, std::vector<double> *layer);
+
+  /**
+   * \brief Get the configuration on which the gain layer of an RTD depends
+   * \param rtd the RTD
+   * \return the configuration, as a string
+   */
+  std::string GetAnalyticLayerKey (const RemDevice& rtd) const;
+
+  /**
+   * \brief Append to a key the attributes of an antenna and its beamforming vector
+   * \param os the stream of the key
+   * \param antenna the antenna
+   */
+  void AppendAntennaKey (std::ostream &os, const Ptr<const UniformPlanarArray>& antenna) const;
+
+  /**
+   * \brief Append to a key the type and the attributes of an object, with
+   * the objects that it points to
+   * \param os the stream of the key
+   * \param object the object
+   */
+  void AppendAttributesKey (std::ostream &os, const Ptr<const Object>& object) const;
+
+  /**
+   * \brief Read a gain layer from the cache
+   * \param fileName the file of the layer
+   * \param key the configuration of the layer
+   * \param layer the layer
+   * \return true if the file has a complete layer of this configuration and grid
+   */
+  bool ReadAnalyticGainLayer (const std::string &fileName, const std::string &key,
+                              std::vector<double> *layer) const;
+
+  /**
+   * \brief Write a gain layer in the cache
+   * \param fileName the file of the layer
+   * \param key the configuration of the layer
+   * \param layer the layer
+   */
+  void WriteAnalyticGainLayer (const std::string &fileName, const std::string &key,
+                               const std::vector<double> &layer) const;
+
   /**
    * \brief This function generates a CoverageArea map. In this case, all the
    * antennas of the rtds are set to point towards the rem point and the antenna
@@ -397,12 +572,148 @@ private:
    */
   void CalcUeCoverageRemMap ();
 
+  /**
+   * \brief Pointer to the function that calculates the values of a REM point
+   */
+  typedef void (NrRadioEnvironmentMapHelper::*CalcRemPointFn) (RemPoint *remPoint);
+
+  /**
+   * \brief Calculates the BeamShape values of a REM point
+   * \param remPoint the REM point
+   */
+  void CalcBeamShapeRemPoint (RemPoint *remPoint);
+
+  /**
+   * \brief Calculates the CoverageArea values of a REM point
+   * \param remPoint the REM point
+   */
+  void CalcCoverageAreaRemPoint (RemPoint *remPoint);
+
+  /**
+   * \brief Calculates the UeCoverage values of a REM point
+   * \param remPoint the REM point
+   */
+  void CalcUeCoverageRemPoint (RemPoint *remPoint);
+
+  /**
+   * \brief Calculates the whole REM, in tiles if m_tileSize is not 0
+   *
+   * With tiles, the values of each tile are appended to the checkpoint file
+   * (see GetTileCheckpointFileName) as soon as the tile is done, and, if
+   * m_resumeTiles is true, the tiles already in that file are not
+   * calculated again.
+   *
+   * \param calcRemPoint the function that calculates a REM point
+   */
+  void CalcRemMap (CalcRemPointFn calcRemPoint);
+
+  /**
+   * \brief Calculates the REM points of a rectangle of the grid
+   *
+   * If m_refinementStep is greater than 1, only one grid line out of
+   * m_refinementStep (plus the last one) is calculated first, in both
+   * directions. The cells of this coarse grid whose corners differ by more
+   * than m_refinementThreshold dB in SNR or SINR are then calculated in
+   * full, and the points of the other cells are interpolated from their
+   * corners.
+   *
+   * \param calcRemPoint the function that calculates a REM point
+   * \param xBegin first grid column of the rectangle
+   * \param xEnd grid column after the last one of the rectangle
+   * \param yBegin first grid row of the rectangle
+   * \param yEnd grid row after the last one of the rectangle
+   */
+  void CalcRemRegion (CalcRemPointFn calcRemPoint, uint32_t xBegin, uint32_t xEnd,
+                      uint32_t yBegin, uint32_t yEnd);
+
+  /**
+   * \brief Calculates some REM points with the compute backend
+   * \param calcRemPoint the function that calculates a REM point
+   * \param points the REM points
+   */
+  void CalcRemPoints (CalcRemPointFn calcRemPoint, const std::vector<RemPoint*> &points);
+
+  /**
+   * \brief Get the REM point at a position of the grid
+   * \param x the grid column
+   * \param y the grid row
+   * \return the point, or nullptr if there is no point there (an RTD is
+   * at that position)
+   */
+  RemPoint * GetGridPoint (uint32_t x, uint32_t y);
+
+  /**
+   * \brief Get the name of the file in which the tiles are saved
+   * \return the file name
+   */
+  std::string GetTileCheckpointFileName () const;
+
+  /**
+   * \brief Read the tiles completed by a previous run from the checkpoint
+   * file, and copy their values in m_rem
+   *
+   * A tile whose block is truncated (the previous run was interrupted while
+   * writing it) is not considered completed.
+   *
+   * \param numTiles the number of tiles of the REM
+   * \return for each tile, true if it has been read
+   */
+  std::vector<bool> ReadTileCheckpoint (uint32_t numTiles);
+
+  /**
+   * \brief Write the values of a tile in the checkpoint file
+   * \param outFile the checkpoint file
+   * \param tile the index of the tile
+   * \param xBegin first grid column of the tile
+   * \param xEnd grid column after the last one of the tile
+   * \param yBegin first grid row of the tile
+   * \param yEnd grid row after the last one of the tile
+   */
+  void WriteTileCheckpoint (std::ofstream &outFile, uint32_t tile, uint32_t xBegin,
+                            uint32_t xEnd, uint32_t yBegin, uint32_t yEnd);
+
+  /**
+   * \brief Account for REM points done (calculated, interpolated or read
+   * from the checkpoint), printing the progress report when due
+   * \param numPoints the number of points done
+   */
+  void CountRemPointsDone (size_t numPoints);
+
   /**
    * \brief This method calculates the PSD
    * \return The PSD (spectrumValue)
    */
   Ptr<SpectrumValue> CalcRxPsdValue (RemDevice& device, RemDevice& otherDevice) const;
 
+  /**
+   * \brief Calculates the TX PSD of a device over all its RBs, converted to
+   * the spectrum model of the receiving device
+   *
+   * It does not depend on the positions, the beams or the channel, so it
+   * can be reused by all the received power calculations of a link.
+   *
+   * \param device the transmitting device
+   * \param otherDevice the receiving device
+   * \return The TX PSD, in the spectrum model of otherDevice
+   */
+  Ptr<const SpectrumValue> CalcConvertedTxPsd (const RemDevice& device, const RemDevice& otherDevice) const;
+
+  /**
+   * \brief Calculates the PSD received through the current beams, from the
+   * TX PSD and the path gain of the link
+   * \param models the propagation models to use for the fading and the
+   * beamforming gain
+   * \param device the transmitting device
+   * \param otherDevice the receiving device
+   * \param convertedTxPsd the TX PSD, from CalcConvertedTxPsd
+   * \param pathGainLinear the path gain of the link (linear)
+   * \return The PSD (spectrumValue)
+   */
+  Ptr<SpectrumValue> CalcBeamformedRxPsd (const PropagationModels &models,
+                                          RemDevice& device, RemDevice& otherDevice,
+                                          const Ptr<const SpectrumValue> &convertedTxPsd,
+                                          double pathGainLinear) const;
+
   /**
    * \brief This function calculates the SNR.
    * \param usefulSignal The useful Signal
@@ -501,6 +812,28 @@ private:
    */
   PropagationModels CreateTemporalPropagationModels () const;
 
+  /**
+   * \brief Creates the models shared by the calculations of a REM point
+   * and averaging iteration, if the lifetime is PER_REALIZATION
+   */
+  void RenewPropagationModels ();
+
+  /**
+   * \brief Assign the streams of the random variables of a set of temporal
+   * propagation models
+   * \param models the models
+   * \param stream the first stream
+   * \return the number of streams assigned
+   */
+  int64_t AssignTemporalStreams (const PropagationModels &models, int64_t stream) const;
+
+  /**
+   * \brief Position the streams of the temporal propagation models at the
+   * block of a REM point, if m_pointStreamBase is not negative
+   * \param remPoint the REM point that is going to be calculated
+   */
+  void StartPointStreams (const RemPoint *remPoint);
+
   /**
    * \brief Prints REM generation progress report
    */
@@ -553,7 +886,19 @@ private:
                                const Ptr<const UniformPlanarArray>& antenna);
 
   std::list<RemDevice> m_remDev; ///< List of REM Transmiting Devices (RTDs).
-  std::list<RemPoint> m_rem; ///< List of REM points.
+  std::vector<RemPoint> m_rem; ///< REM points, column by column of the grid.
+  std::vector<int64_t> m_remGrid; ///< Index in m_rem of each grid position (column by column), -1 if none
+  uint32_t m_xNumPoints {0};      ///< Number of grid columns
+  uint32_t m_yNumPoints {0};      ///< Number of grid rows
+  std::vector<double> m_gridX;    ///< X coordinate of each grid column
+  std::vector<double> m_gridY;    ///< Y coordinate of each grid row
+  size_t m_remPointsDone {0};     ///< REM points done so far
+  uint32_t m_remSizeNextReport {0}; ///< REM points done at the next progress report
+
+  uint32_t m_tileSize {0};             ///< The `TileSize` attribute.
+  bool m_resumeTiles {false};          ///< The `ResumeTiles` attribute.
+  uint32_t m_refinementStep {0};       ///< The `RefinementStep` attribute.
+  double m_refinementThreshold {3.0};  ///< The `RefinementThreshold` attribute.
 
   std::chrono::system_clock::time_point m_remStartTime; //!< Time at which REM generation has started
 
@@ -572,6 +917,16 @@ private:
 
   uint16_t m_numOfIterationsToAverage {1};
   Time m_installationDelay {Seconds(0)};
+  uint32_t m_numWorkers {1};  ///< The `NumWorkers` attribute.
+  Ptr<NrRemComputeBackend> m_computeBackend;  ///< The `ComputeBackend` attribute.
+  int64_t m_pointStreamBase {-1};             ///< The `PointStreamBase` attribute.
+  int64_t m_pointStreamStride {0};            ///< Streams reserved for each REM point
+  mutable int64_t m_nextPointStream {0};      ///< Next stream of the block of the current REM point
+  int64_t m_pointStreamEnd {0};               ///< End of the block of the current REM point
+  enum PropagationModelsLifetime m_propModelsLifetime {PER_CALL};  ///< The `PropagationModelsLifetime` attribute.
+  enum BeamShapeModel m_beamShapeModel {FULL_CHANNEL};  ///< The `BeamShapeModel` attribute.
+  std::string m_layerCacheDir;  ///< The `LayerCacheDir` attribute.
+  PropagationModels m_sharedPropModels;  ///< Models of the current REM point and iteration, with PER_REALIZATION
 
   RemDevice m_rrd;
 
@@ -582,7 +937,11 @@ private:
   Ptr<PropagationLossModel> m_propagationLossModel;
   Ptr<PhasedArraySpectrumPropagationLossModel> m_phasedArraySpectrumLossModel;
   ObjectFactory m_channelConditionModelFactory;
+  Ptr<NrLosFieldChannelConditionModel> m_losFieldModel; ///< The channel condition model, if it is a NrLosFieldChannelConditionModel
+  bool m_buildingInfoNeeded {true};  ///< False if the channel condition model does not use the MobilityBuildingInfo of the RRD
   ObjectFactory m_matrixBasedChannelModelFactory;
+  ObjectFactory m_propagationLossModelFactory;   ///< Factory of the temporal propagation loss model
+  ObjectFactory m_spectrumLossModelFactory;      ///< Factory of the temporal spectrum propagation loss model
 
   Ptr<SpectrumValue> m_noisePsd; // noise figure PSD that will be used for calculations
 
@@ -0,0 +1,359 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-rem-compute-backend.h"
+#include <ns3/abort.h>
+#include <ns3/log.h>
+#include <ns3/uinteger.h>
+#include <ns3/rng-seed-manager.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#if defined (__unix__) || defined (__APPLE__)
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define NR_REM_HAVE_FORK 1
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrRemComputeBackend");
+
+NS_OBJECT_ENSURE_REGISTERED (NrRemComputeBackend);
+
+TypeId
+NrRemComputeBackend::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::NrRemComputeBackend")
+    .SetParent<Object> ()
+    .SetGroupName ("nr")
+  ;
+  return tid;
+}
+
+// -----------------------------------------------------------------
+
+NS_OBJECT_ENSURE_REGISTERED (NrRemSerialBackend);
+
+TypeId
+NrRemSerialBackend::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::NrRemSerialBackend")
+    .SetParent<NrRemComputeBackend> ()
+    .SetGroupName ("nr")
+    .AddConstructor<NrRemSerialBackend> ()
+  ;
+  return tid;
+}
+
+bool
+NrRemSerialBackend::CalcPoints (size_t numPoints, const CalcPointFn &calcPoint,
+                                const StorePointFn &storePoint)
+{
+  NS_LOG_FUNCTION (this << numPoints);
+  for (size_t i = 0; i < numPoints; ++i)
+    {
+      PointValues values;
+      calcPoint (i, values);
+      storePoint (i, values);
+    }
+  return true;
+}
+
+// -----------------------------------------------------------------
+
+NS_OBJECT_ENSURE_REGISTERED (NrRemWorkersBackend);
+
+TypeId
+NrRemWorkersBackend::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::NrRemWorkersBackend")
+    .SetParent<NrRemComputeBackend> ()
+    .SetGroupName ("nr")
+    .AddConstructor<NrRemWorkersBackend> ()
+    .AddAttribute ("NumWorkers",
+                   "Number of worker processes that evaluate the REM points.",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&NrRemWorkersBackend::m_numWorkers),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+#ifdef NR_REM_HAVE_FORK
+
+/**
+ * \brief Write a buffer to a file descriptor, retrying on partial writes
+ * \param fd the file descriptor
+ * \param buf the buffer
+ * \param size the size of the buffer
+ * \return true if the whole buffer was written
+ */
+static bool
+WriteAll (int fd, const void *buf, size_t size)
+{
+  const char *p = static_cast<const char*> (buf);
+  while (size > 0)
+    {
+      ssize_t n = write (fd, p, size);
+      if (n < 0 && errno == EINTR)
+        {
+          continue;
+        }
+      if (n <= 0)
+        {
+          return false;
+        }
+      p += n;
+      size -= static_cast<size_t> (n);
+    }
+  return true;
+}
+
+/**
+ * \brief Read a buffer from a file descriptor, retrying on partial reads
+ * \param fd the file descriptor
+ * \param buf the buffer
+ * \param size the size of the buffer
+ * \return true if the whole buffer was read
+ */
+static bool
+ReadAll (int fd, void *buf, size_t size)
+{
+  char *p = static_cast<char*> (buf);
+  while (size > 0)
+    {
+      ssize_t n = read (fd, p, size);
+      if (n < 0 && errno == EINTR)
+        {
+          continue;
+        }
+      if (n <= 0)
+        {
+          return false;
+        }
+      p += n;
+      size -= static_cast<size_t> (n);
+    }
+  return true;
+}
+
+/**
+ * \brief Advance the global RNG stream counter
+ * \param streams the number of streams to skip
+ */
+static void
+SkipStreams (uint64_t streams)
+{
+  for (uint64_t i = 0; i < streams; ++i)
+    {
+      RngSeedManager::GetNextStreamIndex ();
+    }
+}
+
+bool
+NrRemWorkersBackend::CalcPoints (size_t numPoints, const CalcPointFn &calcPoint,
+                                 const StorePointFn &storePoint)
+{
+  NS_LOG_FUNCTION (this << m_numWorkers << numPoints);
+
+  if (m_numWorkers < 2 || numPoints < 2)
+    {
+      return false;
+    }
+
+  // Every point creates its temporal propagation models, whose random
+  // variables take their streams from the global counter. The number of
+  // streams used by a point is measured on the first one, in a probe
+  // process, so that each worker can start from the same stream as the
+  // serial evaluation.
+  std::cout << std::flush;
+  std::cerr << std::flush;
+  fflush (nullptr);
+
+  int probePipe[2];
+  if (pipe (probePipe) != 0)
+    {
+      NS_LOG_WARN ("Could not create a pipe, evaluating the REM points serially");
+      return false;
+    }
+  pid_t probe = fork ();
+  if (probe < 0)
+    {
+      close (probePipe[0]);
+      close (probePipe[1]);
+      NS_LOG_WARN ("Could not fork, evaluating the REM points serially");
+      return false;
+    }
+  if (probe == 0)
+    {
+      close (probePipe[0]);
+      uint64_t before = RngSeedManager::GetNextStreamIndex ();
+      PointValues values;
+      calcPoint (0, values);
+      uint64_t streamsPerPoint = RngSeedManager::GetNextStreamIndex () - before - 1;
+      _exit (WriteAll (probePipe[1], &streamsPerPoint, sizeof (streamsPerPoint)) ? 0 : 1);
+    }
+  close (probePipe[1]);
+  uint64_t streamsPerPoint = 0;
+  bool probeOk = ReadAll (probePipe[0], &streamsPerPoint, sizeof (streamsPerPoint));
+  close (probePipe[0]);
+  int status = 0;
+  waitpid (probe, &status, 0);
+  NS_ABORT_MSG_IF (!probeOk || !WIFEXITED (status) || WEXITSTATUS (status) != 0,
+                   "REM probe process failed");
+  NS_LOG_INFO ("Each REM point uses " << streamsPerPoint << " RNG streams");
+
+  const size_t numWorkers = std::min<size_t> (m_numWorkers, numPoints);
+
+  struct Worker
+  {
+    pid_t pid {-1};       //!< Process id
+    int fd {-1};          //!< Read end of the pipe
+    size_t next {0};      //!< Next point to be received
+    size_t end {0};       //!< End of the chunk
+    size_t bytes {0};     //!< Bytes of the next point already received
+    PointValues values;  //!< Values of the next point
+  };
+  std::vector<Worker> workers (numWorkers);
+
+  for (size_t w = 0; w < numWorkers; ++w)
+    {
+      size_t begin = numPoints * w / numWorkers;
+      size_t end = numPoints * (w + 1) / numWorkers;
+
+      int fds[2];
+      NS_ABORT_MSG_IF (pipe (fds) != 0, "Could not create the pipe of REM worker " << w);
+      pid_t pid = fork ();
+      NS_ABORT_MSG_IF (pid < 0, "Could not fork REM worker " << w);
+
+      if (pid == 0)
+        {
+          close (fds[0]);
+          for (size_t v = 0; v < w; ++v)
+            {
+              close (workers[v].fd);
+            }
+          SkipStreams (begin * streamsPerPoint);
+          for (size_t i = begin; i < end; ++i)
+            {
+              PointValues values;
+              calcPoint (i, values);
+              if (!WriteAll (fds[1], values.data (), sizeof (values)))
+                {
+                  _exit (1);
+                }
+            }
+          close (fds[1]);
+          _exit (0);
+        }
+
+      close (fds[1]);
+      workers[w].pid = pid;
+      workers[w].fd = fds[0];
+      workers[w].next = begin;
+      workers[w].end = end;
+    }
+
+  // Receive the values in the order of each chunk, and report the progress
+  // on the total number of points received
+  size_t running = numWorkers;
+  std::vector<pollfd> pollFds;
+
+  while (running > 0)
+    {
+      pollFds.clear ();
+      for (const auto &worker : workers)
+        {
+          if (worker.fd >= 0)
+            {
+              pollFds.push_back ({worker.fd, POLLIN, 0});
+            }
+        }
+      int ret = poll (pollFds.data (), pollFds.size (), -1);
+      if (ret < 0 && errno == EINTR)
+        {
+          continue;
+        }
+      NS_ABORT_MSG_IF (ret < 0, "poll on the REM workers failed");
+
+      for (const auto &pfd : pollFds)
+        {
+          if (pfd.revents == 0)
+            {
+              continue;
+            }
+          auto worker = std::find_if (workers.begin (), workers.end (),
+                                      [&pfd] (const Worker &w) { return w.fd == pfd.fd; });
+          char *buf = reinterpret_cast<char*> (worker->values.data ());
+          ssize_t n = read (worker->fd, buf + worker->bytes, sizeof (worker->values) - worker->bytes);
+          if (n < 0 && errno == EINTR)
+            {
+              continue;
+            }
+          if (n <= 0)
+            {
+              NS_ABORT_MSG_IF (worker->next != worker->end || worker->bytes != 0,
+                               "REM worker " << worker->pid << " terminated before sending all its points");
+              close (worker->fd);
+              worker->fd = -1;
+              --running;
+              continue;
+            }
+          worker->bytes += static_cast<size_t> (n);
+          if (worker->bytes < sizeof (worker->values))
+            {
+              continue;
+            }
+          NS_ABORT_MSG_IF (worker->next == worker->end,
+                           "REM worker " << worker->pid << " sent too many points");
+          storePoint (worker->next++, worker->values);
+          worker->bytes = 0;
+        }
+    }
+
+  for (const auto &worker : workers)
+    {
+      waitpid (worker.pid, &status, 0);
+      NS_ABORT_MSG_IF (!WIFEXITED (status) || WEXITSTATUS (status) != 0,
+                       "REM worker " << worker.pid << " failed");
+    }
+
+  // Leave the stream counter as the serial evaluation would have left it
+  SkipStreams (numPoints * streamsPerPoint);
+  return true;
+}
+
+#else // NR_REM_HAVE_FORK
+
+bool
+NrRemWorkersBackend::CalcPoints (size_t, const CalcPointFn &, const StorePointFn &)
+{
+  NS_LOG_WARN ("Worker processes are not supported on this platform, "
+               "evaluating the REM points serially");
+  return false;
+}
+
+#endif // NR_REM_HAVE_FORK
+
+} // namespace ns3
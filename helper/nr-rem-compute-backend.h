@@ -0,0 +1,134 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef NR_REM_COMPUTE_BACKEND_H
+#define NR_REM_COMPUTE_BACKEND_H
+
+#include <ns3/object.h>
+
+#include <array>
+#include <functional>
+
+namespace ns3 {
+
+/**
+ * \ingroup helper
+ * \brief Interface of the backends that evaluate the points of a REM
+ *
+ * NrRadioEnvironmentMapHelper hands to the backend the number of points to
+ * evaluate, a function that calculates the values of a point, and a
+ * function that stores them in the map. The backend decides where and in
+ * which order the calculations run. However, each calculation creates
+ * propagation models that take their random variable streams from the
+ * global counter, so a backend must give each point the same streams (and
+ * therefore the same values) as NrRemSerialBackend, and leave the counter
+ * where NrRemSerialBackend would. The calculation function runs ns-3
+ * models, which are not thread-safe: it cannot run in several threads of
+ * the same process.
+ *
+ * The backend is set with the NrRadioEnvironmentMapHelper attribute
+ * ComputeBackend. If none is set, the helper uses NrRemWorkersBackend when
+ * NumWorkers is greater than 1, and NrRemSerialBackend otherwise.
+ */
+class NrRemComputeBackend : public Object
+{
+public:
+  /**
+   * \brief Get the type id
+   * \return the type id of the class
+   */
+  static TypeId GetTypeId ();
+
+  /**
+   * \brief Values of a REM point: SNR (dB), SINR (dB), SIR (dB) and
+   * received power (dBm)
+   */
+  typedef std::array<double, 4> PointValues;
+
+  /**
+   * \brief Calculates the values of the point with the given index
+   */
+  typedef std::function<void (size_t index, PointValues &values)> CalcPointFn;
+
+  /**
+   * \brief Stores the values of the point with the given index; it must be
+   * called in the process of the helper
+   */
+  typedef std::function<void (size_t index, const PointValues &values)> StorePointFn;
+
+  /**
+   * \brief Evaluate some REM points
+   * \param numPoints the number of points, with indexes from 0
+   * \param calcPoint the function that calculates a point
+   * \param storePoint the function that stores the values of a point
+   * \return false if the backend could not evaluate the points; then no
+   * point has been evaluated, and the helper evaluates them serially
+   */
+  virtual bool CalcPoints (size_t numPoints, const CalcPointFn &calcPoint,
+                           const StorePointFn &storePoint) = 0;
+};
+
+/**
+ * \ingroup helper
+ * \brief Reference backend: evaluates the REM points one after the other,
+ * in the process of the helper
+ */
+class NrRemSerialBackend : public NrRemComputeBackend
+{
+public:
+  /**
+   * \brief Get the type id
+   * \return the type id of the class
+   */
+  static TypeId GetTypeId ();
+
+  virtual bool CalcPoints (size_t numPoints, const CalcPointFn &calcPoint,
+                           const StorePointFn &storePoint) override;
+};
+
+/**
+ * \ingroup helper
+ * \brief Backend that evaluates the REM points in forked worker processes
+ *
+ * Each worker calculates a contiguous chunk of points, and sends the
+ * values back through a pipe. Before that, the RNG stream counter is
+ * positioned where the serial evaluation would have it at the first point
+ * of the chunk, so that each point gets the same random variable streams,
+ * and the same values, as in the serial evaluation. On platforms without
+ * fork () the points are evaluated serially.
+ */
+class NrRemWorkersBackend : public NrRemComputeBackend
+{
+public:
+  /**
+   * \brief Get the type id
+   * \return the type id of the class
+   */
+  static TypeId GetTypeId ();
+
+  virtual bool CalcPoints (size_t numPoints, const CalcPointFn &calcPoint,
+                           const StorePointFn &storePoint) override;
+
+private:
+  uint32_t m_numWorkers {2}; //!< Number of worker processes
+};
+
+} // namespace ns3
+
+#endif // NR_REM_COMPUTE_BACKEND_H
@@ -0,0 +1,255 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-site-index.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/mobility-model.h>
+#include <ns3/net-device-container.h>
+#include <ns3/node.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrSiteIndex");
+
+NrSiteIndex::NrSiteIndex (const std::vector<Vector> &positions, double cellSize)
+  : m_positions (positions)
+{
+  Build (cellSize);
+}
+
+NrSiteIndex::NrSiteIndex (const NetDeviceContainer &devices, double cellSize)
+{
+  m_positions.reserve (devices.GetN ());
+  for (auto it = devices.Begin (); it != devices.End (); ++it)
+    {
+      Ptr<MobilityModel> mobility = (*it)->GetNode ()->GetObject<MobilityModel> ();
+      NS_ABORT_MSG_IF (mobility == nullptr, "The node of a site has no MobilityModel");
+      m_positions.push_back (mobility->GetPosition ());
+    }
+  Build (cellSize);
+}
+
+void
+NrSiteIndex::Build (double cellSize)
+{
+  NS_LOG_FUNCTION (this << m_positions.size () << cellSize);
+  NS_ABORT_MSG_IF (cellSize < 0.0, "Negative cell size");
+
+  if (m_positions.empty ())
+    {
+      return;
+    }
+
+  double maxX = std::numeric_limits<double>::lowest ();
+  double maxY = std::numeric_limits<double>::lowest ();
+  m_originX = std::numeric_limits<double>::max ();
+  m_originY = std::numeric_limits<double>::max ();
+  for (const auto &pos : m_positions)
+    {
+      m_originX = std::min (m_originX, pos.x);
+      m_originY = std::min (m_originY, pos.y);
+      maxX = std::max (maxX, pos.x);
+      maxY = std::max (maxY, pos.y);
+    }
+  double width = maxX - m_originX;
+  double height = maxY - m_originY;
+
+  if (cellSize == 0.0)
+    {
+      // Around one site per cell; the sites on a line have a cell each
+      double area = std::max (width, 1.0) * std::max (height, 1.0);
+      cellSize = std::sqrt (area / m_positions.size ());
+      if (width == 0.0 || height == 0.0)
+        {
+          cellSize = std::max (width, height) / m_positions.size ();
+        }
+      cellSize = std::max (cellSize, 1.0);
+    }
+  m_cellSize = cellSize;
+
+  // Not too many empty cells, e.g., for a small cell size or a far away site
+  const double maxCells = 4.0 * m_positions.size () + 4.0;
+  while ((std::floor (width / m_cellSize) + 1.0) * (std::floor (height / m_cellSize) + 1.0) > maxCells)
+    {
+      m_cellSize *= 2.0;
+    }
+  m_numCellsX = static_cast<uint32_t> (std::floor (width / m_cellSize) + 1.0);
+  m_numCellsY = static_cast<uint32_t> (std::floor (height / m_cellSize) + 1.0);
+
+  // Counting sort of the sites by cell, that keeps the order of the index
+  std::vector<uint32_t> siteCell (m_positions.size ());
+  m_cellStart.assign (m_numCellsX * m_numCellsY + 1, 0);
+  for (uint32_t site = 0; site < m_positions.size (); ++site)
+    {
+      siteCell[site] = GetCell (m_positions[site].y, m_originY, m_numCellsY) * m_numCellsX
+        + GetCell (m_positions[site].x, m_originX, m_numCellsX);
+      ++m_cellStart[siteCell[site] + 1];
+    }
+  for (uint32_t cell = 0; cell + 1 < m_cellStart.size (); ++cell)
+    {
+      m_cellStart[cell + 1] += m_cellStart[cell];
+    }
+  m_cellSites.resize (m_positions.size ());
+  std::vector<uint32_t> next (m_cellStart.begin (), m_cellStart.end () - 1);
+  for (uint32_t site = 0; site < m_positions.size (); ++site)
+    {
+      m_cellSites[next[siteCell[site]]++] = site;
+    }
+}
+
+uint32_t
+NrSiteIndex::GetN () const
+{
+  return static_cast<uint32_t> (m_positions.size ());
+}
+
+const Vector &
+NrSiteIndex::GetPosition (uint32_t site) const
+{
+  return m_positions.at (site);
+}
+
+uint32_t
+NrSiteIndex::GetCell (double x, double origin, uint32_t numCells) const
+{
+  double cell = std::floor ((x - origin) / m_cellSize);
+  if (cell <= 0.0)
+    {
+      return 0;
+    }
+  return static_cast<uint32_t> (std::min (cell, numCells - 1.0));
+}
+
+void
+NrSiteIndex::AddCell (const Vector &pos, uint32_t cell, uint32_t k, std::vector<Candidate> *best) const
+{
+  for (uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i)
+    {
+      Candidate candidate {CalculateDistance (pos, m_positions[m_cellSites[i]]), m_cellSites[i]};
+      if (best->size () < k)
+        {
+          best->push_back (candidate);
+          std::push_heap (best->begin (), best->end ());
+        }
+      else if (candidate < best->front ())
+        {
+          std::pop_heap (best->begin (), best->end ());
+          best->back () = candidate;
+          std::push_heap (best->begin (), best->end ());
+        }
+    }
+}
+
+uint32_t
+NrSiteIndex::FindNearest (const Vector &pos) const
+{
+  NS_ABORT_MSG_IF (m_positions.empty (), "No sites in the index");
+  return FindNearest (pos, 1).front ();
+}
+
+std::vector<uint32_t>
+NrSiteIndex::FindNearest (const Vector &pos, uint32_t k) const
+{
+  std::vector<uint32_t> sites;
+  k = std::min (k, GetN ());
+  if (k == 0)
+    {
+      return sites;
+    }
+
+  // Rings of cells around the cell of the point: the sites of the ring r
+  // are at least (r - 1) cells away
+  int64_t cx = GetCell (pos.x, m_originX, m_numCellsX);
+  int64_t cy = GetCell (pos.y, m_originY, m_numCellsY);
+  int64_t maxRing = std::max (m_numCellsX, m_numCellsY);
+  std::vector<Candidate> best;
+  best.reserve (k);
+  for (int64_t r = 0; r <= maxRing; ++r)
+    {
+      if (best.size () == k && (r - 1) * m_cellSize > best.front ().m_distance)
+        {
+          break;
+        }
+      for (int64_t y = std::max<int64_t> (cy - r, 0); y <= std::min<int64_t> (cy + r, m_numCellsY - 1); ++y)
+        {
+          bool edgeRow = (y == cy - r || y == cy + r);
+          int64_t step = edgeRow ? 1 : 2 * r;
+          for (int64_t x = cx - r; x <= cx + r; x += std::max<int64_t> (step, 1))
+            {
+              if (x >= 0 && x < m_numCellsX)
+                {
+                  AddCell (pos, static_cast<uint32_t> (y * m_numCellsX + x), k, &best);
+                }
+            }
+        }
+    }
+
+  std::sort (best.begin (), best.end ());
+  sites.reserve (best.size ());
+  for (const auto &candidate : best)
+    {
+      sites.push_back (candidate.m_site);
+    }
+  return sites;
+}
+
+std::vector<uint32_t>
+NrSiteIndex::FindWithinRadius (const Vector &pos, double radius) const
+{
+  std::vector<uint32_t> sites;
+  if (m_positions.empty () || radius < 0.0)
+    {
+      return sites;
+    }
+
+  std::vector<Candidate> found;
+  uint32_t minX = GetCell (pos.x - radius, m_originX, m_numCellsX);
+  uint32_t maxX = GetCell (pos.x + radius, m_originX, m_numCellsX);
+  uint32_t minY = GetCell (pos.y - radius, m_originY, m_numCellsY);
+  uint32_t maxY = GetCell (pos.y + radius, m_originY, m_numCellsY);
+  for (uint32_t y = minY; y <= maxY; ++y)
+    {
+      for (uint32_t x = minX; x <= maxX; ++x)
+        {
+          uint32_t cell = y * m_numCellsX + x;
+          for (uint32_t i = m_cellStart[cell]; i < m_cellStart[cell + 1]; ++i)
+            {
+              double distance = CalculateDistance (pos, m_positions[m_cellSites[i]]);
+              if (distance <= radius)
+                {
+                  found.push_back ({distance, m_cellSites[i]});
+                }
+            }
+        }
+    }
+
+  std::sort (found.begin (), found.end ());
+  sites.reserve (found.size ());
+  for (const auto &candidate : found)
+    {
+      sites.push_back (candidate.m_site);
+    }
+  return sites;
+}
+
+} // namespace ns3
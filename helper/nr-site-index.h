@@ -0,0 +1,164 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef NR_SITE_INDEX_H
+#define NR_SITE_INDEX_H
+
+#include <ns3/vector.h>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+class NetDeviceContainer;
+
+/**
+ * \ingroup helper
+ * \brief A uniform grid over the positions of a set of sites, to find the sites close to a point
+ *
+ * The sites are put in square cells on the (x, y) plane; the distances are
+ * the 3D distances of CalculateDistance. The sites at the same distance
+ * are returned in the order of their index, so FindNearest gives the same
+ * site as a loop over all the sites that keeps the first closest one.
+ *
+ * The index does not follow the sites: it has to be built again if they move.
+ *
+ * \code
+ *   NrSiteIndex index (gnbDevices);
+ *   for (uint32_t i = 0; i < ueDevices.GetN (); ++i)
+ *     {
+ *       Vector pos = ueDevices.Get (i)->GetNode ()->GetObject<MobilityModel> ()->GetPosition ();
+ *       for (uint32_t site : index.FindNearest (pos, 3))
+ *         {
+ *           // evaluate the RSRP of gnbDevices.Get (site)
+ *         }
+ *     }
+ * \endcode
+ */
+class NrSiteIndex
+{
+public:
+  /**
+   * \brief Build an index without sites
+   */
+  NrSiteIndex () = default;
+
+  /**
+   * \brief Build the index of a set of positions
+   * \param positions the position of each site
+   * \param cellSize the side of the cells in meters, or 0 to have around one site per cell
+   */
+  NrSiteIndex (const std::vector<Vector> &positions, double cellSize = 0.0);
+
+  /**
+   * \brief Build the index of the current positions of the nodes of a set of devices
+   * \param devices the devices, whose nodes must have a MobilityModel
+   * \param cellSize the side of the cells in meters, or 0 to have around one site per cell
+   */
+  NrSiteIndex (const NetDeviceContainer &devices, double cellSize = 0.0);
+
+  /**
+   * \return the number of sites
+   */
+  uint32_t GetN () const;
+
+  /**
+   * \param site the index of the site
+   * \return the position of the site
+   */
+  const Vector & GetPosition (uint32_t site) const;
+
+  /**
+   * \brief Find the closest site to a point
+   * \param pos the point
+   * \return the index of the closest site; the index must not be empty
+   */
+  uint32_t FindNearest (const Vector &pos) const;
+
+  /**
+   * \brief Find the k closest sites to a point
+   * \param pos the point
+   * \param k the number of sites
+   * \return the indexes of the min (k, GetN ()) closest sites, from the closest
+   */
+  std::vector<uint32_t> FindNearest (const Vector &pos, uint32_t k) const;
+
+  /**
+   * \brief Find the sites within a distance of a point
+   * \param pos the point
+   * \param radius the distance in meters
+   * \return the indexes of the sites at a distance <= radius, from the closest
+   */
+  std::vector<uint32_t> FindWithinRadius (const Vector &pos, double radius) const;
+
+private:
+  /**
+   * \brief A site found by a query
+   */
+  struct Candidate
+  {
+    double m_distance; //!< Distance from the point
+    uint32_t m_site;   //!< Index of the site
+
+    /**
+     * \param o the other candidate
+     * \return true if this candidate comes before the other
+     */
+    bool operator< (const Candidate &o) const
+    {
+      return m_distance < o.m_distance || (m_distance == o.m_distance && m_site < o.m_site);
+    }
+  };
+
+  /**
+   * \brief Put the sites in the cells
+   * \param cellSize the side of the cells in meters, or 0 to choose it
+   */
+  void Build (double cellSize);
+
+  /**
+   * \param x the coordinate
+   * \param origin the coordinate of the first cell
+   * \param numCells the number of cells on the axis
+   * \return the cell of the coordinate, clamped to the grid
+   */
+  uint32_t GetCell (double x, double origin, uint32_t numCells) const;
+
+  /**
+   * \brief Add the sites of a cell to the k best candidates
+   * \param pos the point
+   * \param cell the cell
+   * \param k the number of candidates to keep
+   * \param best the heap of the k best candidates
+   */
+  void AddCell (const Vector &pos, uint32_t cell, uint32_t k, std::vector<Candidate> *best) const;
+
+  std::vector<Vector> m_positions;     //!< Position of each site
+  double m_cellSize {1.0};             //!< Side of the cells
+  double m_originX {0.0};              //!< x of the corner of the first cell
+  double m_originY {0.0};              //!< y of the corner of the first cell
+  uint32_t m_numCellsX {0};            //!< Number of cells on x
+  uint32_t m_numCellsY {0};            //!< Number of cells on y
+  std::vector<uint32_t> m_cellStart;   //!< First entry of each cell in m_cellSites, and the end
+  std::vector<uint32_t> m_cellSites;   //!< The sites of each cell, in order of index
+};
+
+} // namespace ns3
+
+#endif // NR_SITE_INDEX_H
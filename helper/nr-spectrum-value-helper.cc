@@ -18,12 +18,14 @@
  */
 
 #include "nr-spectrum-value-helper.h"
-#include <map>
+#include <unordered_map>
+#include <algorithm>
 #include <cmath>
 #include <ns3/log.h>
 #include <ns3/fatal-error.h>
 #include <ns3/string.h>
 #include <ns3/abort.h>
+#include <ns3/nr-counters.h>
 
 namespace ns3 {
 
@@ -38,129 +40,203 @@ struct NrSpectrumModelId
    * \param f center frequency
    * \param b bandwidth in RBs
    * \param s subcarrierSpacing
+   * \param r RBs per band
    */
-  NrSpectrumModelId (double f, uint16_t b, double s);
+  NrSpectrumModelId (double f, uint16_t b, double s, uint32_t r);
   double frequency; ///<
   uint16_t bandwidth; ///< bandwidth
   double subcarrierSpacing;
+  uint32_t rbsPerBand; ///< RBs per band
 };
 
-NrSpectrumModelId::NrSpectrumModelId (double f, uint16_t b, double s)
+NrSpectrumModelId::NrSpectrumModelId (double f, uint16_t b, double s, uint32_t r)
   : frequency (f),
   bandwidth (b),
-  subcarrierSpacing (s)
+  subcarrierSpacing (s),
+  rbsPerBand (r)
 {
 }
 
 /**
- * \brief Operator < so that it can be the key in a g_nrSpectrumModelMap
+ * \brief Operator == so that it can be the key in a g_nrSpectrumModelMap
  * \param a lhs
  * \param b rhs
- * \returns true if earfcn less than or if earfcn equal and bandwidth less than or if earfcn and bandwidth equal and sucarrier spacing less than
+ * \returns true if frequency, bandwidth, subcarrier spacing and RBs per band are equal
  */
 bool
-operator < (const NrSpectrumModelId& a, const NrSpectrumModelId& b)
+operator == (const NrSpectrumModelId& a, const NrSpectrumModelId& b)
 {
-  return ( (a.frequency < b.frequency) ||
-           ( (a.frequency == b.frequency) && (a.bandwidth < b.bandwidth) ) ||
-           ( (a.frequency == b.frequency) && (a.bandwidth == b.bandwidth ) && (a.subcarrierSpacing < b.subcarrierSpacing))
-         );
+  return a.frequency == b.frequency && a.bandwidth == b.bandwidth
+         && a.subcarrierSpacing == b.subcarrierSpacing && a.rbsPerBand == b.rbsPerBand;
 }
 
-static std::map<NrSpectrumModelId, Ptr<SpectrumModel> > g_nrSpectrumModelMap; ///< nr spectrum model map
+/**
+ * \brief Hash of NrSpectrumModelId, so that it can be the key in a g_nrSpectrumModelMap
+ */
+struct NrSpectrumModelIdHash
+{
+  /**
+   * \brief Hash the model id
+   * \param id the model id
+   * \return the combination of the hashes of the fields
+   */
+  size_t operator() (const NrSpectrumModelId &id) const
+  {
+    size_t h = std::hash<double> () (id.frequency);
+    h ^= std::hash<uint16_t> () (id.bandwidth) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= std::hash<double> () (id.subcarrierSpacing) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= std::hash<uint32_t> () (id.rbsPerBand) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return h;
+  }
+};
+
+static std::unordered_map<NrSpectrumModelId, Ptr<SpectrumModel>, NrSpectrumModelIdHash> g_nrSpectrumModelMap; ///< nr spectrum model map
+static std::unordered_map<SpectrumModelUid_t, double> g_nrRbWidthMap; ///< RB width of each model of g_nrSpectrumModelMap
+
+/**
+ * \brief Get the width of one RB of a spectrum model
+ *
+ * The models created by GetSpectrumModel know their subcarrier spacing. For
+ * the others, the first band is assumed to hold rbsPerBand RBs, which is
+ * wrong when the model has less RBs than rbsPerBand.
+ *
+ * \param model the spectrum model
+ * \param rbsPerBand the number of RBs of each band
+ * \return the width of one RB, in Hz
+ */
+static double
+GetRbWidth (const Ptr<const SpectrumModel>& model, uint32_t rbsPerBand)
+{
+  auto it = g_nrRbWidthMap.find (model->GetUid ());
+  if (it != g_nrRbWidthMap.end ())
+    {
+      return it->second;
+    }
+  return (model->Begin ()->fh - model->Begin ()->fl) / rbsPerBand;
+}
 
 Ptr<const SpectrumModel>
-NrSpectrumValueHelper::GetSpectrumModel (uint32_t numRbs, double centerFrequency, double subcarrierSpacing)
+NrSpectrumValueHelper::GetSpectrumModel (uint32_t numRbs, double centerFrequency, double subcarrierSpacing,
+                                         uint32_t rbsPerBand)
 {
-  NS_LOG_FUNCTION (centerFrequency << numRbs << subcarrierSpacing);
+  NS_LOG_FUNCTION (centerFrequency << numRbs << subcarrierSpacing << rbsPerBand);
 
   NS_ABORT_MSG_IF (numRbs == 0, "Total bandwidth cannot be 0 RBs");
+  NS_ABORT_MSG_IF (rbsPerBand == 0, "A band must have at least one RB");
   NS_ABORT_MSG_IF (centerFrequency < 0.5e9 || centerFrequency > 100e9, "Central frequency should be in range from 0.5GHz to 100GHz");
   NS_ABORT_MSG_IF (subcarrierSpacing!=15000 && subcarrierSpacing!=30000 && subcarrierSpacing!=60000 &&
                    subcarrierSpacing!=120000 && subcarrierSpacing!=240000 && subcarrierSpacing!=480000,
                    "Supported subcarrier spacing values are: 15000, 30000, 60000, 120000, 240000 and 480000 Hz.");
 
 
-  NrSpectrumModelId modelId = NrSpectrumModelId (centerFrequency, numRbs, subcarrierSpacing);
+  NrSpectrumModelId modelId = NrSpectrumModelId (centerFrequency, numRbs, subcarrierSpacing, rbsPerBand);
 
-  if (g_nrSpectrumModelMap.find (modelId) != g_nrSpectrumModelMap.end ())
+  auto it = g_nrSpectrumModelMap.find (modelId);
+  if (it != g_nrSpectrumModelMap.end ())
     {
-      return g_nrSpectrumModelMap.find (modelId)->second;
+      return it->second;
     }
 
   NS_ASSERT_MSG (centerFrequency != 0, "The carrier frequency cannot be set to 0");
   double f = centerFrequency - (numRbs * subcarrierSpacing * SUBCARRIERS_PER_RB / 2.0);
-  Bands rbs; // A vector representing all resource blocks
-  for (uint32_t numrb = 0; numrb < numRbs; ++numrb)
+  Bands rbs; // A vector representing all resource blocks (or bands of RBs)
+  for (uint32_t numrb = 0; numrb < numRbs; numrb += rbsPerBand)
     {
+      double width = std::min (rbsPerBand, numRbs - numrb) * subcarrierSpacing * SUBCARRIERS_PER_RB;
       BandInfo rb;
       rb.fl = f;
-      f += subcarrierSpacing * SUBCARRIERS_PER_RB / 2;
+      f += width / 2;
       rb.fc = f;
-      f += subcarrierSpacing * SUBCARRIERS_PER_RB / 2;
+      f += width / 2;
       rb.fh = f;
       rbs.push_back (rb);
     }
 
   Ptr<SpectrumModel> model = Create<SpectrumModel> (rbs);
   // save this model to the map of spectrum models
-  g_nrSpectrumModelMap.insert (std::pair<NrSpectrumModelId, Ptr<SpectrumModel> > (modelId, model));
+  g_nrSpectrumModelMap.emplace (modelId, model);
+  g_nrRbWidthMap.emplace (model->GetUid (), subcarrierSpacing * SUBCARRIERS_PER_RB);
   NS_LOG_INFO ("Created SpectrumModel with frequency: "<<f<<" NumRB: "<< rbs.size()<<" subcarrier spacing: "<<subcarrierSpacing << ", and global UID: "<<model->GetUid());
   return model;
 }
 
 Ptr<SpectrumValue>
-NrSpectrumValueHelper::CreateTxPsdOverActiveRbs (double powerTx, const std::vector <int>& activeRbs, const Ptr<const SpectrumModel>& spectrumModel)
+NrSpectrumValueHelper::CreateTxPsdOverActiveRbs (double powerTx, const std::vector <int>& activeRbs, const Ptr<const SpectrumModel>& spectrumModel,
+                                                 uint32_t rbsPerBand)
 {
-  NS_LOG_FUNCTION (powerTx << activeRbs << spectrumModel);
+  NS_LOG_FUNCTION (powerTx << activeRbs << spectrumModel << rbsPerBand);
   Ptr<SpectrumValue> txPsd = Create <SpectrumValue> (spectrumModel);
+  NrCounters::Add (NrCounters::SPECTRUM_VALUES);
   double powerTxW = std::pow (10., (powerTx - 30) / 10);
   double txPowerDensity = 0;
-  double subbandWidth = (spectrumModel->Begin()->fh - spectrumModel->Begin()->fl);
+  double subbandWidth = GetRbWidth (spectrumModel, rbsPerBand);
   NS_ABORT_MSG_IF(subbandWidth < 180000, "Erroneous spectrum model. RB width should be equal or greater than 180KHz");
   txPowerDensity = powerTxW / (subbandWidth * activeRbs.size());
-  for (std::vector <int>::const_iterator it = activeRbs.begin (); it != activeRbs.end (); it++)
-    {
-      int rbId = (*it);
-      (*txPsd)[rbId] = txPowerDensity;
-    }
+  SpreadOverBands (*txPsd, txPowerDensity, activeRbs, rbsPerBand);
   NS_LOG_LOGIC (*txPsd);
   return txPsd;
 }
 
 
 Ptr<SpectrumValue>
-NrSpectrumValueHelper::CreateTxPsdOverAllRbs (double powerTx, const std::vector <int>& activeRbs, const Ptr<const SpectrumModel>& spectrumModel)
+NrSpectrumValueHelper::CreateTxPsdOverAllRbs (double powerTx, const std::vector <int>& activeRbs, const Ptr<const SpectrumModel>& spectrumModel,
+                                              uint32_t rbsPerBand)
 {
-  NS_LOG_FUNCTION (powerTx << activeRbs << spectrumModel);
+  NS_LOG_FUNCTION (powerTx << activeRbs << spectrumModel << rbsPerBand);
   Ptr<SpectrumValue> txPsd = Create <SpectrumValue> (spectrumModel);
+  NrCounters::Add (NrCounters::SPECTRUM_VALUES);
   double powerTxW = std::pow (10., (powerTx - 30) / 10);
   double txPowerDensity = 0;
-  double subbandWidth = (spectrumModel->Begin()->fh - spectrumModel->Begin()->fl);
+  double subbandWidth = GetRbWidth (spectrumModel, rbsPerBand);
   NS_ABORT_MSG_IF(subbandWidth < 180000, "Erroneous spectrum model. RB width should be equal or greater than 180KHz");
-  txPowerDensity = powerTxW / (subbandWidth * spectrumModel->GetNumBands());
-  for (std::vector <int>::const_iterator it = activeRbs.begin (); it != activeRbs.end (); it++)
-    {
-      int rbId = (*it);
-      (*txPsd)[rbId] = txPowerDensity;
-    }
+  // The total bandwidth, as the last band may have less RBs than the others
+  double bandwidth = (spectrumModel->End () - 1)->fh - spectrumModel->Begin ()->fl;
+  txPowerDensity = powerTxW / (subbandWidth * std::round (bandwidth / subbandWidth));
+  SpreadOverBands (*txPsd, txPowerDensity, activeRbs, rbsPerBand);
   NS_LOG_LOGIC (*txPsd);
   return txPsd;
 }
 
+void
+NrSpectrumValueHelper::SpreadOverBands (SpectrumValue &txPsd, double rbDensity,
+                                        const std::vector <int>& activeRbs, uint32_t rbsPerBand)
+{
+  if (rbsPerBand == 1)
+    {
+      for (std::vector <int>::const_iterator it = activeRbs.begin (); it != activeRbs.end (); it++)
+        {
+          int rbId = (*it);
+          txPsd[rbId] = rbDensity;
+        }
+      return;
+    }
+
+  // Each active RB adds its power to its band, over the width of the band
+  Ptr<const SpectrumModel> model = txPsd.GetSpectrumModel ();
+  double rbWidth = GetRbWidth (model, rbsPerBand);
+  for (int rbId : activeRbs)
+    {
+      size_t band = static_cast<size_t> (rbId) / rbsPerBand;
+      NS_ASSERT (band < txPsd.GetValuesN ());
+      const BandInfo &info = *(model->Begin () + band);
+      txPsd[band] += rbDensity * rbWidth / (info.fh - info.fl);
+    }
+}
+
 Ptr<SpectrumValue>
 NrSpectrumValueHelper::CreateTxPowerSpectralDensity (double powerTx, const std::vector<int> &rbIndexVector,
-                                                     const Ptr<const SpectrumModel>& txSm, enum PowerAllocationType allocationType)
+                                                     const Ptr<const SpectrumModel>& txSm, enum PowerAllocationType allocationType,
+                                                     uint32_t rbsPerBand)
 {
   switch (allocationType)
   {
     case UNIFORM_POWER_ALLOCATION_BW:
       {
-        return CreateTxPsdOverAllRbs (powerTx, rbIndexVector, txSm);
+        return CreateTxPsdOverAllRbs (powerTx, rbIndexVector, txSm, rbsPerBand);
       }
     case UNIFORM_POWER_ALLOCATION_USED:
       {
-        return CreateTxPsdOverActiveRbs (powerTx, rbIndexVector, txSm);
+        return CreateTxPsdOverActiveRbs (powerTx, rbIndexVector, txSm, rbsPerBand);
       }
     default:
       {
@@ -180,6 +256,7 @@ NrSpectrumValueHelper::CreateNoisePowerSpectralDensity (double noiseFigureDb, co
   double noisePowerSpectralDensity =  kT_W_Hz * noiseFigureLinear;
 
   Ptr<SpectrumValue> noisePsd = Create <SpectrumValue> (spectrumModel);
+  NrCounters::Add (NrCounters::SPECTRUM_VALUES);
   (*noisePsd) = noisePowerSpectralDensity;
   return noisePsd;
 }
@@ -48,11 +48,18 @@ public:
   /**
    * \brief Creates or obtains from a global map a spectrum model with a given number of RBs,
    * center frequency and subcarrier spacing.
+   *
+   * With more than one RB per band, each band groups consecutive RBs (the
+   * last band may have less of them): the PSDs, the channel and the
+   * interference are then computed per band instead of per RB.
+   *
    * \param numRbs bandwidth in number of RBs
    * \param centerFrequency the center frequency of this band
+   * \param rbsPerBand the number of RBs of each band of the model
    * \return pointer to a spectrum model with defined characteristics
    */
-  static Ptr<const SpectrumModel> GetSpectrumModel (uint32_t numRbs, double centerFrequency, double subcarrierSpacing);
+  static Ptr<const SpectrumModel> GetSpectrumModel (uint32_t numRbs, double centerFrequency, double subcarrierSpacing,
+                                                    uint32_t rbsPerBand = 1);
 
   /**
     * \brief Create SpectrumValue that will represent transmit power spectral density,
@@ -61,11 +68,14 @@ public:
     * \param rbIndexVector the list of active/used RBs for the current transmission
     * \param txSm spectrumModel to be used to create this SpectrumValue
     * \param allocationType power allocation type to be used
+    * \param rbsPerBand the number of RBs of each band of txSm: the power of
+    * the active RBs is spread over the band that contains them
     * \return spectrum value representing power spectral density for given parameters
     */
   static Ptr<SpectrumValue> CreateTxPowerSpectralDensity (double powerTx, const std::vector<int> &rbIndexVector,
                                                                 const Ptr<const SpectrumModel>& txSm,
-                                                                enum PowerAllocationType allocationType);
+                                                                enum PowerAllocationType allocationType,
+                                                                uint32_t rbsPerBand = 1);
 
   /**
    * \brief Create a SpectrumValue that models the power spectral density of AWGN
@@ -91,10 +101,12 @@ protected:
    * \param powerTx total power in dBm
    * \param activeRbs vector of RBs that are active for this transmission
    * \param spectrumModel spectrumModel to be used to create this SpectrumValue
+   * \param rbsPerBand the number of RBs of each band of spectrumModel
    */
   static Ptr<SpectrumValue> CreateTxPsdOverActiveRbs (double powerTx,
                                                       const std::vector <int>& activeRbs,
-                                                      const Ptr<const SpectrumModel>& spectrumModel);
+                                                      const Ptr<const SpectrumModel>& spectrumModel,
+                                                      uint32_t rbsPerBand);
 
 
   /**
@@ -103,10 +115,22 @@ protected:
    * \param powerTx total power in dBm
    * \param activeRbs vector of RBs that are active for this transmission
    * \param spectrumModel spectrumModel to be used to create this SpectrumValue
+   * \param rbsPerBand the number of RBs of each band of spectrumModel
    */
   static Ptr<SpectrumValue> CreateTxPsdOverAllRbs (double powerTx,
                                                    const std::vector <int>& activeRbs,
-                                                   const Ptr<const SpectrumModel>& spectrumModel);
+                                                   const Ptr<const SpectrumModel>& spectrumModel,
+                                                   uint32_t rbsPerBand);
+
+  /**
+   * \brief Spread a power density per RB over the bands of a spectrum model
+   * \param txPsd the PSD to fill, initially 0
+   * \param rbDensity the power density of each active RB, in W/Hz
+   * \param activeRbs the active RBs
+   * \param rbsPerBand the number of RBs of each band of txPsd
+   */
+  static void SpreadOverBands (SpectrumValue &txPsd, double rbDensity,
+                               const std::vector <int>& activeRbs, uint32_t rbsPerBand);
 };
 
 
@@ -0,0 +1,298 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#include "nr-sqlite-stats-sink.h"
+#include <ns3/rng-seed-manager.h>
+#include <ns3/abort.h>
+#include <ns3/log.h>
+#include <algorithm>
+
+namespace ns3 {
+
+// Logging is only used from the simulation thread: the log prefix reads the
+// simulator time, which must not be done from the writer thread.
+NS_LOG_COMPONENT_DEFINE ("NrSqliteStatsSink");
+
+// Default value of SQLITE_MAX_VARIABLE_NUMBER before SQLite 3.32.0
+static const uint32_t MAX_PARAMETERS_PER_STATEMENT = 999;
+
+NrSqliteStatsSink::NrSqliteStatsSink (SQLiteOutput *db, bool useWriterThread)
+  : m_db (db),
+    m_useWriterThread (useWriterThread)
+{
+  NS_LOG_FUNCTION (this << useWriterThread);
+  NS_ABORT_MSG_IF (m_db == nullptr, "The database is not valid");
+
+  if (m_useWriterThread)
+    {
+      m_writer = std::thread (&NrSqliteStatsSink::WriterLoop, this);
+    }
+}
+
+NrSqliteStatsSink::~NrSqliteStatsSink ()
+{
+  Flush ();
+
+  if (m_useWriterThread)
+    {
+      {
+        std::lock_guard<std::mutex> lock (m_mutex);
+        m_stop = true;
+      }
+      m_cv.notify_all ();
+      m_writer.join ();
+    }
+}
+
+void
+NrSqliteStatsSink::SetRowsPerInsert (uint32_t rows)
+{
+  NS_ABORT_MSG_IF (rows == 0, "At least one row per INSERT is needed");
+  std::lock_guard<std::mutex> lock (m_mutex);
+  m_rowsPerInsert = rows;
+}
+
+void
+NrSqliteStatsSink::SetRowsPerCommit (uint32_t rows)
+{
+  NS_ABORT_MSG_IF (rows == 0, "At least one row per transaction is needed");
+  std::lock_guard<std::mutex> lock (m_mutex);
+  m_rowsPerCommit = rows;
+}
+
+void
+NrSqliteStatsSink::SetMaxQueuedRows (uint32_t rows)
+{
+  NS_ABORT_MSG_IF (rows == 0, "The queue must hold at least one row");
+  std::lock_guard<std::mutex> lock (m_mutex);
+  m_maxQueuedRows = rows;
+}
+
+uint32_t
+NrSqliteStatsSink::RegisterTable (const std::string &tableName,
+                                  const std::vector<std::string> &columns)
+{
+  NS_LOG_FUNCTION (this << tableName);
+  NS_ABORT_MSG_IF (columns.empty (), "Table " << tableName << " has no columns");
+
+  // The writer thread must be idle while the database is used from here
+  Flush ();
+
+  std::string definition;
+  for (const auto &c : columns)
+    {
+      definition += c + ", ";
+    }
+
+  bool ret = m_db->SpinExec ("CREATE TABLE IF NOT EXISTS " + tableName + " (" +
+                             definition +
+                             "Seed INTEGER NOT NULL,"
+                             "Run INTEGER NOT NULL);");
+  NS_ABORT_IF (ret == false);
+
+  Table t;
+  t.m_name = tableName;
+  t.m_numColumns = static_cast<uint32_t> (columns.size ());
+  t.m_seed = RngSeedManager::GetSeed ();
+  t.m_run = static_cast<uint32_t> (RngSeedManager::GetRun ());
+
+  sqlite3_stmt *stmt;
+  ret = m_db->SpinPrepare (&stmt, "DELETE FROM \"" + tableName + "\" WHERE SEED = ? AND RUN = ?;");
+  NS_ABORT_IF (ret == false);
+  ret = m_db->Bind (stmt, 1, t.m_seed);
+  NS_ABORT_IF (ret == false);
+  ret = m_db->Bind (stmt, 2, t.m_run);
+  NS_ABORT_IF (ret == false);
+  ret = m_db->SpinExec (stmt);
+  NS_ABORT_IF (ret == false);
+
+  m_tables.push_back (t);
+  return static_cast<uint32_t> (m_tables.size () - 1);
+}
+
+void
+NrSqliteStatsSink::Insert (uint32_t table, std::initializer_list<Value> values)
+{
+  NS_ASSERT_MSG (table < m_tables.size (), "Table " << table << " is not registered");
+  NS_ASSERT_MSG (values.size () == m_tables.at (table).m_numColumns,
+                 "Table " << m_tables.at (table).m_name << " has " <<
+                 m_tables.at (table).m_numColumns << " columns, got " << values.size ());
+
+  if (!m_useWriterThread)
+    {
+      m_queue.m_tables.push_back (table);
+      m_queue.m_values.insert (m_queue.m_values.end (), values.begin (), values.end ());
+      if (m_queue.m_tables.size () >= m_rowsPerCommit)
+        {
+          WriteBatch (m_queue);
+          m_queue.m_tables.clear ();
+          m_queue.m_values.clear ();
+        }
+      return;
+    }
+
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_cv.wait (lock, [this] { return m_queue.m_tables.size () < m_maxQueuedRows; });
+  m_queue.m_tables.push_back (table);
+  m_queue.m_values.insert (m_queue.m_values.end (), values.begin (), values.end ());
+  size_t queued = m_queue.m_tables.size ();
+  if (queued >= m_rowsPerCommit || queued >= m_maxQueuedRows)
+    {
+      lock.unlock ();
+      m_cv.notify_all ();
+    }
+}
+
+void
+NrSqliteStatsSink::Flush ()
+{
+  NS_LOG_FUNCTION (this);
+
+  if (!m_useWriterThread)
+    {
+      if (!m_queue.m_tables.empty ())
+        {
+          WriteBatch (m_queue);
+          m_queue.m_tables.clear ();
+          m_queue.m_values.clear ();
+        }
+      return;
+    }
+
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_flushRequested = true;
+  m_cv.notify_all ();
+  m_cv.wait (lock, [this] { return m_queue.m_tables.empty () && !m_writing; });
+}
+
+void
+NrSqliteStatsSink::WriterLoop ()
+{
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (true)
+    {
+      m_cv.wait (lock, [this]
+        {
+          size_t queued = m_queue.m_tables.size ();
+          return m_stop || m_flushRequested ||
+                 queued >= m_rowsPerCommit || queued >= m_maxQueuedRows;
+        });
+
+      if (m_queue.m_tables.empty ())
+        {
+          // Nothing left: the flush (if any) is complete
+          m_flushRequested = false;
+          m_cv.notify_all ();
+          if (m_stop)
+            {
+              break;
+            }
+          continue;
+        }
+
+      Batch batch;
+      std::swap (batch, m_queue);
+      m_writing = true;
+      lock.unlock ();
+      // Wake up the simulation thread, if it is blocked on a full queue
+      m_cv.notify_all ();
+
+      WriteBatch (batch);
+
+      lock.lock ();
+      m_writing = false;
+      m_cv.notify_all ();
+    }
+}
+
+void
+NrSqliteStatsSink::WriteBatch (const Batch &batch)
+{
+  // Offsets of the values of each row, grouped by table so that the rows of
+  // the same table can go in the same INSERT. The order of the rows of each
+  // table is preserved.
+  std::vector<std::vector<size_t> > rowOffsets (m_tables.size ());
+  size_t offset = 0;
+  for (uint32_t table : batch.m_tables)
+    {
+      rowOffsets.at (table).push_back (offset);
+      offset += m_tables.at (table).m_numColumns;
+    }
+
+  bool ret = m_db->SpinExec ("BEGIN TRANSACTION;");
+  NS_ABORT_IF (ret == false);
+
+  for (size_t t = 0; t < m_tables.size (); ++t)
+    {
+      const Table &table = m_tables.at (t);
+      const std::vector<size_t> &offsets = rowOffsets.at (t);
+      size_t rowsPerInsert = std::max<size_t> (1, std::min<size_t> (m_rowsPerInsert,
+                                                                    MAX_PARAMETERS_PER_STATEMENT / (table.m_numColumns + 2)));
+      for (size_t first = 0; first < offsets.size (); first += rowsPerInsert)
+        {
+          WriteRows (table, batch, offsets, first,
+                     std::min (rowsPerInsert, offsets.size () - first));
+        }
+    }
+
+  ret = m_db->SpinExec ("END TRANSACTION;");
+  NS_ABORT_IF (ret == false);
+}
+
+void
+NrSqliteStatsSink::WriteRows (const Table &table, const Batch &batch,
+                              const std::vector<size_t> &rowOffsets, size_t first, size_t count)
+{
+  std::string placeholders = "(";
+  for (uint32_t i = 0; i < table.m_numColumns + 2; ++i)
+    {
+      placeholders += i == 0 ? "?" : ",?";
+    }
+  placeholders += ")";
+
+  std::string sql = "INSERT INTO " + table.m_name + " VALUES ";
+  sql.reserve (sql.size () + count * (placeholders.size () + 1));
+  for (size_t r = 0; r < count; ++r)
+    {
+      sql += r == 0 ? placeholders : "," + placeholders;
+    }
+  sql += ";";
+
+  sqlite3_stmt *stmt;
+  bool ret = m_db->SpinPrepare (&stmt, sql);
+  NS_ABORT_IF (ret == false);
+
+  int pos = 1;
+  for (size_t r = first; r < first + count; ++r)
+    {
+      const Value *v = &batch.m_values.at (rowOffsets.at (r));
+      for (uint32_t c = 0; c < table.m_numColumns; ++c, ++v)
+        {
+          int rc = v->m_isInteger ? sqlite3_bind_int64 (stmt, pos++, v->m_integer)
+                                  : sqlite3_bind_double (stmt, pos++, v->m_double);
+          NS_ABORT_IF (rc != SQLITE_OK);
+        }
+      NS_ABORT_IF (sqlite3_bind_int64 (stmt, pos++, table.m_seed) != SQLITE_OK);
+      NS_ABORT_IF (sqlite3_bind_int64 (stmt, pos++, table.m_run) != SQLITE_OK);
+    }
+
+  ret = m_db->SpinExec (stmt);
+  NS_ABORT_IF (ret == false);
+}
+
+} // namespace ns3
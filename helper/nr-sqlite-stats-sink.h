@@ -0,0 +1,218 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_SQLITE_STATS_SINK_H
+#define NR_SQLITE_STATS_SINK_H
+
+#include <ns3/sqlite-output.h>
+#include <condition_variable>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup helper
+ * \brief Batched writer of statistics rows to a SQLite database
+ *
+ * The statistic classes register their tables with RegisterTable, and then
+ * push one row per sample with Insert. The rows are queued, and written to
+ * the database in transactions of RowsPerCommit rows, each one made of
+ * multi-row INSERT statements of RowsPerInsert rows.
+ *
+ * By default the transactions are executed by a writer thread, so the
+ * simulation does not wait for SQLite; the queue is bounded by MaxQueuedRows,
+ * and Insert blocks when it is full. Without the writer thread, the
+ * transaction is executed by Insert when RowsPerCommit rows are queued.
+ *
+ * Every table gets two additional columns, Seed and Run, filled with the
+ * values of RngSeedManager at registration time. Registering a table deletes
+ * the rows that it already contains for the same Seed/Run pair.
+ *
+ * All the tables of a database must be written through the same sink. The
+ * caller can access the database directly after a call to Flush.
+ *
+ * Usage:
+ * \code
+ *   SQLiteOutput db ("stats.db");
+ *   NrSqliteStatsSink sink (&db);
+ *   uint32_t table = sink.RegisterTable ("sinr", {"CellId INTEGER NOT NULL",
+ *                                                 "AvgSinr DOUBLE NOT NULL"});
+ *   sink.Insert (table, {cellId, avgSinr});
+ *   ...
+ *   sink.Flush ();
+ * \endcode
+ */
+class NrSqliteStatsSink
+{
+public:
+  /**
+   * \brief A value of a row: an integer or a double
+   */
+  struct Value
+  {
+    /**
+     * \brief Create a double value
+     * \param v the value
+     */
+    Value (double v) : m_isInteger (false), m_double (v)
+    {
+    }
+    /**
+     * \brief Create an integer value
+     * \param v the value
+     */
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    Value (T v) : m_isInteger (true), m_integer (static_cast<int64_t> (v))
+    {
+    }
+
+    bool m_isInteger;      //!< True if m_integer is valid, false if m_double is
+    int64_t m_integer {0}; //!< Integer value
+    double m_double {0.0}; //!< Double value
+  };
+
+  /**
+   * \brief Constructor
+   * \param db the database; it must be valid through all the lifespan of the sink
+   * \param useWriterThread true to write the database from a writer thread
+   */
+  NrSqliteStatsSink (SQLiteOutput *db, bool useWriterThread = true);
+
+  /**
+   * \brief Destructor; writes all the queued rows and stops the writer thread
+   */
+  ~NrSqliteStatsSink ();
+
+  NrSqliteStatsSink (const NrSqliteStatsSink &) = delete;
+  NrSqliteStatsSink & operator= (const NrSqliteStatsSink &) = delete;
+
+  /**
+   * \brief Set the number of rows of each INSERT statement (default 100)
+   *
+   * The value is reduced if needed, so that a statement has at most 999
+   * parameters (the default SQLite limit).
+   *
+   * \param rows the number of rows
+   */
+  void SetRowsPerInsert (uint32_t rows);
+
+  /**
+   * \brief Set the number of rows of each transaction (default 50000)
+   * \param rows the number of rows
+   */
+  void SetRowsPerCommit (uint32_t rows);
+
+  /**
+   * \brief Set the maximum number of queued rows (default 500000)
+   *
+   * It is only used with the writer thread: Insert blocks when the queue
+   * is full, until the writer thread has consumed it.
+   *
+   * \param rows the number of rows
+   */
+  void SetMaxQueuedRows (uint32_t rows);
+
+  /**
+   * \brief Create, if it does not exist, a table, and delete its rows for
+   * the current Seed/Run pair
+   * \param tableName the name of the table
+   * \param columns the column definitions (e.g., "CellId INTEGER NOT NULL"),
+   * without the Seed and Run columns that are added by the sink
+   * \return the identifier of the table, to be used with Insert
+   */
+  uint32_t RegisterTable (const std::string &tableName, const std::vector<std::string> &columns);
+
+  /**
+   * \brief Queue a row
+   * \param table the table identifier, returned by RegisterTable
+   * \param values the values, one per column, as in RegisterTable
+   */
+  void Insert (uint32_t table, std::initializer_list<Value> values);
+
+  /**
+   * \brief Write all the queued rows, and wait until they are committed
+   */
+  void Flush ();
+
+private:
+  /**
+   * \brief A registered table
+   */
+  struct Table
+  {
+    std::string m_name;          //!< Table name
+    uint32_t m_numColumns {0};   //!< Number of columns, without Seed and Run
+    uint32_t m_seed {0};         //!< Value of the Seed column
+    uint32_t m_run {0};          //!< Value of the Run column
+  };
+
+  /**
+   * \brief Rows waiting to be written
+   */
+  struct Batch
+  {
+    std::vector<uint32_t> m_tables; //!< Table of each row
+    std::vector<Value> m_values;    //!< Values of all the rows, row after row
+  };
+
+  /**
+   * \brief Body of the writer thread
+   */
+  void WriterLoop ();
+  /**
+   * \brief Write a batch in a single transaction
+   * \param batch the batch
+   */
+  void WriteBatch (const Batch &batch);
+  /**
+   * \brief Execute a multi-row INSERT
+   * \param table the table
+   * \param batch the batch that contains the rows
+   * \param rowOffsets the offsets of the rows values in the batch
+   * \param first the first row
+   * \param count the number of rows
+   */
+  void WriteRows (const Table &table, const Batch &batch,
+                  const std::vector<size_t> &rowOffsets, size_t first, size_t count);
+
+  SQLiteOutput *m_db {nullptr};     //!< Database
+  bool m_useWriterThread {true};    //!< Use the writer thread
+  uint32_t m_rowsPerInsert {100};   //!< Rows of each INSERT
+  uint32_t m_rowsPerCommit {50000}; //!< Rows of each transaction
+  uint32_t m_maxQueuedRows {500000}; //!< Maximum queued rows
+
+  std::vector<Table> m_tables;      //!< Registered tables
+  Batch m_queue;                    //!< Rows waiting to be written
+
+  std::thread m_writer;             //!< Writer thread
+  std::mutex m_mutex;               //!< Protects m_queue and the flags below
+  std::condition_variable m_cv;     //!< Signals queue and state changes
+  bool m_flushRequested {false};    //!< Write the queue even if not full
+  bool m_writing {false};           //!< The writer thread is writing a batch
+  bool m_stop {false};              //!< Stop the writer thread
+};
+
+} // namespace ns3
+
+#endif // NR_SQLITE_STATS_SINK_H
@@ -137,6 +137,87 @@ NrStatsCalculator::GetCellIdPath (std::string path)
 }
 
 
+void
+NrStatsCalculator::ConnectRrc (uint16_t cellId, Ptr<LteEnbRrc> rrc)
+{
+  NS_LOG_FUNCTION (this << cellId << rrc);
+  if (!m_rrcByCellId.emplace (cellId, rrc).second)
+    {
+      return;
+    }
+  // The RRC does not keep the stats alive
+  NrStatsCalculator *stats = this;
+  rrc->TraceConnectWithoutContext ("NewUeContext",
+                                   MakeBoundCallback (&NrStatsCalculator::NotifyNewUeContext, stats, cellId));
+  rrc->TraceConnectWithoutContext ("ConnectionEstablished",
+                                   MakeBoundCallback (&NrStatsCalculator::NotifyUeConnected, stats, cellId));
+  rrc->TraceConnectWithoutContext ("HandoverEndOk",
+                                   MakeBoundCallback (&NrStatsCalculator::NotifyUeConnected, stats, cellId));
+  rrc->TraceConnectWithoutContext ("ConnectionRelease",
+                                   MakeBoundCallback (&NrStatsCalculator::NotifyUeReleased, stats, cellId));
+}
+
+void
+NrStatsCalculator::SetImsi (uint16_t cellId, uint16_t rnti, uint64_t imsi)
+{
+  NS_LOG_FUNCTION (this << cellId << rnti << imsi);
+  m_imsiByCellRnti[GetCellRntiKey (cellId, rnti)] = imsi;
+}
+
+void
+NrStatsCalculator::RemoveImsi (uint16_t cellId, uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << cellId << rnti);
+  m_imsiByCellRnti.erase (GetCellRntiKey (cellId, rnti));
+}
+
+uint64_t
+NrStatsCalculator::GetImsi (uint16_t cellId, uint16_t rnti)
+{
+  auto it = m_imsiByCellRnti.find (GetCellRntiKey (cellId, rnti));
+  if (it != m_imsiByCellRnti.end ())
+    {
+      return it->second;
+    }
+
+  // The connection is not established yet: the UE manager knows the IMSI
+  // since the RRC connection request
+  auto rrc = m_rrcByCellId.find (cellId);
+  if (rrc == m_rrcByCellId.end () || !rrc->second->HasUeManager (rnti))
+    {
+      return 0;
+    }
+  uint64_t imsi = rrc->second->GetUeManager (rnti)->GetImsi ();
+  if (imsi != 0)
+    {
+      SetImsi (cellId, rnti, imsi);
+    }
+  return imsi;
+}
+
+void
+NrStatsCalculator::NotifyUeConnected (NrStatsCalculator *stats, uint16_t cellId,
+                                      uint64_t imsi, [[maybe_unused]] uint16_t rrcCellId,
+                                      uint16_t rnti)
+{
+  stats->SetImsi (cellId, rnti, imsi);
+}
+
+void
+NrStatsCalculator::NotifyUeReleased (NrStatsCalculator *stats, uint16_t cellId,
+                                     [[maybe_unused]] uint64_t imsi,
+                                     [[maybe_unused]] uint16_t rrcCellId, uint16_t rnti)
+{
+  stats->RemoveImsi (cellId, rnti);
+}
+
+void
+NrStatsCalculator::NotifyNewUeContext (NrStatsCalculator *stats, uint16_t cellId,
+                                       [[maybe_unused]] uint16_t rrcCellId, uint16_t rnti)
+{
+  stats->RemoveImsi (cellId, rnti);
+}
+
 uint64_t
 NrStatsCalculator::FindImsiFromGnbRlcPath (std::string path)
 {
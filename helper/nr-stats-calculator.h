@@ -24,9 +24,12 @@
 #include "ns3/object.h"
 #include "ns3/string.h"
 #include <map>
+#include <unordered_map>
 
 namespace ns3 {
 
+class LteEnbRrc;
+
 /**
  * \ingroup nr
  *
@@ -122,6 +125,45 @@ public:
    */
   uint16_t GetCellIdPath (std::string path);
 
+  /**
+   * \brief Keep the IMSI of the UEs of a cell up to date from the events of its RRC
+   *
+   * The IMSI of an RNTI is stored when the connection is established or the
+   * handover completes, and forgotten when the RNTI is given to a new UE or
+   * released. A second call for the same cell does nothing.
+   *
+   * \param cellId the cell ID used in GetImsi
+   * \param rrc the RRC of the cell
+   */
+  void ConnectRrc (uint16_t cellId, Ptr<LteEnbRrc> rrc);
+
+  /**
+   * \brief Store the IMSI of a (cell ID, RNTI) pair
+   * \param cellId the cell ID
+   * \param rnti the RNTI
+   * \param imsi the IMSI
+   */
+  void SetImsi (uint16_t cellId, uint16_t rnti, uint64_t imsi);
+
+  /**
+   * \brief Forget the IMSI of a (cell ID, RNTI) pair
+   * \param cellId the cell ID
+   * \param rnti the RNTI
+   */
+  void RemoveImsi (uint16_t cellId, uint16_t rnti);
+
+  /**
+   * \brief Retrieve the IMSI of a (cell ID, RNTI) pair
+   *
+   * If no RRC event stored it yet (e.g., during the connection
+   * establishment), the IMSI is asked to the RRC given to ConnectRrc.
+   *
+   * \param cellId the cell ID
+   * \param rnti the RNTI
+   * \return the IMSI, or 0 if it is not known
+   */
+  uint64_t GetImsi (uint16_t cellId, uint16_t rnti);
+
 protected:
 
   /**
@@ -162,6 +204,58 @@ protected:
   static uint16_t FindCellIdFromGnbMac (std::string path, uint16_t rnti);
 
 private:
+  /**
+   * \param cellId the cell ID
+   * \param rnti the RNTI
+   * \return the key of the pair in m_imsiByCellRnti
+   */
+  static uint32_t GetCellRntiKey (uint16_t cellId, uint16_t rnti)
+  {
+    return (static_cast<uint32_t> (cellId) << 16) | rnti;
+  }
+
+  /**
+   * \brief Sink of the ConnectionEstablished and HandoverEndOk traces of LteEnbRrc
+   * \param stats the stats calculator
+   * \param cellId the cell ID given to ConnectRrc
+   * \param imsi the IMSI
+   * \param rrcCellId the cell ID of the trace (unused)
+   * \param rnti the RNTI
+   */
+  static void NotifyUeConnected (NrStatsCalculator *stats, uint16_t cellId,
+                                 uint64_t imsi, uint16_t rrcCellId, uint16_t rnti);
+
+  /**
+   * \brief Sink of the ConnectionRelease trace of LteEnbRrc
+   * \param stats the stats calculator
+   * \param cellId the cell ID given to ConnectRrc
+   * \param imsi the IMSI
+   * \param rrcCellId the cell ID of the trace (unused)
+   * \param rnti the RNTI
+   */
+  static void NotifyUeReleased (NrStatsCalculator *stats, uint16_t cellId,
+                                uint64_t imsi, uint16_t rrcCellId, uint16_t rnti);
+
+  /**
+   * \brief Sink of the NewUeContext trace of LteEnbRrc
+   * \param stats the stats calculator
+   * \param cellId the cell ID given to ConnectRrc
+   * \param rrcCellId the cell ID of the trace (unused)
+   * \param rnti the RNTI
+   */
+  static void NotifyNewUeContext (NrStatsCalculator *stats, uint16_t cellId,
+                                  uint16_t rrcCellId, uint16_t rnti);
+
+  /**
+   * IMSI by (cell ID, RNTI), see GetCellRntiKey
+   */
+  std::unordered_map<uint32_t, uint64_t> m_imsiByCellRnti;
+
+  /**
+   * RRC of each cell given to ConnectRrc
+   */
+  std::map<uint16_t, Ptr<LteEnbRrc>> m_rrcByCellId;
+
   /**
    * List of IMSI by path in the attribute system
    */
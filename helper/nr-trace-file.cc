@@ -0,0 +1,351 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-trace-file.h"
+#include <ns3/log.h>
+
+#include <cstdio>
+#include <vector>
+
+#ifdef NR_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef NR_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrTraceFile");
+
+/**
+ * \ingroup helper
+ * \brief Stream buffer that compresses the data of each full buffer
+ *
+ * sync does nothing: the data is compressed when the buffer is full, and
+ * the stream is terminated by Close.
+ */
+class NrCompressedStreamBuf : public std::streambuf
+{
+public:
+  /**
+   * \brief Constructor
+   * \param file the open file, closed by Close
+   * \param compression GZIP or ZSTD, available in this build
+   */
+  NrCompressedStreamBuf (FILE *file, NrTraceFile::Compression compression);
+  ~NrCompressedStreamBuf () override;
+
+  /**
+   * \brief Compress the remaining data, terminate the stream and close the file
+   * \return false if the data could not be written
+   */
+  bool Close ();
+
+protected:
+  int_type overflow (int_type ch) override;
+  int sync () override;
+
+private:
+  /**
+   * \brief Compress the data of the buffer, and write the output to the file
+   * \param finish if true, terminate the stream
+   * \return false if the data could not be compressed or written
+   */
+  bool Compress (bool finish);
+
+  /**
+   * \param size the number of bytes of m_out to write
+   * \return false if they could not be written
+   */
+  bool Write (size_t size);
+
+  FILE *m_file;                          //!< The file
+  NrTraceFile::Compression m_compression; //!< GZIP or ZSTD
+  std::vector<char> m_in;                //!< Data to compress
+  std::vector<char> m_out;               //!< Compressed data
+  bool m_ok {true};                      //!< False after an error
+#ifdef NR_WITH_ZLIB
+  z_stream m_zlib;                       //!< State of zlib
+#endif
+#ifdef NR_WITH_ZSTD
+  ZSTD_CCtx *m_zstd {nullptr};           //!< State of zstd
+#endif
+};
+
+NrCompressedStreamBuf::NrCompressedStreamBuf (FILE *file, NrTraceFile::Compression compression)
+  : m_file (file),
+  m_compression (compression),
+  m_in (64 * 1024),
+  m_out (64 * 1024)
+{
+  setp (m_in.data (), m_in.data () + m_in.size ());
+#ifdef NR_WITH_ZLIB
+  if (m_compression == NrTraceFile::GZIP)
+    {
+      m_zlib = z_stream ();
+      // 15 + 16: the largest window, with a gzip header and trailer
+      m_ok = deflateInit2 (&m_zlib, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                           Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+#endif
+#ifdef NR_WITH_ZSTD
+  if (m_compression == NrTraceFile::ZSTD)
+    {
+      m_zstd = ZSTD_createCCtx ();
+      m_ok = m_zstd != nullptr;
+    }
+#endif
+}
+
+NrCompressedStreamBuf::~NrCompressedStreamBuf ()
+{
+  Close ();
+}
+
+bool
+NrCompressedStreamBuf::Close ()
+{
+  if (m_file == nullptr)
+    {
+      return m_ok;
+    }
+  m_ok = Compress (true) && m_ok;
+#ifdef NR_WITH_ZLIB
+  if (m_compression == NrTraceFile::GZIP)
+    {
+      deflateEnd (&m_zlib);
+    }
+#endif
+#ifdef NR_WITH_ZSTD
+  if (m_compression == NrTraceFile::ZSTD)
+    {
+      ZSTD_freeCCtx (m_zstd);
+      m_zstd = nullptr;
+    }
+#endif
+  m_ok = fclose (m_file) == 0 && m_ok;
+  m_file = nullptr;
+  return m_ok;
+}
+
+NrCompressedStreamBuf::int_type
+NrCompressedStreamBuf::overflow (int_type ch)
+{
+  if (!Compress (false))
+    {
+      return traits_type::eof ();
+    }
+  if (!traits_type::eq_int_type (ch, traits_type::eof ()))
+    {
+      *pptr () = traits_type::to_char_type (ch);
+      pbump (1);
+      return ch;
+    }
+  return traits_type::not_eof (ch);
+}
+
+int
+NrCompressedStreamBuf::sync ()
+{
+  return m_ok ? 0 : -1;
+}
+
+bool
+NrCompressedStreamBuf::Write (size_t size)
+{
+  return size == 0 || fwrite (m_out.data (), 1, size, m_file) == size;
+}
+
+bool
+NrCompressedStreamBuf::Compress ([[maybe_unused]] bool finish)
+{
+  if (!m_ok || m_file == nullptr)
+    {
+      return false;
+    }
+  [[maybe_unused]] size_t size = static_cast<size_t> (pptr () - pbase ());
+  setp (m_in.data (), m_in.data () + m_in.size ());
+
+#ifdef NR_WITH_ZLIB
+  if (m_compression == NrTraceFile::GZIP)
+    {
+      m_zlib.next_in = reinterpret_cast<Bytef *> (m_in.data ());
+      m_zlib.avail_in = static_cast<uInt> (size);
+      do
+        {
+          m_zlib.next_out = reinterpret_cast<Bytef *> (m_out.data ());
+          m_zlib.avail_out = static_cast<uInt> (m_out.size ());
+          if (deflate (&m_zlib, finish ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR
+              || !Write (m_out.size () - m_zlib.avail_out))
+            {
+              m_ok = false;
+              return false;
+            }
+        }
+      while (m_zlib.avail_out == 0);
+    }
+#endif
+#ifdef NR_WITH_ZSTD
+  if (m_compression == NrTraceFile::ZSTD)
+    {
+      ZSTD_inBuffer in {m_in.data (), size, 0};
+      bool done = false;
+      while (!done)
+        {
+          ZSTD_outBuffer out {m_out.data (), m_out.size (), 0};
+          size_t remaining = ZSTD_compressStream2 (m_zstd, &out, &in,
+                                                   finish ? ZSTD_e_end : ZSTD_e_continue);
+          if (ZSTD_isError (remaining) || !Write (out.pos))
+            {
+              m_ok = false;
+              return false;
+            }
+          done = finish ? remaining == 0 : in.pos == in.size;
+        }
+    }
+#endif
+  return true;
+}
+
+NrTraceFile::NrTraceFile ()
+  : std::ostream (nullptr)
+{
+  rdbuf (&m_fileBuf);
+}
+
+NrTraceFile::~NrTraceFile ()
+{
+  if (is_open ())
+    {
+      close ();
+    }
+}
+
+void
+NrTraceFile::open (const std::string &fileName, std::ios_base::openmode mode)
+{
+  open (fileName, NONE, mode);
+}
+
+void
+NrTraceFile::open (const std::string &fileName, Compression compression,
+                   std::ios_base::openmode mode)
+{
+  NS_LOG_FUNCTION (this << fileName << compression);
+  if (is_open ())
+    {
+      setstate (std::ios_base::failbit);
+      return;
+    }
+
+  m_compression = GetAvailable (compression);
+  if (m_compression != compression)
+    {
+      NS_LOG_WARN ("Compression " << compression << " not available, using " << m_compression);
+    }
+
+  if (m_compression == NONE)
+    {
+      if (m_fileBuf.open (fileName, mode | std::ios_base::out) == nullptr)
+        {
+          setstate (std::ios_base::failbit);
+          return;
+        }
+      rdbuf (&m_fileBuf);
+      return;
+    }
+
+  std::string name = fileName + GetExtension (m_compression);
+  FILE *file = fopen (name.c_str (), (mode & std::ios_base::app) ? "ab" : "wb");
+  if (file == nullptr)
+    {
+      setstate (std::ios_base::failbit);
+      return;
+    }
+  m_compressedBuf.reset (new NrCompressedStreamBuf (file, m_compression));
+  rdbuf (m_compressedBuf.get ());
+}
+
+bool
+NrTraceFile::is_open () const
+{
+  return m_compressedBuf != nullptr || m_fileBuf.is_open ();
+}
+
+void
+NrTraceFile::close ()
+{
+  NS_LOG_FUNCTION (this);
+  bool ok;
+  if (m_compressedBuf)
+    {
+      ok = static_cast<NrCompressedStreamBuf *> (m_compressedBuf.get ())->Close ();
+      m_compressedBuf.reset ();
+    }
+  else
+    {
+      ok = m_fileBuf.close () != nullptr;
+    }
+  rdbuf (&m_fileBuf);
+  m_compression = NONE;
+  if (!ok)
+    {
+      setstate (std::ios_base::failbit);
+    }
+}
+
+NrTraceFile::Compression
+NrTraceFile::GetCompression () const
+{
+  return m_compression;
+}
+
+NrTraceFile::Compression
+NrTraceFile::GetAvailable (Compression compression)
+{
+#ifndef NR_WITH_ZSTD
+  if (compression == ZSTD)
+    {
+      compression = GZIP;
+    }
+#endif
+#ifndef NR_WITH_ZLIB
+  if (compression == GZIP)
+    {
+      compression = NONE;
+    }
+#endif
+  return compression;
+}
+
+std::string
+NrTraceFile::GetExtension (Compression compression)
+{
+  switch (compression)
+    {
+    case GZIP:
+      return ".gz";
+    case ZSTD:
+      return ".zst";
+    default:
+      return "";
+    }
+}
+
+} // namespace ns3
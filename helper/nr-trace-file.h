@@ -0,0 +1,119 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_TRACE_FILE_H
+#define NR_TRACE_FILE_H
+
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \ingroup helper
+ * \brief Output file of the text traces, optionally compressed while written
+ *
+ * It replaces std::ofstream in the trace helpers, with the same open,
+ * is_open and close methods. Without compression, it writes through a
+ * std::filebuf, as std::ofstream does. With GZIP or ZSTD, the text is
+ * collected in a 64 KiB buffer, and each full buffer is compressed and
+ * written to the file; the extension of the format (.gz or .zst) is
+ * appended to the file name. A flush (e.g., std::endl) does not force
+ * the data to the file, so that the compressor sees large blocks: the
+ * last block is written by close, or by the destructor.
+ *
+ * A file opened in append mode gets a new gzip member or zstd frame, and
+ * the tools (gzip -d, zstd -d, zcat) decompress the concatenation.
+ *
+ * The formats are available if the module was built with zlib (GZIP) and
+ * libzstd (ZSTD). A missing ZSTD falls back to GZIP, and a missing GZIP
+ * to no compression, see GetAvailable.
+ */
+class NrTraceFile : public std::ostream
+{
+public:
+  /**
+   * \brief Compression of the file
+   */
+  enum Compression
+  {
+    NONE = 0,  //!< Plain text
+    GZIP = 1,  //!< gzip (zlib), extension .gz
+    ZSTD = 2   //!< Zstandard, extension .zst
+  };
+
+  NrTraceFile ();
+  /**
+   * \brief Close the file, if it is open
+   */
+  ~NrTraceFile ();
+
+  /**
+   * \brief Open the file, uncompressed
+   * \param fileName the name of the file
+   * \param mode the open mode, as for std::ofstream
+   */
+  void open (const std::string &fileName, std::ios_base::openmode mode = std::ios_base::out);
+
+  /**
+   * \brief Open the file
+   * \param fileName the name of the file, without the extension of the compression
+   * \param compression the compression; if not available, the one returned by GetAvailable
+   * \param mode the open mode, as for std::ofstream
+   */
+  void open (const std::string &fileName, Compression compression,
+             std::ios_base::openmode mode = std::ios_base::out);
+
+  /**
+   * \return true if the file is open
+   */
+  bool is_open () const;
+
+  /**
+   * \brief Write the remaining data, and close the file
+   */
+  void close ();
+
+  /**
+   * \return the compression of the open file
+   */
+  Compression GetCompression () const;
+
+  /**
+   * \param compression a compression
+   * \return the compression used instead of it by this build
+   */
+  static Compression GetAvailable (Compression compression);
+
+  /**
+   * \param compression a compression
+   * \return the file name extension of the compression (empty for NONE)
+   */
+  static std::string GetExtension (Compression compression);
+
+private:
+  std::filebuf m_fileBuf;                     //!< Buffer of the uncompressed files
+  std::unique_ptr<std::streambuf> m_compressedBuf; //!< Buffer of the compressed files
+  Compression m_compression {NONE};           //!< Compression of the open file
+};
+
+} // namespace ns3
+
+#endif // NR_TRACE_FILE_H
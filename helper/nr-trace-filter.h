@@ -0,0 +1,97 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_TRACE_FILTER_H
+#define NR_TRACE_FILTER_H
+
+#include <cstdint>
+#include <set>
+
+namespace ns3 {
+
+/**
+ * \ingroup helper
+ * \brief Selection of the UEs, cells and BWPs whose traces are connected
+ *
+ * An empty list selects all the values. A UE is selected if its IMSI is in
+ * m_imsis, and if it is one out of m_samplingPeriod UEs: the UEs whose
+ * (IMSI - 1) is a multiple of the period, so that the selection does not
+ * change between runs.
+ *
+ * Example, the traces of one UE out of 100, in the cells 1 and 2:
+ * \code
+ *   NrTraceFilter filter;
+ *   filter.m_cellIds = {1, 2};
+ *   filter.m_samplingPeriod = 100;
+ *   nrHelper->SetTraceFilter (filter);
+ *   nrHelper->EnableTraces ();
+ * \endcode
+ *
+ * \see NrHelper::SetTraceFilter
+ */
+struct NrTraceFilter
+{
+  std::set<uint64_t> m_imsis;    //!< IMSIs of the selected UEs (empty: all)
+  std::set<uint16_t> m_cellIds;  //!< Cell IDs of the selected cells (empty: all)
+  std::set<uint16_t> m_bwpIds;   //!< IDs of the selected BWPs (empty: all)
+  uint32_t m_samplingPeriod {1}; //!< One UE out of this number is selected
+
+  /**
+   * \param imsi the IMSI of a UE
+   * \return true if the UE is selected
+   */
+  bool SelectsImsi (uint64_t imsi) const
+  {
+    if (!FiltersImsi ())
+      {
+        return true;
+      }
+    return imsi > 0 && (imsi - 1) % m_samplingPeriod == 0
+           && (m_imsis.empty () || m_imsis.count (imsi) > 0);
+  }
+
+  /**
+   * \param cellId the cell ID
+   * \return true if the cell is selected
+   */
+  bool SelectsCell (uint16_t cellId) const
+  {
+    return m_cellIds.empty () || m_cellIds.count (cellId) > 0;
+  }
+
+  /**
+   * \param bwpId the BWP ID
+   * \return true if the BWP is selected
+   */
+  bool SelectsBwp (uint16_t bwpId) const
+  {
+    return m_bwpIds.empty () || m_bwpIds.count (bwpId) > 0;
+  }
+
+  /**
+   * \return true if not all the UEs are selected
+   */
+  bool FiltersImsi () const
+  {
+    return !m_imsis.empty () || m_samplingPeriod > 1;
+  }
+};
+
+} // namespace ns3
+
+#endif // NR_TRACE_FILTER_H
@@ -0,0 +1,205 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-trace-queue.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrTraceQueue");
+
+NrTraceQueue &
+NrTraceQueue::Get ()
+{
+  static NrTraceQueue queue;
+  return queue;
+}
+
+NrTraceQueue::~NrTraceQueue ()
+{
+  if (m_started)
+    {
+      m_stop = true;
+      m_consumer.join ();
+    }
+}
+
+void
+NrTraceQueue::Configure (uint32_t capacity, Backpressure backpressure, uint32_t samplingPeriod)
+{
+  NS_LOG_FUNCTION (this << capacity << backpressure << samplingPeriod);
+  NS_ABORT_MSG_IF (m_started, "The trace queue must be configured before the first record");
+  NS_ABORT_MSG_IF (capacity < 2, "The trace queue needs at least 2 records");
+  NS_ABORT_MSG_IF (samplingPeriod == 0, "The sampling period must be at least 1");
+
+  uint64_t size = 1;
+  while (size < capacity)
+    {
+      size <<= 1;
+    }
+  m_slots.reset (new Slot[size]);
+  for (uint64_t i = 0; i < size; ++i)
+    {
+      m_slots[i].m_sequence.store (i, std::memory_order_relaxed);
+    }
+  m_mask = size - 1;
+  m_backpressure = backpressure;
+  m_samplingPeriod = samplingPeriod;
+}
+
+bool
+NrTraceQueue::Push (std::ostream *os, const char *data, uint32_t size)
+{
+  if (!m_started)
+    {
+      static std::mutex startMutex;
+      std::lock_guard<std::mutex> lock (startMutex);
+      if (!m_started)
+        {
+          if (!m_slots)
+            {
+              Configure (16 * 1024, m_backpressure, m_samplingPeriod);
+            }
+          m_consumer = std::thread (&NrTraceQueue::ConsumerLoop, this);
+          m_started = true;
+        }
+    }
+
+  if (size > MAX_RECORD_SIZE)
+    {
+      Flush ();
+      os->write (data, size);
+      return true;
+    }
+
+  if (m_backpressure == SAMPLE)
+    {
+      uint64_t queued = m_enqueuePos.load (std::memory_order_relaxed) -
+        m_dequeuePos.load (std::memory_order_relaxed);
+      if (queued > m_mask / 2 && m_sampleCounter++ % m_samplingPeriod != 0)
+        {
+          ++m_dropped;
+          return false;
+        }
+    }
+
+  while (!TryPush (os, data, size))
+    {
+      if (m_backpressure != BLOCK)
+        {
+          ++m_dropped;
+          return false;
+        }
+      std::this_thread::yield ();
+    }
+  return true;
+}
+
+bool
+NrTraceQueue::TryPush (std::ostream *os, const char *data, uint32_t size)
+{
+  uint64_t pos = m_enqueuePos.load (std::memory_order_relaxed);
+  Slot *slot;
+  while (true)
+    {
+      slot = &m_slots[pos & m_mask];
+      uint64_t sequence = slot->m_sequence.load (std::memory_order_acquire);
+      int64_t diff = static_cast<int64_t> (sequence) - static_cast<int64_t> (pos);
+      if (diff == 0)
+        {
+          if (m_enqueuePos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+            {
+              break;
+            }
+        }
+      else if (diff < 0)
+        {
+          return false; // full
+        }
+      else
+        {
+          pos = m_enqueuePos.load (std::memory_order_relaxed);
+        }
+    }
+
+  slot->m_os = os;
+  slot->m_size = size;
+  std::memcpy (slot->m_data, data, size);
+  slot->m_sequence.store (pos + 1, std::memory_order_release);
+  return true;
+}
+
+void
+NrTraceQueue::ConsumerLoop ()
+{
+  uint32_t idle = 0;
+  while (true)
+    {
+      uint64_t pos = m_dequeuePos.load (std::memory_order_relaxed);
+      Slot &slot = m_slots[pos & m_mask];
+      if (slot.m_sequence.load (std::memory_order_acquire) == pos + 1)
+        {
+          slot.m_os->write (slot.m_data, slot.m_size);
+          slot.m_sequence.store (pos + m_mask + 1, std::memory_order_release);
+          m_dequeuePos.store (pos + 1, std::memory_order_relaxed);
+          ++m_written;
+          idle = 0;
+          continue;
+        }
+
+      // Empty: stop only when asked and when every reserved slot is written
+      if (m_stop && m_enqueuePos.load (std::memory_order_acquire) == pos)
+        {
+          return;
+        }
+      if (++idle < 64)
+        {
+          std::this_thread::yield ();
+        }
+      else
+        {
+          std::this_thread::sleep_for (std::chrono::microseconds (100));
+        }
+    }
+}
+
+void
+NrTraceQueue::Flush ()
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_started)
+    {
+      return;
+    }
+  while (m_written.load (std::memory_order_acquire) != m_enqueuePos.load (std::memory_order_acquire))
+    {
+      std::this_thread::yield ();
+    }
+}
+
+uint64_t
+NrTraceQueue::GetDropped () const
+{
+  return m_dropped;
+}
+
+} // namespace ns3
@@ -0,0 +1,151 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_TRACE_QUEUE_H
+#define NR_TRACE_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <thread>
+
+namespace ns3 {
+
+/**
+ * \ingroup helper
+ * \brief Writes the fixed-size trace records on a dedicated thread
+ *
+ * The producers (the trace callbacks, possibly more than one thread) copy
+ * each record, with the stream it is for, in a bounded lock-free ring
+ * buffer. A consumer thread, started with the first record, takes the
+ * records in order and writes them. The records of a stream are written in
+ * the order they were pushed.
+ *
+ * When the ring is full, a record is dropped (DROP), or the producer waits
+ * for a free slot (BLOCK). With SAMPLE, when the ring is more than half
+ * full, only one record out of the sampling period is queued, and the
+ * others are dropped. GetDropped counts the dropped records.
+ *
+ * A stream must not be used by anybody else while it has queued records:
+ * Flush waits until all of them are written.
+ */
+class NrTraceQueue
+{
+public:
+  /**
+   * \brief What a producer does when the ring is full
+   */
+  enum Backpressure
+  {
+    DROP = 0,   //!< Drop the record
+    BLOCK = 1,  //!< Wait for a free slot
+    SAMPLE = 2  //!< Above half full, queue one record out of the sampling period
+  };
+
+  static constexpr uint32_t MAX_RECORD_SIZE = 256; //!< Largest record that can be queued
+
+  /**
+   * \return the queue shared by all the traces
+   */
+  static NrTraceQueue & Get ();
+
+  /**
+   * \brief Write all the records, and stop the consumer thread
+   */
+  ~NrTraceQueue ();
+
+  /**
+   * \brief Configure the queue, before the first record
+   * \param capacity number of records in the ring (rounded up to a power of 2)
+   * \param backpressure what happens when the ring is full
+   * \param samplingPeriod one record out of samplingPeriod is queued with SAMPLE
+   */
+  void Configure (uint32_t capacity, Backpressure backpressure, uint32_t samplingPeriod);
+
+  /**
+   * \brief Queue a record
+   *
+   * A record larger than MAX_RECORD_SIZE is written directly, after the
+   * queued records.
+   *
+   * \param os the stream to write the record to
+   * \param data the record
+   * \param size the size of the record
+   * \return false if the record was dropped
+   */
+  bool Push (std::ostream *os, const char *data, uint32_t size);
+
+  /**
+   * \brief Wait until all the queued records are written
+   */
+  void Flush ();
+
+  /**
+   * \return the number of records dropped
+   */
+  uint64_t GetDropped () const;
+
+private:
+  /**
+   * \brief A slot of the ring
+   *
+   * m_sequence is the position for which the slot is free (equal to it) or
+   * full (equal to it + 1).
+   */
+  struct Slot
+  {
+    std::atomic<uint64_t> m_sequence {0}; //!< Sequence number of the slot
+    std::ostream *m_os {nullptr};         //!< Destination of the record
+    uint32_t m_size {0};                  //!< Size of the record
+    char m_data[MAX_RECORD_SIZE];         //!< The record
+  };
+
+  NrTraceQueue () = default;
+
+  /**
+   * \brief Try to queue a record
+   * \param os the stream
+   * \param data the record
+   * \param size the size of the record
+   * \return false if the ring is full
+   */
+  bool TryPush (std::ostream *os, const char *data, uint32_t size);
+
+  /**
+   * \brief Write the queued records until stopped
+   */
+  void ConsumerLoop ();
+
+  std::unique_ptr<Slot[]> m_slots;            //!< The ring
+  uint64_t m_mask {0};                        //!< Capacity - 1
+  Backpressure m_backpressure {BLOCK};         //!< Backpressure policy
+  uint32_t m_samplingPeriod {10};             //!< Sampling period of SAMPLE
+  std::atomic<uint64_t> m_enqueuePos {0};     //!< Next position to fill
+  std::atomic<uint64_t> m_dequeuePos {0};     //!< Next position to write
+  std::atomic<uint64_t> m_written {0};        //!< Number of records written
+  std::atomic<uint64_t> m_dropped {0};        //!< Number of records dropped
+  std::atomic<uint64_t> m_sampleCounter {0};  //!< Records offered while above half full
+  std::atomic<bool> m_stop {false};           //!< Whether the consumer has to stop
+  std::thread m_consumer;                     //!< The consumer thread
+  std::atomic<bool> m_started {false};        //!< Whether the consumer thread was started
+};
+
+} // namespace ns3
+
+#endif // NR_TRACE_QUEUE_H
@@ -29,6 +29,7 @@
 #include <ns3/lte-ue-rrc.h>
 #include <ns3/nr-phy-mac-common.h>
 #include <ns3/nr-spectrum-phy.h>
+#include <ns3/nr-counters.h>
 #include <ns3/nr-mac-scheduler.h>
 
 namespace ns3{
@@ -99,6 +100,7 @@ RealisticBeamformingHelper::GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnb
 {
   auto itAlgo = m_antennaPairToAlgorithm.find(std::make_pair(gnbSpectrumPhy, ueSpectrumPhy));
   NS_ABORT_MSG_IF (itAlgo == m_antennaPairToAlgorithm.end(), "There is no created task/algorithm for the specified pair of antenna arrays.");
+  NrCounters::Add (gnbSpectrumPhy->GetCellId (), gnbSpectrumPhy->GetBwpId (), NrCounters::BEAMFORMING_SEARCHES);
   return itAlgo->second->GetBeamformingVectors ();
 }
 
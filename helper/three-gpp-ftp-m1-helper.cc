@@ -19,6 +19,7 @@
 
 #include "three-gpp-ftp-m1-helper.h"
 #include <ns3/packet-sink-helper.h>
+#include <ns3/boolean.h>
 
 namespace ns3 {
 
@@ -52,6 +53,13 @@ ThreeGppFtpM1Helper::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::ThreeGppFtpM1Helper")
                       .SetParent<Object> ()
                       .AddConstructor<ThreeGppFtpM1Helper> ()
+                      .AddAttribute ("ReuseSockets",
+                                     "If true, each client keeps one socket for all its files "
+                                     "(see FileTransferApplication::ReuseSocket), instead of "
+                                     "opening one per file",
+                                     BooleanValue (false),
+                                     MakeBooleanAccessor (&ThreeGppFtpM1Helper::m_reuseSockets),
+                                     MakeBooleanChecker ())
   ;
   return tid;
 }
@@ -74,6 +82,7 @@ ThreeGppFtpM1Helper::DoConfigureFtpClients (void)
   FileTransferHelper ftpHelper ("ns3::UdpSocketFactory", Address ());
   ftpHelper.SetAttribute ("SendSize", UintegerValue (ftpSegSize));
   ftpHelper.SetAttribute ("FileSize", UintegerValue (m_ftpFileSize));
+  ftpHelper.SetAttribute ("ReuseSocket", BooleanValue (m_reuseSockets));
 
   for (uint32_t i = 0; i < m_serversIps->GetN (); i++)
     {
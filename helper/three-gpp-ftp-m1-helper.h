@@ -56,6 +56,11 @@ namespace ns3 {
 * Traffic intensity can be modified by varying the FTP lambda
 * value.
 *
+* By default, every file opens a new socket in its client. With the
+* ReuseSockets attribute, each client opens one socket at its first file,
+* and queues the next files on it: the load of many clients then costs
+* only the packets of the files.
+*
 * This helper should be used in the following way:
 *
 * ...
@@ -142,6 +147,7 @@ private:
   NodeContainer* m_clientNodes;//!<container of client nodes
   Ipv4InterfaceContainer* m_serversIps;//!<container of IPv4 server interfaces
   ApplicationContainer m_pingApps;//!<container of ping apps
+  bool m_reuseSockets {false};//!<the ReuseSockets attribute
 };
 
 
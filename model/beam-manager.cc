@@ -18,6 +18,7 @@
  */
 
 #include "beam-manager.h"
+#include "nr-beam-codebook.h"
 #include <ns3/uinteger.h>
 #include <ns3/log.h>
 #include <ns3/simulator.h>
@@ -55,6 +56,12 @@ BeamManager::GetBeamId (const BeamformingVector&v) const
   return v.second;
 }
 
+bool
+BeamManager::HasBeamformingVector (const Ptr<const NetDevice>& device) const
+{
+  return m_beamformingVectorMap.find (device) != m_beamformingVectorMap.end ();
+}
+
 Ptr<const UniformPlanarArray>
 BeamManager::GetAntenna () const
 {
@@ -105,18 +112,37 @@ BeamManager::SaveBeamformingVector (const BeamformingVector& bfv,
 
   if (device != nullptr)
     {
+      // A beam of the codebook is stored by its index only
+      bool byIndex = m_beamCodebook != nullptr && NrBeamCodebook::IsIndexBeamId (bfv.second)
+        && bfv.second.GetSector () < m_beamCodebook->GetNumBeams ();
+      BeamformingVector stored = byIndex ? std::make_pair (complexVector_t (), bfv.second) : bfv;
+
+      bool beamChanged = true;
       BeamformingStorage::iterator iter = m_beamformingVectorMap.find (device);
       if (iter != m_beamformingVectorMap.end ())
         {
-          (*iter).second = bfv;
+          beamChanged = (*iter).second.second != bfv.second;
+          (*iter).second = std::move (stored);
         }
       else
         {
-          m_beamformingVectorMap.insert (std::make_pair (device, bfv));
+          m_beamformingVectorMap.insert (std::make_pair (device, std::move (stored)));
+        }
+
+      if (beamChanged && !m_beamChangeCallback.IsNull ())
+        {
+          m_beamChangeCallback (device);
         }
     }
 }
 
+void
+BeamManager::SetBeamChangeCallback (const Callback<void, const Ptr<const NetDevice>&> &c)
+{
+  NS_LOG_FUNCTION (this);
+  m_beamChangeCallback = c;
+}
+
 void
 BeamManager::ChangeBeamformingVector (const Ptr<const NetDevice>& device)
 {
@@ -141,7 +167,7 @@ BeamManager::ChangeBeamformingVector (const Ptr<const NetDevice>& device)
   else
     {
       NS_LOG_INFO ("Beamforming vector found");
-      m_antennaArray->SetBeamformingVector(it->second.first);
+      m_antennaArray->SetBeamformingVector (GetSavedVector (it->second));
     }
 }
 
@@ -185,7 +211,7 @@ BeamManager::GetBeamformingVector (const Ptr<NetDevice>& device) const
   BeamformingStorage::const_iterator it = m_beamformingVectorMap.find (device);
   if (it != m_beamformingVectorMap.end ())
     {
-      beamformingVector = it->second.first;
+      beamformingVector = GetSavedVector (it->second);
     }
   else
     {
@@ -228,12 +254,135 @@ BeamManager::GetBeamId (const Ptr<NetDevice>& device) const
   return beamId;
 }
 
+double
+BeamManager::GetBeamCoupling (const BeamId &a, const BeamId &b) const
+{
+  const complexVector_t *va = nullptr;
+  const complexVector_t *vb = nullptr;
+  for (const auto & it : m_beamformingVectorMap)
+    {
+      if (va == nullptr && it.second.second == a)
+        {
+          va = &GetSavedVector (it.second);
+        }
+      if (vb == nullptr && it.second.second == b)
+        {
+          vb = &GetSavedVector (it.second);
+        }
+    }
+
+  if (va == nullptr || vb == nullptr || va->size () != vb->size ())
+    {
+      return -1.0;
+    }
+
+  std::complex<double> inner (0.0, 0.0);
+  double normA = 0.0;
+  double normB = 0.0;
+  for (size_t i = 0; i < va->size (); ++i)
+    {
+      inner += std::conj (va->at (i)) * vb->at (i);
+      normA += std::norm (va->at (i));
+      normB += std::norm (vb->at (i));
+    }
+
+  if (normA == 0.0 || normB == 0.0)
+    {
+      return -1.0;
+    }
+  return std::norm (inner) / (normA * normB);
+}
+
+void
+BeamManager::SetBeamCodebook (const std::shared_ptr<const NrBeamCodebook> &codebook)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (codebook != nullptr && codebook->GetVector (0).size () != m_antennaArray->GetNumberOfElements (),
+                   "The codebook is not for the antenna of the beam manager");
+  if (m_beamCodebook == codebook)
+    {
+      return;
+    }
+  // The beams stored by index refer to the old codebook
+  for (auto & it : m_beamformingVectorMap)
+    {
+      if (it.second.first.empty () && m_beamCodebook != nullptr)
+        {
+          it.second.first = m_beamCodebook->GetVector (it.second.second.GetSector ());
+        }
+    }
+  m_beamCodebook = codebook;
+}
+
+std::shared_ptr<const NrBeamCodebook>
+BeamManager::GetBeamCodebook () const
+{
+  return m_beamCodebook;
+}
+
+const complexVector_t &
+BeamManager::GetSavedVector (const BeamformingVector &bfv) const
+{
+  if (bfv.first.empty () && m_beamCodebook != nullptr)
+    {
+      return m_beamCodebook->GetVector (bfv.second.GetSector ());
+    }
+  return bfv.first;
+}
+
+BeamManager::Codebook &
+BeamManager::GetCodebook () const
+{
+  // Codebooks of all the antenna geometries, shared by all the beam managers
+  static std::map<std::vector<double>, std::shared_ptr<Codebook> > codebooks;
+
+  UintegerValue numRows;
+  m_antennaArray->GetAttribute ("NumRows", numRows);
+  uint64_t numElements = m_antennaArray->GetNumberOfElements ();
+
+  bool sameGeometry = m_codebook != nullptr
+    && m_codebookGeometry.size () == 1 + 3 * numElements
+    && m_codebookGeometry[0] == static_cast<double> (numRows.Get ());
+  for (uint64_t i = 0; sameGeometry && i < numElements; ++i)
+    {
+      Vector loc = m_antennaArray->GetElementLocation (i);
+      sameGeometry = m_codebookGeometry[1 + 3 * i] == loc.x
+        && m_codebookGeometry[2 + 3 * i] == loc.y
+        && m_codebookGeometry[3 + 3 * i] == loc.z;
+    }
+
+  if (!sameGeometry)
+    {
+      m_codebookGeometry.assign (1, static_cast<double> (numRows.Get ()));
+      for (uint64_t i = 0; i < numElements; ++i)
+        {
+          Vector loc = m_antennaArray->GetElementLocation (i);
+          m_codebookGeometry.insert (m_codebookGeometry.end (), {loc.x, loc.y, loc.z});
+        }
+      std::shared_ptr<Codebook> &codebook = codebooks[m_codebookGeometry];
+      if (codebook == nullptr)
+        {
+          NS_LOG_LOGIC ("New codebook for " << numElements << " elements");
+          codebook = std::make_shared<Codebook> ();
+        }
+      m_codebook = codebook;
+    }
+  return *m_codebook;
+}
+
 void
 BeamManager::SetSector (uint16_t sector, double elevation) const
 {
   NS_LOG_INFO ("Set sector to : " << (unsigned) sector <<
                ", and elevation to: " << elevation);
-  m_antennaArray->SetBeamformingVector(CreateDirectionalBfv (m_antennaArray, sector, elevation));
+  Codebook &codebook = GetCodebook ();
+  BeamId beamId (sector, elevation);
+  auto it = codebook.m_sectorBfvs.find (beamId);
+  if (it == codebook.m_sectorBfvs.end ())
+    {
+      it = codebook.m_sectorBfvs.emplace (beamId, CreateDirectionalBfv (m_antennaArray, sector, elevation)).first;
+    }
+  m_antennaArray->SetBeamformingVector (it->second);
 }
 
 void
@@ -241,7 +390,14 @@ BeamManager::SetSectorAz (double azimuth, double zenith) const
 {
   NS_LOG_INFO ("Set azimuth to : " << (unsigned) azimuth <<
                ", and zenith to:" << zenith);
-  m_antennaArray->SetBeamformingVector(CreateDirectionalBfvAz (m_antennaArray, azimuth, zenith));
+  Codebook &codebook = GetCodebook ();
+  std::pair<double, double> key (azimuth, zenith);
+  auto it = codebook.m_azimuthZenithBfvs.find (key);
+  if (it == codebook.m_azimuthZenithBfvs.end ())
+    {
+      it = codebook.m_azimuthZenithBfvs.emplace (key, CreateDirectionalBfvAz (m_antennaArray, azimuth, zenith)).first;
+    }
+  m_antennaArray->SetBeamformingVector (it->second);
 }
 
 } /* namespace ns3 */
@@ -23,7 +23,13 @@
 #include "ns3/event-id.h"
 #include <ns3/nstime.h>
 #include <ns3/net-device.h>
+#include <ns3/callback.h>
 #include "beamforming-vector.h"
+#include "beam-id.h"
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 
 namespace ns3 {
@@ -31,6 +37,7 @@ namespace ns3 {
 class NrUeNetDevice;
 class NrGnbNetDevice;
 class BeamformingHelperBase;
+class NrBeamCodebook;
 
 /**
  * \ingroup gnb-phy
@@ -114,6 +121,20 @@ public:
    */
   virtual void SaveBeamformingVector (const BeamformingVector& bfv,
                                       const Ptr<const NetDevice>& device);
+  /**
+   * \brief Check if a beamforming vector is saved for a device
+   * \param device the device
+   * \return true if SaveBeamformingVector was called for the device
+   */
+  bool HasBeamformingVector (const Ptr<const NetDevice>& device) const;
+
+  /**
+   * \brief Set the callback invoked when SaveBeamformingVector changes the
+   * BeamId toward a device
+   * \param c the callback, with the device as parameter
+   */
+  void SetBeamChangeCallback (const Callback<void, const Ptr<const NetDevice>&> &c);
+
   /**
    * \brief Change the beamforming vector for tx/rx to/from specified device
    * \param device Device to change the beamforming vector for
@@ -147,8 +168,26 @@ public:
    */
   virtual BeamId GetBeamId (const Ptr<NetDevice>& device) const;
 
+  /**
+   * \brief Get the coupling between two beams saved for the connected devices
+   *
+   * The coupling is the normalized gain |a^H b|^2 / (|a|^2 |b|^2) between the
+   * beamforming vectors a and b: 1 for the same beam, and close to 0 for
+   * beams that point in well separated directions.
+   *
+   * \param a the first beam
+   * \param b the second beam
+   * \return the coupling, or -1 if no device uses one of the beams
+   */
+  double GetBeamCoupling (const BeamId &a, const BeamId &b) const;
+
   /**
    * \brief Set the Sector
+   *
+   * The beamforming vector is taken from the codebook shared by the beam
+   * managers of the antennas with the same geometry, and computed only the
+   * first time that the sector is used.
+   *
    * \param sector sector
    * \param elevation elevation
    */
@@ -156,12 +195,60 @@ public:
 
   /**
    * \brief Set the Sector
+   *
+   * As SetSector, the beamforming vector is taken from the shared codebook.
+   *
    * \param azimuth azimuth
    * \param zenith zenith
    */
   void SetSectorAz (double azimuth, double zenith) const;
 
+  /**
+   * \brief Set the predefined codebook of the antenna
+   * \param codebook the codebook, see NrBeamCodebook
+   *
+   * For the beams of the codebook saved with SaveBeamformingVector, only
+   * the BeamId (i.e., the index in the codebook) is stored, and the vector
+   * is taken from the codebook when needed.
+   */
+  void SetBeamCodebook (const std::shared_ptr<const NrBeamCodebook> &codebook);
+
+  /**
+   * \return the predefined codebook of the antenna, or nullptr
+   */
+  std::shared_ptr<const NrBeamCodebook> GetBeamCodebook () const;
+
 private:
+  /**
+   * \brief Get the weights of a saved beamforming vector
+   * \param bfv the beamforming vector, possibly stored only by its BeamId
+   * \return the weights
+   */
+  const complexVector_t & GetSavedVector (const BeamformingVector &bfv) const;
+
+  /**
+   * \brief Directional beamforming vectors of an antenna geometry
+   */
+  struct Codebook
+  {
+    std::unordered_map<BeamId, complexVector_t, BeamIdHash> m_sectorBfvs;   //!< Vectors of SetSector, by sector and elevation
+    std::map<std::pair<double, double>, complexVector_t> m_azimuthZenithBfvs; //!< Vectors of SetSectorAz, by azimuth and zenith
+  };
+
+  /**
+   * \brief Get the codebook of the current geometry of the antenna
+   *
+   * The geometry is the number of rows (used by CreateDirectionalBfv) and the
+   * location of every element, which includes the spacing and the
+   * orientation of the array.
+   *
+   * \return the codebook, shared with the beam managers of the antennas with
+   * the same geometry
+   */
+  Codebook & GetCodebook () const;
+
+  mutable std::shared_ptr<Codebook> m_codebook; //!< Codebook of m_codebookGeometry
+  mutable std::vector<double> m_codebookGeometry; //!< Geometry of the antenna when m_codebook was taken
 
   Ptr<UniformPlanarArray> m_antennaArray;  //!< the antenna array instance for which is responsible this BeamManager
   uint32_t m_numRows {0};//!< Number of rows of antenna array for which is calculated current quasi omni beamforming vector
@@ -169,6 +256,8 @@ private:
   BeamformingVector m_omniTxRxW; //!< Beamforming vector that emulates omnidirectional transmission and reception
   BeamformingStorage m_beamformingVectorMap; //!< device to beamforming vector mapping
   BeamformingVector m_predefinedDirTxRxW; //!< A predefined vector that is used for directional transmission and reception to any device
+  Callback<void, const Ptr<const NetDevice>&> m_beamChangeCallback; //!< Called when the BeamId toward a device changes
+  std::shared_ptr<const NrBeamCodebook> m_beamCodebook; //!< Predefined codebook, whose beams are stored by index
 
 };
 
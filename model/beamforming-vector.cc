@@ -61,64 +61,65 @@ complexVector_t CreateQuasiOmniBfv (uint32_t antennaRows, uint32_t antennaColumn
   return omni;
 }
 
-complexVector_t CreateDirectionalBfv (const Ptr<const UniformPlanarArray>& antenna,
-                                      uint16_t sector, double elevation)
+/**
+ * \brief Create the steering vector of an antenna toward a direction
+ *
+ * The direction terms are computed once, then the phase of every element,
+ * and finally the complex exponentials, in separate loops over contiguous
+ * arrays that the compiler can vectorize.
+ *
+ * \param antenna the antenna
+ * \param hAngle_radian the horizontal angle (azimuth) in radians
+ * \param vAngle_radian the vertical angle (zenith) in radians
+ * \return the normalized steering vector
+ */
+static complexVector_t
+CreateSteeringVector (const Ptr<const UniformPlanarArray>& antenna,
+                      double hAngle_radian, double vAngle_radian)
 {
-  complexVector_t tempVector;
-
-  UintegerValue uintValueNumRows;
-  antenna->GetAttribute ("NumRows", uintValueNumRows);
-
-  double hAngle_radian = M_PI * (static_cast<double> (sector) / static_cast<double> (uintValueNumRows.Get ())) - 0.5 * M_PI;
-  double vAngle_radian = elevation * M_PI / 180;
   uint16_t size = antenna->GetNumberOfElements ();
   double power = 1 / sqrt (size);
   if (size == 1)
     {
-      tempVector.push_back (power);  // single AE, no BF
+      return complexVector_t (1, power);  // single AE, no BF
     }
-  else
+
+  double sinVCosH = sin (vAngle_radian) * cos (hAngle_radian);
+  double sinVSinH = sin (vAngle_radian) * sin (hAngle_radian);
+  double cosV = cos (vAngle_radian);
+
+  std::vector<double> phases (size);
+  for (uint16_t ind = 0; ind < size; ind++)
     {
-      for (auto ind = 0; ind < size; ind++)
-        {
-        Vector loc = antenna->GetElementLocation (ind);
-        double phase = -2 * M_PI * (sin (vAngle_radian) * cos (hAngle_radian) * loc.x
-                                    + sin (vAngle_radian) * sin (hAngle_radian) * loc.y
-                                    + cos (vAngle_radian) * loc.z);
-        tempVector.push_back (exp (std::complex<double> (0, phase)) * power);
-        }
+      Vector loc = antenna->GetElementLocation (ind);
+      phases[ind] = -2 * M_PI * (sinVCosH * loc.x + sinVSinH * loc.y + cosV * loc.z);
+    }
+
+  complexVector_t tempVector (size);
+  for (uint16_t ind = 0; ind < size; ind++)
+    {
+      tempVector[ind] = std::complex<double> (cos (phases[ind]) * power, sin (phases[ind]) * power);
     }
   return tempVector;
 }
 
-complexVector_t CreateDirectionalBfvAz (const Ptr<const UniformPlanarArray>& antenna,
-                                        double azimuth, double zenith)
+complexVector_t CreateDirectionalBfv (const Ptr<const UniformPlanarArray>& antenna,
+                                      uint16_t sector, double elevation)
 {
-  complexVector_t tempVector;
-
   UintegerValue uintValueNumRows;
   antenna->GetAttribute ("NumRows", uintValueNumRows);
 
+  double hAngle_radian = M_PI * (static_cast<double> (sector) / static_cast<double> (uintValueNumRows.Get ())) - 0.5 * M_PI;
+  double vAngle_radian = elevation * M_PI / 180;
+  return CreateSteeringVector (antenna, hAngle_radian, vAngle_radian);
+}
+
+complexVector_t CreateDirectionalBfvAz (const Ptr<const UniformPlanarArray>& antenna,
+                                        double azimuth, double zenith)
+{
   double hAngle_radian = azimuth * M_PI / 180;
   double vAngle_radian = zenith * M_PI / 180;
-  uint16_t size = antenna->GetNumberOfElements ();
-  double power = 1 / sqrt (size);
-  if (size == 1)
-    {
-      tempVector.push_back (power);  // single AE, no BF
-    }
-  else
-    {
-      for (auto ind = 0; ind < size; ind++)
-        {
-        Vector loc = antenna->GetElementLocation (ind);
-        double phase = -2 * M_PI * (sin (vAngle_radian) * cos (hAngle_radian) * loc.x
-                                    + sin (vAngle_radian) * sin (hAngle_radian) * loc.y
-                                    + cos (vAngle_radian) * loc.z);
-        tempVector.push_back (exp (std::complex<double> (0, phase)) * power);
-        }
-    }
-  return tempVector;
+  return CreateSteeringVector (antenna, hAngle_radian, vAngle_radian);
 }
 
 complexVector_t CreateDirectPathBfv (const Ptr<MobilityModel>& a,
@@ -18,6 +18,10 @@
  */
 #include "bwp-manager-algorithm.h"
 #include <ns3/log.h>
+#include <ns3/uinteger.h>
+#include <ns3/double.h>
+#include <ns3/enum.h>
+#include <algorithm>
 
 namespace ns3 {
 
@@ -146,4 +150,187 @@ BwpManagerAlgorithmStatic::GetBwpForEpsBearer (const EpsBearer::Qci &v) const
   return m_qciToBwpMap.at (v);
 }
 
+NS_OBJECT_ENSURE_REGISTERED (BwpManagerAlgorithmDynamic);
+
+TypeId
+BwpManagerAlgorithmDynamic::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::BwpManagerAlgorithmDynamic")
+    .SetParent<BwpManagerAlgorithmStatic> ()
+    .SetGroupName ("nr")
+    .AddConstructor<BwpManagerAlgorithmDynamic> ()
+    .AddAttribute ("LoadWindow",
+                   "Number of slots (per BWP) over which the load is estimated. "
+                   "The QCI assignment is evaluated every LoadWindow slots",
+                   UintegerValue (20),
+                   MakeUintegerAccessor (&BwpManagerAlgorithmDynamic::m_loadWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Hysteresis",
+                   "Relative spare capacity that the best BWP must have in excess "
+                   "of the most loaded one to move a QCI",
+                   DoubleValue (0.2),
+                   MakeDoubleAccessor (&BwpManagerAlgorithmDynamic::m_hysteresis),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("LoadDirection",
+                   "Direction of the slots used to estimate the load. NrHelper "
+                   "sets UL for the algorithm of the UEs",
+                   EnumValue (BwpManagerAlgorithmDynamic::DL),
+                   MakeEnumAccessor (&BwpManagerAlgorithmDynamic::m_direction),
+                   MakeEnumChecker (BwpManagerAlgorithmDynamic::DL, "DL",
+                                    BwpManagerAlgorithmDynamic::UL, "UL"))
+  ;
+  return tid;
+}
+
+uint8_t
+BwpManagerAlgorithmDynamic::GetBwpForEpsBearer (const EpsBearer::Qci &v) const
+{
+  auto it = m_qciAssignment.find (v);
+  if (it != m_qciAssignment.end ())
+    {
+      return it->second;
+    }
+
+  uint8_t bwp = BwpManagerAlgorithmStatic::GetBwpForEpsBearer (v);
+  m_qciAssignment.emplace (v, bwp);
+  return bwp;
+}
+
+BwpManagerAlgorithmDynamic::BwpState &
+BwpManagerAlgorithmDynamic::GetBwpState (uint16_t bwpId)
+{
+  if (m_bwps.size () <= bwpId)
+    {
+      m_bwps.resize (bwpId + 1);
+    }
+  BwpState &state = m_bwps[bwpId];
+  if (state.m_window.size () != m_loadWindow)
+    {
+      state.m_window.assign (m_loadWindow, std::make_pair (0, 0));
+      state.m_next = 0;
+      state.m_used = 0;
+      state.m_available = 0;
+    }
+  return state;
+}
+
+void
+BwpManagerAlgorithmDynamic::ReportSlotLoad ([[maybe_unused]] const SfnSf &sfnSf, bool isDl,
+                                            uint16_t bwpId, uint32_t usedRbgSym,
+                                            uint32_t availableRbgSym)
+{
+  if (isDl != (m_direction == DL))
+    {
+      return;
+    }
+
+  BwpState &state = GetBwpState (bwpId);
+
+  // Running sums over the window: remove the oldest slot, add the new one
+  uint32_t used = std::min (usedRbgSym, availableRbgSym);
+  auto &slot = state.m_window[state.m_next];
+  state.m_used = state.m_used - slot.first + used;
+  state.m_available = state.m_available - slot.second + availableRbgSym;
+  slot = std::make_pair (used, availableRbgSym);
+  state.m_next = (state.m_next + 1) % m_loadWindow;
+
+  if (++m_reportsSinceRebalance >= m_loadWindow * m_bwps.size ())
+    {
+      m_reportsSinceRebalance = 0;
+      Rebalance ();
+    }
+}
+
+void
+BwpManagerAlgorithmDynamic::ReportDlWbCqi (uint16_t bwpId, [[maybe_unused]] uint16_t rnti, uint8_t cqi)
+{
+  // Exponential average over the reports of all the UEs
+  static const double alpha = 0.1;
+
+  BwpState &state = GetBwpState (bwpId);
+  if (state.m_cqi < 0.0)
+    {
+      state.m_cqi = cqi;
+    }
+  else
+    {
+      state.m_cqi = (1.0 - alpha) * state.m_cqi + alpha * cqi;
+    }
+}
+
+double
+BwpManagerAlgorithmDynamic::GetBwpLoad (uint16_t bwpId) const
+{
+  if (bwpId >= m_bwps.size () || m_bwps[bwpId].m_available == 0)
+    {
+      return 0.0;
+    }
+  return static_cast<double> (m_bwps[bwpId].m_used) / m_bwps[bwpId].m_available;
+}
+
+double
+BwpManagerAlgorithmDynamic::GetSpareCapacity (const BwpState &state)
+{
+  double spare = static_cast<double> (state.m_available - state.m_used) / state.m_window.size ();
+  if (state.m_cqi >= 0.0)
+    {
+      spare *= state.m_cqi / 15.0;
+    }
+  return spare;
+}
+
+void
+BwpManagerAlgorithmDynamic::Rebalance ()
+{
+  NS_LOG_FUNCTION (this);
+
+  // Only the BWPs that reported their load are known to exist
+  int32_t best = -1;
+  int32_t loaded = -1;
+  for (uint32_t bwp = 0; bwp < m_bwps.size (); ++bwp)
+    {
+      if (m_bwps[bwp].m_available == 0)
+        {
+          continue;
+        }
+      if (best < 0 || GetSpareCapacity (m_bwps[bwp]) > GetSpareCapacity (m_bwps[best]))
+        {
+          best = static_cast<int32_t> (bwp);
+        }
+      bool hasQci = std::any_of (m_qciAssignment.begin (), m_qciAssignment.end (),
+                                 [bwp] (const std::pair<const uint8_t, uint8_t> &a)
+                                 { return a.second == bwp; });
+      if (hasQci && (loaded < 0 || GetBwpLoad (bwp) > GetBwpLoad (loaded)))
+        {
+          loaded = static_cast<int32_t> (bwp);
+        }
+    }
+
+  if (best < 0 || loaded < 0 || best == loaded)
+    {
+      return;
+    }
+
+  double bestSpare = GetSpareCapacity (m_bwps[best]);
+  double loadedSpare = GetSpareCapacity (m_bwps[loaded]);
+  if (bestSpare <= loadedSpare * (1.0 + m_hysteresis))
+    {
+      return;
+    }
+
+  for (auto &a : m_qciAssignment)
+    {
+      if (a.second == loaded)
+        {
+          NS_LOG_INFO ("Moving QCI " << +a.first << " from BWP " << loaded <<
+                       " (load " << GetBwpLoad (loaded) << ", spare " << loadedSpare <<
+                       ") to BWP " << best << " (load " << GetBwpLoad (best) <<
+                       ", spare " << bestSpare << ")");
+          a.second = static_cast<uint8_t> (best);
+          NotifyMappingChanged ();
+          return;
+        }
+    }
+}
+
 } // namespace ns3
@@ -21,6 +21,9 @@
 
 #include <ns3/object.h>
 #include <ns3/eps-bearer.h>
+#include "sfnsf.h"
+#include <map>
+#include <vector>
 
 namespace ns3 {
 
@@ -29,8 +32,9 @@ namespace ns3 {
  * \brief Interface for a Bwp selection algorithm based on the bearer
  *
  *
- * At the moment, we provide only a static algorithm that has to be configured
- * before the simulation starts (BwpManagerAlgorithmStatic).
+ * We provide a static algorithm that has to be configured before the
+ * simulation starts (BwpManagerAlgorithmStatic), and a dynamic one that
+ * moves the QCIs away from the loaded BWPs (BwpManagerAlgorithmDynamic).
  *
  *
  * \section bwp_manager_conf Configuration
@@ -69,6 +73,33 @@ public:
    * \return the bwp id that the algorithm selects for the qci specified
    */
   virtual uint8_t GetBwpForEpsBearer (const EpsBearer::Qci &v) const = 0;
+  /**
+   * \brief Get the version of the QCI to BWP mapping
+   *
+   * The BWP managers cache the output of GetBwpForEpsBearer() for each
+   * logical channel; the cache is rebuilt when the version changes.
+   *
+   * \return a counter that is increased every time the mapping changes
+   */
+  uint32_t GetMappingVersion () const
+  {
+    return m_mappingVersion;
+  }
+
+protected:
+  /**
+   * \brief Invalidate the mapping cached by the BWP managers
+   *
+   * Algorithms must call it every time the output of GetBwpForEpsBearer()
+   * may have changed.
+   */
+  void NotifyMappingChanged ()
+  {
+    ++m_mappingVersion;
+  }
+
+private:
+  uint32_t m_mappingVersion {0}; //!< Version of the QCI to BWP mapping
 };
 
 /**
@@ -105,6 +136,7 @@ public:
   void SetConvVoiceBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::GBR_CONV_VOICE] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -121,6 +153,7 @@ public:
   void SetConvVideoBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::GBR_CONV_VIDEO] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -137,6 +170,7 @@ public:
   void SetGamingBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::GBR_GAMING] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -153,6 +187,7 @@ public:
   void SetNonConvVideoBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::GBR_NON_CONV_VIDEO] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -169,6 +204,7 @@ public:
   void SetMcPttBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::GBR_MC_PUSH_TO_TALK] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -185,6 +221,7 @@ public:
   void SetNmcPttBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::GBR_NMC_PUSH_TO_TALK] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -201,6 +238,7 @@ public:
   void SetMcVideoBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::GBR_MC_VIDEO] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -217,6 +255,7 @@ public:
   void SetGbrV2xBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::GBR_V2X] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -233,6 +272,7 @@ public:
   void SetImsBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::NGBR_IMS] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -249,6 +289,7 @@ public:
   void SetVideoTcpOpBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::NGBR_VIDEO_TCP_OPERATOR] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -265,6 +306,7 @@ public:
   void SetVideoGamingBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::NGBR_VOICE_VIDEO_GAMING] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -281,6 +323,7 @@ public:
   void SetVideoTcpPremiumBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::NGBR_VIDEO_TCP_PREMIUM] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -297,6 +340,7 @@ public:
   void SetVideoTcpDefaultBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::NGBR_VIDEO_TCP_DEFAULT] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -313,6 +357,7 @@ public:
   void SetMcDelaySignalBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::NGBR_MC_DELAY_SIGNAL] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -329,6 +374,7 @@ public:
   void SetMcDataBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::NGBR_MC_DATA] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -345,6 +391,7 @@ public:
   void SetNgbrV2xBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::NGBR_V2X] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -361,6 +408,7 @@ public:
   void SetLowLatEmbbBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::NGBR_LOW_LAT_EMBB] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -377,6 +425,7 @@ public:
   void SetDiscreteAutSmallBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::DGBR_DISCRETE_AUT_SMALL] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -393,6 +442,7 @@ public:
   void SetDiscreteAutLargeBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::DGBR_DISCRETE_AUT_LARGE] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -409,6 +459,7 @@ public:
   void SetItsBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::DGBR_ITS] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -425,6 +476,7 @@ public:
   void SetElectricityBwp (uint8_t bwpIndex)
   {
     m_qciToBwpMap[EpsBearer::DGBR_ELECTRICITY] = bwpIndex;
+    NotifyMappingChanged ();
   }
   /**
    * \brief Get the BWP index of the QCI in the function name
@@ -442,5 +494,123 @@ private:
   std::unordered_map <uint8_t, uint8_t> m_qciToBwpMap;
 };
 
+/**
+ * \ingroup bwp
+ * \brief A load-aware BWP manager algorithm
+ *
+ * The QCIs start in the BWP configured through the attributes of
+ * BwpManagerAlgorithmStatic. Then, every LoadWindow slots, the algorithm
+ * estimates the spare capacity of each BWP as the RBG x symbols left free by
+ * the scheduler in the last LoadWindow slots, weighted by the average
+ * wide-band CQI reported by the UEs in that BWP (CQI / 15). If the spare
+ * capacity of the best BWP is greater than the one of the most loaded BWP
+ * (plus the Hysteresis), one QCI of the most loaded BWP is moved to the
+ * best BWP. Only one QCI is moved at each evaluation, to avoid moving all
+ * the traffic back and forth.
+ *
+ * The input comes from the traces SlotLoad and DlWbCqi of NrMacSchedulerNs3.
+ * NrHelper connects them to the algorithm of the gNB, which uses the DL
+ * load, and to the algorithm of the UEs attached to the gNB, which use the
+ * UL load (see the attribute LoadDirection).
+ *
+ * Please note that the interface selects a BWP for a QCI, so all the bearers
+ * with the same QCI move together.
+ */
+class BwpManagerAlgorithmDynamic : public BwpManagerAlgorithmStatic
+{
+public:
+  /**
+   * \brief GetTypeId
+   * \return The TypeId of the object
+   */
+  static TypeId GetTypeId ();
+
+  /**
+   * \brief constructor
+   */
+  BwpManagerAlgorithmDynamic () = default;
+  /**
+    * \brief deconstructor
+    */
+  virtual ~BwpManagerAlgorithmDynamic () override = default;
+
+  // inherited
+  virtual uint8_t GetBwpForEpsBearer (const EpsBearer::Qci &v) const override;
+
+  /**
+   * \brief Report the load of a slot (sink of NrMacSchedulerNs3 SlotLoad)
+   * \param sfnSf the slot scheduled
+   * \param isDl true for a DL slot
+   * \param bwpId the BWP of the scheduler
+   * \param usedRbgSym RBG x symbols assigned to data
+   * \param availableRbgSym RBG x symbols available for data
+   */
+  void ReportSlotLoad (const SfnSf &sfnSf, bool isDl, uint16_t bwpId,
+                       uint32_t usedRbgSym, uint32_t availableRbgSym);
+
+  /**
+   * \brief Report a wide-band CQI (sink of NrMacSchedulerNs3 DlWbCqi)
+   * \param bwpId the BWP of the scheduler
+   * \param rnti the UE that reported the CQI
+   * \param cqi the wide-band CQI
+   */
+  void ReportDlWbCqi (uint16_t bwpId, uint16_t rnti, uint8_t cqi);
+
+  /**
+   * \brief Direction of the load reports used by the algorithm
+   */
+  enum LoadDirection
+  {
+    DL,  //!< Use the DL slots (gNB)
+    UL   //!< Use the UL slots (UE)
+  };
+
+  /**
+   * \brief Get the estimated load of a BWP
+   * \param bwpId the BWP
+   * \return the fraction of the available resources used in the last LoadWindow slots
+   */
+  double GetBwpLoad (uint16_t bwpId) const;
+
+private:
+  /**
+   * \brief Load and quality of a BWP
+   */
+  struct BwpState
+  {
+    std::vector<std::pair<uint32_t, uint32_t> > m_window; //!< (used, available) of the last slots
+    uint32_t m_next {0};        //!< Next position to overwrite in m_window
+    uint64_t m_used {0};        //!< Sum of the used resources in m_window
+    uint64_t m_available {0};   //!< Sum of the available resources in m_window
+    double m_cqi {-1.0};        //!< Average wide-band CQI (negative if never reported)
+  };
+
+  /**
+   * \brief Get the state of a BWP, creating it if needed
+   * \param bwpId the BWP
+   * \return the state of the BWP
+   */
+  BwpState & GetBwpState (uint16_t bwpId);
+
+  /**
+   * \brief Spare capacity of a BWP, in RBG x symbols per slot, weighted by the CQI
+   * \param state the state of the BWP
+   * \return the spare capacity of the BWP
+   */
+  static double GetSpareCapacity (const BwpState &state);
+
+  /**
+   * \brief Move, if convenient, one QCI from the most loaded BWP to the best one
+   */
+  void Rebalance ();
+
+  uint32_t m_loadWindow {20};      //!< Number of slots of the load estimation
+  double m_hysteresis {0.2};       //!< Relative capacity gain needed to move a QCI
+  LoadDirection m_direction {DL};  //!< Direction of the load reports used
+  std::vector<BwpState> m_bwps;    //!< State of each BWP, indexed by BWP id
+  uint32_t m_reportsSinceRebalance {0}; //!< Load reports received after the last Rebalance
+  mutable std::map<uint8_t, uint8_t> m_qciAssignment; //!< Current BWP of each QCI requested
+};
+
 } // namespace ns3
 #endif // BWPMANAGERALGORITHM_H
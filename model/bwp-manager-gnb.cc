@@ -64,6 +64,12 @@ BwpManagerGnb::SetBwpManagerAlgorithm (const Ptr<BwpManagerAlgorithm> &algorithm
   m_algorithm = algorithm;
 }
 
+Ptr<BwpManagerAlgorithm>
+BwpManagerGnb::GetBwpManagerAlgorithm () const
+{
+  return m_algorithm;
+}
+
 bool
 BwpManagerGnb::IsGbr (LteMacSapProvider::ReportBufferStatusParameters params)
 {
@@ -78,22 +84,88 @@ BwpManagerGnb::DoSetupDataRadioBearer (EpsBearer bearer, uint8_t bearerId, uint1
   NS_LOG_FUNCTION (this);
 
   std::vector<LteCcmRrcSapProvider::LcsConfig> lcsConfig = RrComponentCarrierManager::DoSetupDataRadioBearer (bearer, bearerId, rnti, lcid, lcGroup, msu);
+
+  // Resolve the route now, so the buffer status reports of this LC will
+  // only read the table
+  if (m_algorithm != nullptr)
+    {
+      auto it = m_lcRoutes.find (rnti);
+      if (it != m_lcRoutes.end () && lcid < it->second.size ())
+        {
+          it->second[lcid] = LcRoute (); // the LCID may have been used by a released bearer
+        }
+      GetLcRoute (rnti, lcid);
+    }
+
   return lcsConfig;
 }
 
-uint8_t
-BwpManagerGnb::GetBwpIndex (uint16_t rnti, uint8_t lcid)
+void
+BwpManagerGnb::DoRemoveUe (uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << rnti);
+  m_lcRoutes.erase (rnti);
+  RrComponentCarrierManager::DoRemoveUe (rnti);
+}
+
+bool
+BwpManagerGnb::IsLcRouteTableValid () const
+{
+  return m_lcRoutesAlgorithm == PeekPointer (m_algorithm)
+         && m_lcRoutesVersion == m_algorithm->GetMappingVersion ();
+}
+
+BwpManagerGnb::LcRoute
+BwpManagerGnb::ComputeLcRoute (uint16_t rnti, uint8_t lcid) const
 {
-  NS_LOG_FUNCTION (this);
-  NS_ASSERT (m_algorithm != nullptr);
   NS_ASSERT_MSG (m_ueInfo.find (rnti) != m_ueInfo.end (), "Unknown UE");
   NS_ASSERT_MSG (m_ueInfo.at (rnti).m_rlcLcInstantiated.find (lcid) != m_ueInfo.at (rnti).m_rlcLcInstantiated.end (), "Unknown logical channel of UE");
 
-  uint8_t qci = m_ueInfo[rnti].m_rlcLcInstantiated [lcid].qci;
+  uint8_t qci = m_ueInfo.at (rnti).m_rlcLcInstantiated.at (lcid).qci;
 
+  LcRoute route;
   // Force a conversion between the uint8_t type that comes from the LcInfo
   // struct (yeah, using the EpsBearer::Qci type was too hard ...)
-  return m_algorithm->GetBwpForEpsBearer (static_cast<EpsBearer::Qci> (qci));
+  route.m_bwpIndex = m_algorithm->GetBwpForEpsBearer (static_cast<EpsBearer::Qci> (qci));
+
+  auto it = m_macSapProvidersMap.find (route.m_bwpIndex);
+  if (it != m_macSapProvidersMap.end ())
+    {
+      route.m_macSap = it->second;
+    }
+  return route;
+}
+
+const BwpManagerGnb::LcRoute &
+BwpManagerGnb::GetLcRoute (uint16_t rnti, uint8_t lcid)
+{
+  if (! IsLcRouteTableValid ())
+    {
+      NS_LOG_INFO ("BWP mapping changed, flushing the routing table");
+      m_lcRoutes.clear ();
+      m_lcRoutesAlgorithm = PeekPointer (m_algorithm);
+      m_lcRoutesVersion = m_algorithm->GetMappingVersion ();
+    }
+
+  std::vector<LcRoute> &routes = m_lcRoutes[rnti];
+  if (routes.size () <= lcid)
+    {
+      routes.resize (lcid + 1);
+    }
+  if (routes[lcid].m_bwpIndex == UINT8_MAX)
+    {
+      routes[lcid] = ComputeLcRoute (rnti, lcid);
+    }
+  return routes[lcid];
+}
+
+uint8_t
+BwpManagerGnb::GetBwpIndex (uint16_t rnti, uint8_t lcid)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_algorithm != nullptr);
+
+  return GetLcRoute (rnti, lcid).m_bwpIndex;
 }
 
 uint8_t
@@ -102,14 +174,18 @@ BwpManagerGnb::PeekBwpIndex (uint16_t rnti, uint8_t lcid) const
   NS_LOG_FUNCTION (this);
   NS_ASSERT (m_algorithm != nullptr);
   // For the moment, Get and Peek are the same, but they'll change
-  NS_ASSERT_MSG (m_ueInfo.find (rnti) != m_ueInfo.end (), "Unknown UE");
-  NS_ASSERT_MSG (m_ueInfo.at (rnti).m_rlcLcInstantiated.find (lcid) != m_ueInfo.at (rnti).m_rlcLcInstantiated.end (), "Unknown logical channel of UE");
 
-  uint8_t qci = m_ueInfo.at(rnti).m_rlcLcInstantiated.at (lcid).qci;
+  if (IsLcRouteTableValid ())
+    {
+      auto it = m_lcRoutes.find (rnti);
+      if (it != m_lcRoutes.end () && lcid < it->second.size ()
+          && it->second[lcid].m_bwpIndex != UINT8_MAX)
+        {
+          return it->second[lcid].m_bwpIndex;
+        }
+    }
 
-  // Force a conversion between the uint8_t type that comes from the LcInfo
-  // struct (yeah, using the EpsBearer::Qci type was too hard ...)
-  return m_algorithm->GetBwpForEpsBearer (static_cast<EpsBearer::Qci> (qci));
+  return ComputeLcRoute (rnti, lcid).m_bwpIndex;
 }
 
 uint8_t
@@ -134,28 +210,29 @@ BwpManagerGnb::RouteOutgoingCtrlMsg (const Ptr<NrControlMessage> &msg,
   NS_LOG_INFO ("Msg type " << msg->GetMessageType () << " from bwp " <<
                +sourceBwpId << " that wants to go out from gnb");
 
-  if (m_outputLinks.empty ())
-    {
-      NS_LOG_INFO ("No linked BWP, routing outgoing msg to the source: " << +sourceBwpId);
-      return sourceBwpId;
-    }
-
-  auto it = m_outputLinks.find (sourceBwpId);
-  if (it == m_outputLinks.end ())
+  if (sourceBwpId >= m_outputLinks.size () || m_outputLinks[sourceBwpId] == UINT32_MAX)
     {
-      NS_LOG_INFO ("Source BWP not in the map, routing outgoing msg to itself: " << +sourceBwpId);
+      NS_LOG_INFO ("Source BWP not linked, routing outgoing msg to itself: " << +sourceBwpId);
       return sourceBwpId;
     }
 
-  NS_LOG_INFO ("routing outgoing msg to bwp: " << +it->second);
-  return it->second;
+  NS_LOG_INFO ("routing outgoing msg to bwp: " << m_outputLinks[sourceBwpId]);
+  return static_cast<uint8_t> (m_outputLinks[sourceBwpId]);
 }
 
 void
 BwpManagerGnb::SetOutputLink(uint32_t sourceBwp, uint32_t outputBwp)
 {
   NS_LOG_FUNCTION (this);
-  m_outputLinks.insert (std::make_pair (sourceBwp, outputBwp));
+  if (m_outputLinks.size () <= sourceBwp)
+    {
+      m_outputLinks.resize (sourceBwp + 1, UINT32_MAX);
+    }
+  // As before, the first link installed for a source BWP wins
+  if (m_outputLinks[sourceBwp] == UINT32_MAX)
+    {
+      m_outputLinks[sourceBwp] = outputBwp;
+    }
 }
 
 void
@@ -163,15 +240,17 @@ BwpManagerGnb::DoReportBufferStatus (LteMacSapProvider::ReportBufferStatusParame
 {
   NS_LOG_FUNCTION (this);
 
-  uint8_t bwpIndex = GetBwpIndex (params.rnti, params.lcid);
+  NS_ASSERT (m_algorithm != nullptr);
+
+  const LcRoute &route = GetLcRoute (params.rnti, params.lcid);
 
-  if (m_macSapProvidersMap.find (bwpIndex) != m_macSapProvidersMap.end ())
+  if (route.m_macSap != nullptr)
     {
-      m_macSapProvidersMap.find (bwpIndex)->second->ReportBufferStatus (params);
+      route.m_macSap->ReportBufferStatus (params);
     }
   else
     {
-      NS_ABORT_MSG ("Bwp index " << +bwpIndex << " not valid.");
+      NS_ABORT_MSG ("Bwp index " << +route.m_bwpIndex << " not valid.");
     }
 }
 
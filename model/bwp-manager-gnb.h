@@ -26,6 +26,7 @@
 #include <ns3/lte-rlc.h>
 #include <ns3/eps-bearer.h>
 #include <unordered_map>
+#include <vector>
 
 namespace ns3 {
 class UeManager;
@@ -50,11 +51,21 @@ public:
    */
   void SetBwpManagerAlgorithm (const Ptr<BwpManagerAlgorithm> &algorithm);
 
+  /**
+   * \brief Get the algorithm
+   * \return the pointer to the algorithm
+   */
+  Ptr<BwpManagerAlgorithm> GetBwpManagerAlgorithm () const;
+
   /**
    * \brief Get the bwp index for the RNTI and LCID
    * \param rnti The RNTI of the user
    * \param lcid The LCID of the flow that we want to know the bwp index
    * \return The index of the BWP in which that LCID should go
+   *
+   * The index is computed once, when the bearer is set up, and then read
+   * from a per-UE table indexed by LCID. The table is rebuilt when the
+   * algorithm reports a change of its mapping.
    */
   uint8_t GetBwpIndex (uint16_t rnti, uint8_t lcid);
 
@@ -137,15 +148,56 @@ protected:
    */
   virtual std::vector<LteCcmRrcSapProvider::LcsConfig> DoSetupDataRadioBearer (EpsBearer bearer, uint8_t bearerId, uint16_t rnti, uint8_t lcid, uint8_t lcGroup, LteMacSapUser* msu) override;
 
+  /**
+   * \brief Remove the UE, and its routing table
+   * \param rnti RNTI of the UE
+   */
+  virtual void DoRemoveUe (uint16_t rnti) override;
+
 private:
+  /**
+   * \brief Routing information of a logical channel
+   */
+  struct LcRoute
+  {
+    uint8_t m_bwpIndex {UINT8_MAX};         //!< BWP selected by the algorithm
+    LteMacSapProvider *m_macSap {nullptr};  //!< MAC of the BWP (nullptr if the index is not valid)
+  };
+
   /**
    * \brief Checks if the flow is is GBR.
    */
   bool IsGbr (LteMacSapProvider::ReportBufferStatusParameters params);
 
+  /**
+   * \brief Ask the algorithm the route of a logical channel
+   * \param rnti The RNTI of the user
+   * \param lcid The LCID of the flow
+   * \return the route for the LC
+   */
+  LcRoute ComputeLcRoute (uint16_t rnti, uint8_t lcid) const;
+
+  /**
+   * \brief Get the route of a logical channel, filling the table if needed
+   * \param rnti The RNTI of the user
+   * \param lcid The LCID of the flow
+   * \return the route stored in the table
+   */
+  const LcRoute & GetLcRoute (uint16_t rnti, uint8_t lcid);
+
+  /**
+   * \brief Check if the routing table is aligned with the algorithm mapping
+   * \return true if the entries of m_lcRoutes can be used
+   */
+  bool IsLcRouteTableValid () const;
+
   Ptr<BwpManagerAlgorithm> m_algorithm; //!< The BWP selection algorithm.
 
-  std::unordered_map <uint32_t, uint32_t> m_outputLinks; //!< Mapping between BWP.
+  std::unordered_map <uint16_t, std::vector<LcRoute>> m_lcRoutes; //!< Per-UE routes, indexed by LCID
+  const BwpManagerAlgorithm *m_lcRoutesAlgorithm {nullptr}; //!< Algorithm used to fill m_lcRoutes
+  uint32_t m_lcRoutesVersion {0}; //!< Mapping version used to fill m_lcRoutes
+
+  std::vector <uint32_t> m_outputLinks; //!< Mapping between BWP, indexed by the source BWP (UINT32_MAX if not linked)
 };
 
 } // end of namespace ns3
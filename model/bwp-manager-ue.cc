@@ -44,6 +44,12 @@ BwpManagerUe::SetBwpManagerAlgorithm(const Ptr<BwpManagerAlgorithm> &algorithm)
   m_algorithm = algorithm;
 }
 
+Ptr<BwpManagerAlgorithm>
+BwpManagerUe::GetBwpManagerAlgorithm () const
+{
+  return m_algorithm;
+}
+
 
 TypeId
 BwpManagerUe::GetTypeId ()
@@ -67,14 +73,42 @@ BwpManagerUe::DoReportBufferStatus (LteMacSapProvider::ReportBufferStatusParamet
   NS_LOG_FUNCTION (this);
   NS_ASSERT (m_algorithm != nullptr);
 
-  uint8_t bwpIndex = m_algorithm->GetBwpForEpsBearer (m_lcToBearerMap.at (params.lcid));
+  const LcRoute &route = GetLcRoute (params.lcid);
 
   NS_LOG_DEBUG ("BSR of size " << params.txQueueSize << " from RLC for LCID = " <<
-                static_cast<uint32_t> (params.lcid) << " traffic type " <<
-                m_lcToBearerMap.at (params.lcid) << " reported to CcId " <<
-                static_cast<uint32_t> (bwpIndex));
+                static_cast<uint32_t> (params.lcid) << " reported to CcId " <<
+                static_cast<uint32_t> (route.m_bwpIndex));
 
-  m_componentCarrierLcMap.at (bwpIndex).at (params.lcid)->ReportBufferStatus (params);
+  route.m_macSap->ReportBufferStatus (params);
+}
+
+const BwpManagerUe::LcRoute &
+BwpManagerUe::GetLcRoute (uint8_t lcid)
+{
+  if (m_lcRoutesAlgorithm != PeekPointer (m_algorithm)
+      || m_lcRoutesVersion != m_algorithm->GetMappingVersion ())
+    {
+      NS_LOG_INFO ("BWP mapping changed, flushing the routing table");
+      m_lcRoutes.clear ();
+      m_lcRoutesAlgorithm = PeekPointer (m_algorithm);
+      m_lcRoutesVersion = m_algorithm->GetMappingVersion ();
+    }
+
+  if (m_lcRoutes.size () <= lcid)
+    {
+      m_lcRoutes.resize (lcid + 1);
+    }
+
+  LcRoute &route = m_lcRoutes[lcid];
+  if (route.m_macSap == nullptr)
+    {
+      route.m_bwpIndex = m_algorithm->GetBwpForEpsBearer (m_lcToBearerMap.at (lcid));
+      route.m_macSap = m_componentCarrierLcMap.at (route.m_bwpIndex).at (lcid);
+      NS_LOG_INFO ("LCID " << static_cast<uint32_t> (lcid) << " traffic type " <<
+                   m_lcToBearerMap.at (lcid) << " routed to CcId " <<
+                   static_cast<uint32_t> (route.m_bwpIndex));
+    }
+  return route;
 }
 
 std::vector<LteUeCcmRrcSapProvider::LcsConfig>
@@ -89,7 +123,20 @@ BwpManagerUe::DoAddLc (uint8_t lcId, LteUeCmacSapProvider::LogicalChannelConfig
   // see lte-enb-rrc.cc:453
   m_lcToBearerMap.insert (std::make_pair (lcId, static_cast<EpsBearer::Qci> (lcConfig.priority)));
 
-  return SimpleUeComponentCarrierManager::DoAddLc (lcId, lcConfig, msu);
+  std::vector<LteUeCcmRrcSapProvider::LcsConfig> lcsConfig = SimpleUeComponentCarrierManager::DoAddLc (lcId, lcConfig, msu);
+
+  // Resolve the route now, so the buffer status reports of this LC will
+  // only read the table
+  if (m_algorithm != nullptr)
+    {
+      if (lcId < m_lcRoutes.size ())
+        {
+          m_lcRoutes[lcId] = LcRoute ();
+        }
+      GetLcRoute (lcId);
+    }
+
+  return lcsConfig;
 }
 
 LteMacSapUser
@@ -115,7 +162,15 @@ void
 BwpManagerUe::SetOutputLink(uint32_t sourceBwp, uint32_t outputBwp)
 {
   NS_LOG_FUNCTION (this);
-  m_outputLinks.insert (std::make_pair (sourceBwp, outputBwp));
+  if (m_outputLinks.size () <= sourceBwp)
+    {
+      m_outputLinks.resize (sourceBwp + 1, UINT32_MAX);
+    }
+  // As before, the first link installed for a source BWP wins
+  if (m_outputLinks[sourceBwp] == UINT32_MAX)
+    {
+      m_outputLinks[sourceBwp] = outputBwp;
+    }
 }
 
 uint8_t
@@ -125,21 +180,14 @@ BwpManagerUe::RouteOutgoingCtrlMsg (const Ptr<NrControlMessage> &msg, uint8_t so
 
   NS_LOG_INFO ("Msg type " << msg->GetMessageType () << " that wants to go out from UE");
 
-  if (m_outputLinks.empty ())
-    {
-      NS_LOG_INFO ("No linked BWP, routing outgoing msg to the source: " << +sourceBwpId);
-      return sourceBwpId;
-    }
-
-  auto it = m_outputLinks.find (sourceBwpId);
-  if (it == m_outputLinks.end ())
+  if (sourceBwpId >= m_outputLinks.size () || m_outputLinks[sourceBwpId] == UINT32_MAX)
     {
-      NS_LOG_INFO ("Source BWP not in the map, routing outgoing msg to itself: " << +sourceBwpId);
+      NS_LOG_INFO ("Source BWP not linked, routing outgoing msg to itself: " << +sourceBwpId);
       return sourceBwpId;
     }
 
-  NS_LOG_INFO ("routing outgoing msg to bwp: " << +it->second);
-  return it->second;
+  NS_LOG_INFO ("routing outgoing msg to bwp: " << m_outputLinks[sourceBwpId]);
+  return static_cast<uint8_t> (m_outputLinks[sourceBwpId]);
 }
 
 uint8_t
@@ -21,6 +21,7 @@
 
 #include <ns3/simple-ue-component-carrier-manager.h>
 #include <ns3/nr-phy-mac-common.h>
+#include <vector>
 
 namespace ns3 {
 
@@ -55,6 +56,12 @@ public:
    */
   void SetBwpManagerAlgorithm (const Ptr<BwpManagerAlgorithm> &algorithm);
 
+  /**
+   * \brief Get the algorithm
+   * \return the pointer to the algorithm
+   */
+  Ptr<BwpManagerAlgorithm> GetBwpManagerAlgorithm () const;
+
   /**
    * \brief The UE received a HARQ feedback from spectrum. Where this feedback
    * should be forwarded?
@@ -106,10 +113,30 @@ protected:
   virtual LteMacSapUser* DoConfigureSignalBearer (uint8_t lcId,  LteUeCmacSapProvider::LogicalChannelConfig lcConfig, LteMacSapUser* msu) override;
 
 private:
+  /**
+   * \brief Routing information of a logical channel
+   */
+  struct LcRoute
+  {
+    uint8_t m_bwpIndex {UINT8_MAX};         //!< BWP selected by the algorithm
+    LteMacSapProvider *m_macSap {nullptr};  //!< MAC of the BWP
+  };
+
+  /**
+   * \brief Get the route of a logical channel, filling the table if needed
+   * \param lcid The LCID of the flow
+   * \return the route stored in the table
+   */
+  const LcRoute & GetLcRoute (uint8_t lcid);
+
   Ptr<BwpManagerAlgorithm> m_algorithm;
   std::unordered_map<uint8_t, EpsBearer::Qci> m_lcToBearerMap; //!< Map from LCID to bearer ID
 
-  std::unordered_map <uint32_t, uint32_t> m_outputLinks; //!< Mapping between BWP.
+  std::vector<LcRoute> m_lcRoutes; //!< Routes, indexed by LCID
+  const BwpManagerAlgorithm *m_lcRoutesAlgorithm {nullptr}; //!< Algorithm used to fill m_lcRoutes
+  uint32_t m_lcRoutesVersion {0}; //!< Mapping version used to fill m_lcRoutes
+
+  std::vector <uint32_t> m_outputLinks; //!< Mapping between BWP, indexed by the source BWP (UINT32_MAX if not linked)
 };
 
 } // namespace ns3
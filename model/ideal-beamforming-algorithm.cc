@@ -21,6 +21,7 @@
 #include <ns3/double.h>
 #include <ns3/angles.h>
 #include <ns3/uinteger.h>
+#include <ns3/string.h>
 #include <ns3/mobility-module.h>
 #include <ns3/node.h>
 #include <ns3/multi-model-spectrum-channel.h>
@@ -28,16 +29,20 @@
 #include "beam-manager.h"
 #include <ns3/nr-spectrum-value-helper.h>
 #include <ns3/uniform-planar-array.h>
+#include <ns3/three-gpp-spectrum-propagation-loss-model.h>
 #include "nr-ue-phy.h"
 #include "nr-gnb-phy.h"
 #include "nr-gnb-net-device.h"
 #include "nr-ue-net-device.h"
+#include <algorithm>
 
 namespace ns3{
 
 NS_LOG_COMPONENT_DEFINE ("IdealBeamformingAlgorithm");
 NS_OBJECT_ENSURE_REGISTERED (CellScanBeamforming);
+NS_OBJECT_ENSURE_REGISTERED (CodebookBeamforming);
 NS_OBJECT_ENSURE_REGISTERED (CellScanBeamformingAzimuthZenith);
+NS_OBJECT_ENSURE_REGISTERED (HierarchicalCellScanBeamforming);
 NS_OBJECT_ENSURE_REGISTERED (DirectPathBeamforming);
 NS_OBJECT_ENSURE_REGISTERED (QuasiOmniDirectPathBeamforming);
 NS_OBJECT_ENSURE_REGISTERED (OptimalCovMatrixBeamforming);
@@ -72,6 +77,150 @@ void
 CellScanBeamforming::SetBeamSearchAngleStep (double beamSearchAngleStep)
 {
   m_beamSearchAngleStep = beamSearchAngleStep;
+  m_codebooks.clear ();
+}
+
+void
+CellScanBeamforming::DoDispose ()
+{
+  m_codebooks.clear ();
+  IdealBeamformingAlgorithm::DoDispose ();
+}
+
+const NrBeamCodebook &
+CellScanBeamforming::GetCodebook (const Ptr<const UniformPlanarArray> &antenna, bool isGnb) const
+{
+  UintegerValue uintValue;
+  antenna->GetAttribute ("NumRows", uintValue);
+  uint32_t numRows = static_cast<uint32_t> (uintValue.Get ());
+
+  // The vectors only depend on the number of rows and on the element locations
+  std::vector<double> key {isGnb ? 1.0 : 0.0, static_cast<double> (numRows)};
+  for (uint64_t i = 0; i < antenna->GetNumberOfElements (); ++i)
+    {
+      Vector loc = antenna->GetElementLocation (i);
+      key.insert (key.end (), {loc.x, loc.y, loc.z});
+    }
+
+  auto it = m_codebooks.find (key);
+  if (it != m_codebooks.end ())
+    {
+      return *it->second;
+    }
+
+  // Same beams, in the same order, as the sweep of GetBeamformingVectors
+  std::vector<complexVector_t> bfvs;
+  std::vector<BeamId> beamIds;
+  for (double theta = 60; theta < 121;
+       theta = isGnb ? theta + m_beamSearchAngleStep : static_cast<uint16_t> (theta + m_beamSearchAngleStep))
+    {
+      for (uint16_t sector = 0; sector <= numRows; sector++)
+        {
+          bfvs.push_back (CreateDirectionalBfv (antenna, sector, theta));
+          beamIds.push_back (BeamId (sector, theta));
+        }
+    }
+  NS_LOG_LOGIC ("Built a codebook of " << bfvs.size () << " beams for " <<
+                antenna->GetNumberOfElements () << " elements");
+  std::unique_ptr<NrBeamCodebook> &codebook = m_codebooks[key];
+  codebook = std::make_unique<NrBeamCodebook> (std::move (bfvs), std::move (beamIds));
+  return *codebook;
+}
+
+BeamformingVectorPair
+CellScanBeamforming::SearchCodebooks (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                      const Ptr<NrSpectrumPhy>& ueSpectrumPhy,
+                                      Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel) const
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<const UniformPlanarArray> gnbAntenna = gnbSpectrumPhy->GetAntenna ()->GetObject <UniformPlanarArray> ();
+  Ptr<const UniformPlanarArray> ueAntenna = ueSpectrumPhy->GetAntenna ()->GetObject <UniformPlanarArray> ();
+  const NrBeamCodebook &txCodebook = GetCodebook (gnbAntenna, true);
+  const NrBeamCodebook &rxCodebook = GetCodebook (ueAntenna, false);
+
+  // H[u][s][c]: gNB on the s side, unless the matrix was generated the other way
+  const MatrixBasedChannelModel::Complex3DVector &h = channel->m_channel;
+  bool gnbIsS = !channel->IsReverse (gnbAntenna->GetId (), ueAntenna->GetId ());
+  size_t uSize = h.size ();
+  size_t sSize = h.at (0).size ();
+  size_t numClusters = h.at (0).at (0).size ();
+  size_t txSize = gnbIsS ? sSize : uSize;
+  size_t rxSize = gnbIsS ? uSize : sSize;
+  NS_ASSERT (txCodebook.GetVector (0).size () == txSize && rxCodebook.GetVector (0).size () == rxSize);
+
+  // The channel as a (tx element, rx element x cluster) matrix
+  complexVector_t hTx (txSize * rxSize * numClusters);
+  for (size_t u = 0; u < uSize; ++u)
+    {
+      for (size_t s = 0; s < sSize; ++s)
+        {
+          size_t tx = gnbIsS ? s : u;
+          size_t rx = gnbIsS ? u : s;
+          std::copy (h[u][s].begin (), h[u][s].end (), hTx.begin () + (tx * rxSize + rx) * numClusters);
+        }
+    }
+
+  // Project the channel on all the tx beams: (tx beam, rx element x cluster)
+  size_t numTxBeams = txCodebook.GetNumBeams ();
+  size_t numRxBeams = rxCodebook.GetNumBeams ();
+  size_t rowSize = rxSize * numClusters;
+  complexVector_t projected (numTxBeams * rowSize, std::complex<double> (0, 0));
+  for (size_t t = 0; t < numTxBeams; ++t)
+    {
+      const complexVector_t &txW = txCodebook.GetVector (t);
+      std::complex<double> *out = &projected[t * rowSize];
+      for (size_t tx = 0; tx < txSize; ++tx)
+        {
+          const std::complex<double> *in = &hTx[tx * rowSize];
+          for (size_t i = 0; i < rowSize; ++i)
+            {
+              out[i] += txW[tx] * in[i];
+            }
+        }
+    }
+
+  // Project on all the rx beams, and keep the first beam pair with the
+  // highest long term gain
+  double max = 0;
+  size_t maxTx = 0, maxRx = 0;
+  complexVector_t longTerm (numClusters);
+  for (size_t t = 0; t < numTxBeams; ++t)
+    {
+      for (size_t r = 0; r < numRxBeams; ++r)
+        {
+          const complexVector_t &rxW = rxCodebook.GetVector (r);
+          std::fill (longTerm.begin (), longTerm.end (), std::complex<double> (0, 0));
+          for (size_t rx = 0; rx < rxSize; ++rx)
+            {
+              const std::complex<double> *in = &projected[t * rowSize + rx * numClusters];
+              for (size_t c = 0; c < numClusters; ++c)
+                {
+                  longTerm[c] += rxW[rx] * in[c];
+                }
+            }
+          double gain = 0;
+          for (size_t c = 0; c < numClusters; ++c)
+            {
+              gain += std::norm (longTerm[c]);
+            }
+          if (max < gain)
+            {
+              max = gain;
+              maxTx = t;
+              maxRx = r;
+            }
+        }
+    }
+
+  NS_LOG_DEBUG ("Beamforming vectors for gNB with node id: "<< gnbSpectrumPhy->GetMobility()->GetObject<Node>()->GetId () <<
+                " and UE with node id: " << ueSpectrumPhy->GetMobility()->GetObject<Node>()->GetId () <<
+                " are tx " << txCodebook.GetBeamId (maxTx) << " rx " << rxCodebook.GetBeamId (maxRx) <<
+                " with long term gain " << max);
+
+  BeamformingVector gnbBfv = BeamformingVector (std::make_pair (txCodebook.GetVector (maxTx), txCodebook.GetBeamId (maxTx)));
+  BeamformingVector ueBfv = BeamformingVector (std::make_pair (rxCodebook.GetVector (maxRx), rxCodebook.GetBeamId (maxRx)));
+  return BeamformingVectorPair (std::make_pair (gnbBfv, ueBfv));
 }
 
 double
@@ -95,6 +244,18 @@ CellScanBeamforming::GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpectru
   Ptr<const PhasedArraySpectrumPropagationLossModel> ueThreeGppSpectrumPropModel = ueSpectrumChannel->GetPhasedArraySpectrumPropagationLossModel ();
   NS_ASSERT_MSG (gnbThreeGppSpectrumPropModel == ueThreeGppSpectrumPropModel, "Devices should be connected on the same spectrum channel");
 
+  Ptr<ThreeGppSpectrumPropagationLossModel> threeGppSplm =
+    DynamicCast<ThreeGppSpectrumPropagationLossModel> (gnbSpectrumChannel->GetPhasedArraySpectrumPropagationLossModel ());
+  if (threeGppSplm != nullptr)
+    {
+      Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel =
+        threeGppSplm->GetChannelModel ()->GetChannel (gnbSpectrumPhy->GetMobility (),
+                                                     ueSpectrumPhy->GetMobility (),
+                                                     gnbSpectrumPhy->GetAntenna ()->GetObject <PhasedArrayModel> (),
+                                                     ueSpectrumPhy->GetAntenna ()->GetObject <PhasedArrayModel> ());
+      return SearchCodebooks (gnbSpectrumPhy, ueSpectrumPhy, channel);
+    }
+
   std::vector<int> activeRbs;
   for (size_t rbId = 0; rbId < gnbSpectrumPhy->GetRxSpectrumModel ()->GetNumBands(); rbId++)
     {
@@ -188,6 +349,82 @@ CellScanBeamforming::GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpectru
   return BeamformingVectorPair (std::make_pair (gnbBfv, ueBfv));
 }
 
+TypeId
+CodebookBeamforming::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CodebookBeamforming")
+                     .SetParent<CellScanBeamforming> ()
+                     .AddConstructor<CodebookBeamforming> ()
+                     .AddAttribute ("GnbCodebookFile",
+                                    "File of the codebook of the gNB antennas; if empty, the DFT codebook",
+                                    StringValue (""),
+                                    MakeStringAccessor (&CodebookBeamforming::m_gnbCodebookFile),
+                                    MakeStringChecker ())
+                     .AddAttribute ("UeCodebookFile",
+                                    "File of the codebook of the UE antennas; if empty, the DFT codebook",
+                                    StringValue (""),
+                                    MakeStringAccessor (&CodebookBeamforming::m_ueCodebookFile),
+                                    MakeStringChecker ())
+                     .AddAttribute ("OversamplingH",
+                                    "Oversampling factor of the DFT codebook along the antenna columns",
+                                    UintegerValue (1),
+                                    MakeUintegerAccessor (&CodebookBeamforming::m_oversamplingH),
+                                    MakeUintegerChecker<uint32_t> (1))
+                     .AddAttribute ("OversamplingV",
+                                    "Oversampling factor of the DFT codebook along the antenna rows",
+                                    UintegerValue (1),
+                                    MakeUintegerAccessor (&CodebookBeamforming::m_oversamplingV),
+                                    MakeUintegerChecker<uint32_t> (1));
+
+  return tid;
+}
+
+std::shared_ptr<const NrBeamCodebook>
+CodebookBeamforming::GetSharedCodebook (const Ptr<const UniformPlanarArray> &antenna, bool isGnb) const
+{
+  const std::string &fileName = isGnb ? m_gnbCodebookFile : m_ueCodebookFile;
+  if (fileName.empty ())
+    {
+      return NrBeamCodebook::GetDft (antenna, m_oversamplingH, m_oversamplingV);
+    }
+  return NrBeamCodebook::Load (fileName, antenna->GetNumberOfElements ());
+}
+
+const NrBeamCodebook &
+CodebookBeamforming::GetCodebook (const Ptr<const UniformPlanarArray> &antenna, bool isGnb) const
+{
+  // The registry of NrBeamCodebook keeps the codebook alive
+  return *GetSharedCodebook (antenna, isGnb);
+}
+
+BeamformingVectorPair
+CodebookBeamforming::GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                            const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (gnbSpectrumPhy == nullptr || ueSpectrumPhy == nullptr,
+                   "Something went wrong, gnb or UE PHY layer not set.");
+
+  Ptr<SpectrumChannel> gnbSpectrumChannel = gnbSpectrumPhy->GetSpectrumChannel ();
+  Ptr<ThreeGppSpectrumPropagationLossModel> threeGppSplm =
+    DynamicCast<ThreeGppSpectrumPropagationLossModel> (gnbSpectrumChannel->GetPhasedArraySpectrumPropagationLossModel ());
+  NS_ABORT_MSG_IF (threeGppSplm == nullptr,
+                   "CodebookBeamforming needs a ThreeGppSpectrumPropagationLossModel");
+
+  Ptr<const UniformPlanarArray> gnbAntenna = gnbSpectrumPhy->GetAntenna ()->GetObject <UniformPlanarArray> ();
+  Ptr<const UniformPlanarArray> ueAntenna = ueSpectrumPhy->GetAntenna ()->GetObject <UniformPlanarArray> ();
+
+  // Let the beam managers store the beams by index
+  gnbSpectrumPhy->GetBeamManager ()->SetBeamCodebook (GetSharedCodebook (gnbAntenna, true));
+  ueSpectrumPhy->GetBeamManager ()->SetBeamCodebook (GetSharedCodebook (ueAntenna, false));
+
+  Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel =
+    threeGppSplm->GetChannelModel ()->GetChannel (gnbSpectrumPhy->GetMobility (),
+                                                 ueSpectrumPhy->GetMobility (),
+                                                 gnbAntenna, ueAntenna);
+  return SearchCodebooks (gnbSpectrumPhy, ueSpectrumPhy, channel);
+}
+
 TypeId
 CellScanBeamformingAzimuthZenith::GetTypeId (void)
 {
@@ -310,6 +547,328 @@ CellScanBeamformingAzimuthZenith::GetBeamformingVectors (const Ptr<NrSpectrumPhy
   return BeamformingVectorPair (std::make_pair (gnbBfv, ueBfv));
 }
 
+TypeId
+HierarchicalCellScanBeamforming::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::HierarchicalCellScanBeamforming")
+                     .SetParent<IdealBeamformingAlgorithm> ()
+                     .AddConstructor<HierarchicalCellScanBeamforming> ()
+                     .AddAttribute ("CoarseAngleStep",
+                                    "Angle step, in degrees, of the coarse search over all the beam pairs",
+                                    DoubleValue (30),
+                                    MakeDoubleAccessor (&HierarchicalCellScanBeamforming::SetCoarseAngleStep,
+                                                        &HierarchicalCellScanBeamforming::GetCoarseAngleStep),
+                                    MakeDoubleChecker<double> (1.0))
+                     .AddAttribute ("FineAngleStep",
+                                    "Angle step, in degrees, of the refinement around the coarse candidates",
+                                    DoubleValue (5),
+                                    MakeDoubleAccessor (&HierarchicalCellScanBeamforming::SetFineAngleStep,
+                                                        &HierarchicalCellScanBeamforming::GetFineAngleStep),
+                                    MakeDoubleChecker<double> (0.1))
+                     .AddAttribute ("NumCandidates",
+                                    "Number of the best coarse beam pairs that are refined",
+                                    UintegerValue (2),
+                                    MakeUintegerAccessor (&HierarchicalCellScanBeamforming::m_numCandidates),
+                                    MakeUintegerChecker<uint32_t> (1));
+
+  return tid;
+}
+
+void
+HierarchicalCellScanBeamforming::SetCoarseAngleStep (double step)
+{
+  m_coarseAngleStep = step;
+}
+
+double
+HierarchicalCellScanBeamforming::GetCoarseAngleStep () const
+{
+  return m_coarseAngleStep;
+}
+
+void
+HierarchicalCellScanBeamforming::SetFineAngleStep (double step)
+{
+  m_fineAngleStep = step;
+}
+
+double
+HierarchicalCellScanBeamforming::GetFineAngleStep () const
+{
+  return m_fineAngleStep;
+}
+
+void
+HierarchicalCellScanBeamforming::DoDispose ()
+{
+  m_codebooks.clear ();
+  IdealBeamformingAlgorithm::DoDispose ();
+}
+
+const HierarchicalCellScanBeamforming::Codebook &
+HierarchicalCellScanBeamforming::GetCodebook (const Ptr<const UniformPlanarArray> &antenna, double step) const
+{
+  // The vectors only depend on the element locations
+  std::vector<double> key {step};
+  for (uint64_t i = 0; i < antenna->GetNumberOfElements (); ++i)
+    {
+      Vector loc = antenna->GetElementLocation (i);
+      key.insert (key.end (), {loc.x, loc.y, loc.z});
+    }
+
+  auto it = m_codebooks.find (key);
+  if (it != m_codebooks.end ())
+    {
+      return it->second;
+    }
+
+  Codebook &codebook = m_codebooks[key];
+  for (double azimuth = -90; azimuth < 90 + step / 2; azimuth += step)
+    {
+      codebook.m_azimuths.push_back (std::min (azimuth, 90.0));
+    }
+  for (double zenith = 60; zenith < 120 + step / 2; zenith += step)
+    {
+      codebook.m_zeniths.push_back (std::min (zenith, 120.0));
+    }
+  for (double azimuth : codebook.m_azimuths)
+    {
+      for (double zenith : codebook.m_zeniths)
+        {
+          codebook.m_bfvs.push_back (CreateDirectionalBfvAz (antenna, azimuth, zenith));
+        }
+    }
+  NS_LOG_LOGIC ("Built a codebook of " << codebook.m_bfvs.size () << " beams with step " <<
+                step << " for " << antenna->GetNumberOfElements () << " elements");
+  return codebook;
+}
+
+/**
+ * \brief Project a (tx element, rx element x cluster) channel on a beam of one side
+ * \param hTx the channel
+ * \param txSize the number of tx elements
+ * \param rxSize the number of rx elements
+ * \param numClusters the number of clusters
+ * \param w the beamforming vector
+ * \param onTx true if w is a tx beam, false if it is a rx beam
+ * \return the channel seen through the beam, as (element of the other side x cluster)
+ */
+static complexVector_t
+ProjectChannel (const complexVector_t &hTx, size_t txSize, size_t rxSize, size_t numClusters,
+                const complexVector_t &w, bool onTx)
+{
+  complexVector_t out ((onTx ? rxSize : txSize) * numClusters, std::complex<double> (0, 0));
+  for (size_t tx = 0; tx < txSize; ++tx)
+    {
+      for (size_t rx = 0; rx < rxSize; ++rx)
+        {
+          const std::complex<double> *in = &hTx[(tx * rxSize + rx) * numClusters];
+          std::complex<double> weight = onTx ? w[tx] : w[rx];
+          std::complex<double> *o = &out[(onTx ? rx : tx) * numClusters];
+          for (size_t c = 0; c < numClusters; ++c)
+            {
+              o[c] += weight * in[c];
+            }
+        }
+    }
+  return out;
+}
+
+/**
+ * \brief Long term gain of a beam on a channel projected on the beam of the other side
+ * \param projected the projected channel, as (element x cluster)
+ * \param numClusters the number of clusters
+ * \param w the beamforming vector
+ * \return the sum over the clusters of the squared gain
+ */
+static double
+ProjectedGain (const complexVector_t &projected, size_t numClusters, const complexVector_t &w)
+{
+  double gain = 0;
+  for (size_t c = 0; c < numClusters; ++c)
+    {
+      std::complex<double> sum (0, 0);
+      for (size_t e = 0; e < w.size (); ++e)
+        {
+          sum += w[e] * projected[e * numClusters + c];
+        }
+      gain += std::norm (sum);
+    }
+  return gain;
+}
+
+/**
+ * \brief Indices of the values of a regular grid within a distance of a center
+ * \param values the values of the grid, increasing
+ * \param center the center
+ * \param half the distance
+ * \return the first and one past the last index
+ */
+static std::pair<size_t, size_t>
+GridWindow (const std::vector<double> &values, double center, double half)
+{
+  auto first = std::lower_bound (values.begin (), values.end (), center - half);
+  auto last = std::upper_bound (values.begin (), values.end (), center + half);
+  return std::make_pair (static_cast<size_t> (first - values.begin ()),
+                         static_cast<size_t> (last - values.begin ()));
+}
+
+BeamformingVectorPair
+HierarchicalCellScanBeamforming::GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                                        const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (gnbSpectrumPhy == nullptr || ueSpectrumPhy == nullptr,
+                   "Something went wrong, gnb or UE PHY layer not set.");
+  double distance = gnbSpectrumPhy->GetMobility ()->GetDistanceFrom (ueSpectrumPhy->GetMobility ());
+  NS_ABORT_MSG_IF (distance == 0, "Beamforming method cannot be performed between "
+                                  "two devices that are placed in the same position.");
+
+  Ptr<SpectrumChannel> gnbSpectrumChannel = gnbSpectrumPhy->GetSpectrumChannel (); // SpectrumChannel should be const.. but need to change ns-3-dev
+  Ptr<ThreeGppSpectrumPropagationLossModel> threeGppSplm =
+    DynamicCast<ThreeGppSpectrumPropagationLossModel> (gnbSpectrumChannel->GetPhasedArraySpectrumPropagationLossModel ());
+  NS_ABORT_MSG_IF (threeGppSplm == nullptr,
+                   "HierarchicalCellScanBeamforming needs a ThreeGppSpectrumPropagationLossModel");
+
+  Ptr<const UniformPlanarArray> gnbAntenna = gnbSpectrumPhy->GetAntenna ()->GetObject <UniformPlanarArray> ();
+  Ptr<const UniformPlanarArray> ueAntenna = ueSpectrumPhy->GetAntenna ()->GetObject <UniformPlanarArray> ();
+  NS_ASSERT (gnbAntenna->GetNumberOfElements () && ueAntenna->GetNumberOfElements ());
+
+  Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel =
+    threeGppSplm->GetChannelModel ()->GetChannel (gnbSpectrumPhy->GetMobility (),
+                                                 ueSpectrumPhy->GetMobility (),
+                                                 gnbAntenna, ueAntenna);
+
+  // The channel as a (tx element, rx element x cluster) matrix, as in
+  // CellScanBeamforming::SearchCodebooks
+  const MatrixBasedChannelModel::Complex3DVector &h = channel->m_channel;
+  bool gnbIsS = !channel->IsReverse (gnbAntenna->GetId (), ueAntenna->GetId ());
+  size_t uSize = h.size ();
+  size_t sSize = h.at (0).size ();
+  size_t numClusters = h.at (0).at (0).size ();
+  size_t txSize = gnbIsS ? sSize : uSize;
+  size_t rxSize = gnbIsS ? uSize : sSize;
+  complexVector_t hTx (txSize * rxSize * numClusters);
+  for (size_t u = 0; u < uSize; ++u)
+    {
+      for (size_t s = 0; s < sSize; ++s)
+        {
+          size_t tx = gnbIsS ? s : u;
+          size_t rx = gnbIsS ? u : s;
+          std::copy (h[u][s].begin (), h[u][s].end (), hTx.begin () + (tx * rxSize + rx) * numClusters);
+        }
+    }
+
+  const Codebook &txCoarse = GetCodebook (gnbAntenna, m_coarseAngleStep);
+  const Codebook &rxCoarse = GetCodebook (ueAntenna, m_coarseAngleStep);
+  const Codebook &txFine = GetCodebook (gnbAntenna, m_fineAngleStep);
+  const Codebook &rxFine = GetCodebook (ueAntenna, m_fineAngleStep);
+  NS_ASSERT (txCoarse.m_bfvs.at (0).size () == txSize && rxCoarse.m_bfvs.at (0).size () == rxSize);
+
+  // Coarse stage: all the pairs, keeping the best candidates
+  struct Candidate
+  {
+    double m_gain;  //!< Long term gain of the pair
+    size_t m_tx;    //!< Index of the tx beam
+    size_t m_rx;    //!< Index of the rx beam
+  };
+  std::vector<Candidate> candidates;
+  candidates.reserve (txCoarse.m_bfvs.size () * rxCoarse.m_bfvs.size ());
+  for (size_t t = 0; t < txCoarse.m_bfvs.size (); ++t)
+    {
+      complexVector_t projected = ProjectChannel (hTx, txSize, rxSize, numClusters, txCoarse.m_bfvs[t], true);
+      for (size_t r = 0; r < rxCoarse.m_bfvs.size (); ++r)
+        {
+          candidates.push_back ({ProjectedGain (projected, numClusters, rxCoarse.m_bfvs[r]), t, r});
+        }
+    }
+  size_t numCandidates = std::min<size_t> (m_numCandidates, candidates.size ());
+  std::partial_sort (candidates.begin (), candidates.begin () + numCandidates, candidates.end (),
+                     [] (const Candidate &a, const Candidate &b) { return a.m_gain > b.m_gain; });
+
+  // Refine the gNB beam of each candidate with its UE beam, then the UE beam
+  // with the refined gNB beam; the coarse pair is kept if it is still better
+  double half = m_coarseAngleStep / 2;
+  double max = candidates.front ().m_gain;
+  BeamformingVector gnbBfv (txCoarse.m_bfvs[candidates.front ().m_tx],
+                            BeamId (static_cast<uint16_t> (txCoarse.m_azimuths[candidates.front ().m_tx / txCoarse.m_zeniths.size ()]),
+                                    txCoarse.m_zeniths[candidates.front ().m_tx % txCoarse.m_zeniths.size ()]));
+  BeamformingVector ueBfv (rxCoarse.m_bfvs[candidates.front ().m_rx],
+                           BeamId (static_cast<uint16_t> (rxCoarse.m_azimuths[candidates.front ().m_rx / rxCoarse.m_zeniths.size ()]),
+                                   rxCoarse.m_zeniths[candidates.front ().m_rx % rxCoarse.m_zeniths.size ()]));
+  for (size_t k = 0; k < numCandidates; ++k)
+    {
+      const Candidate &candidate = candidates[k];
+      double txAzimuth = txCoarse.m_azimuths[candidate.m_tx / txCoarse.m_zeniths.size ()];
+      double txZenith = txCoarse.m_zeniths[candidate.m_tx % txCoarse.m_zeniths.size ()];
+      double rxAzimuth = rxCoarse.m_azimuths[candidate.m_rx / rxCoarse.m_zeniths.size ()];
+      double rxZenith = rxCoarse.m_zeniths[candidate.m_rx % rxCoarse.m_zeniths.size ()];
+
+      complexVector_t throughRx = ProjectChannel (hTx, txSize, rxSize, numClusters, rxCoarse.m_bfvs[candidate.m_rx], false);
+      auto azimuths = GridWindow (txFine.m_azimuths, txAzimuth, half);
+      auto zeniths = GridWindow (txFine.m_zeniths, txZenith, half);
+      double txMax = -1;
+      size_t bestTx = 0;
+      for (size_t a = azimuths.first; a < azimuths.second; ++a)
+        {
+          for (size_t z = zeniths.first; z < zeniths.second; ++z)
+            {
+              size_t t = a * txFine.m_zeniths.size () + z;
+              double gain = ProjectedGain (throughRx, numClusters, txFine.m_bfvs[t]);
+              if (txMax < gain)
+                {
+                  txMax = gain;
+                  bestTx = t;
+                }
+            }
+        }
+      if (txMax < 0)
+        {
+          continue;
+        }
+
+      complexVector_t throughTx = ProjectChannel (hTx, txSize, rxSize, numClusters, txFine.m_bfvs[bestTx], true);
+      azimuths = GridWindow (rxFine.m_azimuths, rxAzimuth, half);
+      zeniths = GridWindow (rxFine.m_zeniths, rxZenith, half);
+      double rxMax = -1;
+      size_t bestRx = 0;
+      for (size_t a = azimuths.first; a < azimuths.second; ++a)
+        {
+          for (size_t z = zeniths.first; z < zeniths.second; ++z)
+            {
+              size_t r = a * rxFine.m_zeniths.size () + z;
+              double gain = ProjectedGain (throughTx, numClusters, rxFine.m_bfvs[r]);
+              if (rxMax < gain)
+                {
+                  rxMax = gain;
+                  bestRx = r;
+                }
+            }
+        }
+
+      NS_LOG_LOGIC ("Candidate " << k << " with coarse gain " << candidate.m_gain <<
+                    " refined to " << rxMax);
+      if (max < rxMax)
+        {
+          max = rxMax;
+          double azimuth = txFine.m_azimuths[bestTx / txFine.m_zeniths.size ()];
+          double zenith = txFine.m_zeniths[bestTx % txFine.m_zeniths.size ()];
+          gnbBfv = BeamformingVector (txFine.m_bfvs[bestTx], BeamId (static_cast<uint16_t> (azimuth), zenith));
+          azimuth = rxFine.m_azimuths[bestRx / rxFine.m_zeniths.size ()];
+          zenith = rxFine.m_zeniths[bestRx % rxFine.m_zeniths.size ()];
+          ueBfv = BeamformingVector (rxFine.m_bfvs[bestRx], BeamId (static_cast<uint16_t> (azimuth), zenith));
+        }
+    }
+
+  NS_LOG_DEBUG ("Beamforming vectors for gNB with node id: " <<
+                gnbSpectrumPhy->GetMobility ()->GetObject<Node> ()->GetId () <<
+                " and UE with node id: " << ueSpectrumPhy->GetMobility ()->GetObject<Node> ()->GetId () <<
+                " are tx " << gnbBfv.second << " rx " << ueBfv.second <<
+                " with long term gain " << max);
+
+  return BeamformingVectorPair (std::make_pair (gnbBfv, ueBfv));
+}
+
 TypeId
 CellScanQuasiOmniBeamforming::GetTypeId (void)
 {
@@ -533,12 +1092,251 @@ OptimalCovMatrixBeamforming::GetTypeId (void)
   return tid;
 }
 
+void
+OptimalCovMatrixBeamforming::DoDispose ()
+{
+  m_cache.clear ();
+  IdealBeamformingAlgorithm::DoDispose ();
+}
+
+/**
+ * \brief Get the principal eigenvector of a Hermitian positive semi-definite
+ * matrix, with the power iteration
+ * \param m the matrix, by rows
+ * \return the eigenvector, of unit norm; an uniform vector if m is null
+ */
+static complexVector_t
+GetPrincipalEigenvector (const std::vector<complexVector_t> &m)
+{
+  size_t n = m.size ();
+
+  // Start from the column with the largest diagonal term, which is never
+  // orthogonal to the principal eigenvector of a non-null matrix
+  size_t start = 0;
+  for (size_t i = 1; i < n; ++i)
+    {
+      if (m[i][i].real () > m[start][start].real ())
+        {
+          start = i;
+        }
+    }
+  if (n == 0 || m[start][start].real () <= 0)
+    {
+      return complexVector_t (n, std::complex<double> (1.0 / std::sqrt (static_cast<double> (n)), 0));
+    }
+
+  complexVector_t v (n);
+  for (size_t i = 0; i < n; ++i)
+    {
+      v[i] = m[i][start];
+    }
+
+  static const uint32_t MAX_ITERATIONS = 100;
+  static const double TOLERANCE = 1e-9;
+  double eigenvalue = 0;
+  complexVector_t w (n);
+  for (uint32_t it = 0; it < MAX_ITERATIONS; ++it)
+    {
+      double norm = 0;
+      for (size_t i = 0; i < n; ++i)
+        {
+          norm += std::norm (v[i]);
+        }
+      norm = std::sqrt (norm);
+      for (size_t i = 0; i < n; ++i)
+        {
+          v[i] /= norm;
+        }
+
+      // w = m v, and the Rayleigh quotient v^H m v
+      double rayleigh = 0;
+      for (size_t i = 0; i < n; ++i)
+        {
+          std::complex<double> sum (0, 0);
+          for (size_t j = 0; j < n; ++j)
+            {
+              sum += m[i][j] * v[j];
+            }
+          w[i] = sum;
+          rayleigh += (std::conj (v[i]) * sum).real ();
+        }
+      std::swap (v, w);
+
+      if (std::abs (rayleigh - eigenvalue) <= TOLERANCE * rayleigh)
+        {
+          break;
+        }
+      eigenvalue = rayleigh;
+    }
+
+  double norm = 0;
+  for (size_t i = 0; i < n; ++i)
+    {
+      norm += std::norm (v[i]);
+    }
+  norm = std::sqrt (norm);
+  for (size_t i = 0; i < n; ++i)
+    {
+      v[i] /= norm;
+    }
+  return v;
+}
+
 BeamformingVectorPair
-OptimalCovMatrixBeamforming::GetBeamformingVectors ([[maybe_unused]] const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
-                                                    [[maybe_unused]] const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const
+OptimalCovMatrixBeamforming::GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                                    const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const
 {
   NS_LOG_FUNCTION (this);
-  return BeamformingVectorPair ();
+  NS_ABORT_MSG_IF (gnbSpectrumPhy == nullptr || ueSpectrumPhy == nullptr,
+                   "Something went wrong, gnb or UE PHY layer not set.");
+  double distance = gnbSpectrumPhy->GetMobility ()->GetDistanceFrom (ueSpectrumPhy->GetMobility ());
+  NS_ABORT_MSG_IF (distance == 0, "Beamforming method cannot be performed between "
+                                  "two devices that are placed in the same position.");
+
+  Ptr<SpectrumChannel> gnbSpectrumChannel = gnbSpectrumPhy->GetSpectrumChannel (); // SpectrumChannel should be const.. but need to change ns-3-dev
+  Ptr<ThreeGppSpectrumPropagationLossModel> threeGppSplm =
+    DynamicCast<ThreeGppSpectrumPropagationLossModel> (gnbSpectrumChannel->GetPhasedArraySpectrumPropagationLossModel ());
+  NS_ABORT_MSG_IF (threeGppSplm == nullptr,
+                   "OptimalCovMatrixBeamforming needs a ThreeGppSpectrumPropagationLossModel");
+
+  Ptr<const PhasedArrayModel> gnbArray = gnbSpectrumPhy->GetAntenna ()->GetObject<PhasedArrayModel> ();
+  Ptr<const PhasedArrayModel> ueArray = ueSpectrumPhy->GetAntenna ()->GetObject<PhasedArrayModel> ();
+  NS_ASSERT (gnbArray->GetNumberOfElements () && ueArray->GetNumberOfElements ());
+
+  Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel =
+    threeGppSplm->GetChannelModel ()->GetChannel (gnbSpectrumPhy->GetMobility (),
+                                                 ueSpectrumPhy->GetMobility (),
+                                                 gnbArray, ueArray);
+
+  // Fast path: the channel of the pair has not been regenerated
+  CacheEntry &entry = m_cache[std::make_pair (PeekPointer (gnbSpectrumPhy), PeekPointer (ueSpectrumPhy))];
+  if (entry.m_channel == channel && entry.m_generatedTime == channel->m_generatedTime)
+    {
+      NS_LOG_LOGIC ("Channel not regenerated, reusing the beamforming vectors");
+      return entry.m_bfvs;
+    }
+
+  // H[u][s][c]: gNB on the s side, unless the matrix was generated the other way
+  const MatrixBasedChannelModel::Complex3DVector &h = channel->m_channel;
+  bool gnbIsS = !channel->IsReverse (gnbArray->GetId (), ueArray->GetId ());
+  size_t uSize = h.size ();
+  size_t sSize = h.at (0).size ();
+  size_t numClusters = h.at (0).at (0).size ();
+
+  // Covariance at the s side, summed over the clusters and the u elements:
+  // rS = sum_c H_c^H H_c
+  std::vector<complexVector_t> rS (sSize, complexVector_t (sSize, std::complex<double> (0, 0)));
+  for (size_t u = 0; u < uSize; ++u)
+    {
+      for (size_t i = 0; i < sSize; ++i)
+        {
+          for (size_t j = i; j < sSize; ++j)
+            {
+              std::complex<double> sum (0, 0);
+              for (size_t c = 0; c < numClusters; ++c)
+                {
+                  sum += std::conj (h[u][i][c]) * h[u][j][c];
+                }
+              rS[i][j] += sum;
+            }
+        }
+    }
+  for (size_t i = 0; i < sSize; ++i)
+    {
+      for (size_t j = 0; j < i; ++j)
+        {
+          rS[i][j] = std::conj (rS[j][i]);
+        }
+    }
+  complexVector_t sW = GetPrincipalEigenvector (rS);
+  complexVector_t uW;
+
+  // Alternate between the two sides: the best vector of one side, given the
+  // vector of the other, is the principal eigenvector of the covariance of
+  // the channel seen through the other vector
+  static const uint32_t MAX_REFINEMENTS = 10;
+  static const double TOLERANCE = 1e-6;
+  double gain = 0;
+  std::vector<complexVector_t> projected (numClusters);
+  for (uint32_t it = 0; it < MAX_REFINEMENTS; ++it)
+    {
+      // b_c = H_c sW, rU = sum_c conj (b_c) b_c^T
+      for (size_t c = 0; c < numClusters; ++c)
+        {
+          projected[c].assign (uSize, std::complex<double> (0, 0));
+          for (size_t u = 0; u < uSize; ++u)
+            {
+              for (size_t s = 0; s < sSize; ++s)
+                {
+                  projected[c][u] += h[u][s][c] * sW[s];
+                }
+            }
+        }
+      std::vector<complexVector_t> rU (uSize, complexVector_t (uSize, std::complex<double> (0, 0)));
+      for (size_t c = 0; c < numClusters; ++c)
+        {
+          for (size_t i = 0; i < uSize; ++i)
+            {
+              for (size_t j = 0; j < uSize; ++j)
+                {
+                  rU[i][j] += std::conj (projected[c][i]) * projected[c][j];
+                }
+            }
+        }
+      uW = GetPrincipalEigenvector (rU);
+
+      // a_c = uW^T H_c, rS = sum_c conj (a_c) a_c^T
+      for (size_t c = 0; c < numClusters; ++c)
+        {
+          projected[c].assign (sSize, std::complex<double> (0, 0));
+          for (size_t u = 0; u < uSize; ++u)
+            {
+              for (size_t s = 0; s < sSize; ++s)
+                {
+                  projected[c][s] += uW[u] * h[u][s][c];
+                }
+            }
+        }
+      for (size_t i = 0; i < sSize; ++i)
+        {
+          for (size_t j = 0; j < sSize; ++j)
+            {
+              std::complex<double> sum (0, 0);
+              for (size_t c = 0; c < numClusters; ++c)
+                {
+                  sum += std::conj (projected[c][i]) * projected[c][j];
+                }
+              rS[i][j] = sum;
+            }
+        }
+      sW = GetPrincipalEigenvector (rS);
+
+      // Long term gain sum_c |uW^T H_c sW|^2
+      double newGain = 0;
+      for (size_t c = 0; c < numClusters; ++c)
+        {
+          std::complex<double> sum (0, 0);
+          for (size_t s = 0; s < sSize; ++s)
+            {
+              sum += projected[c][s] * sW[s];
+            }
+          newGain += std::norm (sum);
+        }
+      NS_LOG_LOGIC ("Refinement " << it << " long term gain " << newGain);
+      if (newGain - gain <= TOLERANCE * newGain)
+        {
+          break;
+        }
+      gain = newGain;
+    }
+
+  BeamformingVector gnbBfv = BeamformingVector (std::make_pair (gnbIsS ? sW : uW, BeamId::GetEmptyBeamId ()));
+  BeamformingVector ueBfv = BeamformingVector (std::make_pair (gnbIsS ? uW : sW, BeamId::GetEmptyBeamId ()));
+
+  entry.m_channel = channel;
+  entry.m_generatedTime = channel->m_generatedTime;
+  entry.m_bfvs = BeamformingVectorPair (std::make_pair (gnbBfv, ueBfv));
+  return entry.m_bfvs;
 }
 
 } // end of ns3 namespace
@@ -23,6 +23,11 @@
 #include <ns3/object.h>
 #include "beam-id.h"
 #include "beamforming-vector.h"
+#include "nr-beam-codebook.h"
+#include <ns3/matrix-based-channel-model.h>
+#include <ns3/nstime.h>
+#include <map>
+#include <memory>
 
 namespace ns3 {
 
@@ -31,6 +36,7 @@ class SpectrumValue;
 class NrGnbNetDevice;
 class NrUeNetDevice;
 class NrSpectrumPhy;
+class UniformPlanarArray;
 
 /**
  * \ingroup gnb-phy
@@ -64,6 +70,16 @@ public:
 /**
  * \ingroup gnb-phy
  * \brief The CellScanBeamforming class
+ *
+ * Searches the pair of directional beams (sector and elevation, see
+ * CreateDirectionalBfv) of the gNB and of the UE with the highest gain.
+ *
+ * When the devices use a ThreeGppSpectrumPropagationLossModel, the codebook
+ * of each antenna configuration is built once, and the long term gain
+ * \f$ \sum_c |w_{rx}^T H_c w_{tx}|^2 \f$ of all the beam pairs is computed
+ * in a single pass over the cluster matrix H of the channel, projecting it
+ * first on each tx beam and then on each rx beam. Otherwise, each beam pair
+ * is evaluated with a full CalcRxPowerSpectralDensity call.
  */
 class CellScanBeamforming: public IdealBeamformingAlgorithm
 {
@@ -105,10 +121,105 @@ public:
   virtual BeamformingVectorPair GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
                                                        const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const override;
 
-private:
+protected:
+  virtual void DoDispose () override;
+
+  /**
+   * \brief Gets the codebook of an antenna, building it the first time
+   * \param antenna the antenna
+   * \param isGnb true for the gNB codebook, false for the UE codebook
+   * \return the codebook of the directional beams (sector and elevation)
+   */
+  virtual const NrBeamCodebook & GetCodebook (const Ptr<const UniformPlanarArray> &antenna, bool isGnb) const;
+
+  /**
+   * \brief Searches the best beam pair over the codebooks, using the long
+   * term gain of the channel matrix
+   * \param gnbSpectrumPhy the spectrum phy of the gNB
+   * \param ueSpectrumPhy the spectrum phy of the UE
+   * \param channel the channel matrix of the gNB and the UE
+   * \return the beamforming vector pair of the gNB and the UE
+   */
+  BeamformingVectorPair SearchCodebooks (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                         const Ptr<NrSpectrumPhy>& ueSpectrumPhy,
+                                         Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel) const;
 
+private:
   double m_beamSearchAngleStep {30};//!< the beam search angle step attribute
 
+  /**
+   * \brief Codebooks, by gNB/UE role and antenna configuration (number of
+   * rows and element locations)
+   */
+  mutable std::map<std::vector<double>, std::unique_ptr<NrBeamCodebook> > m_codebooks;
+
+};
+
+/**
+ * \ingroup gnb-phy
+ * \brief The CodebookBeamforming class
+ *
+ * Searches, as CellScanBeamforming, the pair of beams of the gNB and of the
+ * UE with the highest long term gain, but over predefined codebooks (see
+ * NrBeamCodebook): an oversampled DFT codebook, or the one of a file. The
+ * codebooks are built once per antenna configuration and shared by all the
+ * devices, so the search only evaluates the gains. The beam managers of the
+ * devices get the codebook, and store the beams by their index.
+ *
+ * The channel of the devices must be a ThreeGppSpectrumPropagationLossModel.
+ */
+class CodebookBeamforming: public CellScanBeamforming
+{
+
+public:
+  /**
+   * \brief Get the type id
+   * \return the type id of the class
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief constructor
+   */
+  CodebookBeamforming () = default;
+
+  /**
+   * \brief destructor
+   */
+  virtual ~CodebookBeamforming () override = default;
+
+  /**
+   * \brief Function that generates the beamforming vectors for a pair of
+   * communicating devices by searching the codebooks
+   * \param [in] gnbSpectrumPhy the spectrum phy of the gNB
+   * \param [in] ueSpectrumPhy the spectrum phy of the UE
+   * \return the beamforming vector pair of the gNB and the UE
+   */
+  virtual BeamformingVectorPair GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                                       const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const override;
+
+protected:
+  /**
+   * \brief Gets the predefined codebook of an antenna
+   * \param antenna the antenna
+   * \param isGnb true for the gNB codebook, false for the UE codebook
+   * \return the codebook
+   */
+  virtual const NrBeamCodebook & GetCodebook (const Ptr<const UniformPlanarArray> &antenna, bool isGnb) const override;
+
+private:
+  /**
+   * \brief Gets the shared codebook of an antenna
+   * \param antenna the antenna
+   * \param isGnb true for the gNB codebook, false for the UE codebook
+   * \return the codebook of the file of the role, or the DFT codebook
+   */
+  std::shared_ptr<const NrBeamCodebook> GetSharedCodebook (const Ptr<const UniformPlanarArray> &antenna, bool isGnb) const;
+
+  std::string m_gnbCodebookFile;  //!< the GnbCodebookFile attribute
+  std::string m_ueCodebookFile;   //!< the UeCodebookFile attribute
+  uint32_t m_oversamplingH {1};   //!< the OversamplingH attribute
+  uint32_t m_oversamplingV {1};   //!< the OversamplingV attribute
 };
 
 /**
@@ -151,6 +262,115 @@ private:
   std::vector<double> m_zenith {112.5, 157.5};
 };
 
+/**
+ * \ingroup gnb-phy
+ * \brief Coarse-to-fine (hierarchical) cell scan beamforming
+ *
+ * The beams are steered in azimuth (-90 to 90 degrees) and zenith (60 to
+ * 120 degrees), as with CreateDirectionalBfvAz. The search has two stages:
+ *
+ * - all the pairs of beams of a coarse grid (CoarseAngleStep) are evaluated,
+ * and the NumCandidates pairs with the highest long term gain are kept;
+ * - for each candidate, the gNB beam is refined on a fine grid
+ * (FineAngleStep) within half a coarse step of the candidate, with the UE
+ * beam of the candidate, and then the UE beam is refined in the same way
+ * with the refined gNB beam.
+ *
+ * The refinement of each side is a search over one set of beams, not over
+ * the pairs of beams, so that a fine step costs roughly the square root of
+ * the exhaustive search of CellScanBeamforming at the same step. The long
+ * term gain \f$ \sum_c |w_{rx}^T H_c w_{tx}|^2 \f$ is computed on the 3GPP
+ * channel matrix, projected first on the fixed beam of each stage. The
+ * codebooks of each antenna configuration are built once.
+ *
+ * The channel of the devices must be a ThreeGppSpectrumPropagationLossModel.
+ */
+class HierarchicalCellScanBeamforming: public IdealBeamformingAlgorithm
+{
+
+public:
+  /**
+   * \brief Get the type id
+   * \return the type id of the class
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief constructor
+   */
+  HierarchicalCellScanBeamforming () = default;
+
+  /**
+   * \brief destructor
+   */
+  virtual ~HierarchicalCellScanBeamforming () override = default;
+
+  /**
+   * \brief Sets the angle step of the coarse search
+   * \param step the angle step, in degrees
+   */
+  void SetCoarseAngleStep (double step);
+
+  /**
+   * \return the angle step of the coarse search, in degrees
+   */
+  double GetCoarseAngleStep () const;
+
+  /**
+   * \brief Sets the angle step of the refinement
+   * \param step the angle step, in degrees
+   */
+  void SetFineAngleStep (double step);
+
+  /**
+   * \return the angle step of the refinement, in degrees
+   */
+  double GetFineAngleStep () const;
+
+  /**
+   * \brief Function that generates the beamforming vectors for a pair of
+   * communicating devices by using the coarse-to-fine cell scan
+   * \param [in] gnbSpectrumPhy the spectrum phy of the gNB
+   * \param [in] ueSpectrumPhy the spectrum phy of the UE
+   * \return the beamforming vector pair of the gNB and the UE
+   */
+  virtual BeamformingVectorPair GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
+                                                       const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const override;
+
+protected:
+  virtual void DoDispose () override;
+
+private:
+  /**
+   * \brief The beams of an azimuth-zenith grid, azimuth-major
+   */
+  struct Codebook
+  {
+    std::vector<double> m_azimuths;      //!< The azimuths of the grid, in degrees
+    std::vector<double> m_zeniths;       //!< The zeniths of the grid, in degrees
+    std::vector<complexVector_t> m_bfvs; //!< The vector of each beam, at azimuth index * zeniths + zenith index
+  };
+
+  /**
+   * \brief Gets the codebook of an antenna for an angle step, building it
+   * the first time
+   * \param antenna the antenna
+   * \param step the angle step, in degrees
+   * \return the codebook
+   */
+  const Codebook & GetCodebook (const Ptr<const UniformPlanarArray> &antenna, double step) const;
+
+  double m_coarseAngleStep {30}; //!< the CoarseAngleStep attribute
+  double m_fineAngleStep {5};    //!< the FineAngleStep attribute
+  uint32_t m_numCandidates {2};  //!< the NumCandidates attribute
+
+  /**
+   * \brief Codebooks, by angle step and antenna configuration (element
+   * locations)
+   */
+  mutable std::map<std::vector<double>, Codebook> m_codebooks;
+};
+
 /**
  * \ingroup gnb-phy
  * \brief The CellScanQuasiOmniBeamforming class
@@ -285,10 +505,23 @@ public:
 
 /**
  * \ingroup gnb-phy
- * \brief The OptimalCovMatrixBeamforming class not implemented yet.
- * TODO The idea was to port one of the initial beamforming methods that
- * were implemented in NYU/University of Padova mmwave module.
- * Method is based on a long term covariation matrix.
+ * \brief Beamforming on the principal eigenvectors of the channel covariance
+ *
+ * The idea comes from one of the initial beamforming methods of the
+ * NYU/University of Padova mmwave module, based on a long term covariance
+ * matrix. Here the covariance is computed directly from the 3GPP channel
+ * matrix H of the link, as the sum over the clusters c of
+ * \f$ H_c^H H_c \f$. The gNB beamforming vector is its principal
+ * eigenvector; the UE beamforming vector is then the principal eigenvector
+ * of the covariance of the channel seen through the gNB beam, and the two
+ * are refined in turns. Each eigenvector is found by power iteration, which
+ * replaces the angle sweeps of CellScanBeamforming with a few matrix-vector
+ * products.
+ *
+ * The vectors are cached per gNB-UE pair, and recomputed only when the
+ * channel matrix of the pair is regenerated.
+ *
+ * The channel of the devices must be a ThreeGppSpectrumPropagationLossModel.
  */
 class OptimalCovMatrixBeamforming : public IdealBeamformingAlgorithm
 {
@@ -303,16 +536,34 @@ public:
 
   /**
    * \brief Function that generates the beamforming vectors for a pair of
-   * communicating devices by using the direct-path beamforming vector for gNB
-   * and quasi-omni beamforming vector for UEs
+   * communicating devices from the principal eigenvectors of the covariance
+   * of their channel matrix
    * \param [in] gnbSpectrumPhy the spectrum phy of the gNB
    * \param [in] ueSpectrumPhy the spectrum phy of the UE
    * \return the beamforming vector pair of the gNB and the UE
    */
   virtual BeamformingVectorPair GetBeamformingVectors (const Ptr<NrSpectrumPhy>& gnbSpectrumPhy,
                                                        const Ptr<NrSpectrumPhy>& ueSpectrumPhy) const override;
-};
 
+protected:
+  virtual void DoDispose () override;
+
+private:
+  /**
+   * \brief Beamforming vectors computed for a channel matrix
+   */
+  struct CacheEntry
+  {
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> m_channel; //!< The channel matrix
+    Time m_generatedTime;                                         //!< Generation time of the channel matrix
+    BeamformingVectorPair m_bfvs;                                 //!< The beamforming vectors
+  };
+
+  /**
+   * \brief Cache of the beamforming vectors, per gNB and UE spectrum phy
+   */
+  mutable std::map<std::pair<const NrSpectrumPhy*, const NrSpectrumPhy*>, CacheEntry> m_cache;
+};
 
 } // end of ns3 namespace
 #endif
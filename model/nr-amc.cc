@@ -26,7 +26,10 @@
 #include "nr-error-model.h"
 #include "nr-lte-mi-error-model.h"
 #include "lena-error-model.h"
+#include "nr-counters.h"
 #include <ns3/nr-spectrum-value-helper.h>
+#include <algorithm>
+
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("NrAmc");
@@ -46,6 +49,7 @@ NrAmc::SetDlMode ()
 {
   NS_LOG_FUNCTION (this);
   m_emMode = NrErrorModel::DL;
+  InvalidateTbSizeTable ();
 }
 
 void
@@ -53,6 +57,7 @@ NrAmc::SetUlMode ()
 {
   NS_LOG_FUNCTION (this);
   m_emMode = NrErrorModel::UL;
+  InvalidateTbSizeTable ();
 }
 
 TypeId
@@ -81,6 +86,16 @@ NrAmc::GetTypeId (void)
                    MakeTypeIdAccessor (&NrAmc::SetErrorModelType,
                                        &NrAmc::GetErrorModelType),
                    MakeTypeIdChecker ())
+    .AddAttribute ("CqiSearchMode",
+                   "How the MCS is searched when AmcModel is set to ErrorModel. "
+                   "Linear evaluates the MCSs one by one, starting from the lowest, "
+                   "while Binary does a binary search over the MCSs, assuming that "
+                   "the TBLER does not decrease with the MCS",
+                   EnumValue (NrAmc::LINEAR_SEARCH),
+                   MakeEnumAccessor (&NrAmc::SetCqiSearchMode,
+                                     &NrAmc::GetCqiSearchMode),
+                   MakeEnumChecker (NrAmc::LINEAR_SEARCH, "Linear",
+                                    NrAmc::BINARY_SEARCH, "Binary"))
     .AddConstructor <NrAmc> ()
   ;
   return tid;
@@ -96,6 +111,7 @@ uint8_t
 NrAmc::GetMcsFromCqi (uint8_t cqi) const
 {
   NS_LOG_FUNCTION (cqi);
+  NrCounters::Add (NrCounters::AMC_CALLS);
   NS_ASSERT_MSG (cqi >= 0 && cqi <= 15, "CQI must be in [0..15] = " << cqi);
 
   double spectralEfficiency = m_errorModel->GetSpectralEfficiencyForCqi (cqi);
@@ -122,16 +138,50 @@ void NrAmc::SetNumRefScPerRb(uint8_t nref)
 {
   NS_LOG_FUNCTION (this);
   m_numRefScPerRb = nref;
+  InvalidateTbSizeTable ();
 }
 
 uint32_t
 NrAmc::CalculateTbSize (uint8_t mcs, uint32_t nprb) const
 {
   NS_LOG_FUNCTION (this << static_cast<uint32_t> (mcs));
+  NrCounters::Add (NrCounters::AMC_CALLS);
 
   NS_ASSERT_MSG (mcs <= m_errorModel->GetMaxMcs (), "MCS=" << static_cast<uint32_t> (mcs) <<
                  " while maximum MCS is " << static_cast<uint32_t> (m_errorModel->GetMaxMcs ()));
 
+  // The table grows lazily, up to (max MCS + 1) x (max number of PRB) entries
+  if (mcs >= m_tbSizeTable.size ())
+    {
+      m_tbSizeTable.resize (mcs + 1);
+    }
+
+  std::vector<uint32_t> &tbSizeRow = m_tbSizeTable[mcs];
+  if (nprb >= tbSizeRow.size ())
+    {
+      tbSizeRow.resize (nprb + 1, TB_SIZE_NOT_COMPUTED);
+    }
+
+  if (tbSizeRow[nprb] == TB_SIZE_NOT_COMPUTED)
+    {
+      tbSizeRow[nprb] = ComputeTbSize (mcs, nprb);
+    }
+
+  return tbSizeRow[nprb];
+}
+
+void
+NrAmc::InvalidateTbSizeTable ()
+{
+  NS_LOG_FUNCTION (this);
+  m_tbSizeTable.clear ();
+}
+
+uint32_t
+NrAmc::ComputeTbSize (uint8_t mcs, uint32_t nprb) const
+{
+  NS_LOG_FUNCTION (this << static_cast<uint32_t> (mcs));
+
   uint32_t payloadSize = GetPayloadSize (mcs, nprb);
   uint32_t tbSize = payloadSize;
 
@@ -157,14 +207,16 @@ NrAmc::CalculateTbSize (uint8_t mcs, uint32_t nprb) const
 uint32_t
 NrAmc::GetPayloadSize (uint8_t mcs, uint32_t nprb) const
 {
+  NrCounters::Add (NrCounters::AMC_CALLS);
   return m_errorModel->GetPayloadSize (NrSpectrumValueHelper::SUBCARRIERS_PER_RB - GetNumRefScPerRb (),
                                        mcs, nprb, m_emMode);
 }
 
 uint8_t
-NrAmc::CreateCqiFeedbackWbTdma (const SpectrumValue& sinr, uint8_t &mcs) const
+NrAmc::CreateCqiFeedbackWbTdma (const NrSinrValues& sinr, uint8_t &mcs) const
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Add (NrCounters::AMC_CALLS);
 
   // produces a single CQI/MCS value
 
@@ -172,15 +224,14 @@ NrAmc::CreateCqiFeedbackWbTdma (const SpectrumValue& sinr, uint8_t &mcs) const
   uint8_t cqi = 0;
   double seAvg = 0;
 
-  Values::const_iterator it;
   if (m_amcModel == ShannonModel)
     {
       //use shannon model
       double m_ber = GetBer();   // Shannon based model reference BER
       uint32_t rbNum = 0;
-      for (it = sinr.ConstValuesBegin (); it != sinr.ConstValuesEnd (); it++)
+      for (uint32_t rb = 0; rb < sinr.m_numBands; ++rb)
         {
-          double sinr_ = (*it);
+          double sinr_ = sinr[rb];
           if (sinr_ == 0.0)
             {
               //cqi.push_back (-1); // SINR == 0 (linear units) means no signal in this RB
@@ -201,7 +252,7 @@ NrAmc::CreateCqiFeedbackWbTdma (const SpectrumValue& sinr, uint8_t &mcs) const
               int cqi_ = GetCqiFromSpectralEfficiency (s);
               rbNum++;
 
-              NS_LOG_LOGIC (" PRB =" << sinr.GetSpectrumModel ()->GetNumBands ()
+              NS_LOG_LOGIC (" PRB =" << sinr.m_numBands
                                      << ", sinr = " << sinr_
                                      << " (=" << 10 * std::log10 (sinr_) << " dB)"
                                      << ", spectral efficiency =" << s
@@ -219,51 +270,64 @@ NrAmc::CreateCqiFeedbackWbTdma (const SpectrumValue& sinr, uint8_t &mcs) const
   else if (m_amcModel == ErrorModel)
     {
       std::vector <int> rbMap;
-      int rbId = 0;
-      for (it = sinr.ConstValuesBegin (); it != sinr.ConstValuesEnd (); it++)
+      for (uint32_t rbId = 0; rbId < sinr.m_numBands; ++rbId)
         {
-          if (*it != 0.0)
+          if (sinr[rbId] != 0.0)
             {
               rbMap.push_back (rbId);
             }
-          rbId += 1;
         }
 
-      mcs = 0;
-      Ptr<NrErrorModelOutput> output;
-      while (mcs <= m_errorModel->GetMaxMcs ())
+      // Index of the first MCS that can not guarantee the 10 % of BLER, or
+      // GetMaxMcs () + 1 if all of them can
+      uint8_t firstFailingMcs = 0;
+      if (m_cqiSearchMode == BINARY_SEARCH)
         {
-          output = m_errorModel->GetTbDecodificationStats (sinr, rbMap,
-                                                           CalculateTbSize (mcs, rbMap.size ()),
-                                                           mcs,
-                                                           NrErrorModel::NrErrorModelHistory ());
-          if (output->m_tbler > 0.1)
+          uint8_t low = 0;
+          uint8_t high = m_errorModel->GetMaxMcs () + 1;
+          while (low < high)
             {
-              break;
+              uint8_t mid = low + (high - low) / 2;
+              if (IsTblerAboveTarget (sinr, rbMap, mid))
+                {
+                  high = mid;
+                }
+              else
+                {
+                  low = mid + 1;
+                }
             }
-          mcs++;
+          firstFailingMcs = low;
         }
-
-      if (mcs > 0)
+      else
         {
-          mcs--;
+          while (firstFailingMcs <= m_errorModel->GetMaxMcs ()
+                 && ! IsTblerAboveTarget (sinr, rbMap, firstFailingMcs))
+            {
+              firstFailingMcs++;
+            }
         }
 
-      if ((output->m_tbler > 0.1) && (mcs == 0))
-        {
-          cqi = 0;
-        }
-      else if (mcs == m_errorModel->GetMaxMcs ())
+      if (firstFailingMcs > m_errorModel->GetMaxMcs ())
         {
+          mcs = m_errorModel->GetMaxMcs ();
           cqi = 15;   // all MCSs can guarantee the 10 % of BER
         }
       else
         {
-          double s = m_errorModel->GetSpectralEfficiencyForMcs (mcs);
-          cqi = 0;
-          while ((cqi < 15) && (m_errorModel->GetSpectralEfficiencyForCqi (cqi + 1) <= s))
+          mcs = firstFailingMcs > 0 ? firstFailingMcs - 1 : 0;
+          if (mcs == 0)
+            {
+              cqi = 0;
+            }
+          else
             {
-              ++cqi;
+              double s = m_errorModel->GetSpectralEfficiencyForMcs (mcs);
+              cqi = 0;
+              while ((cqi < 15) && (m_errorModel->GetSpectralEfficiencyForCqi (cqi + 1) <= s))
+                {
+                  ++cqi;
+                }
             }
         }
       NS_LOG_DEBUG (this << "\t MCS " << (uint16_t)mcs << "-> CQI " << cqi);
@@ -271,6 +335,56 @@ NrAmc::CreateCqiFeedbackWbTdma (const SpectrumValue& sinr, uint8_t &mcs) const
   return cqi;
 }
 
+std::vector<uint8_t>
+NrAmc::CreateCqiFeedbackSbTdma (const SpectrumValue& sinr, uint32_t numRbPerRbg) const
+{
+  NS_LOG_FUNCTION (this);
+  NrCounters::Add (NrCounters::AMC_CALLS);
+  NS_ASSERT (numRbPerRbg > 0);
+
+  uint32_t numRb = sinr.GetSpectrumModel ()->GetNumBands ();
+  uint32_t numRbg = (numRb + numRbPerRbg - 1) / numRbPerRbg;
+  std::vector<uint8_t> cqi (numRbg, 0);
+
+  // The SINR of one RBG at a time; the other RBs stay at 0, i.e., not used
+  SpectrumValue rbgSinr (sinr.GetSpectrumModel ());
+  for (uint32_t rbg = 0; rbg < numRbg; ++rbg)
+    {
+      uint32_t firstRb = rbg * numRbPerRbg;
+      uint32_t lastRb = std::min (firstRb + numRbPerRbg, numRb);
+      bool measured = false;
+      for (uint32_t rb = firstRb; rb < lastRb; ++rb)
+        {
+          rbgSinr[rb] = sinr[rb];
+          measured |= sinr[rb] != 0.0;
+        }
+      if (measured)
+        {
+          uint8_t mcs;
+          cqi[rbg] = CreateCqiFeedbackWbTdma (rbgSinr, mcs);
+        }
+      for (uint32_t rb = firstRb; rb < lastRb; ++rb)
+        {
+          rbgSinr[rb] = 0.0;
+        }
+    }
+  return cqi;
+}
+
+bool
+NrAmc::IsTblerAboveTarget (const NrSinrValues& sinr, const std::vector<int> &rbMap,
+                           uint8_t mcs) const
+{
+  NS_LOG_FUNCTION (this);
+  NrCounters::Add (NrCounters::AMC_CALLS);
+  Ptr<NrErrorModelOutput> output;
+  output = m_errorModel->GetTbDecodificationStats (sinr, rbMap,
+                                                   CalculateTbSize (mcs, rbMap.size ()),
+                                                   mcs,
+                                                   NrErrorModel::NrErrorModelHistory ());
+  return output->m_tbler > 0.1;
+}
+
 uint8_t
 NrAmc::GetCqiFromSpectralEfficiency (double s) const
 {
@@ -285,6 +399,14 @@ NrAmc::GetCqiFromSpectralEfficiency (double s) const
   return cqi;
 }
 
+uint8_t
+NrAmc::GetCqiFromSinrShannon (double sinr) const
+{
+  NS_LOG_FUNCTION (sinr);
+  double s = log2 (1 + (sinr / ((-std::log (5.0 * GetBer ())) / 1.5)));
+  return GetCqiFromSpectralEfficiency (std::max (s, 0.0));
+}
+
 uint8_t
 NrAmc::GetMcsFromSpectralEfficiency (double s) const
 {
@@ -299,6 +421,13 @@ NrAmc::GetMcsFromSpectralEfficiency (double s) const
   return mcs;
 }
 
+double
+NrAmc::GetSpectralEfficiencyForMcs (uint8_t mcs) const
+{
+  NS_LOG_FUNCTION (this << +mcs);
+  return m_errorModel->GetSpectralEfficiencyForMcs (mcs);
+}
+
 uint32_t
 NrAmc::GetMaxMcs() const
 {
@@ -311,6 +440,7 @@ NrAmc::SetAmcModel (NrAmc::AmcModel m)
 {
   NS_LOG_FUNCTION (this);
   m_amcModel = m;
+  InvalidateTbSizeTable ();
 }
 
 NrAmc::AmcModel
@@ -320,16 +450,27 @@ NrAmc::GetAmcModel () const
   return m_amcModel;
 }
 
+void
+NrAmc::SetCqiSearchMode (NrAmc::CqiSearchMode mode)
+{
+  NS_LOG_FUNCTION (this);
+  m_cqiSearchMode = mode;
+}
+
+NrAmc::CqiSearchMode
+NrAmc::GetCqiSearchMode () const
+{
+  NS_LOG_FUNCTION (this);
+  return m_cqiSearchMode;
+}
+
 void
 NrAmc::SetErrorModelType (const TypeId &type)
 {
   NS_LOG_FUNCTION (this);
-  ObjectFactory factory;
   m_errorModelType = type;
-
-  factory.SetTypeId (m_errorModelType);
-  m_errorModel = DynamicCast<NrErrorModel> (factory.Create ());
-  NS_ASSERT (m_errorModel != nullptr);
+  m_errorModel = NrErrorModel::GetShared (m_errorModelType);
+  InvalidateTbSizeTable ();
 }
 
 TypeId
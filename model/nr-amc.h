@@ -100,6 +100,17 @@ public:
     ErrorModel    //!< Error Model version (can use different error models, see NrErrorModel)
   };
 
+  /**
+   * \brief Valid types of search of the MCS in the ErrorModel AMC model
+   *
+   * \see CreateCqiFeedbackWbTdma
+   */
+  enum CqiSearchMode
+  {
+    LINEAR_SEARCH, //!< Evaluate the TBLER of each MCS, starting from the lowest
+    BINARY_SEARCH  //!< Binary search of the highest MCS with TBLER below 10 %
+  };
+
   /**
    * \brief Get the MCS value from a CQI value
    * \param cqi the CQI
@@ -129,11 +140,36 @@ public:
    * which the gNB/UE has transmitted power, and from which the SINR can be
    * measured, during 1 OFDM symbol, is assumed.
    *
+   * With the ErrorModel AMC model, the MCS is the highest one with a TBLER
+   * below 10 %. With the CqiSearchMode attribute set to Binary, the MCS is
+   * found with a binary search, which needs around log2(GetMaxMcs ()) calls
+   * to the error model instead of up to GetMaxMcs (). The result is the same
+   * as the linear search as long as the TBLER does not decrease with the MCS,
+   * which for the EESM tables may not hold only for transmissions over very
+   * few RBs.
+   *
+   * The SINR is read through a NrSinrValues, so that the schedulers can call
+   * it from the workers of NrSchedulingWorkerPool without touching the
+   * SpectrumModel, which is shared by the cells.
+   *
    * \param sinr the sinr values
    * \param mcsWb The calculated MCS
    * \return The calculated CQI
    */
-  uint8_t CreateCqiFeedbackWbTdma (const SpectrumValue& sinr, uint8_t &mcsWb) const;
+  uint8_t CreateCqiFeedbackWbTdma (const NrSinrValues& sinr, uint8_t &mcsWb) const;
+
+  /**
+   * \brief Create a CQI sub-band feedback from a SINR values
+   *
+   * The CQI of each RBG is the one that CreateCqiFeedbackWbTdma returns for
+   * the SINR of the RBs of that RBG only. An RBG without any RB with
+   * transmitted power is not measured, and its CQI is 0.
+   *
+   * \param sinr the sinr values
+   * \param numRbPerRbg the number of RBs per RBG
+   * \return The calculated CQI, one per RBG
+   */
+  std::vector<uint8_t> CreateCqiFeedbackSbTdma (const SpectrumValue& sinr, uint32_t numRbPerRbg) const;
 
   /**
    * \brief Get CQI from a SpectralEfficiency value
@@ -142,6 +178,17 @@ public:
    */
   uint8_t GetCqiFromSpectralEfficiency (double s) const;
 
+  /**
+   * \brief Get the CQI of a SINR with the Shannon model, whatever the AMC model
+   *
+   * Much cheaper than CreateCqiFeedbackWbTdma with the ErrorModel AMC
+   * model, as it does not search the MCS.
+   *
+   * \param sinr the SINR, in linear units
+   * \return the CQI (depends on the Error Model)
+   */
+  uint8_t GetCqiFromSinrShannon (double sinr) const;
+
   /**
    * \brief Get MCS from a SpectralEfficiency value
    * \param s spectral efficiency
@@ -149,6 +196,13 @@ public:
    */
   uint8_t GetMcsFromSpectralEfficiency (double s) const;
 
+  /**
+   * \brief Get the spectral efficiency of an MCS
+   * \param mcs the MCS
+   * \return the spectral efficiency (depends on the Error Model)
+   */
+  double GetSpectralEfficiencyForMcs (uint8_t mcs) const;
+
  /**
   * \brief Get the maximum MCS (depends on the underlying error model)
   * \return the maximum MCS
@@ -166,6 +220,18 @@ public:
    */
   AmcModel GetAmcModel () const;
 
+  /**
+   * \brief Set the search mode of the MCS in the ErrorModel AMC model
+   * \param mode the search mode
+   */
+  void SetCqiSearchMode (CqiSearchMode mode);
+
+  /**
+   * \brief Get the search mode of the MCS in the ErrorModel AMC model
+   * \return the search mode
+   */
+  CqiSearchMode GetCqiSearchMode () const;
+
   /**
    * \brief Set Error model type
    * \param type the Error model type
@@ -183,6 +249,11 @@ public:
    * It depends on the error model and the "mode" configured with SetMode().
    * Please note that this function expects in input the RB, not the RBG of the transmission.
    *
+   * The values are stored in a (MCS x nPRB) table, filled lazily the first
+   * time each entry is requested, and cleared every time the AMC model,
+   * the error model type, the mode, or the number of reference subcarriers
+   * change.
+   *
    * \param mcs the MCS of the transmission
    * \param nprb The number of physical resource blocks used in the transmission
    * \return the TBS in bytes
@@ -203,12 +274,40 @@ private:
    */
   double GetBer () const;
 
+  /**
+   * \brief Check if the TBLER of a transmission is above the 10 %
+   * \param sinr the sinr values
+   * \param rbMap the RBs used by the transmission
+   * \param mcs the MCS of the transmission
+   * \return true if the error model returns a TBLER higher than 0.1
+   */
+  bool IsTblerAboveTarget (const NrSinrValues& sinr, const std::vector<int> &rbMap,
+                           uint8_t mcs) const;
+
+  /**
+   * \brief Calculate the TransportBlock size (in bytes), without looking
+   * into the TB size table
+   * \param mcs the MCS of the transmission
+   * \param nprb The number of physical resource blocks used in the transmission
+   * \return the TBS in bytes
+   */
+  uint32_t ComputeTbSize (uint8_t mcs, uint32_t nprb) const;
+
+  /**
+   * \brief Remove all the entries of the TB size table
+   */
+  void InvalidateTbSizeTable ();
+
 private:
   AmcModel m_amcModel;             //!< Type of the CQI feedback model
+  CqiSearchMode m_cqiSearchMode {LINEAR_SEARCH}; //!< Search mode of the MCS in the ErrorModel AMC model
   Ptr<NrErrorModel> m_errorModel;  //!< Pointer to an instance of ErrorModel
   TypeId m_errorModelType;         //!< Type of the error model
   uint8_t m_numRefScPerRb {1};     //!< number of reference subcarriers per RB
   NrErrorModel::Mode m_emMode {NrErrorModel::DL}; //!< Error model mode
+
+  static constexpr uint32_t TB_SIZE_NOT_COMPUTED = UINT32_MAX; //!< Marker of an empty entry of the TB size table
+  mutable std::vector<std::vector<uint32_t>> m_tbSizeTable; //!< TB size cache, indexed by MCS and number of PRB
   static const unsigned int m_crcLen = 24 / 8; //!< CRC length (in bytes)
 };
 
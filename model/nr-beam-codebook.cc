@@ -0,0 +1,169 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-beam-codebook.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/uinteger.h>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrBeamCodebook");
+
+// The elevation of the BeamId of the codebook indices, out of [0, 180]
+static const double INDEX_BEAM_ELEVATION = -1.0;
+
+NrBeamCodebook::NrBeamCodebook (std::vector<complexVector_t> bfvs, std::vector<BeamId> beamIds)
+  : m_bfvs (std::move (bfvs)),
+    m_beamIds (std::move (beamIds))
+{
+  NS_ABORT_MSG_IF (m_bfvs.size () != m_beamIds.size (), "A BeamId is needed for each vector");
+}
+
+std::shared_ptr<const NrBeamCodebook>
+NrBeamCodebook::GetDft (const Ptr<const UniformPlanarArray> &antenna,
+                        uint32_t oversamplingH, uint32_t oversamplingV)
+{
+  NS_ABORT_MSG_IF (oversamplingH == 0 || oversamplingV == 0, "The oversampling factors must be positive");
+  static std::map<std::vector<uint64_t>, std::shared_ptr<const NrBeamCodebook> > codebooks;
+
+  UintegerValue uintValue;
+  antenna->GetAttribute ("NumRows", uintValue);
+  uint64_t numRows = uintValue.Get ();
+  antenna->GetAttribute ("NumColumns", uintValue);
+  uint64_t numColumns = uintValue.Get ();
+
+  std::shared_ptr<const NrBeamCodebook> &codebook = codebooks[{numRows, numColumns, oversamplingH, oversamplingV}];
+  if (codebook != nullptr)
+    {
+      return codebook;
+    }
+
+  uint64_t numH = numColumns * oversamplingH;
+  uint64_t numV = numRows * oversamplingV;
+  NS_ABORT_MSG_IF (numH * numV > UINT16_MAX, "Too many beams for a codebook: " << numH * numV);
+  double norm = 1.0 / std::sqrt (static_cast<double> (numRows * numColumns));
+
+  // The elements are row-major: element n * numColumns + m is on column m and row n
+  std::vector<complexVector_t> bfvs;
+  std::vector<BeamId> beamIds;
+  bfvs.reserve (numH * numV);
+  beamIds.reserve (numH * numV);
+  for (uint64_t k = 0; k < numH; ++k)
+    {
+      for (uint64_t l = 0; l < numV; ++l)
+        {
+          complexVector_t bfv (numRows * numColumns);
+          for (uint64_t n = 0; n < numRows; ++n)
+            {
+              for (uint64_t m = 0; m < numColumns; ++m)
+                {
+                  double phase = 2 * M_PI * (static_cast<double> (m * k) / numH + static_cast<double> (n * l) / numV);
+                  bfv[n * numColumns + m] = std::polar (norm, phase);
+                }
+            }
+          beamIds.push_back (GetIndexBeamId (static_cast<uint16_t> (bfvs.size ())));
+          bfvs.push_back (std::move (bfv));
+        }
+    }
+  NS_LOG_LOGIC ("Built a DFT codebook of " << bfvs.size () << " beams for " <<
+                numRows << "x" << numColumns << " elements");
+  codebook = std::make_shared<const NrBeamCodebook> (std::move (bfvs), std::move (beamIds));
+  return codebook;
+}
+
+std::shared_ptr<const NrBeamCodebook>
+NrBeamCodebook::Load (const std::string &fileName, uint64_t numElements)
+{
+  static std::map<std::string, std::shared_ptr<const NrBeamCodebook> > codebooks;
+
+  std::shared_ptr<const NrBeamCodebook> &codebook = codebooks[fileName];
+  if (codebook != nullptr)
+    {
+      NS_ABORT_MSG_IF (codebook->GetVector (0).size () != numElements,
+                       "The codebook " << fileName << " is not for " << numElements << " elements");
+      return codebook;
+    }
+
+  std::ifstream file (fileName);
+  NS_ABORT_MSG_IF (!file.good (), "Cannot open the codebook " << fileName);
+  std::vector<complexVector_t> bfvs;
+  std::vector<BeamId> beamIds;
+  std::string line;
+  while (std::getline (file, line))
+    {
+      if (line.find_first_not_of (" \t\r") == std::string::npos)
+        {
+          continue;
+        }
+      std::istringstream values (line);
+      complexVector_t bfv;
+      double re, im;
+      while (values >> re >> im)
+        {
+          bfv.emplace_back (re, im);
+        }
+      NS_ABORT_MSG_IF (bfv.size () != numElements,
+                       "Beam " << bfvs.size () << " of " << fileName << " has " << bfv.size () <<
+                       " weights instead of " << numElements);
+      NS_ABORT_MSG_IF (bfvs.size () == UINT16_MAX, "Too many beams in " << fileName);
+      beamIds.push_back (GetIndexBeamId (static_cast<uint16_t> (bfvs.size ())));
+      bfvs.push_back (std::move (bfv));
+    }
+  NS_ABORT_MSG_IF (bfvs.empty (), "No beam in the codebook " << fileName);
+  NS_LOG_LOGIC ("Loaded a codebook of " << bfvs.size () << " beams from " << fileName);
+  codebook = std::make_shared<const NrBeamCodebook> (std::move (bfvs), std::move (beamIds));
+  return codebook;
+}
+
+BeamId
+NrBeamCodebook::GetIndexBeamId (uint16_t index)
+{
+  return BeamId (index, INDEX_BEAM_ELEVATION);
+}
+
+bool
+NrBeamCodebook::IsIndexBeamId (const BeamId &beamId)
+{
+  return beamId.GetElevation () == INDEX_BEAM_ELEVATION;
+}
+
+size_t
+NrBeamCodebook::GetNumBeams () const
+{
+  return m_bfvs.size ();
+}
+
+const complexVector_t &
+NrBeamCodebook::GetVector (size_t index) const
+{
+  return m_bfvs.at (index);
+}
+
+const BeamId &
+NrBeamCodebook::GetBeamId (size_t index) const
+{
+  return m_beamIds.at (index);
+}
+
+} // namespace ns3
@@ -0,0 +1,113 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_BEAM_CODEBOOK_H
+#define NR_BEAM_CODEBOOK_H
+
+#include "beamforming-vector.h"
+#include "beam-id.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup utils
+ * \brief A set of predefined beams of an antenna configuration
+ *
+ * The beams are referenced by their index. The codebooks built by GetDft
+ * and Load are kept in a registry, so that all the devices with the same
+ * antenna configuration (or the same file) share the same vectors, which
+ * are computed only once; the beams of these codebooks have the BeamId
+ * returned by GetIndexBeamId, which a BeamManager with the codebook stores
+ * instead of the vector.
+ */
+class NrBeamCodebook
+{
+public:
+  /**
+   * \brief Create a codebook from its beams
+   * \param bfvs the beamforming vectors, all of the same size
+   * \param beamIds the BeamId of each vector
+   */
+  NrBeamCodebook (std::vector<complexVector_t> bfvs, std::vector<BeamId> beamIds);
+
+  /**
+   * \brief Get the oversampled 2D DFT codebook of an antenna
+   * \param antenna the antenna
+   * \param oversamplingH the oversampling factor along the columns
+   * \param oversamplingV the oversampling factor along the rows
+   * \return the codebook of NumColumns * oversamplingH times
+   * NumRows * oversamplingV beams, shared by all the antennas with the same
+   * number of rows and columns
+   *
+   * The beam of index k * NumRows * oversamplingV + l has, on the element of
+   * column m and row n, the weight
+   * \f$ e^{j 2 \pi (m k / (N_c O_H) + n l / (N_r O_V))} / \sqrt{N_c N_r} \f$.
+   */
+  static std::shared_ptr<const NrBeamCodebook> GetDft (const Ptr<const UniformPlanarArray> &antenna,
+                                                       uint32_t oversamplingH, uint32_t oversamplingV);
+
+  /**
+   * \brief Get the codebook of a file
+   * \param fileName the file, with a beam per line, made of the real and
+   * imaginary part of the weight of each element, separated by spaces
+   * \param numElements the number of elements of the antenna
+   * \return the codebook, shared by all the antennas that use the file
+   */
+  static std::shared_ptr<const NrBeamCodebook> Load (const std::string &fileName, uint64_t numElements);
+
+  /**
+   * \brief Get the BeamId of a beam of a codebook of GetDft or Load
+   * \param index the index of the beam
+   * \return the BeamId, which has an elevation that no directional beam has
+   */
+  static BeamId GetIndexBeamId (uint16_t index);
+
+  /**
+   * \param beamId a BeamId
+   * \return true if the BeamId is the one of an index of a codebook
+   */
+  static bool IsIndexBeamId (const BeamId &beamId);
+
+  /**
+   * \return the number of beams
+   */
+  size_t GetNumBeams () const;
+
+  /**
+   * \param index the index of the beam
+   * \return the beamforming vector of the beam
+   */
+  const complexVector_t & GetVector (size_t index) const;
+
+  /**
+   * \param index the index of the beam
+   * \return the BeamId of the beam
+   */
+  const BeamId & GetBeamId (size_t index) const;
+
+private:
+  std::vector<complexVector_t> m_bfvs; //!< The beamforming vectors
+  std::vector<BeamId> m_beamIds;       //!< The BeamId of each vector
+};
+
+} // namespace ns3
+
+#endif // NR_BEAM_CODEBOOK_H
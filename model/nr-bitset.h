@@ -0,0 +1,461 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_BITSET_H
+#define NR_BITSET_H
+
+#include <ns3/assert.h>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup utils
+ * \brief A packed bitset of RBGs or RBs
+ *
+ * One bit per RBG (or RB), packed in 64 bits words: a bit set to 1 means
+ * that the RBG is used (or, for a notching mask, that it can be used).
+ * Counting, AND and OR are done one word at a time, and the set bits can
+ * be visited with FindFirst (or FindFrom) and FindNext:
+ *
+ * \code
+ *   for (size_t i = mask.FindFirst (); i < mask.size (); i = mask.FindNext (i))
+ *     {
+ *       // RBG i is set
+ *     }
+ * \endcode
+ *
+ * Up to INLINE_WORDS words (256 RBGs) are stored inside the object, so that
+ * creating and copying a mask does not allocate memory; larger masks are
+ * stored in a std::vector.
+ *
+ * A bitset can be built from the std::vector<uint8_t> masks used before
+ * (one byte per RBG, 0 or 1), and converted back with ToVector.
+ */
+class NrBitset
+{
+public:
+  NrBitset () = default;
+
+  /**
+   * \brief Build a bitset
+   * \param size the number of bits
+   * \param value the value of all the bits
+   */
+  explicit NrBitset (size_t size, bool value = false)
+  {
+    resize (size, value);
+  }
+
+  /**
+   * \brief Build a bitset from a byte mask
+   * \param mask one byte per bit; the bit is set if the byte is not 0
+   */
+  NrBitset (const std::vector<uint8_t> &mask)
+  {
+    resize (mask.size ());
+    for (size_t i = 0; i < mask.size (); ++i)
+      {
+        if (mask[i] != 0)
+          {
+            set (i);
+          }
+      }
+  }
+
+  /**
+   * \return the bits as a byte mask (one byte per bit, 0 or 1)
+   */
+  std::vector<uint8_t> ToVector () const
+  {
+    std::vector<uint8_t> ret (m_size, 0);
+    for (size_t i = FindFirst (); i < m_size; i = FindNext (i))
+      {
+        ret[i] = 1;
+      }
+    return ret;
+  }
+
+  /**
+   * \return the number of bits
+   */
+  size_t size () const
+  {
+    return m_size;
+  }
+
+  /**
+   * \return true if the bitset has no bits
+   */
+  bool empty () const
+  {
+    return m_size == 0;
+  }
+
+  /**
+   * \brief Change the number of bits
+   * \param size the new number of bits
+   * \param value the value of the added bits
+   */
+  void resize (size_t size, bool value = false)
+  {
+    if (size < m_size)
+      {
+        // Keep the bits beyond the size at 0
+        uint64_t *words = Words ();
+        for (size_t w = (size + 63) / 64; w < NumWords (); ++w)
+          {
+            words[w] = 0;
+          }
+        m_size = size;
+        ClearTail ();
+        return;
+      }
+
+    size_t oldSize = m_size;
+    size_t numWords = (size + 63) / 64;
+    if (!m_onHeap && numWords > INLINE_WORDS)
+      {
+        m_heap.assign (m_inline, m_inline + INLINE_WORDS);
+        m_onHeap = true;
+      }
+    if (m_onHeap && numWords > m_heap.size ())
+      {
+        m_heap.resize (numWords, 0);
+      }
+    m_size = size;
+    if (value)
+      {
+        for (size_t i = oldSize; i < size; ++i)
+          {
+            set (i);
+          }
+      }
+  }
+
+  /**
+   * \param i the index of the bit
+   * \return the value of the bit
+   */
+  bool test (size_t i) const
+  {
+    NS_ASSERT_MSG (i < m_size, "Bit " << i << " out of " << m_size);
+    return (Words ()[i / 64] >> (i % 64)) & 1;
+  }
+
+  /**
+   * \brief Set the value of a bit
+   * \param i the index of the bit
+   * \param value the value
+   */
+  void set (size_t i, bool value = true)
+  {
+    NS_ASSERT_MSG (i < m_size, "Bit " << i << " out of " << m_size);
+    uint64_t bit = static_cast<uint64_t> (1) << (i % 64);
+    if (value)
+      {
+        Words ()[i / 64] |= bit;
+      }
+    else
+      {
+        Words ()[i / 64] &= ~bit;
+      }
+  }
+
+  /**
+   * \brief Clear a bit
+   * \param i the index of the bit
+   */
+  void reset (size_t i)
+  {
+    set (i, false);
+  }
+
+  /**
+   * \brief Set all the bits
+   */
+  void set ()
+  {
+    uint64_t *words = Words ();
+    for (size_t w = 0; w < NumWords (); ++w)
+      {
+        words[w] = ~static_cast<uint64_t> (0);
+      }
+    ClearTail ();
+  }
+
+  /**
+   * \brief Clear all the bits
+   */
+  void reset ()
+  {
+    uint64_t *words = Words ();
+    for (size_t w = 0; w < NumWords (); ++w)
+      {
+        words[w] = 0;
+      }
+  }
+
+  /**
+   * \return the number of bits set
+   */
+  size_t count () const
+  {
+    size_t n = 0;
+    const uint64_t *words = Words ();
+    for (size_t w = 0; w < NumWords (); ++w)
+      {
+        n += PopCount (words[w]);
+      }
+    return n;
+  }
+
+  /**
+   * \return true if at least one bit is set
+   */
+  bool any () const
+  {
+    const uint64_t *words = Words ();
+    for (size_t w = 0; w < NumWords (); ++w)
+      {
+        if (words[w] != 0)
+          {
+            return true;
+          }
+      }
+    return false;
+  }
+
+  /**
+   * \return true if no bit is set
+   */
+  bool none () const
+  {
+    return !any ();
+  }
+
+  /**
+   * \param i the index of a bit
+   * \return the index of the first bit set from i (included), or size ()
+   */
+  size_t FindFrom (size_t i) const
+  {
+    if (i >= m_size)
+      {
+        return m_size;
+      }
+    const uint64_t *words = Words ();
+    size_t w = i / 64;
+    uint64_t word = words[w] & (~static_cast<uint64_t> (0) << (i % 64));
+    while (word == 0)
+      {
+        if (++w >= NumWords ())
+          {
+            return m_size;
+          }
+        word = words[w];
+      }
+    return w * 64 + CountTrailingZeros (word);
+  }
+
+  /**
+   * \return the index of the first bit set, or size () if there is none
+   */
+  size_t FindFirst () const
+  {
+    return FindFrom (0);
+  }
+
+  /**
+   * \param i the index of a bit
+   * \return the index of the first bit set after i, or size () if there is none
+   */
+  size_t FindNext (size_t i) const
+  {
+    return FindFrom (i + 1);
+  }
+
+  /**
+   * \brief Keep only the bits that are also set in another bitset
+   * \param o the other bitset, of the same size
+   * \return this bitset
+   */
+  NrBitset & operator&= (const NrBitset &o)
+  {
+    NS_ASSERT_MSG (m_size == o.m_size, "Size " << m_size << " != " << o.m_size);
+    uint64_t *words = Words ();
+    const uint64_t *other = o.Words ();
+    for (size_t w = 0; w < NumWords (); ++w)
+      {
+        words[w] &= other[w];
+      }
+    return *this;
+  }
+
+  /**
+   * \brief Set also the bits that are set in another bitset
+   * \param o the other bitset, of the same size
+   * \return this bitset
+   */
+  NrBitset & operator|= (const NrBitset &o)
+  {
+    NS_ASSERT_MSG (m_size == o.m_size, "Size " << m_size << " != " << o.m_size);
+    uint64_t *words = Words ();
+    const uint64_t *other = o.Words ();
+    for (size_t w = 0; w < NumWords (); ++w)
+      {
+        words[w] |= other[w];
+      }
+    return *this;
+  }
+
+  /**
+   * \param o the other bitset
+   * \return true if the bitsets have the same size and the same bits set
+   */
+  bool operator== (const NrBitset &o) const
+  {
+    if (m_size != o.m_size)
+      {
+        return false;
+      }
+    const uint64_t *words = Words ();
+    const uint64_t *other = o.Words ();
+    for (size_t w = 0; w < NumWords (); ++w)
+      {
+        if (words[w] != other[w])
+          {
+            return false;
+          }
+      }
+    return true;
+  }
+
+  /**
+   * \param o the other bitset
+   * \return true if the bitsets are different
+   */
+  bool operator!= (const NrBitset &o) const
+  {
+    return !(*this == o);
+  }
+
+private:
+  static const size_t INLINE_WORDS = 4; //!< Number of words stored inside the object
+
+  /**
+   * \return the number of words in use
+   */
+  size_t NumWords () const
+  {
+    return (m_size + 63) / 64;
+  }
+
+  /**
+   * \return the words
+   */
+  uint64_t * Words ()
+  {
+    return m_onHeap ? m_heap.data () : m_inline;
+  }
+
+  /**
+   * \return the words
+   */
+  const uint64_t * Words () const
+  {
+    return m_onHeap ? m_heap.data () : m_inline;
+  }
+
+  /**
+   * \brief Clear the bits of the last word that are beyond the size
+   */
+  void ClearTail ()
+  {
+    if (m_size % 64 != 0)
+      {
+        Words ()[m_size / 64] &= (static_cast<uint64_t> (1) << (m_size % 64)) - 1;
+      }
+  }
+
+  /**
+   * \param word the word
+   * \return the number of bits set in the word
+   */
+  static size_t PopCount (uint64_t word)
+  {
+#if defined (__GNUC__)
+    return static_cast<size_t> (__builtin_popcountll (word));
+#else
+    size_t n = 0;
+    while (word != 0)
+      {
+        word &= word - 1;
+        ++n;
+      }
+    return n;
+#endif
+  }
+
+  /**
+   * \param word the word, not 0
+   * \return the index of the lowest bit set
+   */
+  static size_t CountTrailingZeros (uint64_t word)
+  {
+#if defined (__GNUC__)
+    return static_cast<size_t> (__builtin_ctzll (word));
+#else
+    size_t n = 0;
+    while ((word & 1) == 0)
+      {
+        word >>= 1;
+        ++n;
+      }
+    return n;
+#endif
+  }
+
+  uint64_t m_inline[INLINE_WORDS] {}; //!< The words, when they are not more than INLINE_WORDS
+  std::vector<uint64_t> m_heap;       //!< The words, when they are more than INLINE_WORDS
+  size_t m_size {0};                  //!< Number of bits
+  bool m_onHeap {false};              //!< True if the words are in m_heap
+};
+
+/**
+ * \brief Print the bits of a NrBitset, separated by a space
+ * \param os the output stream
+ * \param bitset the bitset
+ * \return the output stream
+ */
+inline std::ostream &
+operator<< (std::ostream &os, const NrBitset &bitset)
+{
+  for (size_t i = 0; i < bitset.size (); ++i)
+    {
+      os << bitset.test (i) << " ";
+    }
+  return os;
+}
+
+} // namespace ns3
+
+#endif // NR_BITSET_H
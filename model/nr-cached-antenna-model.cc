@@ -0,0 +1,200 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-cached-antenna-model.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/double.h>
+#include <ns3/pointer.h>
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrCachedAntennaModel");
+NS_OBJECT_ENSURE_REGISTERED (NrCachedAntennaModel);
+
+TypeId
+NrCachedAntennaModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrCachedAntennaModel")
+    .SetParent<AntennaModel> ()
+    .SetGroupName ("Antenna")
+    .AddConstructor<NrCachedAntennaModel> ()
+    .AddAttribute ("Element",
+                   "The antenna element whose gain is tabulated",
+                   PointerValue (),
+                   MakePointerAccessor (&NrCachedAntennaModel::SetElement,
+                                        &NrCachedAntennaModel::GetElement),
+                   MakePointerChecker<AntennaModel> ())
+    .AddAttribute ("Resolution",
+                   "Step of the table, in degrees, in inclination and azimuth",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&NrCachedAntennaModel::SetResolution,
+                                       &NrCachedAntennaModel::GetResolution),
+                   MakeDoubleChecker<double> (0.01, 90.0))
+  ;
+  return tid;
+}
+
+NrCachedAntennaModel::NrCachedAntennaModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrCachedAntennaModel::~NrCachedAntennaModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrCachedAntennaModel::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_element = nullptr;
+  m_table.clear ();
+  AntennaModel::DoDispose ();
+}
+
+void
+NrCachedAntennaModel::SetElement (const Ptr<AntennaModel> &element)
+{
+  NS_LOG_FUNCTION (this << element);
+  m_element = element;
+  m_table.clear ();
+}
+
+Ptr<AntennaModel>
+NrCachedAntennaModel::GetElement () const
+{
+  return m_element;
+}
+
+void
+NrCachedAntennaModel::SetResolution (double resolution)
+{
+  NS_LOG_FUNCTION (this << resolution);
+  m_resolution = resolution;
+  m_table.clear ();
+}
+
+double
+NrCachedAntennaModel::GetResolution () const
+{
+  return m_resolution;
+}
+
+void
+NrCachedAntennaModel::BuildTable ()
+{
+  NS_LOG_FUNCTION (this);
+  if (! m_table.empty ())
+    {
+      return;
+    }
+  NS_ABORT_MSG_IF (m_element == nullptr, "NrCachedAntennaModel needs an element to tabulate");
+
+  m_numInclinations = static_cast<uint32_t> (std::ceil (180.0 / m_resolution)) + 1;
+  m_numAzimuths = static_cast<uint32_t> (std::ceil (360.0 / m_resolution)) + 1;
+  m_inclinationStep = 180.0 / (m_numInclinations - 1);
+  m_azimuthStep = 360.0 / (m_numAzimuths - 1);
+
+  m_table.resize (static_cast<size_t> (m_numInclinations) * m_numAzimuths);
+  for (uint32_t i = 0; i < m_numInclinations; ++i)
+    {
+      double inclination = DegreesToRadians (i * m_inclinationStep);
+      for (uint32_t j = 0; j < m_numAzimuths; ++j)
+        {
+          double azimuth = DegreesToRadians (-180.0 + j * m_azimuthStep);
+          m_table[i * m_numAzimuths + j] = m_element->GetGainDb (Angles (azimuth, inclination));
+        }
+    }
+
+  // The error is the largest at the centers of the cells
+  double maxError = 0.0;
+  double sumSquares = 0.0;
+  uint64_t count = 0;
+  for (uint32_t i = 0; i + 1 < m_numInclinations; ++i)
+    {
+      double inclinationDeg = (i + 0.5) * m_inclinationStep;
+      for (uint32_t j = 0; j + 1 < m_numAzimuths; ++j)
+        {
+          double azimuthDeg = -180.0 + (j + 0.5) * m_azimuthStep;
+          double exact = m_element->GetGainDb (Angles (DegreesToRadians (azimuthDeg),
+                                                       DegreesToRadians (inclinationDeg)));
+          double error = std::abs (Interpolate (inclinationDeg, azimuthDeg) - exact);
+          if (std::isfinite (error))
+            {
+              maxError = std::max (maxError, error);
+              sumSquares += error * error;
+              ++count;
+            }
+        }
+    }
+  m_maxErrorDb = maxError;
+  m_rmsErrorDb = count > 0 ? std::sqrt (sumSquares / count) : 0.0;
+  NS_LOG_INFO ("Element pattern table of " << m_numInclinations << "x" << m_numAzimuths <<
+               " gains, step " << m_resolution << " deg: max error " << m_maxErrorDb <<
+               " dB, RMS error " << m_rmsErrorDb << " dB");
+}
+
+double
+NrCachedAntennaModel::GetMaxErrorDb ()
+{
+  BuildTable ();
+  return m_maxErrorDb;
+}
+
+double
+NrCachedAntennaModel::GetRmsErrorDb ()
+{
+  BuildTable ();
+  return m_rmsErrorDb;
+}
+
+double
+NrCachedAntennaModel::Interpolate (double inclinationDeg, double azimuthDeg) const
+{
+  double x = std::min (std::max (inclinationDeg / m_inclinationStep, 0.0),
+                       static_cast<double> (m_numInclinations - 1));
+  double y = std::min (std::max ((azimuthDeg + 180.0) / m_azimuthStep, 0.0),
+                       static_cast<double> (m_numAzimuths - 1));
+  uint32_t i = std::min (static_cast<uint32_t> (x), m_numInclinations - 2);
+  uint32_t j = std::min (static_cast<uint32_t> (y), m_numAzimuths - 2);
+  double fx = x - i;
+  double fy = y - j;
+
+  const double *row0 = &m_table[i * m_numAzimuths + j];
+  const double *row1 = row0 + m_numAzimuths;
+  return (1 - fx) * ((1 - fy) * row0[0] + fy * row0[1])
+    + fx * ((1 - fy) * row1[0] + fy * row1[1]);
+}
+
+double
+NrCachedAntennaModel::GetGainDb (Angles a)
+{
+  if (m_table.empty ())
+    {
+      BuildTable ();
+    }
+  // Angles keeps the azimuth in [-pi, pi) and the inclination in [0, pi]
+  return Interpolate (RadiansToDegrees (a.GetInclination ()), RadiansToDegrees (a.GetAzimuth ()));
+}
+
+} // namespace ns3
@@ -0,0 +1,120 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_CACHED_ANTENNA_MODEL_H
+#define NR_CACHED_ANTENNA_MODEL_H
+
+#include <ns3/antenna-model.h>
+#include <ns3/angles.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup antenna
+ * \brief An antenna element whose gain is interpolated from a table
+ *
+ * The gain (dB) of the wrapped element (attribute "Element", e.g., a
+ * ThreeGppAntennaModel) is tabulated once on a grid of inclination in
+ * [0, 180] and azimuth in [-180, 180] degrees, with the step of the
+ * attribute "Resolution", and then bilinearly interpolated. The table is
+ * built at the first call, or with BuildTable; then the maximum and the
+ * RMS error against the wrapped element, at the centers of the cells of
+ * the grid, are logged and available with GetMaxErrorDb and
+ * GetRmsErrorDb.
+ *
+ * The same instance can be the "AntennaElement" of many arrays: the table
+ * is shared by all of them.
+ */
+class NrCachedAntennaModel : public AntennaModel
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  NrCachedAntennaModel ();
+  ~NrCachedAntennaModel () override;
+
+  double GetGainDb (Angles a) override;
+
+  /**
+   * \brief Set the element to tabulate
+   * \param element the element
+   */
+  void SetElement (const Ptr<AntennaModel> &element);
+
+  /**
+   * \return the element to tabulate
+   */
+  Ptr<AntennaModel> GetElement () const;
+
+  /**
+   * \brief Set the step of the table
+   * \param resolution the step, in degrees
+   */
+  void SetResolution (double resolution);
+
+  /**
+   * \return the step of the table, in degrees
+   */
+  double GetResolution () const;
+
+  /**
+   * \brief Build the table, if it is not built yet, and compute its error
+   */
+  void BuildTable ();
+
+  /**
+   * \return the maximum absolute error of the interpolation, in dB
+   */
+  double GetMaxErrorDb ();
+
+  /**
+   * \return the RMS error of the interpolation, in dB
+   */
+  double GetRmsErrorDb ();
+
+protected:
+  void DoDispose (void) override;
+
+private:
+  /**
+   * \brief Interpolate the table
+   * \param inclinationDeg the inclination, in [0, 180] degrees
+   * \param azimuthDeg the azimuth, in [-180, 180] degrees
+   * \return the interpolated gain, in dB
+   */
+  double Interpolate (double inclinationDeg, double azimuthDeg) const;
+
+  Ptr<AntennaModel> m_element;      //!< The tabulated element (attribute)
+  double m_resolution {1.0};        //!< Step of the table, in degrees (attribute)
+  uint32_t m_numInclinations {0};   //!< Rows of the table
+  uint32_t m_numAzimuths {0};       //!< Columns of the table
+  double m_inclinationStep {0.0};   //!< Actual step of the rows, in degrees
+  double m_azimuthStep {0.0};       //!< Actual step of the columns, in degrees
+  std::vector<double> m_table;      //!< The gains, inclination-major, in dB
+  double m_maxErrorDb {0.0};        //!< Maximum absolute error of the interpolation
+  double m_rmsErrorDb {0.0};        //!< RMS error of the interpolation
+};
+
+} // namespace ns3
+
+#endif // NR_CACHED_ANTENNA_MODEL_H
@@ -19,9 +19,14 @@
 
 #include "nr-ch-access-manager.h"
 #include <ns3/assert.h>
+#include <ns3/abort.h>
 #include <ns3/log.h>
 #include <ns3/double.h>
 #include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <ns3/nr-interference.h>
+#include <algorithm>
+#include <cmath>
 
 namespace ns3 {
 
@@ -153,5 +158,338 @@ NrAlwaysOnAccessManager::Cancel ()
   // is called
 }
 
+// -----------------------------------------------------------------
+
+/**
+ * \brief Parameters of a channel access priority class (TS 37.213 Table 4.1.1-1)
+ */
+struct Cat4PriorityClassParams
+{
+  uint32_t m_mp;    //!< Sensing slots of the defer period
+  uint32_t m_cwMin; //!< Minimum contention window
+  uint32_t m_cwMax; //!< Maximum contention window
+  Time m_mcot;      //!< Maximum channel occupancy time
+};
+
+static const Cat4PriorityClassParams &
+GetCat4PriorityClassParams (uint8_t priorityClass)
+{
+  static const Cat4PriorityClassParams params[4] =
+  {
+    {1, 3, 7, MilliSeconds (2)},
+    {1, 7, 15, MilliSeconds (3)},
+    {3, 15, 63, MilliSeconds (8)},
+    {7, 15, 1023, MilliSeconds (8)}
+  };
+  NS_ASSERT (priorityClass >= 1 && priorityClass <= 4);
+  return params[priorityClass - 1];
+}
+
+static const Time LBT_DEFER_INITIAL_PERIOD = MicroSeconds (16); //!< Fixed part of the defer period
+static const Time LBT_SENSING_SLOT = MicroSeconds (9);          //!< Duration of a sensing slot
+
+NS_OBJECT_ENSURE_REGISTERED (NrCat4LbtAccessManager);
+
+TypeId
+NrCat4LbtAccessManager::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrCat4LbtAccessManager")
+    .SetParent<NrChAccessManager> ()
+    .SetGroupName ("nr")
+    .AddConstructor <NrCat4LbtAccessManager> ()
+    .AddAttribute ("EnergyDetectionThreshold",
+                   "Energy over which the channel is sensed busy, in dBm",
+                   DoubleValue (-72.0),
+                   MakeDoubleAccessor (&NrCat4LbtAccessManager::SetEnergyDetectionThreshold,
+                                       &NrCat4LbtAccessManager::GetEnergyDetectionThreshold),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("PriorityClass",
+                   "Channel access priority class (1 to 4), that sets the defer "
+                   "period, the contention window limits and the maximum "
+                   "channel occupancy time",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (&NrCat4LbtAccessManager::SetPriorityClass,
+                                         &NrCat4LbtAccessManager::GetPriorityClass),
+                   MakeUintegerChecker<uint8_t> (1, 4))
+    .AddAttribute ("NackRatioThreshold",
+                   "Fraction of NACKs in the HARQ feedback of the last grant "
+                   "that doubles the contention window",
+                   DoubleValue (0.8),
+                   MakeDoubleAccessor (&NrCat4LbtAccessManager::m_nackRatioThreshold),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+  ;
+  return tid;
+}
+
+NrCat4LbtAccessManager::NrCat4LbtAccessManager () : NrChAccessManager ()
+{
+  NS_LOG_FUNCTION (this);
+  m_random = CreateObject<UniformRandomVariable> ();
+  m_cw = GetCat4PriorityClassParams (m_priorityClass).m_cwMin;
+}
+
+NrCat4LbtAccessManager::~NrCat4LbtAccessManager ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrCat4LbtAccessManager::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_event.Cancel ();
+  m_accessGrantedCb.clear ();
+  m_random = nullptr;
+  NrChAccessManager::DoDispose ();
+}
+
+void
+NrCat4LbtAccessManager::SetPriorityClass (uint8_t priorityClass)
+{
+  NS_LOG_FUNCTION (this << +priorityClass);
+  m_priorityClass = priorityClass;
+  m_cw = GetCat4PriorityClassParams (m_priorityClass).m_cwMin;
+}
+
+uint8_t
+NrCat4LbtAccessManager::GetPriorityClass () const
+{
+  return m_priorityClass;
+}
+
+void
+NrCat4LbtAccessManager::SetEnergyDetectionThreshold (double thresholdDbm)
+{
+  NS_LOG_FUNCTION (this << thresholdDbm);
+  m_edThresholdW = std::pow (10.0, (thresholdDbm - 30) / 10.0);
+}
+
+double
+NrCat4LbtAccessManager::GetEnergyDetectionThreshold () const
+{
+  return 10 * std::log10 (m_edThresholdW) + 30;
+}
+
+uint32_t
+NrCat4LbtAccessManager::GetCw () const
+{
+  return m_cw;
 }
 
+int64_t
+NrCat4LbtAccessManager::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_random->SetStream (stream);
+  return 1;
+}
+
+void
+NrCat4LbtAccessManager::SetNrGnbMac (Ptr<NrGnbMac> mac)
+{
+  NS_LOG_FUNCTION (this);
+  NrChAccessManager::SetNrGnbMac (mac);
+  if (mac != nullptr)
+    {
+      mac->TraceConnectWithoutContext ("DlHarqFeedback",
+                                       MakeCallback (&NrCat4LbtAccessManager::DoReceiveDlHarqFeedback, this));
+    }
+}
+
+void
+NrCat4LbtAccessManager::DoReceiveDlHarqFeedback (const DlHarqInfo &harqInfo)
+{
+  if (harqInfo.IsReceivedOk ())
+    {
+      ++m_acks;
+    }
+  else
+    {
+      ++m_nacks;
+    }
+}
+
+void
+NrCat4LbtAccessManager::RequestAccess ()
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_state == DEFER || m_state == BACKOFF || m_state == BUSY)
+    {
+      NS_LOG_INFO ("LBT already in progress");
+      return;
+    }
+
+  // A new request ends the previous occupancy, if any
+  m_event.Cancel ();
+  UpdateCw ();
+
+  if (! m_backoffDrawn)
+    {
+      m_backoff = m_random->GetInteger (0, m_cw);
+      m_backoffDrawn = true;
+      NS_LOG_INFO ("New backoff of " << m_backoff << " slots, CW " << m_cw);
+    }
+
+  StartDefer ();
+}
+
+void
+NrCat4LbtAccessManager::SetAccessGrantedCallback (const AccessGrantedCallback &cb)
+{
+  NS_LOG_FUNCTION (this);
+  m_accessGrantedCb.push_back (cb);
+}
+
+void
+NrCat4LbtAccessManager::SetAccessDeniedCallback ([[maybe_unused]] const NrChAccessManager::AccessDeniedCallback &cb)
+{
+  NS_LOG_FUNCTION (this);
+  // Don't store it: a busy channel only delays the grant, it is never denied
+}
+
+void
+NrCat4LbtAccessManager::Cancel ()
+{
+  NS_LOG_FUNCTION (this);
+  // The backoff counter is kept (frozen) for the next request
+  m_event.Cancel ();
+  m_state = IDLE;
+}
+
+bool
+NrCat4LbtAccessManager::IsChannelBusy ()
+{
+  Ptr<NrSpectrumPhy> spectrumPhy = GetNrSpectrumPhy ();
+  NS_ABORT_MSG_IF (spectrumPhy == nullptr, "The LBT needs the NrSpectrumPhy to sense the channel");
+  return spectrumPhy->GetNrInterference ()->IsChannelBusyNow (m_edThresholdW);
+}
+
+void
+NrCat4LbtAccessManager::StartDefer ()
+{
+  NS_LOG_FUNCTION (this);
+  m_state = DEFER;
+  m_deferSlotsLeft = GetCat4PriorityClassParams (m_priorityClass).m_mp;
+  m_event = Simulator::Schedule (LBT_DEFER_INITIAL_PERIOD,
+                                 &NrCat4LbtAccessManager::EndDeferInitialPeriod, this);
+}
+
+void
+NrCat4LbtAccessManager::EndDeferInitialPeriod ()
+{
+  NS_LOG_FUNCTION (this);
+  if (IsChannelBusy ())
+    {
+      WaitForIdle ();
+      return;
+    }
+  m_event = Simulator::Schedule (LBT_SENSING_SLOT, &NrCat4LbtAccessManager::EndDeferSlot, this);
+}
+
+void
+NrCat4LbtAccessManager::EndDeferSlot ()
+{
+  NS_LOG_FUNCTION (this);
+  if (IsChannelBusy ())
+    {
+      WaitForIdle ();
+      return;
+    }
+
+  NS_ASSERT (m_deferSlotsLeft > 0);
+  if (--m_deferSlotsLeft > 0)
+    {
+      m_event = Simulator::Schedule (LBT_SENSING_SLOT, &NrCat4LbtAccessManager::EndDeferSlot, this);
+    }
+  else if (m_backoff == 0)
+    {
+      Grant ();
+    }
+  else
+    {
+      m_state = BACKOFF;
+      m_event = Simulator::Schedule (LBT_SENSING_SLOT, &NrCat4LbtAccessManager::EndBackoffSlot, this);
+    }
+}
+
+void
+NrCat4LbtAccessManager::EndBackoffSlot ()
+{
+  NS_LOG_FUNCTION (this);
+  if (IsChannelBusy ())
+    {
+      NS_LOG_INFO ("Backoff frozen at " << m_backoff << " slots");
+      WaitForIdle ();
+      return;
+    }
+
+  NS_ASSERT (m_backoff > 0);
+  if (--m_backoff > 0)
+    {
+      m_event = Simulator::Schedule (LBT_SENSING_SLOT, &NrCat4LbtAccessManager::EndBackoffSlot, this);
+    }
+  else
+    {
+      Grant ();
+    }
+}
+
+void
+NrCat4LbtAccessManager::WaitForIdle ()
+{
+  NS_LOG_FUNCTION (this);
+  m_state = BUSY;
+  Time busy = GetNrSpectrumPhy ()->GetNrInterference ()->GetEnergyDuration (m_edThresholdW);
+  // The energy may be back below the threshold already (e.g., a signal that
+  // ends now): sense again in the next slot
+  m_event = Simulator::Schedule (std::max (busy, LBT_SENSING_SLOT),
+                                 &NrCat4LbtAccessManager::StartDefer, this);
+}
+
+void
+NrCat4LbtAccessManager::Grant ()
+{
+  NS_LOG_FUNCTION (this);
+  m_state = GRANTED;
+  m_backoffDrawn = false;
+  m_acks = 0;
+  m_nacks = 0;
+
+  Time duration = std::min (GetCat4PriorityClassParams (m_priorityClass).m_mcot,
+                            GetGrantDuration ());
+  NS_LOG_INFO ("Channel granted for " << duration);
+  m_event = Simulator::Schedule (duration, &NrCat4LbtAccessManager::EndGrant, this);
+  for (const auto & cb : m_accessGrantedCb)
+    {
+      cb (duration);
+    }
+}
+
+void
+NrCat4LbtAccessManager::EndGrant ()
+{
+  NS_LOG_FUNCTION (this);
+  m_state = IDLE;
+}
+
+void
+NrCat4LbtAccessManager::UpdateCw ()
+{
+  NS_LOG_FUNCTION (this);
+  const Cat4PriorityClassParams &params = GetCat4PriorityClassParams (m_priorityClass);
+  uint32_t feedbacks = m_acks + m_nacks;
+  if (feedbacks > 0 && m_nacks >= m_nackRatioThreshold * feedbacks)
+    {
+      m_cw = std::min (2 * m_cw + 1, params.m_cwMax);
+    }
+  else if (feedbacks > 0)
+    {
+      m_cw = params.m_cwMin;
+    }
+  m_acks = 0;
+  m_nacks = 0;
+  NS_LOG_INFO ("CW is now " << m_cw);
+}
+
+}
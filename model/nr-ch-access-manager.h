@@ -20,6 +20,7 @@
 #include <ns3/object.h>
 #include <ns3/nstime.h>
 #include <ns3/event-id.h>
+#include <ns3/random-variable-stream.h>
 #include <functional>
 #include "nr-gnb-mac.h"
 #include "nr-spectrum-phy.h"
@@ -29,6 +30,8 @@
 
 namespace ns3 {
 
+class NrCat4LbtTestCase;
+
 /**
  * \ingroup nru
  * \brief The Channel Access Manager class
@@ -54,6 +57,7 @@ namespace ns3 {
  * attributes is reported below, in the Attributes section.
  *
  * \see NrAlwaysOnAccessManager
+ * \see NrCat4LbtAccessManager
  */
 class NrChAccessManager : public Object
 {
@@ -206,6 +210,183 @@ private:
   std::vector<AccessGrantedCallback> m_accessGrantedCb; //!< Access granted CB
 };
 
+/**
+ * \ingroup nru
+ * \brief A Channel access manager that implements the Cat-4 LBT of NR-U
+ *
+ * The channel is sensed with the energy detector of the NrInterference
+ * instance of the spectrum phy, against the threshold of the attribute
+ * EnergyDetectionThreshold. Upon a request, the manager waits for a defer
+ * period (16 us plus mp sensing slots of 9 us) with the channel idle, and
+ * then counts down a random backoff of N sensing slots, with N uniform in
+ * [0, CW]. The countdown is frozen while the channel is busy, and resumed
+ * after another defer period once the channel is idle again; the counter
+ * left by a cancelled request is kept for the next one. When the counter
+ * reaches zero the access is granted for the maximum channel occupancy time
+ * of the priority class (or the GrantDuration, if shorter).
+ *
+ * The parameters mp, CWmin, CWmax and MCOT depend on the channel access
+ * priority class (attribute PriorityClass), following TS 37.213 Table
+ * 4.1.1-1. The contention window is doubled (up to CWmax) at the next
+ * request if at least the fraction NackRatioThreshold of the DL HARQ
+ * feedback received during the last grant is a NACK, and reset to CWmin
+ * otherwise; without a gNB MAC (UE side) it stays at CWmin.
+ *
+ * Each sensing slot is a single query of the running total power kept by
+ * NrInterference (see NrInterference::GetCurrentPower), so its cost does not
+ * depend on the number of signals received. While the channel is busy, the
+ * manager does not sense every slot, but waits for the end of the energy
+ * already announced (NrInterference::GetEnergyDuration).
+ *
+ * The access is never denied: the request is retried until it succeeds, or
+ * it is cancelled.
+ *
+\verbatim
+  nrHelper->SetGnbChannelAccessManagerTypeId (NrCat4LbtAccessManager::GetTypeId());
+  nrHelper->SetGnbChannelAccessManagerAttribute ("PriorityClass", UintegerValue (3));
+  ...
+  nrHelper->InstallGnb ...
+\endverbatim
+ */
+class NrCat4LbtAccessManager : public NrChAccessManager
+{
+public:
+  friend NrCat4LbtTestCase;
+  /**
+   * \brief Get the type ID
+   * \return the type id
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief NrCat4LbtAccessManager constructor
+   */
+  NrCat4LbtAccessManager ();
+  /**
+    * \brief destructor
+    */
+  ~NrCat4LbtAccessManager () override;
+
+  // inherited
+  virtual void RequestAccess () override;
+  virtual void SetAccessGrantedCallback (const AccessGrantedCallback &cb) override;
+  virtual void SetAccessDeniedCallback (const AccessDeniedCallback &cb) override;
+  virtual void Cancel () override;
+  virtual void SetNrGnbMac (Ptr<NrGnbMac> mac) override;
+
+  /**
+   * \brief Set the channel access priority class
+   * \param priorityClass the class, from 1 to 4
+   */
+  void SetPriorityClass (uint8_t priorityClass);
+  /**
+   * \brief Get the channel access priority class
+   * \return the class, from 1 to 4
+   */
+  uint8_t GetPriorityClass () const;
+
+  /**
+   * \brief Set the energy detection threshold
+   * \param thresholdDbm the threshold, in dBm
+   */
+  void SetEnergyDetectionThreshold (double thresholdDbm);
+  /**
+   * \brief Get the energy detection threshold
+   * \return the threshold, in dBm
+   */
+  double GetEnergyDetectionThreshold () const;
+
+  /**
+   * \brief Get the current contention window
+   * \return the contention window, in sensing slots
+   */
+  uint32_t GetCw () const;
+
+  /**
+   * \brief Assign a fixed random variable stream number to the random
+   * variables used by this model
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+protected:
+  virtual void DoDispose () override;
+
+private:
+  /**
+   * \brief State of the LBT procedure
+   */
+  enum LbtState
+  {
+    IDLE,     //!< No request pending
+    DEFER,    //!< Sensing the defer period
+    BACKOFF,  //!< Counting down the backoff
+    BUSY,     //!< Waiting for the end of the energy on the channel
+    GRANTED   //!< Channel granted
+  };
+
+  /**
+   * \brief Sense the channel now
+   * \return true if the energy on the channel is above the threshold
+   */
+  bool IsChannelBusy ();
+  /**
+   * \brief Start a defer period
+   */
+  void StartDefer ();
+  /**
+   * \brief Sense the 16 us at the beginning of the defer period
+   */
+  void EndDeferInitialPeriod ();
+  /**
+   * \brief Sense one sensing slot of the defer period
+   */
+  void EndDeferSlot ();
+  /**
+   * \brief Sense one sensing slot of the backoff
+   */
+  void EndBackoffSlot ();
+  /**
+   * \brief The channel has been sensed busy: wait until it is idle, then defer
+   */
+  void WaitForIdle ();
+  /**
+   * \brief Grant the channel
+   */
+  void Grant ();
+  /**
+   * \brief End of the channel occupancy
+   */
+  void EndGrant ();
+  /**
+   * \brief Update the contention window with the HARQ feedback of the last
+   * grant
+   */
+  void UpdateCw ();
+  /**
+   * \brief Count the DL HARQ feedback received from the MAC
+   * \param harqInfo the feedback
+   */
+  void DoReceiveDlHarqFeedback (const DlHarqInfo &harqInfo);
+
+  double m_edThresholdW {0.0};   //!< Energy detection threshold, in W
+  uint8_t m_priorityClass {3};   //!< Channel access priority class
+  double m_nackRatioThreshold {0.8}; //!< NACK fraction that doubles the CW
+
+  LbtState m_state {IDLE};       //!< State of the LBT
+  uint32_t m_cw {0};             //!< Contention window
+  uint32_t m_backoff {0};        //!< Remaining backoff slots
+  bool m_backoffDrawn {false};   //!< True if m_backoff has been drawn and not finished
+  uint32_t m_deferSlotsLeft {0}; //!< Remaining sensing slots of the defer period
+  uint32_t m_acks {0};           //!< ACKs received during the last grant
+  uint32_t m_nacks {0};          //!< NACKs received during the last grant
+  EventId m_event;               //!< Next sensing (or end of grant) event
+
+  Ptr<UniformRandomVariable> m_random; //!< Random variable for the backoff
+  std::vector<AccessGrantedCallback> m_accessGrantedCb; //!< Access granted CB
+};
+
 }
 
 #endif /* NR_CH_ACCESS_MANAGER_H_ */
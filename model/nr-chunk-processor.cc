@@ -0,0 +1,133 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-chunk-processor.h"
+#include "nr-counters.h"
+#include "nr-spectrum-kernels.h"
+#include <ns3/log.h>
+#include <ns3/spectrum-value.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrChunkProcessor");
+
+NrChunkProcessor::NrChunkProcessor ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrChunkProcessor::~NrChunkProcessor ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrChunkProcessor::AddCallback (LteChunkProcessorCallback c)
+{
+  NS_LOG_FUNCTION (this);
+  m_callbacks.push_back (c);
+}
+
+void
+NrChunkProcessor::SetEvaluatedRbs (const std::vector<int> &rbs)
+{
+  NS_LOG_FUNCTION (this << rbs.size ());
+  m_nextRbs = rbs;
+}
+
+void
+NrChunkProcessor::Start ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_rbs != m_nextRbs)
+    {
+      m_rbs = m_nextRbs;
+      m_clearAverage = true;
+    }
+  m_sums.clear ();
+  m_totDuration = Seconds (0);
+}
+
+void
+NrChunkProcessor::EvaluateChunk (const SpectrumValue& sinr, Time duration)
+{
+  NS_LOG_FUNCTION (this << sinr << duration);
+  if (m_average == nullptr || m_average->GetSpectrumModel () != sinr.GetSpectrumModel ())
+    {
+      m_average = Create<SpectrumValue> (sinr.GetSpectrumModel ());
+      NrCounters::Add (NrCounters::SPECTRUM_VALUES);
+      m_clearAverage = true;
+    }
+
+  double d = duration.GetSeconds ();
+  if (m_rbs.empty ())
+    {
+      m_sums.resize (sinr.GetValuesN (), 0.0);
+      NrScaledAddKernel (m_sums.data (), &(*sinr.ConstValuesBegin ()), d, m_sums.size ());
+    }
+  else
+    {
+      m_sums.resize (m_rbs.size (), 0.0);
+      for (size_t i = 0; i < m_rbs.size (); ++i)
+        {
+          NS_ASSERT (m_rbs[i] >= 0 && static_cast<size_t> (m_rbs[i]) < sinr.GetValuesN ());
+          m_sums[i] += sinr[m_rbs[i]] * d;
+        }
+    }
+  m_totDuration += duration;
+}
+
+void
+NrChunkProcessor::End ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_totDuration.GetSeconds () <= 0)
+    {
+      NS_LOG_WARN ("m_numSinr == 0");
+      return;
+    }
+
+  double totDuration = m_totDuration.GetSeconds ();
+  if (m_rbs.empty ())
+    {
+      for (size_t rb = 0; rb < m_sums.size (); ++rb)
+        {
+          (*m_average)[rb] = m_sums[rb] / totDuration;
+        }
+    }
+  else
+    {
+      if (m_clearAverage)
+        {
+          (*m_average) = 0.0;
+          m_clearAverage = false;
+        }
+      for (size_t i = 0; i < m_rbs.size (); ++i)
+        {
+          (*m_average)[m_rbs[i]] = m_sums[i] / totDuration;
+        }
+    }
+
+  for (const auto & callback : m_callbacks)
+    {
+      callback (*m_average);
+    }
+}
+
+} // namespace ns3
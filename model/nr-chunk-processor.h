@@ -0,0 +1,72 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_CHUNK_PROCESSOR_H
+#define NR_CHUNK_PROCESSOR_H
+
+#include <ns3/lte-chunk-processor.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup spectrum
+ * \brief A chunk processor that can average the values of some RBs only
+ *
+ * It gives the same time average as LteChunkProcessor. When it is
+ * restricted to some RBs (see NrInterference::SetEvaluatedRbs), it only
+ * keeps the sums of those RBs, and reports 0 for the other ones. The sums
+ * and the reported SpectrumValue are reused from a reception to the next.
+ */
+class NrChunkProcessor : public LteChunkProcessor
+{
+public:
+  /**
+   * \brief NrChunkProcessor constructor
+   */
+  NrChunkProcessor ();
+  /**
+   * \brief ~NrChunkProcessor
+   */
+  virtual ~NrChunkProcessor () override;
+
+  // inherited from LteChunkProcessor
+  virtual void AddCallback (LteChunkProcessorCallback c) override;
+  virtual void Start () override;
+  virtual void EvaluateChunk (const SpectrumValue& sinr, Time duration) override;
+  virtual void End () override;
+
+  /**
+   * \brief Restrict the average to some RBs, from the next Start
+   * \param rbs the sorted indexes of the RBs, or empty for the whole band
+   */
+  void SetEvaluatedRbs (const std::vector<int> &rbs);
+
+private:
+  std::vector<LteChunkProcessorCallback> m_callbacks; //!< Callbacks notified at End
+  std::vector<int> m_nextRbs;     //!< RBs of the next reception, all if empty
+  std::vector<int> m_rbs;         //!< RBs of this reception, all if empty
+  std::vector<double> m_sums;     //!< Sum of value * duration of each RB of m_rbs (or of each RB)
+  Time m_totDuration;             //!< Duration of the chunks
+  Ptr<SpectrumValue> m_average;   //!< The reported average
+  bool m_clearAverage {true};     //!< Whether m_average has to be reset to 0 before reporting
+};
+
+} // namespace ns3
+
+#endif // NR_CHUNK_PROCESSOR_H
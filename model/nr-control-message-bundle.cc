@@ -0,0 +1,92 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-control-message-bundle.h"
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrControlMessageBundle");
+
+NrControlMessageBundle::NrControlMessageBundle (const std::list<Ptr<NrControlMessage> > &msgs)
+  : m_messages (msgs)
+{
+  NS_LOG_FUNCTION (this << msgs.size ());
+
+  // First pass: which RNTI have a DCI
+  for (const auto & msg : m_messages)
+    {
+      uint16_t rnti = GetRnti (msg);
+      if (rnti != 0)
+        {
+          m_messagesPerRnti[rnti];
+        }
+    }
+
+  // Second pass: each message goes to its RNTI, or to everybody
+  for (const auto & msg : m_messages)
+    {
+      uint16_t rnti = GetRnti (msg);
+      if (rnti != 0)
+        {
+          m_messagesPerRnti.at (rnti).push_back (msg);
+        }
+      else
+        {
+          m_broadcast.push_back (msg);
+          for (auto & v : m_messagesPerRnti)
+            {
+              v.second.push_back (msg);
+            }
+        }
+    }
+}
+
+const std::list<Ptr<NrControlMessage> > &
+NrControlMessageBundle::GetMessages () const
+{
+  return m_messages;
+}
+
+const std::list<Ptr<NrControlMessage> > &
+NrControlMessageBundle::GetMessages (uint16_t rnti) const
+{
+  auto it = m_messagesPerRnti.find (rnti);
+  if (it != m_messagesPerRnti.end ())
+    {
+      return it->second;
+    }
+  return m_broadcast;
+}
+
+uint16_t
+NrControlMessageBundle::GetRnti (const Ptr<NrControlMessage> &msg)
+{
+  if (msg->GetMessageType () == NrControlMessage::DL_DCI)
+    {
+      return StaticCast<NrDlDciMessage> (msg)->GetDciInfoElement ()->m_rnti;
+    }
+  else if (msg->GetMessageType () == NrControlMessage::UL_DCI)
+    {
+      return StaticCast<NrUlDciMessage> (msg)->GetDciInfoElement ()->m_rnti;
+    }
+  return 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,78 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_CONTROL_MESSAGE_BUNDLE_H
+#define NR_CONTROL_MESSAGE_BUNDLE_H
+
+#include "nr-control-messages.h"
+#include <ns3/ptr.h>
+#include <list>
+#include <unordered_map>
+
+namespace ns3 {
+
+/**
+ * \ingroup utils
+ * \brief The control messages of a DL CTRL frame, indexed by RNTI
+ *
+ * The gNB builds a bundle once for each DL CTRL it transmits, and all the
+ * receivers share it: the signal parameters copied by the channel for each
+ * receiver only copy the pointer. A DCI is addressed to the RNTI of its
+ * DciInfoElementTdma (0 means everybody); any other message is a broadcast.
+ * For each RNTI the bundle keeps the list of the broadcast messages and of
+ * the DCIs of that RNTI, in the order of transmission, so that a UE gets its
+ * messages without copying or scanning the DCIs of the other UEs.
+ *
+ * The bundle, and the lists it returns, must not be modified.
+ */
+class NrControlMessageBundle : public SimpleRefCount<NrControlMessageBundle>
+{
+public:
+  /**
+   * \brief Build the bundle and its index
+   * \param msgs the control messages, in the order of transmission
+   */
+  NrControlMessageBundle (const std::list<Ptr<NrControlMessage> > &msgs);
+
+  /**
+   * \return all the messages of the bundle
+   */
+  const std::list<Ptr<NrControlMessage> > & GetMessages () const;
+
+  /**
+   * \brief Get the messages that a UE has to process
+   * \param rnti the RNTI of the UE
+   * \return the broadcast messages and the DCIs of rnti, in the order of transmission
+   */
+  const std::list<Ptr<NrControlMessage> > & GetMessages (uint16_t rnti) const;
+
+  /**
+   * \param msg a control message
+   * \return the RNTI the message is addressed to, or 0 if it is a broadcast
+   */
+  static uint16_t GetRnti (const Ptr<NrControlMessage> &msg);
+
+private:
+  std::list<Ptr<NrControlMessage> > m_messages;  //!< All the messages
+  std::list<Ptr<NrControlMessage> > m_broadcast; //!< The broadcast messages
+  std::unordered_map<uint16_t, std::list<Ptr<NrControlMessage> > > m_messagesPerRnti; //!< Broadcast messages and DCIs of each RNTI with a DCI
+};
+
+} // namespace ns3
+
+#endif // NR_CONTROL_MESSAGE_BUNDLE_H
@@ -0,0 +1,143 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-counters.h"
+
+#include <ns3/abort.h>
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+
+#include <fstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrCounters");
+
+bool NrCounters::m_enabled = false;
+NrCounters::Values *NrCounters::m_current = nullptr;
+std::unordered_map<uint32_t, NrCounters::Values> NrCounters::m_values;
+
+NrCounters::Values &
+NrCounters::GetValues (uint16_t cellId, uint16_t bwpId)
+{
+  // The elements of an unordered_map are never moved: the pointer of the
+  // current context stays valid when other cells are added
+  return m_values[(static_cast<uint32_t> (cellId) << 16) | bwpId];
+}
+
+void
+NrCounters::SetEnabled (bool enabled)
+{
+  NS_LOG_FUNCTION (enabled);
+  if (m_current == nullptr)
+    {
+      m_current = &GetValues (0, 0);
+    }
+  m_enabled = enabled;
+}
+
+bool
+NrCounters::IsEnabled ()
+{
+  return m_enabled;
+}
+
+void
+NrCounters::Reset ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  // The values are zeroed in place, as a context may point to them
+  for (auto &it : m_values)
+    {
+      it.second.fill (0);
+    }
+}
+
+NrCounters::Snapshot
+NrCounters::GetSnapshot ()
+{
+  Snapshot snapshot;
+  for (const auto &it : m_values)
+    {
+      snapshot.emplace (Key (static_cast<uint16_t> (it.first >> 16), static_cast<uint16_t> (it.first & 0xFFFF)),
+                        it.second);
+    }
+  return snapshot;
+}
+
+std::string
+NrCounters::GetCounterName (Counter counter)
+{
+  static const std::array<std::string, NUM_COUNTERS> names {"phyEvents", "macEvents",
+                                                            "spectrumPhyEvents", "ctrlMessages",
+                                                            "spectrumValues", "errorModelCalls",
+                                                            "amcCalls", "channelMatrices",
+                                                            "beamformingSearches"};
+  return names.at (counter);
+}
+
+void
+NrCounters::PrintHeader (std::ostream &os)
+{
+  os << "% time(s)\tcellId\tbwpId";
+  for (uint32_t c = 0; c < NUM_COUNTERS; ++c)
+    {
+      os << "\t" << GetCounterName (static_cast<Counter> (c));
+    }
+  os << std::endl;
+}
+
+void
+NrCounters::Print (std::ostream &os, const Time &now, const Snapshot &snapshot)
+{
+  for (const auto &it : snapshot)
+    {
+      os << now.GetSeconds () << "\t" << it.first.first << "\t" << it.first.second;
+      for (const auto &value : it.second)
+        {
+          os << "\t" << value;
+        }
+      os << std::endl;
+    }
+}
+
+void
+NrCounters::StartPeriodicDump (const Time &period, const std::string &fileName)
+{
+  NS_LOG_FUNCTION (period << fileName);
+  NS_ABORT_MSG_IF (!period.IsStrictlyPositive (), "The period of the counters dump must be positive");
+
+  std::ofstream outFile (fileName, std::ofstream::out | std::ofstream::trunc);
+  NS_ABORT_MSG_IF (!outFile.is_open (), "Can't open file " << fileName);
+  PrintHeader (outFile);
+  Simulator::Schedule (period, &NrCounters::PeriodicDump, period, fileName);
+}
+
+void
+NrCounters::PeriodicDump (Time period, std::string fileName)
+{
+  NS_LOG_FUNCTION (period << fileName);
+
+  std::ofstream outFile (fileName, std::ofstream::out | std::ofstream::app);
+  NS_ABORT_MSG_IF (!outFile.is_open (), "Can't open file " << fileName);
+  Print (outFile, Simulator::Now (), GetSnapshot ());
+  Simulator::Schedule (period, &NrCounters::PeriodicDump, period, fileName);
+}
+
+} // namespace ns3
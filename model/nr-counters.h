@@ -0,0 +1,245 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_COUNTERS_H
+#define NR_COUNTERS_H
+
+#include <ns3/nstime.h>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace ns3 {
+
+/**
+ * \ingroup nr-utils
+ * \brief Registry of counters of the activity of the models, per cell and BWP
+ *
+ * The counters tell how much work the models did (events run, control
+ * messages sent, SpectrumValue allocated, error model and AMC calls,
+ * channel matrices generated, beamforming searches), so that a slow
+ * simulation can be related to the activity of its cells without a
+ * profiler.
+ *
+ * The work is charged to the cell and BWP of the current context. The
+ * events of NrGnbPhy, NrUePhy, NrSpectrumPhy and of the MACs open a Context
+ * with their cell and BWP: everything done in the event (e.g., the
+ * scheduler run by the slot of the gNB, the channel computed for a
+ * transmission, the CQI computed by a UE at the end of a reception) is
+ * charged to it. The work done outside any context is charged to the cell
+ * 0, BWP 0.
+ *
+ * The registry is global to the process and disabled by default. When it
+ * is disabled, counting costs the test of a boolean. It is enabled, and
+ * optionally dumped periodically to a file, by NrHelper::EnableCounters,
+ * and read by NrHelper::GetCounters.
+ */
+class NrCounters
+{
+public:
+  /**
+   * \brief The counters
+   */
+  enum Counter
+  {
+    PHY_EVENTS = 0,           //!< Events run by NrGnbPhy and NrUePhy
+    MAC_EVENTS = 1,           //!< Events run by the MACs
+    SPECTRUM_PHY_EVENTS = 2,  //!< Events run by NrSpectrumPhy, including the receptions started by the channel
+    CTRL_MESSAGES = 3,        //!< Control messages transmitted
+    SPECTRUM_VALUES = 4,      //!< SpectrumValue allocated by the module
+    ERROR_MODEL_CALLS = 5,    //!< Transport blocks evaluated by the error model
+    AMC_CALLS = 6,            //!< Calls to NrAmc
+    CHANNEL_MATRICES = 7,     //!< Channel matrices (re)generated, seen by the spectrum propagation loss model
+    BEAMFORMING_SEARCHES = 8, //!< Beamforming vectors searched by the beamforming helpers
+    NUM_COUNTERS = 9          //!< Number of counters
+  };
+
+  using Values = std::array<uint64_t, NUM_COUNTERS>; //!< The value of every counter
+  using Key = std::pair<uint16_t, uint16_t>;          //!< The cell ID and the BWP ID
+  using Snapshot = std::map<Key, Values>;             //!< The values of every cell and BWP
+
+  /**
+   * \brief Charges the work done during its life to a cell and BWP
+   *
+   * The context also counts one event of the counter given to the
+   * constructor, if any.
+   */
+  class Context
+  {
+  public:
+    /**
+     * \brief Enter the context of a cell and BWP
+     * \param cellId the cell ID
+     * \param bwpId the BWP ID
+     * \param event the counter of the event that opens the context, or NUM_COUNTERS
+     */
+    Context (uint16_t cellId, uint16_t bwpId, Counter event = NUM_COUNTERS)
+    {
+      if (m_enabled)
+        {
+          m_previous = m_current;
+          m_current = &GetValues (cellId, bwpId);
+          if (event != NUM_COUNTERS)
+            {
+              ++(*m_current)[event];
+            }
+        }
+    }
+
+    /**
+     * \brief Go back to the previous context
+     */
+    ~Context ()
+    {
+      if (m_previous != nullptr)
+        {
+          m_current = m_previous;
+        }
+    }
+
+    /**
+     * \brief Enter the context of the cell and BWP of an object
+     *
+     * The IDs are asked to the object only when the counting is enabled.
+     *
+     * \param owner an object with GetCellId () and GetBwpId (), e.g., a PHY or a MAC
+     * \param event the counter of the event that opens the context, or NUM_COUNTERS
+     */
+    template <class T>
+    Context (const T *owner, Counter event = NUM_COUNTERS)
+      : Context (m_enabled ? owner->GetCellId () : 0, m_enabled ? owner->GetBwpId () : 0, event)
+    {
+    }
+
+    Context (const Context &) = delete;
+    Context &operator= (const Context &) = delete;
+
+  private:
+    Values *m_previous {nullptr}; //!< The context to go back to, or nullptr if disabled
+  };
+
+  /**
+   * \brief Add to a counter of the current context
+   * \param counter the counter
+   * \param n the amount
+   */
+  static void Add (Counter counter, uint64_t n = 1)
+  {
+    if (m_enabled)
+      {
+        (*m_current)[counter] += n;
+      }
+  }
+
+  /**
+   * \brief Add to a counter of a cell and BWP
+   * \param cellId the cell ID
+   * \param bwpId the BWP ID
+   * \param counter the counter
+   * \param n the amount
+   */
+  static void Add (uint16_t cellId, uint16_t bwpId, Counter counter, uint64_t n = 1)
+  {
+    if (m_enabled)
+      {
+        GetValues (cellId, bwpId)[counter] += n;
+      }
+  }
+
+  /**
+   * \brief Enable or disable the counting
+   * \param enabled true to count
+   */
+  static void SetEnabled (bool enabled);
+
+  /**
+   * \return true if the counting is enabled
+   */
+  static bool IsEnabled ();
+
+  /**
+   * \brief Set all the counters to zero
+   */
+  static void Reset ();
+
+  /**
+   * \return the current value of the counters of every cell and BWP
+   */
+  static Snapshot GetSnapshot ();
+
+  /**
+   * \param counter the counter
+   * \return the name of the counter
+   */
+  static std::string GetCounterName (Counter counter);
+
+  /**
+   * \brief Print the header of the dump: the time, the cell, the BWP and the
+   * name of every counter
+   * \param os the output stream
+   */
+  static void PrintHeader (std::ostream &os);
+
+  /**
+   * \brief Print a snapshot, one line per cell and BWP, in the order of PrintHeader
+   * \param os the output stream
+   * \param now the time of the snapshot
+   * \param snapshot the snapshot
+   */
+  static void Print (std::ostream &os, const Time &now, const Snapshot &snapshot);
+
+  /**
+   * \brief Write the counters to a file every period
+   *
+   * The file is created with the header, and a snapshot is appended every
+   * period, starting from one period from now.
+   *
+   * \param period the period
+   * \param fileName the name of the file
+   */
+  static void StartPeriodicDump (const Time &period, const std::string &fileName);
+
+private:
+  /**
+   * \brief Get the counters of a cell and BWP, creating them if needed
+   * \param cellId the cell ID
+   * \param bwpId the BWP ID
+   * \return the counters
+   */
+  static Values &GetValues (uint16_t cellId, uint16_t bwpId);
+
+  /**
+   * \brief Append a snapshot to the dump file, and schedule the next one
+   * \param period the period
+   * \param fileName the name of the file
+   */
+  static void PeriodicDump (Time period, std::string fileName);
+
+  static bool m_enabled;       //!< Whether the counting is enabled
+  static Values *m_current;    //!< The counters of the current context
+  static std::unordered_map<uint32_t, Values> m_values; //!< The counters of each cell and BWP (cell ID << 16 | BWP ID)
+};
+
+} // namespace ns3
+
+#endif // NR_COUNTERS_H
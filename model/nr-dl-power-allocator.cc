@@ -0,0 +1,182 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-dl-power-allocator.h"
+#include <ns3/log.h>
+#include <ns3/double.h>
+#include <ns3/uinteger.h>
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrDlPowerAllocator");
+NS_OBJECT_ENSURE_REGISTERED (NrDlPowerAllocator);
+NS_OBJECT_ENSURE_REGISTERED (NrDlPowerAllocatorWaterFilling);
+NS_OBJECT_ENSURE_REGISTERED (NrDlPowerAllocatorCellEdge);
+
+TypeId
+NrDlPowerAllocator::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrDlPowerAllocator")
+    .SetParent<Object> ()
+    .SetGroupName ("Nr")
+    .AddAttribute ("MinPowerOffset",
+                   "The minimum power of an RBG, relative to a uniform allocation (dB)",
+                   DoubleValue (-6.0),
+                   MakeDoubleAccessor (&NrDlPowerAllocator::m_minPowerOffset),
+                   MakeDoubleChecker<double> (-30.0, 0.0))
+    .AddAttribute ("MaxPowerOffset",
+                   "The maximum power of an RBG, relative to a uniform allocation (dB)",
+                   DoubleValue (6.0),
+                   MakeDoubleAccessor (&NrDlPowerAllocator::m_maxPowerOffset),
+                   MakeDoubleChecker<double> (0.0, 30.0))
+    ;
+  return tid;
+}
+
+double
+NrDlPowerAllocator::GetMinPower () const
+{
+  return std::pow (10.0, m_minPowerOffset / 10.0);
+}
+
+double
+NrDlPowerAllocator::GetMaxPower () const
+{
+  return std::pow (10.0, m_maxPowerOffset / 10.0);
+}
+
+TypeId
+NrDlPowerAllocatorWaterFilling::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrDlPowerAllocatorWaterFilling")
+    .SetParent<NrDlPowerAllocator> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrDlPowerAllocatorWaterFilling> ()
+    ;
+  return tid;
+}
+
+void
+NrDlPowerAllocatorWaterFilling::AllocatePower (const std::vector<RbgInfo> &rbgs, std::vector<float> *power) const
+{
+  NS_LOG_FUNCTION (this << rbgs.size ());
+  power->assign (rbgs.size (), 1.0f);
+  if (rbgs.size () < 2)
+    {
+      return;
+    }
+
+  const double minPower = GetMinPower ();
+  const double maxPower = GetMaxPower ();
+  std::vector<double> inverse (rbgs.size ());
+  for (size_t i = 0; i < rbgs.size (); ++i)
+    {
+      inverse[i] = 1.0 / std::max (rbgs[i].m_sinr, 1e-6);
+    }
+  auto total = [&] (double level)
+    {
+      double sum = 0.0;
+      for (double inv : inverse)
+        {
+          sum += std::min (std::max (level - inv, minPower), maxPower);
+        }
+      return sum;
+    };
+
+  // The total power grows with the level: at low the RBGs are all at the
+  // minimum, at high all at the maximum, and 1 is between them
+  const auto bounds = std::minmax_element (inverse.begin (), inverse.end ());
+  double low = *bounds.first + minPower;
+  double high = *bounds.second + maxPower;
+  const double target = static_cast<double> (rbgs.size ());
+  for (uint32_t iteration = 0; iteration < 50 && high - low > 1e-9 * high; ++iteration)
+    {
+      double level = 0.5 * (low + high);
+      if (total (level) < target)
+        {
+          low = level;
+        }
+      else
+        {
+          high = level;
+        }
+    }
+
+  // Remove the residual error of the bisection, to keep the total power
+  double level = 0.5 * (low + high);
+  double scale = target / total (level);
+  for (size_t i = 0; i < rbgs.size (); ++i)
+    {
+      (*power)[i] = static_cast<float> (std::min (std::max (level - inverse[i], minPower), maxPower) * scale);
+    }
+}
+
+TypeId
+NrDlPowerAllocatorCellEdge::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrDlPowerAllocatorCellEdge")
+    .SetParent<NrDlPowerAllocator> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrDlPowerAllocatorCellEdge> ()
+    .AddAttribute ("CellEdgeCqi",
+                   "The UEs whose wide-band CQI is not above this value are at the cell edge",
+                   UintegerValue (6),
+                   MakeUintegerAccessor (&NrDlPowerAllocatorCellEdge::m_cellEdgeCqi),
+                   MakeUintegerChecker<uint8_t> (0, 15))
+    .AddAttribute ("Boost",
+                   "The power of the RBGs of the cell-edge UEs, relative to a uniform allocation (dB). "
+                   "It is limited by MaxPowerOffset",
+                   DoubleValue (3.0),
+                   MakeDoubleAccessor (&NrDlPowerAllocatorCellEdge::m_boost),
+                   MakeDoubleChecker<double> (0.0))
+    ;
+  return tid;
+}
+
+void
+NrDlPowerAllocatorCellEdge::AllocatePower (const std::vector<RbgInfo> &rbgs, std::vector<float> *power) const
+{
+  NS_LOG_FUNCTION (this << rbgs.size ());
+  power->assign (rbgs.size (), 1.0f);
+
+  size_t numEdge = std::count_if (rbgs.begin (), rbgs.end (),
+                                  [this] (const RbgInfo &rbg) { return rbg.m_wbCqi <= m_cellEdgeCqi; });
+  size_t numOther = rbgs.size () - numEdge;
+  if (numEdge == 0 || numOther == 0)
+    {
+      return;
+    }
+
+  // The edge RBGs get the boost, the others what remains, down to the minimum
+  double edge = std::min (std::pow (10.0, m_boost / 10.0), GetMaxPower ());
+  double other = (rbgs.size () - edge * numEdge) / numOther;
+  if (other < GetMinPower ())
+    {
+      other = GetMinPower ();
+      edge = (rbgs.size () - other * numOther) / numEdge;
+    }
+  for (size_t i = 0; i < rbgs.size (); ++i)
+    {
+      (*power)[i] = static_cast<float> (rbgs[i].m_wbCqi <= m_cellEdgeCqi ? edge : other);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,134 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_DL_POWER_ALLOCATOR_H
+#define NR_DL_POWER_ALLOCATOR_H
+
+#include <ns3/object.h>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief Share the DL power of a transmission among its RBGs
+ *
+ * NrMacSchedulerNs3, when it has one (attribute DlPowerAllocator), calls it
+ * once the DL DATA of a slot is scheduled, for each set of DCIs sent
+ * together (same starting symbol and MU-MIMO layer). The weights it returns
+ * are stored in the DCIs, and NrGnbPhy multiplies the power of each RB of
+ * the TX PSD by the weight of its RBG. The weights have a mean of 1 over the
+ * RBGs of the set, so the total TX power does not change; they are bounded
+ * by MinPowerOffset and MaxPowerOffset, so that no scheduled RBG is left
+ * without power. The MCS of the DCIs is not changed: it is the one chosen
+ * for a uniform power, and the outer loop link adaptation, if any, follows
+ * the new SINR.
+ */
+class NrDlPowerAllocator : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief The RBG of a transmission
+   */
+  struct RbgInfo
+  {
+    uint16_t m_rnti {0};    //!< The UE of the RBG
+    double m_sinr {0.0};    //!< The SINR of the UE on the RBG with a uniform power (linear), from its CQI
+    uint8_t m_wbCqi {0};    //!< The wide-band CQI of the UE
+  };
+
+  /**
+   * \brief Compute the power of the RBGs of a transmission
+   * \param rbgs the RBGs
+   * \param power the weight of the power of each RBG, relative to a uniform
+   * allocation: its size is the one of rbgs, and its mean is 1
+   */
+  virtual void AllocatePower (const std::vector<RbgInfo> &rbgs, std::vector<float> *power) const = 0;
+
+protected:
+  /**
+   * \return the minimum weight (linear)
+   */
+  double GetMinPower () const;
+
+  /**
+   * \return the maximum weight (linear)
+   */
+  double GetMaxPower () const;
+
+private:
+  double m_minPowerOffset {-6.0};   //!< The minimum weight (dB) (attribute)
+  double m_maxPowerOffset {6.0};    //!< The maximum weight (dB) (attribute)
+};
+
+/**
+ * \ingroup scheduler
+ * \brief Water-filling over the RBGs of a transmission
+ *
+ * The weight of an RBG of SINR g is p = min (max (mu - 1 / g, min), max),
+ * the level mu being such that the mean of the weights is 1: it maximizes
+ * the sum of log2 (1 + p g), the Shannon capacity, within the bounds. The
+ * level is found by bisection, with a number of operations linear in the
+ * number of RBGs.
+ */
+class NrDlPowerAllocatorWaterFilling : public NrDlPowerAllocator
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  void AllocatePower (const std::vector<RbgInfo> &rbgs, std::vector<float> *power) const override;
+};
+
+/**
+ * \ingroup scheduler
+ * \brief Boost the RBGs of the cell-edge UEs
+ *
+ * The RBGs of the UEs whose wide-band CQI is not above CellEdgeCqi get the
+ * weight of Boost, and the other RBGs share what remains of the power; when
+ * they would get less than the minimum weight, the boost is reduced.
+ */
+class NrDlPowerAllocatorCellEdge : public NrDlPowerAllocator
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  void AllocatePower (const std::vector<RbgInfo> &rbgs, std::vector<float> *power) const override;
+
+private:
+  uint8_t m_cellEdgeCqi {6};        //!< The highest CQI of a cell-edge UE (attribute)
+  double m_boost {3.0};             //!< The weight of the cell-edge RBGs (dB) (attribute)
+};
+
+} // namespace ns3
+
+#endif // NR_DL_POWER_ALLOCATOR_H
@@ -0,0 +1,249 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-dynamic-tdd-controller.h"
+#include "nr-gnb-phy.h"
+#include "nr-mac-scheduler-ns3.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/simulator.h>
+#include <ns3/string.h>
+#include <ns3/uinteger.h>
+#include <ns3/double.h>
+#include <ns3/enum.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <unordered_map>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrDynamicTddController");
+NS_OBJECT_ENSURE_REGISTERED (NrDynamicTddController);
+
+TypeId
+NrDynamicTddController::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrDynamicTddController")
+    .SetParent<Object> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrDynamicTddController> ()
+    .AddAttribute ("Candidates",
+                   "The candidate patterns, separated by ';'",
+                   StringValue ("DL|DL|DL|DL|DL|DL|DL|DL|S|UL;"
+                                "DL|DL|DL|DL|DL|DL|S|UL|UL|UL;"
+                                "DL|DL|DL|DL|S|UL|UL|UL|UL|UL;"
+                                "DL|DL|S|UL|UL|UL|UL|UL|UL|UL"),
+                   MakeStringAccessor (&NrDynamicTddController::SetCandidates,
+                                       &NrDynamicTddController::GetCandidates),
+                   MakeStringChecker ())
+    .AddAttribute ("Period",
+                   "The number of frames between two decisions",
+                   UintegerValue (20),
+                   MakeUintegerAccessor (&NrDynamicTddController::m_periodFrames),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Coordination",
+                   "Independent: each cell follows its buffers. Common: all the cells "
+                   "follow the sum of their buffers, without cross-link interference",
+                   EnumValue (NrDynamicTddController::INDEPENDENT),
+                   MakeEnumAccessor (&NrDynamicTddController::m_coordination),
+                   MakeEnumChecker (NrDynamicTddController::INDEPENDENT, "Independent",
+                                    NrDynamicTddController::COMMON, "Common"))
+    .AddAttribute ("Hysteresis",
+                   "The pattern changes only when the new one is closer to the share of DL "
+                   "bytes by more than this share",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&NrDynamicTddController::m_hysteresis),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    ;
+  return tid;
+}
+
+void
+NrDynamicTddController::DoDispose ()
+{
+  m_event.Cancel ();
+  m_cells.clear ();
+  Object::DoDispose ();
+}
+
+std::vector<LteNrTddSlotType>
+NrDynamicTddController::ParsePattern (const std::string &pattern)
+{
+  static std::unordered_map<std::string, LteNrTddSlotType> lookupTable =
+  {
+    { "DL", LteNrTddSlotType::DL },
+    { "UL", LteNrTddSlotType::UL },
+    { "S",  LteNrTddSlotType::S },
+    { "F",  LteNrTddSlotType::F },
+  };
+
+  std::vector<LteNrTddSlotType> vector;
+  std::stringstream ss (pattern);
+  std::string token;
+  while (std::getline (ss, token, '|'))
+    {
+      auto it = lookupTable.find (token);
+      NS_ABORT_MSG_IF (it == lookupTable.end (),
+                       "Pattern type " << token << " not valid. Valid values are: DL UL F S");
+      vector.push_back (it->second);
+    }
+  NS_ABORT_MSG_IF (vector.empty (), "Empty TDD pattern");
+  return vector;
+}
+
+void
+NrDynamicTddController::SetCandidates (const std::string &candidates)
+{
+  m_candidates.clear ();
+  std::stringstream ss (candidates);
+  std::string pattern;
+  while (std::getline (ss, pattern, ';'))
+    {
+      m_candidates.push_back (ParsePattern (pattern));
+    }
+}
+
+std::string
+NrDynamicTddController::GetCandidates () const
+{
+  std::string candidates;
+  for (const auto &pattern : m_candidates)
+    {
+      candidates += (candidates.empty () ? "" : ";") + NrPhy::GetPattern (pattern);
+    }
+  return candidates;
+}
+
+double
+NrDynamicTddController::GetDlShare (const std::vector<LteNrTddSlotType> &pattern)
+{
+  double dl = 0.0;
+  for (LteNrTddSlotType type : pattern)
+    {
+      dl += type < LteNrTddSlotType::F ? 1.0 : type == LteNrTddSlotType::F ? 0.5 : 0.0;
+    }
+  return pattern.empty () ? 0.0 : dl / pattern.size ();
+}
+
+int32_t
+NrDynamicTddController::ChoosePattern (uint64_t dlBytes, uint64_t ulBytes,
+                                       const std::vector<LteNrTddSlotType> &current) const
+{
+  if (dlBytes + ulBytes == 0 || m_candidates.empty ())
+    {
+      return -1;
+    }
+
+  const double target = static_cast<double> (dlBytes) / (dlBytes + ulBytes);
+  int32_t best = 0;
+  double bestDistance = std::abs (GetDlShare (m_candidates[0]) - target);
+  for (size_t i = 1; i < m_candidates.size (); ++i)
+    {
+      double distance = std::abs (GetDlShare (m_candidates[i]) - target);
+      if (distance < bestDistance)
+        {
+          best = static_cast<int32_t> (i);
+          bestDistance = distance;
+        }
+    }
+
+  if (m_candidates[best] == current
+      || std::abs (GetDlShare (current) - target) - bestDistance <= m_hysteresis)
+    {
+      return -1;
+    }
+  return best;
+}
+
+void
+NrDynamicTddController::AddCell (const Ptr<NrGnbPhy> &phy, const Ptr<NrMacSchedulerNs3> &scheduler)
+{
+  NS_LOG_FUNCTION (this << phy << scheduler);
+  m_cells.push_back ({phy, scheduler});
+  if (!m_event.IsRunning ())
+    {
+      m_event = Simulator::Schedule (MilliSeconds (10 * m_periodFrames), &NrDynamicTddController::Evaluate, this);
+    }
+}
+
+void
+NrDynamicTddController::Evaluate ()
+{
+  NS_LOG_FUNCTION (this);
+  m_event = Simulator::Schedule (MilliSeconds (10 * m_periodFrames), &NrDynamicTddController::Evaluate, this);
+
+  if (m_coordination == INDEPENDENT)
+    {
+      for (const auto &cell : m_cells)
+        {
+          if (cell.m_phy->IsTddPatternChanging ())
+            {
+              continue;
+            }
+          int32_t chosen = ChoosePattern (cell.m_scheduler->GetBufferedBytes (true),
+                                          cell.m_scheduler->GetBufferedBytes (false),
+                                          ParsePattern (cell.m_phy->GetPattern ()));
+          if (chosen >= 0)
+            {
+              const auto &pattern = m_candidates[chosen];
+              NS_LOG_INFO ("Cell " << cell.m_phy->GetCellId () << " changes to " << NrPhy::GetPattern (pattern));
+              cell.m_phy->ChangeTddPattern (pattern, cell.m_phy->GetEarliestTddPatternChange (pattern));
+            }
+        }
+      return;
+    }
+
+  uint64_t dlBytes = 0;
+  uint64_t ulBytes = 0;
+  for (const auto &cell : m_cells)
+    {
+      if (cell.m_phy->IsTddPatternChanging ())
+        {
+          return;
+        }
+      dlBytes += cell.m_scheduler->GetBufferedBytes (true);
+      ulBytes += cell.m_scheduler->GetBufferedBytes (false);
+    }
+  if (m_cells.empty ())
+    {
+      return;
+    }
+
+  int32_t chosen = ChoosePattern (dlBytes, ulBytes, ParsePattern (m_cells.front ().m_phy->GetPattern ()));
+  if (chosen < 0)
+    {
+      return;
+    }
+
+  // The same switch slot for all the cells
+  const auto &pattern = m_candidates[chosen];
+  uint64_t switchSlot = 0;
+  for (const auto &cell : m_cells)
+    {
+      switchSlot = std::max (switchSlot, cell.m_phy->GetEarliestTddPatternChange (pattern));
+    }
+  NS_LOG_INFO ("All the cells change to " << NrPhy::GetPattern (pattern) << " at slot " << switchSlot);
+  for (const auto &cell : m_cells)
+    {
+      cell.m_phy->ChangeTddPattern (pattern, switchSlot);
+    }
+}
+
+} // namespace ns3
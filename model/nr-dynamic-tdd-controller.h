@@ -0,0 +1,140 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_DYNAMIC_TDD_CONTROLLER_H
+#define NR_DYNAMIC_TDD_CONTROLLER_H
+
+#include <ns3/object.h>
+#include <ns3/event-id.h>
+#include "nr-control-messages.h"
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+class NrGnbPhy;
+class NrMacSchedulerNs3;
+
+/**
+ * \ingroup gnb-phy
+ * \brief Choose the TDD pattern of some cells from their DL and UL buffers
+ *
+ * Every Period frames, the controller reads the bytes buffered in the DL
+ * and, as reported by the BSRs, in the UL of each cell (see
+ * NrMacSchedulerNs3::GetBufferedBytes), and picks among the Candidates the
+ * pattern whose share of DL slots is the closest to the share of DL bytes.
+ * The DL and S slots count as DL, the UL slots as UL, and the F slots as
+ * half of each. The pattern changes only when the new one is closer by
+ * more than Hysteresis, and through NrGnbPhy::ChangeTddPattern, which also
+ * changes it in the UEs.
+ *
+ * With the Independent coordination each cell follows its own buffers;
+ * with Common all the cells of the controller follow the sum of their
+ * buffers, and change at the same slot, so that neighbour cells do not
+ * suffer cross-link (gNB to gNB, UE to UE) interference; they must have the
+ * same pattern and numerology when they are added.
+ */
+class NrDynamicTddController : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief How the cells of the controller choose their pattern
+   */
+  enum Coordination
+  {
+    INDEPENDENT,   //!< Each cell from its buffers
+    COMMON         //!< All the cells the same pattern, from the sum of their buffers
+  };
+
+  /**
+   * \brief Control the pattern of a cell; the first call starts the periodic
+   * decisions
+   * \param phy the PHY of the cell
+   * \param scheduler the scheduler of the cell
+   */
+  void AddCell (const Ptr<NrGnbPhy> &phy, const Ptr<NrMacSchedulerNs3> &scheduler);
+
+  /**
+   * \brief Choose the pattern for some buffers
+   * \param dlBytes the DL buffered bytes
+   * \param ulBytes the UL buffered bytes
+   * \param current the current pattern
+   * \return the index of the chosen candidate, or -1 to keep the current pattern
+   */
+  int32_t ChoosePattern (uint64_t dlBytes, uint64_t ulBytes,
+                         const std::vector<LteNrTddSlotType> &current) const;
+
+  /**
+   * \param pattern a pattern
+   * \return the share of DL slots of the pattern
+   */
+  static double GetDlShare (const std::vector<LteNrTddSlotType> &pattern);
+
+  /**
+   * \brief Parse a pattern
+   * \param pattern slot types separated by '|', e.g. "DL|S|UL|UL"
+   * \return the pattern
+   */
+  static std::vector<LteNrTddSlotType> ParsePattern (const std::string &pattern);
+
+protected:
+  void DoDispose () override;
+
+private:
+  /**
+   * \brief Choose the patterns and schedule the next decision
+   */
+  void Evaluate ();
+
+  /**
+   * \brief Set the candidates
+   * \param candidates patterns separated by ';'
+   */
+  void SetCandidates (const std::string &candidates);
+
+  /**
+   * \return the candidates, separated by ';'
+   */
+  std::string GetCandidates () const;
+
+  /**
+   * \brief A controlled cell
+   */
+  struct Cell
+  {
+    Ptr<NrGnbPhy> m_phy;                  //!< The PHY
+    Ptr<NrMacSchedulerNs3> m_scheduler;   //!< The scheduler
+  };
+
+  std::vector<Cell> m_cells;                                  //!< The controlled cells
+  std::vector<std::vector<LteNrTddSlotType> > m_candidates;   //!< The candidate patterns (attribute)
+  uint32_t m_periodFrames {20};                               //!< Frames between two decisions (attribute)
+  Coordination m_coordination {INDEPENDENT};                  //!< How the cells choose (attribute)
+  double m_hysteresis {0.1};                                  //!< Minimum gain of DL share to change (attribute)
+  EventId m_event;                                            //!< The next decision
+};
+
+} // namespace ns3
+
+#endif // NR_DYNAMIC_TDD_CONTROLLER_H
@@ -59,7 +59,13 @@ NrEesmCcT1::GetMcsEcrTable() const
 const NrEesmErrorModel::SimulatedBlerFromSINR *
 NrEesmCcT1::GetSimulatedBlerFromSINR() const
 {
-  return m_t1.m_simulatedBlerFromSINR;
+  return m_t1.GetSimulatedBlerFromSINR ();
+}
+
+const NrEesmErrorModel::BlerTable *
+NrEesmCcT1::GetBlerTable () const
+{
+  return m_t1.m_blerTable;
 }
 
 const std::vector<uint8_t> *
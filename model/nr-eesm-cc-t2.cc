@@ -59,7 +59,13 @@ NrEesmCcT2::GetMcsEcrTable() const
 const NrEesmErrorModel::SimulatedBlerFromSINR *
 NrEesmCcT2::GetSimulatedBlerFromSINR() const
 {
-  return m_t2.m_simulatedBlerFromSINR;
+  return m_t2.GetSimulatedBlerFromSINR ();
+}
+
+const NrEesmErrorModel::BlerTable *
+NrEesmCcT2::GetBlerTable () const
+{
+  return m_t2.m_blerTable;
 }
 
 const std::vector<uint8_t> *
@@ -45,46 +45,16 @@ NrEesmCc::GetTypeId (void)
 
 
 double
-NrEesmCc::ComputeSINR (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs,
+NrEesmCc::ComputeSINR (const NrSinrValues& sinr, const std::vector<int>& map, uint8_t mcs,
                        [[maybe_unused]] uint32_t sizeBit,
-                         const NrErrorModel::NrErrorModelHistory &sinrHistory) const
+                         const NrErrorModel::NrErrorModelHistory &sinrHistory,
+                         const Ptr<NrEesmErrorModelOutput> &output) const
 {
   NS_LOG_FUNCTION (this);
 
   // HARQ CHASE COMBINING: update SINReff, but not ECR after retx
   // repetition of coded bits
 
-  // make a vector of history that contains the last tx (but without modifying
-  // sinrHistory, as it will be modified by the caller when it will be the time)
-  Ptr<NrEesmErrorModelOutput> last = Create<NrEesmErrorModelOutput> (0.0);
-  last->m_map = map;
-  last->m_sinr = sinr;
-
-  NrErrorModel::NrErrorModelHistory total = sinrHistory;
-  total.push_back (last);
-
-  // evaluate SINR_eff over "total", as per Chase Combining
-
-  NS_ASSERT (sinr.GetSpectrumModel()->GetNumBands() == sinr.GetValuesN());
-
-  SpectrumValue sinr_sum (sinr.GetSpectrumModel());
-  uint32_t historySize = static_cast<uint32_t> (total.size ());
-  uint32_t maxRBUsed = 0;
-  for (uint32_t i = 0; i < historySize; ++i)
-    {
-      Ptr<NrEesmErrorModelOutput> output = DynamicCast<NrEesmErrorModelOutput> (total.at(i));
-      maxRBUsed = std::max (maxRBUsed, static_cast<uint32_t> (output->m_map.size ()));
-    }
-
-  std::vector<int> map_sum;
-  map_sum.reserve (maxRBUsed);
-
-  for (uint32_t i = 0 ; i < maxRBUsed; ++i)
-    {
-      sinr_sum[i] = 0;
-      map_sum.push_back (static_cast<int> (i));
-    }
-
   /* combine at the bit level. Example:
    * SINR{1}=[0 0 10 20 10 0 0];
    * SINR{2}=[1 2 1 2 1 0 3];
@@ -98,25 +68,60 @@ NrEesmCc::ComputeSINR (const SpectrumValue& sinr, const std::vector<int>& map, u
    * SINR_SUM = [16 27 16 17 26 18]
    *
    * (the value at SINR_SUM[0] is SINR{1}[2] + SINR{2}[0] + SINR{3}[0])
+   *
+   * The last tx of the history keeps the combined SINRs of all the previous
+   * ones (SINR_SUM after the tx 2, in the example): when the new tx does not
+   * use more RBs than all the previous ones, it is just added to them.
    */
-  for (uint32_t i = 0; i < historySize; ++i)
+  const auto *previous = dynamic_cast<const NrEesmErrorModelOutput *> (PeekPointer (sinrHistory.back ()));
+  NS_ASSERT (previous != nullptr);
+  const std::vector<NrStorageReal> &previousSum = previous->m_sinrSum.empty () ? previous->m_sinrRb
+                                                                               : previous->m_sinrSum;
+  const std::vector<NrStorageReal> &current = output->m_sinrRb;
+  std::vector<NrStorageReal> &sum = output->m_sinrSum;
+
+  if (current.size () <= previousSum.size ())
+    {
+      sum = previousSum;
+    }
+  else
     {
-      Ptr<NrEesmErrorModelOutput> output = DynamicCast<NrEesmErrorModelOutput> (total.at(i));
-      uint32_t size = output->m_map.size ();
-      for (uint32_t j = 0 ; j < maxRBUsed; ++j)
+      // The new RBs wrap over the maps of all the previous tx:
+      // combine them again, in the order of the history
+      sum.assign (current.size (), 0.0);
+      for (const auto & element : sinrHistory)
         {
-          sinr_sum[j] += output->m_sinr [ output->m_map [ j % size ] ];
+          const std::vector<NrStorageReal> &sinrRb = static_cast<const NrEesmErrorModelOutput *> (PeekPointer (element))->m_sinrRb;
+          for (uint32_t j = 0; j < sum.size (); ++j)
+            {
+              sum[j] += sinrRb[j % sinrRb.size ()];
+            }
         }
     }
+  for (uint32_t j = 0; j < sum.size (); ++j)
+    {
+      sum[j] += current[j % current.size ()];
+    }
+
+  // evaluate SINR_eff over the combined SINRs, as per Chase Combining
+
+  NS_ASSERT (sum.size () <= sinr.m_numBands);
 
-  NS_LOG_INFO ("\tHISTORY:");
-  for (const auto & element : total)
+  // The instance is shared by all the PHYs, which can decode in worker
+  // threads: the buffers are per thread
+  static thread_local std::vector<double> sinrSumValues;
+  static thread_local std::vector<int> map_sum;
+  sinrSumValues.assign (sum.begin (), sum.end ());
+  map_sum.resize (sum.size ());
+  for (uint32_t i = 0 ; i < sum.size (); ++i)
     {
-      Ptr<NrEesmErrorModelOutput> output = DynamicCast<NrEesmErrorModelOutput> (element);
-      NS_LOG_INFO ("\tMAP:" << PrintMap (output->m_map));
-      NS_LOG_INFO ("\tSINR: " << output->m_sinr);
+      map_sum[i] = static_cast<int> (i);
     }
+  NrSinrValues sinr_sum (sinrSumValues.data (), static_cast<uint32_t> (sinrSumValues.size ()));
 
+  NS_LOG_INFO ("\tHISTORY: " << sinrHistory.size () << " previous tx");
+  NS_LOG_INFO ("\tMAP: " << PrintMap (map));
+  NS_LOG_INFO ("\tSINR: " << sinr);
   NS_LOG_INFO ("MAP_SUM: " << PrintMap (map_sum));
   NS_LOG_INFO ("SINR_SUM: " << sinr_sum);
 
@@ -125,7 +130,7 @@ NrEesmCc::ComputeSINR (const SpectrumValue& sinr, const std::vector<int>& map, u
 }
 
 double
-NrEesmCc::GetMcsEq (uint8_t mcsTx) const
+NrEesmCc::GetMcsEq (uint8_t mcsTx, [[maybe_unused]] double reff) const
 {
   NS_LOG_FUNCTION (this);
   return mcsTx;
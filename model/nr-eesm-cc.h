@@ -67,10 +67,13 @@ protected:
    * \param sizeBit the Transport block size in bits
    * \param mcs the MCS of the transmission
    * \param sinrHistory the History of the previous transmissions of the same block
+   * \param output the output of the current transmission, where the combined
+   * SINRs are stored for the next retransmission
    * \return The effective SINR
    */
-  double ComputeSINR (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs,
-                      uint32_t sizeBit, const NrErrorModel::NrErrorModelHistory &sinrHistory) const override;
+  double ComputeSINR (const NrSinrValues& sinr, const std::vector<int>& map, uint8_t mcs,
+                      uint32_t sizeBit, const NrErrorModel::NrErrorModelHistory &sinrHistory,
+                      const Ptr<NrEesmErrorModelOutput> &output) const override;
 
   /**
    * \brief Returns the MCS corresponding to the ECR after retransmissions. As the ECR
@@ -78,9 +81,10 @@ protected:
    * retransmissions, it returns current MCS.
    *
    * \param mcsTx the MCS of the transmission
+   * \param reff the equivalent effective code rate after the retransmissions (unused)
    * \return The equivalent MCS after retransmissions
    */
-  double GetMcsEq (uint8_t mcsTx) const override;
+  double GetMcsEq (uint8_t mcsTx, double reff) const override;
 };
 
 } // namespace ns3
@@ -22,6 +22,7 @@
 #include "nr-eesm-error-model.h"
 #include "ns3/log.h"
 #include <cmath>
+#include <cstring>
 #include <algorithm>
 #include "ns3/enum.h"
 #include "nr-phy-mac-common.h"
@@ -43,6 +44,109 @@ static const std::vector<uint16_t> LiftingSizeTableBG = {
 std::vector<std::string>
 NrEesmErrorModel::m_bgTypeName = { "BG1" , "BG2" };
 
+/**
+ * \brief Approximation of exp (x), for x not above a few units
+ * \param x the exponent
+ * \return exp (x), or zero when x is below -708
+ *
+ * Please see NrEesmErrorModel::SinrExp for the accuracy. The body has no
+ * branches, and the selects are done on the integer bits: a floating point
+ * comparison may raise an exception, and with the default -ftrapping-math
+ * GCC does not if-convert it, which kept the loop in FastExpSum scalar.
+ */
+static inline double
+FastExpTerm (double x)
+{
+  const double log2e = 1.4426950408889634;
+  const double ln2Hi = 6.93145751953125e-1;
+  const double ln2Lo = 1.42860682030941723212e-6;
+  // 1.5 * 2^52: adding it rounds to the nearest integer, which ends up in
+  // the low bits of the mantissa
+  const double shifter = 6755399441055744.0;
+  // -708, below which exp (x) is not a normal double. For negative values
+  // the bits grow with the magnitude, so x < -708 compares on the bits
+  const uint64_t minBits = UINT64_C (0xc086200000000000);
+
+  uint64_t xBits;
+  std::memcpy (&xBits, &x, sizeof (xBits));
+  const uint64_t keep = UINT64_C (0) - static_cast<uint64_t> (xBits <= minBits);
+  const uint64_t vBits = (xBits & keep) | (minBits & ~keep);
+  double v;
+  std::memcpy (&v, &vBits, sizeof (v));
+
+  const double t = v * log2e + shifter;
+  const double k = t - shifter;
+  const double r = (v - k * ln2Hi) - k * ln2Lo;
+
+  // Taylor expansion of exp (r), |r| <= ln(2)/2, error term below 1e-8
+  double p = 1.0 / 5040.0;
+  p = p * r + 1.0 / 720.0;
+  p = p * r + 1.0 / 120.0;
+  p = p * r + 1.0 / 24.0;
+  p = p * r + 1.0 / 6.0;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  p = p * r + 1.0;
+
+  // 2^k, built directly in the exponent bits from the low bits of t
+  uint64_t scaleBits;
+  std::memcpy (&scaleBits, &t, sizeof (scaleBits));
+  scaleBits = (scaleBits << 52) + (UINT64_C (1023) << 52);
+  double scale;
+  std::memcpy (&scale, &scaleBits, sizeof (scale));
+
+  // flush to zero below -708
+  const double term = p * scale;
+  uint64_t termBits;
+  std::memcpy (&termBits, &term, sizeof (termBits));
+  termBits &= keep;
+  double ret;
+  std::memcpy (&ret, &termBits, sizeof (ret));
+  return ret;
+}
+
+/**
+ * \brief Sum of exp (x[i]) over a contiguous buffer of non-positive exponents
+ * \param x the exponents
+ * \param n the number of exponents
+ * \return the sum of the exponentials
+ *
+ * The sum goes through independent partial accumulators, so that the
+ * compiler can vectorize the loop without reordering a single floating
+ * point reduction. The sse4.2 clone is needed for the 64-bit comparison of
+ * FastExpTerm; on aarch64 Advanced SIMD is part of the baseline, and no
+ * clone is needed.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+__attribute__ ((target_clones ("avx512f", "avx2", "sse4.2", "default")))
+#endif
+static double
+FastExpSum (const double *x, size_t n)
+{
+  const size_t lanes = 8;
+  double acc[lanes] = {};
+  size_t i = 0;
+
+  for (; i + lanes <= n; i += lanes)
+    {
+      for (size_t j = 0; j < lanes; ++j)
+        {
+          acc[j] += FastExpTerm (x[i + j]);
+        }
+    }
+
+  double sum = 0.0;
+  for (; i < n; ++i)
+    {
+      sum += FastExpTerm (x[i]);
+    }
+  for (size_t j = 0; j < lanes; ++j)
+    {
+      sum += acc[j];
+    }
+  return sum;
+}
+
 NrEesmErrorModel::NrEesmErrorModel () : NrErrorModel ()
 {
   NS_LOG_FUNCTION (this);
@@ -58,10 +162,57 @@ NrEesmErrorModel::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::NrEesmErrorModel")
     .SetParent<NrErrorModel> ()
+    .AddAttribute ("SinrExpKernel",
+                   "Kernel used to compute the sum of exponential SINRs of the EESM. "
+                   "ExactExp calls std::exp for each RB, while FastExp computes a "
+                   "vectorized approximation (relative error below 1e-8)",
+                   EnumValue (NrEesmErrorModel::EXACT_EXP),
+                   MakeEnumAccessor (&NrEesmErrorModel::SetSinrExpKernel,
+                                     &NrEesmErrorModel::GetSinrExpKernel),
+                   MakeEnumChecker (NrEesmErrorModel::EXACT_EXP, "ExactExp",
+                                    NrEesmErrorModel::FAST_EXP, "FastExp"))
+    .AddAttribute ("BlerMapping",
+                   "Mapping of the effective SINR into the BLER of a CB. "
+                   "Interpolation looks up the simulated SINR-BLER points, while Fit "
+                   "evaluates an erfc fit of the simulated curve (maximum deviation "
+                   "from the simulated points below 0.03), without any table search",
+                   EnumValue (NrEesmErrorModel::INTERPOLATION),
+                   MakeEnumAccessor (&NrEesmErrorModel::SetBlerMapping,
+                                     &NrEesmErrorModel::GetBlerMapping),
+                   MakeEnumChecker (NrEesmErrorModel::INTERPOLATION, "Interpolation",
+                                    NrEesmErrorModel::FIT, "Fit"))
   ;
   return tid;
 }
 
+void
+NrEesmErrorModel::SetSinrExpKernel (SinrExpKernel kernel)
+{
+  NS_LOG_FUNCTION (this);
+  m_sinrExpKernel = kernel;
+}
+
+NrEesmErrorModel::SinrExpKernel
+NrEesmErrorModel::GetSinrExpKernel () const
+{
+  NS_LOG_FUNCTION (this);
+  return m_sinrExpKernel;
+}
+
+void
+NrEesmErrorModel::SetBlerMapping (BlerMapping mapping)
+{
+  NS_LOG_FUNCTION (this);
+  m_blerMapping = mapping;
+}
+
+NrEesmErrorModel::BlerMapping
+NrEesmErrorModel::GetBlerMapping () const
+{
+  NS_LOG_FUNCTION (this);
+  return m_blerMapping;
+}
+
 TypeId
 NrEesmErrorModel::GetInstanceTypeId() const
 {
@@ -69,7 +220,7 @@ NrEesmErrorModel::GetInstanceTypeId() const
 }
 
 double
-NrEesmErrorModel::SinrEff (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs, double a, double b) const
+NrEesmErrorModel::SinrEff (const NrSinrValues& sinr, const std::vector<int>& map, uint8_t mcs, double a, double b) const
 {
   // it follows: SINReff = - beta * ln [1/b * (sum (exp (-sinr/beta)) + a)]
   // for HARQ-IR: b = sum (map.size()), a = sum_j(sum_n (exp (-sinr/beta))) (for previous retx, till j=q-1)
@@ -85,7 +236,7 @@ NrEesmErrorModel::SinrEff (const SpectrumValue& sinr, const std::vector<int>& ma
 }
 
 double
-NrEesmErrorModel::SinrExp (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs) const
+NrEesmErrorModel::SinrExp (const NrSinrValues& sinr, const std::vector<int>& map, uint8_t mcs) const
 {
   // it returns sum_n (exp (-SINR/beta))
   NS_LOG_FUNCTION (sinr << &map << (uint8_t) mcs);
@@ -95,6 +246,23 @@ NrEesmErrorModel::SinrExp (const SpectrumValue& sinr, const std::vector<int>& ma
   double SINRexp = 0.0;
   double SINRsum = 0.0;
   double beta = GetBetaTable ()->at (mcs);
+
+  if (m_sinrExpKernel == FAST_EXP)
+    {
+      // Gather the exponents of the allocated RBs in a contiguous buffer
+      const double *sinrValues = sinr.m_values;
+      // The instance is shared by all the PHYs: the buffer is per thread
+      static thread_local std::vector<double> sinrExpBuffer;
+      const double scale = -1.0 / beta;
+      sinrExpBuffer.resize (map.size ());
+      for (uint32_t i = 0; i < map.size (); i++)
+        {
+          NS_ASSERT (static_cast<uint32_t> (map[i]) < sinr.m_numBands);
+          sinrExpBuffer[i] = sinrValues[map[i]] * scale;
+        }
+      return FastExpSum (sinrExpBuffer.data (), sinrExpBuffer.size ());
+    }
+
   for (uint32_t i = 0; i < map.size (); i++)
     {
       double sinrLin = sinr [map.at (i)];
@@ -118,6 +286,57 @@ NrEesmErrorModel::GetBLERVectorFromSimulatedValues (NrEesmErrorModel::GraphType
   return std::get<1> (GetSimulatedBlerFromSINR ()->at (graphType).at (mcs).at (cbSizeIndex));
 }
 
+NrEesmErrorModel::BlerCurve
+NrEesmErrorModel::BlerTable::GetCurve (GraphType bgType, uint8_t mcs, uint32_t cbSize) const
+{
+  NS_ASSERT (static_cast<uint32_t> (bgType) < m_numBg);
+  NS_ASSERT (mcs < m_numMcs);
+  uint32_t row = static_cast<uint32_t> (bgType) * m_numMcs + mcs;
+
+  const uint32_t *first = m_cbSize + m_rowOffset[row];
+  const uint32_t *last = m_cbSize + m_rowOffset[row + 1];
+  const uint32_t *cbIt = std::upper_bound (first, last, cbSize);
+
+  if (cbIt != first)
+    {
+      cbIt--;
+    }
+
+  uint32_t cbIndex = static_cast<uint32_t> (cbIt - m_cbSize);
+  BlerCurve curve;
+  curve.m_sinrDb = m_sinrDb + m_pointOffset[cbIndex];
+  curve.m_bler = m_bler + m_pointOffset[cbIndex];
+  curve.m_size = m_pointOffset[cbIndex + 1] - m_pointOffset[cbIndex];
+  curve.m_cbSize = *cbIt;
+  curve.m_fitMean = m_fitMean[cbIndex];
+  curve.m_fitStdDev = m_fitStdDev[cbIndex];
+  return curve;
+}
+
+NrEesmErrorModel::SimulatedBlerFromSINR
+NrEesmErrorModel::BlerTable::GetNestedTable () const
+{
+  SimulatedBlerFromSINR table (m_numBg, std::vector<std::map<uint32_t, DoubleTuple>> (m_numMcs));
+  for (uint32_t bg = 0; bg < m_numBg; ++bg)
+    {
+      for (uint32_t mcs = 0; mcs < m_numMcs; ++mcs)
+        {
+          uint32_t row = bg * m_numMcs + mcs;
+          for (uint32_t cb = m_rowOffset[row]; cb < m_rowOffset[row + 1]; ++cb)
+            {
+              const double *sinrBegin = m_sinrDb + m_pointOffset[cb];
+              const double *sinrEnd = m_sinrDb + m_pointOffset[cb + 1];
+              const double *blerBegin = m_bler + m_pointOffset[cb];
+              const double *blerEnd = m_bler + m_pointOffset[cb + 1];
+              table[bg][mcs].emplace (m_cbSize[cb],
+                                      DoubleTuple (DoubleVector (sinrBegin, sinrEnd),
+                                                   DoubleVector (blerBegin, blerEnd)));
+            }
+        }
+    }
+  return table;
+}
+
 double
 NrEesmErrorModel::MappingSinrBler (double sinr, uint8_t mcs, uint32_t cbSizeBit)
 {
@@ -131,40 +350,43 @@ NrEesmErrorModel::MappingSinrBler (double sinr, uint8_t mcs, uint32_t cbSizeBit)
   double sinr_db = 10 * log10 (sinr);
   GraphType bg_type = GetBaseGraphType (cbSizeBit, mcs);
 
-  // Get the index of CBSIZE in the map
+  // Get the curve of CBSIZE in the table
   NS_LOG_INFO ("For sinr " << sinr << " and mcs " << +mcs <<
                 " CbSizebit " << cbSizeBit << " we got bg type " << m_bgTypeName[bg_type]);
-  auto cbMap = GetSimulatedBlerFromSINR ()->at (bg_type).at (mcs);
-  auto cbIt = cbMap.upper_bound (cbSizeBit);
+  const BlerCurve curve = GetBlerTable ()->GetCurve (bg_type, mcs, cbSizeBit);
+  const double *sinrBegin = curve.m_sinrDb;
+  const double *sinrEnd = curve.m_sinrDb + curve.m_size;
 
-  if (cbIt != cbMap.begin ())
+  if (m_blerMapping == FIT)
     {
-      cbIt--;
+      if (curve.m_fitStdDev > 0.0)
+        {
+          bler = 0.5 * std::erfc ((sinr_db - curve.m_fitMean) / (M_SQRT2 * curve.m_fitStdDev));
+        }
+      else
+        {
+          bler = sinr_db < curve.m_fitMean ? 1.0 : 0.0;
+        }
     }
-
-  if (sinr_db < GetSinrDbVectorFromSimulatedValues (bg_type, mcs, cbIt->first).front ())
+  else if (sinr_db < *sinrBegin)
     {
       bler = 1.0;
     }
-  else if (sinr_db > GetSinrDbVectorFromSimulatedValues (bg_type, mcs, cbIt->first).back ())
+  else if (sinr_db > *(sinrEnd - 1))
     {
       bler = 0.0;
     }
   else
     {
       // Get the index of SINR in the vector
-      auto sinrIt = std::upper_bound (GetSinrDbVectorFromSimulatedValues (bg_type, mcs, cbIt->first).begin (),
-                                      GetSinrDbVectorFromSimulatedValues (bg_type, mcs, cbIt->first).end (),
-                                      sinr_db);
+      const double *sinrIt = std::upper_bound (sinrBegin, sinrEnd, sinr_db);
 
-      if (sinrIt != GetSinrDbVectorFromSimulatedValues (bg_type, mcs, cbIt->first).begin ())
+      if (sinrIt != sinrBegin)
         {
           sinrIt--;
         }
 
-      auto sinr_index = std::distance (GetSinrDbVectorFromSimulatedValues (bg_type, mcs, cbIt->first).begin (),
-                                       sinrIt);
-      bler = GetBLERVectorFromSimulatedValues (bg_type, mcs, cbIt->first).at (sinr_index);
+      bler = curve.m_bler[std::distance (sinrBegin, sinrIt)];
     }
 
   NS_LOG_LOGIC ("SINR effective: " << sinr << " BLER:" << bler);
@@ -260,14 +482,82 @@ NrEesmErrorModel::CodeBlockSegmentation (uint32_t B, GraphType bg_type) const
   return std::make_pair(K,C);
 }
 
+NrEesmErrorModel::TbSegmentation
+NrEesmErrorModel::GetTbSegmentation (uint32_t sizeBit, uint8_t mcs) const
+{
+  std::lock_guard<std::mutex> lock (m_tbSegmentationsMutex);
+  return LookupTbSegmentation (sizeBit, mcs);
+}
+
+NrEesmErrorModel::TbSegmentation
+NrEesmErrorModel::LookupTbSegmentation (uint32_t sizeBit, uint8_t mcs) const
+{
+  // The TB sizes come from a finite set (MCS, RBs, symbols): the cache is
+  // bounded only to be safe with unusual users
+  static const size_t maxSegmentations = 16384;
+  uint64_t key = (static_cast<uint64_t> (sizeBit) << 8) | mcs;
+
+  auto it = m_tbSegmentations.find (key);
+  if (it != m_tbSegmentations.end ())
+    {
+      return it->second;
+    }
+
+  if (m_tbSegmentations.size () >= maxSegmentations)
+    {
+      m_tbSegmentations.clear ();
+    }
+
+  TbSegmentation segmentation;
+  // LDPC base graph type selection (1 or 2), as per TS 38.212, using the payload (A)
+  segmentation.m_bgType = GetBaseGraphType (sizeBit, mcs);
+  // code block segmentation, as per TS 38.212, using payload + TB CRC attachment (B)
+  uint32_t B = sizeBit + 24; // input to code block segmentation, in bits
+  std::pair<uint32_t, uint32_t> cbSeg = CodeBlockSegmentation (B, segmentation.m_bgType);
+  segmentation.m_cbSize = cbSeg.first;
+  segmentation.m_numCb = cbSeg.second;
+
+  m_tbSegmentations.emplace (key, segmentation);
+  return segmentation;
+}
+
 Ptr<NrErrorModelOutput>
-NrEesmErrorModel::GetTbDecodificationStats (const SpectrumValue& sinr, const std::vector<int>& map,
+NrEesmErrorModel::GetTbDecodificationStats (const NrSinrValues& sinr, const std::vector<int>& map,
                                             uint32_t size, uint8_t mcs,
                                             const NrErrorModelHistory &sinrHistory)
 {
   return GetTbBitDecodificationStats (sinr, map, size * 8, mcs, sinrHistory);
 }
 
+void
+NrEesmErrorModel::GetTbsDecodificationStats (const NrSinrValues& sinr,
+                                             const std::vector<TbDecodeInput> &tbs,
+                                             std::vector<Ptr<NrErrorModelOutput> > &outputs)
+{
+  NS_LOG_FUNCTION (this << tbs.size ());
+
+  // The instance is shared by all the PHYs: the buffer is per thread
+  static thread_local std::vector<TbSegmentation> segmentations;
+  segmentations.resize (tbs.size ());
+  {
+    std::lock_guard<std::mutex> lock (m_tbSegmentationsMutex);
+    for (size_t i = 0; i < tbs.size (); ++i)
+      {
+        NS_ABORT_IF (tbs[i].m_mcs > GetMaxMcs ());
+        segmentations[i] = LookupTbSegmentation (tbs[i].m_size * 8, tbs[i].m_mcs);
+      }
+  }
+
+  outputs.clear ();
+  outputs.reserve (tbs.size ());
+  for (size_t i = 0; i < tbs.size (); ++i)
+    {
+      const TbDecodeInput &tb = tbs[i];
+      outputs.emplace_back (DecodeTb (sinr, *tb.m_map, tb.m_size * 8, tb.m_mcs,
+                                      *tb.m_history, segmentations[i]));
+    }
+}
+
 std::string
 NrEesmErrorModel::PrintMap (const std::vector<int> &map) const
 {
@@ -282,7 +572,7 @@ NrEesmErrorModel::PrintMap (const std::vector<int> &map) const
 }
 
 Ptr<NrErrorModelOutput>
-NrEesmErrorModel::GetTbBitDecodificationStats (const SpectrumValue& sinr,
+NrEesmErrorModel::GetTbBitDecodificationStats (const NrSinrValues& sinr,
                                                const std::vector<int>& map,
                                                uint32_t sizeBit, uint8_t mcs,
                                                const NrErrorModelHistory &sinrHistory)
@@ -290,38 +580,72 @@ NrEesmErrorModel::GetTbBitDecodificationStats (const SpectrumValue& sinr,
   NS_LOG_FUNCTION (this);
   NS_ABORT_IF (mcs > GetMaxMcs ());
 
-  double tbSinr = SinrEff (sinr, map, mcs, 0, map.size());  // effective SINR for this tx
-  double SINR = tbSinr;
+  // LDPC base graph type selection and code block segmentation
+  return DecodeTb (sinr, map, sizeBit, mcs, sinrHistory, GetTbSegmentation (sizeBit, mcs));
+}
+
+Ptr<NrErrorModelOutput>
+NrEesmErrorModel::DecodeTb (const NrSinrValues& sinr, const std::vector<int>& map,
+                            uint32_t sizeBit, uint8_t mcs,
+                            const NrErrorModelHistory &sinrHistory,
+                            const TbSegmentation &segmentation)
+{
   double sinrExpSum = SinrExp (sinr, map, mcs);  // exponential sum of SINRs for this tx
+  // effective SINR for this tx, as SinrEff (sinr, map, mcs, 0, map.size ())
+  double tbSinr = -GetBetaTable ()->at (mcs) * log (sinrExpSum / map.size ());
+  NS_LOG_INFO (" Effective SINR = " << tbSinr);
+  double SINR = tbSinr;
+  double reff = 0.0;
 
   NS_LOG_DEBUG (" mcs " << +mcs << " TBSize in bit " << sizeBit <<
                 " history elements: " << sinrHistory.size () << " SINR of the tx: " <<
                 tbSinr << std::endl << "MAP: " << PrintMap (map) << std::endl <<
                 "SINR: " << sinr);
 
+  // The output of this tx, with the running sums of the HARQ process. The
+  // error rate is filled at the end
+  Ptr<NrEesmErrorModelOutput> ret = Create<NrEesmErrorModelOutput> (0.0);
+  ret->m_sinrRb.resize (map.size ());
+  for (uint32_t i = 0; i < map.size (); i++)
+    {
+      ret->m_sinrRb[i] = sinr[map[i]];
+    }
+  ret->m_infoBits = sizeBit;
+  ret->m_codeBits = sizeBit / GetMcsEcrTable ()->at (mcs);
+  ret->m_sinrExp = sinrExpSum;
+  ret->m_codeBitsSum = ret->m_codeBits;
+  ret->m_numRbSum = map.size ();
+
   if (sinrHistory.size () > 0)
     {
-      SINR = ComputeSINR (sinr, map, mcs, sizeBit, sinrHistory);
+      // the last tx carries the sums of all the previous ones. The decoding
+      // can run in a worker thread: the history is read through raw pointers,
+      // as the reference count of its elements is not atomic
+      const auto *previous = dynamic_cast<const NrEesmErrorModelOutput *> (PeekPointer (sinrHistory.back ()));
+      NS_ASSERT (previous != nullptr);
+      ret->m_sinrExp += previous->m_sinrExp;
+      ret->m_codeBitsSum += previous->m_codeBitsSum;
+      ret->m_numRbSum += previous->m_numRbSum;
+
+      SINR = ComputeSINR (sinr, map, mcs, sizeBit, sinrHistory, ret);
+
+      // equivalent effective code rate after the retransmissions
+      const auto *first = static_cast<const NrEesmErrorModelOutput *> (PeekPointer (sinrHistory.front ()));
+      reff = first->m_infoBits / static_cast<double> (ret->m_codeBitsSum);
     }
 
   NS_LOG_DEBUG (" SINR after processing all retx (if any): " << SINR << " SINR last tx" << tbSinr);
 
-  // LDPC base graph type selection (1 or 2), as per TS 38.212, using the payload (A)
-  GraphType bg_type = GetBaseGraphType (sizeBit, mcs);
-  NS_LOG_INFO ("BG type selection: " << bg_type);
-
-  // code block segmentation, as per TS 38.212, using payload + TB CRC attachment (B)
-  uint32_t B = sizeBit + 24; // input to code block segmentation, in bits
-  std::pair<uint32_t, uint32_t> cbSeg = CodeBlockSegmentation(B, bg_type);
-  uint32_t K = cbSeg.first;
-  uint32_t C = cbSeg.second;
-  NS_LOG_INFO ("EESMErrorModel: TBS of " << B << " bits distributed in " << C <<
+  uint32_t K = segmentation.m_cbSize;
+  uint32_t C = segmentation.m_numCb;
+  NS_LOG_INFO ("BG type selection: " << segmentation.m_bgType);
+  NS_LOG_INFO ("EESMErrorModel: TBS of " << sizeBit + 24 << " bits distributed in " << C <<
                " CBs of " << K << " bits");
 
   uint8_t mcs_eq = mcs;
   if ((sinrHistory.size () > 0) && (mcs > 0))
     {
-      mcs_eq = GetMcsEq (mcs);
+      mcs_eq = GetMcsEq (mcs, reff);
     }
 
   NS_LOG_INFO (" MCS of tx " << +mcs <<
@@ -341,21 +665,8 @@ NrEesmErrorModel::GetTbBitDecodificationStats (const SpectrumValue& sinr,
   NS_LOG_DEBUG ("Calculated Error rate " << errorRate);
   NS_ASSERT (GetMcsEcrTable () != nullptr);
 
-  Ptr<NrEesmErrorModelOutput> ret = Create<NrEesmErrorModelOutput> (errorRate);
+  ret->m_tbler = errorRate;
   ret->m_sinrEff = SINR;
-  ret->m_sinr = sinr;
-  ret->m_map = map;
-  if (sinrHistory.size () == 0)
-    {
-      ret->m_sinrExp =  sinrExpSum;  // it is first tx!
-    }
-  else
-    {
-      double m_sinrExpPrevious = DynamicCast<NrEesmErrorModelOutput> (sinrHistory.back ())->m_sinrExp;
-      ret->m_sinrExp = m_sinrExpPrevious + sinrExpSum;  // it sums over previous tx (recursively)
-    }
-  ret->m_infoBits = sizeBit;
-  ret->m_codeBits = sizeBit / GetMcsEcrTable ()->at (mcs);
 
   return ret;
 }
@@ -20,7 +20,10 @@
 #define NR_EESM_ERROR_MODEL_H
 
 #include "nr-error-model.h"
+#include "nr-storage-precision.h"
 #include <map>
+#include <mutex>
+#include <unordered_map>
 
 namespace ns3 {
 
@@ -47,12 +50,14 @@ struct NrEesmErrorModelOutput : public NrErrorModelOutput
   {
   }
 
-  double m_sinrExp {0.0};   //!< Sum of exponential SINR (needed for HARQ-IR)
-  double m_sinrEff {0.0};   //!< The effective SINR (needed just for the test)
-  SpectrumValue m_sinr;     //!< perceived SINRs in the whole bandwidth
-  std::vector<int> m_map;   //!< map of the active RBs
-  uint32_t m_infoBits {0};  //!< number of info bits
-  uint32_t m_codeBits {0};  //!< number of code bits
+  double m_sinrExp {0.0};          //!< Sum of exponential SINR of this and the previous tx (needed for HARQ-IR)
+  double m_sinrEff {0.0};          //!< The effective SINR (needed just for the test)
+  std::vector<NrStorageReal> m_sinrRb;  //!< perceived SINRs of the active RBs, in the order of the RB map
+  std::vector<NrStorageReal> m_sinrSum; //!< per-RB combined SINRs of this and the previous tx (HARQ-CC only, empty for the first tx)
+  uint32_t m_infoBits {0};         //!< number of info bits
+  uint32_t m_codeBits {0};         //!< number of code bits
+  uint32_t m_codeBitsSum {0};      //!< number of code bits of this and the previous tx
+  uint32_t m_numRbSum {0};         //!< number of active RBs of this and the previous tx
 };
 
 /**
@@ -100,6 +105,28 @@ public:
    */
   TypeId GetInstanceTypeId (void) const override;
 
+  /**
+   * \brief Kernel used to compute the sum of exponential SINRs
+   *
+   * \see SinrExp
+   */
+  enum SinrExpKernel
+  {
+    EXACT_EXP, //!< std::exp for each RB, as-is
+    FAST_EXP   //!< Vectorized exponential approximation over gathered SINRs
+  };
+
+  /**
+   * \brief Mapping of the effective SINR into the BLER of a CB
+   *
+   * \see MappingSinrBler
+   */
+  enum BlerMapping
+  {
+    INTERPOLATION, //!< Lookup of the simulated SINR-BLER points, as-is
+    FIT            //!< Analytic erfc fit of the simulated curve
+  };
+
   /**
    * \brief NrEesmErrorModel constructor
    */
@@ -109,6 +136,30 @@ public:
    */
   virtual ~NrEesmErrorModel () override;
 
+  /**
+   * \brief Set the kernel used to compute the sum of exponential SINRs
+   * \param kernel the kernel
+   */
+  void SetSinrExpKernel (SinrExpKernel kernel);
+
+  /**
+   * \brief Get the kernel used to compute the sum of exponential SINRs
+   * \return the kernel
+   */
+  SinrExpKernel GetSinrExpKernel () const;
+
+  /**
+   * \brief Set the mapping of the effective SINR into the BLER
+   * \param mapping the mapping
+   */
+  void SetBlerMapping (BlerMapping mapping);
+
+  /**
+   * \brief Get the mapping of the effective SINR into the BLER
+   * \return the mapping
+   */
+  BlerMapping GetBlerMapping () const;
+
   /**
    * \brief Get an output for the decodification error probability of a given
    * transport block, assuming the EESM method, NR LDPC coding and block
@@ -122,11 +173,27 @@ public:
    * \return A pointer to an output, with the tbler and SINR vector, effective
    * SINR, RB map, code bits, and info bits.
    */
-  virtual Ptr<NrErrorModelOutput> GetTbDecodificationStats (const SpectrumValue& sinr,
+  virtual Ptr<NrErrorModelOutput> GetTbDecodificationStats (const NrSinrValues& sinr,
                                                             const std::vector<int>& map,
                                                             uint32_t size, uint8_t mcs,
                                                             const NrErrorModelHistory &sinrHistory) override;
 
+  /**
+   * \brief Get the outputs of several transport blocks received with the
+   * same SINR vector
+   *
+   * The segmentations of all the TBs are looked up with one lock of the
+   * cache, and the exponential sum of the SINR of each TB is computed once
+   * for its effective SINR and its output.
+   *
+   * \param sinr SINR vector
+   * \param tbs the transport blocks, with their size in Bytes
+   * \param outputs the outputs, in the order of tbs (the vector is cleared first)
+   */
+  virtual void GetTbsDecodificationStats (const NrSinrValues& sinr,
+                                          const std::vector<TbDecodeInput> &tbs,
+                                          std::vector<Ptr<NrErrorModelOutput> > &outputs) override;
+
   /**
    * \brief Get the SE for a given CQI, following the CQIs in NR Table1/Table2
    * in TS38.214
@@ -164,6 +231,24 @@ public:
   typedef std::tuple<DoubleVector, DoubleVector> DoubleTuple;
   typedef std::vector<std::vector<std::map<uint32_t, DoubleTuple> > > SimulatedBlerFromSINR;
 
+  /**
+   * \brief Read-only view over the SINR-BLER points of one simulated curve
+   *
+   * The pointers refer to the contiguous storage of a BlerTable, so the curve
+   * is valid as long as that table is alive.
+   */
+  struct BlerCurve
+  {
+    const double *m_sinrDb {nullptr}; //!< SINR values (in dB) of the curve
+    const double *m_bler {nullptr};   //!< BLER values of the curve
+    uint32_t m_size {0};              //!< number of points of the curve
+    uint32_t m_cbSize {0};            //!< CB size (in bits) of the curve
+    double m_fitMean {0.0};           //!< mean (dB) of the erfc fit of the curve
+    double m_fitStdDev {0.0};         //!< standard deviation (dB) of the erfc fit, 0 for a step
+  };
+
+  class BlerTable;
+
 protected:
   /**
    * \brief function to print the RB map
@@ -191,18 +276,28 @@ protected:
    * \param b the denominator for the exponentials sum
    * \return the effective SINR
    */
-  double SinrEff (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs, double a, double b) const;
+  double SinrEff (const NrSinrValues& sinr, const std::vector<int>& map, uint8_t mcs, double a, double b) const;
 
   /**
    * \brief compute the sum of exponential SINRs for the specified MCS and SINR, according
    * to the EESM method, used in HARQ-IR
    *
+   * With the FAST_EXP kernel, the SINRs of the allocated RBs are first
+   * gathered in a contiguous buffer, and then the exponentials are computed
+   * with a range reduction (exp(x) = 2^k * exp(r), |r| <= ln(2)/2) followed
+   * by a degree-7 polynomial on r. The relative error of each exponential is
+   * below 1e-8, so the relative error of the sum is below 1e-8 as well, and
+   * the effective SINR differs from the EXACT_EXP one by less than
+   * beta * 1e-8 (in linear units). Exponentials below exp(-708) are
+   * flushed to zero. On x86-64 builds with GCC, the kernel is compiled for
+   * both AVX2 and the baseline ISA, and the version is selected at run time.
+   *
    * \param sinr the perceived sinrs in the whole bandwidth (vector, per RB)
    * \param map the actives RBs for the TB
    * \param mcs the MCS of the TB
    * \return the sum of exponential SINR
    */
-  double SinrExp (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs) const;
+  double SinrExp (const NrSinrValues& sinr, const std::vector<int>& map, uint8_t mcs) const;
 
   /**
    * \brief Compute the effective SINR after retransmission combining
@@ -211,28 +306,38 @@ protected:
    * \param mcs MCS of the transmission
    * \param sizeBit size (in bit) of the transmission
    * \param sinrHistory history of the SINR of the previous transmission
+   * \param output the output of the new transmission, with its own values
+   * and the running sums of the HARQ process already filled
    * \return the single SINR value
    *
    * Called in GetTbBitDecodificationStats(). Please implement this function
    * in a way that calculating the SINR of the new transmission
-   * takes in consideration the sinr history.
+   * takes in consideration the sinr history. The last element of the history
+   * carries the running sums of all the previous transmissions, so that the
+   * function does not need to walk the whole history; the values that the
+   * next transmission needs must be stored in output.
    *
    * \see NrEesmIr
    * \see NrEesmCc
    */
-  virtual double ComputeSINR (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs,
-                              uint32_t sizeBit, const NrErrorModel::NrErrorModelHistory &sinrHistory) const = 0;
+  virtual double ComputeSINR (const NrSinrValues& sinr, const std::vector<int>& map, uint8_t mcs,
+                              uint32_t sizeBit, const NrErrorModel::NrErrorModelHistory &sinrHistory,
+                              const Ptr<NrEesmErrorModelOutput> &output) const = 0;
 
   /**
    * \brief Get the "Equivalent MCS" after retransmission combining
    * \param mcsTx MCS of the transmission
+   * \param reff the equivalent effective code rate after the retransmissions:
+   * the information bits of the first transmission over the code bits of all
+   * of them
    * \return the equivalent MCS
    *
-   * Called in GetTbDecodificationStats()
+   * Called in GetTbDecodificationStats(). The instance is shared, and can be
+   * called from worker threads: it must not store per-TB values.
    * \see NrEesmIr
    * \see NrEesmCc
    */
-  virtual double GetMcsEq (uint8_t mcsTx) const = 0;
+  virtual double GetMcsEq (uint8_t mcsTx, double reff) const = 0;
 
   /**
    * \return pointer to a static vector that represents the beta table
@@ -246,6 +351,10 @@ protected:
    * \return pointer to a table of BLER vs SINR
    */
   virtual const SimulatedBlerFromSINR * GetSimulatedBlerFromSINR () const = 0;
+  /**
+   * \return pointer to the flat representation of the table of BLER vs SINR
+   */
+  virtual const BlerTable * GetBlerTable () const = 0;
   /**
    * \return pointer to a static vector that represents the MCS-M table
    */
@@ -261,6 +370,8 @@ protected:
 
 private:
   static std::vector<std::string> m_bgTypeName; //!< Base graph name
+  SinrExpKernel m_sinrExpKernel {EXACT_EXP}; //!< Kernel used in SinrExp
+  BlerMapping m_blerMapping {INTERPOLATION}; //!< Mapping used in MappingSinrBler
 
   /**
    * \brief map the effective SINR into CBLER for the specified MCS and CB size,
@@ -270,6 +381,11 @@ private:
    * \param mcs the MCS of the TB
    * \param cbSize the size of the CB in BITS
    * \return the code block error rate
+   *
+   * With the FIT mapping, the BLER is 0.5 * erfc ((SINR - mean) / (sqrt (2) * std)),
+   * with the SINR in dB and the coefficients of the simulated curve, fitted
+   * offline by utils/eesm-bler/generate-eesm-bler-tables.py (the maximum
+   * deviation from the simulated points is below 0.03).
    */
   double MappingSinrBler (double sinrEff, uint8_t mcs, uint32_t cbSize);
 
@@ -286,7 +402,7 @@ private:
    * \return A pointer to an output, with the tbler and SINR vector, effective
    * SINR, RB map, code bits, and info bits.
    */
-  Ptr<NrErrorModelOutput> GetTbBitDecodificationStats (const SpectrumValue& sinr,
+  Ptr<NrErrorModelOutput> GetTbBitDecodificationStats (const NrSinrValues& sinr,
                                                        const std::vector<int>& map,
                                                        uint32_t size, uint8_t mcs,
                                                        const NrErrorModelHistory &sinrHistory);
@@ -322,6 +438,56 @@ private:
   std::pair<uint32_t, uint32_t>
   CodeBlockSegmentation (uint32_t B, GraphType bg_type) const;
 
+  /**
+   * \brief The LDPC base graph and the code block segmentation of a TB
+   */
+  struct TbSegmentation
+  {
+    GraphType m_bgType {FIRST}; //!< base graph type
+    uint32_t m_cbSize {0};      //!< number of bits in each code block (K)
+    uint32_t m_numCb {0};       //!< number of code blocks (C)
+  };
+
+  /**
+   * \brief Get the base graph and the code block segmentation of a TB
+   * \param sizeBit the size of the TB (in bits) (A, payload, in TS 38.212)
+   * \param mcs the MCS of the TB
+   * \return the segmentation, from GetBaseGraphType and CodeBlockSegmentation
+   *
+   * The segmentations are memoized per (size, MCS), as the same few TB sizes
+   * are decoded over and over. The error model may be shared by spectrum
+   * phys that decode in parallel (NrRxWorkerPool): the cache is locked.
+   */
+  TbSegmentation GetTbSegmentation (uint32_t sizeBit, uint8_t mcs) const;
+
+  /**
+   * \brief Get the segmentation of a TB from the cache, or compute and store it
+   * \param sizeBit the size of the TB (in bits)
+   * \param mcs the MCS of the TB
+   * \return the segmentation
+   *
+   * The caller must hold m_tbSegmentationsMutex.
+   */
+  TbSegmentation LookupTbSegmentation (uint32_t sizeBit, uint8_t mcs) const;
+
+  /**
+   * \brief Evaluate a TB, once its segmentation is known
+   * \param sinr SINR vector
+   * \param map RB map
+   * \param sizeBit Transport block size in bits
+   * \param mcs MCS
+   * \param sinrHistory History of the retransmission
+   * \param segmentation the segmentation of the TB
+   * \return the output of GetTbBitDecodificationStats
+   */
+  Ptr<NrErrorModelOutput> DecodeTb (const NrSinrValues& sinr, const std::vector<int>& map,
+                                    uint32_t sizeBit, uint8_t mcs,
+                                    const NrErrorModelHistory &sinrHistory,
+                                    const TbSegmentation &segmentation);
+
+  mutable std::unordered_map<uint64_t, TbSegmentation> m_tbSegmentations; //!< memoized segmentations, by (TB size in bits, MCS)
+  mutable std::mutex m_tbSegmentationsMutex; //!< lock of m_tbSegmentations
+
   /**
    * \brief Get SinrDb Vector From Simulated Values
    * \param graphType
@@ -340,6 +506,79 @@ private:
   const std::vector<double> & GetBLERVectorFromSimulatedValues (GraphType graphType, uint8_t mcs, uint32_t cbSizeIndex) const;
 };
 
+/**
+ * \ingroup error-models
+ * \brief Flat, read-only layout of a SimulatedBlerFromSINR table
+ *
+ * The nested (base graph, MCS, CB size) maps of the simulated tables are
+ * packed in a few contiguous arrays: the sorted CB sizes of all the
+ * (base graph, MCS) pairs, and the SINR and BLER points of all the curves.
+ * A lookup returns a BlerCurve that points into these arrays, without
+ * copying any value. The table does not own the arrays: the tables of
+ * NrEesmT1 and NrEesmT2 are constexpr arrays, generated by
+ * utils/eesm-bler/generate-eesm-bler-tables.py, so that they need no work
+ * at startup.
+ */
+class NrEesmErrorModel::BlerTable
+{
+public:
+  /**
+   * \brief Build the table over the flat arrays
+   * \param numBg number of base graphs
+   * \param numMcs number of MCS for each base graph
+   * \param rowOffset first CB of each (base graph, MCS) in cbSize, plus the
+   * end (numBg * numMcs + 1 values)
+   * \param cbSize sorted CB sizes of each (base graph, MCS)
+   * \param pointOffset first point of each CB in sinrDb and bler, plus the end
+   * \param sinrDb SINR points (dB) of all the curves
+   * \param bler BLER points of all the curves
+   * \param fitMean mean (dB) of the erfc fit of each CB
+   * \param fitStdDev standard deviation (dB) of the erfc fit of each CB
+   */
+  constexpr BlerTable (uint32_t numBg, uint32_t numMcs, const uint32_t *rowOffset,
+                       const uint32_t *cbSize, const uint32_t *pointOffset,
+                       const double *sinrDb, const double *bler,
+                       const double *fitMean, const double *fitStdDev)
+    : m_numBg (numBg),
+      m_numMcs (numMcs),
+      m_rowOffset (rowOffset),
+      m_cbSize (cbSize),
+      m_pointOffset (pointOffset),
+      m_sinrDb (sinrDb),
+      m_bler (bler),
+      m_fitMean (fitMean),
+      m_fitStdDev (fitStdDev)
+  {
+  }
+
+  /**
+   * \brief Get the curve for the lowest simulated CB size that includes the CB
+   * \param bgType LDPC base graph type
+   * \param mcs MCS
+   * \param cbSize CB size in bits
+   * \return the curve of the greatest simulated CB size not greater than
+   * cbSize, or the curve of the smallest simulated CB size if cbSize is smaller
+   */
+  BlerCurve GetCurve (GraphType bgType, uint8_t mcs, uint32_t cbSize) const;
+
+  /**
+   * \brief Build the nested representation of the table
+   * \return the table, indexed by base graph, MCS and CB size
+   */
+  SimulatedBlerFromSINR GetNestedTable () const;
+
+private:
+  uint32_t m_numBg;                 //!< number of base graphs
+  uint32_t m_numMcs;                //!< number of MCS for each base graph
+  const uint32_t *m_rowOffset;      //!< first CB of each (base graph, MCS) in m_cbSize, plus the end
+  const uint32_t *m_cbSize;         //!< sorted CB sizes of each (base graph, MCS)
+  const uint32_t *m_pointOffset;    //!< first point of each CB in m_sinrDb and m_bler, plus the end
+  const double *m_sinrDb;           //!< SINR points (dB) of all the curves
+  const double *m_bler;             //!< BLER points of all the curves
+  const double *m_fitMean;          //!< mean (dB) of the erfc fit of each CB
+  const double *m_fitStdDev;        //!< standard deviation (dB) of the erfc fit of each CB
+};
+
 
 } // namespace ns3
 
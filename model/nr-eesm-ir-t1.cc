@@ -59,7 +59,13 @@ NrEesmIrT1::GetMcsEcrTable() const
 const NrEesmErrorModel::SimulatedBlerFromSINR *
 NrEesmIrT1::GetSimulatedBlerFromSINR() const
 {
-  return m_t1.m_simulatedBlerFromSINR;
+  return m_t1.GetSimulatedBlerFromSINR ();
+}
+
+const NrEesmErrorModel::BlerTable *
+NrEesmIrT1::GetBlerTable () const
+{
+  return m_t1.m_blerTable;
 }
 
 const std::vector<uint8_t> *
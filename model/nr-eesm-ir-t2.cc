@@ -58,7 +58,13 @@ NrEesmIrT2::GetMcsEcrTable() const
 const NrEesmErrorModel::SimulatedBlerFromSINR *
 NrEesmIrT2::GetSimulatedBlerFromSINR() const
 {
-  return m_t2.m_simulatedBlerFromSINR;
+  return m_t2.GetSimulatedBlerFromSINR ();
+}
+
+const NrEesmErrorModel::BlerTable *
+NrEesmIrT2::GetBlerTable () const
+{
+  return m_t2.m_blerTable;
 }
 
 const std::vector<uint8_t> *
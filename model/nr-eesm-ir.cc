@@ -45,44 +45,31 @@ NrEesmIr::GetTypeId (void)
 }
 
 double
-NrEesmIr::ComputeSINR (const SpectrumValue &sinr, const std::vector<int> &map,
-                         uint8_t mcs, uint32_t sizeBit,
-                         const NrErrorModel::NrErrorModelHistory &sinrHistory) const
+NrEesmIr::ComputeSINR (const NrSinrValues &sinr, const std::vector<int> &map,
+                         uint8_t mcs, [[maybe_unused]] uint32_t sizeBit,
+                         const NrErrorModel::NrErrorModelHistory &sinrHistory,
+                         const Ptr<NrEesmErrorModelOutput> &output) const
 {
   NS_LOG_FUNCTION (this);
   // HARQ INCREMENTAL REDUNDANCY: update SINReff and ECR after retx, assuming
   // no repetition of coded bits.
 
-  // compute equivalent effective code rate after retransmissions and total map size
-  uint32_t codeBitsSum = 0;
-  uint32_t infoBits = DynamicCast<NrEesmErrorModelOutput> (sinrHistory.front ())->m_infoBits;  // information bits of the first TB
-  double mapSumSize = 0.0;
+  // total map size: the output already has the sums over the previous tx and
+  // this one (the equivalent effective code rate is computed by DecodeTb)
+  const auto *previous = dynamic_cast<const NrEesmErrorModelOutput *> (PeekPointer (sinrHistory.back ()));
+  NS_ASSERT (previous != nullptr);
 
-  for (const Ptr<NrErrorModelOutput> & output : sinrHistory)
-    {
-      Ptr<NrEesmErrorModelOutput> sinrHistorytemp = DynamicCast<NrEesmErrorModelOutput> (output);
-      NS_ASSERT (sinrHistorytemp != nullptr);
-
-      NS_LOG_DEBUG (" Exponential SINR sum " << sinrHistorytemp->m_sinrExp <<
-                    " codeBits " << sinrHistorytemp->m_codeBits <<
-                    " infoBits: " << sinrHistorytemp->m_infoBits);
-
-      codeBitsSum += sinrHistorytemp->m_codeBits;
-      mapSumSize += sinrHistorytemp->m_map.size();
-    }
-  mapSumSize += map.size();
-  codeBitsSum += sizeBit / GetMcsEcrTable()->at (mcs);;
-  const_cast<NrEesmIr*> (this)->m_Reff = infoBits / static_cast<double> (codeBitsSum);
-
-  NS_LOG_INFO (" Reff " << m_Reff << " HARQ history (previous) " << sinrHistory.size ());
+  NS_LOG_DEBUG (" Exponential SINR sum of the previous tx " << previous->m_sinrExp <<
+                " codeBits " << output->m_codeBitsSum <<
+                " HARQ history (previous) " << sinrHistory.size ());
 
   // compute effective SINR with expSINR_previousTx and mapSumSize
-  double expSINR_previousTx = DynamicCast<NrEesmErrorModelOutput> (sinrHistory.back ())->m_sinrExp;
-  return SinrEff (sinr, map, mcs, expSINR_previousTx, mapSumSize);
+  double mapSumSize = output->m_numRbSum;
+  return SinrEff (sinr, map, mcs, previous->m_sinrExp, mapSumSize);
 }
 
 double
-NrEesmIr::GetMcsEq (uint8_t mcsTx) const
+NrEesmIr::GetMcsEq (uint8_t mcsTx, double reff) const
 {
   NS_LOG_FUNCTION (this);
   // PHY abstraction for HARQ-IR retx -> get closest ECR to Reff from the
@@ -93,13 +80,13 @@ NrEesmIr::GetMcsEq (uint8_t mcsTx) const
   uint8_t ModOrder = GetMcsMTable ()->at (mcsTx);
 
   NS_LOG_INFO (" Modulation order: " << +ModOrder );
-  NS_LOG_INFO (" Reff: " << m_Reff );
+  NS_LOG_INFO (" Reff: " << reff);
 
   for (uint8_t mcsindex = (mcsTx-1); mcsindex != 255; mcsindex--)
     // search from MCS=mcs-1 to MCS=0. end at 255 to account for wrap around of uint
     {
       if ((GetMcsMTable ()->at (mcsindex) == ModOrder) &&
-          (GetMcsEcrTable ()->at (mcsindex) > m_Reff))
+          (GetMcsEcrTable ()->at (mcsindex) > reff))
         {
           mcs_eq--;
         }
@@ -36,9 +36,6 @@ namespace ns3 {
  * number of coded bits of each of the previous retransmissions. Given the current
  * SINR vector and the HARQ history, the effective SINR is computed according to EESM.
  *
- * NOTE: The method GetMcsEq() must be called after ComputeSINR(), as it uses
- * the value m_Reff.
- *
  * Please, don't use this class directly, but one between NrEesmIrT1 or NrEesmIrT2,
  * depending on what table you want to use.
  *
@@ -64,31 +61,30 @@ protected:
   // Inherited from NrEesmErrorModel
   /**
    * \brief Computes the effective SINR after retransmission combining with HARQ-IR.
-   * Also, it updates the equivalent ECR after retransmissions (m_Reff).
    *
    * \param sinr the SINR vector of current transmission
    * \param map the RB map of current transmission
    * \param sizeBit the Transport block size in bits
    * \param mcs the MCS
    * \param sinrHistory the History of the previous transmissions of the same block
+   * \param output the output of the current transmission, with the running sums
    * \return The effective SINR
    */
-  double ComputeSINR (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs,
-                      uint32_t sizeBit, const NrErrorModel::NrErrorModelHistory &sinrHistory) const override;
+  double ComputeSINR (const NrSinrValues& sinr, const std::vector<int>& map, uint8_t mcs,
+                      uint32_t sizeBit, const NrErrorModel::NrErrorModelHistory &sinrHistory,
+                      const Ptr<NrEesmErrorModelOutput> &output) const override;
 
   /**
    * \brief Returns the MCS corresponding to the ECR after retransmissions. In case of
-   * HARQ-IR the equivalent ECR changes after retransmissions, and it is updated
-   * inside ComputeSINR function. GetMcsEq gets the closest ECR to m_Reff from
-   * the available ones that belong to the same modulation order.
+   * HARQ-IR the equivalent ECR changes after retransmissions. GetMcsEq gets the
+   * closest ECR to reff from the available ones that belong to the same
+   * modulation order.
    *
    * \param mcsTx the MCS of the transmission
+   * \param reff the equivalent effective code rate after the retransmissions
    * \return The equivalent MCS after retransmissions
    */
-  double GetMcsEq (uint8_t mcsTx) const override;
-
-private:
-  double m_Reff {0.0};  //!< equivalent effective code rate after retransmissions
+  double GetMcsEq (uint8_t mcsTx, double reff) const override;
 };
 
 } // namespace ns3
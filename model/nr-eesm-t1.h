@@ -48,9 +48,15 @@ struct NrEesmT1
    */
   NrEesmT1 ();
 
+  /**
+   * \brief Get the nested representation of the BLER from SINR table
+   * \return the table, built from m_blerTable the first time it is needed
+   */
+  const NrEesmErrorModel::SimulatedBlerFromSINR * GetSimulatedBlerFromSINR () const;
+
   const std::vector<double> *m_betaTable {nullptr};  //!< Beta table
   const std::vector<double> *m_mcsEcrTable {nullptr}; //!< MCS-ECR table
-  const NrEesmErrorModel::SimulatedBlerFromSINR *m_simulatedBlerFromSINR {nullptr}; //!< BLER from SINR table
+  const NrEesmErrorModel::BlerTable *m_blerTable {nullptr}; //!< Flat layout of the BLER from SINR table
   const std::vector<uint8_t> *m_mcsMTable {nullptr}; //!< MCS-M table
   const std::vector<double> *m_spectralEfficiencyForMcs {nullptr}; //!< Spectral-efficiency for MCS
   const std::vector<double> *m_spectralEfficiencyForCqi {nullptr}; //!< Spectral-efficiency for CQI
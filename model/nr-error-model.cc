@@ -17,12 +17,25 @@
 */
 #include "nr-error-model.h"
 #include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/object-factory.h>
+#include <unordered_map>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("NrErrorModel");
 NS_OBJECT_ENSURE_REGISTERED (NrErrorModel);
 
+std::ostream &
+operator<< (std::ostream &os, const NrSinrValues &sinr)
+{
+  for (uint32_t i = 0; i < sinr.m_numBands; ++i)
+    {
+      os << sinr.m_values[i] << " ";
+    }
+  return os;
+}
+
 NrErrorModel::NrErrorModel () : Object ()
 {
   NS_LOG_FUNCTION (this);
@@ -48,4 +61,52 @@ NrErrorModel::GetInstanceTypeId() const
   return NrErrorModel::GetTypeId ();
 }
 
+Ptr<NrErrorModel>
+NrErrorModel::GetShared (const TypeId &type)
+{
+  NS_LOG_FUNCTION (type);
+  NS_ABORT_MSG_IF (!type.IsChildOf (NrErrorModel::GetTypeId ()),
+                   "The error model must be a child of NrErrorModel");
+
+  // The configuration is the type and the initial values of its attributes,
+  // and of the ones of its parents
+  std::string key = type.GetName ();
+  for (TypeId tid = type; tid != NrErrorModel::GetTypeId (); tid = tid.GetParent ())
+    {
+      for (uint32_t i = 0; i < tid.GetAttributeN (); ++i)
+        {
+          TypeId::AttributeInformation info = tid.GetAttribute (i);
+          key += ";" + info.name + "=" + info.initialValue->SerializeToString (info.checker);
+        }
+    }
+
+  static std::unordered_map<std::string, Ptr<NrErrorModel>> instances;
+  auto it = instances.find (key);
+  if (it == instances.end ())
+    {
+      ObjectFactory factory;
+      factory.SetTypeId (type);
+      Ptr<NrErrorModel> errorModel = DynamicCast<NrErrorModel> (factory.Create ());
+      NS_ABORT_IF (errorModel == nullptr);
+      NS_LOG_INFO ("New shared error model " << key);
+      it = instances.emplace (key, errorModel).first;
+    }
+  return it->second;
+}
+
+void
+NrErrorModel::GetTbsDecodificationStats (const NrSinrValues& sinr,
+                                         const std::vector<TbDecodeInput> &tbs,
+                                         std::vector<Ptr<NrErrorModelOutput> > &outputs)
+{
+  NS_LOG_FUNCTION (this << tbs.size ());
+  outputs.clear ();
+  outputs.reserve (tbs.size ());
+  for (const auto &tb : tbs)
+    {
+      outputs.emplace_back (GetTbDecodificationStats (sinr, *tb.m_map, tb.m_size,
+                                                      tb.m_mcs, *tb.m_history));
+    }
+}
+
 } // namespace ns3
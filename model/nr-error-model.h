@@ -19,11 +19,67 @@
 #define NRERRORMODEL_H
 
 #include <ns3/object.h>
+#include <ns3/assert.h>
 #include <vector>
 #include <ns3/spectrum-value.h>
 
 namespace ns3 {
 
+/**
+ * \ingroup error-models
+ * \brief The SINR values of the RBs of a reception, as read by the error models
+ *
+ * It only points to the values. Unlike a SpectrumValue, it does not hold
+ * the SpectrumModel, that all the devices of a BWP share through a Ptr whose
+ * reference count is not atomic: the error models can be called with it
+ * from worker threads (see NrRxWorkerPool). A SpectrumValue converts to it
+ * implicitly; the values must outlive it.
+ */
+struct NrSinrValues
+{
+  /**
+   * \brief Constructor
+   * \param values the SINR of each band
+   * \param numBands the number of bands
+   */
+  NrSinrValues (const double *values, uint32_t numBands)
+    : m_values (values),
+    m_numBands (numBands)
+  {
+  }
+
+  /**
+   * \brief Constructor from the values of a SpectrumValue
+   * \param sinr the SINR
+   */
+  NrSinrValues (const SpectrumValue &sinr)
+    : m_values (sinr.GetValuesN () > 0 ? &(*sinr.ConstValuesBegin ()) : nullptr),
+    m_numBands (sinr.GetValuesN ())
+  {
+  }
+
+  /**
+   * \param band the band
+   * \return the SINR of the band
+   */
+  double operator[] (uint32_t band) const
+  {
+    NS_ASSERT (band < m_numBands);
+    return m_values[band];
+  }
+
+  const double *m_values {nullptr}; //!< The SINR of each band
+  uint32_t m_numBands {0};          //!< The number of bands
+};
+
+/**
+ * \brief Print the SINR values
+ * \param os the output stream
+ * \param sinr the SINR values
+ * \return the output stream
+ */
+std::ostream & operator<< (std::ostream &os, const NrSinrValues &sinr);
+
 /**
  * \ingroup error-models
  * \brief Store the output of an NRErrorModel
@@ -91,6 +147,26 @@ public:
    */
   TypeId GetInstanceTypeId (void) const override;
 
+  /**
+   * \brief Get the instance shared by all the users of an error model configuration
+   * \param type the TypeId of the error model, a child of NrErrorModel
+   * \return the instance of type with the current default values of its attributes
+   *
+   * The PHYs and the AMCs with the same configuration use the same instance,
+   * and the same tables. A new default value of an attribute (e.g., with
+   * Config::SetDefault) gives a new instance. The shared instance must not
+   * be reconfigured.
+   *
+   * As the instance is used by all the devices, also from the scheduler and
+   * RX worker threads, an error model must be stateless: a call must not
+   * leave in the members anything that another call reads (as the equivalent
+   * code rate of the HARQ history that NrEesmIr used to keep between
+   * ComputeSINR and GetMcsEq). Only scratch buffers that are thread_local,
+   * and caches of constant results behind a lock (as the TB segmentations of
+   * NrEesmErrorModel), are allowed.
+   */
+  static Ptr<NrErrorModel> GetShared (const TypeId &type);
+
   /**
    * \brief NrErrorModel default constructor
    */
@@ -141,11 +217,38 @@ public:
    * \param history History of the retransmission
    * \return A pointer to an output, with the tbler and other customized values
    */
-  virtual Ptr<NrErrorModelOutput> GetTbDecodificationStats (const SpectrumValue& sinr,
+  virtual Ptr<NrErrorModelOutput> GetTbDecodificationStats (const NrSinrValues& sinr,
                                                             const std::vector<int>& map,
                                                             uint32_t size, uint8_t mcs,
                                                             const NrErrorModelHistory &history) = 0;
 
+  /**
+   * \brief A transport block of GetTbsDecodificationStats
+   */
+  struct TbDecodeInput
+  {
+    const std::vector<int> *m_map {nullptr};        //!< RB map
+    uint32_t m_size {0};                            //!< Transport block size
+    uint8_t m_mcs {0};                              //!< MCS
+    const NrErrorModelHistory *m_history {nullptr}; //!< History of the retransmission
+  };
+
+  /**
+   * \brief Get the outputs of several transport blocks received with the
+   * same SINR vector
+   *
+   * The transport blocks of a reception are evaluated at once, so that the
+   * error model can share its lookups among them. The default
+   * implementation calls GetTbDecodificationStats for each of them.
+   *
+   * \param sinr SINR vector
+   * \param tbs the transport blocks
+   * \param outputs the outputs, in the order of tbs (the vector is cleared first)
+   */
+  virtual void GetTbsDecodificationStats (const NrSinrValues& sinr,
+                                          const std::vector<TbDecodeInput> &tbs,
+                                          std::vector<Ptr<NrErrorModelOutput> > &outputs);
+
   /**
    * \brief Get the SpectralEfficiency for a given CQI
    * \param cqi CQI to take into consideration
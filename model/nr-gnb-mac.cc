@@ -34,9 +34,12 @@
 #include "nr-mac-header-vs.h"
 #include "nr-mac-header-fs-ul.h"
 #include "nr-mac-short-bsr-ce.h"
+#include "nr-scheduling-worker-pool.h"
+#include "nr-counters.h"
 
 #include <ns3/lte-radio-bearer-tag.h>
 #include <ns3/log.h>
+#include <ns3/boolean.h>
 #include <ns3/spectrum-model.h>
 #include <algorithm>
 #include "beam-id.h"
@@ -158,7 +161,7 @@ public:
 
   virtual void UlHarqFeedback (UlHarqInfo params) override;
 
-  virtual void BeamChangeReport (BeamConfId beamConfId, uint8_t rnti) override;
+  virtual void BeamChangeReport (BeamConfId beamConfId, uint16_t rnti) override;
 
   virtual uint32_t GetNumRbPerRbg () const override;
 
@@ -224,7 +227,7 @@ NrMacEnbMemberPhySapUser::UlHarqFeedback (UlHarqInfo params)
 }
 
 void
-NrMacEnbMemberPhySapUser::BeamChangeReport (BeamConfId beamConfId, uint8_t rnti)
+NrMacEnbMemberPhySapUser::BeamChangeReport (BeamConfId beamConfId, uint16_t rnti)
 {
   m_mac->BeamChangeReport (beamConfId, rnti);
 }
@@ -262,6 +265,7 @@ public:
   virtual uint16_t GetCellId () const override;
   virtual uint32_t GetSymbolsPerSlot () const override;
   virtual Time GetSlotPeriod () const override;
+  virtual double GetBeamCoupling (const BeamConfId &a, const BeamConfId &b) const override;
 private:
   NrGnbMac* m_mac;
 };
@@ -320,6 +324,12 @@ NrMacMemberMacSchedSapUser::GetSlotPeriod() const
   return m_mac->m_phySapProvider->GetSlotPeriod ();
 }
 
+double
+NrMacMemberMacSchedSapUser::GetBeamCoupling (const BeamConfId &a, const BeamConfId &b) const
+{
+  return m_mac->m_phySapProvider->GetBeamCoupling (a, b);
+}
+
 class NrMacMemberMacCschedSapUser : public NrMacCschedSapUser
 {
 public:
@@ -403,6 +413,13 @@ NrGnbMac::GetTypeId (void)
                     MakeUintegerAccessor (&NrGnbMac::SetNumHarqProcess,
                                           &NrGnbMac::GetNumHarqProcess),
                     MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("BeamPolling",
+                   "If true, ask the BeamConfId of every UE to the PHY at each DL slot "
+                   "indication, instead of updating the scheduler when the PHY reports "
+                   "a beam change",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrGnbMac::m_beamPolling),
+                   MakeBooleanChecker ())
     .AddTraceSource ("DlScheduling",
                      "Information regarding DL scheduling.",
                      MakeTraceSourceAccessor (&NrGnbMac::m_dlScheduling),
@@ -427,6 +444,11 @@ NrGnbMac::GetTypeId (void)
                      "Harq feedback.",
                       MakeTraceSourceAccessor (&NrGnbMac::m_dlHarqFeedback),
                      "ns3::NrGnbMac::DlHarqFeedbackTracedCallback")
+    .AddTraceSource ("UlLatencyBreakdown",
+                     "Latency breakdown of the UL PDUs decoded, "
+                     "when NrLatencyTag is enabled.",
+                     MakeTraceSourceAccessor (&NrGnbMac::m_ulLatencyBreakdown),
+                     "ns3::NrGnbMac::LatencyBreakdownTracedCallback")
   ;
   return tid;
 }
@@ -506,13 +528,27 @@ NrGnbMac::GetUlCtrlSyms() const
 void
 NrGnbMac::ReceiveRachPreamble (uint32_t raId)
 {
-  Ptr<NrRachPreambleMessage> rachMsg = Create<NrRachPreambleMessage> ();
-  rachMsg->SetSourceBwp (GetBwpId ());
-  m_macRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), raId, GetBwpId (), rachMsg);
+  // The control messages that the MAC creates only to trace them are
+  // created only if the trace has sinks
+  if (!m_macRxedCtrlMsgsTrace.IsEmpty ())
+    {
+      Ptr<NrRachPreambleMessage> rachMsg = Create<NrRachPreambleMessage> ();
+      rachMsg->SetSourceBwp (GetBwpId ());
+      m_macRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), raId, GetBwpId (), rachMsg);
+    }
 
   ++m_receivedRachPreambleCount[raId];
 }
 
+uint16_t
+NrGnbMac::IdealRandomAccess ()
+{
+  NS_LOG_FUNCTION (this);
+  uint16_t rnti = m_cmacSapUser->AllocateTemporaryCellRnti ();
+  NS_LOG_INFO ("Ideal random access in slot " << m_currentSlot << ", allocated RNTI " << rnti);
+  return rnti;
+}
+
 LteMacSapProvider*
 NrGnbMac::GetMacSapProvider (void)
 {
@@ -568,11 +604,14 @@ NrGnbMac::DoSlotDlIndication (const SfnSf &sfnSf, LteNrTddSlotType type)
 
     m_macSchedSapProvider->SchedDlCqiInfoReq (dlCqiInfoReq);
 
-    for (const auto & v : dlCqiInfoReq.m_cqiList)
+    if (!m_macRxedCtrlMsgsTrace.IsEmpty ())
       {
-        Ptr<NrDlCqiMessage> msg = Create<NrDlCqiMessage> ();
-        msg->SetDlCqi (v);
-        m_macRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), v.m_rnti, GetBwpId (), msg);
+        for (const auto & v : dlCqiInfoReq.m_cqiList)
+          {
+            Ptr<NrDlCqiMessage> msg = Create<NrDlCqiMessage> ();
+            msg->SetDlCqi (v);
+            m_macRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), v.m_rnti, GetBwpId (), msg);
+          }
       }
   }
 
@@ -612,26 +651,40 @@ NrGnbMac::DoSlotDlIndication (const SfnSf &sfnSf, LteNrTddSlotType type)
       // empty local buffer
       m_dlHarqInfoReceived.clear ();
 
-      for (const auto & v : dlParams.m_dlHarqInfoList)
+      if (!m_macRxedCtrlMsgsTrace.IsEmpty ())
         {
-          Ptr<NrDlHarqFeedbackMessage> msg = Create <NrDlHarqFeedbackMessage> ();
-          msg->SetDlHarqFeedback (v);
-          m_macRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), v.m_rnti, GetBwpId (), msg);
+          for (const auto & v : dlParams.m_dlHarqInfoList)
+            {
+              Ptr<NrDlHarqFeedbackMessage> msg = Create <NrDlHarqFeedbackMessage> ();
+              msg->SetDlHarqFeedback (v);
+              m_macRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), v.m_rnti, GetBwpId (), msg);
+            }
         }
     }
 
-  {
-    for (const auto & ue : m_rlcAttached)
-      {
-        NrMacCschedSapProvider::CschedUeConfigReqParameters params;
-        params.m_rnti = ue.first;
-        params.m_beamConfId = m_phySapProvider->GetBeamConfId (ue.first);
-        params.m_transmissionMode = 0;   // set to default value (SISO) for avoiding random initialization (valgrind error)
-        m_macCschedSapProvider->CschedUeConfigReq (params);
-      }
-  }
+  if (m_beamPolling)
+    {
+      for (const auto & ue : m_rlcAttached)
+        {
+          NrMacCschedSapProvider::CschedUeConfigReqParameters params;
+          params.m_rnti = ue.first;
+          params.m_beamConfId = m_phySapProvider->GetBeamConfId (ue.first);
+          params.m_transmissionMode = 0;   // set to default value (SISO) for avoiding random initialization (valgrind error)
+          m_macCschedSapProvider->CschedUeConfigReq (params);
+        }
+    }
 
-  m_macSchedSapProvider->SchedDlTriggerReq (dlParams);
+  if (NrSchedulingWorkerPool::Get ().IsCollecting ())
+    {
+      AddSchedulerTask ([this, dlParams] ()
+        {
+          m_macSchedSapProvider->SchedDlTriggerReq (dlParams);
+        });
+    }
+  else
+    {
+      m_macSchedSapProvider->SchedDlTriggerReq (dlParams);
+    }
 }
 
 void
@@ -658,11 +711,14 @@ NrGnbMac::DoSlotUlIndication (const SfnSf &sfnSf, LteNrTddSlotType type)
 
     m_macSchedSapProvider->SchedUlSrInfoReq (params);
 
-    for (const auto & v : params.m_srList)
+    if (!m_macRxedCtrlMsgsTrace.IsEmpty ())
       {
-        Ptr<NrSRMessage> msg =  Create<NrSRMessage> ();
-        msg->SetRNTI (v);
-        m_macRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), v, GetBwpId (), msg);
+        for (const auto & v : params.m_srList)
+          {
+            Ptr<NrSRMessage> msg =  Create<NrSRMessage> ();
+            msg->SetRNTI (v);
+            m_macRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), v, GetBwpId (), msg);
+          }
       }
   }
 
@@ -675,11 +731,14 @@ NrGnbMac::DoSlotUlIndication (const SfnSf &sfnSf, LteNrTddSlotType type)
       m_ulCeReceived.erase (m_ulCeReceived.begin (), m_ulCeReceived.end ());
       m_macSchedSapProvider->SchedUlMacCtrlInfoReq (ulMacReq);
 
-      for (const auto & v : ulMacReq.m_macCeList)
+      if (!m_macRxedCtrlMsgsTrace.IsEmpty ())
         {
-          Ptr<NrBsrMessage> msg = Create<NrBsrMessage> ();
-          msg->SetBsr (v);
-          m_macRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), v.m_rnti, GetBwpId (), msg);
+          for (const auto & v : ulMacReq.m_macCeList)
+            {
+              Ptr<NrBsrMessage> msg = Create<NrBsrMessage> ();
+              msg->SetBsr (v);
+              m_macRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), v.m_rnti, GetBwpId (), msg);
+            }
         }
     }
 
@@ -696,8 +755,40 @@ NrGnbMac::DoSlotUlIndication (const SfnSf &sfnSf, LteNrTddSlotType type)
       m_ulHarqInfoReceived.clear ();
     }
 
-  m_macSchedSapProvider->SchedUlTriggerReq (ulParams);
+  if (NrSchedulingWorkerPool::Get ().IsCollecting ())
+    {
+      AddSchedulerTask ([this, ulParams] ()
+        {
+          m_macSchedSapProvider->SchedUlTriggerReq (ulParams);
+        });
+    }
+  else
+    {
+      m_macSchedSapProvider->SchedUlTriggerReq (ulParams);
+    }
+}
+
+void
+NrGnbMac::AddSchedulerTask (const std::function<void ()> &trigger)
+{
+  NS_LOG_FUNCTION (this);
 
+  auto schedule = [this, trigger] ()
+    {
+      m_keepSchedConfigInd = true;
+      trigger ();
+      m_keepSchedConfigInd = false;
+    };
+  auto commit = [this] ()
+    {
+      std::vector<NrMacSchedSapUser::SchedConfigIndParameters> kept;
+      std::swap (kept, m_keptSchedConfigInd);
+      for (auto & ind : kept)
+        {
+          DoSchedConfigIndication (std::move (ind));
+        }
+    };
+  NrSchedulingWorkerPool::Get ().AddTask (schedule, commit);
 }
 
 void
@@ -788,6 +879,7 @@ void
 NrGnbMac::DoReceivePhyPdu (Ptr<Packet> p)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::MAC_EVENTS);
 
   LteRadioBearerTag tag;
   p->RemovePacketTag (tag);
@@ -797,12 +889,15 @@ NrGnbMac::DoReceivePhyPdu (Ptr<Packet> p)
 
   NS_ASSERT_MSG (rntiIt != m_rlcAttached.end (), "could not find RNTI" << rnti);
 
-  // Try to peek whatever header; in the first byte there will be the LC ID.
-  NrMacHeaderFsUl header;
-  p->PeekHeader (header);
+  // In the first byte there will be the LC ID. Read only that byte, instead
+  // of deserializing a header that is then deserialized again.
+  uint8_t firstByte = 0;
+  p->CopyData (&firstByte, 1);
 
-  // Based on LC ID, we know if it is a CE or simply data.
-  if (header.GetLcId () == NrMacHeaderFsUl::SHORT_BSR)
+  // Based on LC ID, we know if it is a CE or simply data. A data header with
+  // the F bit set can not be confused with a CE, as the whole byte is
+  // compared, as NrMacHeaderFsUl::Deserialize does.
+  if (firstByte == NrMacHeaderFsUl::SHORT_BSR)
     {
       NrMacShortBsrCe bsrHeader;
       p->RemoveHeader (bsrHeader); // Really remove the header this time
@@ -824,6 +919,17 @@ NrGnbMac::DoReceivePhyPdu (Ptr<Packet> p)
 
   // Ok, we know it is data, so let's extract and pass to RLC.
 
+  NrLatencyBreakdown breakdown;
+  if (NrLatencyTag::IsEnabled () && NrLatencyTag::GetBreakdown (p, &breakdown))
+    {
+      breakdown.m_cellId = GetCellId ();
+      breakdown.m_bwpId = GetBwpId ();
+      breakdown.m_rnti = rnti;
+      breakdown.m_lcid = tag.GetLcid ();
+      breakdown.m_size = p->GetSize ();
+      m_ulLatencyBreakdown (breakdown);
+    }
+
   NrMacHeaderVs macHeader;
   p->RemoveHeader (macHeader);
 
@@ -986,6 +1092,11 @@ NrGnbMac::DoReportBufferStatus (LteMacSapProvider::ReportBufferStatusParameters
   schedParams.m_rnti = params.rnti;
 
   m_macSchedSapProvider->SchedDlRlcBufferReq (schedParams);
+  m_phySapProvider->NotifyActivity ();
+  if (params.txQueueSize > 0 || params.retxQueueSize > 0 || params.statusPduSize > 0)
+    {
+      m_phySapProvider->PageUe (params.rnti);
+    }
 }
 
 // forwarded from LteMacSapProvider
@@ -993,14 +1104,13 @@ void
 NrGnbMac::DoTransmitPdu (LteMacSapProvider::TransmitPduParameters params)
 {
   // TB UID passed back along with RLC data as HARQ process ID
-  uint32_t tbMapKey = ((params.rnti & 0xFFFF) << 8) | (params.harqProcessId & 0xFF);
   auto harqIt = m_miDlHarqProcessesPackets.find (params.rnti);
-  auto it = m_macPduMap.find (tbMapKey);
-
-  if (it == m_macPduMap.end ())
+  if (!m_pduInAssembly.has_value () || m_pduInAssembly->m_dci->m_rnti != params.rnti
+      || m_pduInAssembly->m_dci->m_harqProcess != params.harqProcessId)
     {
       NS_FATAL_ERROR ("No MAC PDU storage element found for this TB UID/RNTI");
     }
+  NrMacPduInfo &pduInfo = *m_pduInAssembly;
 
   NrMacHeaderVs header;
   header.SetLcId (params.lcid);
@@ -1011,13 +1121,18 @@ NrGnbMac::DoTransmitPdu (LteMacSapProvider::TransmitPduParameters params)
   LteRadioBearerTag bearerTag (params.rnti, params.lcid, params.layer);
   params.pdu->AddPacketTag (bearerTag);
 
+  if (NrLatencyTag::IsEnabled ())
+    {
+      NrLatencyTag::StampFirstTx (params.pdu);
+    }
+
   harqIt->second.at (params.harqProcessId).m_infoPerStream.at (params.layer).m_pktBurst->AddPacket (params.pdu);
 
-  it->second.m_used += params.pdu->GetSize ();
-  NS_ASSERT_MSG (it->second.m_maxBytes >= it->second.m_used,
-                 "DCI OF " << it->second.m_maxBytes << " total used " << it->second.m_used);
+  pduInfo.m_used += params.pdu->GetSize ();
+  NS_ASSERT_MSG (pduInfo.m_maxBytes >= pduInfo.m_used,
+                 "DCI OF " << pduInfo.m_maxBytes << " total used " << pduInfo.m_used);
 
-  m_phySapProvider->SendMacPdu (params.pdu, it->second.m_sfnSf, it->second.m_dci->m_symStart, params.layer);
+  m_phySapProvider->SendMacPdu (params.pdu, pduInfo.m_sfnSf, pduInfo.m_dci->m_symStart, params.layer);
 }
 
 void
@@ -1055,6 +1170,14 @@ NrGnbMac::SendRar (const std::vector <BuildRarListElement_s> &rarList)
 void
 NrGnbMac::DoSchedConfigIndication (NrMacSchedSapUser::SchedConfigIndParameters ind)
 {
+  if (m_keepSchedConfigInd)
+    {
+      // Running on a worker thread: the allocation is processed in the
+      // simulation thread, after all the schedulers of this round
+      m_keptSchedConfigInd.emplace_back (std::move (ind));
+      return;
+    }
+
   NS_ASSERT (ind.m_sfnSf.GetNumerology () == m_currentSlot.GetNumerology ());
   std::sort (ind.m_slotAllocInfo.m_varTtiAllocInfo.begin (), ind.m_slotAllocInfo.m_varTtiAllocInfo.end ());
 
@@ -1082,8 +1205,6 @@ NrGnbMac::DoSchedConfigIndication (NrMacSchedSapUser::SchedConfigIndParameters i
           std::unordered_map <uint16_t, NrDlHarqProcessesBuffer_t>::iterator harqIt = m_miDlHarqProcessesPackets.find (rnti);
           NS_ASSERT (harqIt != m_miDlHarqProcessesPackets.end ());
 
-          std::pair <std::unordered_map<uint32_t, struct NrMacPduInfo>::iterator, bool> mapRet;
-
           //for new data first force emptying correspondent harq pkt buffer
           for (uint8_t stream = 0; stream < dciElem->m_ndi.size (); stream++)
             {
@@ -1092,25 +1213,25 @@ NrGnbMac::DoSchedConfigIndication (NrMacSchedSapUser::SchedConfigIndParameters i
                   NS_ASSERT (dciElem->m_tbSize.at (stream) > 0);
                   //if any of the stream is carrying new data
                   //we refresh the info for all the streams in the
-                  //HARQ buffer.
+                  //HARQ buffer. A burst that is already empty (e.g.,
+                  //after an ACK) is kept.
                   for (auto &it:harqIt->second.at (tbUid).m_infoPerStream)
                     {
-                      Ptr<PacketBurst> pb = CreateObject <PacketBurst> ();
-                      it.m_pktBurst = pb;
+                      if (it.m_pktBurst == nullptr || it.m_pktBurst->GetNPackets () > 0)
+                        {
+                          it.m_pktBurst = CreateObject <PacketBurst> ();
+                        }
                       it.m_lcidList.clear ();
                     }
-                  //now push the NrMacPduInfo into m_macPduMap
+                  //now store the NrMacPduInfo of the TB,
                   //which would be used to extract info while
                   //giving the PDU to the PHY in DoTransmitPdu.
                   //it is done for only new data.
-                  NrMacPduInfo macPduInfo (ind.m_sfnSf, dciElem);
-                  //insert into MAC PDU map
-                  uint32_t tbMapKey = ((rnti & 0xFFFF) << 8) | (tbUid & 0xFF);
-                  mapRet = m_macPduMap.insert (std::pair<uint32_t, struct NrMacPduInfo> (tbMapKey, macPduInfo));
-                  if (!mapRet.second)
+                  if (m_pduInAssembly.has_value ())
                     {
-                      NS_FATAL_ERROR ("MAC PDU map element exists");
+                      NS_FATAL_ERROR ("A MAC PDU is already being assembled");
                     }
+                  m_pduInAssembly.emplace (ind.m_sfnSf, dciElem);
                   break;
                 }
             }
@@ -1140,6 +1261,10 @@ NrGnbMac::DoSchedConfigIndication (NrMacSchedSapUser::SchedConfigIndParameters i
                           Ptr<PacketBurst> pb = harqIt->second.at (tbUid).m_infoPerStream.at (k).m_pktBurst;
                           for (std::list<Ptr<Packet> >::const_iterator j = pb->Begin (); j != pb->End (); ++j)
                             {
+                              if (NrLatencyTag::IsEnabled ())
+                                {
+                                  NrLatencyTag::StampRetx (*j);
+                                }
                               Ptr<Packet> pkt = (*j)->Copy ();
                               m_phySapProvider->SendMacPdu (pkt, ind.m_sfnSf, dciElem->m_symStart, k);
                             }
@@ -1148,10 +1273,7 @@ NrGnbMac::DoSchedConfigIndication (NrMacSchedSapUser::SchedConfigIndParameters i
                 }
             }
 
-          if (mapRet.second)
-            {
-              m_macPduMap.erase (mapRet.first);    // delete map entry
-            }
+          m_pduInAssembly.reset ();    // the RLCs gave all their PDUs
 
           for (uint8_t stream = 0; stream < dciElem->m_tbSize.size (); stream++)
             {
@@ -1169,6 +1291,7 @@ NrGnbMac::DoSchedConfigIndication (NrMacSchedSapUser::SchedConfigIndParameters i
               traceInfo.m_ndi = dciElem->m_ndi.at (stream);
               traceInfo.m_rv = dciElem->m_rv.at (stream);
               traceInfo.m_harqId = dciElem->m_harqProcess;
+              traceInfo.m_numRbg = static_cast<uint16_t> (dciElem->m_rbgBitmask.count ());
 
               m_dlScheduling (traceInfo);
             }
@@ -1196,6 +1319,7 @@ NrGnbMac::DoSchedConfigIndication (NrMacSchedSapUser::SchedConfigIndParameters i
               traceInfo.m_ndi = dciElem->m_ndi.at (stream);
               traceInfo.m_rv = dciElem->m_rv.at (stream);
               traceInfo.m_harqId = dciElem->m_harqProcess;
+              traceInfo.m_numRbg = static_cast<uint16_t> (dciElem->m_rbgBitmask.count ());
 
               m_ulScheduling (traceInfo);
             }
@@ -1236,8 +1360,17 @@ NrGnbMac::DoConfigureMac (uint16_t ulBandwidth, uint16_t dlBandwidth)
 }
 
 void
-NrGnbMac::BeamChangeReport (BeamConfId beamConfId, uint8_t rnti)
+NrGnbMac::BeamChangeReport (BeamConfId beamConfId, uint16_t rnti)
 {
+  NS_LOG_FUNCTION (this << rnti << beamConfId);
+
+  // The scheduler knows only the UEs added by DoAddUe, that reads the
+  // BeamConfId of the UE when it adds it
+  if (m_beamPolling || m_rlcAttached.find (rnti) == m_rlcAttached.end ())
+    {
+      return;
+    }
+
   NrMacCschedSapProvider::CschedUeConfigReqParameters params;
   params.m_rnti = rnti;
   params.m_beamConfId = beamConfId;
@@ -1280,11 +1413,11 @@ NrGnbMac::GetDlCtrlDci () const
 
   auto bwInRbg = m_phySapProvider->GetRbNum () / GetNumRbPerRbg ();
   NS_ASSERT (bwInRbg > 0);
-  std::vector<uint8_t> rbgBitmask (bwInRbg , 1);
+  NrBitset rbgBitmask (bwInRbg, true);
 
-  return std::make_shared<DciInfoElementTdma> (0, m_macSchedSapProvider->GetDlCtrlSyms (),
-                                               DciInfoElementTdma::DL, DciInfoElementTdma::CTRL,
-                                               rbgBitmask);
+  return DciInfoElementTdma::Create (0, m_macSchedSapProvider->GetDlCtrlSyms (),
+                                     DciInfoElementTdma::DL, DciInfoElementTdma::CTRL,
+                                     rbgBitmask);
 }
 
 std::shared_ptr<DciInfoElementTdma>
@@ -1293,11 +1426,11 @@ NrGnbMac::GetUlCtrlDci () const
   NS_LOG_FUNCTION (this);
 
   NS_ASSERT (m_bandwidthInRbg > 0);
-  std::vector<uint8_t> rbgBitmask (m_bandwidthInRbg , 1);
+  NrBitset rbgBitmask (m_bandwidthInRbg, true);
 
-  return std::make_shared<DciInfoElementTdma> (0, m_macSchedSapProvider->GetUlCtrlSyms (),
-                                               DciInfoElementTdma::UL, DciInfoElementTdma::CTRL,
-                                               rbgBitmask);
+  return DciInfoElementTdma::Create (0, m_macSchedSapProvider->GetUlCtrlSyms (),
+                                     DciInfoElementTdma::UL, DciInfoElementTdma::CTRL,
+                                     rbgBitmask);
 }
 
 void
@@ -1319,11 +1452,11 @@ NrGnbMac::DoAddUe (uint16_t rnti)
   // Create DL transmission HARQ buffers
   NrDlHarqProcessesBuffer_t buf;
   uint16_t harqNum = GetNumHarqProcess ();
-  uint16_t numStreams = 2;
+  uint16_t numStreams = m_phySapProvider->GetNumberOfStreams ();
   buf.resize (harqNum);
   for (uint8_t i = 0; i < harqNum; i++)
     {
-      //for each of the HARQ process we have the info of max 2 streams
+      //for each of the HARQ process we have the info of each stream of the PHY
       for (uint16_t stream = 0; stream < numStreams; stream++)
         {
           HarqProcessInfoSingleStream info;
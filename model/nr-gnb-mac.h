@@ -25,6 +25,7 @@
 #include "nr-phy-sap.h"
 #include "nr-mac-scheduler.h"
 #include "nr-mac-pdu-info.h"
+#include "nr-latency-tag.h"
 
 #include <ns3/lte-enb-cmac-sap.h>
 #include <ns3/lte-mac-sap.h>
@@ -32,6 +33,8 @@
 #include <ns3/lte-mac-sap.h>
 #include <ns3/lte-enb-cmac-sap.h>
 #include <ns3/traced-callback.h>
+#include <functional>
+#include <optional>
 
 namespace ns3 {
 
@@ -170,6 +173,16 @@ public:
 
   void SetEnbCmacSapUser (LteEnbCmacSapUser* s);
 
+  /**
+   * \brief Perform the random access of a UE without preamble and RAR
+   * \return the temporary C-RNTI allocated to the UE
+   *
+   * Used by the UEs attached with NrHelper in instant attach mode: the RRC
+   * allocates the RNTI and creates the UE context as when a preamble is
+   * received, in the same instant.
+   */
+  uint16_t IdealRandomAccess ();
+
 
 
   /**
@@ -188,8 +201,12 @@ public:
    * \brief A BeamConf for a user has changed
    * \param beamConfId new beam ID
    * \param rnti RNTI of the user
+   *
+   * The scheduler is updated, unless the attribute BeamPolling is true: in
+   * that case, the MAC asks the BeamConfId of every UE to the PHY at each
+   * DL slot indication, and the reports are ignored.
    */
-  void BeamChangeReport (BeamConfId beamConfId, uint8_t rnti);
+  void BeamChangeReport (BeamConfId beamConfId, uint16_t rnti);
 
   /**
    * TracedCallback signature for DL and UL data scheduling events.
@@ -252,6 +269,13 @@ public:
       (const SfnSf sfn, const uint16_t nodeId, const uint16_t rnti,
        const uint8_t bwpId, Ptr<NrControlMessage>);
 
+  /**
+   * TracedCallback signature for the latency breakdown of the decoded PDUs.
+   *
+   * \param [in] breakdown the latency breakdown of the PDU
+   */
+  typedef void (* LatencyBreakdownTracedCallback) (const NrLatencyBreakdown &breakdown);
+
 protected:
   /**
    * \brief DoDispose method inherited from Object
@@ -294,6 +318,16 @@ private:
   void DoReceivePhyPdu (Ptr<Packet> p);
   void DoReceiveControlMessage  (Ptr<NrControlMessage> msg);
   virtual void DoSchedConfigIndication (NrMacSchedSapUser::SchedConfigIndParameters ind);
+  /**
+   * \brief Let the NrSchedulingWorkerPool call the scheduler
+   *
+   * Used when the slot indications come from the pool: the scheduler call
+   * runs on a worker thread, and the allocations it produces are kept and
+   * then processed by DoSchedConfigIndication in the simulation thread.
+   *
+   * \param trigger the call to SchedDlTriggerReq or SchedUlTriggerReq
+   */
+  void AddSchedulerTask (const std::function<void ()> &trigger);
   // forwarded from LteMacSapProvider
   void DoTransmitPdu (LteMacSapProvider::TransmitPduParameters);
   void DoReportBufferStatus (LteMacSapProvider::ReportBufferStatusParameters);
@@ -372,7 +406,14 @@ private:
 
   uint8_t m_numHarqProcess {20}; //!< number of HARQ processes
 
-  std::unordered_map<uint32_t, struct NrMacPduInfo> m_macPduMap;
+  bool m_beamPolling {false}; //!< Ask the BeamConfId of every UE at each DL slot indication
+
+  /**
+   * The DL TB with new data whose RLC PDUs are being collected. The RLCs
+   * give their PDUs to DoTransmitPdu while the MAC notifies them the TX
+   * opportunities of the TB, so there is at most one TB at a time.
+   */
+  std::optional<NrMacPduInfo> m_pduInAssembly;
 
   Callback <void, Ptr<Packet> > m_forwardUpCallback;
 
@@ -402,6 +443,9 @@ private:
 
   SfnSf m_currentSlot;
 
+  bool m_keepSchedConfigInd {false}; //!< True while the scheduler runs on a worker thread
+  std::vector<NrMacSchedSapUser::SchedConfigIndParameters> m_keptSchedConfigInd; //!< Allocations of the scheduler run on a worker thread
+
   /**
    * Trace information regarding ENB MAC Received Control Messages
    * Frame number, Subframe number, slot, VarTtti, nodeId, rnti,
@@ -420,6 +464,11 @@ private:
    * Trace DL HARQ info list elements.
    */
   TracedCallback<const DlHarqInfo&> m_dlHarqFeedback;
+
+  /**
+   * Trace of the latency breakdown of the UL PDUs decoded, see NrLatencyTag
+   */
+  TracedCallback<const NrLatencyBreakdown &> m_ulLatencyBreakdown;
 };
 
 }
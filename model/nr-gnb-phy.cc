@@ -29,8 +29,11 @@
 #include <ns3/node.h>
 #include <algorithm>
 #include <functional>
+#include <map>
+#include <numeric>
 #include <string>
-#include <unordered_set>
+#include <tuple>
+#include <unordered_map>
 
 #include "nr-gnb-phy.h"
 #include "nr-ue-phy.h"
@@ -39,6 +42,9 @@
 #include "nr-gnb-net-device.h"
 #include "nr-radio-bearer-tag.h"
 #include "nr-ch-access-manager.h"
+#include "nr-scheduling-worker-pool.h"
+#include "nr-slot-timing-engine.h"
+#include "nr-counters.h"
 
 #include <ns3/node-list.h>
 #include <ns3/node.h>
@@ -72,6 +78,8 @@ NrGnbPhy::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
   delete m_enbCphySapProvider;
+  m_slotTimingEngine = nullptr;
+  m_varTtiTimeline.Cancel ();
   NrPhy::DoDispose ();
 }
 
@@ -117,6 +125,10 @@ NrGnbPhy::GetTypeId (void)
                    MakeEnumChecker ( NrSpectrumValueHelper::UNIFORM_POWER_ALLOCATION_BW, "UniformPowerAllocBw",
                                      NrSpectrumValueHelper::UNIFORM_POWER_ALLOCATION_USED, "UniformPowerAllocUsed"
                                    ))
+    .AddTraceSource ("TddPatternChange",
+                     "The TDD pattern changed: the absolute slot from which it is used, and the new pattern",
+                     MakeTraceSourceAccessor (&NrGnbPhy::m_tddPatternChangeTrace),
+                     "ns3::NrGnbPhy::TddPatternChangeTracedCallback")
     .AddTraceSource ("UlSinrTrace",
                      "UL SINR statistics.",
                      MakeTraceSourceAccessor (&NrGnbPhy::m_ulSinrTrace),
@@ -176,6 +188,40 @@ NrGnbPhy::GetTypeId (void)
                    ObjectVectorValue (),
                    MakeObjectVectorAccessor (&NrGnbPhy::m_spectrumPhys),
                    MakeObjectVectorChecker<NrSpectrumPhy> ())
+    .AddAttribute ("NumSchedulingWorkers",
+                   "Number of threads that run the schedulers of the gNB PHYs that "
+                   "start a slot at the same time. With 1, each PHY calls its MAC "
+                   "directly, in the simulation thread. The highest value of all "
+                   "the PHYs is used by all the PHYs with a value greater than 1.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&NrGnbPhy::SetNumSchedulingWorkers,
+                                         &NrGnbPhy::GetNumSchedulingWorkers),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("IdleSlotFastForward",
+                   "Maximum number of idle slots that the PHY, and its attached UEs, "
+                   "skip at once: the slot counters advance without running the "
+                   "slots, until something has to be sent or received. 0 disables "
+                   "the fast-forward.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrGnbPhy::SetIdleSlotFastForward,
+                                         &NrGnbPhy::GetIdleSlotFastForward),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("IdealControl",
+                   "Deliver the DL CTRL messages directly to the PHYs of the UEs "
+                   "of the cell at the end of the DL CTRL symbols, instead of "
+                   "transmitting a signal: there is no DL CTRL interference, no DL "
+                   "CTRL SINR, and no measurement of the received power from the "
+                   "DL CTRL at the UEs",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrGnbPhy::m_idealCtrl),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CoalesceVarTtiEvents",
+                   "Schedule the starts and the ends of the varTTIs of a slot in a "
+                   "local timeline (NrVarTtiTimeline), with only its next boundary in "
+                   "the simulator queue, instead of one simulator event each",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrGnbPhy::m_coalesceVarTtiEvents),
+                   MakeBooleanChecker ())
     .AddTraceSource ("SlotDataStats",
                      "Data statistics for the current slot: SfnSf, active UE, used RE, "
                      "used symbols, available RBs, available symbols, bwp ID, cell ID",
@@ -454,18 +500,214 @@ NrGnbPhy::SetTddPattern (const std::vector<LteNrTddSlotType> &pattern)
   NS_LOG_INFO ("Set pattern : " << ss.str ());
 
   m_tddPattern = pattern;
+  m_slotPattern = pattern;
+  m_slotPatternOrigin = 0;
+  m_tddPatternChange.reset ();
+
+  m_patternSlots = GetPatternSlots (pattern, 0, GetN2Delay (), GetN1Delay (),
+                                    GetL1L2CtrlLatency ());
+}
+
+uint64_t
+NrGnbPhy::GetPatternPosition (const SfnSf &slot) const
+{
+  const int64_t size = static_cast<int64_t> (m_slotPattern.size ());
+  int64_t pos = (static_cast<int64_t> (slot.Normalize ()) - m_slotPatternOrigin) % size;
+  return static_cast<uint64_t> (pos < 0 ? pos + size : pos);
+}
+
+std::pair<uint32_t, uint32_t>
+NrGnbPhy::GetTddTransitionRepetitions (const std::vector<LteNrTddSlotType> &pattern) const
+{
+  auto reach = [] (const std::vector<PatternSlot> &slots)
+    {
+      uint32_t generate = 0;
+      uint32_t k1 = 0;
+      for (const auto &slot : slots)
+        {
+          for (uint32_t k : slot.m_generateDl)
+            {
+              generate = std::max (generate, k);
+            }
+          for (uint32_t k : slot.m_generateUl)
+            {
+              generate = std::max (generate, k);
+            }
+          k1 = std::max (k1, slot.m_dlHarqfbPosition);
+        }
+      return generate + k1;
+    };
+
+  auto oldSlots = GetPatternSlots (m_tddPattern, 0, GetN2Delay (), GetN1Delay (), GetL1L2CtrlLatency ());
+  auto newSlots = GetPatternSlots (pattern, 0, GetN2Delay (), GetN1Delay (), GetL1L2CtrlLatency ());
+  uint32_t distance = std::max (reach (*oldSlots), reach (*newSlots));
+
+  return std::make_pair (distance / static_cast<uint32_t> (m_tddPattern.size ()) + 1,
+                         distance / static_cast<uint32_t> (pattern.size ()) + 1);
+}
+
+uint64_t
+NrGnbPhy::GetEarliestTddPatternChange (const std::vector<LteNrTddSlotType> &pattern) const
+{
+  NS_ABORT_MSG_IF (!IsTdd (m_tddPattern) || !IsTdd (pattern),
+                   "Only a TDD pattern can change to another TDD pattern");
+
+  const uint64_t period = std::lcm (m_tddPattern.size (), pattern.size ());
+  const uint64_t before = GetTddTransitionRepetitions (pattern).first * m_tddPattern.size ();
+
+  // The window of the switch starts after the current slot
+  uint64_t earliest = m_currentSlot.Normalize () + 1 + before;
+  return (earliest + period - 1) / period * period;
+}
+
+void
+NrGnbPhy::ChangeTddPattern (const std::vector<LteNrTddSlotType> &pattern, uint64_t switchSlot)
+{
+  NS_LOG_FUNCTION (this << NrPhy::GetPattern (pattern) << switchSlot);
+  NS_ABORT_MSG_IF (m_tddPatternChange != nullptr, "A change of the TDD pattern is already pending");
+  NS_ABORT_MSG_IF (switchSlot < GetEarliestTddPatternChange (pattern)
+                   || switchSlot % m_tddPattern.size () != 0 || switchSlot % pattern.size () != 0,
+                   "The TDD pattern cannot change at slot " << switchSlot);
+
+  const auto repetitions = GetTddTransitionRepetitions (pattern);
+  const uint64_t oldSize = m_tddPattern.size ();
+  const uint64_t newSize = pattern.size ();
+
+  auto change = std::make_unique<TddPatternChange> ();
+  change->m_pattern = pattern;
+  change->m_slots = GetPatternSlots (pattern, 0, GetN2Delay (), GetN1Delay (), GetL1L2CtrlLatency ());
+
+  // The old pattern before the window, to find the DCI slots of the first
+  // slots, and the new one after, to find the HARQ feedback slots of the last
+  for (uint32_t i = 0; i < 2 * repetitions.first; ++i)
+    {
+      change->m_transition.insert (change->m_transition.end (), m_tddPattern.begin (), m_tddPattern.end ());
+    }
+  for (uint32_t i = 0; i < 3 * repetitions.second; ++i)
+    {
+      change->m_transition.insert (change->m_transition.end (), pattern.begin (), pattern.end ());
+    }
+  change->m_transitionSlots = GetPatternSlots (change->m_transition, 0, GetN2Delay (), GetN1Delay (),
+                                               GetL1L2CtrlLatency ());
+  change->m_transitionOrigin = static_cast<int64_t> (switchSlot - 2 * repetitions.first * oldSize);
+  change->m_windowStart = switchSlot - repetitions.first * oldSize;
+  change->m_switchSlot = switchSlot;
+  change->m_windowEnd = switchSlot + repetitions.second * newSize;
+  m_tddPatternChange = std::move (change);
+
+  for (const auto & ueDev : m_deviceMap)
+    {
+      Ptr<NrUePhy> uePhy = ueDev->GetPhy (GetBwpId ());
+      if (uePhy && uePhy->GetCellId () == GetCellId ())
+        {
+          ForwardTddPatternChange (uePhy);
+        }
+    }
+}
+
+bool
+NrGnbPhy::IsTddPatternChanging () const
+{
+  return m_tddPatternChange != nullptr;
+}
+
+void
+NrGnbPhy::ForwardTddPatternChange (const Ptr<NrUePhy> &uePhy) const
+{
+  if (m_tddPatternChange != nullptr && m_tddPattern != m_tddPatternChange->m_pattern)
+    {
+      uePhy->ChangeTddPattern (m_tddPatternChange->m_pattern, m_tddPatternChange->m_switchSlot);
+    }
+}
+
+void
+NrGnbPhy::UpdateTddPattern ()
+{
+  if (m_tddPatternChange == nullptr)
+    {
+      return;
+    }
+
+  const uint64_t slot = m_currentSlot.Normalize ();
+  if (slot < m_tddPatternChange->m_windowStart)
+    {
+      return;
+    }
+
+  if (slot >= m_tddPatternChange->m_switchSlot && m_tddPattern != m_tddPatternChange->m_pattern)
+    {
+      m_tddPattern = m_tddPatternChange->m_pattern;
+      NS_LOG_INFO ("TDD pattern changed to " << GetPattern () << " at slot " << m_currentSlot);
+      m_tddPatternChangeTrace (m_tddPatternChange->m_switchSlot, GetPattern ());
+    }
+
+  if (slot >= m_tddPatternChange->m_windowEnd)
+    {
+      m_tddPattern = m_tddPatternChange->m_pattern;
+      m_slotPattern = m_tddPattern;
+      m_slotPatternOrigin = 0;
+      m_patternSlots = m_tddPatternChange->m_slots;
+      m_tddPatternChange.reset ();
+    }
+  else if (m_patternSlots != m_tddPatternChange->m_transitionSlots)
+    {
+      m_slotPattern = m_tddPatternChange->m_transition;
+      m_slotPatternOrigin = m_tddPatternChange->m_transitionOrigin;
+      m_patternSlots = m_tddPatternChange->m_transitionSlots;
+    }
+}
 
-  m_generateDl.clear ();
-  m_generateUl.clear ();
-  m_toSendDl.clear ();
-  m_toSendUl.clear ();
-  m_dlHarqfbPosition.clear ();
+std::shared_ptr<const std::vector<NrGnbPhy::PatternSlot>>
+NrGnbPhy::GetPatternSlots (const std::vector<LteNrTddSlotType> &pattern,
+                           uint32_t n0, uint32_t n2, uint32_t n1, uint32_t l1l2CtrlLatency)
+{
+  using Key = std::tuple<std::vector<LteNrTddSlotType>, uint32_t, uint32_t, uint32_t, uint32_t>;
+  static std::map<Key, std::weak_ptr<const std::vector<PatternSlot>>> cache;
+
+  Key key (pattern, n0, n2, n1, l1l2CtrlLatency);
+  auto it = cache.find (key);
+  if (it != cache.end ())
+    {
+      std::shared_ptr<const std::vector<PatternSlot>> slots = it->second.lock ();
+      if (slots)
+        {
+          return slots;
+        }
+    }
+
+  std::map<uint32_t, std::vector<uint32_t>> toSendDl;
+  std::map<uint32_t, std::vector<uint32_t>> toSendUl;
+  std::map<uint32_t, std::vector<uint32_t>> generateDl;
+  std::map<uint32_t, std::vector<uint32_t>> generateUl;
+  std::map<uint32_t, uint32_t> dlHarqfbPosition;
+
+  GenerateStructuresFromPattern (pattern, &toSendDl, &toSendUl, &generateDl, &generateUl,
+                                 &dlHarqfbPosition, n0, n2, n1, l1l2CtrlLatency);
+
+  auto slots = std::make_shared<std::vector<PatternSlot>> (pattern.size ());
+  for (const auto & v : toSendDl)
+    {
+      slots->at (v.first).m_toSendDl = v.second;
+    }
+  for (const auto & v : toSendUl)
+    {
+      slots->at (v.first).m_toSendUl = v.second;
+    }
+  for (const auto & v : generateDl)
+    {
+      slots->at (v.first).m_generateDl = v.second;
+    }
+  for (const auto & v : generateUl)
+    {
+      slots->at (v.first).m_generateUl = v.second;
+    }
+  for (const auto & v : dlHarqfbPosition)
+    {
+      slots->at (v.first).m_dlHarqfbPosition = v.second;
+    }
 
-  GenerateStructuresFromPattern (pattern, &m_toSendDl, &m_toSendUl,
-                                 &m_generateDl, &m_generateUl,
-                                 &m_dlHarqfbPosition, 0,
-                                 GetN2Delay (), GetN1Delay (),
-                                 GetL1L2CtrlLatency ());
+  cache[key] = slots;
+  return slots;
 }
 
 void
@@ -480,6 +722,7 @@ void
 NrGnbPhy::StartEventLoop (uint16_t frame, uint8_t subframe, uint16_t slot)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
   NS_LOG_DEBUG ("PHY starting. Configuration: "  << std::endl <<
                 "\t TxPower: " << m_txPower << " dB" << std::endl <<
                 "\t NoiseFigure: " << m_noiseFigure << std::endl <<
@@ -557,27 +800,119 @@ NrGnbPhy::GetBeamConfId (uint16_t rnti) const
 {
   NS_LOG_FUNCTION (this);
 
-  NS_ABORT_MSG_UNLESS (m_spectrumPhys.size () == 1 || m_spectrumPhys.size () == 2, " Currently the BeamConfId implementation supports up to 2 antenna arrays per PHY instance.");
+  BeamConfId beamConfId (BeamId (0,0), BeamId::GetEmptyBeamId ());
+  if (!FindBeamConfId (rnti, &beamConfId))
+    {
+      // The BeamConfId is reported to the MAC when the device gets the RNTI
+      m_unresolvedBeamRnti.insert (rnti);
+    }
+  return beamConfId;
+}
+
+double
+NrGnbPhy::GetBeamCoupling (const BeamConfId &a, const BeamConfId &b) const
+{
+  if (a == b)
+    {
+      return 1.0;
+    }
+  NS_ASSERT (m_spectrumPhys [0]->GetBeamManager ());
+  return m_spectrumPhys [0]->GetBeamManager ()->GetBeamCoupling (a.GetFirstBeam (), b.GetFirstBeam ());
+}
 
-  for (uint8_t i = 0; i < m_deviceMap.size (); i++)
+bool
+NrGnbPhy::FindBeamConfId (uint16_t rnti, BeamConfId *beamConfId) const
+{
+  NS_ABORT_MSG_UNLESS (m_spectrumPhys.size () >= 1 && m_spectrumPhys.size () <= NR_MAX_STREAMS,
+                       "The BeamConfId implementation supports up to " << +NR_MAX_STREAMS <<
+                       " antenna arrays per PHY instance.");
+
+  Ptr<NrUeNetDevice> ueDev = FindUeDevice (rnti);
+  if (ueDev == nullptr)
     {
-      Ptr<NrUeNetDevice> ueDev = DynamicCast < NrUeNetDevice > (m_deviceMap.at (i));
-      uint64_t ueRnti = (DynamicCast<NrUePhy>(ueDev->GetPhy (GetBwpId ())))->GetRnti ();
+      return false;
+    }
+
+  NS_ASSERT (m_spectrumPhys [0]->GetBeamManager ());
+  BeamId beamId1 = m_spectrumPhys [0]->GetBeamManager ()->GetBeamId (ueDev);
+  BeamId beamId2 = BeamId::GetEmptyBeamId ();
 
-      if (ueRnti == rnti)
+  if (m_spectrumPhys.size () > 1)
+    {
+      m_spectrumPhys [1]->GetBeamManager ()->GetBeamId (ueDev);
+    }
+  *beamConfId = BeamConfId (beamId1, beamId2);
+  return true;
+}
+
+Ptr<NrUeNetDevice>
+NrGnbPhy::FindUeDevice (uint16_t rnti) const
+{
+  if (rnti == 0)
+    {
+      return nullptr;
+    }
+
+  auto it = m_ueByRnti.find (rnti);
+  if (it != m_ueByRnti.end ())
+    {
+      if (it->second.m_phy->GetRnti () == rnti)
         {
-          NS_ASSERT (m_spectrumPhys [0]->GetBeamManager ());
-          BeamId beamId1 = m_spectrumPhys [0]->GetBeamManager ()->GetBeamId (m_deviceMap.at (i));
-          BeamId beamId2 = BeamId::GetEmptyBeamId ();
+          return it->second.m_device;
+        }
+      m_ueByRnti.erase (it);
+    }
 
-          if (m_spectrumPhys.size () > 1)
-            {
-              m_spectrumPhys [1]->GetBeamManager ()->GetBeamId (m_deviceMap.at (i));
-            }
-          return BeamConfId (beamId1, beamId2);
+  for (const auto & ueDev : m_deviceMap)
+    {
+      Ptr<NrUePhy> uePhy = ueDev->GetPhy (GetBwpId ());
+      if (uePhy != nullptr && uePhy->GetRnti () == rnti)
+        {
+          m_ueByRnti.emplace (rnti, UeEntry {ueDev, uePhy});
+          return ueDev;
+        }
+    }
+  return nullptr;
+}
+
+void
+NrGnbPhy::ReportBeamChange (const Ptr<const NetDevice> &device)
+{
+  NS_LOG_FUNCTION (this << device);
+
+  auto it = std::find_if (m_deviceMap.begin (), m_deviceMap.end (),
+                          [&device] (const Ptr<NrUeNetDevice> &ueDev)
+                          { return PeekPointer (ueDev) == PeekPointer (device); });
+  if (it == m_deviceMap.end ())
+    {
+      return;
+    }
+
+  uint16_t rnti = (*it)->GetPhy (GetBwpId ())->GetRnti ();
+  BeamConfId beamConfId (BeamId (0,0), BeamId::GetEmptyBeamId ());
+  if (rnti != 0 && FindBeamConfId (rnti, &beamConfId))
+    {
+      m_phySapUser->BeamChangeReport (beamConfId, rnti);
+    }
+}
+
+void
+NrGnbPhy::ReportResolvedBeams ()
+{
+  for (auto it = m_unresolvedBeamRnti.begin (); it != m_unresolvedBeamRnti.end (); )
+    {
+      BeamConfId beamConfId (BeamId (0,0), BeamId::GetEmptyBeamId ());
+      if (FindBeamConfId (*it, &beamConfId))
+        {
+          NS_LOG_INFO ("RNTI " << *it << " resolved, BeamConfId " << beamConfId);
+          m_phySapUser->BeamChangeReport (beamConfId, *it);
+          it = m_unresolvedBeamRnti.erase (it);
+        }
+      else
+        {
+          ++it;
         }
     }
-  return BeamConfId (BeamId (0,0), BeamId::GetEmptyBeamId ());
 }
 
 void
@@ -598,6 +933,13 @@ NrGnbPhy::GetCam() const
   return m_cam;
 }
 
+void
+NrGnbPhy::SetSlotTimingEngine (const Ptr<NrSlotTimingEngine> &engine)
+{
+  NS_LOG_FUNCTION (this);
+  m_slotTimingEngine = engine;
+}
+
 void
 NrGnbPhy::SetTxPower (double pow)
 {
@@ -610,9 +952,10 @@ NrGnbPhy::GetTxPower () const
 }
 
 void
-NrGnbPhy::SetSubChannels (const std::vector<int> &rbIndexVector, uint8_t activeStreams)
+NrGnbPhy::SetSubChannels (const std::vector<int> &rbIndexVector, uint8_t activeStreams,
+                          const std::vector<float> &rbgPower)
 {
-  Ptr<SpectrumValue> txPsd = GetTxPowerSpectralDensity (rbIndexVector, activeStreams);
+  Ptr<SpectrumValue> txPsd = GetTxPowerSpectralDensity (rbIndexVector, activeStreams, rbgPower);
   NS_ASSERT (txPsd);
   for (uint8_t streamIndex = 0; streamIndex < m_spectrumPhys.size(); streamIndex++)
     {
@@ -647,40 +990,139 @@ void
 NrGnbPhy::CallMacForSlotIndication (const SfnSf &currentSlot)
 {
   NS_LOG_FUNCTION (this);
-  NS_ASSERT (!m_generateDl.empty() || !m_generateUl.empty());
+  NS_ASSERT (m_patternSlots && !m_patternSlots->empty ());
 
   m_phySapUser->SetCurrentSfn (currentSlot);
 
-  uint64_t currentSlotN = currentSlot.Normalize () % m_tddPattern.size ();
+  uint64_t currentSlotN = GetPatternPosition (currentSlot);
 
   NS_LOG_INFO ("Start Slot " << currentSlot << ". In position " <<
                currentSlotN << " there is a slot of type " <<
-               m_tddPattern[currentSlotN]);
+               m_slotPattern[currentSlotN]);
 
-  for (const auto & k2WithLatency : m_generateUl[currentSlotN])
+  for (const auto & k2WithLatency : (*m_patternSlots)[currentSlotN].m_generateUl)
     {
       SfnSf targetSlot = currentSlot;
       targetSlot.Add (k2WithLatency);
 
-      uint64_t pos = targetSlot.Normalize () % m_tddPattern.size ();
+      uint64_t pos = GetPatternPosition (targetSlot);
 
       NS_LOG_INFO (" in slot " << currentSlot << " generate UL for " <<
-                     targetSlot << " which is of type " << m_tddPattern[pos]);
+                     targetSlot << " which is of type " << m_slotPattern[pos]);
 
-      m_phySapUser->SlotUlIndication (targetSlot, m_tddPattern[pos]);
+      m_phySapUser->SlotUlIndication (targetSlot, m_slotPattern[pos]);
     }
 
-  for (const auto & k0WithLatency : m_generateDl[currentSlotN])
+  for (const auto & k0WithLatency : (*m_patternSlots)[currentSlotN].m_generateDl)
     {
       SfnSf targetSlot = currentSlot;
       targetSlot.Add (k0WithLatency);
 
-      uint64_t pos = targetSlot.Normalize () % m_tddPattern.size ();
+      uint64_t pos = GetPatternPosition (targetSlot);
 
       NS_LOG_INFO (" in slot " << currentSlot << " generate DL for " <<
-                     targetSlot << " which is of type " << m_tddPattern[pos]);
+                     targetSlot << " which is of type " << m_slotPattern[pos]);
 
-      m_phySapUser->SlotDlIndication (targetSlot, m_tddPattern[pos]);
+      m_phySapUser->SlotDlIndication (targetSlot, m_slotPattern[pos]);
+    }
+}
+
+std::vector<std::function<void ()>>
+NrGnbPhy::GetMacSlotIndications (const SfnSf &currentSlot)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_patternSlots && !m_patternSlots->empty ());
+
+  std::vector<std::function<void ()>> indications;
+
+  uint64_t currentSlotN = GetPatternPosition (currentSlot);
+
+  NS_LOG_INFO ("Start Slot " << currentSlot << ". In position " <<
+               currentSlotN << " there is a slot of type " <<
+               m_slotPattern[currentSlotN]);
+
+  for (const auto & k2WithLatency : (*m_patternSlots)[currentSlotN].m_generateUl)
+    {
+      SfnSf targetSlot = currentSlot;
+      targetSlot.Add (k2WithLatency);
+
+      uint64_t pos = GetPatternPosition (targetSlot);
+
+      NS_LOG_INFO (" in slot " << currentSlot << " generate UL for " <<
+                     targetSlot << " which is of type " << m_slotPattern[pos]);
+
+      LteNrTddSlotType type = m_slotPattern[pos];
+      indications.emplace_back ([this, targetSlot, type] ()
+        {
+          m_phySapUser->SlotUlIndication (targetSlot, type);
+        });
+    }
+
+  for (const auto & k0WithLatency : (*m_patternSlots)[currentSlotN].m_generateDl)
+    {
+      SfnSf targetSlot = currentSlot;
+      targetSlot.Add (k0WithLatency);
+
+      uint64_t pos = GetPatternPosition (targetSlot);
+
+      NS_LOG_INFO (" in slot " << currentSlot << " generate DL for " <<
+                     targetSlot << " which is of type " << m_slotPattern[pos]);
+
+      LteNrTddSlotType type = m_slotPattern[pos];
+      indications.emplace_back ([this, targetSlot, type] ()
+        {
+          m_phySapUser->SlotDlIndication (targetSlot, type);
+        });
+    }
+
+  // The MAC must know the current slot before the first indication
+  std::function<void ()> setCurrentSfn = [this, currentSlot] ()
+    {
+      m_phySapUser->SetCurrentSfn (currentSlot);
+    };
+  if (indications.empty ())
+    {
+      indications.emplace_back (setCurrentSfn);
+    }
+  else
+    {
+      std::function<void ()> first = indications.front ();
+      indications.front () = [setCurrentSfn, first] ()
+        {
+          setCurrentSfn ();
+          first ();
+        };
+    }
+
+  return indications;
+}
+
+void
+NrGnbPhy::CallMacAndStartSlot (bool startSlot)
+{
+  NS_LOG_FUNCTION (this << startSlot);
+
+  if (!m_unresolvedBeamRnti.empty ())
+    {
+      ReportResolvedBeams ();
+    }
+
+  if (m_numSchedulingWorkers > 1)
+    {
+      std::function<void ()> doStartSlot;
+      if (startSlot)
+        {
+          doStartSlot = std::bind (&NrGnbPhy::DoStartSlot, this);
+        }
+      NrSchedulingWorkerPool::Get ().AddSlot (GetMacSlotIndications (m_currentSlot),
+                                              doStartSlot);
+      return;
+    }
+
+  CallMacForSlotIndication (m_currentSlot);
+  if (startSlot)
+    {
+      DoStartSlot ();
     }
 }
 
@@ -688,12 +1130,21 @@ void
 NrGnbPhy::StartSlot (const SfnSf &startSlot)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
   NS_ASSERT (m_channelStatus != TO_LOSE);
 
   m_currentSlot = startSlot;
   m_lastSlotStart = Simulator::Now ();
+  UpdateTddPattern ();
 
-  Simulator::Schedule (GetSlotPeriod (), &NrGnbPhy::EndSlot, this);
+  if (m_slotTimingEngine != nullptr)
+    {
+      m_slotTimingEngine->Schedule (GetSlotPeriod (), std::bind (&NrGnbPhy::EndSlot, this));
+    }
+  else
+    {
+      Simulator::Schedule (GetSlotPeriod (), &NrGnbPhy::EndSlot, this);
+    }
 
   // update the current slot allocation; if empty (e.g., at the beginning of simu)
   // then insert a dummy allocation, without anything.
@@ -734,8 +1185,7 @@ NrGnbPhy::StartSlot (const SfnSf &startSlot)
   if (m_channelStatus == GRANTED)
     {
       NS_LOG_INFO ("Channel granted");
-      CallMacForSlotIndication (m_currentSlot);
-      DoStartSlot ();
+      CallMacAndStartSlot (true);
     }
   else
     {
@@ -767,8 +1217,7 @@ NrGnbPhy::StartSlot (const SfnSf &startSlot)
                   // Repetition but we can have a CAM that gives the channel
                   // instantaneously
                   NS_LOG_INFO ("Channel granted; asking MAC for SlotIndication for the future and then start the slot");
-                  CallMacForSlotIndication (m_currentSlot);
-                  DoStartSlot ();
+                  CallMacAndStartSlot (true);
                   return; // Exit without calling anything else
                 }
             }
@@ -794,7 +1243,7 @@ NrGnbPhy::StartSlot (const SfnSf &startSlot)
           // It's an empty slot; ask the MAC for a new one (maybe a new data will arrive..)
           // and just let the current one go away
           NS_LOG_INFO ("Empty slot, but asking MAC for SlotIndication for the future, maybe there will be data");
-          CallMacForSlotIndication (m_currentSlot);
+          CallMacAndStartSlot (false);
         }
       // If we have the UL CTRL, then schedule it (we are listening, so
       // we don't need the channel.
@@ -883,7 +1332,14 @@ void
 NrGnbPhy::GenerateAllocationStatistics (const SlotAllocInfo &allocInfo) const
 {
   NS_LOG_FUNCTION (this);
-  std::unordered_set<uint16_t> activeUe;
+
+  if (m_phySlotDataStats.IsEmpty () && m_phySlotCtrlStats.IsEmpty ())
+    {
+      return;
+    }
+
+  // A handful of UEs per slot: a sorted vector is cheaper than a hash set
+  m_activeUeStat.clear ();
   uint32_t availRb = GetRbNum ();
   uint32_t dataReg = 0;
   uint32_t ctrlReg = 0;
@@ -895,13 +1351,12 @@ NrGnbPhy::GenerateAllocationStatistics (const SlotAllocInfo &allocInfo) const
 
   for (const auto & allocation : allocInfo.m_varTtiAllocInfo)
     {
-      uint32_t rbg = std::count (allocation.m_dci->m_rbgBitmask.begin (),
-                                 allocation.m_dci->m_rbgBitmask.end (), 1);
+      uint32_t rbg = static_cast<uint32_t> (allocation.m_dci->m_rbgBitmask.count ());
 
       // First: Store the RNTI of the UE in the active list
       if (allocation.m_dci->m_rnti != 0)
         {
-          activeUe.insert (allocation.m_dci->m_rnti);
+          m_activeUeStat.push_back (allocation.m_dci->m_rnti);
         }
 
       NS_ASSERT (lastSymStart <= allocation.m_dci->m_symStart);
@@ -936,9 +1391,13 @@ NrGnbPhy::GenerateAllocationStatistics (const SlotAllocInfo &allocInfo) const
   NS_ASSERT_MSG (symUsed == allocInfo.m_numSymAlloc,
                  "Allocated " << +allocInfo.m_numSymAlloc << " but only " << symUsed << " written in stats");
 
-  m_phySlotDataStats (allocInfo.m_sfnSf, activeUe.size (), dataReg, dataSym,
+  std::sort (m_activeUeStat.begin (), m_activeUeStat.end ());
+  uint32_t activeUe = static_cast<uint32_t> (std::unique (m_activeUeStat.begin (), m_activeUeStat.end ())
+                                             - m_activeUeStat.begin ());
+
+  m_phySlotDataStats (allocInfo.m_sfnSf, activeUe, dataReg, dataSym,
                       availRb, GetSymbolsPerSlot () - ctrlSym, GetBwpId (), GetCellId ());
-  m_phySlotCtrlStats (allocInfo.m_sfnSf, activeUe.size (), ctrlReg, ctrlSym,
+  m_phySlotCtrlStats (allocInfo.m_sfnSf, activeUe, ctrlReg, ctrlSym,
                       availRb, GetSymbolsPerSlot () - dataSym, GetBwpId (), GetCellId ());
 }
 
@@ -949,9 +1408,9 @@ NrGnbPhy::DoStartSlot ()
   NS_ASSERT (m_ctrlMsgs.size () == 0); // This assert has to be re-evaluated for NR-U.
                                        // We can have messages before we weren't able to tx them before.
 
-  uint64_t currentSlotN = m_currentSlot.Normalize () % m_tddPattern.size ();;
+  uint64_t currentSlotN = GetPatternPosition (m_currentSlot);
 
-  NS_LOG_DEBUG ("Start Slot " << m_currentSlot << " of type " << m_tddPattern[currentSlotN]);
+  NS_LOG_DEBUG ("Start Slot " << m_currentSlot << " of type " << m_slotPattern[currentSlotN]);
 
   GenerateAllocationStatistics (m_currSlotAllocInfo);
 
@@ -977,7 +1436,11 @@ NrGnbPhy::PrepareRbgAllocationMap (const std::deque<VarTtiAllocInfo> &allocation
   NS_LOG_FUNCTION (this);
 
   // Start with a clean RBG allocation bitmask
-  m_rbgAllocationPerSym.clear ();
+  m_rbgAllocationPerSym.Clear ();
+  m_rbgAllocationPerSymDataStat.Clear ();
+  m_dlLayersPerSym.clear ();
+  const bool rbStats = !m_rbStatistics.IsEmpty ();
+  bool muMimo = false;
 
   // Create RBG map to know where to put power in DL
   for (const auto & allocation : allocations)
@@ -989,21 +1452,83 @@ NrGnbPhy::PrepareRbgAllocationMap (const std::deque<VarTtiAllocInfo> &allocation
               // In m_rbgAllocationPerSym, store only the DL RBG set to 1:
               // these will used to put power
               StoreRBGAllocation (&m_rbgAllocationPerSym, allocation.m_dci);
+              muMimo = muMimo || allocation.m_dci->m_layer > 0;
             }
 
           // For statistics, store UL/DL allocations
-          StoreRBGAllocation (&m_rbgAllocationPerSymDataStat, allocation.m_dci);
+          if (rbStats)
+            {
+              StoreRBGAllocation (&m_rbgAllocationPerSymDataStat, allocation.m_dci);
+            }
         }
     }
 
-  for (const auto & s : m_rbgAllocationPerSymDataStat)
+  if (muMimo)
     {
-      auto & rbgAllocation = s.second;
-      m_rbStatistics (m_currentSlot, s.first, FromRBGBitmaskToRBAssignment (rbgAllocation),
-                      GetBwpId (), GetCellId ());
+      PrepareDlLayers (allocations);
+    }
+
+  if (!rbStats)
+    {
+      return;
+    }
+
+  for (uint8_t sym = 0; sym < RbgAllocationPerSym::MAX_SYMBOLS; ++sym)
+    {
+      if (m_rbgAllocationPerSymDataStat.Has (sym))
+        {
+          m_rbStatistics (m_currentSlot, sym,
+                          FromRBGBitmaskToRBAssignment (m_rbgAllocationPerSymDataStat.Get (sym)),
+                          GetBwpId (), GetCellId ());
+        }
     }
+}
 
-  m_rbgAllocationPerSymDataStat.clear ();
+void
+NrGnbPhy::PrepareDlLayers (const std::deque<VarTtiAllocInfo> &allocations)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (const auto & allocation : allocations)
+    {
+      const auto &dci = allocation.m_dci;
+      if (dci->m_type != DciInfoElementTdma::DATA || dci->m_format != DciInfoElementTdma::DL)
+        {
+          continue;
+        }
+
+      auto &layers = m_dlLayersPerSym[dci->m_symStart];
+      if (layers.size () <= dci->m_layer)
+        {
+          layers.resize (dci->m_layer + 1u);
+        }
+      DlLayer &layer = layers.at (dci->m_layer);
+      if (layer.m_rntis.empty ())
+        {
+          layer.m_beamRnti = dci->m_rnti;
+          layer.m_rbgBitmask = dci->m_rbgBitmask;
+        }
+      else
+        {
+          layer.m_rbgBitmask |= dci->m_rbgBitmask;
+        }
+      layer.m_rntis.insert (dci->m_rnti);
+      if (!dci->m_rbgPower.empty ())
+        {
+          if (layer.m_rbgPower.empty ())
+            {
+              layer.m_rbgPower.assign (dci->m_rbgBitmask.size (), 1.0f);
+            }
+          const NrBitset &mask = dci->m_rbgBitmask;
+          for (size_t rbg = mask.FindFirst (); rbg < mask.size (); rbg = mask.FindNext (rbg))
+            {
+              layer.m_rbgPower[rbg] = dci->m_rbgPower[rbg];
+            }
+        }
+      uint8_t activeStreams = static_cast<uint8_t> (std::count_if (dci->m_tbSize.begin (), dci->m_tbSize.end (),
+                                                                   [] (uint32_t tbSize) { return tbSize > 0; }));
+      layer.m_activeStreams = std::max (layer.m_activeStreams, activeStreams);
+    }
 }
 
 void
@@ -1028,7 +1553,14 @@ NrGnbPhy::FillTheEvent ()
         }
 
       auto varTtiStart = GetSymbolPeriod () * allocation.m_dci->m_symStart;
-      Simulator::Schedule (varTtiStart, &NrGnbPhy::StartVarTti, this, allocation.m_dci);
+      if (m_coalesceVarTtiEvents)
+        {
+          m_varTtiTimeline.Schedule (varTtiStart, std::bind (&NrGnbPhy::StartVarTti, this, allocation.m_dci));
+        }
+      else
+        {
+          Simulator::Schedule (varTtiStart, &NrGnbPhy::StartVarTti, this, allocation.m_dci);
+        }
       lastSymStart = allocation.m_dci->m_symStart;
 
       // If the allocation is DL, then don't schedule anything that is in the
@@ -1045,23 +1577,39 @@ NrGnbPhy::FillTheEvent ()
 }
 
 void
-NrGnbPhy::StoreRBGAllocation (std::unordered_map<uint8_t, std::vector<uint8_t> > *map,
+NrGnbPhy::StoreRBGAllocation (RbgAllocationPerSym *map,
                               const std::shared_ptr<DciInfoElementTdma> &dci) const
 {
   NS_LOG_FUNCTION (this);
 
-  auto itAlloc = map->find (dci->m_symStart);
-  if (itAlloc == map->end ())
+  uint8_t sym = dci->m_symStart;
+  NS_ABORT_MSG_IF (sym >= RbgAllocationPerSym::MAX_SYMBOLS, "Invalid starting symbol " << +sym);
+  if (!map->Has (sym))
     {
-      itAlloc = map->insert (std::make_pair (dci->m_symStart, dci->m_rbgBitmask)).first;
+      // The assignment reuses the words of the bitset of a previous slot
+      map->m_rbg[sym] = dci->m_rbgBitmask;
+      map->m_used |= static_cast<uint16_t> (1u << sym);
     }
   else
     {
-      auto & existingRBGBitmask = itAlloc->second;
+      auto & existingRBGBitmask = map->m_rbg[sym];
       NS_ASSERT (existingRBGBitmask.size () == dci->m_rbgBitmask.size ());
-      for (uint32_t i = 0; i < existingRBGBitmask.size (); ++i)
+      existingRBGBitmask |= dci->m_rbgBitmask;
+    }
+
+  // The RBGs of the DCIs without a power allocation keep the uniform power
+  if (!dci->m_rbgPower.empty ())
+    {
+      std::vector<float> &power = map->m_power[sym];
+      if ((map->m_powerUsed & (1u << sym)) == 0)
+        {
+          power.assign (dci->m_rbgBitmask.size (), 1.0f);
+          map->m_powerUsed |= static_cast<uint16_t> (1u << sym);
+        }
+      const NrBitset &mask = dci->m_rbgBitmask;
+      for (size_t rbg = mask.FindFirst (); rbg < mask.size (); rbg = mask.FindNext (rbg))
         {
-          existingRBGBitmask.at (i) = existingRBGBitmask.at (i) | dci->m_rbgBitmask.at (i);
+          power[rbg] = dci->m_rbgPower[rbg];
         }
     }
 }
@@ -1119,12 +1667,13 @@ std::list <Ptr<NrControlMessage> >
 NrGnbPhy::RetrieveMsgsFromDCIs (const SfnSf &currentSlot)
 {
   std::list <Ptr<NrControlMessage> > ctrlMsgs;
-  uint64_t currentSlotN = currentSlot.Normalize () % m_tddPattern.size ();
+  uint64_t currentSlotN = GetPatternPosition (currentSlot);
 
-  uint32_t k1delay = m_dlHarqfbPosition[currentSlotN];
+  const PatternSlot & patternSlot = (*m_patternSlots)[currentSlotN];
+  uint32_t k1delay = patternSlot.m_dlHarqfbPosition;
 
   // TODO: copy paste :(
-  for (const auto & k0delay : m_toSendDl[currentSlotN])
+  for (const auto & k0delay : patternSlot.m_toSendDl)
     {
       SfnSf targetSlot = currentSlot;
 
@@ -1151,7 +1700,7 @@ NrGnbPhy::RetrieveMsgsFromDCIs (const SfnSf &currentSlot)
         }
     }
 
-  for (const auto & k2delay : m_toSendUl[currentSlotN])
+  for (const auto & k2delay : patternSlot.m_toSendUl)
     {
       SfnSf targetSlot = currentSlot;
 
@@ -1201,10 +1750,12 @@ NrGnbPhy::DlCtrl (const std::shared_ptr<DciInfoElementTdma> &dci)
                     " start " << Simulator::Now () <<
                     " end " << Simulator::Now () + varTtiPeriod - NanoSeconds (1.0));
 
-      for (auto ctrlIt = m_ctrlMsgs.begin (); ctrlIt != m_ctrlMsgs.end (); ++ctrlIt)
+      if (!m_phyTxedCtrlMsgsTrace.IsEmpty ())
         {
-          Ptr<NrControlMessage> msg = (*ctrlIt);
-          m_phyTxedCtrlMsgsTrace (m_currentSlot, GetCellId (), dci->m_rnti, GetBwpId (), msg);
+          for (const auto & msg : m_ctrlMsgs)
+            {
+              m_phyTxedCtrlMsgsTrace (m_currentSlot, GetCellId (), dci->m_rnti, GetBwpId (), msg);
+            }
         }
 
       SendCtrlChannels (varTtiPeriod - NanoSeconds (1.0)); // -1 ns ensures control ends before data period
@@ -1221,6 +1772,7 @@ Time
 NrGnbPhy::UlCtrl(const std::shared_ptr<DciInfoElementTdma> &dci)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
 
   NS_LOG_DEBUG ("Starting UL CTRL TTI at symbol " << +m_currSymStart <<
                 " to " << +m_currSymStart + dci->m_numSym);
@@ -1243,6 +1795,8 @@ NrGnbPhy::DlData (const std::shared_ptr<DciInfoElementTdma> &dci)
                 " to " << +m_currSymStart + dci->m_numSym);
 
   Time varTtiPeriod = GetSymbolPeriod () * dci->m_numSym;
+  auto layersIt = m_dlLayersPerSym.find (dci->m_symStart);
+  const bool multiLayer = layersIt != m_dlLayersPerSym.end () && layersIt->second.size () > 1;
 
   for (uint8_t streamIndex = 0; streamIndex < m_spectrumPhys.size(); streamIndex++)
     {
@@ -1261,6 +1815,13 @@ NrGnbPhy::DlData (const std::shared_ptr<DciInfoElementTdma> &dci)
                     " start " << Simulator::Now () + NanoSeconds (1) <<
                     " end " << Simulator::Now () + varTtiPeriod - NanoSeconds (2.0));
 
+      if (multiLayer)
+        {
+          Simulator::Schedule (NanoSeconds (1.0), &NrGnbPhy::SendDataLayers, this,
+                               pktBurst, varTtiPeriod - NanoSeconds (2.0), dci->m_symStart, streamIndex);
+          continue;
+        }
+
       Simulator::Schedule (NanoSeconds (1.0), &NrGnbPhy::SendDataChannels, this,
                            pktBurst, varTtiPeriod - NanoSeconds (2.0), dci, streamIndex);
     }
@@ -1284,30 +1845,21 @@ NrGnbPhy::UlData(const std::shared_ptr<DciInfoElementTdma> &dci)
 
   if (dci->m_tbSize.at (streamIndex) > 0)
     {
+      FromRBGBitmaskToRBAssignment (dci->m_rbgBitmask, &m_ulRbs);
       m_spectrumPhys.at(streamIndex)->AddExpectedTb (dci->m_rnti, dci->m_ndi.at (streamIndex),
                                                         dci->m_tbSize.at (streamIndex),
                                                         dci->m_mcs.at (streamIndex),
-                                                        FromRBGBitmaskToRBAssignment (dci->m_rbgBitmask),
+                                                        m_ulRbs,
                                                         dci->m_harqProcess, dci->m_rv.at (streamIndex), false,
                                                         dci->m_symStart, dci->m_numSym, m_currentSlot);
      }
 
-  bool found = false;
-  for (uint8_t i = 0; i < m_deviceMap.size (); i++)
-    {
-      Ptr<NrUeNetDevice> ueDev = DynamicCast < NrUeNetDevice > (m_deviceMap.at (i));
-      uint64_t ueRnti = (DynamicCast<NrUePhy>(ueDev->GetPhy (GetBwpId ())))->GetRnti ();
-      if (dci->m_rnti == ueRnti)
-        {
-          // Even if we change the beamforming vector, we hope that the scheduler
-          // has scheduled UEs within the same beam (and, therefore, have the same
-          // beamforming vector)
-          ChangeBeamformingVector (m_deviceMap.at (i)); //assume the control signal is omni
-          found = true;
-          break;
-        }
-    }
-  NS_ASSERT (found);
+  Ptr<NrUeNetDevice> ueDev = FindUeDevice (dci->m_rnti);
+  NS_ASSERT (ueDev != nullptr);
+  // Even if we change the beamforming vector, we hope that the scheduler
+  // has scheduled UEs within the same beam (and, therefore, have the same
+  // beamforming vector)
+  ChangeBeamformingVector (ueDev); //assume the control signal is omni
 
   NS_LOG_INFO ("GNB RXing UL DATA frame " << m_currentSlot <<
                 " symbols "  << static_cast<uint32_t> (dci->m_symStart) <<
@@ -1341,6 +1893,7 @@ Time
 NrGnbPhy::UlSrs (const std::shared_ptr<DciInfoElementTdma> &dci)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
 
   NS_LOG_DEBUG ("Starting UL SRS TTI at symbol " << +m_currSymStart <<
                 " to " << +m_currSymStart + dci->m_numSym);
@@ -1352,34 +1905,22 @@ NrGnbPhy::UlSrs (const std::shared_ptr<DciInfoElementTdma> &dci)
       m_spectrumPhys.at(streamIndex)->AddExpectedSrsRnti (dci->m_rnti);
     }
 
-  bool found = false;
-  uint16_t notValidRntiCounter = 0; // count if there are in the list of devices without initialized RNTI (rnti = 0)
-                                    // if yes, and the rnti for the current SRS is not found in the list,
-                                    // the code will not abort
-  for (uint8_t i = 0; i < m_deviceMap.size (); i++)
+  Ptr<NrUeNetDevice> ueDev = FindUeDevice (dci->m_rnti);
+  if (ueDev != nullptr)
     {
-      Ptr<NrUeNetDevice> ueDev = DynamicCast < NrUeNetDevice > (m_deviceMap.at (i));
-      uint64_t ueRnti = (DynamicCast<NrUePhy>(ueDev->GetPhy (0)))->GetRnti ();
-      if (ueRnti == 0)
-        {
-          notValidRntiCounter++;
-        }
-      if (dci->m_rnti == ueRnti)
-        {
-          // Even if we change the beamforming vector, we hope that the scheduler
-          // has scheduled UEs within the same beam (and, therefore, have the same
-          // beamforming vector)
-          ChangeBeamformingVector (m_deviceMap.at (i)); //assume the control signal is omni
-          found = true;
-          break;
-        }
+      // Even if we change the beamforming vector, we hope that the scheduler
+      // has scheduled UEs within the same beam (and, therefore, have the same
+      // beamforming vector)
+      ChangeBeamformingVector (ueDev); //assume the control signal is omni
     }
-
-  NS_ABORT_MSG_IF (!found && (notValidRntiCounter == 0), "All RNTIs are already set (all UEs received RAR message), "
-                                                         "but the RNTI for this SRS was not found");
-
-  if (!found)
+  else
     {
+      // Abort only if every device has its RNTI (all UEs received the RAR message)
+      bool notValidRnti = std::any_of (m_deviceMap.begin (), m_deviceMap.end (),
+                                       [this] (const Ptr<NrUeNetDevice> &dev)
+                                       { return dev->GetPhy (GetBwpId ())->GetRnti () == 0; });
+      NS_ABORT_MSG_IF (!notValidRnti, "All RNTIs are already set (all UEs received RAR message), "
+                                      "but the RNTI for this SRS was not found");
       NS_LOG_WARN ("The UE for which is scheduled this SRS does not have yet initialized RNTI. RAR message was not received yet.");
     }
 
@@ -1395,6 +1936,7 @@ void
 NrGnbPhy::StartVarTti (const std::shared_ptr<DciInfoElementTdma> &dci)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
   ChangeToQuasiOmniBeamformingVector (); //assume the control signal is omni
   m_currSymStart = dci->m_symStart;
 
@@ -1428,13 +1970,21 @@ NrGnbPhy::StartVarTti (const std::shared_ptr<DciInfoElementTdma> &dci)
       varTtiPeriod = UlSrs (dci);
     }
 
-  Simulator::Schedule (varTtiPeriod, &NrGnbPhy::EndVarTti, this, dci);
+  if (m_coalesceVarTtiEvents)
+    {
+      m_varTtiTimeline.Schedule (varTtiPeriod, std::bind (&NrGnbPhy::EndVarTti, this, dci));
+    }
+  else
+    {
+      Simulator::Schedule (varTtiPeriod, &NrGnbPhy::EndVarTti, this, dci);
+    }
 }
 
 void
 NrGnbPhy::EndVarTti (const std::shared_ptr<DciInfoElementTdma> &lastDci)
 {
   NS_LOG_FUNCTION (this << Simulator::Now ().GetSeconds ());
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
 
   NS_LOG_DEBUG ("DCI started at symbol " << static_cast<uint32_t> (lastDci->m_symStart) <<
                 " which lasted for " << static_cast<uint32_t> (lastDci->m_numSym) <<
@@ -1445,6 +1995,7 @@ void
 NrGnbPhy::EndSlot (void)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
 
   Time slotStart = m_lastSlotStart + GetSlotPeriod () - Simulator::Now ();
 
@@ -1457,37 +2008,167 @@ NrGnbPhy::EndSlot (void)
 
   NS_LOG_DEBUG ("Slot started at " << m_lastSlotStart << " ended");
   m_currentSlot.Add (1);
-  Simulator::Schedule (slotStart, &NrGnbPhy::StartSlot, this, m_currentSlot);
+
+  uint32_t idleSlots = GetIdleSlotsToSkip ();
+  m_slotActivity = false;
+  if (idleSlots > 0)
+    {
+      StartFastForward (idleSlots);
+      return;
+    }
+
+  if (m_slotTimingEngine != nullptr)
+    {
+      m_slotTimingEngine->Schedule (slotStart, std::bind (&NrGnbPhy::StartSlot, this, m_currentSlot));
+    }
+  else
+    {
+      Simulator::Schedule (slotStart, &NrGnbPhy::StartSlot, this, m_currentSlot);
+    }
 }
 
-void
-NrGnbPhy::SendDataChannels (const Ptr<PacketBurst> &pb, const Time &varTtiPeriod,
-                            const std::shared_ptr<DciInfoElementTdma> &dci,
-                            const uint8_t &streamId)
+uint32_t
+NrGnbPhy::GetIdleSlotsToSkip () const
 {
   NS_LOG_FUNCTION (this);
-  // update beamforming vectors (currently supports 1 user only)
-  bool found = false;
-  for (uint8_t i = 0; i < m_deviceMap.size (); i++)
+
+  if (m_idleSlotFastForward == 0 || m_slotActivity || m_channelStatus == REQUESTED
+      || !m_ctrlMsgs.empty () || HasPendingTransmissions ())
     {
-      Ptr<NrUeNetDevice> ueDev = DynamicCast<NrUeNetDevice> (m_deviceMap.at (i));
-      uint64_t ueRnti = (DynamicCast<NrUePhy>(ueDev->GetPhy (GetBwpId ())))->GetRnti ();
-      //NS_LOG_INFO ("Scheduled rnti:"<<rnti <<" ue rnti:"<< ueRnti);
-      if (dci->m_rnti == ueRnti)
+      return 0;
+    }
+
+  SfnSf slot = m_currentSlot;
+  uint32_t idleSlots = 0;
+  while (idleSlots < m_idleSlotFastForward)
+    {
+      // The primary PHY sends the MIB and the SIB1 in the first slot of the
+      // subframes 0 and 5: that slot has to be run
+      if (m_isPrimary && slot.GetSlot () == 0 && (slot.GetSubframe () == 0 || slot.GetSubframe () == 5))
         {
-          ChangeBeamformingVector(m_deviceMap.at (i));
-          found = true;
           break;
         }
+      slot.Add (1);
+      ++idleSlots;
+    }
+  return idleSlots;
+}
+
+void
+NrGnbPhy::StartFastForward (uint32_t idleSlots)
+{
+  NS_LOG_FUNCTION (this << idleSlots);
+
+  m_fastForwardFirstSlot = m_currentSlot;
+  SfnSf startSlot = m_currentSlot;
+  startSlot.Add (idleSlots);
+  Time start = m_lastSlotStart + GetSlotPeriod () * (idleSlots + 1);
+  NS_LOG_INFO ("Skip the idle slots from " << m_currentSlot << ", next slot " << startSlot << " at " << start);
+
+  // Listen with the quasi-omni beam, as in the UL CTRL of the skipped slots
+  ChangeToQuasiOmniBeamformingVector ();
+  m_fastForwardEvent = Simulator::Schedule (start - Simulator::Now (), &NrGnbPhy::EndFastForward,
+                                            this, startSlot);
+
+  // No DCI is sent before start: the UEs of this cell can skip the slots too
+  for (const auto & ueDev : m_deviceMap)
+    {
+      Ptr<NrUePhy> uePhy = ueDev->GetPhy (GetBwpId ());
+      if (uePhy && uePhy->GetCellId () == GetCellId ())
+        {
+          uePhy->NotifyGnbIdleUntil (GetCellId (), start);
+        }
+    }
+}
+
+void
+NrGnbPhy::EndFastForward (const SfnSf &startSlot)
+{
+  NS_LOG_FUNCTION (this << startSlot);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
+
+  if (m_channelStatus == TO_LOSE)
+    {
+      NS_LOG_INFO ("Release the channel, it was lost during the skipped slots");
+      m_channelStatus = NONE;
+      m_channelLostTimer.Cancel ();
+    }
+
+  m_currentSlot = startSlot;
+  DiscardSlotAllocInfoBefore (startSlot);
+
+  for (const auto & ueDev : m_deviceMap)
+    {
+      Ptr<NrUePhy> uePhy = ueDev->GetPhy (GetBwpId ());
+      if (uePhy && uePhy->GetCellId () == GetCellId ())
+        {
+          uePhy->NotifyGnbIdleUntil (GetCellId (), Simulator::Now ());
+        }
+    }
+
+  StartSlot (startSlot);
+}
+
+void
+NrGnbPhy::WakeUp ()
+{
+  NS_LOG_FUNCTION (this);
+  m_slotActivity = true;
+  if (!m_fastForwardEvent.IsRunning ())
+    {
+      return;
+    }
+
+  uint32_t slots = GetSlotsToNextSlotStart (m_lastSlotStart);
+  SfnSf startSlot = m_fastForwardFirstSlot;
+  startSlot.Add (slots - 1);
+  Time start = m_lastSlotStart + GetSlotPeriod () * slots;
+  if (start >= Simulator::Now () + Simulator::GetDelayLeft (m_fastForwardEvent))
+    {
+      return;
+    }
+
+  NS_LOG_INFO ("Stop skipping the slots, next slot " << startSlot << " at " << start);
+  m_fastForwardEvent.Cancel ();
+  m_fastForwardEvent = Simulator::Schedule (start - Simulator::Now (), &NrGnbPhy::EndFastForward,
+                                            this, startSlot);
+}
+
+void
+NrGnbPhy::PageUe (uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << rnti);
+  Ptr<NrUeNetDevice> ueDev = FindUeDevice (rnti);
+  if (ueDev == nullptr)
+    {
+      return;
+    }
+  Ptr<NrUePhy> uePhy = ueDev->GetPhy (GetBwpId ());
+  if (uePhy->GetCellId () == GetCellId () && uePhy->IsIdle ())
+    {
+      NS_LOG_INFO ("Page the idle UE " << rnti);
+      uePhy->WakeUp ();
     }
-  NS_ABORT_IF (!found);
+}
+
+void
+NrGnbPhy::SendDataChannels (const Ptr<PacketBurst> &pb, const Time &varTtiPeriod,
+                            const std::shared_ptr<DciInfoElementTdma> &dci,
+                            const uint8_t &streamId)
+{
+  NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
+  // update beamforming vectors (currently supports 1 user only)
+  Ptr<NrUeNetDevice> ueDev = FindUeDevice (dci->m_rnti);
+  NS_ABORT_IF (ueDev == nullptr);
+  ChangeBeamformingVector (ueDev);
 
 
   // in the map we stored the RBG allocated by the MAC for this symbol.
   // If the transmission last n symbol (n > 1 && n < 12) the SetSubChannels
   // doesn't need to be called again. In fact, SendDataChannels will be
   // invoked only when the symStart changes.
-  NS_ASSERT (m_rbgAllocationPerSym.find(dci->m_symStart) != m_rbgAllocationPerSym.end ());
+  NS_ASSERT (m_rbgAllocationPerSym.Has (dci->m_symStart));
 
   uint8_t activeStreams = 0;
   for (const auto& tbSize : dci->m_tbSize)
@@ -1497,17 +2178,81 @@ NrGnbPhy::SendDataChannels (const Ptr<PacketBurst> &pb, const Time &varTtiPeriod
           activeStreams++;
         }
     }
-  SetSubChannels (FromRBGBitmaskToRBAssignment (m_rbgAllocationPerSym.at (dci->m_symStart)), activeStreams);
+  SetSubChannels (FromRBGBitmaskToRBAssignment (m_rbgAllocationPerSym.Get (dci->m_symStart)), activeStreams,
+                  m_rbgAllocationPerSym.GetPower (dci->m_symStart));
 
   std::list<Ptr<NrControlMessage> > ctrlMsgs;
   m_spectrumPhys.at (streamId)->StartTxDataFrames (pb, ctrlMsgs, varTtiPeriod);
 }
 
+void
+NrGnbPhy::SendDataLayers (const Ptr<PacketBurst> &pb, const Time &varTtiPeriod,
+                          uint8_t symStart, uint8_t streamId)
+{
+  NS_LOG_FUNCTION (this << +symStart);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
+  const auto &layers = m_dlLayersPerSym.at (symStart);
+
+  // Split the packets among the layers, by the RNTI of their bearer
+  std::vector<Ptr<PacketBurst> > bursts (layers.size ());
+  for (const auto &packet : pb->GetPackets ())
+    {
+      LteRadioBearerTag bearerTag;
+      if (!packet->PeekPacketTag (bearerTag))
+        {
+          NS_FATAL_ERROR ("No radio bearer tag in a DL DATA packet");
+        }
+      for (size_t i = 0; i < layers.size (); ++i)
+        {
+          if (layers.at (i).m_rntis.count (bearerTag.GetRnti ()) > 0)
+            {
+              if (bursts.at (i) == nullptr)
+                {
+                  bursts.at (i) = CreateObject<PacketBurst> ();
+                }
+              bursts.at (i)->AddPacket (packet);
+              break;
+            }
+        }
+    }
+
+  // The power is shared among the layers with data
+  uint8_t numLayers = static_cast<uint8_t> (std::count_if (bursts.begin (), bursts.end (),
+                                                           [] (const Ptr<PacketBurst> &b) { return b != nullptr; }));
+  std::vector<NrSpectrumPhy::TxDataLayer> txLayers;
+  txLayers.reserve (numLayers);
+  for (size_t i = 0; i < layers.size (); ++i)
+    {
+      if (bursts.at (i) == nullptr)
+        {
+          continue;
+        }
+      Ptr<NrUeNetDevice> ueDev = FindUeDevice (layers.at (i).m_beamRnti);
+      NS_ABORT_IF (ueDev == nullptr);
+      Ptr<SpectrumValue> txPsd = GetTxPowerSpectralDensity (FromRBGBitmaskToRBAssignment (layers.at (i).m_rbgBitmask),
+                                                            layers.at (i).m_activeStreams * numLayers,
+                                                            layers.at (i).m_rbgPower);
+      txLayers.push_back ({bursts.at (i), txPsd, ueDev});
+    }
+
+  NS_LOG_INFO ("ENB TXing " << txLayers.size () << " DL DATA layers at symbol " << +symStart);
+  m_spectrumPhys.at (streamId)->StartTxDataLayers (txLayers, varTtiPeriod);
+}
+
 void
 NrGnbPhy::SendCtrlChannels (const Time &varTtiPeriod)
 {
   NS_LOG_FUNCTION (this << "Send Ctrl");
 
+  if (m_idealCtrl)
+    {
+      NrCounters::Add (NrCounters::CTRL_MESSAGES, m_ctrlMsgs.size ());
+      Simulator::Schedule (varTtiPeriod, &NrGnbPhy::DeliverIdealCtrl, this,
+                           Create<const NrControlMessageBundle> (m_ctrlMsgs));
+      m_ctrlMsgs.clear ();
+      return;
+    }
+
   std::vector <int> fullBwRb (GetRbNum ());
   // The first time set the right values for the phy
   for (uint32_t i = 0; i < fullBwRb.size (); ++i)
@@ -1522,6 +2267,21 @@ NrGnbPhy::SendCtrlChannels (const Time &varTtiPeriod)
   m_ctrlMsgs.clear ();
 }
 
+void
+NrGnbPhy::DeliverIdealCtrl (const Ptr<const NrControlMessageBundle> &bundle)
+{
+  NS_LOG_FUNCTION (this);
+  // As the DL CTRL signal, only the first stream of the UEs receives them
+  for (const auto & ueDev : m_deviceMap)
+    {
+      Ptr<NrUePhy> uePhy = ueDev->GetPhy (GetBwpId ());
+      if (uePhy && uePhy->GetCellId () == GetCellId ())
+        {
+          uePhy->GetSpectrumPhy (0)->ReceiveIdealCtrl (bundle);
+        }
+    }
+}
+
 bool
 NrGnbPhy::RegisterUe (uint64_t imsi, const Ptr<NrUeNetDevice> &ueDevice)
 {
@@ -1545,6 +2305,7 @@ NrGnbPhy::RegisterUe (uint64_t imsi, const Ptr<NrUeNetDevice> &ueDevice)
 void
 NrGnbPhy::PhyDataPacketReceived (const Ptr<Packet> &p)
 {
+  WakeUp ();
   Simulator::ScheduleWithContext (m_netDevice->GetNode ()->GetId (),
                                   GetTbDecodeLatency (),
                                   &NrGnbPhySapUser::ReceivePhyPdu,
@@ -1583,6 +2344,7 @@ void
 NrGnbPhy::PhyCtrlMessagesReceived (const Ptr<NrControlMessage> &msg)
 {
   NS_LOG_FUNCTION (this);
+  WakeUp ();
 
   if (msg->GetMessageType () == NrControlMessage::DL_CQI)
     {
@@ -1655,6 +2417,7 @@ NrGnbPhy::DoAddUe ([[maybe_unused]] uint16_t rnti)
     {
       m_ueAttachedRnti.insert (rnti);
     }
+  WakeUp ();
 }
 
 void
@@ -1671,6 +2434,8 @@ NrGnbPhy::DoRemoveUe (uint16_t rnti)
     {
       NS_FATAL_ERROR ("Impossible to remove UE, not attached!");
     }
+  m_ueByRnti.erase (rnti);
+  WakeUp ();
 }
 
 void
@@ -1772,6 +2537,34 @@ NrGnbPhy::GetPattern () const
   return NrPhy::GetPattern (m_tddPattern);
 }
 
+void
+NrGnbPhy::SetNumSchedulingWorkers (uint32_t numWorkers)
+{
+  NS_LOG_FUNCTION (this << numWorkers);
+  NS_ABORT_MSG_IF (numWorkers == 0, "At least one scheduling worker is needed");
+  m_numSchedulingWorkers = numWorkers;
+  NrSchedulingWorkerPool::Get ().SetNumWorkers (numWorkers);
+}
+
+uint32_t
+NrGnbPhy::GetNumSchedulingWorkers () const
+{
+  return m_numSchedulingWorkers;
+}
+
+void
+NrGnbPhy::SetIdleSlotFastForward (uint32_t slots)
+{
+  NS_LOG_FUNCTION (this << slots);
+  m_idleSlotFastForward = slots;
+}
+
+uint32_t
+NrGnbPhy::GetIdleSlotFastForward () const
+{
+  return m_idleSlotFastForward;
+}
+
 void
 NrGnbPhy::SetPrimary ()
 {
@@ -1815,6 +2608,7 @@ void
 NrGnbPhy::ChannelAccessLost ()
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
   NS_LOG_INFO ("Channel access lost");
   m_channelStatus = NONE;
 }
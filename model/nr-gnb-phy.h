@@ -23,9 +23,13 @@
 #include <ns3/lte-enb-phy-sap.h>
 #include <ns3/lte-enb-cphy-sap.h>
 #include <ns3/nr-harq-phy.h>
+#include <array>
 #include <functional>
+#include <memory>
+#include <unordered_map>
 #include "ns3/ideal-beamforming-algorithm.h"
 #include "beam-conf-id.h"
+#include "nr-var-tti-timeline.h"
 
 namespace ns3 {
 
@@ -36,6 +40,7 @@ class NrUePhy;
 class NrGnbMac;
 class NrChAccessManager;
 class BeamManager;
+class NrSlotTimingEngine;
 
 /**
  *
@@ -190,6 +195,25 @@ public:
    */
   BeamConfId GetBeamConfId (uint16_t rnti) const override;
 
+  /**
+   * \brief Get the coupling between two beams, from the beamforming vectors
+   * saved toward the UEs in the beam manager of the first antenna
+   * \param a the first beam
+   * \param b the second beam
+   * \return the normalized gain of a toward b, or -1 if unknown
+   */
+  double GetBeamCoupling (const BeamConfId &a, const BeamConfId &b) const override;
+
+  /**
+   * \brief Report to the MAC the BeamConfId of a UE whose beam changed
+   * \param device the UE device
+   *
+   * Called by the beam managers of this PHY. If the UE does not have an
+   * RNTI yet, there is nothing to report: the MAC gets the BeamConfId of
+   * the UE when it adds it.
+   */
+  void ReportBeamChange (const Ptr<const NetDevice> &device);
+
   /**
    * \brief Set the channel access manager interface for this instance of the PHY
    * \param s the pointer to the interface
@@ -202,6 +226,15 @@ public:
    */
   Ptr<NrChAccessManager> GetCam () const;
 
+  /**
+   * \brief Set the clock shared with the other PHYs of the gNB
+   * \param engine the slot timing engine (nullptr to use a private chain of events)
+   *
+   * The slot boundaries are scheduled through the engine, that runs the
+   * boundaries of all the PHYs falling at the same instant in one event.
+   */
+  void SetSlotTimingEngine (const Ptr<NrSlotTimingEngine> &engine);
+
   /**
    * \brief Set the transmission power for the UE
    *
@@ -223,8 +256,11 @@ public:
    * \param rbIndexVector vector of the index of the RB (in SpectrumValue array)
    * in which there is a transmission
    * \param activeStreams the number of active streams
+   * \param rbgPower the power of each RBG relative to a uniform allocation
+   * (empty: uniform)
    */
-  void SetSubChannels (const std::vector<int> &rbIndexVector, uint8_t activeStreams);
+  void SetSubChannels (const std::vector<int> &rbIndexVector, uint8_t activeStreams,
+                       const std::vector<float> &rbgPower = {});
 
   /**
    * \brief Add the UE to the list of this gnb UEs.
@@ -308,6 +344,97 @@ public:
    */
   std::string GetPattern() const;
 
+  /**
+   * \brief Get the first slot from which the TDD pattern may change
+   * \param pattern the new pattern
+   * \return the absolute slot number (see SfnSf::Normalize)
+   *
+   * It is the first slot in which both the current and the new pattern
+   * start, after the slots already being scheduled with the current
+   * pattern.
+   */
+  uint64_t GetEarliestTddPatternChange (const std::vector<LteNrTddSlotType> &pattern) const;
+
+  /**
+   * \brief Change the TDD pattern during the simulation
+   * \param pattern the new pattern
+   * \param switchSlot the absolute slot number from which the new pattern is
+   * used: not before GetEarliestTddPatternChange, and a multiple of the
+   * lengths of both patterns
+   *
+   * Both patterns must be TDD, and no other change must be pending. The
+   * K0, K1 and K2 of the slots around the switch are computed over the old
+   * pattern followed by the new one, so that each slot is scheduled once,
+   * with its actual type. The UEs attached to the PHY get the change at
+   * once (see NrUePhy::ChangeTddPattern).
+   */
+  void ChangeTddPattern (const std::vector<LteNrTddSlotType> &pattern, uint64_t switchSlot);
+
+  /**
+   * \return true if a change of the TDD pattern is pending
+   */
+  bool IsTddPatternChanging () const;
+
+  /**
+   * \brief Give to a UE PHY the pending change of the TDD pattern, if any
+   * \param uePhy the UE PHY, that has the current pattern
+   */
+  void ForwardTddPatternChange (const Ptr<NrUePhy> &uePhy) const;
+
+  /**
+   * \brief Set the number of threads that run the schedulers of the gNBs
+   *
+   * With more than 1, the MAC indications of the slot are not called
+   * directly, but through the NrSchedulingWorkerPool, that runs in parallel
+   * the schedulers of all the PHYs that start a slot at the same time.
+   *
+   * \param numWorkers the number of threads (1: serial scheduling)
+   * \see NrSchedulingWorkerPool
+   */
+  void SetNumSchedulingWorkers (uint32_t numWorkers);
+
+  /**
+   * \return the number of threads that run the schedulers of the gNBs
+   */
+  uint32_t GetNumSchedulingWorkers () const;
+
+  /**
+   * \brief Set the maximum number of idle slots skipped at once
+   *
+   * When a slot ends with nothing to transmit or to receive in the next
+   * slots (no DATA or SRS allocation, no control message, no reception nor
+   * MAC activity in the slot), the PHY does not run the next slots: it
+   * advances its slot counter arithmetically, and tells the attached UEs
+   * that they can do the same. The PHY restarts at the next slot boundary
+   * when it receives something, when the MAC has new data, and before the
+   * MIB and SIB1 of a primary PHY. The MAC is not called in the skipped
+   * slots.
+   *
+   * \param slots the maximum number of slots to skip (0: disabled)
+   */
+  void SetIdleSlotFastForward (uint32_t slots);
+
+  /**
+   * \return the maximum number of idle slots skipped at once
+   */
+  uint32_t GetIdleSlotFastForward () const;
+
+  /**
+   * \brief Restart the slots at the next slot boundary, if they are skipped
+   */
+  virtual void WakeUp () override;
+
+  /**
+   * \brief Wake up the UE of this cell with the RNTI, if it is idle (see
+   * the NrUePhy attribute InactivityTimer)
+   *
+   * The UE restarts its slots at its next slot boundary, before the slot of
+   * the first DCI that can be sent to it.
+   *
+   * \param rnti the RNTI of the UE
+   */
+  virtual void PageUe (uint16_t rnti) override;
+
   /**
    * \brief Set this PHY as primary
    *
@@ -387,6 +514,14 @@ public:
                                          const std::vector<int> &rbMap,
                                          uint16_t bwpId, uint16_t cellId);
 
+  /**
+   * TracedCallback signature for the change of the TDD pattern.
+   *
+   * \param [in] switchSlot the absolute slot from which the pattern is used
+   * \param [in] pattern the new pattern
+   */
+  typedef void (* TddPatternChangeTracedCallback)(uint64_t switchSlot, const std::string &pattern);
+
   /**
    * \brief Retrieve the number of RB per RBG
    * \return the number of RB per RBG
@@ -407,6 +542,33 @@ public:
   void ChangeToQuasiOmniBeamformingVector ();
 
 protected:
+  /**
+   * \brief Find the BeamConfId of a UE
+   * \param rnti the RNTI of the UE
+   * \param beamConfId the BeamConfId, if found
+   * \return true if a registered UE device has the RNTI
+   */
+  bool FindBeamConfId (uint16_t rnti, BeamConfId *beamConfId) const;
+
+  /**
+   * \brief Find the registered UE device with an RNTI
+   *
+   * The UE gets its RNTI with the RAR, after RegisterUe and DoAddUe: the
+   * device is looked for in m_deviceMap the first time its RNTI is asked,
+   * and then indexed. An indexed entry whose PHY does not have the RNTI
+   * anymore is looked for again.
+   *
+   * \param rnti the RNTI of the UE
+   * \return the device, or nullptr if no registered device has the RNTI
+   */
+  Ptr<NrUeNetDevice> FindUeDevice (uint16_t rnti) const;
+
+  /**
+   * \brief Report to the MAC the BeamConfId of the unresolved RNTIs that
+   * a UE device now has
+   */
+  void ReportResolvedBeams ();
+
   /**
    * \brief DoDispose method inherited from Object
    */
@@ -417,10 +579,34 @@ private:
    * \brief Set the current slot pattern (better to call it only once..)
    * \param pattern the pattern
    *
-   * It does not support dynamic change of pattern during the simulation
+   * It cancels a pending change, see ChangeTddPattern
    */
   void SetTddPattern (const std::vector<LteNrTddSlotType> &pattern);
 
+  /**
+   * \brief Move to the structures of the slot being started, when a change
+   * of the TDD pattern is pending
+   */
+  void UpdateTddPattern ();
+
+  /**
+   * \brief Get the position of a slot in the pattern of m_patternSlots
+   * \param slot the slot
+   * \return the position
+   */
+  uint64_t GetPatternPosition (const SfnSf &slot) const;
+
+  /**
+   * \brief Get how many times the current and a new pattern are repeated
+   * around a switch
+   * \param pattern the new pattern
+   * \return the repetitions of the current and of the new pattern
+   *
+   * Each side of the switch is at least as long as the farthest slot that
+   * the structures of the patterns reach (generation plus HARQ feedback).
+   */
+  std::pair<uint32_t, uint32_t> GetTddTransitionRepetitions (const std::vector<LteNrTddSlotType> &pattern) const;
+
   /**
    * \brief Start the slot processing.
    * \param startSlot slot number
@@ -443,6 +629,24 @@ private:
    */
   void EndSlot (void);
 
+  /**
+   * \brief Get the number of idle slots that can be skipped from m_currentSlot
+   * \return the number of slots, 0 if the next slot has to be run
+   */
+  uint32_t GetIdleSlotsToSkip () const;
+
+  /**
+   * \brief Skip the idle slots from m_currentSlot
+   * \param idleSlots the number of slots to skip
+   */
+  void StartFastForward (uint32_t idleSlots);
+
+  /**
+   * \brief Stop skipping the slots, and start the slot
+   * \param startSlot the slot to start
+   */
+  void EndFastForward (const SfnSf &startSlot);
+
   /**
    * \brief Start the processing of a variable TTI
    * \param dci the DCI of the variable TTI
@@ -487,6 +691,24 @@ private:
                          const std::shared_ptr<DciInfoElementTdma> &dci,
                          const uint8_t &streamId);
 
+  /**
+   * \brief Transmit to the spectrum phy the data of the MU-MIMO layers
+   * starting at a symbol, each layer with the beam of its UEs
+   *
+   * \param pb Data of all the layers, split by the RNTI of the packets
+   * \param varTtiPeriod period of transmission
+   * \param symStart the starting symbol of the layers
+   * \param streamId The id of the stream
+   */
+  void SendDataLayers (const Ptr<PacketBurst> &pb, const Time &varTtiPeriod,
+                       uint8_t symStart, uint8_t streamId);
+
+  /**
+   * \brief Store in m_dlLayersPerSym the MU-MIMO layers of the DL DATA
+   * \param allocations the allocations of the slot
+   */
+  void PrepareDlLayers (const std::deque<VarTtiAllocInfo> &allocations);
+
   /**
    * \brief Transmit the control channel
    *
@@ -496,6 +718,12 @@ private:
    */
   void SendCtrlChannels (const Time &varTtiPeriod);
 
+  /**
+   * \brief Deliver DL CTRL messages to the UEs of the cell, with the ideal control
+   * \param bundle the messages
+   */
+  void DeliverIdealCtrl (const Ptr<const NrControlMessageBundle> &bundle);
+
   /**
    * \brief Create a list of messages that contains the DCI to send in the slot specified
    * \param sfn Slot from which take all the DCI
@@ -603,12 +831,64 @@ private:
   void DoSetEarfcn (uint16_t Earfcn );
 
   /**
-   * \brief Store the RBG allocation in the symStart, rbg map.
-   * \param map the MAP
+   * \brief The RBGs allocated in each symbol of a slot, by starting symbol
+   *
+   * A fixed array indexed by the starting symbol, with a mask of the symbols
+   * that hold an allocation: clearing it and storing into it reuse the
+   * bitsets of the previous slots.
+   */
+  struct RbgAllocationPerSym
+  {
+    static const uint8_t MAX_SYMBOLS = 14; //!< Maximum number of symbols in a slot
+
+    std::array<NrBitset, MAX_SYMBOLS> m_rbg; //!< RBGs allocated, by starting symbol
+    uint16_t m_used {0};                     //!< Bit i is set if m_rbg[i] holds an allocation
+    std::array<std::vector<float>, MAX_SYMBOLS> m_power; //!< Power of each RBG relative to a uniform allocation, by starting symbol
+    uint16_t m_powerUsed {0};                //!< Bit i is set if m_power[i] holds the power of a DCI
+
+    /**
+     * \brief Remove all the allocations
+     */
+    void Clear ()
+    {
+      m_used = 0;
+      m_powerUsed = 0;
+    }
+    /**
+     * \param sym the starting symbol
+     * \return the power of the RBGs at sym, or an empty vector if it is uniform
+     */
+    const std::vector<float> & GetPower (uint8_t sym) const
+    {
+      static const std::vector<float> uniform;
+      return sym < MAX_SYMBOLS && (m_powerUsed & (1u << sym)) != 0 ? m_power[sym] : uniform;
+    }
+    /**
+     * \param sym the starting symbol
+     * \return true if there is an allocation starting at sym
+     */
+    bool Has (uint8_t sym) const
+    {
+      return sym < MAX_SYMBOLS && (m_used & (1u << sym)) != 0;
+    }
+    /**
+     * \param sym the starting symbol, that must hold an allocation
+     * \return the RBGs allocated at sym
+     */
+    const NrBitset & Get (uint8_t sym) const
+    {
+      NS_ASSERT (Has (sym));
+      return m_rbg[sym];
+    }
+  };
+
+  /**
+   * \brief Store the RBG allocation of a DCI at its starting symbol
+   * \param map the allocation of the symbols
    * \param dci DCI
    *
    */
-  void StoreRBGAllocation (std::unordered_map<uint8_t, std::vector<uint8_t> > *map,
+  void StoreRBGAllocation (RbgAllocationPerSym *map,
                            const std::shared_ptr<DciInfoElementTdma> &dci) const;
 
   /**
@@ -638,6 +918,24 @@ private:
    */
   void CallMacForSlotIndication (const SfnSf &currentSlot);
 
+  /**
+   * \brief Get the MAC indications of a slot, in the order they have to be called
+   * \param currentSlot Current slot
+   * \return the UL indications, then the DL ones; the first one also sets
+   * the current slot in the MAC
+   */
+  std::vector<std::function<void ()>> GetMacSlotIndications (const SfnSf &currentSlot);
+
+  /**
+   * \brief Call the MAC for the slot indications, and then start the slot
+   *
+   * With more than one scheduling worker, the calls are made by the
+   * NrSchedulingWorkerPool, together with the ones of the other PHYs.
+   *
+   * \param startSlot if true, call DoStartSlot after the MAC
+   */
+  void CallMacAndStartSlot (bool startSlot);
+
   /**
    * \brief Retrieve a DCI list for the allocation passed as parameter
    * \param alloc The allocation we are searching in
@@ -715,11 +1013,36 @@ private:
   std::set <uint16_t> m_ueAttachedRnti; //!< Set of attached UE (by RNTI)
   std::vector< Ptr<NrUeNetDevice> > m_deviceMap; //!< Vector of UE devices
 
+  /**
+   * \brief A registered UE, indexed by its RNTI
+   */
+  struct UeEntry
+  {
+    Ptr<NrUeNetDevice> m_device; //!< The UE device
+    Ptr<NrUePhy> m_phy;          //!< The PHY of the UE device in this BWP
+  };
+  mutable std::unordered_map<uint16_t, UeEntry> m_ueByRnti; //!< The UEs of m_deviceMap that got an RNTI (see FindUeDevice)
+  mutable std::set<uint16_t> m_unresolvedBeamRnti; //!< RNTIs asked with GetBeamConfId before their device had the RNTI
+
   LteRrcSap::SystemInformationBlockType1 m_sib1; //!< SIB1 message
   Time m_lastSlotStart; //!< Time at which the last slot started
   uint8_t m_currSymStart {0}; //!< Symbol at which the current allocation started
-  std::unordered_map<uint8_t, std::vector<uint8_t> > m_rbgAllocationPerSym;  //!< RBG allocation in each sym
-  std::unordered_map<uint8_t, std::vector<uint8_t> > m_rbgAllocationPerSymDataStat;  //!< RBG allocation in each sym, for statistics (UL and DL included, only data)
+  RbgAllocationPerSym m_rbgAllocationPerSym;  //!< RBG allocation in each sym
+
+  /**
+   * \brief A MU-MIMO layer of the DL DATA starting at a symbol
+   */
+  struct DlLayer
+  {
+    NrBitset m_rbgBitmask;        //!< The RBGs of the layer
+    std::set<uint16_t> m_rntis;   //!< The UEs of the layer
+    uint16_t m_beamRnti {0};      //!< The UE whose beam is used for the layer
+    uint8_t m_activeStreams {1};  //!< The number of streams with data
+    std::vector<float> m_rbgPower; //!< The power of each RBG relative to a uniform allocation (empty: uniform)
+  };
+  std::unordered_map<uint8_t, std::vector<DlLayer> > m_dlLayersPerSym; //!< MU-MIMO layers of the DL DATA of the slot, by starting symbol (empty without MU-MIMO)
+  RbgAllocationPerSym m_rbgAllocationPerSymDataStat;  //!< RBG allocation in each sym, for statistics (UL and DL included, only data)
+  mutable std::vector<uint16_t> m_activeUeStat; //!< RNTIs allocated in the slot, for statistics
 
   TracedCallback< uint64_t, SpectrumValue&, SpectrumValue& > m_ulSinrTrace; //!< SINR trace
 
@@ -748,12 +1071,59 @@ private:
 
   TracedCallback<const SfnSf &, uint8_t, const std::vector<int>&, uint16_t, uint16_t> m_rbStatistics;
 
-  std::map<uint32_t, std::vector<uint32_t>> m_toSendDl; //!< Map that indicates, for each slot, what DL DCI we have to send
-  std::map<uint32_t, std::vector<uint32_t>> m_toSendUl; //!< Map that indicates, for each slot, what UL DCI we have to send
-  std::map<uint32_t, std::vector<uint32_t>> m_generateUl; //!< Map that indicates, for each slot, what UL DCI we have to generate
-  std::map<uint32_t, std::vector<uint32_t>> m_generateDl; //!< Map that indicates, for each slot, what DL DCI we have to generate
+  /**
+   * \brief What the PHY has to do in a slot of the pattern
+   *
+   * The flat version of the structures of GenerateStructuresFromPattern,
+   * indexed by the position of the slot in the pattern.
+   */
+  struct PatternSlot
+  {
+    std::vector<uint32_t> m_toSendDl;   //!< K0 of the DL DCI to send in this slot
+    std::vector<uint32_t> m_toSendUl;   //!< K2 of the UL DCI to send in this slot
+    std::vector<uint32_t> m_generateDl; //!< K0 plus L1L2 latency of the DL slots to generate in this slot
+    std::vector<uint32_t> m_generateUl; //!< K2 plus L1L2 latency of the UL slots to generate in this slot
+    uint32_t m_dlHarqfbPosition {0};    //!< Where the UE has to send the HARQ feedback of the DL data of this slot
+  };
+
+  /**
+   * \brief Get the slots of a pattern, shared by all the PHYs with the same pattern and delays
+   * \param pattern the TDD pattern
+   * \param n0 N0 parameter
+   * \param n2 N2 parameter
+   * \param n1 N1 parameter
+   * \param l1l2CtrlLatency L1L2CtrlLatency of the system
+   * \return a PatternSlot for each slot of the pattern
+   */
+  static std::shared_ptr<const std::vector<PatternSlot>> GetPatternSlots (const std::vector<LteNrTddSlotType> &pattern,
+                                                                          uint32_t n0, uint32_t n2, uint32_t n1,
+                                                                          uint32_t l1l2CtrlLatency);
+
+  std::shared_ptr<const std::vector<PatternSlot>> m_patternSlots; //!< What to do in each slot of the pattern
+  std::vector<LteNrTddSlotType> m_slotPattern; //!< The pattern of m_patternSlots
+  int64_t m_slotPatternOrigin {0};             //!< The absolute slot of the first position of m_slotPattern
+
+  /**
+   * \brief A pending change of the TDD pattern
+   *
+   * From m_windowStart to m_windowEnd, the PHY uses the structures of the
+   * old pattern repeated and followed by the new one repeated: before and
+   * after, those of the old and the new pattern.
+   */
+  struct TddPatternChange
+  {
+    std::vector<LteNrTddSlotType> m_pattern;                           //!< The new pattern
+    std::shared_ptr<const std::vector<PatternSlot>> m_slots;           //!< The structures of the new pattern
+    std::vector<LteNrTddSlotType> m_transition;                        //!< The old pattern repeated, then the new one
+    std::shared_ptr<const std::vector<PatternSlot>> m_transitionSlots; //!< The structures of m_transition
+    int64_t m_transitionOrigin {0};                                    //!< The absolute slot of the first position of m_transition
+    uint64_t m_windowStart {0};                                        //!< First slot that uses m_transitionSlots
+    uint64_t m_switchSlot {0};                                         //!< First slot of the new pattern
+    uint64_t m_windowEnd {0};                                          //!< First slot that uses m_slots
+  };
+  std::unique_ptr<TddPatternChange> m_tddPatternChange; //!< The pending change of the TDD pattern, if any
 
-  std::map<uint32_t, uint32_t> m_dlHarqfbPosition; //!< Map that indicates, for each DL slot, where the UE has to send the Harq Feedback
+  TracedCallback<uint64_t, const std::string &> m_tddPatternChangeTrace; //!< Absolute slot and new pattern, when the pattern changes
 
   /**
    * \brief Status of the channel for the PHY
@@ -779,6 +1149,18 @@ private:
 
   SfnSf m_currentSlot;      //!< The current slot number
   bool m_isPrimary {false}; //!< Is this PHY a primary phy?
+  uint32_t m_numSchedulingWorkers {1}; //!< The `NumSchedulingWorkers` attribute
+
+  uint32_t m_idleSlotFastForward {0}; //!< The `IdleSlotFastForward` attribute
+  bool m_idealCtrl {false};           //!< The `IdealControl` attribute
+  bool m_coalesceVarTtiEvents {false}; //!< The `CoalesceVarTtiEvents` attribute
+  NrVarTtiTimeline m_varTtiTimeline;   //!< The varTTI boundaries, with CoalesceVarTtiEvents
+  std::vector<int> m_ulRbs;            //!< RBs of the UL DATA TB being set up, reused at each UL DCI
+  bool m_slotActivity {false};        //!< Something was received or notified since the last EndSlot
+  EventId m_fastForwardEvent;         //!< The end of the current fast-forward
+  SfnSf m_fastForwardFirstSlot;       //!< The first slot skipped by the current fast-forward
+
+  Ptr<NrSlotTimingEngine> m_slotTimingEngine; //!< Clock shared with the other PHYs of the gNB (optional)
 };
 
 }
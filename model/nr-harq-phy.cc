@@ -94,21 +94,17 @@ NrHarqPhy::GetHistoryMapOf (NrHarqPhy::HistoryMap *map, uint16_t rnti) const
   return it;
 }
 
-NrHarqPhy::ProcIdHistoryMap::iterator
+NrErrorModel::NrErrorModelHistory &
 NrHarqPhy::GetProcIdHistoryMapOf (NrHarqPhy::ProcIdHistoryMap *map, uint16_t procId) const
 {
   NS_LOG_FUNCTION (this);
 
-  NrHarqPhy::ProcIdHistoryMap::iterator it = map->find (procId);
-  if (it == map->end())
+  if (procId >= map->size ())
     {
-      auto ret = map->insert (std::make_pair (procId, NrErrorModel::NrErrorModelHistory ()));
-      NS_ASSERT (ret.second);
-
-      it = ret.first;
+      map->resize (procId + 1);
     }
 
-  return it;
+  return (*map)[procId];
 }
 
 void
@@ -117,11 +113,12 @@ NrHarqPhy::ResetHarqProcessStatus (NrHarqPhy::HistoryMap *map, uint16_t rnti,
 {
   NS_LOG_FUNCTION (this);
 
-  NrHarqPhy::HistoryMap::iterator historyMap = GetHistoryMapOf (map, rnti);
-
-  ProcIdHistoryMap * procIdMap = &(historyMap->second);
-
-  GetProcIdHistoryMapOf (procIdMap, harqProcId)->second.clear ();
+  // Nothing to reset if the process never had a history
+  auto historyMap = map->find (rnti);
+  if (historyMap != map->end () && harqProcId < historyMap->second.size ())
+    {
+      historyMap->second[harqProcId].clear ();
+    }
 }
 
 void
@@ -134,7 +131,7 @@ NrHarqPhy::UpdateHarqProcessStatus (NrHarqPhy::HistoryMap *map, uint16_t rnti,
 
   ProcIdHistoryMap * procIdMap = &(historyMap->second);
 
-  GetProcIdHistoryMapOf (procIdMap, harqProcId)->second.emplace_back (output);
+  GetProcIdHistoryMapOf (procIdMap, harqProcId).emplace_back (output);
 }
 
 const NrErrorModel::NrErrorModelHistory &
@@ -143,11 +140,35 @@ NrHarqPhy::GetHarqProcessInfo (NrHarqPhy::HistoryMap *map, uint16_t rnti,
 {
   NS_LOG_FUNCTION (this);
 
-  NrHarqPhy::HistoryMap::iterator historyMap = GetHistoryMapOf (map, rnti);
-
-  ProcIdHistoryMap * procIdMap = &(historyMap->second);
+  // The history of a RNTI and of a process is created by the first update
+  // (i.e., the first failed reception), not by the reads
+  static const NrErrorModel::NrErrorModelHistory emptyHistory;
+  auto historyMap = map->find (rnti);
+  if (historyMap == map->end () || harqProcId >= historyMap->second.size ())
+    {
+      return emptyHistory;
+    }
+  return historyMap->second[harqProcId];
+}
 
-  return GetProcIdHistoryMapOf (procIdMap, harqProcId)->second;
+uint64_t
+NrHarqPhy::GetMemoryUsage () const
+{
+  uint64_t bytes = sizeof (NrHarqPhy);
+  for (const HistoryMap *map : {&m_dlHistory, &m_ulHistory})
+    {
+      bytes += map->bucket_count () * sizeof (void *);
+      for (const auto & it : *map)
+        {
+          bytes += sizeof (HistoryMap::value_type) + sizeof (void *);
+          bytes += it.second.capacity () * sizeof (NrErrorModel::NrErrorModelHistory);
+          for (const auto & history : it.second)
+            {
+              bytes += history.capacity () * sizeof (Ptr<NrErrorModelOutput>);
+            }
+        }
+    }
+  return bytes;
 }
 
 
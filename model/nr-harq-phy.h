@@ -97,15 +97,28 @@ public:
   */
   void ResetUlHarqProcessStatus (uint16_t rnti, uint8_t id);
 
+  /**
+   * \brief Get an estimate of the memory used by the HARQ history
+   *
+   * The error model outputs are not counted, as they are shared with the
+   * receptions.
+   *
+   * \return the number of bytes
+   */
+  uint64_t GetMemoryUsage () const;
+
 private:
 
   /**
-   * \brief Map between a process id and its HARQ history (a vector of pointers)
+   * \brief HARQ history (a vector of pointers) of each process id, indexed by the
+   * process id
    *
    * The HARQ history depends on the error model (LTE error model stores MI (MIESM-based), while NR
    * error model stores SINR (EESM-based)) as well as on the HARQ combining method.
+   * The process ids are dense, so the vector grows up to the highest id
+   * used.
    */
-  typedef std::unordered_map <uint8_t, NrErrorModel::NrErrorModelHistory> ProcIdHistoryMap;
+  typedef std::vector<NrErrorModel::NrErrorModelHistory> ProcIdHistoryMap;
   /**
    * \brief Map between an RNTI and its ProcIdHistoryMap
    */
@@ -120,10 +133,10 @@ private:
   /**
   * \brief Return the HARQ history of a particular process id
   * \param procId the process id
-  * \param map the Map between processes ids and their history
-  * \return the ProcIdHistoryMap of such process id
+  * \param map the history of each process id
+  * \return the history of such process id
   */
-  ProcIdHistoryMap::iterator GetProcIdHistoryMapOf (ProcIdHistoryMap *map, uint16_t procId) const;
+  NrErrorModel::NrErrorModelHistory & GetProcIdHistoryMapOf (ProcIdHistoryMap *map, uint16_t procId) const;
 
   /**
   * \brief Reset the HARQ history of a particular process id
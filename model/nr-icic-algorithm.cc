@@ -0,0 +1,327 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-icic-algorithm.h"
+#include "nr-phy-mac-common.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/simulator.h>
+#include <ns3/uinteger.h>
+#include <ns3/double.h>
+#include <ns3/enum.h>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrIcicAlgorithm");
+NS_OBJECT_ENSURE_REGISTERED (NrIcicAlgorithm);
+NS_OBJECT_ENSURE_REGISTERED (NrIcicFrequencyReuse);
+
+TypeId
+NrIcicAlgorithm::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrIcicAlgorithm")
+    .SetParent<Object> ()
+    .SetGroupName ("Nr")
+    .AddAttribute ("ExchangePeriod",
+                   "The number of slots between two indications sent to the neighbours. "
+                   "0 disables the indications",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&NrIcicAlgorithm::m_exchangePeriod),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("X2Delay",
+                   "The delay of an indication, from the cell to its neighbours",
+                   TimeValue (MilliSeconds (2)),
+                   MakeTimeAccessor (&NrIcicAlgorithm::m_x2Delay),
+                   MakeTimeChecker (Seconds (0)))
+    ;
+  return tid;
+}
+
+void
+NrIcicAlgorithm::DoDispose ()
+{
+  m_neighbours.clear ();
+  m_indications.clear ();
+  Object::DoDispose ();
+}
+
+void
+NrIcicAlgorithm::Configure (uint16_t cellId, uint32_t numRbg)
+{
+  m_cellId = cellId;
+  if (numRbg == m_numRbg)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this << cellId << numRbg);
+  m_numRbg = numRbg;
+  m_usedSlots.assign (numRbg, 0);
+  m_highPower = NrBitset (numRbg);
+  m_periodSlots = 0;
+  DoConfigure (numRbg);
+}
+
+uint32_t
+NrIcicAlgorithm::GetNumRbg () const
+{
+  return m_numRbg;
+}
+
+void
+NrIcicAlgorithm::AddNeighbour (const Ptr<NrIcicAlgorithm> &neighbour)
+{
+  NS_LOG_FUNCTION (this << neighbour);
+  NS_ASSERT (neighbour != this);
+  m_neighbours.push_back (neighbour);
+}
+
+void
+NrIcicAlgorithm::NotifyDlSlot (const SlotAllocInfo &allocInfo)
+{
+  if (m_exchangePeriod == 0 || m_numRbg == 0)
+    {
+      return;
+    }
+
+  // An RBG counts once per slot, whatever the number of its DCIs
+  NrBitset used (m_numRbg);
+  for (const auto &allocation : allocInfo.m_varTtiAllocInfo)
+    {
+      const auto &dci = allocation.m_dci;
+      if (dci->m_type != DciInfoElementTdma::DATA || dci->m_format != DciInfoElementTdma::DL
+          || dci->m_rbgBitmask.size () != m_numRbg)
+        {
+          continue;
+        }
+      used |= dci->m_rbgBitmask;
+      for (size_t rbg = dci->m_rbgBitmask.FindFirst (); rbg < m_numRbg; rbg = dci->m_rbgBitmask.FindNext (rbg))
+        {
+          if (rbg < dci->m_rbgPower.size () && dci->m_rbgPower[rbg] > 1.0f)
+            {
+              m_highPower.set (rbg);
+            }
+        }
+    }
+  for (size_t rbg = used.FindFirst (); rbg < m_numRbg; rbg = used.FindNext (rbg))
+    {
+      ++m_usedSlots[rbg];
+    }
+
+  if (++m_periodSlots < m_exchangePeriod)
+    {
+      return;
+    }
+
+  Indication indication;
+  indication.m_cellId = m_cellId;
+  indication.m_load.resize (m_numRbg);
+  for (uint32_t rbg = 0; rbg < m_numRbg; ++rbg)
+    {
+      indication.m_load[rbg] = static_cast<float> (m_usedSlots[rbg]) / m_periodSlots;
+    }
+  indication.m_highPower = m_highPower;
+  for (const auto &neighbour : m_neighbours)
+    {
+      Simulator::Schedule (m_x2Delay, &NrIcicAlgorithm::ReceiveIndication, neighbour, indication);
+    }
+  NS_LOG_INFO ("Cell " << m_cellId << " sent its indication to " << m_neighbours.size () <<
+               " neighbours, high power RBGs " << m_highPower);
+
+  std::fill (m_usedSlots.begin (), m_usedSlots.end (), 0);
+  m_highPower = NrBitset (m_numRbg);
+  m_periodSlots = 0;
+}
+
+void
+NrIcicAlgorithm::ReceiveIndication (const Indication &indication)
+{
+  NS_LOG_FUNCTION (this << indication.m_cellId);
+  m_indications[indication.m_cellId] = indication;
+  DoReceiveIndication (indication);
+}
+
+const std::map<uint16_t, NrIcicAlgorithm::Indication> &
+NrIcicAlgorithm::GetNeighbourIndications () const
+{
+  return m_indications;
+}
+
+void
+NrIcicAlgorithm::DoReceiveIndication ([[maybe_unused]] const Indication &indication)
+{
+}
+
+TypeId
+NrIcicFrequencyReuse::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrIcicFrequencyReuse")
+    .SetParent<NrIcicAlgorithm> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrIcicFrequencyReuse> ()
+    .AddAttribute ("Mode",
+                   "The reuse scheme",
+                   EnumValue (NrIcicFrequencyReuse::SOFT),
+                   MakeEnumAccessor (&NrIcicFrequencyReuse::m_mode),
+                   MakeEnumChecker (NrIcicFrequencyReuse::SOFT, "Soft",
+                                    NrIcicFrequencyReuse::FRACTIONAL, "Fractional"))
+    .AddAttribute ("ReuseFactor",
+                   "The number of edge sub-bands",
+                   UintegerValue (3),
+                   MakeUintegerAccessor (&NrIcicFrequencyReuse::m_reuseFactor),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("SubBand",
+                   "The edge sub-band of the cell, below ReuseFactor",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrIcicFrequencyReuse::m_subBand),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("CenterFraction",
+                   "The fraction of the band shared by the cell-center UEs of all the cells, "
+                   "with the Fractional mode",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&NrIcicFrequencyReuse::m_centerFraction),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("EdgeCqi",
+                   "The UEs whose wide-band CQI is not above this value are at the cell edge",
+                   UintegerValue (6),
+                   MakeUintegerAccessor (&NrIcicFrequencyReuse::m_edgeCqi),
+                   MakeUintegerChecker<uint8_t> (0, 15))
+    .AddAttribute ("EdgePowerOffset",
+                   "The power of the RBGs of the edge sub-band, relative to a uniform allocation (dB)",
+                   DoubleValue (3.0),
+                   MakeDoubleAccessor (&NrIcicFrequencyReuse::m_edgePowerOffset),
+                   MakeDoubleChecker<double> (-30.0, 30.0))
+    .AddAttribute ("CenterPowerOffset",
+                   "The power of the other RBGs, relative to a uniform allocation (dB)",
+                   DoubleValue (-3.0),
+                   MakeDoubleAccessor (&NrIcicFrequencyReuse::m_centerPowerOffset),
+                   MakeDoubleChecker<double> (-30.0, 30.0))
+    .AddAttribute ("LoadThreshold",
+                   "The cell-center UEs avoid the RBGs that a neighbour used with a high power "
+                   "in more than this fraction of its slots. 1 disables it",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&NrIcicFrequencyReuse::m_loadThreshold),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    ;
+  return tid;
+}
+
+void
+NrIcicFrequencyReuse::DoConfigure (uint32_t numRbg)
+{
+  NS_LOG_FUNCTION (this << numRbg);
+  NS_ABORT_MSG_IF (m_subBand >= m_reuseFactor,
+                   "SubBand " << m_subBand << " is not below ReuseFactor " << m_reuseFactor);
+
+  uint32_t first = 0;
+  if (m_mode == FRACTIONAL)
+    {
+      first = static_cast<uint32_t> (std::round (numRbg * m_centerFraction));
+    }
+  const uint32_t edgeRbgs = numRbg - first;
+  NS_ABORT_MSG_IF (edgeRbgs < m_reuseFactor,
+                   "Not enough RBGs (" << edgeRbgs << ") for " << m_reuseFactor << " sub-bands");
+
+  m_edgeMask = NrBitset (numRbg);
+  for (uint32_t rbg = first + m_subBand * edgeRbgs / m_reuseFactor;
+       rbg < first + (m_subBand + 1) * edgeRbgs / m_reuseFactor; ++rbg)
+    {
+      m_edgeMask.set (rbg);
+    }
+
+  m_centerMask = NrBitset (numRbg);
+  if (m_mode == FRACTIONAL)
+    {
+      for (uint32_t rbg = 0; rbg < first; ++rbg)
+        {
+          m_centerMask.set (rbg);
+        }
+      m_cellMask = m_centerMask;
+      m_cellMask |= m_edgeMask;
+    }
+  else
+    {
+      for (uint32_t rbg = 0; rbg < numRbg; ++rbg)
+        {
+          m_centerMask.set (rbg, !m_edgeMask.test (rbg));
+        }
+      m_cellMask = NrBitset (numRbg, true);
+    }
+  if (m_centerMask.none ())
+    {
+      // Plain reuse: all the UEs share the edge sub-band
+      m_centerMask = m_edgeMask;
+    }
+  NS_LOG_INFO ("Edge RBGs " << m_edgeMask << ", center RBGs " << m_centerMask);
+
+  UpdateCenterMask ();
+}
+
+void
+NrIcicFrequencyReuse::DoReceiveIndication ([[maybe_unused]] const Indication &indication)
+{
+  UpdateCenterMask ();
+}
+
+void
+NrIcicFrequencyReuse::UpdateCenterMask ()
+{
+  m_activeCenterMask = m_centerMask;
+  for (const auto &neighbour : GetNeighbourIndications ())
+    {
+      const Indication &indication = neighbour.second;
+      if (indication.m_highPower.size () != m_centerMask.size ())
+        {
+          continue;
+        }
+      const NrBitset &highPower = indication.m_highPower;
+      for (size_t rbg = highPower.FindFirst (); rbg < highPower.size (); rbg = highPower.FindNext (rbg))
+        {
+          if (indication.m_load[rbg] > m_loadThreshold)
+            {
+              m_activeCenterMask.reset (rbg);
+            }
+        }
+    }
+  if (m_activeCenterMask.none ())
+    {
+      m_activeCenterMask = m_centerMask;
+    }
+}
+
+const NrBitset &
+NrIcicFrequencyReuse::GetDlCellMask () const
+{
+  return m_cellMask;
+}
+
+const NrBitset &
+NrIcicFrequencyReuse::GetDlUeMask (uint8_t wbCqi) const
+{
+  return wbCqi <= m_edgeCqi ? m_edgeMask : m_activeCenterMask;
+}
+
+float
+NrIcicFrequencyReuse::GetDlRbgPower (uint32_t rbg) const
+{
+  double offset = m_edgeMask.test (rbg) ? m_edgePowerOffset : m_centerPowerOffset;
+  return static_cast<float> (std::pow (10.0, offset / 10.0));
+}
+
+} // namespace ns3
@@ -0,0 +1,223 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_ICIC_ALGORITHM_H
+#define NR_ICIC_ALGORITHM_H
+
+#include <ns3/object.h>
+#include <ns3/nstime.h>
+#include "nr-bitset.h"
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+struct SlotAllocInfo;
+
+/**
+ * \ingroup scheduler
+ * \brief Inter-cell interference coordination of the DL of a cell
+ *
+ * NrMacSchedulerNs3, when it has one (attribute IcicAlgorithm), asks it at
+ * each slot which RBGs the cell may use, and restricts its DL notched mask
+ * to them. The OFDMA schedulers in BEST_RBG mode (PF, MR and QoS) also give
+ * each UE only the RBGs of its zone, chosen from its wide-band CQI; in the
+ * other modes the UEs share all the RBGs of the cell. The power of each
+ * RBG, relative to a uniform allocation, is applied to the DCIs as the one
+ * of a NrDlPowerAllocator, and it is scaled down when the mean over a
+ * transmission is above 1.
+ *
+ * Every ExchangePeriod slots, the algorithm sends to its neighbours (see
+ * AddNeighbour) a lightweight X2-like indication: the fraction of the slots
+ * in which each RBG was used, and the RBGs used with a high power, which
+ * reaches them after X2Delay. The subclasses may use the last indication of
+ * each neighbour to update the zones (DoReceiveIndication).
+ */
+class NrIcicAlgorithm : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief The per-RBG indication sent to the neighbours
+   */
+  struct Indication
+  {
+    uint16_t m_cellId {0};              //!< The cell that sends it
+    std::vector<float> m_load;          //!< Fraction of the slots of the period in which each RBG was used
+    NrBitset m_highPower;               //!< The RBGs used with a power above the uniform one
+  };
+
+  /**
+   * \brief Set the cell and its bandwidth; the zones are computed again
+   * only when the bandwidth changes
+   * \param cellId the cell id
+   * \param numRbg the DL bandwidth, in RBG
+   */
+  void Configure (uint16_t cellId, uint32_t numRbg);
+
+  /**
+   * \return the DL bandwidth, in RBG (0 before Configure)
+   */
+  uint32_t GetNumRbg () const;
+
+  /**
+   * \return the RBGs that the cell may use in the DL
+   */
+  virtual const NrBitset & GetDlCellMask () const = 0;
+
+  /**
+   * \brief Get the RBGs of the zone of a UE
+   * \param wbCqi the DL wide-band CQI of the UE
+   * \return the RBGs that the UE may use in the DL
+   */
+  virtual const NrBitset & GetDlUeMask (uint8_t wbCqi) const = 0;
+
+  /**
+   * \brief Get the DL power of an RBG
+   * \param rbg the RBG
+   * \return the weight of the power of the RBG, relative to a uniform
+   * allocation (linear)
+   */
+  virtual float GetDlRbgPower (uint32_t rbg) const = 0;
+
+  /**
+   * \brief Add a neighbour, that gets the indications of this cell
+   * \param neighbour the ICIC algorithm of the neighbour cell
+   */
+  void AddNeighbour (const Ptr<NrIcicAlgorithm> &neighbour);
+
+  /**
+   * \brief Account the DL DATA of a scheduled slot, and send the indication
+   * to the neighbours at the end of each period
+   * \param allocInfo the allocation of the slot, with the power of the RBGs
+   */
+  void NotifyDlSlot (const SlotAllocInfo &allocInfo);
+
+  /**
+   * \brief Receive the indication of a neighbour
+   * \param indication the indication
+   */
+  void ReceiveIndication (const Indication &indication);
+
+  /**
+   * \return the last indication of each neighbour, by cell id
+   */
+  const std::map<uint16_t, Indication> & GetNeighbourIndications () const;
+
+protected:
+  void DoDispose () override;
+
+  /**
+   * \brief Compute the zones for a bandwidth
+   * \param numRbg the DL bandwidth, in RBG
+   */
+  virtual void DoConfigure (uint32_t numRbg) = 0;
+
+  /**
+   * \brief Called when the indication of a neighbour is received, after it
+   * is stored
+   * \param indication the indication
+   */
+  virtual void DoReceiveIndication (const Indication &indication);
+
+private:
+  uint16_t m_cellId {0};                         //!< The cell id
+  uint32_t m_numRbg {0};                         //!< The DL bandwidth, in RBG
+  uint32_t m_exchangePeriod {10};                //!< Slots between two indications; 0 disables them (attribute)
+  Time m_x2Delay;                                //!< Delay of an indication (attribute)
+  std::vector<Ptr<NrIcicAlgorithm> > m_neighbours;  //!< The neighbours
+  std::map<uint16_t, Indication> m_indications;  //!< Last indication of each neighbour
+  std::vector<uint32_t> m_usedSlots;             //!< Slots of the period in which each RBG was used
+  NrBitset m_highPower;                          //!< RBGs of the period used with a high power
+  uint32_t m_periodSlots {0};                    //!< Slots of the period so far
+};
+
+/**
+ * \ingroup scheduler
+ * \brief Static soft or fractional (strict) frequency reuse
+ *
+ * The RBGs are split in ReuseFactor sub-bands, and each cell takes one,
+ * SubBand, for its UEs at the cell edge: those whose wide-band CQI is not
+ * above EdgeCqi. With the Fractional mode, a first part of the band,
+ * CenterFraction, is shared by the UEs at the cell center of all the cells,
+ * and the rest is split in the sub-bands; the cell does not use the
+ * sub-bands of the others. With the Soft mode, the whole band is split in
+ * the sub-bands, and the UEs at the cell center use the sub-bands of the
+ * other cells. The RBGs of the edge sub-band get EdgePowerOffset, the others
+ * CenterPowerOffset.
+ *
+ * The UEs at the cell center avoid the RBGs that a neighbour indicated as
+ * used with a high power in more than LoadThreshold of its slots, unless
+ * that leaves them no RBG.
+ */
+class NrIcicFrequencyReuse : public NrIcicAlgorithm
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief The reuse scheme
+   */
+  enum Mode
+  {
+    SOFT,          //!< Soft frequency reuse
+    FRACTIONAL     //!< Strict fractional frequency reuse
+  };
+
+  const NrBitset & GetDlCellMask () const override;
+  const NrBitset & GetDlUeMask (uint8_t wbCqi) const override;
+  float GetDlRbgPower (uint32_t rbg) const override;
+
+protected:
+  void DoConfigure (uint32_t numRbg) override;
+  void DoReceiveIndication (const Indication &indication) override;
+
+private:
+  /**
+   * \brief Compute the RBGs of the cell-center UEs, without the ones that
+   * the neighbours use with a high power
+   */
+  void UpdateCenterMask ();
+
+  Mode m_mode {SOFT};                 //!< The reuse scheme (attribute)
+  uint32_t m_reuseFactor {3};         //!< Number of edge sub-bands (attribute)
+  uint32_t m_subBand {0};             //!< The edge sub-band of the cell (attribute)
+  double m_centerFraction {0.5};      //!< Fraction of the band shared by the cell centers, Fractional mode (attribute)
+  uint8_t m_edgeCqi {6};              //!< The highest CQI of a cell-edge UE (attribute)
+  double m_edgePowerOffset {3.0};     //!< Power of the edge sub-band (dB) (attribute)
+  double m_centerPowerOffset {-3.0};  //!< Power of the other RBGs (dB) (attribute)
+  double m_loadThreshold {0.5};       //!< Load of a neighbour RBG avoided by the center UEs (attribute)
+
+  NrBitset m_cellMask;                //!< The RBGs of the cell
+  NrBitset m_edgeMask;                //!< The RBGs of the edge UEs
+  NrBitset m_centerMask;              //!< The RBGs of the center UEs, configured
+  NrBitset m_activeCenterMask;        //!< The RBGs of the center UEs, after the indications
+};
+
+} // namespace ns3
+
+#endif // NR_ICIC_ALGORITHM_H
@@ -21,8 +21,13 @@
 #include <ns3/simulator.h>
 #include <ns3/log.h>
 #include <ns3/lte-chunk-processor.h>
+#include "nr-chunk-processor.h"
+#include "nr-perf-profiler.h"
+#include "nr-counters.h"
+#include "nr-spectrum-kernels.h"
 #include <stdio.h>
 #include <algorithm>
+#include <initializer_list>
 
 NS_LOG_COMPONENT_DEFINE ("NrInterference");
 
@@ -45,6 +50,8 @@ void
 NrInterference::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
+  m_sinrBuffer = nullptr;
+  m_energyBuffer = nullptr;
   LteInterference::DoDispose ();
 }
 
@@ -70,6 +77,7 @@ void
 NrInterference::AddSignal (Ptr<const SpectrumValue> spd, Time duration)
 {
   NS_LOG_FUNCTION (this << *spd << duration);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::SPECTRUM);
 
   // Integrate over our receive bandwidth.
   // Note that differently from wifi, we do not need to pass the
@@ -93,17 +101,42 @@ void
 NrInterference::EndRx ()
 {
   NS_LOG_FUNCTION (this);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::SPECTRUM);
   if (m_receiving != true)
     {
       NS_LOG_INFO ("EndRx was already evaluated or RX was aborted");
     }
   else
     {
-      SpectrumValue snr = (*m_rxSignal) / (*m_noise);
-      double avgSnr = Sum (snr) /(snr.GetSpectrumModel ()->GetNumBands ());
+      double avgSnr = NrMeanRatioKernel (&(*m_rxSignal->ConstValuesBegin ()),
+                                         &(*m_noise->ConstValuesBegin ()),
+                                         m_rxSignal->GetValuesN ());
       m_snrPerProcessedChunk (avgSnr);
 
-      NrInterference::ConditionallyEvaluateChunk ();
+      if (m_averageInterference)
+        {
+          if (Now () > m_lastChangeTime)
+            {
+              AccumulateEnergy ();
+              m_lastChangeTime = Now ();
+            }
+          if (!m_energyDuration.IsZero ())
+            {
+              // The energy becomes the average power
+              SpectrumValue &power = GetSpectrumBuffer (m_energyBuffer);
+              double inverse = 1.0 / m_energyDuration.GetSeconds ();
+              auto energy = m_energy.cbegin ();
+              for (Values::iterator out = power.ValuesBegin (); out != power.ValuesEnd (); ++out, ++energy)
+                {
+                  *out = *energy * inverse;
+                }
+              EvaluateChunk (power, m_energyDuration);
+            }
+        }
+      else
+        {
+          NrInterference::ConditionallyEvaluateChunk ();
+        }
 
       m_receiving = false;
       for (std::list<Ptr<LteChunkProcessor> >::const_iterator it = m_rsPowerChunkProcessorList.begin (); it != m_rsPowerChunkProcessorList.end (); ++it)
@@ -119,12 +152,62 @@ NrInterference::EndRx ()
           (*it)->End ();
         }
     }
+  m_energyDuration = Time ();
+}
+
+void
+NrInterference::SetEvaluatedRbs (const std::vector<int> &rbs)
+{
+  NS_LOG_FUNCTION (this << rbs.size ());
+  if (rbs != m_evaluatedRbs)
+    {
+      m_evaluatedRbs = rbs;
+      m_clearSinrBuffer = true;
+      // The NR processors only accumulate the evaluated RBs
+      for (const auto & processor : m_sinrChunkProcessorList)
+        {
+          Ptr<NrChunkProcessor> nrProcessor = DynamicCast<NrChunkProcessor> (processor);
+          if (nrProcessor != nullptr)
+            {
+              nrProcessor->SetEvaluatedRbs (m_evaluatedRbs);
+            }
+        }
+    }
+}
+
+void
+NrInterference::SetAverageInterference (bool average)
+{
+  NS_LOG_FUNCTION (this << average);
+  m_averageInterference = average;
+  m_energyDuration = Time ();
+}
+
+uint64_t
+NrInterference::GetMemoryUsage () const
+{
+  uint64_t bytes = sizeof (NrInterference);
+  for (const Ptr<const SpectrumValue> &value : std::initializer_list<Ptr<const SpectrumValue>> {m_rxSignal, m_allSignals, m_noise, m_sinrBuffer, m_energyBuffer})
+    {
+      if (value != nullptr)
+        {
+          bytes += sizeof (SpectrumValue) + value->GetSpectrumModel ()->GetNumBands () * sizeof (double);
+        }
+    }
+  bytes += m_energy.capacity () * sizeof (NrStorageReal);
+  bytes += m_niChanges.GetCapacity () * sizeof (NiChange);
+  bytes += m_evaluatedRbs.capacity () * sizeof (int);
+  size_t processors = m_rsPowerChunkProcessorList.size () + m_sinrChunkProcessorList.size ()
+    + m_interfChunkProcessorList.size ();
+  bytes += processors * (sizeof (NrChunkProcessor) + 3 * sizeof (void *));
+  return bytes;
 }
 
 void
 NrInterference::ConditionallyEvaluateChunk ()
 {
   NS_LOG_FUNCTION (this);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::SPECTRUM);
   if (m_receiving)
     {
       NS_LOG_DEBUG (this << " Receiving");
@@ -132,26 +215,94 @@ NrInterference::ConditionallyEvaluateChunk ()
   NS_LOG_DEBUG (this << " now "  << Now () << " last " << m_lastChangeTime);
   if (m_receiving && (Now () > m_lastChangeTime))
     {
-      NS_LOG_LOGIC (this << " signal = " << *m_rxSignal << " allSignals = " << *m_allSignals << " noise = " << *m_noise);
-      SpectrumValue interf =  (*m_allSignals) - (*m_rxSignal) + (*m_noise);
-      SpectrumValue sinr = (*m_rxSignal) / interf;
+      if (m_averageInterference)
+        {
+          AccumulateEnergy ();
+        }
+      else
+        {
+          EvaluateChunk (*m_allSignals, Now () - m_lastChangeTime);
+        }
+      m_lastChangeTime = Now ();
+    }
+}
+
+void
+NrInterference::EvaluateChunk (const SpectrumValue &allSignals, Time duration)
+{
+  NS_LOG_LOGIC (this << " signal = " << *m_rxSignal << " allSignals = " << allSignals << " noise = " << *m_noise);
+  // sinr = rxSignal / (allSignals - rxSignal + noise), in a preallocated buffer
+  SpectrumValue &sinr = GetSpectrumBuffer (m_sinrBuffer);
+  if (m_evaluatedRbs.empty ())
+    {
+      NrSinrKernel (&(*m_rxSignal->ConstValuesBegin ()), &(*allSignals.ConstValuesBegin ()),
+                    &(*m_noise->ConstValuesBegin ()), &(*sinr.ValuesBegin ()), sinr.GetValuesN ());
+    }
+  else
+    {
+      if (m_clearSinrBuffer)
+        {
+          sinr = 0.0;
+          m_clearSinrBuffer = false;
+        }
+      for (int rb : m_evaluatedRbs)
+        {
+          NS_ASSERT (rb >= 0 && static_cast<size_t> (rb) < sinr.GetValuesN ());
+          double rx = (*m_rxSignal)[rb];
+          sinr[rb] = rx / (allSignals[rb] - rx + (*m_noise)[rb]);
+        }
+    }
+  // The RSSI is full-band: only if it is traced
+  if (!m_rssiPerProcessedChunk.IsEmpty ())
+    {
       double rbWidth = (*m_rxSignal).GetSpectrumModel ()->Begin ()->fh - (*m_rxSignal).GetSpectrumModel ()->Begin ()->fl;
-      double rssidBm = 10 * log10 (Sum ((*m_noise + *m_allSignals) * rbWidth) * 1000);
-      m_rssiPerProcessedChunk(rssidBm);
+      double rssiW = 0.0;
+      Values::const_iterator noise = m_noise->ConstValuesBegin ();
+      for (Values::const_iterator all = allSignals.ConstValuesBegin (); all != allSignals.ConstValuesEnd (); ++all, ++noise)
+        {
+          rssiW += (*noise + *all) * rbWidth;
+        }
+      double rssidBm = 10 * log10 (rssiW * 1000);
+      m_rssiPerProcessedChunk (rssidBm);
+    }
 
-      NS_LOG_DEBUG ("All signals: " << (*m_allSignals)[0] << ", rxSingal:" << (*m_rxSignal)[0] << " , noise:" << (*m_noise)[0]);
+  NS_LOG_DEBUG ("All signals: " << allSignals[0] << ", rxSingal:" << (*m_rxSignal)[0] << " , noise:" << (*m_noise)[0]);
 
-      Time duration = Now () - m_lastChangeTime;
-      for (std::list<Ptr<LteChunkProcessor> >::const_iterator it = m_rsPowerChunkProcessorList.begin (); it != m_rsPowerChunkProcessorList.end (); ++it)
+  for (std::list<Ptr<LteChunkProcessor> >::const_iterator it = m_rsPowerChunkProcessorList.begin (); it != m_rsPowerChunkProcessorList.end (); ++it)
+    {
+      (*it)->EvaluateChunk (*m_rxSignal, duration);
+    }
+  for (std::list<Ptr<LteChunkProcessor> >::const_iterator it = m_sinrChunkProcessorList.begin (); it != m_sinrChunkProcessorList.end (); ++it)
+    {
+      (*it)->EvaluateChunk (sinr, duration);
+    }
+}
+
+void
+NrInterference::AccumulateEnergy ()
+{
+  // The buffer restarts at the first chunk of each reception; with the
+  // evaluated RBs only those are integrated, unless the RSSI is traced
+  bool first = m_energyDuration.IsZero ();
+  Time chunk = Now () - m_lastChangeTime;
+  double seconds = chunk.GetSeconds ();
+  m_energy.resize (m_allSignals->GetValuesN ());
+  if (m_evaluatedRbs.empty () || !m_rssiPerProcessedChunk.IsEmpty ())
+    {
+      auto out = m_energy.begin ();
+      for (Values::const_iterator all = m_allSignals->ConstValuesBegin (); all != m_allSignals->ConstValuesEnd (); ++all, ++out)
         {
-          (*it)->EvaluateChunk (*m_rxSignal, duration);
+          *out = static_cast<NrStorageReal> ((first ? 0.0 : *out) + *all * seconds);
         }
-      for (std::list<Ptr<LteChunkProcessor> >::const_iterator it = m_sinrChunkProcessorList.begin (); it != m_sinrChunkProcessorList.end (); ++it)
+    }
+  else
+    {
+      for (int rb : m_evaluatedRbs)
         {
-          (*it)->EvaluateChunk (sinr, duration);
+          m_energy[rb] = static_cast<NrStorageReal> ((first ? 0.0 : m_energy[rb]) + (*m_allSignals)[rb] * seconds);
         }
-      m_lastChangeTime = Now ();
     }
+  m_energyDuration += chunk;
 }
 
 /****************************************************************
@@ -186,12 +337,11 @@ NrInterference::NiChange::operator < (const NrInterference::NiChange& o) const
 bool
 NrInterference::IsChannelBusyNow (double energyW)
 {
-  double detectedPowerW = Integral (*m_allSignals);
+  double detectedPowerW = GetCurrentPower ();
   double powerDbm = 10 * log10 (detectedPowerW * 1000);
 
   NS_LOG_INFO("IsChannelBusyNow detected power is: "<<powerDbm <<
-              "  detectedPowerW: "<< detectedPowerW << " length spectrum: "<<
-              (*m_allSignals).GetValuesN() <<" thresholdW:"<< energyW);
+              "  detectedPowerW: "<< detectedPowerW <<" thresholdW:"<< energyW);
 
   if (detectedPowerW > energyW)
     {
@@ -214,21 +364,19 @@ NrInterference::GetEnergyDuration (double energyW)
     }
 
   Time now = Simulator::Now ();
-  double noiseInterferenceW = 0.0;
   Time end = now;
-  noiseInterferenceW = m_firstPower;
+  // The events until now are already applied by IsChannelBusyNow: walk
+  // only the future ones
+  double noiseInterferenceW = m_firstPower + m_appliedPower;
 
-  NS_LOG_INFO("First power: " << m_firstPower);
+  NS_LOG_INFO("Current power: " << noiseInterferenceW);
 
-  for (NiChanges::const_iterator i = m_niChanges.begin (); i != m_niChanges.end (); i++)
+  for (size_t n = m_appliedChanges; n < m_niChanges.GetSize (); n++)
     {
-      noiseInterferenceW += i->GetDelta ();
-      end = i->GetTime ();
-      NS_LOG_INFO ("Delta: " << i->GetDelta () << "time: " << i->GetTime ());
-      if (end < now)
-        {
-          continue;
-        }
+      const NiChange &i = m_niChanges.Get (n);
+      noiseInterferenceW += i.GetDelta ();
+      end = i.GetTime ();
+      NS_LOG_INFO ("Delta: " << i.GetDelta () << "time: " << i.GetTime ());
       if (noiseInterferenceW < energyW)
         {
           break;
@@ -254,20 +402,128 @@ NrInterference::GetEnergyDuration (double energyW)
 void
 NrInterference::EraseEvents (void)
 {
-  m_niChanges.clear ();
+  m_niChanges.Clear ();
   m_firstPower = 0.0;
+  ResetAppliedNiChanges ();
+}
+
+double
+NrInterference::GetCurrentPower ()
+{
+  ApplyNiChangesUntilNow ();
+  // Rounding errors of the additions and subtractions may leave a tiny
+  // negative residual when the channel is empty
+  return std::max (0.0, m_firstPower + m_appliedPower);
+}
+
+void
+NrInterference::ApplyNiChangesUntilNow ()
+{
+  Time now = Simulator::Now ();
+  while (m_appliedChanges < m_niChanges.GetSize ()
+         && !(now < m_niChanges.Get (m_appliedChanges).GetTime ()))
+    {
+      m_appliedPower += m_niChanges.Get (m_appliedChanges).GetDelta ();
+      ++m_appliedChanges;
+    }
+  m_appliedUntil = now;
 }
 
-NrInterference::NiChanges::iterator
-NrInterference::GetPosition (Time moment)
+void
+NrInterference::ResetAppliedNiChanges ()
 {
-  return std::upper_bound (m_niChanges.begin (), m_niChanges.end (), NiChange (moment, 0));
+  m_appliedChanges = 0;
+  m_appliedPower = 0.0;
+  m_appliedUntil = Time ();
+}
+
+void
+NrInterference::NiChanges::Insert (const NiChange &change)
+{
+  if (m_size == m_buffer.size ())
+    {
+      // Grow to the next power of 2, unrolling the ring
+      std::vector<NiChange> buffer (std::max<size_t> (16, 2 * m_buffer.size ()));
+      for (size_t i = 0; i < m_size; ++i)
+        {
+          buffer[i] = Get (i);
+        }
+      m_buffer.swap (buffer);
+      m_head = 0;
+    }
+
+  // Shift the later events by one, from the end
+  size_t mask = m_buffer.size () - 1;
+  size_t pos = m_size;
+  while (pos > 0 && change < Get (pos - 1))
+    {
+      m_buffer[(m_head + pos) & mask] = m_buffer[(m_head + pos - 1) & mask];
+      --pos;
+    }
+  m_buffer[(m_head + pos) & mask] = change;
+  ++m_size;
+}
+
+double
+NrInterference::NiChanges::EraseUntil (Time moment)
+{
+  double sum = 0.0;
+  while (m_size > 0 && !(moment < Get (0).GetTime ()))
+    {
+      sum += Get (0).GetDelta ();
+      m_head = (m_head + 1) & (m_buffer.size () - 1);
+      --m_size;
+    }
+  return sum;
+}
+
+void
+NrInterference::NiChanges::Clear ()
+{
+  m_head = 0;
+  m_size = 0;
+}
+
+size_t
+NrInterference::NiChanges::GetSize () const
+{
+  return m_size;
+}
+
+size_t
+NrInterference::NiChanges::GetCapacity () const
+{
+  return m_buffer.capacity ();
+}
+
+const NrInterference::NiChange &
+NrInterference::NiChanges::Get (size_t i) const
+{
+  NS_ASSERT (i < m_size);
+  return m_buffer[(m_head + i) & (m_buffer.size () - 1)];
+}
+
+SpectrumValue &
+NrInterference::GetSpectrumBuffer (Ptr<SpectrumValue> &buffer) const
+{
+  if (buffer == nullptr || buffer->GetSpectrumModel () != m_rxSignal->GetSpectrumModel ())
+    {
+      buffer = Create<SpectrumValue> (m_rxSignal->GetSpectrumModel ());
+      NrCounters::Add (NrCounters::SPECTRUM_VALUES);
+    }
+  return *buffer;
 }
 
 void
 NrInterference::AddNiChangeEvent (NiChange change)
 {
-  m_niChanges.insert (GetPosition (change.GetTime ()), change);
+  // The events are inserted after the ones with the same time: only an
+  // event in the past can end up among the applied ones
+  if (m_appliedChanges > 0 && change.GetTime () < m_appliedUntil)
+    {
+      ResetAppliedNiChanges ();
+    }
+  m_niChanges.Insert (change);
 }
 
 void
@@ -277,25 +533,22 @@ NrInterference::AppendEvent (Time startTime, Time endTime, double rxPowerW)
 
   if (!m_receiving)
     {
-      NiChanges::iterator nowIterator = GetPosition (now);
       // We empty the list until the current moment. To do so we
       // first we sum all the energies until the current moment
-      // and save it in m_firstPower.
-      for (NiChanges::iterator i = m_niChanges.begin (); i != nowIterator; i++)
-        {
-          m_firstPower += i->GetDelta ();
-        }
-      // then we remove all the events up to the current moment
-      m_niChanges.erase (m_niChanges.begin (), nowIterator);
-      // we create an event that represents the new energy
-      m_niChanges.insert (m_niChanges.begin (), NiChange (startTime, rxPowerW));
-    }
-  else
-    {
-      // for the startTime create the event that adds the energy
-      AddNiChangeEvent (NiChange (startTime, rxPowerW));
+      // and save it in m_firstPower, while removing those events.
+      // The removed events are the ones applied until now, so they move
+      // from m_appliedPower to m_firstPower.
+      ApplyNiChangesUntilNow ();
+      size_t sizeBefore = m_niChanges.GetSize ();
+      double erasedPower = m_niChanges.EraseUntil (now);
+      m_firstPower += erasedPower;
+      m_appliedPower -= erasedPower;
+      m_appliedChanges -= sizeBefore - m_niChanges.GetSize ();
     }
 
+  // for the startTime create the event that adds the energy
+  AddNiChangeEvent (NiChange (startTime, rxPowerW));
+
   // for the endTime create event that will substract energy
   AddNiChangeEvent (NiChange (endTime, - rxPowerW));
 }
@@ -30,6 +30,7 @@
 #include <ns3/traced-callback.h>
 #include <ns3/vector.h>
 #include <ns3/lte-interference.h>
+#include "nr-storage-precision.h"
 
 
 namespace ns3 {
@@ -84,6 +85,19 @@ public:
    */
   Time GetEnergyDuration (double energyW);
 
+  /**
+   * \brief Get the total power received now, over the whole band
+   *
+   * The total is kept up to date by folding in the NiChange events as the
+   * time passes, so that each call costs O(1) (amortized), instead of an
+   * integration of the received signals or a walk over the event list.
+   * The signals that start at this moment are included, the ones that end
+   * at this moment are not.
+   *
+   * \return the received power, in W
+   */
+  double GetCurrentPower ();
+
   /**
   * \brief Crates events corresponding to the new energy. One event corresponds
   * to the moment when the energy starts, and another to the moment that energy
@@ -103,6 +117,50 @@ public:
   //inherited from LteInterference
   virtual void EndRx () override;
 
+  /**
+   * \brief Restrict the SINR evaluated in each chunk to some RBs
+   *
+   * The SINR of the other RBs is reported as 0 to the SINR chunk processors,
+   * so this is meant for receptions whose SINR is only read on the RBs of
+   * the expected TBs. The setting holds until it is changed; an empty list
+   * evaluates the SINR on the whole band. The SINR chunk processors that are
+   * NrChunkProcessor only accumulate these RBs as well.
+   *
+   * \param rbs the sorted indexes of the RBs to evaluate
+   */
+  void SetEvaluatedRbs (const std::vector<int> &rbs);
+
+  /**
+   * \brief Average the interference over each reception, instead of
+   * evaluating the SINR at each change of the interference
+   *
+   * The received power of all the signals is integrated over the reception,
+   * at each change, and the SINR is evaluated once at the end of the
+   * reception with the average power: the chunk processors get a single
+   * chunk, of the duration of the reception.
+   *
+   * The SINR of each RB is then S / (Im + N), where Im is the average
+   * interference, while the chunk processors otherwise average S / (I + N)
+   * over the chunks. The approximated SINR is never higher (the function
+   * is convex in I): it is exact when the interference does not change
+   * during the reception, and it is lower by at most
+   * 10 log10 ((Im + N) / (Imin + N)) dB, where Imin is the lowest
+   * interference of the chunks. The energy detection is not affected.
+   *
+   * \param average true to average the interference over each reception
+   */
+  void SetAverageInterference (bool average);
+
+  /**
+   * \brief Get an estimate of the memory used by this object
+   *
+   * It counts the object, its spectrum values, its event buffer and its
+   * chunk processors (each one as a NrChunkProcessor).
+   *
+   * \return the number of bytes
+   */
+  uint64_t GetMemoryUsage () const;
+
 private:
 
   /**
@@ -118,6 +176,10 @@ private:
        * \param delta the power
        */
       NiChange (Time time, double delta);
+      /**
+       * Create an empty NiChange, to preallocate the event buffer
+       */
+      NiChange () = default;
       /**
        * Return the event time.
        *
@@ -141,24 +203,59 @@ private:
     private:
 
         Time m_time;
-        double m_delta;
+        double m_delta {0.0};
     };
-   /**
-    * typedef for a vector of NiChanges
-    */
-  typedef std::vector <NiChange> NiChanges;
 
   /**
-   * \brief Find a position in event list that corresponds to a given
-   * moment. Note that all events are saved when they start and when
-   * they end. When they start, the energy the signal brings is saved as
-   * the positive value, and the event when the energy finish is
-   * saved with a negative prefix. By using this position, one
-   * can know which signals have finished, and can be removed from
-   * the list because after the given moment they do not contribute
-   * anymore to the total energy received.
+   * \brief The NiChange events, sorted by time, in a ring buffer
+   *
+   * The events are added near the end (they start now and end after the
+   * other ones, most of the time) and removed from the beginning, so the
+   * buffer is reused without any allocation once it has grown to the
+   * maximum number of overlapping events.
    */
-  NrInterference::NiChanges::iterator GetPosition (Time moment);
+  class NiChanges
+  {
+  public:
+    /**
+     * \brief Insert an event after the other events with the same time
+     * \param change the event
+     */
+    void Insert (const NiChange &change);
+
+    /**
+     * \brief Remove the events up to a given moment (included)
+     * \param moment the moment
+     * \return the sum of the power of the removed events
+     */
+    double EraseUntil (Time moment);
+
+    /**
+     * \brief Remove all the events, keeping the buffer
+     */
+    void Clear ();
+
+    /**
+     * \return the number of events
+     */
+    size_t GetSize () const;
+
+    /**
+     * \param i the index of the event, in time order
+     * \return the event
+     */
+    const NiChange & Get (size_t i) const;
+
+    /**
+     * \return the number of events that the buffer can hold without growing
+     */
+    size_t GetCapacity () const;
+
+  private:
+    std::vector<NiChange> m_buffer; //!< The ring buffer; its size is a power of 2
+    size_t m_head {0};              //!< Index of the first event in m_buffer
+    size_t m_size {0};              //!< Number of events
+  };
 
   //inherited from LteInterference
   virtual void ConditionallyEvaluateChunk () override;
@@ -169,6 +266,45 @@ private:
    */
   void AddNiChangeEvent (NiChange change);
 
+  /**
+   * \brief Fold in m_appliedPower the events that happened until now
+   */
+  void ApplyNiChangesUntilNow ();
+
+  /**
+   * \brief Forget the applied events, to recompute them at the next query
+   */
+  void ResetAppliedNiChanges ();
+
+  /**
+   * \brief Get a buffer preallocated for the spectrum model of the received
+   * signal, reallocating it only when the model changes
+   * \param buffer the buffer
+   * \return the buffer
+   */
+  SpectrumValue & GetSpectrumBuffer (Ptr<SpectrumValue> &buffer) const;
+
+  /**
+   * \brief Compute the SINR of a chunk and pass it to the chunk processors
+   * \param allSignals the power of all the signals during the chunk
+   * \param duration the duration of the chunk
+   */
+  void EvaluateChunk (const SpectrumValue &allSignals, Time duration);
+
+  /**
+   * \brief Add the energy of all the signals since the last change to the
+   * energy of the reception, for the average interference
+   */
+  void AccumulateEnergy ();
+
+  Ptr<SpectrumValue> m_sinrBuffer; //!< Preallocated SINR of a chunk
+  bool m_averageInterference {false}; //!< Whether the interference is averaged over each reception
+  std::vector<NrStorageReal> m_energy; //!< Energy of all the signals since the start of the reception, for the average interference
+  Ptr<SpectrumValue> m_energyBuffer;  //!< Average power of all the signals over the reception, computed from m_energy at its end
+  Time m_energyDuration;              //!< Duration integrated in m_energy, 0 at the start of a reception
+  std::vector<int> m_evaluatedRbs; //!< RBs on which the SINR is evaluated, all if empty
+  bool m_clearSinrBuffer {false};  //!< True if the SINR of the RBs not evaluated has to be reset
+
 protected:
 
   /**
@@ -182,6 +318,9 @@ protected:
   /// Used for energy duration calculation, inspired by wifi/model/interference-helper implementation
   NiChanges m_niChanges; //!< List of events in which there is some change in the energy
   double m_firstPower; //!< This contains the accumulated sum of the energy events until the certain moment it has been calculated
+  size_t m_appliedChanges {0}; //!< Number of leading events of m_niChanges already summed in m_appliedPower
+  double m_appliedPower {0.0}; //!< Sum of the power of the first m_appliedChanges events
+  Time m_appliedUntil;         //!< Moment until which the events have been applied
 
 
 };
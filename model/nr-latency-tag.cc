@@ -0,0 +1,144 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-latency-tag.h"
+#include <ns3/packet.h>
+#include <ns3/simulator.h>
+#include <ns3/lte-pdcp-tag.h>
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (NrLatencyTag);
+
+bool NrLatencyTag::m_enabled = false;
+
+TypeId
+NrLatencyTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrLatencyTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("nr")
+    .AddConstructor<NrLatencyTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+NrLatencyTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+NrLatencyTag::GetSerializedSize () const
+{
+  return 3 * 8 + 1;
+}
+
+void
+NrLatencyTag::Serialize (TagBuffer i) const
+{
+  i.WriteU64 (m_enqueueTime.GetTimeStep ());
+  i.WriteU64 (m_firstTxTime.GetTimeStep ());
+  i.WriteU64 (m_lastTxTime.GetTimeStep ());
+  i.WriteU8 (m_numTx);
+}
+
+void
+NrLatencyTag::Deserialize (TagBuffer i)
+{
+  m_enqueueTime = TimeStep (i.ReadU64 ());
+  m_firstTxTime = TimeStep (i.ReadU64 ());
+  m_lastTxTime = TimeStep (i.ReadU64 ());
+  m_numTx = i.ReadU8 ();
+}
+
+void
+NrLatencyTag::Print (std::ostream &os) const
+{
+  os << "enqueue=" << m_enqueueTime << ", firstTx=" << m_firstTxTime
+     << ", lastTx=" << m_lastTxTime << ", numTx=" << +m_numTx;
+}
+
+void
+NrLatencyTag::SetEnabled (bool enabled)
+{
+  m_enabled = enabled;
+}
+
+bool
+NrLatencyTag::IsEnabled ()
+{
+  return m_enabled;
+}
+
+void
+NrLatencyTag::StampFirstTx (const Ptr<Packet> &pdu)
+{
+  NrLatencyTag tag;
+  tag.m_firstTxTime = Simulator::Now ();
+  tag.m_lastTxTime = tag.m_firstTxTime;
+  tag.m_numTx = 1;
+
+  // The PDCP stamps the SDUs with a byte tag, that follows the segments
+  PdcpTag pdcpTag;
+  if (pdu->FindFirstMatchingByteTag (pdcpTag) || pdu->PeekPacketTag (pdcpTag))
+    {
+      tag.m_enqueueTime = pdcpTag.GetSenderTimestamp ();
+    }
+  else
+    {
+      tag.m_enqueueTime = tag.m_firstTxTime;
+    }
+  pdu->ReplacePacketTag (tag);
+}
+
+void
+NrLatencyTag::StampRetx (const Ptr<Packet> &pdu)
+{
+  NrLatencyTag tag;
+  if (pdu->PeekPacketTag (tag))
+    {
+      tag.m_lastTxTime = Simulator::Now ();
+      if (tag.m_numTx < UINT8_MAX)
+        {
+          ++tag.m_numTx;
+        }
+      pdu->ReplacePacketTag (tag);
+    }
+}
+
+bool
+NrLatencyTag::GetBreakdown (const Ptr<Packet> &pdu, NrLatencyBreakdown *breakdown)
+{
+  NrLatencyTag tag;
+  if (!pdu->RemovePacketTag (tag))
+    {
+      return false;
+    }
+  Time now = Simulator::Now ();
+  breakdown->m_queue = tag.m_firstTxTime - tag.m_enqueueTime;
+  breakdown->m_harq = tag.m_lastTxTime - tag.m_firstTxTime;
+  breakdown->m_air = now - tag.m_lastTxTime;
+  breakdown->m_total = now - tag.m_enqueueTime;
+  breakdown->m_numTx = tag.m_numTx;
+  return true;
+}
+
+} // namespace ns3
@@ -0,0 +1,129 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef NR_LATENCY_TAG_H
+#define NR_LATENCY_TAG_H
+
+#include "ns3/tag.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+
+namespace ns3 {
+
+class Packet;
+
+/**
+ * \ingroup utils
+ * \brief The latency of a MAC PDU, split in components, when it is decoded
+ */
+struct NrLatencyBreakdown
+{
+  uint16_t m_cellId {0}; //!< Cell ID
+  uint8_t m_bwpId {0};   //!< BWP ID
+  uint16_t m_rnti {0};   //!< RNTI of the UE
+  uint8_t m_lcid {0};    //!< LC ID of the PDU
+  uint32_t m_size {0};   //!< Size of the PDU, with the MAC header
+  Time m_queue;          //!< From the PDCP timestamp of the first SDU to the first transmission
+  Time m_harq;           //!< From the first to the last transmission
+  Time m_air;            //!< From the last transmission to the decoding
+  Time m_total;          //!< From the PDCP timestamp to the decoding
+  uint8_t m_numTx {0};   //!< Number of transmissions
+};
+
+/**
+ * \ingroup utils
+ * \brief Packet tag with the timestamps of a MAC PDU, for the latency breakdown
+ *
+ * The MAC of the transmitter stamps the PDU when it gets it from the RLC,
+ * and at each HARQ retransmission; the MAC of the receiver removes the tag
+ * when the PDU is decoded, and fires its latency trace with the breakdown.
+ * The RLC enqueue time is taken from the PdcpTag of the first SDU in the
+ * PDU: the PDCP gives the SDU to the RLC when it stamps it. The PDUs
+ * without it (RLC status PDUs, SRBs) have no queueing component.
+ *
+ * The MACs stamp the PDUs only after SetEnabled (true), that
+ * NrHelper::EnableLatencyBreakdownStats calls.
+ */
+class NrLatencyTag : public Tag
+{
+public:
+  /**
+   * \brief Get the object TypeId
+   * \return the object type id
+   */
+  static TypeId GetTypeId (void);
+  TypeId GetInstanceTypeId (void) const override;
+
+  NrLatencyTag () = default;
+
+  // inherited
+  void Serialize (TagBuffer i) const override;
+  void Deserialize (TagBuffer i) override;
+  uint32_t GetSerializedSize () const override;
+  void Print (std::ostream &os) const override;
+
+  /**
+   * \brief Enable or disable the stamping of the PDUs, for all the MACs
+   * \param enabled true to enable it
+   */
+  static void SetEnabled (bool enabled);
+
+  /**
+   * \return true if the MACs stamp the PDUs
+   */
+  static bool IsEnabled ();
+
+  /**
+   * \brief Stamp a PDU given by the RLC, at its first transmission
+   * \param pdu the PDU
+   */
+  static void StampFirstTx (const Ptr<Packet> &pdu);
+
+  /**
+   * \brief Stamp a PDU of the HARQ buffer, at a retransmission
+   *
+   * The PDU is the one kept by the HARQ process: its copies inherit the tag.
+   *
+   * \param pdu the PDU
+   */
+  static void StampRetx (const Ptr<Packet> &pdu);
+
+  /**
+   * \brief Remove the tag of a decoded PDU, and compute its latency breakdown
+   *
+   * The identifiers of the PDU (cell, BWP, RNTI, LC ID) are left unchanged.
+   *
+   * \param pdu the PDU
+   * \param breakdown the latency breakdown
+   * \return false if the PDU has no tag
+   */
+  static bool GetBreakdown (const Ptr<Packet> &pdu, NrLatencyBreakdown *breakdown);
+
+private:
+  Time m_enqueueTime; //!< PDCP timestamp of the first SDU, or first transmission
+  Time m_firstTxTime; //!< First transmission
+  Time m_lastTxTime;  //!< Last transmission
+  uint8_t m_numTx {0}; //!< Number of transmissions
+
+  static bool m_enabled; //!< True if the MACs stamp the PDUs
+};
+
+} // namespace ns3
+
+#endif /* NR_LATENCY_TAG_H */
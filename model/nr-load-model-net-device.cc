@@ -0,0 +1,95 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-load-model-net-device.h"
+#include "nr-load-model-phy.h"
+#include <ns3/object-vector.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrLoadModelNetDevice");
+NS_OBJECT_ENSURE_REGISTERED (NrLoadModelNetDevice);
+
+TypeId
+NrLoadModelNetDevice::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrLoadModelNetDevice")
+    .SetParent<NrNetDevice> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrLoadModelNetDevice> ()
+    .AddAttribute ("NrLoadModelPhyList", "The PHY of each BWP",
+                   ObjectVectorValue (),
+                   MakeObjectVectorAccessor (&NrLoadModelNetDevice::m_phys),
+                   MakeObjectVectorChecker<NrLoadModelPhy> ())
+    ;
+  return tid;
+}
+
+NrLoadModelNetDevice::NrLoadModelNetDevice ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrLoadModelNetDevice::~NrLoadModelNetDevice ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrLoadModelNetDevice::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  for (const auto &phy : m_phys)
+    {
+      phy->Dispose ();
+    }
+  m_phys.clear ();
+  NrNetDevice::DoDispose ();
+}
+
+void
+NrLoadModelNetDevice::AddPhy (const Ptr<NrLoadModelPhy> &phy)
+{
+  NS_LOG_FUNCTION (this << phy);
+  m_phys.push_back (phy);
+}
+
+Ptr<NrLoadModelPhy>
+NrLoadModelNetDevice::GetPhy (uint8_t index) const
+{
+  NS_ASSERT (index < m_phys.size ());
+  return m_phys[index];
+}
+
+uint32_t
+NrLoadModelNetDevice::GetNumPhys () const
+{
+  return static_cast<uint32_t> (m_phys.size ());
+}
+
+bool
+NrLoadModelNetDevice::DoSend (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+  NS_LOG_FUNCTION (this << packet << dest << protocolNumber);
+  NS_LOG_WARN ("A load model device does not transmit packets: dropped");
+  return false;
+}
+
+} // namespace ns3
@@ -0,0 +1,77 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_LOAD_MODEL_NET_DEVICE_H
+#define NR_LOAD_MODEL_NET_DEVICE_H
+
+#include "nr-net-device.h"
+#include <vector>
+
+namespace ns3 {
+
+class NrLoadModelPhy;
+
+/**
+ * \ingroup gnb
+ * \brief The device of an interference-only gNB
+ *
+ * It has one NrLoadModelPhy per BWP, and nothing else: no MAC, scheduler,
+ * RRC nor UE. It is created by NrHelper::InstallLoadModelDevice, to load the
+ * outer cells of a deployment at the cost of their channel computation.
+ * It drops the packets that it is given.
+ */
+class NrLoadModelNetDevice : public NrNetDevice
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  NrLoadModelNetDevice ();
+  ~NrLoadModelNetDevice () override;
+
+  /**
+   * \brief Add the PHY of the next BWP
+   * \param phy the PHY
+   */
+  void AddPhy (const Ptr<NrLoadModelPhy> &phy);
+
+  /**
+   * \param index the index of the BWP
+   * \return the PHY of the BWP
+   */
+  Ptr<NrLoadModelPhy> GetPhy (uint8_t index) const;
+
+  /**
+   * \return the number of BWPs
+   */
+  uint32_t GetNumPhys () const;
+
+protected:
+  void DoDispose () override;
+  bool DoSend (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber) override;
+
+private:
+  std::vector<Ptr<NrLoadModelPhy>> m_phys; //!< The PHY of each BWP
+};
+
+} // namespace ns3
+
+#endif // NR_LOAD_MODEL_NET_DEVICE_H
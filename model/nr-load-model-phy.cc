@@ -0,0 +1,379 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-load-model-phy.h"
+#include "nr-phy.h"
+#include "beamforming-vector.h"
+#include <ns3/nr-spectrum-value-helper.h>
+#include <ns3/spectrum-channel.h>
+#include <ns3/spectrum-signal-parameters.h>
+#include <ns3/double.h>
+#include <ns3/uinteger.h>
+#include <ns3/enum.h>
+#include <ns3/string.h>
+#include <ns3/simulator.h>
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <cmath>
+#include <sstream>
+#include <unordered_map>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrLoadModelPhy");
+NS_OBJECT_ENSURE_REGISTERED (NrLoadModelPhy);
+
+NrLoadModelPhy::NrLoadModelPhy ()
+{
+  NS_LOG_FUNCTION (this);
+  m_random = CreateObject<UniformRandomVariable> ();
+}
+
+NrLoadModelPhy::~NrLoadModelPhy ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+NrLoadModelPhy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrLoadModelPhy")
+    .SetParent<SpectrumPhy> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrLoadModelPhy> ()
+    .AddAttribute ("TxPower",
+                   "Transmission power in dBm, over all the RBs of the band",
+                   DoubleValue (4.0),
+                   MakeDoubleAccessor (&NrLoadModelPhy::m_txPower),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("Numerology",
+                   "The 3GPP numerology to be used",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrLoadModelPhy::m_numerology),
+                   MakeUintegerChecker<uint16_t> (0, 5))
+    .AddAttribute ("RbOverhead",
+                   "Overhead when calculating the usable RB number",
+                   DoubleValue (0.04),
+                   MakeDoubleAccessor (&NrLoadModelPhy::m_rbOh),
+                   MakeDoubleChecker<double> (0, 0.5))
+    .AddAttribute ("LoadFactor",
+                   "The fraction of the RBs (FREQUENCY) or of the slots (TIME) that are used",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&NrLoadModelPhy::SetLoadFactor,
+                                       &NrLoadModelPhy::GetLoadFactor),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("LoadMode",
+                   "How the load is spread over the slots",
+                   EnumValue (NrLoadModelPhy::FREQUENCY),
+                   MakeEnumAccessor (&NrLoadModelPhy::m_loadMode),
+                   MakeEnumChecker (NrLoadModelPhy::FREQUENCY, "Frequency",
+                                    NrLoadModelPhy::TIME, "Time"))
+    .AddAttribute ("BeamPattern",
+                   "How the beam of each slot is chosen",
+                   EnumValue (NrLoadModelPhy::RANDOM),
+                   MakeEnumAccessor (&NrLoadModelPhy::m_beamPattern),
+                   MakeEnumChecker (NrLoadModelPhy::FIXED, "Fixed",
+                                    NrLoadModelPhy::RANDOM, "Random"))
+    .AddAttribute ("NumBeams",
+                   "The number of beams, over [-60, 60] degrees of azimuth, of the Random pattern",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&NrLoadModelPhy::m_numBeams),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("BeamAzimuth",
+                   "The azimuth (degrees) of the beam of the Fixed pattern, in the array frame",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&NrLoadModelPhy::m_beamAzimuth),
+                   MakeDoubleChecker<double> (-180.0, 180.0))
+    .AddAttribute ("BeamZenith",
+                   "The zenith (degrees) of the beams, in the array frame",
+                   DoubleValue (90.0),
+                   MakeDoubleAccessor (&NrLoadModelPhy::m_beamZenith),
+                   MakeDoubleChecker<double> (0.0, 180.0))
+    .AddAttribute ("Pattern",
+                   "The TDD pattern of the gNBs: no signal is sent in the UL slots",
+                   StringValue ("F|F|F|F|F|F|F|F|F|F|"),
+                   MakeStringAccessor (&NrLoadModelPhy::SetPattern,
+                                       &NrLoadModelPhy::GetPattern),
+                   MakeStringChecker ())
+    .AddTraceSource ("Tx",
+                     "The transmission of a slot",
+                     MakeTraceSourceAccessor (&NrLoadModelPhy::m_txTrace),
+                     "ns3::NrLoadModelPhy::TxTracedCallback")
+    ;
+  return tid;
+}
+
+void
+NrLoadModelPhy::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_device = nullptr;
+  m_mobility = nullptr;
+  m_channel = nullptr;
+  m_antenna = nullptr;
+  m_txPsds.clear ();
+  SpectrumPhy::DoDispose ();
+}
+
+void
+NrLoadModelPhy::SetDevice (Ptr<NetDevice> d)
+{
+  m_device = d;
+}
+
+Ptr<NetDevice>
+NrLoadModelPhy::GetDevice () const
+{
+  return m_device;
+}
+
+void
+NrLoadModelPhy::SetMobility (Ptr<MobilityModel> m)
+{
+  m_mobility = m;
+}
+
+Ptr<MobilityModel>
+NrLoadModelPhy::GetMobility () const
+{
+  return m_mobility;
+}
+
+void
+NrLoadModelPhy::SetChannel (Ptr<SpectrumChannel> c)
+{
+  // Only to transmit: the PHY is not a receiver of the channel
+  m_channel = c;
+}
+
+Ptr<const SpectrumModel>
+NrLoadModelPhy::GetRxSpectrumModel () const
+{
+  return m_spectrumModel;
+}
+
+Ptr<Object>
+NrLoadModelPhy::GetAntenna () const
+{
+  return m_antenna;
+}
+
+void
+NrLoadModelPhy::StartRx ([[maybe_unused]] Ptr<SpectrumSignalParameters> params)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrLoadModelPhy::SetAntenna (const Ptr<UniformPlanarArray> &antenna)
+{
+  m_antenna = antenna;
+}
+
+void
+NrLoadModelPhy::Configure (double centralFrequency, double bandwidth, uint32_t rbsPerBand)
+{
+  NS_LOG_FUNCTION (this << centralFrequency << bandwidth << rbsPerBand);
+  NS_ABORT_MSG_IF (m_antenna == nullptr, "The antenna must be set before Configure");
+
+  uint32_t subcarrierSpacing = 15000 * static_cast<uint32_t> (std::pow (2, m_numerology));
+  uint32_t rbWidth = subcarrierSpacing * NrSpectrumValueHelper::SUBCARRIERS_PER_RB;
+  double realBw = bandwidth * (1 - m_rbOh);
+  NS_ABORT_MSG_IF (rbWidth > realBw, "Bandwidth and numerology not correctly set");
+
+  m_rbNum = static_cast<uint32_t> (realBw / rbWidth);
+  m_rbsPerBand = rbsPerBand;
+  m_spectrumModel = NrSpectrumValueHelper::GetSpectrumModel (m_rbNum, centralFrequency,
+                                                             subcarrierSpacing, m_rbsPerBand);
+  m_slotPeriod = Seconds (0.001 / std::pow (2, m_numerology));
+  m_txPsds.clear ();
+
+  m_codebook.clear ();
+  if (m_beamPattern == FIXED)
+    {
+      m_codebook.push_back (CreateDirectionalBfvAz (m_antenna, m_beamAzimuth, m_beamZenith));
+    }
+  else
+    {
+      for (uint32_t beam = 0; beam < m_numBeams; ++beam)
+        {
+          double azimuth = -60.0 + 120.0 * (beam + 0.5) / m_numBeams;
+          m_codebook.push_back (CreateDirectionalBfvAz (m_antenna, azimuth, m_beamZenith));
+        }
+    }
+}
+
+void
+NrLoadModelPhy::ScheduleStartEventLoop (uint32_t nodeId)
+{
+  NS_LOG_FUNCTION (this << nodeId);
+  Simulator::ScheduleWithContext (nodeId, MilliSeconds (0), &NrLoadModelPhy::StartSlot, this);
+}
+
+uint32_t
+NrLoadModelPhy::GetRbNum () const
+{
+  return m_rbNum;
+}
+
+Ptr<SpectrumChannel>
+NrLoadModelPhy::GetSpectrumChannel () const
+{
+  return m_channel;
+}
+
+const std::vector<PhasedArrayModel::ComplexVector> &
+NrLoadModelPhy::GetCodebook () const
+{
+  return m_codebook;
+}
+
+void
+NrLoadModelPhy::SetLoadFactor (double loadFactor)
+{
+  NS_LOG_FUNCTION (this << loadFactor);
+  m_loadFactor = loadFactor;
+  m_txPsds.clear ();
+}
+
+double
+NrLoadModelPhy::GetLoadFactor () const
+{
+  return m_loadFactor;
+}
+
+void
+NrLoadModelPhy::SetPattern (const std::string &pattern)
+{
+  NS_LOG_FUNCTION (this);
+
+  static std::unordered_map<std::string, LteNrTddSlotType> lookupTable =
+  {
+    { "DL", LteNrTddSlotType::DL },
+    { "UL", LteNrTddSlotType::UL },
+    { "S",  LteNrTddSlotType::S },
+    { "F",  LteNrTddSlotType::F },
+  };
+
+  std::vector<LteNrTddSlotType> vector;
+  std::stringstream ss (pattern);
+  std::string token;
+  while (std::getline (ss, token, '|'))
+    {
+      auto it = lookupTable.find (token);
+      NS_ABORT_MSG_IF (it == lookupTable.end (),
+                       "Pattern type " << token << " not valid. Valid values are: DL UL F S");
+      vector.push_back (it->second);
+    }
+  NS_ABORT_MSG_IF (vector.empty (), "Empty TDD pattern");
+  m_tddPattern = vector;
+  m_slot = 0;
+}
+
+std::string
+NrLoadModelPhy::GetPattern () const
+{
+  return NrPhy::GetPattern (m_tddPattern);
+}
+
+int64_t
+NrLoadModelPhy::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_random->SetStream (stream);
+  return 1;
+}
+
+Ptr<SpectrumValue>
+NrLoadModelPhy::GetTxPsd (uint32_t firstRb, uint32_t numRbs)
+{
+  // The number of RBs only changes with the load, which clears the cache
+  if (m_txPsds.size () != m_rbNum)
+    {
+      m_txPsds.assign (m_rbNum, nullptr);
+    }
+  Ptr<SpectrumValue> &psd = m_txPsds[firstRb];
+  if (psd == nullptr)
+    {
+      std::vector<int> rbs;
+      rbs.reserve (numRbs);
+      for (uint32_t i = 0; i < numRbs; ++i)
+        {
+          rbs.push_back (static_cast<int> ((firstRb + i) % m_rbNum));
+        }
+      psd = NrSpectrumValueHelper::CreateTxPowerSpectralDensity (m_txPower, rbs, m_spectrumModel,
+                                                                 NrSpectrumValueHelper::UNIFORM_POWER_ALLOCATION_BW,
+                                                                 m_rbsPerBand);
+    }
+  return psd;
+}
+
+void
+NrLoadModelPhy::StartSlot ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT_MSG (m_spectrumModel != nullptr, "Configure was not called");
+
+  LteNrTddSlotType type = m_tddPattern[m_slot];
+  m_slot = (m_slot + 1) % m_tddPattern.size ();
+  Simulator::Schedule (m_slotPeriod, &NrLoadModelPhy::StartSlot, this);
+
+  if (type == LteNrTddSlotType::UL || m_loadFactor <= 0.0)
+    {
+      return;
+    }
+
+  uint32_t firstRb = 0;
+  uint32_t numRbs = m_rbNum;
+  if (m_loadMode == FREQUENCY)
+    {
+      numRbs = static_cast<uint32_t> (std::round (m_loadFactor * m_rbNum));
+      if (numRbs == 0)
+        {
+          return;
+        }
+      firstRb = m_random->GetInteger (0, m_rbNum - 1);
+    }
+  else if (m_random->GetValue () >= m_loadFactor)
+    {
+      return;
+    }
+
+  uint32_t beam = 0;
+  if (m_codebook.size () > 1)
+    {
+      beam = m_random->GetInteger (0, static_cast<uint32_t> (m_codebook.size ()) - 1);
+    }
+  // The channel reads the beam when the signal is sent
+  m_antenna->SetBeamformingVector (m_codebook[beam]);
+
+  Ptr<SpectrumSignalParameters> params = Create<SpectrumSignalParameters> ();
+  params->duration = m_slotPeriod;
+  params->txPhy = GetObject<SpectrumPhy> ();
+  params->psd = GetTxPsd (firstRb, numRbs);
+
+  m_txTrace (numRbs, beam);
+  NS_LOG_INFO ("Slot with " << numRbs << " RBs from " << firstRb << " on beam " << beam);
+  if (m_channel != nullptr)
+    {
+      m_channel->StartTx (params);
+    }
+}
+
+} // namespace ns3
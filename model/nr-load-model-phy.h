@@ -0,0 +1,217 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_LOAD_MODEL_PHY_H
+#define NR_LOAD_MODEL_PHY_H
+
+#include <ns3/spectrum-phy.h>
+#include <ns3/spectrum-value.h>
+#include <ns3/traced-callback.h>
+#include <ns3/random-variable-stream.h>
+#include <ns3/uniform-planar-array.h>
+#include "nr-control-messages.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup gnb
+ * \brief The PHY of an interference-only gNB
+ *
+ * It has no MAC, scheduler nor UE: at the start of each slot that is not UL
+ * in its TDD pattern, it transmits on its channel a signal of one slot
+ * whose PSD and beam are drawn from its load model:
+ * - LoadMode FREQUENCY: a random block of round (LoadFactor * RBs)
+ *   contiguous RBs (wrapping around the band) is active in each slot;
+ * - LoadMode TIME: all the RBs are active, in a fraction LoadFactor of the
+ *   slots.
+ *
+ * The power per RB is TxPower divided over all the RBs of the band
+ * (UNIFORM_POWER_ALLOCATION_BW), so the interference is proportional to the
+ * load. The beam is fixed (BeamPattern FIXED, towards BeamAzimuth and
+ * BeamZenith), or drawn in each slot from NumBeams beams that cover
+ * [-60, 60] degrees of azimuth (BeamPattern RANDOM), which stands for the
+ * beams towards the scheduled UEs of a loaded cell.
+ *
+ * The signal is not a NR signal: the NrSpectrumPhy that receive it add it to
+ * the interference of the data, and ignore it otherwise. The PHY does not
+ * receive. The numerology, the RB overhead, the TDD pattern and the antenna
+ * must match the ones of the real gNBs, so that the slots are aligned and
+ * the PSDs are built on the same spectrum model.
+ */
+class NrLoadModelPhy : public SpectrumPhy
+{
+public:
+  /**
+   * \brief How the load is spread over the slots
+   */
+  enum LoadMode
+  {
+    FREQUENCY, //!< A fraction of the RBs in every slot
+    TIME       //!< All the RBs in a fraction of the slots
+  };
+
+  /**
+   * \brief How the beam of each slot is chosen
+   */
+  enum BeamPattern
+  {
+    FIXED,  //!< Always the same beam
+    RANDOM  //!< A random beam of the codebook in each slot
+  };
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  NrLoadModelPhy ();
+  ~NrLoadModelPhy () override;
+
+  // inherited from SpectrumPhy
+  void SetDevice (Ptr<NetDevice> d) override;
+  Ptr<NetDevice> GetDevice () const override;
+  void SetMobility (Ptr<MobilityModel> m) override;
+  Ptr<MobilityModel> GetMobility () const override;
+  void SetChannel (Ptr<SpectrumChannel> c) override;
+  Ptr<const SpectrumModel> GetRxSpectrumModel () const override;
+  Ptr<Object> GetAntenna () const override;
+  void StartRx (Ptr<SpectrumSignalParameters> params) override;
+
+  /**
+   * \brief Set the antenna array, whose beamforming vector is changed at each slot
+   * \param antenna the antenna array
+   */
+  void SetAntenna (const Ptr<UniformPlanarArray> &antenna);
+
+  /**
+   * \brief Build the spectrum model and the codebook
+   *
+   * Called by the helper, after the attributes and the antenna are set.
+   *
+   * \param centralFrequency the central frequency of the BWP (Hz)
+   * \param bandwidth the bandwidth of the BWP (Hz)
+   * \param rbsPerBand the number of RBs of each band of the PSDs
+   */
+  void Configure (double centralFrequency, double bandwidth, uint32_t rbsPerBand);
+
+  /**
+   * \brief Start the slots at time 0, as the gNBs
+   * \param nodeId the id of the node, for the context of the events
+   */
+  void ScheduleStartEventLoop (uint32_t nodeId);
+
+  /**
+   * \return the number of RBs of the band
+   */
+  uint32_t GetRbNum () const;
+
+  /**
+   * \return the channel
+   */
+  Ptr<SpectrumChannel> GetSpectrumChannel () const;
+
+  /**
+   * \return the beams, indexed as in the Tx trace
+   */
+  const std::vector<PhasedArrayModel::ComplexVector> & GetCodebook () const;
+
+  /**
+   * \param loadFactor the load, in [0, 1]
+   */
+  void SetLoadFactor (double loadFactor);
+
+  /**
+   * \return the load
+   */
+  double GetLoadFactor () const;
+
+  /**
+   * \brief Set the TDD pattern, as for NrGnbPhy
+   * \param pattern the pattern, e.g. "DL|S|UL|UL|DL"
+   */
+  void SetPattern (const std::string &pattern);
+
+  /**
+   * \return the TDD pattern
+   */
+  std::string GetPattern () const;
+
+  /**
+   * \brief Assign a fixed random variable stream number to the random
+   * variables used by this model.
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \brief TracedCallback signature for the transmission of a slot
+   * \param [in] numRbs the number of active RBs
+   * \param [in] beam the index of the beam in the codebook
+   */
+  typedef void (*TxTracedCallback) (uint32_t numRbs, uint32_t beam);
+
+protected:
+  void DoDispose () override;
+
+private:
+  /**
+   * \brief Transmit the signal of a slot, and schedule the next slot
+   */
+  void StartSlot ();
+
+  /**
+   * \param firstRb the first active RB
+   * \param numRbs the number of active RBs
+   * \return the PSD of the RBs [firstRb, firstRb + numRbs), modulo the number of RBs
+   */
+  Ptr<SpectrumValue> GetTxPsd (uint32_t firstRb, uint32_t numRbs);
+
+  Ptr<NetDevice> m_device;           //!< The device
+  Ptr<MobilityModel> m_mobility;     //!< The mobility model
+  Ptr<SpectrumChannel> m_channel;    //!< The channel
+  Ptr<UniformPlanarArray> m_antenna; //!< The antenna array
+  Ptr<const SpectrumModel> m_spectrumModel; //!< The spectrum model of the BWP
+  uint32_t m_rbsPerBand {1};         //!< The number of RBs of each band of the PSDs
+  uint32_t m_rbNum {0};              //!< The number of RBs of the band
+  Time m_slotPeriod;                 //!< The duration of a slot
+
+  double m_txPower {4.0};            //!< Total TX power over the band (dBm) (attribute)
+  uint16_t m_numerology {0};         //!< The numerology (attribute)
+  double m_rbOh {0.04};              //!< The RB overhead (attribute)
+  double m_loadFactor {0.5};         //!< The load (attribute)
+  LoadMode m_loadMode {FREQUENCY};   //!< How the load is spread (attribute)
+  BeamPattern m_beamPattern {RANDOM}; //!< How the beams are chosen (attribute)
+  uint32_t m_numBeams {8};           //!< The size of the RANDOM codebook (attribute)
+  double m_beamAzimuth {0.0};        //!< The azimuth of the FIXED beam (deg) (attribute)
+  double m_beamZenith {90.0};        //!< The zenith of the beams (deg) (attribute)
+  std::vector<LteNrTddSlotType> m_tddPattern {LteNrTddSlotType::F}; //!< The TDD pattern
+
+  std::vector<PhasedArrayModel::ComplexVector> m_codebook; //!< The beams
+  std::vector<Ptr<SpectrumValue>> m_txPsds; //!< The PSD of each first RB, built on demand
+  uint32_t m_slot {0};               //!< The index of the current slot in the pattern
+  Ptr<UniformRandomVariable> m_random; //!< Draws the RBs, the active slots and the beams
+
+  TracedCallback<uint32_t, uint32_t> m_txTrace; //!< The transmission of a slot
+};
+
+} // namespace ns3
+
+#endif // NR_LOAD_MODEL_PHY_H
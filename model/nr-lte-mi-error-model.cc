@@ -18,6 +18,8 @@
 
 #include <cmath>
 #include <algorithm>
+#include <array>
+#include <vector>
 #include <ns3/log.h>
 #include "nr-lte-mi-error-model.h"
 
@@ -332,144 +334,179 @@ NrLteMiErrorModel::GetInstanceTypeId() const
   return NrLteMiErrorModel::GetTypeId ();
 }
 
+/**
+ * \brief A MI table of a modulation, with the values needed by the lookup
+ */
+struct MiTable
+{
+  const double *m_mi;  //!< MI values, one per point of the axis
+  double m_axisFirst;  //!< first SINR of the axis
+  double m_axisLast;   //!< last SINR of the axis
+  double m_scaling;    //!< inverse of the (uniform) spacing of the axis
+  uint32_t m_size;     //!< number of points of the axis
+};
+
+/**
+ * \brief Build the table of a modulation
+ * \param mi the MI values
+ * \param axis the SINR axis
+ * \param size the number of points
+ * \return the table
+ */
+static MiTable
+MakeMiTable (const double *mi, const double *axis, uint32_t size)
+{
+  // since the values of the axis are uniformly spaced, we have
+  // index = ((sinrLin - value[0]) / (value[SIZE-1] - value[0])) * (SIZE-1)
+  // the scaling coefficient is always the same, so we compute it once
+  return {mi, axis[0], axis[size - 1], (size - 1) / (axis[size - 1] - axis[0]), size};
+}
+
+/**
+ * \brief Get the MI table of the modulation of a MCS
+ * \param mcs the MCS
+ * \return the table of QPSK, 16-QAM or 64-QAM
+ */
+static const MiTable &
+GetMiTable (uint8_t mcs)
+{
+  static const MiTable qpsk = MakeMiTable (MI_map_qpsk, MI_map_qpsk_axis, MI_MAP_QPSK_SIZE);
+  static const MiTable qam16 = MakeMiTable (MI_map_16qam, MI_map_16qam_axis, MI_MAP_16QAM_SIZE);
+  static const MiTable qam64 = MakeMiTable (MI_map_64qam, MI_map_64qam_axis, MI_MAP_64QAM_SIZE);
+
+  if (mcs <= MI_QPSK_MAX_ID)
+    {
+      return qpsk;
+    }
+  if (mcs <= MI_16QAM_MAX_ID)
+    {
+      return qam16;
+    }
+  return qam64;
+}
+
+/**
+ * \brief Sum of the MI of a contiguous buffer of SINRs
+ * \param sinr the linear SINRs
+ * \param n the number of SINRs
+ * \param table the MI table of the modulation
+ * \return the sum of the MI
+ *
+ * The MI of a SINR is the value of the first point of the axis after it,
+ * or 1 above the axis. The index is clamped instead of checked, so that
+ * the loop body has no branches besides the final select.
+ */
+static double
+MiSum (const double *sinr, size_t n, const MiTable &table)
+{
+  const double maxIndex = table.m_size - 1;
+  double sum = 0.0;
+
+  for (size_t i = 0; i < n; ++i)
+    {
+      const double index = std::floor ((sinr[i] - table.m_axisFirst) * table.m_scaling + 1);
+      const double mi = table.m_mi[static_cast<uint32_t> (std::min (std::max (index, 0.0), maxIndex))];
+      sum += sinr[i] > table.m_axisLast ? 1.0 : mi;
+    }
+  return sum;
+}
+
 double
-NrLteMiErrorModel::Mib (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs)
+NrLteMiErrorModel::Mib (const NrSinrValues& sinr, const std::vector<int>& map, uint8_t mcs)
 {
   NS_LOG_FUNCTION (sinr << &map << (uint32_t) mcs);
 
-  double MI;
-  double MIsum = 0.0;
+  if (map.size () == 0)
+    {
+      NS_LOG_LOGIC (" MI = 0");
+      return 0.0;
+    }
 
+  // Gather the SINRs of the allocated RBs in a contiguous buffer. The method
+  // is static, so the buffer is kept per thread
+  static thread_local std::vector<double> sinrBuffer;
+  const double *sinrValues = sinr.m_values;
+  sinrBuffer.resize (map.size ());
   for (uint32_t i = 0; i < map.size (); i++)
     {
-      double sinrLin = sinr [map.at (i)];
-      if (mcs <= MI_QPSK_MAX_ID) // QPSK
-        {
+      NS_ASSERT (static_cast<uint32_t> (map[i]) < sinr.m_numBands);
+      sinrBuffer[i] = sinrValues[map[i]];
+      NS_LOG_LOGIC (" RB " << map[i] << " SINR = " << 10 * std::log10 (sinrBuffer[i]) << " dB, " <<
+                    sinrBuffer[i] << " V, MCS = " << (uint16_t)mcs);
+    }
 
-          if (sinrLin > MI_map_qpsk_axis[MI_MAP_QPSK_SIZE - 1])
-            {
-              MI = 1;
-            }
-          else
-            {
-              // since the values in MI_map_qpsk_axis are uniformly spaced, we have
-              // index = ((sinrLin - value[0]) / (value[SIZE-1] - value[0])) * (SIZE-1)
-              // the scaling coefficient is always the same, so we use a static const
-              // to speed up the calculation
-              static const double scalingCoeffQpsk =
-                (MI_MAP_QPSK_SIZE - 1) / (MI_map_qpsk_axis[MI_MAP_QPSK_SIZE - 1] - MI_map_qpsk_axis[0]);
-              double sinrIndexDouble = (sinrLin -  MI_map_qpsk_axis[0]) * scalingCoeffQpsk + 1;
-              uint32_t sinrIndex = std::max (0.0, std::floor (sinrIndexDouble));
-              NS_ASSERT_MSG (sinrIndex < MI_MAP_QPSK_SIZE, "MI map out of data");
-              MI = MI_map_qpsk[sinrIndex];
-            }
-        }
-      else
+  double MI = MiSum (sinrBuffer.data (), sinrBuffer.size (), GetMiTable (mcs)) / map.size ();
+
+  NS_LOG_LOGIC (" MI = " << MI);
+  return MI;
+}
+
+/**
+ * \brief The parameters of a BLER curve of the EMD formula
+ */
+struct EcrCurve
+{
+  double m_b {0.0};  //!< mean of the curve
+  double m_c {0.0};  //!< standard deviation of the curve
+};
+
+/**
+ * \brief Get the curves of all the (CB size index, ECR id) pairs
+ * \return the curves, indexed by CB size index and ECR id
+ *
+ * The curves that are not in bEcrTable or cEcrTable (negative values) are
+ * resolved once, taking the lowest CB size that includes this CB, for
+ * removing CB size quantization errors.
+ */
+static const std::array<std::array<EcrCurve, MI_64QAM_BLER_MAX_ID + 1>, 9> &
+GetEcrCurves ()
+{
+  static const auto curves = [] ()
+    {
+      std::array<std::array<EcrCurve, MI_64QAM_BLER_MAX_ID + 1>, 9> table;
+      for (int cbIndex = 0; cbIndex < 9; ++cbIndex)
         {
-          if (mcs > MI_QPSK_MAX_ID && mcs <= MI_16QAM_MAX_ID )  // 16-QAM
+          for (int ecrId = 0; ecrId <= MI_64QAM_BLER_MAX_ID; ++ecrId)
             {
-              if (sinrLin > MI_map_16qam_axis[MI_MAP_16QAM_SIZE - 1])
+              double b = bEcrTable[cbIndex][ecrId];
+              for (int i = cbIndex; i < 9 && b < 0.0; ++i)
                 {
-                  MI = 1;
+                  b = bEcrTable[i][ecrId];
                 }
-              else
+              double c = cEcrTable[cbIndex][ecrId];
+              for (int i = cbIndex; i < 9 && c < 0.0; ++i)
                 {
-                  // since the values in MI_map_16QAM_axis are uniformly spaced, we have
-                  // index = ((sinrLin - value[0]) / (value[SIZE-1] - value[0])) * (SIZE-1)
-                  // the scaling coefficient is always the same, so we use a static const
-                  // to speed up the calculation
-                  static const double scalingCoeff16qam =
-                    (MI_MAP_16QAM_SIZE - 1) / (MI_map_16qam_axis[MI_MAP_16QAM_SIZE - 1] - MI_map_16qam_axis[0]);
-                  double sinrIndexDouble = (sinrLin -  MI_map_16qam_axis[0]) * scalingCoeff16qam + 1;
-                  uint32_t sinrIndex = std::max (0.0, std::floor (sinrIndexDouble));
-                  NS_ASSERT_MSG (sinrIndex < MI_MAP_16QAM_SIZE, "MI map out of data");
-                  MI = MI_map_16qam[sinrIndex];
-                }
-            }
-          else // 64-QAM
-            {
-              if (sinrLin > MI_map_64qam_axis[MI_MAP_64QAM_SIZE - 1])
-                {
-                  MI = 1;
-                }
-              else
-                {
-                  // since the values in MI_map_64QAM_axis are uniformly spaced, we have
-                  // index = ((sinrLin - value[0]) / (value[SIZE-1] - value[0])) * (SIZE-1)
-                  // the scaling coefficient is always the same, so we use a static const
-                  // to speed up the calculation
-                  static const double scalingCoeff64qam =
-                    (MI_MAP_64QAM_SIZE - 1) / (MI_map_64qam_axis[MI_MAP_64QAM_SIZE - 1] - MI_map_64qam_axis[0]);
-                  double sinrIndexDouble = (sinrLin -  MI_map_64qam_axis[0]) * scalingCoeff64qam + 1;
-                  uint32_t sinrIndex = std::max (0.0, std::floor (sinrIndexDouble));
-                  NS_ASSERT_MSG (sinrIndex < MI_MAP_64QAM_SIZE, "MI map out of data");
-                  MI = MI_map_64qam[sinrIndex];
+                  c = cEcrTable[i][ecrId];
                 }
+              table[cbIndex][ecrId].m_b = b;
+              table[cbIndex][ecrId].m_c = c;
             }
         }
-      NS_LOG_LOGIC (" RB " << map.at (i) << "Minimum SNR = " << 10 * std::log10 (sinrLin) << " dB, " << sinrLin << " V, MCS = " << (uint16_t)mcs << ", MI = " << MI);
-      MIsum += MI;
-    }
-  if (map.size () == 0)
-    {
-      MI = 0;
-    }
-  else
-    {
-      MI = MIsum / map.size ();
-    }
-
-  NS_LOG_LOGIC (" MI = " << MI);
-  return MI;
+      return table;
+    } ();
+  return curves;
 }
 
-
 double
 NrLteMiErrorModel::MappingMiBler (double mib, uint8_t ecrId, uint32_t cbSize)
 {
   NS_LOG_FUNCTION (mib << (uint32_t) ecrId << (uint32_t) cbSize);
-  double b = 0;
-  double c = 0;
 
   NS_ASSERT_MSG (ecrId <= MI_64QAM_BLER_MAX_ID, "ECR out of range [0..37]: " << (uint16_t) ecrId);
-  int cbIndex = 1;
-  while ((cbIndex < 9)&&(cbMiSizeTable[cbIndex] <= cbSize))
-    {
-      cbIndex++;
-    }
-  cbIndex--;
+  // the greatest CB size of the curves not greater than cbSize, or the smallest one
+  int cbIndex = std::upper_bound (cbMiSizeTable, cbMiSizeTable + 9, cbSize) - cbMiSizeTable - 1;
+  cbIndex = std::max (cbIndex, 0);
   NS_LOG_LOGIC (" ECRid " << (uint16_t)ecrId << " ECR " << BlerCurvesEcrMap[ecrId] << " CB size " << cbSize << " CB size curve " << cbMiSizeTable[cbIndex]);
 
-  b = bEcrTable[cbIndex][ecrId];
-  if (b < 0.0)
-    {
-      //take the lowest CB size including this CB for removing CB size
-      //quatization errors
-      int i = cbIndex;
-      while ((i < 9)&&(b < 0))
-        {
-          b = bEcrTable[i++][ecrId];
-        }
-    }
-  c = cEcrTable[cbIndex][ecrId];
-  if (c < 0.0)
-    {
-      //take the lowest CB size including this CB for removing CB size
-      //quatization errors
-      int i = cbIndex;
-      while ((i < 9)&&(c < 0))
-        {
-          c = cEcrTable[i++][ecrId];
-        }
-    }
+  const EcrCurve &curve = GetEcrCurves ()[cbIndex][ecrId];
   // see IEEE802.16m EMD formula 55 of section 4.3.2.1
-  double bler = 0.5 * ( 1 - erf ((mib - b) / (sqrt (2) * c)) );
-  NS_LOG_LOGIC ("MIB: " << mib << " BLER:" << bler << " b:" << b << " c:" << c);
+  double bler = 0.5 * ( 1 - erf ((mib - curve.m_b) / (sqrt (2) * curve.m_c)) );
+  NS_LOG_LOGIC ("MIB: " << mib << " BLER:" << bler << " b:" << curve.m_b << " c:" << curve.m_c);
   return bler;
 }
 
 Ptr<NrErrorModelOutput>
-NrLteMiErrorModel::GetTbDecodificationStats (const SpectrumValue& sinr,
+NrLteMiErrorModel::GetTbDecodificationStats (const NrSinrValues& sinr,
                                              const std::vector<int>& map,
                                              uint32_t size, uint8_t mcs,
                                              const NrErrorModel::NrErrorModelHistory &history)
@@ -478,7 +515,7 @@ NrLteMiErrorModel::GetTbDecodificationStats (const SpectrumValue& sinr,
 }
 
 Ptr<NrErrorModelOutput>
-NrLteMiErrorModel::GetTbBitDecodificationStats (const SpectrumValue& sinr,
+NrLteMiErrorModel::GetTbBitDecodificationStats (const NrSinrValues& sinr,
                                                 const std::vector<int>& map,
                                                 uint32_t size, uint8_t mcs,
                                                 const NrErrorModel::NrErrorModelHistory &history)
@@ -497,11 +534,13 @@ NrLteMiErrorModel::GetTbBitDecodificationStats (const SpectrumValue& sinr,
     {
       uint32_t codeBitsSum = 0;
       double miSum = 0.0;
-      uint32_t infoBits = DynamicCast<NrLteMiErrorModelOutput> (history.front ())->m_infoBits; // information bits of the first TB
+      // information bits of the first TB. Raw pointers, as in a worker thread
+      // the reference count of the history must not change
+      uint32_t infoBits = static_cast<const NrLteMiErrorModelOutput *> (PeekPointer (history.front ()))->m_infoBits;
 
       for (const Ptr<NrErrorModelOutput> & output : history)
         {
-          Ptr<NrLteMiErrorModelOutput> miHistory = DynamicCast<NrLteMiErrorModelOutput> (output);
+          const auto *miHistory = dynamic_cast<const NrLteMiErrorModelOutput *> (PeekPointer (output));
           NS_ASSERT (miHistory != nullptr);
 
           NS_LOG_DEBUG (" Sum MI " << miHistory->m_mi << " Ci " << miHistory->m_codeBits <<
@@ -104,7 +104,7 @@ public:
    * \return A pointer to an output, with the tbler and accumulated MI, effective
    * MI, code bits, and info bits.
    */
-  virtual Ptr<NrErrorModelOutput> GetTbDecodificationStats (const SpectrumValue& sinr,
+  virtual Ptr<NrErrorModelOutput> GetTbDecodificationStats (const NrSinrValues& sinr,
                                                             const std::vector<int>& map,
                                                             uint32_t size, uint8_t mcs,
                                                             const NrErrorModelHistory &history) override;
@@ -141,7 +141,7 @@ private:
    * \return A pointer to an output, with the tbler and accumulated MI, effective
    * MI, code bits, and info bits.
    */
-  virtual Ptr<NrErrorModelOutput> GetTbBitDecodificationStats (const SpectrumValue& sinr,
+  virtual Ptr<NrErrorModelOutput> GetTbBitDecodificationStats (const NrSinrValues& sinr,
                                                                const std::vector<int>& map,
                                                                uint32_t size, uint8_t mcs,
                                                                const NrErrorModelHistory &history);
@@ -155,7 +155,7 @@ private:
    * \param mcs the MCS of the TB
    * \return the mmib
    */
-  static double Mib (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs);
+  static double Mib (const NrSinrValues& sinr, const std::vector<int>& map, uint8_t mcs);
 
   /**
    * \brief map the mmib (mean mutual information per bit) into CBLER for
@@ -36,7 +36,7 @@ namespace ns3 {
  * as well as the RLC PDU.
  *
  * The HarqProcess will be stored inside the class NrMacHarqVector, which
- * is a unordered map that maps the HARQ ID with the HARQ content (this struct).
+ * is an array, indexed by the HARQ ID, of the HARQ content (this struct).
  */
 struct HarqProcess
 {
@@ -68,6 +68,7 @@ struct HarqProcess
     : m_active (other.m_active),
     m_status (other.m_status),
     m_timer (other.m_timer),
+    m_timerStart (other.m_timerStart),
     m_dciElement (other.m_dciElement),
     m_rlcPduInfo (other.m_rlcPduInfo)
   {
@@ -96,6 +97,7 @@ struct HarqProcess
     m_active = false;
     m_status = INACTIVE;
     m_timer = 0;
+    m_timerStart = 0;
     m_dciElement.reset ();
     m_rlcPduInfo.clear ();
   }
@@ -103,9 +105,10 @@ struct HarqProcess
   bool m_active                         {false};       //!< False indicate that the process is not active
   Status m_status                       {INACTIVE};    //!< Status of the process
   uint8_t m_timer                       {0};           //!< Timer of the process (in slot)
+  uint64_t m_timerStart                 {0};           //!< Scheduler slot of the last (re)transmission, with the HARQ timer wheel
   std::shared_ptr<DciInfoElementTdma> m_dciElement {}; //!< DCI element
   std::vector<std::vector<RlcPduInfo> > m_rlcPduInfo {};            //!< vector of RLC PDU
-  std::vector <uint8_t> nackStreamIndexes; //!< vector holding the stream indexes for which gNB received NACK
+  StreamVector<uint8_t> nackStreamIndexes; //!< vector holding the stream indexes for which gNB received NACK
 };
 
 /**
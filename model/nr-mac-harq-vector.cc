@@ -23,18 +23,10 @@ namespace ns3 {
 bool
 NrMacHarqVector::Erase (uint8_t id)
 {
-  at (id).Erase ();
+  NS_ASSERT (Get (id).m_active);
+  Get (id).Erase ();
+  m_inactive[id / 64] |= uint64_t (1) << (id % 64);
   --m_usedSize;
-
-  uint32_t count = 0;
-  for (const auto & v : *this)
-    {
-      if (v.second.m_active)
-        {
-          ++count;
-        }
-    }
-  NS_ASSERT (count == m_usedSize);
   return true;
 }
 
@@ -54,10 +46,16 @@ NrMacHarqVector::Insert (uint8_t *id, const HarqProcess& element)
       return false;
     }
 
-  NS_ABORT_IF (at (*id).m_active == true);
-  at (*id) = element;
+  while (m_processes.size () <= *id)
+    {
+      m_processes.emplace_back (static_cast<uint8_t> (m_processes.size ()), HarqProcess ());
+    }
+
+  NS_ABORT_IF (Get (*id).m_active == true);
+  Get (*id) = element;
+  m_inactive[*id / 64] &= ~(uint64_t (1) << (*id % 64));
 
-  NS_ABORT_IF (at (*id).m_active == false);
+  NS_ABORT_IF (Get (*id).m_active == false);
   NS_ABORT_IF (this->FirstAvailableId () == *id);
 
   ++m_usedSize;
@@ -67,7 +65,7 @@ NrMacHarqVector::Insert (uint8_t *id, const HarqProcess& element)
 std::ostream &
 operator<< (std::ostream & os, NrMacHarqVector const & item)
 {
-  for (const auto & p : item)
+  for (const auto & p : item.m_processes)
     {
       os << "Process ID " << static_cast<uint32_t> (p.first)
          << ": " << p.second << std::endl;
@@ -18,7 +18,8 @@
  */
 #pragma once
 
-#include <unordered_map>
+#include <array>
+#include <vector>
 #include "nr-mac-harq-process.h"
 
 namespace ns3 {
@@ -27,29 +28,34 @@ namespace ns3 {
  * \ingroup scheduler
  * \brief Data structure to save all the HARQ process of an UE
  *
- * The data is stored as an unordered_map between the process ID and the
- * real data, saved in the structure HarqProcess. The vector (yes, it is an
- * improper name) is always full (i.e., it always contains almost 20 HARQ processes)
- * but they can be inactive (i.e., no data is stored there). The duty of finding
- * an empty spot is split between Insert and FirstAvailableId.
+ * The data is stored in an array of pairs between the process ID and the
+ * real data, saved in the structure HarqProcess, indexed by the process ID
+ * (which are dense, from 0 to the number of processes - 1). The vector grows
+ * only up to the highest ID used: as the lowest free ID is always picked,
+ * an UE with little traffic keeps a few processes instead of the 20 of the
+ * configuration. The processes stored can be inactive (i.e., no data is
+ * stored there). The duty of finding
+ * an empty spot is split between Insert and FirstAvailableId; the inactive
+ * processes are tracked by a bitmask, so that FirstAvailableId does not
+ * have to visit the processes.
  *
  * The class does not support going "out of space", or in other words, if all
  * the spots are filled with active processes, the next insert will fail.
  *
  * \see HarqProcess
  */
-class NrMacHarqVector : private std::unordered_map<uint8_t, HarqProcess>
+class NrMacHarqVector
 {
 public:
   friend std::ostream &  operator<< (std::ostream & os, NrMacHarqVector const & item);
   /**
-   * \brief iterator of the map
+   * \brief iterator of the vector
    */
-  typedef typename std::unordered_map<uint8_t, HarqProcess>::iterator iterator;
+  typedef typename std::vector<std::pair<const uint8_t, HarqProcess> >::iterator iterator;
   /**
-   * \brief const_iterator of the map
+   * \brief const_iterator of the vector
    */
-  typedef typename std::unordered_map<uint8_t, HarqProcess>::const_iterator const_iterator;
+  typedef typename std::vector<std::pair<const uint8_t, HarqProcess> >::const_iterator const_iterator;
 
   /**
     * \brief Default constructor
@@ -57,18 +63,22 @@ public:
   NrMacHarqVector () = default;
 
   /**
-   * \brief Set and reserve the size of the vector
-   * \param size the vector size
+   * \brief Set the maximum number of processes
+   * \param size the maximum number of processes
    *
-   * The method will reserve and create the necessary processes.
+   * The processes are created by Insert, when their ID is used for the
+   * first time.
    */
   void SetMaxSize (uint8_t size)
   {
     m_maxSize = size;
-    reserve (size);
+    m_usedSize = 0;
+    m_processes.clear ();
+    m_processes.shrink_to_fit ();
+    m_inactive.fill (0);
     for (auto i = 0; i < size; ++i)
       {
-        emplace (i, HarqProcess ());
+        m_inactive[i / 64] |= uint64_t (1) << (i % 64);
       }
   }
 
@@ -95,7 +105,7 @@ public:
   const iterator
   Find (uint8_t key)
   {
-    return this->find (key);
+    return Exist (key) ? m_processes.begin () + key : m_processes.end ();
   }
   /**
    * \brief Begin of the vector
@@ -104,7 +114,7 @@ public:
   const iterator
   Begin ()
   {
-    return this->begin ();
+    return m_processes.begin ();
   }
   /**
    * \brief End of the vector
@@ -113,7 +123,7 @@ public:
   const iterator
   End ()
   {
-    return this->end ();
+    return m_processes.end ();
   }
   /**
    * \brief Const begin of the vector
@@ -122,7 +132,7 @@ public:
   const_iterator
   CBegin ()
   {
-    return this->cbegin ();
+    return m_processes.cbegin ();
   }
   /**
    * \brief Const end of the vector
@@ -131,7 +141,7 @@ public:
   const_iterator
   CEnd ()
   {
-    return this->cend ();
+    return m_processes.cend ();
   }
   /**
    * \brief Check if the ID exists in the map
@@ -141,8 +151,7 @@ public:
    */
   bool Exist (uint8_t id) const
   {
-    // could be id > max_size?
-    return find (id) != end ();
+    return id < m_processes.size ();
   }
   /**
    * \brief Get a reference to a process
@@ -152,7 +161,7 @@ public:
   HarqProcess & Get (uint8_t id)
   {
     NS_ASSERT (Exist (id));
-    return find (id)->second;
+    return m_processes[id].second;
   }
   /**
    * \brief Get a const reference to a process
@@ -162,7 +171,7 @@ public:
   const HarqProcess & Get (uint8_t id) const
   {
     NS_ASSERT (Exist (id));
-    return find (id)->second;
+    return m_processes[id].second;
   }
   /**
    * \brief Find the first (INACTIVE) ID
@@ -170,11 +179,11 @@ public:
    */
   uint8_t FirstAvailableId () const
   {
-    for (const auto & it : *this)
+    for (size_t w = 0; w < m_inactive.size (); ++w)
       {
-        if (!it.second.m_active)
+        if (m_inactive[w] != 0)
           {
-            return it.first;
+            return static_cast<uint8_t> (w * 64 + CountTrailingZeros (m_inactive[w]));
           }
       }
     return 255;
@@ -195,8 +204,38 @@ public:
   {
     return m_usedSize;
   }
+  /**
+   * \brief Get an estimate of the memory allocated for the processes
+   * \return the number of bytes, the vector object itself excluded
+   */
+  uint64_t GetMemoryUsage () const
+  {
+    return m_processes.capacity () * sizeof (std::pair<const uint8_t, HarqProcess>);
+  }
 
 private:
+  /**
+   * \brief Count the trailing zero bits of a word
+   * \param word the word, not 0
+   * \return the index of the lowest bit set
+   */
+  static uint8_t CountTrailingZeros (uint64_t word)
+  {
+#if defined (__GNUC__)
+    return static_cast<uint8_t> (__builtin_ctzll (word));
+#else
+    uint8_t n = 0;
+    while ((word & 1) == 0)
+      {
+        word >>= 1;
+        ++n;
+      }
+    return n;
+#endif
+  }
+
+  std::vector<std::pair<const uint8_t, HarqProcess> > m_processes; //!< The processes, indexed by their ID
+  std::array<uint64_t, 4> m_inactive {}; //!< Bitmask of the INACTIVE processes (the 255 ID is not valid)
   uint8_t m_maxSize  {0}; //!< Maximum size (or the number of processes stored)
   uint8_t m_usedSize {0}; //!< Number of ACTIVE processes
 };
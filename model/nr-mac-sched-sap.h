@@ -20,6 +20,7 @@
 
 #include "nr-phy-mac-common.h"
 #include "nr-control-messages.h"
+#include "beam-conf-id.h"
 
 namespace ns3 {
 
@@ -263,6 +264,14 @@ public:
    */
   virtual Time GetSlotPeriod () const = 0;
 
+  /**
+   * \brief Get the coupling between two beams
+   * \param a the first beam
+   * \param b the second beam
+   * \return the normalized gain of a toward b, between 0 and 1, or -1 if unknown
+   */
+  virtual double GetBeamCoupling (const BeamConfId &a, const BeamConfId &b) const = 0;
+
 };
 
 std::ostream & operator<< (std::ostream & os, NrMacSchedSapProvider::SchedDlRlcBufferReqParameters const & p);
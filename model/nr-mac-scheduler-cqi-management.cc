@@ -29,75 +29,98 @@
 #include "nr-amc.h"
 
 #include <ns3/log.h>
+#include <ns3/abort.h>
+
+#include <algorithm>
+#include <cmath>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("NrMacSchedulerCQIManagement");
 
 void
-NrMacSchedulerCQIManagement::DlSBCQIReported ([[maybe_unused]]const DlCqiInfo &info,
-                                              [[maybe_unused]] const std::shared_ptr<NrMacSchedulerUeInfo>&ueInfo) const
+NrMacSchedulerCQIManagement::DlSBCQIReported (const DlCqiInfo &info,
+                                              const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
+                                              uint32_t expirationTime, int8_t maxDlMcs)
 {
   NS_LOG_INFO (this);
-  // TODO
+
+  DlWBCQIReported (info, ueInfo, expirationTime, maxDlMcs);
+  ueInfo->m_dlCqi.m_cqiType = NrMacSchedulerUeInfo::DlCqiInfo::SB;
+
+  // The MCS of each RBG is computed once here, and not at every scheduling.
+  // An RBG that was not measured gets the wideband MCS.
+  NS_ASSERT (! ueInfo->m_dlMcs.empty ());
+  ueInfo->m_dlRbgMcs.resize (info.m_sbCqi.size ());
+  for (size_t rbg = 0; rbg < info.m_sbCqi.size (); ++rbg)
+    {
+      if (info.m_sbCqi.at (rbg) > 0)
+        {
+          uint8_t mcs = std::min (static_cast<uint8_t> (GetAmcDl ()->GetMcsFromCqi (info.m_sbCqi.at (rbg))),
+                                  static_cast<uint8_t> (maxDlMcs));
+          ueInfo->m_dlRbgMcs.at (rbg) = ApplyOllaOffset (mcs, ueInfo->m_dlOllaOffset,
+                                                         std::min (GetAmcDl ()->GetMaxMcs (),
+                                                                   static_cast<uint32_t> (static_cast<uint8_t> (maxDlMcs))));
+        }
+      else
+        {
+          ueInfo->m_dlRbgMcs.at (rbg) = ueInfo->m_dlMcs.at (0);
+        }
+    }
+
+  NS_LOG_INFO ("Updated SB CQI of UE " << ueInfo->m_rnti << " for " <<
+               ueInfo->m_dlRbgMcs.size () << " RBG");
 }
 
 void
 NrMacSchedulerCQIManagement::UlSBCQIReported (uint32_t expirationTime, [[maybe_unused]] uint32_t tbs,
                                               const NrMacSchedSapProvider::SchedUlCqiInfoReqParameters& params,
                                               const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
-                                              const std::vector<uint8_t> &rbgMask,
+                                              const NrBitset &rbgMask,
                                               uint32_t numRbPerRbg,
-                                              const Ptr<const SpectrumModel> &model) const
+                                              uint32_t numRbs)
 {
   NS_LOG_INFO (this);
   NS_ASSERT (rbgMask.size () > 0);
+  NS_ASSERT (numRbs > 0);
 
   NS_LOG_INFO ("Computing SB CQI for UE " << ueInfo->m_rnti);
 
-  ueInfo->m_ulCqi.m_sinr = params.m_ulCqi.m_sinr;
+  // The SINR is read from the report: the UE only keeps the resulting CQI
+  const std::vector<NrStorageReal> &sinr = params.m_ulCqi.m_sinr;
   ueInfo->m_ulCqi.m_cqiType = NrMacSchedulerUeInfo::CqiInfo::SB;
   ueInfo->m_ulCqi.m_timer = expirationTime;
+  ueInfo->m_ulCqi.m_expiration = m_ulRefreshes + expirationTime + 1;
+  m_ulExpirations.push (CqiExpiration {ueInfo->m_ulCqi.m_expiration, ueInfo});
 
-  std::vector<int> rbAssignment (params.m_ulCqi.m_sinr.size (), 0);
-
-  for (uint32_t i = 0; i < rbgMask.size (); ++i)
-    {
-      if (rbgMask.at (i) == 1)
-        {
-          for (uint32_t k = 0; k < numRbPerRbg; ++k)
-            {
-              rbAssignment[i * numRbPerRbg + k] = 1;
-            }
-        }
-    }
-
-  SpectrumValue specVals (model);
-  Values::iterator specIt = specVals.ValuesBegin ();
+  // Called by the scheduler, possibly on a worker of NrSchedulingWorkerPool:
+  // no SpectrumValue here, as its SpectrumModel is shared by the cells
+  static thread_local std::vector<double> specVals;
+  specVals.assign (numRbs, 0.0);
 
   std::stringstream out;
 
-  for (uint32_t ichunk = 0; ichunk < model->GetNumBands (); ichunk++)
+  for (uint32_t ichunk = 0; ichunk < numRbs; ichunk++)
     {
-      NS_ASSERT (specIt != specVals.ValuesEnd ());
-      if (rbAssignment[ichunk] == 1)
+      NS_ASSERT (ichunk < sinr.size ());
+      uint32_t rbg = ichunk / numRbPerRbg;
+      if (rbg < rbgMask.size () && rbgMask.test (rbg))
         {
-          *specIt = ueInfo->m_ulCqi.m_sinr.at (ichunk);
-          out << ueInfo->m_ulCqi.m_sinr.at (ichunk) << " ";
+          specVals[ichunk] = sinr[ichunk];
+          out << sinr[ichunk] << " ";
         }
       else
         {
           out << "0.0 ";
-          *specIt = 0.0;
         }
-
-      specIt++;
     }
 
   NS_LOG_INFO ("Values of SINR to pass to the AMC: " << out.str ());
 
   // MCS updated inside the function; crappy API... but we can't fix everything
-  ueInfo->m_ulCqi.m_cqi = GetAmcUl ()->CreateCqiFeedbackWbTdma (specVals, ueInfo->m_ulMcs);
+  ueInfo->m_ulCqi.m_cqi = GetAmcUl ()->CreateCqiFeedbackWbTdma (NrSinrValues (specVals.data (), numRbs),
+                                                                ueInfo->m_ulMcs);
+  ueInfo->m_ulMcs = ApplyOllaOffset (ueInfo->m_ulMcs, ueInfo->m_ulOllaOffset, GetAmcUl ()->GetMaxMcs ());
   NS_LOG_DEBUG ("Calculated MCS for RNTI " << ueInfo->m_rnti << " is " << ueInfo->m_ulMcs);
 }
 
@@ -146,25 +169,23 @@ NrMacSchedulerCQIManagement::InstallGetNrAmcUlFn (const std::function<Ptr<const
 void
 NrMacSchedulerCQIManagement::DlWBCQIReported (const DlCqiInfo &info,
                                                   const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
-                                                  uint32_t expirationTime, int8_t maxDlMcs) const
+                                                  uint32_t expirationTime, int8_t maxDlMcs)
 {
   NS_LOG_INFO (this);
 
   ueInfo->m_dlCqi.m_cqiType = NrMacSchedulerUeInfo::DlCqiInfo::WB;
+  ueInfo->m_dlRbgMcs.clear ();
   ueInfo->m_dlCqi.m_timer = expirationTime;
+  ueInfo->m_dlCqi.m_expiration = m_dlRefreshes + expirationTime + 1;
+  ueInfo->m_dlCqi.m_reportRefresh = m_dlRefreshes;
+  m_dlExpirations.push (CqiExpiration {ueInfo->m_dlCqi.m_expiration, ueInfo});
   ueInfo->m_dlCqi.m_ri = info.m_ri;
   ueInfo->m_dlCqi.m_wbCqi.resize (info.m_wbCqi.size ());
   ueInfo->m_dlMcs.resize (info.m_wbCqi.size ());
-  //TODO following code limits the number of streams
-  //2. In future, we should try to lift this
-  //limit.
-  if (info.m_ri == 2 || info.m_wbCqi.size () == 2)
+  if (ueInfo->m_dlTbSize.size () < info.m_wbCqi.size ())
     {
-      if (ueInfo->m_dlTbSize.size () == 1)
-        {
-          //scheduling first time the TB of the second stream
-          ueInfo->m_dlTbSize.push_back (0);
-        }
+      //scheduling first time the TB of the other streams
+      ueInfo->m_dlTbSize.resize (info.m_wbCqi.size (), 0);
     }
   for (uint8_t stream = 0; stream < info.m_wbCqi.size (); stream++)
     {
@@ -172,6 +193,9 @@ NrMacSchedulerCQIManagement::DlWBCQIReported (const DlCqiInfo &info,
         {
           ueInfo->m_dlCqi.m_wbCqi.at (stream) = (info.m_wbCqi.at (stream));
           uint8_t mcs = std::min(static_cast<uint8_t> (GetAmcDl()->GetMcsFromCqi (info.m_wbCqi.at (stream))), static_cast<uint8_t> (maxDlMcs));
+          mcs = ApplyOllaOffset (mcs, ueInfo->m_dlOllaOffset,
+                                 std::min (GetAmcDl ()->GetMaxMcs (),
+                                           static_cast<uint32_t> (static_cast<uint8_t> (maxDlMcs))));
           ueInfo->m_dlMcs.at (stream) = mcs;
           NS_LOG_INFO ("Calculated MCS for UE " << ueInfo->m_rnti
                        << " stream index " << static_cast<uint16_t> (stream)
@@ -202,49 +226,113 @@ NrMacSchedulerCQIManagement::DlWBCQIReported (const DlCqiInfo &info,
 }
 
 void
-NrMacSchedulerCQIManagement::RefreshDlCqiMaps (const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap) const
+NrMacSchedulerCQIManagement::ConfigureOlla (double targetBler, double stepDown, double maxOffset)
+{
+  NS_LOG_FUNCTION (this << targetBler << stepDown << maxOffset);
+  NS_ABORT_MSG_IF (targetBler < 0.0 || targetBler >= 1.0, "Invalid OLLA target BLER " << targetBler);
+  m_ollaTargetBler = targetBler;
+  m_ollaStepDown = stepDown;
+  m_ollaStepUp = stepDown * targetBler / (1.0 - targetBler);
+  m_ollaMaxOffset = maxOffset;
+}
+
+void
+NrMacSchedulerCQIManagement::DlHarqFeedback (const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
+                                             bool ack) const
+{
+  UpdateOllaOffset (&ueInfo->m_dlOllaOffset, ack);
+  NS_LOG_INFO ("DL OLLA offset of UE " << ueInfo->m_rnti << ": " << ueInfo->m_dlOllaOffset);
+}
+
+void
+NrMacSchedulerCQIManagement::UlHarqFeedback (const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
+                                             bool ack) const
+{
+  UpdateOllaOffset (&ueInfo->m_ulOllaOffset, ack);
+  NS_LOG_INFO ("UL OLLA offset of UE " << ueInfo->m_rnti << ": " << ueInfo->m_ulOllaOffset);
+}
+
+void
+NrMacSchedulerCQIManagement::UpdateOllaOffset (double *offset, bool ack) const
+{
+  if (m_ollaTargetBler == 0.0)
+    {
+      return;
+    }
+  *offset += ack ? m_ollaStepUp : -m_ollaStepDown;
+  *offset = std::max (-m_ollaMaxOffset, std::min (m_ollaMaxOffset, *offset));
+}
+
+uint8_t
+NrMacSchedulerCQIManagement::ApplyOllaOffset (uint8_t mcs, double offset, uint32_t maxMcs) const
+{
+  if (m_ollaTargetBler == 0.0)
+    {
+      return mcs;
+    }
+  long adjusted = std::lround (mcs + offset);
+  return static_cast<uint8_t> (std::max (0L, std::min (static_cast<long> (maxMcs), adjusted)));
+}
+
+bool
+NrMacSchedulerCQIManagement::RequestDlCqi (const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
+                                           uint32_t maxAge) const
+{
+  if (m_dlRefreshes - ueInfo->m_dlCqi.m_reportRefresh < maxAge
+      || m_dlRefreshes - ueInfo->m_dlCqi.m_requestRefresh < maxAge)
+    {
+      return false;
+    }
+  NS_LOG_INFO ("Request a DL CQI report to UE " << ueInfo->m_rnti);
+  ueInfo->m_dlCqi.m_requestRefresh = m_dlRefreshes;
+  return true;
+}
+
+void
+NrMacSchedulerCQIManagement::RefreshDlCqiMaps ()
 {
   NS_LOG_FUNCTION (this);
 
-  for (const auto &itUe : ueMap)
+  ++m_dlRefreshes;
+  while (!m_dlExpirations.empty () && m_dlExpirations.top ().m_refresh <= m_dlRefreshes)
     {
-      const std::shared_ptr<NrMacSchedulerUeInfo>&ue = itUe.second;
+      std::shared_ptr<NrMacSchedulerUeInfo> ue = m_dlExpirations.top ().m_ue;
+      bool expired = ue->m_dlCqi.m_expiration == m_dlExpirations.top ().m_refresh;
+      m_dlExpirations.pop ();
 
-      if (ue->m_dlCqi.m_timer == 0)
+      if (expired)
         {
+          NS_LOG_INFO ("DL CQI of UE " << ue->m_rnti << " expired");
           ue->m_dlCqi.m_cqiType = NrMacSchedulerUeInfo::DlCqiInfo::WB;
+          ue->m_dlRbgMcs.clear ();
           for (uint8_t stream = 0; stream < ue->m_dlCqi.m_wbCqi.size (); stream++)
             {
               ue->m_dlCqi.m_wbCqi.at (stream) = 1; // lowest value for trying a transmission
               ue->m_dlMcs.at (stream) = GetStartMcsDl ();
             }
         }
-      else
-        {
-          ue->m_dlCqi.m_timer -= 1;
-        }
     }
 }
 
 void
-NrMacSchedulerCQIManagement::RefreshUlCqiMaps (const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap) const
+NrMacSchedulerCQIManagement::RefreshUlCqiMaps ()
 {
   NS_LOG_FUNCTION (this);
 
-  for (const auto &itUe : ueMap)
+  ++m_ulRefreshes;
+  while (!m_ulExpirations.empty () && m_ulExpirations.top ().m_refresh <= m_ulRefreshes)
     {
-      const std::shared_ptr<NrMacSchedulerUeInfo>&ue = itUe.second;
+      std::shared_ptr<NrMacSchedulerUeInfo> ue = m_ulExpirations.top ().m_ue;
+      bool expired = ue->m_ulCqi.m_expiration == m_ulExpirations.top ().m_refresh;
+      m_ulExpirations.pop ();
 
-      if (ue->m_ulCqi.m_timer == 0)
+      if (expired)
         {
+          NS_LOG_INFO ("UL CQI of UE " << ue->m_rnti << " expired");
           ue->m_ulCqi.m_cqi = 1; // lowest value for trying a transmission
           ue->m_ulCqi.m_cqiType = NrMacSchedulerUeInfo::CqiInfo::WB;
           ue->m_ulMcs = GetStartMcsUl ();
         }
-      else
-        {
-          ue->m_ulCqi.m_timer -= 1;
-        }
     }
 }
 
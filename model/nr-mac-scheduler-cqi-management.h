@@ -20,7 +20,10 @@
 
 #include "nr-phy-mac-common.h"
 #include "nr-mac-scheduler-ue-info.h"
+#include <functional>
 #include <memory>
+#include <queue>
+#include <vector>
 
 namespace ns3 {
 
@@ -31,10 +34,21 @@ class NrAmc;
  * \brief CQI management for schedulers.
  *
  * The scheduler will call either DlWBCQIReported or DlSBCQIReported to calculate
- * a new DL MCS. For UL, only the method UlSBCQIReported is implemented,
+ * a new DL MCS (and, for the SB CQI, a new MCS for each RBG). For UL, only the method UlSBCQIReported is implemented,
  * and it is a bit more complicated. For any detail, check the respective
  * documentation.
  *
+ * A reported CQI is valid for a number of refreshes of the CQI maps (one
+ * per scheduler call, in each direction): the expiration of each CQI is
+ * kept in a min-heap, so that a refresh only touches the UE whose CQI
+ * expires there, and not all the UE.
+ *
+ * With the outer loop link adaptation (OLLA, ConfigureOlla()), each UE has
+ * an MCS offset per direction, updated by the HARQ feedback of the first
+ * transmissions (DlHarqFeedback() and UlHarqFeedback()) and added to the
+ * MCS that comes from each CQI, so that the BLER of the first transmissions
+ * converges to a target even when the CQI is aged or biased.
+ *
  * \see UlSBCQIReported
  * \see DlWBCQIReported
  */
@@ -89,15 +103,20 @@ public:
    * here.
    */
   void DlWBCQIReported (const DlCqiInfo &info, const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
-                        uint32_t expirationTime, int8_t maxDlMcs) const;
+                        uint32_t expirationTime, int8_t maxDlMcs);
   /**
-   * \brief SB CQI reported
+   * \brief A sub-band CQI has been reported for the specified UE
    * \param info SB CQI
    * \param ueInfo UE
+   * \param expirationTime expiration time of the CQI in number of slot
+   * \param maxDlMcs maximum DL MCS index
    *
-   * NOT IMPLEMENTED
+   * The wideband part is processed as in DlWBCQIReported. Then, the MCS of
+   * each RBG is calculated through NrAmc and stored in the m_dlRbgMcs value
+   * of the UE, until the next report or the expiration of the CQI.
    */
-  void DlSBCQIReported (const DlCqiInfo &info, const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo) const;
+  void DlSBCQIReported (const DlCqiInfo &info, const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
+                        uint32_t expirationTime, int8_t maxDlMcs);
 
   /**
    * \brief An UL SB CQI has been reported for the specified UE
@@ -107,47 +126,130 @@ public:
    * \param ueInfo UE info
    * \param rbgMask RBG mask
    * \param numRbPerRbg How many RB do we have per RBG
-   * \param model SpectrumModel to calculate the CQI
+   * \param numRbs the number of RB of the band
    *
    * To calculate the UL MCS, is necessary to remember the allocation done to
    * be able to retrieve the number of symbols and the TBS assigned. This is
    * done inside the class NrMacSchedulerNs3, and here we assume correct
    * parameters as input.
    *
-   * From a vector of SINR (along the entire band) a SpectrumValue is calculated
-   * and then passed as input to NrAmc::CreateCqiFeedbackWbTdma. From this
+   * From a vector of SINR (along the entire band) the SINR of the RBs of the
+   * allocation is calculated and then passed as input to
+   * NrAmc::CreateCqiFeedbackWbTdma. From this
    * function, we have as a result an updated value of CQI, as well as an updated
    * version of MCS for the UL.
    */
   void UlSBCQIReported (uint32_t expirationTime, uint32_t tbs,
                         const NrMacSchedSapProvider::SchedUlCqiInfoReqParameters& params,
                         const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
-                        const std::vector<uint8_t> &rbgMask, uint32_t numRbPerRbg,
-                        const Ptr<const SpectrumModel> &model) const;
+                        const NrBitset &rbgMask, uint32_t numRbPerRbg,
+                        uint32_t numRbs);
 
   /**
-   * \brief Refresh the DL CQI for all the UE
+   * \brief Configure the outer loop link adaptation (OLLA)
+   * \param targetBler the target BLER of the first transmissions, or 0 to
+   * disable the OLLA
+   * \param stepDown the MCS offset removed at each NACK of a first transmission
+   * \param maxOffset the largest absolute value of the offset, in MCS
    *
-   * This method should be called every slot.
-   * Decrement the validity counter DL CQI, and if a CQI expires, reset its
-   * value to the default (MCS 0)
+   * Each ACK of a first transmission adds stepDown * targetBler / (1 - targetBler)
+   * to the offset, so that the offset is stable when the BLER of the first
+   * transmissions equals the target.
+   */
+  void ConfigureOlla (double targetBler, double stepDown, double maxOffset);
+
+  /**
+   * \brief The feedback of a DL first transmission has been received
+   * \param ueInfo UE
+   * \param ack true if the TB has been received correctly
    *
-   * \param m_ueMap UE map
+   * The offset is used from the next DL CQI of the UE.
    */
-  void RefreshDlCqiMaps (const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &m_ueMap) const;
+  void DlHarqFeedback (const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo, bool ack) const;
 
   /**
-   * \brief Refresh the UL CQI for all the UE
+   * \brief The feedback of an UL first transmission has been received
+   * \param ueInfo UE
+   * \param ack true if the TB has been received correctly
    *
-   * This method should be called every slot.
-   * Decrement the validity counter UL CQI, and if a CQI expires, reset its
-   * value to the default (MCS 0)
+   * The offset is used from the next UL CQI of the UE.
+   */
+  void UlHarqFeedback (const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo, bool ack) const;
+
+  /**
+   * \brief Decide if a DL DCI of the UE requests an aperiodic CQI report
+   * \param ueInfo UE
+   * \param maxAge the age, in refreshes of the DL CQI maps, of the CQI to renew
+   * \return true if the last DL CQI of the UE, and the last request, are
+   * at least maxAge refreshes old
    *
-   * \param m_ueMap UE map
+   * When the method returns true the request is recorded, so that the UE
+   * is not asked again before its report arrives.
    */
-  void RefreshUlCqiMaps (const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &m_ueMap) const;
+  bool RequestDlCqi (const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo, uint32_t maxAge) const;
+
+  /**
+   * \brief Refresh the DL CQI of the UE
+   *
+   * This method should be called every slot, before the DL scheduling.
+   * The DL CQI that expire at this refresh are reset to the default value
+   * (the starting MCS); the other UE are not touched.
+   */
+  void RefreshDlCqiMaps ();
+
+  /**
+   * \brief Refresh the UL CQI of the UE
+   *
+   * This method should be called every slot, before the UL scheduling.
+   * The UL CQI that expire at this refresh are reset to the default value
+   * (the starting MCS); the other UE are not touched.
+   */
+  void RefreshUlCqiMaps ();
 
 private:
+  /**
+   * \brief The expiration of a CQI
+   */
+  struct CqiExpiration
+  {
+    uint64_t m_refresh {0};                     //!< Refresh at which the CQI expires
+    std::shared_ptr<NrMacSchedulerUeInfo> m_ue; //!< The UE
+
+    /**
+     * \param o another expiration
+     * \return true if this expiration is after the other
+     */
+    bool operator> (const CqiExpiration &o) const
+    {
+      return m_refresh > o.m_refresh;
+    }
+  };
+
+  /**
+   * \brief Min-heap of the CQI expirations
+   *
+   * A UE that reports again before its CQI expires has more than one entry;
+   * only the one equal to the expiration stored in the UE is valid.
+   */
+  typedef std::priority_queue<CqiExpiration, std::vector<CqiExpiration>,
+                              std::greater<CqiExpiration>> CqiExpirationHeap;
+
+  /**
+   * \brief Update an OLLA offset with a HARQ feedback
+   * \param offset the offset
+   * \param ack true if the TB has been received correctly
+   */
+  void UpdateOllaOffset (double *offset, bool ack) const;
+
+  /**
+   * \brief Add an OLLA offset to a MCS
+   * \param mcs the MCS from the CQI
+   * \param offset the offset
+   * \param maxMcs the highest MCS
+   * \return the MCS with the offset, between 0 and maxMcs
+   */
+  uint8_t ApplyOllaOffset (uint8_t mcs, double offset, uint32_t maxMcs) const;
+
   /**
    * \brief Get the bwp id of this MAC
    * \return the bwp id
@@ -186,6 +288,16 @@ private:
   std::function<uint8_t ()> m_getStartMcsUl; //!< Function to retrieve the starting MCS for UL
   std::function<Ptr<const NrAmc> ()> m_getAmcDl; //!< Function to retrieve the AMC for DL
   std::function<Ptr<const NrAmc> ()> m_getAmcUl; //!< Function to retrieve the AMC for UL
+
+  uint64_t m_dlRefreshes {0};       //!< Number of refreshes of the DL CQI
+  uint64_t m_ulRefreshes {0};       //!< Number of refreshes of the UL CQI
+  CqiExpirationHeap m_dlExpirations; //!< Expirations of the DL CQI
+  CqiExpirationHeap m_ulExpirations; //!< Expirations of the UL CQI
+
+  double m_ollaTargetBler {0.0};    //!< Target BLER of the OLLA (0 if disabled)
+  double m_ollaStepDown {0.0};      //!< OLLA offset removed at each NACK
+  double m_ollaStepUp {0.0};        //!< OLLA offset added at each ACK
+  double m_ollaMaxOffset {0.0};     //!< Largest absolute value of the OLLA offset
 };
 
 } // namespace ns3
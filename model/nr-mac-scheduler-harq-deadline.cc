@@ -0,0 +1,135 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#define NS_LOG_APPEND_CONTEXT                                            \
+  do                                                                     \
+    {                                                                    \
+      std::clog << " [ CellId " << GetCellId() << ", bwpId "             \
+                << GetBwpId () << "] ";                                  \
+    }                                                                    \
+  while (false);
+#include "nr-mac-scheduler-harq-deadline.h"
+#include <ns3/log.h>
+#include <array>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrMacSchedulerHarqDeadline");
+
+NrMacSchedulerHarqDeadline::NrMacSchedulerHarqDeadline (uint8_t deadline)
+  : NrMacSchedulerHarqRr (),
+  m_retxDeadline (deadline)
+{
+}
+
+void
+NrMacSchedulerHarqDeadline::SetRetxDeadline (uint8_t deadline)
+{
+  m_retxDeadline = deadline;
+}
+
+uint8_t
+NrMacSchedulerHarqDeadline::GetRetxDeadline () const
+{
+  return m_retxDeadline;
+}
+
+void
+NrMacSchedulerHarqDeadline::SortDlHarq (NrMacSchedulerNs3::ActiveHarqMap *activeDlHarq) const
+{
+  NS_LOG_FUNCTION (this);
+
+  for (auto & beam : *activeDlHarq)
+    {
+      auto & list = beam.second;
+      if (list.size () < 2)
+        {
+          continue;
+        }
+
+      // count[t] is, at the end, the first position of the processes
+      // with timer t in the list ordered from the highest timer
+      std::array<uint32_t, UINT8_MAX + 1> count {};
+      for (const auto & it : list)
+        {
+          ++count[UINT8_MAX - it->second.m_timer];
+        }
+      uint32_t position = 0;
+      for (auto & c : count)
+        {
+          uint32_t n = c;
+          c = position;
+          position += n;
+        }
+
+      m_sorted.resize (list.size ());
+      for (const auto & it : list)
+        {
+          m_sorted[count[UINT8_MAX - it->second.m_timer]++] = it;
+        }
+      // The old list becomes the storage for the next beam
+      list.swap (m_sorted);
+    }
+}
+
+void
+NrMacSchedulerHarqDeadline::DropStaleDlHarq (std::vector<DlHarqInfo> *dlHarqFeedback,
+                                             const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap) const
+{
+  DropStaleHarq (dlHarqFeedback, ueMap, NrMacSchedulerUeInfo::GetDlHarqVector);
+}
+
+void
+NrMacSchedulerHarqDeadline::DropStaleUlHarq (std::vector<UlHarqInfo> *ulHarqFeedback,
+                                             const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap) const
+{
+  DropStaleHarq (ulHarqFeedback, ueMap, NrMacSchedulerUeInfo::GetUlHarqVector);
+}
+
+template <typename T>
+void
+NrMacSchedulerHarqDeadline::DropStaleHarq (std::vector<T> *harqFeedback,
+                                           const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap,
+                                           const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVectorFn) const
+{
+  NS_LOG_FUNCTION (this);
+
+  // Compact the feedbacks in place, without moving the ones that are kept
+  // if nothing is erased
+  auto kept = harqFeedback->begin ();
+  for (auto it = harqFeedback->begin (); it != harqFeedback->end (); ++it)
+    {
+      NrMacHarqVector & harqVector = GetHarqVectorFn (ueMap.find (it->m_rnti)->second);
+      if (harqVector.Get (it->m_harqProcessId).m_timer >= m_retxDeadline)
+        {
+          NS_LOG_INFO ("Erased process " << static_cast<uint32_t> (it->m_harqProcessId) <<
+                       " of UE " << it->m_rnti << ": retransmission deadline of " <<
+                       static_cast<uint32_t> (m_retxDeadline) << " slots passed");
+          harqVector.Erase (it->m_harqProcessId);
+          continue;
+        }
+      if (kept != it)
+        {
+          *kept = std::move (*it);
+        }
+      ++kept;
+    }
+  harqFeedback->erase (kept, harqFeedback->end ());
+}
+
+} // namespace ns3
@@ -0,0 +1,104 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+
+#include "nr-mac-scheduler-harq-rr.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief Schedule the HARQ retransmission, oldest first, within a deadline
+ *
+ * The retransmissions are placed as in NrMacSchedulerHarqRr, but in each
+ * beam they are ordered by the slots they waited since their last
+ * transmission (the HarqProcess timer), the oldest first. The processes
+ * that waited the retransmission deadline or more are erased before they
+ * are scheduled, so that stale HARQ does not take the symbols of new data.
+ *
+ * The timer of a process is bounded by the number of HARQ processes (after
+ * that, NrMacSchedulerNs3 erases the process), so the retransmissions are
+ * ordered with a count of the timers instead of a sort.
+ */
+class NrMacSchedulerHarqDeadline : public NrMacSchedulerHarqRr
+{
+public:
+  /**
+   * \brief NrMacSchedulerHarqDeadline constructor
+   * \param deadline the retransmission deadline, in slots
+   */
+  NrMacSchedulerHarqDeadline (uint8_t deadline);
+
+  /**
+   * \brief Set the retransmission deadline
+   * \param deadline the number of slots a NACKed process can wait for its retransmission
+   */
+  void SetRetxDeadline (uint8_t deadline);
+
+  /**
+   * \brief Get the retransmission deadline
+   * \return the number of slots a NACKed process can wait for its retransmission
+   */
+  uint8_t GetRetxDeadline () const;
+
+  /**
+   * \brief Order the DL HARQ of each beam by their timer, the oldest first
+   * \param activeDlHarq map of the active retx
+   *
+   * Within the same timer, the processes keep the order of the feedbacks:
+   * the ones that could not be retransmitted in the previous slots first.
+   */
+  virtual void SortDlHarq (NrMacSchedulerNs3::ActiveHarqMap *activeDlHarq) const override;
+
+  /**
+   * \brief Erase the DL processes that waited the deadline, and their feedback
+   * \param dlHarqFeedback the NACKed feedbacks
+   * \param ueMap Map of the UEs
+   */
+  virtual void DropStaleDlHarq (std::vector<DlHarqInfo> *dlHarqFeedback,
+                                const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap) const override;
+
+  /**
+   * \brief Erase the UL processes that waited the deadline, and their feedback
+   * \param ulHarqFeedback the NACKed feedbacks
+   * \param ueMap Map of the UEs
+   *
+   * The UL retransmissions are served in the order of the feedbacks, and
+   * the buffered ones are already before the new ones.
+   */
+  virtual void DropStaleUlHarq (std::vector<UlHarqInfo> *ulHarqFeedback,
+                                const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap) const override;
+
+private:
+  /**
+   * \brief Erase the processes that waited the deadline, and their feedback
+   * \param harqFeedback the NACKed feedbacks
+   * \param ueMap Map of the UEs
+   * \param GetHarqVectorFn function to retrieve the HARQ vector of a UE
+   */
+  template <typename T>
+  void DropStaleHarq (std::vector<T> *harqFeedback,
+                      const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap,
+                      const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVectorFn) const;
+
+  uint8_t m_retxDeadline {0}; //!< Slots a NACKed process can wait for its retransmission
+  mutable NrMacSchedulerNs3::HarqVectorIteratorList m_sorted; //!< Storage swapped with the sorted lists
+};
+
+} // namespace ns3
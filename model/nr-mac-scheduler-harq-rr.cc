@@ -105,8 +105,7 @@ uint8_t NrMacSchedulerHarqRr::ScheduleDlHarq (NrMacSchedulerNs3::PointInFTPlane
 
           auto & dciInfoReTx = harqProcess.m_dciElement;
 
-          long rbgAssigned = std::count (dciInfoReTx->m_rbgBitmask.begin (),
-                                         dciInfoReTx->m_rbgBitmask.end (), 1) * dciInfoReTx->m_numSym;
+          long rbgAssigned = static_cast<long> (dciInfoReTx->m_rbgBitmask.count ()) * dciInfoReTx->m_numSym;
           uint32_t rbgAvail = (GetBandwidthInRbg () - startingPoint->m_rbg) * symPerBeam;
 
           NS_LOG_INFO ("Evaluating space to retransmit HARQ PID=" <<
@@ -138,13 +137,13 @@ uint8_t NrMacSchedulerHarqRr::ScheduleDlHarq (NrMacSchedulerNs3::PointInFTPlane
 
           NS_ASSERT (dciInfoReTx->m_format == DciInfoElementTdma::DL);
 
-          std::vector<uint32_t> tbSize;
+          StreamVector<uint32_t> tbSize;
           tbSize.resize (dciInfoReTx->m_tbSize.size ());
-          std::vector<uint8_t> ndi;
+          StreamVector<uint8_t> ndi;
           ndi.resize (dciInfoReTx->m_ndi.size ());
-          std::vector<uint8_t> rv;
+          StreamVector<uint8_t> rv;
           rv.resize (dciInfoReTx->m_rv.size ());
-          std::vector<uint8_t> mcs;
+          StreamVector<uint8_t> mcs;
           mcs.resize (dciInfoReTx->m_mcs.size ());
 
           for (uint8_t stream = 0; stream < dciInfoReTx->m_tbSize.size (); stream++)
@@ -172,10 +171,10 @@ uint8_t NrMacSchedulerHarqRr::ScheduleDlHarq (NrMacSchedulerNs3::PointInFTPlane
 
             }
 
-          auto dci = std::make_shared<DciInfoElementTdma> (dciInfoReTx->m_rnti, dciInfoReTx->m_format,
-                                                           startingPoint->m_sym, symPerBeam,
-                                                           mcs, tbSize, ndi, rv, DciInfoElementTdma::DATA,
-                                                           dciInfoReTx->m_bwpIndex, dciInfoReTx->m_tpc);
+          auto dci = DciInfoElementTdma::Create (dciInfoReTx->m_rnti, dciInfoReTx->m_format,
+                                                 startingPoint->m_sym, symPerBeam,
+                                                 mcs, tbSize, ndi, rv, DciInfoElementTdma::DATA,
+                                                 dciInfoReTx->m_bwpIndex, dciInfoReTx->m_tpc);
 
           dci->m_rbgBitmask = harqProcess.m_dciElement->m_rbgBitmask;
           dci->m_harqProcess = dciInfoReTx->m_harqProcess;
@@ -195,16 +194,11 @@ uint8_t NrMacSchedulerHarqRr::ScheduleDlHarq (NrMacSchedulerNs3::PointInFTPlane
 
           NS_ABORT_IF (static_cast<unsigned long> (rbgAssigned) > dciInfoReTx->m_rbgBitmask.size ());
 
-          for (unsigned int i = 0; i < dciInfoReTx->m_rbgBitmask.size (); ++i)
+          dciInfoReTx->m_rbgBitmask.reset ();
+          for (unsigned int i = startingPoint->m_rbg;
+               i < dciInfoReTx->m_rbgBitmask.size () && i < startingPoint->m_rbg + rbgAssigned; ++i)
             {
-              if (startingPoint->m_rbg <= i && i < startingPoint->m_rbg + rbgAssigned)
-                {
-                  dciInfoReTx->m_rbgBitmask.at (i) = 1;
-                }
-              else
-                {
-                  dciInfoReTx->m_rbgBitmask.at (i) = 0;
-                }
+              dciInfoReTx->m_rbgBitmask.set (i);
             }
 
           startingPoint->m_rbg += rbgAssigned;
@@ -315,15 +309,15 @@ NrMacSchedulerHarqRr::ScheduleUlHarq (NrMacSchedulerNs3::PointInFTPlane *startin
           NS_ASSERT_MSG (harqProcess.nackStreamIndexes.size () == 1, "MIMO is not supported for UL yet");
 
           uint8_t rvIndex = dciInfoReTx->m_rv.at (0) + 1;
-          std::vector<uint8_t> rv {rvIndex};
-          std::vector<uint8_t> ndi {0};
-
-          auto dci = std::make_shared<DciInfoElementTdma> (dciInfoReTx->m_rnti, dciInfoReTx->m_format,
-                                                           startingPoint->m_sym - dciInfoReTx->m_numSym,
-                                                           dciInfoReTx->m_numSym,
-                                                           dciInfoReTx->m_mcs, dciInfoReTx->m_tbSize,
-                                                           ndi, rv, DciInfoElementTdma::DATA,
-                                                           dciInfoReTx->m_bwpIndex, dciInfoReTx->m_tpc);
+          StreamVector<uint8_t> rv {rvIndex};
+          StreamVector<uint8_t> ndi {0};
+
+          auto dci = DciInfoElementTdma::Create (dciInfoReTx->m_rnti, dciInfoReTx->m_format,
+                                                 startingPoint->m_sym - dciInfoReTx->m_numSym,
+                                                 dciInfoReTx->m_numSym,
+                                                 dciInfoReTx->m_mcs, dciInfoReTx->m_tbSize,
+                                                 ndi, rv, DciInfoElementTdma::DATA,
+                                                 dciInfoReTx->m_bwpIndex, dciInfoReTx->m_tpc);
           dci->m_rbgBitmask = harqProcess.m_dciElement->m_rbgBitmask;
           dci->m_harqProcess = harqId;
           harqProcess.m_dciElement = dci;
@@ -397,6 +391,18 @@ NrMacSchedulerHarqRr::SortUlHarq ([[maybe_unused]] NrMacSchedulerNs3::ActiveHarq
   NS_LOG_FUNCTION (this);
 }
 
+void
+NrMacSchedulerHarqRr::DropStaleDlHarq ([[maybe_unused]] std::vector<DlHarqInfo> *dlHarqFeedback,
+                                       [[maybe_unused]] const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap) const
+{
+}
+
+void
+NrMacSchedulerHarqRr::DropStaleUlHarq ([[maybe_unused]] std::vector<UlHarqInfo> *ulHarqFeedback,
+                                       [[maybe_unused]] const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap) const
+{
+}
+
 /**
  * \brief Find the specified HARQ process and buffer it into a vector
  * \param dlHarqFeedback HARQ not retransmitted list
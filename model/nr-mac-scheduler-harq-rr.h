@@ -83,6 +83,28 @@ public:
   virtual void SortDlHarq (NrMacSchedulerNs3::ActiveHarqMap *activeDlHarq) const;
   virtual void SortUlHarq (NrMacSchedulerNs3::ActiveHarqMap *activeUlHarq) const;
 
+  /**
+   * \brief Remove the DL retransmissions that should not be scheduled anymore
+   * \param dlHarqFeedback the NACKed feedbacks
+   * \param ueMap Map of the UEs
+   *
+   * Called after the feedbacks are processed, and before the active HARQ
+   * are computed. The round-robin scheduler keeps all of them.
+   */
+  virtual void DropStaleDlHarq (std::vector<DlHarqInfo> *dlHarqFeedback,
+                                const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap) const;
+
+  /**
+   * \brief Remove the UL retransmissions that should not be scheduled anymore
+   * \param ulHarqFeedback the NACKed feedbacks
+   * \param ueMap Map of the UEs
+   *
+   * Called after the feedbacks are processed, and before the active HARQ
+   * are computed. The round-robin scheduler keeps all of them.
+   */
+  virtual void DropStaleUlHarq (std::vector<UlHarqInfo> *ulHarqFeedback,
+                                const std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > &ueMap) const;
+
 protected:
   void BufferHARQFeedback (const std::vector <DlHarqInfo> &dlHarqFeedback,
                            std::vector<DlHarqInfo> *dlHarqToRetransmit,
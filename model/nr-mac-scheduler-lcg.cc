@@ -21,6 +21,8 @@
 
 #include <ns3/eps-bearer.h>
 #include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <algorithm>
 
 namespace ns3 {
 
@@ -46,6 +48,19 @@ NrMacSchedulerLC::Update (const NrMacSchedSapProvider::SchedDlRlcBufferReqParame
   m_rlcStatusPduSize = params.m_rlcStatusPduSize;
   m_rlcRetransmissionHolDelay = params.m_rlcRetransmissionHolDelay;
   m_rlcTransmissionQueueHolDelay = params.m_rlcTransmissionQueueHolDelay;
+
+  // The RLC reports the HOL delays at the time of the report: store the
+  // arrival time, so that the delay keeps growing until the next report
+  uint16_t holDelay = 0;
+  if (m_rlcRetransmissionQueueSize > 0)
+    {
+      holDelay = m_rlcRetransmissionHolDelay;
+    }
+  if (m_rlcTransmissionQueueSize > 0)
+    {
+      holDelay = std::max (holDelay, m_rlcTransmissionQueueHolDelay);
+    }
+  m_holTimestamp = GetTotalSize () > 0 ? Simulator::Now () - MilliSeconds (holDelay) : Time::Max ();
 }
 
 uint32_t
@@ -54,6 +69,16 @@ NrMacSchedulerLC::GetTotalSize () const
   return m_rlcTransmissionQueueSize + m_rlcRetransmissionQueueSize + m_rlcStatusPduSize;
 }
 
+Time
+NrMacSchedulerLC::GetDeadline () const
+{
+  if (m_holTimestamp == Time::Max ())
+    {
+      return Time::Max ();
+    }
+  return m_holTimestamp + m_delayBudget;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //NrMacSchedulerLCG
@@ -84,7 +109,13 @@ NrMacSchedulerLCG::Insert (LCPtr && lc)
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (!Contains (lc->m_id));
-  return m_lcMap.emplace (std::make_pair (lc->m_id, std::move (lc))).second;
+  const NrMacSchedulerLC &inserted = *lc;
+  bool ret = m_lcMap.emplace (std::make_pair (lc->m_id, std::move (lc))).second;
+  if (ret)
+    {
+      SizeChanged (inserted, 0);
+    }
+  return ret;
 }
 
 void
@@ -92,7 +123,10 @@ NrMacSchedulerLCG::UpdateInfo (const NrMacSchedSapProvider::SchedDlRlcBufferReqP
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (Contains (params.m_logicalChannelIdentity));
-  m_lcMap.at (params.m_logicalChannelIdentity)->Update (params);
+  NrMacSchedulerLC &lc = *m_lcMap.at (params.m_logicalChannelIdentity);
+  uint32_t oldSize = lc.GetTotalSize ();
+  lc.Update (params);
+  SizeChanged (lc, oldSize);
 }
 
 void
@@ -104,7 +138,18 @@ NrMacSchedulerLCG::UpdateInfo (uint32_t lcgQueueSize)
 
   for (auto & lc : m_lcMap)
     {
+      uint32_t oldSize = lc.second->GetTotalSize ();
       lc.second->m_rlcTransmissionQueueSize = lcIdPart;
+      // The BSR has no delay: the data arrived at most when the LCG got data
+      if (lcIdPart == 0)
+        {
+          lc.second->m_holTimestamp = Time::Max ();
+        }
+      else if (oldSize == 0)
+        {
+          lc.second->m_holTimestamp = Simulator::Now ();
+        }
+      SizeChanged (*lc.second, oldSize);
     }
 }
 
@@ -112,13 +157,8 @@ uint32_t
 NrMacSchedulerLCG::GetTotalSize () const
 {
   NS_LOG_FUNCTION (this);
-  uint32_t totalSize = 0;
-  for (const auto & lc: m_lcMap)
-    {
-      totalSize += lc.second->GetTotalSize();
-    }
-  NS_LOG_INFO ("Total size: " << totalSize);
-  return totalSize;
+  NS_LOG_INFO ("Total size: " << m_totalSize);
+  return m_totalSize;
 }
 
 uint32_t
@@ -140,6 +180,65 @@ NrMacSchedulerLCG::GetLCId () const
   return ret;
 }
 
+const std::vector<uint8_t> &
+NrMacSchedulerLCG::GetActiveLCId () const
+{
+  return m_activeLc;
+}
+
+Time
+NrMacSchedulerLCG::GetEarliestDeadline (Time *delayBudget) const
+{
+  Time earliest = Time::Max ();
+  for (uint8_t lcId : m_activeLc)
+    {
+      const NrMacSchedulerLC &lc = *m_lcMap.at (lcId);
+      Time deadline = lc.GetDeadline ();
+      if (deadline < earliest)
+        {
+          earliest = deadline;
+          if (delayBudget != nullptr)
+            {
+              *delayBudget = lc.m_delayBudget;
+            }
+        }
+    }
+  return earliest;
+}
+
+uint32_t
+NrMacSchedulerLCG::GetTotalSizeWithin (const Time &maxDelayBudget) const
+{
+  uint32_t size = 0;
+  for (uint8_t lcId : m_activeLc)
+    {
+      const NrMacSchedulerLC &lc = *m_lcMap.at (lcId);
+      if (lc.m_delayBudget <= maxDelayBudget)
+        {
+          size += lc.GetTotalSize ();
+        }
+    }
+  return size;
+}
+
+void
+NrMacSchedulerLCG::SizeChanged (const NrMacSchedulerLC &lc, uint32_t oldSize)
+{
+  uint32_t newSize = lc.GetTotalSize ();
+  NS_ASSERT (m_totalSize >= oldSize);
+  m_totalSize = m_totalSize - oldSize + newSize;
+
+  uint8_t lcId = static_cast<uint8_t> (lc.m_id);
+  if (oldSize == 0 && newSize > 0)
+    {
+      m_activeLc.insert (std::lower_bound (m_activeLc.begin (), m_activeLc.end (), lcId), lcId);
+    }
+  else if (oldSize > 0 && newSize == 0)
+    {
+      m_activeLc.erase (std::lower_bound (m_activeLc.begin (), m_activeLc.end (), lcId));
+    }
+}
+
 void
 NrMacSchedulerLCG::AssignedData (uint8_t lcId, uint32_t size, std::string type)
 {
@@ -147,6 +246,7 @@ NrMacSchedulerLCG::AssignedData (uint8_t lcId, uint32_t size, std::string type)
   NS_ASSERT (m_lcMap.size () > 0);
 
   NS_LOG_INFO ("Assigning " << size << " bytes to lcId: "<< +lcId);
+  uint32_t oldSize = m_lcMap.at (lcId)->GetTotalSize ();
   // Update queues: RLC tx order Status, ReTx, Tx. To understand this, you have
   // to see RlcAm::NotifyTxOpportunity
   NS_LOG_INFO ("Status of LCID " << static_cast<uint32_t> (lcId) << " before: RLC PDU =" <<
@@ -221,6 +321,13 @@ NrMacSchedulerLCG::AssignedData (uint8_t lcId, uint32_t size, std::string type)
                m_lcMap.at (lcId)->m_rlcStatusPduSize << ", RLC RX=" <<
                m_lcMap.at (lcId)->m_rlcRetransmissionQueueSize << ", RLC TX=" <<
                m_lcMap.at (lcId)->m_rlcTransmissionQueueSize);
+
+  // The HOL data of a partly served LC is known only at the next report
+  if (m_lcMap.at (lcId)->GetTotalSize () == 0)
+    {
+      m_lcMap.at (lcId)->m_holTimestamp = Time::Max ();
+    }
+  SizeChanged (*m_lcMap.at (lcId), oldSize);
 }
 
 } // namespace ns3
@@ -65,6 +65,13 @@ public:
    */
   uint32_t GetTotalSize () const;
 
+  /**
+   * \brief Get the deadline of the head of line data
+   * \return the time at which the head of line data exceeds the delay
+   * budget, or Time::Max () if the LC has no data
+   */
+  Time GetDeadline () const;
+
   uint32_t m_id                           {0}; //!< ID of the LC
   uint32_t m_rlcTransmissionQueueSize     {0}; //!< The current size of the new transmission queue in byte.
   uint16_t m_rlcTransmissionQueueHolDelay {0}; //!< Head of line delay of new transmissions in ms.
@@ -73,6 +80,7 @@ public:
   uint16_t m_rlcStatusPduSize             {0}; //!< The current size of the pending STATUS message in byte.
 
   Time m_delayBudget    {Time::Min ()}; //!< Delay budget of the flow
+  Time m_holTimestamp   {Time::Max ()}; //!< Arrival time of the head of line data (Time::Max () without data)
   double m_PER          {0.0};         //!< PER of the flow
   bool m_isGbr          {false};       //!< Is GBR?
 };
@@ -100,6 +108,11 @@ typedef std::unique_ptr<NrMacSchedulerLC> LCPtr;
  * The general usage of this class is to insert each LC, and then update the
  * amount of bytes stored. The removal of an LC is still missing.
  *
+ * The total size of the LCG, and the list of the LC that have data, are
+ * kept updated by UpdateInfo and AssignedData, so that GetTotalSize costs
+ * nothing and the LC without data are not visited at each TB. For this
+ * reason, the queue sizes of the LC must be changed only through the LCG.
+ *
  * For what regards UL, we currently support only one LC per LCG. This comes
  * from the fact that the BSR is reported for all the LCG, and the scheduler
  * has no way to identify which LCID contains bytes. So, even at the cost to
@@ -177,6 +190,31 @@ public:
    */
   std::vector<uint8_t> GetLCId () const;
 
+  /**
+   * \brief Get the LC that have data
+   * \return the ID of the LC with a total size greater than 0, in increasing order
+   */
+  const std::vector<uint8_t> & GetActiveLCId () const;
+
+  /**
+   * \brief Get the earliest deadline of the LC with data
+   * \param delayBudget if not null, set to the delay budget of the LC with
+   * the earliest deadline
+   * \return the earliest deadline, or Time::Max () if no LC has data
+   *
+   * Only the LC with data are visited.
+   */
+  Time GetEarliestDeadline (Time *delayBudget = nullptr) const;
+
+  /**
+   * \brief Get the size of the LC with a short delay budget
+   * \param maxDelayBudget the longest delay budget counted
+   * \return the total size of the LC whose delay budget is at most maxDelayBudget
+   *
+   * Only the LC with data are visited.
+   */
+  uint32_t GetTotalSizeWithin (const Time &maxDelayBudget) const;
+
   /**
    * \brief Inform the LCG of the assigned data to a LC id
    * \param lcId the LC id to which the data was assigned
@@ -186,8 +224,17 @@ public:
   void AssignedData (uint8_t lcId, uint32_t size, std::string type);
 
 private:
+  /**
+   * \brief Update the total size and the active LC after a change of the size of a LC
+   * \param lc the LC
+   * \param oldSize the total size of the LC before the change
+   */
+  void SizeChanged (const NrMacSchedulerLC &lc, uint32_t oldSize);
+
   uint8_t m_id {0};                          //!< ID of the LCG
   std::unordered_map<uint8_t, LCPtr> m_lcMap; //!< Map between LC id and their pointer
+  uint32_t m_totalSize {0};                  //!< Sum of the total size of the LC
+  std::vector<uint8_t> m_activeLc;           //!< ID of the LC with data, in increasing order
 };
 
 /**
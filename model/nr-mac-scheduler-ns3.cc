@@ -27,17 +27,24 @@
 
 #include "nr-mac-scheduler-ns3.h"
 #include "nr-mac-scheduler-harq-rr.h"
+#include "nr-mac-scheduler-harq-deadline.h"
 #include "nr-mac-short-bsr-ce.h"
 #include "nr-mac-scheduler-srs-default.h"
+#include "nr-perf-profiler.h"
 
 #include <ns3/boolean.h>
+#include <ns3/double.h>
 #include <ns3/uinteger.h>
 #include <ns3/log.h>
 #include <ns3/eps-bearer.h>
 #include <ns3/pointer.h>
+#include <ns3/simulator.h>
+#include <ns3/object-factory.h>
 #include <algorithm>
 #include <ns3/integer.h>
 #include <unordered_set>
+#include <cmath>
+#include <map>
 
 namespace ns3 {
 
@@ -48,11 +55,8 @@ NrMacSchedulerNs3::NrMacSchedulerNs3 () : NrMacScheduler ()
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  // Hardcoded, but the type can be a parameter if needed
-  m_schedHarq = std::unique_ptr<NrMacSchedulerHarqRr> (new NrMacSchedulerHarqRr ());
-  m_schedHarq->InstallGetBwInRBG (std::bind (&NrMacSchedulerNs3::GetBandwidthInRbg, this));
-  m_schedHarq->InstallGetBwpIdFn (std::bind (&NrMacSchedulerNs3::GetBwpId, this));
-  m_schedHarq->InstallGetCellIdFn (std::bind (&NrMacSchedulerNs3::GetCellId, this));
+  // Replaced by SetHarqRetxDeadline, if a deadline is set
+  InstallHarqScheduler (std::unique_ptr<NrMacSchedulerHarqRr> (new NrMacSchedulerHarqRr ()));
 
   m_cqiManagement.InstallGetBwpIdFn (std::bind (&NrMacSchedulerNs3::GetBwpId, this));
   m_cqiManagement.InstallGetCellIdFn (std::bind (&NrMacSchedulerNs3::GetCellId, this));
@@ -61,13 +65,14 @@ NrMacSchedulerNs3::NrMacSchedulerNs3 () : NrMacScheduler ()
   m_cqiManagement.InstallGetStartMcsDlFn (std::bind ([this] () { return m_startMcsDl; }));
   m_cqiManagement.InstallGetStartMcsUlFn (std::bind ([this] () { return m_startMcsUl; }));
 
-  // If more Srs allocators will be created, then we will add an attribute
+  // Replaced by SetSrsAlgorithm, with the SrsAlgorithm attribute
   m_schedulerSrs = CreateObject<NrMacSchedulerSrsDefault> ();
 }
 
 NrMacSchedulerNs3::~NrMacSchedulerNs3 ()
 {
   m_ueMap.clear ();
+  m_ueVector.clear ();
 }
 
 void
@@ -98,6 +103,12 @@ NrMacSchedulerNs3::GetDlAmc() const
   return m_dlAmc;
 }
 
+Ptr<NrIcicAlgorithm>
+NrMacSchedulerNs3::GetIcicAlgorithm () const
+{
+  return m_icic;
+}
+
 int64_t
 NrMacSchedulerNs3::AssignStreams (int64_t stream)
 {
@@ -174,6 +185,13 @@ NrMacSchedulerNs3::GetTypeId (void)
                     MakeBooleanAccessor (&NrMacSchedulerNs3::SetSrsInFSlots,
                                          &NrMacSchedulerNs3::IsSrsInFSlots),
                     MakeBooleanChecker ())
+    .AddAttribute ("SrsAlgorithm",
+                   "The algorithm that assigns the SRS periodicity and offset of the UEs, "
+                   "NrMacSchedulerSrsDefault or a subclass (e.g., NrMacSchedulerSrsAdaptive)",
+                   TypeIdValue (NrMacSchedulerSrsDefault::GetTypeId ()),
+                   MakeTypeIdAccessor (&NrMacSchedulerNs3::SetSrsAlgorithm,
+                                       &NrMacSchedulerNs3::GetSrsAlgorithm),
+                   MakeTypeIdChecker ())
     .AddAttribute ("DlAmc",
                    "The DL AMC of this scheduler",
                    PointerValue (),
@@ -184,6 +202,18 @@ NrMacSchedulerNs3::GetTypeId (void)
                    PointerValue (),
                    MakePointerAccessor (&NrMacSchedulerNs3::m_ulAmc),
                    MakePointerChecker <NrAmc> ())
+    .AddAttribute ("DlPowerAllocator",
+                   "The algorithm that shares the DL power of each transmission among its RBGs "
+                   "(e.g., NrDlPowerAllocatorWaterFilling). With none, the power is uniform",
+                   PointerValue (),
+                   MakePointerAccessor (&NrMacSchedulerNs3::m_dlPowerAllocator),
+                   MakePointerChecker <NrDlPowerAllocator> ())
+    .AddAttribute ("IcicAlgorithm",
+                   "The inter-cell interference coordination of the DL of the cell "
+                   "(e.g., NrIcicFrequencyReuse). It must not be shared with other cells",
+                   PointerValue (),
+                   MakePointerAccessor (&NrMacSchedulerNs3::m_icic),
+                   MakePointerChecker <NrIcicAlgorithm> ())
     .AddAttribute ("MaxDlMcs",
                    "Maximum MCS index for DL",
                    IntegerValue (-1),
@@ -196,6 +226,105 @@ NrMacSchedulerNs3::GetTypeId (void)
                    MakeBooleanAccessor (&NrMacSchedulerNs3::EnableHarqReTx,
                                         &NrMacSchedulerNs3::IsHarqReTxEnable),
                                         MakeBooleanChecker ())
+    .AddAttribute ("HarqRetxDeadline",
+                   "Number of slots a NACKed HARQ process can wait for its retransmission, "
+                   "counted from its last transmission (thus including the feedback delay). "
+                   "The processes that wait more are erased, and the retransmissions are "
+                   "scheduled oldest first. With 0, there is no deadline and the "
+                   "retransmissions are ordered by their number of symbols",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrMacSchedulerNs3::SetHarqRetxDeadline,
+                                         &NrMacSchedulerNs3::GetHarqRetxDeadline),
+                   MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("ProactiveUlGrant",
+                   "If true, the grant given for a SR is sized from the average of the "
+                   "non-empty BSRs of the UE, and the UEs that sent a non-empty BSR in the "
+                   "last ProactiveUlWindow get a minimal UL grant when they have no UL data "
+                   "nor UL HARQ process, without waiting for a SR",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrMacSchedulerNs3::SetProactiveUlGrant,
+                                        &NrMacSchedulerNs3::IsProactiveUlGrant),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ProactiveUlWindow",
+                   "Time after the last non-empty BSR during which a UE gets the proactive UL grants",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&NrMacSchedulerNs3::SetProactiveUlWindow,
+                                     &NrMacSchedulerNs3::GetProactiveUlWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("BsrAverageWeight",
+                   "Weight of the last non-empty BSR in the average of the BSRs of a UE",
+                   DoubleValue (0.25),
+                   MakeDoubleAccessor (&NrMacSchedulerNs3::SetBsrAverageWeight,
+                                       &NrMacSchedulerNs3::GetBsrAverageWeight),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("MiniSlotSymbols",
+                   "Number of symbols (2, 4 or 7) of the mini-slots in which the data of the "
+                   "LC with a delay budget up to MiniSlotDelayBudget is scheduled; 0 to "
+                   "schedule all the data per slot",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrMacSchedulerNs3::SetMiniSlotSymbols,
+                                         &NrMacSchedulerNs3::GetMiniSlotSymbols),
+                   MakeUintegerChecker<uint8_t> (0, 7))
+    .AddAttribute ("MiniSlotDelayBudget",
+                   "Longest packet delay budget of the LC scheduled in mini-slots",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&NrMacSchedulerNs3::SetMiniSlotDelayBudget,
+                                     &NrMacSchedulerNs3::GetMiniSlotDelayBudget),
+                   MakeTimeChecker ())
+    .AddAttribute ("OllaTargetBler",
+                   "Target BLER of the first transmissions of the outer loop link adaptation "
+                   "(OLLA), that corrects the MCS from the CQI with the HARQ feedback; 0 to "
+                   "disable the OLLA",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&NrMacSchedulerNs3::SetOllaTargetBler,
+                                       &NrMacSchedulerNs3::GetOllaTargetBler),
+                   MakeDoubleChecker<double> (0.0, 0.5))
+    .AddAttribute ("OllaStepDown",
+                   "MCS offset removed by the OLLA at each NACK of a first transmission; "
+                   "the offset added at each ACK follows from OllaTargetBler",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&NrMacSchedulerNs3::SetOllaStepDown,
+                                       &NrMacSchedulerNs3::GetOllaStepDown),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("OllaMaxOffset",
+                   "Largest absolute value of the OLLA MCS offset",
+                   DoubleValue (10.0),
+                   MakeDoubleAccessor (&NrMacSchedulerNs3::SetOllaMaxOffset,
+                                       &NrMacSchedulerNs3::GetOllaMaxOffset),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("AperiodicCqiAge",
+                   "Age, in slots, of the DL CQI of a UE after which its next DL data DCI "
+                   "requests an aperiodic CQI report (see the attribute CqiReportPeriodicity "
+                   "of NrUePhy); 0 to never request a report",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrMacSchedulerNs3::SetAperiodicCqiAge,
+                                         &NrMacSchedulerNs3::GetAperiodicCqiAge),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("HarqTimerWheel",
+                   "If true, the HARQ processes expire through timer wheels, indexed by "
+                   "the slot of expiry and filled at each (re)transmission, so that the "
+                   "cost of the expiry at each slot does not grow with the number of UEs; "
+                   "otherwise, the processes of all the UEs are scanned at every slot. "
+                   "The processes expire in the same slots either way",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrMacSchedulerNs3::SetHarqTimerWheel,
+                                        &NrMacSchedulerNs3::IsHarqTimerWheel),
+                   MakeBooleanChecker ())
+    .AddTraceSource ("PhaseTimes",
+                     "Nanoseconds spent in each phase of ScheduleDl and ScheduleUl, at "
+                     "every slot. Fired only if the module is built with "
+                     "NR_SCHEDULER_PHASE_TIMING, from the thread that runs the scheduler",
+                     MakeTraceSourceAccessor (&NrMacSchedulerNs3::m_phaseTimesTrace),
+                     "ns3::NrMacSchedulerNs3::PhaseTimesTracedCallback")
+    .AddTraceSource ("SlotLoad",
+                     "RBG x symbols assigned to data, and RBG x symbols available "
+                     "(not used by CTRL or SRS), of every slot scheduled",
+                     MakeTraceSourceAccessor (&NrMacSchedulerNs3::m_slotLoadTrace),
+                     "ns3::NrMacSchedulerNs3::SlotLoadTracedCallback")
+    .AddTraceSource ("DlWbCqi",
+                     "DL wide-band CQI received from the UEs",
+                     MakeTraceSourceAccessor (&NrMacSchedulerNs3::m_dlWbCqiTrace),
+                     "ns3::NrMacSchedulerNs3::DlWbCqiTracedCallback")
   ;
 
   return tid;
@@ -328,42 +457,28 @@ NrMacSchedulerNs3::SetUlCtrlSyms (uint8_t v)
 }
 
 void
-NrMacSchedulerNs3::SetDlNotchedRbgMask (const std::vector<uint8_t> &dlNotchedRbgsMask)
+NrMacSchedulerNs3::SetDlNotchedRbgMask (const NrBitset &dlNotchedRbgsMask)
 {
   NS_LOG_FUNCTION (this);
   m_dlNotchedRbgsMask = dlNotchedRbgsMask;
-  std::stringstream ss;
-
-  //print the DL mask set (prefix + is added just for printing purposes)
-  for (const auto & x : m_dlNotchedRbgsMask)
-    {
-      ss << +x << " ";
-    }
-  NS_LOG_INFO ("Set DL notched mask: " << ss.str ());
+  NS_LOG_INFO ("Set DL notched mask: " << m_dlNotchedRbgsMask);
 }
 
-std::vector<uint8_t>
+const NrBitset &
 NrMacSchedulerNs3::GetDlNotchedRbgMask (void) const
 {
-  return m_dlNotchedRbgsMask;
+  return m_icic != nullptr ? m_dlIcicRbgsMask : m_dlNotchedRbgsMask;
 }
 
 void
-NrMacSchedulerNs3::SetUlNotchedRbgMask (const std::vector<uint8_t> &ulNotchedRbgsMask)
+NrMacSchedulerNs3::SetUlNotchedRbgMask (const NrBitset &ulNotchedRbgsMask)
 {
   NS_LOG_FUNCTION (this);
   m_ulNotchedRbgsMask = ulNotchedRbgsMask;
-  std::stringstream ss;
-
-  //print the UL mask set (prefix + is added just for printing purposes)
-  for (const auto & x : m_ulNotchedRbgsMask)
-    {
-      ss << +x << " ";
-    }
-  NS_LOG_INFO ("Set UL notched mask: " << ss.str ());
+  NS_LOG_INFO ("Set UL notched mask: " << m_ulNotchedRbgsMask);
 }
 
-std::vector<uint8_t>
+const NrBitset &
 NrMacSchedulerNs3::GetUlNotchedRbgMask (void) const
 {
   return m_ulNotchedRbgsMask;
@@ -381,6 +496,25 @@ NrMacSchedulerNs3::GetSrsCtrlSyms () const
   return m_srsCtrlSymbols;
 }
 
+void
+NrMacSchedulerNs3::SetSrsAlgorithm (const TypeId &type)
+{
+  NS_LOG_FUNCTION (this << type);
+  NS_ABORT_MSG_UNLESS (type == NrMacSchedulerSrsDefault::GetTypeId ()
+                       || type.IsChildOf (NrMacSchedulerSrsDefault::GetTypeId ()),
+                       "The SRS algorithm must be a NrMacSchedulerSrsDefault");
+  NS_ABORT_MSG_IF (!m_ueMap.empty (), "The SRS algorithm cannot be changed once UEs are added");
+  ObjectFactory factory;
+  factory.SetTypeId (type);
+  m_schedulerSrs = factory.Create<NrMacSchedulerSrsDefault> ();
+}
+
+TypeId
+NrMacSchedulerNs3::GetSrsAlgorithm () const
+{
+  return m_schedulerSrs->GetInstanceTypeId ();
+}
+
 void
 NrMacSchedulerNs3::SetSrsInUlSlots (bool v)
 {
@@ -418,6 +552,358 @@ NrMacSchedulerNs3::IsHarqReTxEnable () const
   return m_enableHarqReTx;
 }
 
+void
+NrMacSchedulerNs3::SetHarqRetxDeadline (uint8_t slots)
+{
+  NS_LOG_FUNCTION (this << static_cast<uint32_t> (slots));
+  m_harqRetxDeadline = slots;
+  if (slots == 0)
+    {
+      InstallHarqScheduler (std::unique_ptr<NrMacSchedulerHarqRr> (new NrMacSchedulerHarqRr ()));
+    }
+  else
+    {
+      InstallHarqScheduler (std::unique_ptr<NrMacSchedulerHarqRr> (new NrMacSchedulerHarqDeadline (slots)));
+    }
+}
+
+uint8_t
+NrMacSchedulerNs3::GetHarqRetxDeadline () const
+{
+  return m_harqRetxDeadline;
+}
+
+void
+NrMacSchedulerNs3::SetProactiveUlGrant (bool v)
+{
+  m_proactiveUlGrant = v;
+}
+
+bool
+NrMacSchedulerNs3::IsProactiveUlGrant () const
+{
+  return m_proactiveUlGrant;
+}
+
+void
+NrMacSchedulerNs3::SetProactiveUlWindow (const Time &v)
+{
+  m_proactiveUlWindow = v;
+}
+
+Time
+NrMacSchedulerNs3::GetProactiveUlWindow () const
+{
+  return m_proactiveUlWindow;
+}
+
+void
+NrMacSchedulerNs3::SetBsrAverageWeight (double v)
+{
+  m_bsrAverageWeight = v;
+}
+
+double
+NrMacSchedulerNs3::GetBsrAverageWeight () const
+{
+  return m_bsrAverageWeight;
+}
+
+void
+NrMacSchedulerNs3::SetMiniSlotSymbols (uint8_t v)
+{
+  NS_ABORT_MSG_UNLESS (v == 0 || v == 2 || v == 4 || v == 7,
+                       "A mini-slot has 2, 4 or 7 symbols, not " << +v);
+  m_miniSlotSymbols = v;
+}
+
+uint8_t
+NrMacSchedulerNs3::GetMiniSlotSymbols () const
+{
+  return m_miniSlotSymbols;
+}
+
+void
+NrMacSchedulerNs3::SetMiniSlotDelayBudget (const Time &v)
+{
+  m_miniSlotDelayBudget = v;
+}
+
+Time
+NrMacSchedulerNs3::GetMiniSlotDelayBudget () const
+{
+  return m_miniSlotDelayBudget;
+}
+
+void
+NrMacSchedulerNs3::SetOllaTargetBler (double v)
+{
+  m_ollaTargetBler = v;
+  m_cqiManagement.ConfigureOlla (m_ollaTargetBler, m_ollaStepDown, m_ollaMaxOffset);
+}
+
+double
+NrMacSchedulerNs3::GetOllaTargetBler () const
+{
+  return m_ollaTargetBler;
+}
+
+void
+NrMacSchedulerNs3::SetOllaStepDown (double v)
+{
+  m_ollaStepDown = v;
+  m_cqiManagement.ConfigureOlla (m_ollaTargetBler, m_ollaStepDown, m_ollaMaxOffset);
+}
+
+double
+NrMacSchedulerNs3::GetOllaStepDown () const
+{
+  return m_ollaStepDown;
+}
+
+void
+NrMacSchedulerNs3::SetOllaMaxOffset (double v)
+{
+  m_ollaMaxOffset = v;
+  m_cqiManagement.ConfigureOlla (m_ollaTargetBler, m_ollaStepDown, m_ollaMaxOffset);
+}
+
+double
+NrMacSchedulerNs3::GetOllaMaxOffset () const
+{
+  return m_ollaMaxOffset;
+}
+
+void
+NrMacSchedulerNs3::SetAperiodicCqiAge (uint32_t v)
+{
+  m_aperiodicCqiAge = v;
+}
+
+uint32_t
+NrMacSchedulerNs3::GetAperiodicCqiAge () const
+{
+  return m_aperiodicCqiAge;
+}
+
+void
+NrMacSchedulerNs3::SetHarqTimerWheel (bool v)
+{
+  m_harqTimerWheel = v;
+}
+
+bool
+NrMacSchedulerNs3::IsHarqTimerWheel () const
+{
+  return m_harqTimerWheel;
+}
+
+void
+NrMacSchedulerNs3::ConfigureDlSps (uint16_t rnti, uint16_t periodicity, uint8_t numSym, uint16_t offset)
+{
+  NS_LOG_FUNCTION (this << rnti << periodicity << +numSym << offset);
+  if (periodicity == 0 || numSym == 0)
+    {
+      m_dlSps.erase (rnti);
+      return;
+    }
+  m_dlSps[rnti] = PeriodicGrant {periodicity, static_cast<uint16_t> (offset % periodicity), numSym};
+}
+
+void
+NrMacSchedulerNs3::ConfigureUlConfiguredGrant (uint16_t rnti, uint16_t periodicity, uint8_t numSym,
+                                               uint16_t offset)
+{
+  NS_LOG_FUNCTION (this << rnti << periodicity << +numSym << offset);
+  if (periodicity == 0 || numSym == 0)
+    {
+      m_ulCg.erase (rnti);
+      return;
+    }
+  m_ulCg[rnti] = PeriodicGrant {periodicity, static_cast<uint16_t> (offset % periodicity), numSym};
+}
+
+/**
+ * \brief Replace the HARQ scheduler
+ * \param schedHarq the HARQ scheduler, to which the functions to retrieve
+ * the bandwidth, the bwp id and the cell id are installed
+ */
+void
+NrMacSchedulerNs3::InstallHarqScheduler (std::unique_ptr<NrMacSchedulerHarqRr> schedHarq)
+{
+  m_schedHarq = std::move (schedHarq);
+  m_schedHarq->InstallGetBwInRBG (std::bind (&NrMacSchedulerNs3::GetBandwidthInRbg, this));
+  m_schedHarq->InstallGetBwpIdFn (std::bind (&NrMacSchedulerNs3::GetBwpId, this));
+  m_schedHarq->InstallGetCellIdFn (std::bind (&NrMacSchedulerNs3::GetCellId, this));
+}
+
+const NrMacSchedulerPhaseHistogram &
+NrMacSchedulerNs3::GetPhaseHistogram (bool isDl, NrMacSchedulerPhaseTimes::Phase phase) const
+{
+  return m_phaseHistograms.at (isDl ? 1 : 0).at (phase);
+}
+
+uint64_t
+NrMacSchedulerNs3::GetUeMemoryUsage () const
+{
+  uint64_t bytes = m_ueVector.capacity () * sizeof (std::shared_ptr<NrMacSchedulerUeInfo>)
+    + m_ueMap.bucket_count () * sizeof (void *);
+  for (const auto & ue : m_ueVector)
+    {
+      bytes += ue->GetMemoryUsage () + sizeof (std::pair<const uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> >) + sizeof (void *);
+    }
+  return bytes;
+}
+
+uint32_t
+NrMacSchedulerNs3::GetNumberOfUes () const
+{
+  return static_cast<uint32_t> (m_ueVector.size ());
+}
+
+uint64_t
+NrMacSchedulerNs3::GetBufferedBytes (bool isDl) const
+{
+  uint64_t bytes = 0;
+  for (const auto & ue : m_ueVector)
+    {
+      for (const auto & lcg : isDl ? ue->m_dlLCG : ue->m_ulLCG)
+        {
+          bytes += lcg.second->GetTotalSize ();
+        }
+    }
+  return bytes;
+}
+
+void
+NrMacSchedulerNs3::ReportPhaseTimes ([[maybe_unused]] const SfnSf &sfnSf, [[maybe_unused]] bool isDl)
+{
+  if constexpr (NR_SCHEDULER_PHASE_TIMING != 0)
+    {
+      auto & histograms = m_phaseHistograms.at (isDl ? 1 : 0);
+      for (uint32_t phase = 0; phase < NrMacSchedulerPhaseTimes::NUM_PHASES; ++phase)
+        {
+          histograms.at (phase).Add (m_phaseTimes.m_ns.at (phase));
+        }
+      m_phaseTimesTrace (sfnSf, isDl, m_phaseTimes);
+    }
+}
+
+void
+NrMacSchedulerNs3::AllocateDlPower (SlotAllocInfo *allocInfo) const
+{
+  NS_LOG_FUNCTION (this);
+
+  // The DL DATA DCIs sent together, in one TX PSD: same starting symbol
+  // and MU-MIMO layer
+  std::map<std::pair<uint8_t, uint8_t>, std::vector<DciInfoElementTdma *> > transmissions;
+  for (auto &allocation : allocInfo->m_varTtiAllocInfo)
+    {
+      DciInfoElementTdma *dci = allocation.m_dci.get ();
+      if (dci->m_type == DciInfoElementTdma::DATA && dci->m_format == DciInfoElementTdma::DL)
+        {
+          transmissions[std::make_pair (dci->m_symStart, dci->m_layer)].push_back (dci);
+        }
+    }
+
+  std::vector<NrDlPowerAllocator::RbgInfo> rbgs;
+  std::vector<float> power;
+  for (const auto &transmission : transmissions)
+    {
+      // The SINR of an RBG is the one of the MCS chosen from the CQI, per
+      // RBG with a sub-band CQI
+      rbgs.clear ();
+      for (const DciInfoElementTdma *dci : transmission.second)
+        {
+          auto itUe = m_ueMap.find (dci->m_rnti);
+          NS_ASSERT (itUe != m_ueMap.end ());
+          const auto &ue = itUe->second;
+          uint8_t wbCqi = ue->m_dlCqi.m_wbCqi.empty () ? 0 : ue->m_dlCqi.m_wbCqi[0];
+          const NrBitset &mask = dci->m_rbgBitmask;
+          for (size_t rbg = mask.FindFirst (); rbg < mask.size (); rbg = mask.FindNext (rbg))
+            {
+              uint8_t mcs = rbg < ue->m_dlRbgMcs.size () ? ue->m_dlRbgMcs[rbg] : ue->m_dlMcs[0];
+              double sinr = std::pow (2.0, m_dlAmc->GetSpectralEfficiencyForMcs (mcs)) - 1.0;
+              rbgs.push_back ({dci->m_rnti, sinr, wbCqi});
+            }
+        }
+
+      if (m_dlPowerAllocator != nullptr)
+        {
+          m_dlPowerAllocator->AllocatePower (rbgs, &power);
+        }
+      else
+        {
+          power.assign (rbgs.size (), 1.0f);
+        }
+      NS_ASSERT (power.size () == rbgs.size ());
+
+      size_t i = 0;
+      for (DciInfoElementTdma *dci : transmission.second)
+        {
+          const NrBitset &mask = dci->m_rbgBitmask;
+          dci->m_rbgPower.assign (mask.size (), 1.0f);
+          for (size_t rbg = mask.FindFirst (); rbg < mask.size (); rbg = mask.FindNext (rbg))
+            {
+              dci->m_rbgPower[rbg] = power[i++];
+            }
+        }
+
+      if (m_icic != nullptr)
+        {
+          // The power of the zone of each RBG, within the total power
+          double sum = 0.0;
+          for (DciInfoElementTdma *dci : transmission.second)
+            {
+              const NrBitset &mask = dci->m_rbgBitmask;
+              for (size_t rbg = mask.FindFirst (); rbg < mask.size (); rbg = mask.FindNext (rbg))
+                {
+                  dci->m_rbgPower[rbg] *= m_icic->GetDlRbgPower (static_cast<uint32_t> (rbg));
+                  sum += dci->m_rbgPower[rbg];
+                }
+            }
+          if (sum > power.size ())
+            {
+              float scale = static_cast<float> (power.size () / sum);
+              for (DciInfoElementTdma *dci : transmission.second)
+                {
+                  const NrBitset &mask = dci->m_rbgBitmask;
+                  for (size_t rbg = mask.FindFirst (); rbg < mask.size (); rbg = mask.FindNext (rbg))
+                    {
+                      dci->m_rbgPower[rbg] *= scale;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void
+NrMacSchedulerNs3::ReportSlotLoad (const SlotAllocInfo &allocInfo, bool isDl)
+{
+  const DciInfoElementTdma::DciFormat format = isDl ? DciInfoElementTdma::DL : DciInfoElementTdma::UL;
+  uint32_t usedRbgSym = 0;
+  uint32_t busySym = 0;
+
+  for (const auto &varTti : allocInfo.m_varTtiAllocInfo)
+    {
+      const auto &dci = varTti.m_dci;
+      if (dci->m_type != DciInfoElementTdma::DATA)
+        {
+          busySym += dci->m_numSym;
+        }
+      else if (dci->m_format == format)
+        {
+          usedRbgSym += static_cast<uint32_t> (dci->m_rbgBitmask.count ()) * dci->m_numSym;
+        }
+    }
+
+  uint32_t symbols = m_macSchedSapUser->GetSymbolsPerSlot ();
+  uint32_t availableRbgSym = busySym < symbols ? (symbols - busySym) * GetBandwidthInRbg () : 0;
+
+  m_slotLoadTrace (allocInfo.m_sfnSf, isDl, GetBwpId (), usedRbgSym, availableRbgSym);
+}
+
 
 uint8_t
 NrMacSchedulerNs3::ScheduleDlHarq (PointInFTPlane *startingPoint,
@@ -446,6 +932,18 @@ NrMacSchedulerNs3::ScheduleUlHarq (PointInFTPlane *startingPoint,
                                       ueMap, ulHarqToRetransmit, ulHarqFeedback, slotAlloc);
 }
 
+std::vector<std::vector<BeamConfId> >
+NrMacSchedulerNs3::GetDlBeamGroups (const ActiveUeMap &activeDl) const
+{
+  std::vector<std::vector<BeamConfId> > groups;
+  groups.reserve (activeDl.size ());
+  for (const auto &beam : activeDl)
+    {
+      groups.push_back ({beam.first});
+    }
+  return groups;
+}
+
 void
 NrMacSchedulerNs3::SortDlHarq (NrMacSchedulerNs3::ActiveHarqMap *activeDlHarq) const
 {
@@ -456,7 +954,7 @@ NrMacSchedulerNs3::SortDlHarq (NrMacSchedulerNs3::ActiveHarqMap *activeDlHarq) c
 void NrMacSchedulerNs3::SortUlHarq (NrMacSchedulerNs3::ActiveHarqMap *activeUlHarq) const
 {
   NS_LOG_FUNCTION (this);
-  m_schedHarq->SortDlHarq (activeUlHarq);
+  m_schedHarq->SortUlHarq (activeUlHarq);
 }
 
 uint8_t
@@ -467,9 +965,9 @@ NrMacSchedulerNs3::GetUlCtrlSyms () const
 
 /**
  * \brief Cell configuration
- * \param params unused.
+ * \param params the cell configuration
  *
- * Ignored. Always Success.
+ * Save the bandwidth, in RBG and in RB. Always Success.
  */
 void
 NrMacSchedulerNs3::DoCschedCellConfigReq (const NrMacCschedSapProvider::CschedCellConfigReqParameters& params)
@@ -479,6 +977,12 @@ NrMacSchedulerNs3::DoCschedCellConfigReq (const NrMacCschedSapProvider::CschedCe
   NS_ASSERT (params.m_ulBandwidth == params.m_dlBandwidth);
   m_bandwidth = params.m_dlBandwidth;
 
+  // The scheduler may run on a worker of NrSchedulingWorkerPool, where the
+  // SpectrumModel, shared by the cells, must not be touched: read the
+  // number of RB here, on the main thread
+  Ptr<const SpectrumModel> model = m_macSchedSapUser->GetSpectrumModel ();
+  m_numRbs = model != nullptr ? model->GetNumBands () : 0;
+
   NrMacCschedSapUser::CschedUeConfigCnfParameters cnf;
   cnf.m_result = SUCCESS;
   m_macCschedSapUser->CschedUeConfigCnf (cnf);
@@ -505,6 +1009,7 @@ NrMacSchedulerNs3::DoCschedUeConfigReq (const NrMacCschedSapProvider::CschedUeCo
   if (itUe == m_ueMap.end ())
     {
       itUe = m_ueMap.insert (std::make_pair (params.m_rnti, CreateUeRepresentation (params))).first;
+      m_ueVector.push_back (UeInfoOf (*itUe));
 
       UeInfoOf (*itUe)->m_dlHarq.SetMaxSize (static_cast<uint8_t> (m_macSchedSapUser->GetNumHarqProcess ()));
       UeInfoOf (*itUe)->m_ulHarq.SetMaxSize (static_cast<uint8_t> (m_macSchedSapUser->GetNumHarqProcess ()));
@@ -553,7 +1058,10 @@ NrMacSchedulerNs3::DoCschedUeReleaseReq (const NrMacCschedSapProvider::CschedUeR
   NS_ABORT_IF (itUe == m_ueMap.end ());
 
   m_schedulerSrs->RemoveUe (itUe->second->m_srsOffset);
+  m_ueVector.erase (std::find (m_ueVector.begin (), m_ueVector.end (), itUe->second));
   m_ueMap.erase (itUe);
+  m_dlSps.erase (params.m_rnti);
+  m_ulCg.erase (params.m_rnti);
 
   // When it will be the case of reducing the periodicity? Question for the
   // future...
@@ -742,10 +1250,12 @@ NrMacSchedulerNs3::BSRReceivedFromUe (const MacCeElement &bsr)
 
   // The UE only notifies the buf size as sum of all components.
   // see nr-ue-mac.cc:395
+  uint32_t totalSize = 0;
   for (uint8_t lcg = 0; lcg < 4; ++lcg)
     {
       uint8_t bsrId = bsr.m_macCeValue.m_bufferStatus.at (lcg);
       uint32_t bufSize = NrMacShortBsrCe::FromLevelToBytes (bsrId);
+      totalSize += bufSize;
 
       auto itLcg = UeInfoOf (*itUe)->m_ulLCG.find (lcg);
       if (itLcg == UeInfoOf (*itUe)->m_ulLCG.end ())
@@ -763,6 +1273,14 @@ NrMacSchedulerNs3::BSRReceivedFromUe (const MacCeElement &bsr)
 
       itLcg->second->UpdateInfo (bufSize);
     }
+
+  if (totalSize > 0)
+    {
+      const auto &ue = itUe->second;
+      ue->m_ulBsrAverage = ue->m_lastUlBsr == Time::Min () ? totalSize
+        : (1.0 - m_bsrAverageWeight) * ue->m_ulBsrAverage + m_bsrAverageWeight * totalSize;
+      ue->m_lastUlBsr = Simulator::Now ();
+    }
 }
 
 /**
@@ -823,10 +1341,14 @@ NrMacSchedulerNs3::DoSchedDlCqiInfoReq (const NrMacSchedSapProvider::SchedDlCqiI
       if (cqi.m_cqiType == DlCqiInfo::WB)
         {
           m_cqiManagement.DlWBCQIReported (cqi, ue, expirationTime, m_maxDlMcs);
+          if (! cqi.m_wbCqi.empty ())
+            {
+              m_dlWbCqiTrace (GetBwpId (), cqi.m_rnti, cqi.m_wbCqi.at (0));
+            }
         }
       else
         {
-          m_cqiManagement.DlSBCQIReported (cqi, ue);
+          m_cqiManagement.DlSBCQIReported (cqi, ue, expirationTime, m_maxDlMcs);
         }
     }
 }
@@ -891,7 +1413,7 @@ NrMacSchedulerNs3::DoSchedUlCqiInfoReq (const NrMacSchedSapProvider::SchedUlCqiI
                                                  params, UeInfoOf (*itUe),
                                                  allocation.m_rbgMask,
                                                  m_macSchedSapUser->GetNumRbPerRbg (),
-                                                 m_macSchedSapUser->GetSpectrumModel ());
+                                                 m_numRbs);
                 found = true;
                 it = ulAllocations.erase (it);
               }
@@ -944,9 +1466,9 @@ std::vector<T> NrMacSchedulerNs3::MergeHARQ (std::vector<T> *existingFeedbacks,
                              inFeedbacks.end ());
   NS_ASSERT (existingFeedbacks->size () == existingSize + inSize);
 
-  auto ret = std::vector<T> (std::make_move_iterator (existingFeedbacks->begin ()),
-                             std::make_move_iterator (existingFeedbacks->end ()));
-  existingFeedbacks->clear ();
+  // Take the storage of the merged feedbacks, instead of moving them one by one
+  std::vector<T> ret;
+  ret.swap (*existingFeedbacks);
 
   return ret;
 }
@@ -955,6 +1477,8 @@ std::vector<T> NrMacSchedulerNs3::MergeHARQ (std::vector<T> *existingFeedbacks,
  * \brief Process HARQ feedbacks
  * \param harqInfo all the known HARQ feedbacks (can be UL or DL)
  * \param GetHarqVectorFn Function to retrieve the correct Harq Vector
+ * \param ollaFn Method of the CQI management that takes the feedback of the
+ * first transmissions, for the OLLA
  * \param direction "UL" or "DL" for debug messages
  *
  * For every received feedback (even the already processed ones) the method
@@ -962,7 +1486,8 @@ std::vector<T> NrMacSchedulerNs3::MergeHARQ (std::vector<T> *existingFeedbacks,
  * HarqInfo::IsReceivedOk) the feedback is eliminated and the corresponding
  * HARQ process erased; if the feedback is NACK, the corresponding process
  * is marked for retransmission. The decision to retransmit or not the process
- * will be taken later.
+ * will be taken later. The feedback of a first transmission, received for
+ * the first time, is also passed to ollaFn.
  *
  * \see DlHarqInfo
  * \see UlHarqInfo
@@ -972,6 +1497,7 @@ template<typename T>
 void
 NrMacSchedulerNs3::ProcessHARQFeedbacks (std::vector<T> *harqInfo,
                                              const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVectorFn,
+                                             OllaFeedbackFn ollaFn,
                                              const std::string &direction) const
 {
   NS_LOG_FUNCTION (this);
@@ -993,13 +1519,17 @@ NrMacSchedulerNs3::ProcessHARQFeedbacks (std::vector<T> *harqInfo,
         }
       NS_ABORT_IF (ueProcess.m_dciElement == nullptr);
 
-      std::vector<uint8_t>::const_iterator rvIt;
-      rvIt = std::max_element (ueProcess.m_dciElement->m_rv.begin(), ueProcess.m_dciElement->m_rv.end());
+      auto rvIt = std::max_element (ueProcess.m_dciElement->m_rv.begin(), ueProcess.m_dciElement->m_rv.end());
       //RV number should not be greater than 3. An unscheduled stream should
       //be assigned RV = 0 in MIMO.
       NS_ASSERT (*rvIt < 4);
       uint8_t maxHarqReTx = m_enableHarqReTx == true ? 3 : 0;
 
+      if (*rvIt == 0 && ueProcess.m_status == HarqProcess::WAITING_FEEDBACK)
+        {
+          (m_cqiManagement.*ollaFn) (m_ueMap.find (rnti)->second, harqFeedbackIt->IsReceivedOk ());
+        }
+
       if (harqFeedbackIt->IsReceivedOk () || *rvIt == maxHarqReTx)
         {
           ueHarqVector.Erase (harqId);
@@ -1065,24 +1595,131 @@ NrMacSchedulerNs3::ResetExpiredHARQ (uint16_t rnti, NrMacHarqVector *harq)
 }
 
 /**
- * \brief Prepend a CTRL symbol to the allocation list
- * \param symStart starting symbol
- * \param numSymToAllocate number of symbols to allocate (each CTRL take 1 symbol)
- * \param mode Mode of the allocation (UL, DL)
- * \param allocations list of allocations to which prepend the CTRL symbol
- * \return the symbol that can be used to append other things into the allocation list
+ * \brief Move a HARQ timer wheel to the next slot, and reset the processes that expire in it
+ * \param wheel the timer wheel
+ * \param GetHarqVectorFn function that returns the HARQ vector of the direction of the wheel
+ * \param direction "DL" or "UL", for the logs
+ *
+ * A process armed in slot s expires in slot s + GetNumHarqProcess () + 1, as
+ * with ResetExpiredHARQ. The entries of a process that has been erased, or
+ * retransmitted (and so armed again) after them, are stale, and ignored.
  */
-uint8_t
-NrMacSchedulerNs3::PrependCtrlSym (uint8_t symStart, uint8_t numSymToAllocate,
-                                       DciInfoElementTdma::DciFormat mode,
-                                       std::deque<VarTtiAllocInfo> *allocations) const
+void
+NrMacSchedulerNs3::AdvanceHarqTimerWheel (HarqTimerWheel *wheel,
+                                          const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVectorFn,
+                                          const std::string &direction)
 {
-  std::vector<uint8_t> rbgBitmask (GetBandwidthInRbg (), 1);
+  NS_LOG_FUNCTION (this);
 
-  NS_ASSERT_MSG (rbgBitmask.size () == GetBandwidthInRbg (),
-                 "bitmask size " << rbgBitmask.size () << " conf " <<
-                 GetBandwidthInRbg ());
-  if (mode == DciInfoElementTdma::DL)
+  if (wheel->m_buckets.empty ())
+    {
+      wheel->m_buckets.resize (m_macSchedSapUser->GetNumHarqProcess () + 2U);
+    }
+
+  ++wheel->m_slot;
+  auto & bucket = wheel->m_buckets.at (wheel->m_slot % wheel->m_buckets.size ());
+  for (const auto & entry : bucket)
+    {
+      auto itUe = m_ueMap.find (entry.m_rnti);
+      if (itUe == m_ueMap.end ())
+        {
+          continue;
+        }
+      NrMacHarqVector & harq = GetHarqVectorFn (itUe->second);
+      HarqProcess & process = harq.Get (entry.m_processId);
+      if (process.m_status != HarqProcess::INACTIVE && process.m_timerStart == entry.m_start)
+        {
+          harq.Erase (entry.m_processId);
+          NS_LOG_INFO ("Erased " << direction << " process for UE " << entry.m_rnti <<
+                       " number " << static_cast<uint32_t> (entry.m_processId) <<
+                       " for time limits");
+        }
+    }
+  bucket.clear ();
+}
+
+/**
+ * \brief Arm the timers of the HARQ processes (re)transmitted in a slot
+ * \param wheel the timer wheel
+ * \param slotAlloc the allocation of the slot
+ * \param format the direction of the wheel: the data DCI of the other are skipped
+ * \param GetHarqVectorFn function that returns the HARQ vector of the direction of the wheel
+ *
+ * Every data DCI of the allocation is a new transmission or a retransmission,
+ * both of which restart the timer of their process.
+ */
+void
+NrMacSchedulerNs3::ArmHarqTimerWheel (HarqTimerWheel *wheel, const SlotAllocInfo &slotAlloc,
+                                      DciInfoElementTdma::DciFormat format,
+                                      const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVectorFn)
+{
+  NS_LOG_FUNCTION (this);
+
+  const uint64_t expiry = wheel->m_slot + m_macSchedSapUser->GetNumHarqProcess () + 1U;
+  auto & bucket = wheel->m_buckets.at (expiry % wheel->m_buckets.size ());
+  for (const auto & varTti : slotAlloc.m_varTtiAllocInfo)
+    {
+      const auto & dci = varTti.m_dci;
+      if (dci->m_type != DciInfoElementTdma::DATA || dci->m_format != format)
+        {
+          continue;
+        }
+      auto itUe = m_ueMap.find (dci->m_rnti);
+      NS_ASSERT (itUe != m_ueMap.end ());
+      HarqProcess & process = GetHarqVectorFn (itUe->second).Get (dci->m_harqProcess);
+      if (process.m_status == HarqProcess::INACTIVE)
+        {
+          continue;
+        }
+      process.m_timerStart = wheel->m_slot;
+      bucket.push_back ({dci->m_rnti, dci->m_harqProcess, wheel->m_slot});
+    }
+}
+
+/**
+ * \brief Set the timer of the processes of the feedbacks, with the HARQ timer wheel
+ * \param wheel the timer wheel
+ * \param feedbacks the feedbacks, all of active processes
+ * \param GetHarqVectorFn function that returns the HARQ vector of the direction of the wheel
+ *
+ * With the wheel, the timers are not incremented at every slot: the ones that
+ * the HARQ scheduler reads (those of the processes with a feedback) are computed
+ * from the slot of the last (re)transmission.
+ */
+template<typename T>
+void
+NrMacSchedulerNs3::RefreshHarqTimers (const HarqTimerWheel &wheel, const std::vector<T> &feedbacks,
+                                      const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVectorFn)
+{
+  NS_LOG_FUNCTION (this);
+
+  const uint64_t maxTimer = m_macSchedSapUser->GetNumHarqProcess ();
+  for (const auto & feedback : feedbacks)
+    {
+      HarqProcess & process = GetHarqVectorFn (m_ueMap.find (feedback.m_rnti)->second).Get (feedback.m_harqProcessId);
+      process.m_timer = static_cast<uint8_t> (std::min (wheel.m_slot - process.m_timerStart, maxTimer));
+    }
+}
+
+/**
+ * \brief Prepend a CTRL symbol to the allocation list
+ * \param symStart starting symbol
+ * \param numSymToAllocate number of symbols to allocate (each CTRL take 1 symbol)
+ * \param mode Mode of the allocation (UL, DL)
+ * \param allocations list of allocations to which prepend the CTRL symbol
+ * \return the symbol that can be used to append other things into the allocation list
+ */
+uint8_t
+NrMacSchedulerNs3::PrependCtrlSym (uint8_t symStart, uint8_t numSymToAllocate,
+                                       DciInfoElementTdma::DciFormat mode,
+                                       std::deque<VarTtiAllocInfo> *allocations) const
+{
+  NrBitset rbgBitmask (GetBandwidthInRbg (), true);
+
+  NS_ASSERT_MSG (rbgBitmask.size () == GetBandwidthInRbg (),
+                 "bitmask size " << rbgBitmask.size () << " conf " <<
+                 GetBandwidthInRbg ());
+  if (mode == DciInfoElementTdma::DL)
     {
       NS_ASSERT (allocations->size () == 0); // no previous allocations
       NS_ASSERT (symStart == 0); // start from the symbol 0
@@ -1090,7 +1727,7 @@ NrMacSchedulerNs3::PrependCtrlSym (uint8_t symStart, uint8_t numSymToAllocate,
 
   for (uint8_t sym = symStart; sym < symStart + numSymToAllocate; ++sym)
     {
-      allocations->emplace_front (VarTtiAllocInfo (std::make_shared<DciInfoElementTdma> (sym, 1, mode, DciInfoElementTdma::CTRL, rbgBitmask)));
+      allocations->emplace_front (VarTtiAllocInfo (DciInfoElementTdma::Create (sym, 1, mode, DciInfoElementTdma::CTRL, rbgBitmask)));
       NS_LOG_INFO ("Allocating CTRL symbol, type" << mode <<
                    " in TDMA. numSym=1, symStart=" <<
                    static_cast<uint32_t> (sym) <<
@@ -1112,7 +1749,7 @@ NrMacSchedulerNs3::AppendCtrlSym (uint8_t symStart, uint8_t numSymToAllocate,
                                       DciInfoElementTdma::DciFormat mode,
                                       std::deque<VarTtiAllocInfo> *allocations) const
 {
-  std::vector<uint8_t> rbgBitmask (GetBandwidthInRbg (), 1);
+  NrBitset rbgBitmask (GetBandwidthInRbg (), true);
 
   NS_ASSERT (rbgBitmask.size () == GetBandwidthInRbg ());
   if (mode == DciInfoElementTdma::DL)
@@ -1123,7 +1760,7 @@ NrMacSchedulerNs3::AppendCtrlSym (uint8_t symStart, uint8_t numSymToAllocate,
 
   for (uint8_t sym = symStart; sym < symStart + numSymToAllocate; ++sym)
     {
-      allocations->emplace_back (VarTtiAllocInfo (std::make_shared<DciInfoElementTdma> (sym, 1, mode, DciInfoElementTdma::CTRL, rbgBitmask)));
+      allocations->emplace_back (VarTtiAllocInfo (DciInfoElementTdma::Create (sym, 1, mode, DciInfoElementTdma::CTRL, rbgBitmask)));
       NS_LOG_INFO ("Allocating CTRL symbol, type" << mode <<
                    " in TDMA. numSym=1, symStart=" <<
                    static_cast<uint32_t> (sym) <<
@@ -1231,13 +1868,13 @@ void
 NrMacSchedulerNs3::ComputeActiveUe (ActiveUeMap *activeUe,
                                         const NrMacSchedulerUeInfo::GetLCGFn &GetLCGFn,
                                         const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVector,
-                                        const std::string &mode) const
+                                        const std::string &mode)
 {
   NS_LOG_FUNCTION (this);
-  for (const auto &ueInfo : m_ueMap)
+  NS_ASSERT (activeUe->empty ());
+  for (const auto &ue : m_ueVector)
     {
       uint32_t totBuffer = 0;
-      const auto & ue = ueInfo.second;
 
       // compute total DL and UL bytes buffered
       for (const auto & lcgInfo : GetLCGFn (ue))
@@ -1252,30 +1889,52 @@ NrMacSchedulerNs3::ComputeActiveUe (ActiveUeMap *activeUe,
           totBuffer += lcg->GetTotalSize ();
         }
 
-      auto harqV = GetHarqVector (ue);
+      const NrMacHarqVector &harqV = GetHarqVector (ue);
 
       if (totBuffer > 0 && harqV.CanInsert ())
         {
           auto it = activeUe->find (ue->m_beamConfId);
-          if (it == activeUe->end ())
+          if (it == activeUe->end () && m_activeUeNodes.empty ())
             {
-              std::vector<std::pair<std::shared_ptr<NrMacSchedulerUeInfo>, uint32_t> > tmp;
-              tmp.emplace_back (ue, totBuffer);
-              activeUe->insert (std::make_pair (ue->m_beamConfId, tmp));
+              it = activeUe->emplace (ue->m_beamConfId, std::vector<UePtrAndBufferReq> ()).first;
             }
-          else
+          else if (it == activeUe->end ())
             {
-              it->second.emplace_back (ue, totBuffer);
+              // Reuse an entry of a previous slot, and the memory of its vector
+              ActiveUeMap::node_type node = std::move (m_activeUeNodes.back ());
+              m_activeUeNodes.pop_back ();
+              node.key () = ue->m_beamConfId;
+              it = activeUe->insert (std::move (node)).position;
             }
+          it->second.emplace_back (ue, totBuffer);
         }
     }
 }
 
+/**
+ * \brief Empty a map of active UE, once the slot is scheduled
+ * \param activeUe the map to empty
+ *
+ * The entries are kept in m_activeUeNodes, with the memory of their
+ * vector, so that ComputeActiveUe does not allocate memory once the
+ * number of beams and of UE per beam has been reached.
+ */
+void
+NrMacSchedulerNs3::ClearActiveUe (ActiveUeMap *activeUe)
+{
+  while (!activeUe->empty ())
+    {
+      ActiveUeMap::node_type node = activeUe->extract (activeUe->begin ());
+      node.mapped ().clear ();
+      m_activeUeNodes.push_back (std::move (node));
+    }
+}
+
 /**
  * \brief Method to decide how to distribute the assigned bytes to the different LCs
  * \param ueLCG LCG of an UE
  * \param tbs TBS to divide between the LCG/LC
- * \return A vector of Assignation
+ * \param assignations the Assignation of each LC with data (cleared and filled)
  *
  * The method distribute bytes evenly between LCG. This is a default;
  * more advanced methods can be inserted. Please note that the correct way
@@ -1285,59 +1944,159 @@ NrMacSchedulerNs3::ComputeActiveUe (ActiveUeMap *activeUe,
  *
  * Please don't try to insert if/switch statements here, NOR to make it virtual
  * and to change in the subclasses.
+ *
+ * The output is owned by the caller, that reuses it for every DCI; the
+ * assignations are written in one pass over the active LC of each LCG, and
+ * then get their bytes.
  */
 // Assume LC are unique
-std::vector<NrMacSchedulerNs3::Assignation>
+void
 NrMacSchedulerNs3::AssignBytesToLC (const std::unordered_map<uint8_t, LCGPtr> &ueLCG,
-                                        uint32_t tbs) const
+                                    uint32_t tbs, std::vector<Assignation> *assignations) const
 {
   NS_LOG_FUNCTION (this);
   GetFirst GetLCGID;
   GetSecond GetLCG;
 
-  std::vector<Assignation> ret;
+  assignations->clear ();
 
   NS_LOG_INFO ("To distribute: " << tbs << " bytes over " << ueLCG.size () << " LCG");
 
-  uint32_t activeLc = 0;
+  // Most UEs have a single LC with data: it takes the whole TBS
+  if (ueLCG.size () == 1)
+    {
+      const auto & lcg = *ueLCG.begin ();
+      const auto & activeLcId = GetLCG (lcg)->GetActiveLCId ();
+      if (activeLcId.size () == 1)
+        {
+          NS_LOG_INFO ("Assigned to LCID " << static_cast<uint32_t> (activeLcId.front ()) <<
+                       " inside LCG " << static_cast<uint32_t> (GetLCGID (lcg)) <<
+                       " an amount of " << tbs << " B");
+          assignations->emplace_back (Assignation (GetLCGID (lcg), activeLcId.front (), tbs));
+          return;
+        }
+    }
+
+  // Only the LC with data are visited
   for (const auto & lcg : ueLCG)
     {
-      std::vector<uint8_t> lcs = GetLCG (lcg)->GetLCId ();
-      for (const auto & lcId : lcs)
+      for (const auto & lcId : GetLCG (lcg)->GetActiveLCId ())
         {
-          if (GetLCG (lcg)->GetTotalSizeOfLC (lcId) > 0)
-            {
-              ++activeLc;
-            }
+          assignations->emplace_back (Assignation (GetLCGID (lcg), lcId, 0));
         }
     }
 
-  if (activeLc == 0)
+  if (assignations->empty ())
     {
-      return ret;
+      return;
     }
 
-  uint32_t amountPerLC = tbs / activeLc;
-  NS_LOG_INFO ("Total LC: " << activeLc << " each one will receive " << amountPerLC << " bytes");
+  uint32_t amountPerLC = tbs / static_cast<uint32_t> (assignations->size ());
+  NS_LOG_INFO ("Total LC: " << assignations->size () << " each one will receive " << amountPerLC << " bytes");
 
-  for (const auto & lcg : ueLCG)
+  for (auto & assignation : *assignations)
+    {
+      NS_LOG_INFO ("Assigned to LCID " << static_cast<uint32_t> (assignation.m_lcId) <<
+                   " inside LCG " << static_cast<uint32_t> (assignation.m_lcg) <<
+                   " an amount of " << amountPerLC << " B");
+      assignation.m_bytes = amountPerLC;
+    }
+}
+
+
+/**
+ * \brief Register a new DL data DCI: HARQ process, bytes of the LC, RLC PDUs
+ * \param ue the UE of the DCI
+ * \param dci the DCI
+ * \param slotAlloc the allocation of the slot, to which the DCI is appended
+ */
+void
+NrMacSchedulerNs3::CommitDlDataDci (const std::shared_ptr<NrMacSchedulerUeInfo> &ue,
+                                    const std::shared_ptr<DciInfoElementTdma> &dci,
+                                    SlotAllocInfo *slotAlloc) const
+{
+  NS_LOG_FUNCTION (this);
+  HarqProcess harqProcess (true, HarqProcess::WAITING_FEEDBACK, 0, dci);
+  uint8_t id;
+
+  if (!ue->m_dlHarq.CanInsert ())
+    {
+      NS_LOG_INFO ("Harq Vector condition for UE " << ue->m_rnti <<
+                   std::endl << ue->m_dlHarq);
+      NS_FATAL_ERROR ("UE " << ue->m_rnti << " does not have DL HARQ space");
+    }
+
+  ue->m_dlHarq.Insert (&id, harqProcess);
+  ue->m_dlHarq.Get (id).m_dciElement->m_harqProcess = id;
+  dci->m_cqiRequest = m_aperiodicCqiAge > 0 && m_cqiManagement.RequestDlCqi (ue, m_aperiodicCqiAge);
+
+  //distribute tbsize of each stream among the LCs of the UE: the LC
+  //are the same, in the same order, for all the streams
+  if (m_assignationsPerStream.size () < dci->m_tbSize.size ())
+    {
+      m_assignationsPerStream.resize (dci->m_tbSize.size ());
+    }
+  for (uint32_t stream = 0; stream < dci->m_tbSize.size (); stream++)
+    {
+      AssignBytesToLC (ue->m_dlLCG, dci->m_tbSize.at (stream),
+                       &m_assignationsPerStream.at (stream));
+    }
+
+  VarTtiAllocInfo slotInfo (dci);
+
+  NS_LOG_INFO ("Assigned process ID " << static_cast<uint32_t> (dci->m_harqProcess) <<
+               " to UE " << ue->m_rnti);
+  for (uint32_t stream = 0; stream < dci->m_tbSize.size (); stream++)
     {
-      std::vector<uint8_t> lcs = GetLCG (lcg)->GetLCId ();
-      for (const auto & lcId : lcs)
+      NS_LOG_DEBUG (" UE" << dci->m_rnti << " stream " << stream <<
+                    " gets DL symbols " << static_cast<uint32_t> (dci->m_symStart) <<
+                    "-" << static_cast<uint32_t> (dci->m_symStart + dci->m_numSym) <<
+                    " tbs " << dci->m_tbSize.at (stream) <<
+                    " mcs " << static_cast<uint32_t> (dci->m_mcs.at (stream)) <<
+                    " harqId " << static_cast<uint32_t> (id) <<
+                    " rv " << static_cast<uint32_t> (dci->m_rv.at (stream))
+                    );
+    }
+
+  const uint32_t numLc = static_cast<uint32_t> (m_assignationsPerStream.at (0).size ());
+  for (uint32_t lc = 0; lc < numLc; lc++)
+    {
+      std::vector<RlcPduInfo> rlcPdusInfoPerStream;
+      rlcPdusInfoPerStream.reserve (dci->m_tbSize.size ());
+      for (uint32_t stream = 0; stream < dci->m_tbSize.size (); stream++)
         {
-          if (GetLCG (lcg)->GetTotalSizeOfLC (lcId) > 0)
+          const Assignation & bytesPerStream = m_assignationsPerStream.at (stream).at (lc);
+          if (bytesPerStream.m_bytes != 0)
+            {
+              NS_ASSERT (bytesPerStream.m_bytes >= 3);
+              uint8_t lcId = bytesPerStream.m_lcId;
+              uint8_t lcgId = bytesPerStream.m_lcg;
+              uint32_t bytes = bytesPerStream.m_bytes - 3; // Consider the subPdu overhead
+              RlcPduInfo newRlcPdu (lcId, bytes);
+              rlcPdusInfoPerStream.push_back (newRlcPdu);
+              ue->m_dlLCG.at (lcgId)->AssignedData (lcId, bytes, "DL");
+
+              NS_LOG_DEBUG ("DL LCG " << static_cast<uint32_t> (lcgId) <<
+                            " LCID " << static_cast<uint32_t> (lcId) <<
+                            " got bytes " << newRlcPdu.m_size);
+            }
+          else
             {
-              NS_LOG_INFO ("Assigned to LCID " << static_cast<uint32_t> (lcId) <<
-                           " inside LCG " << static_cast<uint32_t> (GetLCGID (lcg)) <<
-                           " an amount of " << amountPerLC << " B");
-              ret.emplace_back (Assignation (GetLCGID (lcg), lcId, amountPerLC));
+              uint8_t lcId = bytesPerStream.m_lcId;
+              RlcPduInfo newRlcPdu (lcId, 0);
+              rlcPdusInfoPerStream.push_back (newRlcPdu);
             }
         }
+      //insert rlcPduInforPerStream of a LC
+      slotInfo.m_rlcPduInfo.push_back (rlcPdusInfoPerStream);
+      HarqProcess & process = ue->m_dlHarq.Get (dci->m_harqProcess);
+      process.m_rlcPduInfo.push_back (std::move (rlcPdusInfoPerStream));
     }
 
-  return ret;
-}
+  NS_ABORT_IF (slotInfo.m_rlcPduInfo.size () == 0);
 
+  slotAlloc->m_varTtiAllocInfo.emplace_back (slotInfo);
+}
 
 /**
  * \brief Scheduling new DL data
@@ -1377,191 +2136,109 @@ NrMacSchedulerNs3::DoScheduleDlData (PointInFTPlane *spoint, uint32_t symAvail,
 {
   NS_LOG_FUNCTION (this << symAvail);
   NS_ASSERT (spoint->m_rbg == 0);
-  BeamSymbolMap symPerBeam = AssignDLRBG (symAvail, activeDl);
+  BeamSymbolMap symPerBeam;
+  {
+    NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::ASSIGN_RBG);
+    symPerBeam = AssignDLRBG (symAvail, activeDl);
+  }
   GetFirst GetBeam;
   uint8_t usedSym = 0;
 
-  for (const auto &beam : activeDl)
+  for (const auto &group : GetDlBeamGroups (activeDl))
     {
-      uint32_t availableRBG = (GetBandwidthInRbg () - spoint->m_rbg) * symPerBeam.at (GetBeam (beam));
-      bool assigned = false;
-      std::unordered_set <uint8_t> symbStartDci;
-      //allocSym is used to count the number of allocated symbols to the UEs of the beam
-      //we are iterating over
-      uint32_t allocSym = 0;
-
-      NS_LOG_DEBUG (activeDl.size () << " active DL beam, this beam has " <<
-                    symPerBeam.at (GetBeam (beam)) << " SYM, starts from RB " << static_cast<uint32_t> (spoint->m_rbg) <<
-                    " and symbol " << static_cast<uint32_t> (spoint->m_sym) << " for a total of " <<
-                    availableRBG << " RBG. In one symbol we have " << GetBandwidthInRbg () <<
-                    " RBG.");
-
-      if (symPerBeam.at (GetBeam (beam)) == 0)
-        {
-          NS_LOG_INFO ("No available symbols for this beam, continue");
-          continue;
-        }
+      // The beams of a group (MU-MIMO layers) start from the same point
+      const PointInFTPlane groupStart = *spoint;
+      uint32_t groupSym = 0;
+      uint32_t groupAllocSym = 0;
+      bool groupAssigned = false;
 
-      for (const auto &ue : beam.second)
+      for (uint8_t layer = 0; layer < group.size (); ++layer)
         {
-          if (ue.first->m_dlRBG == 0)
-            {
-              NS_LOG_INFO ("UE " << ue.first->m_rnti << " does not have RBG assigned");
-              continue;
-            }
-
-          std::shared_ptr<DciInfoElementTdma> dci = CreateDlDci (spoint, ue.first,
-                                                                 symPerBeam.at (GetBeam (beam)));
-          if (dci == nullptr)
-            {
-              //By continuing to the next UE means that we are
-              //wasting a resource assign to this UE. For a TDMA
-              //scheduler this resource would be one or more
-              //symbols, and for OFDMA scheduler it would be a
-              //chunk of time + freq, i.e., one or more
-              //symbols in time and one ore more RBG in freq.
-              //TODO To avoid this, a more accurate solution
-              //is needed to assign resources. That is, a solution
-              //that would not assign resources to a UE if the assigned resources
-              //result a TB size of less than 7 bytes (3 mac header, 2 rlc header, 2 data).
-              //Because if this happens CreateDlDci will not create DCI.
-              NS_LOG_DEBUG ("No DCI has been created, ignoring");
-              ue.first->ResetDlMetric ();
-              continue;
-            }
-
-          assigned = true;
-
-          if (symbStartDci.insert (dci->m_symStart).second)
+          const auto &beam = *activeDl.find (group.at (layer));
+          if (layer > 0)
             {
-              allocSym += dci->m_numSym;
+              *spoint = groupStart;
             }
 
-          NS_LOG_INFO ("UE " << ue.first->m_rnti << " has " << ue.first->m_dlRBG <<
-                       " RBG assigned");
-          NS_ASSERT_MSG (dci->m_symStart + dci->m_numSym <= m_macSchedSapUser->GetSymbolsPerSlot (),
-                         "symStart: " << static_cast<uint32_t> (dci->m_symStart) << " symEnd: " <<
-                         static_cast<uint32_t> (dci->m_numSym) << " symbols: " <<
-                         static_cast<uint32_t> (m_macSchedSapUser->GetSymbolsPerSlot ()));
+          uint32_t availableRBG = (GetBandwidthInRbg () - spoint->m_rbg) * symPerBeam.at (GetBeam (beam));
+          bool assigned = false;
+          std::unordered_set <uint8_t> symbStartDci;
+          //allocSym is used to count the number of allocated symbols to the UEs of the beam
+          //we are iterating over
+          uint32_t allocSym = 0;
 
-          HarqProcess harqProcess (true, HarqProcess::WAITING_FEEDBACK, 0, dci);
-          uint8_t id;
+          NS_LOG_DEBUG (activeDl.size () << " active DL beam, this beam has " <<
+                        symPerBeam.at (GetBeam (beam)) << " SYM, starts from RB " << static_cast<uint32_t> (spoint->m_rbg) <<
+                        " and symbol " << static_cast<uint32_t> (spoint->m_sym) << " for a total of " <<
+                        availableRBG << " RBG. In one symbol we have " << GetBandwidthInRbg () <<
+                        " RBG.");
 
-          if (!ue.first->m_dlHarq.CanInsert ())
+          if (symPerBeam.at (GetBeam (beam)) == 0)
             {
-              NS_LOG_INFO ("Harq Vector condition for UE " << ue.first->m_rnti <<
-                           std::endl << ue.first->m_dlHarq);
-              NS_FATAL_ERROR ("UE " << ue.first->m_rnti << " does not have DL HARQ space");
+              NS_LOG_INFO ("No available symbols for this beam, continue");
+              continue;
             }
 
-          ue.first->m_dlHarq.Insert (&id, harqProcess);
-          ue.first->m_dlHarq.Get (id).m_dciElement->m_harqProcess = id;
-
-
-          std::vector <std::vector<Assignation> > bytesPerLcPerStream;
-
-          for (const auto &it:dci->m_tbSize)
+          for (const auto &ue : beam.second)
             {
-              //distribute tbsize of each stream among the LCs of the UE
-              //distributedBytes size is equal to the number of LCs
-              auto distributedBytes = AssignBytesToLC (ue.first->m_dlLCG, it);
-              if (bytesPerLcPerStream.size () == 0)
+              if (ue.first->m_dlRBG == 0)
                 {
-                  bytesPerLcPerStream.resize (distributedBytes.size ());
+                  NS_LOG_INFO ("UE " << ue.first->m_rnti << " does not have RBG assigned");
+                  continue;
                 }
-              for (uint16_t numLc = 0; numLc < distributedBytes.size (); numLc++)
+
+              std::shared_ptr<DciInfoElementTdma> dci;
+              {
+                NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::CREATE_DCI);
+                dci = CreateDlDci (spoint, ue.first, symPerBeam.at (GetBeam (beam)));
+              }
+              if (dci == nullptr)
                 {
-                  bytesPerLcPerStream.at (numLc).emplace_back (Assignation (distributedBytes.at (numLc).m_lcg,
-                                                                            distributedBytes.at (numLc).m_lcId,
-                                                                            distributedBytes.at (numLc).m_bytes));
+                  //By continuing to the next UE means that we are
+                  //wasting a resource assign to this UE. For a TDMA
+                  //scheduler this resource would be one or more
+                  //symbols, and for OFDMA scheduler it would be a
+                  //chunk of time + freq, i.e., one or more
+                  //symbols in time and one ore more RBG in freq.
+                  //TODO To avoid this, a more accurate solution
+                  //is needed to assign resources. That is, a solution
+                  //that would not assign resources to a UE if the assigned resources
+                  //result a TB size of less than 7 bytes (3 mac header, 2 rlc header, 2 data).
+                  //Because if this happens CreateDlDci will not create DCI.
+                  NS_LOG_DEBUG ("No DCI has been created, ignoring");
+                  ue.first->ResetDlMetric ();
+                  continue;
                 }
-            }
-
-
-    //      auto distributedBytes = AssignBytesToLC (ue.first->m_dlLCG, dci->m_tbSize);
 
-          VarTtiAllocInfo slotInfo (dci);
-
-          NS_LOG_INFO ("Assigned process ID " << static_cast<uint32_t> (dci->m_harqProcess) <<
-                       " to UE " << ue.first->m_rnti);
-          for (uint32_t stream = 0; stream < dci->m_tbSize.size (); stream++)
-            {
-              NS_LOG_DEBUG (" UE" << dci->m_rnti << " stream " << stream <<
-                            " gets DL symbols " << static_cast<uint32_t> (dci->m_symStart) <<
-                            "-" << static_cast<uint32_t> (dci->m_symStart + dci->m_numSym) <<
-                            " tbs " << dci->m_tbSize.at (stream) <<
-                            " mcs " << static_cast<uint32_t> (dci->m_mcs.at (stream)) <<
-                            " harqId " << static_cast<uint32_t> (id) <<
-                            " rv " << static_cast<uint32_t> (dci->m_rv.at (stream))
-                            );
-            }
+              assigned = true;
+              dci->m_layer = layer;
 
-
-
-          for (const auto & bytesPerLc : bytesPerLcPerStream)
-            {
-              //bytesPerLc is a vector
-              std::vector<RlcPduInfo> rlcPdusInfoPerStream;
-              for (const auto & bytesPerStream : bytesPerLc)
+              if (symbStartDci.insert (dci->m_symStart).second)
                 {
-                  if (bytesPerStream.m_bytes != 0)
-                    {
-                      NS_ASSERT (bytesPerStream.m_bytes >= 3);
-                      uint8_t lcId = bytesPerStream.m_lcId;
-                      uint8_t lcgId = bytesPerStream.m_lcg;
-                      uint32_t bytes = bytesPerStream.m_bytes - 3; // Consider the subPdu overhead
-                      RlcPduInfo newRlcPdu (lcId, bytes);
-                      rlcPdusInfoPerStream.push_back (newRlcPdu);
-                      ue.first->m_dlLCG.at (lcgId)->AssignedData (lcId, bytes, "DL");
-
-                      NS_LOG_DEBUG ("DL LCG " << static_cast<uint32_t> (lcgId) <<
-                                    " LCID " << static_cast<uint32_t> (lcId) <<
-                                    " got bytes " << newRlcPdu.m_size);
-                    }
-                  else
-                    {
-                      uint8_t lcId = bytesPerStream.m_lcId;
-                      RlcPduInfo newRlcPdu (lcId, 0);
-                      rlcPdusInfoPerStream.push_back (newRlcPdu);
-                    }
+                  allocSym += dci->m_numSym;
                 }
-              //insert rlcPduInforPerStream of a LC
-              slotInfo.m_rlcPduInfo.push_back (rlcPdusInfoPerStream);
-              HarqProcess & process = ue.first->m_dlHarq.Get (dci->m_harqProcess);
-              process.m_rlcPduInfo.push_back (rlcPdusInfoPerStream);
-            }
 
+              NS_LOG_INFO ("UE " << ue.first->m_rnti << " has " << ue.first->m_dlRBG <<
+                           " RBG assigned");
+              NS_ASSERT_MSG (dci->m_symStart + dci->m_numSym <= m_macSchedSapUser->GetSymbolsPerSlot (),
+                             "symStart: " << static_cast<uint32_t> (dci->m_symStart) << " symEnd: " <<
+                             static_cast<uint32_t> (dci->m_numSym) << " symbols: " <<
+                             static_cast<uint32_t> (m_macSchedSapUser->GetSymbolsPerSlot ()));
 
-/*
-          for (const auto & byteDistribution : distributedBytes)
+              CommitDlDataDci (ue.first, dci, slotAlloc);
+            }
+          if (assigned)
             {
-              NS_ASSERT (byteDistribution.m_bytes >= 3);
-              uint8_t lcId = byteDistribution.m_lcId;
-              uint8_t lcgId = byteDistribution.m_lcg;
-              uint32_t bytes = byteDistribution.m_bytes - 3; // Consider the subPdu overhead
-
-              RlcPduInfo newRlcPdu (lcId, bytes);
-              HarqProcess & process = ue.first->m_dlHarq.Get (dci->m_harqProcess);
-
-              slotInfo.m_rlcPduInfo.push_back (newRlcPdu);
-              process.m_rlcPduInfo.push_back (newRlcPdu);
-
-              ue.first->m_dlLCG.at (lcgId)->AssignedData (lcId, bytes);
-
-              NS_LOG_DEBUG ("DL LCG " << static_cast<uint32_t> (lcgId) <<
-                            " LCID " << static_cast<uint32_t> (lcId) <<
-                            " got bytes " << newRlcPdu.m_size);
-            }*/
-
-          NS_ABORT_IF (slotInfo.m_rlcPduInfo.size () == 0);
-
-          slotAlloc->m_varTtiAllocInfo.emplace_back (slotInfo);
+              groupAssigned = true;
+              groupSym = std::max (groupSym, symPerBeam.at (GetBeam (beam)));
+              groupAllocSym = std::max (groupAllocSym, allocSym);
+            }
         }
-      if (assigned)
+      if (groupAssigned)
         {
-          ChangeDlBeam (spoint, symPerBeam.at (GetBeam (beam)));
-          usedSym += allocSym;
-          slotAlloc->m_numSymAlloc += allocSym;
+          ChangeDlBeam (spoint, groupSym);
+          usedSym += groupAllocSym;
+          slotAlloc->m_numSymAlloc += groupAllocSym;
         }
     }
 
@@ -1578,6 +2255,67 @@ NrMacSchedulerNs3::DoScheduleDlData (PointInFTPlane *spoint, uint32_t symAvail,
   return usedSym;
 }
 
+/**
+ * \brief Register a new UL data DCI: HARQ process and bytes of the LC
+ * \param ue the UE of the DCI
+ * \param dci the DCI
+ * \param slotAlloc the allocation of the slot, to which the DCI is prepended
+ * \return true if some bytes of the TB have been assigned to the LC of the UE
+ */
+bool
+NrMacSchedulerNs3::CommitUlDataDci (const std::shared_ptr<NrMacSchedulerUeInfo> &ue,
+                                    const std::shared_ptr<DciInfoElementTdma> &dci,
+                                    SlotAllocInfo *slotAlloc) const
+{
+  NS_LOG_FUNCTION (this);
+  if (!ue->m_ulHarq.CanInsert ())
+    {
+      NS_LOG_INFO ("Harq Vector condition for UE " << ue->m_rnti <<
+                   std::endl << ue->m_ulHarq);
+      NS_FATAL_ERROR ("UE " << ue->m_rnti << " does not have UL HARQ space");
+    }
+
+  HarqProcess harqProcess (true, HarqProcess::WAITING_FEEDBACK, 0, dci);
+  uint8_t id;
+  ue->m_ulHarq.Insert (&id, harqProcess);
+
+  ue->m_ulHarq.Get (id).m_dciElement->m_harqProcess = id;
+
+  VarTtiAllocInfo slotInfo (dci);
+
+  NS_LOG_INFO ("Assigned process ID " << static_cast<uint32_t> (dci->m_harqProcess) <<
+               " to UE " << ue->m_rnti);
+  for (uint32_t stream = 0; stream < dci->m_tbSize.size (); stream++)
+    {
+      NS_LOG_DEBUG (" UE" << dci->m_rnti <<
+                    " gets UL symbols " << static_cast<uint32_t> (dci->m_symStart) <<
+                    "-" << static_cast<uint32_t> (dci->m_symStart + dci->m_numSym) <<
+                    " tbs " << dci->m_tbSize.at (stream) <<
+                    " mcs " << static_cast<uint32_t> (dci->m_mcs.at (stream)) <<
+                    " harqId " << static_cast<uint32_t> (id) <<
+                    " rv " << static_cast<uint32_t> (dci->m_rv.at (stream))
+                    );
+    }
+
+  if (m_assignationsPerStream.empty ())
+    {
+      m_assignationsPerStream.resize (1);
+    }
+  auto & distributedBytes = m_assignationsPerStream.at (0);
+  AssignBytesToLC (ue->m_ulLCG, dci->m_tbSize.at (0), &distributedBytes);
+  bool assignedToLC = false;
+  for (const auto & byteDistribution : distributedBytes)
+    {
+      assignedToLC = true;
+      ue->m_ulLCG.at (byteDistribution.m_lcg)->AssignedData (byteDistribution.m_lcId, byteDistribution.m_bytes, "UL");
+      NS_LOG_DEBUG ("UL LCG " << static_cast<uint32_t> (byteDistribution.m_lcg) <<
+                    " assigned bytes " << byteDistribution.m_bytes << " to LCID " <<
+                    static_cast<uint32_t> (byteDistribution.m_lcId));
+    }
+  slotAlloc->m_varTtiAllocInfo.emplace_front (slotInfo);
+  return assignedToLC;
+}
+
 /**
  * \brief Scheduling new UL data
  * \param spoint Starting point of the blocks to add to the allocation list
@@ -1621,7 +2359,11 @@ NrMacSchedulerNs3::DoScheduleUlData (PointInFTPlane *spoint, uint32_t symAvail,
   NS_ASSERT (symAvail > 0 && activeUl.size () > 0);
   NS_ASSERT (spoint->m_rbg == 0);
 
-  BeamSymbolMap symPerBeam = AssignULRBG (symAvail, activeUl);
+  BeamSymbolMap symPerBeam;
+  {
+    NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::ASSIGN_RBG);
+    symPerBeam = AssignULRBG (symAvail, activeUl);
+  }
   uint8_t usedSym = 0;
   GetFirst GetBeam;
 
@@ -1656,7 +2398,11 @@ NrMacSchedulerNs3::DoScheduleUlData (PointInFTPlane *spoint, uint32_t symAvail,
               continue;
             }
 
-          std::shared_ptr<DciInfoElementTdma> dci = CreateUlDci (spoint, ue.first, symPerBeam.at (GetBeam (beam)));
+          std::shared_ptr<DciInfoElementTdma> dci;
+          {
+            NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::CREATE_DCI);
+            dci = CreateUlDci (spoint, ue.first, symPerBeam.at (GetBeam (beam)));
+          }
 
           if (dci == nullptr)
             {
@@ -1683,48 +2429,8 @@ NrMacSchedulerNs3::DoScheduleUlData (PointInFTPlane *spoint, uint32_t symAvail,
               allocSym += dci->m_numSym;
             }
 
-          if (!ue.first->m_ulHarq.CanInsert ())
-            {
-              NS_LOG_INFO ("Harq Vector condition for UE " << ue.first->m_rnti <<
-                           std::endl << ue.first->m_ulHarq);
-              NS_FATAL_ERROR ("UE " << ue.first->m_rnti << " does not have UL HARQ space");
-            }
-
-          HarqProcess harqProcess (true, HarqProcess::WAITING_FEEDBACK, 0, dci);
-          uint8_t id;
-          ue.first->m_ulHarq.Insert (&id, harqProcess);
-
-          ue.first->m_ulHarq.Get (id).m_dciElement->m_harqProcess = id;
-
-          VarTtiAllocInfo slotInfo (dci);
-
-          NS_LOG_INFO ("Assigned process ID " << static_cast<uint32_t> (dci->m_harqProcess) <<
-                       " to UE " << ue.first->m_rnti);
-          for (uint32_t stream = 0; stream < dci->m_tbSize.size (); stream++)
-            {
-              NS_LOG_DEBUG (" UE" << dci->m_rnti <<
-                            " gets UL symbols " << static_cast<uint32_t> (dci->m_symStart) <<
-                            "-" << static_cast<uint32_t> (dci->m_symStart + dci->m_numSym) <<
-                            " tbs " << dci->m_tbSize.at (stream) <<
-                            " mcs " << static_cast<uint32_t> (dci->m_mcs.at (stream)) <<
-                            " harqId " << static_cast<uint32_t> (id) <<
-                            " rv " << static_cast<uint32_t> (dci->m_rv.at (stream))
-                            );
-            }
-
-
-          auto distributedBytes = AssignBytesToLC (ue.first->m_ulLCG, dci->m_tbSize.at (0));
-          bool assignedToLC = false;
-          for (const auto & byteDistribution : distributedBytes)
-            {
-              assignedToLC = true;
-              ue.first->m_ulLCG.at (byteDistribution.m_lcg)->AssignedData (byteDistribution.m_lcId, byteDistribution.m_bytes, "UL");
-              NS_LOG_DEBUG ("UL LCG " << static_cast<uint32_t> (byteDistribution.m_lcg) <<
-                            " assigned bytes " << byteDistribution.m_bytes << " to LCID " <<
-                            static_cast<uint32_t> (byteDistribution.m_lcId));
-            }
+          [[maybe_unused]] bool assignedToLC = CommitUlDataDci (ue.first, dci, slotAlloc);
           NS_ASSERT (assignedToLC);
-          slotAlloc->m_varTtiAllocInfo.emplace_front (slotInfo);
         }
       if (assigned)
         {
@@ -1766,14 +2472,399 @@ NrMacSchedulerNs3::DoScheduleUlSr (PointInFTPlane *spoint, const std::list<uint1
 
   for (const auto & v : rntiList)
     {
-      for (auto & ulLcg : NrMacSchedulerUeInfo::GetUlLCG (m_ueMap.at (v)))
+      const auto &ue = m_ueMap.at (v);
+      uint32_t bytes = 12;
+      if (m_proactiveUlGrant && ! ue->m_ulLCG.empty ())
+        {
+          // The average of the past BSRs, split among the LCG
+          bytes = std::max (bytes, static_cast<uint32_t> (ue->m_ulBsrAverage / ue->m_ulLCG.size ()));
+        }
+      for (auto & ulLcg : NrMacSchedulerUeInfo::GetUlLCG (ue))
+        {
+          NS_LOG_DEBUG ("Assigning " << bytes << " bytes to UE " << v << " because of a SR");
+          ulLcg.second->UpdateInfo (bytes);
+        }
+    }
+}
+
+/**
+ * \brief Give a minimal UL grant to the recently active UEs
+ *
+ * Each UE that sent a non-empty BSR in the last ProactiveUlWindow, and that
+ * has no UL data known by the scheduler nor UL HARQ process in flight, gets
+ * the same 12 bytes of a SR, without waiting for it: new data that arrived
+ * at the UE can be sent (with its BSR) without the SR round trip.
+ */
+void
+NrMacSchedulerNs3::DoScheduleUlProactive () const
+{
+  NS_LOG_FUNCTION (this);
+  const Time now = Simulator::Now ();
+
+  for (const auto & ue : m_ueVector)
+    {
+      if (ue->m_lastUlBsr == Time::Min () || ue->m_lastUlBsr + m_proactiveUlWindow < now ||
+          ue->m_ulHarq.Size () > 0)
+        {
+          continue;
+        }
+      bool hasData = false;
+      for (const auto & ulLcg : ue->m_ulLCG)
+        {
+          hasData = hasData || ulLcg.second->GetTotalSize () > 0;
+        }
+      if (hasData)
         {
-          NS_LOG_DEBUG ("Assigning 12 bytes to UE " << v << " because of a SR");
+          continue;
+        }
+      for (auto & ulLcg : ue->m_ulLCG)
+        {
+          NS_LOG_DEBUG ("Assigning 12 bytes to the recently active UE " << ue->m_rnti);
           ulLcg.second->UpdateInfo (12);
         }
     }
 }
 
+/**
+ * \brief Schedule the DL SPS occasions of the slot
+ * \param spoint Starting point for allocation
+ * \param symAvail Number of available symbols
+ * \param sfnSf the slot
+ * \param allocInfo the allocation of the slot
+ * \return the number of symbols used
+ *
+ * Each UE that has an occasion in the slot, DL data and no retransmission
+ * already scheduled gets the configured symbols over all the RBG, at its
+ * current MCS, before the scheduling of new data. There is no sorting nor
+ * RBG assignment for these UEs, which are then excluded from the new data.
+ */
+uint8_t
+NrMacSchedulerNs3::ScheduleDlSps (PointInFTPlane *spoint, uint32_t symAvail,
+                                  const SfnSf &sfnSf, SlotAllocInfo *allocInfo) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (spoint->m_rbg == 0);
+  uint8_t usedSym = 0;
+
+  for (const auto & sps : m_dlSps)
+    {
+      auto itUe = m_ueMap.find (sps.first);
+      if (! sps.second.IsOccasion (sfnSf) || itUe == m_ueMap.end () ||
+          HasAllocation (*allocInfo, sps.first) || ! itUe->second->m_dlHarq.CanInsert ())
+        {
+          continue;
+        }
+      const auto & ue = itUe->second;
+
+      uint32_t dlData = 0;
+      for (const auto & lcg : ue->m_dlLCG)
+        {
+          dlData += lcg.second->GetTotalSize ();
+        }
+      uint8_t numSym = static_cast<uint8_t> (std::min<uint32_t> (sps.second.m_numSym, symAvail - usedSym));
+      if (dlData == 0 || numSym == 0)
+        {
+          continue;
+        }
+
+      const NrBitset &notchedMask = GetDlNotchedRbgMask ();
+      NrBitset rbgMask = notchedMask.size () > 0 ? notchedMask : NrBitset (GetBandwidthInRbg (), true);
+      ue->m_dlRBG = numSym * static_cast<uint32_t> (rbgMask.count ());
+      ue->UpdateDlMetric (m_dlAmc);
+
+      StreamVector<uint8_t> ndi (ue->m_dlTbSize.size (), 0);
+      StreamVector<uint8_t> rv (ue->m_dlTbSize.size (), 0);
+      bool validTb = false;
+      for (uint32_t stream = 0; stream < ue->m_dlTbSize.size (); ++stream)
+        {
+          if (ue->m_dlTbSize.at (stream) < 10)
+            {
+              ue->m_dlTbSize.at (stream) = 0;
+              continue;
+            }
+          ndi.at (stream) = 1;
+          validTb = true;
+        }
+      if (! validTb)
+        {
+          NS_LOG_DEBUG ("SPS occasion of UE " << ue->m_rnti << " too small, TBS < 10");
+          ue->ResetDlSchedInfo ();
+          continue;
+        }
+
+      auto dci = DciInfoElementTdma::Create (ue->m_rnti, DciInfoElementTdma::DL, spoint->m_sym,
+                                             numSym, ue->m_dlMcs, ue->m_dlTbSize, ndi, rv,
+                                             DciInfoElementTdma::DATA, GetBwpId (), GetTpc ());
+      dci->m_rbgBitmask = rbgMask;
+      ue->ResetDlSchedInfo ();
+
+      NS_LOG_INFO ("SPS occasion of UE " << ue->m_rnti << " in " << sfnSf << ": " <<
+                   +numSym << " symbols from " << +spoint->m_sym);
+      CommitDlDataDci (ue, dci, allocInfo);
+
+      spoint->m_sym += numSym;
+      usedSym += numSym;
+      allocInfo->m_numSymAlloc += numSym;
+    }
+
+  return usedSym;
+}
+
+/**
+ * \brief Schedule the UL configured grant occasions of the slot
+ * \param spoint Starting point for allocation (going backward)
+ * \param symAvail Number of available symbols
+ * \param sfnSf the slot
+ * \param allocInfo the allocation of the slot
+ * \return the number of symbols used
+ *
+ * Each UE that has an occasion in the slot and no retransmission already
+ * scheduled gets the configured symbols over all the RBG, at its current
+ * MCS, also if the scheduler does not know of any data of the UE: the data
+ * arrived after the last BSR is sent without waiting for an SR and a BSR.
+ * The bytes reported by the BSR are consumed as for a dynamic grant.
+ */
+uint8_t
+NrMacSchedulerNs3::ScheduleUlConfiguredGrant (PointInFTPlane *spoint, uint32_t symAvail,
+                                              const SfnSf &sfnSf, SlotAllocInfo *allocInfo) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (spoint->m_rbg == 0);
+  uint8_t usedSym = 0;
+
+  for (const auto & cg : m_ulCg)
+    {
+      auto itUe = m_ueMap.find (cg.first);
+      if (! cg.second.IsOccasion (sfnSf) || itUe == m_ueMap.end () ||
+          HasAllocation (*allocInfo, cg.first) || ! itUe->second->m_ulHarq.CanInsert ())
+        {
+          continue;
+        }
+      const auto & ue = itUe->second;
+
+      uint8_t numSym = static_cast<uint8_t> (std::min<uint32_t> (cg.second.m_numSym, symAvail - usedSym));
+      if (numSym == 0)
+        {
+          break;
+        }
+
+      const NrBitset &notchedMask = GetUlNotchedRbgMask ();
+      NrBitset rbgMask = notchedMask.size () > 0 ? notchedMask : NrBitset (GetBandwidthInRbg (), true);
+      uint32_t tbs = m_ulAmc->CalculateTbSize (ue->m_ulMcs, numSym * static_cast<uint32_t> (rbgMask.count ()) *
+                                               GetNumRbPerRbg ());
+      // As in CreateUlDci: 7 bytes (3 mac header, 2 rlc header, 2 data) + SHORT_BSR (5)
+      if (tbs < 12)
+        {
+          NS_LOG_DEBUG ("Configured grant occasion of UE " << ue->m_rnti << " too small, TBS " << tbs);
+          continue;
+        }
+
+      NS_ASSERT (spoint->m_sym >= numSym);
+      spoint->m_sym -= numSym;
+
+      //Due to MIMO implementation MCS and TB size are vectors
+      StreamVector<uint8_t> ulMcs = {ue->m_ulMcs};
+      StreamVector<uint32_t> ulTbs = {tbs};
+      StreamVector<uint8_t> ndi = {1};
+      StreamVector<uint8_t> rv = {0};
+      auto dci = DciInfoElementTdma::Create (ue->m_rnti, DciInfoElementTdma::UL, spoint->m_sym,
+                                             numSym, ulMcs, ulTbs, ndi, rv,
+                                             DciInfoElementTdma::DATA, GetBwpId (), GetTpc ());
+      dci->m_rbgBitmask = rbgMask;
+
+      NS_LOG_INFO ("Configured grant occasion of UE " << ue->m_rnti << " in " << sfnSf << ": " <<
+                   +numSym << " symbols from " << +spoint->m_sym);
+      CommitUlDataDci (ue, dci, allocInfo);
+
+      usedSym += numSym;
+      allocInfo->m_numSymAlloc += numSym;
+    }
+
+  return usedSym;
+}
+
+/**
+ * \brief Schedule the DL data of the low latency LC in mini-slots
+ * \param spoint Starting point for allocation
+ * \param symAvail Number of available symbols
+ * \param sfnSf the slot
+ * \param allocInfo the allocation of the slot
+ * \return the number of symbols used
+ *
+ * Each UE with data in the LC whose delay budget is at most
+ * MiniSlotDelayBudget, and no allocation yet in the slot, gets the fewest
+ * whole mini-slots (of MiniSlotSymbols symbols) that carry that data, over
+ * all the RBG and at its current MCS, as long as there are symbols. The
+ * mini-slots are placed one after the other from the start of the data
+ * region, so that the first UEs receive their TB after a few symbols. As for
+ * the SPS, these UEs are then excluded from the new data.
+ */
+uint8_t
+NrMacSchedulerNs3::ScheduleDlMiniSlots (PointInFTPlane *spoint, uint32_t symAvail,
+                                        const SfnSf &sfnSf, SlotAllocInfo *allocInfo) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (spoint->m_rbg == 0);
+  uint8_t usedSym = 0;
+  const NrBitset &notchedMask = GetDlNotchedRbgMask ();
+  NrBitset rbgMask = notchedMask.size () > 0 ? notchedMask : NrBitset (GetBandwidthInRbg (), true);
+
+  for (const auto & ue : m_ueVector)
+    {
+      if (symAvail - usedSym < m_miniSlotSymbols)
+        {
+          break;
+        }
+      uint32_t dlData = 0;
+      for (const auto & lcg : ue->m_dlLCG)
+        {
+          dlData += lcg.second->GetTotalSizeWithin (m_miniSlotDelayBudget);
+        }
+      if (dlData == 0 || HasAllocation (*allocInfo, ue->m_rnti) || ! ue->m_dlHarq.CanInsert ())
+        {
+          continue;
+        }
+
+      // Add mini-slots until the TB carries the data or the slot is full
+      uint8_t numSym = 0;
+      uint32_t tbs = 0;
+      while (tbs < dlData && numSym + m_miniSlotSymbols <= symAvail - usedSym)
+        {
+          numSym += m_miniSlotSymbols;
+          ue->m_dlRBG = numSym * static_cast<uint32_t> (rbgMask.count ());
+          ue->UpdateDlMetric (m_dlAmc);
+          tbs = 0;
+          for (uint32_t tb : ue->m_dlTbSize)
+            {
+              tbs += tb;
+            }
+        }
+
+      StreamVector<uint8_t> ndi (ue->m_dlTbSize.size (), 0);
+      StreamVector<uint8_t> rv (ue->m_dlTbSize.size (), 0);
+      bool validTb = false;
+      for (uint32_t stream = 0; stream < ue->m_dlTbSize.size (); ++stream)
+        {
+          if (ue->m_dlTbSize.at (stream) < 10)
+            {
+              ue->m_dlTbSize.at (stream) = 0;
+              continue;
+            }
+          ndi.at (stream) = 1;
+          validTb = true;
+        }
+      if (! validTb)
+        {
+          NS_LOG_DEBUG ("Mini-slots of UE " << ue->m_rnti << " too small, TBS < 10");
+          ue->ResetDlSchedInfo ();
+          continue;
+        }
+
+      auto dci = DciInfoElementTdma::Create (ue->m_rnti, DciInfoElementTdma::DL, spoint->m_sym,
+                                             numSym, ue->m_dlMcs, ue->m_dlTbSize, ndi, rv,
+                                             DciInfoElementTdma::DATA, GetBwpId (), GetTpc ());
+      dci->m_rbgBitmask = rbgMask;
+      ue->ResetDlSchedInfo ();
+
+      NS_LOG_INFO ("DL mini-slots of UE " << ue->m_rnti << " in " << sfnSf << ": " <<
+                   +numSym << " symbols from " << +spoint->m_sym << " for " << dlData << " bytes");
+      CommitDlDataDci (ue, dci, allocInfo);
+
+      spoint->m_sym += numSym;
+      usedSym += numSym;
+      allocInfo->m_numSymAlloc += numSym;
+    }
+
+  return usedSym;
+}
+
+/**
+ * \brief Schedule the UL data of the low latency LC in mini-slots
+ * \param spoint Starting point for allocation (going backward)
+ * \param symAvail Number of available symbols
+ * \param sfnSf the slot
+ * \param allocInfo the allocation of the slot
+ * \return the number of symbols used
+ *
+ * As ScheduleDlMiniSlots(), with the bytes of the BSR of the low latency LC.
+ * As all the UL allocations, the mini-slots are placed backward from the end
+ * of the slot.
+ */
+uint8_t
+NrMacSchedulerNs3::ScheduleUlMiniSlots (PointInFTPlane *spoint, uint32_t symAvail,
+                                        const SfnSf &sfnSf, SlotAllocInfo *allocInfo) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (spoint->m_rbg == 0);
+  uint8_t usedSym = 0;
+  const NrBitset &notchedMask = GetUlNotchedRbgMask ();
+  NrBitset rbgMask = notchedMask.size () > 0 ? notchedMask : NrBitset (GetBandwidthInRbg (), true);
+  uint32_t rbs = static_cast<uint32_t> (rbgMask.count ()) * GetNumRbPerRbg ();
+
+  for (const auto & ue : m_ueVector)
+    {
+      if (symAvail - usedSym < m_miniSlotSymbols)
+        {
+          break;
+        }
+      uint32_t ulData = 0;
+      for (const auto & lcg : ue->m_ulLCG)
+        {
+          ulData += lcg.second->GetTotalSizeWithin (m_miniSlotDelayBudget);
+        }
+      if (ulData == 0 || HasAllocation (*allocInfo, ue->m_rnti) || ! ue->m_ulHarq.CanInsert ())
+        {
+          continue;
+        }
+
+      uint8_t numSym = 0;
+      uint32_t tbs = 0;
+      while (tbs < ulData && numSym + m_miniSlotSymbols <= symAvail - usedSym)
+        {
+          numSym += m_miniSlotSymbols;
+          tbs = m_ulAmc->CalculateTbSize (ue->m_ulMcs, numSym * rbs);
+        }
+      // As in CreateUlDci: 7 bytes (3 mac header, 2 rlc header, 2 data) + SHORT_BSR (5)
+      if (tbs < 12)
+        {
+          NS_LOG_DEBUG ("Mini-slots of UE " << ue->m_rnti << " too small, TBS " << tbs);
+          continue;
+        }
+
+      NS_ASSERT (spoint->m_sym >= numSym);
+      spoint->m_sym -= numSym;
+
+      //Due to MIMO implementation MCS and TB size are vectors
+      StreamVector<uint8_t> ulMcs = {ue->m_ulMcs};
+      StreamVector<uint32_t> ulTbs = {tbs};
+      StreamVector<uint8_t> ndi = {1};
+      StreamVector<uint8_t> rv = {0};
+      auto dci = DciInfoElementTdma::Create (ue->m_rnti, DciInfoElementTdma::UL, spoint->m_sym,
+                                             numSym, ulMcs, ulTbs, ndi, rv,
+                                             DciInfoElementTdma::DATA, GetBwpId (), GetTpc ());
+      dci->m_rbgBitmask = rbgMask;
+
+      NS_LOG_INFO ("UL mini-slots of UE " << ue->m_rnti << " in " << sfnSf << ": " <<
+                   +numSym << " symbols from " << +spoint->m_sym << " for " << ulData << " bytes");
+      CommitUlDataDci (ue, dci, allocInfo);
+
+      usedSym += numSym;
+      allocInfo->m_numSymAlloc += numSym;
+    }
+
+  return usedSym;
+}
+
+bool
+NrMacSchedulerNs3::HasAllocation (const SlotAllocInfo &allocInfo, uint16_t rnti)
+{
+  return std::any_of (allocInfo.m_varTtiAllocInfo.begin (), allocInfo.m_varTtiAllocInfo.end (),
+                      [rnti] (const VarTtiAllocInfo &alloc)
+                      {
+                        return alloc.m_dci->m_type == DciInfoElementTdma::DATA && alloc.m_dci->m_rnti == rnti;
+                      });
+}
+
 /**
  * \brief Do the process of scheduling for the DL
  * \param params scheduling parameters
@@ -1820,6 +2911,8 @@ NrMacSchedulerNs3::ScheduleDl (const NrMacSchedSapProvider::SchedDlTriggerReqPar
   NS_LOG_FUNCTION (this);
   NS_LOG_INFO ("Scheduling invoked for slot " << params.m_snfSf << " of type " << params.m_slotType);
 
+  m_phaseTimes.Reset ();
+
   NrMacSchedSapUser::SchedConfigIndParameters dlSlot (params.m_snfSf);
   dlSlot.m_slotAllocInfo.m_sfnSf = params.m_snfSf;
   dlSlot.m_slotAllocInfo.m_type = SlotAllocInfo::DL;
@@ -1830,21 +2923,25 @@ NrMacSchedulerNs3::ScheduleDl (const NrMacSchedSapProvider::SchedDlTriggerReqPar
     }
   auto & ulAllocations = ulAllocationIt->second;
 
-  // add slot for DL control, at symbol 0
-  PrependCtrlSym (0, m_dlCtrlSymbols, DciInfoElementTdma::DL,
-                  &dlSlot.m_slotAllocInfo.m_varTtiAllocInfo);
-  dlSlot.m_slotAllocInfo.m_numSymAlloc += m_dlCtrlSymbols;
+  {
+    NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::CTRL_SYM);
 
-  // In case of S slot, add UL CTRL and update the symbol used count
-  if (params.m_slotType == LteNrTddSlotType::S)
-    {
-      NS_LOG_INFO ("S slot, adding UL CTRL");
-      AppendCtrlSym (static_cast<uint8_t> (m_macSchedSapUser->GetSymbolsPerSlot () - 1),
-                     m_ulCtrlSymbols, DciInfoElementTdma::UL,
-                     &dlSlot.m_slotAllocInfo.m_varTtiAllocInfo);
-      ulAllocations.m_totUlSym += m_ulCtrlSymbols;
-      dlSlot.m_slotAllocInfo.m_numSymAlloc += m_ulCtrlSymbols;
-    }
+    // add slot for DL control, at symbol 0
+    PrependCtrlSym (0, m_dlCtrlSymbols, DciInfoElementTdma::DL,
+                    &dlSlot.m_slotAllocInfo.m_varTtiAllocInfo);
+    dlSlot.m_slotAllocInfo.m_numSymAlloc += m_dlCtrlSymbols;
+
+    // In case of S slot, add UL CTRL and update the symbol used count
+    if (params.m_slotType == LteNrTddSlotType::S)
+      {
+        NS_LOG_INFO ("S slot, adding UL CTRL");
+        AppendCtrlSym (static_cast<uint8_t> (m_macSchedSapUser->GetSymbolsPerSlot () - 1),
+                       m_ulCtrlSymbols, DciInfoElementTdma::UL,
+                       &dlSlot.m_slotAllocInfo.m_varTtiAllocInfo);
+        ulAllocations.m_totUlSym += m_ulCtrlSymbols;
+        dlSlot.m_slotAllocInfo.m_numSymAlloc += m_ulCtrlSymbols;
+      }
+  }
 
   // RACH
   for (const auto & rachReq : m_rachList)
@@ -1858,14 +2955,39 @@ NrMacSchedulerNs3::ScheduleDl (const NrMacSchedSapProvider::SchedDlTriggerReqPar
 
   // compute active ue in the current subframe, group them by BeamConfId
   ActiveHarqMap activeDlHarq;
-  ComputeActiveHarq (&activeDlHarq, dlHarqFeedback);
-
-  ActiveUeMap activeDlUe;
-  ComputeActiveUe (&activeDlUe, &NrMacSchedulerUeInfo::GetDlLCG,
-                   &NrMacSchedulerUeInfo::GetDlHarqVector, "DL");
+  {
+    NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::COMPUTE_ACTIVE_HARQ);
+    ComputeActiveHarq (&activeDlHarq, dlHarqFeedback);
+  }
+
+  {
+    NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::COMPUTE_ACTIVE_UE);
+    ComputeActiveUe (&m_activeDlUe, &NrMacSchedulerUeInfo::GetDlLCG,
+                     &NrMacSchedulerUeInfo::GetDlHarqVector, "DL");
+  }
+
+  if (m_icic != nullptr)
+    {
+      m_icic->Configure (GetCellId (), GetBandwidthInRbg ());
+      m_dlIcicRbgsMask = m_icic->GetDlCellMask ();
+      if (m_dlNotchedRbgsMask.size () == m_dlIcicRbgsMask.size ())
+        {
+          m_dlIcicRbgsMask &= m_dlNotchedRbgsMask;
+        }
+    }
 
-  DoScheduleDl (dlHarqFeedback, activeDlHarq, &activeDlUe, params.m_snfSf,
+  DoScheduleDl (dlHarqFeedback, activeDlHarq, &m_activeDlUe, params.m_snfSf,
                 ulAllocations, &dlSlot.m_slotAllocInfo);
+  ClearActiveUe (&m_activeDlUe);
+
+  if (m_dlPowerAllocator != nullptr || m_icic != nullptr)
+    {
+      AllocateDlPower (&dlSlot.m_slotAllocInfo);
+    }
+  if (m_icic != nullptr)
+    {
+      m_icic->NotifyDlSlot (dlSlot.m_slotAllocInfo);
+    }
 
   // if the number of allocated symbols is greater than GetUlCtrlSymbols (), then don't delete
   // the allocation, as it will be removed when the CQI will be processed.
@@ -1879,6 +3001,13 @@ NrMacSchedulerNs3::ScheduleDl (const NrMacSchedSapProvider::SchedDlTriggerReqPar
 
   NS_LOG_INFO ("Total DCI for DL : " << dlSlot.m_slotAllocInfo.m_varTtiAllocInfo.size () <<
                " including DL CTRL");
+  ReportPhaseTimes (params.m_snfSf, true);
+  ReportSlotLoad (dlSlot.m_slotAllocInfo, true);
+  if (m_harqTimerWheel)
+    {
+      ArmHarqTimerWheel (&m_dlHarqWheel, dlSlot.m_slotAllocInfo, DciInfoElementTdma::DL,
+                         NrMacSchedulerUeInfo::GetDlHarqVector);
+    }
   m_macSchedSapUser->SchedConfigInd (dlSlot);
 }
 
@@ -1926,21 +3055,34 @@ NrMacSchedulerNs3::ScheduleUl (const NrMacSchedSapProvider::SchedUlTriggerReqPar
   NS_LOG_FUNCTION (this);
   NS_LOG_INFO ("Scheduling invoked for slot " << params.m_snfSf);
 
+  m_phaseTimes.Reset ();
+
   NrMacSchedSapUser::SchedConfigIndParameters ulSlot (params.m_snfSf);
   ulSlot.m_slotAllocInfo.m_sfnSf = params.m_snfSf;
   ulSlot.m_slotAllocInfo.m_type = SlotAllocInfo::UL;
 
-  // add slot for UL control, at last symbol, for slot type F and UL.
-  AppendCtrlSym (static_cast<uint8_t> (m_macSchedSapUser->GetSymbolsPerSlot () - 1),
-                 m_ulCtrlSymbols, DciInfoElementTdma::UL,
-                 &ulSlot.m_slotAllocInfo.m_varTtiAllocInfo);
-  ulSlot.m_slotAllocInfo.m_numSymAlloc += m_ulCtrlSymbols;
+  {
+    NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::CTRL_SYM);
+
+    // add slot for UL control, at last symbol, for slot type F and UL.
+    AppendCtrlSym (static_cast<uint8_t> (m_macSchedSapUser->GetSymbolsPerSlot () - 1),
+                   m_ulCtrlSymbols, DciInfoElementTdma::UL,
+                   &ulSlot.m_slotAllocInfo.m_varTtiAllocInfo);
+    ulSlot.m_slotAllocInfo.m_numSymAlloc += m_ulCtrlSymbols;
+  }
 
   // Doing UL for slot ulSlot
   DoScheduleUl (ulHarqFeedback, params.m_snfSf, &ulSlot.m_slotAllocInfo, params.m_slotType);
 
   NS_LOG_INFO ("Total DCI for UL : " << ulSlot.m_slotAllocInfo.m_varTtiAllocInfo.size () <<
                " including UL CTRL");
+  ReportPhaseTimes (params.m_snfSf, false);
+  ReportSlotLoad (ulSlot.m_slotAllocInfo, false);
+  if (m_harqTimerWheel)
+    {
+      ArmHarqTimerWheel (&m_ulHarqWheel, ulSlot.m_slotAllocInfo, DciInfoElementTdma::UL,
+                         NrMacSchedulerUeInfo::GetUlHarqVector);
+    }
   m_macSchedSapUser->SchedConfigInd (ulSlot);
 }
 
@@ -1997,7 +3139,10 @@ NrMacSchedulerNs3::DoScheduleUl (const std::vector <UlHarqInfo> &ulHarqFeedback,
     }
 
   ActiveHarqMap activeUlHarq;
-  ComputeActiveHarq (&activeUlHarq, ulHarqFeedback);
+  {
+    NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::COMPUTE_ACTIVE_HARQ);
+    ComputeActiveHarq (&activeUlHarq, ulHarqFeedback);
+  }
 
   // Start the assignation from the last available data symbol, and like a shrimp
   // go backward.
@@ -2024,6 +3169,7 @@ NrMacSchedulerNs3::DoScheduleUl (const std::vector <UlHarqInfo> &ulHarqFeedback,
 
   if (activeUlHarq.size () > 0)
     {
+      NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::SCHEDULE_HARQ);
       uint8_t usedHarq = ScheduleUlHarq (&ulAssignationStartPoint, ulSymAvail,
                                          m_ueMap, &m_ulHarqToRetransmit, ulHarqFeedback,
                                          allocInfo);
@@ -2034,6 +3180,22 @@ NrMacSchedulerNs3::DoScheduleUl (const std::vector <UlHarqInfo> &ulHarqFeedback,
       ulSymAvail -= usedHarq;
     }
 
+  if (ulSymAvail > 0 && ! m_ulCg.empty ())
+    {
+      uint8_t usedCg = ScheduleUlConfiguredGrant (&ulAssignationStartPoint, ulSymAvail, ulSfn, allocInfo);
+      NS_LOG_INFO ("For the slot " << ulSfn << " reserved " <<
+                   static_cast<uint32_t> (usedCg) << " symbols for UL configured grants");
+      ulSymAvail -= usedCg;
+    }
+
+  if (ulSymAvail >= m_miniSlotSymbols && m_miniSlotSymbols > 0)
+    {
+      uint8_t usedMini = ScheduleUlMiniSlots (&ulAssignationStartPoint, ulSymAvail, ulSfn, allocInfo);
+      NS_LOG_INFO ("For the slot " << ulSfn << " reserved " <<
+                   static_cast<uint32_t> (usedMini) << " symbols for UL mini-slots");
+      ulSymAvail -= usedMini;
+    }
+
   NS_ASSERT (ulAssignationStartPoint.m_rbg == 0);
 
   if (ulSymAvail > 0 && m_srList.size () > 0)
@@ -2042,14 +3204,21 @@ NrMacSchedulerNs3::DoScheduleUl (const std::vector <UlHarqInfo> &ulHarqFeedback,
       m_srList.clear ();
     }
 
-  ActiveUeMap activeUlUe;
-  ComputeActiveUe (&activeUlUe, &NrMacSchedulerUeInfo::GetUlLCG,
-                   &NrMacSchedulerUeInfo::GetUlHarqVector, "UL");
+  if (ulSymAvail > 0 && m_proactiveUlGrant)
+    {
+      DoScheduleUlProactive ();
+    }
+
+  {
+    NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::COMPUTE_ACTIVE_UE);
+    ComputeActiveUe (&m_activeUlUe, &NrMacSchedulerUeInfo::GetUlLCG,
+                     &NrMacSchedulerUeInfo::GetUlHarqVector, "UL");
+  }
 
   GetSecond GetUeInfoList;
   for (const auto & alloc : allocInfo->m_varTtiAllocInfo)
     {
-      for (auto it = activeUlUe.begin(); it != activeUlUe.end (); ++it)
+      for (auto it = m_activeUlUe.begin(); it != m_activeUlUe.end (); ++it)
         {
           auto & ueInfos = GetUeInfoList(*it);
           for (auto ueIt = ueInfos.begin(); ueIt != ueInfos.end(); /* no incr */)
@@ -2070,14 +3239,15 @@ NrMacSchedulerNs3::DoScheduleUl (const std::vector <UlHarqInfo> &ulHarqFeedback,
         }
     }
 
-  if (ulSymAvail > 0 && activeUlUe.size () > 0)
+  if (ulSymAvail > 0 && m_activeUlUe.size () > 0)
     {
       uint8_t usedUl = DoScheduleUlData (&ulAssignationStartPoint, ulSymAvail,
-                                         activeUlUe, allocInfo);
+                                         m_activeUlUe, allocInfo);
       NS_LOG_INFO ("For the slot " << ulSfn << " reserved " <<
                    static_cast<uint32_t> (usedUl) << " symbols for UL data tx");
       ulSymAvail -= usedUl;
     }
+  ClearActiveUe (&m_activeUlUe);
 
   std::vector<uint32_t> symToAl;
   symToAl.resize (15, 0);
@@ -2138,7 +3308,7 @@ NrMacSchedulerNs3::DoScheduleSrs (PointInFTPlane *spoint, SlotAllocInfo *allocIn
   uint8_t used = 0;
 
   // Without UE, don't schedule any SRS
-  if (m_ueMap.size () == 0)
+  if (m_ueVector.empty ())
     {
       return used;
     }
@@ -2147,45 +3317,52 @@ NrMacSchedulerNs3::DoScheduleSrs (PointInFTPlane *spoint, SlotAllocInfo *allocIn
   // absolute_slot_number % periodicity = offset_UEx
   // Assuming that all UEs share the same periodicity.
 
-  uint32_t offset_UEx = m_srsSlotCounter % m_ueMap.begin()->second->m_srsPeriodicity;
-  uint16_t rnti = 0;
+  uint32_t offset_UEx = m_srsSlotCounter % m_ueVector.front ()->m_srsPeriodicity;
+  std::shared_ptr<NrMacSchedulerUeInfo> srsUe;
 
-  for (const auto & ue : m_ueMap)
+  for (const auto & ue : m_ueVector)
     {
-      if (ue.second->m_srsOffset == offset_UEx)
+      if (ue->m_srsOffset == offset_UEx)
         {
-          rnti = ue.second->m_rnti;
+          srsUe = ue;
         }
     }
 
-  if (rnti == 0)
+  if (srsUe == nullptr)
     {
       return used; // No SRS in this slot!
     }
 
+  // The algorithm may skip some occurrences of the offset of the UE
+  uint32_t occurrence = m_srsSlotCounter / m_ueVector.front ()->m_srsPeriodicity;
+  if (!m_schedulerSrs->IsSrsOccurrence (srsUe, occurrence))
+    {
+      NS_LOG_INFO ("UE " << srsUe->m_rnti << " skips its SRS occurrence " << occurrence);
+      return used;
+    }
+  uint16_t rnti = srsUe->m_rnti;
+
   // Schedule 4 allocation, of 1 symbol each, in TDMA mode, for the RNTI found.
 
   for (uint32_t i = 0; i < m_srsCtrlSymbols; ++i)
     {
-      std::vector<uint8_t> rbgAssigned (GetBandwidthInRbg (), 1);
-
       NS_LOG_INFO ("UE " << rnti << " assigned symbol " << +spoint->m_sym << " for SRS tx");
 
-      std::vector<uint8_t> rbgBitmask (GetBandwidthInRbg (), 1);
+      NrBitset rbgBitmask (GetBandwidthInRbg (), true);
 
       spoint->m_sym--;
 
       //Due to MIMO implementation MCS, TB size, ndi, rv, are vectors
-      std::vector<uint8_t> mcs = {0};
-      std::vector<uint32_t> tbs = {0};
-      std::vector<uint8_t> ndi = {1};
-      std::vector<uint8_t> rv = {0};
-
-      auto dci = std::make_shared<DciInfoElementTdma> (rnti, DciInfoElementTdma::UL,
-                                                       spoint->m_sym, 1, mcs, tbs,
-                                                       ndi, rv,
-                                                       DciInfoElementTdma::SRS,
-                                                       GetBwpId(), GetTpc ());
+      StreamVector<uint8_t> mcs = {0};
+      StreamVector<uint32_t> tbs = {0};
+      StreamVector<uint8_t> ndi = {1};
+      StreamVector<uint8_t> rv = {0};
+
+      auto dci = DciInfoElementTdma::Create (rnti, DciInfoElementTdma::UL,
+                                             spoint->m_sym, 1, mcs, tbs,
+                                             ndi, rv,
+                                             DciInfoElementTdma::SRS,
+                                             GetBwpId(), GetTpc ());
       dci->m_rbgBitmask = rbgBitmask;
 
       allocInfo->m_numSymAlloc += 1;
@@ -2274,6 +3451,7 @@ NrMacSchedulerNs3::DoScheduleDl (const std::vector <DlHarqInfo> &dlHarqFeedback,
 
   if (activeDlHarq.size () > 0)
     {
+      NrMacSchedulerSlotPhaseTimer timer (&m_phaseTimes, NrMacSchedulerPhaseTimes::SCHEDULE_HARQ);
       uint8_t usedHarq = ScheduleDlHarq (&dlAssignationStartPoint, dlSymAvail,
                                          activeDlHarq, m_ueMap, &m_dlHarqToRetransmit,
                                          dlHarqFeedback, allocInfo);
@@ -2281,6 +3459,22 @@ NrMacSchedulerNs3::DoScheduleDl (const std::vector <DlHarqInfo> &dlHarqFeedback,
       dlSymAvail -= usedHarq;
     }
 
+  if (dlSymAvail > 0 && ! m_dlSps.empty ())
+    {
+      uint8_t usedSps = ScheduleDlSps (&dlAssignationStartPoint, dlSymAvail, dlSfnSf, allocInfo);
+      NS_LOG_INFO ("For the slot " << dlSfnSf << " reserved " <<
+                   static_cast<uint32_t> (usedSps) << " symbols for DL SPS");
+      dlSymAvail -= usedSps;
+    }
+
+  if (dlSymAvail >= m_miniSlotSymbols && m_miniSlotSymbols > 0)
+    {
+      uint8_t usedMini = ScheduleDlMiniSlots (&dlAssignationStartPoint, dlSymAvail, dlSfnSf, allocInfo);
+      NS_LOG_INFO ("For the slot " << dlSfnSf << " reserved " <<
+                   static_cast<uint32_t> (usedMini) << " symbols for DL mini-slots");
+      dlSymAvail -= usedMini;
+    }
+
   GetSecond GetUeInfoList;
 
   for (const auto & alloc : allocInfo->m_varTtiAllocInfo)
@@ -2333,14 +3527,22 @@ void
 NrMacSchedulerNs3::DoSchedDlTriggerReq (const NrMacSchedSapProvider::SchedDlTriggerReqParameters& params)
 {
   NS_LOG_FUNCTION (this);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::SCHEDULER);
 
   // process received CQIs
-  m_cqiManagement.RefreshDlCqiMaps (m_ueMap);
+  m_cqiManagement.RefreshDlCqiMaps ();
 
   // reset expired HARQ
-  for (const auto & itUe : m_ueMap)
+  if (m_harqTimerWheel)
     {
-      ResetExpiredHARQ (itUe.second->m_rnti, &itUe.second->m_dlHarq);
+      AdvanceHarqTimerWheel (&m_dlHarqWheel, NrMacSchedulerUeInfo::GetDlHarqVector, "DL");
+    }
+  else
+    {
+      for (const auto & ue : m_ueVector)
+        {
+          ResetExpiredHARQ (ue->m_rnti, &ue->m_dlHarq);
+        }
     }
 
   // Merge not-retransmitted and received feedback
@@ -2406,8 +3608,13 @@ NrMacSchedulerNs3::DoSchedDlTriggerReq (const NrMacSchedSapProvider::SchedDlTrig
             }
         }
 
+      if (m_harqTimerWheel)
+        {
+          RefreshHarqTimers (m_dlHarqWheel, dlHarqFeedback, NrMacSchedulerUeInfo::GetDlHarqVector);
+        }
       ProcessHARQFeedbacks (&dlHarqFeedback, NrMacSchedulerUeInfo::GetDlHarqVector,
-                            "DL");
+                            &NrMacSchedulerCQIManagement::DlHarqFeedback, "DL");
+      m_schedHarq->DropStaleDlHarq (&dlHarqFeedback, m_ueMap);
     }
 
   ScheduleDl (params, dlHarqFeedback);
@@ -2427,14 +3634,22 @@ void
 NrMacSchedulerNs3::DoSchedUlTriggerReq (const NrMacSchedSapProvider::SchedUlTriggerReqParameters& params)
 {
   NS_LOG_FUNCTION (this);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::SCHEDULER);
 
   // process received CQIs
-  m_cqiManagement.RefreshUlCqiMaps (m_ueMap);
+  m_cqiManagement.RefreshUlCqiMaps ();
 
   // reset expired HARQ
-  for (const auto & itUe : m_ueMap)
+  if (m_harqTimerWheel)
     {
-      ResetExpiredHARQ (itUe.second->m_rnti, &itUe.second->m_ulHarq);
+      AdvanceHarqTimerWheel (&m_ulHarqWheel, NrMacSchedulerUeInfo::GetUlHarqVector, "UL");
+    }
+  else
+    {
+      for (const auto & ue : m_ueVector)
+        {
+          ResetExpiredHARQ (ue->m_rnti, &ue->m_ulHarq);
+        }
     }
 
   // Merge not-retransmitted and received feedback
@@ -2470,8 +3685,13 @@ NrMacSchedulerNs3::DoSchedUlTriggerReq (const NrMacSchedSapProvider::SchedUlTrig
             }
         }
 
+      if (m_harqTimerWheel)
+        {
+          RefreshHarqTimers (m_ulHarqWheel, ulHarqFeedback, NrMacSchedulerUeInfo::GetUlHarqVector);
+        }
       ProcessHARQFeedbacks (&ulHarqFeedback, NrMacSchedulerUeInfo::GetUlHarqVector,
-                            "UL");
+                            &NrMacSchedulerCQIManagement::UlHarqFeedback, "UL");
+      m_schedHarq->DropStaleUlHarq (&ulHarqFeedback, m_ueMap);
     }
 
   ScheduleUl (params, ulHarqFeedback);
@@ -24,7 +24,11 @@
 #include "nr-mac-scheduler-ue-info.h"
 #include "nr-mac-scheduler-lcg.h"
 #include "nr-mac-scheduler-cqi-management.h"
+#include "nr-mac-scheduler-phase-timer.h"
 #include "nr-amc.h"
+#include "nr-dl-power-allocator.h"
+#include "nr-icic-algorithm.h"
+#include <ns3/traced-callback.h>
 #include <memory>
 #include <functional>
 #include <list>
@@ -76,7 +80,10 @@ class NrMacSchedulerSrsDefault;
  *
  * \section scheduler_cell_conf Cell configuration
  *
- * The cell configuration, done with a call to DoCschedCellConfigReq, is ignored.
+ * The cell configuration, done with a call to DoCschedCellConfigReq, gives
+ * the bandwidth in RBG. The number of RB is read there as well from the
+ * SpectrumModel of the MAC, so that the scheduler, which may run on the
+ * workers of NrSchedulingWorkerPool, never touches the SpectrumModel.
  *
  * \section scheduler_lc_creation LC creation and removal
  *
@@ -155,7 +162,10 @@ class NrMacSchedulerSrsDefault;
  * for both UL and DL HARQs.
  *
  * At the end of the process, the code evaluates the HARQ timers, and reset the
- * processes with an expired timer (ResetExpiredHARQ()).
+ * processes with an expired timer (ResetExpiredHARQ()). That scan visits every
+ * process of every UE at each slot; with the attribute HarqTimerWheel, each
+ * (re)transmission is instead filed under the slot in which it expires, and
+ * only the processes of the current slot are checked (AdvanceHarqTimerWheel()).
  *
  * To discover more about how HARQ processes are stored and managed, please take
  * a look at the HarqProcess and NrMacHarqVector documentation.
@@ -203,6 +213,15 @@ class NrMacSchedulerSrsDefault;
  *
  * All this details are considered in the functions ScheduleUl() and ScheduleDl().
  *
+ * With the attribute ProactiveUlGrant, the UL scheduling does not wait for a
+ * SR to serve the UEs that were recently active: a UE that reported a non-empty
+ * BSR in the last ProactiveUlWindow, and that has no UL data nor UL HARQ
+ * process in flight, gets a minimal grant (see DoScheduleUlProactive()), so that
+ * the next packet does not pay the SR-BSR round trip. Moreover, the grant given
+ * after a SR is sized from the average of the BSRs of the UE (weighted by
+ * BsrAverageWeight) instead of the minimum, so that most of the times the first
+ * grant already carries the data.
+ *
  *
  * \section scheduler_harq HARQ
  *
@@ -210,6 +229,30 @@ class NrMacSchedulerSrsDefault;
  * new data, and this happens for both DL and UL. The detailed documentation
  * is available in the methods ScheduleDlHarq() and ScheduleUlHarq().
  *
+ * \section scheduler_periodic Periodic reservations
+ *
+ * A UE with periodic traffic can have a DL semi-persistent scheduling
+ * (ConfigureDlSps()) and an UL configured grant (ConfigureUlConfiguredGrant()).
+ * In their occasions, after the HARQ retransmissions, the configured symbols
+ * are subtracted from the slot and assigned to the UE at its current MCS,
+ * before the scheduling of new data, in which the UE does not take part.
+ * The UL occasions do not wait for a SR or a BSR. The occasions are still
+ * signalled to the UE with a DCI, as any allocation in this model, but they
+ * do not go through the sorting and RBG assignment of the new data.
+ *
+ * \section scheduler_mini_slot Mini-slots
+ *
+ * With the attribute MiniSlotSymbols (2, 4 or 7), the data of the LC whose
+ * packet delay budget is at most MiniSlotDelayBudget (e.g., the delay critical
+ * GBR QCIs) is scheduled in mini-slots, after the periodic reservations: each
+ * UE with such data gets the fewest whole mini-slots that carry it, over all
+ * the RBG and at its current MCS, without sorting nor RBG assignment. In DL
+ * the mini-slots are at the start of the data region of the slot, so the TB
+ * is received after a few symbols instead of at the end of the slot. The
+ * scheduler is still called once per slot, and K0, K1 and K2 are still in
+ * slots: the latency gain is the position and the length of the TB inside
+ * the slot (see ScheduleDlMiniSlots() and ScheduleUlMiniSlots()).
+ *
  * \section scheduler_sched Scheduling new data
  *
  * The scheduling of new data is performed by functions ScheduleUlData() and
@@ -287,6 +330,12 @@ public:
    */
   Ptr<const NrAmc> GetDlAmc () const;
 
+  /**
+   * \brief Get the ICIC algorithm
+   * \return the ICIC algorithm of the cell, or nullptr
+   */
+  Ptr<NrIcicAlgorithm> GetIcicAlgorithm () const;
+
   /**
    * \brief Point in the Frequency/Time plane
    *
@@ -454,27 +503,30 @@ public:
 
   /**
    * \brief Set the notched (blank) RBGs Mask for the DL
-   * \param dlNotchedRbgsMask The mask of notched RBGs
+   * \param dlNotchedRbgsMask The mask of notched RBGs (a std::vector<uint8_t>,
+   * with one byte per RBG, is converted)
    */
-  void SetDlNotchedRbgMask (const std::vector<uint8_t> &dlNotchedRbgsMask);
+  void SetDlNotchedRbgMask (const NrBitset &dlNotchedRbgsMask);
 
   /**
    * \brief Get the notched (blank) RBGs Mask for the DL
-   * \return The mask of notched RBGs
+   * \return The mask of notched RBGs; with an ICIC algorithm, only the RBGs
+   * that it leaves to the cell are not notched
    */
-  std::vector<uint8_t> GetDlNotchedRbgMask (void) const;
+  const NrBitset & GetDlNotchedRbgMask (void) const;
 
   /**
    * \brief Set the notched (blank) RBGs Mask for the UL
-   * \param ulNotchedRbgsMask The mask of notched RBGs
+   * \param ulNotchedRbgsMask The mask of notched RBGs (a std::vector<uint8_t>,
+   * with one byte per RBG, is converted)
    */
-  void SetUlNotchedRbgMask (const std::vector<uint8_t> &ulNotchedRbgsMask);
+  void SetUlNotchedRbgMask (const NrBitset &ulNotchedRbgsMask);
 
   /**
    * \brief Get the notched (blank) RBGs Mask for the UL
    * \return The mask of notched RBGs
    */
-  std::vector<uint8_t> GetUlNotchedRbgMask (void) const;
+  const NrBitset & GetUlNotchedRbgMask (void) const;
 
   /**
    * \brief Set the number of UL SRS symbols
@@ -488,6 +540,18 @@ public:
    */
   uint8_t GetSrsCtrlSyms () const;
 
+  /**
+   * \brief Set the algorithm that assigns the SRS periodicity and offset
+   * \param type the type of the algorithm, a NrMacSchedulerSrsDefault or a subclass
+   */
+  void SetSrsAlgorithm (const TypeId &type);
+
+  /**
+   * \brief Get the algorithm that assigns the SRS periodicity and offset
+   * \return the type of the algorithm
+   */
+  TypeId GetSrsAlgorithm () const;
+
   /**
    * \brief Set if the UL slots are allowed for SRS transmission (if True, UL
    * and F slots may carry SRS, if False, SRS are transmitted only in F slots)
@@ -534,6 +598,210 @@ public:
    */
   bool IsHarqReTxEnable () const;
 
+  /**
+   * \brief Set the HARQ retransmission deadline
+   * \param slots the number of slots a NACKed process can wait for its
+   * retransmission, counted from its last transmission. With 0, the
+   * retransmissions are scheduled by NrMacSchedulerHarqRr, without deadline;
+   * otherwise, by NrMacSchedulerHarqDeadline.
+   */
+  void SetHarqRetxDeadline (uint8_t slots);
+  /**
+   * \brief Get the HARQ retransmission deadline
+   * \return the number of slots a NACKed process can wait for its retransmission (0: no deadline)
+   */
+  uint8_t GetHarqRetxDeadline () const;
+
+  /**
+   * \brief Set the attribute ProactiveUlGrant
+   * \param v true to size the SR grants from the past BSRs, and to give
+   * minimal UL grants to the recently active UEs
+   */
+  void SetProactiveUlGrant (bool v);
+  /**
+   * \return the value of the attribute ProactiveUlGrant
+   */
+  bool IsProactiveUlGrant () const;
+
+  /**
+   * \brief Set the attribute ProactiveUlWindow
+   * \param v time after the last non-empty BSR during which a UE gets the proactive UL grants
+   */
+  void SetProactiveUlWindow (const Time &v);
+  /**
+   * \return the value of the attribute ProactiveUlWindow
+   */
+  Time GetProactiveUlWindow () const;
+
+  /**
+   * \brief Set the attribute BsrAverageWeight
+   * \param v weight of the last non-empty BSR in the average of the BSRs of a UE
+   */
+  void SetBsrAverageWeight (double v);
+  /**
+   * \return the value of the attribute BsrAverageWeight
+   */
+  double GetBsrAverageWeight () const;
+
+  /**
+   * \brief Set the attribute MiniSlotSymbols
+   * \param v the number of symbols of a mini-slot (2, 4 or 7), or 0 to
+   * schedule all the data per slot
+   */
+  void SetMiniSlotSymbols (uint8_t v);
+  /**
+   * \return the value of the attribute MiniSlotSymbols
+   */
+  uint8_t GetMiniSlotSymbols () const;
+
+  /**
+   * \brief Set the attribute MiniSlotDelayBudget
+   * \param v the longest packet delay budget of the LC scheduled in mini-slots
+   */
+  void SetMiniSlotDelayBudget (const Time &v);
+  /**
+   * \return the value of the attribute MiniSlotDelayBudget
+   */
+  Time GetMiniSlotDelayBudget () const;
+
+  /**
+   * \brief Set the attribute OllaTargetBler
+   * \param v the target BLER of the first transmissions, or 0 to disable the OLLA
+   */
+  void SetOllaTargetBler (double v);
+  /**
+   * \return the value of the attribute OllaTargetBler
+   */
+  double GetOllaTargetBler () const;
+
+  /**
+   * \brief Set the attribute OllaStepDown
+   * \param v the MCS offset removed at each NACK of a first transmission
+   */
+  void SetOllaStepDown (double v);
+  /**
+   * \return the value of the attribute OllaStepDown
+   */
+  double GetOllaStepDown () const;
+
+  /**
+   * \brief Set the attribute OllaMaxOffset
+   * \param v the largest absolute value of the OLLA MCS offset
+   */
+  void SetOllaMaxOffset (double v);
+  /**
+   * \return the value of the attribute OllaMaxOffset
+   */
+  double GetOllaMaxOffset () const;
+
+  /**
+   * \brief Set the attribute AperiodicCqiAge
+   * \param v the age in slots of the DL CQI after which a DL DCI requests a
+   * report, or 0 to never request one
+   */
+  void SetAperiodicCqiAge (uint32_t v);
+  /**
+   * \return the value of the attribute AperiodicCqiAge
+   */
+  uint32_t GetAperiodicCqiAge () const;
+
+  /**
+   * \brief Set the attribute HarqTimerWheel
+   * \param v whether the HARQ processes expire through a timer wheel, instead
+   * of a scan of the processes of all the UEs at every slot. To be set
+   * before the first slot is scheduled
+   */
+  void SetHarqTimerWheel (bool v);
+  /**
+   * \return the value of the attribute HarqTimerWheel
+   */
+  bool IsHarqTimerWheel () const;
+
+  /**
+   * \brief Configure the DL semi-persistent scheduling (SPS) of a UE
+   * \param rnti the UE
+   * \param periodicity the number of slots between two occasions (0 releases the SPS)
+   * \param numSym the number of symbols of each occasion, over all the RBG
+   * \param offset the slot of the occasions, modulo the periodicity
+   *
+   * In an occasion in which the UE has DL data, the symbols are assigned to
+   * it after the HARQ retransmissions and before the new data, without
+   * sorting the UEs nor assigning RBG. An occasion without data leaves the
+   * symbols to the other UEs.
+   */
+  void ConfigureDlSps (uint16_t rnti, uint16_t periodicity, uint8_t numSym, uint16_t offset = 0);
+
+  /**
+   * \brief Configure the UL configured grant of a UE
+   * \param rnti the UE
+   * \param periodicity the number of slots between two occasions (0 releases the grant)
+   * \param numSym the number of symbols of each occasion, over all the RBG
+   * \param offset the slot of the occasions, modulo the periodicity
+   *
+   * The symbols of each occasion are granted to the UE after the HARQ
+   * retransmissions, also without a BSR: the data generated between two
+   * occasions is sent at the next one, without the SR and BSR round trip.
+   */
+  void ConfigureUlConfiguredGrant (uint16_t rnti, uint16_t periodicity, uint8_t numSym, uint16_t offset = 0);
+
+  /**
+   * \brief TracedCallback signature for the times of the phases of a slot
+   * \param [in] sfnSf the slot scheduled
+   * \param [in] isDl true for ScheduleDl, false for ScheduleUl
+   * \param [in] times the nanoseconds spent in each phase
+   */
+  typedef void (* PhaseTimesTracedCallback)(const SfnSf &sfnSf, bool isDl,
+                                            const NrMacSchedulerPhaseTimes &times);
+
+  /**
+   * \brief TracedCallback signature for the load of a slot
+   * \param [in] sfnSf the slot scheduled
+   * \param [in] isDl true for ScheduleDl, false for ScheduleUl
+   * \param [in] bwpId the BWP of the scheduler
+   * \param [in] usedRbgSym RBG x symbols assigned to data
+   * \param [in] availableRbgSym RBG x symbols not used by CTRL or SRS
+   */
+  typedef void (* SlotLoadTracedCallback)(const SfnSf &sfnSf, bool isDl, uint16_t bwpId,
+                                          uint32_t usedRbgSym, uint32_t availableRbgSym);
+
+  /**
+   * \brief TracedCallback signature for the DL wide-band CQI received
+   * \param [in] bwpId the BWP of the scheduler
+   * \param [in] rnti the UE that reported the CQI
+   * \param [in] cqi the wide-band CQI of the first stream
+   */
+  typedef void (* DlWbCqiTracedCallback)(uint16_t bwpId, uint16_t rnti, uint8_t cqi);
+
+  /**
+   * \brief Get the histogram of the times of a phase, over all the slots
+   * scheduled so far
+   *
+   * The histograms are filled only if the module is built with
+   * NR_SCHEDULER_PHASE_TIMING; otherwise, they are empty.
+   *
+   * \param isDl true for the DL slots, false for the UL slots
+   * \param phase the phase
+   * \return the histogram
+   */
+  const NrMacSchedulerPhaseHistogram & GetPhaseHistogram (bool isDl, NrMacSchedulerPhaseTimes::Phase phase) const;
+
+  /**
+   * \brief Get an estimate of the memory used by the representation of the UEs
+   * \return the number of bytes of all the UEs (see NrMacSchedulerUeInfo::GetMemoryUsage)
+   */
+  uint64_t GetUeMemoryUsage () const;
+
+  /**
+   * \return the number of UEs of the scheduler
+   */
+  uint32_t GetNumberOfUes () const;
+
+  /**
+   * \param isDl true for the DL buffers, false for the UL ones (as reported by the BSRs)
+   * \return the bytes in the buffers of all the UEs, as known by the scheduler
+   */
+  uint64_t GetBufferedBytes (bool isDl) const;
+
 protected:
   /**
    * \brief Create an UE representation for the scheduler.
@@ -667,6 +935,18 @@ protected:
   virtual void
   ChangeUlBeam (PointInFTPlane *spoint, uint32_t symOfBeam) const = 0;
 
+  /**
+   * \brief Group the DL beams that share the same symbols and RBGs (MU-MIMO)
+   * \param activeDl Map of Beam and active UE per beam
+   * \return the groups, in scheduling order
+   *
+   * It is called after AssignDLRBG. The beams of a group start from the same
+   * point, and the DCI of the i-th beam of a group have the layer i. The
+   * default puts each beam in its own group, in the order of activeDl.
+   */
+  virtual std::vector<std::vector<BeamConfId> >
+  GetDlBeamGroups (const ActiveUeMap &activeDl) const;
+
   /**
    * \brief Sort the DL HARQ retransmission
    * \param activeDlHarq HARQ DL to retransmit
@@ -766,7 +1046,7 @@ private:
      * \param mcs MCS
      */
     AllocElem (uint16_t rnti, uint32_t tbs, uint8_t symStart, uint8_t numSym, uint8_t mcs,
-               const std::vector<uint8_t> &rbgMask)
+               const NrBitset &rbgMask)
       : m_rnti (rnti), m_tbs (tbs), m_symStart (symStart), m_numSym (numSym), m_mcs (mcs),
         m_rbgMask (rbgMask)
     {
@@ -777,7 +1057,7 @@ private:
     uint8_t m_symStart {0}; //!< Sym start
     uint8_t m_numSym {0}; //!< Allocated symbols
     uint8_t m_mcs   {0};  //!< MCS of the transmission
-    std::vector<uint8_t> m_rbgMask; //!< RBG Mask
+    NrBitset m_rbgMask; //!< RBG Mask
   };
 
   /**
@@ -807,8 +1087,8 @@ private:
     std::vector<AllocElem> m_ulAllocations; //!< List of UL allocations
   };
 
-  std::vector<Assignation>
-  AssignBytesToLC (const std::unordered_map<uint8_t, LCGPtr> &ueLCG, uint32_t tbs) const;
+  void AssignBytesToLC (const std::unordered_map<uint8_t, LCGPtr> &ueLCG, uint32_t tbs,
+                        std::vector<Assignation> *assignations) const;
 
   void BSRReceivedFromUe (const MacCeElement &bsr);
 
@@ -819,9 +1099,46 @@ private:
 
   void ResetExpiredHARQ (uint16_t rnti, NrMacHarqVector *harq);
 
+  /**
+   * \brief A (re)transmission of a HARQ process, to expire in a slot of the HARQ timer wheel
+   */
+  struct HarqTimerEntry
+  {
+    uint16_t m_rnti {0};       //!< RNTI of the UE
+    uint8_t m_processId {0};   //!< ID of the process
+    uint64_t m_start {0};      //!< Slot of the (re)transmission
+  };
+
+  /**
+   * \brief The HARQ processes of a direction, by the slot in which they expire
+   */
+  struct HarqTimerWheel
+  {
+    uint64_t m_slot {0};                                 //!< Slots scheduled so far
+    std::vector<std::vector<HarqTimerEntry> > m_buckets; //!< Entries, by slot of expiry modulo the size
+  };
+
+  void AdvanceHarqTimerWheel (HarqTimerWheel *wheel,
+                              const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVectorFn,
+                              const std::string &direction);
+  void ArmHarqTimerWheel (HarqTimerWheel *wheel, const SlotAllocInfo &slotAlloc,
+                          DciInfoElementTdma::DciFormat format,
+                          const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVectorFn);
+  template<typename T>
+  void RefreshHarqTimers (const HarqTimerWheel &wheel, const std::vector<T> &feedbacks,
+                          const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVectorFn);
+  void InstallHarqScheduler (std::unique_ptr<NrMacSchedulerHarqRr> schedHarq);
+
+  /**
+   * \brief Method of NrMacSchedulerCQIManagement that takes the HARQ feedback for the OLLA
+   */
+  typedef void (NrMacSchedulerCQIManagement::*OllaFeedbackFn) (const std::shared_ptr<NrMacSchedulerUeInfo> &,
+                                                               bool) const;
+
   template<typename T>
   void ProcessHARQFeedbacks (std::vector<T> *harqInfo,
                              const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVectorFn,
+                             OllaFeedbackFn ollaFn,
                              const std::string &direction) const;
 
   void
@@ -842,7 +1159,8 @@ private:
 
   void ComputeActiveUe (ActiveUeMap *activeDlUe, const NrMacSchedulerUeInfo::GetLCGFn &GetLCGFn,
                         const NrMacSchedulerUeInfo::GetHarqVectorFn &GetHarqVector,
-                        const std::string &mode) const;
+                        const std::string &mode);
+  void ClearActiveUe (ActiveUeMap *activeUe);
   void ComputeActiveHarq (ActiveHarqMap *activeDlHarq, const std::vector <DlHarqInfo> &dlHarqFeedback) const;
   void ComputeActiveHarq (ActiveHarqMap *activeUlHarq, const std::vector <UlHarqInfo> &ulHarqFeedback) const;
 
@@ -851,6 +1169,22 @@ private:
   uint8_t DoScheduleUlData (PointInFTPlane *spoint, uint32_t symAvail,
                             const ActiveUeMap &activeUl, SlotAllocInfo *slotAlloc) const;
   void DoScheduleUlSr (PointInFTPlane *spoint, const std::list<uint16_t> &rntiList) const;
+  void DoScheduleUlProactive () const;
+  void CommitDlDataDci (const std::shared_ptr<NrMacSchedulerUeInfo> &ue,
+                        const std::shared_ptr<DciInfoElementTdma> &dci,
+                        SlotAllocInfo *slotAlloc) const;
+  bool CommitUlDataDci (const std::shared_ptr<NrMacSchedulerUeInfo> &ue,
+                        const std::shared_ptr<DciInfoElementTdma> &dci,
+                        SlotAllocInfo *slotAlloc) const;
+  uint8_t ScheduleDlSps (PointInFTPlane *spoint, uint32_t symAvail,
+                         const SfnSf &sfnSf, SlotAllocInfo *allocInfo) const;
+  uint8_t ScheduleUlConfiguredGrant (PointInFTPlane *spoint, uint32_t symAvail,
+                                     const SfnSf &sfnSf, SlotAllocInfo *allocInfo) const;
+  uint8_t ScheduleDlMiniSlots (PointInFTPlane *spoint, uint32_t symAvail,
+                               const SfnSf &sfnSf, SlotAllocInfo *allocInfo) const;
+  uint8_t ScheduleUlMiniSlots (PointInFTPlane *spoint, uint32_t symAvail,
+                               const SfnSf &sfnSf, SlotAllocInfo *allocInfo) const;
+  static bool HasAllocation (const SlotAllocInfo &allocInfo, uint16_t rnti);
   uint8_t DoScheduleDl (const std::vector <DlHarqInfo> &dlHarqFeedback, const ActiveHarqMap &activeDlHarq,
                         ActiveUeMap *activeDlUe, const SfnSf &dlSfnSf,
                         const SlotElem &ulAllocations, SlotAllocInfo *allocInfo);
@@ -882,6 +1216,10 @@ protected:
 
 private:
   std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > m_ueMap; //!< The map of between RNTI and their data
+  std::vector<std::shared_ptr<NrMacSchedulerUeInfo> > m_ueVector; //!< The UE of m_ueMap, contiguous and in creation order, for the walks done at each slot
+  ActiveUeMap m_activeDlUe; //!< The active UE of the DL slot being scheduled, reused at each slot
+  ActiveUeMap m_activeUlUe; //!< The active UE of the UL slot being scheduled, reused at each slot
+  std::vector<ActiveUeMap::node_type> m_activeUeNodes; //!< Unused entries of the active UE maps, kept with the capacity of their vector
 
   /**
    * Map of previous allocated UE per RBG
@@ -903,19 +1241,56 @@ private:
 
   std::list<uint16_t> m_srList;  //!< List of RNTI of UEs that asked for a SR
 
+  bool m_proactiveUlGrant {false};       //!< Size the SR grants from the BSRs and pre-schedule the active UEs (attribute)
+  Time m_proactiveUlWindow;              //!< Time after the last BSR during which a UE is pre-scheduled (attribute)
+  double m_bsrAverageWeight {0.25};      //!< Weight of the last BSR in the average of the BSRs (attribute)
+  uint8_t m_miniSlotSymbols {0};         //!< Symbols of a mini-slot, 0 if disabled (attribute)
+  Time m_miniSlotDelayBudget;            //!< Longest delay budget of the LC scheduled in mini-slots (attribute)
+  double m_ollaTargetBler {0.0};         //!< Target BLER of the OLLA, 0 if disabled (attribute)
+  double m_ollaStepDown {0.5};           //!< OLLA MCS offset removed at each NACK (attribute)
+  double m_ollaMaxOffset {10.0};         //!< Largest absolute OLLA MCS offset (attribute)
+  uint32_t m_aperiodicCqiAge {0};        //!< Age of the DL CQI after which a DL DCI requests a report (attribute)
+  bool m_harqTimerWheel {false};         //!< Expire the HARQ processes through the timer wheels (attribute)
+  HarqTimerWheel m_dlHarqWheel;          //!< Timer wheel of the DL HARQ processes
+  HarqTimerWheel m_ulHarqWheel;          //!< Timer wheel of the UL HARQ processes
+
+  /**
+   * \brief A periodic reservation of symbols of a UE: DL SPS or UL configured grant
+   */
+  struct PeriodicGrant
+  {
+    uint16_t m_periodicity {0}; //!< Slots between two occasions
+    uint16_t m_offset {0};      //!< Slot of the occasions, modulo the periodicity
+    uint8_t m_numSym {0};       //!< Symbols of each occasion
+
+    /**
+     * \param sfnSf the slot
+     * \return true if the slot is an occasion of the reservation
+     */
+    bool IsOccasion (const SfnSf &sfnSf) const
+    {
+      return sfnSf.Normalize () % m_periodicity == m_offset;
+    }
+  };
+
+  std::map<uint16_t, PeriodicGrant> m_dlSps; //!< DL SPS of the UEs, by RNTI
+  std::map<uint16_t, PeriodicGrant> m_ulCg;  //!< UL configured grants of the UEs, by RNTI
+
   std::vector <struct RachListElement_s> m_rachList; //!< rach list
 
   uint16_t m_bandwidth {0}; //!< Bandwidth in number of RBG
+  uint32_t m_numRbs {0};    //!< Bandwidth in number of RB, read at the cell configuration
   uint8_t m_dlCtrlSymbols {0}; //!< DL ctrl symbols (attribute)
   uint8_t m_ulCtrlSymbols {0}; //!< UL ctrl symbols (attribute)
   uint8_t m_srsCtrlSymbols {0}; //!< SRS symbols (attribute)
   bool m_enableSrsInUlSlots  {true}; //!< SRS allowed in UL slots (attribute)
   bool m_enableSrsInFSlots  {true}; //!< SRS allowed in F slots (attribute)
 
-  std::vector<uint8_t> m_dlNotchedRbgsMask; //!< The mask of notched (blank) RBGs for the DL
-  std::vector<uint8_t> m_ulNotchedRbgsMask; //!< The mask of notched (blank) RBGs for the UL
+  NrBitset m_dlNotchedRbgsMask; //!< The mask of notched (blank) RBGs for the DL
+  NrBitset m_ulNotchedRbgsMask; //!< The mask of notched (blank) RBGs for the UL
 
   std::unique_ptr <NrMacSchedulerHarqRr> m_schedHarq; //!< Pointer to the real HARQ scheduler
+  uint8_t m_harqRetxDeadline {0}; //!< HARQ retransmission deadline, in slots (attribute)
 
   Ptr<NrMacSchedulerSrsDefault> m_schedulerSrs; //!< Pointer to the SRS algorithm
 
@@ -924,6 +1299,38 @@ private:
   friend NrSchedGeneralTestCase;
 
   bool m_enableHarqReTx  {true}; //!< Flag to enable or disable HARQ ReTx (attribute)
+
+  /**
+   * \brief Fire the trace and fill the histograms with the times of the slot
+   * \param sfnSf the slot scheduled
+   * \param isDl true for ScheduleDl, false for ScheduleUl
+   */
+  void ReportPhaseTimes (const SfnSf &sfnSf, bool isDl);
+
+  /**
+   * \brief Fire the SlotLoad trace for a slot that has been scheduled
+   * \param allocInfo the allocation of the slot
+   * \param isDl true for ScheduleDl, false for ScheduleUl
+   */
+  void ReportSlotLoad (const SlotAllocInfo &allocInfo, bool isDl);
+
+  /**
+   * \brief Set the power of the RBGs of the DL DATA DCIs of a slot, with the
+   * DL power allocator and the ICIC algorithm
+   * \param allocInfo the allocation of the slot
+   */
+  void AllocateDlPower (SlotAllocInfo *allocInfo) const;
+
+  Ptr<NrDlPowerAllocator> m_dlPowerAllocator; //!< The DL power allocator, if any (attribute)
+  Ptr<NrIcicAlgorithm> m_icic;                //!< The ICIC algorithm, if any (attribute)
+  NrBitset m_dlIcicRbgsMask;                  //!< The DL notched mask, restricted by the ICIC algorithm
+
+  mutable NrMacSchedulerPhaseTimes m_phaseTimes; //!< Times of the phases of the slot being scheduled
+  mutable std::vector<std::vector<Assignation> > m_assignationsPerStream; //!< Bytes per LC of each stream of the DCI being created, reused for every DCI
+  std::array<std::array<NrMacSchedulerPhaseHistogram, NrMacSchedulerPhaseTimes::NUM_PHASES>, 2> m_phaseHistograms; //!< Histograms of the phase times, UL (0) and DL (1)
+  TracedCallback<const SfnSf &, bool, const NrMacSchedulerPhaseTimes &> m_phaseTimesTrace; //!< Trace of the phase times of each slot
+  TracedCallback<const SfnSf &, bool, uint16_t, uint32_t, uint32_t> m_slotLoadTrace; //!< Trace of the load of each slot
+  TracedCallback<uint16_t, uint16_t, uint8_t> m_dlWbCqiTrace; //!< Trace of the DL wide-band CQI received
 };
 
 } //namespace ns3
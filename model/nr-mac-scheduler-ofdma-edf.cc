@@ -0,0 +1,117 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#include "nr-mac-scheduler-ofdma-edf.h"
+#include "nr-mac-scheduler-ue-info-edf.h"
+#include <ns3/log.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrMacSchedulerOfdmaEdf");
+NS_OBJECT_ENSURE_REGISTERED (NrMacSchedulerOfdmaEdf);
+
+TypeId
+NrMacSchedulerOfdmaEdf::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrMacSchedulerOfdmaEdf")
+    .SetParent<NrMacSchedulerOfdmaPF> ()
+    .AddConstructor<NrMacSchedulerOfdmaEdf> ()
+  ;
+  return tid;
+}
+
+NrMacSchedulerOfdmaEdf::NrMacSchedulerOfdmaEdf () : NrMacSchedulerOfdmaPF ()
+{
+
+}
+
+std::shared_ptr<NrMacSchedulerUeInfo>
+NrMacSchedulerOfdmaEdf::CreateUeRepresentation (const NrMacCschedSapProvider::CschedUeConfigReqParameters &params) const
+{
+  NS_LOG_FUNCTION (this);
+  return std::make_shared <NrMacSchedulerUeInfoEdf> (GetFairnessIndex (),
+                                                     params.m_rnti, params.m_beamConfId,
+                                                     std::bind (&NrMacSchedulerOfdmaEdf::GetNumRbPerRbg, this));
+}
+
+std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                   const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
+NrMacSchedulerOfdmaEdf::GetUeCompareDlFn () const
+{
+  return NrMacSchedulerUeInfoEdf::CompareUeWeightsDl;
+}
+
+std::function<bool (const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                    const NrMacSchedulerNs3::UePtrAndBufferReq &rhs)>
+NrMacSchedulerOfdmaEdf::GetUeCompareUlFn () const
+{
+  return NrMacSchedulerUeInfoEdf::CompareUeWeightsUl;
+}
+
+void
+NrMacSchedulerOfdmaEdf::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoEdf::CompareUeWeightsDl> (ueVector);
+}
+
+void
+NrMacSchedulerOfdmaEdf::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoEdf::CompareUeWeightsUl> (ueVector);
+}
+
+NrMacSchedulerOfdma::RbgAssignmentMode
+NrMacSchedulerOfdmaEdf::GetRbgAssignmentModeInUse () const
+{
+  return GetRbgAssignmentMode () == BEST_RBG ? BEST_RBG : HEAP;
+}
+
+void
+NrMacSchedulerOfdmaEdf::BeforeDlSched (const UePtrAndBufferReq &ue,
+                                     const FTResources &assignableInIteration) const
+{
+  NS_LOG_FUNCTION (this);
+  NrMacSchedulerOfdmaPF::BeforeDlSched (ue, assignableInIteration);
+  auto uePtr = std::dynamic_pointer_cast<NrMacSchedulerUeInfoEdf> (ue.first);
+  uePtr->UpdateDlDelay ();
+}
+
+void
+NrMacSchedulerOfdmaEdf::BeforeUlSched (const UePtrAndBufferReq &ue,
+                                     const FTResources &assignableInIteration) const
+{
+  NS_LOG_FUNCTION (this);
+  NrMacSchedulerOfdmaPF::BeforeUlSched (ue, assignableInIteration);
+  auto uePtr = std::dynamic_pointer_cast<NrMacSchedulerUeInfoEdf> (ue.first);
+  uePtr->UpdateUlDelay ();
+}
+
+double
+NrMacSchedulerOfdmaEdf::GetDlRbgWeight (const UePtrAndBufferReq &ue, double wbRate) const
+{
+  auto uePtr = std::dynamic_pointer_cast<NrMacSchedulerUeInfoEdf> (ue.first);
+  if (uePtr->m_dlDeadline != Time::Max ())
+    {
+      // As the urgent UEs of NrMacSchedulerOfdmaQos
+      return 1E30 / (1.0 + uePtr->m_dlDeadline.GetSeconds ()) / std::max (1E-9, wbRate);
+    }
+  return NrMacSchedulerOfdmaPF::GetDlRbgWeight (ue, wbRate) * (1.0 + uePtr->m_dlDelayRatio);
+}
+
+} // namespace ns3
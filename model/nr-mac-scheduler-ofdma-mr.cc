@@ -62,4 +62,37 @@ NrMacSchedulerOfdmaMR::GetUeCompareUlFn () const
   return NrMacSchedulerUeInfoMR::CompareUeWeightsUl;
 }
 
+void
+NrMacSchedulerOfdmaMR::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  NrMacSchedulerUeInfoMR::SortUeDl (ueVector, &m_ueSortBuffer);
+}
+
+void
+NrMacSchedulerOfdmaMR::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  NrMacSchedulerUeInfoMR::SortUeUl (ueVector, &m_ueSortBuffer);
+}
+
+std::unique_ptr<NrMacSchedulerUeStateSoa>
+NrMacSchedulerOfdmaMR::CreateDlUeState (const std::vector<UePtrAndBufferReq> &ueVector,
+                                       uint32_t beamSym) const
+{
+  return CopyDlUeState (NrMacSchedulerUeStateSoa::MR, ueVector, beamSym);
+}
+
+std::unique_ptr<NrMacSchedulerUeStateSoa>
+NrMacSchedulerOfdmaMR::CreateUlUeState (const std::vector<UePtrAndBufferReq> &ueVector,
+                                       uint32_t beamSym) const
+{
+  return CopyUlUeState (NrMacSchedulerUeStateSoa::MR, ueVector, beamSym);
+}
+
+double
+NrMacSchedulerOfdmaMR::GetDlRbgWeight ([[maybe_unused]] const UePtrAndBufferReq &ue,
+                                       [[maybe_unused]] double wbRate) const
+{
+  return 1.0;
+}
+
 } // namespace ns3
@@ -76,6 +76,51 @@ protected:
   virtual std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
                              const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
   GetUeCompareUlFn () const override;
+
+  /**
+   * \brief Sort the DL UEs with a counting sort on the MCS
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoMR::SortUeDl
+   */
+  virtual void SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Sort the UL UEs with a counting sort on the MCS
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoMR::SortUeUl
+   */
+  virtual void SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Copy the DL state of the UEs of a beam, ordered by the highest MCS
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return the state, or nullptr if a UE has more than one DL stream
+   */
+  virtual std::unique_ptr<NrMacSchedulerUeStateSoa>
+  CreateDlUeState (const std::vector<UePtrAndBufferReq> &ueVector, uint32_t beamSym) const override;
+
+  /**
+   * \brief Copy the UL state of the UEs of a beam, ordered by the highest MCS
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return the state
+   */
+  virtual std::unique_ptr<NrMacSchedulerUeStateSoa>
+  CreateUlUeState (const std::vector<UePtrAndBufferReq> &ueVector, uint32_t beamSym) const override;
+
+  /**
+   * \brief Get the weight of a UE in the search of the best UE of each DL RBG
+   * \param ue UE and its buffer requirement
+   * \param wbRate rate of one RBG at the wideband MCS of the UE
+   * \return 1, so that each RBG goes to the UE with the highest rate on it
+   */
+  virtual double GetDlRbgWeight (const UePtrAndBufferReq &ue, double wbRate) const override;
+
+private:
+  mutable std::vector<UePtrAndBufferReq> m_ueSortBuffer; //!< Buffer of the counting sort of the UEs
 };
 
 } // namespace ns3
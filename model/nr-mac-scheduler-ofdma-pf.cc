@@ -104,6 +104,77 @@ NrMacSchedulerOfdmaPF::GetUeCompareUlFn () const
   return NrMacSchedulerUeInfoPF::CompareUeWeightsUl;
 }
 
+void
+NrMacSchedulerOfdmaPF::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoPF::CompareUeWeightsDl> (ueVector);
+}
+
+void
+NrMacSchedulerOfdmaPF::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoPF::CompareUeWeightsUl> (ueVector);
+}
+
+/**
+ * \brief Check that a comparison function is a given function
+ * \param fn the comparison function
+ * \param target the function
+ * \return true if fn calls target
+ */
+static bool
+IsCompareFn (const std::function<bool (const NrMacSchedulerNs3::UePtrAndBufferReq &,
+                                       const NrMacSchedulerNs3::UePtrAndBufferReq &)> &fn,
+             bool (*target) (const NrMacSchedulerNs3::UePtrAndBufferReq &,
+                             const NrMacSchedulerNs3::UePtrAndBufferReq &))
+{
+  auto ptr = fn.target<bool (*) (const NrMacSchedulerNs3::UePtrAndBufferReq &,
+                                 const NrMacSchedulerNs3::UePtrAndBufferReq &)> ();
+  return ptr != nullptr && *ptr == target;
+}
+
+std::unique_ptr<NrMacSchedulerUeStateSoa>
+NrMacSchedulerOfdmaPF::CreateDlUeState (const std::vector<UePtrAndBufferReq> &ueVector,
+                                        uint32_t beamSym) const
+{
+  // The subclasses (e.g., QoS) with their own metric do not support it
+  if (! IsCompareFn (GetUeCompareDlFn (), &NrMacSchedulerUeInfoPF::CompareUeWeightsDl))
+    {
+      return nullptr;
+    }
+  auto state = CopyDlUeState (NrMacSchedulerUeStateSoa::PF, ueVector, beamSym);
+  if (state == nullptr)
+    {
+      return nullptr;
+    }
+  // The UEs keep the fairness index as a float
+  state->SetPfParameters (static_cast<float> (m_alpha), m_timeWindow);
+  for (size_t k = 0; k < ueVector.size (); ++k)
+    {
+      auto uePtr = std::dynamic_pointer_cast<NrMacSchedulerUeInfoPF> (ueVector[k].first);
+      state->SetPfInputs (k, uePtr->m_potentialTputDl, uePtr->m_lastAvgTputDl);
+    }
+  return state;
+}
+
+std::unique_ptr<NrMacSchedulerUeStateSoa>
+NrMacSchedulerOfdmaPF::CreateUlUeState (const std::vector<UePtrAndBufferReq> &ueVector,
+                                        uint32_t beamSym) const
+{
+  if (! IsCompareFn (GetUeCompareUlFn (), &NrMacSchedulerUeInfoPF::CompareUeWeightsUl))
+    {
+      return nullptr;
+    }
+  auto state = CopyUlUeState (NrMacSchedulerUeStateSoa::PF, ueVector, beamSym);
+  state->SetPfParameters (static_cast<float> (m_alpha), m_timeWindow);
+  for (size_t k = 0; k < ueVector.size (); ++k)
+    {
+      auto uePtr = std::dynamic_pointer_cast<NrMacSchedulerUeInfoPF> (ueVector[k].first);
+      state->SetPfInputs (k, uePtr->m_potentialTputUl, uePtr->m_lastAvgTputUl);
+    }
+  return state;
+}
+
 void
 NrMacSchedulerOfdmaPF::AssignedDlResources (const UePtrAndBufferReq &ue,
                                             [[maybe_unused]]const FTResources &assigned,
@@ -162,4 +233,12 @@ NrMacSchedulerOfdmaPF::BeforeUlSched (const UePtrAndBufferReq &ue,
   uePtr->CalculatePotentialTPutUl (assignableInIteration, m_ulAmc);
 }
 
+double
+NrMacSchedulerOfdmaPF::GetDlRbgWeight (const UePtrAndBufferReq &ue, double wbRate) const
+{
+  auto uePtr = std::dynamic_pointer_cast<NrMacSchedulerUeInfoPF> (ue.first);
+  double pfMetric = std::pow (uePtr->m_potentialTputDl, uePtr->m_alpha) / std::max (1E-9, uePtr->m_avgTputDl);
+  return pfMetric / std::max (1E-9, wbRate);
+}
+
 } // namespace ns3
@@ -99,6 +99,53 @@ protected:
                              const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
   GetUeCompareUlFn () const override;
 
+  /**
+   * \brief Sort the DL UEs calling NrMacSchedulerUeInfoPF::CompareUeWeightsDl directly
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoPF::CompareUeWeightsDl
+   */
+  virtual void SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Sort the UL UEs calling NrMacSchedulerUeInfoPF::CompareUeWeightsUl directly
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoPF::CompareUeWeightsUl
+   */
+  virtual void SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Copy the DL state of the UEs of a beam, ordered by the PF metric
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return the state, or nullptr if a UE has more than one DL stream,
+   * or if a subclass sorts the UEs with another comparison function
+   */
+  virtual std::unique_ptr<NrMacSchedulerUeStateSoa>
+  CreateDlUeState (const std::vector<UePtrAndBufferReq> &ueVector, uint32_t beamSym) const override;
+
+  /**
+   * \brief Copy the UL state of the UEs of a beam, ordered by the PF metric
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return the state, or nullptr if a subclass sorts the UEs with another comparison
+   * function
+   */
+  virtual std::unique_ptr<NrMacSchedulerUeStateSoa>
+  CreateUlUeState (const std::vector<UePtrAndBufferReq> &ueVector, uint32_t beamSym) const override;
+
+  /**
+   * \brief Get the weight of a UE in the search of the best UE of each DL RBG
+   * \param ue UE and its buffer requirement
+   * \param wbRate rate of one RBG at the wideband MCS of the UE
+   * \return the PF metric of the UE divided by wbRate
+   *
+   * On an RBG at the wideband MCS, the metric is the PF metric used to sort
+   * the UEs; on the other RBG, it is scaled by the rate of the RBG.
+   */
+  virtual double GetDlRbgWeight (const UePtrAndBufferReq &ue, double wbRate) const override;
+
   /**
    * \brief Update the UE representation after a symbol (DL) has been assigned to it
    * \param ue UE to which a symbol has been assigned
@@ -80,4 +80,30 @@ NrMacSchedulerOfdmaRR::GetUeCompareUlFn () const
   return NrMacSchedulerUeInfoRR::CompareUeWeightsUl;
 }
 
+void
+NrMacSchedulerOfdmaRR::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  NrMacSchedulerUeInfoRR::SortUeDl (ueVector);
+}
+
+void
+NrMacSchedulerOfdmaRR::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  NrMacSchedulerUeInfoRR::SortUeUl (ueVector);
+}
+
+std::unique_ptr<NrMacSchedulerUeStateSoa>
+NrMacSchedulerOfdmaRR::CreateDlUeState (const std::vector<UePtrAndBufferReq> &ueVector,
+                                       uint32_t beamSym) const
+{
+  return CopyDlUeState (NrMacSchedulerUeStateSoa::RR, ueVector, beamSym);
+}
+
+std::unique_ptr<NrMacSchedulerUeStateSoa>
+NrMacSchedulerOfdmaRR::CreateUlUeState (const std::vector<UePtrAndBufferReq> &ueVector,
+                                       uint32_t beamSym) const
+{
+  return CopyUlUeState (NrMacSchedulerUeStateSoa::RR, ueVector, beamSym);
+}
+
 } // namespace ns3
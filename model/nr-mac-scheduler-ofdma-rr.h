@@ -85,6 +85,40 @@ protected:
                              const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
   GetUeCompareUlFn () const override;
 
+  /**
+   * \brief Sort the DL UEs rotating the last served one
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoRR::SortUeDl
+   */
+  virtual void SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Sort the UL UEs rotating the last served one
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoRR::SortUeUl
+   */
+  virtual void SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Copy the DL state of the UEs of a beam, ordered by the fewest RBG
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return the state, or nullptr if a UE has more than one DL stream
+   */
+  virtual std::unique_ptr<NrMacSchedulerUeStateSoa>
+  CreateDlUeState (const std::vector<UePtrAndBufferReq> &ueVector, uint32_t beamSym) const override;
+
+  /**
+   * \brief Copy the UL state of the UEs of a beam, ordered by the fewest RBG
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return the state
+   */
+  virtual std::unique_ptr<NrMacSchedulerUeStateSoa>
+  CreateUlUeState (const std::vector<UePtrAndBufferReq> &ueVector, uint32_t beamSym) const override;
+
   /**
    * \brief Update the UE representation after a symbol (DL) has been assigned to it
    * \param ue UE to which a symbol has been assigned
@@ -0,0 +1,222 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#include "nr-mac-scheduler-ofdma-shm.h"
+#include "nr-mac-scheduler-ue-info-shm.h"
+#include "nr-scheduler-shm-interface.h"
+#include <ns3/log.h>
+#include <ns3/string.h>
+#include <ns3/boolean.h>
+#include <ns3/nstime.h>
+#include <ns3/simulator.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrMacSchedulerOfdmaShm");
+NS_OBJECT_ENSURE_REGISTERED (NrMacSchedulerOfdmaShm);
+
+TypeId
+NrMacSchedulerOfdmaShm::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrMacSchedulerOfdmaShm")
+    .SetParent<NrMacSchedulerOfdmaPF> ()
+    .AddConstructor<NrMacSchedulerOfdmaShm> ()
+    .AddAttribute ("ShmName",
+                   "Name of the POSIX shared memory shared with the agent",
+                   StringValue ("/ns3-nr-scheduler"),
+                   MakeStringAccessor (&NrMacSchedulerOfdmaShm::m_shmName),
+                   MakeStringChecker ())
+    .AddAttribute ("Timeout",
+                   "Wall-clock time to wait for a decision of the agent, after which the PF metric is used",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&NrMacSchedulerOfdmaShm::m_timeout),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("Blocking",
+                   "Wait for the decision on each snapshot; otherwise, apply the last decision of the agent",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&NrMacSchedulerOfdmaShm::m_blocking),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+NrMacSchedulerOfdmaShm::NrMacSchedulerOfdmaShm () : NrMacSchedulerOfdmaPF ()
+{
+
+}
+
+NrMacSchedulerOfdmaShm::~NrMacSchedulerOfdmaShm ()
+{
+
+}
+
+uint64_t
+NrMacSchedulerOfdmaShm::GetTimeouts () const
+{
+  return m_timeouts;
+}
+
+std::shared_ptr<NrMacSchedulerUeInfo>
+NrMacSchedulerOfdmaShm::CreateUeRepresentation (const NrMacCschedSapProvider::CschedUeConfigReqParameters &params) const
+{
+  NS_LOG_FUNCTION (this);
+  return std::make_shared <NrMacSchedulerUeInfoShm> (GetFairnessIndex (),
+                                                     params.m_rnti, params.m_beamConfId,
+                                                     std::bind (&NrMacSchedulerOfdmaShm::GetNumRbPerRbg, this));
+}
+
+std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                   const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
+NrMacSchedulerOfdmaShm::GetUeCompareDlFn () const
+{
+  return NrMacSchedulerUeInfoShm::CompareUeWeightsDl;
+}
+
+std::function<bool (const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                    const NrMacSchedulerNs3::UePtrAndBufferReq &rhs)>
+NrMacSchedulerOfdmaShm::GetUeCompareUlFn () const
+{
+  return NrMacSchedulerUeInfoShm::CompareUeWeightsUl;
+}
+
+void
+NrMacSchedulerOfdmaShm::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoShm::CompareUeWeightsDl> (ueVector);
+}
+
+void
+NrMacSchedulerOfdmaShm::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoShm::CompareUeWeightsUl> (ueVector);
+}
+
+NrMacSchedulerNs3::BeamSymbolMap
+NrMacSchedulerOfdmaShm::AssignDLRBG (uint32_t symAvail, const ActiveUeMap &activeDl) const
+{
+  NS_LOG_FUNCTION (this);
+  Exchange (activeDl, true);
+  return NrMacSchedulerOfdmaPF::AssignDLRBG (symAvail, activeDl);
+}
+
+NrMacSchedulerNs3::BeamSymbolMap
+NrMacSchedulerOfdmaShm::AssignULRBG (uint32_t symAvail, const ActiveUeMap &activeUl) const
+{
+  NS_LOG_FUNCTION (this);
+  Exchange (activeUl, false);
+  return NrMacSchedulerOfdmaPF::AssignULRBG (symAvail, activeUl);
+}
+
+void
+NrMacSchedulerOfdmaShm::Exchange (const ActiveUeMap &activeUes, bool dl) const
+{
+  NS_LOG_FUNCTION (this << dl);
+  if (m_shm == nullptr)
+    {
+      m_shm = std::make_unique<NrSchedulerShmInterface> (m_shmName, NrSchedulerShmInterface::SIMULATOR);
+    }
+
+  // Fill the snapshot in place, in the shared memory
+  NrShmRegion::State *state = m_shm->NextState ();
+  state->m_timeNs = Simulator::Now ().GetNanoSeconds ();
+  state->m_direction = dl ? 0 : 1;
+  uint32_t numUes = 0;
+  for (const auto &beam : activeUes)
+    {
+      for (const auto &ue : beam.second)
+        {
+          auto uePtr = static_cast<NrMacSchedulerUeInfoShm*> (ue.first.get ());
+          (dl ? uePtr->m_dlWeight : uePtr->m_ulWeight) = -1.0;
+          if (numUes == NrShmRegion::MAX_UES)
+            {
+              NS_LOG_WARN ("More than " << NrShmRegion::MAX_UES << " active UEs, UE " <<
+                           uePtr->m_rnti << " not exported");
+              continue;
+            }
+          NrShmUeState &ueState = state->m_ues[numUes++];
+          ueState.m_rnti = uePtr->m_rnti;
+          ueState.m_beamSector = uePtr->m_beamConfId.GetFirstBeam ().GetSector ();
+          ueState.m_beamElevation = static_cast<float> (uePtr->m_beamConfId.GetFirstBeam ().GetElevation ());
+          if (dl)
+            {
+              ueState.m_wbCqi = uePtr->m_dlCqi.m_wbCqi.size () > 0 ? uePtr->m_dlCqi.m_wbCqi[0] : 0;
+              ueState.m_mcs = uePtr->m_dlMcs.size () > 0 ? uePtr->m_dlMcs[0] : 0;
+              ueState.m_activeHarq = static_cast<uint8_t> (uePtr->m_dlHarq.Size ());
+              ueState.m_avgTput = static_cast<float> (uePtr->m_avgTputDl);
+              ueState.m_potentialTput = static_cast<float> (uePtr->m_potentialTputDl);
+            }
+          else
+            {
+              ueState.m_wbCqi = 0;
+              ueState.m_mcs = uePtr->m_ulMcs;
+              ueState.m_activeHarq = static_cast<uint8_t> (uePtr->m_ulHarq.Size ());
+              ueState.m_avgTput = static_cast<float> (uePtr->m_avgTputUl);
+              ueState.m_potentialTput = static_cast<float> (uePtr->m_potentialTputUl);
+            }
+          ueState.m_reserved = 0;
+          ueState.m_bufferBytes = ue.second;
+        }
+    }
+  state->m_numUes = numUes;
+  uint64_t seq = m_shm->PublishState ();
+
+  const NrShmRegion::Decision *decision = m_blocking ?
+    m_shm->WaitDecision (seq, static_cast<uint64_t> (m_timeout.GetMicroSeconds ())) :
+    m_shm->GetLastDecision ();
+  if (decision == nullptr)
+    {
+      m_timeouts += m_blocking ? 1 : 0;
+      return;
+    }
+  if (decision->m_direction != state->m_direction)
+    {
+      // Only in the non-blocking mode: the last decision is on the other direction
+      return;
+    }
+
+  // The weights go to the UEs by RNTI, as an asynchronous decision can be
+  // on a different set of UEs. The agent usually answers in the order of the
+  // snapshot, so the entry with the same index is checked first
+  uint32_t numDecided = std::min (decision->m_numUes, NrShmRegion::MAX_UES);
+  const NrShmUeDecision *begin = decision->m_ues;
+  const NrShmUeDecision *end = decision->m_ues + numDecided;
+  uint32_t index = 0;
+  for (const auto &beam : activeUes)
+    {
+      for (const auto &ue : beam.second)
+        {
+          auto uePtr = static_cast<NrMacSchedulerUeInfoShm*> (ue.first.get ());
+          const NrShmUeDecision *it = index < numDecided ? begin + index : end;
+          ++index;
+          if (it == end || it->m_rnti != uePtr->m_rnti)
+            {
+              it = std::find_if (begin, end, [uePtr] (const NrShmUeDecision &d)
+                {
+                  return d.m_rnti == uePtr->m_rnti;
+                });
+            }
+          if (it != end)
+            {
+              (dl ? uePtr->m_dlWeight : uePtr->m_ulWeight) = it->m_weight;
+            }
+        }
+    }
+}
+
+} // namespace ns3
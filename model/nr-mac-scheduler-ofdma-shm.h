@@ -0,0 +1,145 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+#include "nr-mac-scheduler-ofdma-pf.h"
+#include <memory>
+
+namespace ns3 {
+
+class NrSchedulerShmInterface;
+
+/**
+ * \ingroup scheduler
+ * \brief Assign frequencies following the decisions of an external agent
+ *
+ * Before the RBG of a DL or UL slot are assigned, the scheduler exports a
+ * snapshot of the active UEs (beam, CQI, MCS, HARQ processes in use,
+ * buffer, PF throughputs) through a NrSchedulerShmInterface, with the name
+ * of the attribute "ShmName", and waits for the decision of the agent: a
+ * weight per UE. The UEs are then served in decreasing weight, as the PF
+ * scheduler does with its metric; the UEs without a weight come after, by
+ * PF metric. The throughputs exported are the ones of the last slot in
+ * which the UE was considered.
+ *
+ * If the attribute "Blocking" is true, the simulation waits for the
+ * decision on each snapshot up to the wall-clock "Timeout"; a decision that
+ * does not arrive in time is replaced by the PF metric. Otherwise, the
+ * scheduler applies the last decision published by the agent, if any, and
+ * the agent runs asynchronously.
+ *
+ * The simulator creates the shared memory the first time it schedules; the
+ * agent has to open it afterwards, and then poll for the states.
+ */
+class NrMacSchedulerOfdmaShm : public NrMacSchedulerOfdmaPF
+{
+public:
+  /**
+   * \brief GetTypeId
+   * \return The TypeId of the class
+   */
+  static TypeId GetTypeId (void);
+  /**
+   * \brief NrMacSchedulerOfdmaShm constructor
+   */
+  NrMacSchedulerOfdmaShm ();
+
+  /**
+   * \brief ~NrMacSchedulerOfdmaShm deconstructor
+   */
+  virtual ~NrMacSchedulerOfdmaShm () override;
+
+  /**
+   * \brief Get the number of snapshots whose decision did not arrive in time
+   * \return the number of timeouts
+   */
+  uint64_t GetTimeouts () const;
+
+protected:
+  // inherit
+  /**
+   * \brief Create an UE representation of the type NrMacSchedulerUeInfoShm
+   * \param params parameters
+   * \return NrMacSchedulerUeInfoShm instance
+   */
+  virtual std::shared_ptr<NrMacSchedulerUeInfo>
+  CreateUeRepresentation (const NrMacCschedSapProvider::CschedUeConfigReqParameters& params) const override;
+
+  /**
+   * \brief Return the comparison function to sort DL UE according to the scheduler policy
+   * \return a pointer to NrMacSchedulerUeInfoShm::CompareUeWeightsDl
+   */
+  virtual std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                             const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
+  GetUeCompareDlFn () const override;
+
+  /**
+   * \brief Return the comparison function to sort UL UE according to the scheduler policy
+   * \return a pointer to NrMacSchedulerUeInfoShm::CompareUeWeightsUl
+   */
+  virtual std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                             const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
+  GetUeCompareUlFn () const override;
+
+  /**
+   * \brief Sort the DL UEs calling NrMacSchedulerUeInfoShm::CompareUeWeightsDl directly
+   * \param ueVector the UEs to sort
+   */
+  virtual void SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Sort the UL UEs calling NrMacSchedulerUeInfoShm::CompareUeWeightsUl directly
+   * \param ueVector the UEs to sort
+   */
+  virtual void SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Exchange the DL snapshot with the agent, and then assign the RBG
+   * \param symAvail Number of available symbols
+   * \param activeDl Map of active DL UE and their beam
+   * \return the symbols of each beam
+   */
+  virtual BeamSymbolMap
+  AssignDLRBG (uint32_t symAvail, const ActiveUeMap &activeDl) const override;
+
+  /**
+   * \brief Exchange the UL snapshot with the agent, and then assign the RBG
+   * \param symAvail Number of available symbols
+   * \param activeUl Map of active UL UE and their beam
+   * \return the symbols of each beam
+   */
+  virtual BeamSymbolMap
+  AssignULRBG (uint32_t symAvail, const ActiveUeMap &activeUl) const override;
+
+private:
+  /**
+   * \brief Export the snapshot of the active UEs, and set their weights
+   * from the decision of the agent
+   * \param activeUes the active UEs
+   * \param dl true for the DL, false for the UL
+   */
+  void Exchange (const ActiveUeMap &activeUes, bool dl) const;
+
+  std::string m_shmName;                                   //!< Name of the shared memory (attribute)
+  Time m_timeout;                                          //!< Wall-clock timeout of a decision (attribute)
+  bool m_blocking {true};                                  //!< Whether to wait for each decision (attribute)
+  mutable std::unique_ptr<NrSchedulerShmInterface> m_shm;  //!< The interface, created at the first slot
+  mutable uint64_t m_timeouts {0};                         //!< Decisions that did not arrive in time
+};
+
+} // namespace ns3
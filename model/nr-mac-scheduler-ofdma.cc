@@ -27,7 +27,13 @@
 
 #include "nr-mac-scheduler-ofdma.h"
 #include <ns3/log.h>
+#include <ns3/enum.h>
+#include <ns3/boolean.h>
+#include <ns3/double.h>
+#include <ns3/uinteger.h>
 #include <algorithm>
+#include <cmath>
+#include <numeric>
 
 namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("NrMacSchedulerOfdma");
@@ -42,6 +48,42 @@ NrMacSchedulerOfdma::GetTypeId (void)
                      "Number of assigned symbol per beam. Gets called every time an assignment is made",
                      MakeTraceSourceAccessor (&NrMacSchedulerOfdma::m_tracedValueSymPerBeam),
                      "ns3::TracedValueCallback::Uint32")
+    .AddAttribute ("RbgAssignmentMode",
+                   "Algorithm used to distribute the RBG of a beam among its UEs. "
+                   "SortLoop sorts all the UEs for each RBG, while Heap keeps the UEs "
+                   "in a heap and updates only the UE that received the RBG. BestRbg "
+                   "gives each DL RBG to the UE with the best metric on that RBG, "
+                   "using the sub-band CQI of the UEs (only for the PF and MR "
+                   "schedulers; the UL, and the other schedulers, use SortLoop). Soa "
+                   "copies the state of the UEs of a beam in contiguous arrays, and "
+                   "searches the UE of each RBG in them (only for the RR, PF and MR "
+                   "schedulers, without DL MIMO; otherwise, it is as Heap).",
+                   EnumValue (NrMacSchedulerOfdma::SORT_LOOP),
+                   MakeEnumAccessor (&NrMacSchedulerOfdma::SetRbgAssignmentMode,
+                                     &NrMacSchedulerOfdma::GetRbgAssignmentMode),
+                   MakeEnumChecker (NrMacSchedulerOfdma::SORT_LOOP, "SortLoop",
+                                    NrMacSchedulerOfdma::HEAP, "Heap",
+                                    NrMacSchedulerOfdma::BEST_RBG, "BestRbg",
+                                    NrMacSchedulerOfdma::SOA, "Soa"))
+    .AddAttribute ("MuMimo",
+                   "Schedule on the same DL symbols and RBGs the beams whose "
+                   "coupling is below MuMimoCouplingThreshold, each as a "
+                   "different layer (multi-user MIMO). The UL is not affected.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrMacSchedulerOfdma::SetMuMimo,
+                                        &NrMacSchedulerOfdma::GetMuMimo),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MuMimoCouplingThreshold",
+                   "Maximum coupling (dB), i.e., normalized gain of the beamforming "
+                   "vector of a beam toward another, between the beams of a MU-MIMO group",
+                   DoubleValue (-15.0),
+                   MakeDoubleAccessor (&NrMacSchedulerOfdma::m_muMimoCouplingThreshold),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("MuMimoMaxLayers",
+                   "Maximum number of beams of a MU-MIMO group",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&NrMacSchedulerOfdma::m_muMimoMaxLayers),
+                   MakeUintegerChecker<uint8_t> (1, 8))
   ;
   return tid;
 }
@@ -50,6 +92,102 @@ NrMacSchedulerOfdma::NrMacSchedulerOfdma () : NrMacSchedulerTdma ()
 {
 }
 
+void
+NrMacSchedulerOfdma::SetRbgAssignmentMode (RbgAssignmentMode mode)
+{
+  NS_LOG_FUNCTION (this);
+  m_rbgAssignmentMode = mode;
+}
+
+NrMacSchedulerOfdma::RbgAssignmentMode
+NrMacSchedulerOfdma::GetRbgAssignmentMode () const
+{
+  NS_LOG_FUNCTION (this);
+  return m_rbgAssignmentMode;
+}
+
+void
+NrMacSchedulerOfdma::SetMuMimo (bool enable)
+{
+  NS_LOG_FUNCTION (this << enable);
+  m_muMimo = enable;
+}
+
+bool
+NrMacSchedulerOfdma::GetMuMimo () const
+{
+  return m_muMimo;
+}
+
+bool
+NrMacSchedulerOfdma::IsDlUeSatisfied (const UePtrAndBufferReq &ue) const
+{
+  GetFirst GetUe;
+  uint32_t bufQueueSize = ue.second;
+
+  //if there are two streams we add the TbSizes of the two
+  //streams to satisfy the bufQueueSize
+  uint32_t tbSize = 0;
+  for (const auto &it:GetUe (ue)->m_dlTbSize)
+    {
+      tbSize += it;
+    }
+
+  if (tbSize < std::max (bufQueueSize, 10U))
+    {
+      return false;
+    }
+
+  if (GetUe (ue)->m_dlTbSize.size () > 1)
+    {
+      // This "if" is purely for MIMO. In MIMO, for example, if the
+      // first TB size is big enough to empty the buffer then we
+      // should not allocate anything to the second stream. In this
+      // case, if we allocate bytes to the second stream, the UE
+      // would expect the TB but the gNB would not be able to transmit
+      // it. This would break HARQ TX state machine at UE PHY.
+
+      uint8_t streamCounter = 0;
+      uint32_t copyBufQueueSize = bufQueueSize;
+      auto dlTbSizeIt = GetUe (ue)->m_dlTbSize.begin ();
+      while (dlTbSizeIt != GetUe (ue)->m_dlTbSize.end ())
+        {
+          if (copyBufQueueSize != 0)
+            {
+              NS_LOG_DEBUG ("Stream " << +streamCounter << " with TB size " << *dlTbSizeIt << " needed to TX MIMO TB");
+              if (*dlTbSizeIt >= copyBufQueueSize)
+                {
+                  copyBufQueueSize = 0;
+                }
+              else
+                {
+                  copyBufQueueSize = copyBufQueueSize - *dlTbSizeIt;
+                }
+              streamCounter++;
+              dlTbSizeIt++;
+            }
+          else
+            {
+              // if we are here, that means previously iterated
+              // streams were enough to empty the buffer. We do
+              // not need this stream. Make its TB size zero.
+              NS_LOG_DEBUG ("Stream " << +streamCounter << " with TB size " << *dlTbSizeIt << " not needed to TX MIMO TB");
+              *dlTbSizeIt = 0;
+              streamCounter++;
+              dlTbSizeIt++;
+            }
+        }
+    }
+  return true;
+}
+
+bool
+NrMacSchedulerOfdma::IsUlUeSatisfied (const UePtrAndBufferReq &ue) const
+{
+  GetFirst GetUe;
+  return GetUe (ue)->m_ulTbSize >= std::max (ue.second, 12U);
+}
+
 /**
  *
  * \brief Calculate the number of symbols to assign to each beam
@@ -132,6 +270,141 @@ NrMacSchedulerOfdma::GetSymPerBeam (uint32_t symAvail,
   return ret;
 }
 
+/**
+ * \return the sum of the buffers of the UEs of a beam
+ * \param ueVector the UEs of the beam
+ */
+static uint32_t
+GetBeamBufSize (const std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> &ueVector)
+{
+  uint32_t bufSize = 0;
+  for (const auto &ue : ueVector)
+    {
+      bufSize += ue.second;
+    }
+  return bufSize;
+}
+
+std::vector<std::vector<BeamConfId> >
+NrMacSchedulerOfdma::GroupDlBeams (const ActiveUeMap &activeDl) const
+{
+  NS_LOG_FUNCTION (this);
+
+  std::vector<std::pair<BeamConfId, uint32_t> > beams;
+  beams.reserve (activeDl.size ());
+  for (const auto &el : activeDl)
+    {
+      beams.emplace_back (el.first, GetBeamBufSize (el.second));
+    }
+  std::stable_sort (beams.begin (), beams.end (),
+                    [] (const std::pair<BeamConfId, uint32_t> &a,
+                        const std::pair<BeamConfId, uint32_t> &b)
+                    {
+                      return a.second > b.second;
+                    });
+
+  const double threshold = std::pow (10.0, m_muMimoCouplingThreshold / 10.0);
+  std::vector<bool> grouped (beams.size (), false);
+  std::vector<std::vector<BeamConfId> > groups;
+
+  for (size_t i = 0; i < beams.size (); ++i)
+    {
+      if (grouped.at (i))
+        {
+          continue;
+        }
+      std::vector<BeamConfId> group {beams.at (i).first};
+      grouped.at (i) = true;
+
+      for (size_t j = i + 1; j < beams.size () && group.size () < m_muMimoMaxLayers; ++j)
+        {
+          if (grouped.at (j))
+            {
+              continue;
+            }
+          bool separated = std::all_of (group.begin (), group.end (),
+                                        [&] (const BeamConfId &member)
+                                        {
+                                          double coupling = m_macSchedSapUser->GetBeamCoupling (member, beams.at (j).first);
+                                          return coupling >= 0.0 && coupling <= threshold;
+                                        });
+          if (separated)
+            {
+              group.push_back (beams.at (j).first);
+              grouped.at (j) = true;
+            }
+        }
+
+      NS_LOG_DEBUG ("MU-MIMO group of " << group.size () << " beams, starting from beam " <<
+                    group.front ());
+      groups.emplace_back (std::move (group));
+    }
+
+  return groups;
+}
+
+NrMacSchedulerNs3::BeamSymbolMap
+NrMacSchedulerOfdma::GetSymPerBeamGroup (uint32_t symAvail, const ActiveUeMap &activeDl,
+                                         const std::vector<std::vector<BeamConfId> > &groups) const
+{
+  NS_LOG_FUNCTION (this);
+
+  std::vector<uint32_t> groupBuf;
+  std::vector<uint32_t> groupSym;
+  groupBuf.reserve (groups.size ());
+  double bufTotal = 0.0;
+  uint32_t symUsed = 0;
+
+  for (const auto &group : groups)
+    {
+      uint32_t bufSize = 0;
+      for (const auto &beam : group)
+        {
+          bufSize = std::max (bufSize, GetBeamBufSize (activeDl.at (beam)));
+        }
+      groupBuf.push_back (bufSize);
+      bufTotal += bufSize;
+    }
+
+  for (uint32_t bufSize : groupBuf)
+    {
+      uint32_t sym = static_cast<uint32_t> (bufSize * (symAvail / bufTotal));
+      groupSym.push_back (sym);
+      symUsed += sym;
+    }
+
+  NS_ASSERT (symAvail >= symUsed);
+  for (uint32_t i = symUsed; i < symAvail && !groupSym.empty (); ++i)
+    {
+      auto min = std::min_element (groupSym.begin (), groupSym.end ());
+      *min += 1;
+    }
+
+  BeamSymbolMap ret;
+  for (size_t i = 0; i < groups.size (); ++i)
+    {
+      for (const auto &beam : groups.at (i))
+        {
+          ret.emplace (beam, groupSym.at (i));
+        }
+      NS_LOG_DEBUG ("Assigned to the group of beam " << groups.at (i).front () <<
+                    " symbols " << groupSym.at (i));
+      const_cast<NrMacSchedulerOfdma*> (this)->m_tracedValueSymPerBeam = groupSym.at (i);
+    }
+
+  return ret;
+}
+
+std::vector<std::vector<BeamConfId> >
+NrMacSchedulerOfdma::GetDlBeamGroups (const ActiveUeMap &activeDl) const
+{
+  if (m_muMimo)
+    {
+      return m_dlBeamGroups;
+    }
+  return NrMacSchedulerTdma::GetDlBeamGroups (activeDl);
+}
+
 /**
  * \brief Assign the available DL RBG to the UEs
  * \param symAvail Available symbols
@@ -151,11 +424,18 @@ NrMacSchedulerOfdma::GetSymPerBeam (uint32_t symAvail,
  *    UpdateUeDlMetric (ueVector.first());
  * </pre>
  *
- * To sort the UEs, the method uses the function returned by GetUeCompareDlFn().
+ * To sort the UEs, the method uses SortUeDl().
  * Two fairness helper are hard-coded in the method: the first one is avoid
  * to assign resources to UEs that already have their buffer requirement covered,
  * and the other one is avoid to assign symbols when all the UEs have their
  * requirements covered.
+ *
+ * If the attribute RbgAssignmentMode is set to Heap, the RBG of each beam
+ * are distributed by AssignDLRBGHeap(), which avoids the sort for every RBG.
+ * If it is set to BestRbg, and the scheduler supports it, they are
+ * distributed by AssignDLRBGBest(), which also chooses which RBG each UE gets.
+ * If it is set to Soa, they are distributed by AssignDLRBGSoa() or, if the
+ * scheduler does not support it, by AssignDLRBGHeap().
  */
 NrMacSchedulerNs3::BeamSymbolMap
 NrMacSchedulerOfdma::AssignDLRBG (uint32_t symAvail, const ActiveUeMap &activeDl) const
@@ -166,7 +446,17 @@ NrMacSchedulerOfdma::AssignDLRBG (uint32_t symAvail, const ActiveUeMap &activeDl
 
   GetFirst GetBeamId;
   GetSecond GetUeVector;
-  BeamSymbolMap symPerBeam = GetSymPerBeam (symAvail, activeDl);
+  BeamSymbolMap symPerBeam;
+  if (m_muMimo)
+    {
+      // The beams of a group get the same symbols, and all the RBGs
+      m_dlBeamGroups = GroupDlBeams (activeDl);
+      symPerBeam = GetSymPerBeamGroup (symAvail, activeDl, m_dlBeamGroups);
+    }
+  else
+    {
+      symPerBeam = GetSymPerBeam (symAvail, activeDl);
+    }
 
   // Iterate through the different beams
   for (const auto &el : activeDl)
@@ -176,10 +466,8 @@ NrMacSchedulerOfdma::AssignDLRBG (uint32_t symAvail, const ActiveUeMap &activeDl
       uint32_t rbgAssignable = 1 * beamSym;
       std::vector<UePtrAndBufferReq> ueVector;
       FTResources assigned (0,0);
-      const std::vector<uint8_t> dlNotchedRBGsMask = GetDlNotchedRbgMask ();
-      uint32_t resources = dlNotchedRBGsMask.size () > 0 ? std::count (dlNotchedRBGsMask.begin (),
-                                                                     dlNotchedRBGsMask.end (),
-                                                                     1) : GetBandwidthInRbg ();
+      const NrBitset &dlNotchedRBGsMask = GetDlNotchedRbgMask ();
+      uint32_t resources = dlNotchedRBGsMask.size () > 0 ? dlNotchedRBGsMask.count () : GetBandwidthInRbg ();
       NS_ASSERT (resources > 0);
 
       for (const auto &ue : GetUeVector (el))
@@ -192,73 +480,32 @@ NrMacSchedulerOfdma::AssignDLRBG (uint32_t symAvail, const ActiveUeMap &activeDl
           BeforeDlSched (ue, FTResources (rbgAssignable * beamSym, beamSym));
         }
 
+      if (GetRbgAssignmentModeInUse () == SOA && AssignDLRBGSoa (&ueVector, beamSym, resources))
+        {
+          continue;
+        }
+
+      if (GetRbgAssignmentModeInUse () == HEAP || GetRbgAssignmentModeInUse () == SOA)
+        {
+          AssignDLRBGHeap (&ueVector, beamSym, resources);
+          continue;
+        }
+
+      if (GetRbgAssignmentModeInUse () == BEST_RBG && AssignDLRBGBest (&ueVector, beamSym))
+        {
+          continue;
+        }
+
       while (resources > 0)
         {
           GetFirst GetUe;
-          std::sort (ueVector.begin (), ueVector.end (), GetUeCompareDlFn ());
+          SortUeDl (&ueVector);
           auto schedInfoIt = ueVector.begin ();
 
           // Ensure fairness: pass over UEs which already has enough resources to transmit
-          while (schedInfoIt != ueVector.end ())
+          while (schedInfoIt != ueVector.end () && IsDlUeSatisfied (*schedInfoIt))
             {
-              uint32_t bufQueueSize = schedInfoIt->second;
-
-              //if there are two streams we add the TbSizes of the two
-              //streams to satisfy the bufQueueSize
-              uint32_t tbSize = 0;
-              for (const auto &it:GetUe (*schedInfoIt)->m_dlTbSize)
-                {
-                  tbSize += it;
-                }
-
-              if (tbSize >= std::max (bufQueueSize, 10U))
-                {
-                  if (GetUe (*schedInfoIt)->m_dlTbSize.size () > 1)
-                    {
-                      // This "if" is purely for MIMO. In MIMO, for example, if the
-                      // first TB size is big enough to empty the buffer then we
-                      // should not allocate anything to the second stream. In this
-                      // case, if we allocate bytes to the second stream, the UE
-                      // would expect the TB but the gNB would not be able to transmit
-                      // it. This would break HARQ TX state machine at UE PHY.
-
-                      uint8_t streamCounter = 0;
-                      uint32_t copyBufQueueSize = bufQueueSize;
-                      auto dlTbSizeIt = GetUe (*schedInfoIt)->m_dlTbSize.begin ();
-                      while (dlTbSizeIt != GetUe (*schedInfoIt)->m_dlTbSize.end ())
-                        {
-                          if (copyBufQueueSize != 0)
-                            {
-                              NS_LOG_DEBUG ("Stream " << +streamCounter << " with TB size " << *dlTbSizeIt << " needed to TX MIMO TB");
-                              if (*dlTbSizeIt >= copyBufQueueSize)
-                                {
-                                  copyBufQueueSize = 0;
-                                }
-                              else
-                                {
-                                  copyBufQueueSize = copyBufQueueSize - *dlTbSizeIt;
-                                }
-                              streamCounter++;
-                              dlTbSizeIt++;
-                            }
-                          else
-                            {
-                              // if we are here, that means previously iterated
-                              // streams were enough to empty the buffer. We do
-                              // not need this stream. Make its TB size zero.
-                              NS_LOG_DEBUG ("Stream " << +streamCounter << " with TB size " << *dlTbSizeIt << " not needed to TX MIMO TB");
-                              *dlTbSizeIt = 0;
-                              streamCounter++;
-                              dlTbSizeIt++;
-                            }
-                        }
-                    }
-                  schedInfoIt++;
-                }
-              else
-                {
-                  break;
-                }
+              schedInfoIt++;
             }
 
           // In the case that all the UE already have their requirements fullfilled,
@@ -324,10 +571,8 @@ NrMacSchedulerOfdma::AssignULRBG (uint32_t symAvail, const ActiveUeMap &activeUl
       uint32_t rbgAssignable = 1 * beamSym;
       std::vector<UePtrAndBufferReq> ueVector;
       FTResources assigned (0,0);
-      const std::vector<uint8_t> ulNotchedRBGsMask = GetUlNotchedRbgMask ();
-      uint32_t resources = ulNotchedRBGsMask.size () > 0 ? std::count (ulNotchedRBGsMask.begin (),
-                                                                     ulNotchedRBGsMask.end (),
-                                                                     1) : GetBandwidthInRbg ();
+      const NrBitset &ulNotchedRBGsMask = GetUlNotchedRbgMask ();
+      uint32_t resources = ulNotchedRBGsMask.size () > 0 ? ulNotchedRBGsMask.count () : GetBandwidthInRbg ();
       NS_ASSERT (resources > 0);
 
       for (const auto &ue : GetUeVector (el))
@@ -340,24 +585,27 @@ NrMacSchedulerOfdma::AssignULRBG (uint32_t symAvail, const ActiveUeMap &activeUl
           BeforeUlSched (ue, FTResources (rbgAssignable * beamSym, beamSym));
         }
 
+      if (GetRbgAssignmentModeInUse () == SOA && AssignULRBGSoa (&ueVector, beamSym, resources))
+        {
+          continue;
+        }
+
+      if (GetRbgAssignmentModeInUse () == HEAP || GetRbgAssignmentModeInUse () == SOA)
+        {
+          AssignULRBGHeap (&ueVector, beamSym, resources);
+          continue;
+        }
+
       while (resources > 0)
         {
           GetFirst GetUe;
-          std::sort (ueVector.begin (), ueVector.end (), GetUeCompareUlFn ());
+          SortUeUl (&ueVector);
           auto schedInfoIt = ueVector.begin ();
 
           // Ensure fairness: pass over UEs which already has enough resources to transmit
-          while (schedInfoIt != ueVector.end ())
+          while (schedInfoIt != ueVector.end () && IsUlUeSatisfied (*schedInfoIt))
             {
-              uint32_t bufQueueSize = schedInfoIt->second;
-              if (GetUe (*schedInfoIt)->m_ulTbSize >= std::max (bufQueueSize, 12U))
-                {
-                  schedInfoIt++;
-                }
-              else
-                {
-                  break;
-                }
+              schedInfoIt++;
             }
 
           // In the case that all the UE already have their requirements fullfilled,
@@ -399,6 +647,682 @@ NrMacSchedulerOfdma::AssignULRBG (uint32_t symAvail, const ActiveUeMap &activeUl
   return symPerBeam;
 }
 
+/**
+ * \brief Assign the available DL RBG of a beam, keeping the UEs in a heap
+ * \param ueVector UEs of the beam
+ * \param beamSym symbols assigned to the beam
+ * \param resources RBG available for the beam
+ *
+ * The result is the same as the one of the loop in AssignDLRBG(), but
+ * instead of sorting the entire UE vector for every RBG, the UEs are kept in
+ * a heap ordered by the function returned by GetUeCompareDlFn(), and only
+ * the UE that received the RBG is re-keyed, making each RBG assignment
+ * O(log U) instead of O(U log U).
+ *
+ * The std heap functions do not keep the order of the UEs with the same
+ * priority, so the ties are broken by a rank that follows the order of the
+ * UEs in the vector of the loop. The results are therefore the same when
+ * SortUeDl() is a stable sort: always for the RR and MR schedulers, and up
+ * to 16 UEs in a beam for the others, which use std::sort.
+ *
+ * The method relies on NotAssignedDlResources() being idempotent for an UE
+ * whose resources did not change, as it is for the RR, PF, and MR schedulers.
+ * Therefore, the metric of the UEs that did not get any resource is updated
+ * only twice: after the first assignment (the first time the total
+ * assigned resources are known) and in one batch pass at the end of the beam.
+ * IsDlUeSatisfied(), which changes the TB sizes of the MIMO UEs, is called
+ * on the same UEs and at the same points as in the loop.
+ */
+void
+NrMacSchedulerOfdma::AssignDLRBGHeap (std::vector<UePtrAndBufferReq> *ueVector,
+                                       uint32_t beamSym, uint32_t resources) const
+{
+  NS_LOG_FUNCTION (this);
+
+  GetFirst GetUe;
+  uint32_t rbgAssignable = 1 * beamSym;
+  FTResources assigned (0,0);
+  std::shared_ptr<NrMacSchedulerUeInfo> lastAssigned = nullptr;
+
+  // The heap holds the indexes of the UEs in ueVector. The UEs with the same
+  // priority are ordered by their rank, which is their position in the
+  // vector of the sorting loop: at first their index, then the order of the
+  // first sort, and a served UE stays before the UEs it ties with, as in a
+  // stable sort.
+  std::vector<int64_t> rank (ueVector->size ());
+  std::iota (rank.begin (), rank.end (), 0);
+  int64_t frontRank = 0;
+
+  // The std heap functions keep the greatest element on the front. Invert the
+  // comparison function to keep on the front the UE with the highest priority
+  const auto compareFn = GetUeCompareDlFn ();
+  auto heapCompareFn = [&compareFn, &rank, ueVector] (size_t lhs, size_t rhs)
+    {
+      if (compareFn (ueVector->at (rhs), ueVector->at (lhs)))
+        {
+          return true;
+        }
+      return ! compareFn (ueVector->at (lhs), ueVector->at (rhs)) && rank[rhs] < rank[lhs];
+    };
+
+  std::vector<size_t> heap (ueVector->size ());
+  std::iota (heap.begin (), heap.end (), 0);
+  std::make_heap (heap.begin (), heap.end (), heapCompareFn);
+
+  while (resources > 0)
+    {
+      // Ensure fairness: remove the UEs which already have enough resources to
+      // transmit. Their TB size does not change anymore in this beam.
+      while (! heap.empty () && IsDlUeSatisfied (ueVector->at (heap.front ())))
+        {
+          std::pop_heap (heap.begin (), heap.end (), heapCompareFn);
+          heap.pop_back ();
+        }
+
+      // In the case that all the UE already have their requirements fullfilled,
+      // then stop the beam processing and pass to the next
+      if (heap.empty ())
+        {
+          break;
+        }
+
+      if (lastAssigned == nullptr)
+        {
+          // Rank the UEs in the order of the first sort of the loop, which
+          // the metric updates of the first assignment do not change
+          std::vector<size_t> order (heap);
+          std::sort (order.begin (), order.end (), [&heapCompareFn] (size_t lhs, size_t rhs)
+            {
+              return heapCompareFn (rhs, lhs);
+            });
+          for (size_t k = 0; k < order.size (); ++k)
+            {
+              rank[order[k]] = static_cast<int64_t> (k);
+            }
+        }
+
+      const UePtrAndBufferReq &ue = ueVector->at (heap.front ());
+      rank[heap.front ()] = --frontRank;
+
+      // Assign 1 RBG for each available symbols for the beam,
+      // and then update the count of available resources
+      GetUe (ue)->m_dlRBG += rbgAssignable;
+      assigned.m_rbg += rbgAssignable;
+
+      GetUe (ue)->m_dlSym = beamSym;
+      assigned.m_sym = beamSym;
+
+      resources -= 1; // Resources are RBG, so they do not consider the beamSym
+
+      NS_LOG_DEBUG ("Assigned " << rbgAssignable <<
+                    " DL RBG, spanned over " << beamSym << " SYM, to UE " <<
+                    GetUe (ue)->m_rnti);
+      AssignedDlResources (ue, FTResources (rbgAssignable, beamSym), assigned);
+
+      bool firstAssignment = (lastAssigned == nullptr);
+      lastAssigned = GetUe (ue);
+
+      if (firstAssignment)
+        {
+          // The total assigned resources are now known: update the metrics of
+          // all the other UEs once, and rebuild the heap from scratch
+          for (const auto & other : *ueVector)
+            {
+              if (GetUe (other) != lastAssigned)
+                {
+                  NotAssignedDlResources (other, FTResources (rbgAssignable, beamSym),
+                                          assigned);
+                }
+            }
+          std::make_heap (heap.begin (), heap.end (), heapCompareFn);
+        }
+      else
+        {
+          // Only the metric of the UE on the front changed: sift it down
+          std::pop_heap (heap.begin (), heap.end (), heapCompareFn);
+          std::push_heap (heap.begin (), heap.end (), heapCompareFn);
+        }
+    }
+
+  if (lastAssigned == nullptr)
+    {
+      return;
+    }
+
+  // Batch pass: the final state of each UE is the one it would have had after
+  // the last NotAssigned call of the sorting loop
+  for (const auto & ue : *ueVector)
+    {
+      if (GetUe (ue) != lastAssigned)
+        {
+          NotAssignedDlResources (ue, FTResources (rbgAssignable, beamSym), assigned);
+        }
+    }
+
+  // IsDlUeSatisfied clears the TB size of the MIMO streams that are not
+  // needed. The sorting loop calls it on the UEs it passes over, as the heap
+  // does when it removes them, and on all the UEs only when it stops because
+  // they are all satisfied. When it stops because the RBGs are over, the
+  // state is the one left by the last Assigned/NotAssigned calls.
+  if (heap.empty ())
+    {
+      for (const auto & ue : *ueVector)
+        {
+          IsDlUeSatisfied (ue);
+        }
+    }
+}
+
+/**
+ * \brief Assign the available UL RBG of a beam, keeping the UEs in a heap
+ * \param ueVector UEs of the beam
+ * \param beamSym symbols assigned to the beam
+ * \param resources RBG available for the beam
+ *
+ * The result is the same as the one of the loop in AssignULRBG(), but
+ * instead of sorting the entire UE vector for every RBG, the UEs are kept in
+ * a heap ordered by the function returned by GetUeCompareUlFn(), and only
+ * the UE that received the RBG is re-keyed, making each RBG assignment
+ * O(log U) instead of O(U log U).
+ *
+ * The std heap functions do not keep the order of the UEs with the same
+ * priority, so the ties are broken by a rank that follows the order of the
+ * UEs in the vector of the loop. The results are therefore the same when
+ * SortUeUl() is a stable sort: always for the RR and MR schedulers, and up
+ * to 16 UEs in a beam for the others, which use std::sort.
+ *
+ * The method relies on NotAssignedUlResources() being idempotent for an UE
+ * whose resources did not change, as it is for the RR, PF, and MR schedulers.
+ * Therefore, the metric of the UEs that did not get any resource is updated
+ * only twice: after the first assignment (the first time the total
+ * assigned resources are known) and in one batch pass at the end of the beam.
+ */
+void
+NrMacSchedulerOfdma::AssignULRBGHeap (std::vector<UePtrAndBufferReq> *ueVector,
+                                       uint32_t beamSym, uint32_t resources) const
+{
+  NS_LOG_FUNCTION (this);
+
+  GetFirst GetUe;
+  uint32_t rbgAssignable = 1 * beamSym;
+  FTResources assigned (0,0);
+  std::shared_ptr<NrMacSchedulerUeInfo> lastAssigned = nullptr;
+
+  // The heap holds the indexes of the UEs in ueVector. The UEs with the same
+  // priority are ordered by their rank, which is their position in the
+  // vector of the sorting loop: at first their index, then the order of the
+  // first sort, and a served UE stays before the UEs it ties with, as in a
+  // stable sort.
+  std::vector<int64_t> rank (ueVector->size ());
+  std::iota (rank.begin (), rank.end (), 0);
+  int64_t frontRank = 0;
+
+  // The std heap functions keep the greatest element on the front. Invert the
+  // comparison function to keep on the front the UE with the highest priority
+  const auto compareFn = GetUeCompareUlFn ();
+  auto heapCompareFn = [&compareFn, &rank, ueVector] (size_t lhs, size_t rhs)
+    {
+      if (compareFn (ueVector->at (rhs), ueVector->at (lhs)))
+        {
+          return true;
+        }
+      return ! compareFn (ueVector->at (lhs), ueVector->at (rhs)) && rank[rhs] < rank[lhs];
+    };
+
+  std::vector<size_t> heap (ueVector->size ());
+  std::iota (heap.begin (), heap.end (), 0);
+  std::make_heap (heap.begin (), heap.end (), heapCompareFn);
+
+  while (resources > 0)
+    {
+      // Ensure fairness: remove the UEs which already have enough resources to
+      // transmit. Their TB size does not change anymore in this beam.
+      while (! heap.empty () && IsUlUeSatisfied (ueVector->at (heap.front ())))
+        {
+          std::pop_heap (heap.begin (), heap.end (), heapCompareFn);
+          heap.pop_back ();
+        }
+
+      // In the case that all the UE already have their requirements fullfilled,
+      // then stop the beam processing and pass to the next
+      if (heap.empty ())
+        {
+          break;
+        }
+
+      if (lastAssigned == nullptr)
+        {
+          // Rank the UEs in the order of the first sort of the loop, which
+          // the metric updates of the first assignment do not change
+          std::vector<size_t> order (heap);
+          std::sort (order.begin (), order.end (), [&heapCompareFn] (size_t lhs, size_t rhs)
+            {
+              return heapCompareFn (rhs, lhs);
+            });
+          for (size_t k = 0; k < order.size (); ++k)
+            {
+              rank[order[k]] = static_cast<int64_t> (k);
+            }
+        }
+
+      const UePtrAndBufferReq &ue = ueVector->at (heap.front ());
+      rank[heap.front ()] = --frontRank;
+
+      // Assign 1 RBG for each available symbols for the beam,
+      // and then update the count of available resources
+      GetUe (ue)->m_ulRBG += rbgAssignable;
+      assigned.m_rbg += rbgAssignable;
+
+      GetUe (ue)->m_ulSym = beamSym;
+      assigned.m_sym = beamSym;
+
+      resources -= 1; // Resources are RBG, so they do not consider the beamSym
+
+      NS_LOG_DEBUG ("Assigned " << rbgAssignable <<
+                    " UL RBG, spanned over " << beamSym << " SYM, to UE " <<
+                    GetUe (ue)->m_rnti);
+      AssignedUlResources (ue, FTResources (rbgAssignable, beamSym), assigned);
+
+      bool firstAssignment = (lastAssigned == nullptr);
+      lastAssigned = GetUe (ue);
+
+      if (firstAssignment)
+        {
+          // The total assigned resources are now known: update the metrics of
+          // all the other UEs once, and rebuild the heap from scratch
+          for (const auto & other : *ueVector)
+            {
+              if (GetUe (other) != lastAssigned)
+                {
+                  NotAssignedUlResources (other, FTResources (rbgAssignable, beamSym),
+                                          assigned);
+                }
+            }
+          std::make_heap (heap.begin (), heap.end (), heapCompareFn);
+        }
+      else
+        {
+          // Only the metric of the UE on the front changed: sift it down
+          std::pop_heap (heap.begin (), heap.end (), heapCompareFn);
+          std::push_heap (heap.begin (), heap.end (), heapCompareFn);
+        }
+    }
+
+  if (lastAssigned == nullptr)
+    {
+      return;
+    }
+
+  // Batch pass: the final state of each UE is the one it would have had after
+  // the last NotAssigned call of the sorting loop
+  for (const auto & ue : *ueVector)
+    {
+      if (GetUe (ue) != lastAssigned)
+        {
+          NotAssignedUlResources (ue, FTResources (rbgAssignable, beamSym), assigned);
+        }
+    }
+}
+
+/**
+ * \brief Distribute the DL RBG of a beam giving each RBG to the best UE
+ * \param ueVector UEs of the beam
+ * \param beamSym symbols assigned to the beam
+ * \return false if the scheduler does not support the search
+ *
+ * The allowed RBG are visited in order, and each one goes to the UE, among
+ * those whose requirements are not covered yet, with the highest metric on
+ * that RBG: the weight of the UE (GetDlRbgWeight()) multiplied by the rate
+ * of one RBG at the MCS of the UE on that RBG. The rates of all the UEs and
+ * RBG are taken from a table computed once for the beam, from the RBG MCS
+ * of the UEs (cached by the CQI management at every sub-band CQI report),
+ * so that the search of each RBG is a loop over contiguous arrays, without
+ * any call to the AMC. A UE without sub-band CQI has the same rate in all
+ * the RBG. With an ICIC algorithm, a UE does not compete for the RBG outside
+ * its zone.
+ *
+ * As in AssignDLRBGHeap(), the UEs that did not get the RBG are updated
+ * only after the first assignment and at the end, and only the weight of
+ * the UE that got the RBG changes in between. The RBG chosen for each UE
+ * are stored in its m_dlRbgMask, used by CreateDlDci().
+ */
+bool
+NrMacSchedulerOfdma::AssignDLRBGBest (std::vector<UePtrAndBufferReq> *ueVector,
+                                      uint32_t beamSym) const
+{
+  NS_LOG_FUNCTION (this);
+
+  GetFirst GetUe;
+  const uint32_t rbgAssignable = 1 * beamSym;
+  const uint32_t numRbg = GetBandwidthInRbg ();
+  const size_t numUe = ueVector->size ();
+  FTResources assigned (0,0);
+
+  // Rate of one RBG at each MCS: the metrics below only compare rates
+  std::vector<double> mcsRate (m_dlAmc->GetMaxMcs () + 1);
+  for (uint8_t mcs = 0; mcs < mcsRate.size (); ++mcs)
+    {
+      mcsRate[mcs] = m_dlAmc->CalculateTbSize (mcs, GetNumRbPerRbg ());
+    }
+
+  std::vector<double> weight (numUe);
+  std::vector<double> wbRate (numUe);
+  for (size_t k = 0; k < numUe; ++k)
+    {
+      wbRate[k] = mcsRate.at (GetUe (ueVector->at (k))->m_dlMcs.at (0));
+      weight[k] = GetDlRbgWeight (ueVector->at (k), wbRate[k]);
+      if (weight[k] < 0.0)
+        {
+          return false;
+        }
+    }
+
+  // The rate of each UE in each RBG, one row of UEs per RBG; with ICIC, it
+  // is negative in the RBGs outside the zone of the UE
+  Ptr<const NrIcicAlgorithm> icic = GetIcicAlgorithm ();
+  std::vector<double> rate (static_cast<size_t> (numRbg) * numUe);
+  for (size_t k = 0; k < numUe; ++k)
+    {
+      const auto &ue = GetUe (ueVector->at (k));
+      const auto &rbgMcs = ue->m_dlRbgMcs;
+      bool subband = rbgMcs.size () == numRbg;
+      const NrBitset *zone = nullptr;
+      if (icic != nullptr)
+        {
+          zone = &icic->GetDlUeMask (ue->m_dlCqi.m_wbCqi.empty () ? 0 : ue->m_dlCqi.m_wbCqi[0]);
+        }
+      for (uint32_t rbg = 0; rbg < numRbg; ++rbg)
+        {
+          if (zone != nullptr && zone->size () == numRbg && !zone->test (rbg))
+            {
+              rate[rbg * numUe + k] = -1.0;
+            }
+          else
+            {
+              rate[rbg * numUe + k] = subband ? mcsRate.at (rbgMcs[rbg]) : wbRate[k];
+            }
+        }
+    }
+
+  // A UE whose requirements are covered has a negative weight
+  auto updateWeight = [&] (size_t k)
+    {
+      weight[k] = IsDlUeSatisfied (ueVector->at (k)) ? -1.0 : GetDlRbgWeight (ueVector->at (k), wbRate[k]);
+    };
+  for (size_t k = 0; k < numUe; ++k)
+    {
+      updateWeight (k);
+    }
+
+  const NrBitset &notchedMask = GetDlNotchedRbgMask ();
+  const NrBitset allowed = notchedMask.size () > 0 ? notchedMask : NrBitset (numRbg, true);
+  std::vector<double> metric (numUe);
+  size_t lastAssigned = numUe;
+
+  for (size_t rbg = allowed.FindFirst (); rbg < allowed.size (); rbg = allowed.FindNext (rbg))
+    {
+      const double *rbgRate = &rate[rbg * numUe];
+      for (size_t k = 0; k < numUe; ++k)
+        {
+          metric[k] = weight[k] < 0.0 || rbgRate[k] < 0.0 ? -1.0 : weight[k] * rbgRate[k];
+        }
+      size_t best = std::distance (metric.begin (), std::max_element (metric.begin (), metric.end ()));
+
+      // In the case that all the UE already have their requirements fullfilled,
+      // then stop the beam processing and pass to the next
+      if (metric[best] < 0.0)
+        {
+          if (*std::max_element (weight.begin (), weight.end ()) < 0.0)
+            {
+              break;
+            }
+          // No UE that still needs resources may use this RBG
+          continue;
+        }
+
+      const UePtrAndBufferReq &ue = ueVector->at (best);
+      GetUe (ue)->m_dlRBG += rbgAssignable;
+      assigned.m_rbg += rbgAssignable;
+
+      GetUe (ue)->m_dlSym = beamSym;
+      assigned.m_sym = beamSym;
+
+      if (GetUe (ue)->m_dlRbgMask.size () != numRbg)
+        {
+          GetUe (ue)->m_dlRbgMask.resize (numRbg);
+        }
+      GetUe (ue)->m_dlRbgMask.set (rbg);
+
+      NS_LOG_DEBUG ("Assigned DL RBG " << rbg << ", spanned over " << beamSym <<
+                    " SYM, to UE " << GetUe (ue)->m_rnti);
+      AssignedDlResources (ue, FTResources (rbgAssignable, beamSym), assigned);
+
+      bool firstAssignment = (lastAssigned == numUe);
+      lastAssigned = best;
+
+      if (firstAssignment)
+        {
+          // The total assigned resources are now known: update the metrics of
+          // all the other UEs once, and then their weights
+          for (size_t k = 0; k < numUe; ++k)
+            {
+              if (k != best)
+                {
+                  NotAssignedDlResources (ueVector->at (k), FTResources (rbgAssignable, beamSym),
+                                          assigned);
+                }
+              updateWeight (k);
+            }
+        }
+      else
+        {
+          updateWeight (best);
+        }
+    }
+
+  if (lastAssigned == numUe)
+    {
+      return true;
+    }
+
+  // Batch pass: the final state of each UE is the one it would have had after
+  // the last NotAssigned call of the sorting loop
+  for (size_t k = 0; k < numUe; ++k)
+    {
+      if (k != lastAssigned)
+        {
+          NotAssignedDlResources (ueVector->at (k), FTResources (rbgAssignable, beamSym), assigned);
+        }
+    }
+  return true;
+}
+
+std::unique_ptr<NrMacSchedulerUeStateSoa>
+NrMacSchedulerOfdma::CopyDlUeState (NrMacSchedulerUeStateSoa::Metric metric,
+                                    const std::vector<UePtrAndBufferReq> &ueVector,
+                                    uint32_t beamSym) const
+{
+  GetFirst GetUe;
+  auto state = std::make_unique<NrMacSchedulerUeStateSoa> (metric, beamSym, 10);
+  for (const auto &ue : ueVector)
+    {
+      if (GetUe (ue)->m_dlMcs.size () != 1)
+        {
+          return nullptr;
+        }
+      state->AddUe (GetUe (ue)->m_dlMcs.at (0), ue.second, GetUe (ue)->m_dlRBG,
+                    GetUe (ue)->m_dlTbSize.at (0));
+    }
+  return state;
+}
+
+std::unique_ptr<NrMacSchedulerUeStateSoa>
+NrMacSchedulerOfdma::CopyUlUeState (NrMacSchedulerUeStateSoa::Metric metric,
+                                    const std::vector<UePtrAndBufferReq> &ueVector,
+                                    uint32_t beamSym) const
+{
+  GetFirst GetUe;
+  auto state = std::make_unique<NrMacSchedulerUeStateSoa> (metric, beamSym, 12);
+  for (const auto &ue : ueVector)
+    {
+      state->AddUe (GetUe (ue)->m_ulMcs, ue.second, GetUe (ue)->m_ulRBG, GetUe (ue)->m_ulTbSize);
+    }
+  return state;
+}
+
+/**
+ * \brief Distribute the DL RBG of a beam using the state of the UEs in arrays
+ * \param ueVector UEs of the beam
+ * \param beamSym symbols assigned to the beam
+ * \param resources RBG available for the beam
+ * \return false if the scheduler does not support it
+ *
+ * The result is the same as the one of AssignDLRBGHeap(), except that the
+ * UEs with the same metric are taken in the order of ueVector, and not in
+ * the order of the sorting loop. The UEs are reached through their shared
+ * pointer only twice: when their state is
+ * copied by CreateDlUeState(), and when the final assignment is written
+ * back. In between, each RBG goes to the UE found by a pass over the array
+ * of the metrics, and only the TB size and the metric of that UE are
+ * computed again. With hundreds of UEs in a beam, the pass is cheaper than
+ * the re-keying of the heap, whose comparisons dereference two UEs each.
+ *
+ * The UEs that got RBG are then updated by AssignedDlResources(), and the
+ * others by NotAssignedDlResources(), once and with the total assigned
+ * resources of the beam, which is the final state of the loop in
+ * AssignDLRBGHeap() for the RR, PF and MR schedulers.
+ */
+bool
+NrMacSchedulerOfdma::AssignDLRBGSoa (std::vector<UePtrAndBufferReq> *ueVector,
+                                     uint32_t beamSym, uint32_t resources) const
+{
+  NS_LOG_FUNCTION (this);
+
+  std::unique_ptr<NrMacSchedulerUeStateSoa> state = CreateDlUeState (*ueVector, beamSym);
+  if (state == nullptr)
+    {
+      return false;
+    }
+
+  GetFirst GetUe;
+  const uint32_t rbgAssignable = 1 * beamSym;
+  const size_t numUe = state->GetSize ();
+  FTResources assigned (0,0);
+  size_t lastAssigned = numUe;
+
+  state->Start ();
+  while (resources > 0)
+    {
+      size_t best = state->GetBest ();
+      // In the case that all the UE already have their requirements fullfilled,
+      // then stop the beam processing and pass to the next
+      if (best == numUe)
+        {
+          break;
+        }
+
+      uint32_t rbg = state->GetRbg (best) + rbgAssignable;
+      state->Assign (best, rbg, m_dlAmc->CalculateTbSize (state->GetMcs (best), rbg * GetNumRbPerRbg ()));
+      assigned.m_rbg += rbgAssignable;
+      assigned.m_sym = beamSym;
+      resources -= 1; // Resources are RBG, so they do not consider the beamSym
+      lastAssigned = best;
+    }
+
+  if (lastAssigned == numUe)
+    {
+      return true;
+    }
+
+  for (size_t k = 0; k < numUe; ++k)
+    {
+      const UePtrAndBufferReq &ue = ueVector->at (k);
+      if (state->GetRbg (k) != GetUe (ue)->m_dlRBG)
+        {
+          NS_LOG_DEBUG ("Assigned " << state->GetRbg (k) - GetUe (ue)->m_dlRBG <<
+                        " DL RBG, spanned over " << beamSym << " SYM, to UE " <<
+                        GetUe (ue)->m_rnti);
+          GetUe (ue)->m_dlRBG = state->GetRbg (k);
+          GetUe (ue)->m_dlSym = beamSym;
+          AssignedDlResources (ue, FTResources (rbgAssignable, beamSym), assigned);
+        }
+      else
+        {
+          NotAssignedDlResources (ue, FTResources (rbgAssignable, beamSym), assigned);
+        }
+    }
+  return true;
+}
+
+/**
+ * \brief Distribute the UL RBG of a beam using the state of the UEs in arrays
+ * \param ueVector UEs of the beam
+ * \param beamSym symbols assigned to the beam
+ * \param resources RBG available for the beam
+ * \return false if the scheduler does not support it
+ *
+ * As AssignDLRBGSoa(), with the state of CreateUlUeState().
+ */
+bool
+NrMacSchedulerOfdma::AssignULRBGSoa (std::vector<UePtrAndBufferReq> *ueVector,
+                                     uint32_t beamSym, uint32_t resources) const
+{
+  NS_LOG_FUNCTION (this);
+
+  std::unique_ptr<NrMacSchedulerUeStateSoa> state = CreateUlUeState (*ueVector, beamSym);
+  if (state == nullptr)
+    {
+      return false;
+    }
+
+  GetFirst GetUe;
+  const uint32_t rbgAssignable = 1 * beamSym;
+  const size_t numUe = state->GetSize ();
+  FTResources assigned (0,0);
+  size_t lastAssigned = numUe;
+
+  state->Start ();
+  while (resources > 0)
+    {
+      size_t best = state->GetBest ();
+      if (best == numUe)
+        {
+          break;
+        }
+
+      uint32_t rbg = state->GetRbg (best) + rbgAssignable;
+      state->Assign (best, rbg, m_ulAmc->CalculateTbSize (state->GetMcs (best), rbg * GetNumRbPerRbg ()));
+      assigned.m_rbg += rbgAssignable;
+      assigned.m_sym = beamSym;
+      resources -= 1;
+      lastAssigned = best;
+    }
+
+  if (lastAssigned == numUe)
+    {
+      return true;
+    }
+
+  for (size_t k = 0; k < numUe; ++k)
+    {
+      const UePtrAndBufferReq &ue = ueVector->at (k);
+      if (state->GetRbg (k) != GetUe (ue)->m_ulRBG)
+        {
+          NS_LOG_DEBUG ("Assigned " << state->GetRbg (k) - GetUe (ue)->m_ulRBG <<
+                        " UL RBG, spanned over " << beamSym << " SYM, to UE " <<
+                        GetUe (ue)->m_rnti);
+          GetUe (ue)->m_ulRBG = state->GetRbg (k);
+          GetUe (ue)->m_ulSym = beamSym;
+          AssignedUlResources (ue, FTResources (rbgAssignable, beamSym), assigned);
+        }
+      else
+        {
+          NotAssignedUlResources (ue, FTResources (rbgAssignable, beamSym), assigned);
+        }
+    }
+  return true;
+}
+
 /**
  * \brief Create the DL DCI in OFDMA mode
  * \param spoint Starting point
@@ -423,9 +1347,9 @@ NrMacSchedulerOfdma::CreateDlDci (NrMacSchedulerNs3::PointInFTPlane *spoint,
   //here to cover MIMO
 
   //Due to MIMO implementation MCS, TB size, ndi, rv, are vectors
-  std::vector<uint8_t> ndi;
+  StreamVector<uint8_t> ndi;
   ndi.resize (ueInfo->m_dlTbSize.size ());
-  std::vector<uint8_t> rv;
+  StreamVector<uint8_t> rv;
   rv.resize (ueInfo->m_dlTbSize.size ());
 
   for (uint32_t numTb = 0; numTb < ueInfo->m_dlTbSize.size (); numTb++)
@@ -462,58 +1386,76 @@ NrMacSchedulerOfdma::CreateDlDci (NrMacSchedulerNs3::PointInFTPlane *spoint,
     }
 
   uint32_t RBGNum = ueInfo->m_dlRBG / maxSym;
-  std::vector<uint8_t> rbgBitmask = GetDlNotchedRbgMask ();
+  const NrBitset &notchedMask = GetDlNotchedRbgMask ();
+  const NrBitset allowed = notchedMask.size () > 0 ? notchedMask : NrBitset (GetBandwidthInRbg (), true);
 
-  if (rbgBitmask.size () == 0)
-    {
-      rbgBitmask = std::vector<uint8_t> (GetBandwidthInRbg (), 1);
-    }
+  // allowed is all 1s or have 1s in the place we are allowed to transmit.
 
-  // rbgBitmask is all 1s or have 1s in the place we are allowed to transmit.
+  NS_ASSERT (allowed.size () == GetBandwidthInRbg ());
 
-  NS_ASSERT (rbgBitmask.size () == GetBandwidthInRbg ());
+  NrBitset rbgBitmask (GetBandwidthInRbg ());
 
   uint32_t lastRbg = spoint->m_rbg;
 
-  // Limit the places in which we can transmit following the starting point
-  // and the number of RBG assigned to the UE
-  for (uint32_t i = 0; i < GetBandwidthInRbg (); ++i)
+  if (ueInfo->m_dlRbgMask.any ())
     {
-      if (i >= spoint->m_rbg && RBGNum > 0 && rbgBitmask[i] == 1)
-        {
-          // assigned! Decrement RBGNum and continue the for
-          RBGNum--;
-          lastRbg = i;
-        }
-      else
+      // The RBG were chosen by AssignDLRBGBest
+      NS_ASSERT_MSG (ueInfo->m_dlRbgMask.count () == RBGNum,
+                     "If you see this message, it means that the AssignRBG and CreateDci method are unaligned");
+      rbgBitmask = ueInfo->m_dlRbgMask;
+      for (size_t i = rbgBitmask.FindFirst (); i < rbgBitmask.size (); i = rbgBitmask.FindNext (i))
         {
-          // Set to 0 the position < spoint->m_rbg OR the remaining RBG when
-          // we already assigned the number of requested RBG
-          rbgBitmask[i] = 0;
+          lastRbg = static_cast<uint32_t> (i);
         }
+      RBGNum = 0;
+    }
+
+  // Assign the first RBGNum allowed RBG following the starting point
+  for (size_t i = allowed.FindFrom (spoint->m_rbg); i < allowed.size () && RBGNum > 0;
+       i = allowed.FindNext (i))
+    {
+      rbgBitmask.set (i);
+      RBGNum--;
+      lastRbg = static_cast<uint32_t> (i);
     }
 
   NS_ASSERT_MSG (RBGNum == 0,
                  "If you see this message, it means that the AssignRBG and CreateDci method are unaligned");
 
-  std::ostringstream oss;
-  for (const auto & x: rbgBitmask)
+  // With the RBG chosen on the sub-band CQI, a single stream can use the
+  // lowest MCS of its RBG, when it is higher than the wideband one
+  const StreamVector<uint8_t> *mcs = &ueInfo->m_dlMcs;
+  StreamVector<uint8_t> rbgMcs;
+  if (ueInfo->m_dlRbgMask.any () && ueInfo->m_dlMcs.size () == 1
+      && ueInfo->m_dlRbgMcs.size () == GetBandwidthInRbg () && ueInfo->m_dlTbSize.at (0) > 0)
     {
-      oss << std::to_string (x) << " ";
+      uint8_t lowest = UINT8_MAX;
+      for (size_t i = rbgBitmask.FindFirst (); i < rbgBitmask.size (); i = rbgBitmask.FindNext (i))
+        {
+          lowest = std::min (lowest, ueInfo->m_dlRbgMcs.at (i));
+        }
+      if (lowest > ueInfo->m_dlMcs.at (0))
+        {
+          rbgMcs.assign (1, lowest);
+          mcs = &rbgMcs;
+          ueInfo->m_dlTbSize.at (0) = m_dlAmc->CalculateTbSize (lowest, rbgBitmask.count () * GetNumRbPerRbg ());
+          NS_LOG_INFO ("UE " << ueInfo->m_rnti << " uses MCS " << +lowest <<
+                       " on its RBG instead of the wideband MCS " << +ueInfo->m_dlMcs.at (0));
+        }
     }
 
   NS_LOG_INFO ("UE " << ueInfo->m_rnti << " assigned RBG from " <<
                static_cast<uint32_t> (spoint->m_rbg) << " with mask " <<
-               oss.str () << " for " << static_cast<uint32_t> (maxSym) << " SYM.");
+               rbgBitmask << " for " << static_cast<uint32_t> (maxSym) << " SYM.");
 
 
-  std::shared_ptr<DciInfoElementTdma> dci = std::make_shared<DciInfoElementTdma>
-      (ueInfo->m_rnti, DciInfoElementTdma::DL, spoint->m_sym, maxSym, ueInfo->m_dlMcs,
+  std::shared_ptr<DciInfoElementTdma> dci = DciInfoElementTdma::Create
+      (ueInfo->m_rnti, DciInfoElementTdma::DL, spoint->m_sym, maxSym, *mcs,
        ueInfo->m_dlTbSize, ndi, rv, DciInfoElementTdma::DATA, GetBwpId (), GetTpc());
 
   dci->m_rbgBitmask = std::move (rbgBitmask);
 
-  NS_ASSERT (std::count (dci->m_rbgBitmask.begin (), dci->m_rbgBitmask.end (), 0) != GetBandwidthInRbg ());
+  NS_ASSERT (dci->m_rbgBitmask.any ());
 
   spoint->m_rbg = lastRbg + 1;
 
@@ -540,36 +1482,25 @@ NrMacSchedulerOfdma::CreateUlDci (PointInFTPlane *spoint,
     }
 
   uint32_t RBGNum = ueInfo->m_ulRBG / maxSym;
-  std::vector<uint8_t> rbgBitmask = GetUlNotchedRbgMask ();
+  const NrBitset &notchedMask = GetUlNotchedRbgMask ();
+  const NrBitset allowed = notchedMask.size () > 0 ? notchedMask : NrBitset (GetBandwidthInRbg (), true);
 
-  if (rbgBitmask.size () == 0)
-    {
-      rbgBitmask = std::vector<uint8_t> (GetBandwidthInRbg (), 1);
-    }
+  // allowed is all 1s or have 1s in the place we are allowed to transmit.
 
-  // rbgBitmask is all 1s or have 1s in the place we are allowed to transmit.
+  NS_ASSERT (allowed.size () == GetBandwidthInRbg ());
 
-  NS_ASSERT (rbgBitmask.size () == GetBandwidthInRbg ());
+  NrBitset rbgBitmask (GetBandwidthInRbg ());
 
   uint32_t lastRbg = spoint->m_rbg;
   uint32_t assigned = RBGNum;
 
-  // Limit the places in which we can transmit following the starting point
-  // and the number of RBG assigned to the UE
-  for (uint32_t i = 0; i < GetBandwidthInRbg (); ++i)
+  // Assign the first RBGNum allowed RBG following the starting point
+  for (size_t i = allowed.FindFrom (spoint->m_rbg); i < allowed.size () && RBGNum > 0;
+       i = allowed.FindNext (i))
     {
-      if (i >= spoint->m_rbg && RBGNum > 0 && rbgBitmask[i] == 1)
-        {
-          // assigned! Decrement RBGNum and continue the for
-          RBGNum--;
-          lastRbg = i;
-        }
-      else
-        {
-          // Set to 0 the position < spoint->m_rbg OR the remaining RBG when
-          // we already assigned the number of requested RBG
-          rbgBitmask[i] = 0;
-        }
+      rbgBitmask.set (i);
+      RBGNum--;
+      lastRbg = static_cast<uint32_t> (i);
     }
 
   NS_ASSERT_MSG (RBGNum == 0,
@@ -581,26 +1512,21 @@ NrMacSchedulerOfdma::CreateUlDci (PointInFTPlane *spoint,
                static_cast<uint32_t> (maxSym) << " SYM.");
 
   //Due to MIMO implementation MCS, TB size, ndi, rv, are vectors
-  std::vector<uint8_t> ulMcs = {ueInfo->m_ulMcs};
-  std::vector<uint32_t> ulTbs = {tbs};
-  std::vector<uint8_t> ndi = {1};
-  std::vector<uint8_t> rv = {0};
+  StreamVector<uint8_t> ulMcs = {ueInfo->m_ulMcs};
+  StreamVector<uint32_t> ulTbs = {tbs};
+  StreamVector<uint8_t> ndi = {1};
+  StreamVector<uint8_t> rv = {0};
 
   NS_ASSERT (spoint->m_sym >= maxSym);
-  std::shared_ptr<DciInfoElementTdma> dci = std::make_shared<DciInfoElementTdma>
+  std::shared_ptr<DciInfoElementTdma> dci = DciInfoElementTdma::Create
       (ueInfo->m_rnti, DciInfoElementTdma::UL, spoint->m_sym - maxSym, maxSym, ulMcs,
        ulTbs, ndi, rv, DciInfoElementTdma::DATA, GetBwpId (), GetTpc());
 
   dci->m_rbgBitmask = std::move (rbgBitmask);
 
-  std::ostringstream oss;
-  for (auto x: dci->m_rbgBitmask)
-  {
-   oss << std::to_string(x) << " ";
-  }
-  NS_LOG_INFO ("UE " << ueInfo->m_rnti << " DCI RBG mask: " << oss.str());
+  NS_LOG_INFO ("UE " << ueInfo->m_rnti << " DCI RBG mask: " << dci->m_rbgBitmask);
 
-  NS_ASSERT (std::count (dci->m_rbgBitmask.begin (), dci->m_rbgBitmask.end (), 0) != GetBandwidthInRbg ());
+  NS_ASSERT (dci->m_rbgBitmask.any ());
 
   spoint->m_rbg = lastRbg + 1;
 
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "nr-mac-scheduler-tdma.h"
+#include "nr-mac-scheduler-ue-state-soa.h"
 #include <ns3/traced-value.h>
 
 namespace ns3 {
@@ -68,6 +69,17 @@ public:
    */
   static TypeId GetTypeId (void);
 
+  /**
+   * \brief Algorithm used to distribute the RBG of a beam among its UEs
+   */
+  enum RbgAssignmentMode
+  {
+    SORT_LOOP,  //!< Sort the entire UE vector for every RBG assigned (default)
+    HEAP,       //!< Keep the UEs in a heap and re-key only the assigned UE
+    BEST_RBG,   //!< Give each DL RBG to the UE with the best metric on it (UL as SORT_LOOP)
+    SOA         //!< Copy the state of the UEs of a beam in contiguous arrays (as HEAP if not supported)
+  };
+
   /**
    * \brief NrMacSchedulerOfdma constructor
    */
@@ -80,6 +92,30 @@ public:
   {
   }
 
+  /**
+   * \brief Set the algorithm used in AssignDLRBG() and AssignULRBG()
+   * \param mode the RBG assignment mode
+   */
+  void SetRbgAssignmentMode (RbgAssignmentMode mode);
+
+  /**
+   * \brief Get the algorithm used in AssignDLRBG() and AssignULRBG()
+   * \return the RBG assignment mode
+   */
+  RbgAssignmentMode GetRbgAssignmentMode () const;
+
+  /**
+   * \brief Enable the DL MU-MIMO: the beams with a low coupling share the
+   * same symbols and RBGs
+   * \param enable true to enable it
+   */
+  void SetMuMimo (bool enable);
+
+  /**
+   * \return true if the DL MU-MIMO is enabled
+   */
+  bool GetMuMimo () const;
+
 protected:
   virtual BeamSymbolMap
   AssignDLRBG (uint32_t symAvail, const ActiveUeMap &activeDl) const override;
@@ -108,10 +144,194 @@ protected:
   NrMacSchedulerOfdma::BeamSymbolMap
   GetSymPerBeam (uint32_t symAvail, const ActiveUeMap &activeDl) const;
 
+  /**
+   * \brief Return the groups of DL beams made by the last AssignDLRBG
+   * \param activeDl Map of Beam and active UE per beam
+   * \return the groups of beams that share the same symbols and RBGs
+   *
+   * Without MU-MIMO, each beam is in its own group.
+   */
+  virtual std::vector<std::vector<BeamConfId> >
+  GetDlBeamGroups (const ActiveUeMap &activeDl) const override;
+
   virtual uint8_t GetTpc () const override;
 
+  /**
+   * \brief Get the weight of a UE in the search of the best UE of each DL RBG
+   * \param ue UE and its buffer requirement
+   * \param wbRate rate of one RBG at the wideband MCS of the UE
+   * \return the weight, or a negative value if the scheduler does not
+   * support the search
+   *
+   * With the RbgAssignmentMode BestRbg, the metric of the UE on an RBG is the
+   * weight multiplied by the rate of one RBG at the MCS of the UE on that
+   * RBG (from the sub-band CQI, or the wideband one). The default
+   * implementation does not support the search, and the RBG are distributed
+   * as with SortLoop.
+   */
+  virtual double GetDlRbgWeight ([[maybe_unused]] const UePtrAndBufferReq &ue,
+                                 [[maybe_unused]] double wbRate) const
+  {
+    return -1.0;
+  }
+
+  /**
+   * \brief Create the DL state of the UEs of a beam, for the RbgAssignmentMode Soa
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return the state, or nullptr if the scheduler does not support the mode
+   *
+   * The default implementation does not support the mode, and the RBG are
+   * distributed as with Heap.
+   */
+  virtual std::unique_ptr<NrMacSchedulerUeStateSoa>
+  CreateDlUeState ([[maybe_unused]] const std::vector<UePtrAndBufferReq> &ueVector,
+                   [[maybe_unused]] uint32_t beamSym) const
+  {
+    return nullptr;
+  }
+
+  /**
+   * \brief Create the UL state of the UEs of a beam, for the RbgAssignmentMode Soa
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return the state, or nullptr if the scheduler does not support the mode
+   *
+   * \see CreateDlUeState
+   */
+  virtual std::unique_ptr<NrMacSchedulerUeStateSoa>
+  CreateUlUeState ([[maybe_unused]] const std::vector<UePtrAndBufferReq> &ueVector,
+                   [[maybe_unused]] uint32_t beamSym) const
+  {
+    return nullptr;
+  }
+
+  /**
+   * \brief Copy the DL state of the UEs of a beam, with their MCS, bytes and RBG
+   * \param metric the metric of the scheduler
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return the state, or nullptr if a UE has more than one DL stream
+   */
+  std::unique_ptr<NrMacSchedulerUeStateSoa>
+  CopyDlUeState (NrMacSchedulerUeStateSoa::Metric metric,
+                 const std::vector<UePtrAndBufferReq> &ueVector, uint32_t beamSym) const;
+
+  /**
+   * \brief Copy the UL state of the UEs of a beam, with their MCS, bytes and RBG
+   * \param metric the metric of the scheduler
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return the state
+   */
+  std::unique_ptr<NrMacSchedulerUeStateSoa>
+  CopyUlUeState (NrMacSchedulerUeStateSoa::Metric metric,
+                 const std::vector<UePtrAndBufferReq> &ueVector, uint32_t beamSym) const;
+
+  /**
+   * \brief Get the algorithm that AssignDLRBG() and AssignULRBG() use
+   * \return the value of the attribute RbgAssignmentMode
+   *
+   * A scheduler whose policy needs a given algorithm can override it.
+   */
+  virtual RbgAssignmentMode GetRbgAssignmentModeInUse () const
+  {
+    return m_rbgAssignmentMode;
+  }
+
 private:
+  /**
+   * \brief Check if the DL requirements of the UE are already covered
+   * \param ue UE and its buffer requirement
+   * \return true if the TB size of the UE already covers its buffer
+   *
+   * In MIMO, the streams that are not needed to empty the buffer get their
+   * TB size set to zero.
+   */
+  bool IsDlUeSatisfied (const UePtrAndBufferReq &ue) const;
+
+  /**
+   * \brief Check if the UL requirements of the UE are already covered
+   * \param ue UE and its buffer requirement
+   * \return true if the TB size of the UE already covers its buffer
+   */
+  bool IsUlUeSatisfied (const UePtrAndBufferReq &ue) const;
+
+  /**
+   * \brief Distribute the DL RBG of a beam using a heap of UEs
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \param resources RBG available for the beam
+   */
+  void AssignDLRBGHeap (std::vector<UePtrAndBufferReq> *ueVector, uint32_t beamSym,
+                        uint32_t resources) const;
+
+  /**
+   * \brief Distribute the UL RBG of a beam using a heap of UEs
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \param resources RBG available for the beam
+   */
+  void AssignULRBGHeap (std::vector<UePtrAndBufferReq> *ueVector, uint32_t beamSym,
+                        uint32_t resources) const;
+
+  /**
+   * \brief Distribute the DL RBG of a beam giving each RBG to the UE with the best metric on it
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \return false if the scheduler does not support the search (nothing is assigned)
+   */
+  bool AssignDLRBGBest (std::vector<UePtrAndBufferReq> *ueVector, uint32_t beamSym) const;
+
+  /**
+   * \brief Distribute the DL RBG of a beam using the state of the UEs in arrays
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \param resources RBG available for the beam
+   * \return false if the scheduler does not support it (nothing is assigned)
+   */
+  bool AssignDLRBGSoa (std::vector<UePtrAndBufferReq> *ueVector, uint32_t beamSym,
+                       uint32_t resources) const;
+
+  /**
+   * \brief Distribute the UL RBG of a beam using the state of the UEs in arrays
+   * \param ueVector UEs of the beam
+   * \param beamSym symbols assigned to the beam
+   * \param resources RBG available for the beam
+   * \return false if the scheduler does not support it (nothing is assigned)
+   */
+  bool AssignULRBGSoa (std::vector<UePtrAndBufferReq> *ueVector, uint32_t beamSym,
+                       uint32_t resources) const;
+
+  /**
+   * \brief Group the DL beams for MU-MIMO
+   * \param activeDl Map of active DL UE and their beam
+   * \return the groups of beams
+   *
+   * The beams are taken in decreasing order of buffer; each beam opens a
+   * group, and takes the following beams whose coupling with all the beams
+   * of the group is below MuMimoCouplingThreshold, up to MuMimoMaxLayers.
+   */
+  std::vector<std::vector<BeamConfId> > GroupDlBeams (const ActiveUeMap &activeDl) const;
+
+  /**
+   * \brief Calculate the number of symbols to assign to each group of beams
+   * \param symAvail Number of available symbols
+   * \param activeDl Map of active DL UE and their beam
+   * \param groups the groups of beams
+   * \return the symbols of each beam, that are the ones of its group
+   *
+   * As GetSymPerBeam, but the buffer of a group is the largest buffer of
+   * its beams, as the beams are transmitted at the same time.
+   */
+  BeamSymbolMap GetSymPerBeamGroup (uint32_t symAvail, const ActiveUeMap &activeDl,
+                                    const std::vector<std::vector<BeamConfId> > &groups) const;
 
   TracedValue<uint32_t> m_tracedValueSymPerBeam;
+  RbgAssignmentMode m_rbgAssignmentMode {SORT_LOOP}; //!< Algorithm used to assign the RBG
+  bool m_muMimo {false};                    //!< Whether the DL MU-MIMO is enabled
+  double m_muMimoCouplingThreshold {-15.0}; //!< Max coupling (dB) between beams of the same group
+  uint8_t m_muMimoMaxLayers {2};            //!< Max number of beams of a group
+  mutable std::vector<std::vector<BeamConfId> > m_dlBeamGroups; //!< Groups of the last AssignDLRBG
 };
 } // namespace ns3
@@ -0,0 +1,219 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_MAC_SCHEDULER_PHASE_TIMER_H
+#define NR_MAC_SCHEDULER_PHASE_TIMER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * \ingroup scheduler
+ * \brief 1 to time the phases of NrMacSchedulerNs3::ScheduleDl and ScheduleUl
+ *
+ * Set by the CMake option NR_SCHEDULER_PHASE_TIMING. When 0, the timers are
+ * empty objects and the scheduler does not read the clock.
+ */
+#ifndef NR_SCHEDULER_PHASE_TIMING
+#define NR_SCHEDULER_PHASE_TIMING 0
+#endif
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief The time spent by a scheduler in each phase of a slot, for one direction
+ */
+struct NrMacSchedulerPhaseTimes
+{
+  /**
+   * \brief The timed phases
+   */
+  enum Phase
+  {
+    COMPUTE_ACTIVE_UE = 0,   //!< ComputeActiveUe
+    COMPUTE_ACTIVE_HARQ = 1, //!< ComputeActiveHarq
+    SCHEDULE_HARQ = 2,       //!< ScheduleDlHarq or ScheduleUlHarq
+    ASSIGN_RBG = 3,          //!< AssignDLRBG or AssignULRBG
+    CREATE_DCI = 4,          //!< CreateDlDci or CreateUlDci, for all the UEs
+    CTRL_SYM = 5,            //!< PrependCtrlSym and AppendCtrlSym
+    NUM_PHASES = 6           //!< Number of phases
+  };
+
+  /**
+   * \param phase the phase
+   * \return the name of the phase
+   */
+  static std::string GetPhaseName (Phase phase)
+  {
+    static const std::array<std::string, NUM_PHASES> names {"ComputeActiveUe", "ComputeActiveHarq",
+                                                            "ScheduleHarq", "AssignRbg",
+                                                            "CreateDci", "CtrlSym"};
+    return names.at (phase);
+  }
+
+  /**
+   * \brief Set all the times to zero
+   */
+  void Reset ()
+  {
+    m_ns.fill (0);
+  }
+
+  std::array<uint64_t, NUM_PHASES> m_ns {}; //!< Nanoseconds spent in each phase
+};
+
+/**
+ * \ingroup scheduler
+ * \brief Histogram of the times of a phase, in power-of-two buckets of nanoseconds
+ *
+ * The bucket i counts the times t with 2^(i-1) <= t < 2^i ns (the bucket 0
+ * counts the times of 0 ns).
+ */
+class NrMacSchedulerPhaseHistogram
+{
+public:
+  static constexpr uint32_t NUM_BUCKETS = 40; //!< Number of buckets (the last one takes the rest)
+
+  /**
+   * \brief Add a time
+   * \param ns the time in nanoseconds
+   */
+  void Add (uint64_t ns)
+  {
+    m_sum += ns;
+    uint32_t bucket = 0;
+    while (ns > 0 && bucket < NUM_BUCKETS - 1)
+      {
+        ns >>= 1;
+        ++bucket;
+      }
+    ++m_counts[bucket];
+    ++m_total;
+  }
+
+  /**
+   * \param bucket the bucket
+   * \return the number of times in the bucket
+   */
+  uint64_t GetCount (uint32_t bucket) const
+  {
+    return m_counts.at (bucket);
+  }
+
+  /**
+   * \return the number of times added
+   */
+  uint64_t GetTotal () const
+  {
+    return m_total;
+  }
+
+  /**
+   * \return the sum of the times added, in nanoseconds
+   */
+  uint64_t GetSum () const
+  {
+    return m_sum;
+  }
+
+  /**
+   * \brief Print the non-empty buckets as "<upper bound in ns>:<count>"
+   * \param os the output stream
+   */
+  void Print (std::ostream &os) const
+  {
+    for (uint32_t bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+      {
+        if (m_counts[bucket] > 0)
+          {
+            os << (1ULL << bucket) << ":" << m_counts[bucket] << " ";
+          }
+      }
+  }
+
+private:
+  std::array<uint64_t, NUM_BUCKETS> m_counts {}; //!< The count of each bucket
+  uint64_t m_total {0};                           //!< The number of times added
+  uint64_t m_sum {0};                             //!< The sum of the times added
+};
+
+/**
+ * \ingroup scheduler
+ * \brief Adds to a phase the time spent between its construction and its destruction
+ *
+ * The specialization for Enabled = false does nothing.
+ */
+template <bool Enabled>
+class NrMacSchedulerPhaseTimer
+{
+public:
+  /**
+   * \brief Start the timer
+   * \param times the times of the slot
+   * \param phase the phase that is timed
+   */
+  NrMacSchedulerPhaseTimer (NrMacSchedulerPhaseTimes *times, NrMacSchedulerPhaseTimes::Phase phase)
+    : m_time (&times->m_ns[phase]),
+      m_start (std::chrono::steady_clock::now ())
+  {
+  }
+
+  /**
+   * \brief Stop the timer, and add the time to the phase
+   */
+  ~NrMacSchedulerPhaseTimer ()
+  {
+    auto elapsed = std::chrono::steady_clock::now () - m_start;
+    *m_time += static_cast<uint64_t> (std::chrono::duration_cast<std::chrono::nanoseconds> (elapsed).count ());
+  }
+
+private:
+  uint64_t *m_time;                                     //!< The time of the phase
+  std::chrono::steady_clock::time_point m_start;        //!< When the timer started
+};
+
+/**
+ * \ingroup scheduler
+ * \brief The disabled timer
+ */
+template <>
+class NrMacSchedulerPhaseTimer<false>
+{
+public:
+  /**
+   * \brief Do nothing
+   */
+  NrMacSchedulerPhaseTimer ([[maybe_unused]] NrMacSchedulerPhaseTimes *times,
+                            [[maybe_unused]] NrMacSchedulerPhaseTimes::Phase phase)
+  {
+  }
+};
+
+/**
+ * \ingroup scheduler
+ * \brief The timer used by the scheduler, enabled by NR_SCHEDULER_PHASE_TIMING
+ */
+using NrMacSchedulerSlotPhaseTimer = NrMacSchedulerPhaseTimer<NR_SCHEDULER_PHASE_TIMING != 0>;
+
+} // namespace ns3
+
+#endif // NR_MAC_SCHEDULER_PHASE_TIMER_H
@@ -0,0 +1,113 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#include "nr-mac-scheduler-srs-adaptive.h"
+
+#include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrMacSchedulerSrsAdaptive");
+NS_OBJECT_ENSURE_REGISTERED (NrMacSchedulerSrsAdaptive);
+
+NrMacSchedulerSrsAdaptive::NrMacSchedulerSrsAdaptive ()
+{
+}
+
+NrMacSchedulerSrsAdaptive::~NrMacSchedulerSrsAdaptive ()
+{
+}
+
+TypeId
+NrMacSchedulerSrsAdaptive::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::NrMacSchedulerSrsAdaptive")
+    .SetParent<NrMacSchedulerSrsDefault> ()
+    .AddConstructor<NrMacSchedulerSrsAdaptive> ()
+    .SetGroupName ("nr")
+    .AddAttribute ("ActivePeriodicityFactor",
+                   "A static UE with data in its buffers sends its SRS at one out of "
+                   "this number of occurrences of its offset",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&NrMacSchedulerSrsAdaptive::m_activeFactor),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("IdlePeriodicityFactor",
+                   "A static UE without data in its buffers sends its SRS at one out of "
+                   "this number of occurrences of its offset",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&NrMacSchedulerSrsAdaptive::m_idleFactor),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("MobilityWindow",
+                   "A UE whose beam changed in this window is considered moving, and "
+                   "sends its SRS at every occurrence of its offset",
+                   TimeValue (MilliSeconds (200)),
+                   MakeTimeAccessor (&NrMacSchedulerSrsAdaptive::m_mobilityWindow),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+uint32_t
+NrMacSchedulerSrsAdaptive::GetPeriodicityFactor (const std::shared_ptr<NrMacSchedulerUeInfo> &ue)
+{
+  NS_LOG_FUNCTION (this << ue->m_rnti);
+
+  // A UE seen for the first time counts as moving, so that its beams are
+  // refined at the full rate at the beginning
+  UeState &state = m_ueStates[ue->m_rnti];
+  if (!state.m_known || !(state.m_beamConfId == ue->m_beamConfId))
+    {
+      state.m_beamConfId = ue->m_beamConfId;
+      state.m_lastBeamChange = Simulator::Now ();
+      state.m_known = true;
+    }
+
+  if (Simulator::Now () - state.m_lastBeamChange < m_mobilityWindow)
+    {
+      return 1;
+    }
+
+  for (const auto &lcg : ue->m_dlLCG)
+    {
+      if (lcg.second->GetTotalSize () > 0)
+        {
+          return m_activeFactor;
+        }
+    }
+  for (const auto &lcg : ue->m_ulLCG)
+    {
+      if (lcg.second->GetTotalSize () > 0)
+        {
+          return m_activeFactor;
+        }
+    }
+  return m_idleFactor;
+}
+
+bool
+NrMacSchedulerSrsAdaptive::IsSrsOccurrence (const std::shared_ptr<NrMacSchedulerUeInfo> &ue, uint32_t occurrence)
+{
+  NS_LOG_FUNCTION (this << ue->m_rnti << occurrence);
+  uint32_t factor = GetPeriodicityFactor (ue);
+  NS_LOG_INFO ("UE " << ue->m_rnti << " periodicity factor " << factor);
+  return occurrence % factor == 0;
+}
+
+} // namespace ns3
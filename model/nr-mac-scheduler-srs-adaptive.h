@@ -0,0 +1,96 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_MAC_SCHEDULER_SRS_ADAPTIVE_H
+#define NR_MAC_SCHEDULER_SRS_ADAPTIVE_H
+
+#include <ns3/nstime.h>
+
+#include "nr-mac-scheduler-srs-default.h"
+#include "beam-conf-id.h"
+
+#include <unordered_map>
+
+namespace ns3 {
+
+/**
+ * \brief SRS algorithm that adapts the periodicity of each UE to its mobility
+ * and to its traffic
+ *
+ * The offsets and the shared periodicity are assigned as in
+ * NrMacSchedulerSrsDefault. Then, at each occurrence of its offset, a UE
+ * sends its SRS only at one out of N occurrences, where N is:
+ *
+ * - 1 if the beam of the UE changed in the last MobilityWindow (moving UE);
+ * - ActivePeriodicityFactor if the UE has data in its DL or UL buffers;
+ * - IdlePeriodicityFactor otherwise (static and idle UE).
+ *
+ * The SRS symbols of the skipped slots are left for UL data. The UEs still
+ * report one SRS per transmission, so the SRS count trigger of
+ * RealisticBeamformingAlgorithm keeps working: it simply counts the SRS that
+ * were sent, and updates the beams of the static UEs less often.
+ */
+class NrMacSchedulerSrsAdaptive : public NrMacSchedulerSrsDefault
+{
+public:
+  /**
+   * \brief NrMacSchedulerSrsAdaptive
+   */
+  NrMacSchedulerSrsAdaptive ();
+  /**
+   * \brief ~NrMacSchedulerSrsAdaptive
+   */
+  virtual ~NrMacSchedulerSrsAdaptive () override;
+
+  /**
+   * \brief GetTypeId
+   * \return the object type id
+   */
+  static TypeId GetTypeId ();
+
+  // inherited from NrMacSchedulerSrs
+  virtual bool IsSrsOccurrence (const std::shared_ptr<NrMacSchedulerUeInfo> &ue, uint32_t occurrence) override;
+
+  /**
+   * \brief Get the number of occurrences of its offset out of which a UE
+   * sends one SRS, updating the state of the UE
+   * \param ue the UE
+   * \return the periodicity factor of the UE
+   */
+  uint32_t GetPeriodicityFactor (const std::shared_ptr<NrMacSchedulerUeInfo> &ue);
+
+private:
+  /**
+   * \brief What the algorithm knows of a UE
+   */
+  struct UeState
+  {
+    BeamConfId m_beamConfId;  //!< The beam of the UE at its last occurrence
+    Time m_lastBeamChange;    //!< When the beam of the UE was last seen changing
+    bool m_known {false};     //!< False until the first occurrence of the UE
+  };
+
+  uint32_t m_activeFactor {2};                  //!< The ActivePeriodicityFactor attribute
+  uint32_t m_idleFactor {8};                    //!< The IdlePeriodicityFactor attribute
+  Time m_mobilityWindow {MilliSeconds (200)};   //!< The MobilityWindow attribute
+  std::unordered_map<uint16_t, UeState> m_ueStates; //!< State of each UE, by RNTI
+};
+
+} // namespace ns3
+
+#endif // NR_MAC_SCHEDULER_SRS_ADAPTIVE_H
@@ -126,6 +126,22 @@ public:
    */
   virtual bool DecreasePeriodicity (std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > *ueMap) = 0;
 
+  /**
+   * \brief Function called at each slot with the offset of a UE, to know
+   * whether the UE sends its SRS in it
+   * \param ue the UE whose offset is the current slot
+   * \param occurrence the number of the occurrences of the offset so far
+   * \return true if the UE sends its SRS; by default, at every occurrence
+   *
+   * An algorithm can skip some occurrences of a UE, to give it a longer
+   * periodicity than the one shared by all the UEs, without changing the
+   * offsets; the SRS symbols of the skipped slots are left for data.
+   */
+  virtual bool IsSrsOccurrence (const std::shared_ptr<NrMacSchedulerUeInfo> &ue, uint32_t occurrence)
+  {
+    return true;
+  }
+
 };
 } // namespace ns3
 
@@ -0,0 +1,98 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#include "nr-mac-scheduler-tdma-edf.h"
+#include "nr-mac-scheduler-ue-info-edf.h"
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrMacSchedulerTdmaEdf");
+NS_OBJECT_ENSURE_REGISTERED (NrMacSchedulerTdmaEdf);
+
+TypeId
+NrMacSchedulerTdmaEdf::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrMacSchedulerTdmaEdf")
+    .SetParent<NrMacSchedulerTdmaPF> ()
+    .AddConstructor<NrMacSchedulerTdmaEdf> ()
+  ;
+  return tid;
+}
+
+NrMacSchedulerTdmaEdf::NrMacSchedulerTdmaEdf () : NrMacSchedulerTdmaPF ()
+{
+
+}
+
+std::shared_ptr<NrMacSchedulerUeInfo>
+NrMacSchedulerTdmaEdf::CreateUeRepresentation (const NrMacCschedSapProvider::CschedUeConfigReqParameters &params) const
+{
+  NS_LOG_FUNCTION (this);
+  return std::make_shared <NrMacSchedulerUeInfoEdf> (GetFairnessIndex (),
+                                                     params.m_rnti, params.m_beamConfId,
+                                                     std::bind (&NrMacSchedulerTdmaEdf::GetNumRbPerRbg, this));
+}
+
+std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                   const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
+NrMacSchedulerTdmaEdf::GetUeCompareDlFn () const
+{
+  return NrMacSchedulerUeInfoEdf::CompareUeWeightsDl;
+}
+
+std::function<bool (const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                    const NrMacSchedulerNs3::UePtrAndBufferReq &rhs)>
+NrMacSchedulerTdmaEdf::GetUeCompareUlFn () const
+{
+  return NrMacSchedulerUeInfoEdf::CompareUeWeightsUl;
+}
+
+void
+NrMacSchedulerTdmaEdf::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoEdf::CompareUeWeightsDl> (ueVector);
+}
+
+void
+NrMacSchedulerTdmaEdf::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoEdf::CompareUeWeightsUl> (ueVector);
+}
+
+void
+NrMacSchedulerTdmaEdf::BeforeDlSched (const UePtrAndBufferReq &ue,
+                                     const FTResources &assignableInIteration) const
+{
+  NS_LOG_FUNCTION (this);
+  NrMacSchedulerTdmaPF::BeforeDlSched (ue, assignableInIteration);
+  auto uePtr = std::dynamic_pointer_cast<NrMacSchedulerUeInfoEdf> (ue.first);
+  uePtr->UpdateDlDelay ();
+}
+
+void
+NrMacSchedulerTdmaEdf::BeforeUlSched (const UePtrAndBufferReq &ue,
+                                     const FTResources &assignableInIteration) const
+{
+  NS_LOG_FUNCTION (this);
+  NrMacSchedulerTdmaPF::BeforeUlSched (ue, assignableInIteration);
+  auto uePtr = std::dynamic_pointer_cast<NrMacSchedulerUeInfoEdf> (ue.first);
+  uePtr->UpdateUlDelay ();
+}
+
+} // namespace ns3
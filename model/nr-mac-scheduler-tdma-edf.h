@@ -0,0 +1,126 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+#include "nr-mac-scheduler-tdma-pf.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief Assign symbols to the UEs by earliest deadline first (EDF)
+ *
+ * The deadline of a UE is the time at which the head of line data of one of
+ * its LC exceeds the packet delay budget of the LC QCI. The UEs are served
+ * the earliest deadline first; the UEs without a deadline come last, sorted
+ * by their PF metric.
+ *
+ * The DL head of line delay is the one reported by the RLC, while the UL one
+ * is approximated by the time passed since the BSR that announced the data.
+ *
+ * The UEs are sorted once for every symbol assigned, i.e., at most 14
+ * times per slot.
+ *
+ * Details of the sorting function in the class NrMacSchedulerUeInfoEdf.
+ */
+class NrMacSchedulerTdmaEdf : public NrMacSchedulerTdmaPF
+{
+public:
+  /**
+   * \brief GetTypeId
+   * \return The TypeId of the class
+   */
+  static TypeId GetTypeId (void);
+  /**
+   * \brief NrMacSchedulerTdmaEdf constructor
+   */
+  NrMacSchedulerTdmaEdf ();
+
+  /**
+   * \brief ~NrMacSchedulerTdmaEdf deconstructor
+   */
+  virtual ~NrMacSchedulerTdmaEdf () override
+  {
+  }
+
+protected:
+  // inherit
+  /**
+   * \brief Create an UE representation of the type NrMacSchedulerUeInfoEdf
+   * \param params parameters
+   * \return NrMacSchedulerUeInfoEdf instance
+   */
+  virtual std::shared_ptr<NrMacSchedulerUeInfo>
+  CreateUeRepresentation (const NrMacCschedSapProvider::CschedUeConfigReqParameters& params) const override;
+
+  /**
+   * \brief Return the comparison function to sort DL UE according to the scheduler policy
+   * \return a pointer to NrMacSchedulerUeInfoEdf::CompareUeWeightsDl
+   */
+  virtual std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                             const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
+  GetUeCompareDlFn () const override;
+
+  /**
+   * \brief Return the comparison function to sort UL UE according to the scheduler policy
+   * \return a pointer to NrMacSchedulerUeInfoEdf::CompareUeWeightsUl
+   */
+  virtual std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                             const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
+  GetUeCompareUlFn () const override;
+
+  /**
+   * \brief Sort the DL UEs calling NrMacSchedulerUeInfoEdf::CompareUeWeightsDl directly
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoEdf::CompareUeWeightsDl
+   */
+  virtual void SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Sort the UL UEs calling NrMacSchedulerUeInfoEdf::CompareUeWeightsUl directly
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoEdf::CompareUeWeightsUl
+   */
+  virtual void SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Calculate the potential throughput and the deadline for the DL
+   * \param ue UE to update
+   * \param assignableInIteration the minimum amount of resources to be assigned
+   *
+   * Calls the PF version, and then NrMacSchedulerUeInfoQos::UpdateDlDelay.
+   */
+  virtual void
+  BeforeDlSched (const UePtrAndBufferReq &ue,
+                 const FTResources &assignableInIteration) const override;
+
+  /**
+   * \brief Calculate the potential throughput and the deadline for the UL
+   * \param ue UE to update
+   * \param assignableInIteration the minimum amount of resources to be assigned
+   *
+   * Calls the PF version, and then NrMacSchedulerUeInfoQos::UpdateUlDelay.
+   */
+  virtual void
+  BeforeUlSched (const UePtrAndBufferReq &ue,
+                 const FTResources &assignableInIteration) const override;
+};
+
+} // namespace ns3
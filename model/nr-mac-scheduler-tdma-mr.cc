@@ -60,4 +60,16 @@ NrMacSchedulerTdmaMR::GetUeCompareUlFn () const
   return NrMacSchedulerUeInfoMR::CompareUeWeightsUl;
 }
 
+void
+NrMacSchedulerTdmaMR::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  NrMacSchedulerUeInfoMR::SortUeDl (ueVector, &m_ueSortBuffer);
+}
+
+void
+NrMacSchedulerTdmaMR::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  NrMacSchedulerUeInfoMR::SortUeUl (ueVector, &m_ueSortBuffer);
+}
+
 } // namespace ns3
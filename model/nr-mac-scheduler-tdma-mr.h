@@ -76,6 +76,25 @@ protected:
   virtual std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
                              const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
   GetUeCompareUlFn () const override;
+
+  /**
+   * \brief Sort the DL UEs with a counting sort on the MCS
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoMR::SortUeDl
+   */
+  virtual void SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Sort the UL UEs with a counting sort on the MCS
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoMR::SortUeUl
+   */
+  virtual void SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+private:
+  mutable std::vector<UePtrAndBufferReq> m_ueSortBuffer; //!< Buffer of the counting sort of the UEs
 };
 
 } // namespace ns3
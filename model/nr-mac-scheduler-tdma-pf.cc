@@ -104,6 +104,18 @@ NrMacSchedulerTdmaPF::GetUeCompareUlFn () const
   return NrMacSchedulerUeInfoPF::CompareUeWeightsUl;
 }
 
+void
+NrMacSchedulerTdmaPF::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoPF::CompareUeWeightsDl> (ueVector);
+}
+
+void
+NrMacSchedulerTdmaPF::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoPF::CompareUeWeightsUl> (ueVector);
+}
+
 void
 NrMacSchedulerTdmaPF::AssignedDlResources (const UePtrAndBufferReq &ue,
                                            [[maybe_unused]] const FTResources &assigned,
@@ -97,6 +97,22 @@ protected:
                              const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
   GetUeCompareUlFn () const override;
 
+  /**
+   * \brief Sort the DL UEs calling NrMacSchedulerUeInfoPF::CompareUeWeightsDl directly
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoPF::CompareUeWeightsDl
+   */
+  virtual void SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Sort the UL UEs calling NrMacSchedulerUeInfoPF::CompareUeWeightsUl directly
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoPF::CompareUeWeightsUl
+   */
+  virtual void SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
   /**
    * \brief Update DL metrics by calling NrMacSchedulerUeInfoPF::UpdatePFDlMetric
    * \param ue UE to update
@@ -0,0 +1,121 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#include "nr-mac-scheduler-tdma-qos.h"
+#include "nr-mac-scheduler-ue-info-qos.h"
+#include <ns3/log.h>
+#include <ns3/double.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrMacSchedulerTdmaQos");
+NS_OBJECT_ENSURE_REGISTERED (NrMacSchedulerTdmaQos);
+
+TypeId
+NrMacSchedulerTdmaQos::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrMacSchedulerTdmaQos")
+    .SetParent<NrMacSchedulerTdmaPF> ()
+    .AddConstructor<NrMacSchedulerTdmaQos> ()
+    .AddAttribute ("UrgencyFactor",
+                   "Ratio between the head of line delay and the packet delay budget after which a UE is served first, "
+                   "by earliest deadline",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&NrMacSchedulerTdmaQos::SetUrgencyFactor,
+                                       &NrMacSchedulerTdmaQos::GetUrgencyFactor),
+                   MakeDoubleChecker<double> (0))
+  ;
+  return tid;
+}
+
+NrMacSchedulerTdmaQos::NrMacSchedulerTdmaQos () : NrMacSchedulerTdmaPF ()
+{
+
+}
+
+void
+NrMacSchedulerTdmaQos::SetUrgencyFactor (double v)
+{
+  NS_LOG_FUNCTION (this);
+  m_urgencyFactor = v;
+}
+
+double
+NrMacSchedulerTdmaQos::GetUrgencyFactor () const
+{
+  NS_LOG_FUNCTION (this);
+  return m_urgencyFactor;
+}
+
+std::shared_ptr<NrMacSchedulerUeInfo>
+NrMacSchedulerTdmaQos::CreateUeRepresentation (const NrMacCschedSapProvider::CschedUeConfigReqParameters &params) const
+{
+  NS_LOG_FUNCTION (this);
+  return std::make_shared <NrMacSchedulerUeInfoQos> (GetFairnessIndex (), m_urgencyFactor,
+                                                     params.m_rnti, params.m_beamConfId,
+                                                     std::bind (&NrMacSchedulerTdmaQos::GetNumRbPerRbg, this));
+}
+
+std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                   const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
+NrMacSchedulerTdmaQos::GetUeCompareDlFn () const
+{
+  return NrMacSchedulerUeInfoQos::CompareUeWeightsDl;
+}
+
+std::function<bool (const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                    const NrMacSchedulerNs3::UePtrAndBufferReq &rhs)>
+NrMacSchedulerTdmaQos::GetUeCompareUlFn () const
+{
+  return NrMacSchedulerUeInfoQos::CompareUeWeightsUl;
+}
+
+void
+NrMacSchedulerTdmaQos::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoQos::CompareUeWeightsDl> (ueVector);
+}
+
+void
+NrMacSchedulerTdmaQos::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  SortUe<NrMacSchedulerUeInfoQos::CompareUeWeightsUl> (ueVector);
+}
+
+void
+NrMacSchedulerTdmaQos::BeforeDlSched (const UePtrAndBufferReq &ue,
+                                     const FTResources &assignableInIteration) const
+{
+  NS_LOG_FUNCTION (this);
+  NrMacSchedulerTdmaPF::BeforeDlSched (ue, assignableInIteration);
+  auto uePtr = std::dynamic_pointer_cast<NrMacSchedulerUeInfoQos> (ue.first);
+  uePtr->UpdateDlDelay ();
+}
+
+void
+NrMacSchedulerTdmaQos::BeforeUlSched (const UePtrAndBufferReq &ue,
+                                     const FTResources &assignableInIteration) const
+{
+  NS_LOG_FUNCTION (this);
+  NrMacSchedulerTdmaPF::BeforeUlSched (ue, assignableInIteration);
+  auto uePtr = std::dynamic_pointer_cast<NrMacSchedulerUeInfoQos> (ue.first);
+  uePtr->UpdateUlDelay ();
+}
+
+} // namespace ns3
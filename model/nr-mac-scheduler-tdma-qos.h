@@ -0,0 +1,139 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+#include "nr-mac-scheduler-tdma-pf.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief Assign symbols taking into account the delay budget of the data
+ *
+ * The UEs whose head of line delay exceeds a fraction (attribute
+ * "UrgencyFactor") of the packet delay budget of the QCI of their LC are
+ * urgent, and they are served first, the one with the earliest deadline
+ * first. The other UEs are sorted by their PF metric, weighted by
+ * (1 + head of line delay / delay budget).
+ *
+ * The DL head of line delay is the one reported by the RLC, while the UL one
+ * is approximated by the time passed since the BSR that announced the data.
+ *
+ * Details of the sorting function in the class NrMacSchedulerUeInfoQos.
+ */
+class NrMacSchedulerTdmaQos : public NrMacSchedulerTdmaPF
+{
+public:
+  /**
+   * \brief GetTypeId
+   * \return The TypeId of the class
+   */
+  static TypeId GetTypeId (void);
+  /**
+   * \brief NrMacSchedulerTdmaQos constructor
+   */
+  NrMacSchedulerTdmaQos ();
+
+  /**
+   * \brief ~NrMacSchedulerTdmaQos deconstructor
+   */
+  virtual ~NrMacSchedulerTdmaQos () override
+  {
+  }
+
+  /**
+   * \brief Set the value of attribute "UrgencyFactor"
+   * \param v the value
+   */
+  void SetUrgencyFactor (double v);
+
+  /**
+   * \brief Get the value of attribute "UrgencyFactor"
+   * \return the value
+   */
+  double GetUrgencyFactor () const;
+
+protected:
+  // inherit
+  /**
+   * \brief Create an UE representation of the type NrMacSchedulerUeInfoQos
+   * \param params parameters
+   * \return NrMacSchedulerUeInfoQos instance
+   */
+  virtual std::shared_ptr<NrMacSchedulerUeInfo>
+  CreateUeRepresentation (const NrMacCschedSapProvider::CschedUeConfigReqParameters& params) const override;
+
+  /**
+   * \brief Return the comparison function to sort DL UE according to the scheduler policy
+   * \return a pointer to NrMacSchedulerUeInfoQos::CompareUeWeightsDl
+   */
+  virtual std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                             const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
+  GetUeCompareDlFn () const override;
+
+  /**
+   * \brief Return the comparison function to sort UL UE according to the scheduler policy
+   * \return a pointer to NrMacSchedulerUeInfoQos::CompareUeWeightsUl
+   */
+  virtual std::function<bool(const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
+                             const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
+  GetUeCompareUlFn () const override;
+
+  /**
+   * \brief Sort the DL UEs calling NrMacSchedulerUeInfoQos::CompareUeWeightsDl directly
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoQos::CompareUeWeightsDl
+   */
+  virtual void SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Sort the UL UEs calling NrMacSchedulerUeInfoQos::CompareUeWeightsUl directly
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoQos::CompareUeWeightsUl
+   */
+  virtual void SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Calculate the potential throughput and the deadline for the DL
+   * \param ue UE to update
+   * \param assignableInIteration the minimum amount of resources to be assigned
+   *
+   * Calls the PF version, and then NrMacSchedulerUeInfoQos::UpdateDlDelay.
+   */
+  virtual void
+  BeforeDlSched (const UePtrAndBufferReq &ue,
+                 const FTResources &assignableInIteration) const override;
+
+  /**
+   * \brief Calculate the potential throughput and the deadline for the UL
+   * \param ue UE to update
+   * \param assignableInIteration the minimum amount of resources to be assigned
+   *
+   * Calls the PF version, and then NrMacSchedulerUeInfoQos::UpdateUlDelay.
+   */
+  virtual void
+  BeforeUlSched (const UePtrAndBufferReq &ue,
+                 const FTResources &assignableInIteration) const override;
+
+private:
+  double m_urgencyFactor {0.5}; //!< Ratio of the delay budget after which a UE is urgent
+};
+
+} // namespace ns3
@@ -85,4 +85,16 @@ NrMacSchedulerTdmaRR::GetUeCompareUlFn () const
   return NrMacSchedulerUeInfoRR::CompareUeWeightsUl;
 }
 
+void
+NrMacSchedulerTdmaRR::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  NrMacSchedulerUeInfoRR::SortUeDl (ueVector);
+}
+
+void
+NrMacSchedulerTdmaRR::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  NrMacSchedulerUeInfoRR::SortUeUl (ueVector);
+}
+
 } //namespace ns3
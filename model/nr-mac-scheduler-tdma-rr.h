@@ -84,6 +84,22 @@ protected:
                              const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
   GetUeCompareUlFn () const override;
 
+  /**
+   * \brief Sort the DL UEs rotating the last served one
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoRR::SortUeDl
+   */
+  virtual void SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
+  /**
+   * \brief Sort the UL UEs rotating the last served one
+   * \param ueVector the UEs to sort
+   *
+   * \see NrMacSchedulerUeInfoRR::SortUeUl
+   */
+  virtual void SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const override;
+
   /**
    * \brief Update the UE representation after a symbol (DL) has been assigned to it
    * \param ue UE to which a symbol has been assigned
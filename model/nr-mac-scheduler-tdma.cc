@@ -77,7 +77,7 @@ NrMacSchedulerTdma::GetUeVectorFromActiveUeMap (const NrMacSchedulerNs3::ActiveU
  * \param activeUe active flows and UE
  * \param type String representing the type of allocation currently in act (DL or UL)
  * \param BeforeSchedFn Function to call before any scheduling is started
- * \param GetCompareFn Function to call to compare UEs during assignment
+ * \param SortFn Function to call to sort the UEs by priority during assignment
  * \param GetTBSFn Function to call to get a reference of the UL or DL TBS
  * \param GetRBGFn Function to call to get a reference of the UL or DL RBG
  * \param GetSymFn Function to call to get a reference of the UL or DL symbols
@@ -101,7 +101,7 @@ NrMacSchedulerTdma::GetUeVectorFromActiveUeMap (const NrMacSchedulerNs3::ActiveU
  *        UnSuccessfullAssignmentFn (ue);
  * </pre>
  *
- * To sort the UEs, the method uses the function returned by GetUeCompareDlFn().
+ * To sort the UEs, the method uses SortUeDl() or SortUeUl().
  * Two fairness helper are hard-coded in the method: the first one is avoid
  * to assign resources to UEs that already have their buffer requirement covered,
  * and the other one is avoid to assign symbols when all the UEs have their
@@ -119,7 +119,7 @@ NrMacSchedulerTdma::GetUeVectorFromActiveUeMap (const NrMacSchedulerNs3::ActiveU
 NrMacSchedulerTdma::BeamSymbolMap
 NrMacSchedulerTdma::AssignRBGTDMA (uint32_t symAvail, const ActiveUeMap &activeUe,
                                        const std::string &type, const BeforeSchedFn &BeforeSchedFn,
-                                       const GetCompareUeFn &GetCompareFn,
+                                       const SortUeFn &SortFn,
                                        const GetTBSFn &GetTBSFn,
                                        const GetRBGFn &GetRBGFn,
                                        const GetSymFn &GetSymFn,
@@ -137,8 +137,8 @@ NrMacSchedulerTdma::AssignRBGTDMA (uint32_t symAvail, const ActiveUeMap &activeU
   uint32_t resources = symAvail;
   FTResources assigned (0, 0);
 
-  const std::vector<uint8_t> notchedRBGsMask = type == "DL" ? GetDlNotchedRbgMask () : GetUlNotchedRbgMask ();
-  int zeroes = std::count (notchedRBGsMask.begin (), notchedRBGsMask.end (), 0);
+  const NrBitset &notchedRBGsMask = type == "DL" ? GetDlNotchedRbgMask () : GetUlNotchedRbgMask ();
+  int zeroes = static_cast<int> (notchedRBGsMask.size () - notchedRBGsMask.count ());
   uint32_t numOfAssignableRbgs = GetBandwidthInRbg () - zeroes;
   NS_ASSERT (numOfAssignableRbgs > 0);
 
@@ -153,7 +153,7 @@ NrMacSchedulerTdma::AssignRBGTDMA (uint32_t symAvail, const ActiveUeMap &activeU
 
       auto schedInfoIt = ueVector.begin ();
 
-      std::sort (ueVector.begin (), ueVector.end (), GetCompareFn ());
+      SortFn (&ueVector);
 
       // Ensure fairness: pass over UEs which already has enough resources to transmit
       while (schedInfoIt != ueVector.end ())
@@ -300,13 +300,13 @@ NrMacSchedulerTdma::AssignDLRBG (uint32_t symAvail, const ActiveUeMap &activeDl)
   AfterUnsucessfullAssignmentFn UnSuccFn = std::bind (&NrMacSchedulerTdma::NotAssignedDlResources, this,
                                                       std::placeholders::_1, std::placeholders::_2,
                                                       std::placeholders::_3);
-  GetCompareUeFn compareFn = std::bind (&NrMacSchedulerTdma::GetUeCompareDlFn, this);
+  SortUeFn sortFn = std::bind (&NrMacSchedulerTdma::SortUeDl, this, std::placeholders::_1);
 
   GetTBSFn GetTbs = &NrMacSchedulerUeInfo::GetDlTBS;
   GetRBGFn GetRBG = &NrMacSchedulerUeInfo::GetDlRBG;
   GetSymFn GetSym = &NrMacSchedulerUeInfo::GetDlSym;
 
-  return AssignRBGTDMA (symAvail, activeDl, "DL", beforeSched, compareFn,
+  return AssignRBGTDMA (symAvail, activeDl, "DL", beforeSched, sortFn,
                         GetTbs, GetRBG, GetSym, SuccFn, UnSuccFn);
 }
 
@@ -328,7 +328,7 @@ NrMacSchedulerTdma::AssignULRBG (uint32_t symAvail, const ActiveUeMap &activeUl)
   AfterSuccessfullAssignmentFn SuccFn = std::bind (&NrMacSchedulerTdma::AssignedUlResources, this,
                                                    std::placeholders::_1, std::placeholders::_2,
                                                    std::placeholders::_3);
-  GetCompareUeFn compareFn = std::bind (&NrMacSchedulerTdma::GetUeCompareUlFn, this);
+  SortUeFn sortFn = std::bind (&NrMacSchedulerTdma::SortUeUl, this, std::placeholders::_1);
   AfterUnsucessfullAssignmentFn UnSuccFn = std::bind (&NrMacSchedulerTdma::NotAssignedUlResources, this,
                                                       std::placeholders::_1, std::placeholders::_2,
                                                       std::placeholders::_3);
@@ -336,10 +336,22 @@ NrMacSchedulerTdma::AssignULRBG (uint32_t symAvail, const ActiveUeMap &activeUl)
   GetRBGFn GetRBG = &NrMacSchedulerUeInfo::GetUlRBG;
   GetSymFn GetSym = &NrMacSchedulerUeInfo::GetUlSym;
 
-  return AssignRBGTDMA (symAvail, activeUl, "UL", beforeSched, compareFn,
+  return AssignRBGTDMA (symAvail, activeUl, "UL", beforeSched, sortFn,
                         GetTbs, GetRBG, GetSym, SuccFn, UnSuccFn);
 }
 
+void
+NrMacSchedulerTdma::SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  std::sort (ueVector->begin (), ueVector->end (), GetUeCompareDlFn ());
+}
+
+void
+NrMacSchedulerTdma::SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const
+{
+  std::sort (ueVector->begin (), ueVector->end (), GetUeCompareUlFn ());
+}
+
 /**
  * \brief Create a DL DCI starting from spoint and spanning maxSym symbols
  * \param spoint Starting point of the DCI
@@ -364,9 +376,9 @@ NrMacSchedulerTdma::CreateDlDci (PointInFTPlane *spoint,
   //here to cover MIMO
 
   //Due to MIMO implementation MCS, TB size, ndi, rv, are vectors
-    std::vector<uint8_t> ndi;
+    StreamVector<uint8_t> ndi;
     ndi.resize (ueInfo->m_dlTbSize.size ());
-    std::vector<uint8_t> rv;
+    StreamVector<uint8_t> rv;
     rv.resize (ueInfo->m_dlTbSize.size ());
     uint32_t tbs = 0;
     for (uint32_t numTb = 0; numTb < ueInfo->m_dlTbSize.size (); numTb++)
@@ -396,8 +408,8 @@ NrMacSchedulerTdma::CreateDlDci (PointInFTPlane *spoint,
       return nullptr;
     }
 
-  const std::vector<uint8_t> notchedRBGsMask = GetDlNotchedRbgMask ();
-  int zeroes = std::count (notchedRBGsMask.begin (), notchedRBGsMask.end (), 0);
+  const NrBitset &notchedRBGsMask = GetDlNotchedRbgMask ();
+  int zeroes = static_cast<int> (notchedRBGsMask.size () - notchedRBGsMask.count ());
   uint32_t numOfAssignableRbgs = GetBandwidthInRbg () - zeroes;
 
   uint8_t numSym = static_cast<uint8_t> (ueInfo->m_dlRBG / numOfAssignableRbgs);
@@ -442,8 +454,8 @@ NrMacSchedulerTdma::CreateUlDci (NrMacSchedulerNs3::PointInFTPlane *spoint,
       return nullptr;
     }
 
-  const std::vector<uint8_t> notchedRBGsMask = GetUlNotchedRbgMask ();
-  int zeroes = std::count (notchedRBGsMask.begin (), notchedRBGsMask.end (), 0);
+  const NrBitset &notchedRBGsMask = GetUlNotchedRbgMask ();
+  int zeroes = static_cast<int> (notchedRBGsMask.size () - notchedRBGsMask.count ());
   uint32_t numOfAssignableRbgs = GetBandwidthInRbg () - zeroes;
 
   uint8_t numSym = static_cast<uint8_t> (std::max (ueInfo->m_ulRBG / numOfAssignableRbgs, 1U));
@@ -455,10 +467,10 @@ NrMacSchedulerTdma::CreateUlDci (NrMacSchedulerNs3::PointInFTPlane *spoint,
   spoint->m_sym -= numSym;
 
   //Due to MIMO implementation MCS and TB size are vectors
-  std::vector<uint8_t> ulMcs = {ueInfo->m_ulMcs};
-  std::vector<uint32_t> ulTbs = {tbs};
-  std::vector<uint8_t> ndi = {1};
-  std::vector<uint8_t> rv = {0};
+  StreamVector<uint8_t> ulMcs = {ueInfo->m_ulMcs};
+  StreamVector<uint32_t> ulTbs = {tbs};
+  StreamVector<uint8_t> ndi = {1};
+  StreamVector<uint8_t> rv = {0};
 
   auto dci = CreateDci (spoint, ueInfo, ulTbs, DciInfoElementTdma::UL, ulMcs,
                         ndi, rv, numSym);
@@ -492,9 +504,9 @@ NrMacSchedulerTdma::GetTpc () const
 std::shared_ptr<DciInfoElementTdma>
 NrMacSchedulerTdma::CreateDci (NrMacSchedulerNs3::PointInFTPlane *spoint,
                                const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
-                               std::vector<uint32_t> tbs, DciInfoElementTdma::DciFormat fmt,
-                               std::vector<uint8_t> mcs, std::vector<uint8_t> ndi,
-                               std::vector<uint8_t> rv,uint8_t numSym) const
+                               const StreamVector<uint32_t> &tbs, DciInfoElementTdma::DciFormat fmt,
+                               const StreamVector<uint8_t> &mcs, const StreamVector<uint8_t> &ndi,
+                               const StreamVector<uint8_t> &rv, uint8_t numSym) const
 {
   NS_LOG_FUNCTION (this);
   uint32_t sumTbSize = 0;
@@ -505,33 +517,29 @@ NrMacSchedulerTdma::CreateDci (NrMacSchedulerNs3::PointInFTPlane *spoint,
   NS_ASSERT (sumTbSize > 0);
   NS_ASSERT (numSym > 0);
 
-  std::shared_ptr<DciInfoElementTdma> dci = std::make_shared<DciInfoElementTdma>
+  std::shared_ptr<DciInfoElementTdma> dci = DciInfoElementTdma::Create
       (ueInfo->m_rnti, fmt, spoint->m_sym, numSym, mcs, tbs, ndi, rv, DciInfoElementTdma::DATA,
        GetBwpId (), GetTpc());
 
-  std::vector<uint8_t> rbgAssigned = fmt == DciInfoElementTdma::DL ? GetDlNotchedRbgMask () :
-                                                                     GetUlNotchedRbgMask ();
+  const NrBitset &rbgAssigned = fmt == DciInfoElementTdma::DL ? GetDlNotchedRbgMask () :
+                                                                GetUlNotchedRbgMask ();
 
   if (rbgAssigned.size() == 0)
     {
-      rbgAssigned = std::vector<uint8_t> (GetBandwidthInRbg (), 1);
+      dci->m_rbgBitmask = NrBitset (GetBandwidthInRbg (), true);
     }
-
-  NS_ASSERT (rbgAssigned.size () == GetBandwidthInRbg ());
-
-  dci->m_rbgBitmask = std::move (rbgAssigned);
-
-  std::ostringstream oss;
-  for (auto & x: dci->m_rbgBitmask)
+  else
     {
-      oss << std::to_string (x) << " ";
+      dci->m_rbgBitmask = rbgAssigned;
     }
 
+  NS_ASSERT (dci->m_rbgBitmask.size () == GetBandwidthInRbg ());
+
   NS_LOG_INFO ("UE " << ueInfo->m_rnti << " assigned RBG from " <<
                static_cast<uint32_t> (spoint->m_rbg) << " with mask " <<
-               oss.str() << " for " << static_cast<uint32_t> (numSym) << " SYM ");
+               dci->m_rbgBitmask << " for " << static_cast<uint32_t> (numSym) << " SYM ");
 
-  NS_ASSERT (std::count (dci->m_rbgBitmask.begin (), dci->m_rbgBitmask.end (), 0) != GetBandwidthInRbg ());
+  NS_ASSERT (dci->m_rbgBitmask.any ());
 
   return dci;
 }
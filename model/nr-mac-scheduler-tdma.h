@@ -19,6 +19,7 @@
 #pragma once
 
 #include "nr-mac-scheduler-ns3.h"
+#include <algorithm>
 #include <memory>
 #include <functional>
 
@@ -140,6 +141,39 @@ protected:
                              const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )>
   GetUeCompareUlFn () const = 0;
 
+  /**
+   * \brief Sort the UEs by their DL priority, the highest first
+   * \param ueVector the UEs to sort
+   *
+   * It is called before the assignment of each resource. The default
+   * implementation sorts with the function returned by GetUeCompareDlFn();
+   * the subclasses override it with a sort specialized on their metric, or
+   * with SortUe() to avoid calling the comparison through a std::function.
+   */
+  virtual void SortUeDl (std::vector<UePtrAndBufferReq> *ueVector) const;
+
+  /**
+   * \brief Sort the UEs by their UL priority, the highest first
+   * \param ueVector the UEs to sort
+   *
+   * \see SortUeDl
+   */
+  virtual void SortUeUl (std::vector<UePtrAndBufferReq> *ueVector) const;
+
+  /**
+   * \brief Sort the UEs with a comparison function known at compile time
+   * \param ueVector the UEs to sort
+   */
+  template <bool (*Compare) (const UePtrAndBufferReq &, const UePtrAndBufferReq &)>
+  static void SortUe (std::vector<UePtrAndBufferReq> *ueVector)
+  {
+    std::sort (ueVector->begin (), ueVector->end (),
+               [] (const UePtrAndBufferReq &lhs, const UePtrAndBufferReq &rhs)
+                 {
+                   return Compare (lhs, rhs);
+                 });
+  }
+
   /**
    * \brief Update the UE representation after a symbol (DL) has been assigned to it
    * \param ue UE to which a symbol has been assigned
@@ -241,22 +275,20 @@ private:
   typedef std::function<uint32_t& (const UePtr &ue)> GetRBGFn; //!< Getter for the RBG of an UE
   typedef std::function<uint32_t (const UePtr &ue)> GetTBSFn; //!< Getter for the TBS of an UE
   typedef std::function<uint8_t& (const UePtr &ue)> GetSymFn;  //!< Getter for the number of symbols of an UE
-  typedef std::function<bool (const NrMacSchedulerNs3::UePtrAndBufferReq &lhs,
-                              const NrMacSchedulerNs3::UePtrAndBufferReq &rhs )> CompareUeFn;
-  typedef std::function<CompareUeFn ()> GetCompareUeFn;
+  typedef std::function<void (std::vector<UePtrAndBufferReq> *)> SortUeFn; //!< Sort the UEs by priority
 
   BeamSymbolMap
   AssignRBGTDMA (uint32_t symAvail, const ActiveUeMap &activeUe,
                  const std::string &type, const BeforeSchedFn &BeforeSchedFn,
-                 const GetCompareUeFn &GetCompareFn, const GetTBSFn &GetTBSFn, const GetRBGFn &GetRBGFn,
+                 const SortUeFn &SortFn, const GetTBSFn &GetTBSFn, const GetRBGFn &GetRBGFn,
                  const GetSymFn &GetSymFn, const AfterSuccessfullAssignmentFn &SuccessfullAssignmentFn,
                  const AfterUnsucessfullAssignmentFn &UnSuccessfullAssignmentFn) const;
 
 
   std::shared_ptr<DciInfoElementTdma> CreateDci (PointInFTPlane *spoint, const std::shared_ptr<NrMacSchedulerUeInfo> &ueInfo,
-                                                 std::vector<uint32_t> tbs, DciInfoElementTdma::DciFormat fmt,
-                                                 std::vector<uint8_t> mcs, std::vector<uint8_t> ndi,
-                                                 std::vector<uint8_t> rv, uint8_t numSym) const;
+                                                 const StreamVector<uint32_t> &tbs, DciInfoElementTdma::DciFormat fmt,
+                                                 const StreamVector<uint8_t> &mcs, const StreamVector<uint8_t> &ndi,
+                                                 const StreamVector<uint8_t> &rv, uint8_t numSym) const;
 };
 
 } // namespace ns3
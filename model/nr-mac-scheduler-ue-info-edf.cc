@@ -0,0 +1,46 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-mac-scheduler-ue-info-edf.h"
+
+namespace ns3 {
+
+bool
+NrMacSchedulerUeInfoEdf::CompareUeWeightsDl (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                                             const NrMacSchedulerNs3::UePtrAndBufferReq &rue)
+{
+  auto luePtr = dynamic_cast<NrMacSchedulerUeInfoEdf*> (lue.first.get ());
+  auto ruePtr = dynamic_cast<NrMacSchedulerUeInfoEdf*> (rue.first.get ());
+
+  return Compare (luePtr->m_dlDeadline, luePtr->GetDlQosMetric (),
+                  ruePtr->m_dlDeadline, ruePtr->GetDlQosMetric ());
+}
+
+bool
+NrMacSchedulerUeInfoEdf::CompareUeWeightsUl (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                                             const NrMacSchedulerNs3::UePtrAndBufferReq &rue)
+{
+  auto luePtr = dynamic_cast<NrMacSchedulerUeInfoEdf*> (lue.first.get ());
+  auto ruePtr = dynamic_cast<NrMacSchedulerUeInfoEdf*> (rue.first.get ());
+
+  return Compare (luePtr->m_ulDeadline, luePtr->GetUlQosMetric (),
+                  ruePtr->m_ulDeadline, ruePtr->GetUlQosMetric ());
+}
+
+} // namespace ns3
@@ -0,0 +1,103 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+
+#include "nr-mac-scheduler-ue-info-qos.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief UE representation for an earliest-deadline-first (EDF) scheduler
+ *
+ * The deadline is the one of NrMacSchedulerUeInfoQos: the time at which the
+ * head of line data of one of the LC of the UE exceeds the packet delay
+ * budget of its QCI. All the UEs with a deadline are sorted by it, the
+ * earliest first, whatever their head of line delay; equal deadlines are
+ * broken by the QoS metric. The UEs without a deadline (no data, or no
+ * delay budget) come last, by their QoS metric.
+ *
+ * \see CompareUeWeightsDl
+ * \see CompareUeWeightsUl
+ */
+class NrMacSchedulerUeInfoEdf : public NrMacSchedulerUeInfoQos
+{
+public:
+  /**
+   * \brief NrMacSchedulerUeInfoEdf constructor
+   * \param alpha PF fairness index
+   * \param rnti RNTI of the UE
+   * \param beamConfId BeamConfId of the UE
+   * \param fn A function that tells how many RB per RBG
+   */
+  NrMacSchedulerUeInfoEdf (float alpha, uint16_t rnti, BeamConfId beamConfId,
+                           const GetRbPerRbgFn &fn)
+    : NrMacSchedulerUeInfoQos (alpha, 0.0, rnti, beamConfId, fn)
+  {
+  }
+
+  virtual uint64_t GetMemoryUsage () const override
+  {
+    return NrMacSchedulerUeInfoQos::GetMemoryUsage ()
+      + sizeof (NrMacSchedulerUeInfoEdf) - sizeof (NrMacSchedulerUeInfoQos);
+  }
+
+  /**
+   * \brief comparison function object (i.e. an object that satisfies the
+   * requirements of Compare) which returns true if the first argument is less
+   * than (i.e. is ordered before) the second.
+   * \param lue Left UE
+   * \param rue Right UE
+   * \return true if the left UE has an earlier DL deadline than the right
+   * UE, or the same deadline and a higher QoS metric
+   */
+  static bool CompareUeWeightsDl (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                                  const NrMacSchedulerNs3::UePtrAndBufferReq &rue);
+
+  /**
+   * \brief comparison function object (i.e. an object that satisfies the
+   * requirements of Compare) which returns true if the first argument is less
+   * than (i.e. is ordered before) the second.
+   * \param lue Left UE
+   * \param rue Right UE
+   * \return as CompareUeWeightsDl, with the UL deadlines and metrics
+   */
+  static bool CompareUeWeightsUl (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                                  const NrMacSchedulerNs3::UePtrAndBufferReq &rue);
+
+  /**
+   * \brief Order two UEs by deadline, and then by QoS metric
+   * \param lDeadline the deadline of the left UE
+   * \param lMetric the QoS metric of the left UE
+   * \param rDeadline the deadline of the right UE
+   * \param rMetric the QoS metric of the right UE
+   * \return true if the left UE comes first
+   */
+  static bool Compare (const Time &lDeadline, double lMetric,
+                       const Time &rDeadline, double rMetric)
+  {
+    if (lDeadline != rDeadline)
+      {
+        return lDeadline < rDeadline;
+      }
+    return lMetric > rMetric;
+  }
+};
+
+} // namespace ns3
@@ -20,6 +20,8 @@
 
 #include "nr-mac-scheduler-ns3.h"
 #include "nr-mac-scheduler-ue-info-rr.h"
+#include <algorithm>
+#include <array>
 
 namespace ns3 {
 
@@ -90,6 +92,103 @@ public:
 
     return (lue.first->m_ulMcs > rue.first->m_ulMcs);
   }
+
+  /**
+   * \brief Sort the UEs by CompareUeWeightsDl, the highest DL MCS first
+   * \param ueVector the UEs
+   * \param buffer a buffer for the sort, that can be reused between the calls
+   *
+   * \see CountingSort
+   */
+  static void SortUeDl (std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> *ueVector,
+                        std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> *buffer)
+  {
+    CountingSort (ueVector, buffer,
+                  [] (const NrMacSchedulerNs3::UePtrAndBufferReq &ue)
+                    {
+                      return ue.first->m_dlMcs.at (0);
+                    },
+                  [] (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                      const NrMacSchedulerNs3::UePtrAndBufferReq &rue)
+                    {
+                      return CompareUeWeightsDl (lue, rue);
+                    });
+  }
+
+  /**
+   * \brief Sort the UEs by CompareUeWeightsUl, the highest UL MCS first
+   * \param ueVector the UEs
+   * \param buffer a buffer for the sort, that can be reused between the calls
+   *
+   * \see CountingSort
+   */
+  static void SortUeUl (std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> *ueVector,
+                        std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> *buffer)
+  {
+    CountingSort (ueVector, buffer,
+                  [] (const NrMacSchedulerNs3::UePtrAndBufferReq &ue)
+                    {
+                      return ue.first->m_ulMcs;
+                    },
+                  [] (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                      const NrMacSchedulerNs3::UePtrAndBufferReq &rue)
+                    {
+                      return CompareUeWeightsUl (lue, rue);
+                    });
+  }
+
+  /**
+   * \brief Sort the UEs by a uint8_t key, the highest first, and then by a
+   * comparison function
+   * \param ueVector the UEs
+   * \param buffer a buffer for the sort
+   * \param key the key of an UE (the MCS of its first stream)
+   * \param compare the comparison function, which must order the UEs by
+   * decreasing key first
+   *
+   * The MCS is a small integer: the UEs are distributed in one bucket per
+   * key with a counting sort, in O(U), and only the UEs in the same bucket
+   * are sorted with the comparison function (to order them by the MCS of
+   * the other streams, and then as the RR scheduler).
+   *
+   * Both passes are stable, so the result is the one of std::stable_sort
+   * with the comparison function: the UEs that compare equal keep their
+   * order. It is also the one of the std::sort of libstdc++ up to 16 UEs,
+   * but not above, where std::sort permutes them.
+   */
+  template <typename Key, typename Compare>
+  static void CountingSort (std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> *ueVector,
+                            std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> *buffer,
+                            Key key, Compare compare)
+  {
+    // Bucket UINT8_MAX - key, so that the highest key is the first
+    std::array<uint32_t, UINT8_MAX + 2> bucketEnd {};
+    for (const auto &ue : *ueVector)
+      {
+        bucketEnd[UINT8_MAX - key (ue) + 1]++;
+      }
+    for (size_t bucket = 1; bucket < bucketEnd.size (); ++bucket)
+      {
+        bucketEnd[bucket] += bucketEnd[bucket - 1];
+      }
+    buffer->resize (ueVector->size ());
+    for (auto &ue : *ueVector)
+      {
+        (*buffer)[bucketEnd[UINT8_MAX - key (ue)]++] = std::move (ue);
+      }
+    ueVector->swap (*buffer);
+
+    auto begin = ueVector->begin ();
+    for (size_t bucket = 0; bucket <= UINT8_MAX && begin != ueVector->end (); ++bucket)
+      {
+        auto end = ueVector->begin () + bucketEnd[bucket];
+        if (end - begin > 1)
+          {
+            std::stable_sort (begin, end, compare);
+          }
+        begin = end;
+      }
+  }
 };
 
 } // namespace ns3
@@ -19,6 +19,8 @@
 
 #include "nr-mac-scheduler-ue-info-pf.h"
 #include <ns3/log.h>
+#include <algorithm>
+#include <functional>
 
 namespace ns3 {
 
@@ -83,18 +85,20 @@ NrMacSchedulerUeInfoPF::CalculatePotentialTPutDl (const NrMacSchedulerNs3::FTRes
 
   if (this->m_dlCqi.m_ri == 1)
     {
-      std::vector<uint8_t>::const_iterator mcsIt;
+      StreamVector<uint8_t>::const_iterator mcsIt;
       mcsIt = std::max_element (m_dlMcs.begin(), m_dlMcs.end());
       m_potentialTputDl =  amc->CalculateTbSize (*mcsIt, rbsAssignable);
     }
 
-  if (this->m_dlCqi.m_ri == 2)
+  if (this->m_dlCqi.m_ri >= 2)
     {
-      //if the UE supports two streams potential throughput is the sum of
-      //both the TBs.
-      for (const auto &it:m_dlMcs)
+      //if the UE supports more streams potential throughput is the sum of
+      //the TBs of the RI streams with the highest MCS.
+      StreamVector<uint8_t> mcs = m_dlMcs;
+      std::sort (mcs.begin (), mcs.end (), std::greater<uint8_t> ());
+      for (uint8_t stream = 0; stream < std::min<size_t> (m_dlCqi.m_ri, mcs.size ()); stream++)
         {
-          m_potentialTputDl +=  amc->CalculateTbSize (it, rbsAssignable);
+          m_potentialTputDl +=  amc->CalculateTbSize (mcs.at (stream), rbsAssignable);
         }
     }
 
@@ -100,6 +100,12 @@ public:
     m_avgTputUl = m_lastAvgTputUl;
   }
 
+  virtual uint64_t GetMemoryUsage () const override
+  {
+    return NrMacSchedulerUeInfo::GetMemoryUsage ()
+      + sizeof (NrMacSchedulerUeInfoPF) - sizeof (NrMacSchedulerUeInfo);
+  }
+
   /**
    * \brief Update the PF metric for downlink
    * \param totAssigned the resources assigned
@@ -0,0 +1,109 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-mac-scheduler-ue-info-qos.h"
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrMacSchedulerUeInfoQos");
+
+void
+NrMacSchedulerUeInfoQos::ComputeDelay (const std::unordered_map<uint8_t, LCGPtr> &lcgs,
+                                       Time *deadline, double *ratio)
+{
+  *deadline = Time::Max ();
+  *ratio = 0.0;
+  Time delayBudget = Time::Max ();
+  for (const auto &lcg : lcgs)
+    {
+      Time budget;
+      Time lcgDeadline = lcg.second->GetEarliestDeadline (&budget);
+      if (lcgDeadline < *deadline)
+        {
+          *deadline = lcgDeadline;
+          delayBudget = budget;
+        }
+    }
+
+  if (*deadline != Time::Max () && delayBudget.IsStrictlyPositive ())
+    {
+      Time holDelay = Simulator::Now () - (*deadline - delayBudget);
+      *ratio = std::max (0.0, holDelay.GetSeconds () / delayBudget.GetSeconds ());
+    }
+}
+
+void
+NrMacSchedulerUeInfoQos::UpdateDlDelay ()
+{
+  NS_LOG_FUNCTION (this);
+  ComputeDelay (m_dlLCG, &m_dlDeadline, &m_dlDelayRatio);
+  m_dlUrgent = m_dlDeadline != Time::Max () && m_dlDelayRatio >= m_urgencyFactor;
+  NS_LOG_INFO ("UE " << m_rnti << " DL deadline " << m_dlDeadline.As (Time::MS) <<
+               " delay ratio " << m_dlDelayRatio << " urgent " << m_dlUrgent);
+}
+
+void
+NrMacSchedulerUeInfoQos::UpdateUlDelay ()
+{
+  NS_LOG_FUNCTION (this);
+  ComputeDelay (m_ulLCG, &m_ulDeadline, &m_ulDelayRatio);
+  m_ulUrgent = m_ulDeadline != Time::Max () && m_ulDelayRatio >= m_urgencyFactor;
+  NS_LOG_INFO ("UE " << m_rnti << " UL deadline " << m_ulDeadline.As (Time::MS) <<
+               " delay ratio " << m_ulDelayRatio << " urgent " << m_ulUrgent);
+}
+
+double
+NrMacSchedulerUeInfoQos::GetDlQosMetric () const
+{
+  double pfMetric = std::pow (m_potentialTputDl, m_alpha) / std::max (1E-9, m_avgTputDl);
+  return pfMetric * (1.0 + m_dlDelayRatio);
+}
+
+double
+NrMacSchedulerUeInfoQos::GetUlQosMetric () const
+{
+  double pfMetric = std::pow (m_potentialTputUl, m_alpha) / std::max (1E-9, m_avgTputUl);
+  return pfMetric * (1.0 + m_ulDelayRatio);
+}
+
+bool
+NrMacSchedulerUeInfoQos::CompareUeWeightsDl (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                                             const NrMacSchedulerNs3::UePtrAndBufferReq &rue)
+{
+  auto luePtr = dynamic_cast<NrMacSchedulerUeInfoQos*> (lue.first.get ());
+  auto ruePtr = dynamic_cast<NrMacSchedulerUeInfoQos*> (rue.first.get ());
+
+  return Compare (luePtr->m_dlUrgent, luePtr->m_dlDeadline, luePtr->GetDlQosMetric (),
+                  ruePtr->m_dlUrgent, ruePtr->m_dlDeadline, ruePtr->GetDlQosMetric ());
+}
+
+bool
+NrMacSchedulerUeInfoQos::CompareUeWeightsUl (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                                             const NrMacSchedulerNs3::UePtrAndBufferReq &rue)
+{
+  auto luePtr = dynamic_cast<NrMacSchedulerUeInfoQos*> (lue.first.get ());
+  auto ruePtr = dynamic_cast<NrMacSchedulerUeInfoQos*> (rue.first.get ());
+
+  return Compare (luePtr->m_ulUrgent, luePtr->m_ulDeadline, luePtr->GetUlQosMetric (),
+                  ruePtr->m_ulUrgent, ruePtr->m_ulDeadline, ruePtr->GetUlQosMetric ());
+}
+
+} // namespace ns3
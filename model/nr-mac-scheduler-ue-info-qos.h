@@ -0,0 +1,156 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+
+#include "nr-mac-scheduler-ue-info-pf.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief UE representation for a delay-budget-aware (QoS) scheduler
+ *
+ * On top of the PF representation, it stores the earliest deadline of the
+ * data of the UE, i.e., the time at which the head of line data of one of
+ * its LC exceeds the packet delay budget of the LC QCI, and the ratio
+ * between the head of line delay and the delay budget of that LC.
+ *
+ * The UEs whose ratio reached the urgency factor are urgent: they come
+ * before the others, the earliest deadline first. The other UEs are sorted
+ * by the PF metric weighted by (1 + ratio).
+ *
+ * \see CompareUeWeightsDl
+ * \see CompareUeWeightsUl
+ */
+class NrMacSchedulerUeInfoQos : public NrMacSchedulerUeInfoPF
+{
+public:
+  /**
+   * \brief NrMacSchedulerUeInfoQos constructor
+   * \param alpha PF fairness index
+   * \param urgencyFactor ratio of the delay budget after which the UE is urgent
+   * \param rnti RNTI of the UE
+   * \param beamConfId BeamConfId of the UE
+   * \param fn A function that tells how many RB per RBG
+   */
+  NrMacSchedulerUeInfoQos (float alpha, double urgencyFactor, uint16_t rnti,
+                           BeamConfId beamConfId, const GetRbPerRbgFn &fn)
+    : NrMacSchedulerUeInfoPF (alpha, rnti, beamConfId, fn),
+    m_urgencyFactor (urgencyFactor)
+  {
+  }
+
+  virtual uint64_t GetMemoryUsage () const override
+  {
+    return NrMacSchedulerUeInfoPF::GetMemoryUsage ()
+      + sizeof (NrMacSchedulerUeInfoQos) - sizeof (NrMacSchedulerUeInfoPF);
+  }
+
+  /**
+   * \brief Update the DL deadline and delay ratio from the DL LCG, at the current time
+   */
+  void UpdateDlDelay ();
+
+  /**
+   * \brief Update the UL deadline and delay ratio from the UL LCG, at the current time
+   */
+  void UpdateUlDelay ();
+
+  /**
+   * \brief Get the DL QoS metric of the non-urgent UEs
+   * \return the PF metric weighted by (1 + m_dlDelayRatio)
+   */
+  double GetDlQosMetric () const;
+
+  /**
+   * \brief Get the UL QoS metric of the non-urgent UEs
+   * \return the PF metric weighted by (1 + m_ulDelayRatio)
+   */
+  double GetUlQosMetric () const;
+
+  /**
+   * \brief comparison function object (i.e. an object that satisfies the
+   * requirements of Compare) which returns true if the first argument is less
+   * than (i.e. is ordered before) the second.
+   * \param lue Left UE
+   * \param rue Right UE
+   * \return true if the left UE is urgent and has an earlier deadline than
+   * the right UE (or the right UE is not urgent), or if both are not urgent
+   * and the left UE has the higher QoS metric
+   */
+  static bool CompareUeWeightsDl (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                                  const NrMacSchedulerNs3::UePtrAndBufferReq &rue);
+
+  /**
+   * \brief comparison function object (i.e. an object that satisfies the
+   * requirements of Compare) which returns true if the first argument is less
+   * than (i.e. is ordered before) the second.
+   * \param lue Left UE
+   * \param rue Right UE
+   * \return as CompareUeWeightsDl, with the UL deadlines and metrics
+   */
+  static bool CompareUeWeightsUl (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                                  const NrMacSchedulerNs3::UePtrAndBufferReq &rue);
+
+  double m_urgencyFactor {1.0};     //!< Ratio of the delay budget after which the UE is urgent
+
+  Time m_dlDeadline {Time::Max ()}; //!< Earliest deadline of the DL data
+  double m_dlDelayRatio {0.0};      //!< HOL delay over delay budget of the DL LC with the earliest deadline
+  bool m_dlUrgent {false};          //!< Whether the DL delay ratio reached the urgency factor
+
+  Time m_ulDeadline {Time::Max ()}; //!< Earliest deadline of the UL data
+  double m_ulDelayRatio {0.0};      //!< HOL delay over delay budget of the UL LC with the earliest deadline
+  bool m_ulUrgent {false};          //!< Whether the UL delay ratio reached the urgency factor
+
+private:
+  /**
+   * \brief Compute the earliest deadline and the delay ratio of a set of LCG
+   * \param lcgs the LCG
+   * \param deadline the earliest deadline
+   * \param ratio the delay ratio of the LC with the earliest deadline
+   */
+  static void ComputeDelay (const std::unordered_map<uint8_t, LCGPtr> &lcgs,
+                            Time *deadline, double *ratio);
+
+  /**
+   * \brief Order two UEs by urgency, deadline and QoS metric
+   * \param lUrgent whether the left UE is urgent
+   * \param lDeadline the deadline of the left UE
+   * \param lMetric the QoS metric of the left UE
+   * \param rUrgent whether the right UE is urgent
+   * \param rDeadline the deadline of the right UE
+   * \param rMetric the QoS metric of the right UE
+   * \return true if the left UE comes first
+   */
+  static bool Compare (bool lUrgent, const Time &lDeadline, double lMetric,
+                       bool rUrgent, const Time &rDeadline, double rMetric)
+  {
+    if (lUrgent != rUrgent)
+      {
+        return lUrgent;
+      }
+    if (lUrgent)
+      {
+        return lDeadline < rDeadline;
+      }
+    return lMetric > rMetric;
+  }
+};
+
+} // namespace ns3
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "nr-mac-scheduler-ns3.h"
+#include <algorithm>
 
 namespace ns3 {
 
@@ -83,6 +84,74 @@ public:
   {
     return (lue.first->m_ulRBG < rue.first->m_ulRBG);
   }
+
+  /**
+   * \brief Sort the UEs by CompareUeWeightsDl, the fewest DL RBG first
+   * \param ueVector the UEs, sorted by a previous call except for one UE
+   *
+   * \see RotateSort
+   */
+  static void SortUeDl (std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> *ueVector)
+  {
+    RotateSort (ueVector, [] (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                              const NrMacSchedulerNs3::UePtrAndBufferReq &rue)
+                  {
+                    return CompareUeWeightsDl (lue, rue);
+                  });
+  }
+
+  /**
+   * \brief Sort the UEs by CompareUeWeightsUl, the fewest UL RBG first
+   * \param ueVector the UEs, sorted by a previous call except for one UE
+   *
+   * \see RotateSort
+   */
+  static void SortUeUl (std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> *ueVector)
+  {
+    RotateSort (ueVector, [] (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                              const NrMacSchedulerNs3::UePtrAndBufferReq &rue)
+                  {
+                    return CompareUeWeightsUl (lue, rue);
+                  });
+  }
+
+  /**
+   * \brief Sort a vector of UEs in which, at most, one UE moved back
+   * \param ueVector the UEs
+   * \param compare the comparison function
+   *
+   * Between two sorts of the assignment loop of a RR scheduler, only the UE
+   * that was served gets more resources. Instead of sorting all the UEs
+   * again, the UE is rotated before the first UE that does not have fewer
+   * resources than it, in O(U). If the vector has any other disorder (e.g.,
+   * at the first call), it is sorted entirely.
+   *
+   * The result is always the one of std::stable_sort: the UEs with the same
+   * resources keep their order. It is also the one of the std::sort of
+   * libstdc++ up to 16 UEs, but not above, where std::sort permutes them.
+   */
+  template <typename Compare>
+  static void RotateSort (std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> *ueVector,
+                          Compare compare)
+  {
+    auto next = std::is_sorted_until (ueVector->begin (), ueVector->end (), compare);
+    if (next == ueVector->end ())
+      {
+        return;
+      }
+    // The rotation moves the UE only past UEs that are ordered before it,
+    // so it does not change the order of the UEs with the same resources
+    auto moved = next - 1;
+    if (std::is_sorted (next, ueVector->end (), compare))
+      {
+        std::rotate (moved, next, std::lower_bound (next, ueVector->end (), *moved, compare));
+        if (std::is_sorted (ueVector->begin (), ueVector->end (), compare))
+          {
+            return;
+          }
+      }
+    std::stable_sort (ueVector->begin (), ueVector->end (), compare);
+  }
 };
 
 } // namespace ns3
@@ -0,0 +1,105 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+
+#include "nr-mac-scheduler-ue-info-pf.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief UE representation for a scheduler driven by an external agent
+ *
+ * On top of the PF representation, it stores the weight that the agent
+ * gave to the UE for the current slot, or a negative value if the agent
+ * gave none. The UEs with a weight come first, the highest weight first;
+ * the others follow, sorted by their PF metric.
+ *
+ * \see NrMacSchedulerOfdmaShm
+ */
+class NrMacSchedulerUeInfoShm : public NrMacSchedulerUeInfoPF
+{
+public:
+  /**
+   * \brief NrMacSchedulerUeInfoShm constructor
+   * \param alpha PF fairness index
+   * \param rnti RNTI of the UE
+   * \param beamConfId BeamConfId of the UE
+   * \param fn A function that tells how many RB per RBG
+   */
+  NrMacSchedulerUeInfoShm (float alpha, uint16_t rnti, BeamConfId beamConfId,
+                           const GetRbPerRbgFn &fn)
+    : NrMacSchedulerUeInfoPF (alpha, rnti, beamConfId, fn)
+  {
+  }
+
+  virtual uint64_t GetMemoryUsage () const override
+  {
+    return NrMacSchedulerUeInfoPF::GetMemoryUsage ()
+      + sizeof (NrMacSchedulerUeInfoShm) - sizeof (NrMacSchedulerUeInfoPF);
+  }
+
+  /**
+   * \brief comparison function object (i.e. an object that satisfies the
+   * requirements of Compare) which returns true if the first argument is less
+   * than (i.e. is ordered before) the second.
+   * \param lue Left UE
+   * \param rue Right UE
+   * \return true if the left UE has a higher DL weight than the right UE, or
+   * if neither has one and the left UE has a higher PF metric
+   */
+  static bool CompareUeWeightsDl (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                                  const NrMacSchedulerNs3::UePtrAndBufferReq &rue)
+  {
+    auto luePtr = dynamic_cast<NrMacSchedulerUeInfoShm*> (lue.first.get ());
+    auto ruePtr = dynamic_cast<NrMacSchedulerUeInfoShm*> (rue.first.get ());
+
+    if (luePtr->m_dlWeight < 0.0 && ruePtr->m_dlWeight < 0.0)
+      {
+        return NrMacSchedulerUeInfoPF::CompareUeWeightsDl (lue, rue);
+      }
+    return luePtr->m_dlWeight > ruePtr->m_dlWeight;
+  }
+
+  /**
+   * \brief comparison function object (i.e. an object that satisfies the
+   * requirements of Compare) which returns true if the first argument is less
+   * than (i.e. is ordered before) the second.
+   * \param lue Left UE
+   * \param rue Right UE
+   * \return as CompareUeWeightsDl, with the UL weights and metrics
+   */
+  static bool CompareUeWeightsUl (const NrMacSchedulerNs3::UePtrAndBufferReq &lue,
+                                  const NrMacSchedulerNs3::UePtrAndBufferReq &rue)
+  {
+    auto luePtr = dynamic_cast<NrMacSchedulerUeInfoShm*> (lue.first.get ());
+    auto ruePtr = dynamic_cast<NrMacSchedulerUeInfoShm*> (rue.first.get ());
+
+    if (luePtr->m_ulWeight < 0.0 && ruePtr->m_ulWeight < 0.0)
+      {
+        return NrMacSchedulerUeInfoPF::CompareUeWeightsUl (lue, rue);
+      }
+    return luePtr->m_ulWeight > ruePtr->m_ulWeight;
+  }
+
+  double m_dlWeight {-1.0}; //!< DL weight given by the agent for the current slot, negative if none
+  double m_ulWeight {-1.0}; //!< UL weight given by the agent for the current slot, negative if none
+};
+
+} // namespace ns3
@@ -19,6 +19,7 @@
 
 #include "nr-mac-scheduler-ue-info.h"
 #include <ns3/log.h>
+#include <algorithm>
 
 
 namespace ns3 {
@@ -129,6 +130,7 @@ NrMacSchedulerUeInfo::ResetDlSchedInfo ()
   m_dlMRBRetx = 0;
   m_dlRBG = 0;
   m_dlSym = 0;
+  m_dlRbgMask.reset ();
   for (auto &it:m_dlTbSize)
     {
       it = 0;
@@ -157,65 +159,50 @@ NrMacSchedulerUeInfo::UpdateDlMetric (const Ptr<const NrAmc> &amc)
     }
   else
     {
-      switch (m_dlCqi.m_ri)
-      {
-        case 1:
-          if (m_dlMcs.size () == 1)
+      NS_ABORT_MSG_IF (m_dlCqi.m_ri == 0 || m_dlCqi.m_ri > m_dlMcs.size (),
+                       "Rank indicator value of " << +m_dlCqi.m_ri << " is not supported");
+      if (m_dlMcs.size () == 1)
+        {
+          //the UE supports only one stream, i.e., max 1 stream
+          NS_ABORT_MSG_IF (m_dlMcs.at (0) == 255, "DL MCS " << +m_dlMcs.at (0) << " is invalid");
+          m_dlTbSize.at (0) = amc->CalculateTbSize (m_dlMcs.at (0), m_dlRBG * GetNumRbPerRbg ());
+        }
+      else
+        {
+          //The UE uses the RI streams with the highest CQI, which are all the
+          //streams when the RI equals their number. When the UE switched to
+          //fewer streams, we need to correctly read the MCS from the right
+          //index in the MCS vector and write a valid TB size at the right
+          //index of the TB size vector, and zero in the others. REMEMBER:
+          //Index of these vectors directly maps to the stream index.
+          StreamVector<uint8_t> order;
+          for (uint8_t stream = 0; stream < m_dlMcs.size (); stream++)
             {
-              //the UE supports only one stream, i.e., max 1 stream
-              NS_ABORT_MSG_IF (m_dlMcs.at (0) == 255, "DL MCS " << +m_dlMcs.at (0) << " is invalid");
-              m_dlTbSize.at (0) = amc->CalculateTbSize (m_dlMcs.at (0), m_dlRBG * GetNumRbPerRbg ());
+              order.push_back (stream);
             }
-          else
+          std::stable_sort (order.begin (), order.end (), [this] (uint8_t a, uint8_t b)
+                            {
+                              return m_dlCqi.m_wbCqi.at (a) > m_dlCqi.m_wbCqi.at (b);
+                            });
+          for (uint8_t i = 0; i < order.size (); i++)
             {
-              //this else is to cover the case when UE switched from 2 streams
-              //to 1. In that case, scheduler needs to choose one stream with
-              //highest CQI. Therefore, we need to correctly read the MCS from
-              //the right index in the MCS vector and write a valid TB size at
-              //the right index of the TB size vector. REMEMBER: Index of these
-              //vectors directly maps to the stream index.
-              std::vector<uint8_t>::iterator it;
-              it = std::max_element (m_dlCqi.m_wbCqi.begin (), m_dlCqi.m_wbCqi.end ());
-              uint8_t maxCqiIndex = std::distance (m_dlCqi.m_wbCqi.begin(), it);
-              NS_LOG_DEBUG ("Max CQI " << static_cast <uint16_t> (*it) << " at index : " <<  maxCqiIndex);
-              for (uint32_t stream = 0; stream < m_dlCqi.m_wbCqi.size (); stream++)
+              uint8_t stream = order.at (i);
+              if (i < m_dlCqi.m_ri)
                 {
-                  if (stream == maxCqiIndex)
-                    {
-                      uint8_t mcs = m_dlMcs.at (stream);
-                      NS_ASSERT_MSG (mcs != UINT8_MAX, "Invalid MCS " << +mcs
-                                     << " for CQI " << +m_dlCqi.m_wbCqi.at (stream)
-                                     << " for stream " << stream);
-                      NS_LOG_DEBUG ("Switching from 2 streams to 1. Using " <<
-                                    stream << " that has the maximum MCS : " <<
-                                    +mcs);
-                      m_dlTbSize.at (stream) = amc->CalculateTbSize (mcs, m_dlRBG * GetNumRbPerRbg ());
-                    }
-                  else
-                    {
-                      m_dlTbSize.at (stream) = 0;
-                    }
+                  uint8_t mcs = m_dlMcs.at (stream);
+                  NS_ASSERT_MSG (mcs != UINT8_MAX, "Invalid MCS " << +mcs
+                                 << " for CQI " << +m_dlCqi.m_wbCqi.at (stream)
+                                 << " for stream " << +stream);
+                  NS_LOG_DEBUG ("Using stream " << +stream << " with CQI " <<
+                                +m_dlCqi.m_wbCqi.at (stream) << " and MCS " << +mcs);
+                  m_dlTbSize.at (stream) = amc->CalculateTbSize (mcs, m_dlRBG * GetNumRbPerRbg ());
+                }
+              else
+                {
+                  m_dlTbSize.at (stream) = 0;
                 }
             }
-          break;
-        case 2:
-          NS_ASSERT_MSG (m_dlMcs.at (0) != UINT8_MAX, "Invalid MCS " << +m_dlMcs.at (0)
-                                               << " for CQI " << +m_dlCqi.m_wbCqi.at (0)
-                                               << " for stream 0");
-          NS_ASSERT_MSG (m_dlMcs.at (1) != UINT8_MAX, "Invalid MCS " << +m_dlMcs.at (1)
-                                               << " for CQI " << +m_dlCqi.m_wbCqi.at (1)
-                                               << " for stream 1");
-          NS_ABORT_MSG_IF (m_dlMcs.size () < 2,"No MCS computed to be used for the second stream");
-
-          m_dlTbSize.at (0) = amc->CalculateTbSize (m_dlMcs.at (0), m_dlRBG * GetNumRbPerRbg ());
-
-          //we have the MCS to be used for the 2nd stream
-          m_dlTbSize.at (1) = amc->CalculateTbSize (m_dlMcs.at (1), m_dlRBG * GetNumRbPerRbg ());
-          break;
-        default:
-          NS_FATAL_ERROR ("Rank indicator value of " << +m_dlCqi.m_ri << " is not supported");
-      }
-
+        }
     }
 }
 
@@ -248,6 +235,20 @@ NrMacSchedulerUeInfo::ResetUlMetric ()
   m_ulTbSize = 0;
 }
 
+uint64_t
+NrMacSchedulerUeInfo::GetMemoryUsage () const
+{
+  uint64_t bytes = sizeof (NrMacSchedulerUeInfo);
+  bytes += m_dlRbgMcs.capacity ();
+  bytes += m_dlHarq.GetMemoryUsage () + m_ulHarq.GetMemoryUsage ();
+  for (const auto *lcgs : {&m_dlLCG, &m_ulLCG})
+    {
+      bytes += lcgs->bucket_count () * sizeof (void *);
+      bytes += lcgs->size () * (sizeof (std::pair<const uint8_t, LCGPtr>) + sizeof (void *) + sizeof (NrMacSchedulerLCG));
+    }
+  return bytes;
+}
+
 uint32_t
 NrMacSchedulerUeInfo::GetNumRbPerRbg () const
 {
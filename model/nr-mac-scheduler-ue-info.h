@@ -212,6 +212,16 @@ public:
    */
   virtual void ResetUlMetric ();
 
+  /**
+   * \brief Get an estimate of the memory used by the UE
+   *
+   * It counts the object, its vectors, its HARQ processes and its LCGs. The
+   * subclasses with more members should add them.
+   *
+   * \return the number of bytes
+   */
+  virtual uint64_t GetMemoryUsage () const;
+
   /**
    * \brief Received CQI information
    */
@@ -226,10 +236,9 @@ public:
       SB              //!< Sub-band
     } m_cqiType {WB}; //!< CQI type
 
-    std::vector<double> m_sinr;   //!< Vector of SINR for the entire band
-    std::vector<int16_t> m_rbCqi; //!< CQI for each Rsc Block, set to -1 if SINR < Threshold
     uint8_t m_cqi    {0};  //!< CQI reported value
-    uint32_t m_timer {0};  //!< Timer (in slot number). When the timer is 0, the value is discarded
+    uint32_t m_timer {0};  //!< Validity (in slot number) of the value, when it was reported
+    uint64_t m_expiration {0}; //!< Refresh of the CQI maps at which the value is discarded
   };
 
   /**
@@ -247,9 +256,11 @@ public:
     } m_cqiType {WB}; //!< CQI type
 
     uint8_t m_ri    {0}; //!< The rank indicator, by default UE would have only one stream
-    std::vector<double> m_sinr;   //!< Vector of SINR for the entire band
-    std::vector<uint8_t> m_wbCqi; //!< CQI for each stream
-    uint32_t m_timer {0};  //!< Timer (in slot number). When the timer is 0, the value is discarded
+    StreamVector<uint8_t> m_wbCqi; //!< CQI for each stream
+    uint32_t m_timer {0};  //!< Validity (in slot number) of the value, when it was reported
+    uint64_t m_expiration {0}; //!< Refresh of the CQI maps at which the value is discarded
+    uint64_t m_reportRefresh {0};  //!< Refresh of the CQI maps at which the value was reported
+    uint64_t m_requestRefresh {0}; //!< Refresh of the CQI maps at which a report was last requested in a DCI
   };
 
   uint16_t m_rnti {0};          //!< RNTI of the UE
@@ -265,10 +276,14 @@ public:
   uint8_t         m_dlSym     {0};  //!< Number of (new data) symbols assigned in this slot.
   uint8_t         m_ulSym     {0};  //!< Number of (new data) symbols assigned in this slot.
 
-  std::vector<uint8_t> m_dlMcs;  //!< DL MCS per stream, it is initialized with a starting MCS upon UE addition to gNB and the scheduler
+  StreamVector<uint8_t> m_dlMcs; //!< DL MCS per stream, it is initialized with a starting MCS upon UE addition to gNB and the scheduler
+  std::vector<uint8_t> m_dlRbgMcs; //!< DL MCS of each RBG of the first stream, from the last SB CQI (empty if the CQI is WB)
+  NrBitset m_dlRbgMask;          //!< DL RBG chosen in this slot by a frequency-selective assignment (none set if not used)
   uint8_t m_ulMcs     {0};  //!< UL MCS
+  double m_dlOllaOffset {0.0}; //!< DL MCS offset of the outer loop link adaptation
+  double m_ulOllaOffset {0.0}; //!< UL MCS offset of the outer loop link adaptation
 
-  std::vector<uint32_t> m_dlTbSize {0};  //!< DL Transport Block Size per stream, depends on MCS and RBG, updated in UpdateDlMetric()
+  StreamVector<uint32_t> m_dlTbSize {0}; //!< DL Transport Block Size per stream, depends on MCS and RBG, updated in UpdateDlMetric()
   uint32_t m_ulTbSize         {0};  //!< UL Transport Block Size, depends on MCS and RBG, updated in UpdateDlMetric()
 
   DlCqiInfo m_dlCqi;                  //!< DL CQI information
@@ -279,6 +294,8 @@ public:
 
   uint32_t m_srsPeriodicity {0}; //!< SRS periodicity
   uint32_t m_srsOffset {0};      //!< SRS offset
+  double m_ulBsrAverage {0.0};   //!< Average of the bytes of the non-empty BSRs, for the proactive UL grants
+  Time m_lastUlBsr {Time::Min ()}; //!< Time of the last non-empty BSR (Time::Min () if none)
   uint8_t m_startMcsDlUe {0}; //!< Starting DL MCS to be used
 
 protected:
@@ -0,0 +1,142 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-mac-scheduler-ue-state-soa.h"
+#include <ns3/log.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrMacSchedulerUeStateSoa");
+
+NrMacSchedulerUeStateSoa::NrMacSchedulerUeStateSoa (Metric metric, uint32_t sym, uint32_t minBytes)
+  : m_metric (metric),
+    m_sym (sym),
+    m_minBytes (minBytes)
+{
+}
+
+void
+NrMacSchedulerUeStateSoa::AddUe (uint8_t mcs, uint32_t bytes, uint32_t rbg, uint32_t tbSize)
+{
+  m_mcs.push_back (mcs);
+  m_bytes.push_back (bytes);
+  m_rbg.push_back (rbg);
+  m_tbSize.push_back (tbSize);
+  m_pfNumerator.push_back (0.0);
+  m_lastAvgTput.push_back (0.0);
+  m_value.push_back (0.0);
+}
+
+void
+NrMacSchedulerUeStateSoa::SetPfParameters (double alpha, double timeWindow)
+{
+  m_alpha = alpha;
+  m_timeWindow = timeWindow;
+}
+
+void
+NrMacSchedulerUeStateSoa::SetPfInputs (size_t k, double potentialTput, double lastAvgTput)
+{
+  m_pfNumerator[k] = std::pow (potentialTput, m_alpha);
+  m_lastAvgTput[k] = lastAvgTput;
+}
+
+void
+NrMacSchedulerUeStateSoa::Start ()
+{
+  m_anyAssigned = false;
+  for (size_t k = 0; k < m_value.size (); ++k)
+    {
+      UpdateMetric (k);
+    }
+}
+
+size_t
+NrMacSchedulerUeStateSoa::GetBest () const
+{
+  const size_t size = m_value.size ();
+  const double *value = m_value.data ();
+  size_t best = 0;
+  double bestValue = -std::numeric_limits<double>::infinity ();
+  for (size_t k = 0; k < size; ++k)
+    {
+      if (value[k] > bestValue)
+        {
+          bestValue = value[k];
+          best = k;
+        }
+    }
+  return bestValue == -std::numeric_limits<double>::infinity () ? size : best;
+}
+
+void
+NrMacSchedulerUeStateSoa::Assign (size_t k, uint32_t rbg, uint32_t tbSize)
+{
+  m_rbg[k] = rbg;
+  m_tbSize[k] = tbSize;
+  if (! m_anyAssigned)
+    {
+      // The average throughput of all the UEs is now the one after the slot
+      m_anyAssigned = true;
+      for (size_t i = 0; i < m_value.size (); ++i)
+        {
+          UpdateMetric (i);
+        }
+      return;
+    }
+  UpdateMetric (k);
+}
+
+void
+NrMacSchedulerUeStateSoa::UpdateMetric (size_t k)
+{
+  if (m_tbSize[k] >= std::max (m_bytes[k], m_minBytes))
+    {
+      m_value[k] = -std::numeric_limits<double>::infinity ();
+      return;
+    }
+
+  switch (m_metric)
+    {
+    case RR:
+      m_value[k] = -static_cast<double> (m_rbg[k]);
+      break;
+    case MR:
+      m_value[k] = m_mcs[k] * 4294967296.0 - m_rbg[k];
+      break;
+    case PF:
+      {
+        // As NrMacSchedulerUeInfoPF::UpdateDlPFMetric, and zero after the reset of the slot
+        double avgTput = 0.0;
+        if (m_anyAssigned)
+          {
+            double currTput = static_cast<double> (m_tbSize[k]) / m_sym;
+            avgTput = ((1.0 - (1.0 / m_timeWindow)) * m_lastAvgTput[k]) +
+              ((1.0 / m_timeWindow) * currTput);
+          }
+        m_value[k] = m_pfNumerator[k] / std::max (1E-9, avgTput);
+        break;
+      }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,170 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief The scheduling state of the UEs of a beam, one array per field
+ *
+ * With the RbgAssignmentMode Soa of NrMacSchedulerOfdma, the inputs of the
+ * metric of the UEs of a beam (MCS, bytes to transmit, RBG and TB size
+ * assigned so far and, for PF, the potential and last average throughput)
+ * are copied once in contiguous arrays, instead of being reached through the
+ * shared pointer of each UE for every RBG. The metric of all the UEs is kept
+ * in an array too, so that the search of the UE of each RBG is a single
+ * pass over it, and only the metric of the UE that got the RBG is computed
+ * again.
+ *
+ * The metrics are the ones of NrMacSchedulerUeInfoRR, NrMacSchedulerUeInfoMR
+ * and NrMacSchedulerUeInfoPF. As in the sort loop, the PF metric of all the
+ * UEs uses an average throughput of zero until the first RBG is assigned,
+ * and then the one the UE would have after NotAssignedDlResources().
+ *
+ * A UE is satisfied when its TB size covers its bytes, and at least the
+ * minimum given to the constructor; a satisfied UE does not get other RBG.
+ */
+class NrMacSchedulerUeStateSoa
+{
+public:
+  /**
+   * \brief The metric by which the UEs are ordered
+   */
+  enum Metric
+  {
+    RR,   //!< The fewest RBG first
+    MR,   //!< The highest MCS first, then the fewest RBG
+    PF    //!< The highest potential throughput over the average throughput first
+  };
+
+  /**
+   * \brief Constructor
+   * \param metric the metric of the scheduler
+   * \param sym the symbols of the beam
+   * \param minBytes the TB size that satisfies any UE
+   */
+  NrMacSchedulerUeStateSoa (Metric metric, uint32_t sym, uint32_t minBytes);
+
+  /**
+   * \brief Add a UE, with index GetSize () before the call
+   * \param mcs the MCS of the UE
+   * \param bytes the bytes the UE has to transmit
+   * \param rbg the RBG already assigned to the UE
+   * \param tbSize the TB size of the RBG already assigned
+   */
+  void AddUe (uint8_t mcs, uint32_t bytes, uint32_t rbg = 0, uint32_t tbSize = 0);
+
+  /**
+   * \brief Set the parameters of the PF metric
+   * \param alpha the fairness index
+   * \param timeWindow the weight of the last average throughput
+   */
+  void SetPfParameters (double alpha, double timeWindow);
+
+  /**
+   * \brief Set the PF inputs of a UE
+   * \param k index of the UE
+   * \param potentialTput the potential throughput in one assignable resource
+   * \param lastAvgTput the last average throughput
+   */
+  void SetPfInputs (size_t k, double potentialTput, double lastAvgTput);
+
+  /**
+   * \brief Compute the metric of all the UEs; call it after adding them
+   */
+  void Start ();
+
+  /**
+   * \return the index of the UE not satisfied with the highest metric, or
+   * GetSize () if all the UEs are satisfied
+   */
+  size_t GetBest () const;
+
+  /**
+   * \brief Assign RBG to a UE and update its metric
+   * \param k index of the UE
+   * \param rbg the RBG assigned to the UE in total
+   * \param tbSize the TB size of all these RBG
+   */
+  void Assign (size_t k, uint32_t rbg, uint32_t tbSize);
+
+  /**
+   * \return the number of UEs
+   */
+  size_t GetSize () const
+  {
+    return m_mcs.size ();
+  }
+
+  /**
+   * \param k index of the UE
+   * \return the MCS of the UE
+   */
+  uint8_t GetMcs (size_t k) const
+  {
+    return m_mcs[k];
+  }
+
+  /**
+   * \param k index of the UE
+   * \return the RBG assigned to the UE
+   */
+  uint32_t GetRbg (size_t k) const
+  {
+    return m_rbg[k];
+  }
+
+  /**
+   * \param k index of the UE
+   * \return the TB size of the RBG assigned to the UE
+   */
+  uint32_t GetTbSize (size_t k) const
+  {
+    return m_tbSize[k];
+  }
+
+private:
+  /**
+   * \brief Compute the metric of a UE
+   * \param k index of the UE
+   */
+  void UpdateMetric (size_t k);
+
+  Metric m_metric;                    //!< Metric of the scheduler
+  uint32_t m_sym;                     //!< Symbols of the beam
+  uint32_t m_minBytes;                //!< TB size that satisfies any UE
+  double m_alpha {1.0};               //!< PF fairness index
+  double m_timeWindow {99.0};         //!< PF weight of the last average throughput
+  bool m_anyAssigned {false};         //!< Whether an RBG was assigned since Start()
+
+  std::vector<uint8_t> m_mcs;         //!< MCS of each UE
+  std::vector<uint32_t> m_bytes;      //!< Bytes to transmit of each UE
+  std::vector<uint32_t> m_rbg;        //!< RBG assigned to each UE
+  std::vector<uint32_t> m_tbSize;     //!< TB size of each UE
+  std::vector<double> m_pfNumerator;  //!< Potential throughput to the power of alpha, for PF
+  std::vector<double> m_lastAvgTput;  //!< Last average throughput of each UE, for PF
+  std::vector<double> m_value;        //!< Metric of each UE, -infinity when satisfied
+};
+
+} // namespace ns3
@@ -0,0 +1,81 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-perf-profiler.h"
+
+namespace ns3 {
+
+std::array<uint64_t, NrPerfProfiler::NUM_SUBSYSTEMS> NrPerfProfiler::m_ns {};
+std::array<uint64_t, NrPerfProfiler::NUM_SUBSYSTEMS> NrPerfProfiler::m_calls {};
+NrPerfProfiler::Subsystem NrPerfProfiler::m_current = NrPerfProfiler::NUM_SUBSYSTEMS;
+std::chrono::steady_clock::time_point NrPerfProfiler::m_since;
+
+std::string
+NrPerfProfiler::GetSubsystemName (Subsystem subsystem)
+{
+  static const std::array<std::string, NUM_SUBSYSTEMS> names {"scheduler", "spectrum",
+                                                              "errorModel", "channel"};
+  return names.at (subsystem);
+}
+
+uint64_t
+NrPerfProfiler::GetTimeNs (Subsystem subsystem)
+{
+  return m_ns.at (subsystem);
+}
+
+uint64_t
+NrPerfProfiler::GetCalls (Subsystem subsystem)
+{
+  return m_calls.at (subsystem);
+}
+
+void
+NrPerfProfiler::Reset ()
+{
+  m_ns.fill (0);
+  m_calls.fill (0);
+  m_since = std::chrono::steady_clock::now ();
+}
+
+NrPerfProfiler::Subsystem
+NrPerfProfiler::Enter (Subsystem subsystem)
+{
+  auto now = std::chrono::steady_clock::now ();
+  if (m_current != NUM_SUBSYSTEMS)
+    {
+      m_ns[m_current] += static_cast<uint64_t> (std::chrono::duration_cast<std::chrono::nanoseconds> (now - m_since).count ());
+    }
+  Subsystem previous = m_current;
+  m_current = subsystem;
+  m_since = now;
+  ++m_calls[subsystem];
+  return previous;
+}
+
+void
+NrPerfProfiler::Leave (Subsystem previous)
+{
+  auto now = std::chrono::steady_clock::now ();
+  m_ns[m_current] += static_cast<uint64_t> (std::chrono::duration_cast<std::chrono::nanoseconds> (now - m_since).count ());
+  m_current = previous;
+  m_since = now;
+}
+
+} // namespace ns3
@@ -0,0 +1,170 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_PERF_PROFILER_H
+#define NR_PERF_PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * \ingroup nr-utils
+ * \brief 1 to measure the CPU time spent in each subsystem of the module
+ *
+ * Set by the CMake option NR_PERF_PROFILING. When 0, the scopes are empty
+ * objects and the module does not read the clock.
+ */
+#ifndef NR_PERF_PROFILING
+#define NR_PERF_PROFILING 0
+#endif
+
+namespace ns3 {
+
+/**
+ * \ingroup nr-utils
+ * \brief The time spent by the simulation in each subsystem of the module
+ *
+ * The entry points of the subsystems open a NrPerfProfilerScope. The time is
+ * exclusive: when a subsystem calls another one (e.g., the reception of a TB
+ * calls the error model), the time of the callee is not counted in the
+ * caller. The time spent outside any scope is not counted.
+ *
+ * The profiler is global to the process, and it is not thread-safe: it is
+ * meant for the simulator thread only.
+ */
+class NrPerfProfiler
+{
+public:
+  /**
+   * \brief The profiled subsystems
+   */
+  enum Subsystem
+  {
+    SCHEDULER = 0,      //!< The MAC schedulers (DL and UL trigger requests)
+    SPECTRUM = 1,       //!< NrSpectrumPhy reception and NrInterference
+    ERROR_MODEL = 2,    //!< The error models
+    CHANNEL = 3,        //!< The spectrum propagation loss models of the module
+    NUM_SUBSYSTEMS = 4  //!< Number of subsystems
+  };
+
+  /**
+   * \param subsystem the subsystem
+   * \return the name of the subsystem
+   */
+  static std::string GetSubsystemName (Subsystem subsystem);
+
+  /**
+   * \param subsystem the subsystem
+   * \return the nanoseconds spent in the subsystem since the last Reset
+   */
+  static uint64_t GetTimeNs (Subsystem subsystem);
+
+  /**
+   * \param subsystem the subsystem
+   * \return the number of times the subsystem was entered since the last Reset
+   */
+  static uint64_t GetCalls (Subsystem subsystem);
+
+  /**
+   * \brief Set all the times and calls to zero
+   */
+  static void Reset ();
+
+  /**
+   * \brief Enter a subsystem: the time since the last change goes to the
+   * current subsystem, if any
+   * \param subsystem the subsystem entered
+   * \return the subsystem that was current before, or NUM_SUBSYSTEMS if none
+   */
+  static Subsystem Enter (Subsystem subsystem);
+
+  /**
+   * \brief Leave the current subsystem, and go back to the previous one
+   * \param previous the value returned by the matching Enter
+   */
+  static void Leave (Subsystem previous);
+
+private:
+  static std::array<uint64_t, NUM_SUBSYSTEMS> m_ns;    //!< Nanoseconds per subsystem
+  static std::array<uint64_t, NUM_SUBSYSTEMS> m_calls; //!< Calls per subsystem
+  static Subsystem m_current;                          //!< The current subsystem
+  static std::chrono::steady_clock::time_point m_since; //!< When the current subsystem got the CPU
+};
+
+/**
+ * \ingroup nr-utils
+ * \brief Counts the time between its construction and its destruction in a
+ * subsystem
+ *
+ * The specialization for Enabled = false does nothing.
+ */
+template <bool Enabled>
+class NrPerfScope
+{
+public:
+  /**
+   * \brief Enter the subsystem
+   * \param subsystem the subsystem
+   */
+  explicit NrPerfScope (NrPerfProfiler::Subsystem subsystem)
+    : m_previous (NrPerfProfiler::Enter (subsystem))
+  {
+  }
+
+  /**
+   * \brief Leave the subsystem
+   */
+  ~NrPerfScope ()
+  {
+    NrPerfProfiler::Leave (m_previous);
+  }
+
+  NrPerfScope (const NrPerfScope &) = delete;
+  NrPerfScope &operator= (const NrPerfScope &) = delete;
+
+private:
+  NrPerfProfiler::Subsystem m_previous; //!< The subsystem to go back to
+};
+
+/**
+ * \ingroup nr-utils
+ * \brief The disabled scope
+ */
+template <>
+class NrPerfScope<false>
+{
+public:
+  /**
+   * \brief Do nothing
+   */
+  explicit NrPerfScope ([[maybe_unused]] NrPerfProfiler::Subsystem subsystem)
+  {
+  }
+};
+
+/**
+ * \ingroup nr-utils
+ * \brief The scope used by the module, enabled by NR_PERF_PROFILING
+ */
+using NrPerfProfilerScope = NrPerfScope<NR_PERF_PROFILING != 0>;
+
+} // namespace ns3
+
+#endif // NR_PERF_PROFILER_H
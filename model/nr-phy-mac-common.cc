@@ -259,21 +259,21 @@ std::ostream &operator<< (std::ostream &os, const DciInfoElementTdma &item)
   bool canPrint = false;
   for (uint32_t i = 0; i < item.m_rbgBitmask.size(); ++i)
     {
-      if (item.m_rbgBitmask[i] == 1)
+      if (item.m_rbgBitmask.test (i))
         {
           canPrint = true;
         }
 
-      if (item.m_rbgBitmask[i] == 1 && end < i)
+      if (item.m_rbgBitmask.test (i) && end < i)
         {
           end = i;
         }
-      if (item.m_rbgBitmask[i] == 1 && start > i)
+      if (item.m_rbgBitmask.test (i) && start > i)
         {
           start = i;
         }
 
-      if (item.m_rbgBitmask[i] == 0 && canPrint)
+      if (!item.m_rbgBitmask.test (i) && canPrint)
         {
           os << "[" << +start << ";" << +end << "]";
           start = 65000;
@@ -35,9 +35,15 @@
 #include <ns3/component-carrier.h>
 #include <ns3/enum.h>
 #include <memory>
+#include <initializer_list>
+#include <algorithm>
 #include <ns3/string.h>
+#include <ns3/abort.h>
 
 #include "sfnsf.h"
+#include "nr-pool-allocator.h"
+#include "nr-bitset.h"
+#include "nr-storage-precision.h"
 
 namespace ns3 {
 
@@ -136,6 +142,244 @@ struct TbInfoElement
   uint8_t m_harqProcess;
 };
 
+/**
+ * \ingroup utils
+ * \brief The maximum number of MIMO streams (layers) of a PHY
+ */
+static const uint8_t NR_MAX_STREAMS = 4;
+
+/**
+ * \ingroup utils
+ * \brief A vector of per-stream values (MCS, TB size, NDI, RV, CQI, HARQ
+ * status) of a DCI, a CQI report, a HARQ feedback or a scheduled UE
+ *
+ * The values of up to NR_MAX_STREAMS streams are stored inside the object,
+ * so that creating and copying these structures never allocates memory.
+ * It implements the part of the std::vector interface used for the
+ * per-stream values, and it can be built from a std::vector.
+ */
+template <typename T>
+class StreamVector
+{
+public:
+  typedef T value_type;           //!< The type of the values
+  typedef T * iterator;           //!< Iterator
+  typedef const T * const_iterator; //!< Const iterator
+
+  StreamVector () = default;
+
+  /**
+   * \brief Create a vector of a given size
+   * \param size the number of values
+   * \param value the value of all of them
+   */
+  explicit StreamVector (size_t size, const T &value = T ())
+  {
+    resize (size, value);
+  }
+
+  /**
+   * \brief Create a vector from a list of values
+   * \param values the values
+   */
+  StreamVector (std::initializer_list<T> values)
+  {
+    for (const T &v : values)
+      {
+        push_back (v);
+      }
+  }
+
+  /**
+   * \brief Create a vector with the values of a std::vector
+   * \param values the values
+   */
+  StreamVector (const std::vector<T> &values)
+  {
+    for (const T &v : values)
+      {
+        push_back (v);
+      }
+  }
+
+  /**
+   * \return the values in a std::vector
+   */
+  operator std::vector<T> () const
+  {
+    return std::vector<T> (begin (), end ());
+  }
+
+  /**
+   * \return the number of values
+   */
+  size_t size () const
+  {
+    return m_size;
+  }
+
+  /**
+   * \return the maximum number of values
+   */
+  static constexpr size_t capacity ()
+  {
+    return NR_MAX_STREAMS;
+  }
+
+  /**
+   * \return true if there are no values
+   */
+  bool empty () const
+  {
+    return size () == 0;
+  }
+
+  /**
+   * \brief Add a value at the end
+   * \param value the value
+   */
+  void push_back (const T &value)
+  {
+    NS_ABORT_MSG_IF (m_size == NR_MAX_STREAMS, "More than " << +NR_MAX_STREAMS << " streams");
+    m_values[m_size++] = value;
+  }
+
+  /**
+   * \brief Change the number of values
+   * \param size the new number of values
+   * \param value the value of the added values
+   */
+  void resize (size_t size, const T &value = T ())
+  {
+    NS_ABORT_MSG_IF (size > NR_MAX_STREAMS, "More than " << +NR_MAX_STREAMS << " streams");
+    while (m_size < size)
+      {
+        m_values[m_size++] = value;
+      }
+    m_size = size;
+  }
+
+  /**
+   * \brief Replace the values
+   * \param size the new number of values
+   * \param value the value of all of them
+   */
+  void assign (size_t size, const T &value)
+  {
+    m_size = 0;
+    resize (size, value);
+  }
+
+  /**
+   * \brief Remove all the values
+   */
+  void clear ()
+  {
+    resize (0);
+  }
+
+  /**
+   * \param i index of the value
+   * \return the value, after checking the index
+   */
+  T & at (size_t i)
+  {
+    NS_ABORT_MSG_IF (i >= size (), "Stream " << i << " out of " << size ());
+    return data ()[i];
+  }
+
+  /**
+   * \param i index of the value
+   * \return the value, after checking the index
+   */
+  const T & at (size_t i) const
+  {
+    NS_ABORT_MSG_IF (i >= size (), "Stream " << i << " out of " << size ());
+    return data ()[i];
+  }
+
+  /**
+   * \param i index of the value
+   * \return the value
+   */
+  T & operator[] (size_t i)
+  {
+    return data ()[i];
+  }
+
+  /**
+   * \param i index of the value
+   * \return the value
+   */
+  const T & operator[] (size_t i) const
+  {
+    return data ()[i];
+  }
+
+  /**
+   * \return the values
+   */
+  T * data ()
+  {
+    return m_values;
+  }
+
+  /**
+   * \return the values
+   */
+  const T * data () const
+  {
+    return m_values;
+  }
+
+  iterator begin () { return data (); }                     //!< \return the first value
+  iterator end () { return data () + size (); }             //!< \return the end of the values
+  const_iterator begin () const { return data (); }         //!< \return the first value
+  const_iterator end () const { return data () + size (); } //!< \return the end of the values
+  const_iterator cbegin () const { return begin (); }       //!< \return the first value
+  const_iterator cend () const { return end (); }           //!< \return the end of the values
+
+  /**
+   * \param o the other vector
+   * \return true if the vectors have the same values
+   */
+  bool operator== (const StreamVector &o) const
+  {
+    return m_size == o.m_size && std::equal (begin (), end (), o.begin ());
+  }
+
+  /**
+   * \param o the other vector
+   * \return true if the vectors have different values
+   */
+  bool operator!= (const StreamVector &o) const
+  {
+    return !(*this == o);
+  }
+
+  /**
+   * \param o the other vector
+   * \return true if the values are lexicographically less than the other ones
+   */
+  bool operator< (const StreamVector &o) const
+  {
+    return std::lexicographical_compare (begin (), end (), o.begin (), o.end ());
+  }
+
+  /**
+   * \param o the other vector
+   * \return true if the values are lexicographically greater than the other ones
+   */
+  bool operator> (const StreamVector &o) const
+  {
+    return o < *this;
+  }
+
+private:
+  T m_values[NR_MAX_STREAMS] {}; //!< The values
+  uint8_t m_size {0};            //!< Number of values
+};
+
 /**
  * \ingroup utils
  * \brief Scheduling information. Despite the name, it is not TDMA.
@@ -168,7 +412,7 @@ struct DciInfoElementTdma
    * \param rbgBitmask Bitmask of RBG
    */
   DciInfoElementTdma (uint8_t symStart, uint8_t numSym, DciFormat format, VarTtiType type,
-                      const std::vector<uint8_t> &rbgBitmask)
+                      const NrBitset &rbgBitmask)
     : m_format (format),
     m_symStart (symStart),
     m_numSym (numSym),
@@ -191,9 +435,9 @@ struct DciInfoElementTdma
    * \param rv Redundancy Version per stream
    */
   DciInfoElementTdma (uint16_t rnti, DciFormat format, uint8_t symStart,
-                      uint8_t numSym, std::vector<uint8_t> mcs,
-                      std::vector<uint32_t> tbs, std::vector<uint8_t> ndi,
-                      std::vector<uint8_t> rv, VarTtiType type,
+                      uint8_t numSym, const StreamVector<uint8_t> &mcs,
+                      const StreamVector<uint32_t> &tbs, const StreamVector<uint8_t> &ndi,
+                      const StreamVector<uint8_t> &rv, VarTtiType type,
                       uint8_t bwpIndex, uint8_t tpc)
     : m_rnti (rnti), m_format (format), m_symStart (symStart),
     m_numSym (numSym), m_mcs (mcs), m_tbSize (tbs), m_ndi (ndi), m_rv (rv),
@@ -210,8 +454,8 @@ struct DciInfoElementTdma
    * \param rv Retransmission value
    * \param o Other object from which copy all that is not specified as parameter
    */
-  DciInfoElementTdma (uint8_t symStart, uint8_t numSym, std::vector<uint8_t> ndi,
-                      std::vector<uint8_t> rv, const DciInfoElementTdma &o)
+  DciInfoElementTdma (uint8_t symStart, uint8_t numSym, const StreamVector<uint8_t> &ndi,
+                      const StreamVector<uint8_t> &rv, const DciInfoElementTdma &o)
     : m_rnti (o.m_rnti),
       m_format (o.m_format),
       m_symStart (symStart),
@@ -232,17 +476,38 @@ struct DciInfoElementTdma
   const DciFormat m_format    {DL}; //!< DCI format
   const uint8_t m_symStart    {0}; //!< starting symbol index for flexible TTI scheme
   const uint8_t m_numSym      {0}; //!< number of symbols for flexible TTI scheme
-  const std::vector<uint8_t> m_mcs; //!< MCS per stream
-  const std::vector<uint32_t> m_tbSize; //!< TB size per stream
-  const std::vector<uint8_t> m_ndi; //!< New Data Indicator per stream (Old comment: By default is retransmission. Zoraze to check if it has any effect)
-  const std::vector<uint8_t> m_rv; //!< Redundancy Version per stream (Old comment: // not used for UL DCI. Zoraze to check why?)
+  const StreamVector<uint8_t> m_mcs; //!< MCS per stream
+  const StreamVector<uint32_t> m_tbSize; //!< TB size per stream
+  const StreamVector<uint8_t> m_ndi; //!< New Data Indicator per stream (Old comment: By default is retransmission. Zoraze to check if it has any effect)
+  const StreamVector<uint8_t> m_rv; //!< Redundancy Version per stream (Old comment: // not used for UL DCI. Zoraze to check why?)
   const VarTtiType m_type     {SRS}; //!< Var TTI type
   const uint8_t m_bwpIndex    {0}; //!< BWP Index to identify to which BWP this DCI applies to.
   uint8_t m_harqProcess       {0}; //!< HARQ process id
-  std::vector<uint8_t> m_rbgBitmask  {};   //!< RBG mask: 0 if the RBG is not used, 1 otherwise
+  NrBitset m_rbgBitmask  {};   //!< RBG mask: 0 if the RBG is not used, 1 otherwise
   const uint8_t m_tpc         {0}; //!< Tx power control command
+  uint8_t m_layer             {0}; //!< MU-MIMO layer of a DL DATA DCI: the layers of the same symbols are sent with different beams
+  bool m_cqiRequest           {false}; //!< CSI request of a DL DATA DCI: the UE reports the CQI of this reception (aperiodic report)
+  std::vector<float> m_rbgPower; //!< Power of each RBG of a DL DATA DCI relative to a uniform allocation, from NrDlPowerAllocator (empty: uniform)
+
+  /**
+   * \brief Create a DCI in the memory of the DCI already released
+   *
+   * The DCI of every slot are created and released at a high rate; they
+   * reuse the same memory through NrPoolAllocator.
+   *
+   * \param args the arguments of a DciInfoElementTdma constructor
+   * \return the DCI
+   */
+  template <typename... Args>
+  static std::shared_ptr<DciInfoElementTdma>
+  Create (Args&&... args)
+  {
+    return std::allocate_shared<DciInfoElementTdma> (NrPoolAllocator<DciInfoElementTdma> (),
+                                                     std::forward<Args> (args)...);
+  }
 };
 
+
 /**
  * \ingroup utils
  * \brief The TbAllocInfo struct
@@ -282,6 +547,9 @@ struct RlcPduInfo
 struct VarTtiAllocInfo
 {
   VarTtiAllocInfo (const VarTtiAllocInfo &o) = default;
+  VarTtiAllocInfo (VarTtiAllocInfo &&o) = default;
+  VarTtiAllocInfo & operator= (const VarTtiAllocInfo &o) = default;
+  VarTtiAllocInfo & operator= (VarTtiAllocInfo &&o) = default;
 
   VarTtiAllocInfo (const std::shared_ptr<DciInfoElementTdma> &dci)
     : m_dci (dci)
@@ -372,8 +640,9 @@ struct DlCqiInfo
   {
     WB, SB
   } m_cqiType {WB}; //!< The type of the CQI
-  std::vector<uint8_t> m_wbCqi;   //!< WB CQI for each MIMO stream
+  StreamVector<uint8_t> m_wbCqi;  //!< WB CQI for each MIMO stream
   uint8_t m_wbPmi {0}; //!< The reported wideband pre-coding matrix index
+  std::vector<uint8_t> m_sbCqi;   //!< SB CQI of the first stream, one per RBG (0 if the RBG was not measured); only for SB
 };
 
 /**
@@ -383,7 +652,7 @@ struct DlCqiInfo
 struct UlCqiInfo
 {
   //std::vector <uint16_t> m_sinr;
-  std::vector<double> m_sinr;
+  std::vector<NrStorageReal> m_sinr; //!< Per-RB SINR (linear)
   enum UlCqiType
   {
     SRS, PUSCH, PUCCH_1, PUCCH_2, PRACH
@@ -522,8 +791,8 @@ struct DlHarqInfo : public HarqInfo
     ACK, NACK, NONE
   };
 
-  std::vector<enum HarqStatus> m_harqStatus;   //!< HARQ status
-  std::vector<uint8_t> m_numRetx;              //!< Num of Retx
+  StreamVector<enum HarqStatus> m_harqStatus; //!< HARQ status
+  StreamVector<uint8_t> m_numRetx;             //!< Num of Retx
 
   virtual bool IsReceivedOk () const override
   {
@@ -563,9 +832,9 @@ struct DlHarqInfo : public HarqInfo
     return m_harqStatus.at (stream) == ACK;
   }
 
-  std::vector<uint8_t> GetNackStreamIndexes ()
+  StreamVector<uint8_t> GetNackStreamIndexes ()
   {
-    std::vector<uint8_t> indexes;
+    StreamVector<uint8_t> indexes;
     for (uint8_t i = 0; i < m_harqStatus.size (); i++)
       {
         if (m_harqStatus.at (i) == NACK)
@@ -598,9 +867,9 @@ struct UlHarqInfo : public HarqInfo
     return m_receptionStatus == Ok;
   }
 
-  std::vector<uint8_t> GetNackStreamIndexes ()
+  StreamVector<uint8_t> GetNackStreamIndexes ()
   {
-    std::vector<uint8_t> indexes;
+    StreamVector<uint8_t> indexes;
     if (m_receptionStatus == NotOk)
       {
         indexes.push_back (0);
@@ -634,6 +903,7 @@ struct NrSchedulingCallbackInfo
   uint8_t  m_ndi {UINT8_MAX}; //!< New data indicator
   uint8_t  m_rv {UINT8_MAX}; //!< RV
   uint8_t  m_harqId {UINT8_MAX}; //!< HARQ id
+  uint16_t m_numRbg {UINT16_MAX}; //!< number of RBGs
 };
 
 #endif /* SRC_NR_MODEL_NR_PHY_MAC_COMMON_H_ */
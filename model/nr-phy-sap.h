@@ -103,7 +103,18 @@ public:
    *
    * The MAC asks for the BeamConfId of the specified used.
    */
-  virtual BeamConfId GetBeamConfId (uint8_t rnti) const = 0;
+  virtual BeamConfId GetBeamConfId (uint16_t rnti) const = 0;
+
+  /**
+   * \brief Get the coupling between two beams of the PHY. Not in any standard.
+   * \param a the first beam
+   * \param b the second beam
+   * \return the normalized gain of a toward b, between 0 and 1, or -1 if unknown
+   *
+   * The MAC scheduler uses it to find the beams that can share the same
+   * symbols and RBGs (MU-MIMO).
+   */
+  virtual double GetBeamCoupling (const BeamConfId &a, const BeamConfId &b) const = 0;
 
   /**
    * \brief Retrieve the spectrum model used by the PHY layer.
@@ -146,6 +157,29 @@ public:
    */
   virtual uint32_t GetRbNum () const = 0;
 
+  /**
+   * \brief Retrieve the number of streams (antenna arrays) of the PHY
+   * \return the number of streams, at most NR_MAX_STREAMS
+   */
+  virtual uint8_t GetNumberOfStreams () const = 0;
+
+  /**
+   * \brief Notify the PHY that the MAC has new work (e.g., new data from the RLC)
+   *
+   * If the PHY is fast-forwarding idle slots, it restarts at the next slot.
+   */
+  virtual void NotifyActivity () = 0;
+
+  /**
+   * \brief Notify the gNB PHY that the MAC has DL data for a UE
+   *
+   * If the UE is idle (see the NrUePhy attribute InactivityTimer), the gNB
+   * PHY pages it.
+   *
+   * \param rnti the RNTI of the UE
+   */
+  virtual void PageUe (uint16_t rnti) = 0;
+
 };
 
 /**
@@ -235,7 +269,7 @@ public:
    * \param beamConfId the new beam ID
    * \param rnti the RNTI of the user
    */
-  virtual void BeamChangeReport (BeamConfId beamConfId, uint8_t rnti) = 0;
+  virtual void BeamChangeReport (BeamConfId beamConfId, uint16_t rnti) = 0;
 
   /**
    * \brief PHY requests information from MAC.
@@ -33,6 +33,7 @@
 #include "beam-manager.h"
 #include "ns3/uniform-planar-array.h"
 #include <ns3/boolean.h>
+#include <ns3/simulator.h>
 
 #include <algorithm>
 
@@ -56,7 +57,9 @@ public:
 
   virtual void SetSlotAllocInfo (const SlotAllocInfo &slotAllocInfo) override;
 
-  virtual BeamConfId GetBeamConfId (uint8_t rnti) const override;
+  virtual BeamConfId GetBeamConfId (uint16_t rnti) const override;
+
+  virtual double GetBeamCoupling (const BeamConfId &a, const BeamConfId &b) const override;
 
   virtual Ptr<const SpectrumModel> GetSpectrumModel () override;
 
@@ -72,6 +75,12 @@ public:
 
   virtual uint32_t GetRbNum () const override;
 
+  virtual uint8_t GetNumberOfStreams () const override;
+
+  virtual void NotifyActivity () override;
+
+  virtual void PageUe (uint16_t rnti) override;
+
 private:
   NrPhy* m_phy;
 };
@@ -107,11 +116,17 @@ NrMemberPhySapProvider::SetSlotAllocInfo (const SlotAllocInfo &slotAllocInfo)
 }
 
 BeamConfId
-NrMemberPhySapProvider::GetBeamConfId (uint8_t rnti) const
+NrMemberPhySapProvider::GetBeamConfId (uint16_t rnti) const
 {
   return m_phy->GetBeamConfId (rnti);
 }
 
+double
+NrMemberPhySapProvider::GetBeamCoupling (const BeamConfId &a, const BeamConfId &b) const
+{
+  return m_phy->GetBeamCoupling (a, b);
+}
+
 Ptr<const SpectrumModel>
 NrMemberPhySapProvider::GetSpectrumModel ()
 {
@@ -124,6 +139,18 @@ NrMemberPhySapProvider::NotifyConnectionSuccessful ()
   m_phy->NotifyConnectionSuccessful ();
 }
 
+void
+NrMemberPhySapProvider::NotifyActivity ()
+{
+  m_phy->WakeUp ();
+}
+
+void
+NrMemberPhySapProvider::PageUe (uint16_t rnti)
+{
+  m_phy->PageUe (rnti);
+}
+
 uint16_t
 NrMemberPhySapProvider::GetBwpId () const
 {
@@ -154,6 +181,12 @@ NrMemberPhySapProvider::GetRbNum () const
   return m_phy->GetRbNum ();
 }
 
+uint8_t
+NrMemberPhySapProvider::GetNumberOfStreams () const
+{
+  return m_phy->GetNumberOfStreams ();
+}
+
 /* ======= */
 
 TypeId
@@ -169,24 +202,27 @@ NrPhy::GetTypeId ()
 }
 
 std::vector<int>
-NrPhy::FromRBGBitmaskToRBAssignment (const std::vector<uint8_t> rbgBitmask) const
+NrPhy::FromRBGBitmaskToRBAssignment (const NrBitset &rbgBitmask) const
 {
   std::vector<int> ret;
+  FromRBGBitmaskToRBAssignment (rbgBitmask, &ret);
+  return ret;
+}
 
-  for (uint32_t i = 0; i < rbgBitmask.size (); ++i)
+void
+NrPhy::FromRBGBitmaskToRBAssignment (const NrBitset &rbgBitmask, std::vector<int> *rbs) const
+{
+  const uint32_t numRbPerRbg = GetNumRbPerRbg ();
+  rbs->clear ();
+  rbs->reserve (rbgBitmask.count () * numRbPerRbg);
+
+  for (size_t i = rbgBitmask.FindFirst (); i < rbgBitmask.size (); i = rbgBitmask.FindNext (i))
     {
-      if (rbgBitmask.at (i) == 1)
+      for (uint32_t k = 0; k < numRbPerRbg; ++k)
         {
-          for (uint32_t k = 0; k < GetNumRbPerRbg (); ++k)
-            {
-              ret.push_back ((i * GetNumRbPerRbg ()) + k);
-            }
+          rbs->push_back (static_cast<int> (i * numRbPerRbg + k));
         }
     }
-
-  NS_ASSERT (static_cast<uint32_t> (std::count (rbgBitmask.begin (), rbgBitmask.end (), 1) * GetNumRbPerRbg ())
-             == ret.size ());
-  return ret;
 }
 
 NrPhy::NrPhy ()
@@ -206,8 +242,9 @@ void
 NrPhy::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
-  m_slotAllocInfo.clear ();
+  m_slotAllocInfo.Clear ();
   m_controlMessageQueue.clear ();
+  m_ctrlMsgQueueHead = 0;
   m_packetBurstMap.clear();
   m_ctrlMsgs.clear ();
   m_tddPattern.clear ();
@@ -361,6 +398,24 @@ NrPhy::NotifyConnectionSuccessful ()
   NS_LOG_FUNCTION (this);
 }
 
+void
+NrPhy::WakeUp ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrPhy::PageUe (uint16_t rnti)
+{
+  NS_LOG_FUNCTION (this << rnti);
+}
+
+const std::list<Ptr<NrControlMessage> > &
+NrPhy::GetRxCtrlMessages (const Ptr<const NrControlMessageBundle> &bundle) const
+{
+  return bundle->GetMessages ();
+}
+
 Ptr<PacketBurst>
 NrPhy::GetPacketBurst (SfnSf sfn, uint8_t sym, uint8_t streamId)
 {
@@ -387,21 +442,83 @@ NrPhy::GetPacketBurst (SfnSf sfn, uint8_t sym, uint8_t streamId)
 Ptr<SpectrumValue>
 NrPhy::GetNoisePowerSpectralDensity ()
 {
-  return NrSpectrumValueHelper::CreateNoisePowerSpectralDensity (m_noiseFigure, GetSpectrumModel ());
+  return NrSpectrumValueHelper::CreateNoisePowerSpectralDensity (m_noiseFigure, GetPsdSpectrumModel ());
 }
 
 Ptr<SpectrumValue>
 NrPhy::GetTxPowerSpectralDensity (const std::vector<int> &rbIndexVector, uint8_t activeStreams)
 {
   NS_LOG_FUNCTION (this);
-  Ptr<const SpectrumModel> sm = GetSpectrumModel ();
+  Ptr<const SpectrumModel> sm = GetPsdSpectrumModel ();
   NS_ASSERT_MSG (activeStreams, "There should be at least one active stream.");
+
+  // The bandwidth, the numerology or the central frequency changed
+  if (sm != m_txPsdCacheModel)
+    {
+      m_txPsdCache.clear ();
+      m_txPsdCacheModel = sm;
+    }
+
+  m_txPsdKey.m_txPower = m_txPower;
+  m_txPsdKey.m_activeStreams = activeStreams;
+  m_txPsdKey.m_powerAllocationType = m_powerAllocationType;
+  m_txPsdKey.m_rbs.assign (rbIndexVector.begin (), rbIndexVector.end ());
+
+  auto it = m_txPsdCache.find (m_txPsdKey);
+  if (it != m_txPsdCache.end ())
+    {
+      return it->second;
+    }
+
   // Convert txPower to linear units
   double txPowerLinear = pow (10, m_txPower / 10);
   // Share the total transmission power among active streams
   double txPowerPerStreamDbm = 10 * log10 (txPowerLinear/activeStreams);
   // Pass the TX power per stream, each stream will have the same TX PSD
-  return NrSpectrumValueHelper::CreateTxPowerSpectralDensity (txPowerPerStreamDbm, rbIndexVector, sm, m_powerAllocationType );
+  Ptr<SpectrumValue> txPsd = NrSpectrumValueHelper::CreateTxPowerSpectralDensity (txPowerPerStreamDbm, rbIndexVector, sm, m_powerAllocationType,
+                                                                                  m_rbsPerPsdBand);
+
+  if (m_txPsdCache.size () >= MAX_TX_PSD_CACHE_SIZE)
+    {
+      m_txPsdCache.clear ();
+    }
+  m_txPsdCache.emplace (m_txPsdKey, txPsd);
+  return txPsd;
+}
+
+Ptr<SpectrumValue>
+NrPhy::GetTxPowerSpectralDensity (const std::vector<int> &rbIndexVector, uint8_t activeStreams,
+                                  const std::vector<float> &rbgPower)
+{
+  NS_LOG_FUNCTION (this);
+  Ptr<SpectrumValue> uniform = GetTxPowerSpectralDensity (rbIndexVector, activeStreams);
+  if (rbgPower.empty ())
+    {
+      return uniform;
+    }
+
+  // A band of the PSD gets the mean weight of its RBs with a transmission
+  const uint32_t numRbPerRbg = GetNumRbPerRbg ();
+  const uint32_t rbsPerBand = std::max (m_rbsPerPsdBand, 1U);
+  Ptr<SpectrumValue> txPsd = uniform->Copy ();
+  std::vector<double> weight (txPsd->GetValuesN (), 0.0);
+  std::vector<uint32_t> numRbs (txPsd->GetValuesN (), 0);
+  for (int rb : rbIndexVector)
+    {
+      size_t rbg = static_cast<size_t> (rb) / numRbPerRbg;
+      size_t band = static_cast<size_t> (rb) / rbsPerBand;
+      NS_ASSERT (band < weight.size ());
+      weight[band] += rbg < rbgPower.size () ? rbgPower[rbg] : 1.0;
+      ++numRbs[band];
+    }
+  for (size_t band = 0; band < weight.size (); ++band)
+    {
+      if (numRbs[band] > 0)
+        {
+          (*txPsd)[band] *= weight[band] / numRbs[band];
+        }
+    }
+  return txPsd;
 }
 
 double
@@ -451,7 +568,10 @@ NrPhy::EnqueueCtrlMessage (const Ptr<NrControlMessage> &m)
 {
   NS_LOG_FUNCTION (this);
 
-  m_controlMessageQueue.at (m_controlMessageQueue.size () - 1).push_back (m);
+  // The end of the ring is the element before the head
+  size_t last = (m_ctrlMsgQueueHead + m_controlMessageQueue.size () - 1) % m_controlMessageQueue.size ();
+  m_controlMessageQueue.at (last).push_back (m);
+  WakeUp ();
 }
 
 void
@@ -459,7 +579,7 @@ NrPhy::EnqueueCtrlMsgNow (const Ptr<NrControlMessage> &msg)
 {
   NS_LOG_FUNCTION (this);
 
-  m_controlMessageQueue.at (0).push_back (msg);
+  m_controlMessageQueue.at (m_ctrlMsgQueueHead).push_back (msg);
 }
 
 void
@@ -467,7 +587,7 @@ NrPhy::EnqueueCtrlMsgNow (const std::list<Ptr<NrControlMessage> > &listOfMsgs)
 {
   for (const auto & msg : listOfMsgs)
     {
-      m_controlMessageQueue.at (0).push_back (msg);
+      m_controlMessageQueue.at (m_ctrlMsgQueueHead).push_back (msg);
     }
 }
 
@@ -549,6 +669,7 @@ NrPhy::DoUpdateRbNum ()
 
   m_rbNum = static_cast<uint32_t> (realBw / rbWidth);
   NS_ASSERT (GetRbNum () > 0);
+  m_txPsdCache.clear ();
 
   NS_LOG_INFO ("Updated RbNum to " << GetRbNum ());
 
@@ -607,11 +728,8 @@ NrPhy::InitializeMessageList ()
 {
   NS_LOG_FUNCTION (this);
   m_controlMessageQueue.clear ();
-
-  for (unsigned i = 0; i <= GetL1L2CtrlLatency (); i++)
-    {
-      m_controlMessageQueue.push_back (std::list<Ptr<NrControlMessage> > ());
-    }
+  m_controlMessageQueue.resize (GetL1L2CtrlLatency () + 1);
+  m_ctrlMsgQueueHead = 0;
 }
 
 
@@ -619,28 +737,16 @@ std::list<Ptr<NrControlMessage> >
 NrPhy::PopCurrentSlotCtrlMsgs (void)
 {
   NS_LOG_FUNCTION (this);
+  std::list<Ptr<NrControlMessage> > ret;
   if (m_controlMessageQueue.empty ())
     {
-      std::list<Ptr<NrControlMessage> > emptylist;
-      return (emptylist);
+      return ret;
     }
 
-  if (m_controlMessageQueue.at (0).size () > 0)
-    {
-      std::list<Ptr<NrControlMessage> > ret = m_controlMessageQueue.front ();
-      m_controlMessageQueue.erase (m_controlMessageQueue.begin ());
-      std::list<Ptr<NrControlMessage> > newlist;
-      m_controlMessageQueue.push_back (newlist);
-      return (ret);
-    }
-  else
-    {
-      m_controlMessageQueue.erase (m_controlMessageQueue.begin ());
-      std::list<Ptr<NrControlMessage> > newlist;
-      m_controlMessageQueue.push_back (newlist);
-      std::list<Ptr<NrControlMessage> > emptylist;
-      return (emptylist);
-    }
+  // The emptied element of the current slot becomes the end of the ring
+  ret.swap (m_controlMessageQueue.at (m_ctrlMsgQueueHead));
+  m_ctrlMsgQueueHead = (m_ctrlMsgQueueHead + 1) % m_controlMessageQueue.size ();
+  return ret;
 }
 
 void
@@ -702,32 +808,14 @@ NrPhy::PushBackSlotAllocInfo (const SlotAllocInfo &slotAllocInfo)
 
   NS_LOG_DEBUG ("setting info for slot " << slotAllocInfo.m_sfnSf);
 
-  // That's not so complex, as the list would typically be of 2 or 3 elements.
-  bool updated = false;
-  for (auto & alloc : m_slotAllocInfo)
-    {
-      if (alloc.m_sfnSf == slotAllocInfo.m_sfnSf)
-        {
-          NS_LOG_INFO ("Merging inside existing allocation");
-          alloc.Merge (slotAllocInfo);
-          updated = true;
-          break;
-        }
-    }
-  if (! updated)
-    {
-      m_slotAllocInfo.push_back (slotAllocInfo);
-      m_slotAllocInfo.sort ();
-      NS_LOG_INFO ("Pushing allocation at the end of the list");
-    }
-
-  std::stringstream output;
+  m_slotAllocInfo.Insert (slotAllocInfo);
 
-  for (const auto & alloc : m_slotAllocInfo)
+  if (g_log.IsEnabled (LOG_LEVEL_INFO))
     {
-      output << alloc;
+      std::stringstream output;
+      m_slotAllocInfo.Print (output);
+      NS_LOG_INFO (output.str ());
     }
-  NS_LOG_INFO (output.str ());
 }
 
 void
@@ -735,7 +823,10 @@ NrPhy::PushFrontSlotAllocInfo (const SfnSf &newSfnSf, const SlotAllocInfo &slotA
 {
   NS_LOG_FUNCTION (this);
 
-  m_slotAllocInfo.push_front (slotAllocInfo);
+  // The allocations are renumbered from newSfnSf: take them out, and store
+  // them back with their new slot
+  std::vector<SlotAllocInfo> allocations = m_slotAllocInfo.RetrieveAll ();
+  allocations.insert (allocations.begin (), slotAllocInfo);
   SfnSf currentSfn = newSfnSf;
   std::unordered_map<uint64_t, Ptr<PacketBurst>> newBursts; // map between new sfn and the packet burst
   std::unordered_map<uint64_t, uint64_t> sfnMap; // map between new and old sfn, for debugging
@@ -743,7 +834,7 @@ NrPhy::PushFrontSlotAllocInfo (const SfnSf &newSfnSf, const SlotAllocInfo &slotA
   // all the slot allocations  (and their packet burst) have to be "adjusted":
   // directly modify the sfn for the allocation, and temporarly store the
   // burst (along with the new sfn) into newBursts.
-  for (auto it = m_slotAllocInfo.begin (); it != m_slotAllocInfo.end (); ++it)
+  for (auto it = allocations.begin (); it != allocations.end (); ++it)
     {
       auto slotSfn = it->m_sfnSf;
       for (const auto &alloc : it->m_varTtiAllocInfo)
@@ -771,6 +862,7 @@ NrPhy::PushFrontSlotAllocInfo (const SfnSf &newSfnSf, const SlotAllocInfo &slotA
       NS_LOG_INFO ("Set slot allocation for " << it->m_sfnSf << " to " << currentSfn);
       it->m_sfnSf = currentSfn;
       currentSfn.Add (1);
+      m_slotAllocInfo.Insert (*it);
     }
 
   for (const auto & burstPair : newBursts)
@@ -790,23 +882,14 @@ NrPhy::SlotAllocInfoExists (const SfnSf &retVal) const
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (retVal.GetNumerology () == GetNumerology ());
-  for (const auto & alloc : m_slotAllocInfo)
-    {
-      if (alloc.m_sfnSf == retVal)
-        {
-          return true;
-        }
-    }
-  return false;
+  return m_slotAllocInfo.Exists (retVal);
 }
 
 SlotAllocInfo
 NrPhy::RetrieveSlotAllocInfo ()
 {
   NS_LOG_FUNCTION (this);
-  SlotAllocInfo ret = *m_slotAllocInfo.begin ();
-  m_slotAllocInfo.erase (m_slotAllocInfo.begin ());
-  return ret;
+  return m_slotAllocInfo.RetrieveFirst ();
 }
 
 
@@ -815,19 +898,7 @@ NrPhy::RetrieveSlotAllocInfo (const SfnSf &sfnsf)
 {
   NS_LOG_FUNCTION (" slot " << sfnsf);
   NS_ASSERT (sfnsf.GetNumerology () == GetNumerology ());
-
-  for (auto allocIt = m_slotAllocInfo.begin(); allocIt != m_slotAllocInfo.end (); ++allocIt)
-    {
-      if (allocIt->m_sfnSf == sfnsf)
-        {
-          SlotAllocInfo ret = *allocIt;
-          m_slotAllocInfo.erase (allocIt);
-          return ret;
-        }
-    }
-
-  NS_FATAL_ERROR("Didn't found the slot");
-  return SlotAllocInfo (sfnsf);
+  return m_slotAllocInfo.Retrieve (sfnsf);
 }
 
 SlotAllocInfo &
@@ -835,29 +906,56 @@ NrPhy::PeekSlotAllocInfo (const SfnSf &sfnsf)
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT (sfnsf.GetNumerology () == GetNumerology ());
-  for (auto & alloc : m_slotAllocInfo)
-    {
-      if (alloc.m_sfnSf == sfnsf)
-        {
-          return alloc;
-        }
-    }
-
-  NS_FATAL_ERROR ("Didn't found the slot");
+  return m_slotAllocInfo.Peek (sfnsf);
 }
 
 size_t
 NrPhy::SlotAllocInfoSize() const
 {
   NS_LOG_FUNCTION (this);
-  return m_slotAllocInfo.size ();
+  return m_slotAllocInfo.Size ();
 }
 
 bool
 NrPhy::IsCtrlMsgListEmpty() const
 {
   NS_LOG_FUNCTION (this);
-  return m_controlMessageQueue.empty () || m_controlMessageQueue.at (0).empty();
+  return m_controlMessageQueue.empty () || m_controlMessageQueue.at (m_ctrlMsgQueueHead).empty ();
+}
+
+bool
+NrPhy::HasPendingTransmissions () const
+{
+  NS_LOG_FUNCTION (this);
+  for (const auto & msgs : m_controlMessageQueue)
+    {
+      if (!msgs.empty ())
+        {
+          return true;
+        }
+    }
+  if (m_slotAllocInfo.AnyOf ([] (const SlotAllocInfo &alloc)
+                             { return alloc.ContainsDataAllocation () || alloc.ContainsUlCtrlAllocation (); }))
+    {
+      return true;
+    }
+  return !m_packetBurstMap.empty ();
+}
+
+uint32_t
+NrPhy::GetSlotsToNextSlotStart (const Time &lastSlotStart) const
+{
+  int64_t elapsed = (Simulator::Now () - lastSlotStart).GetTimeStep ();
+  int64_t period = GetSlotPeriod ().GetTimeStep ();
+  int64_t slots = (elapsed + period - 1) / period;
+  return static_cast<uint32_t> (std::max<int64_t> (slots, 1));
+}
+
+void
+NrPhy::DiscardSlotAllocInfoBefore (const SfnSf &sfnSf)
+{
+  NS_LOG_FUNCTION (this << sfnSf);
+  m_slotAllocInfo.DiscardBefore (sfnSf);
 }
 
 Ptr<const SpectrumModel>
@@ -871,6 +969,34 @@ NrPhy::GetSpectrumModel ()
                                                   GetSubcarrierSpacing ());
 }
 
+void
+NrPhy::SetRbsPerPsdBand (uint32_t rbsPerBand)
+{
+  NS_LOG_FUNCTION (this << rbsPerBand);
+  NS_ABORT_MSG_IF (rbsPerBand == 0, "A PSD band must have at least one RB");
+  NS_ABORT_MSG_IF (!m_spectrumPhys.empty (), "Set the RBs per PSD band before installing the spectrum phys");
+  m_rbsPerPsdBand = rbsPerBand;
+  m_txPsdCache.clear ();
+}
+
+uint32_t
+NrPhy::GetRbsPerPsdBand () const
+{
+  return m_rbsPerPsdBand;
+}
+
+Ptr<const SpectrumModel>
+NrPhy::GetPsdSpectrumModel ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (GetSubcarrierSpacing () < 0.0, "Set a valid numerology");
+  NS_ABORT_MSG_IF (m_channelBandwidth == 0, "Channel bandwidth not set.");
+  return NrSpectrumValueHelper::GetSpectrumModel (GetRbNum (),
+                                                  GetCentralFrequency (),
+                                                  GetSubcarrierSpacing (),
+                                                  m_rbsPerPsdBand);
+}
+
 Time
 NrPhy::GetSymbolPeriod () const
 {
@@ -911,4 +1037,10 @@ NrPhy::GetTbDecodeLatency (void) const
   return m_tbDecodeLatencyUs;
 }
 
+double
+NrPhy::GetBeamCoupling ([[maybe_unused]] const BeamConfId &a, [[maybe_unused]] const BeamConfId &b) const
+{
+  return -1.0;
+}
+
 }
@@ -22,6 +22,8 @@
 
 #include "nr-phy-sap.h"
 #include "nr-phy-mac-common.h"
+#include "nr-control-message-bundle.h"
+#include "nr-slot-alloc-store.h"
 #include <ns3/nr-spectrum-value-helper.h>
 
 namespace ns3 {
@@ -46,7 +48,10 @@ class BeamConfId;
  *
  * The control message list is maintained as a list that has, always, a number
  * of element equals to the latency between PHY and MAC, plus one. The list
- * is initialized by a call to InitializeMessageList(). The messages
+ * is initialized by a call to InitializeMessageList(). It is a ring: the
+ * element of the current slot is at m_ctrlMsgQueueHead, and popping it
+ * makes it the element of the last slot, so no element is moved or
+ * allocated when the slot changes. The messages
  * are enqueued by MAC at the end of the list through the method EnqueueCtrlMessage().
  * If the PHY has the necessity of adding a message, then it can use the
  * no-latency version of it, namely EnqueueCtrlMsgNow(). The messages for the
@@ -60,7 +65,7 @@ class BeamConfId;
  * At the gNb, After the MAC does the slot allocation, it is saved in the PHY with the method
  * PushBackSlotAllocInfo(), and if an allocation for the same slot is already
  * present, the two will be merged together. The slot allocation is stored
- * inside the variable m_slotAllocInfo.
+ * inside the variable m_slotAllocInfo, indexed by slot (see NrSlotAllocStore).
  *
  * \section phy_mac_pdu Management of the MAC PDU that waits to be transmitted
  *
@@ -140,6 +145,31 @@ public:
    */
   void NotifyConnectionSuccessful ();
 
+  /**
+   * \brief Stop the fast-forward of the idle slots, if any
+   *
+   * Called when there is something to do (e.g., new data in the MAC, a
+   * control message to send). The PHY restarts its slots at the next slot
+   * boundary. It does nothing by default.
+   */
+  virtual void WakeUp ();
+
+  /**
+   * \brief Wake up a UE that has DL data, if it is idle
+   *
+   * Only the gNB PHY pages the UEs: it does nothing by default.
+   *
+   * \param rnti the RNTI of the UE
+   */
+  virtual void PageUe (uint16_t rnti);
+
+  /**
+   * \brief Select the messages of a received DL CTRL that this PHY has to process
+   * \param bundle the received control messages
+   * \return all the messages of the bundle (by default)
+   */
+  virtual const std::list<Ptr<NrControlMessage> > & GetRxCtrlMessages (const Ptr<const NrControlMessageBundle> &bundle) const;
+
   /**
    * \brief Configures TB decode latency
    * \param us decode latency
@@ -159,12 +189,46 @@ public:
    */
   virtual BeamConfId GetBeamConfId (uint16_t rnti) const = 0;
 
+  /**
+   * \brief Get the coupling between two beams of this PHY
+   * \param a the first beam
+   * \param b the second beam
+   * \return the normalized gain of a toward b, or -1 if unknown (the default)
+   */
+  virtual double GetBeamCoupling (const BeamConfId &a, const BeamConfId &b) const;
+
   /**
    * \brief Get the spectrum model of the PHY
    * \return a pointer to the spectrum model
    */
   Ptr<const SpectrumModel> GetSpectrumModel ();
 
+  /**
+   * \brief Set the number of RBs of each band of the PSDs of the PHY
+   *
+   * With more than one RB per band, the TX and noise PSDs (hence the
+   * channel and the interference computations) have one value per band
+   * of consecutive RBs instead of one per RB. The MAC, the AMC and the
+   * error model still work per RB: the SINR of a band is given to each of
+   * its RBs. To be set before the spectrum phys are installed, and to the
+   * same value for all the PHYs of a channel.
+   *
+   * \param rbsPerBand the number of RBs of each band (1 for one band per RB)
+   */
+  void SetRbsPerPsdBand (uint32_t rbsPerBand);
+
+  /**
+   * \return the number of RBs of each band of the PSDs of the PHY
+   */
+  uint32_t GetRbsPerPsdBand () const;
+
+  /**
+   * \brief Get the spectrum model of the PSDs of the PHY, with
+   * GetRbsPerPsdBand () RBs per band
+   * \return a pointer to the spectrum model
+   */
+  Ptr<const SpectrumModel> GetPsdSpectrumModel ();
+
   /**
    * \brief Get the number of symbols in a slot
    * \return the number of symbol per slot
@@ -455,7 +519,15 @@ protected:
    * <0,0,0,0,1,1,1,1,1,1,1,1,0,0,0,0> , and therefore the places in which there
    * is a 1 are from the 4th to the 11th, and that is reflected in the output)
    */
-  std::vector<int> FromRBGBitmaskToRBAssignment (const std::vector<uint8_t> rbgBitmask) const;
+  std::vector<int> FromRBGBitmaskToRBAssignment (const NrBitset &rbgBitmask) const;
+
+  /**
+   * \brief Transform a bitmask of RBG into the indices of their RBs, in an
+   * existing vector, reusing its memory
+   * \param rbgBitmask the RBG bitmask
+   * \param rbs the indices of the RBs, cleared first
+   */
+  void FromRBGBitmaskToRBAssignment (const NrBitset &rbgBitmask, std::vector<int> *rbs) const;
 
   /**
    * \brief Protected function that is used to get the number of resource
@@ -487,10 +559,30 @@ protected:
    * \return A SpectrumValue array with fixed size, in which each value
    * is updated to a particular value if the correspond RB index was inside the rbIndexVector,
    * or is left untouched otherwise.
+   *
+   * The PSD are cached by TX power, RBs, number of streams and power
+   * allocation type: the returned PSD can be shared with previous
+   * transmissions, and must not be modified.
+   *
    * \see NrSpectrumValueHelper::CreateTxPowerSpectralDensity
    */
   Ptr<SpectrumValue> GetTxPowerSpectralDensity (const std::vector<int> &rbIndexVector, uint8_t activeStreams);
 
+  /**
+   * \brief Get the TX PSD with a power per RBG
+   *
+   * The power of each RB is the one of the uniform PSD multiplied by the
+   * weight of its RBG. The PSD is not cached.
+   *
+   * \param rbIndexVector the RBs in which there is a transmission
+   * \param activeStreams the number of active streams
+   * \param rbgPower the weight of the power of each RBG (see
+   * DciInfoElementTdma::m_rbgPower); if it is empty, the PSD is the uniform one
+   * \return the TX PSD
+   */
+  Ptr<SpectrumValue> GetTxPowerSpectralDensity (const std::vector<int> &rbIndexVector, uint8_t activeStreams,
+                                                const std::vector<float> &rbgPower);
+
   /**
    * \brief Store the slot allocation info at the front
    * \param slotAllocInfo the allocation to store
@@ -543,6 +635,27 @@ protected:
    */
   bool IsCtrlMsgListEmpty () const;
 
+  /**
+   * \brief Check if there is something to transmit or to receive in the next slots
+   * \return true if there are control messages in the queue, DATA or SRS
+   * allocations, or MAC PDUs waiting for their slot
+   */
+  bool HasPendingTransmissions () const;
+
+  /**
+   * \brief Remove the allocations of the slots before sfnSf (e.g., of the
+   * slots skipped by a fast-forward)
+   * \param sfnSf the first slot to keep
+   */
+  void DiscardSlotAllocInfoBefore (const SfnSf &sfnSf);
+
+  /**
+   * \brief Get the number of slot periods from the start of a slot to the next slot boundary
+   * \param lastSlotStart the start of the last slot that was run
+   * \return the number of slot periods (at least 1)
+   */
+  uint32_t GetSlotsToNextSlotStart (const Time &lastSlotStart) const;
+
   /**
    * \brief Enqueue a CTRL message without considering L1L2CtrlLatency
    * \param msg The message to enqueue
@@ -561,6 +674,10 @@ protected:
   void InitializeMessageList ();
   /**
    * \brief Extract and return the message list that is at the beginning of the queue
+   *
+   * The messages are moved out of the queue, not copied, and the emptied
+   * element becomes the end of the queue.
+   *
    * \return a list of control messages that are meant to be sent in the current slot
    */
   virtual std::list<Ptr<NrControlMessage> > PopCurrentSlotCtrlMsgs (void);
@@ -585,8 +702,9 @@ protected:
   std::vector<LteNrTddSlotType> m_tddPattern = { F, F, F, F, F, F, F, F, F, F}; //!< Pattern
 
 private:
-  std::list<SlotAllocInfo> m_slotAllocInfo; //!< slot allocation info list
-  std::vector<std::list<Ptr<NrControlMessage>>> m_controlMessageQueue; //!< CTRL message queue
+  NrSlotAllocStore m_slotAllocInfo; //!< slot allocation info, indexed by slot
+  std::vector<std::list<Ptr<NrControlMessage>>> m_controlMessageQueue; //!< CTRL message queue, a ring of L1L2CtrlLatency + 1 slots
+  size_t m_ctrlMsgQueueHead {0}; //!< Index in m_controlMessageQueue of the messages of the current slot
 
   Time m_tbDecodeLatencyUs {MicroSeconds(100)}; //!< transport block decode latency
   double m_centralFrequency {-1.0};             //!< Channel central frequency -- set by the helper
@@ -605,6 +723,59 @@ private:
   uint32_t m_rbNum {0};                         //!< number of resource blocks within the channel bandwidth
   double m_rbOh {0.04};                         //!< Overhead for the RB calculation
   enum NrSpectrumValueHelper::PowerAllocationType m_powerAllocationType {NrSpectrumValueHelper::UNIFORM_POWER_ALLOCATION_USED}; //!< The type of power allocation, supported modes to distribute power uniformly over all RBs, or only used RBs
+
+  /**
+   * \brief The parameters of a TX PSD
+   */
+  struct TxPsdKey
+  {
+    double m_txPower {0.0};       //!< TX power (dBm)
+    uint8_t m_activeStreams {0};  //!< Number of active streams
+    enum NrSpectrumValueHelper::PowerAllocationType m_powerAllocationType {NrSpectrumValueHelper::UNIFORM_POWER_ALLOCATION_USED}; //!< Power allocation type
+    std::vector<int> m_rbs;       //!< The RBs of the transmission
+
+    /**
+     * \param o the other key
+     * \return true if the keys are equal
+     */
+    bool operator== (const TxPsdKey &o) const
+    {
+      return m_txPower == o.m_txPower && m_activeStreams == o.m_activeStreams
+             && m_powerAllocationType == o.m_powerAllocationType && m_rbs == o.m_rbs;
+    }
+  };
+
+  /**
+   * \brief Hash of a TxPsdKey
+   */
+  struct TxPsdKeyHash
+  {
+    /**
+     * \param key the key
+     * \return the hash of the key
+     */
+    size_t operator() (const TxPsdKey &key) const
+    {
+      size_t h = std::hash<double> () (key.m_txPower);
+      h ^= (static_cast<size_t> (key.m_activeStreams) << 8) ^ static_cast<size_t> (key.m_powerAllocationType);
+      for (int rb : key.m_rbs)
+        {
+          h = h * 31 + static_cast<size_t> (rb);
+        }
+      return h;
+    }
+  };
+
+  /**
+   * \brief Maximum number of cached TX PSD (the cache is emptied when full,
+   * e.g., with the changing UE TX powers of the power control)
+   */
+  static constexpr size_t MAX_TX_PSD_CACHE_SIZE = 64;
+
+  std::unordered_map<TxPsdKey, Ptr<SpectrumValue>, TxPsdKeyHash> m_txPsdCache; //!< The TX PSD already created
+  Ptr<const SpectrumModel> m_txPsdCacheModel; //!< The spectrum model of the cached TX PSD
+  TxPsdKey m_txPsdKey;                        //!< Key of the last lookup, reused to avoid allocations
+  uint32_t m_rbsPerPsdBand {1};               //!< Number of RBs of each band of the PSDs
 };
 
 } // namespace ns3
@@ -0,0 +1,136 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef NR_POOL_ALLOCATOR_H
+#define NR_POOL_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup utils
+ * \brief An allocator that recycles the memory of single objects
+ *
+ * The memory given back by deallocate is kept in a free list of the
+ * allocated type, and handed out again by the next allocate. Objects that
+ * are created and destroyed at every slot (e.g., the DCI, through
+ * std::allocate_shared) then do not go through the global allocator, once
+ * the peak number of live objects has been reached. The memory is never
+ * given back to the system.
+ *
+ * Each thread has its own free list, as the DCIs are also created by the
+ * schedulers running on the worker threads of NrSchedulingWorkerPool. The
+ * memory of an object created by a thread and released by another goes in
+ * the list of the latter; to not keep growing a list that only receives
+ * memory, at most MAX_FREE_LIST blocks are kept in each list.
+ */
+template <typename T>
+class NrPoolAllocator
+{
+public:
+  typedef T value_type; //!< The allocated type
+
+  NrPoolAllocator () = default;
+
+  /**
+   * \brief Rebinding constructor
+   */
+  template <typename U>
+  NrPoolAllocator (const NrPoolAllocator<U> &)
+  {
+  }
+
+  /**
+   * \brief Allocate the memory for n objects
+   * \param n the number of objects
+   * \return the memory
+   */
+  T * allocate (std::size_t n)
+  {
+    std::vector<void *> &freeList = GetFreeList ();
+    if (n == 1 && !freeList.empty ())
+      {
+        void *p = freeList.back ();
+        freeList.pop_back ();
+        return static_cast<T *> (p);
+      }
+    return static_cast<T *> (::operator new (n * sizeof (T)));
+  }
+
+  /**
+   * \brief Give back the memory of n objects
+   * \param p the memory
+   * \param n the number of objects
+   */
+  void deallocate (T *p, std::size_t n)
+  {
+    std::vector<void *> &freeList = GetFreeList ();
+    if (n == 1 && freeList.size () < MAX_FREE_LIST)
+      {
+        freeList.push_back (p);
+      }
+    else
+      {
+        ::operator delete (p);
+      }
+  }
+
+private:
+  static const std::size_t MAX_FREE_LIST = 4096; //!< Maximum number of blocks kept by a thread
+
+  /**
+   * \return the free list of the type T, for this thread
+   */
+  static std::vector<void *> & GetFreeList ()
+  {
+    // Never destroyed, as objects may be released during the destruction of
+    // the static objects
+    static thread_local std::vector<void *> *freeList = new std::vector<void *> ();
+    return *freeList;
+  }
+};
+
+/**
+ * \brief All the pool allocators share the same free lists
+ * \return true
+ */
+template <typename T, typename U>
+bool
+operator== (const NrPoolAllocator<T> &, const NrPoolAllocator<U> &)
+{
+  return true;
+}
+
+/**
+ * \brief All the pool allocators share the same free lists
+ * \return false
+ */
+template <typename T, typename U>
+bool
+operator!= (const NrPoolAllocator<T> &, const NrPoolAllocator<U> &)
+{
+  return false;
+}
+
+} // namespace ns3
+
+#endif // NR_POOL_ALLOCATOR_H
@@ -26,6 +26,8 @@
 #include <ns3/node-list.h>
 #include <ns3/node.h>
 #include <ns3/simulator.h>
+#include <ns3/boolean.h>
+#include <unordered_map>
 
 #include "ns3/lte-ue-rrc.h"
 #include "ns3/lte-enb-rrc.h"
@@ -229,6 +231,7 @@ NrGnbRrcProtocolIdeal::DoDispose ()
 {
   NS_LOG_FUNCTION (this);
   delete m_enbRrcSapUser;
+  m_pendingDeliveries.clear ();
 }
 
 TypeId
@@ -237,6 +240,13 @@ NrGnbRrcProtocolIdeal::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::NrGnbRrcProtocolIdeal")
     .SetParent<Object> ()
     .AddConstructor<NrGnbRrcProtocolIdeal> ()
+    .AddAttribute ("CoalescedDelivery",
+                   "If true, the messages sent to the UEs at the same time are "
+                   "delivered in a single event, in the order they were sent, "
+                   "instead of one event per message and per UE",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrGnbRrcProtocolIdeal::m_coalescedDelivery),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
@@ -292,6 +302,7 @@ NrGnbRrcProtocolIdeal::DoSendSystemInformation (uint16_t cellId, LteRrcSap::Syst
   NS_LOG_FUNCTION (this << cellId);
   // walk list of all nodes to get UEs with this cellId
   Ptr<LteUeRrc> ueRrc;
+  std::vector<LteUeRrcSapProvider*> siReceivers;
   for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); ++i)
     {
       Ptr<Node> node = *i;
@@ -307,19 +318,69 @@ NrGnbRrcProtocolIdeal::DoSendSystemInformation (uint16_t cellId, LteRrcSap::Syst
                 {
                   NS_LOG_LOGIC ("sending SI to IMSI " << nrUeDev->GetImsi ());
                   ueRrc->GetLteUeRrcSapProvider ()->RecvSystemInformation (msg);
-                  Simulator::Schedule (RRC_IDEAL_MSG_DELAY,
-                                       &LteUeRrcSapProvider::RecvSystemInformation,
-                                       ueRrc->GetLteUeRrcSapProvider (),
-                                       msg);
+                  if (m_coalescedDelivery)
+                    {
+                      siReceivers.push_back (ueRrc->GetLteUeRrcSapProvider ());
+                    }
+                  else
+                    {
+                      Simulator::Schedule (RRC_IDEAL_MSG_DELAY,
+                                           &LteUeRrcSapProvider::RecvSystemInformation,
+                                           ueRrc->GetLteUeRrcSapProvider (),
+                                           msg);
+                    }
                 }
             }
         }
     }
+
+  if (!siReceivers.empty ())
+    {
+      // One event for all the UEs of the cell
+      DeliverToUe ([siReceivers, msg] ()
+        {
+          for (auto ueRrcSapProvider : siReceivers)
+            {
+              ueRrcSapProvider->RecvSystemInformation (msg);
+            }
+        });
+    }
+}
+
+void
+NrGnbRrcProtocolIdeal::DeliverToUe (std::function<void ()> delivery)
+{
+  m_pendingDeliveries.emplace_back (std::move (delivery));
+  if (!m_deliveryScheduled)
+    {
+      m_deliveryScheduled = true;
+      Simulator::Schedule (RRC_IDEAL_MSG_DELAY, &NrGnbRrcProtocolIdeal::DeliverPending, this);
+    }
+}
+
+void
+NrGnbRrcProtocolIdeal::DeliverPending ()
+{
+  NS_LOG_FUNCTION (this << m_pendingDeliveries.size ());
+  // A delivery can make the RRC send another message: it goes in the next event
+  std::vector<std::function<void ()>> deliveries;
+  deliveries.swap (m_pendingDeliveries);
+  m_deliveryScheduled = false;
+  for (auto & delivery : deliveries)
+    {
+      delivery ();
+    }
 }
 
 void
 NrGnbRrcProtocolIdeal::DoSendRrcConnectionSetup (uint16_t rnti, LteRrcSap::RrcConnectionSetup msg)
 {
+  if (m_coalescedDelivery)
+    {
+      LteUeRrcSapProvider *ueRrcSapProvider = GetUeRrcSapProvider (rnti);
+      DeliverToUe ([ueRrcSapProvider, msg] () { ueRrcSapProvider->RecvRrcConnectionSetup (msg); });
+      return;
+    }
   Simulator::Schedule (RRC_IDEAL_MSG_DELAY,
                        &LteUeRrcSapProvider::RecvRrcConnectionSetup,
                        GetUeRrcSapProvider (rnti),
@@ -329,6 +390,12 @@ NrGnbRrcProtocolIdeal::DoSendRrcConnectionSetup (uint16_t rnti, LteRrcSap::RrcCo
 void
 NrGnbRrcProtocolIdeal::DoSendRrcConnectionReconfiguration (uint16_t rnti, LteRrcSap::RrcConnectionReconfiguration msg)
 {
+  if (m_coalescedDelivery)
+    {
+      LteUeRrcSapProvider *ueRrcSapProvider = GetUeRrcSapProvider (rnti);
+      DeliverToUe ([ueRrcSapProvider, msg] () { ueRrcSapProvider->RecvRrcConnectionReconfiguration (msg); });
+      return;
+    }
   Simulator::Schedule (RRC_IDEAL_MSG_DELAY,
                        &LteUeRrcSapProvider::RecvRrcConnectionReconfiguration,
                        GetUeRrcSapProvider (rnti),
@@ -338,6 +405,12 @@ NrGnbRrcProtocolIdeal::DoSendRrcConnectionReconfiguration (uint16_t rnti, LteRrc
 void
 NrGnbRrcProtocolIdeal::DoSendRrcConnectionReestablishment (uint16_t rnti, LteRrcSap::RrcConnectionReestablishment msg)
 {
+  if (m_coalescedDelivery)
+    {
+      LteUeRrcSapProvider *ueRrcSapProvider = GetUeRrcSapProvider (rnti);
+      DeliverToUe ([ueRrcSapProvider, msg] () { ueRrcSapProvider->RecvRrcConnectionReestablishment (msg); });
+      return;
+    }
   Simulator::Schedule (RRC_IDEAL_MSG_DELAY,
                        &LteUeRrcSapProvider::RecvRrcConnectionReestablishment,
                        GetUeRrcSapProvider (rnti),
@@ -347,6 +420,12 @@ NrGnbRrcProtocolIdeal::DoSendRrcConnectionReestablishment (uint16_t rnti, LteRrc
 void
 NrGnbRrcProtocolIdeal::DoSendRrcConnectionReestablishmentReject (uint16_t rnti, LteRrcSap::RrcConnectionReestablishmentReject msg)
 {
+  if (m_coalescedDelivery)
+    {
+      LteUeRrcSapProvider *ueRrcSapProvider = GetUeRrcSapProvider (rnti);
+      DeliverToUe ([ueRrcSapProvider, msg] () { ueRrcSapProvider->RecvRrcConnectionReestablishmentReject (msg); });
+      return;
+    }
   Simulator::Schedule (RRC_IDEAL_MSG_DELAY,
                        &LteUeRrcSapProvider::RecvRrcConnectionReestablishmentReject,
                        GetUeRrcSapProvider (rnti),
@@ -356,6 +435,12 @@ NrGnbRrcProtocolIdeal::DoSendRrcConnectionReestablishmentReject (uint16_t rnti,
 void
 NrGnbRrcProtocolIdeal::DoSendRrcConnectionRelease (uint16_t rnti, LteRrcSap::RrcConnectionRelease msg)
 {
+  if (m_coalescedDelivery)
+    {
+      LteUeRrcSapProvider *ueRrcSapProvider = GetUeRrcSapProvider (rnti);
+      DeliverToUe ([ueRrcSapProvider, msg] () { ueRrcSapProvider->RecvRrcConnectionRelease (msg); });
+      return;
+    }
   Simulator::Schedule (RRC_IDEAL_MSG_DELAY,
                        &LteUeRrcSapProvider::RecvRrcConnectionRelease,
                        GetUeRrcSapProvider (rnti),
@@ -365,6 +450,12 @@ NrGnbRrcProtocolIdeal::DoSendRrcConnectionRelease (uint16_t rnti, LteRrcSap::Rrc
 void
 NrGnbRrcProtocolIdeal::DoSendRrcConnectionReject (uint16_t rnti, LteRrcSap::RrcConnectionReject msg)
 {
+  if (m_coalescedDelivery)
+    {
+      LteUeRrcSapProvider *ueRrcSapProvider = GetUeRrcSapProvider (rnti);
+      DeliverToUe ([ueRrcSapProvider, msg] () { ueRrcSapProvider->RecvRrcConnectionReject (msg); });
+      return;
+    }
   Simulator::Schedule (RRC_IDEAL_MSG_DELAY,
                        &LteUeRrcSapProvider::RecvRrcConnectionReject,
                        GetUeRrcSapProvider (rnti),
@@ -383,7 +474,7 @@ NrGnbRrcProtocolIdeal::DoSendRrcConnectionReject (uint16_t rnti, LteRrcSap::RrcC
  *
  */
 
-static std::map<uint32_t, LteRrcSap::HandoverPreparationInfo> g_handoverPreparationInfoMsgMap;
+static std::unordered_map<uint32_t, LteRrcSap::HandoverPreparationInfo> g_handoverPreparationInfoMsgMap;
 static uint32_t g_handoverPreparationInfoMsgIdCounter = 0;
 
 /*
@@ -465,7 +556,7 @@ NrGnbRrcProtocolIdeal::DoEncodeHandoverPreparationInformation (LteRrcSap::Handov
   uint32_t msgId = ++g_handoverPreparationInfoMsgIdCounter;
   NS_ASSERT_MSG (g_handoverPreparationInfoMsgMap.find (msgId) == g_handoverPreparationInfoMsgMap.end (), "msgId " << msgId << " already in use");
   NS_LOG_INFO (" encoding msgId = " << msgId);
-  g_handoverPreparationInfoMsgMap.insert (std::pair<uint32_t, LteRrcSap::HandoverPreparationInfo> (msgId, msg));
+  g_handoverPreparationInfoMsgMap.emplace (msgId, std::move (msg));
   NrIdealHandoverPreparationInfoHeader h;
   h.SetMsgId (msgId);
   Ptr<Packet> p = Create<Packet> ();
@@ -480,16 +571,16 @@ NrGnbRrcProtocolIdeal::DoDecodeHandoverPreparationInformation (Ptr<Packet> p)
   p->RemoveHeader (h);
   uint32_t msgId = h.GetMsgId ();
   NS_LOG_INFO (" decoding msgId = " << msgId);
-  std::map<uint32_t, LteRrcSap::HandoverPreparationInfo>::iterator it = g_handoverPreparationInfoMsgMap.find (msgId);
+  auto it = g_handoverPreparationInfoMsgMap.find (msgId);
   NS_ASSERT_MSG (it != g_handoverPreparationInfoMsgMap.end (), "msgId " << msgId << " not found");
-  LteRrcSap::HandoverPreparationInfo msg = it->second;
+  LteRrcSap::HandoverPreparationInfo msg = std::move (it->second);
   g_handoverPreparationInfoMsgMap.erase (it);
   return msg;
 }
 
 
 
-static std::map<uint32_t, LteRrcSap::RrcConnectionReconfiguration> g_handoverCommandMsgMap;
+static std::unordered_map<uint32_t, LteRrcSap::RrcConnectionReconfiguration> g_handoverCommandMsgMap;
 static uint32_t g_handoverCommandMsgIdCounter = 0;
 
 /*
@@ -571,7 +662,7 @@ NrGnbRrcProtocolIdeal::DoEncodeHandoverCommand (LteRrcSap::RrcConnectionReconfig
   uint32_t msgId = ++g_handoverCommandMsgIdCounter;
   NS_ASSERT_MSG (g_handoverCommandMsgMap.find (msgId) == g_handoverCommandMsgMap.end (), "msgId " << msgId << " already in use");
   NS_LOG_INFO (" encoding msgId = " << msgId);
-  g_handoverCommandMsgMap.insert (std::pair<uint32_t, LteRrcSap::RrcConnectionReconfiguration> (msgId, msg));
+  g_handoverCommandMsgMap.emplace (msgId, std::move (msg));
   NrIdealHandoverCommandHeader h;
   h.SetMsgId (msgId);
   Ptr<Packet> p = Create<Packet> ();
@@ -586,9 +677,9 @@ NrGnbRrcProtocolIdeal::DoDecodeHandoverCommand (Ptr<Packet> p)
   p->RemoveHeader (h);
   uint32_t msgId = h.GetMsgId ();
   NS_LOG_INFO (" decoding msgId = " << msgId);
-  std::map<uint32_t, LteRrcSap::RrcConnectionReconfiguration>::iterator it = g_handoverCommandMsgMap.find (msgId);
+  auto it = g_handoverCommandMsgMap.find (msgId);
   NS_ASSERT_MSG (it != g_handoverCommandMsgMap.end (), "msgId " << msgId << " not found");
-  LteRrcSap::RrcConnectionReconfiguration msg = it->second;
+  LteRrcSap::RrcConnectionReconfiguration msg = std::move (it->second);
   g_handoverCommandMsgMap.erase (it);
   return msg;
 }
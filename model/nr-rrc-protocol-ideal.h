@@ -24,6 +24,8 @@
 
 #include <stdint.h>
 #include <map>
+#include <functional>
+#include <vector>
 
 #include <ns3/ptr.h>
 #include <ns3/object.h>
@@ -158,11 +160,23 @@ private:
   Ptr<Packet> DoEncodeHandoverCommand (LteRrcSap::RrcConnectionReconfiguration msg);
   LteRrcSap::RrcConnectionReconfiguration DoDecodeHandoverCommand (Ptr<Packet> p);
 
+  /**
+   * \brief Deliver a message to the UEs with the other messages of this instant
+   * \param delivery the function that delivers the message
+   */
+  void DeliverToUe (std::function<void ()> delivery);
+  /**
+   * \brief Deliver the messages sent since the last delivery
+   */
+  void DeliverPending ();
 
   uint16_t m_rnti;
   LteEnbRrcSapProvider* m_enbRrcSapProvider;
   LteEnbRrcSapUser* m_enbRrcSapUser;
   std::map<uint16_t, LteUeRrcSapProvider*> m_enbRrcSapProviderMap;
+  bool m_coalescedDelivery {false}; //!< Deliver the messages of the same time in one event (attribute)
+  bool m_deliveryScheduled {false}; //!< True if DeliverPending is scheduled
+  std::vector<std::function<void ()>> m_pendingDeliveries; //!< The messages to deliver in DeliverPending
 
 };
 
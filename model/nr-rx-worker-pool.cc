@@ -0,0 +1,198 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-rx-worker-pool.h"
+#include <ns3/log.h>
+#include <ns3/assert.h>
+#include <ns3/simulator.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrRxWorkerPool");
+
+NrRxWorkerPool &
+NrRxWorkerPool::Get ()
+{
+  static NrRxWorkerPool pool;
+  return pool;
+}
+
+NrRxWorkerPool::~NrRxWorkerPool ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_stop = true;
+  }
+  m_wakeWorkers.notify_all ();
+  for (auto & thread : m_threads)
+    {
+      thread.join ();
+    }
+}
+
+void
+NrRxWorkerPool::SetNumWorkers (uint32_t numWorkers)
+{
+  NS_LOG_FUNCTION (this << numWorkers);
+  m_numWorkers = std::max (m_numWorkers, numWorkers);
+}
+
+uint32_t
+NrRxWorkerPool::GetNumWorkers () const
+{
+  return m_numWorkers;
+}
+
+void
+NrRxWorkerPool::AddRx (std::function<void ()> decode, std::function<void ()> deliver)
+{
+  NS_LOG_FUNCTION (this);
+
+  // A simulation stopped between the end of a reception and its delivery
+  // leaves it in the pool
+  if (!m_resetScheduled)
+    {
+      m_resetScheduled = true;
+      Simulator::ScheduleDestroy (&NrRxWorkerPool::Reset, this);
+    }
+
+  Rx rx;
+  rx.m_context = Simulator::GetContext ();
+  rx.m_decode = std::move (decode);
+  rx.m_deliver = std::move (deliver);
+  m_pendingRx.emplace_back (std::move (rx));
+
+  // All the receptions that end at this time do it before RunBatch, that
+  // is the last event of this time in the queue
+  if (!m_batchScheduled)
+    {
+      m_batchScheduled = true;
+      Simulator::ScheduleNow (&NrRxWorkerPool::RunBatch, this);
+    }
+}
+
+void
+NrRxWorkerPool::RunBatch ()
+{
+  NS_LOG_FUNCTION (this << m_pendingRx.size ());
+  NS_ASSERT_MSG (m_delivered == m_rx.size (), "The deliveries of the last batch are not done");
+
+  std::swap (m_rx, m_pendingRx);
+  m_pendingRx.clear ();
+  m_delivered = 0;
+  m_batchScheduled = false;
+
+  RunDecodes ();
+
+  // Events of the same time are run in the order they are scheduled
+  for (size_t i = 0; i < m_rx.size (); ++i)
+    {
+      Simulator::ScheduleWithContext (m_rx.at (i).m_context, Seconds (0),
+                                      &NrRxWorkerPool::CallDeliver, this, i);
+    }
+}
+
+void
+NrRxWorkerPool::Reset ()
+{
+  NS_LOG_FUNCTION (this);
+  m_pendingRx.clear ();
+  m_rx.clear ();
+  m_delivered = 0;
+  m_batchScheduled = false;
+  m_resetScheduled = false;
+}
+
+void
+NrRxWorkerPool::CallDeliver (size_t rx)
+{
+  NS_LOG_FUNCTION (this << rx);
+  m_rx.at (rx).m_deliver ();
+  ++m_delivered;
+}
+
+void
+NrRxWorkerPool::RunDecodes ()
+{
+  if (m_numWorkers <= 1 || m_rx.size () < 2)
+    {
+      for (auto & rx : m_rx)
+        {
+          rx.m_decode ();
+        }
+      return;
+    }
+
+  while (m_threads.size () + 1 < m_numWorkers)
+    {
+      m_threads.emplace_back (&NrRxWorkerPool::WorkerLoop, this, m_generation);
+    }
+
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_nextRx = 0;
+    m_idleWorkers = 0;
+    ++m_generation;
+  }
+  m_wakeWorkers.notify_all ();
+
+  RunPendingDecodes ();
+
+  // Wait for all the threads, and not only for all the decodings, so that
+  // no thread is looking at m_rx when the next batch fills it
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_workersIdle.wait (lock, [this] { return m_idleWorkers == m_threads.size (); });
+}
+
+void
+NrRxWorkerPool::RunPendingDecodes ()
+{
+  for (size_t i = m_nextRx++; i < m_rx.size (); i = m_nextRx++)
+    {
+      m_rx[i].m_decode ();
+    }
+}
+
+void
+NrRxWorkerPool::WorkerLoop (uint64_t generation)
+{
+  while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lock (m_mutex);
+        m_wakeWorkers.wait (lock, [this, generation] { return m_stop || m_generation != generation; });
+        if (m_stop)
+          {
+            return;
+          }
+        generation = m_generation;
+      }
+
+      RunPendingDecodes ();
+
+      {
+        std::lock_guard<std::mutex> lock (m_mutex);
+        ++m_idleWorkers;
+      }
+      m_workersIdle.notify_one ();
+    }
+}
+
+} // namespace ns3
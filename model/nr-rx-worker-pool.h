@@ -0,0 +1,157 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_RX_WORKER_POOL_H
+#define NR_RX_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup spectrum
+ * \brief Decodes the DATA receptions that end at the same time on worker threads
+ *
+ * A NrSpectrumPhy with the attribute NumRxWorkers greater than 1 does, at
+ * the end of a DATA reception, only what touches the rest of the
+ * simulation: the end of the interference window (SINR and CQI callbacks)
+ * and the change of state. It then registers with AddRx the decoding of
+ * the TBs (SINR statistics and error model) and their delivery (packets to
+ * the PHY, HARQ feedback and history, traces).
+ *
+ * The first registration at a given simulation time schedules the batch,
+ * which is the last event of that time in the queue: all the receptions
+ * that end at that time are in it. The decodings are run in parallel on
+ * the worker threads; when all of them are finished, the deliveries are
+ * done in the order of registration, which is the order of the serial
+ * execution, each with the context of its receiver.
+ *
+ * A decoding only reads and writes the state of its reception, the HARQ
+ * history and the random variable of its NrSpectrumPhy, and the error
+ * model, whose GetTbDecodificationStats must be thread-safe (as the ones
+ * of this module are). The results do not depend on the number of
+ * workers. With respect to the serial execution, the deliveries of the
+ * receptions that end at the same time happen after the end of all of
+ * them, and after the other events of that time already in the queue.
+ */
+class NrRxWorkerPool
+{
+public:
+  /**
+   * \return the pool shared by all the NrSpectrumPhy
+   */
+  static NrRxWorkerPool & Get ();
+
+  /**
+   * \brief Destructor: stop and join the worker threads
+   */
+  ~NrRxWorkerPool ();
+
+  /**
+   * \brief Set the number of threads that decode the receptions
+   *
+   * The number is only increased: the pool uses the highest value asked by
+   * any of the NrSpectrumPhy. The simulation thread is one of the workers.
+   *
+   * \param numWorkers the number of workers
+   */
+  void SetNumWorkers (uint32_t numWorkers);
+
+  /**
+   * \return the number of threads that decode the receptions
+   */
+  uint32_t GetNumWorkers () const;
+
+  /**
+   * \brief Register the end of a reception
+   * \param decode the decoding, run on a worker thread
+   * \param deliver the delivery, run on the simulation thread
+   */
+  void AddRx (std::function<void ()> decode, std::function<void ()> deliver);
+
+private:
+  NrRxWorkerPool () = default;
+
+  /**
+   * \brief A reception
+   */
+  struct Rx
+  {
+    uint32_t m_context {0};            //!< The context of the receiver
+    std::function<void ()> m_decode;   //!< The decoding
+    std::function<void ()> m_deliver;  //!< The delivery
+  };
+
+  /**
+   * \brief Decode the receptions registered at this time, and schedule their deliveries
+   */
+  void RunBatch ();
+
+  /**
+   * \brief Drop the receptions not delivered, when the simulation is destroyed
+   */
+  void Reset ();
+
+  /**
+   * \brief Deliver a reception of the last batch
+   * \param rx the index of the reception
+   */
+  void CallDeliver (size_t rx);
+
+  /**
+   * \brief Run the decodings of the batch on the worker threads
+   */
+  void RunDecodes ();
+
+  /**
+   * \brief Run the decodings that were not taken yet by a worker
+   */
+  void RunPendingDecodes ();
+
+  /**
+   * \brief The loop of a worker thread
+   * \param generation the last batch already run when the thread is created
+   */
+  void WorkerLoop (uint64_t generation);
+
+  uint32_t m_numWorkers {1};         //!< Number of workers, including the simulation thread
+  bool m_batchScheduled {false};     //!< True if RunBatch is scheduled
+  bool m_resetScheduled {false};     //!< True if Reset is scheduled at the destruction of the simulation
+  std::vector<Rx> m_pendingRx;       //!< Receptions registered for the next batch
+  std::vector<Rx> m_rx;              //!< Receptions of the current batch
+  size_t m_delivered {0};            //!< Deliveries of the current batch already done
+
+  std::vector<std::thread> m_threads;    //!< The worker threads
+  std::mutex m_mutex;                     //!< Protects the following members
+  std::condition_variable m_wakeWorkers;  //!< Signals a new batch to the workers
+  std::condition_variable m_workersIdle;  //!< Signals the end of a batch to the simulation thread
+  uint64_t m_generation {0};             //!< Counter of the batches run on the workers
+  uint32_t m_idleWorkers {0};            //!< Threads that finished the current batch
+  bool m_stop {false};                   //!< True to stop the workers
+  std::atomic<size_t> m_nextRx {0};      //!< Index of the next decoding to take
+};
+
+} // namespace ns3
+
+#endif // NR_RX_WORKER_POOL_H
@@ -0,0 +1,193 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-scheduler-shm-interface.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/assert.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrSchedulerShmInterface");
+
+static_assert (sizeof (NrShmUeState) == 24, "Unexpected layout of NrShmUeState");
+static_assert (sizeof (NrShmUeDecision) == 8, "Unexpected layout of NrShmUeDecision");
+static_assert (sizeof (NrShmRegion::State) == 24 + 24 * NrShmRegion::MAX_UES,
+               "Unexpected layout of NrShmRegion::State");
+static_assert (sizeof (NrShmRegion::Decision) == 16 + 8 * NrShmRegion::MAX_UES,
+               "Unexpected layout of NrShmRegion::Decision");
+static_assert (std::atomic<uint64_t>::is_always_lock_free,
+               "The sequence numbers must be lock-free to be shared between processes");
+
+/**
+ * \brief Poll a condition, yielding the CPU, up to a wall-clock timeout
+ * \param condition the condition
+ * \param timeoutUs the timeout, in us
+ * \return true if the condition became true in time
+ */
+template <typename Condition>
+static bool
+PollUntil (const Condition &condition, uint64_t timeoutUs)
+{
+  // Spin for the first checks, as a polling agent answers in a few us
+  for (uint32_t i = 0; i < 1000; ++i)
+    {
+      if (condition ())
+        {
+          return true;
+        }
+    }
+  const auto deadline = std::chrono::steady_clock::now () + std::chrono::microseconds (timeoutUs);
+  while (! condition ())
+    {
+      if (std::chrono::steady_clock::now () >= deadline)
+        {
+          return false;
+        }
+      std::this_thread::yield ();
+    }
+  return true;
+}
+
+NrSchedulerShmInterface::NrSchedulerShmInterface (const std::string &name, Role role)
+  : m_name (name),
+    m_role (role)
+{
+  NS_LOG_FUNCTION (this << name << role);
+  int flags = role == SIMULATOR ? O_CREAT | O_RDWR | O_TRUNC : O_RDWR;
+  int fd = shm_open (name.c_str (), flags, 0600);
+  NS_ABORT_MSG_IF (fd < 0, "Cannot open the shared memory " << name << ": " << std::strerror (errno));
+  if (role == SIMULATOR)
+    {
+      NS_ABORT_MSG_IF (ftruncate (fd, sizeof (NrShmRegion)) != 0,
+                       "Cannot size the shared memory " << name << ": " << std::strerror (errno));
+    }
+  void *addr = mmap (nullptr, sizeof (NrShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+  NS_ABORT_MSG_IF (addr == MAP_FAILED, "Cannot map the shared memory " << name << ": " << std::strerror (errno));
+  m_region = static_cast<NrShmRegion *> (addr);
+
+  if (role == SIMULATOR)
+    {
+      // The region is zeroed by ftruncate; the magic number goes last
+      m_region->m_version = NrShmRegion::VERSION;
+      m_region->m_stateSeq.store (0, std::memory_order_relaxed);
+      m_region->m_decisionSeq.store (0, std::memory_order_relaxed);
+      std::atomic_thread_fence (std::memory_order_release);
+      m_region->m_magic = NrShmRegion::MAGIC;
+    }
+  else
+    {
+      NS_ABORT_MSG_IF (m_region->m_magic != NrShmRegion::MAGIC || m_region->m_version != NrShmRegion::VERSION,
+                       "The shared memory " << name << " is not a NR scheduler region of version "
+                       << NrShmRegion::VERSION);
+    }
+}
+
+NrSchedulerShmInterface::~NrSchedulerShmInterface ()
+{
+  NS_LOG_FUNCTION (this);
+  munmap (m_region, sizeof (NrShmRegion));
+  if (m_role == SIMULATOR)
+    {
+      shm_unlink (m_name.c_str ());
+    }
+}
+
+NrShmRegion::State *
+NrSchedulerShmInterface::NextState ()
+{
+  NS_ASSERT (m_role == SIMULATOR);
+  NrShmRegion::State *state = &m_region->m_states[m_nextSeq % NrShmRegion::RING_SIZE];
+  state->m_seq = m_nextSeq;
+  return state;
+}
+
+uint64_t
+NrSchedulerShmInterface::PublishState ()
+{
+  NS_ASSERT (m_role == SIMULATOR);
+  uint64_t seq = m_nextSeq++;
+  m_region->m_stateSeq.store (seq, std::memory_order_release);
+  return seq;
+}
+
+const NrShmRegion::Decision *
+NrSchedulerShmInterface::WaitDecision (uint64_t seq, uint64_t timeoutUs) const
+{
+  bool arrived = PollUntil ([this, seq] ()
+    {
+      return m_region->m_decisionSeq.load (std::memory_order_acquire) >= seq;
+    }, timeoutUs);
+  if (! arrived)
+    {
+      NS_LOG_WARN ("No decision on state " << seq << " within " << timeoutUs << " us");
+      return nullptr;
+    }
+  const NrShmRegion::Decision *decision = &m_region->m_decisions[seq % NrShmRegion::RING_SIZE];
+  return decision->m_seq == seq ? decision : nullptr;
+}
+
+const NrShmRegion::Decision *
+NrSchedulerShmInterface::GetLastDecision () const
+{
+  uint64_t seq = m_region->m_decisionSeq.load (std::memory_order_acquire);
+  return seq == 0 ? nullptr : &m_region->m_decisions[seq % NrShmRegion::RING_SIZE];
+}
+
+const NrShmRegion::State *
+NrSchedulerShmInterface::WaitState (uint64_t seq, uint64_t timeoutUs) const
+{
+  bool arrived = PollUntil ([this, seq] ()
+    {
+      return m_region->m_stateSeq.load (std::memory_order_acquire) > seq;
+    }, timeoutUs);
+  if (! arrived)
+    {
+      return nullptr;
+    }
+  uint64_t last = m_region->m_stateSeq.load (std::memory_order_acquire);
+  return &m_region->m_states[last % NrShmRegion::RING_SIZE];
+}
+
+NrShmRegion::Decision *
+NrSchedulerShmInterface::DecisionFor (uint64_t seq)
+{
+  NS_ASSERT (m_role == AGENT);
+  NrShmRegion::Decision *decision = &m_region->m_decisions[seq % NrShmRegion::RING_SIZE];
+  decision->m_seq = seq;
+  decision->m_direction = m_region->m_states[seq % NrShmRegion::RING_SIZE].m_direction;
+  return decision;
+}
+
+void
+NrSchedulerShmInterface::PublishDecision (uint64_t seq)
+{
+  NS_ASSERT (m_role == AGENT);
+  m_region->m_decisionSeq.store (seq, std::memory_order_release);
+}
+
+} // namespace ns3
@@ -0,0 +1,206 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_SCHEDULER_SHM_INTERFACE_H
+#define NR_SCHEDULER_SHM_INTERFACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief State of a UE in the snapshot of a slot (24 bytes, no padding)
+ */
+struct NrShmUeState
+{
+  uint16_t m_rnti;           //!< RNTI
+  uint16_t m_beamSector;     //!< Sector of the first beam of the UE
+  float m_beamElevation;     //!< Elevation of the first beam of the UE
+  uint8_t m_wbCqi;           //!< Wideband CQI of the first stream (DL) or 0 (UL)
+  uint8_t m_mcs;             //!< MCS of the first stream
+  uint8_t m_activeHarq;      //!< HARQ processes in use
+  uint8_t m_reserved;        //!< Padding, 0
+  uint32_t m_bufferBytes;    //!< Bytes in the buffers of the UE
+  float m_avgTput;           //!< Average throughput of the PF scheduler
+  float m_potentialTput;     //!< Throughput of the UE in one RBG, at its MCS
+};
+
+/**
+ * \ingroup scheduler
+ * \brief Weight of a UE in a decision (8 bytes)
+ */
+struct NrShmUeDecision
+{
+  uint16_t m_rnti;           //!< RNTI
+  uint16_t m_reserved;       //!< Padding, 0
+  float m_weight;            //!< Priority of the UE: the higher, the earlier it is served
+};
+
+/**
+ * \ingroup scheduler
+ * \brief Layout of the memory shared by the scheduler and the agent
+ *
+ * The simulator writes the state of a scheduling decision (a DL or UL
+ * allocation of a slot) in m_states[seq % RING_SIZE], and then stores seq
+ * in m_stateSeq (release). The agent, once it sees m_stateSeq change
+ * (acquire), reads the state, writes its decision, with the same seq, in
+ * m_decisions[seq % RING_SIZE], and stores seq in m_decisionSeq (release).
+ * The sequence numbers start from 1. The layout is fixed: all the fields
+ * have the size and the offset given by a C struct without padding on a
+ * little-endian 64-bit machine, so that an agent in another language can
+ * map it (e.g., with numpy structured dtypes).
+ */
+struct NrShmRegion
+{
+  static constexpr uint32_t MAGIC = 0x4E525348;    //!< "NRSH"
+  static constexpr uint32_t VERSION = 1;           //!< Version of the layout
+  static constexpr uint32_t RING_SIZE = 16;        //!< Entries of the rings
+  static constexpr uint32_t MAX_UES = 256;         //!< UEs of a state or decision
+
+  /**
+   * \brief Snapshot of the UEs to schedule
+   */
+  struct State
+  {
+    uint64_t m_seq;                      //!< Sequence number
+    int64_t m_timeNs;                    //!< Simulation time, in ns
+    uint8_t m_direction;                 //!< 0 for DL, 1 for UL
+    uint8_t m_reserved[3];               //!< Padding, 0
+    uint32_t m_numUes;                   //!< UEs valid in m_ues
+    NrShmUeState m_ues[MAX_UES];         //!< The UEs
+  };
+
+  /**
+   * \brief Decision of the agent on a state
+   */
+  struct Decision
+  {
+    uint64_t m_seq;                      //!< Sequence number of the state
+    uint32_t m_numUes;                   //!< UEs valid in m_ues
+    uint8_t m_direction;                 //!< Direction of the state, copied by DecisionFor
+    uint8_t m_reserved[3];               //!< Padding, 0
+    NrShmUeDecision m_ues[MAX_UES];      //!< The UEs
+  };
+
+  uint32_t m_magic;                      //!< MAGIC, once the region is ready
+  uint32_t m_version;                    //!< VERSION
+  std::atomic<uint64_t> m_stateSeq;      //!< Last state published
+  std::atomic<uint64_t> m_decisionSeq;   //!< Last decision published
+  State m_states[RING_SIZE];             //!< Ring of the states
+  Decision m_decisions[RING_SIZE];       //!< Ring of the decisions
+};
+
+/**
+ * \ingroup scheduler
+ * \brief POSIX shared-memory channel between a scheduler and an external agent
+ *
+ * The simulator side creates the region (shm_open) with the given name and
+ * removes it when destroyed; the agent side opens the existing one. The
+ * states and the decisions are written in place in the region, and the
+ * two sides synchronize only through the two sequence numbers of
+ * NrShmRegion, so that an exchange costs a few microseconds when the agent
+ * is polling. The waits poll the sequence numbers, yielding the CPU, up to
+ * a wall-clock timeout.
+ */
+class NrSchedulerShmInterface
+{
+public:
+  /**
+   * \brief Side of the channel
+   */
+  enum Role
+  {
+    SIMULATOR,  //!< Create the region, publish states
+    AGENT       //!< Open the region, publish decisions
+  };
+
+  /**
+   * \brief Create or open the region
+   * \param name the name of the POSIX shared memory object, e.g., "/nr-sched"
+   * \param role the side of the channel
+   */
+  NrSchedulerShmInterface (const std::string &name, Role role);
+
+  /**
+   * \brief Unmap the region, and remove it on the simulator side
+   */
+  ~NrSchedulerShmInterface ();
+
+  NrSchedulerShmInterface (const NrSchedulerShmInterface &) = delete;
+  NrSchedulerShmInterface & operator= (const NrSchedulerShmInterface &) = delete;
+
+  /**
+   * \brief Get the entry of the next state, to fill before PublishState
+   * \return the entry, with the sequence number already set
+   */
+  NrShmRegion::State * NextState ();
+
+  /**
+   * \brief Publish the state filled in the entry returned by NextState
+   * \return the sequence number of the state
+   */
+  uint64_t PublishState ();
+
+  /**
+   * \brief Wait for the decision on a state
+   * \param seq the sequence number of the state
+   * \param timeoutUs the wall-clock timeout, in us
+   * \return the decision, or nullptr if it did not arrive in time
+   */
+  const NrShmRegion::Decision * WaitDecision (uint64_t seq, uint64_t timeoutUs) const;
+
+  /**
+   * \brief Get the last decision published, without waiting
+   * \return the decision, or nullptr if there is none yet
+   */
+  const NrShmRegion::Decision * GetLastDecision () const;
+
+  /**
+   * \brief Wait for a state newer than a sequence number
+   * \param seq the sequence number of the last state seen (0 at start)
+   * \param timeoutUs the wall-clock timeout, in us
+   * \return the newest state, or nullptr if none arrived in time
+   */
+  const NrShmRegion::State * WaitState (uint64_t seq, uint64_t timeoutUs) const;
+
+  /**
+   * \brief Get the entry of the decision on a state, to fill before PublishDecision
+   * \param seq the sequence number of the state
+   * \return the entry, with the sequence number and the direction already set
+   */
+  NrShmRegion::Decision * DecisionFor (uint64_t seq);
+
+  /**
+   * \brief Publish the decision filled in the entry returned by DecisionFor
+   * \param seq the sequence number of the state
+   */
+  void PublishDecision (uint64_t seq);
+
+private:
+  std::string m_name;               //!< Name of the shared memory object
+  Role m_role;                      //!< Side of the channel
+  NrShmRegion *m_region {nullptr};  //!< The mapped region
+  uint64_t m_nextSeq {1};           //!< Sequence number of the next state (simulator side)
+};
+
+} // namespace ns3
+
+#endif // NR_SCHEDULER_SHM_INTERFACE_H
@@ -0,0 +1,267 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-scheduling-worker-pool.h"
+#include <ns3/log.h>
+#include <ns3/assert.h>
+#include <ns3/simulator.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrSchedulingWorkerPool");
+
+NrSchedulingWorkerPool &
+NrSchedulingWorkerPool::Get ()
+{
+  static NrSchedulingWorkerPool pool;
+  return pool;
+}
+
+NrSchedulingWorkerPool::~NrSchedulingWorkerPool ()
+{
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_stop = true;
+  }
+  m_wakeWorkers.notify_all ();
+  for (auto & thread : m_threads)
+    {
+      thread.join ();
+    }
+}
+
+void
+NrSchedulingWorkerPool::SetNumWorkers (uint32_t numWorkers)
+{
+  NS_LOG_FUNCTION (this << numWorkers);
+  m_numWorkers = std::max (m_numWorkers, numWorkers);
+}
+
+uint32_t
+NrSchedulingWorkerPool::GetNumWorkers () const
+{
+  return m_numWorkers;
+}
+
+void
+NrSchedulingWorkerPool::AddSlot (std::vector<std::function<void ()>> indications,
+                                 std::function<void ()> startSlot)
+{
+  NS_LOG_FUNCTION (this << indications.size ());
+
+  Slot slot;
+  slot.m_context = Simulator::GetContext ();
+  slot.m_indications = std::move (indications);
+  slot.m_startSlot = std::move (startSlot);
+  m_pendingSlots.emplace_back (std::move (slot));
+
+  // All the PHYs that start a slot at this time do it before StartBatch,
+  // that is the last event of this time in the queue. If a batch is
+  // running, the slot goes in the next one.
+  if (!m_batchScheduled)
+    {
+      m_batchScheduled = true;
+      Simulator::ScheduleNow (&NrSchedulingWorkerPool::StartBatch, this);
+    }
+}
+
+bool
+NrSchedulingWorkerPool::IsCollecting () const
+{
+  return m_collecting;
+}
+
+void
+NrSchedulingWorkerPool::AddTask (std::function<void ()> schedule, std::function<void ()> commit)
+{
+  NS_ASSERT_MSG (m_collecting, "A scheduler call can be registered only during a MAC indication");
+
+  Task task;
+  task.m_context = Simulator::GetContext ();
+  task.m_schedule = std::move (schedule);
+  task.m_commit = std::move (commit);
+  m_tasks.emplace_back (std::move (task));
+}
+
+void
+NrSchedulingWorkerPool::StartBatch ()
+{
+  NS_LOG_FUNCTION (this << m_pendingSlots.size ());
+  NS_ASSERT (m_slots.empty ());
+
+  std::swap (m_slots, m_pendingSlots);
+  m_startSlots.clear ();
+  m_round = 0;
+  StartRound ();
+}
+
+void
+NrSchedulingWorkerPool::StartRound ()
+{
+  NS_LOG_FUNCTION (this << m_round);
+
+  m_tasks.clear ();
+
+  bool lastRound = true;
+  for (size_t i = 0; i < m_slots.size (); ++i)
+    {
+      if (m_round < m_slots.at (i).m_indications.size ())
+        {
+          lastRound = false;
+          Simulator::ScheduleWithContext (m_slots.at (i).m_context, Seconds (0),
+                                          &NrSchedulingWorkerPool::CallIndication, this, i);
+        }
+    }
+
+  if (lastRound)
+    {
+      for (auto & slot : m_slots)
+        {
+          if (slot.m_startSlot)
+            {
+              Simulator::ScheduleWithContext (slot.m_context, Seconds (0),
+                                              &NrSchedulingWorkerPool::CallStartSlot, this,
+                                              m_startSlots.size ());
+              m_startSlots.emplace_back (std::move (slot.m_startSlot));
+            }
+        }
+      m_slots.clear ();
+      m_batchScheduled = false;
+      if (!m_pendingSlots.empty ())
+        {
+          m_batchScheduled = true;
+          Simulator::ScheduleNow (&NrSchedulingWorkerPool::StartBatch, this);
+        }
+      return;
+    }
+
+  // Events of the same time are run in the order they are scheduled: the
+  // round is run after all its indications
+  Simulator::ScheduleNow (&NrSchedulingWorkerPool::RunRound, this);
+}
+
+void
+NrSchedulingWorkerPool::CallIndication (size_t slot)
+{
+  NS_LOG_FUNCTION (this << slot << m_round);
+
+  m_collecting = true;
+  m_slots.at (slot).m_indications.at (m_round) ();
+  m_collecting = false;
+}
+
+void
+NrSchedulingWorkerPool::CallStartSlot (size_t slot)
+{
+  NS_LOG_FUNCTION (this << slot);
+  m_startSlots.at (slot) ();
+}
+
+void
+NrSchedulingWorkerPool::RunRound ()
+{
+  NS_LOG_FUNCTION (this << m_round << m_tasks.size ());
+
+  RunTasks ();
+
+  for (size_t i = 0; i < m_tasks.size (); ++i)
+    {
+      Simulator::ScheduleWithContext (m_tasks.at (i).m_context, Seconds (0),
+                                      &NrSchedulingWorkerPool::CallCommit, this, i);
+    }
+  ++m_round;
+  Simulator::ScheduleNow (&NrSchedulingWorkerPool::StartRound, this);
+}
+
+void
+NrSchedulingWorkerPool::CallCommit (size_t task)
+{
+  NS_LOG_FUNCTION (this << task);
+  m_tasks.at (task).m_commit ();
+}
+
+void
+NrSchedulingWorkerPool::RunTasks ()
+{
+  if (m_numWorkers <= 1 || m_tasks.size () < 2)
+    {
+      for (auto & task : m_tasks)
+        {
+          task.m_schedule ();
+        }
+      return;
+    }
+
+  while (m_threads.size () + 1 < m_numWorkers)
+    {
+      m_threads.emplace_back (&NrSchedulingWorkerPool::WorkerLoop, this, m_generation);
+    }
+
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_nextTask = 0;
+    m_idleWorkers = 0;
+    ++m_generation;
+  }
+  m_wakeWorkers.notify_all ();
+
+  RunPendingTasks ();
+
+  // Wait for all the threads, and not only for all the tasks, so that no
+  // thread is looking at m_tasks when the next round fills it
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_workersIdle.wait (lock, [this] { return m_idleWorkers == m_threads.size (); });
+}
+
+void
+NrSchedulingWorkerPool::RunPendingTasks ()
+{
+  for (size_t i = m_nextTask++; i < m_tasks.size (); i = m_nextTask++)
+    {
+      m_tasks[i].m_schedule ();
+    }
+}
+
+void
+NrSchedulingWorkerPool::WorkerLoop (uint64_t generation)
+{
+  while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lock (m_mutex);
+        m_wakeWorkers.wait (lock, [this, generation] { return m_stop || m_generation != generation; });
+        if (m_stop)
+          {
+            return;
+          }
+        generation = m_generation;
+      }
+
+      RunPendingTasks ();
+
+      {
+        std::lock_guard<std::mutex> lock (m_mutex);
+        ++m_idleWorkers;
+      }
+      m_workersIdle.notify_one ();
+    }
+}
+
+} // namespace ns3
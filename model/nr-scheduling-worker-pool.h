@@ -0,0 +1,207 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_SCHEDULING_WORKER_POOL_H
+#define NR_SCHEDULING_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup gnb-mac
+ * \brief Runs the schedulers of the gNB PHYs that start a slot at the same time on worker threads
+ *
+ * A gNB PHY with the attribute NrGnbPhy::NumSchedulingWorkers greater than
+ * 1 does not call its MAC at the beginning of the slot, but registers the
+ * slot with AddSlot: the list of the MAC indications (UL and DL) of the
+ * slot, and what the PHY has to do after them (the start of the slot).
+ *
+ * All the slots registered at the same simulation time are processed in
+ * rounds: in round i, the i-th indication of every PHY is called, in the
+ * order of registration and with the PHY context. The MAC does everything
+ * that touches the rest of the simulation, and then, instead of calling the
+ * scheduler, it registers with AddTask the scheduler call and the "commit"
+ * of its result. The scheduler calls of the round are then run in
+ * parallel on the worker threads; when all of them are finished, the
+ * commits are done in the order of registration, with the MAC context.
+ * After the last round, every PHY starts its slot.
+ *
+ * The scheduler of a cell only accesses its own state, so that its
+ * decisions do not depend on the number of workers, nor on the order in
+ * which the threads run. With respect to the serial execution, the calls
+ * of a cell happen in the same order; what changes is the order between
+ * the calls of different cells at the same simulation time, and the fact
+ * that events of the same time that are after the starting of the slot in
+ * the event queue (e.g., the reception of CTRL messages) are processed
+ * before the MAC indications, instead of after.
+ *
+ * The scheduler must not touch other simulation objects than its own
+ * (no Simulator::Schedule, no random variables shared with other cells,
+ * no trace sinks that write shared data) while it runs on a worker thread;
+ * logging is allowed, but the lines of different workers are interleaved.
+ */
+class NrSchedulingWorkerPool
+{
+public:
+  /**
+   * \return the pool shared by all the gNB PHYs
+   */
+  static NrSchedulingWorkerPool & Get ();
+
+  /**
+   * \brief Destructor: stop and join the worker threads
+   */
+  ~NrSchedulingWorkerPool ();
+
+  /**
+   * \brief Set the number of threads that run the schedulers
+   *
+   * The number is only increased: the pool uses the highest value asked by
+   * any of the PHYs. The simulation thread is one of the workers.
+   *
+   * \param numWorkers the number of workers
+   */
+  void SetNumWorkers (uint32_t numWorkers);
+
+  /**
+   * \return the number of threads that run the schedulers
+   */
+  uint32_t GetNumWorkers () const;
+
+  /**
+   * \brief Register the MAC indications of a slot of a PHY
+   * \param indications the MAC indications, to be called one per round
+   * \param startSlot what to do after the last round (may be empty)
+   */
+  void AddSlot (std::vector<std::function<void ()>> indications,
+                std::function<void ()> startSlot);
+
+  /**
+   * \return true if a MAC indication is being called by the pool, and then
+   * the MAC should register the scheduler call with AddTask
+   */
+  bool IsCollecting () const;
+
+  /**
+   * \brief Register a scheduler call, during a MAC indication
+   * \param schedule the scheduler call, run on a worker thread
+   * \param commit what to do with the result, run on the simulation thread
+   */
+  void AddTask (std::function<void ()> schedule, std::function<void ()> commit);
+
+private:
+  NrSchedulingWorkerPool () = default;
+
+  /**
+   * \brief A slot of a PHY
+   */
+  struct Slot
+  {
+    uint32_t m_context {0};                         //!< The context of the PHY
+    std::vector<std::function<void ()>> m_indications; //!< The MAC indications
+    std::function<void ()> m_startSlot;             //!< The start of the slot
+  };
+
+  /**
+   * \brief A scheduler call
+   */
+  struct Task
+  {
+    uint32_t m_context {0};           //!< The context of the MAC
+    std::function<void ()> m_schedule; //!< The scheduler call
+    std::function<void ()> m_commit;   //!< The commit of the result
+  };
+
+  /**
+   * \brief Start the processing of the slots registered at this time
+   */
+  void StartBatch ();
+
+  /**
+   * \brief Call the MAC indications of the current round
+   */
+  void StartRound ();
+
+  /**
+   * \brief Call a MAC indication of the current round
+   * \param slot the index of the slot
+   */
+  void CallIndication (size_t slot);
+
+  /**
+   * \brief Start the slot of a PHY, after the last round
+   * \param slot the index of the slot in m_startSlots
+   */
+  void CallStartSlot (size_t slot);
+
+  /**
+   * \brief Run the scheduler calls of the round, and schedule the commits
+   */
+  void RunRound ();
+
+  /**
+   * \brief Call a commit of the current round
+   * \param task the index of the task
+   */
+  void CallCommit (size_t task);
+
+  /**
+   * \brief Run the scheduler calls on the worker threads
+   */
+  void RunTasks ();
+
+  /**
+   * \brief Run the scheduler calls that were not taken yet by a worker
+   */
+  void RunPendingTasks ();
+
+  /**
+   * \brief The loop of a worker thread
+   * \param generation the last round already run when the thread is created
+   */
+  void WorkerLoop (uint64_t generation);
+
+  uint32_t m_numWorkers {1};        //!< Number of workers, including the simulation thread
+  bool m_batchScheduled {false};     //!< True if StartBatch is scheduled, or a batch is running
+  bool m_collecting {false};         //!< True while a MAC indication is called
+  size_t m_round {0};                //!< Current round
+  std::vector<Slot> m_pendingSlots;  //!< Slots registered for the next batch
+  std::vector<Slot> m_slots;         //!< Slots of the current batch
+  std::vector<Task> m_tasks;         //!< Scheduler calls of the current round
+  std::vector<std::function<void ()>> m_startSlots; //!< Starts of the slots of the last batch
+
+  std::vector<std::thread> m_threads;    //!< The worker threads
+  std::mutex m_mutex;                     //!< Protects the following members
+  std::condition_variable m_wakeWorkers;  //!< Signals a new round to the workers
+  std::condition_variable m_workersIdle;  //!< Signals the end of a round to the simulation thread
+  uint64_t m_generation {0};             //!< Counter of the rounds run on the workers
+  uint32_t m_idleWorkers {0};            //!< Threads that finished the current round
+  bool m_stop {false};                   //!< True to stop the workers
+  std::atomic<size_t> m_nextTask {0};    //!< Index of the next scheduler call to take
+};
+
+} // namespace ns3
+
+#endif // NR_SCHEDULING_WORKER_POOL_H
@@ -0,0 +1,217 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-slot-alloc-store.h"
+
+#include <ns3/abort.h>
+#include <ns3/log.h>
+
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrSlotAllocStore");
+
+NrSlotAllocStore::NrSlotAllocStore (size_t window)
+  : m_slots (window, SlotAllocInfo (SfnSf ())),
+  m_used (window, false)
+{
+  NS_ABORT_MSG_IF (window == 0, "The window must have at least one slot");
+}
+
+size_t
+NrSlotAllocStore::GetIndex (const SfnSf &sfnSf) const
+{
+  return sfnSf.Normalize () % m_slots.size ();
+}
+
+void
+NrSlotAllocStore::Insert (const SlotAllocInfo &slotAllocInfo)
+{
+  NS_LOG_FUNCTION (this << slotAllocInfo.m_sfnSf);
+
+  size_t index = GetIndex (slotAllocInfo.m_sfnSf);
+  while (m_used[index] && !(m_slots[index].m_sfnSf == slotAllocInfo.m_sfnSf))
+    {
+      Grow ();
+      index = GetIndex (slotAllocInfo.m_sfnSf);
+    }
+
+  if (m_used[index])
+    {
+      NS_LOG_INFO ("Merging inside existing allocation");
+      m_slots[index].Merge (slotAllocInfo);
+    }
+  else
+    {
+      m_slots[index] = slotAllocInfo;
+      m_used[index] = true;
+      ++m_size;
+    }
+}
+
+bool
+NrSlotAllocStore::Exists (const SfnSf &sfnSf) const
+{
+  size_t index = GetIndex (sfnSf);
+  return m_used[index] && m_slots[index].m_sfnSf == sfnSf;
+}
+
+SlotAllocInfo &
+NrSlotAllocStore::Peek (const SfnSf &sfnSf)
+{
+  NS_ABORT_MSG_UNLESS (Exists (sfnSf), "Didn't found the slot " << sfnSf);
+  return m_slots[GetIndex (sfnSf)];
+}
+
+SlotAllocInfo
+NrSlotAllocStore::Retrieve (const SfnSf &sfnSf)
+{
+  NS_LOG_FUNCTION (this << sfnSf);
+  SlotAllocInfo &slot = Peek (sfnSf);
+  SlotAllocInfo ret = std::move (slot);
+  slot.m_varTtiAllocInfo.clear ();
+  m_used[GetIndex (sfnSf)] = false;
+  --m_size;
+  return ret;
+}
+
+SlotAllocInfo
+NrSlotAllocStore::RetrieveFirst ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_size == 0, "No allocation stored");
+  return Retrieve (m_slots[GetSortedIndices ().front ()].m_sfnSf);
+}
+
+std::vector<SlotAllocInfo>
+NrSlotAllocStore::RetrieveAll ()
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<SlotAllocInfo> ret;
+  ret.reserve (m_size);
+  for (size_t index : GetSortedIndices ())
+    {
+      ret.emplace_back (std::move (m_slots[index]));
+      m_slots[index].m_varTtiAllocInfo.clear ();
+      m_used[index] = false;
+    }
+  m_size = 0;
+  return ret;
+}
+
+void
+NrSlotAllocStore::DiscardBefore (const SfnSf &sfnSf)
+{
+  NS_LOG_FUNCTION (this << sfnSf);
+  for (size_t i = 0; i < m_slots.size () && m_size > 0; ++i)
+    {
+      if (m_used[i] && m_slots[i].m_sfnSf < sfnSf)
+        {
+          NS_LOG_INFO ("Discard the allocation of the skipped slot " << m_slots[i].m_sfnSf);
+          m_slots[i].m_varTtiAllocInfo.clear ();
+          m_used[i] = false;
+          --m_size;
+        }
+    }
+}
+
+void
+NrSlotAllocStore::Clear ()
+{
+  NS_LOG_FUNCTION (this);
+  for (size_t i = 0; i < m_slots.size (); ++i)
+    {
+      m_slots[i].m_varTtiAllocInfo.clear ();
+      m_used[i] = false;
+    }
+  m_size = 0;
+}
+
+size_t
+NrSlotAllocStore::Size () const
+{
+  return m_size;
+}
+
+bool
+NrSlotAllocStore::Empty () const
+{
+  return m_size == 0;
+}
+
+void
+NrSlotAllocStore::Print (std::ostream &os) const
+{
+  for (size_t index : GetSortedIndices ())
+    {
+      os << m_slots[index];
+    }
+}
+
+void
+NrSlotAllocStore::Grow ()
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<SlotAllocInfo> slots = RetrieveAll ();
+  size_t window = m_slots.size ();
+  bool collision = true;
+  while (collision)
+    {
+      window *= 2;
+      std::vector<bool> used (window, false);
+      collision = false;
+      for (const auto & slot : slots)
+        {
+          size_t index = slot.m_sfnSf.Normalize () % window;
+          collision = collision || used[index];
+          used[index] = true;
+        }
+    }
+
+  NS_LOG_INFO ("Grow the ring to " << window << " slots");
+  m_slots.resize (window, SlotAllocInfo (SfnSf ()));
+  m_used.assign (window, false);
+  for (auto & slot : slots)
+    {
+      size_t index = GetIndex (slot.m_sfnSf);
+      m_slots[index] = std::move (slot);
+      m_used[index] = true;
+      ++m_size;
+    }
+}
+
+std::vector<size_t>
+NrSlotAllocStore::GetSortedIndices () const
+{
+  std::vector<size_t> indices;
+  indices.reserve (m_size);
+  for (size_t i = 0; i < m_slots.size () && indices.size () < m_size; ++i)
+    {
+      if (m_used[i])
+        {
+          indices.push_back (i);
+        }
+    }
+  std::sort (indices.begin (), indices.end (),
+             [this] (size_t a, size_t b) { return m_slots[a].m_sfnSf < m_slots[b].m_sfnSf; });
+  return indices;
+}
+
+} // namespace ns3
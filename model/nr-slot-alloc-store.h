@@ -0,0 +1,160 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_SLOT_ALLOC_STORE_H
+#define NR_SLOT_ALLOC_STORE_H
+
+#include "nr-phy-mac-common.h"
+
+#include <ostream>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup utils
+ * \brief The allocations of the next slots of a PHY, indexed by slot
+ *
+ * The allocations are stored in a ring of records, at the index
+ * SfnSf::Normalize () modulo the size of the ring. As the allocations are
+ * made at most K0/K2 (plus the L1L2 latency) slots ahead, the ring is
+ * small: inserting, finding and removing the allocation of a slot are
+ * constant time, and the records are reused instead of allocating a list
+ * node per slot. If two stored slots fall at the same index, the ring
+ * doubles its size.
+ *
+ * All the SfnSf stored must have the same numerology.
+ */
+class NrSlotAllocStore
+{
+public:
+  /**
+   * \brief Constructor
+   * \param window the initial number of records of the ring
+   */
+  NrSlotAllocStore (size_t window = 16);
+
+  /**
+   * \brief Store an allocation, merging it with the allocation of the same
+   * slot, if any
+   * \param slotAllocInfo the allocation
+   */
+  void Insert (const SlotAllocInfo &slotAllocInfo);
+
+  /**
+   * \param sfnSf the slot
+   * \return true if an allocation for the slot is stored
+   */
+  bool Exists (const SfnSf &sfnSf) const;
+
+  /**
+   * \brief Get the allocation of a slot, that must exist
+   * \param sfnSf the slot
+   * \return a reference to the allocation
+   */
+  SlotAllocInfo & Peek (const SfnSf &sfnSf);
+
+  /**
+   * \brief Remove and return the allocation of a slot, that must exist
+   * \param sfnSf the slot
+   * \return the allocation
+   */
+  SlotAllocInfo Retrieve (const SfnSf &sfnSf);
+
+  /**
+   * \brief Remove and return the allocation of the first slot stored
+   * \return the allocation
+   */
+  SlotAllocInfo RetrieveFirst ();
+
+  /**
+   * \brief Remove and return all the allocations, in slot order
+   * \return the allocations
+   */
+  std::vector<SlotAllocInfo> RetrieveAll ();
+
+  /**
+   * \brief Remove the allocations of the slots before a slot
+   * \param sfnSf the first slot to keep
+   */
+  void DiscardBefore (const SfnSf &sfnSf);
+
+  /**
+   * \brief Remove all the allocations
+   */
+  void Clear ();
+
+  /**
+   * \return the number of allocations stored
+   */
+  size_t Size () const;
+
+  /**
+   * \return true if no allocation is stored
+   */
+  bool Empty () const;
+
+  /**
+   * \brief Check if a stored allocation satisfies a predicate
+   * \param pred the predicate, called with a const SlotAllocInfo &
+   * \return true if pred returns true for an allocation, in any order
+   */
+  template <class Pred>
+  bool AnyOf (Pred pred) const
+  {
+    for (size_t i = 0; i < m_slots.size () && m_size > 0; ++i)
+      {
+        if (m_used[i] && pred (m_slots[i]))
+          {
+            return true;
+          }
+      }
+    return false;
+  }
+
+  /**
+   * \brief Print the allocations, in slot order
+   * \param os the output stream
+   */
+  void Print (std::ostream &os) const;
+
+private:
+  /**
+   * \param sfnSf the slot
+   * \return the index of the record of the slot
+   */
+  size_t GetIndex (const SfnSf &sfnSf) const;
+
+  /**
+   * \brief Double the ring, until no two stored slots fall at the same index
+   */
+  void Grow ();
+
+  /**
+   * \return the indices of the stored allocations, in slot order
+   */
+  std::vector<size_t> GetSortedIndices () const;
+
+  std::vector<SlotAllocInfo> m_slots; //!< The records of the ring
+  std::vector<bool> m_used;           //!< Whether each record holds an allocation
+  size_t m_size {0};                  //!< The number of allocations stored
+};
+
+} // namespace ns3
+
+#endif // NR_SLOT_ALLOC_STORE_H
@@ -0,0 +1,109 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-slot-timing-engine.h"
+
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrSlotTimingEngine");
+NS_OBJECT_ENSURE_REGISTERED (NrSlotTimingEngine);
+
+TypeId
+NrSlotTimingEngine::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::NrSlotTimingEngine")
+    .SetParent<Object> ()
+    .SetGroupName ("nr")
+    .AddConstructor<NrSlotTimingEngine> ()
+  ;
+  return tid;
+}
+
+NrSlotTimingEngine::NrSlotTimingEngine ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrSlotTimingEngine::~NrSlotTimingEngine ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrSlotTimingEngine::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_batches.clear ();
+  Object::DoDispose ();
+}
+
+void
+NrSlotTimingEngine::Schedule (const Time &delay, const std::function<void ()> &fn)
+{
+  NS_LOG_FUNCTION (this << delay);
+
+  int64_t ts = (Simulator::Now () + delay).GetTimeStep ();
+  auto it = m_batches.find (ts);
+  if (it == m_batches.end ())
+    {
+      // First function for this instant: it gets the event
+      it = m_batches.emplace (ts, std::vector<std::function<void ()> > ()).first;
+      Simulator::Schedule (delay, &NrSlotTimingEngine::RunBatch, this, ts);
+      ++m_numEvents;
+    }
+  it->second.push_back (fn);
+}
+
+void
+NrSlotTimingEngine::RunBatch (int64_t ts)
+{
+  NS_LOG_FUNCTION (this << ts);
+
+  auto it = m_batches.find (ts);
+  NS_ASSERT (it != m_batches.end ());
+
+  // The functions may schedule other functions for this same instant: they
+  // go in a new batch, with its own event
+  std::vector<std::function<void ()> > batch = std::move (it->second);
+  m_batches.erase (it);
+
+  NS_LOG_INFO ("Running " << batch.size () << " slot boundaries");
+  for (const auto &fn : batch)
+    {
+      fn ();
+    }
+  m_numRuns += batch.size ();
+}
+
+uint64_t
+NrSlotTimingEngine::GetNumEvents () const
+{
+  return m_numEvents;
+}
+
+uint64_t
+NrSlotTimingEngine::GetNumRuns () const
+{
+  return m_numRuns;
+}
+
+} // namespace ns3
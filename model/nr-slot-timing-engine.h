@@ -0,0 +1,107 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_SLOT_TIMING_ENGINE_H
+#define NR_SLOT_TIMING_ENGINE_H
+
+#include <ns3/object.h>
+#include <ns3/nstime.h>
+
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup gnb-phy
+ * \brief Common clock for the slot boundaries of the BWPs of a gNB
+ *
+ * Each NrGnbPhy runs its own chain of EndSlot / StartSlot events, with the
+ * period of its numerology. All the chains start at the same instant, so the
+ * slot boundaries of the BWPs are aligned every lowest-common-multiple of
+ * the slot periods (e.g., every slot of numerology 0 is also the boundary
+ * of 8 slots of numerology 3).
+ *
+ * When the PHYs of a gNB share an NrSlotTimingEngine, they schedule the
+ * slot boundaries through it: all the boundaries that fall at the same
+ * instant are run, in the order of their request, by a single simulator
+ * event. The number of events at the aligned boundaries is then one per
+ * instant, instead of one per BWP.
+ *
+ * The engine is installed by NrHelper, if the attribute AlignBwpSlots is
+ * true. Please note that, as the boundaries of the BWPs are run together,
+ * other events scheduled for the same instant may run before or after all
+ * of them, instead of in between.
+ */
+class NrSlotTimingEngine : public Object
+{
+public:
+  /**
+   * \brief Get the type id
+   * \return the type id of the class
+   */
+  static TypeId GetTypeId ();
+
+  /**
+   * \brief NrSlotTimingEngine constructor
+   */
+  NrSlotTimingEngine ();
+  /**
+   * \brief ~NrSlotTimingEngine
+   */
+  virtual ~NrSlotTimingEngine () override;
+
+  /**
+   * \brief Run a function after a delay, together with the other functions
+   * scheduled for the same instant
+   * \param delay the delay
+   * \param fn the function
+   */
+  void Schedule (const Time &delay, const std::function<void ()> &fn);
+
+  /**
+   * \brief Get the number of simulator events used so far
+   * \return the number of events scheduled by the engine
+   */
+  uint64_t GetNumEvents () const;
+
+  /**
+   * \brief Get the number of functions run so far
+   * \return the number of functions scheduled through the engine and run
+   */
+  uint64_t GetNumRuns () const;
+
+protected:
+  virtual void DoDispose () override;
+
+private:
+  /**
+   * \brief Run all the functions scheduled for an instant
+   * \param ts the instant, in time steps
+   */
+  void RunBatch (int64_t ts);
+
+  std::map<int64_t, std::vector<std::function<void ()> > > m_batches; //!< Functions to run, per instant
+  uint64_t m_numEvents {0}; //!< Simulator events scheduled
+  uint64_t m_numRuns {0};   //!< Functions run
+};
+
+} // namespace ns3
+
+#endif // NR_SLOT_TIMING_ENGINE_H
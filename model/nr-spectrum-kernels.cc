@@ -0,0 +1,84 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-spectrum-kernels.h"
+#include <algorithm>
+#include <limits>
+
+/**
+ * \brief Build a kernel for AVX2 and for the baseline, chosen at run time
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define NR_KERNEL_CLONES __attribute__ ((target_clones ("avx2", "default")))
+#else
+#define NR_KERNEL_CLONES
+#endif
+
+namespace ns3 {
+
+NR_KERNEL_CLONES
+void
+NrSinrKernel (const double *signal, const double *all, const double *noise,
+              double *sinr, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+    {
+      sinr[i] = signal[i] / (all[i] - signal[i] + noise[i]);
+    }
+}
+
+NR_KERNEL_CLONES
+void
+NrScaledAddKernel (double *sum, const double *x, double scale, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+    {
+      sum[i] += x[i] * scale;
+    }
+}
+
+NR_KERNEL_CLONES
+double
+NrMeanRatioKernel (const double *x, const double *y, size_t n)
+{
+  double sum = 0.0;
+  for (size_t i = 0; i < n; ++i)
+    {
+      sum += x[i] / y[i];
+    }
+  return sum / n;
+}
+
+NR_KERNEL_CLONES
+void
+NrMeanMinOnRbsKernel (const double *x, const int *rbs, size_t n, double *mean, double *min)
+{
+  double sum = 0.0;
+  double minimum = std::numeric_limits<double>::max ();
+  for (size_t i = 0; i < n; ++i)
+    {
+      const double v = x[rbs[i]];
+      sum += v;
+      minimum = std::min (minimum, v);
+    }
+  *mean = sum / n;
+  *min = minimum;
+}
+
+} // namespace ns3
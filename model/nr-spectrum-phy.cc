@@ -20,14 +20,22 @@
 #include "nr-spectrum-phy.h"
 #include <ns3/boolean.h>
 #include <ns3/double.h>
+#include <ns3/enum.h>
 #include <ns3/lte-radio-bearer-tag.h>
 #include <ns3/trace-source-accessor.h>
+#include <ns3/uinteger.h>
 #include "nr-gnb-net-device.h"
 #include "nr-gnb-phy.h"
 #include "nr-ue-phy.h"
 #include "nr-ue-net-device.h"
 #include "nr-lte-mi-error-model.h"
+#include "nr-perf-profiler.h"
+#include "nr-counters.h"
+#include "nr-rx-worker-pool.h"
+#include "nr-spectrum-kernels.h"
 #include "ns3/uniform-planar-array.h"
+#include <algorithm>
+#include <initializer_list>
 
 
 namespace ns3 {
@@ -110,8 +118,11 @@ NrSpectrumPhy::DoDispose ()
 
   m_interferenceData = nullptr;
   m_interferenceCtrl = nullptr;
+  m_sinrPerRb = nullptr;
   m_mobility = nullptr;
   m_phy = nullptr;
+  m_freeTbs.clear ();
+  m_txPacketsByRnti.clear ();
 
 
   m_phyRxDataEndOkCallback = MakeNullCallback< void, const Ptr<Packet> &> ();
@@ -144,6 +155,46 @@ NrSpectrumPhy::GetTypeId (void)
                     BooleanValue (false),
                     MakeBooleanAccessor (&NrSpectrumPhy::SetUnlicensedMode),
                     MakeBooleanChecker ())
+    .AddAttribute ("InterferenceFilter",
+                   "Drop the signals of the other cells whose received power over the band is"
+                   " below InterferenceFilterThreshold, instead of adding them to the interference."
+                   " Not applied in the unlicensed mode.",
+                    BooleanValue (false),
+                    MakeBooleanAccessor (&NrSpectrumPhy::SetInterferenceFilter),
+                    MakeBooleanChecker ())
+    .AddAttribute ("InterferenceFilterThreshold",
+                   "The threshold (dB, relative to the noise power over the band) below which"
+                   " the interference filter drops a signal of another cell",
+                    DoubleValue (-20.0),
+                    MakeDoubleAccessor (&NrSpectrumPhy::SetInterferenceFilterThreshold,
+                                        &NrSpectrumPhy::GetInterferenceFilterThreshold),
+                    MakeDoubleChecker<double> ())
+    .AddAttribute ("SinrOnExpectedRbs",
+                   "Evaluate the SINR of the DATA only on the RBs of the expected TBs."
+                   " The SINR of the other RBs is reported as 0, which affects the wideband"
+                   " CQI computed from the DATA SINR (e.g., the UE DL CQI).",
+                    BooleanValue (false),
+                    MakeBooleanAccessor (&NrSpectrumPhy::SetSinrOnExpectedRbs),
+                    MakeBooleanChecker ())
+    .AddAttribute ("AverageDataInterference",
+                   "Evaluate the SINR of the DATA once per reception, with the interference"
+                   " averaged over the reception, instead of at each change of the"
+                   " interference. The SINR is exact when the interference is constant"
+                   " over the reception, and otherwise underestimated (see"
+                   " NrInterference::SetAverageInterference for the bound).",
+                    BooleanValue (false),
+                    MakeBooleanAccessor (&NrSpectrumPhy::SetAverageDataInterference),
+                    MakeBooleanChecker ())
+    .AddAttribute ("RxPacketTraceCqi",
+                   "How the CQI of the RxPacketTraceUe trace is computed, only when the"
+                   " trace has sinks: the wideband CQI of the AMC (once per reception),"
+                   " the Shannon CQI of the average SINR of the TB (cheaper), or none (255)",
+                    EnumValue (NrSpectrumPhy::TRACE_CQI_AMC),
+                    MakeEnumAccessor (&NrSpectrumPhy::SetTraceCqiMode,
+                                      &NrSpectrumPhy::GetTraceCqiMode),
+                    MakeEnumChecker (NrSpectrumPhy::TRACE_CQI_AMC, "Amc",
+                                     NrSpectrumPhy::TRACE_CQI_SHANNON, "Shannon",
+                                     NrSpectrumPhy::TRACE_CQI_NONE, "None"))
     .AddAttribute ("CcaMode1Threshold",
                    "The energy of a received signal should be higher than "
                    "this threshold (dbm) to allow the PHY layer to declare CCA BUSY state.",
@@ -157,6 +208,16 @@ NrSpectrumPhy::GetTypeId (void)
                    DoubleValue (0.0),
                    MakeDoubleAccessor (&NrSpectrumPhy::SetInterStreamInterferenceRatio),
                    MakeDoubleChecker <double> (0.0, 1.0))
+    .AddAttribute ("NumRxWorkers",
+                   "Number of threads that decode the DATA receptions of all the spectrum "
+                   "phys that end at the same time (SINR statistics and error model). "
+                   "With 1, each reception is decoded and delivered in its EndRxData, in "
+                   "the simulation thread. The highest value of all the spectrum phys is "
+                   "used by all the spectrum phys with a value greater than 1.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&NrSpectrumPhy::SetNumRxWorkers,
+                                         &NrSpectrumPhy::GetNumRxWorkers),
+                   MakeUintegerChecker<uint32_t> (1))
 
     .AddTraceSource ("RxPacketTraceEnb",
                      "The no. of packets received and transmitted by the Base Station",
@@ -320,6 +381,73 @@ NrSpectrumPhy::SetUnlicensedMode (bool unlicensedMode)
   m_unlicensedMode = unlicensedMode;
 }
 
+void
+NrSpectrumPhy::SetInterferenceFilter (bool interferenceFilter)
+{
+  NS_LOG_FUNCTION (this << interferenceFilter);
+  m_interferenceFilter = interferenceFilter;
+}
+
+void
+NrSpectrumPhy::SetInterferenceFilterThreshold (double thresholdDb)
+{
+  NS_LOG_FUNCTION (this << thresholdDb);
+  m_interferenceFilterRatio = std::pow (10.0, thresholdDb / 10.0);
+}
+
+double
+NrSpectrumPhy::GetInterferenceFilterThreshold () const
+{
+  return 10.0 * std::log10 (m_interferenceFilterRatio);
+}
+
+void
+NrSpectrumPhy::SetSinrOnExpectedRbs (bool sinrOnExpectedRbs)
+{
+  NS_LOG_FUNCTION (this << sinrOnExpectedRbs);
+  m_sinrOnExpectedRbs = sinrOnExpectedRbs;
+  if (!m_sinrOnExpectedRbs)
+    {
+      m_expectedRbs.clear ();
+      m_interferenceData->SetEvaluatedRbs (m_expectedRbs);
+    }
+}
+
+void
+NrSpectrumPhy::SetAverageDataInterference (bool average)
+{
+  NS_LOG_FUNCTION (this << average);
+  m_interferenceData->SetAverageInterference (average);
+}
+
+void
+NrSpectrumPhy::SetTraceCqiMode (TraceCqiMode mode)
+{
+  NS_LOG_FUNCTION (this << mode);
+  m_traceCqiMode = mode;
+}
+
+NrSpectrumPhy::TraceCqiMode
+NrSpectrumPhy::GetTraceCqiMode () const
+{
+  return m_traceCqiMode;
+}
+
+void
+NrSpectrumPhy::SetNumRxWorkers (uint32_t numWorkers)
+{
+  NS_LOG_FUNCTION (this << numWorkers);
+  NS_ABORT_MSG_IF (numWorkers == 0, "At least one worker is needed");
+  m_numRxWorkers = numWorkers;
+  NrRxWorkerPool::Get ().SetNumWorkers (numWorkers);
+}
+
+uint32_t
+NrSpectrumPhy::GetNumRxWorkers () const
+{
+  return m_numRxWorkers;
+}
+
 void
 NrSpectrumPhy::SetDataErrorModelEnabled (bool dataErrorModelEnabled)
 {
@@ -340,8 +468,12 @@ NrSpectrumPhy::SetNoisePowerSpectralDensity (const Ptr<const SpectrumValue>& noi
   NS_LOG_FUNCTION (this << noisePsd);
   NS_ASSERT (noisePsd);
   m_rxSpectrumModel = noisePsd->GetSpectrumModel ();
+  m_noisePower = Integral (*noisePsd);
   m_interferenceData->SetNoisePowerSpectralDensity (noisePsd);
-  m_interferenceCtrl->SetNoisePowerSpectralDensity (noisePsd);
+  if (m_interferenceCtrl)
+    {
+      m_interferenceCtrl->SetNoisePowerSpectralDensity (noisePsd);
+    }
   if (m_interferenceSrs)
     {
       m_interferenceSrs->SetNoisePowerSpectralDensity (noisePsd);
@@ -358,6 +490,12 @@ void
 NrSpectrumPhy::StartRx (Ptr<SpectrumSignalParameters> params)
 {
   NS_LOG_FUNCTION (this);
+  if (!m_rxEnabled)
+    {
+      return;
+    }
+  NrCounters::Context counters (this, NrCounters::SPECTRUM_PHY_EVENTS);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::SPECTRUM);
   Ptr <const SpectrumValue> rxPsd = params->psd;
   Time duration = params->duration;
   NS_LOG_INFO ("Start receiving signal: " << rxPsd <<" duration= " << duration);
@@ -371,30 +509,59 @@ NrSpectrumPhy::StartRx (Ptr<SpectrumSignalParameters> params)
   Ptr<NrSpectrumSignalParametersUlCtrlFrame> ulCtrlRxParams =
     DynamicCast<NrSpectrumSignalParametersUlCtrlFrame> (params);
 
-  if (nrDataRxParams)
+  // Classify the signal once: NR signal of this cell, and of this stream
+  uint16_t txCellId = UINT16_MAX;
+  if (nrDataRxParams != nullptr)
     {
-      if (nrDataRxParams->cellId == GetCellId ()
-          && nrDataRxParams->txPhy->GetObject<NrSpectrumPhy> ()->GetStreamId () != m_streamId)
-        {
-          NS_LOG_INFO ("Inter stream interference DATA signal. Interference Ratio " << m_interStrInerfRatio);
-          (*params->psd) *= m_interStrInerfRatio;
-          Ptr <const SpectrumValue> rxPsdData = params->psd;
-          m_interferenceData->AddSignal (rxPsdData, duration);
-          return;
-        }
+      txCellId = nrDataRxParams->cellId;
+    }
+  else if (dlCtrlRxParams != nullptr)
+    {
+      txCellId = dlCtrlRxParams->cellId;
+    }
+  else if (ulCtrlRxParams != nullptr)
+    {
+      txCellId = ulCtrlRxParams->cellId;
+    }
+  bool ownCell = txCellId == GetCellId ();
+  bool ownStream = false;
+  if (ownCell)
+    {
+      Ptr<NrSpectrumPhy> txPhy = DynamicCast<NrSpectrumPhy> (params->txPhy);
+      NS_ASSERT (txPhy != nullptr);
+      ownStream = txPhy->GetStreamId () == m_streamId;
     }
 
-  if (dlCtrlRxParams)
+  if (m_interferenceFilter && !m_unlicensedMode && !ownCell
+      && Integral (*rxPsd) < m_noisePower * m_interferenceFilterRatio)
     {
-      if (dlCtrlRxParams->cellId == GetCellId ()
-          && dlCtrlRxParams->txPhy->GetObject<NrSpectrumPhy> ()->GetStreamId () != m_streamId)
+      NS_LOG_INFO ("Dropped a weak signal of another cell");
+      return;
+    }
+
+  if (ownCell && !ownStream && (nrDataRxParams != nullptr || dlCtrlRxParams != nullptr))
+    {
+      NS_LOG_INFO ("Inter stream interference " << (nrDataRxParams != nullptr ? "DATA" : "DL CTRL") <<
+                   " signal. Interference Ratio " << m_interStrInerfRatio);
+      if (m_interStrInerfRatio == 0.0)
         {
-          NS_LOG_INFO ("Inter stream interference DL CTRL signal. Interference Ratio " << m_interStrInerfRatio);
-          (*params->psd) *= m_interStrInerfRatio;
-          Ptr <const SpectrumValue> rxPsdDlCtrl = params->psd;
-          m_interferenceCtrl->AddSignal (rxPsdDlCtrl, duration);
+          // It would add nothing to the interference
           return;
         }
+      if (m_interStrInerfRatio != 1.0)
+        {
+          (*params->psd) *= m_interStrInerfRatio;
+        }
+      Ptr <const SpectrumValue> rxPsdStream = params->psd;
+      if (nrDataRxParams != nullptr)
+        {
+          m_interferenceData->AddSignal (rxPsdStream, duration);
+        }
+      else if (m_interferenceCtrl)
+        {
+          m_interferenceCtrl->AddSignal (rxPsdStream, duration);
+        }
+      return;
     }
 
   // pass it to interference calculations regardless of the type (nr or non-nr)
@@ -408,7 +575,13 @@ NrSpectrumPhy::StartRx (Ptr<SpectrumSignalParameters> params)
 
   if (nrDataRxParams != nullptr)
     {
-      if (nrDataRxParams->cellId == GetCellId () && nrDataRxParams->txPhy->GetObject<NrSpectrumPhy> ()->GetStreamId () == m_streamId)
+      if (ownCell && ownStream && nrDataRxParams->numLayers > 1
+          && !IsEnb () && !CarriesExpectedTb (nrDataRxParams))
+        {
+          // A MU-MIMO layer toward other UEs: it is only interference
+          NS_LOG_INFO ("Received a DATA layer of other UEs");
+        }
+      else if (ownCell && ownStream)
         {
           StartRxData (nrDataRxParams);
         }
@@ -420,11 +593,16 @@ NrSpectrumPhy::StartRx (Ptr<SpectrumSignalParameters> params)
     }
   else if (dlCtrlRxParams != nullptr)
     {
+      if (m_interferenceCtrl == nullptr)
+        {
+          NS_ASSERT_MSG (!(ownCell && ownStream), "DL CTRL received by a spectrum phy without DL control reception");
+          return;
+        }
       m_interferenceCtrl->AddSignal (rxPsd, duration);
 
       if (!IsEnb ())
         {
-          if (dlCtrlRxParams->cellId == GetCellId () && dlCtrlRxParams->txPhy->GetObject<NrSpectrumPhy> ()->GetStreamId () == m_streamId)
+          if (ownCell && ownStream)
             {
               m_interferenceCtrl->StartRx(rxPsd);
               StartRxDlCtrl (dlCtrlRxParams);
@@ -444,9 +622,9 @@ NrSpectrumPhy::StartRx (Ptr<SpectrumSignalParameters> params)
     {
       if (IsEnb ()) // only gNBs should enter into reception of UL CTRL signals
         {
-          if (ulCtrlRxParams->cellId == GetCellId () && ulCtrlRxParams->txPhy->GetObject<NrSpectrumPhy> ()->GetStreamId () == m_streamId)
+          if (ownCell && ownStream)
             {
-              if (IsOnlySrs (ulCtrlRxParams->ctrlMsgList))
+              if (IsOnlySrs (*ulCtrlRxParams->ctrlMsgList))
                 {
                   StartRxSrs (ulCtrlRxParams);
                 }
@@ -485,6 +663,7 @@ NrSpectrumPhy::StartTxDataFrames (const Ptr<PacketBurst>& pb, const std::list<Pt
                                       Time duration)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Add (NrCounters::CTRL_MESSAGES, ctrlMsgList.size ());
   switch (m_state)
     {
     case RX_DATA:
@@ -507,52 +686,118 @@ NrSpectrumPhy::StartTxDataFrames (const Ptr<PacketBurst>& pb, const std::list<Pt
         NS_ASSERT (m_txPsd);
 
         ChangeState (TX, duration);
+        SendDataFrame (pb, ctrlMsgList, duration, 1);
+        Simulator::Schedule (duration, &NrSpectrumPhy::EndTx, this);
+      }
+      break;
+    default:
+      NS_LOG_FUNCTION (this << "Programming Error. Code should not reach this point");
+    }
+}
 
-        Ptr<NrSpectrumSignalParametersDataFrame> txParams = Create<NrSpectrumSignalParametersDataFrame> ();
-        txParams->duration = duration;
-        txParams->txPhy = this->GetObject<SpectrumPhy> ();
-        txParams->psd = m_txPsd;
-        txParams->packetBurst = pb;
-        txParams->cellId = GetCellId ();
-        txParams->ctrlMsgList = ctrlMsgList;
+void
+NrSpectrumPhy::StartTxDataLayers (const std::vector<TxDataLayer> &layers, Time duration)
+{
+  NS_LOG_FUNCTION (this << layers.size ());
+  NS_ABORT_MSG_UNLESS (m_state == IDLE || m_state == CCA_BUSY,
+                       "Cannot TX the DATA layers in state " << m_state);
+  NS_ASSERT (!layers.empty ());
 
-        /* This section is used for trace */
-        if (IsEnb ())
-          {
-            GnbPhyPacketCountParameter traceParam;
-            traceParam.m_noBytes = (txParams->packetBurst) ? txParams->packetBurst->GetSize () : 0;
-            traceParam.m_cellId = txParams->cellId;
-            traceParam.m_isTx = true;
-            traceParam.m_subframeno = 0;   // TODO extend this
+  ChangeState (TX, duration);
+  // The channel computes the RX PSDs in StartTx: each layer takes the
+  // beam that is set when it is sent
+  for (const auto &layer : layers)
+    {
+      m_beamManager->ChangeBeamformingVector (layer.m_beamDevice);
+      m_txPsd = layer.m_txPsd;
+      SendDataFrame (layer.m_packetBurst, {}, duration, static_cast<uint8_t> (layers.size ()));
+    }
+  Simulator::Schedule (duration, &NrSpectrumPhy::EndTx, this);
+}
 
-            m_txPacketTraceEnb (traceParam);
-          }
+void
+NrSpectrumPhy::SendDataFrame (const Ptr<PacketBurst>& pb, const std::list<Ptr<NrControlMessage> >& ctrlMsgList,
+                              Time duration, uint8_t numLayers)
+{
+  Ptr<NrSpectrumSignalParametersDataFrame> txParams = Create<NrSpectrumSignalParametersDataFrame> ();
+  txParams->duration = duration;
+  txParams->txPhy = this->GetObject<SpectrumPhy> ();
+  txParams->psd = m_txPsd;
+  txParams->packetBurst = pb;
+  if (pb != nullptr)
+    {
+      // Reuse the index of a past burst that the receivers released
+      std::shared_ptr<NrSpectrumSignalParametersDataFrame::PacketsByRnti> index;
+      for (const auto &txIndex : m_txPacketsByRnti)
+        {
+          if (txIndex.use_count () == 1)
+            {
+              index = txIndex;
+              break;
+            }
+        }
+      if (index == nullptr)
+        {
+          index = std::make_shared<NrSpectrumSignalParametersDataFrame::PacketsByRnti> ();
+          m_txPacketsByRnti.push_back (index);
+        }
+      NrSpectrumSignalParametersDataFrame::IndexPacketsByRnti (pb, index.get ());
+      txParams->packetsByRnti = index;
+    }
+  txParams->cellId = GetCellId ();
+  txParams->numLayers = numLayers;
+  if (!ctrlMsgList.empty ())
+    {
+      txParams->ctrlMsgList = std::make_shared<const std::list<Ptr<NrControlMessage> > > (ctrlMsgList);
+    }
 
-        m_txDataTrace (duration);
+  /* This section is used for trace */
+  if (IsEnb ())
+    {
+      GnbPhyPacketCountParameter traceParam;
+      traceParam.m_noBytes = (txParams->packetBurst) ? txParams->packetBurst->GetSize () : 0;
+      traceParam.m_cellId = txParams->cellId;
+      traceParam.m_isTx = true;
+      traceParam.m_subframeno = 0;   // TODO extend this
 
-        if (m_channel)
-          {
-            m_channel->StartTx (txParams);
-          }
-        else
-          {
-            NS_LOG_WARN ("Working without channel (i.e., under test)");
-          }
+      m_txPacketTraceEnb (traceParam);
+    }
 
+  m_txDataTrace (duration);
 
-        Simulator::Schedule (duration, &NrSpectrumPhy::EndTx, this);
-      }
-      break;
-    default:
-      NS_LOG_FUNCTION (this << "Programming Error. Code should not reach this point");
+  if (m_channel)
+    {
+      m_channel->StartTx (txParams);
+    }
+  else
+    {
+      NS_LOG_WARN ("Working without channel (i.e., under test)");
     }
 }
 
+bool
+NrSpectrumPhy::CarriesExpectedTb (const Ptr<const NrSpectrumSignalParametersDataFrame>& params) const
+{
+  if (params->packetsByRnti == nullptr)
+    {
+      return false;
+    }
+  for (const auto &packet : *params->packetsByRnti)
+    {
+      if (m_transportBlocks.find (packet.first) != m_transportBlocks.end ())
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
 void
 NrSpectrumPhy::StartTxDlControlFrames (const std::list<Ptr<NrControlMessage> > &ctrlMsgList,
                                            const Time &duration)
 {
   NS_LOG_LOGIC (this << " state: " << m_state);
+  NrCounters::Add (NrCounters::CTRL_MESSAGES, ctrlMsgList.size ());
 
   switch (m_state)
     {
@@ -581,7 +826,7 @@ NrSpectrumPhy::StartTxDlControlFrames (const std::list<Ptr<NrControlMessage> > &
         txParams->psd = m_txPsd;
         txParams->cellId = GetCellId ();
         txParams->pss = true;
-        txParams->ctrlMsgList = ctrlMsgList;
+        txParams->ctrlMsgBundle = Create<const NrControlMessageBundle> (ctrlMsgList);
 
         m_txCtrlTrace (duration);
         if (m_channel)
@@ -603,6 +848,7 @@ NrSpectrumPhy::StartTxUlControlFrames (const std::list<Ptr<NrControlMessage> > &
                                            const Time &duration)
 {
   NS_LOG_LOGIC (this << " state: " << m_state);
+  NrCounters::Add (NrCounters::CTRL_MESSAGES, ctrlMsgList.size ());
 
   switch (m_state)
     {
@@ -630,7 +876,7 @@ NrSpectrumPhy::StartTxUlControlFrames (const std::list<Ptr<NrControlMessage> > &
         txParams->txPhy = GetObject<SpectrumPhy> ();
         txParams->psd = m_txPsd;
         txParams->cellId = GetCellId ();
-        txParams->ctrlMsgList = ctrlMsgList;
+        txParams->ctrlMsgList = std::make_shared<const std::list<Ptr<NrControlMessage> > > (ctrlMsgList);
 
         m_txCtrlTrace (duration);
         if (m_channel)
@@ -705,6 +951,7 @@ void
 NrSpectrumPhy::AddRsPowerChunkProcessor (const Ptr<LteChunkProcessor>& p)
 {
   NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_interferenceCtrl == nullptr, "The DL control reception is disabled");
   m_interferenceCtrl->AddRsPowerChunkProcessor (p);
 }
 
@@ -712,15 +959,83 @@ void
 NrSpectrumPhy::AddDlCtrlSinrChunkProcessor (const Ptr<LteChunkProcessor>& p)
 {
   NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_interferenceCtrl == nullptr, "The DL control reception is disabled");
   m_interferenceCtrl->AddSinrChunkProcessor (p);
 }
 
+void
+NrSpectrumPhy::DisableDlCtrlReception ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (IsEnb (), "The gNB needs the control interference object for the UL control");
+  if (m_interferenceCtrl != nullptr)
+    {
+      m_interferenceCtrl->Dispose ();
+      m_interferenceCtrl = nullptr;
+    }
+}
+
+void
+NrSpectrumPhy::SetRxEnabled (bool enabled)
+{
+  NS_LOG_FUNCTION (this << enabled);
+  m_rxEnabled = enabled;
+}
+
+bool
+NrSpectrumPhy::IsRxEnabled () const
+{
+  return m_rxEnabled;
+}
+
+void
+NrSpectrumPhy::ReceiveIdealCtrl (const Ptr<const NrControlMessageBundle> &bundle)
+{
+  NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::SPECTRUM_PHY_EVENTS);
+  if (!m_rxEnabled)
+    {
+      NS_LOG_INFO ("Reception disabled, drop the ideal control messages");
+      return;
+    }
+
+  const std::list<Ptr<NrControlMessage> > &msgs = m_phy != nullptr
+    ? m_phy->GetRxCtrlMessages (bundle)
+    : bundle->GetMessages ();
+  if (!msgs.empty () && m_phyRxCtrlEndOkCallback)
+    {
+      m_phyRxCtrlEndOkCallback (msgs, GetBwpId ());
+    }
+}
+
 void
 NrSpectrumPhy::UpdateSinrPerceived (const SpectrumValue& sinr)
 {
   NS_LOG_FUNCTION (this << sinr);
   NS_LOG_INFO ("Update SINR perceived with this value: " << sinr);
-  m_sinrPerceived = sinr;
+  m_sinrPerceived = GetSinrPerRb (sinr);
+}
+
+const SpectrumValue &
+NrSpectrumPhy::GetSinrPerRb (const SpectrumValue &sinr)
+{
+  uint32_t rbsPerBand = m_phy != nullptr ? m_phy->GetRbsPerPsdBand () : 1;
+  if (rbsPerBand == 1)
+    {
+      return sinr;
+    }
+
+  Ptr<const SpectrumModel> rbModel = m_phy->GetSpectrumModel ();
+  if (m_sinrPerRb == nullptr || m_sinrPerRb->GetSpectrumModel () != rbModel)
+    {
+      m_sinrPerRb = Create<SpectrumValue> (rbModel);
+      NrCounters::Add (NrCounters::SPECTRUM_VALUES);
+    }
+  for (size_t rb = 0; rb < m_sinrPerRb->GetValuesN (); ++rb)
+    {
+      (*m_sinrPerRb)[rb] = sinr[rb / rbsPerBand];
+    }
+  return *m_sinrPerRb;
 }
 
 
@@ -730,7 +1045,7 @@ NrSpectrumPhy::GenerateDataCqiReport (const SpectrumValue& sinr)
   NS_LOG_FUNCTION (this);
   Ptr<const NrGnbPhy> phy = (DynamicCast<const NrGnbPhy>(m_phy));
   NS_ABORT_MSG_UNLESS (phy, "This function should only be called for NrSpectrumPhy belonging to NrGnbPhy");
-  phy->GenerateDataCqiReport (sinr, m_streamId);
+  phy->GenerateDataCqiReport (GetSinrPerRb (sinr), m_streamId);
 }
 
 void
@@ -748,7 +1063,7 @@ NrSpectrumPhy::GenerateDlCqiReport (const SpectrumValue& sinr)
   NS_LOG_FUNCTION (this);
   Ptr<NrUePhy> phy = (DynamicCast<NrUePhy>(m_phy));
   NS_ABORT_MSG_UNLESS (phy, "This function should only be called for NrSpectrumPhy belonging to NrUEPhy");
-  phy->GenerateDlCqiReport (sinr, m_streamId);
+  phy->GenerateDlCqiReport (GetSinrPerRb (sinr), m_streamId);
 }
 
 void
@@ -789,6 +1104,31 @@ NrSpectrumPhy::GetNrInterference (void) const
   return m_interferenceData;
 }
 
+uint64_t
+NrSpectrumPhy::GetMemoryUsage () const
+{
+  uint64_t bytes = sizeof (NrSpectrumPhy);
+  if (m_harqPhyModule)
+    {
+      bytes += m_harqPhyModule->GetMemoryUsage ();
+    }
+  return bytes;
+}
+
+uint64_t
+NrSpectrumPhy::GetInterferenceMemoryUsage () const
+{
+  uint64_t bytes = 0;
+  for (const auto & interference : {m_interferenceData, m_interferenceCtrl, m_interferenceSrs})
+    {
+      if (interference)
+        {
+          bytes += interference->GetMemoryUsage ();
+        }
+    }
+  return bytes;
+}
+
 void
 NrSpectrumPhy::AddExpectedTb (uint16_t rnti, uint8_t ndi, uint32_t size, uint8_t mcs,
                                   const std::vector<int> &rbMap, uint8_t harqId, uint8_t rv, bool downlink,
@@ -799,13 +1139,30 @@ NrSpectrumPhy::AddExpectedTb (uint16_t rnti, uint8_t ndi, uint32_t size, uint8_t
   if (it != m_transportBlocks.end ())
     {
       // migth be a TB of an unreceived packet (due to high propagation losses)
-      m_transportBlocks.erase (it);
+      m_freeTbs.push_back (m_transportBlocks.extract (it));
     }
 
-  m_transportBlocks.emplace (std::make_pair(rnti, TransportBlockInfo(ExpectedTb (ndi, size, mcs,
-                                                                                rbMap, harqId, rv,
-                                                                                downlink, symStart,
-                                                                                numSym, sfn))));
+  if (m_freeTbs.empty ())
+    {
+      m_transportBlocks.emplace (std::make_pair(rnti, TransportBlockInfo(ExpectedTb (ndi, size, mcs,
+                                                                                    rbMap, harqId, rv,
+                                                                                    downlink, symStart,
+                                                                                    numSym, sfn))));
+    }
+  else
+    {
+      // Reuse the node of a past TB, and the memory of its RB bitmap
+      auto node = std::move (m_freeTbs.back ());
+      m_freeTbs.pop_back ();
+      std::vector<int> rbBitmap;
+      rbBitmap.swap (node.mapped ().m_expected.m_rbBitmap);
+      rbBitmap.assign (rbMap.begin (), rbMap.end ());
+      node.key () = rnti;
+      node.mapped () = TransportBlockInfo (ExpectedTb (ndi, size, mcs, {}, harqId, rv,
+                                                       downlink, symStart, numSym, sfn));
+      node.mapped ().m_expected.m_rbBitmap.swap (rbBitmap);
+      m_transportBlocks.insert (std::move (node));
+    }
   NS_LOG_INFO ("Add expected TB for rnti " << rnti << " size=" << size <<
                " mcs=" << static_cast<uint32_t> (mcs) << " symstart=" <<
                static_cast<uint32_t> (symStart) << " numSym=" <<
@@ -882,9 +1239,27 @@ NrSpectrumPhy::StartRxData (const Ptr<NrSpectrumSignalParametersDataFrame>& para
       /* no break */
     case IDLE:
       {
+        if (m_sinrOnExpectedRbs)
+          {
+            // The interference works on the bands of the PSDs: with more
+            // than one RB per band, the RBs become the indexes of their bands
+            uint32_t rbsPerBand = m_phy->GetRbsPerPsdBand ();
+            m_expectedRbs.clear ();
+            for (const auto &tbIt : m_transportBlocks)
+              {
+                for (int rb : tbIt.second.m_expected.m_rbBitmap)
+                  {
+                    m_expectedRbs.push_back (rb / static_cast<int> (rbsPerBand));
+                  }
+              }
+            std::sort (m_expectedRbs.begin (), m_expectedRbs.end ());
+            m_expectedRbs.erase (std::unique (m_expectedRbs.begin (), m_expectedRbs.end ()),
+                                 m_expectedRbs.end ());
+            m_interferenceData->SetEvaluatedRbs (m_expectedRbs);
+          }
         m_interferenceData->StartRx (params->psd);
 
-        if (m_rxPacketBurstList.empty ())
+        if (m_rxPacketsByRnti.empty ())
           {
             NS_ASSERT (m_state == IDLE || m_state == CCA_BUSY);
             // first transmission, i.e., we're IDLE and we start RX
@@ -906,14 +1281,18 @@ NrSpectrumPhy::StartRxData (const Ptr<NrSpectrumSignalParametersDataFrame>& para
 
         ChangeState (RX_DATA, params->duration);
 
-        if (params->packetBurst && !params->packetBurst->GetPackets ().empty ())
+        if (params->packetBurst && params->packetBurst->GetNPackets () > 0)
+          {
+            m_rxPacketsByRnti.push_back (params->packetsByRnti != nullptr
+                                         ? params->packetsByRnti
+                                         : NrSpectrumSignalParametersDataFrame::IndexPacketsByRnti (params->packetBurst));
+          }
+        if (params->ctrlMsgList != nullptr)
           {
-            m_rxPacketBurstList.push_back (params->packetBurst);
+            m_rxControlMessageList.insert (m_rxControlMessageList.end (), params->ctrlMsgList->begin (), params->ctrlMsgList->end ());
           }
-        //NS_LOG_DEBUG (this << " insert msgs " << params->ctrlMsgList.size ());
-        m_rxControlMessageList.insert (m_rxControlMessageList.end (), params->ctrlMsgList.begin (), params->ctrlMsgList.end ());
 
-        NS_LOG_LOGIC (this << " numSimultaneousRxEvents = " << m_rxPacketBurstList.size ());
+        NS_LOG_LOGIC (this << " numSimultaneousRxEvents = " << m_rxPacketsByRnti.size ());
       }
       break;
     default:
@@ -952,10 +1331,10 @@ NrSpectrumPhy::StartRxDlCtrl (const Ptr<NrSpectrumSignalParametersDlCtrlFrame>&
       /* no break */
     case IDLE:
       {
-        NS_ASSERT (m_rxControlMessageList.empty ());
+        NS_ASSERT (m_rxControlMessageList.empty () && m_rxControlBundle == nullptr);
         NS_LOG_LOGIC (this << "receiving DL CTRL from cellId:"<<params->cellId<< "and scheduling EndRx with delay " << params->duration);
-        // store the DCIs
-        m_rxControlMessageList = params->ctrlMsgList;
+        // store the DCIs, without copying them
+        m_rxControlBundle = params->ctrlMsgBundle;
         Simulator::Schedule (params->duration, &NrSpectrumPhy::EndRxCtrl, this);
         ChangeState (RX_DL_CTRL, params->duration);
         break;
@@ -1008,14 +1387,14 @@ NrSpectrumPhy::StartRxUlCtrl (const Ptr<NrSpectrumSignalParametersUlCtrlFrame>&
             m_firstRxDuration = params->duration;
             NS_LOG_LOGIC (this << " scheduling EndRx with delay " << params->duration);
             // store the DCIs
-            m_rxControlMessageList = params->ctrlMsgList;
+            m_rxControlMessageList = *params->ctrlMsgList;
             Simulator::Schedule (params->duration, &NrSpectrumPhy::EndRxCtrl, this);
             ChangeState (RX_UL_CTRL, params->duration);
           }
         else // already in RX_UL_CTRL state, just add new CTRL messages from other UE
           {
             NS_ASSERT ((m_firstRxStart == Simulator::Now ()) && (m_firstRxDuration == params->duration));
-            m_rxControlMessageList.insert (m_rxControlMessageList.end (), params->ctrlMsgList.begin (), params->ctrlMsgList.end ());
+            m_rxControlMessageList.insert (m_rxControlMessageList.end (), params->ctrlMsgList->begin (), params->ctrlMsgList->end ());
           }
         break;
       }
@@ -1039,8 +1418,8 @@ NrSpectrumPhy::StartRxSrs (const Ptr<NrSpectrumSignalParametersUlCtrlFrame>& par
   NS_ASSERT (params->cellId == GetCellId () &&
              IsEnb () &&
              m_state != RX_UL_SRS &&
-             params->ctrlMsgList.size() == 1 &&
-             (*params->ctrlMsgList.begin())->GetMessageType() == NrControlMessage::SRS);
+             params->ctrlMsgList->size() == 1 &&
+             params->ctrlMsgList->front ()->GetMessageType() == NrControlMessage::SRS);
 
   switch (m_state)
     {
@@ -1069,7 +1448,7 @@ NrSpectrumPhy::StartRxSrs (const Ptr<NrSpectrumSignalParametersUlCtrlFrame>& par
         m_firstRxDuration = params->duration;
         NS_LOG_LOGIC (this << " scheduling EndRx for SRS signal reception with delay " << params->duration);
         // store the SRS message in the CTRL message list
-        m_rxControlMessageList = params->ctrlMsgList;
+        m_rxControlMessageList = *params->ctrlMsgList;
         Simulator::Schedule (params->duration, &NrSpectrumPhy::EndRxSrs, this);
         ChangeState (RX_UL_SRS, params->duration);
       }
@@ -1117,6 +1496,7 @@ void
 NrSpectrumPhy::EndTx ()
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::SPECTRUM_PHY_EVENTS);
   NS_ASSERT (m_state == TX);
 
   // if in unlicensed mode check after transmission if we are in IDLE or CCA_BUSY mode
@@ -1134,75 +1514,155 @@ void
 NrSpectrumPhy::EndRxData ()
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::SPECTRUM_PHY_EVENTS);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::SPECTRUM);
   m_interferenceData->EndRx ();
 
-  Ptr<NrGnbNetDevice> enbRx = DynamicCast<NrGnbNetDevice> (GetDevice ());
-  Ptr<NrUeNetDevice> ueRx = DynamicCast<NrUeNetDevice> (GetDevice ());
-
   NS_ASSERT (m_state == RX_DATA);
 
+  if (m_dataErrorModelEnabled && !m_errorModel)
+    {
+      NS_ABORT_MSG_IF (!m_errorModelType.IsChildOf(NrErrorModel::GetTypeId()),
+                       "The error model must be a child of NrErrorModel");
+      m_errorModel = NrErrorModel::GetShared (m_errorModelType);
+    }
+
+  if (m_numRxWorkers > 1)
+    {
+      // Only the decoding and the delivery of the reception are left: the
+      // spectrum phy is ready for the next one
+      auto rx = std::make_shared<RxData> ();
+      TakeRxData (rx.get ());
+      rx->m_sinrCopy = m_sinrPerceived;
+      rx->m_sinr = &rx->m_sinrCopy;
+      rx->m_sinrValues = NrSinrValues (rx->m_sinrCopy);
+      EndRxDataState ();
+      NrRxWorkerPool::Get ().AddRx ([this, rx] () { DecodeRxData (rx.get ()); },
+                                    [this, rx] ()
+                                    {
+                                      DeliverRxData (rx.get ());
+                                      RecycleTbs (&rx->m_transportBlocks);
+                                    });
+      return;
+    }
+
+  RxData rx;
+  TakeRxData (&rx);
+  rx.m_sinr = &m_sinrPerceived;
+  rx.m_sinrValues = NrSinrValues (m_sinrPerceived);
+  {
+    NrPerfProfilerScope errorModelScope (NrPerfProfiler::ERROR_MODEL);
+    DecodeRxData (&rx);
+  }
+  DeliverRxData (&rx);
+  EndRxDataState ();
+
+  // Give the containers back, so that their memory is reused
+  TakeRxData (&rx);
+}
+
+void
+NrSpectrumPhy::TakeRxData (RxData *rx)
+{
+  rx->m_transportBlocks.swap (m_transportBlocks);
+  rx->m_rxPacketsByRnti.swap (m_rxPacketsByRnti);
+  rx->m_rxControlMessageList.swap (m_rxControlMessageList);
+  RecycleTbs (&m_transportBlocks);
+  m_rxPacketsByRnti.clear ();
+  m_rxControlMessageList.clear ();
+}
+
+void
+NrSpectrumPhy::RecycleTbs (std::unordered_map<uint16_t, TransportBlockInfo> *tbs)
+{
+  while (!tbs->empty ())
+    {
+      m_freeTbs.push_back (tbs->extract (tbs->begin ()));
+      // Do not keep the output of the error model alive
+      m_freeTbs.back ().mapped ().m_outputOfEM = nullptr;
+    }
+}
+
+void
+NrSpectrumPhy::EndRxDataState ()
+{
+  // if in unlicensed mode check after reception if the state should be
+  // changed to IDLE or CCA_BUSY
+  if (m_unlicensedMode)
+    {
+      MaybeCcaBusy ();
+    }
+  else
+    {
+      ChangeState (IDLE, Seconds (0));
+    }
+}
+
+void
+NrSpectrumPhy::DecodeRxData (RxData *rx) const
+{
+  NS_LOG_FUNCTION (this);
+
   GetSecond GetTBInfo;
   GetFirst GetRnti;
 
-  for (auto &tbIt : m_transportBlocks)
-    {
-      GetTBInfo(tbIt).m_sinrAvg = 0.0;
-      GetTBInfo(tbIt).m_sinrMin = 99999999999;
-      for (const auto & rbIndex : GetTBInfo(tbIt).m_expected.m_rbBitmap)
-        {
-          GetTBInfo(tbIt).m_sinrAvg += m_sinrPerceived.ValuesAt (rbIndex);
-          if (m_sinrPerceived.ValuesAt (rbIndex) < GetTBInfo(tbIt).m_sinrMin)
-            {
-              GetTBInfo(tbIt).m_sinrMin = m_sinrPerceived.ValuesAt (rbIndex);
-            }
-        }
+  // The TBs evaluated by the error model. It can run in a worker thread:
+  // the buffers are per thread
+  static thread_local std::vector<NrErrorModel::TbDecodeInput> inputs;
+  static thread_local std::vector<std::pair<const uint16_t, TransportBlockInfo> *> decoded;
+  static thread_local std::vector<Ptr<NrErrorModelOutput> > outputs;
+  inputs.clear ();
+  decoded.clear ();
 
-      GetTBInfo(tbIt).m_sinrAvg = GetTBInfo(tbIt).m_sinrAvg / GetTBInfo(tbIt).m_expected.m_rbBitmap.size ();
+  for (auto &tbIt : rx->m_transportBlocks)
+    {
+      GetTBInfo(tbIt).m_traceCqiComputed = false;
+      const std::vector<int> &rbs = GetTBInfo(tbIt).m_expected.m_rbBitmap;
+      NS_ASSERT (!rbs.empty () && *std::max_element (rbs.begin (), rbs.end ()) < static_cast<int> (rx->m_sinrValues.m_numBands));
+      NrMeanMinOnRbsKernel (rx->m_sinrValues.m_values, rbs.data (), rbs.size (),
+                            &GetTBInfo(tbIt).m_sinrAvg, &GetTBInfo(tbIt).m_sinrMin);
 
       NS_LOG_INFO ("Finishing RX, sinrAvg=" << GetTBInfo(tbIt).m_sinrAvg <<
                    " sinrMin=" << GetTBInfo(tbIt).m_sinrMin <<
                    " SinrAvg (dB) " << 10 * log (GetTBInfo(tbIt).m_sinrAvg) / log (10));
 
-      if ((!m_dataErrorModelEnabled) || (m_rxPacketBurstList.empty ()))
+      if ((!m_dataErrorModelEnabled) || (rx->m_rxPacketsByRnti.empty ()))
         {
           continue;
         }
 
-      std::function < const NrErrorModel::NrErrorModelHistory & (uint16_t, uint8_t) > RetrieveHistory;
-
+      NrErrorModel::TbDecodeInput input;
+      input.m_map = &GetTBInfo (tbIt).m_expected.m_rbBitmap;
+      input.m_size = GetTBInfo (tbIt).m_expected.m_tbSize;
+      input.m_mcs = GetTBInfo (tbIt).m_expected.m_mcs;
       if (GetTBInfo (tbIt).m_expected.m_isDownlink)
         {
-          RetrieveHistory = std::bind (&NrHarqPhy::GetHarqProcessInfoDl, m_harqPhyModule,
-                                       std::placeholders::_1, std::placeholders::_2);
+          input.m_history = &m_harqPhyModule->GetHarqProcessInfoDl (GetRnti (tbIt),
+                                                                    GetTBInfo (tbIt).m_expected.m_harqProcessId);
         }
       else
         {
-          RetrieveHistory = std::bind (&NrHarqPhy::GetHarqProcessInfoUl, m_harqPhyModule,
-                                       std::placeholders::_1, std::placeholders::_2);
+          input.m_history = &m_harqPhyModule->GetHarqProcessInfoUl (GetRnti (tbIt),
+                                                                    GetTBInfo (tbIt).m_expected.m_harqProcessId);
         }
+      inputs.push_back (input);
+      decoded.push_back (&tbIt);
+    }
 
-      const NrErrorModel::NrErrorModelHistory & harqInfoList = RetrieveHistory (GetRnti (tbIt),
-                                                                                GetTBInfo (tbIt).m_expected.m_harqProcessId);
-
-      NS_ABORT_MSG_IF (!m_errorModelType.IsChildOf(NrErrorModel::GetTypeId()),
-                       "The error model must be a child of NrErrorModel");
-
-      if (!m_errorModel)
-        {
-          ObjectFactory emFactory;
-          emFactory.SetTypeId (m_errorModelType);
-          m_errorModel = DynamicCast<NrErrorModel> (emFactory.Create ());
-          NS_ABORT_IF (m_errorModel == nullptr);
-        }
+  if (inputs.empty ())
+    {
+      return;
+    }
 
-      // Output is the output of the error model. From the TBLER we decide
-      // if the entire TB is corrupted or not
+  // Output is the output of the error model, for all the TBs at once. From
+  // the TBLER we decide if the entire TB is corrupted or not
+  rx->m_errorModelCalls += inputs.size ();
+  m_errorModel->GetTbsDecodificationStats (rx->m_sinrValues, inputs, outputs);
 
-      GetTBInfo(tbIt).m_outputOfEM = m_errorModel->GetTbDecodificationStats (m_sinrPerceived,
-                                                                             GetTBInfo(tbIt).m_expected.m_rbBitmap,
-                                                                             GetTBInfo(tbIt).m_expected.m_tbSize,
-                                                                             GetTBInfo(tbIt).m_expected.m_mcs,
-                                                                             harqInfoList);
+  for (size_t i = 0; i < decoded.size (); ++i)
+    {
+      auto &tbIt = *decoded[i];
+      GetTBInfo (tbIt).m_outputOfEM = outputs[i];
       GetTBInfo (tbIt).m_isCorrupted = m_random->GetValue () > GetTBInfo(tbIt).m_outputOfEM->m_tbler ? false : true;
 
       if (GetTBInfo (tbIt).m_isCorrupted)
@@ -1213,193 +1673,236 @@ NrSpectrumPhy::EndRxData ()
                        (uint32_t)GetTBInfo (tbIt).m_expected.m_mcs << " bitmap " <<
                        GetTBInfo (tbIt).m_expected.m_rbBitmap.size () << " rv from MAC: " <<
                        +GetTBInfo (tbIt).m_expected.m_rv << " elements in the history: " <<
-                       harqInfoList.size () << " TBLER " <<
+                       inputs[i].m_history->size () << " TBLER " <<
                        GetTBInfo(tbIt).m_outputOfEM->m_tbler << " corrupted " <<
                        GetTBInfo (tbIt).m_isCorrupted);
         }
     }
+  // Do not keep the outputs alive in the buffer
+  outputs.clear ();
+}
 
-  for (auto packetBurst : m_rxPacketBurstList)
-    {
-      for (auto packet : packetBurst->GetPackets ())
-        {
-          if (packet->GetSize () == 0)
-            {
-              continue;
-            }
+void
+NrSpectrumPhy::DeliverRxData (RxData *rx)
+{
+  NS_LOG_FUNCTION (this);
+  NrCounters::Add (NrCounters::ERROR_MODEL_CALLS, rx->m_errorModelCalls);
 
-          LteRadioBearerTag bearerTag;
-          if (packet->PeekPacketTag (bearerTag) == false)
-            {
-              NS_FATAL_ERROR ("No radio bearer tag found");
-            }
+  Ptr<NrGnbNetDevice> enbRx = DynamicCast<NrGnbNetDevice> (GetDevice ());
+  Ptr<NrUeNetDevice> ueRx = DynamicCast<NrUeNetDevice> (GetDevice ());
 
-          uint16_t rnti = bearerTag.GetRnti ();
+  GetSecond GetTBInfo;
 
-          auto itTb = m_transportBlocks.find (rnti);
+  // The trace parameters are built only for the traces with sinks
+  const bool traceEnb = enbRx && !m_rxPacketTraceEnb.IsEmpty ();
+  const bool traceUe = ueRx && !m_rxPacketTraceUe.IsEmpty ();
+  // The AMC CQI only depends on the SINR: computed once per reception
+  bool amcCqiComputed = false;
+  uint8_t amcCqi = std::numeric_limits<uint8_t>::max ();
 
-          if (itTb == m_transportBlocks.end ())
-            {
-              // Packet for other device...
-              continue;
-            }
-          if (! GetTBInfo (*itTb).m_isCorrupted)
-            {
-              m_phyRxDataEndOkCallback (packet);
-            }
-          else
-            {
-              NS_LOG_INFO ("TB failed");
-            }
+  // The packets are indexed by RNTI by the transmitter: the packets of the
+  // other devices are skipped without reading their tags
+  for (const auto & packets : rx->m_rxPacketsByRnti)
+    {
+      for (auto it = packets->begin (); it != packets->end (); )
+        {
+          uint16_t rnti = it->first;
+          auto runEnd = std::upper_bound (it, packets->end (), rnti,
+                                          [] (uint16_t r, const std::pair<uint16_t, Ptr<Packet>> &entry)
+                                          { return r < entry.first; });
 
-          RxPacketTraceParams traceParams;
-          traceParams.m_tbSize = GetTBInfo(*itTb).m_expected.m_tbSize;
-          traceParams.m_frameNum = GetTBInfo(*itTb).m_expected.m_sfn.GetFrame ();
-          traceParams.m_subframeNum = GetTBInfo(*itTb).m_expected.m_sfn.GetSubframe ();
-          traceParams.m_slotNum = GetTBInfo(*itTb).m_expected.m_sfn.GetSlot ();
-          traceParams.m_rnti = rnti;
-          traceParams.m_mcs = GetTBInfo(*itTb).m_expected.m_mcs;
-          traceParams.m_rv = GetTBInfo(*itTb).m_expected.m_rv;
-          traceParams.m_sinr = GetTBInfo(*itTb).m_sinrAvg;
-          traceParams.m_sinrMin = GetTBInfo(*itTb).m_sinrMin;
-          if (m_dataErrorModelEnabled)
-            {
-              traceParams.m_tbler = GetTBInfo (*itTb).m_outputOfEM->m_tbler;
-              traceParams.m_corrupt = GetTBInfo (*itTb).m_isCorrupted;
-            }
-          else
-            {
-              //when error model is disabled a received TB has no
-              //error, thus, TBLER would be 0 and it would be
-              //considered as not corrupt.
-              traceParams.m_tbler = 0;
-              traceParams.m_corrupt = false;
-            }
-          traceParams.m_symStart = GetTBInfo(*itTb).m_expected.m_symStart;
-          traceParams.m_numSym = GetTBInfo(*itTb).m_expected.m_numSym;
-          traceParams.m_bwpId = GetBwpId ();
-          traceParams.m_streamId = m_streamId;
-          traceParams.m_rbAssignedNum = static_cast<uint32_t> (GetTBInfo(*itTb).m_expected.m_rbBitmap.size ());
+          auto itTb = rx->m_transportBlocks.find (rnti);
 
-          if (enbRx)
-            {
-              traceParams.m_cellId = enbRx->GetCellId ();
-              m_rxPacketTraceEnb (traceParams);
-            }
-          else if (ueRx)
+          if (itTb == rx->m_transportBlocks.end ())
             {
-              traceParams.m_cellId = ueRx->GetTargetEnb ()->GetCellId ();
-              Ptr<NrUePhy> phy = (DynamicCast<NrUePhy>(m_phy));
-              traceParams.m_cqi = phy->ComputeCqi (m_sinrPerceived);
-              m_rxPacketTraceUe (traceParams);
+              // Packets for other device...
+              it = runEnd;
+              continue;
             }
 
-
-          // send HARQ feedback (if not already done for this TB)
-          if (! GetTBInfo(*itTb).m_harqFeedbackSent)
+          for (; it != runEnd; ++it)
             {
-              GetTBInfo(*itTb).m_harqFeedbackSent = true;
-              if (! GetTBInfo(*itTb).m_expected.m_isDownlink)    // UPLINK TB
+              // The burst is shared by all the receivers: deliver a copy
+              Ptr<Packet> packet = it->second->Copy ();
+              if (! GetTBInfo (*itTb).m_isCorrupted)
+                {
+                  m_phyRxDataEndOkCallback (packet);
+                }
+              else
                 {
-                  // Generate the feedback
-                  UlHarqInfo harqUlInfo;
-                  harqUlInfo.m_rnti = rnti;
-                  harqUlInfo.m_tpc = 0;
-                  harqUlInfo.m_harqProcessId = GetTBInfo(*itTb).m_expected.m_harqProcessId;
-                  harqUlInfo.m_numRetx = GetTBInfo(*itTb).m_expected.m_rv;
-                  if (GetTBInfo(*itTb).m_isCorrupted)
+                  NS_LOG_INFO ("TB failed");
+                }
+
+              if (traceEnb || traceUe)
+                {
+                  RxPacketTraceParams traceParams;
+                  traceParams.m_tbSize = GetTBInfo(*itTb).m_expected.m_tbSize;
+                  traceParams.m_frameNum = GetTBInfo(*itTb).m_expected.m_sfn.GetFrame ();
+                  traceParams.m_subframeNum = GetTBInfo(*itTb).m_expected.m_sfn.GetSubframe ();
+                  traceParams.m_slotNum = GetTBInfo(*itTb).m_expected.m_sfn.GetSlot ();
+                  traceParams.m_rnti = rnti;
+                  traceParams.m_mcs = GetTBInfo(*itTb).m_expected.m_mcs;
+                  traceParams.m_rv = GetTBInfo(*itTb).m_expected.m_rv;
+                  traceParams.m_sinr = GetTBInfo(*itTb).m_sinrAvg;
+                  traceParams.m_sinrMin = GetTBInfo(*itTb).m_sinrMin;
+                  if (m_dataErrorModelEnabled)
                     {
-                      harqUlInfo.m_receptionStatus = UlHarqInfo::NotOk;
+                      traceParams.m_tbler = GetTBInfo (*itTb).m_outputOfEM->m_tbler;
+                      traceParams.m_corrupt = GetTBInfo (*itTb).m_isCorrupted;
                     }
                   else
                     {
-                      harqUlInfo.m_receptionStatus = UlHarqInfo::Ok;
+                      //when error model is disabled a received TB has no
+                      //error, thus, TBLER would be 0 and it would be
+                      //considered as not corrupt.
+                      traceParams.m_tbler = 0;
+                      traceParams.m_corrupt = false;
                     }
+                  traceParams.m_symStart = GetTBInfo(*itTb).m_expected.m_symStart;
+                  traceParams.m_numSym = GetTBInfo(*itTb).m_expected.m_numSym;
+                  traceParams.m_bwpId = GetBwpId ();
+                  traceParams.m_streamId = m_streamId;
+                  traceParams.m_rbAssignedNum = static_cast<uint32_t> (GetTBInfo(*itTb).m_expected.m_rbBitmap.size ());
 
-                  // Send the feedback
-                  if (!m_phyUlHarqFeedbackCallback.IsNull ())
+                  if (enbRx)
                     {
-                      m_phyUlHarqFeedbackCallback (harqUlInfo);
+                      traceParams.m_cellId = enbRx->GetCellId ();
+                      m_rxPacketTraceEnb (traceParams);
                     }
-
-                  // Arrange the history
-                  if (! GetTBInfo(*itTb).m_isCorrupted || GetTBInfo(*itTb).m_expected.m_rv == 3)
+                  else if (ueRx)
                     {
-                      m_harqPhyModule->ResetUlHarqProcessStatus (rnti, GetTBInfo(*itTb).m_expected.m_harqProcessId);
-                    }
-                  else
-                    {
-                      m_harqPhyModule->UpdateUlHarqProcessStatus (rnti, GetTBInfo(*itTb).m_expected.m_harqProcessId,
-                                                                  GetTBInfo(*itTb).m_outputOfEM);
+                      traceParams.m_cellId = ueRx->GetTargetEnb ()->GetCellId ();
+                      if (!GetTBInfo (*itTb).m_traceCqiComputed)
+                        {
+                          Ptr<NrUePhy> phy = (DynamicCast<NrUePhy>(m_phy));
+                          if (m_traceCqiMode == TRACE_CQI_AMC)
+                            {
+                              if (!amcCqiComputed)
+                                {
+                                  amcCqi = phy->ComputeCqi (*rx->m_sinr);
+                                  amcCqiComputed = true;
+                                }
+                              GetTBInfo (*itTb).m_traceCqi = amcCqi;
+                            }
+                          else if (m_traceCqiMode == TRACE_CQI_SHANNON)
+                            {
+                              GetTBInfo (*itTb).m_traceCqi = phy->ComputeCqiFromAverageSinr (GetTBInfo (*itTb).m_sinrAvg);
+                            }
+                          else
+                            {
+                              GetTBInfo (*itTb).m_traceCqi = std::numeric_limits<uint8_t>::max ();
+                            }
+                          GetTBInfo (*itTb).m_traceCqiComputed = true;
+                        }
+                      traceParams.m_cqi = GetTBInfo (*itTb).m_traceCqi;
+                      m_rxPacketTraceUe (traceParams);
                     }
                 }
-              else
-                {
-                  // Generate the feedback
-                  DlHarqInfo::HarqStatus harqFeedback;
-                  if (GetTBInfo(*itTb).m_isCorrupted)
-                    {
-                      harqFeedback = DlHarqInfo::NACK;
-                    }
-                  else
-                    {
-                      harqFeedback = DlHarqInfo::ACK;
-                    }
-                  (DynamicCast<NrUePhy> (m_phy))->NotifyDlHarqFeedback (m_streamId, harqFeedback, GetTBInfo(*itTb).m_expected.m_harqProcessId, GetTBInfo(*itTb).m_expected.m_rv);
 
-                  // Arrange the history
-                  if (! GetTBInfo(*itTb).m_isCorrupted || GetTBInfo(*itTb).m_expected.m_rv == 3)
+
+              // send HARQ feedback (if not already done for this TB)
+              if (! GetTBInfo(*itTb).m_harqFeedbackSent)
+                {
+                  GetTBInfo(*itTb).m_harqFeedbackSent = true;
+                  if (! GetTBInfo(*itTb).m_expected.m_isDownlink)    // UPLINK TB
                     {
-                      NS_LOG_DEBUG ("Reset Dl process: " << +GetTBInfo(*itTb).m_expected.m_harqProcessId <<
-                                    " for RNTI " << rnti);
-                      m_harqPhyModule->ResetDlHarqProcessStatus (rnti, GetTBInfo(*itTb).m_expected.m_harqProcessId);
+                      // Generate the feedback
+                      UlHarqInfo harqUlInfo;
+                      harqUlInfo.m_rnti = rnti;
+                      harqUlInfo.m_tpc = 0;
+                      harqUlInfo.m_harqProcessId = GetTBInfo(*itTb).m_expected.m_harqProcessId;
+                      harqUlInfo.m_numRetx = GetTBInfo(*itTb).m_expected.m_rv;
+                      if (GetTBInfo(*itTb).m_isCorrupted)
+                        {
+                          harqUlInfo.m_receptionStatus = UlHarqInfo::NotOk;
+                        }
+                      else
+                        {
+                          harqUlInfo.m_receptionStatus = UlHarqInfo::Ok;
+                        }
+
+                      // Send the feedback
+                      if (!m_phyUlHarqFeedbackCallback.IsNull ())
+                        {
+                          m_phyUlHarqFeedbackCallback (harqUlInfo);
+                        }
+
+                      // Arrange the history
+                      if (! GetTBInfo(*itTb).m_isCorrupted || GetTBInfo(*itTb).m_expected.m_rv == 3)
+                        {
+                          m_harqPhyModule->ResetUlHarqProcessStatus (rnti, GetTBInfo(*itTb).m_expected.m_harqProcessId);
+                        }
+                      else
+                        {
+                          m_harqPhyModule->UpdateUlHarqProcessStatus (rnti, GetTBInfo(*itTb).m_expected.m_harqProcessId,
+                                                                      GetTBInfo(*itTb).m_outputOfEM);
+                        }
                     }
                   else
                     {
-                      NS_LOG_DEBUG ("Update Dl process: " << +GetTBInfo(*itTb).m_expected.m_harqProcessId <<
-                                    " for RNTI " << rnti);
-                      m_harqPhyModule->UpdateDlHarqProcessStatus (rnti, GetTBInfo(*itTb).m_expected.m_harqProcessId,
-                                                                  GetTBInfo(*itTb).m_outputOfEM);
-                    }
-                }   // end if (itTb->second.downlink) HARQ
-            }   // end if (!itTb->second.harqFeedbackSent)
+                      // Generate the feedback
+                      DlHarqInfo::HarqStatus harqFeedback;
+                      if (GetTBInfo(*itTb).m_isCorrupted)
+                        {
+                          harqFeedback = DlHarqInfo::NACK;
+                        }
+                      else
+                        {
+                          harqFeedback = DlHarqInfo::ACK;
+                        }
+                      (DynamicCast<NrUePhy> (m_phy))->NotifyDlHarqFeedback (m_streamId, harqFeedback, GetTBInfo(*itTb).m_expected.m_harqProcessId, GetTBInfo(*itTb).m_expected.m_rv);
+
+                      // Arrange the history
+                      if (! GetTBInfo(*itTb).m_isCorrupted || GetTBInfo(*itTb).m_expected.m_rv == 3)
+                        {
+                          NS_LOG_DEBUG ("Reset Dl process: " << +GetTBInfo(*itTb).m_expected.m_harqProcessId <<
+                                        " for RNTI " << rnti);
+                          m_harqPhyModule->ResetDlHarqProcessStatus (rnti, GetTBInfo(*itTb).m_expected.m_harqProcessId);
+                        }
+                      else
+                        {
+                          NS_LOG_DEBUG ("Update Dl process: " << +GetTBInfo(*itTb).m_expected.m_harqProcessId <<
+                                        " for RNTI " << rnti);
+                          m_harqPhyModule->UpdateDlHarqProcessStatus (rnti, GetTBInfo(*itTb).m_expected.m_harqProcessId,
+                                                                      GetTBInfo(*itTb).m_outputOfEM);
+                        }
+                    }   // end if (itTb->second.downlink) HARQ
+                }   // end if (!itTb->second.harqFeedbackSent)
+            }
         }
     }
 
   // forward control messages of this frame to NrPhy
 
-  if (!m_rxControlMessageList.empty () && m_phyRxCtrlEndOkCallback)
-    {
-      m_phyRxCtrlEndOkCallback (m_rxControlMessageList, GetBwpId ());
-    }
-
-  // if in unlicensed mode check after reception if the state should be
-  // changed to IDLE or CCA_BUSY
-  if (m_unlicensedMode)
-    {
-      MaybeCcaBusy ();
-    }
-  else
+  if (!rx->m_rxControlMessageList.empty () && m_phyRxCtrlEndOkCallback)
     {
-      ChangeState (IDLE, Seconds (0));
+      m_phyRxCtrlEndOkCallback (rx->m_rxControlMessageList, GetBwpId ());
     }
-
-  m_rxPacketBurstList.clear ();
-  m_transportBlocks.clear ();
-  m_rxControlMessageList.clear ();
 }
 
 void
 NrSpectrumPhy::EndRxCtrl ()
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::SPECTRUM_PHY_EVENTS);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::SPECTRUM);
   NS_ASSERT (m_state == RX_DL_CTRL || m_state == RX_UL_CTRL);
 
   m_interferenceCtrl->EndRx ();
 
   // control error model not supported
   // forward control messages of this frame to LtePhy
-  if (!m_rxControlMessageList.empty ())
+  if (m_rxControlBundle != nullptr)
+    {
+      const std::list<Ptr<NrControlMessage> > &msgs = m_phy != nullptr
+        ? m_phy->GetRxCtrlMessages (m_rxControlBundle)
+        : m_rxControlBundle->GetMessages ();
+      if (!msgs.empty () && m_phyRxCtrlEndOkCallback)
+        {
+          m_phyRxCtrlEndOkCallback (msgs, GetBwpId ());
+        }
+    }
+  else if (!m_rxControlMessageList.empty ())
     {
       if (m_phyRxCtrlEndOkCallback)
         {
@@ -1418,12 +1921,15 @@ NrSpectrumPhy::EndRxCtrl ()
     }
 
   m_rxControlMessageList.clear ();
+  m_rxControlBundle = nullptr;
 }
 
 void
 NrSpectrumPhy::EndRxSrs ()
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::SPECTRUM_PHY_EVENTS);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::SPECTRUM);
   NS_ASSERT (m_state == RX_UL_SRS && m_rxControlMessageList.size() ==1 );
 
   // notify interference calculator that the reception of SRS is finished,
@@ -1489,6 +1995,7 @@ void
 NrSpectrumPhy::CheckIfStillBusy ()
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::SPECTRUM_PHY_EVENTS);
   NS_ABORT_MSG_IF ( m_state == IDLE, "This function should not be called when in IDLE state." );
   // If in state of RX/TX do not switch to CCA_BUSY until RX/TX is finished.
   // When RX/TX finishes, check if the channel is still busy.
@@ -112,6 +112,16 @@ public:
     CCA_BUSY   //!< BUSY state (channel occupied by another entity)
   };
 
+  /**
+   * \brief How the CQI of the RxPacketTraceUe trace is computed
+   */
+  enum TraceCqiMode
+  {
+    TRACE_CQI_AMC = 0,     //!< Wideband CQI of the AMC, from the SINR of all the RBs
+    TRACE_CQI_SHANNON = 1, //!< Shannon CQI of the average SINR of the TB (cheap)
+    TRACE_CQI_NONE = 2     //!< No CQI: the trace reports 255
+  };
+
   //callbacks typefefs and setters
   /**
    * \brief This callback method type is used to notify that DATA is received
@@ -205,6 +215,83 @@ public:
    * \param unlicensedMode if true the unlicensed mode is enabled
    */
   void SetUnlicensedMode (bool unlicensedMode);
+  /**
+   * \brief Sets whether to ignore the weak signals of the other cells
+   *
+   * With the filter, a signal that does not belong to this cell, and whose
+   * received power over the band is below the threshold (relative to the
+   * noise power over the band) is dropped: it is not added to the
+   * interference. It saves the interference bookkeeping of the far cells,
+   * at the price of a slightly optimistic SINR. The filter is not applied
+   * in the unlicensed mode, as the energy detection needs all the signals.
+   *
+   * \param interferenceFilter if true, the weak signals of the other cells are dropped
+   */
+  void SetInterferenceFilter (bool interferenceFilter);
+  /**
+   * \brief Set the threshold of the interference filter
+   * \param thresholdDb the threshold in dB, relative to the noise power
+   */
+  void SetInterferenceFilterThreshold (double thresholdDb);
+  /**
+   * \return the threshold of the interference filter in dB, relative to the noise power
+   */
+  double GetInterferenceFilterThreshold () const;
+  /**
+   * \brief Sets whether to evaluate the SINR of the DATA only on the RBs of
+   * the expected TBs
+   *
+   * It saves work when the allocations are narrow with respect to the
+   * bandwidth, but the SINR of the other RBs is reported as 0: the
+   * wideband CQI computed from the DATA (e.g., the UE DL CQI) is then
+   * affected, while the gNB UL CQI only reads the allocated RBs.
+   *
+   * \param sinrOnExpectedRbs if true, the SINR is evaluated only on the RBs
+   * of the expected TBs
+   */
+  void SetSinrOnExpectedRbs (bool sinrOnExpectedRbs);
+  /**
+   * \brief Sets whether the SINR of the DATA is evaluated once per
+   * reception, with the interference averaged over the reception
+   *
+   * The chunk processors then run once per TB instead of at each start or
+   * end of an interfering signal, at the price of a lower SINR when the
+   * interference changes during the reception: see
+   * NrInterference::SetAverageInterference for the bound. The CTRL and
+   * the SRS are not affected.
+   *
+   * \param average if true, the interference of the DATA is averaged
+   */
+  void SetAverageDataInterference (bool average);
+  /**
+   * \brief Set how the CQI of the RxPacketTraceUe trace is computed
+   *
+   * The CQI is computed only if the trace has sinks, once per reception
+   * (TRACE_CQI_AMC) or once per TB (TRACE_CQI_SHANNON), not per packet.
+   *
+   * \param mode the CQI mode
+   */
+  void SetTraceCqiMode (TraceCqiMode mode);
+  /**
+   * \brief Set the number of threads that decode the DATA receptions
+   *
+   * With more than 1, the reception of the DATA is decoded (SINR
+   * statistics and error model) by NrRxWorkerPool together with the other
+   * receptions that end at the same time, and delivered after all of them,
+   * in the order in which they ended. The state of the spectrum phy changes
+   * at the end of the reception, before the delivery.
+   *
+   * \param numWorkers the number of threads, at least 1
+   */
+  void SetNumRxWorkers (uint32_t numWorkers);
+  /**
+   * \return the number of threads that decode the DATA receptions
+   */
+  uint32_t GetNumRxWorkers () const;
+  /**
+   * \return how the CQI of the RxPacketTraceUe trace is computed
+   */
+  TraceCqiMode GetTraceCqiMode () const;
   /**
    * \brief Enables or disabled data error model
    * \param dataErrorModelEnabled boolean saying whether the data error model should be enabled
@@ -233,6 +320,28 @@ public:
    * \param duration the duration of transmission
    */
  void StartTxDataFrames (const Ptr<PacketBurst>& pb, const std::list<Ptr<NrControlMessage> >& ctrlMsgList, Time duration);
+
+  /**
+   * \brief A DL DATA layer of a MU-MIMO transmission
+   */
+  struct TxDataLayer
+  {
+    Ptr<PacketBurst> m_packetBurst;    //!< The packets of the UEs of the layer
+    Ptr<SpectrumValue> m_txPsd;        //!< The TX PSD, over the RBs of the layer
+    Ptr<const NetDevice> m_beamDevice; //!< The device toward which the layer is beamformed
+  };
+
+  /**
+   * \brief Starts the transmission of the DATA of several MU-MIMO layers at
+   * the same time, each with its beam and its TX PSD
+   *
+   * Each layer is a different signal in the channel. The UEs receive the
+   * layer with their packets, and the other layers as interference.
+   *
+   * \param layers the layers
+   * \param duration the duration of transmission
+   */
+  void StartTxDataLayers (const std::vector<TxDataLayer> &layers, Time duration);
   /**
    * \brief Starts transmission of DL CTRL
    * \param duration the duration of this transmission
@@ -272,6 +381,49 @@ public:
    * \param p the chunk processor
    */
   void AddDlCtrlSinrChunkProcessor (const Ptr<LteChunkProcessor>& p);
+
+  /**
+   * \brief Remove the control interference object of a UE spectrum phy that
+   * never receives the DL control
+   *
+   * The gNB sends the DL control on its first stream only, so the spectrum
+   * phys of the other streams of a UE only need the data interference
+   * object. After this call, the DL control signals are ignored by this
+   * spectrum phy, and no control chunk processor can be added.
+   */
+  void DisableDlCtrlReception ();
+
+  /**
+   * \brief Enable or disable the reception
+   *
+   * A spectrum phy with the reception disabled drops the signals as soon as
+   * the channel delivers them, before any processing (interference, CQI,
+   * chunk processors); the receptions in progress are completed. It is
+   * used by the idle UEs (see the NrUePhy attribute InactivityTimer): the
+   * SpectrumChannel of the supported ns-3 release cannot remove a receiver,
+   * so the phy stays in the list of the channel.
+   *
+   * \param enabled false to drop the received signals
+   */
+  void SetRxEnabled (bool enabled);
+
+  /**
+   * \return true if the received signals are processed (the default)
+   */
+  bool IsRxEnabled () const;
+
+  /**
+   * \brief Receive control messages delivered directly by the PHY of the
+   * other end, without a signal, when it uses the ideal control
+   *
+   * The messages are forwarded to the PHY as at the end of a control
+   * reception, but there is no interference, no SINR report and no change
+   * of state. They are dropped if the reception is disabled.
+   *
+   * \param bundle the control messages
+   */
+  void ReceiveIdealCtrl (const Ptr<const NrControlMessageBundle> &bundle);
+
   /**
    * \brief SpectrumPhy that will be called when the SINR for the received
    * DATA is being calculated by the interference object over DATA chunk
@@ -351,6 +503,20 @@ public:
    * \return NrInterference instance of this spectrum phy
    */
   Ptr<NrInterference> GetNrInterference (void) const;
+
+  /**
+   * \brief Get an estimate of the memory used by this spectrum phy and its
+   * HARQ module, without its interference objects
+   * \return the number of bytes
+   */
+  uint64_t GetMemoryUsage () const;
+
+  /**
+   * \brief Get an estimate of the memory used by the interference objects
+   * of this spectrum phy (see NrInterference::GetMemoryUsage)
+   * \return the number of bytes
+   */
+  uint64_t GetInterferenceMemoryUsage () const;
   /**
    * \brief Instruct the Spectrum Model of a incoming transmission.
    * \param rnti RNTI
@@ -457,6 +623,22 @@ protected:
 
 private:
 
+  /**
+   * \brief Send a DATA signal in the channel, with the current beam and TX PSD
+   * \param pb packet burst to be transmitted
+   * \param ctrlMsgList control message list
+   * \param duration the duration of transmission
+   * \param numLayers the number of MU-MIMO layers sent at the same time
+   */
+  void SendDataFrame (const Ptr<PacketBurst>& pb, const std::list<Ptr<NrControlMessage> >& ctrlMsgList,
+                      Time duration, uint8_t numLayers);
+
+  /**
+   * \param params the DATA signal
+   * \return true if the signal carries packets of a TB expected by this spectrum phy
+   */
+  bool CarriesExpectedTb (const Ptr<const NrSpectrumSignalParametersDataFrame>& params) const;
+
   /**
    * \brief Function is called when what is being received is holding data
    * \para params spectrum parameters that are holding information regarding data frame
@@ -482,6 +664,14 @@ private:
    * \return true if this class is inside an enb/gnb
    */
   bool IsEnb () const;
+  /**
+   * \brief Get the SINR of the DATA per RB, when the PSDs of the PHY have
+   * more than one RB per band (see NrPhy::SetRbsPerPsdBand)
+   * \param sinr the SINR per band
+   * \return sinr itself with one RB per band, otherwise a reused buffer
+   * where each RB has the SINR of its band
+   */
+  const SpectrumValue & GetSinrPerRb (const SpectrumValue &sinr);
   /**
    * \brief Update the state of the spectrum phy. The states are:
    *  IDLE, TX, RX_DATA, RX_DL_CTRL, RX_UL_CTRL, CCA_BUSY.
@@ -580,8 +770,55 @@ private:
     Ptr<NrErrorModelOutput> m_outputOfEM; //!< Output of the Error Model (depends on the EM type)
     double m_sinrAvg {0.0};               //!< AVG SINR (only for the RB used to transmit the TB)
     double m_sinrMin {0.0};               //!< MIN SINR (only between the RB used to transmit the TB)
+    bool m_traceCqiComputed {false};      //!< True if m_traceCqi is valid for this reception
+    uint8_t m_traceCqi {0};               //!< CQI reported in the RxPacketTraceUe trace
+  };
+
+  /**
+   * \brief A DATA reception, taken out of the spectrum phy at its end to be
+   * decoded and delivered
+   */
+  struct RxData
+  {
+    std::unordered_map<uint16_t, TransportBlockInfo> m_transportBlocks; //!< The expected TBs, per RNTI
+    std::vector<std::shared_ptr<const NrSpectrumSignalParametersDataFrame::PacketsByRnti>> m_rxPacketsByRnti; //!< The received packets, by RNTI, of each signal
+    std::list<Ptr<NrControlMessage> > m_rxControlMessageList; //!< The received control messages
+    const SpectrumValue *m_sinr {nullptr}; //!< The SINR of the reception
+    SpectrumValue m_sinrCopy;              //!< Copy of the SINR, when the reception is decoded later
+    NrSinrValues m_sinrValues {nullptr, 0}; //!< The values of m_sinr, the only SINR read by DecodeRxData
+    uint64_t m_errorModelCalls {0};        //!< Calls of the error model in the decoding
   };
 
+  /**
+   * \brief Swap the expected TBs, the received packets and the control
+   * messages with the ones of a reception, and clear them
+   * \param rx the reception
+   */
+  void TakeRxData (RxData *rx);
+  /**
+   * \brief Change the state at the end of the reception of DATA
+   */
+  void EndRxDataState ();
+  /**
+   * \brief Evaluate the SINR statistics and the error model of the TBs of a
+   * reception. It does not access the spectrum phy other than in read-only,
+   * and it can run in a worker thread: it does not copy nor release any Ptr
+   * shared with other devices (e.g., the SpectrumModel of the SINR).
+   * \param rx the reception
+   */
+  void DecodeRxData (RxData *rx) const;
+  /**
+   * \brief Deliver the packets of a decoded reception, send the HARQ
+   * feedback and fire the traces
+   * \param rx the reception
+   */
+  void DeliverRxData (RxData *rx);
+  /**
+   * \brief Move the expected TBs of a map in the nodes reused by AddExpectedTb
+   * \param tbs the map, empty at the end
+   */
+  void RecycleTbs (std::unordered_map<uint16_t, TransportBlockInfo> *tbs);
+
   //attributes
   TypeId m_errorModelType {Object::GetTypeId()}; //!< Error model type by default is NrLteMiErrorModel
   bool m_dataErrorModelEnabled {true}; //!< whether the phy error model for DATA is enabled, by default is enabled
@@ -589,6 +826,14 @@ private:
                                    //   CcaMode1Threshold and is configured in dBm
   bool m_unlicensedMode {false}; //!< Whether this spectrum phy is configure to work in an unlicensed mode.
                                  //   Unlicensed mode additionally to licensed mode allows channel monitoring to discover if is busy before transmission.
+  bool m_rxEnabled {true}; //!< Whether the received signals are processed (false for an idle UE)
+  bool m_interferenceFilter {false};        //!< Whether the weak signals of the other cells are dropped
+  double m_interferenceFilterRatio {0.01};  //!< Threshold of the interference filter, as a ratio to the noise power
+  double m_noisePower {0.0};                //!< Noise power over the band, in W
+  bool m_sinrOnExpectedRbs {false}; //!< Whether the SINR of the DATA is evaluated only on the RBs of the expected TBs
+  std::vector<int> m_expectedRbs;   //!< RBs of the expected TBs, reused at each DATA reception
+  TraceCqiMode m_traceCqiMode {TRACE_CQI_AMC}; //!< How the CQI of the RxPacketTraceUe trace is computed
+  uint32_t m_numRxWorkers {1};  //!< Number of threads that decode the DATA receptions
 
   Ptr<SpectrumChannel> m_channel {nullptr}; //!< channel is needed to be able to connect listener spectrum phy (AddRx) or to start transmission StartTx
   Ptr<const SpectrumModel> m_rxSpectrumModel {nullptr}; //!< the spectrum model of this spectrum phy
@@ -606,13 +851,17 @@ private:
   Ptr<UniformRandomVariable> m_random {nullptr}; //!< the random variable used for TB decoding
 
   std::unordered_map<uint16_t, TransportBlockInfo> m_transportBlocks; //!< Transport block map per RNTI of TBs which are expected to be received by reading DL or UL DCIs
-  std::list<Ptr<PacketBurst> > m_rxPacketBurstList; //!< the list of received packets
+  std::vector<std::unordered_map<uint16_t, TransportBlockInfo>::node_type> m_freeTbs; //!< Nodes of the past expected TBs, reused by AddExpectedTb
+  std::vector<std::shared_ptr<NrSpectrumSignalParametersDataFrame::PacketsByRnti>> m_txPacketsByRnti; //!< Indexes of the sent bursts, reused once no receiver holds them
+  std::vector<std::shared_ptr<const NrSpectrumSignalParametersDataFrame::PacketsByRnti>> m_rxPacketsByRnti; //!< the received packets, by RNTI, of each received signal
   std::list<Ptr<NrControlMessage> > m_rxControlMessageList; //!< the list of received control messages
+  Ptr<const NrControlMessageBundle> m_rxControlBundle; //!< the DL CTRL messages being received, shared with the other receivers
 
   Time m_firstRxStart {Seconds (0)}; //!< this is needed to save the time at which we lock down onto signal
   Time m_firstRxDuration {Seconds (0)}; //!< the duration of the current reception
   State m_state {IDLE}; //!<spectrum phy state
   SpectrumValue m_sinrPerceived; //!< SINR that is being update at the end of the DATA reception and is used for TB decoding
+  Ptr<SpectrumValue> m_sinrPerRb; //!< Buffer of GetSinrPerRb
   std::list<SrsSinrReportCallback> m_srsSinrReportCallback; //!< list of SRS SINR callbacks
   std::list<SrsSnrReportCallback> m_srsSnrReportCallback; //!< list of SRS SNR callbacks
   uint16_t m_currentSrsRnti {0};
@@ -21,8 +21,12 @@
 #include <ns3/log.h>
 #include <ns3/packet-burst.h>
 #include <ns3/ptr.h>
+#include <ns3/lte-radio-bearer-tag.h>
 #include "nr-spectrum-signal-parameters.h"
 #include "nr-control-messages.h"
+#include "nr-pool-allocator.h"
+
+#include <algorithm>
 
 
 
@@ -40,11 +44,72 @@ NrSpectrumSignalParametersDataFrame::NrSpectrumSignalParametersDataFrame (const
 {
   NS_LOG_FUNCTION (this << &p);
   cellId = p.cellId;
-  if (p.packetBurst)
+  numLayers = p.numLayers;
+  // The receivers only read the burst and the messages, and copy what they deliver
+  packetBurst = p.packetBurst;
+  packetsByRnti = p.packetsByRnti;
+  ctrlMsgList = p.ctrlMsgList;
+}
+
+void *
+NrSpectrumSignalParametersDataFrame::operator new (std::size_t size)
+{
+  if (size != sizeof (NrSpectrumSignalParametersDataFrame))
     {
-      packetBurst = p.packetBurst->Copy ();
+      return ::operator new (size);
+    }
+  return NrPoolAllocator<NrSpectrumSignalParametersDataFrame> ().allocate (1);
+}
+
+void
+NrSpectrumSignalParametersDataFrame::operator delete (void *p, std::size_t size)
+{
+  if (size != sizeof (NrSpectrumSignalParametersDataFrame))
+    {
+      ::operator delete (p);
+      return;
+    }
+  NrPoolAllocator<NrSpectrumSignalParametersDataFrame> ().deallocate (static_cast<NrSpectrumSignalParametersDataFrame *> (p), 1);
+}
+
+std::shared_ptr<const NrSpectrumSignalParametersDataFrame::PacketsByRnti>
+NrSpectrumSignalParametersDataFrame::IndexPacketsByRnti (const Ptr<const PacketBurst> &pb)
+{
+  NS_LOG_FUNCTION (pb);
+  auto index = std::make_shared<PacketsByRnti> ();
+  IndexPacketsByRnti (pb, index.get ());
+  return index;
+}
+
+void
+NrSpectrumSignalParametersDataFrame::IndexPacketsByRnti (const Ptr<const PacketBurst> &pb, PacketsByRnti *index)
+{
+  NS_LOG_FUNCTION (pb);
+  index->clear ();
+  index->reserve (pb->GetNPackets ());
+  for (auto it = pb->Begin (); it != pb->End (); ++it)
+    {
+      if ((*it)->GetSize () == 0)
+        {
+          continue;
+        }
+
+      LteRadioBearerTag bearerTag;
+      if ((*it)->PeekPacketTag (bearerTag) == false)
+        {
+          NS_FATAL_ERROR ("No radio bearer tag found");
+        }
+      index->emplace_back (bearerTag.GetRnti (), *it);
+    }
+
+  // The bursts of the UEs only have their RNTI, and are already sorted:
+  // std::stable_sort would allocate its buffer for nothing
+  auto byRnti = [] (const std::pair<uint16_t, Ptr<Packet> > &a, const std::pair<uint16_t, Ptr<Packet> > &b)
+    { return a.first < b.first; };
+  if (!std::is_sorted (index->begin (), index->end (), byRnti))
+    {
+      std::stable_sort (index->begin (), index->end (), byRnti);
     }
-  ctrlMsgList = p.ctrlMsgList;
 }
 
 Ptr<SpectrumSignalParameters>
@@ -74,7 +139,7 @@ NrSpectrumSignalParametersDlCtrlFrame::NrSpectrumSignalParametersDlCtrlFrame (co
   NS_LOG_FUNCTION (this << &p);
   cellId = p.cellId;
   pss = p.pss;
-  ctrlMsgList = p.ctrlMsgList;
+  ctrlMsgBundle = p.ctrlMsgBundle;
 }
 
 Ptr<SpectrumSignalParameters>
@@ -22,13 +22,27 @@
 #define NR_SPECTRUM_SIGNAL_PARAMETERS_H
 
 #include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <ns3/packet.h>
 #include <ns3/spectrum-signal-parameters.h>
+#include "nr-control-message-bundle.h"
 
 namespace ns3 {
 
 class PacketBurst;
 class NrControlMessage;
 
+/**
+ * \ingroup utils
+ * \brief The control messages of a signal, shared by all its receivers
+ *
+ * The channel copies the signal parameters for each receiver: the copies
+ * share the list, which must not be modified.
+ */
+typedef std::shared_ptr<const std::list<Ptr<NrControlMessage> > > NrSharedCtrlMsgList;
+
 /**
  * \ingroup spectrum
  *
@@ -55,9 +69,53 @@ struct NrSpectrumSignalParametersDataFrame : public SpectrumSignalParameters
    */
   NrSpectrumSignalParametersDataFrame (const NrSpectrumSignalParametersDataFrame& p);
 
-  Ptr<PacketBurst> packetBurst;                       //!< Packet burst
-  std::list<Ptr<NrControlMessage> > ctrlMsgList;  //!< List of contrl messages
+  /**
+   * \brief Allocate the memory of the signal parameters
+   *
+   * The parameters of a DATA signal are created by the transmitter, and
+   * copied by the channel for each receiver, at each transmission: their
+   * memory is recycled through NrPoolAllocator.
+   *
+   * \param size the size of the object
+   * \return the memory
+   */
+  static void * operator new (std::size_t size);
+
+  /**
+   * \brief Give back the memory of the signal parameters
+   * \param p the memory
+   * \param size the size of the object
+   */
+  static void operator delete (void *p, std::size_t size);
+
+  /**
+   * \brief The packets of a burst with their RNTI, sorted by RNTI (the
+   * packets of the same RNTI keep the order of the burst)
+   */
+  typedef std::vector<std::pair<uint16_t, Ptr<Packet> > > PacketsByRnti;
+
+  /**
+   * \brief Index the packets of a burst by the RNTI of their LteRadioBearerTag
+   *
+   * The empty packets are skipped.
+   *
+   * \param pb the packet burst
+   * \return the index
+   */
+  static std::shared_ptr<const PacketsByRnti> IndexPacketsByRnti (const Ptr<const PacketBurst> &pb);
+
+  /**
+   * \brief Index the packets of a burst in an existing index, reusing its memory
+   * \param pb the packet burst
+   * \param index the index, cleared first
+   */
+  static void IndexPacketsByRnti (const Ptr<const PacketBurst> &pb, PacketsByRnti *index);
+
+  Ptr<PacketBurst> packetBurst;                       //!< Packet burst, shared by all the receivers
+  std::shared_ptr<const PacketsByRnti> packetsByRnti; //!< The packets of the burst by RNTI, shared by all the receivers
+  NrSharedCtrlMsgList ctrlMsgList;                    //!< Control messages, shared by all the receivers (null if there are none)
   uint16_t cellId;                                    //!< CellId
+  uint8_t numLayers {1};                              //!< Number of MU-MIMO layers sent with this one
 };
 
 /**
@@ -87,7 +145,7 @@ struct NrSpectrumSignalParametersDlCtrlFrame : public SpectrumSignalParameters
   NrSpectrumSignalParametersDlCtrlFrame (const NrSpectrumSignalParametersDlCtrlFrame& p);
 
 
-  std::list<Ptr<NrControlMessage> > ctrlMsgList;  //!< CTRL message list
+  Ptr<const NrControlMessageBundle> ctrlMsgBundle;  //!< CTRL messages, shared by all the receivers
   bool pss;                                           //!< PSS (?)
   uint16_t cellId;                                    //!< cell id
 };
@@ -120,7 +178,7 @@ struct NrSpectrumSignalParametersUlCtrlFrame : public SpectrumSignalParameters
   NrSpectrumSignalParametersUlCtrlFrame (const NrSpectrumSignalParametersUlCtrlFrame& p);
 
 
-  std::list<Ptr<NrControlMessage> > ctrlMsgList;  //!< CTRL message list
+  NrSharedCtrlMsgList ctrlMsgList;                    //!< CTRL messages, shared by all the receivers
   uint16_t cellId;                                    //!< cell id
 };
 
@@ -0,0 +1,65 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_STORAGE_PRECISION_H
+#define NR_STORAGE_PRECISION_H
+
+#include <type_traits>
+
+/**
+ * \ingroup nr-utils
+ * \brief 1 to store the per-RB powers and SINRs kept by the module in single
+ * precision
+ *
+ * Set by the CMake option NR_SINGLE_PRECISION_STORAGE. When 0, NrStorageReal
+ * is double, and the results are the same as without the option.
+ */
+#ifndef NR_SINGLE_PRECISION_STORAGE
+#define NR_SINGLE_PRECISION_STORAGE 0
+#endif
+
+namespace ns3 {
+
+/**
+ * \ingroup nr-utils
+ * \brief The type of the per-RB values that the module keeps between events
+ *
+ * It is used by the buffers that live longer than a computation, and whose
+ * size is the number of RBs times the number of receivers or HARQ processes:
+ * - the energy accumulated by NrInterference for the average interference;
+ * - the per-RB SINRs of the HARQ history (NrEesmErrorModelOutput);
+ * - the per-RB SINRs of the UL CQI reports read by the schedulers
+ *   (UlCqiInfo::m_sinr).
+ *
+ * The values are converted from and to double at the SpectrumValue boundary,
+ * and the computations on them (exponentials, effective SINR) are in double;
+ * only the running sums are rounded to the storage type at each step. In
+ * single precision, each stored value has a relative error below 6e-8
+ * (2^-24), i.e. below 3e-7 dB: far below the resolution of the
+ * BLER-SINR tables and of the CQI thresholds, so the MCS and CQI choices
+ * only change when a SINR is within that distance of a threshold. The
+ * results are then not bit-identical to the double precision ones, but the
+ * KPIs are within the statistical noise of a run (check them with
+ * NrEquivalenceChecker). Energies below 1e-38 (the smallest normal float)
+ * lose precision, which is far below any thermal noise.
+ */
+using NrStorageReal = std::conditional<NR_SINGLE_PRECISION_STORAGE != 0, float, double>::type;
+
+} // namespace ns3
+
+#endif // NR_STORAGE_PRECISION_H
@@ -0,0 +1,184 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-ue-lcp.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrUeLcp");
+
+// A byte is 8000 millibits
+static const int64_t MILLIBITS_PER_BYTE = 8000;
+
+void
+NrUeLcp::AddLc (uint8_t lcId, uint8_t priority, uint64_t pbrKbps, uint64_t bsdMs, uint64_t nowUs)
+{
+  NS_LOG_FUNCTION (this << +lcId << +priority << pbrKbps << bsdMs);
+  Lc lc;
+  lc.m_priority = priority;
+  lc.m_pbrKbps = pbrKbps;
+  // kbit/s * ms = bit, that is 1000 millibits
+  lc.m_bucketSize = static_cast<int64_t> (pbrKbps * bsdMs * 1000);
+  lc.m_lastRefillUs = nowUs;
+  m_lcs[lcId] = lc;
+}
+
+void
+NrUeLcp::RemoveLc (uint8_t lcId)
+{
+  NS_LOG_FUNCTION (this << +lcId);
+  m_lcs.erase (lcId);
+}
+
+void
+NrUeLcp::Refill (uint64_t nowUs)
+{
+  for (auto &it : m_lcs)
+    {
+      Lc &lc = it.second;
+      NS_ABORT_MSG_IF (nowUs < lc.m_lastRefillUs, "The time went back");
+      // kbit/s * us = millibit
+      int64_t growth = static_cast<int64_t> (lc.m_pbrKbps * (nowUs - lc.m_lastRefillUs));
+      lc.m_bucket = std::min (lc.m_bucket + growth, lc.m_bucketSize);
+      lc.m_lastRefillUs = nowUs;
+    }
+}
+
+std::vector<uint8_t>
+NrUeLcp::GetLcsByPriority () const
+{
+  std::vector<uint8_t> ids;
+  for (const auto &it : m_lcs)
+    {
+      ids.push_back (it.first);
+    }
+  // m_lcs is ordered by ID, so the stable sort keeps the ID order within a priority
+  std::stable_sort (ids.begin (), ids.end (), [this] (uint8_t a, uint8_t b)
+    {
+      return m_lcs.at (a).m_priority < m_lcs.at (b).m_priority;
+    });
+  return ids;
+}
+
+std::map<uint8_t, uint32_t>
+NrUeLcp::Allocate (uint32_t bytes, const std::map<uint8_t, uint32_t> &demand, uint32_t minBytes)
+{
+  NS_LOG_FUNCTION (this << bytes << minBytes);
+  std::map<uint8_t, uint32_t> alloc;
+  std::map<uint8_t, uint32_t> left;
+  for (const auto &it : demand)
+    {
+      if (it.second > 0 && m_lcs.find (it.first) != m_lcs.end ())
+        {
+          left[it.first] = it.second;
+        }
+    }
+
+  const std::vector<uint8_t> lcs = GetLcsByPriority ();
+
+  // First round: up to the bucket of each LC
+  for (uint8_t id : lcs)
+    {
+      Lc &lc = m_lcs.at (id);
+      auto it = left.find (id);
+      if (it == left.end () || lc.m_bucket <= 0 || bytes < minBytes)
+        {
+          continue;
+        }
+      uint32_t bucketBytes = static_cast<uint32_t> (std::min<int64_t> (
+                                                      (lc.m_bucket + MILLIBITS_PER_BYTE - 1) / MILLIBITS_PER_BYTE,
+                                                      UINT32_MAX));
+      uint32_t given = std::min ({bucketBytes, it->second, bytes});
+      if (given < minBytes)
+        {
+          // A bucket smaller than the minimum still gets the minimum, as
+          // it would get a whole RLC PDU
+          given = std::min ({minBytes, it->second, bytes});
+          if (given < minBytes)
+            {
+              continue;
+            }
+        }
+      alloc[id] += given;
+      it->second -= given;
+      bytes -= given;
+      lc.m_bucket -= static_cast<int64_t> (given) * MILLIBITS_PER_BYTE;
+      NS_LOG_DEBUG ("LC " << +id << " gets " << given << " B from its bucket, now " << lc.m_bucket << " mbit");
+    }
+
+  // Second round: strict priority, equal share within a priority
+  for (size_t i = 0; i < lcs.size () && bytes >= minBytes; )
+    {
+      size_t j = i;
+      std::vector<uint8_t> level;
+      while (j < lcs.size () && m_lcs.at (lcs[j]).m_priority == m_lcs.at (lcs[i]).m_priority)
+        {
+          auto it = left.find (lcs[j]);
+          if (it != left.end () && it->second > 0)
+            {
+              level.push_back (lcs[j]);
+            }
+          ++j;
+        }
+
+      // Share the bytes equally, giving back to the others what an LC cannot use
+      while (! level.empty () && bytes >= minBytes)
+        {
+          uint32_t share = std::max<uint32_t> (bytes / level.size (), minBytes);
+          std::vector<uint8_t> stillHungry;
+          for (uint8_t id : level)
+            {
+              uint32_t &l = left.at (id);
+              uint32_t given = std::min ({share, l, bytes});
+              if (given < minBytes && given < l)
+                {
+                  continue;
+                }
+              alloc[id] += given;
+              l -= given;
+              bytes -= given;
+              if (l > 0)
+                {
+                  stillHungry.push_back (id);
+                }
+            }
+          if (stillHungry.size () == level.size ())
+            {
+              // Nobody was satisfied: the bytes were divided as much as possible
+              break;
+            }
+          level = stillHungry;
+        }
+      i = j;
+    }
+
+  return alloc;
+}
+
+int64_t
+NrUeLcp::GetBucketBytes (uint8_t lcId) const
+{
+  int64_t bucket = m_lcs.at (lcId).m_bucket;
+  return bucket >= 0 ? bucket / MILLIBITS_PER_BYTE : -((-bucket) / MILLIBITS_PER_BYTE);
+}
+
+} // namespace ns3
@@ -0,0 +1,112 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_UE_LCP_H
+#define NR_UE_LCP_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup ue-mac
+ * \brief Logical channel prioritization of the UE (TS 38.321, 5.4.3.1)
+ *
+ * Each LC has a priority (lower value, higher priority), a prioritized bit
+ * rate (PBR) and a bucket size duration (BSD). Its bucket Bj grows by PBR
+ * for the time elapsed, up to PBR * BSD, and is initialized to zero when
+ * the LC is added. A grant is distributed in two rounds:
+ *
+ * - in decreasing priority, each LC with Bj > 0 gets up to Bj bytes, and
+ * Bj is decremented by what it got (it can go negative);
+ * - the rest goes to the LCs in decreasing priority, strictly, up to their
+ * data; the LCs with the same priority share it equally.
+ *
+ * The buckets are kept in millibits (kbit/s times us), so that the refill
+ * and the distribution use only integer arithmetic and do not lose the
+ * fractions of byte between two grants.
+ */
+class NrUeLcp
+{
+public:
+  /**
+   * \brief Add a LC
+   * \param lcId the LC ID
+   * \param priority the priority, lower value is higher priority
+   * \param pbrKbps the prioritized bit rate, in kbit/s
+   * \param bsdMs the bucket size duration, in ms
+   * \param nowUs the current time, in us
+   */
+  void AddLc (uint8_t lcId, uint8_t priority, uint64_t pbrKbps, uint64_t bsdMs, uint64_t nowUs);
+
+  /**
+   * \brief Remove a LC
+   * \param lcId the LC ID
+   */
+  void RemoveLc (uint8_t lcId);
+
+  /**
+   * \brief Grow the buckets up to a time
+   * \param nowUs the current time, in us
+   */
+  void Refill (uint64_t nowUs);
+
+  /**
+   * \brief Distribute a grant
+   * \param bytes the bytes of the grant
+   * \param demand the bytes that each LC could use
+   * \param minBytes the minimum useful allocation of a LC (e.g., subheader
+   * plus the minimum RLC PDU); less than that is not allocated
+   * \return the bytes allocated to each LC, for the LCs that got some
+   */
+  std::map<uint8_t, uint32_t> Allocate (uint32_t bytes, const std::map<uint8_t, uint32_t> &demand,
+                                        uint32_t minBytes);
+
+  /**
+   * \param lcId the LC ID
+   * \return the bytes in the bucket of the LC (negative if it used more
+   * than its PBR)
+   */
+  int64_t GetBucketBytes (uint8_t lcId) const;
+
+private:
+  /**
+   * \brief State of a LC
+   */
+  struct Lc
+  {
+    uint8_t m_priority {0};         //!< Priority, lower value is higher priority
+    uint64_t m_pbrKbps {0};         //!< Prioritized bit rate (kbit/s)
+    int64_t m_bucket {0};           //!< Bucket Bj (millibits)
+    int64_t m_bucketSize {0};       //!< Maximum bucket PBR * BSD (millibits)
+    uint64_t m_lastRefillUs {0};    //!< Time of the last refill (us)
+  };
+
+  /**
+   * \return the LC IDs in decreasing priority, and increasing ID for the same priority
+   */
+  std::vector<uint8_t> GetLcsByPriority () const;
+
+  std::map<uint8_t, Lc> m_lcs;      //!< The LCs
+};
+
+} // namespace ns3
+
+#endif // NR_UE_LCP_H
@@ -30,10 +30,12 @@
 #include <ns3/boolean.h>
 #include <ns3/lte-radio-bearer-tag.h>
 #include <ns3/random-variable-stream.h>
+#include <ns3/simulator.h>
 #include "nr-phy-sap.h"
 #include "nr-control-messages.h"
 #include "nr-mac-header-vs.h"
 #include "nr-mac-short-bsr-ce.h"
+#include "nr-counters.h"
 
 namespace ns3 {
 
@@ -225,6 +227,12 @@ NrUeMac::GetTypeId (void)
                     MakeUintegerAccessor (&NrUeMac::SetNumHarqProcess,
                                           &NrUeMac::GetNumHarqProcess),
                     MakeUintegerChecker<uint8_t> ())
+    .AddAttribute ("LogicalChannelPrioritization",
+                   "Distribute the UL grants among the LCs with the priority, prioritized "
+                   "bit rate and bucket size duration of TS 38.321, instead of equally",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrUeMac::m_lcpEnabled),
+                   MakeBooleanChecker ())
     .AddTraceSource ("UeMacRxedCtrlMsgsTrace",
                      "Ue MAC Control Messages Traces.",
                      MakeTraceSourceAccessor (&NrUeMac::m_macRxedCtrlMsgsTrace),
@@ -233,6 +241,11 @@ NrUeMac::GetTypeId (void)
                      "Ue MAC Control Messages Traces.",
                      MakeTraceSourceAccessor (&NrUeMac::m_macTxedCtrlMsgsTrace),
                      "ns3::NrMacRxTrace::TxedUeMacCtrlMsgsTracedCallback")
+    .AddTraceSource ("DlLatencyBreakdown",
+                     "Latency breakdown of the DL PDUs decoded, "
+                     "when NrLatencyTag is enabled.",
+                     MakeTraceSourceAccessor (&NrUeMac::m_dlLatencyBreakdown),
+                     "ns3::NrUeMac::LatencyBreakdownTracedCallback")
   ;
   return tid;
 }
@@ -254,7 +267,6 @@ void
 NrUeMac::DoDispose ()
 {
   m_miUlHarqProcessesPacket.clear ();
-  m_miUlHarqProcessesPacketTimer.clear ();
   m_ulBsrReceived.clear ();
   m_lcInfoMap.clear ();
   m_raPreambleUniformVariable = nullptr;
@@ -339,7 +351,6 @@ NrUeMac::SetNumHarqProcess (uint8_t numHarqProcess)
           m_miUlHarqProcessesPacket.at (i).m_pktBurst = pb;
         }
     }
-  m_miUlHarqProcessesPacketTimer.resize (GetNumHarqProcess (), 0);
 }
 
 /**
@@ -369,8 +380,12 @@ NrUeMac::DoTransmitPdu (LteMacSapProvider::TransmitPduParameters params)
   LteRadioBearerTag bearerTag (params.rnti, params.lcid, params.layer);
   params.pdu->AddPacketTag (bearerTag);
 
+  if (NrLatencyTag::IsEnabled ())
+    {
+      NrLatencyTag::StampFirstTx (params.pdu);
+    }
+
   m_miUlHarqProcessesPacket.at (params.harqProcessId).m_pktBurst->AddPacket (params.pdu);
-  m_miUlHarqProcessesPacketTimer.at (params.harqProcessId) = GetNumHarqProcess();
 
   m_ulDciTotalUsed += params.pdu->GetSize ();
 
@@ -403,6 +418,7 @@ NrUeMac::DoReportBufferStatus (LteMacSapProvider::ReportBufferStatusParameters p
       NS_LOG_INFO ("INACTIVE -> TO_SEND, bufSize " << GetTotalBufSize ());
       m_srState = TO_SEND;
     }
+  m_phySapProvider->NotifyActivity ();
 }
 
 
@@ -468,11 +484,14 @@ NrUeMac::SendReportBufferStatus (const SfnSf &dataSfn, uint8_t symStart)
   bsr.m_macCeValue.m_bufferStatus.push_back (NrMacShortBsrCe::FromBytesToLevel (queue.at (3)));
 
   // create the message. It is used only for tracing, but we don't send it...
-  Ptr<NrBsrMessage> msg = Create<NrBsrMessage> ();
-  msg->SetSourceBwp (GetBwpId ());
-  msg->SetBsr (bsr);
+  if (!m_macTxedCtrlMsgsTrace.IsEmpty ())
+    {
+      Ptr<NrBsrMessage> msg = Create<NrBsrMessage> ();
+      msg->SetSourceBwp (GetBwpId ());
+      msg->SetBsr (bsr);
 
-  m_macTxedCtrlMsgsTrace (m_currentSlot, GetCellId (), bsr.m_rnti, GetBwpId (), msg);
+      m_macTxedCtrlMsgsTrace (m_currentSlot, GetCellId (), bsr.m_rnti, GetBwpId (), msg);
+    }
 
   // Here we send the real SHORT_BSR, as a subpdu.
   Ptr<Packet> p = Create<Packet> ();
@@ -514,31 +533,6 @@ NrUeMac::GetUeCmacSapProvider (void)
   return m_cmacSapProvider;
 }
 
-void
-NrUeMac::RefreshHarqProcessesPacketBuffer (void)
-{
-  NS_LOG_FUNCTION (this);
-
-  for (uint16_t i = 0; i < m_miUlHarqProcessesPacketTimer.size (); i++)
-    {
-      if (m_miUlHarqProcessesPacketTimer.at (i) == 0 && m_miUlHarqProcessesPacket.at (i).m_pktBurst)
-        {
-          if (m_miUlHarqProcessesPacket.at (i).m_pktBurst->GetSize () > 0)
-            {
-              // timer expired: drop packets in buffer for this process
-              NS_LOG_INFO ("HARQ Proc Id " << i << " packets buffer expired");
-              Ptr<PacketBurst> emptyPb = CreateObject <PacketBurst> ();
-              m_miUlHarqProcessesPacket.at (i).m_pktBurst = emptyPb;
-              m_miUlHarqProcessesPacket.at (i).m_lcidList.clear ();
-            }
-        }
-      else
-        {
-          //m_miUlHarqProcessesPacketTimer.at (i)--;  // ignore HARQ timeout
-        }
-    }
-}
-
 void
 NrUeMac::DoSlotIndication (const SfnSf &sfn)
 {
@@ -546,7 +540,8 @@ NrUeMac::DoSlotIndication (const SfnSf &sfn)
   m_currentSlot = sfn;
   NS_LOG_INFO ("Slot " << m_currentSlot);
 
-  RefreshHarqProcessesPacketBuffer ();
+  // The packets of the UL HARQ processes do not expire (the HARQ timeout is
+  // ignored): a process is touched only when it transmits or retransmits
 
   if (m_srState == TO_SEND)
     {
@@ -582,6 +577,7 @@ void
 NrUeMac::DoReceivePhyPdu (Ptr<Packet> p)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::MAC_EVENTS);
 
   LteRadioBearerTag tag;
   p->RemovePacketTag (tag);
@@ -591,6 +587,17 @@ NrUeMac::DoReceivePhyPdu (Ptr<Packet> p)
       return;
     }
 
+  NrLatencyBreakdown breakdown;
+  if (NrLatencyTag::IsEnabled () && NrLatencyTag::GetBreakdown (p, &breakdown))
+    {
+      breakdown.m_cellId = GetCellId ();
+      breakdown.m_bwpId = GetBwpId ();
+      breakdown.m_rnti = m_rnti;
+      breakdown.m_lcid = tag.GetLcid ();
+      breakdown.m_size = p->GetSize ();
+      m_dlLatencyBreakdown (breakdown);
+    }
+
   NrMacHeaderVs header;
   p->RemoveHeader (header);
 
@@ -709,6 +716,10 @@ NrUeMac::TransmitRetx ()
 
   for (std::list<Ptr<Packet> >::const_iterator j = pb->Begin (); j != pb->End (); ++j)
     {
+      if (NrLatencyTag::IsEnabled ())
+        {
+          NrLatencyTag::StampRetx (*j);
+        }
       Ptr<Packet> pkt = (*j)->Copy ();
       LteRadioBearerTag bearerTag;
       if (!pkt->PeekPacketTag (bearerTag))
@@ -721,8 +732,6 @@ NrUeMac::TransmitRetx ()
       uint8_t streamId = 0;
       m_phySapProvider->SendMacPdu (pkt, m_ulDciSfnsf, m_ulDci->m_symStart, streamId);
     }
-
-  m_miUlHarqProcessesPacketTimer.at (m_ulDci->m_harqProcess) = GetNumHarqProcess();
 }
 
 void
@@ -823,14 +832,76 @@ NrUeMac::SendTxData(uint32_t usefulTbs, uint32_t activeTx)
     }
 }
 
+void
+NrUeMac::SendLcpData (uint32_t usefulTbs)
+{
+  NS_LOG_FUNCTION (this << usefulTbs);
+
+  m_lcp.Refill (Simulator::Now ().GetMicroSeconds ());
+
+  // Each queue needs 3 bytes of MAC subheader
+  std::map<uint8_t, uint32_t> demand;
+  for (const auto & itBsr : m_ulBsrReceived)
+    {
+      const auto &bsr = itBsr.second;
+      uint32_t bytes = 0;
+      bytes += bsr.retxQueueSize > 0 ? bsr.retxQueueSize + 3 : 0;
+      bytes += bsr.txQueueSize > 0 ? bsr.txQueueSize + 3 : 0;
+      demand[bsr.lcid] = bytes;
+    }
+
+  // 10 because 3 bytes will go for MAC subheader
+  // and we should ensure to pass to RLC AM at least 7 bytes
+  for (const auto & itAlloc : m_lcp.Allocate (usefulTbs, demand, 10))
+    {
+      auto &bsr = m_ulBsrReceived.at (itAlloc.first);
+      uint32_t bytes = itAlloc.second;
+
+      for (bool retx : {true, false})
+        {
+          uint32_t &queue = retx ? bsr.retxQueueSize : bsr.txQueueSize;
+          if (queue == 0 || bytes < 10)
+            {
+              continue;
+            }
+          uint32_t opportunity = std::min (bytes, queue + 3);
+          // The left-over of the retx queue, if too small, goes with it
+          if (retx && bytes - opportunity < 10)
+            {
+              opportunity = bytes;
+            }
+
+          LteMacSapUser::TxOpportunityParameters txParams;
+          txParams.lcid = bsr.lcid;
+          txParams.rnti = m_rnti;
+          txParams.bytes = opportunity - 3;
+          txParams.layer = 0;
+          txParams.harqId = m_ulDci->m_harqProcess;
+          txParams.componentCarrierId = GetBwpId ();
+
+          NS_LOG_INFO ("Notifying RLC of LCID " << +bsr.lcid << " of a TxOpp "
+                       "of " << txParams.bytes << " B for a " << (retx ? "RETX" : "TX") <<
+                       " PDU, bucket " << m_lcp.GetBucketBytes (bsr.lcid) << " B");
+
+          m_lcInfoMap.at (bsr.lcid).macSapUser->NotifyTxOpportunity (txParams);
+          queue -= std::min (txParams.bytes, queue);
+          bytes -= opportunity;
+        }
+    }
+}
+
 void
 NrUeMac::SendNewData ()
 {
   NS_LOG_FUNCTION (this);
-  // New transmission -> empty pkt buffer queue (for deleting eventual pkts not acked )
-  Ptr<PacketBurst> pb = CreateObject <PacketBurst> ();
-  m_miUlHarqProcessesPacket.at (m_ulDci->m_harqProcess).m_pktBurst = pb;
-  m_miUlHarqProcessesPacket.at (m_ulDci->m_harqProcess).m_lcidList.clear ();
+  // New transmission -> empty pkt buffer queue (for deleting eventual pkts not acked ).
+  // A burst that is already empty is kept.
+  UlHarqProcessInfo &harqInfo = m_miUlHarqProcessesPacket.at (m_ulDci->m_harqProcess);
+  if (harqInfo.m_pktBurst == nullptr || harqInfo.m_pktBurst->GetNPackets () > 0)
+    {
+      harqInfo.m_pktBurst = CreateObject <PacketBurst> ();
+    }
+  harqInfo.m_lcidList.clear ();
   NS_LOG_INFO ("Reset HARQP " << +m_ulDci->m_harqProcess);
 
   // Sending the status data has no boundary: let's try to send the ACK as
@@ -868,9 +939,16 @@ NrUeMac::SendNewData ()
       NS_LOG_LOGIC ("This UE tx opportunity will be wasted: " << usefulTbs << " bytes.");
    }
 
+  if (m_lcpEnabled)
+    {
+      if (usefulTbs > 0)
+        {
+          SendLcpData (usefulTbs);
+        }
+    }
   // this check is needed, because if there are no active LCS we should not
   // enter into else and call the function SendRetxData
-  if (activeLcsRetx > 0 && usefulTbs > 0)// the queues with some RETX data.
+  else if (activeLcsRetx > 0 && usefulTbs > 0)// the queues with some RETX data.
     {
       // 10 because 3 bytes will go for MAC subheader
       // and we should ensure to pass to RLC AM at least 7 bytes
@@ -894,8 +972,8 @@ NrUeMac::SendNewData ()
   usefulTbs = m_ulDci->m_tbSize.at (0) - m_ulDciTotalUsed - 5; // Update the usefulTbs.
 
   // The last part is for the queues with some non-RETX data. If there is no space left,
-  // then nothing.
-  if (activeLcsTx > 0 && usefulTbs > 0)// the queues with some TX data.
+  // then nothing. With the LCP, they were already served.
+  if (!m_lcpEnabled && activeLcsTx > 0 && usefulTbs > 0)// the queues with some TX data.
     {
       // 10 because 3 bytes will go for MAC subheader
       // and we should ensure to pass to RLC AM at least 7 bytes
@@ -1032,9 +1110,32 @@ void
 NrUeMac::DoStartContentionBasedRandomAccessProcedure ()
 {
   NS_LOG_FUNCTION (this);
+  if (!m_idealRaCallback.IsNull ())
+    {
+      // Not in the call of the RRC, that is still changing its state
+      Simulator::ScheduleNow (&NrUeMac::DoIdealRandomAccess, this);
+      return;
+    }
   RandomlySelectAndSendRaPreamble ();
 }
 
+void
+NrUeMac::SetIdealRandomAccessCallback (const Callback<uint16_t> &cb)
+{
+  m_idealRaCallback = cb;
+}
+
+void
+NrUeMac::DoIdealRandomAccess ()
+{
+  NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::MAC_EVENTS);
+  BuildRarListElement_s raResponse;
+  raResponse.m_rnti = m_idealRaCallback ();
+  NS_LOG_DEBUG (m_currentSlot << " Ideal random access, got RNTI " << raResponse.m_rnti);
+  RecvRaResponse (raResponse);
+}
+
 void
 NrUeMac::RandomlySelectAndSendRaPreamble ()
 {
@@ -1052,9 +1153,13 @@ NrUeMac::SendRaPreamble ([[maybe_unused]] bool contention)
   /*raRnti should be subframeNo -1 */
   m_raRnti = 1;
 
-  Ptr<NrRachPreambleMessage> rachMsg = Create<NrRachPreambleMessage> ();
-  rachMsg->SetSourceBwp (GetBwpId ());
-  m_macTxedCtrlMsgsTrace (m_currentSlot, GetCellId (), m_rnti, GetBwpId (), rachMsg);
+  // The preamble is sent to the PHY by ID: the message is only traced
+  if (!m_macTxedCtrlMsgsTrace.IsEmpty ())
+    {
+      Ptr<NrRachPreambleMessage> rachMsg = Create<NrRachPreambleMessage> ();
+      rachMsg->SetSourceBwp (GetBwpId ());
+      m_macTxedCtrlMsgsTrace (m_currentSlot, GetCellId (), m_rnti, GetBwpId (), rachMsg);
+    }
 
   m_phySapProvider->SendRachPreamble (m_raPreambleId, m_raRnti);
 }
@@ -1077,12 +1182,16 @@ NrUeMac::AddLc (uint8_t lcId,  LteUeCmacSapProvider::LogicalChannelConfig lcConf
   lcInfo.lcConfig = lcConfig;
   lcInfo.macSapUser = msu;
   m_lcInfoMap[lcId] = lcInfo;
+
+  m_lcp.AddLc (lcId, lcConfig.priority, lcConfig.prioritizedBitrateKbps,
+               lcConfig.bucketSizeDurationMs, Simulator::Now ().GetMicroSeconds ());
 }
 
 void
 NrUeMac::DoRemoveLc (uint8_t lcId)
 {
   NS_LOG_FUNCTION (this << " lcId" << lcId);
+  m_lcp.RemoveLc (lcId);
 }
 
 LteMacSapProvider*
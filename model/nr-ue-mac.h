@@ -22,6 +22,8 @@
 
 #include "nr-phy-mac-common.h"
 #include "nr-mac-pdu-info.h"
+#include "nr-latency-tag.h"
+#include "nr-ue-lcp.h"
 
 #include <ns3/lte-ue-cmac-sap.h>
 #include <ns3/lte-ccm-mac-sap.h>
@@ -98,6 +100,11 @@ class NrUlDciMessage;
  * exception (theoretically possible) is when the status PDUs use all the
  * available space; in this case, a rework of the code will be needed.
  *
+ * When the attribute LogicalChannelPrioritization is true, the retx and tx
+ * data are instead distributed with the logical channel prioritization of
+ * TS 38.321 (see NrUeLcp and SendLcpData()): the priority, prioritized bit
+ * rate and bucket size duration of each LC come from its configuration.
+ *
  * The SHORT_BSR is not reflecting the standard, but it is the same data that
  * was sent in LENA, indicating the status of 4 LCG at once with an 8-bit value.
  * Making this part standard-compliant is a good novice exercise.
@@ -191,6 +198,13 @@ public:
     (const SfnSf sfnSf, const uint16_t nodeId, const uint16_t rnti,
      const uint8_t bwpId, Ptr<NrControlMessage> ctrlMessage);
 
+  /**
+   * TracedCallback signature for the latency breakdown of the decoded PDUs.
+   *
+   * \param [in] breakdown the latency breakdown of the PDU
+   */
+  typedef void (* LatencyBreakdownTracedCallback) (const NrLatencyBreakdown &breakdown);
+
   /**
    * \brief Sets the number of HARQ processes.
    * Called by the helper at the moment of UE attachment
@@ -206,6 +220,16 @@ public:
    */
   uint8_t GetNumHarqProcess () const;
 
+  /**
+   * \brief Set the function that performs the random access directly with the gNB MAC
+   * \param cb the function, that returns the temporary C-RNTI of the UE
+   *
+   * Called by the helper at the moment of UE attachment, when the attach is
+   * instant. The preamble is not sent over the air, and the RAR is not
+   * waited for: the RNTI is communicated to the RRC in the same instant.
+   */
+  void SetIdealRandomAccessCallback (const Callback<uint16_t> &cb);
+
   /**
    * \brief Assign a fixed random variable stream number to the random variables
    * used by this model. Returns the number of streams (possibly zero) that
@@ -239,6 +263,10 @@ private:
    * \param raResponse the response
    */
   void RecvRaResponse (BuildRarListElement_s raResponse);
+  /**
+   * \brief Get the RNTI from the gNB MAC, and receive it as a RA response
+   */
+  void DoIdealRandomAccess ();
   /**
    * \brief Set the RNTI
    */
@@ -312,7 +340,6 @@ private:
    * not get retransmitted.
    */
   void SendReportBufferStatus (const SfnSf &dataSfn, uint8_t symStart);
-  void RefreshHarqProcessesPacketBuffer (void);
 
   /**
    * \brief Process the received UL DCI
@@ -382,6 +409,17 @@ private:
    */
   void SendTxData (uint32_t usefulTbs, uint32_t activeTx);
 
+  /**
+   * \brief Send RETX and TX data with the logical channel prioritization
+   *
+   * \param usefulTbs TBS that we can use (data and subheaders)
+   *
+   * The buckets are refilled up to now, and the bytes that NrUeLcp gives
+   * to each LC are used first for its retxQueue and then for its txQueue,
+   * each with its own subheader.
+   */
+  void SendLcpData (uint32_t usefulTbs);
+
 private:
 
   LteUeCmacSapUser* m_cmacSapUser {nullptr};
@@ -441,7 +479,6 @@ private:
 
   //uint8_t m_harqProcessId;
   std::vector < UlHarqProcessInfo > m_miUlHarqProcessesPacket; //!< Packets under trasmission of the UL HARQ processes
-  std::vector < uint8_t > m_miUlHarqProcessesPacketTimer;      //!< timer for packet life in the buffer
 
   struct LcInfo
   {
@@ -450,10 +487,13 @@ private:
   };
 
   std::unordered_map <uint8_t, LcInfo> m_lcInfoMap;
+  NrUeLcp m_lcp;                   //!< Buckets and priorities of the LCs
+  bool m_lcpEnabled {false};       //!< Distribute the grants with the LCP (attribute)
   uint16_t m_rnti {0};
 
   bool m_waitingForRaResponse {true}; //!< Indicates if we are waiting for a RA response
   static uint8_t g_raPreambleId; //!< Preamble ID, fixed, the UEs will not have any collision
+  Callback<uint16_t> m_idealRaCallback; //!< Random access with the gNB MAC, if the attach is instant
 
   /**
    * Trace information regarding Ue MAC Received Control Messages
@@ -468,6 +508,11 @@ private:
    * pointer to message in order to get the msg type
    */
   TracedCallback<SfnSf, uint16_t, uint16_t, uint8_t, Ptr<const NrControlMessage>> m_macTxedCtrlMsgsTrace;
+
+  /**
+   * Trace of the latency breakdown of the DL PDUs decoded, see NrLatencyTag
+   */
+  TracedCallback<const NrLatencyBreakdown &> m_dlLatencyBreakdown;
 };
 
 }
@@ -35,12 +35,18 @@
 #include <ns3/lte-radio-bearer-tag.h>
 #include <algorithm>
 #include <cfloat>
+#include <cmath>
+#include <functional>
+#include <numeric>
 #include <ns3/boolean.h>
 #include <ns3/pointer.h>
 #include "beam-manager.h"
 #include "nr-ue-net-device.h"
+#include "nr-gnb-net-device.h"
+#include "nr-gnb-phy.h"
 #include "nr-ch-access-manager.h"
 #include "nr-ue-power-control.h"
+#include "nr-counters.h"
 #include <ns3/object-vector.h>
 
 namespace ns3 {
@@ -67,6 +73,7 @@ NrUePhy::DoDispose ()
   NS_LOG_FUNCTION (this);
   delete m_ueCphySapProvider;
   m_phyDlHarqFeedbackCallback = MakeNullCallback< void, const DlHarqInfo&> ();
+  m_varTtiTimeline.Cancel ();
   NrPhy::DoDispose ();
 }
 
@@ -134,6 +141,31 @@ NrUePhy::GetTypeId (void)
                    BooleanValue (true),
                    MakeBooleanAccessor (&NrUePhy::UseFixedRankIndicator),
                    MakeBooleanChecker ())
+    .AddAttribute ("SubbandCqi",
+                   "If true, the DL CQI reports are sub-band: besides the wideband "
+                   "CQI of each stream, they carry the CQI of each RBG of the first "
+                   "stream, that the scheduler can use for a frequency-selective "
+                   "assignment. If false, the reports are wideband.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrUePhy::SetSubbandCqi,
+                                        &NrUePhy::GetSubbandCqi),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CqiReportPeriodicity",
+                   "Number of slots between two DL CQI reports. The UE keeps the SINR of "
+                   "the last DL data reception of each stream, and computes and reports "
+                   "its CQI only in the slots at CqiReportOffset modulo this period, or "
+                   "after a reception whose DCI requested a report. If 0, the UE reports "
+                   "a CQI after each DL data reception.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrUePhy::SetCqiReportPeriodicity,
+                                         &NrUePhy::GetCqiReportPeriodicity),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("CqiReportOffset",
+                   "Slot, modulo CqiReportPeriodicity, of the periodic DL CQI reports",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrUePhy::SetCqiReportOffset,
+                                         &NrUePhy::GetCqiReportOffset),
+                   MakeUintegerChecker<uint16_t> ())
     .AddAttribute ("RiSinrThreshold1",
                    "The SINR threshold 1 in dB. It is used to adaptively choose"
                    "the rank indicator value when a UE is trying to switch from"
@@ -150,14 +182,38 @@ NrUePhy::GetTypeId (void)
                    "the rank indicator value once a UE has already switched to"
                    "two streams, i.e., it has already received the data on the"
                    "second stream and has measured its average SINR. The UE will"
-                   "report RI = 2 if the average SINR of both the stream is"
-                   "above this threshold; otherwise, it will report RI = 1."
+                   "report a RI equal to the number of streams with the average"
+                   "SINR above this threshold, and at least RI = 1."
                    "The initial threshold value of 10 dB is selected according to: "
                    "https://ieeexplore.ieee.org/abstract/document/6364098 Figure 2",
                    DoubleValue (10.0),
                    MakeDoubleAccessor (&NrUePhy::SetRiSinrThreshold2,
                                        &NrUePhy::GetRiSinrThreshold2),
                    MakeDoubleChecker<double> ())
+    .AddAttribute ("CapacityBasedRi",
+                   "If true, and UseFixedRi is false, the UE chooses the rank "
+                   "indicator that gives the largest expected TBS, estimated from "
+                   "the average SINR of the measured streams, instead of comparing "
+                   "the SINR with RiSinrThreshold1 and RiSinrThreshold2",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrUePhy::SetCapacityBasedRi,
+                                        &NrUePhy::GetCapacityBasedRi),
+                   MakeBooleanChecker ())
+    .AddAttribute ("CoalesceVarTtiEvents",
+                   "Schedule the starts and the ends of the varTTIs in a local timeline "
+                   "(NrVarTtiTimeline): the end of a varTTI and the start of the next "
+                   "one at the same time are run by one simulator event",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrUePhy::m_coalesceVarTtiEvents),
+                   MakeBooleanChecker ())
+    .AddAttribute ("RiHysteresis",
+                   "With CapacityBasedRi, the UE changes the rank indicator only if "
+                   "the expected TBS of the other rank is larger than the one of the "
+                   "current rank by this fraction",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&NrUePhy::SetRiHysteresis,
+                                       &NrUePhy::GetRiHysteresis),
+                   MakeDoubleChecker<double> (0.0))
     .AddTraceSource ("DlDataSinr",
                      "DL DATA SINR statistics.",
                      MakeTraceSourceAccessor (&NrUePhy::m_dlDataSinrTrace),
@@ -198,6 +254,45 @@ NrUePhy::GetTypeId (void)
                      "Power Spectral Density data.",
                      MakeTraceSourceAccessor (&NrUePhy::m_reportPowerSpectralDensity),
                      "ns3::NrUePhy::PowerSpectralDensityTracedCallback")
+    .AddAttribute ("InactivityTimer",
+                   "Time without DL or UL data after which the UE becomes idle: "
+                   "its slots are stopped and its spectrum phys drop the received "
+                   "signals, until it has UL data or it is paged by the gNB for DL "
+                   "data. A value of 0 disables the idle state",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&NrUePhy::m_inactivityTimer),
+                   MakeTimeChecker (Seconds (0)))
+    .AddAttribute ("IdleMonitoringPeriodicity",
+                   "Number of slots between two monitoring occasions of an idle UE. "
+                   "The UE runs the slots at IdleMonitoringOffset modulo this period "
+                   "with its reception enabled, as a DRX on duration of one slot, and "
+                   "becomes idle again at their end if nothing arrived. If 0, an idle "
+                   "UE only wakes up when it has UL data or it is paged",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrUePhy::m_idleMonitoringPeriodicity),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("IdleMonitoringOffset",
+                   "Slot, modulo IdleMonitoringPeriodicity, of the monitoring occasions "
+                   "of an idle UE",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrUePhy::m_idleMonitoringOffset),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("IdleCqiPeriodicity",
+                   "Minimum number of slots between two DL CQI reports of an idle UE. "
+                   "The report is sent from the first monitoring occasion after the "
+                   "period, with the CQI of the SINR of its DL CTRL, without restarting "
+                   "the inactivity timer. If 0, an idle UE does not report the CQI",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&NrUePhy::m_idleCqiPeriodicity),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("IdealControl",
+                   "Deliver the UL CTRL messages directly to the PHY of the gNB "
+                   "at the end of the UL CTRL symbols, instead of transmitting a "
+                   "signal: there is no UL CTRL interference. The SRS are still "
+                   "transmitted",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrUePhy::m_idealCtrl),
+                   MakeBooleanChecker ())
       ;
   return tid;
 }
@@ -299,6 +394,7 @@ void
 NrUePhy::DoSendControlMessageNow (Ptr<NrControlMessage> msg)
 {
   NS_LOG_FUNCTION (this << msg);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
   EnqueueCtrlMsgNow (msg);
 }
 
@@ -396,6 +492,15 @@ NrUePhy::SetPattern (const std::string &pattern)
      }
 
    m_tddPattern = vector;
+   m_nextTddPattern.clear ();
+}
+
+void
+NrUePhy::ChangeTddPattern (const std::vector<LteNrTddSlotType> &pattern, uint64_t switchSlot)
+{
+  NS_LOG_FUNCTION (this << NrPhy::GetPattern (pattern) << switchSlot);
+  m_nextTddPattern = pattern;
+  m_tddSwitchSlot = switchSlot;
 }
 
 uint32_t
@@ -455,111 +560,148 @@ NrUePhy::InsertFutureAllocation (const SfnSf &sfnSf,
     }
 }
 
+const std::unordered_map<NrControlMessage::messageType, NrUePhy::CtrlMsgHandler> &
+NrUePhy::GetCtrlMsgHandlers ()
+{
+  static const std::unordered_map<NrControlMessage::messageType, CtrlMsgHandler> handlers
+  {
+    {NrControlMessage::DL_DCI, &NrUePhy::HandleDlDci},
+    {NrControlMessage::UL_DCI, &NrUePhy::HandleUlDci},
+    {NrControlMessage::MIB, &NrUePhy::HandleMib},
+    {NrControlMessage::SIB1, &NrUePhy::HandleSib1},
+    {NrControlMessage::RAR, &NrUePhy::HandleRar},
+  };
+  return handlers;
+}
+
 void
 NrUePhy::PhyCtrlMessagesReceived (const Ptr<NrControlMessage> &msg)
 {
   NS_LOG_FUNCTION (this);
+  m_slotActivity = true;
 
-  if (msg->GetMessageType () == NrControlMessage::DL_DCI)
+  // The DCIs of the other UEs are only traced
+  uint16_t rnti = NrControlMessageBundle::GetRnti (msg);
+  if (rnti != 0 && rnti != m_rnti)
     {
-      auto dciMsg = DynamicCast<NrDlDciMessage> (msg);
-      auto dciInfoElem = dciMsg->GetDciInfoElement ();
-
       m_phyRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), m_rnti, GetBwpId (), msg);
+      return;   // DCI not for me
+    }
 
-      if (dciInfoElem->m_rnti != 0 && dciInfoElem->m_rnti != m_rnti)
-        {
-          return;   // DCI not for me
-        }
+  const auto & handlers = GetCtrlMsgHandlers ();
+  auto it = handlers.find (msg->GetMessageType ());
+  if (it != handlers.end ())
+    {
+      (this->*(it->second)) (msg);
+    }
+  else
+    {
+      NS_LOG_INFO ("Message type not recognized " << msg->GetMessageType ());
+      m_phyRxedCtrlMsgsTrace (m_currentSlot,  GetCellId (), m_rnti, GetBwpId (), msg);
+      m_phySapUser->ReceiveControlMessage (msg);
+    }
+}
 
-      SfnSf dciSfn = m_currentSlot;
-      uint32_t k0Delay = dciMsg->GetKDelay ();
-      dciSfn.Add (k0Delay);
+void
+NrUePhy::HandleDlDci (const Ptr<NrControlMessage> &msg)
+{
+  auto dciMsg = StaticCast<NrDlDciMessage> (msg);
+  auto dciInfoElem = dciMsg->GetDciInfoElement ();
+  m_lastActivity = Simulator::Now ();
 
-      for (uint8_t stream = 0; stream < dciInfoElem->m_tbSize.size (); stream++)
-        {
-          NS_LOG_DEBUG ("UE" << m_rnti << " stream " << +stream <<
-                        " DL-DCI received for slot " << dciSfn <<
-                        " symStart " << static_cast<uint32_t> (dciInfoElem->m_symStart) <<
-                        " numSym " << static_cast<uint32_t> (dciInfoElem->m_numSym) <<
-                        " tbs " << dciInfoElem->m_tbSize.at (stream) <<
-                        " harqId " << static_cast<uint32_t> (dciInfoElem->m_harqProcess));
-        }
+  m_phyRxedCtrlMsgsTrace (m_currentSlot, GetCellId (), m_rnti, GetBwpId (), msg);
 
-      /* BIG ASSUMPTION: We assume that K0 is always 0 */
+  SfnSf dciSfn = m_currentSlot;
+  uint32_t k0Delay = dciMsg->GetKDelay ();
+  dciSfn.Add (k0Delay);
 
-      auto it = m_harqIdToK1Map.find (dciInfoElem->m_harqProcess);
-      if (it!=m_harqIdToK1Map.end ())
-        {
-          m_harqIdToK1Map.erase (m_harqIdToK1Map.find (dciInfoElem->m_harqProcess));
-        }
+  for (uint8_t stream = 0; stream < dciInfoElem->m_tbSize.size (); stream++)
+    {
+      NS_LOG_DEBUG ("UE" << m_rnti << " stream " << +stream <<
+                    " DL-DCI received for slot " << dciSfn <<
+                    " symStart " << static_cast<uint32_t> (dciInfoElem->m_symStart) <<
+                    " numSym " << static_cast<uint32_t> (dciInfoElem->m_numSym) <<
+                    " tbs " << dciInfoElem->m_tbSize.at (stream) <<
+                    " harqId " << static_cast<uint32_t> (dciInfoElem->m_harqProcess));
+    }
 
-      m_harqIdToK1Map.insert (std::make_pair (dciInfoElem->m_harqProcess, dciMsg->GetK1Delay ()));
+  /* BIG ASSUMPTION: We assume that K0 is always 0 */
 
-      m_phyUeRxedDlDciTrace (m_currentSlot, GetCellId (), m_rnti, GetBwpId (), dciInfoElem->m_harqProcess, dciMsg->GetK1Delay ());
+  auto it = m_harqIdToK1Map.find (dciInfoElem->m_harqProcess);
+  if (it!=m_harqIdToK1Map.end ())
+    {
+      m_harqIdToK1Map.erase (m_harqIdToK1Map.find (dciInfoElem->m_harqProcess));
+    }
 
-      InsertAllocation (dciInfoElem);
+  m_harqIdToK1Map.insert (std::make_pair (dciInfoElem->m_harqProcess, dciMsg->GetK1Delay ()));
 
-      m_phySapUser->ReceiveControlMessage (msg);
+  m_phyUeRxedDlDciTrace (m_currentSlot, GetCellId (), m_rnti, GetBwpId (), dciInfoElem->m_harqProcess, dciMsg->GetK1Delay ());
 
-      if (m_enableUplinkPowerControl)
-        {
-          m_powerControl->ReportTpcPusch (dciInfoElem->m_tpc);
-          m_powerControl->ReportTpcPucch (dciInfoElem->m_tpc);
-        }
+  if (dciInfoElem->m_cqiRequest)
+    {
+      // Aperiodic report: the CQI of this reception is reported at once
+      m_aperiodicCqiRequested = true;
     }
-  else if (msg->GetMessageType () == NrControlMessage::UL_DCI)
+
+  InsertAllocation (dciInfoElem);
+
+  m_phySapUser->ReceiveControlMessage (msg);
+
+  if (m_enableUplinkPowerControl)
     {
-      auto dciMsg = DynamicCast<NrUlDciMessage> (msg);
-      auto dciInfoElem = dciMsg->GetDciInfoElement ();
+      m_powerControl->ReportTpcPusch (dciInfoElem->m_tpc);
+      m_powerControl->ReportTpcPucch (dciInfoElem->m_tpc);
+    }
+}
 
-      m_phyRxedCtrlMsgsTrace (m_currentSlot,  GetCellId (), m_rnti, GetBwpId (), msg);
+void
+NrUePhy::HandleUlDci (const Ptr<NrControlMessage> &msg)
+{
+  auto dciMsg = StaticCast<NrUlDciMessage> (msg);
+  auto dciInfoElem = dciMsg->GetDciInfoElement ();
 
-      if (dciInfoElem->m_rnti != 0 && dciInfoElem->m_rnti != m_rnti)
-        {
-          return;   // DCI not for me
-        }
+  m_phyRxedCtrlMsgsTrace (m_currentSlot,  GetCellId (), m_rnti, GetBwpId (), msg);
 
-      SfnSf ulSfnSf = m_currentSlot;
-      uint32_t k2Delay = dciMsg->GetKDelay ();
-      ulSfnSf.Add (k2Delay);
+  SfnSf ulSfnSf = m_currentSlot;
+  uint32_t k2Delay = dciMsg->GetKDelay ();
+  ulSfnSf.Add (k2Delay);
 
-      if (dciInfoElem->m_type == DciInfoElementTdma::DATA)
-        {
-          ProcessDataDci (ulSfnSf, dciInfoElem);
-          m_phySapUser->ReceiveControlMessage (msg);
-        }
-      else if (dciInfoElem->m_type == DciInfoElementTdma::SRS)
-        {
-          ProcessSrsDci (ulSfnSf, dciInfoElem);
-          // Do not pass the DCI to MAC
-        }
-    }
-  else if (msg->GetMessageType () == NrControlMessage::MIB)
+  if (dciInfoElem->m_type == DciInfoElementTdma::DATA)
     {
-      NS_LOG_INFO ("received MIB");
-      Ptr<NrMibMessage> msg2 = DynamicCast<NrMibMessage> (msg);
-      m_phyRxedCtrlMsgsTrace (m_currentSlot,  GetCellId (), m_rnti, GetBwpId (), msg);
-      m_ueCphySapUser->RecvMasterInformationBlock (GetCellId (), msg2->GetMib ());
+      m_lastActivity = Simulator::Now ();
+      ProcessDataDci (ulSfnSf, dciInfoElem);
+      m_phySapUser->ReceiveControlMessage (msg);
     }
-  else if (msg->GetMessageType () == NrControlMessage::SIB1)
+  else if (dciInfoElem->m_type == DciInfoElementTdma::SRS)
     {
-      Ptr<NrSib1Message> msg2 = DynamicCast<NrSib1Message> (msg);
-      m_phyRxedCtrlMsgsTrace (m_currentSlot,  GetCellId (), m_rnti, GetBwpId (), msg);
-      m_ueCphySapUser->RecvSystemInformationBlockType1 (GetCellId (), msg2->GetSib1 ());
+      ProcessSrsDci (ulSfnSf, dciInfoElem);
+      // Do not pass the DCI to MAC
     }
-  else if (msg->GetMessageType () == NrControlMessage::RAR)
-    {
-      Ptr<NrRarMessage> rarMsg = DynamicCast<NrRarMessage> (msg);
+}
 
-      Simulator::Schedule ((GetSlotPeriod () * (GetL1L2CtrlLatency ()/2)), &NrUePhy::DoReceiveRar, this, rarMsg);
-    }
-  else
-    {
-      NS_LOG_INFO ("Message type not recognized " << msg->GetMessageType ());
-      m_phyRxedCtrlMsgsTrace (m_currentSlot,  GetCellId (), m_rnti, GetBwpId (), msg);
-      m_phySapUser->ReceiveControlMessage (msg);
-    }
+void
+NrUePhy::HandleMib (const Ptr<NrControlMessage> &msg)
+{
+  NS_LOG_INFO ("received MIB");
+  Ptr<NrMibMessage> msg2 = StaticCast<NrMibMessage> (msg);
+  m_phyRxedCtrlMsgsTrace (m_currentSlot,  GetCellId (), m_rnti, GetBwpId (), msg);
+  m_ueCphySapUser->RecvMasterInformationBlock (GetCellId (), msg2->GetMib ());
+}
+
+void
+NrUePhy::HandleSib1 (const Ptr<NrControlMessage> &msg)
+{
+  Ptr<NrSib1Message> msg2 = StaticCast<NrSib1Message> (msg);
+  m_phyRxedCtrlMsgsTrace (m_currentSlot,  GetCellId (), m_rnti, GetBwpId (), msg);
+  m_ueCphySapUser->RecvSystemInformationBlockType1 (GetCellId (), msg2->GetSib1 ());
+}
+
+void
+NrUePhy::HandleRar (const Ptr<NrControlMessage> &msg)
+{
+  Ptr<NrRarMessage> rarMsg = StaticCast<NrRarMessage> (msg);
+
+  Simulator::Schedule ((GetSlotPeriod () * (GetL1L2CtrlLatency ()/2)), &NrUePhy::DoReceiveRar, this, rarMsg);
 }
 
 void
@@ -641,6 +783,7 @@ void
 NrUePhy::RequestAccess ()
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
   NS_LOG_INFO ("Request access at " << Simulator::Now () << " because we have to transmit UL CTRL");
   m_cam->RequestAccess (); // This will put the m_channelStatus to granted when
                            // the channel will be granted.
@@ -650,6 +793,7 @@ void
 NrUePhy::DoReceiveRar (Ptr<NrRarMessage> rarMsg)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
 
   NS_LOG_INFO ("Received RAR in slot " << m_currentSlot);
   m_phyRxedCtrlMsgsTrace (m_currentSlot,  GetCellId (), m_rnti, GetBwpId (), rarMsg);
@@ -670,19 +814,27 @@ NrUePhy::PushCtrlAllocations (const SfnSf currentSfnSf)
 
   // The UE does not know anything from the GNB yet, so listen on the default
   // bandwidth.
-  std::vector<uint8_t> rbgBitmask (GetRbNum (), 1);
+  NrBitset rbgBitmask (GetRbNum (), true);
 
   // The UE still doesn't know the TDD pattern, so just add a DL CTRL
   if (m_tddPattern.size () == 0)
     {
       NS_LOG_INFO ("TDD Pattern unknown, insert DL CTRL at the beginning of the slot");
-      VarTtiAllocInfo dlCtrlSlot (std::make_shared<DciInfoElementTdma> (0, m_dlCtrlSyms,
-                                                                        DciInfoElementTdma::DL,
-                                                                        DciInfoElementTdma::CTRL, rbgBitmask));
+      VarTtiAllocInfo dlCtrlSlot (DciInfoElementTdma::Create (0, m_dlCtrlSyms,
+                                                              DciInfoElementTdma::DL,
+                                                              DciInfoElementTdma::CTRL, rbgBitmask));
       m_currSlotAllocInfo.m_varTtiAllocInfo.push_front (dlCtrlSlot);
       return;
     }
 
+  if (!m_nextTddPattern.empty () && currentSfnSf.Normalize () >= m_tddSwitchSlot)
+    {
+      // The switch slot is a multiple of the length of the new pattern
+      NS_LOG_INFO ("TDD pattern changed to " << NrPhy::GetPattern (m_nextTddPattern));
+      m_tddPattern = std::move (m_nextTddPattern);
+      m_nextTddPattern.clear ();
+    }
+
   uint64_t currentSlotN = currentSfnSf.Normalize () % m_tddPattern.size ();
 
   if (m_tddPattern[currentSlotN] < LteNrTddSlotType::UL)
@@ -690,9 +842,9 @@ NrUePhy::PushCtrlAllocations (const SfnSf currentSfnSf)
       NS_LOG_INFO ("The current TDD pattern indicates that we are in a " <<
                    m_tddPattern[currentSlotN] <<
                    " slot, so insert DL CTRL at the beginning of the slot");
-      VarTtiAllocInfo dlCtrlSlot (std::make_shared<DciInfoElementTdma> (0, m_dlCtrlSyms,
-                                                                        DciInfoElementTdma::DL,
-                                                                        DciInfoElementTdma::CTRL, rbgBitmask));
+      VarTtiAllocInfo dlCtrlSlot (DciInfoElementTdma::Create (0, m_dlCtrlSyms,
+                                                              DciInfoElementTdma::DL,
+                                                              DciInfoElementTdma::CTRL, rbgBitmask));
       m_currSlotAllocInfo.m_varTtiAllocInfo.push_front (dlCtrlSlot);
     }
   if (m_tddPattern[currentSlotN] > LteNrTddSlotType::DL)
@@ -700,10 +852,10 @@ NrUePhy::PushCtrlAllocations (const SfnSf currentSfnSf)
       NS_LOG_INFO ("The current TDD pattern indicates that we are in a " <<
                    m_tddPattern[currentSlotN] <<
                    " slot, so insert UL CTRL at the end of the slot");
-      VarTtiAllocInfo ulCtrlSlot (std::make_shared<DciInfoElementTdma> (GetSymbolsPerSlot () - m_ulCtrlSyms,
-                                                                        m_ulCtrlSyms,
-                                                                        DciInfoElementTdma::UL,
-                                                                        DciInfoElementTdma::CTRL, rbgBitmask));
+      VarTtiAllocInfo ulCtrlSlot (DciInfoElementTdma::Create (GetSymbolsPerSlot () - m_ulCtrlSyms,
+                                                              m_ulCtrlSyms,
+                                                              DciInfoElementTdma::UL,
+                                                              DciInfoElementTdma::CTRL, rbgBitmask));
       m_currSlotAllocInfo.m_varTtiAllocInfo.push_back (ulCtrlSlot);
     }
 }
@@ -712,6 +864,7 @@ void
 NrUePhy::StartSlot (const SfnSf &s)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
   m_currentSlot = s;
   m_lastSlotStart = Simulator::Now ();
 
@@ -730,6 +883,11 @@ NrUePhy::StartSlot (const SfnSf &s)
 
   PushCtrlAllocations (m_currentSlot);
 
+  if (m_cqiReportPeriodicity > 0)
+    {
+      SendPeriodicDlCqiReport ();
+    }
+
   NS_ASSERT (m_currSlotAllocInfo.m_sfnSf == m_currentSlot);
 
   NS_LOG_INFO ("UE " << m_rnti << " start slot " << m_currSlotAllocInfo.m_sfnSf <<
@@ -765,7 +923,7 @@ NrUePhy::StartSlot (const SfnSf &s)
 
   TryToPerformLbt ();
 
-  VarTtiAllocInfo allocation = m_currSlotAllocInfo.m_varTtiAllocInfo.front ();
+  VarTtiAllocInfo allocation = std::move (m_currSlotAllocInfo.m_varTtiAllocInfo.front ());
   m_currSlotAllocInfo.m_varTtiAllocInfo.pop_front ();
 
   auto nextVarTtiStart = GetSymbolPeriod () * allocation.m_dci->m_symStart;
@@ -787,7 +945,14 @@ NrUePhy::StartSlot (const SfnSf &s)
     }
 
 
-  Simulator::Schedule (nextVarTtiStart, &NrUePhy::StartVarTti, this, allocation.m_dci);
+  if (m_coalesceVarTtiEvents)
+    {
+      m_varTtiTimeline.Schedule (nextVarTtiStart, std::bind (&NrUePhy::StartVarTti, this, allocation.m_dci));
+    }
+  else
+    {
+      Simulator::Schedule (nextVarTtiStart, &NrUePhy::StartVarTti, this, allocation.m_dci);
+    }
 }
 
 
@@ -957,7 +1122,7 @@ NrUePhy::DlData (const std::shared_ptr<DciInfoElementTdma> &dci)
                         " RXing DL DATA frame for"
                         " symbols "  << +dci->m_symStart <<
                         "-" << +(dci->m_symStart + dci->m_numSym - 1) <<
-                        " num of rbg assigned: " << FromRBGBitmaskToRBAssignment (dci->m_rbgBitmask).size () <<
+                        " num of rbg assigned: " << dci->m_rbgBitmask.count () * GetNumRbPerRbg () <<
                         "\t start " << Simulator::Now () <<
                         " end " << (Simulator::Now () + varTtiDuration));
         }
@@ -972,7 +1137,7 @@ NrUePhy::UlData(const std::shared_ptr<DciInfoElementTdma> &dci)
   NS_LOG_FUNCTION (this);
   if (m_enableUplinkPowerControl)
     {
-      m_txPower = m_powerControl->GetPuschTxPower ((FromRBGBitmaskToRBAssignment(dci->m_rbgBitmask)).size());
+      m_txPower = m_powerControl->GetPuschTxPower (dci->m_rbgBitmask.count () * GetNumRbPerRbg ());
     }
   // Currently uplink DATA is transmitted over only 1 stream
   SetSubChannelsForTransmission (FromRBGBitmaskToRBAssignment (dci->m_rbgBitmask), dci->m_numSym, 1);
@@ -1016,6 +1181,7 @@ void
 NrUePhy::StartVarTti (const std::shared_ptr<DciInfoElementTdma> &dci)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
   Time varTtiDuration;
 
   for (auto const &it:dci->m_tbSize)
@@ -1046,7 +1212,14 @@ NrUePhy::StartVarTti (const std::shared_ptr<DciInfoElementTdma> &dci)
       varTtiDuration = UlData (dci);
     }
 
-  Simulator::Schedule (varTtiDuration, &NrUePhy::EndVarTti, this, dci);
+  if (m_coalesceVarTtiEvents)
+    {
+      m_varTtiTimeline.Schedule (varTtiDuration, std::bind (&NrUePhy::EndVarTti, this, dci));
+    }
+  else
+    {
+      Simulator::Schedule (varTtiDuration, &NrUePhy::EndVarTti, this, dci);
+    }
 }
 
 
@@ -1054,6 +1227,7 @@ void
 NrUePhy::EndVarTti (const std::shared_ptr<DciInfoElementTdma> &dci)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
   NS_LOG_INFO ("DCI started at symbol " << static_cast<uint32_t> (dci->m_symStart) <<
                " which lasted for " << static_cast<uint32_t> (dci->m_numSym) <<
                " symbols finished");
@@ -1069,26 +1243,232 @@ NrUePhy::EndVarTti (const std::shared_ptr<DciInfoElementTdma> &dci)
       // end of slot
       m_currentSlot.Add (1);
 
-      Simulator::Schedule (m_lastSlotStart + GetSlotPeriod () - Simulator::Now (),
-                           &NrUePhy::StartSlot, this, m_currentSlot);
+      Time slotStart = m_lastSlotStart + GetSlotPeriod ();
+      uint32_t idleSlots = GetIdleSlotsToSkip (slotStart);
+      m_slotActivity = false;
+      if (m_idleMonitoring)
+        {
+          // End of a monitoring occasion: the UE stays awake only if
+          // something arrived or is pending
+          m_idleMonitoring = false;
+          m_idleCqiDue = false;
+          m_idle = false;
+        }
+      if (IsInactive ())
+        {
+          EnterIdle ();
+        }
+      else if (idleSlots > 0)
+        {
+          m_fastForwardFirstSlot = m_currentSlot;
+          SfnSf startSlot = m_currentSlot;
+          startSlot.Add (idleSlots);
+          NS_LOG_INFO ("UE " << m_rnti << " skips the idle slots from " << m_currentSlot <<
+                       ", next slot " << startSlot);
+          m_fastForwardEvent = Simulator::Schedule (slotStart + GetSlotPeriod () * idleSlots - Simulator::Now (),
+                                                    &NrUePhy::EndFastForward, this, startSlot);
+        }
+      else
+        {
+          Simulator::Schedule (slotStart - Simulator::Now (),
+                               &NrUePhy::StartSlot, this, m_currentSlot);
+        }
     }
   else
     {
-      VarTtiAllocInfo allocation = m_currSlotAllocInfo.m_varTtiAllocInfo.front ();
+      VarTtiAllocInfo allocation = std::move (m_currSlotAllocInfo.m_varTtiAllocInfo.front ());
       m_currSlotAllocInfo.m_varTtiAllocInfo.pop_front ();
 
       Time nextVarTtiStart = GetSymbolPeriod () * allocation.m_dci->m_symStart;
 
-      Simulator::Schedule (nextVarTtiStart + m_lastSlotStart - Simulator::Now (),
-                           &NrUePhy::StartVarTti, this, allocation.m_dci);
+      if (m_coalesceVarTtiEvents)
+        {
+          m_varTtiTimeline.Schedule (nextVarTtiStart + m_lastSlotStart - Simulator::Now (),
+                                     std::bind (&NrUePhy::StartVarTti, this, allocation.m_dci));
+        }
+      else
+        {
+          Simulator::Schedule (nextVarTtiStart + m_lastSlotStart - Simulator::Now (),
+                               &NrUePhy::StartVarTti, this, allocation.m_dci);
+        }
     }
 
   m_receptionEnabled = false;
 }
 
+uint32_t
+NrUePhy::GetIdleSlotsToSkip (const Time &slotStart) const
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_gnbIdleUntil <= slotStart || m_slotActivity || m_rnti == 0 || m_hasPendingDlSinr
+      || HasPendingTransmissions ())
+    {
+      return 0;
+    }
+  return static_cast<uint32_t> ((m_gnbIdleUntil - slotStart).GetTimeStep () / GetSlotPeriod ().GetTimeStep ());
+}
+
+bool
+NrUePhy::IsInactive () const
+{
+  NS_LOG_FUNCTION (this);
+  return m_inactivityTimer.IsStrictlyPositive () && m_rnti != 0
+         && Simulator::Now () - m_lastActivity >= m_inactivityTimer
+         && !HasPendingTransmissions ();
+}
+
+void
+NrUePhy::EnterIdle ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_LOG_INFO ("UE " << m_rnti << " becomes idle after slot " << m_currentSlot);
+  // Nothing is scheduled: the slots restart at the next WakeUp
+  m_idle = true;
+  m_fastForwardFirstSlot = m_currentSlot;
+  for (const auto & spectrumPhy : m_spectrumPhys)
+    {
+      spectrumPhy->SetRxEnabled (false);
+    }
+
+  if (m_idleMonitoringPeriodicity > 0)
+    {
+      // m_currentSlot is the first slot skipped, which starts one slot
+      // period after the last one that was run
+      uint64_t slot = m_currentSlot.Normalize ();
+      uint64_t skip = (m_idleMonitoringOffset % m_idleMonitoringPeriodicity + m_idleMonitoringPeriodicity
+                       - slot % m_idleMonitoringPeriodicity) % m_idleMonitoringPeriodicity;
+      SfnSf occasion = m_currentSlot;
+      occasion.Add (skip);
+      Time start = m_lastSlotStart + GetSlotPeriod () * (skip + 1);
+      NS_LOG_INFO ("UE " << m_rnti << " next monitoring occasion " << occasion);
+      m_fastForwardEvent = Simulator::Schedule (start - Simulator::Now (), &NrUePhy::StartIdleMonitoring,
+                                                this, occasion);
+    }
+}
+
+void
+NrUePhy::StartIdleMonitoring (const SfnSf &slot)
+{
+  NS_LOG_FUNCTION (this << slot);
+  if (m_idle)
+    {
+      // The UE stays idle: IsIdle still holds, so that the gNB pages it
+      m_idleMonitoring = true;
+      for (const auto & spectrumPhy : m_spectrumPhys)
+        {
+          spectrumPhy->SetRxEnabled (true);
+        }
+      if (m_idleCqiPeriodicity > 0 && slot.Normalize () >= m_nextIdleCqiSlot)
+        {
+          m_idleCqiDue = true;
+          m_nextIdleCqiSlot = slot.Normalize () + m_idleCqiPeriodicity;
+        }
+    }
+  EndFastForward (slot);
+}
+
+bool
+NrUePhy::IsIdle () const
+{
+  return m_idle;
+}
+
+void
+NrUePhy::EndFastForward (const SfnSf &startSlot)
+{
+  NS_LOG_FUNCTION (this << startSlot);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
+  m_currentSlot = startSlot;
+  DiscardSlotAllocInfoBefore (startSlot);
+  StartSlot (startSlot);
+}
+
+void
+NrUePhy::NotifyGnbIdleUntil (uint16_t cellId, const Time &until)
+{
+  NS_LOG_FUNCTION (this << cellId << until);
+  if (cellId == GetCellId ())
+    {
+      m_gnbIdleUntil = until;
+      if (until <= Simulator::Now () && !m_idle && m_fastForwardEvent.IsRunning ())
+        {
+          RestartSlots ();
+        }
+    }
+}
+
+const std::list<Ptr<NrControlMessage> > &
+NrUePhy::GetRxCtrlMessages (const Ptr<const NrControlMessageBundle> &bundle) const
+{
+  if (m_phyRxedCtrlMsgsTrace.IsEmpty ())
+    {
+      return bundle->GetMessages (m_rnti);
+    }
+  return bundle->GetMessages ();
+}
+
+void
+NrUePhy::WakeUp ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_sendingIdleCqi)
+    {
+      // The report is sent in the next slots, which the UE runs while the
+      // message is pending: it is not an activity
+      return;
+    }
+  m_slotActivity = true;
+  m_lastActivity = Simulator::Now ();
+  m_gnbIdleUntil = Seconds (0);
+  if (m_idle)
+    {
+      NS_LOG_INFO ("UE " << m_rnti << " leaves the idle state");
+      m_idle = false;
+      for (const auto & spectrumPhy : m_spectrumPhys)
+        {
+          spectrumPhy->SetRxEnabled (true);
+        }
+      if (m_idleMonitoring)
+        {
+          // The slots of the monitoring occasion go on
+          m_idleMonitoring = false;
+          m_idleCqiDue = false;
+          return;
+        }
+    }
+  else if (!m_fastForwardEvent.IsRunning ())
+    {
+      return;
+    }
+  RestartSlots ();
+}
+
+void
+NrUePhy::RestartSlots ()
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t slots = GetSlotsToNextSlotStart (m_lastSlotStart);
+  SfnSf startSlot = m_fastForwardFirstSlot;
+  startSlot.Add (slots - 1);
+  Time start = m_lastSlotStart + GetSlotPeriod () * slots;
+  if (m_fastForwardEvent.IsRunning ()
+      && start >= Simulator::Now () + Simulator::GetDelayLeft (m_fastForwardEvent))
+    {
+      return;
+    }
+
+  NS_LOG_INFO ("UE " << m_rnti << " stops skipping the slots, next slot " << startSlot);
+  m_fastForwardEvent.Cancel ();
+  m_fastForwardEvent = Simulator::Schedule (start - Simulator::Now (), &NrUePhy::EndFastForward,
+                                            this, startSlot);
+}
+
 void
 NrUePhy::PhyDataPacketReceived (const Ptr<Packet> &p)
 {
+  m_slotActivity = true;
+  m_lastActivity = Simulator::Now ();
   Simulator::ScheduleWithContext (m_netDevice->GetNode ()->GetId (),
                                   GetTbDecodeLatency (),
                                   &NrUePhySapUser::ReceivePhyPdu,
@@ -1102,6 +1482,7 @@ NrUePhy::SendDataChannels (const Ptr<PacketBurst> &pb,
                            const std::list<Ptr<NrControlMessage> > &ctrlMsg,
                            const Time &duration)
 {
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
   if (pb->GetNPackets () > 0)
     {
       LteRadioBearerTag tag;
@@ -1118,6 +1499,19 @@ NrUePhy::SendDataChannels (const Ptr<PacketBurst> &pb,
 void
 NrUePhy::SendCtrlChannels (Time duration)
 {
+  Ptr<const NrGnbNetDevice> gnb = m_idealCtrl && m_netDevice != nullptr
+    ? DynamicCast<NrUeNetDevice> (m_netDevice)->GetTargetEnb ()
+    : nullptr;
+  if (gnb != nullptr)
+    {
+      NrCounters::Add (NrCounters::CTRL_MESSAGES, m_ctrlMsgs.size ());
+      Simulator::Schedule (duration, &NrSpectrumPhy::ReceiveIdealCtrl,
+                           gnb->GetPhy (GetBwpId ())->GetSpectrumPhy (0),
+                           Create<const NrControlMessageBundle> (m_ctrlMsgs));
+      m_ctrlMsgs.clear ();
+      return;
+    }
+
   // Uplink CTRL is sent only through a single stream, the first is assumed
   m_spectrumPhys.at (0)->StartTxUlControlFrames (m_ctrlMsgs, duration);
   m_ctrlMsgs.clear ();
@@ -1144,68 +1538,135 @@ NrUePhy::GenerateDlCqiReport (const SpectrumValue& sinr, uint8_t streamId)
     {
       m_dlDataSinrTrace (GetCellId (), m_rnti, ComputeAvgSinr (sinr), GetBwpId (), streamId);
 
-      // TODO
-      // Not sure what this IF is about, seems that it can be removed,
-      // if not, then we have to support wbCqiLast time per stream
-      // if (Simulator::Now () > m_wbCqiLast)
-      if (m_prevDlWbCqi.empty ()) // No DL CQI reported yet, initialize the vector
+      if (m_cqiReportPeriodicity > 0 && ! m_aperiodicCqiRequested)
         {
-          // Remember, scheduler uses MCS 0 for CQI 0.
-          // See, NrMacSchedulerCQIManagement::DlWBCQIReported
-          m_prevDlWbCqi = std::vector <uint8_t> (m_spectrumPhys.size (), 0);
-          m_reportedRi2 = false; // already initialized to false in the header, added here for readability
+          // Keep the SINR until the next occasion: the CQI is computed there
+          m_pendingDlSinr.resize (m_spectrumPhys.size ());
+          NS_ASSERT (streamId < m_pendingDlSinr.size ());
+          m_pendingDlSinr.at (streamId) = sinr.Copy ();
+          m_hasPendingDlSinr = true;
+          return;
         }
 
-      uint8_t mcs; // it is initialized by AMC in the following call
-      uint8_t wbCqi = m_amc->CreateCqiFeedbackWbTdma (sinr, mcs);
-
       std::vector <double> avrgSinr = std::vector <double> (m_spectrumPhys.size (), UINT32_MAX);
-
-      NS_ASSERT (streamId < m_prevDlWbCqi.size ());
-      m_prevDlWbCqi [streamId] = wbCqi;
-      double avrgSinrdB = 10 * log10 (ComputeAvgSinr (sinr));
-      avrgSinr [streamId] = avrgSinrdB;
-      NS_LOG_DEBUG ("Stream " << +streamId << " WB CQI " << +wbCqi << " avrg MCS " << +mcs << " avrg SINR (dB) " << avrgSinrdB);
+      avrgSinr [streamId] = MeasureDlCqi (sinr, streamId);
       m_dlCqiFeedbackCounter++;
 
       // if we received SINR from all the active streams,
       // we can proceed to trigger the corresponding callback
       if (m_dlCqiFeedbackCounter == m_activeDlDataStreams)
         {
-          DlCqiInfo dlcqi;
-          dlcqi.m_rnti = m_rnti;
-          dlcqi.m_cqiType = DlCqiInfo::WB;
-          if (m_spectrumPhys.size () == 1)
-            {
-              dlcqi.m_ri = 1;
-            }
-          else
-            {
-              dlcqi.m_ri = SelectRi (avrgSinr);
-              NS_LOG_DEBUG ("At " << Simulator::Now ().As (Time::S) << " UE PHY reporting RI = " << static_cast<uint16_t> (dlcqi.m_ri));
-            }
+          SendDlCqiReport (avrgSinr);
+          // reset the key variables
+          m_dlCqiFeedbackCounter = 0;
+          m_aperiodicCqiRequested = false;
+          m_pendingDlSinr.clear ();
+          m_hasPendingDlSinr = false;
+        }
+    }
+}
 
-          //In MIMO, once the UE starts reporting RI = 2, both the CQI
-          //must be reported even though one is measured, the other for
-          //which we couldn't measure we will report a previously
-          //computed CQI or if not computed at all then CQI 0. This choice is
-          //made to keep the scheduler informed about the channel state in MIMO
-          //when only one of the stream's TB is retransmitted. Also, remember,
-          //if UE reports RI = 2 and one of the stream's CQI is 0, scheduler will
-          //use MCS 0 to compute its TB size.
-          dlcqi.m_wbCqi = m_prevDlWbCqi; // set DL CQI feedbacks
+double
+NrUePhy::MeasureDlCqi (const SpectrumValue &sinr, uint8_t streamId)
+{
+  NS_LOG_FUNCTION (this);
 
-          NS_ASSERT_MSG (dlcqi.m_ri <= dlcqi.m_wbCqi.size (), "Mismatch between the RI and the number of CQIs in a CQI report");
+  // TODO
+  // Not sure what this IF is about, seems that it can be removed,
+  // if not, then we have to support wbCqiLast time per stream
+  // if (Simulator::Now () > m_wbCqiLast)
+  if (m_prevDlWbCqi.empty ()) // No DL CQI reported yet, initialize the vector
+    {
+      // Remember, scheduler uses MCS 0 for CQI 0.
+      // See, NrMacSchedulerCQIManagement::DlWBCQIReported
+      m_prevDlWbCqi.assign (m_spectrumPhys.size (), 0);
+      m_reportedRi2 = false; // already initialized to false in the header, added here for readability
+    }
 
-          Ptr<NrDlCqiMessage> msg = CreateDlCqiFeedbackMessage (dlcqi);
-          if (msg)
-            {
-              DoSendControlMessage (msg);
-            }
-          // reset the key variables
-          m_dlCqiFeedbackCounter = 0;
+  uint8_t mcs; // it is initialized by AMC in the following call
+  uint8_t wbCqi = m_amc->CreateCqiFeedbackWbTdma (sinr, mcs);
+
+  if (m_subbandCqi && streamId == 0)
+    {
+      m_prevDlSbCqi = m_amc->CreateCqiFeedbackSbTdma (sinr, GetNumRbPerRbg ());
+    }
+
+  NS_ASSERT (streamId < m_prevDlWbCqi.size ());
+  m_prevDlWbCqi [streamId] = wbCqi;
+  double avrgSinrdB = 10 * log10 (ComputeAvgSinr (sinr));
+  m_reportDlSinrDb.resize (m_spectrumPhys.size (), UINT32_MAX);
+  m_reportDlSinrDb [streamId] = avrgSinrdB;
+  NS_LOG_DEBUG ("Stream " << +streamId << " WB CQI " << +wbCqi << " avrg MCS " << +mcs << " avrg SINR (dB) " << avrgSinrdB);
+  return avrgSinrdB;
+}
+
+void
+NrUePhy::SendDlCqiReport (const std::vector<double> &avrgSinr)
+{
+  NS_LOG_FUNCTION (this);
+
+  DlCqiInfo dlcqi;
+  dlcqi.m_rnti = m_rnti;
+  dlcqi.m_cqiType = DlCqiInfo::WB;
+  if (m_subbandCqi && ! m_prevDlSbCqi.empty ())
+    {
+      dlcqi.m_cqiType = DlCqiInfo::SB;
+      dlcqi.m_sbCqi = m_prevDlSbCqi;
+    }
+  if (m_spectrumPhys.size () == 1)
+    {
+      dlcqi.m_ri = 1;
+    }
+  else
+    {
+      dlcqi.m_ri = SelectRi (avrgSinr);
+      NS_LOG_DEBUG ("At " << Simulator::Now ().As (Time::S) << " UE PHY reporting RI = " << static_cast<uint16_t> (dlcqi.m_ri));
+    }
+
+  //In MIMO, once the UE starts reporting RI = 2, both the CQI
+  //must be reported even though one is measured, the other for
+  //which we couldn't measure we will report a previously
+  //computed CQI or if not computed at all then CQI 0. This choice is
+  //made to keep the scheduler informed about the channel state in MIMO
+  //when only one of the stream's TB is retransmitted. Also, remember,
+  //if UE reports RI = 2 and one of the stream's CQI is 0, scheduler will
+  //use MCS 0 to compute its TB size.
+  dlcqi.m_wbCqi = m_prevDlWbCqi; // set DL CQI feedbacks
+
+  NS_ASSERT_MSG (dlcqi.m_ri <= dlcqi.m_wbCqi.size (), "Mismatch between the RI and the number of CQIs in a CQI report");
+
+  Ptr<NrDlCqiMessage> msg = CreateDlCqiFeedbackMessage (dlcqi);
+  if (msg)
+    {
+      DoSendControlMessage (msg);
+    }
+  m_reportDlSinrDb.assign (m_spectrumPhys.size (), UINT32_MAX);
+}
+
+void
+NrUePhy::SendPeriodicDlCqiReport ()
+{
+  NS_LOG_FUNCTION (this);
+
+  if (! m_hasPendingDlSinr
+      || (m_currentSlot.Normalize () + m_cqiReportPeriodicity - m_cqiReportOffset % m_cqiReportPeriodicity)
+         % m_cqiReportPeriodicity != 0)
+    {
+      return;
+    }
+
+  std::vector <double> avrgSinr = std::vector <double> (m_spectrumPhys.size (), UINT32_MAX);
+  for (uint8_t streamId = 0; streamId < m_pendingDlSinr.size (); ++streamId)
+    {
+      if (m_pendingDlSinr.at (streamId) != nullptr)
+        {
+          avrgSinr [streamId] = MeasureDlCqi (*m_pendingDlSinr.at (streamId), streamId);
         }
     }
+  NS_LOG_INFO ("UE " << m_rnti << " periodic DL CQI report in " << m_currentSlot);
+  SendDlCqiReport (avrgSinr);
+  m_pendingDlSinr.clear ();
+  m_hasPendingDlSinr = false;
 }
 
 void
@@ -1253,9 +1714,9 @@ NrUePhy::NotifyDlHarqFeedback (uint8_t streamId, DlHarqInfo::HarqStatus harqFeed
        dlHarqInfo.m_rnti = m_rnti;
        dlHarqInfo.m_bwpIndex = GetBwpId();
        // initialize the feedbacks from all streams with NONE
-       dlHarqInfo.m_harqStatus = std::vector <enum DlHarqInfo::HarqStatus> (m_spectrumPhys.size(), DlHarqInfo::HarqStatus::NONE);
+       dlHarqInfo.m_harqStatus.assign (m_spectrumPhys.size(), DlHarqInfo::HarqStatus::NONE);
        //above initialization logic also applies to m_numRetx vector
-       dlHarqInfo.m_numRetx = std::vector <uint8_t> (m_spectrumPhys.size(), UINT8_MAX);
+       dlHarqInfo.m_numRetx.assign (m_spectrumPhys.size(), UINT8_MAX);
        dlHarqInfo.m_harqProcessId = harqProcessId;
        //insert this element
        m_dlHarqInfo [harqProcessId] = dlHarqInfo;
@@ -1402,6 +1863,18 @@ NrUePhy::ReportDlCtrlSinr (const SpectrumValue& sinr, uint8_t streamId)
 
   NS_ASSERT (rbUsed);
   m_dlCtrlSinrTrace (GetCellId (), m_rnti, sinrSum/rbUsed, GetBwpId (), streamId);
+
+  if (m_idleCqiDue && streamId == 0)
+    {
+      // Wideband CQI of the first stream, from the DL CTRL of the occasion
+      m_idleCqiDue = false;
+      std::vector <double> avrgSinr = std::vector <double> (m_spectrumPhys.size (), UINT32_MAX);
+      avrgSinr [streamId] = MeasureDlCqi (sinr, streamId);
+      NS_LOG_INFO ("UE " << m_rnti << " idle DL CQI report in " << m_currentSlot);
+      m_sendingIdleCqi = true;
+      SendDlCqiReport (avrgSinr);
+      m_sendingIdleCqi = false;
+    }
 }
 
 uint8_t
@@ -1413,10 +1886,18 @@ NrUePhy::ComputeCqi (const SpectrumValue& sinr)
   return wbCqi;
 }
 
+uint8_t
+NrUePhy::ComputeCqiFromAverageSinr (double sinr) const
+{
+  NS_LOG_FUNCTION (this << sinr);
+  return m_amc->GetCqiFromSinrShannon (sinr);
+}
+
 void
 NrUePhy::StartEventLoop (uint16_t frame, uint8_t subframe, uint16_t slot)
 {
   NS_LOG_FUNCTION (this);
+  NrCounters::Context counters (this, NrCounters::PHY_EVENTS);
 
   if (GetChannelBandwidth() == 0)
     {
@@ -1585,6 +2066,45 @@ NrUePhy::UseFixedRankIndicator (bool useFixedRi)
   m_useFixedRi = useFixedRi;
 }
 
+void
+NrUePhy::SetSubbandCqi (bool subbandCqi)
+{
+  NS_LOG_FUNCTION (this);
+  m_subbandCqi = subbandCqi;
+}
+
+bool
+NrUePhy::GetSubbandCqi () const
+{
+  return m_subbandCqi;
+}
+
+void
+NrUePhy::SetCqiReportPeriodicity (uint16_t periodicity)
+{
+  NS_LOG_FUNCTION (this << periodicity);
+  m_cqiReportPeriodicity = periodicity;
+}
+
+uint16_t
+NrUePhy::GetCqiReportPeriodicity () const
+{
+  return m_cqiReportPeriodicity;
+}
+
+void
+NrUePhy::SetCqiReportOffset (uint16_t offset)
+{
+  NS_LOG_FUNCTION (this << offset);
+  m_cqiReportOffset = offset;
+}
+
+uint16_t
+NrUePhy::GetCqiReportOffset () const
+{
+  return m_cqiReportOffset;
+}
+
 void
 NrUePhy::SetRiSinrThreshold1 (double sinrThreshold)
 {
@@ -1611,6 +2131,32 @@ NrUePhy::GetRiSinrThreshold2 () const
   return m_riSinrThreshold2;
 }
 
+void
+NrUePhy::SetCapacityBasedRi (bool capacityBasedRi)
+{
+  NS_LOG_FUNCTION (this);
+  m_capacityBasedRi = capacityBasedRi;
+}
+
+bool
+NrUePhy::GetCapacityBasedRi () const
+{
+  return m_capacityBasedRi;
+}
+
+void
+NrUePhy::SetRiHysteresis (double hysteresis)
+{
+  NS_LOG_FUNCTION (this);
+  m_riHysteresis = hysteresis;
+}
+
+double
+NrUePhy::GetRiHysteresis () const
+{
+  return m_riHysteresis;
+}
+
 uint8_t
 NrUePhy::SelectRi (const std::vector<double> &avrgSinr)
 {
@@ -1620,6 +2166,10 @@ NrUePhy::SelectRi (const std::vector<double> &avrgSinr)
     {
       return m_fixedRi;
     }
+  if (m_capacityBasedRi)
+    {
+      return SelectRiByCapacity ();
+    }
 
   if (!m_reportedRi2)
     {
@@ -1652,38 +2202,41 @@ NrUePhy::SelectRi (const std::vector<double> &avrgSinr)
 
       if (indexValidSinr.size () == avrgSinr.size ())
         {
-          // UE is able to measure both the streams
-          // UE supports two stream and it has already reported RI equal to 2.
-          // Meaning, that this UE has already received the data on stream 2
-          // and has measured its average SINR. Let's check the average SINR
-          // of both the streams. If the average SINR of both the streams is
-          // above m_riSinrThreshold2 then we report RI equal to 2; otherwise, RI
-          // equal to 1.
-          if (avrgSinr [0] > m_riSinrThreshold2 && avrgSinr [1] > m_riSinrThreshold2)
-            {
-              ri = 2;
-            }
-          else
-            {
-              ri = 1;
-            }
+          // UE is able to measure all the streams
+          // UE supports more streams and it has already reported RI of 2.
+          // Meaning, that this UE has already received the data on them
+          // and has measured their average SINR. We report a RI equal to
+          // the number of streams with the average SINR above
+          // m_riSinrThreshold2, and at least 1.
+          ri = static_cast<uint8_t> (std::count_if (avrgSinr.begin (), avrgSinr.end (),
+                                                    [this] (double sinr) { return sinr > m_riSinrThreshold2; }));
+          ri = std::max<uint8_t> (ri, 1);
         }
       else
         {
           // There is at least one stream that UE is unable to measure.
-          // If the average SINR of the measured stream is above
-          // m_riSinrThreshold1, report RI equal to 2; otherwise, RI equal to 1.
+          // If the average SINR of a measured stream is above
+          // m_riSinrThreshold1, report a RI of one more than the measured
+          // streams; otherwise, the number of measured streams above
+          // m_riSinrThreshold2, and at least 1.
           // This else was implemented to handle the situations when a UE
-          // switches from 2 streams to 1, and unable to measure one of
+          // switches from more streams to fewer, and unable to measure some of
           // the streams. In that case, following code would help us
-          // not to get stuck with one stream till the end of simulation.
-          if (avrgSinr [indexValidSinr.at (0)] > m_riSinrThreshold1)
+          // not to get stuck with fewer streams till the end of simulation.
+          uint8_t aboveThreshold2 = 0;
+          bool aboveThreshold1 = false;
+          for (uint8_t i : indexValidSinr)
+            {
+              aboveThreshold1 = aboveThreshold1 || avrgSinr [i] > m_riSinrThreshold1;
+              aboveThreshold2 += avrgSinr [i] > m_riSinrThreshold2 ? 1 : 0;
+            }
+          if (aboveThreshold1)
             {
-              ri = 2;
+              ri = static_cast<uint8_t> (std::min (indexValidSinr.size () + 1, avrgSinr.size ()));
             }
           else
             {
-              ri = 1;
+              ri = std::max<uint8_t> (aboveThreshold2, 1);
             }
         }
     }
@@ -1692,6 +2245,65 @@ NrUePhy::SelectRi (const std::vector<double> &avrgSinr)
   return ri;
 }
 
+uint8_t
+NrUePhy::SelectRiByCapacity ()
+{
+  NS_LOG_FUNCTION (this);
+
+  std::vector<double> measured;
+  for (double sinrDb : m_reportDlSinrDb)
+    {
+      if (sinrDb != UINT32_MAX)
+        {
+          measured.push_back (std::pow (10.0, sinrDb / 10.0));
+        }
+    }
+  NS_ABORT_MSG_IF (measured.empty (), "Unable to find valid average SINR");
+  std::sort (measured.begin (), measured.end (), std::greater<double> ());
+  double totalSinr = std::accumulate (measured.begin (), measured.end (), 0.0);
+
+  // All the ranks are evaluated with the same (Shannon) mapping of the SINR,
+  // so that none is favored, over all the RBs and symbols of a slot
+  uint32_t nprb = GetRbNum () * GetSymbolsPerSlot ();
+  auto tbsOfSinr = [this, nprb] (double sinr)
+    {
+      uint8_t cqi = m_amc->GetCqiFromSinrShannon (sinr);
+      return cqi == 0 ? 0 : m_amc->CalculateTbSize (m_amc->GetMcsFromCqi (cqi), nprb);
+    };
+
+  // With fewer layers than the measured ones, the best layers get the power
+  // of the others, without their interference; with more layers, each one
+  // gets an equal share of the power of the measured ones
+  std::vector<uint32_t> rankTbs (m_spectrumPhys.size () + 1, 0);
+  for (uint8_t rank = 1; rank < rankTbs.size (); ++rank)
+    {
+      if (rank <= measured.size ())
+        {
+          double usedSinr = std::accumulate (measured.begin (), measured.begin () + rank, 0.0);
+          for (uint8_t layer = 0; layer < rank; ++layer)
+            {
+              rankTbs.at (rank) += tbsOfSinr (measured.at (layer) * totalSinr / usedSinr);
+            }
+        }
+      else
+        {
+          rankTbs.at (rank) = rank * tbsOfSinr (totalSinr / rank);
+        }
+      NS_LOG_DEBUG ("Expected TBS with RI " << +rank << ": " << rankTbs.at (rank));
+    }
+
+  m_capacityRi = std::min<uint8_t> (m_capacityRi, m_spectrumPhys.size ());
+  auto best = std::max_element (rankTbs.begin () + 1, rankTbs.end ());
+  if (*best > rankTbs.at (m_capacityRi) * (1.0 + m_riHysteresis))
+    {
+      m_capacityRi = static_cast<uint8_t> (std::distance (rankTbs.begin (), best));
+    }
+
+  NS_LOG_DEBUG ("Reported RI " << +m_capacityRi);
+  m_reportedRi2 = m_reportedRi2 || m_capacityRi >= 2;
+  return m_capacityRi;
+}
+
 }
 
 
@@ -23,9 +23,11 @@
 #include "nr-phy.h"
 #include "nr-amc.h"
 #include "nr-harq-phy.h"
+#include "nr-var-tti-timeline.h"
 #include <ns3/lte-ue-phy-sap.h>
 #include <ns3/lte-ue-cphy-sap.h>
 #include <ns3/traced-callback.h>
+#include <unordered_map>
 
 namespace ns3 {
 
@@ -33,6 +35,7 @@ class NrChAccessManager;
 class BeamManager;
 class BeamId;
 class NrUePowerControl;
+class NrRankSelectionTestCase;
 
 /**
  * \ingroup ue-phy
@@ -69,6 +72,7 @@ class NrUePhy : public NrPhy
 {
   friend class UeMemberLteUePhySapProvider;
   friend class MemberLteUeCphySapProvider<NrUePhy>;
+  friend NrRankSelectionTestCase;
 
 public:
   /**
@@ -216,6 +220,16 @@ public:
    */
   void SetPattern (const std::string &pattern);
 
+  /**
+   * \brief Change the TDD pattern from a slot on, as the gNB does
+   * \param pattern the new pattern
+   * \param switchSlot the absolute slot number (see SfnSf::Normalize) of the
+   * first slot of the new pattern
+   *
+   * Called by NrGnbPhy::ChangeTddPattern.
+   */
+  void ChangeTddPattern (const std::vector<LteNrTddSlotType> &pattern, uint64_t switchSlot);
+
   /**
    * \brief Receive a list of CTRL messages
    *
@@ -287,6 +301,50 @@ public:
    */
   void UseFixedRankIndicator (bool useFixedRi);
 
+  /**
+   * \brief Report sub-band DL CQI
+   *
+   * \param subbandCqi If true, the DL CQI reports carry also the CQI of
+   *        each RBG of the first stream.
+   */
+  void SetSubbandCqi (bool subbandCqi);
+
+  /**
+   * \brief Get if the DL CQI reports are sub-band
+   *
+   * \return true if the DL CQI reports carry also the CQI of each RBG
+   */
+  bool GetSubbandCqi () const;
+
+  /**
+   * \brief Set the period of the DL CQI reports
+   *
+   * \param periodicity the number of slots between two reports, or 0 to
+   *        report after each DL data reception
+   */
+  void SetCqiReportPeriodicity (uint16_t periodicity);
+
+  /**
+   * \brief Get the period of the DL CQI reports
+   *
+   * \return the number of slots between two reports (0: after each reception)
+   */
+  uint16_t GetCqiReportPeriodicity () const;
+
+  /**
+   * \brief Set the offset of the periodic DL CQI reports
+   *
+   * \param offset the slot, modulo the periodicity, of the reports
+   */
+  void SetCqiReportOffset (uint16_t offset);
+
+  /**
+   * \brief Get the offset of the periodic DL CQI reports
+   *
+   * \return the slot, modulo the periodicity, of the reports
+   */
+  uint16_t GetCqiReportOffset () const;
+
   /**
    * \brief Set SINR threshold in dB that is used to adaptively choose the rank indicator value.
    *
@@ -315,6 +373,37 @@ public:
    */
   double GetRiSinrThreshold2 () const;
 
+  /**
+   * \brief Choose the rank indicator by the expected TBS of each rank
+   *
+   * \param capacityBasedRi If true, and the RI is not fixed, the UE reports
+   *        the rank with the largest expected TBS instead of comparing the
+   *        SINR with the thresholds.
+   */
+  void SetCapacityBasedRi (bool capacityBasedRi);
+
+  /**
+   * \brief Get if the rank indicator is chosen by the expected TBS of each rank
+   *
+   * \return true if the rank indicator is chosen by the expected TBS
+   */
+  bool GetCapacityBasedRi () const;
+
+  /**
+   * \brief Set the hysteresis of the capacity based rank indicator
+   *
+   * \param hysteresis The fraction by which the expected TBS of the other
+   *        rank must exceed the one of the current rank to change rank.
+   */
+  void SetRiHysteresis (double hysteresis);
+
+  /**
+   * \brief Get the hysteresis of the capacity based rank indicator
+   *
+   * \return The fraction by which the expected TBS must exceed the current one
+   */
+  double GetRiHysteresis () const;
+
   /**
    *  TracedCallback signature for DL CTRL SINR trace callback
    *
@@ -476,6 +565,66 @@ public:
    */
   uint8_t ComputeCqi (const SpectrumValue& sinr);
 
+  /**
+   * \brief Compute the CQI of an average SINR with the Shannon model
+   *
+   * A cheap alternative to ComputeCqi for the RxPacketTraceUe trace.
+   *
+   * \param sinr the average SINR, in linear units
+   * \return The CQI
+   */
+  uint8_t ComputeCqiFromAverageSinr (double sinr) const;
+
+  /**
+   * \brief The gNB PHY does not send anything before a time
+   *
+   * Called by the gNB PHY when it skips its idle slots (see the
+   * NrGnbPhy attribute IdleSlotFastForward). If the UE has nothing to
+   * transmit, it skips its slots until then too. When the gNB PHY restarts
+   * its slots, it calls this method with the current time: the UE restarts
+   * its slots too, unless it is idle.
+   *
+   * \param cellId the cell ID of the gNB PHY
+   * \param until the start of the next slot run by the gNB PHY
+   */
+  void NotifyGnbIdleUntil (uint16_t cellId, const Time &until);
+
+  /**
+   * \brief There is something to do: restart the slots at the next slot
+   * boundary, if they are skipped, and leave the idle state
+   *
+   * Called when the MAC has UL data or control messages to send, and by
+   * the gNB PHY to page the UE for DL data (NrGnbPhy::PageUe).
+   */
+  virtual void WakeUp () override;
+
+  /**
+   * \brief Whether the UE is idle
+   *
+   * When the attribute InactivityTimer is set, a UE without DL or UL data
+   * for that time becomes idle at the end of a slot: it does not run its
+   * slots, and its spectrum phys drop the received signals (no CQI is
+   * computed). It wakes up at the next slot boundary when WakeUp is called.
+   * With IdleMonitoringPeriodicity, it runs one slot per period with its
+   * reception enabled, and reports the CQI of its DL CTRL every
+   * IdleCqiPeriodicity slots; it is still idle in these slots.
+   *
+   * \return true if the UE is idle
+   */
+  bool IsIdle () const;
+
+  /**
+   * \brief Select the messages of a received DL CTRL that the UE has to process
+   *
+   * When the trace source UePhyRxedCtrlMsgsTrace, that reports also the
+   * DCIs of the other UEs, is not connected, only the broadcast messages
+   * and the DCIs of this UE are processed.
+   *
+   * \param bundle the received control messages
+   * \return the messages to process
+   */
+  virtual const std::list<Ptr<NrControlMessage> > & GetRxCtrlMessages (const Ptr<const NrControlMessageBundle> &bundle) const override;
+
   /**
    * \brief TracedCallback signature for power trace source
    *
@@ -529,6 +678,46 @@ private:
    */
   void RequestAccess ();
 
+  /**
+   * \brief A handler of the received CTRL messages of a type
+   */
+  typedef void (NrUePhy::*CtrlMsgHandler) (const Ptr<NrControlMessage> &msg);
+
+  /**
+   * \brief Get the handler of each type of received CTRL message
+   *
+   * The messages without a handler are traced and forwarded to the MAC.
+   *
+   * \return the dispatch table of PhyCtrlMessagesReceived
+   */
+  static const std::unordered_map<NrControlMessage::messageType, CtrlMsgHandler> & GetCtrlMsgHandlers ();
+
+  /**
+   * \brief Process a DL DCI of this UE
+   * \param msg the NrDlDciMessage
+   */
+  void HandleDlDci (const Ptr<NrControlMessage> &msg);
+  /**
+   * \brief Process an UL DCI of this UE
+   * \param msg the NrUlDciMessage
+   */
+  void HandleUlDci (const Ptr<NrControlMessage> &msg);
+  /**
+   * \brief Forward a MIB to the RRC
+   * \param msg the NrMibMessage
+   */
+  void HandleMib (const Ptr<NrControlMessage> &msg);
+  /**
+   * \brief Forward a SIB1 to the RRC
+   * \param msg the NrSib1Message
+   */
+  void HandleSib1 (const Ptr<NrControlMessage> &msg);
+  /**
+   * \brief Schedule the processing of a RAR
+   * \param msg the NrRarMessage
+   */
+  void HandleRar (const Ptr<NrControlMessage> &msg);
+
   /**
    * \brief Forward the received RAR to the MAC
    * \param rarMsg RAR message
@@ -540,6 +729,26 @@ private:
    * \return a CTRL message with the DL CQI feedback
    */
   Ptr<NrDlCqiMessage> CreateDlCqiFeedbackMessage (const DlCqiInfo& dlcqi) __attribute__((warn_unused_result));
+  /**
+   * \brief Compute the CQI of a stream from its SINR
+   * \param sinr the SINR of the stream
+   * \param streamId the stream
+   * \return the average SINR of the stream, in dB
+   *
+   * The CQI is stored in m_prevDlWbCqi (and, for the first stream and
+   * sub-band reports, in m_prevDlSbCqi) until it is reported.
+   */
+  double MeasureDlCqi (const SpectrumValue &sinr, uint8_t streamId);
+  /**
+   * \brief Send a DL CQI report with the last CQI measured
+   * \param avrgSinr the average SINR in dB of each stream (UINT32_MAX if not measured), for the RI
+   */
+  void SendDlCqiReport (const std::vector<double> &avrgSinr);
+  /**
+   * \brief Send the periodic DL CQI report of the slot, if the slot is an
+   * occasion and a SINR was received since the last report
+   */
+  void SendPeriodicDlCqiReport ();
   /**
    * \brief Receive DL CTRL and return the duration of the transmission
    * \param dci the current DCI
@@ -618,6 +827,44 @@ private:
    */
   void EndVarTti (const std::shared_ptr<DciInfoElementTdma> &dci);
 
+  /**
+   * \brief Get the number of idle slots that can be skipped from m_currentSlot
+   * \param slotStart the start of m_currentSlot
+   * \return the number of slots, 0 if the next slot has to be run
+   */
+  uint32_t GetIdleSlotsToSkip (const Time &slotStart) const;
+
+  /**
+   * \brief Stop skipping the slots, and start the slot
+   * \param startSlot the slot to start
+   */
+  void EndFastForward (const SfnSf &startSlot);
+
+  /**
+   * \brief Restart the slots skipped by a fast-forward or by the idle state
+   * at the next slot boundary
+   */
+  void RestartSlots ();
+
+  /**
+   * \return true if the UE can become idle at the end of the current slot:
+   * the inactivity timer expired and nothing is pending
+   */
+  bool IsInactive () const;
+
+  /**
+   * \brief Stop the slots and the reception until the next WakeUp, or until
+   * the next monitoring occasion
+   */
+  void EnterIdle ();
+
+  /**
+   * \brief Run the slot of a monitoring occasion of the idle state, with
+   * the reception enabled
+   * \param slot the slot of the occasion
+   */
+  void StartIdleMonitoring (const SfnSf &slot);
+
   /**
    * \brief Set the Tx power spectral density based on the RB index vector
    * \param mask vector of the index of the RB (in SpectrumValue array)
@@ -777,13 +1024,29 @@ private:
    *
    * If the UE is configured to report a fixed RI value, this method
    * will return the configured fixed RI value. Otherwise, RI is
-   * selected adaptively based on the average SINR of the streams.
-   * <b>Note: This method is designed to handle only 2 streams</b>
+   * selected adaptively based on the average SINR of the streams: the
+   * first switch is to RI 2, and then the RI is the number of streams
+   * above the threshold 2 (one more than the measured streams if one of
+   * them is above the threshold 1, when not all of them are measured).
    *
    * \return The rank indicator
    */
   uint8_t SelectRi (const std::vector<double> &avrgSinr);
 
+  /**
+   * \brief Select the rank indicator with the largest expected TBS
+   *
+   * The expected TBS of each rank is estimated from the average SINR of
+   * the streams measured for this report (m_reportDlSinrDb): with fewer
+   * layers than the measured streams, the best layers share the SINR of
+   * all of them; with more layers, each one gets an equal share of it.
+   * The UE changes rank only if the best rank exceeds the current one by
+   * m_riHysteresis.
+   *
+   * \return The rank indicator
+   */
+  uint8_t SelectRiByCapacity ();
+
   NrUePhySapUser* m_phySapUser;             //!< SAP pointer
   LteUeCphySapProvider* m_ueCphySapProvider;    //!< SAP pointer
   LteUeCphySapUser* m_ueCphySapUser;            //!< SAP pointer
@@ -803,10 +1066,28 @@ private:
   uint64_t m_imsi {0}; ///< The IMSI of the UE
   std::unordered_map<uint8_t, uint32_t> m_harqIdToK1Map;  //!< Map that holds the K1 delay for each Harq process id
 
+  std::vector<LteNrTddSlotType> m_nextTddPattern; //!< The next TDD pattern, if a change is pending
+  uint64_t m_tddSwitchSlot {0};                   //!< The first slot of m_nextTddPattern
   int64_t m_numRbPerRbg {-1};   //!< number of resource blocks within the channel bandwidth, this parameter is configured by MAC through phy SAP provider interface
 
   SfnSf m_currentSlot;
 
+  Time m_gnbIdleUntil {0};      //!< Time until which the gNB PHY does not send anything
+  bool m_slotActivity {false};  //!< Something was received or notified since the last slot end
+  EventId m_fastForwardEvent;   //!< The end of the current fast-forward
+  SfnSf m_fastForwardFirstSlot; //!< The first slot skipped by the current fast-forward, or by the idle state
+  Time m_inactivityTimer {0};   //!< Time without data after which the UE becomes idle (attribute), 0 to disable
+  Time m_lastActivity {0};      //!< Last time the UE had DL or UL data, or its MAC had something to send
+  bool m_idle {false};          //!< Whether the UE is idle
+  uint16_t m_idleMonitoringPeriodicity {0}; //!< Slots between the monitoring occasions of the idle state (attribute)
+  uint16_t m_idleMonitoringOffset {0};      //!< Slot of the monitoring occasions, modulo the period (attribute)
+  uint16_t m_idleCqiPeriodicity {0};        //!< Minimum slots between the DL CQI reports of the idle state (attribute)
+  bool m_idleMonitoring {false};            //!< Whether the current slot is a monitoring occasion of the idle state
+  bool m_idleCqiDue {false};                //!< Whether the DL CTRL of the current occasion is reported
+  bool m_sendingIdleCqi {false};            //!< Whether the CQI of an occasion is being enqueued
+  uint64_t m_nextIdleCqiSlot {0};           //!< First slot of the next DL CQI report of the idle state
+  bool m_idealCtrl {false};     //!< The `IdealControl` attribute
+
   /**
    * \brief Status of the channel for the PHY
    */
@@ -877,7 +1158,14 @@ private:
   std::unordered_map <uint8_t,uint8_t> m_activeDlDataStreamsPerHarqId; // active streams per HARQ process ID
 
 
-  std::vector <uint8_t> m_prevDlWbCqi; //!< Vector to cache the CQI values reported by this UE PHY
+  StreamVector<uint8_t> m_prevDlWbCqi; //!< Vector to cache the CQI values reported by this UE PHY
+  std::vector <uint8_t> m_prevDlSbCqi; //!< The CQI of each RBG of the first stream, last measured by this UE PHY
+  bool m_subbandCqi {false}; //!< If true, the DL CQI reports are sub-band. It is set using the attribute SubbandCqi
+  uint16_t m_cqiReportPeriodicity {0}; //!< Slots between two DL CQI reports, 0 to report after each reception (attribute)
+  uint16_t m_cqiReportOffset {0};      //!< Slot of the periodic DL CQI reports, modulo the periodicity (attribute)
+  std::vector<Ptr<SpectrumValue> > m_pendingDlSinr; //!< Last SINR of each stream, not reported yet (periodic reports)
+  bool m_hasPendingDlSinr {false};     //!< True if a SINR in m_pendingDlSinr waits for the next occasion
+  bool m_aperiodicCqiRequested {false}; //!< True if a DL DCI requested a report after its reception
   uint8_t m_dlCqiFeedbackCounter {0}; /**< Counter to count the number of DL CQI
                                            report(s) this UE PHY prepares upon
                                            receiving SINR from underlying one or
@@ -899,6 +1187,12 @@ private:
   bool m_reportedRi2 {false}; /**< Flag to keep track of an event when a UE
                                    first time reports RI equal to 2.
                                    */
+  bool m_capacityBasedRi {false}; //!< If true, the RI is chosen by the expected TBS. It is set using the attribute CapacityBasedRi
+  bool m_coalesceVarTtiEvents {false}; //!< The `CoalesceVarTtiEvents` attribute
+  NrVarTtiTimeline m_varTtiTimeline;   //!< The varTTI boundaries, with CoalesceVarTtiEvents
+  double m_riHysteresis {0.1};    //!< Fraction of TBS needed to change the capacity based RI (attribute RiHysteresis)
+  uint8_t m_capacityRi {1};       //!< The last capacity based RI
+  std::vector<double> m_reportDlSinrDb; //!< Average SINR (dB) of each stream measured for the next report, UINT32_MAX if not measured
 };
 
 }
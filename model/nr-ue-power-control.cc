@@ -587,6 +587,28 @@ NrUePowerControl::UpdateGc ()
   m_deltaPucch.clear (); // we have used these values, no need to save them any more
 }
 
+double
+NrUePowerControl::GetBandwidthComponent (std::size_t rbNum)
+{
+  uint16_t numerology = m_nrUePhy->GetNumerology ();
+  if (numerology != m_bandwidthComponentNumerology)
+    {
+      m_bandwidthComponent.clear ();
+      m_bandwidthComponentNumerology = numerology;
+    }
+  if (rbNum >= m_bandwidthComponent.size ())
+    {
+      m_bandwidthComponent.resize (rbNum + 1, -1.0);
+    }
+  // With rbNum > 0, the component is never negative
+  double & component = m_bandwidthComponent[rbNum];
+  if (component < 0.0)
+    {
+      component = 10 * log10 (std::pow (2, numerology) * rbNum);
+    }
+  return component;
+}
+
 //TS 38.213 Table 7.1.1-1 and Table 7.2.1-1,  Mapping of TPC Command Field in DCI to accumulated and absolute value
 
 //Implements from from ts_138213 7.1.1
@@ -614,7 +636,7 @@ NrUePowerControl::CalculatePuschTxPowerNr (std::size_t rbNum)
 
   if (rbNum > 0)
     {
-      puschComponent = 10 * log10 ( std::pow (2, m_nrUePhy->GetNumerology ()) * rbNum);
+      puschComponent = GetBandwidthComponent (rbNum);
     }
   else
     {
@@ -674,7 +696,7 @@ NrUePowerControl::CalculatePucchTxPowerNr (std::size_t rbNum)
   double pucchComponent = 0;
   if (rbNum > 0)
     {
-      pucchComponent = 10 * log10 ( std::pow (2, m_nrUePhy->GetNumerology ()) * rbNum);
+      pucchComponent = GetBandwidthComponent (rbNum);
     }
   else
     {
@@ -757,7 +779,7 @@ NrUePowerControl::CalculateSrsTxPowerNr (std::size_t rbNum)
 
   if (rbNum > 0)
     {
-      component = 10 * log10 (std::pow (2, m_nrUePhy->GetNumerology ()) * rbNum);
+      component = GetBandwidthComponent (rbNum);
     }
   else
     {
@@ -296,6 +296,15 @@ private:
     * \param tpc TPC command value from 0 to 3
     */
    int8_t GetAccumulatedDelta (uint8_t tpc) const;
+   /**
+    * \brief Get the bandwidth component of the transmit power
+    * \param rbNum the number of RBs, greater than 0
+    * \return 10 log10 (2^mu * rbNum), with mu the numerology of the PHY
+    *
+    * The values are computed once per number of RBs, and computed again
+    * only if the numerology changes.
+    */
+   double GetBandwidthComponent (std::size_t rbNum);
    /**
     * \brief Calculates fc value for PUSCH power control
     * according to TS 38.213 7.2.1 formulas.
@@ -365,6 +374,8 @@ private:
   double m_fc {0.0};                            //!< FC
   double m_gc {0.0};                            //!< Is the current PUCCH power control adjustment state. This variable is used for calculation of PUCCH transmit power.
   double m_hc {0.0};                            //!< Is the current SRS power control adjustment state. This variable is used for calculation of SRS transmit power.
+  std::vector<double> m_bandwidthComponent;    //!< Bandwidth component for each number of RBs (negative: not computed yet)
+  uint16_t m_bandwidthComponentNumerology {UINT16_MAX}; //!< Numerology of m_bandwidthComponent
 
   //another attributes needed for function calls
   Ptr<NrUePhy> m_nrUePhy;                       //!< NrUePhy instance owner
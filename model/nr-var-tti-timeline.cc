@@ -0,0 +1,106 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-var-tti-timeline.h"
+
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrVarTtiTimeline");
+
+NrVarTtiTimeline::~NrVarTtiTimeline ()
+{
+  m_event.Cancel ();
+}
+
+void
+NrVarTtiTimeline::Schedule (const Time &delay, std::function<void ()> fn)
+{
+  NS_LOG_FUNCTION (this << delay);
+  Time at = Simulator::Now () + delay;
+  // After the functions of the same time, as the simulator does
+  auto it = std::upper_bound (m_entries.begin (), m_entries.end (), at,
+                              [] (const Time &t, const Entry &entry) { return t < entry.m_time; });
+  m_entries.insert (it, Entry {at, std::move (fn)});
+  if (!m_running)
+    {
+      ScheduleNext ();
+    }
+}
+
+void
+NrVarTtiTimeline::Cancel ()
+{
+  NS_LOG_FUNCTION (this);
+  m_entries.clear ();
+  m_event.Cancel ();
+}
+
+uint64_t
+NrVarTtiTimeline::GetNumEvents () const
+{
+  return m_numEvents;
+}
+
+uint64_t
+NrVarTtiTimeline::GetNumRuns () const
+{
+  return m_numRuns;
+}
+
+void
+NrVarTtiTimeline::ScheduleNext ()
+{
+  if (m_entries.empty ())
+    {
+      return;
+    }
+  Time first = m_entries.front ().m_time;
+  if (m_event.IsRunning () && m_eventTime == first)
+    {
+      return;
+    }
+  m_event.Cancel ();
+  m_eventTime = first;
+  m_event = Simulator::Schedule (first - Simulator::Now (), &NrVarTtiTimeline::Run, this);
+  ++m_numEvents;
+}
+
+void
+NrVarTtiTimeline::Run ()
+{
+  NS_LOG_FUNCTION (this);
+  m_running = true;
+  Time now = Simulator::Now ();
+  while (!m_entries.empty () && m_entries.front ().m_time <= now)
+    {
+      std::function<void ()> fn = std::move (m_entries.front ().m_fn);
+      m_entries.erase (m_entries.begin ());
+      ++m_numRuns;
+      fn ();
+    }
+  m_running = false;
+  ScheduleNext ();
+}
+
+} // namespace ns3
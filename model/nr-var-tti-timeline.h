@@ -0,0 +1,105 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef NR_VAR_TTI_TIMELINE_H
+#define NR_VAR_TTI_TIMELINE_H
+
+#include <ns3/event-id.h>
+#include <ns3/nstime.h>
+
+#include <functional>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup gnb-phy
+ * \brief The varTTI boundaries of the slot of a PHY, with one simulator event
+ *
+ * A PHY with the attribute CoalesceVarTtiEvents schedules the starts and
+ * the ends of its varTTIs through its timeline instead of the simulator.
+ * The timeline keeps them in a small array sorted by time (in the order
+ * of their request at the same time), and only its next boundary is in the
+ * simulator queue: all the functions due at that time are run by that
+ * event, including the ones scheduled for the same time while running.
+ *
+ * The order of the functions of a PHY is the one of the simulator events
+ * they replace; as with NrSlotTimingEngine, other events scheduled for the
+ * same instant may run before or after all of them, instead of in between.
+ */
+class NrVarTtiTimeline
+{
+public:
+  /**
+   * \brief Destructor: cancel the next event
+   */
+  ~NrVarTtiTimeline ();
+
+  /**
+   * \brief Run a function after a delay
+   * \param delay the delay
+   * \param fn the function
+   */
+  void Schedule (const Time &delay, std::function<void ()> fn);
+
+  /**
+   * \brief Drop all the functions not run yet
+   */
+  void Cancel ();
+
+  /**
+   * \return the number of simulator events used so far
+   */
+  uint64_t GetNumEvents () const;
+
+  /**
+   * \return the number of functions run so far
+   */
+  uint64_t GetNumRuns () const;
+
+private:
+  /**
+   * \brief Run the functions due now, and schedule the next boundary
+   */
+  void Run ();
+
+  /**
+   * \brief Schedule the event of the first function, if it is not already
+   */
+  void ScheduleNext ();
+
+  /**
+   * \brief A function and its time
+   */
+  struct Entry
+  {
+    Time m_time;                 //!< Absolute time of the function
+    std::function<void ()> m_fn; //!< The function
+  };
+
+  std::vector<Entry> m_entries; //!< Functions not run yet, sorted by time
+  EventId m_event;              //!< The event of the next boundary
+  Time m_eventTime;             //!< The time of m_event
+  bool m_running {false};       //!< True while Run is running the functions
+  uint64_t m_numEvents {0};     //!< Simulator events scheduled
+  uint64_t m_numRuns {0};       //!< Functions run
+};
+
+} // namespace ns3
+
+#endif // NR_VAR_TTI_TIMELINE_H
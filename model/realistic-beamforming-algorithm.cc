@@ -70,6 +70,7 @@ RealisticBeamformingAlgorithm::AssignStreams (int64_t stream)
 
 RealisticBeamformingAlgorithm::~RealisticBeamformingAlgorithm()
 {
+  m_delayedUpdateEvent.Cancel ();
 }
 
 TypeId
@@ -90,7 +91,16 @@ RealisticBeamformingAlgorithm::GetTypeId (void)
                                    BooleanValue (true),
                                    MakeBooleanAccessor (&RealisticBeamformingAlgorithm::SetUseSnrSrs,
                                                         &RealisticBeamformingAlgorithm::UseSnrSrs),
-                                   MakeBooleanChecker ());
+                                   MakeBooleanChecker ())
+                    .AddAttribute ("MaxPendingUpdates",
+                                   "Maximum number of pending delayed updates of the pair. When "
+                                   "the queue is full, a new SRS replaces the newest pending "
+                                   "update. 0 means no limit; otherwise, it must be at least 2, "
+                                   "so that the oldest update is still applied.",
+                                   UintegerValue (0),
+                                   MakeUintegerAccessor (&RealisticBeamformingAlgorithm::SetMaxPendingUpdates,
+                                                         &RealisticBeamformingAlgorithm::GetMaxPendingUpdates),
+                                   MakeUintegerChecker<uint32_t> ());
   return tid;
 }
 
@@ -143,6 +153,20 @@ RealisticBeamformingAlgorithm::UseSnrSrs () const
   return m_useSnrSrs;
 }
 
+void
+RealisticBeamformingAlgorithm::SetMaxPendingUpdates (uint32_t maxPendingUpdates)
+{
+  NS_ABORT_MSG_IF (maxPendingUpdates == 1,
+                   "With one pending update, a new SRS would always postpone it; use 0 or at least 2");
+  m_maxPendingUpdates = maxPendingUpdates;
+}
+
+uint32_t
+RealisticBeamformingAlgorithm::GetMaxPendingUpdates () const
+{
+  return m_maxPendingUpdates;
+}
+
 void
 RealisticBeamformingAlgorithm::NotifySrsSinrReport (uint16_t cellId, uint16_t rnti, double srsSinr)
 {
@@ -207,15 +231,7 @@ RealisticBeamformingAlgorithm::NotifySrsReport (uint16_t cellId, uint16_t rnti,
       else if ( conf.event == RealisticBfManager::DELAYED_UPDATE)
         {
           NS_LOG_INFO ("Received all SRS symbols per current slot. Scheduler realistic BF helper callback");
-          DelayedUpdateInfo dui;
-          dui.updateTime = Simulator::Now () + conf.updateDelay;
-          dui.srsSinr = m_maxSrsSinrPerSlot;  // SNR or SINR
-          dui.channelMatrix = GetChannelMatrix ();
-          m_delayedUpdateInfo.push (dui);
-          // schedule delayed update
-          Simulator::Schedule (conf.updateDelay, &RealisticBeamformingAlgorithm::NotifyHelper , this);
-          Simulator::Schedule (conf.updateDelay + NanoSeconds (1), &RealisticBeamformingAlgorithm::RemoveUsedDelayedUpdateInfo , this);
-          // we add 1 second just to be sure that will be removed after NotifyHelper, even if it is added into event sequence after, should be called after
+          AddDelayedUpdate (conf.updateDelay);
         }
       else
         {
@@ -225,11 +241,50 @@ RealisticBeamformingAlgorithm::NotifySrsReport (uint16_t cellId, uint16_t rnti,
 }
 
 void
-RealisticBeamformingAlgorithm::RemoveUsedDelayedUpdateInfo ()
+RealisticBeamformingAlgorithm::AddDelayedUpdate (const Time &updateDelay)
+{
+  NS_LOG_FUNCTION (this << updateDelay);
+
+  DelayedUpdateInfo dui;
+  dui.updateTime = Simulator::Now () + updateDelay;
+  dui.srsSinr = m_maxSrsSinrPerSlot;  // SNR or SINR
+  // A regenerated channel is a new matrix: keeping a reference to the
+  // current one is enough to use it at the delayed update
+  dui.channelMatrix = GetChannelMatrix ();
+
+  if (m_maxPendingUpdates > 0 && m_delayedUpdateInfo.size () >= m_maxPendingUpdates)
+    {
+      // The oldest updates are still applied at their time; the newest one
+      // takes the measurement of this SRS
+      NS_LOG_INFO ("Too many pending delayed updates; coalescing with the newest one");
+      m_delayedUpdateInfo.back () = dui;
+      return;
+    }
+
+  m_delayedUpdateInfo.push (dui);
+  ScheduleDelayedUpdate ();
+}
+
+void
+RealisticBeamformingAlgorithm::ScheduleDelayedUpdate ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_delayedUpdateInfo.empty () || m_delayedUpdateEvent.IsRunning ())
+    {
+      return;
+    }
+  m_delayedUpdateEvent = Simulator::Schedule (m_delayedUpdateInfo.front ().updateTime - Simulator::Now (),
+                                              &RealisticBeamformingAlgorithm::RunDelayedUpdate, this);
+}
+
+void
+RealisticBeamformingAlgorithm::RunDelayedUpdate ()
 {
   NS_LOG_FUNCTION (this);
   NS_ASSERT_MSG (m_delayedUpdateInfo.size(), " No elements in m_delayedUpdateInfo queue.");
+  NotifyHelper ();
   m_delayedUpdateInfo.pop (); // we can now delete this first element
+  ScheduleDelayedUpdate ();
 }
 
 void
@@ -265,8 +320,7 @@ RealisticBeamformingAlgorithm::GetChannelMatrix () const
                                                                                                        m_gnbSpectrumPhy->GetAntenna ()->GetObject <PhasedArrayModel>(),
                                                                                                        m_ueSpectrumPhy->GetAntenna ()->GetObject <PhasedArrayModel>());
 
-  Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrixCopy = Copy <const MatrixBasedChannelModel::ChannelMatrix> (originalChannelMatrix);
-  return channelMatrixCopy;
+  return originalChannelMatrix;
 }
 
 BeamformingVectorPair
@@ -304,52 +358,57 @@ RealisticBeamformingAlgorithm::GetBeamformingVectors ()
       channelMatrix = GetChannelMatrix ();
     }
 
+  // The codebooks of the gNB and of the UE, in the order of the search
+  std::vector<complexVector_t> gnbWs, ueWs;
+  std::vector<BeamId> gnbBeamIds, ueBeamIds;
   for (double gnbTheta = 60; gnbTheta < 121; gnbTheta = gnbTheta + m_beamSearchAngleStep)
     {
       for (uint16_t gnbSector = 0; gnbSector <= gnbNumRows; gnbSector++)
         {
           NS_ASSERT(gnbSector < UINT16_MAX);
           m_gnbSpectrumPhy->GetBeamManager()->SetSector (gnbSector, gnbTheta);
-          complexVector_t gnbW = m_gnbSpectrumPhy->GetBeamManager ()->GetCurrentBeamformingVector ();
+          gnbWs.push_back (m_gnbSpectrumPhy->GetBeamManager ()->GetCurrentBeamformingVector ());
+          gnbBeamIds.push_back (BeamId (gnbSector, gnbTheta));
+          NS_ABORT_MSG_IF (gnbWs.back ().size () == 0,
+                           "Beamforming vectors must be initialized in order to calculate the long term matrix.");
+        }
+    }
+  for (double ueTheta = 60; ueTheta < 121; ueTheta = static_cast<uint16_t> (ueTheta + m_beamSearchAngleStep))
+    {
+      for (uint16_t ueSector = 0; ueSector <= ueNumRows; ueSector++)
+        {
+          NS_ASSERT(ueSector < UINT16_MAX);
+          m_ueSpectrumPhy->GetBeamManager ()->SetSector (ueSector, ueTheta);
+          ueWs.push_back (m_ueSpectrumPhy->GetBeamManager ()->GetCurrentBeamformingVector ());
+          ueBeamIds.push_back (BeamId (ueSector, ueTheta));
+          NS_ABORT_MSG_IF (ueWs.back ().size () == 0,
+                           "Beamforming vectors must be initialized in order to calculate the long term matrix.");
+        }
+    }
+
+  std::vector<double> estimatedLongTermMetrics = GetEstimatedLongTermMetrics (channelMatrix, gnbWs, ueWs, srsSinr,
+                                                                              m_gnbSpectrumPhy->GetAntenna ()->GetObject<PhasedArrayModel>(),
+                                                                              m_ueSpectrumPhy->GetAntenna ()->GetObject<PhasedArrayModel>());
+
+  for (size_t gnbBeam = 0; gnbBeam < gnbWs.size (); gnbBeam++)
+    {
+      for (size_t ueBeam = 0; ueBeam < ueWs.size (); ueBeam++)
+        {
+          double estimatedLongTermMetric = estimatedLongTermMetrics[gnbBeam * ueWs.size () + ueBeam];
+
+          NS_LOG_LOGIC (" Estimated long term metric value: "<< estimatedLongTermMetric <<
+                        " gnb beam " << gnbBeamIds[gnbBeam] <<
+                        " ue beam " << ueBeamIds[ueBeam]);
 
-          for (double ueTheta = 60; ueTheta < 121; ueTheta = static_cast<uint16_t> (ueTheta + m_beamSearchAngleStep))
+          if (max < estimatedLongTermMetric)
             {
-              for (uint16_t ueSector = 0; ueSector <= ueNumRows; ueSector++)
-                {
-                  NS_ASSERT(ueSector < UINT16_MAX);
-                  m_ueSpectrumPhy->GetBeamManager ()->SetSector (ueSector, ueTheta);
-                  complexVector_t ueW = m_ueSpectrumPhy->GetBeamManager ()->GetCurrentBeamformingVector ();
-
-                  NS_ABORT_MSG_IF (gnbW.size()==0 || ueW.size()==0,
-                                   "Beamforming vectors must be initialized in order to calculate the long term matrix.");
-
-                  const UniformPlanarArray::ComplexVector estimatedLongTermComponent = GetEstimatedLongTermComponent (channelMatrix, gnbW, ueW,
-                                                                                                                      m_gnbSpectrumPhy->GetObject<MobilityModel>(),
-                                                                                                                      m_ueSpectrumPhy->GetObject<MobilityModel>(),
-                                                                                                                      srsSinr,
-                                                                                                                      m_gnbSpectrumPhy->GetAntenna ()->GetObject<PhasedArrayModel>(),
-                                                                                                                      m_ueSpectrumPhy->GetAntenna ()->GetObject<PhasedArrayModel>()
-                                                                                                                      );
-
-                  double estimatedLongTermMetric = CalculateTheEstimatedLongTermMetric (estimatedLongTermComponent);
-
-                  NS_LOG_LOGIC (" Estimated long term metric value: "<< estimatedLongTermMetric <<
-                                " gnb theta " << gnbTheta <<
-                                " ue theta " << ueTheta <<
-                                " gnb sector " << (M_PI *  static_cast<double> (gnbSector) / static_cast<double> (gnbNumRows) - 0.5 * M_PI) / (M_PI) * 180 <<
-                                " ue sector " << (M_PI * static_cast<double> (ueSector) / static_cast<double> (ueNumRows) - 0.5 * M_PI) / (M_PI) * 180);
-
-                  if (max < estimatedLongTermMetric)
-                    {
-                      max = estimatedLongTermMetric;
-                      maxTxSector = gnbSector;
-                      maxRxSector = ueSector;
-                      maxTxTheta = gnbTheta;
-                      maxRxTheta = ueTheta;
-                      maxTxW = gnbW;
-                      maxRxW = ueW;
-                    }
-                }
+              max = estimatedLongTermMetric;
+              maxTxSector = gnbBeamIds[gnbBeam].GetSector ();
+              maxRxSector = ueBeamIds[ueBeam].GetSector ();
+              maxTxTheta = gnbBeamIds[gnbBeam].GetElevation ();
+              maxRxTheta = ueBeamIds[ueBeam].GetElevation ();
+              maxTxW = gnbWs[gnbBeam];
+              maxRxW = ueWs[ueBeam];
             }
         }
     }
@@ -380,63 +439,91 @@ RealisticBeamformingAlgorithm::CalculateTheEstimatedLongTermMetric (const Unifor
 }
 
 
-UniformPlanarArray::ComplexVector
-RealisticBeamformingAlgorithm::GetEstimatedLongTermComponent (const Ptr<const MatrixBasedChannelModel::ChannelMatrix>& channelMatrix,
-                                                              const UniformPlanarArray::ComplexVector &aW,
-                                                              const UniformPlanarArray::ComplexVector &bW,
-                                                              Ptr<const MobilityModel> a,
-                                                              Ptr<const MobilityModel> b,
-                                                              double srsSinr,
-                                                              Ptr<const PhasedArrayModel> aArray,
-                                                              Ptr<const PhasedArrayModel> bArray
-) const
+std::vector<double>
+RealisticBeamformingAlgorithm::GetEstimatedLongTermMetrics (const Ptr<const MatrixBasedChannelModel::ChannelMatrix>& channelMatrix,
+                                                            const std::vector<complexVector_t> &gnbWs,
+                                                            const std::vector<complexVector_t> &ueWs,
+                                                            double srsSinr,
+                                                            Ptr<const PhasedArrayModel> gnbArray,
+                                                            Ptr<const PhasedArrayModel> ueArray) const
 {
   NS_LOG_FUNCTION (this);
 
-  // check if the channel matrix was generated considering a as the s-node and
-  // b as the u-node or viceversa
-  UniformPlanarArray::ComplexVector sW, uW;
-  if (!channelMatrix->IsReverse (aArray->GetId (), bArray->GetId ()))
-    {
-      sW = aW;
-      uW = bW;
-    }
-  else
-    {
-      sW = bW;
-      uW = aW;
-    }
+  // check if the channel matrix was generated considering the gNB as the
+  // s-node and the UE as the u-node or viceversa
+  bool gnbIsS = !channelMatrix->IsReverse (gnbArray->GetId (), ueArray->GetId ());
 
-  uint16_t sAntenna = static_cast<uint16_t> (sW.size ());
-  uint16_t uAntenna = static_cast<uint16_t> (uW.size ());
+  size_t uAntenna = channelMatrix->m_channel.size ();
+  size_t sAntenna = channelMatrix->m_channel[0].size ();
+  size_t numCluster = channelMatrix->m_channel[0][0].size ();
+  size_t gnbAntenna = gnbIsS ? sAntenna : uAntenna;
+  size_t ueAntenna = gnbIsS ? uAntenna : sAntenna;
 
   NS_LOG_DEBUG ("Calculate the estimation of the long term component with sAntenna: " << sAntenna << " uAntenna: " << uAntenna);
-  UniformPlanarArray::ComplexVector estimatedlongTerm;
+  NS_ABORT_MSG_IF (gnbWs.at (0).size () != gnbAntenna || ueWs.at (0).size () != ueAntenna,
+                   "The beamforming vectors do not match the channel matrix");
 
   NS_ABORT_IF (srsSinr == 0);
 
   double varError = 1 / (srsSinr); // SINR the SINR from UL SRS reception
-  uint8_t numCluster = static_cast<uint8_t> (channelMatrix->m_channel[0][0].size ());
 
-  for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+  // The estimated channel, as a (gNB element, UE element x cluster) matrix
+  size_t rowSize = ueAntenna * numCluster;
+  complexVector_t hEstimate (gnbAntenna * rowSize);
+  for (size_t cIndex = 0; cIndex < numCluster; cIndex++)
     {
-      std::complex<double> txSum (0,0);
-      for (uint16_t sIndex = 0; sIndex < sAntenna; sIndex++)
+      for (size_t sIndex = 0; sIndex < sAntenna; sIndex++)
         {
-          std::complex<double> rxSum (0,0);
-          for (uint16_t uIndex = 0; uIndex < uAntenna; uIndex++)
+          for (size_t uIndex = 0; uIndex < uAntenna; uIndex++)
             {
               //error is generated from the normal random variable with mean 0 and  variance varError*sqrt(1/2) for real/imaginary parts
               std::complex<double> error = std::complex <double> (m_normalRandomVariable->GetValue (0, sqrt (0.5) * varError),
                                                                   m_normalRandomVariable->GetValue (0, sqrt (0.5) * varError)) ;
-              std::complex<double> hEstimate = channelMatrix->m_channel [uIndex][sIndex][cIndex] + error;
-              rxSum += uW[uIndex] * (hEstimate);
+              size_t gnbIndex = gnbIsS ? sIndex : uIndex;
+              size_t ueIndex = gnbIsS ? uIndex : sIndex;
+              hEstimate[gnbIndex * rowSize + ueIndex * numCluster + cIndex] = channelMatrix->m_channel [uIndex][sIndex][cIndex] + error;
+            }
+        }
+    }
+
+  // Project the estimated channel on each gNB beam, once
+  complexVector_t gnbProjections (gnbWs.size () * rowSize, std::complex<double> (0, 0));
+  for (size_t gnbBeam = 0; gnbBeam < gnbWs.size (); gnbBeam++)
+    {
+      std::complex<double> *out = &gnbProjections[gnbBeam * rowSize];
+      for (size_t gnbIndex = 0; gnbIndex < gnbAntenna; gnbIndex++)
+        {
+          const std::complex<double> w = gnbWs[gnbBeam][gnbIndex];
+          const std::complex<double> *in = &hEstimate[gnbIndex * rowSize];
+          for (size_t i = 0; i < rowSize; i++)
+            {
+              out[i] += w * in[i];
+            }
+        }
+    }
+
+  // Reduce each projection on each UE beam, to get the long term component
+  // of the pair
+  std::vector<double> metrics (gnbWs.size () * ueWs.size ());
+  UniformPlanarArray::ComplexVector estimatedlongTerm (numCluster);
+  for (size_t gnbBeam = 0; gnbBeam < gnbWs.size (); gnbBeam++)
+    {
+      for (size_t ueBeam = 0; ueBeam < ueWs.size (); ueBeam++)
+        {
+          std::fill (estimatedlongTerm.begin (), estimatedlongTerm.end (), std::complex<double> (0, 0));
+          for (size_t ueIndex = 0; ueIndex < ueAntenna; ueIndex++)
+            {
+              const std::complex<double> w = ueWs[ueBeam][ueIndex];
+              const std::complex<double> *in = &gnbProjections[gnbBeam * rowSize + ueIndex * numCluster];
+              for (size_t cIndex = 0; cIndex < numCluster; cIndex++)
+                {
+                  estimatedlongTerm[cIndex] += w * in[cIndex];
+                }
             }
-          txSum = txSum + sW[sIndex] * rxSum;
+          metrics[gnbBeam * ueWs.size () + ueBeam] = CalculateTheEstimatedLongTermMetric (estimatedlongTerm);
         }
-      estimatedlongTerm.push_back (txSum);
     }
-  return estimatedlongTerm;
+  return metrics;
 }
 
 } // end of namespace ns-3
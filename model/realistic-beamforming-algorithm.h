@@ -27,6 +27,7 @@
 #include "realistic-bf-manager.h"
 #include "nr-ue-net-device.h"
 #include "nr-gnb-net-device.h"
+#include <ns3/event-id.h>
 #include <queue>
 
 namespace ns3 {
@@ -56,6 +57,15 @@ class NrRealisticBeamformingTestCase;
  * channel matrix, but instead the angles of arrival and departure of the LOS
  * path, and so, the proposed method is not valid for it. Currently, it is
  * only compatible with the beam search method."
+ *
+ * With the delayed update trigger, each SRS slot adds a pending update that
+ * refers to the channel matrix at the reception of the SRS. The channel
+ * model replaces a matrix with a new object when it regenerates the channel,
+ * so the pending update keeps a reference to that version of the channel
+ * instead of a copy. The pending updates of the pair are applied by a single
+ * event, scheduled at the time of the oldest one. With MaxPendingUpdates
+ * greater than zero, an SRS that arrives when the queue is full replaces the
+ * newest pending update, so that the queue stays bounded at high SRS rates.
  */
 class RealisticBeamformingAlgorithm: public Object
 {
@@ -73,7 +83,7 @@ public:
   {
     Time updateTime; //!< time that will be used to check if the event is using the correct SRS measurement and channel
     double srsSinr;  //!< SRS SINR/SNR value
-    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix; //!< saved deep copy of the channel matrix at the time instant when the SRS is received
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix; //!< the version of the channel matrix at the time instant when the SRS is received
   };
 
   /*
@@ -181,6 +191,16 @@ public:
    * \return the boolean indicator indicating whether SRS SNR is used
    */
   bool UseSnrSrs () const;
+  /**
+   * \brief Set the maximum number of pending delayed updates
+   * \param maxPendingUpdates the maximum number of pending updates, 0 for no limit
+   */
+  void SetMaxPendingUpdates (uint32_t maxPendingUpdates);
+  /**
+   * \brief Get the maximum number of pending delayed updates
+   * \return the maximum number of pending updates, 0 for no limit
+   */
+  uint32_t GetMaxPendingUpdates () const;
 
 private:
 
@@ -225,30 +245,34 @@ private:
    * This is needed when delayed trigger event is used and delay is larger then SRS periodicity,
    * so there can be various SRS reports and corresponding channel matrices for which
    * will be nececessary to perform bemaforming update using channel matrix corresponding to
-   * the time of the reception of SRS.
-   * \return returns a deep copy of the current channel matrix
+   * the time of the reception of SRS; in that case, the caller keeps a
+   * reference to it: a regenerated channel is a new matrix.
+   * \return returns the current channel matrix
    */
   Ptr<const MatrixBasedChannelModel::ChannelMatrix> GetChannelMatrix () const;
   /**
-   * \brief Calculates an estimation of the long term component based on the channel measurements
+   * \brief Calculates the estimated long term metric of every pair of gNB
+   * and UE beams, based on the channel measurements
+   *
+   * The channel H is estimated once, with an estimation error that depends
+   * on the SRS report, and projected once on each gNB beam; the long term
+   * component of each pair is then a single reduction of that projection
+   * with the UE beam.
+   *
    * \param channelMatrix the channel matrix H
-   * \param aW the beamforming vector of the first device
-   * \param bW the beamforming vector of the second device
-   * \param a the first node mobility model
-   * \param b the second node mobility model
+   * \param gnbWs the beamforming vectors of the gNB
+   * \param ueWs the beamforming vectors of the UE
    * \param srsSinr the SRS report to be used to estimate the long term component metric
-   * \param aArray the antenna array of the first device
-   * \param bArray the antenna array of the second device
-   * \return the estimated long term component
+   * \param gnbArray the antenna array of the gNB
+   * \param ueArray the antenna array of the UE
+   * \return the metric of each pair, at gnbBeam * ueWs.size () + ueBeam
    */
-  UniformPlanarArray::ComplexVector GetEstimatedLongTermComponent (const Ptr<const MatrixBasedChannelModel::ChannelMatrix>& channelMatrix,
-                                                                          const UniformPlanarArray::ComplexVector &aW,
-                                                                          const UniformPlanarArray::ComplexVector &bW,
-                                                                          Ptr<const MobilityModel> a,
-                                                                          Ptr<const MobilityModel> b,
-                                                                          double srsSinr,
-                                                                          Ptr<const PhasedArrayModel> aArray,
-                                                                          Ptr<const PhasedArrayModel> bArray) const;
+  std::vector<double> GetEstimatedLongTermMetrics (const Ptr<const MatrixBasedChannelModel::ChannelMatrix>& channelMatrix,
+                                                   const std::vector<complexVector_t> &gnbWs,
+                                                   const std::vector<complexVector_t> &ueWs,
+                                                   double srsSinr,
+                                                   Ptr<const PhasedArrayModel> gnbArray,
+                                                   Ptr<const PhasedArrayModel> ueArray) const;
 
   /*
    * \brief Calculates the total metric based on the each element of the long term component
@@ -257,16 +281,31 @@ private:
   double CalculateTheEstimatedLongTermMetric (const UniformPlanarArray::ComplexVector& longTermComponent) const;
 
   /**
-   * \brief Removes the "oldest" delayed update info - from the beggining of the queue
+   * \brief Queues a delayed update for the SRS of the current slot, or
+   * coalesces it with the newest pending one if the queue is full
+   * \param updateDelay the delay of the update
+   */
+  void AddDelayedUpdate (const Time &updateDelay);
+
+  /**
+   * \brief Schedules the event of the oldest pending delayed update, if any
+   */
+  void ScheduleDelayedUpdate ();
+
+  /**
+   * \brief Applies the oldest pending delayed update, removes it from the
+   * queue, and schedules the next one
    */
-  void RemoveUsedDelayedUpdateInfo () ;
+  void RunDelayedUpdate ();
 
   // attribute members, configuration variables
   double m_beamSearchAngleStep {30}; //!< The beam angle step that will be used to define the set of beams for which will be estimated the channel
   bool m_useSnrSrs  {true};          //!< SRS SNR used as measurement (attribute)
+  uint32_t m_maxPendingUpdates {0};  //!< The MaxPendingUpdates attribute
   //variable members, counters, and saving values
   double m_maxSrsSinrPerSlot {0}; //!< the maximum SRS SINR/SNR per slot in Watts, e.g. if there are 4 SRS symbols per UE, this value will represent the maximum
   std::queue <DelayedUpdateInfo> m_delayedUpdateInfo; //!< the vector of SRS SINRs/SNRs and saved channel matrices, needed for when trigger event update is based on delay
+  EventId m_delayedUpdateEvent; //!< the event of the oldest pending delayed update
   uint8_t m_srsSymbolsCounter {0}; //!< the counter that gets reset after reaching the number of symbols per SRS transmission
   uint16_t m_srsPeriodicityCounter {0}; //!< the counter of SRS reports between consecutive beamforming updates, this counter is incremented once the counter
                                         //   m_srsSymbolsPerSlotCounter reaches the number of symbols per SRS transmission, i.e., when SRS transmissions in the
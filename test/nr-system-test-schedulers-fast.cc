@@ -0,0 +1,1056 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/object-factory.h>
+#include <ns3/boolean.h>
+#include <ns3/string.h>
+#include <ns3/simulator.h>
+#include <ns3/nr-amc.h>
+#include <ns3/nr-mac-scheduler-ns3.h>
+#include <ns3/nr-mac-sched-sap.h>
+#include <ns3/nr-mac-short-bsr-ce.h>
+#include <ns3/nr-spectrum-value-helper.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <sstream>
+
+/**
+ * \file nr-system-test-schedulers-fast.cc
+ * \ingroup test
+ *
+ * \brief Quick version of the scheduler system tests. The schedulers are run
+ * alone, through their SAP, by a fake MAC that gives full-buffer RLC and BSR
+ * reports, CQI and HARQ feedback, as in the nr-scheduler-benchmark example.
+ * No PHY, channel or traffic is simulated, so a case takes a few milliseconds.
+ *
+ * The cases check, on a reduced matrix, the invariants of the scheduling
+ * decisions: the data DCI fit in the slot, do not overlap (DL and UL, or
+ * different beams, never share a symbol), no slot is left empty while the
+ * UEs have data, RR and PF serve every UE and MR gives the most to the best
+ * UE of each beam. The full matrix of the nr-system-test-schedulers-*
+ * suites, which simulates the traffic end to end, is EXTENSIVE.
+ *
+ * The Heap RBG assignment of the OFDMA schedulers is also checked against
+ * the SortLoop one, with MIMO UEs whose second stream is not always needed.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief The fake MAC: keeps the data DCI of every slot
+ */
+class FastTestMacSchedSapUser : public NrMacSchedSapUser
+{
+public:
+  /**
+   * \brief A data DCI, with the slot in which it is transmitted
+   */
+  struct SentDci
+  {
+    SfnSf m_sfnSf;                             //!< The slot of the DCI
+    std::shared_ptr<DciInfoElementTdma> m_dci; //!< The DCI
+  };
+
+  /**
+   * \brief Constructor
+   * \param model the spectrum model, one band per RB
+   * \param numerology the numerology
+   */
+  FastTestMacSchedSapUser (Ptr<const SpectrumModel> model, uint8_t numerology)
+    : m_model (model), m_numerology (numerology)
+  {
+  }
+
+  virtual void SchedConfigInd (const struct SchedConfigIndParameters& params) override
+  {
+    for (const auto & varTti : params.m_slotAllocInfo.m_varTtiAllocInfo)
+      {
+        if (varTti.m_dci->m_type != DciInfoElementTdma::DATA || varTti.m_dci->m_rnti == 0)
+          {
+            continue;
+          }
+        m_allDci.push_back ({params.m_sfnSf, varTti.m_dci});
+        m_pendingDci.push_back ({params.m_sfnSf, varTti.m_dci});
+      }
+  }
+
+  virtual Ptr<const SpectrumModel> GetSpectrumModel () const override
+  {
+    return m_model;
+  }
+
+  virtual uint32_t GetNumRbPerRbg () const override
+  {
+    return 1;
+  }
+
+  virtual uint8_t GetNumHarqProcess () const override
+  {
+    return 20;
+  }
+
+  virtual uint16_t GetBwpId () const override
+  {
+    return 0;
+  }
+
+  virtual uint16_t GetCellId () const override
+  {
+    return 0;
+  }
+
+  virtual uint32_t GetSymbolsPerSlot () const override
+  {
+    return 14;
+  }
+
+  virtual Time GetSlotPeriod () const override
+  {
+    return MicroSeconds (1000 >> m_numerology);
+  }
+
+  virtual double GetBeamCoupling ([[maybe_unused]] const BeamConfId &a,
+                                  [[maybe_unused]] const BeamConfId &b) const override
+  {
+    return -1.0;
+  }
+
+  std::vector<SentDci> m_allDci;     //!< Every data DCI received
+  std::vector<SentDci> m_pendingDci; //!< Data DCI without feedback yet
+
+private:
+  Ptr<const SpectrumModel> m_model; //!< The spectrum model
+  uint8_t m_numerology;             //!< The numerology
+};
+
+/**
+ * \ingroup test
+ * \brief The fake MAC for the configuration primitives: nothing to do
+ */
+class FastTestMacCschedSapUser : public NrMacCschedSapUser
+{
+public:
+  virtual void CschedCellConfigCnf ([[maybe_unused]] const struct CschedCellConfigCnfParameters& params) override {}
+  virtual void CschedUeConfigCnf ([[maybe_unused]] const struct CschedUeConfigCnfParameters& params) override {}
+  virtual void CschedLcConfigCnf ([[maybe_unused]] const struct CschedLcConfigCnfParameters& params) override {}
+  virtual void CschedLcReleaseCnf ([[maybe_unused]] const struct CschedLcReleaseCnfParameters& params) override {}
+  virtual void CschedUeReleaseCnf ([[maybe_unused]] const struct CschedUeReleaseCnfParameters& params) override {}
+  virtual void CschedUeConfigUpdateInd ([[maybe_unused]] const struct CschedUeConfigUpdateIndParameters& params) override {}
+  virtual void CschedCellConfigUpdateInd ([[maybe_unused]] const struct CschedCellConfigUpdateIndParameters& params) override {}
+};
+
+/**
+ * \ingroup test
+ * \brief Run a scheduler alone for some slots, with full-buffer UEs, and
+ * check its decisions
+ */
+class NrSchedulerFastTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param name the name of the case
+   * \param schedulerType the TypeId name of the scheduler
+   * \param uesPerBeam number of UEs in each beam
+   * \param beams number of beams
+   * \param isDl whether the UEs have DL data
+   * \param isUl whether the UEs have UL data
+   * \param periodic whether the first UE has a DL SPS and an UL configured grant
+   */
+  NrSchedulerFastTestCase (const std::string &name, const std::string &schedulerType,
+                           uint32_t uesPerBeam, uint32_t beams, bool isDl, bool isUl,
+                           bool periodic = false)
+    : TestCase (name),
+      m_schedulerType (schedulerType),
+      m_uesPerBeam (uesPerBeam),
+      m_beams (beams),
+      m_isDl (isDl),
+      m_isUl (isUl),
+      m_periodic (periodic)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \param rnti the RNTI of a UE
+   * \return the beam of the UE
+   */
+  uint32_t GetBeam (uint16_t rnti) const
+  {
+    return (rnti - 1u) % m_beams;
+  }
+
+  /**
+   * \brief Check the DCI of every slot
+   * \param dcis the data DCI of the run
+   */
+  void CheckDci (const std::vector<FastTestMacSchedSapUser::SentDci> &dcis);
+
+  std::string m_schedulerType;   //!< The TypeId name of the scheduler
+  uint32_t m_uesPerBeam;         //!< Number of UEs per beam
+  uint32_t m_beams;              //!< Number of beams
+  bool m_isDl;                   //!< Whether the UEs have DL data
+  bool m_isUl;                   //!< Whether the UEs have UL data
+  bool m_periodic;               //!< Whether the first UE has periodic reservations
+  const uint16_t m_period {4};   //!< Slots between two occasions of the periodic reservations
+  const uint8_t m_periodSym {2}; //!< Symbols of each occasion
+  const uint32_t m_rbgs {25};    //!< Number of RBGs (one RB each)
+  const uint32_t m_slots {200};  //!< Number of slots
+  const uint32_t m_warmup {8};   //!< Slots before the UL allocations and the feedback settle
+  const uint32_t m_ulDelay {2};  //!< Slots between the UL scheduling and the UL slot
+  const uint8_t m_numerology {1}; //!< Numerology
+};
+
+void
+NrSchedulerFastTestCase::DoRun ()
+{
+  ObjectFactory schedFactory;
+  schedFactory.SetTypeId (m_schedulerType);
+  Ptr<NrMacSchedulerNs3> sched = DynamicCast<NrMacSchedulerNs3> (schedFactory.Create ());
+  NS_ABORT_MSG_IF (sched == nullptr, "Can't create a NrMacSchedulerNs3 from type " + m_schedulerType);
+
+  double scs = 15e3 * std::pow (2, m_numerology);
+  Ptr<const SpectrumModel> model = NrSpectrumValueHelper::GetSpectrumModel (m_rbgs, 28e9, scs);
+
+  FastTestMacSchedSapUser macSap (model, m_numerology);
+  FastTestMacCschedSapUser macCsap;
+  sched->SetMacSchedSapUser (&macSap);
+  sched->SetMacCschedSapUser (&macCsap);
+  sched->InstallDlAmc (CreateObject<NrAmc> ());
+  sched->InstallUlAmc (CreateObject<NrAmc> ());
+
+  NrMacSchedSapProvider *provider = sched->GetMacSchedSapProvider ();
+  NrMacCschedSapProvider *cprovider = sched->GetMacCschedSapProvider ();
+
+  NrMacCschedSapProvider::CschedCellConfigReqParameters cellParams;
+  cellParams.m_ulBandwidth = m_rbgs;
+  cellParams.m_dlBandwidth = m_rbgs;
+  cprovider->CschedCellConfigReq (cellParams);
+
+  // The quality of the UEs grows with the RNTI, so that each UE of a beam
+  // has a different one. The reports do not change during the run.
+  uint32_t ues = m_uesPerBeam * m_beams;
+  NrMacSchedSapProvider::SchedDlCqiInfoReqParameters dlCqi;
+  NrMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters bsr;
+  std::vector<NrMacSchedSapProvider::SchedDlRlcBufferReqParameters> rlc;
+  for (uint16_t rnti = 1; rnti <= ues; ++rnti)
+    {
+      NrMacCschedSapProvider::CschedUeConfigReqParameters ueParams;
+      ueParams.m_rnti = rnti;
+      ueParams.m_beamConfId = BeamConfId (BeamId (static_cast<uint16_t> (GetBeam (rnti)), 90.0),
+                                          BeamId::GetEmptyBeamId ());
+      cprovider->CschedUeConfigReq (ueParams);
+
+      NrMacCschedSapProvider::CschedLcConfigReqParameters lcParams;
+      lcParams.m_rnti = rnti;
+      lcParams.m_reconfigureFlag = false;
+      LogicalChannelConfigListElement_s lc;
+      lc.m_logicalChannelIdentity = 3;
+      lc.m_logicalChannelGroup = 1;
+      lc.m_direction = LogicalChannelConfigListElement_s::DIR_BOTH;
+      lc.m_qosBearerType = LogicalChannelConfigListElement_s::QBT_NON_GBR;
+      lc.m_qci = 9;
+      lcParams.m_logicalChannelConfigList.emplace_back (lc);
+      cprovider->CschedLcConfigReq (lcParams);
+
+      DlCqiInfo cqi;
+      cqi.m_rnti = rnti;
+      cqi.m_ri = 1;
+      cqi.m_wbCqi.assign (1, static_cast<uint8_t> (std::min (15, 3 + rnti)));
+      dlCqi.m_cqiList.emplace_back (std::move (cqi));
+
+      NrMacSchedSapProvider::SchedDlRlcBufferReqParameters rlcParams;
+      rlcParams.m_rnti = rnti;
+      rlcParams.m_logicalChannelIdentity = 3;
+      rlcParams.m_rlcTransmissionQueueSize = 1000000;
+      rlcParams.m_rlcTransmissionQueueHolDelay = 0;
+      rlcParams.m_rlcRetransmissionQueueSize = 0;
+      rlcParams.m_rlcRetransmissionHolDelay = 0;
+      rlcParams.m_rlcStatusPduSize = 0;
+      rlc.emplace_back (rlcParams);
+
+      MacCeElement ce;
+      ce.m_rnti = rnti;
+      ce.m_macCeType = MacCeElement::BSR;
+      ce.m_macCeValue.m_bufferStatus = {0, NrMacShortBsrCe::FromBytesToLevel (1000000), 0, 0};
+      bsr.m_macCeList.emplace_back (std::move (ce));
+    }
+
+  // The DL occasions fall in even slots, the UL ones in odd slots
+  if (m_periodic && m_isDl)
+    {
+      sched->ConfigureDlSps (1, m_period, m_periodSym, 0);
+    }
+  if (m_periodic && m_isUl)
+    {
+      sched->ConfigureUlConfiguredGrant (1, m_period, m_periodSym, 1);
+    }
+
+  // With a single direction all the slots are F. With both, F slots would
+  // go to UL only (the UL data takes all the symbols of a F slot), so the
+  // slots alternate between DL and UL, as with a TDD pattern.
+  auto getSlotType = [this] (const SfnSf &sfn)
+    {
+      if (m_isDl != m_isUl)
+        {
+          return LteNrTddSlotType::F;
+        }
+      return sfn.Normalize () % 2 == 0 ? LteNrTddSlotType::DL : LteNrTddSlotType::UL;
+    };
+
+  SfnSf dlSfn (0, 0, 0, m_numerology);
+  for (uint32_t slot = 0; slot < m_slots; ++slot)
+    {
+      // Every TB of the slots already in the past is received correctly
+      std::vector<DlHarqInfo> dlHarq;
+      std::vector<UlHarqInfo> ulHarq;
+      std::vector<NrMacSchedSapProvider::SchedUlCqiInfoReqParameters> ulCqi;
+      auto isPast = [&dlSfn] (const FastTestMacSchedSapUser::SentDci &sent)
+        {
+          return sent.m_sfnSf.Normalize () < dlSfn.Normalize ();
+        };
+      for (const auto & sent : macSap.m_pendingDci)
+        {
+          if (!isPast (sent))
+            {
+              continue;
+            }
+          if (sent.m_dci->m_format == DciInfoElementTdma::DL)
+            {
+              DlHarqInfo harq;
+              harq.m_rnti = sent.m_dci->m_rnti;
+              harq.m_harqProcessId = sent.m_dci->m_harqProcess;
+              harq.m_bwpIndex = 0;
+              for (size_t stream = 0; stream < sent.m_dci->m_tbSize.size (); ++stream)
+                {
+                  harq.m_harqStatus.push_back (sent.m_dci->m_tbSize.at (stream) == 0 ? DlHarqInfo::NONE
+                                                                                     : DlHarqInfo::ACK);
+                  harq.m_numRetx.push_back (sent.m_dci->m_rv.at (stream));
+                }
+              dlHarq.emplace_back (std::move (harq));
+              continue;
+            }
+
+          UlHarqInfo harq;
+          harq.m_rnti = sent.m_dci->m_rnti;
+          harq.m_harqProcessId = sent.m_dci->m_harqProcess;
+          harq.m_bwpIndex = 0;
+          harq.m_receptionStatus = UlHarqInfo::Ok;
+          harq.m_numRetx = sent.m_dci->m_rv.at (0);
+          ulHarq.emplace_back (std::move (harq));
+
+          // One UL CQI for all the allocations that start at the same symbol
+          bool found = false;
+          for (const auto & v : ulCqi)
+            {
+              found = found || (v.m_sfnSf == sent.m_sfnSf && v.m_symStart == sent.m_dci->m_symStart);
+            }
+          if (!found)
+            {
+              double sinrDb = 3.0 * sent.m_dci->m_rnti;
+              NrMacSchedSapProvider::SchedUlCqiInfoReqParameters cqi;
+              cqi.m_sfnSf = sent.m_sfnSf;
+              cqi.m_symStart = sent.m_dci->m_symStart;
+              cqi.m_ulCqi.m_type = UlCqiInfo::PUSCH;
+              cqi.m_ulCqi.m_sinr.assign (m_rbgs, std::pow (10.0, sinrDb / 10.0));
+              ulCqi.emplace_back (std::move (cqi));
+            }
+        }
+      macSap.m_pendingDci.erase (std::remove_if (macSap.m_pendingDci.begin (),
+                                                 macSap.m_pendingDci.end (), isPast),
+                                 macSap.m_pendingDci.end ());
+
+      NrMacSchedSapProvider::SchedDlTriggerReqParameters dlTrigger;
+      dlTrigger.m_snfSf = dlSfn;
+      dlTrigger.m_slotType = getSlotType (dlSfn);
+      dlTrigger.m_dlHarqInfoList = dlHarq;
+      NrMacSchedSapProvider::SchedUlTriggerReqParameters ulTrigger;
+      ulTrigger.m_snfSf = dlSfn.GetFutureSfnSf (m_ulDelay);
+      ulTrigger.m_slotType = getSlotType (ulTrigger.m_snfSf);
+      ulTrigger.m_ulHarqInfoList = ulHarq;
+      dlCqi.m_sfnsf = dlSfn;
+      bsr.m_sfnSf = dlSfn;
+
+      // Same order as in NrGnbMac: UL indication, then DL indication
+      for (const auto & v : ulCqi)
+        {
+          provider->SchedUlCqiInfoReq (v);
+        }
+      if (m_isUl)
+        {
+          provider->SchedUlMacCtrlInfoReq (bsr);
+        }
+      if (ulTrigger.m_slotType != LteNrTddSlotType::DL)
+        {
+          provider->SchedUlTriggerReq (ulTrigger);
+        }
+      provider->SchedDlCqiInfoReq (dlCqi);
+      if (m_isDl)
+        {
+          for (const auto & v : rlc)
+            {
+              provider->SchedDlRlcBufferReq (v);
+            }
+        }
+      if (dlTrigger.m_slotType != LteNrTddSlotType::UL)
+        {
+          provider->SchedDlTriggerReq (dlTrigger);
+        }
+
+      dlSfn.Add (1);
+    }
+
+  CheckDci (macSap.m_allDci);
+}
+
+void
+NrSchedulerFastTestCase::CheckDci (const std::vector<FastTestMacSchedSapUser::SentDci> &dcis)
+{
+  std::map<uint64_t, std::vector<std::shared_ptr<DciInfoElementTdma>>> slots;
+  std::map<uint16_t, uint64_t> dlBytes;
+  std::map<uint16_t, uint64_t> ulBytes;
+
+  for (const auto & sent : dcis)
+    {
+      const auto & dci = sent.m_dci;
+      NS_TEST_ASSERT_MSG_GT (static_cast<uint32_t> (dci->m_numSym), 0, "DCI without symbols");
+      NS_TEST_ASSERT_MSG_LT (static_cast<uint32_t> (dci->m_symStart + dci->m_numSym), 15u,
+                             "DCI beyond the end of the slot");
+      NS_TEST_ASSERT_MSG_EQ (dci->m_rbgBitmask.size (), m_rbgs, "Wrong size of the RBG mask");
+      NS_TEST_ASSERT_MSG_GT (dci->m_rbgBitmask.count (), 0, "DCI without RBG");
+      uint64_t bytes = 0;
+      for (const auto & tbs : dci->m_tbSize)
+        {
+          bytes += tbs;
+        }
+      NS_TEST_ASSERT_MSG_GT (bytes, 0, "DCI without data");
+
+      bool isDl = dci->m_format == DciInfoElementTdma::DL;
+      NS_TEST_ASSERT_MSG_EQ ((isDl ? m_isDl : m_isUl), true, "DCI in a direction without data");
+      (isDl ? dlBytes : ulBytes)[dci->m_rnti] += bytes;
+      slots[sent.m_sfnSf.Normalize ()].push_back (dci);
+    }
+
+  // Two DCI of the same slot can share a symbol only if they are in the
+  // same direction, in the same beam, and on different RBGs
+  for (const auto & slot : slots)
+    {
+      const auto & list = slot.second;
+      for (size_t i = 0; i < list.size (); ++i)
+        {
+          for (size_t j = i + 1; j < list.size (); ++j)
+            {
+              const auto & a = list.at (i);
+              const auto & b = list.at (j);
+              bool symOverlap = a->m_symStart < b->m_symStart + b->m_numSym
+                && b->m_symStart < a->m_symStart + a->m_numSym;
+              if (!symOverlap)
+                {
+                  continue;
+                }
+              NS_TEST_ASSERT_MSG_EQ (a->m_format, b->m_format,
+                                     "DL and UL data in the same symbol of slot " << slot.first);
+              NS_TEST_ASSERT_MSG_EQ (GetBeam (a->m_rnti), GetBeam (b->m_rnti),
+                                     "Two beams in the same symbol of slot " << slot.first);
+              bool rbgOverlap = false;
+              for (size_t rbg = 0; rbg < m_rbgs; ++rbg)
+                {
+                  rbgOverlap = rbgOverlap || (a->m_rbgBitmask.test (rbg) && b->m_rbgBitmask.test (rbg));
+                }
+              NS_TEST_ASSERT_MSG_EQ (rbgOverlap, false,
+                                     "Two DCI on the same RBG and symbol of slot " << slot.first);
+            }
+        }
+    }
+
+  // With a single direction, every slot has data: there is always a UE to serve
+  if (m_isDl != m_isUl)
+    {
+      SfnSf sfn (0, 0, 0, m_numerology);
+      for (uint32_t slot = 0; slot < m_slots; ++slot, sfn.Add (1))
+        {
+          if (slot < m_warmup)
+            {
+              continue;
+            }
+          NS_TEST_ASSERT_MSG_EQ (slots.count (sfn.Normalize ()), 1,
+                                 "No data in slot " << sfn << " while the UEs have data");
+        }
+    }
+
+  // The first UE gets every occasion of its reservations, and nothing else in those slots
+  if (m_periodic)
+    {
+      SfnSf sfn (0, 0, 0, m_numerology);
+      for (uint32_t slot = 0; slot < m_slots; ++slot, sfn.Add (1))
+        {
+          bool dlOccasion = m_isDl && sfn.Normalize () % m_period == 0;
+          bool ulOccasion = m_isUl && sfn.Normalize () % m_period == 1;
+          if (slot < m_warmup || (!dlOccasion && !ulOccasion))
+            {
+              continue;
+            }
+          auto format = dlOccasion ? DciInfoElementTdma::DL : DciInfoElementTdma::UL;
+          uint32_t found = 0;
+          for (const auto & dci : slots[sfn.Normalize ()])
+            {
+              if (dci->m_rnti == 1 && dci->m_format == format)
+                {
+                  ++found;
+                  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (dci->m_numSym), m_periodSym,
+                                         "Wrong symbols of the occasion of slot " << sfn);
+                  NS_TEST_ASSERT_MSG_EQ (dci->m_rbgBitmask.count (), m_rbgs,
+                                         "The occasion of slot " << sfn << " is not over all the RBG");
+                }
+            }
+          NS_TEST_ASSERT_MSG_EQ (found, 1, "Missing occasion in slot " << sfn);
+        }
+    }
+
+  uint32_t ues = m_uesPerBeam * m_beams;
+  bool isMr = m_schedulerType.find ("MR") != std::string::npos;
+  if (!isMr)
+    {
+      // RR and PF serve every UE
+      for (uint16_t rnti = 1; rnti <= ues; ++rnti)
+        {
+          if (m_isDl)
+            {
+              NS_TEST_ASSERT_MSG_GT (dlBytes[rnti], 0, "UE " << rnti << " not served in DL");
+            }
+          if (m_isUl)
+            {
+              NS_TEST_ASSERT_MSG_GT (ulBytes[rnti], 0, "UE " << rnti << " not served in UL");
+            }
+        }
+    }
+  else if (m_isDl)
+    {
+      // MR gives the most to the UE with the best CQI of each beam, which is
+      // the last RNTI of the beam
+      for (uint32_t beam = 0; beam < m_beams; ++beam)
+        {
+          uint16_t best = static_cast<uint16_t> (ues - m_beams + beam + 1);
+          for (uint16_t rnti = static_cast<uint16_t> (beam + 1); rnti < best; rnti += m_beams)
+            {
+              NS_TEST_ASSERT_MSG_GT (dlBytes[best], dlBytes[rnti],
+                                     "MR gave more to UE " << rnti << " than to the best UE " << best);
+            }
+        }
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief Check the proactive UL grants: a UE that sent a BSR keeps getting
+ * minimal grants, without SR, for ProactiveUlWindow, and the grant of a SR
+ * is sized from its past BSRs
+ *
+ * The slots are run as simulator events, because the window is in time.
+ */
+class NrSchedulerProactiveUlTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param schedulerType the TypeId name of the scheduler
+   */
+  NrSchedulerProactiveUlTestCase (const std::string &schedulerType)
+    : TestCase ("Proactive UL grants, " + schedulerType),
+      m_schedulerType (schedulerType)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Run one UE that sends a BSR in the first slot and a SR in slot m_srSlot
+   * \param proactive the value of the attribute ProactiveUlGrant
+   * \return the data DCI of the run
+   */
+  std::vector<FastTestMacSchedSapUser::SentDci> Run (bool proactive);
+
+  std::string m_schedulerType;   //!< The TypeId name of the scheduler
+  const uint32_t m_rbgs {25};    //!< Number of RBGs (one RB each)
+  const uint32_t m_slots {120};  //!< Number of slots
+  const uint32_t m_srSlot {100}; //!< Slot of the SR
+  const uint32_t m_ulDelay {2};  //!< Slots between the UL scheduling and the UL slot
+  const uint8_t m_numerology {1}; //!< Numerology: 40 slots in the window of 20 ms
+};
+
+std::vector<FastTestMacSchedSapUser::SentDci>
+NrSchedulerProactiveUlTestCase::Run (bool proactive)
+{
+  ObjectFactory schedFactory;
+  schedFactory.SetTypeId (m_schedulerType);
+  schedFactory.Set ("ProactiveUlGrant", BooleanValue (proactive));
+  schedFactory.Set ("ProactiveUlWindow", TimeValue (MilliSeconds (20)));
+  Ptr<NrMacSchedulerNs3> sched = DynamicCast<NrMacSchedulerNs3> (schedFactory.Create ());
+
+  double scs = 15e3 * std::pow (2, m_numerology);
+  Ptr<const SpectrumModel> model = NrSpectrumValueHelper::GetSpectrumModel (m_rbgs, 28e9, scs);
+  FastTestMacSchedSapUser macSap (model, m_numerology);
+  FastTestMacCschedSapUser macCsap;
+  sched->SetMacSchedSapUser (&macSap);
+  sched->SetMacCschedSapUser (&macCsap);
+  sched->InstallDlAmc (CreateObject<NrAmc> ());
+  sched->InstallUlAmc (CreateObject<NrAmc> ());
+  NrMacSchedSapProvider *provider = sched->GetMacSchedSapProvider ();
+  NrMacCschedSapProvider *cprovider = sched->GetMacCschedSapProvider ();
+
+  NrMacCschedSapProvider::CschedCellConfigReqParameters cellParams;
+  cellParams.m_ulBandwidth = m_rbgs;
+  cellParams.m_dlBandwidth = m_rbgs;
+  cprovider->CschedCellConfigReq (cellParams);
+
+  NrMacCschedSapProvider::CschedUeConfigReqParameters ueParams;
+  ueParams.m_rnti = 1;
+  ueParams.m_beamConfId = BeamConfId (BeamId (0, 90.0), BeamId::GetEmptyBeamId ());
+  cprovider->CschedUeConfigReq (ueParams);
+
+  NrMacCschedSapProvider::CschedLcConfigReqParameters lcParams;
+  lcParams.m_rnti = 1;
+  lcParams.m_reconfigureFlag = false;
+  LogicalChannelConfigListElement_s lc;
+  lc.m_logicalChannelIdentity = 3;
+  lc.m_logicalChannelGroup = 1;
+  lc.m_direction = LogicalChannelConfigListElement_s::DIR_BOTH;
+  lc.m_qosBearerType = LogicalChannelConfigListElement_s::QBT_NON_GBR;
+  lc.m_qci = 9;
+  lcParams.m_logicalChannelConfigList.emplace_back (lc);
+  cprovider->CschedLcConfigReq (lcParams);
+
+  SfnSf firstSfn (0, 0, 0, m_numerology);
+  for (uint32_t slot = 0; slot < m_slots; ++slot)
+    {
+      Simulator::Schedule (macSap.GetSlotPeriod () * slot, [&, slot] ()
+        {
+          SfnSf dlSfn = firstSfn.GetFutureSfnSf (slot);
+
+          // Every TB of the slots already in the past is received correctly
+          std::vector<UlHarqInfo> ulHarq;
+          auto isPast = [&dlSfn] (const FastTestMacSchedSapUser::SentDci &sent)
+            {
+              return sent.m_sfnSf.Normalize () < dlSfn.Normalize ();
+            };
+          for (const auto & sent : macSap.m_pendingDci)
+            {
+              if (!isPast (sent))
+                {
+                  continue;
+                }
+              UlHarqInfo harq;
+              harq.m_rnti = sent.m_dci->m_rnti;
+              harq.m_harqProcessId = sent.m_dci->m_harqProcess;
+              harq.m_bwpIndex = 0;
+              harq.m_receptionStatus = UlHarqInfo::Ok;
+              harq.m_numRetx = sent.m_dci->m_rv.at (0);
+              ulHarq.emplace_back (std::move (harq));
+
+              NrMacSchedSapProvider::SchedUlCqiInfoReqParameters cqi;
+              cqi.m_sfnSf = sent.m_sfnSf;
+              cqi.m_symStart = sent.m_dci->m_symStart;
+              cqi.m_ulCqi.m_type = UlCqiInfo::PUSCH;
+              cqi.m_ulCqi.m_sinr.assign (m_rbgs, 100.0);
+              provider->SchedUlCqiInfoReq (cqi);
+            }
+          macSap.m_pendingDci.erase (std::remove_if (macSap.m_pendingDci.begin (),
+                                                     macSap.m_pendingDci.end (), isPast),
+                                     macSap.m_pendingDci.end ());
+
+          if (slot == 0)
+            {
+              NrMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters bsr;
+              bsr.m_sfnSf = dlSfn;
+              MacCeElement ce;
+              ce.m_rnti = 1;
+              ce.m_macCeType = MacCeElement::BSR;
+              ce.m_macCeValue.m_bufferStatus = {0, NrMacShortBsrCe::FromBytesToLevel (2000), 0, 0};
+              bsr.m_macCeList.emplace_back (std::move (ce));
+              provider->SchedUlMacCtrlInfoReq (bsr);
+            }
+          if (slot == m_srSlot)
+            {
+              NrMacSchedSapProvider::SchedUlSrInfoReqParameters sr;
+              sr.m_snfSf = dlSfn;
+              sr.m_srList.push_back (1);
+              provider->SchedUlSrInfoReq (sr);
+            }
+
+          NrMacSchedSapProvider::SchedUlTriggerReqParameters ulTrigger;
+          ulTrigger.m_snfSf = dlSfn.GetFutureSfnSf (m_ulDelay);
+          ulTrigger.m_slotType = LteNrTddSlotType::UL;
+          ulTrigger.m_ulHarqInfoList = ulHarq;
+          provider->SchedUlTriggerReq (ulTrigger);
+        });
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  return macSap.m_allDci;
+}
+
+void
+NrSchedulerProactiveUlTestCase::DoRun ()
+{
+  SfnSf firstSfn (0, 0, 0, m_numerology);
+  auto countIn = [&firstSfn] (const std::vector<FastTestMacSchedSapUser::SentDci> &dcis,
+                              uint32_t from, uint32_t to, uint64_t *bytes)
+    {
+      uint32_t count = 0;
+      for (const auto & sent : dcis)
+        {
+          uint64_t slot = sent.m_sfnSf.Normalize () - firstSfn.Normalize ();
+          if (slot >= from && slot < to)
+            {
+              ++count;
+              *bytes += sent.m_dci->m_tbSize.at (0);
+            }
+        }
+      return count;
+    };
+
+  std::vector<FastTestMacSchedSapUser::SentDci> reactive = Run (false);
+  std::vector<FastTestMacSchedSapUser::SentDci> proactive = Run (true);
+
+  // The BSR is served in both cases; then only the proactive UE keeps
+  // getting grants until the end of the window (slot 40)
+  uint64_t reactiveBytes = 0;
+  uint64_t proactiveBytes = 0;
+  NS_TEST_ASSERT_MSG_GT (countIn (reactive, 0, 30, &reactiveBytes), 0, "The BSR was not served");
+  NS_TEST_ASSERT_MSG_EQ (countIn (reactive, 30, m_srSlot, &reactiveBytes), 0, "UL grant without BSR nor SR");
+  NS_TEST_ASSERT_MSG_GT (countIn (proactive, 30, 40, &proactiveBytes), 0, "No proactive grant in the window");
+  NS_TEST_ASSERT_MSG_EQ (countIn (proactive, 45, m_srSlot, &proactiveBytes), 0, "Proactive grant after the window");
+
+  // The SR grant is sized from the BSR of 2000 bytes
+  reactiveBytes = 0;
+  proactiveBytes = 0;
+  NS_TEST_ASSERT_MSG_GT (countIn (reactive, m_srSlot, m_slots, &reactiveBytes), 0, "The SR was not served");
+  NS_TEST_ASSERT_MSG_GT (countIn (proactive, m_srSlot, m_slots, &proactiveBytes), 0, "The SR was not served");
+  NS_TEST_ASSERT_MSG_GT (proactiveBytes, reactiveBytes, "The SR grant was not sized from the past BSRs");
+  NS_TEST_ASSERT_MSG_GT_OR_EQ (proactiveBytes, 2000, "The SR grant does not cover the average BSR");
+}
+
+/**
+ * \ingroup test
+ * \brief Run an OFDMA scheduler with the SortLoop and with another RBG
+ * assignment mode, and check that the DL DCI are the same
+ *
+ * Two UEs report rank 2, and their buffer is small enough that the second
+ * stream is not always needed: the assignment clears its TB size only when
+ * the sorting loop would. The full-buffer UEs stop having data in the second
+ * half of the run, so that the loop ends both when the RBGs are over and
+ * when all the UEs are satisfied.
+ *
+ * With identical UEs (same rank 2 CQI, full buffer), all the UEs tie, and
+ * the 25 RBGs cannot be divided evenly among the 6 UEs: the UEs that get
+ * one more RBG are the same only if the ties are broken as in the loop.
+ */
+class NrSchedulerRbgAssignmentTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param schedulerType the TypeId name of the scheduler
+   * \param mode the RbgAssignmentMode to compare with SortLoop
+   * \param identical true if all the UEs have the same CQI and a full buffer
+   */
+  NrSchedulerRbgAssignmentTestCase (const std::string &schedulerType, const std::string &mode,
+                                    bool identical)
+    : TestCase ("RBG assignment " + mode + " against SortLoop, " + schedulerType +
+                (identical ? ", identical UEs" : "")),
+      m_schedulerType (schedulerType),
+      m_mode (mode),
+      m_identical (identical)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Run the scheduler with full-buffer, small-buffer and rank 2 UEs,
+   * or with identical UEs
+   * \param mode the value of the attribute RbgAssignmentMode
+   * \return the data DCI of the run
+   */
+  std::vector<FastTestMacSchedSapUser::SentDci> Run (const std::string &mode);
+
+  std::string m_schedulerType;   //!< The TypeId name of the scheduler
+  std::string m_mode;            //!< The RbgAssignmentMode to compare with SortLoop
+  bool m_identical;              //!< True if all the UEs have the same CQI and a full buffer
+  const uint32_t m_rbgs {25};    //!< Number of RBGs (one RB each)
+  const uint32_t m_slots {60};   //!< Number of slots
+  const uint16_t m_ues {6};      //!< Number of UEs
+  const uint8_t m_numerology {1}; //!< Numerology
+};
+
+std::vector<FastTestMacSchedSapUser::SentDci>
+NrSchedulerRbgAssignmentTestCase::Run (const std::string &mode)
+{
+  ObjectFactory schedFactory;
+  schedFactory.SetTypeId (m_schedulerType);
+  schedFactory.Set ("RbgAssignmentMode", StringValue (mode));
+  Ptr<NrMacSchedulerNs3> sched = DynamicCast<NrMacSchedulerNs3> (schedFactory.Create ());
+
+  double scs = 15e3 * std::pow (2, m_numerology);
+  Ptr<const SpectrumModel> model = NrSpectrumValueHelper::GetSpectrumModel (m_rbgs, 28e9, scs);
+  FastTestMacSchedSapUser macSap (model, m_numerology);
+  FastTestMacCschedSapUser macCsap;
+  sched->SetMacSchedSapUser (&macSap);
+  sched->SetMacCschedSapUser (&macCsap);
+  sched->InstallDlAmc (CreateObject<NrAmc> ());
+  sched->InstallUlAmc (CreateObject<NrAmc> ());
+  NrMacSchedSapProvider *provider = sched->GetMacSchedSapProvider ();
+  NrMacCschedSapProvider *cprovider = sched->GetMacCschedSapProvider ();
+
+  NrMacCschedSapProvider::CschedCellConfigReqParameters cellParams;
+  cellParams.m_ulBandwidth = m_rbgs;
+  cellParams.m_dlBandwidth = m_rbgs;
+  cprovider->CschedCellConfigReq (cellParams);
+
+  // RNTI 1 and 2: rank 2, small buffer. RNTI 3: small buffer. The others:
+  // full buffer in the first half of the run, then nothing.
+  std::vector<std::vector<uint8_t>> wbCqi = {{13, 11}, {9, 8}, {7}, {5}, {10}, {15}};
+  std::vector<uint32_t> buffer = {400, 2000, 150, 1000000, 1000000, 1000000};
+  if (m_identical)
+    {
+      wbCqi.assign (m_ues, {11, 11});
+      buffer.assign (m_ues, 1000000);
+    }
+
+  NrMacSchedSapProvider::SchedDlCqiInfoReqParameters dlCqi;
+  for (uint16_t rnti = 1; rnti <= m_ues; ++rnti)
+    {
+      NrMacCschedSapProvider::CschedUeConfigReqParameters ueParams;
+      ueParams.m_rnti = rnti;
+      ueParams.m_beamConfId = BeamConfId (BeamId (0, 90.0), BeamId::GetEmptyBeamId ());
+      cprovider->CschedUeConfigReq (ueParams);
+
+      NrMacCschedSapProvider::CschedLcConfigReqParameters lcParams;
+      lcParams.m_rnti = rnti;
+      lcParams.m_reconfigureFlag = false;
+      LogicalChannelConfigListElement_s lc;
+      lc.m_logicalChannelIdentity = 3;
+      lc.m_logicalChannelGroup = 1;
+      lc.m_direction = LogicalChannelConfigListElement_s::DIR_BOTH;
+      lc.m_qosBearerType = LogicalChannelConfigListElement_s::QBT_NON_GBR;
+      lc.m_qci = 9;
+      lcParams.m_logicalChannelConfigList.emplace_back (lc);
+      cprovider->CschedLcConfigReq (lcParams);
+
+      DlCqiInfo cqi;
+      cqi.m_rnti = rnti;
+      cqi.m_wbCqi = wbCqi.at (rnti - 1);
+      cqi.m_ri = static_cast<uint8_t> (cqi.m_wbCqi.size ());
+      dlCqi.m_cqiList.emplace_back (std::move (cqi));
+    }
+
+  SfnSf dlSfn (0, 0, 0, m_numerology);
+  for (uint32_t slot = 0; slot < m_slots; ++slot)
+    {
+      // Every TB of the slots already in the past is received correctly
+      std::vector<DlHarqInfo> dlHarq;
+      auto isPast = [&dlSfn] (const FastTestMacSchedSapUser::SentDci &sent)
+        {
+          return sent.m_sfnSf.Normalize () < dlSfn.Normalize ();
+        };
+      for (const auto & sent : macSap.m_pendingDci)
+        {
+          if (!isPast (sent))
+            {
+              continue;
+            }
+          DlHarqInfo harq;
+          harq.m_rnti = sent.m_dci->m_rnti;
+          harq.m_harqProcessId = sent.m_dci->m_harqProcess;
+          harq.m_bwpIndex = 0;
+          for (size_t stream = 0; stream < sent.m_dci->m_tbSize.size (); ++stream)
+            {
+              harq.m_harqStatus.push_back (sent.m_dci->m_tbSize.at (stream) == 0 ? DlHarqInfo::NONE
+                                                                                 : DlHarqInfo::ACK);
+              harq.m_numRetx.push_back (sent.m_dci->m_rv.at (stream));
+            }
+          dlHarq.emplace_back (std::move (harq));
+        }
+      macSap.m_pendingDci.erase (std::remove_if (macSap.m_pendingDci.begin (),
+                                                 macSap.m_pendingDci.end (), isPast),
+                                 macSap.m_pendingDci.end ());
+
+      dlCqi.m_sfnsf = dlSfn;
+      provider->SchedDlCqiInfoReq (dlCqi);
+      for (uint16_t rnti = 1; rnti <= m_ues; ++rnti)
+        {
+          uint32_t bytes = buffer.at (rnti - 1);
+          if (!m_identical && bytes > 10000 && slot >= m_slots / 2)
+            {
+              bytes = 0;
+            }
+          NrMacSchedSapProvider::SchedDlRlcBufferReqParameters rlcParams;
+          rlcParams.m_rnti = rnti;
+          rlcParams.m_logicalChannelIdentity = 3;
+          rlcParams.m_rlcTransmissionQueueSize = bytes;
+          rlcParams.m_rlcTransmissionQueueHolDelay = 0;
+          rlcParams.m_rlcRetransmissionQueueSize = 0;
+          rlcParams.m_rlcRetransmissionHolDelay = 0;
+          rlcParams.m_rlcStatusPduSize = 0;
+          provider->SchedDlRlcBufferReq (rlcParams);
+        }
+
+      NrMacSchedSapProvider::SchedDlTriggerReqParameters dlTrigger;
+      dlTrigger.m_snfSf = dlSfn;
+      dlTrigger.m_slotType = LteNrTddSlotType::DL;
+      dlTrigger.m_dlHarqInfoList = dlHarq;
+      provider->SchedDlTriggerReq (dlTrigger);
+
+      dlSfn.Add (1);
+    }
+
+  return macSap.m_allDci;
+}
+
+void
+NrSchedulerRbgAssignmentTestCase::DoRun ()
+{
+  std::vector<FastTestMacSchedSapUser::SentDci> loop = Run ("SortLoop");
+  std::vector<FastTestMacSchedSapUser::SentDci> other = Run (m_mode);
+
+  NS_TEST_ASSERT_MSG_GT (loop.size (), 0, "No DCI with SortLoop");
+  NS_TEST_ASSERT_MSG_EQ (other.size (), loop.size (), "Different number of DCI");
+
+  bool rank2 = false;
+  for (size_t i = 0; i < loop.size (); ++i)
+    {
+      const auto & a = loop.at (i).m_dci;
+      const auto & b = other.at (i).m_dci;
+      NS_TEST_ASSERT_MSG_EQ (other.at (i).m_sfnSf.Normalize (), loop.at (i).m_sfnSf.Normalize (),
+                             "Different slot of DCI " << i);
+      NS_TEST_ASSERT_MSG_EQ (b->m_rnti, a->m_rnti, "Different UE of DCI " << i);
+      NS_TEST_ASSERT_MSG_EQ (+b->m_symStart, +a->m_symStart, "Different first symbol of DCI " << i);
+      NS_TEST_ASSERT_MSG_EQ (+b->m_numSym, +a->m_numSym, "Different symbols of DCI " << i);
+      NS_TEST_ASSERT_MSG_EQ ((b->m_rbgBitmask == a->m_rbgBitmask), true, "Different RBGs of DCI " << i);
+      NS_TEST_ASSERT_MSG_EQ (b->m_tbSize.size (), a->m_tbSize.size (), "Different streams of DCI " << i);
+      for (size_t stream = 0; stream < a->m_tbSize.size (); ++stream)
+        {
+          NS_TEST_ASSERT_MSG_EQ (b->m_tbSize.at (stream), a->m_tbSize.at (stream),
+                                 "Different TB size of DCI " << i << " stream " << stream);
+          NS_TEST_ASSERT_MSG_EQ (+b->m_mcs.at (stream), +a->m_mcs.at (stream),
+                                 "Different MCS of DCI " << i << " stream " << stream);
+        }
+      rank2 = rank2 || a->m_tbSize.size () > 1;
+    }
+  NS_TEST_ASSERT_MSG_EQ (rank2, true, "No DCI of a rank 2 UE");
+}
+
+/**
+ * \ingroup test
+ * \brief The quick scheduler test suite
+ *
+ * It checks the OFDMA and TDMA RR, PF and MR schedulers with:
+ *
+ * - DL, UL, DL and UL together
+ * - UEs per beam: 1, 4
+ * - beams: 1, 2
+ *
+ * and the OFDMA and TDMA PF schedulers with a DL SPS and an UL configured
+ * grant for the first UE and with the proactive UL grants. It also compares
+ * the Heap RBG assignment of the OFDMA RR, PF and MR schedulers with the
+ * SortLoop one.
+ */
+class NrSystemTestSchedulersFastSuite : public TestSuite
+{
+public:
+  NrSystemTestSchedulersFastSuite ()
+    : TestSuite ("nr-system-test-schedulers-fast", SYSTEM)
+  {
+    enum TxMode
+    {
+      DL,
+      UL,
+      DL_UL
+    };
+
+    std::list<std::string> subdivision     = {"Ofdma", "Tdma"};
+    std::list<std::string> scheds          = {"RR", "PF", "MR"};
+    std::list<TxMode>      mode            = {DL, UL, DL_UL};
+    std::list<uint32_t>    uesPerBeamList  = {1, 4};
+    std::list<uint32_t>    beams           = {1, 2};
+
+    for (const auto & subType : subdivision)
+      {
+        for (const auto & sched : scheds)
+          {
+            for (const auto & modeType : mode)
+              {
+                for (const auto & uesPerBeam : uesPerBeamList)
+                  {
+                    for (const auto & beam : beams)
+                      {
+                        std::stringstream ss;
+                        ss << (modeType == DL ? "DL" : (modeType == UL ? "UL" : "DL_UL"))
+                           << ", " << subType << " " << sched << ", "
+                           << uesPerBeam << " UE per beam, " << beam << " beam";
+                        const bool isDl = modeType == DL || modeType == DL_UL;
+                        const bool isUl = modeType == UL || modeType == DL_UL;
+
+                        AddTestCase (new NrSchedulerFastTestCase (ss.str (),
+                                                                  "ns3::NrMacScheduler" + subType + sched,
+                                                                  uesPerBeam, beam, isDl, isUl),
+                                     TestCase::QUICK);
+                      }
+                  }
+              }
+          }
+
+        // DL SPS and UL configured grant of the first UE, with the PF scheduler
+        for (const auto & modeType : mode)
+          {
+            std::stringstream ss;
+            ss << (modeType == DL ? "DL" : (modeType == UL ? "UL" : "DL_UL"))
+               << ", " << subType << " PF, periodic reservations";
+            AddTestCase (new NrSchedulerFastTestCase (ss.str (), "ns3::NrMacScheduler" + subType + "PF",
+                                                      4, 1, modeType == DL || modeType == DL_UL,
+                                                      modeType == UL || modeType == DL_UL, true),
+                         TestCase::QUICK);
+          }
+      }
+
+    AddTestCase (new NrSchedulerProactiveUlTestCase ("ns3::NrMacSchedulerTdmaPF"), TestCase::QUICK);
+    AddTestCase (new NrSchedulerProactiveUlTestCase ("ns3::NrMacSchedulerOfdmaPF"), TestCase::QUICK);
+
+    for (const auto & sched : scheds)
+      {
+        for (bool identical : {false, true})
+          {
+            AddTestCase (new NrSchedulerRbgAssignmentTestCase ("ns3::NrMacSchedulerOfdma" + sched,
+                                                               "Heap", identical),
+                         TestCase::QUICK);
+          }
+      }
+  }
+};
+
+static NrSystemTestSchedulersFastSuite nrSystemTestSchedulersFastSuite; //!< Quick scheduler test suite
+
+}  // namespace ns3
@@ -28,6 +28,9 @@ using namespace ns3;
   *
   * \brief System test for OFDMA - Proportional Fair scheduler. It checks that all the
   * packets sent are delivered correctly.
+  *
+  * The cases are EXTENSIVE: the scheduling invariants are checked quickly by
+  * nr-system-test-schedulers-fast.
   */
 
 /**
@@ -102,7 +105,7 @@ NrSystemTestSchedulerOfdmaPfSuite::NrSystemTestSchedulerOfdmaPfSuite ()
                           AddTestCase (new SystemSchedulerTest (ss.str (), uesPerBeam, beam, num,
                                                                 20e6, isDl, isUl,
                                                                 schedName.str ()),
-                                       TestCase::QUICK);
+                                       TestCase::EXTENSIVE);
                         }
                     }
                 }
@@ -28,6 +28,9 @@ using namespace ns3;
   *
   * \brief System test for TDMA - Round Robin scheduler. It checks that all the
   * packets sent are delivered correctly.
+  *
+  * The cases are EXTENSIVE: the scheduling invariants are checked quickly by
+  * nr-system-test-schedulers-fast.
   */
 
 /**
@@ -83,7 +86,7 @@ NrSystemTestSchedulerTdmaRrDlSuite::NrSystemTestSchedulerTdmaRrDlSuite ()
                           AddTestCase (new SystemSchedulerTest (ss.str(), uesPerBeam, beam, num,
                                                                 20e6, isDl, isUl,
                                                                 schedName.str()),
-                                       TestCase::QUICK);
+                                       TestCase::EXTENSIVE);
                         }
                     }
                 }
@@ -148,7 +151,7 @@ NrSystemTestSchedulerTdmaRrUlSuite::NrSystemTestSchedulerTdmaRrUlSuite ()
                           AddTestCase (new SystemSchedulerTest (ss.str(), uesPerBeam, beam, num,
                                                                 20e6, isDl, isUl,
                                                                 schedName.str()),
-                                       TestCase::QUICK);
+                                       TestCase::EXTENSIVE);
                         }
                     }
                 }
@@ -213,7 +216,7 @@ NrSystemTestSchedulerTdmaRrDlUlSuite::NrSystemTestSchedulerTdmaRrDlUlSuite ()
                           AddTestCase (new SystemSchedulerTest (ss.str(), uesPerBeam, beam, num,
                                                                 20e6, isDl, isUl,
                                                                 schedName.str()),
-                                       TestCase::QUICK);
+                                       TestCase::EXTENSIVE);
                         }
                     }
                 }
@@ -0,0 +1,180 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-amc.h>
+#include <ns3/nr-eesm-cc-t1.h>
+#include <ns3/nr-eesm-cc-t2.h>
+#include <ns3/nr-spectrum-value-helper.h>
+#include <cmath>
+
+/**
+ * \file nr-test-amc-cqi-search.cc
+ * \ingroup test
+ *
+ * \brief This test checks that the binary search of the MCS in
+ * NrAmc::CreateCqiFeedbackWbTdma returns the same CQI and MCS as the linear
+ * search, for wideband SINR values and for MCS Table1 and Table2, and that
+ * NrAmc::CreateCqiFeedbackSbTdma returns for each RBG the wideband CQI of
+ * the SINR of that RBG.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Compare the linear and the binary CQI search for one error model
+ */
+class NrAmcCqiSearchTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param errorModel the error model type to test
+   */
+  NrAmcCqiSearchTestCase (const TypeId &errorModel)
+    : TestCase ("CQI search with " + errorModel.GetName ()),
+    m_errorModel (errorModel)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  TypeId m_errorModel; //!< Error model type
+};
+
+void
+NrAmcCqiSearchTestCase::DoRun ()
+{
+  Ptr<NrAmc> linearAmc = CreateObject<NrAmc> ();
+  linearAmc->SetErrorModelType (m_errorModel);
+  linearAmc->SetCqiSearchMode (NrAmc::LINEAR_SEARCH);
+
+  Ptr<NrAmc> binaryAmc = CreateObject<NrAmc> ();
+  binaryAmc->SetErrorModelType (m_errorModel);
+  binaryAmc->SetCqiSearchMode (NrAmc::BINARY_SEARCH);
+
+  for (uint32_t rbNum : {25, 50, 100, 273})
+    {
+      Ptr<const SpectrumModel> sm = NrSpectrumValueHelper::GetSpectrumModel (rbNum, 3.5e9, 30000);
+      SpectrumValue sinr (sm);
+
+      for (double sinrDb = -10.0; sinrDb <= 40.0; sinrDb += 0.5)
+        {
+          sinr = std::pow (10.0, sinrDb / 10.0);
+
+          uint8_t linearMcs = 0;
+          uint8_t binaryMcs = 0;
+          uint8_t linearCqi = linearAmc->CreateCqiFeedbackWbTdma (sinr, linearMcs);
+          uint8_t binaryCqi = binaryAmc->CreateCqiFeedbackWbTdma (sinr, binaryMcs);
+
+          NS_TEST_ASSERT_MSG_EQ (+binaryCqi, +linearCqi,
+                                 "Different CQI for " << rbNum << " RBs and SINR " << sinrDb << " dB");
+          NS_TEST_ASSERT_MSG_EQ (+binaryMcs, +linearMcs,
+                                 "Different MCS for " << rbNum << " RBs and SINR " << sinrDb << " dB");
+        }
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief Check the sub-band CQI of a frequency-selective SINR
+ */
+class NrAmcSubbandCqiTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param errorModel the error model type to test
+   */
+  NrAmcSubbandCqiTestCase (const TypeId &errorModel)
+    : TestCase ("Sub-band CQI with " + errorModel.GetName ()),
+    m_errorModel (errorModel)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  TypeId m_errorModel; //!< Error model type
+};
+
+void
+NrAmcSubbandCqiTestCase::DoRun ()
+{
+  Ptr<NrAmc> amc = CreateObject<NrAmc> ();
+  amc->SetErrorModelType (m_errorModel);
+
+  // 50 RBs in RBG of 4 RBs: the last RBG has only 2 RBs
+  const uint32_t rbNum = 50;
+  const uint32_t numRbPerRbg = 4;
+  Ptr<const SpectrumModel> sm = NrSpectrumValueHelper::GetSpectrumModel (rbNum, 3.5e9, 30000);
+
+  // The SINR grows of 2 dB every RBG, and the RBs of the last 3 RBG are not used
+  SpectrumValue sinr (sm);
+  for (uint32_t rb = 0; rb < rbNum; ++rb)
+    {
+      uint32_t rbg = rb / numRbPerRbg;
+      sinr[rb] = rbg < 10 ? std::pow (10.0, (-4.0 + 2.0 * rbg) / 10.0) : 0.0;
+    }
+
+  std::vector<uint8_t> sbCqi = amc->CreateCqiFeedbackSbTdma (sinr, numRbPerRbg);
+  NS_TEST_ASSERT_MSG_EQ (sbCqi.size (), 13U, "Wrong number of RBG");
+
+  for (uint32_t rbg = 0; rbg < sbCqi.size (); ++rbg)
+    {
+      if (rbg >= 10)
+        {
+          NS_TEST_ASSERT_MSG_EQ (+sbCqi.at (rbg), 0, "An RBG without SINR was measured");
+          continue;
+        }
+      SpectrumValue rbgSinr (sm);
+      for (uint32_t rb = rbg * numRbPerRbg; rb < (rbg + 1) * numRbPerRbg; ++rb)
+        {
+          rbgSinr[rb] = sinr[rb];
+        }
+      uint8_t mcs = 0;
+      uint8_t cqi = amc->CreateCqiFeedbackWbTdma (rbgSinr, mcs);
+      NS_TEST_ASSERT_MSG_EQ (+sbCqi.at (rbg), +cqi, "Wrong CQI for RBG " << rbg);
+    }
+
+  uint8_t mcs = 0;
+  NS_TEST_ASSERT_MSG_GT (+sbCqi.at (9), +amc->CreateCqiFeedbackWbTdma (sinr, mcs),
+                         "The best RBG is not better than the wideband CQI");
+}
+
+/**
+ * \ingroup test
+ * \brief The CQI search test suite
+ */
+class NrTestAmcCqiSearch : public TestSuite
+{
+public:
+  NrTestAmcCqiSearch () : TestSuite ("nr-test-amc-cqi-search", UNIT)
+  {
+    AddTestCase (new NrAmcCqiSearchTestCase (NrEesmCcT1::GetTypeId ()), QUICK);
+    AddTestCase (new NrAmcCqiSearchTestCase (NrEesmCcT2::GetTypeId ()), QUICK);
+    AddTestCase (new NrAmcSubbandCqiTestCase (NrEesmCcT1::GetTypeId ()), QUICK);
+    AddTestCase (new NrAmcSubbandCqiTestCase (NrEesmCcT2::GetTypeId ()), QUICK);
+  }
+};
+
+static NrTestAmcCqiSearch NrTestAmcCqiSearchSuite; //!< CQI search test suite
+
+}  // namespace ns3
@@ -0,0 +1,112 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-cached-antenna-model.h>
+#include <ns3/three-gpp-antenna-model.h>
+#include <ns3/uniform-random-variable.h>
+
+/**
+ * \file nr-test-antenna-lut.cc
+ * \ingroup test
+ *
+ * \brief This test checks NrCachedAntennaModel against the
+ * ThreeGppAntennaModel it tabulates: exact at the points of the grid, close
+ * everywhere else, and continuous across the azimuth of +-180 degrees.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Compare the table of a 3GPP element with the element
+ */
+class NrAntennaLutTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrAntennaLutTestCase ()
+    : TestCase ("Lookup table of the 3GPP element pattern")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrAntennaLutTestCase::DoRun ()
+{
+  Ptr<ThreeGppAntennaModel> element = CreateObject<ThreeGppAntennaModel> ();
+  Ptr<NrCachedAntennaModel> lut = CreateObject<NrCachedAntennaModel> ();
+  lut->SetElement (element);
+  lut->SetResolution (1.0);
+
+  NS_TEST_ASSERT_MSG_LT (lut->GetMaxErrorDb (), 0.5, "Too large max error at 1 degree");
+  NS_TEST_ASSERT_MSG_LT (lut->GetRmsErrorDb (), 0.01, "Too large RMS error at 1 degree");
+
+  for (int inclination = 0; inclination <= 180; inclination += 15)
+    {
+      for (int azimuth = -180; azimuth < 180; azimuth += 15)
+        {
+          Angles a (DegreesToRadians (azimuth), DegreesToRadians (inclination));
+          NS_TEST_ASSERT_MSG_EQ_TOL (lut->GetGainDb (a), element->GetGainDb (a), 1e-9,
+                                     "Not exact at a point of the grid");
+        }
+    }
+
+  Ptr<UniformRandomVariable> u = CreateObject<UniformRandomVariable> ();
+  u->SetStream (1);
+  for (uint32_t k = 0; k < 1000; ++k)
+    {
+      Angles a (u->GetValue (-M_PI, M_PI), u->GetValue (0, M_PI));
+      NS_TEST_ASSERT_MSG_EQ_TOL (lut->GetGainDb (a), element->GetGainDb (a), lut->GetMaxErrorDb () + 1e-9,
+                                 "Error over the max error reported");
+    }
+
+  // Both sides of the back of the element
+  Angles left (DegreesToRadians (179.9), DegreesToRadians (90));
+  Angles right (DegreesToRadians (-179.9), DegreesToRadians (90));
+  NS_TEST_ASSERT_MSG_EQ_TOL (lut->GetGainDb (left), lut->GetGainDb (right), 1e-6,
+                             "Not continuous across the azimuth of 180 degrees");
+
+  // A finer table is more accurate
+  Ptr<NrCachedAntennaModel> fine = CreateObject<NrCachedAntennaModel> ();
+  fine->SetElement (element);
+  fine->SetResolution (0.25);
+  NS_TEST_ASSERT_MSG_LT (fine->GetRmsErrorDb (), lut->GetRmsErrorDb (), "A finer table is not more accurate");
+}
+
+/**
+ * \ingroup test
+ * \brief The element lookup table test suite
+ */
+class NrTestAntennaLut : public TestSuite
+{
+public:
+  NrTestAntennaLut () : TestSuite ("nr-test-antenna-lut", UNIT)
+  {
+    AddTestCase (new NrAntennaLutTestCase (), QUICK);
+  }
+};
+
+static NrTestAntennaLut NrTestAntennaLutSuite; //!< Element lookup table test suite
+
+}  // namespace ns3
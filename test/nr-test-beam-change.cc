@@ -0,0 +1,112 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/node.h>
+#include <ns3/simple-net-device.h>
+#include <ns3/beam-manager.h>
+#include <ns3/simulator.h>
+
+/**
+ * \file nr-test-beam-change.cc
+ * \ingroup test
+ *
+ * \brief This test checks that BeamManager calls its beam change callback
+ * when the BeamId saved toward a device changes, and only then.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Save some beamforming vectors and count the beam changes
+ */
+class NrBeamChangeTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrBeamChangeTestCase ()
+    : TestCase ("Beam change callback of BeamManager")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief The beam change callback
+   * \param device the device
+   */
+  void BeamChanged (const Ptr<const NetDevice> &device);
+
+  std::vector<Ptr<const NetDevice>> m_changes; //!< The devices of the beam changes, in order
+};
+
+void
+NrBeamChangeTestCase::BeamChanged (const Ptr<const NetDevice> &device)
+{
+  m_changes.push_back (device);
+}
+
+void
+NrBeamChangeTestCase::DoRun ()
+{
+  Ptr<BeamManager> beamManager = CreateObject<BeamManager> ();
+  beamManager->SetBeamChangeCallback (MakeCallback (&NrBeamChangeTestCase::BeamChanged, this));
+
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<SimpleNetDevice> dev1 = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> dev2 = CreateObject<SimpleNetDevice> ();
+  node->AddDevice (dev1);
+  node->AddDevice (dev2);
+
+  complexVector_t vector (4);
+  beamManager->SaveBeamformingVector (BeamformingVector (vector, BeamId (1, 90)), dev1);
+  NS_TEST_ASSERT_MSG_EQ (m_changes.size (), 1U, "The first beam toward a device is not a change");
+
+  beamManager->SaveBeamformingVector (BeamformingVector (vector, BeamId (1, 90)), dev1);
+  NS_TEST_ASSERT_MSG_EQ (m_changes.size (), 1U, "The same beam is a change");
+
+  beamManager->SaveBeamformingVector (BeamformingVector (vector, BeamId (2, 90)), dev1);
+  beamManager->SaveBeamformingVector (BeamformingVector (vector, BeamId (2, 90)), dev2);
+  NS_TEST_ASSERT_MSG_EQ (m_changes.size (), 3U, "A new beam is not a change");
+  NS_TEST_ASSERT_MSG_EQ (m_changes.at (1), dev1, "Wrong device of the change");
+  NS_TEST_ASSERT_MSG_EQ (m_changes.at (2), dev2, "Wrong device of the change");
+
+  m_changes.clear ();
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief The beam change test suite
+ */
+class NrTestBeamChange : public TestSuite
+{
+public:
+  NrTestBeamChange () : TestSuite ("nr-test-beam-change", UNIT)
+  {
+    AddTestCase (new NrBeamChangeTestCase (), QUICK);
+  }
+};
+
+static NrTestBeamChange NrTestBeamChangeSuite; //!< Beam change test suite
+
+}  // namespace ns3
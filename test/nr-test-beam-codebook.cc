@@ -0,0 +1,158 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/node.h>
+#include <ns3/simple-net-device.h>
+#include <ns3/beam-manager.h>
+#include <ns3/nr-beam-codebook.h>
+#include <ns3/uniform-planar-array.h>
+#include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <fstream>
+
+/**
+ * \file nr-test-beam-codebook.cc
+ * \ingroup test
+ *
+ * \brief This test checks the predefined codebooks of NrBeamCodebook: the
+ * DFT beams are normalized and orthogonal, the codebooks are shared by the
+ * antennas with the same configuration, a codebook is loaded from a file,
+ * and a BeamManager with a codebook stores its beams by index.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Build, load and use some codebooks
+ */
+class NrBeamCodebookTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrBeamCodebookTestCase ()
+    : TestCase ("Predefined beam codebooks")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrBeamCodebookTestCase::DoRun ()
+{
+  auto createAntenna = [] (uint32_t rows, uint32_t columns)
+    {
+      Ptr<UniformPlanarArray> antenna = CreateObject<UniformPlanarArray> ();
+      antenna->SetAttribute ("NumRows", UintegerValue (rows));
+      antenna->SetAttribute ("NumColumns", UintegerValue (columns));
+      return antenna;
+    };
+  Ptr<UniformPlanarArray> antenna = createAntenna (4, 4);
+
+  auto dft = NrBeamCodebook::GetDft (antenna, 1, 1);
+  NS_TEST_ASSERT_MSG_EQ (dft->GetNumBeams (), 16U, "Wrong number of DFT beams");
+  NS_TEST_ASSERT_MSG_EQ (dft->GetVector (0).size (), 16U, "Wrong size of a DFT beam");
+  for (size_t a = 0; a < dft->GetNumBeams (); ++a)
+    {
+      for (size_t b = a; b < dft->GetNumBeams (); ++b)
+        {
+          std::complex<double> inner (0.0, 0.0);
+          for (size_t i = 0; i < 16; ++i)
+            {
+              inner += std::conj (dft->GetVector (a)[i]) * dft->GetVector (b)[i];
+            }
+          NS_TEST_ASSERT_MSG_EQ_TOL (std::abs (inner), a == b ? 1.0 : 0.0, 1e-9,
+                                     "The DFT beams " << a << " and " << b << " are not orthonormal");
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (dft->GetBeamId (5), NrBeamCodebook::GetIndexBeamId (5), "Wrong BeamId");
+  NS_TEST_ASSERT_MSG_EQ (NrBeamCodebook::IsIndexBeamId (dft->GetBeamId (5)), true, "Not an index BeamId");
+  NS_TEST_ASSERT_MSG_EQ (NrBeamCodebook::IsIndexBeamId (BeamId (5, 90)), false, "A directional beam is an index BeamId");
+
+  NS_TEST_ASSERT_MSG_EQ (NrBeamCodebook::GetDft (createAntenna (4, 4), 1, 1), dft,
+                         "The same configuration does not share the codebook");
+  NS_TEST_ASSERT_MSG_EQ (NrBeamCodebook::GetDft (antenna, 2, 2)->GetNumBeams (), 64U,
+                         "Wrong number of oversampled DFT beams");
+
+  // Two beams of two elements
+  std::string fileName = CreateTempDirFilename ("nr-test-beam-codebook.txt");
+  {
+    std::ofstream file (fileName);
+    file << "1 0 0 1\n\n0.5 0.5 -0.5 0.5\n";
+  }
+  auto loaded = NrBeamCodebook::Load (fileName, 2);
+  NS_TEST_ASSERT_MSG_EQ (loaded->GetNumBeams (), 2U, "Wrong number of beams in the file");
+  NS_TEST_ASSERT_MSG_EQ (loaded->GetVector (1)[1], std::complex<double> (-0.5, 0.5), "Wrong weight");
+  NS_TEST_ASSERT_MSG_EQ (NrBeamCodebook::Load (fileName, 2), loaded, "The file is loaded twice");
+
+  // The beams of the codebook are stored by index, the others as before
+  Ptr<BeamManager> beamManager = CreateObject<BeamManager> ();
+  beamManager->Configure (antenna);
+  beamManager->SetBeamCodebook (dft);
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<SimpleNetDevice> dev1 = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> dev2 = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> dev3 = CreateObject<SimpleNetDevice> ();
+  node->AddDevice (dev1);
+  node->AddDevice (dev2);
+  node->AddDevice (dev3);
+  beamManager->SaveBeamformingVector (BeamformingVector (dft->GetVector (5), dft->GetBeamId (5)), dev1);
+  beamManager->SaveBeamformingVector (BeamformingVector (dft->GetVector (6), dft->GetBeamId (6)), dev2);
+  complexVector_t directional = CreateDirectionalBfv (antenna, 1, 90);
+  beamManager->SaveBeamformingVector (BeamformingVector (directional, BeamId (1, 90)), dev3);
+
+  NS_TEST_ASSERT_MSG_EQ ((beamManager->GetBeamformingVector (dev1) == dft->GetVector (5)), true,
+                         "Wrong vector of a beam stored by index");
+  NS_TEST_ASSERT_MSG_EQ (beamManager->GetBeamId (dev1), dft->GetBeamId (5), "Wrong BeamId of a beam stored by index");
+  NS_TEST_ASSERT_MSG_EQ ((beamManager->GetBeamformingVector (dev3) == directional), true,
+                         "Wrong vector of a directional beam");
+  NS_TEST_ASSERT_MSG_EQ_TOL (beamManager->GetBeamCoupling (dft->GetBeamId (5), dft->GetBeamId (6)), 0.0, 1e-9,
+                             "Wrong coupling of two orthogonal beams");
+  beamManager->ChangeBeamformingVector (dev2);
+  NS_TEST_ASSERT_MSG_EQ ((beamManager->GetCurrentBeamformingVector () == dft->GetVector (6)), true,
+                         "Wrong vector applied to the antenna");
+
+  // Without the codebook, the beams keep their vector
+  beamManager->SetBeamCodebook (nullptr);
+  NS_TEST_ASSERT_MSG_EQ ((beamManager->GetBeamformingVector (dev1) == dft->GetVector (5)), true,
+                         "The vector of a beam stored by index is lost");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief The beam codebook test suite
+ */
+class NrTestBeamCodebook : public TestSuite
+{
+public:
+  NrTestBeamCodebook () : TestSuite ("nr-test-beam-codebook", UNIT)
+  {
+    AddTestCase (new NrBeamCodebookTestCase (), QUICK);
+  }
+};
+
+static NrTestBeamCodebook NrTestBeamCodebookSuite; //!< Beam codebook test suite
+
+}  // namespace ns3
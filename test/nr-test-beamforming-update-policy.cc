@@ -0,0 +1,227 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/nr-module.h>
+#include <ns3/nr-counters.h>
+
+/**
+ * \file nr-test-beamforming-update-policy.cc
+ * \ingroup test
+ *
+ * \brief This test moves the UE of a gNB-UE pair step by step, and counts
+ * the beamforming searches of IdealBeamformingHelper (the
+ * BEAMFORMING_SEARCHES counter of NrCounters, with the cache disabled).
+ * With the MobilityTriggered policy, a search must happen when the UE has
+ * moved more than MobilityDistanceThreshold, or the gNB-UE direction has
+ * turned more than MobilityAngleThreshold, since the previous search, and
+ * not before; the periodic check must not search if nothing moved. With
+ * the Periodic policy, a search must happen at each period, and not at
+ * the moves.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Move the UE and check the instants of the beamforming searches
+ */
+class NrBeamformingUpdatePolicyTestCase : public TestCase
+{
+public:
+  /**
+   * \brief The scenario
+   */
+  enum Mode
+  {
+    DISTANCE, //!< MobilityTriggered, the UE moves away from the gNB
+    ANGLE,    //!< MobilityTriggered, the UE moves sideways
+    PERIODIC  //!< Periodic, the UE moves away from the gNB
+  };
+
+  /**
+   * \brief Constructor
+   * \param mode the scenario
+   */
+  NrBeamformingUpdatePolicyTestCase (Mode mode)
+    : TestCase (mode == DISTANCE ? "Beamforming update after a distance" :
+                mode == ANGLE ? "Beamforming update after an angle" :
+                "Periodic beamforming update"),
+    m_mode (mode)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Check the number of searches since the start
+   * \param expected the expected number
+   */
+  void CheckSearches (uint64_t expected);
+
+  Mode m_mode; //!< The scenario
+};
+
+void
+NrBeamformingUpdatePolicyTestCase::CheckSearches (uint64_t expected)
+{
+  uint64_t searches = 0;
+  for (const auto &values : NrCounters::GetSnapshot ())
+    {
+      searches += values.second[NrCounters::BEAMFORMING_SEARCHES];
+    }
+  NS_TEST_EXPECT_MSG_EQ (searches, expected, "Wrong number of beamforming searches at " <<
+                         Simulator::Now ().As (Time::MS));
+}
+
+void
+NrBeamformingUpdatePolicyTestCase::DoRun ()
+{
+  Config::SetDefault ("ns3::ThreeGppChannelModel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+  NrCounters::SetEnabled (true);
+  NrCounters::Reset ();
+
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (1);
+  ueNodes.Create (1);
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (gnbNodes);
+  mobility.Install (ueNodes);
+  gnbNodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (0, 0, 10));
+  Ptr<MobilityModel> ueMobility = ueNodes.Get (0)->GetObject<MobilityModel> ();
+  ueMobility->SetPosition (Vector (20, 0, 1.5));
+
+  Ptr<NrPointToPointEpcHelper> epcHelper = CreateObject<NrPointToPointEpcHelper> ();
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  nrHelper->SetEpcHelper (epcHelper);
+
+  // Without the cache, each triggered or periodic update is a search
+  Ptr<IdealBeamformingHelper> idealBeamformingHelper = CreateObject<IdealBeamformingHelper> ();
+  idealBeamformingHelper->SetAttribute ("BeamformingMethod", TypeIdValue (DirectPathBeamforming::GetTypeId ()));
+  idealBeamformingHelper->SetAttribute ("BeamformingPeriodicity", TimeValue (MilliSeconds (100)));
+  idealBeamformingHelper->SetAttribute ("BeamformingCache", BooleanValue (false));
+  if (m_mode == PERIODIC)
+    {
+      idealBeamformingHelper->SetAttribute ("UpdatePolicy", EnumValue (IdealBeamformingHelper::PERIODIC));
+    }
+  else
+    {
+      idealBeamformingHelper->SetAttribute ("UpdatePolicy", EnumValue (IdealBeamformingHelper::MOBILITY_TRIGGERED));
+      idealBeamformingHelper->SetAttribute ("MobilityDistanceThreshold", DoubleValue (m_mode == DISTANCE ? 1.0 : 10.0));
+      idealBeamformingHelper->SetAttribute ("MobilityAngleThreshold", DoubleValue (m_mode == ANGLE ? 5.0 : 10.0));
+    }
+  nrHelper->SetBeamformingHelper (idealBeamformingHelper);
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (2e9, 20e6, 1, BandwidthPartInfo::UMa_LoS);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  NetDeviceContainer gnbDevices = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  NetDeviceContainer ueDevices = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  int64_t randomStream = 1;
+  randomStream += nrHelper->AssignStreams (gnbDevices, randomStream);
+  nrHelper->AssignStreams (ueDevices, randomStream);
+
+  InternetStackHelper internet;
+  internet.Install (ueNodes);
+  epcHelper->AssignUeIpv4Address (ueDevices);
+
+  // The attachment searches the vectors of the pair once
+  nrHelper->AttachToEnb (ueDevices.Get (0), gnbDevices.Get (0));
+  CheckSearches (1);
+
+  // The moves of the UE, and the expected searches after each of them
+  std::vector<std::pair<Vector, uint64_t>> moves;
+  if (m_mode == ANGLE)
+    {
+      // 2.6 degrees, then 5.3 degrees: search; 2.6 degrees since the
+      // search, then 6.4 degrees: search
+      moves = {{Vector (20, 1, 1.5), 1}, {Vector (20, 2, 1.5), 2},
+               {Vector (20, 3, 1.5), 2}, {Vector (20, 4.5, 1.5), 3}};
+    }
+  else
+    {
+      // 0.5 m, 0.9 m, then 1.2 m: search; 0.5 m since the search, then 1.1 m: search
+      moves = {{Vector (20.5, 0, 1.5), 1}, {Vector (20.9, 0, 1.5), 1},
+               {Vector (21.2, 0, 1.5), 2}, {Vector (21.7, 0, 1.5), 2},
+               {Vector (22.3, 0, 1.5), 3}};
+    }
+
+  // The moves at 10, 20, 30, 40 (and 150) ms, around the periodic check at 100 ms
+  for (size_t i = 0; i < moves.size (); ++i)
+    {
+      Time t = i < 4 ? MilliSeconds (10 * (i + 1)) : MilliSeconds (150);
+      Simulator::Schedule (t, &MobilityModel::SetPosition, ueMobility, moves[i].first);
+      if (m_mode != PERIODIC)
+        {
+          Simulator::Schedule (t + MilliSeconds (5), &NrBeamformingUpdatePolicyTestCase::CheckSearches,
+                               this, moves[i].second);
+        }
+    }
+
+  if (m_mode == PERIODIC)
+    {
+      // One search per period, whatever the moves
+      Simulator::Schedule (MilliSeconds (45), &NrBeamformingUpdatePolicyTestCase::CheckSearches, this, 1);
+      Simulator::Schedule (MilliSeconds (155), &NrBeamformingUpdatePolicyTestCase::CheckSearches, this, 2);
+      Simulator::Schedule (MilliSeconds (255), &NrBeamformingUpdatePolicyTestCase::CheckSearches, this, 3);
+    }
+  else
+    {
+      // Nothing moved between 40 and 100 ms, nor after the last move: the
+      // periodic checks do not search
+      Simulator::Schedule (MilliSeconds (105), &NrBeamformingUpdatePolicyTestCase::CheckSearches,
+                           this, moves[3].second);
+      Simulator::Schedule (MilliSeconds (255), &NrBeamformingUpdatePolicyTestCase::CheckSearches,
+                           this, moves.back ().second);
+    }
+
+  Simulator::Stop (MilliSeconds (260));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  NrCounters::SetEnabled (false);
+  NrCounters::Reset ();
+}
+
+/**
+ * \ingroup test
+ * \brief The beamforming update policy test suite
+ */
+class NrTestBeamformingUpdatePolicySuite : public TestSuite
+{
+public:
+  NrTestBeamformingUpdatePolicySuite () : TestSuite ("nr-test-beamforming-update-policy", SYSTEM)
+  {
+    AddTestCase (new NrBeamformingUpdatePolicyTestCase (NrBeamformingUpdatePolicyTestCase::DISTANCE), QUICK);
+    AddTestCase (new NrBeamformingUpdatePolicyTestCase (NrBeamformingUpdatePolicyTestCase::ANGLE), QUICK);
+    AddTestCase (new NrBeamformingUpdatePolicyTestCase (NrBeamformingUpdatePolicyTestCase::PERIODIC), QUICK);
+  }
+};
+
+static NrTestBeamformingUpdatePolicySuite nrTestBeamformingUpdatePolicySuite; //!< Beamforming update policy test suite
+
+}  // namespace ns3
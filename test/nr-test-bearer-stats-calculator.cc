@@ -0,0 +1,142 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/string.h>
+#include <ns3/nr-bearer-stats-calculator.h>
+#include <cmath>
+#include <fstream>
+
+/**
+ * \file nr-test-bearer-stats-calculator.cc
+ * \ingroup test
+ *
+ * \brief This test notifies some PDUs of two bearers to NrBearerStatsCalculator
+ * and checks the counters, the delay and PDU size statistics, and the lines
+ * written to the output files.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Notify the PDUs of two bearers and check the statistics
+ */
+class NrBearerStatsCalculatorTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrBearerStatsCalculatorTestCase ()
+    : TestCase ("Bearer stats calculator counters and statistics")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \param fileName the name of the file
+   * \return the number of lines of the file
+   */
+  static uint32_t CountLines (const std::string &fileName);
+};
+
+uint32_t
+NrBearerStatsCalculatorTestCase::CountLines (const std::string &fileName)
+{
+  std::ifstream file (fileName);
+  std::string line;
+  uint32_t lines = 0;
+  while (std::getline (file, line))
+    {
+      ++lines;
+    }
+  return lines;
+}
+
+void
+NrBearerStatsCalculatorTestCase::DoRun ()
+{
+  std::string dlFileName = CreateTempDirFilename ("nr-test-bearer-stats-dl.txt");
+  std::string ulFileName = CreateTempDirFilename ("nr-test-bearer-stats-ul.txt");
+
+  Ptr<NrBearerStatsCalculator> stats = CreateObject<NrBearerStatsCalculator> ();
+  stats->SetAttribute ("DlRlcOutputFilename", StringValue (dlFileName));
+  stats->SetAttribute ("UlRlcOutputFilename", StringValue (ulFileName));
+
+  // IMSI 7, LCID 3: two DL PDUs, both received
+  stats->DlTxPdu (1, 7, 2, 3, 100);
+  stats->DlTxPdu (1, 7, 2, 3, 300);
+  stats->DlRxPdu (1, 7, 2, 3, 100, 1000);
+  stats->DlRxPdu (1, 7, 2, 3, 300, 3000);
+
+  // IMSI 8, LCID 4: one UL PDU, not received
+  stats->UlTxPdu (2, 8, 5, 4, 50);
+
+  NS_TEST_ASSERT_MSG_EQ (stats->GetDlTxPackets (7, 3), 2, "Wrong DL TX packets");
+  NS_TEST_ASSERT_MSG_EQ (stats->GetDlTxData (7, 3), 400, "Wrong DL TX data");
+  NS_TEST_ASSERT_MSG_EQ (stats->GetDlRxPackets (7, 3), 2, "Wrong DL RX packets");
+  NS_TEST_ASSERT_MSG_EQ (stats->GetDlRxData (7, 3), 400, "Wrong DL RX data");
+  NS_TEST_ASSERT_MSG_EQ (stats->GetDlCellId (7, 3), 1, "Wrong DL cell ID");
+  NS_TEST_ASSERT_MSG_EQ (stats->GetUlTxPackets (7, 3), 0, "UL TX packets for a DL bearer");
+
+  std::vector<double> delay = stats->GetDlDelayStats (7, 3);
+  NS_TEST_ASSERT_MSG_EQ_TOL (delay.at (0), 2000.0, 1e-9, "Wrong average delay");
+  NS_TEST_ASSERT_MSG_EQ_TOL (delay.at (1), std::sqrt (2e6), 1e-6, "Wrong delay standard deviation");
+  NS_TEST_ASSERT_MSG_EQ (delay.at (2), 1000.0, "Wrong min delay");
+  NS_TEST_ASSERT_MSG_EQ (delay.at (3), 3000.0, "Wrong max delay");
+  NS_TEST_ASSERT_MSG_EQ_TOL (stats->GetDlDelay (7, 3), 2000.0, 1e-9, "Wrong average delay");
+
+  std::vector<double> pduSize = stats->GetDlPduSizeStats (7, 3);
+  NS_TEST_ASSERT_MSG_EQ_TOL (pduSize.at (0), 200.0, 1e-9, "Wrong average PDU size");
+  NS_TEST_ASSERT_MSG_EQ (pduSize.at (2), 100.0, "Wrong min PDU size");
+  NS_TEST_ASSERT_MSG_EQ (pduSize.at (3), 300.0, "Wrong max PDU size");
+
+  NS_TEST_ASSERT_MSG_EQ (stats->GetUlTxPackets (8, 4), 1, "Wrong UL TX packets");
+  NS_TEST_ASSERT_MSG_EQ (stats->GetUlTxData (8, 4), 50, "Wrong UL TX data");
+  NS_TEST_ASSERT_MSG_EQ (stats->GetUlRxPackets (8, 4), 0, "Wrong UL RX packets");
+  NS_TEST_ASSERT_MSG_EQ (stats->GetUlDelayStats (8, 4).at (0), 0.0, "Delay without RX PDUs");
+
+  // Unknown bearer
+  NS_TEST_ASSERT_MSG_EQ (stats->GetDlTxPackets (9, 3), 0, "TX packets of an unknown bearer");
+  NS_TEST_ASSERT_MSG_EQ (stats->GetDlPduSizeStats (9, 3).at (3), 0.0, "PDU size of an unknown bearer");
+
+  // The pending output is written at the disposal: a header and a line per bearer
+  stats->Dispose ();
+  NS_TEST_ASSERT_MSG_EQ (CountLines (dlFileName), 2, "Wrong number of DL lines");
+  NS_TEST_ASSERT_MSG_EQ (CountLines (ulFileName), 2, "Wrong number of UL lines");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrBearerStatsCalculator test suite
+ */
+class NrTestBearerStatsCalculator : public TestSuite
+{
+public:
+  NrTestBearerStatsCalculator () : TestSuite ("nr-test-bearer-stats-calculator", UNIT)
+  {
+    AddTestCase (new NrBearerStatsCalculatorTestCase (), QUICK);
+  }
+};
+
+static NrTestBearerStatsCalculator NrTestBearerStatsCalculatorSuite; //!< NrBearerStatsCalculator test suite
+
+}  // namespace ns3
@@ -0,0 +1,202 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-binary-trace.h>
+#include <fstream>
+#include <sstream>
+
+/**
+ * \file nr-test-binary-trace.cc
+ * \ingroup test
+ *
+ * \brief This test writes a binary trace file with NrBinaryTraceWriter and
+ * checks that NrBinaryTraceReader reads back the same header and values,
+ * both as numbers and as text. The file is written both directly and
+ * through the thread of NrTraceQueue. It also checks that the reader rejects
+ * a header without columns or with a column of unknown type.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Write and read back a binary trace file
+ */
+class NrBinaryTraceTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param async whether the records are written through NrTraceQueue
+   */
+  NrBinaryTraceTestCase (bool async)
+    : TestCase (std::string ("Binary trace write/read round trip") + (async ? " through the trace queue" : "")),
+    m_async (async)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  bool m_async; //!< Whether the records are written through NrTraceQueue
+};
+
+void
+NrBinaryTraceTestCase::DoRun ()
+{
+  std::string fileName = CreateTempDirFilename ("nr-test-binary-trace.bin");
+
+  NrBinaryTraceWriter writer;
+  writer.Open (fileName, {{"Time", NrBinaryTraceColumn::DOUBLE},
+                          {"rnti", NrBinaryTraceColumn::UINT16},
+                          {"mcs", NrBinaryTraceColumn::UINT8},
+                          {"tbSize", NrBinaryTraceColumn::UINT32},
+                          {"cellId", NrBinaryTraceColumn::UINT64}});
+  writer.SetAsync (m_async);
+  for (uint32_t i = 0; i < 10; ++i)
+    {
+      writer.Add<double> (i * 0.25)
+            .Add<uint16_t> (i + 1)
+            .Add<uint8_t> (27 - i)
+            .Add<uint32_t> (1000 * i)
+            .Add<uint64_t> (i % 3)
+            .EndRecord ();
+    }
+  writer.Close ();
+
+  NrBinaryTraceReader reader;
+  NS_TEST_ASSERT_MSG_EQ (reader.Open (fileName), true, "Could not read back the file");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetColumns ().size (), 5, "Wrong number of columns");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetColumns ().at (3).m_name, "tbSize", "Wrong column name");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetColumns ().at (3).m_type, NrBinaryTraceColumn::UINT32,
+                         "Wrong column type");
+
+  std::vector<double> values;
+  NS_TEST_ASSERT_MSG_EQ (reader.ReadRecord (&values), true, "Missing first record");
+  NS_TEST_ASSERT_MSG_EQ (values.at (0), 0.0, "Wrong time");
+  NS_TEST_ASSERT_MSG_EQ (values.at (1), 1.0, "Wrong RNTI");
+  NS_TEST_ASSERT_MSG_EQ (values.at (2), 27.0, "Wrong MCS");
+
+  NS_TEST_ASSERT_MSG_EQ (reader.ReadRecord (&values), true, "Missing second record");
+  NS_TEST_ASSERT_MSG_EQ (values.at (0), 0.25, "Wrong time");
+  NS_TEST_ASSERT_MSG_EQ (values.at (3), 1000.0, "Wrong TB size");
+  NS_TEST_ASSERT_MSG_EQ (values.at (4), 1.0, "Wrong cell ID");
+
+  std::ostringstream text;
+  uint64_t records = reader.ConvertToText (text, ',');
+  NS_TEST_ASSERT_MSG_EQ (records, 8, "Wrong number of remaining records");
+
+  std::istringstream lines (text.str ());
+  std::string line;
+  std::getline (lines, line);
+  NS_TEST_ASSERT_MSG_EQ (line, "Time,rnti,mcs,tbSize,cellId", "Wrong text header");
+  std::getline (lines, line);
+  NS_TEST_ASSERT_MSG_EQ (line, "0.5,3,25,2000,2", "Wrong text record");
+
+  NS_TEST_ASSERT_MSG_EQ (reader.ReadRecord (&values), false, "Records after the end of the file");
+}
+
+/**
+ * \ingroup test
+ * \brief Read a binary trace file whose header was corrupted
+ */
+class NrBinaryTraceMalformedTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Corruption of the header
+   */
+  enum Corruption
+  {
+    NO_COLUMNS,   //!< The number of columns is 0
+    UNKNOWN_TYPE  //!< The type of the first column is not a NrBinaryTraceColumn::Type
+  };
+
+  /**
+   * \brief Constructor
+   * \param corruption the corruption of the header
+   */
+  NrBinaryTraceMalformedTestCase (Corruption corruption)
+    : TestCase (std::string ("Binary trace with ") + (corruption == NO_COLUMNS ? "no columns" : "an unknown column type")),
+    m_corruption (corruption)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  Corruption m_corruption; //!< The corruption of the header
+};
+
+void
+NrBinaryTraceMalformedTestCase::DoRun ()
+{
+  std::string fileName = CreateTempDirFilename ("nr-test-binary-trace-malformed.bin");
+
+  NrBinaryTraceWriter writer;
+  writer.Open (fileName, {{"Time", NrBinaryTraceColumn::DOUBLE}});
+  writer.Add<double> (1.0).EndRecord ();
+  writer.Close ();
+
+  // The magic string (4 bytes), the version (2) and the byte-order mark (4)
+  // come before the number of columns (2), then the type of the first column
+  std::fstream file (fileName.c_str (), std::ios::in | std::ios::out | std::ios::binary);
+  if (m_corruption == NO_COLUMNS)
+    {
+      uint16_t numColumns = 0;
+      file.seekp (10);
+      file.write (reinterpret_cast<const char*> (&numColumns), sizeof (numColumns));
+    }
+  else
+    {
+      uint8_t type = NrBinaryTraceColumn::DOUBLE + 1;
+      file.seekp (12);
+      file.write (reinterpret_cast<const char*> (&type), sizeof (type));
+    }
+  file.close ();
+
+  NrBinaryTraceReader reader;
+  NS_TEST_ASSERT_MSG_EQ (reader.Open (fileName), false, "Malformed header accepted");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetColumns ().size (), 0, "Columns of a malformed header");
+
+  std::vector<double> values;
+  NS_TEST_ASSERT_MSG_EQ (reader.ReadRecord (&values), false, "Record read after a malformed header");
+  std::ostringstream text;
+  NS_TEST_ASSERT_MSG_EQ (reader.ConvertToText (text, ','), 0, "Records converted after a malformed header");
+}
+
+/**
+ * \ingroup test
+ * \brief The binary trace test suite
+ */
+class NrTestBinaryTrace : public TestSuite
+{
+public:
+  NrTestBinaryTrace () : TestSuite ("nr-test-binary-trace", UNIT)
+  {
+    AddTestCase (new NrBinaryTraceTestCase (false), QUICK);
+    AddTestCase (new NrBinaryTraceTestCase (true), QUICK);
+    AddTestCase (new NrBinaryTraceMalformedTestCase (NrBinaryTraceMalformedTestCase::NO_COLUMNS), QUICK);
+    AddTestCase (new NrBinaryTraceMalformedTestCase (NrBinaryTraceMalformedTestCase::UNKNOWN_TYPE), QUICK);
+  }
+};
+
+static NrTestBinaryTrace NrTestBinaryTraceSuite; //!< Binary trace test suite
+
+}  // namespace ns3
@@ -0,0 +1,125 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-bitset.h>
+#include <algorithm>
+
+/**
+ * \file nr-test-bitset.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrBitset gives the same results as the
+ * std::vector<uint8_t> RBG masks it replaces, for masks stored inside the
+ * object and on the heap.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Compare a NrBitset with a byte mask of a given size
+ */
+class NrBitsetTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param size the number of bits
+   */
+  NrBitsetTestCase (uint32_t size)
+    : TestCase ("Bitset with " + std::to_string (size) + " bits"),
+    m_size (size)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  uint32_t m_size; //!< Number of bits
+};
+
+void
+NrBitsetTestCase::DoRun ()
+{
+  // One RBG every three is notched, as in a notching mask
+  std::vector<uint8_t> notch (m_size, 1);
+  for (uint32_t i = 0; i < m_size; i += 3)
+    {
+      notch[i] = 0;
+    }
+  NrBitset notchMask (notch);
+
+  NS_TEST_ASSERT_MSG_EQ (notchMask.size (), m_size, "Wrong size");
+  NS_TEST_ASSERT_MSG_EQ ((notchMask.ToVector () == notch), true, "The conversion is not reversible");
+  NS_TEST_ASSERT_MSG_EQ (notchMask.count (), static_cast<size_t> (std::count (notch.begin (), notch.end (), 1)),
+                         "Wrong number of bits set");
+
+  size_t visited = 0;
+  for (size_t i = notchMask.FindFirst (); i < notchMask.size (); i = notchMask.FindNext (i))
+    {
+      NS_TEST_ASSERT_MSG_EQ (+notch[i], 1, "Visited a bit that is not set");
+      ++visited;
+    }
+  NS_TEST_ASSERT_MSG_EQ (visited, notchMask.count (), "Not all the bits set were visited");
+
+  // The second half of the band, ANDed with the notching mask
+  NrBitset half (m_size);
+  for (uint32_t i = m_size / 2; i < m_size; ++i)
+    {
+      half.set (i);
+    }
+  NrBitset allocated = half;
+  allocated &= notchMask;
+  for (uint32_t i = 0; i < m_size; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (allocated.test (i), i >= m_size / 2 && notch[i] == 1, "Wrong AND at " << i);
+    }
+
+  allocated |= notchMask;
+  NS_TEST_ASSERT_MSG_EQ ((allocated == notchMask), true, "Wrong OR");
+
+  allocated.set ();
+  NS_TEST_ASSERT_MSG_EQ (allocated.count (), m_size, "Wrong set of all the bits");
+  allocated.resize (m_size / 2);
+  NS_TEST_ASSERT_MSG_EQ (allocated.count (), m_size / 2, "The bits dropped by resize are still counted");
+  allocated.resize (m_size);
+  NS_TEST_ASSERT_MSG_EQ (allocated.count (), m_size / 2, "The bits added by resize are not cleared");
+  allocated.reset ();
+  NS_TEST_ASSERT_MSG_EQ (allocated.none (), true, "Wrong reset of all the bits");
+  NS_TEST_ASSERT_MSG_EQ (allocated.FindFirst (), allocated.size (), "A bit is found in an empty bitset");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrBitset test suite
+ */
+class NrTestBitset : public TestSuite
+{
+public:
+  NrTestBitset () : TestSuite ("nr-test-bitset", UNIT)
+  {
+    AddTestCase (new NrBitsetTestCase (17), QUICK);
+    AddTestCase (new NrBitsetTestCase (64), QUICK);
+    AddTestCase (new NrBitsetTestCase (275), QUICK);
+  }
+};
+
+static NrTestBitset NrTestBitsetSuite; //!< NrBitset test suite
+
+}  // namespace ns3
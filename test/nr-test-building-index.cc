@@ -0,0 +1,166 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/node.h>
+#include <ns3/double.h>
+#include <ns3/random-variable-stream.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/buildings-module.h>
+#include <ns3/nr-building-index.h>
+
+/**
+ * \file nr-test-building-index.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrBuildingIndex finds the same building of a
+ * position and the same blocked lines of sight as a walk over the whole
+ * BuildingList, and that NrBuildingsChannelConditionModel gives the
+ * condition of BuildingsChannelConditionModel.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Compare the index of the buildings with the BuildingList
+ */
+class NrBuildingIndexTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param cellSize the cell size of the index
+   */
+  NrBuildingIndexTestCase (double cellSize)
+    : TestCase ("Building index with cells of " + std::to_string (cellSize) + " m"),
+      m_cellSize (cellSize)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \param position a position
+   * \return a mobility model at the position, with its MobilityBuildingInfo
+   */
+  static Ptr<MobilityModel> CreateMobility (const Vector &position);
+
+  double m_cellSize; //!< The cell size of the index
+};
+
+Ptr<MobilityModel>
+NrBuildingIndexTestCase::CreateMobility (const Vector &position)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<MobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (position);
+  node->AggregateObject (mobility);
+  Ptr<MobilityBuildingInfo> buildingInfo = CreateObject<MobilityBuildingInfo> ();
+  mobility->AggregateObject (buildingInfo);
+  buildingInfo->MakeConsistent (mobility);
+  return mobility;
+}
+
+void
+NrBuildingIndexTestCase::DoRun ()
+{
+  // A grid of 8x8 buildings of 20 m, separated by streets of 10 m
+  for (uint32_t i = 0; i < 8; ++i)
+    {
+      for (uint32_t j = 0; j < 8; ++j)
+        {
+          Ptr<Building> building = CreateObject<Building> ();
+          building->SetBoundaries (Box (30.0 * i, 30.0 * i + 20.0, 30.0 * j, 30.0 * j + 20.0, 0.0, 15.0));
+        }
+    }
+
+  Ptr<const NrBuildingIndex> index = NrBuildingIndex::GetIndex (m_cellSize);
+  NS_TEST_ASSERT_MSG_EQ (index->GetNumBuildings (), 64U, "Wrong number of buildings");
+  NS_TEST_ASSERT_MSG_EQ (NrBuildingIndex::GetIndex (m_cellSize), index, "The index is not shared");
+
+  Ptr<UniformRandomVariable> uniform = CreateObject<UniformRandomVariable> ();
+  uniform->SetStream (1);
+  auto drawPosition = [&uniform] ()
+    {
+      return Vector (uniform->GetValue (-50.0, 280.0), uniform->GetValue (-50.0, 280.0), uniform->GetValue (1.0, 20.0));
+    };
+
+  for (uint32_t n = 0; n < 2000; ++n)
+    {
+      Vector l1 = drawPosition ();
+      Vector l2 = drawPosition ();
+
+      Ptr<Building> expected;
+      bool blocked = false;
+      for (BuildingList::Iterator it = BuildingList::Begin (); it != BuildingList::End (); ++it)
+        {
+          if (expected == nullptr && (*it)->IsInside (l1))
+            {
+              expected = *it;
+            }
+          blocked = blocked || (*it)->GetBoundaries ().IsIntersect (l1, l2);
+        }
+      NS_TEST_ASSERT_MSG_EQ (index->GetBuilding (l1), expected, "Wrong building of " << l1);
+      NS_TEST_ASSERT_MSG_EQ (index->IsLineOfSightBlocked (l1, l2), blocked,
+                             "Wrong line of sight between " << l1 << " and " << l2);
+    }
+
+  // Along a street, and across the corners of the buildings
+  NS_TEST_ASSERT_MSG_EQ (index->IsLineOfSightBlocked (Vector (25.0, -10.0, 1.5), Vector (25.0, 250.0, 1.5)), false,
+                         "A street is blocked");
+  NS_TEST_ASSERT_MSG_EQ (index->IsLineOfSightBlocked (Vector (-10.0, -10.0, 1.5), Vector (250.0, 250.0, 1.5)), true,
+                         "A diagonal is not blocked");
+
+  Ptr<BuildingsChannelConditionModel> reference = CreateObject<BuildingsChannelConditionModel> ();
+  Ptr<NrBuildingsChannelConditionModel> model =
+    CreateObjectWithAttributes<NrBuildingsChannelConditionModel> ("CellSize", DoubleValue (m_cellSize));
+  for (uint32_t n = 0; n < 500; ++n)
+    {
+      Ptr<MobilityModel> a = CreateMobility (drawPosition ());
+      Ptr<MobilityModel> b = CreateMobility (drawPosition ());
+      Ptr<ChannelCondition> expected = reference->GetChannelCondition (a, b);
+      Ptr<ChannelCondition> cond = model->GetChannelCondition (a, b);
+      NS_TEST_ASSERT_MSG_EQ (cond->GetLosCondition (), expected->GetLosCondition (),
+                             "Wrong LOS condition between " << a->GetPosition () << " and " << b->GetPosition ());
+      NS_TEST_ASSERT_MSG_EQ (cond->GetO2iCondition (), expected->GetO2iCondition (),
+                             "Wrong O2I condition between " << a->GetPosition () << " and " << b->GetPosition ());
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief The NrBuildingIndex test suite
+ */
+class NrTestBuildingIndex : public TestSuite
+{
+public:
+  NrTestBuildingIndex () : TestSuite ("nr-test-building-index", UNIT)
+  {
+    AddTestCase (new NrBuildingIndexTestCase (20.0), QUICK);
+    AddTestCase (new NrBuildingIndexTestCase (7.0), QUICK);
+  }
+};
+
+static NrTestBuildingIndex NrTestBuildingIndexSuite; //!< NrBuildingIndex test suite
+
+}  // namespace ns3
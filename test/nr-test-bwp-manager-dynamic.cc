@@ -0,0 +1,178 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/bwp-manager-algorithm.h>
+#include <ns3/uinteger.h>
+#include <ns3/double.h>
+#include <ns3/enum.h>
+
+/**
+ * \file nr-test-bwp-manager-dynamic.cc
+ * \ingroup test
+ *
+ * \brief This test checks that BwpManagerAlgorithmDynamic moves the QCIs
+ * away from the loaded BWP, one QCI per evaluation, only when the spare
+ * capacity of the best BWP exceeds the hysteresis, and that it weights the
+ * spare capacity with the reported CQI.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the QCI moves of BwpManagerAlgorithmDynamic
+ */
+class NrBwpManagerDynamicTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrBwpManagerDynamicTestCase ()
+    : TestCase ("Dynamic BWP manager, QCI moves on load")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Create the algorithm, with QCIs 1 and 9 on BWP 0
+   * \return the algorithm
+   */
+  static Ptr<BwpManagerAlgorithmDynamic> CreateAlgorithm ();
+
+  /**
+   * \brief Report a full load window of the two BWPs
+   * \param algorithm the algorithm
+   * \param isDl the direction of the slots
+   * \param used0 the resources used in each slot of BWP 0
+   * \param used1 the resources used in each slot of BWP 1
+   */
+  static void ReportWindow (const Ptr<BwpManagerAlgorithmDynamic> &algorithm, bool isDl,
+                            uint32_t used0, uint32_t used1);
+
+  static constexpr uint32_t m_window = 10;      //!< The load window, in slots
+  static constexpr uint32_t m_available = 100;  //!< The resources available in each slot
+};
+
+Ptr<BwpManagerAlgorithmDynamic>
+NrBwpManagerDynamicTestCase::CreateAlgorithm ()
+{
+  Ptr<BwpManagerAlgorithmDynamic> algorithm = CreateObject<BwpManagerAlgorithmDynamic> ();
+  algorithm->SetAttribute ("LoadWindow", UintegerValue (m_window));
+  algorithm->SetAttribute ("Hysteresis", DoubleValue (0.2));
+  algorithm->SetAttribute ("LoadDirection", EnumValue (BwpManagerAlgorithmDynamic::DL));
+  algorithm->GetBwpForEpsBearer (EpsBearer::GBR_CONV_VOICE);
+  algorithm->GetBwpForEpsBearer (EpsBearer::NGBR_VIDEO_TCP_DEFAULT);
+  return algorithm;
+}
+
+void
+NrBwpManagerDynamicTestCase::ReportWindow (const Ptr<BwpManagerAlgorithmDynamic> &algorithm, bool isDl,
+                                           uint32_t used0, uint32_t used1)
+{
+  for (uint32_t slot = 0; slot < m_window; ++slot)
+    {
+      SfnSf sfnSf (0, static_cast<uint8_t> (slot), 0, 0);
+      algorithm->ReportSlotLoad (sfnSf, isDl, 0, used0, m_available);
+      algorithm->ReportSlotLoad (sfnSf, isDl, 1, used1, m_available);
+    }
+}
+
+void
+NrBwpManagerDynamicTestCase::DoRun ()
+{
+  // BWP 0 full, BWP 1 empty: one QCI moves at each evaluation
+  auto algorithm = CreateAlgorithm ();
+  uint32_t version = algorithm->GetMappingVersion ();
+  ReportWindow (algorithm, true, m_available, 0);
+  NS_TEST_ASSERT_MSG_EQ_TOL (algorithm->GetBwpLoad (0), 1.0, 1e-9, "Wrong load of BWP 0");
+  NS_TEST_ASSERT_MSG_EQ_TOL (algorithm->GetBwpLoad (1), 0.0, 1e-9, "Wrong load of BWP 1");
+  NS_TEST_ASSERT_MSG_EQ (+algorithm->GetBwpForEpsBearer (EpsBearer::GBR_CONV_VOICE), 1,
+                         "The first QCI of the loaded BWP did not move");
+  NS_TEST_ASSERT_MSG_EQ (+algorithm->GetBwpForEpsBearer (EpsBearer::NGBR_VIDEO_TCP_DEFAULT), 0,
+                         "More than one QCI moved in one evaluation");
+  NS_TEST_ASSERT_MSG_EQ (algorithm->GetMappingVersion (), version + 1,
+                         "The move did not change the mapping version");
+
+  ReportWindow (algorithm, true, m_available, 0);
+  NS_TEST_ASSERT_MSG_EQ (+algorithm->GetBwpForEpsBearer (EpsBearer::NGBR_VIDEO_TCP_DEFAULT), 1,
+                         "The second QCI of the loaded BWP did not move");
+  NS_TEST_ASSERT_MSG_EQ (algorithm->GetMappingVersion (), version + 2,
+                         "The move did not change the mapping version");
+
+  // All the QCIs are on the best BWP: nothing moves
+  ReportWindow (algorithm, true, m_available, 0);
+  NS_TEST_ASSERT_MSG_EQ (algorithm->GetMappingVersion (), version + 2,
+                         "A QCI moved away from the best BWP");
+
+  // Spare capacity 55 against 50: within the hysteresis of 20 %, no move
+  algorithm = CreateAlgorithm ();
+  version = algorithm->GetMappingVersion ();
+  ReportWindow (algorithm, true, 50, 45);
+  NS_TEST_ASSERT_MSG_EQ (+algorithm->GetBwpForEpsBearer (EpsBearer::GBR_CONV_VOICE), 0,
+                         "A QCI moved within the hysteresis");
+  NS_TEST_ASSERT_MSG_EQ (algorithm->GetMappingVersion (), version,
+                         "The mapping version changed without a move");
+
+  // Spare capacity 70 against 50: beyond the hysteresis, one QCI moves
+  ReportWindow (algorithm, true, 50, 30);
+  NS_TEST_ASSERT_MSG_EQ (+algorithm->GetBwpForEpsBearer (EpsBearer::GBR_CONV_VOICE), 1,
+                         "No QCI moved beyond the hysteresis");
+  NS_TEST_ASSERT_MSG_EQ (algorithm->GetMappingVersion (), version + 1,
+                         "The move did not change the mapping version");
+
+  // The UL slots do not count for the algorithm of the gNB
+  algorithm = CreateAlgorithm ();
+  version = algorithm->GetMappingVersion ();
+  ReportWindow (algorithm, false, m_available, 0);
+  ReportWindow (algorithm, false, m_available, 0);
+  NS_TEST_ASSERT_MSG_EQ_TOL (algorithm->GetBwpLoad (0), 0.0, 1e-9, "A UL slot counted in the DL load");
+  NS_TEST_ASSERT_MSG_EQ (algorithm->GetMappingVersion (), version, "A QCI moved on the UL load");
+
+  // BWP 1 is empty but its CQI is 3: its spare capacity (100 x 3 / 15 = 20)
+  // is lower than the one of BWP 0 (50 x 15 / 15), no move
+  algorithm = CreateAlgorithm ();
+  version = algorithm->GetMappingVersion ();
+  algorithm->ReportDlWbCqi (0, 1, 15);
+  algorithm->ReportDlWbCqi (1, 2, 3);
+  ReportWindow (algorithm, true, 50, 0);
+  NS_TEST_ASSERT_MSG_EQ (+algorithm->GetBwpForEpsBearer (EpsBearer::GBR_CONV_VOICE), 0,
+                         "A QCI moved to a BWP with a bad CQI");
+  NS_TEST_ASSERT_MSG_EQ (algorithm->GetMappingVersion (), version,
+                         "The mapping version changed without a move");
+}
+
+/**
+ * \ingroup test
+ * \brief The dynamic BWP manager test suite
+ */
+class NrTestBwpManagerDynamicSuite : public TestSuite
+{
+public:
+  NrTestBwpManagerDynamicSuite () : TestSuite ("nr-test-bwp-manager-dynamic", UNIT)
+  {
+    AddTestCase (new NrBwpManagerDynamicTestCase (), QUICK);
+  }
+};
+
+static NrTestBwpManagerDynamicSuite nrTestBwpManagerDynamicSuite; //!< Dynamic BWP manager test suite
+
+}  // namespace ns3
@@ -0,0 +1,379 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/nr-ch-access-manager.h>
+#include <ns3/nr-interference.h>
+#include <ns3/nr-spectrum-phy.h>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * \file nr-test-cat4-lbt.cc
+ * \ingroup test
+ *
+ * \brief This test checks the timing of the grants of NrCat4LbtAccessManager,
+ * with the energy on the channel set directly in the NrInterference of its
+ * spectrum phy: the defer period, the backoff frozen while the channel is
+ * busy and resumed after another defer period, the contention window after
+ * NACKs and ACKs, and a request while the channel is granted. It also checks
+ * that NrInterference::GetCurrentPower, which follows the events with a
+ * cursor, agrees with the sum of the signals received at that moment.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the grants of NrCat4LbtAccessManager
+ */
+class NrCat4LbtTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrCat4LbtTestCase ()
+    : TestCase ("Cat-4 LBT defer, backoff and contention window")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Create a manager of priority class 3 (3 defer slots, CW from 15
+   * to 63, MCOT of 8 ms), that records its grants
+   * \param grantDuration the GrantDuration of the manager
+   * \return the manager
+   */
+  Ptr<NrCat4LbtAccessManager> CreateManager (Time grantDuration);
+
+  /**
+   * \brief Set the backoff that the next request uses
+   * \param manager the manager
+   * \param backoff the number of backoff slots
+   */
+  static void SetBackoff (const Ptr<NrCat4LbtAccessManager> &manager, uint32_t backoff);
+
+  /**
+   * \brief Put energy on the channel of a manager, over the threshold
+   * \param manager the manager
+   * \param start the start of the energy
+   * \param end the end of the energy
+   */
+  static void AddEnergy (const Ptr<NrCat4LbtAccessManager> &manager, Time start, Time end);
+
+  /**
+   * \brief Check the defer period alone, and with the channel busy during it
+   */
+  void CheckDefer ();
+  /**
+   * \brief Check the backoff frozen while the channel is busy
+   */
+  void CheckBackoffFreeze ();
+  /**
+   * \brief Check the contention window after NACKs and ACKs
+   */
+  void CheckContentionWindow ();
+  /**
+   * \brief Check a request while the channel is granted
+   */
+  void CheckRequestWhileGranted ();
+
+  std::vector<Time> m_grants; //!< Moments of the grants
+};
+
+Ptr<NrCat4LbtAccessManager>
+NrCat4LbtTestCase::CreateManager (Time grantDuration)
+{
+  m_grants.clear ();
+  Ptr<NrCat4LbtAccessManager> manager = CreateObject<NrCat4LbtAccessManager> ();
+  manager->SetPriorityClass (3);
+  manager->SetGrantDuration (grantDuration);
+  manager->SetNrSpectrumPhy (CreateObject<NrSpectrumPhy> ());
+  manager->SetAccessGrantedCallback ([this] (const Time &) { m_grants.push_back (Simulator::Now ()); });
+  return manager;
+}
+
+void
+NrCat4LbtTestCase::SetBackoff (const Ptr<NrCat4LbtAccessManager> &manager, uint32_t backoff)
+{
+  manager->m_backoff = backoff;
+  manager->m_backoffDrawn = true;
+}
+
+void
+NrCat4LbtTestCase::AddEnergy (const Ptr<NrCat4LbtAccessManager> &manager, Time start, Time end)
+{
+  manager->GetNrSpectrumPhy ()->GetNrInterference ()->AppendEvent (start, end, 1e-3);
+}
+
+void
+NrCat4LbtTestCase::CheckDefer ()
+{
+  // Idle channel, no backoff: granted after 16 us + 3 slots of 9 us
+  Ptr<NrCat4LbtAccessManager> manager = CreateManager (MilliSeconds (1));
+  SetBackoff (manager, 0);
+  manager->RequestAccess ();
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_grants.size (), 1U, "One grant expected");
+  NS_TEST_ASSERT_MSG_EQ (m_grants.at (0), MicroSeconds (43), "Wrong end of the defer period");
+  Simulator::Destroy ();
+
+  // Busy from 20 to 50 us: sensed busy at the end of the first slot (25 us),
+  // then a whole defer period from the end of the energy
+  manager = CreateManager (MilliSeconds (1));
+  SetBackoff (manager, 0);
+  AddEnergy (manager, MicroSeconds (20), MicroSeconds (50));
+  manager->RequestAccess ();
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_grants.size (), 1U, "One grant expected");
+  NS_TEST_ASSERT_MSG_EQ (m_grants.at (0), MicroSeconds (50 + 43), "The defer period did not restart");
+  Simulator::Destroy ();
+}
+
+void
+NrCat4LbtTestCase::CheckBackoffFreeze ()
+{
+  // 5 backoff slots from 43 us. The energy from 65 to 200 us is sensed at
+  // the end of the third slot (70 us), with 3 slots left: they are counted
+  // after the defer period that follows the energy
+  Ptr<NrCat4LbtAccessManager> manager = CreateManager (MilliSeconds (1));
+  SetBackoff (manager, 5);
+  AddEnergy (manager, MicroSeconds (65), MicroSeconds (200));
+  manager->RequestAccess ();
+
+  Simulator::Schedule (MicroSeconds (100), [this, manager] ()
+    {
+      NS_TEST_EXPECT_MSG_EQ (manager->m_state, NrCat4LbtAccessManager::BUSY, "The channel is busy");
+      NS_TEST_EXPECT_MSG_EQ (manager->m_backoff, 3U, "Wrong frozen backoff");
+      NS_TEST_EXPECT_MSG_EQ (m_grants.size (), 0U, "Granted while busy");
+    });
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_grants.size (), 1U, "One grant expected");
+  NS_TEST_ASSERT_MSG_EQ (m_grants.at (0), MicroSeconds (200 + 43 + 3 * 9), "The backoff did not resume");
+  Simulator::Destroy ();
+}
+
+void
+NrCat4LbtTestCase::CheckContentionWindow ()
+{
+  Ptr<NrCat4LbtAccessManager> manager = CreateManager (MicroSeconds (100));
+  NS_TEST_ASSERT_MSG_EQ (manager->GetCw (), 15U, "CW must start at CWmin");
+
+  DlHarqInfo nack;
+  nack.m_harqStatus = StreamVector<DlHarqInfo::HarqStatus> (1, DlHarqInfo::NACK);
+  DlHarqInfo ack;
+  ack.m_harqStatus = StreamVector<DlHarqInfo::HarqStatus> (1, DlHarqInfo::ACK);
+
+  // A grant, its feedback, and the next request: 4 NACKs out of 5 double
+  // the CW up to 63, then 1 NACK out of 5 resets it
+  std::vector<uint32_t> expectedCw {31, 63, 63, 15};
+  std::vector<uint32_t> numNacks {4, 5, 4, 1};
+  SetBackoff (manager, 0);
+  manager->RequestAccess ();
+  Simulator::Run ();
+  for (size_t i = 0; i < expectedCw.size (); ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_grants.size (), i + 1, "Missing grant");
+      for (uint32_t f = 0; f < 5; ++f)
+        {
+          manager->DoReceiveDlHarqFeedback (f < numNacks[i] ? nack : ack);
+        }
+      SetBackoff (manager, 0);
+      manager->RequestAccess ();
+      NS_TEST_ASSERT_MSG_EQ (manager->GetCw (), expectedCw[i], "Wrong CW after the feedback of grant " << i);
+      Simulator::Run ();
+    }
+
+  // Without feedback, the CW does not change
+  SetBackoff (manager, 0);
+  manager->RequestAccess ();
+  NS_TEST_ASSERT_MSG_EQ (manager->GetCw (), 15U, "The CW changed without feedback");
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+NrCat4LbtTestCase::CheckRequestWhileGranted ()
+{
+  // Granted at 43 us for 1 ms; a new request at 100 us ends that grant, so
+  // that its end at 1043 us does not end the new one, granted at 143 us
+  Ptr<NrCat4LbtAccessManager> manager = CreateManager (MilliSeconds (1));
+  SetBackoff (manager, 0);
+  manager->RequestAccess ();
+  Simulator::Schedule (MicroSeconds (100), [manager] ()
+    {
+      NrCat4LbtTestCase::SetBackoff (manager, 0);
+      manager->RequestAccess ();
+    });
+  Simulator::Schedule (MicroSeconds (1050), [this, manager] ()
+    {
+      NS_TEST_EXPECT_MSG_EQ (manager->m_state, NrCat4LbtAccessManager::GRANTED,
+                             "The end of the first grant ended the second one");
+    });
+  Simulator::Schedule (MicroSeconds (1150), [this, manager] ()
+    {
+      NS_TEST_EXPECT_MSG_EQ (manager->m_state, NrCat4LbtAccessManager::IDLE, "The second grant did not end");
+    });
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_grants.size (), 2U, "Two grants expected");
+  NS_TEST_ASSERT_MSG_EQ (m_grants.at (1), MicroSeconds (143), "Wrong second grant");
+  Simulator::Destroy ();
+}
+
+void
+NrCat4LbtTestCase::DoRun ()
+{
+  CheckDefer ();
+  CheckBackoffFreeze ();
+  CheckContentionWindow ();
+  CheckRequestWhileGranted ();
+}
+
+/**
+ * \ingroup test
+ * \brief Check NrInterference::GetCurrentPower against the sum of the
+ * signals received at each moment
+ */
+class NrInterferenceCurrentPowerTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrInterferenceCurrentPowerTestCase ()
+    : TestCase ("Current power of NrInterference with overlapping signals")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief A signal
+   */
+  struct Signal
+  {
+    Time start;   //!< Start of the signal
+    Time end;     //!< End of the signal
+    double power; //!< Power of the signal, in W
+  };
+
+  /**
+   * \brief Receive a signal, as NrInterference::AddSignal does
+   * \param signal the signal
+   */
+  void Receive (const Signal &signal);
+
+  /**
+   * \brief Compare the current power with the sum of the signals received
+   * until now
+   */
+  void Check ();
+
+  Ptr<NrInterference> m_interference; //!< The interference under test
+  std::vector<Signal> m_received;     //!< The signals received
+};
+
+void
+NrInterferenceCurrentPowerTestCase::Receive (const Signal &signal)
+{
+  m_interference->AppendEvent (signal.start, signal.end, signal.power);
+  m_received.push_back (signal);
+}
+
+void
+NrInterferenceCurrentPowerTestCase::Check ()
+{
+  Time now = Simulator::Now ();
+  double expected = 0.0;
+  double largest = 0.0;
+  for (const auto &signal : m_received)
+    {
+      if (!(now < signal.start) && now < signal.end)
+        {
+          expected += signal.power;
+        }
+      largest = std::max (largest, signal.power);
+    }
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_interference->GetCurrentPower (), expected, largest * 1e-9,
+                             "Wrong current power at " << now);
+  if (expected > 0.0)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_interference->IsChannelBusyNow (expected * 0.5), true, "Idle at " << now);
+      NS_TEST_EXPECT_MSG_EQ (m_interference->IsChannelBusyNow (expected * 2), false, "Busy at " << now);
+    }
+}
+
+void
+NrInterferenceCurrentPowerTestCase::DoRun ()
+{
+  m_interference = CreateObject<NrInterference> ();
+
+  // Overlapping signals of powers from 1e-12 to 1 W, some starting or
+  // ending at the same moments, the power is checked every 3 us: at starts,
+  // at ends and in between, also when no query happens for a while
+  const uint32_t numSignals = 60;
+  uint32_t seed = 12345;
+  for (uint32_t i = 0; i < numSignals; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      Time start = MicroSeconds (6 * (i / 2));
+      Time end = start + MicroSeconds (3 * (1 + (seed >> 16) % 20));
+      double power = std::pow (10.0, -static_cast<double> ((seed >> 8) % 13));
+      Simulator::Schedule (start, &NrInterferenceCurrentPowerTestCase::Receive, this, Signal {start, end, power});
+    }
+  for (uint32_t t = 0; t < 300; t += 3)
+    {
+      if (t > 100 && t < 140)
+        {
+          continue;
+        }
+      Simulator::Schedule (MicroSeconds (t), &NrInterferenceCurrentPowerTestCase::Check, this);
+    }
+
+  // A signal announced in the past of the cursor
+  Simulator::Schedule (MicroSeconds (250), [this] ()
+    {
+      Receive (Signal {MicroSeconds (245), MicroSeconds (260), 0.5});
+    });
+  Simulator::Run ();
+  Simulator::Destroy ();
+  m_interference = nullptr;
+}
+
+/**
+ * \ingroup test
+ * \brief The Cat-4 LBT test suite
+ */
+class NrTestCat4LbtSuite : public TestSuite
+{
+public:
+  NrTestCat4LbtSuite () : TestSuite ("nr-test-cat4-lbt", UNIT)
+  {
+    AddTestCase (new NrCat4LbtTestCase (), QUICK);
+    AddTestCase (new NrInterferenceCurrentPowerTestCase (), QUICK);
+  }
+};
+
+static NrTestCat4LbtSuite nrTestCat4LbtSuite; //!< Cat-4 LBT test suite
+
+}  // namespace ns3
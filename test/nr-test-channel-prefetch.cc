@@ -0,0 +1,158 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/node.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/uniform-planar-array.h>
+#include <ns3/channel-condition-model.h>
+#include <ns3/three-gpp-channel-model-param.h>
+#include <ns3/double.h>
+#include <ns3/string.h>
+#include <ns3/pointer.h>
+#include <ns3/uinteger.h>
+
+/**
+ * \file nr-test-channel-prefetch.cc
+ * \ingroup test
+ *
+ * \brief This test checks that the channel matrices of ThreeGppChannelModelParam
+ * are the same with and without prefetching, whatever the number of workers,
+ * and that the links are regenerated only after their update period.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Request the channels of some links, at some times, with a number of prefetch workers
+ */
+class NrChannelPrefetchTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrChannelPrefetchTestCase ()
+    : TestCase ("Prefetch of the channel matrices")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief The channel matrices of the links at each request time
+   */
+  typedef std::vector<std::vector<MatrixBasedChannelModel::Complex3DVector>> Channels;
+
+  /**
+   * \brief Run a simulation that requests the channels
+   * \param numWorkers the number of prefetch workers
+   * \return the channel matrices
+   */
+  Channels GetChannels (uint32_t numWorkers);
+};
+
+NrChannelPrefetchTestCase::Channels
+NrChannelPrefetchTestCase::GetChannels (uint32_t numWorkers)
+{
+  Ptr<ThreeGppChannelModelParam> channelModel = CreateObject<ThreeGppChannelModelParam> ();
+  channelModel->SetAttribute ("Frequency", DoubleValue (28e9));
+  channelModel->SetAttribute ("Scenario", StringValue ("UMa"));
+  channelModel->SetAttribute ("ChannelConditionModel", PointerValue (CreateObject<AlwaysLosChannelConditionModel> ()));
+  channelModel->SetAttribute ("UpdatePeriod", TimeValue (MilliSeconds (10)));
+  channelModel->SetAttribute ("NumPrefetchWorkers", UintegerValue (numWorkers));
+  channelModel->AssignStreams (1);
+
+  // A gNB with a 4x4 array, and three UEs with a 2x1 array
+  std::vector<Ptr<MobilityModel>> mobility;
+  std::vector<Ptr<PhasedArrayModel>> antennas;
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<MobilityModel> mob = CreateObject<ConstantPositionMobilityModel> ();
+      mob->SetPosition (i == 0 ? Vector (0, 0, 25) : Vector (50.0 * i, 20.0 * i, 1.5));
+      node->AggregateObject (mob);
+      mobility.push_back (mob);
+      uint32_t size = i == 0 ? 4 : 2;
+      antennas.push_back (CreateObjectWithAttributes<UniformPlanarArray> ("NumColumns", UintegerValue (size),
+                                                                         "NumRows", UintegerValue (i == 0 ? 4 : 1)));
+    }
+
+  Channels channels;
+  auto requestChannels = [&] ()
+    {
+      channels.emplace_back ();
+      for (uint32_t ue = 1; ue < 4; ++ue)
+        {
+          channels.back ().push_back (channelModel->GetChannel (mobility[0], mobility[ue],
+                                                                antennas[0], antennas[ue])->m_channel);
+        }
+    };
+
+  // The second request is in the update period of the first one
+  for (uint32_t ms : {0, 5, 15, 32})
+    {
+      Simulator::Schedule (MilliSeconds (ms), requestChannels);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  return channels;
+}
+
+void
+NrChannelPrefetchTestCase::DoRun ()
+{
+  Channels lazy = GetChannels (0);
+  NS_TEST_ASSERT_MSG_EQ (lazy.size (), 4U, "Wrong number of requests");
+  NS_TEST_ASSERT_MSG_EQ (lazy[0].at (0).size (), 2U, "Wrong number of UE elements");
+  NS_TEST_ASSERT_MSG_EQ (lazy[0].at (0).at (0).size (), 16U, "Wrong number of gNB elements");
+  for (uint32_t link = 0; link < 3; ++link)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((lazy[0][link] == lazy[1][link]), true, "A link was updated in its update period");
+      NS_TEST_ASSERT_MSG_EQ ((lazy[1][link] != lazy[2][link]), true, "A link was not updated after its update period");
+      NS_TEST_ASSERT_MSG_EQ ((lazy[2][link] != lazy[3][link]), true, "A link was not updated after its update period");
+    }
+
+  for (uint32_t numWorkers : {1, 4})
+    {
+      Channels prefetched = GetChannels (numWorkers);
+      NS_TEST_ASSERT_MSG_EQ ((prefetched == lazy), true,
+                             "Different channels with " << numWorkers << " prefetch workers");
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The ThreeGppChannelModelParam prefetch test suite
+ */
+class NrTestChannelPrefetch : public TestSuite
+{
+public:
+  NrTestChannelPrefetch () : TestSuite ("nr-test-channel-prefetch", UNIT)
+  {
+    AddTestCase (new NrChannelPrefetchTestCase (), QUICK);
+  }
+};
+
+static NrTestChannelPrefetch NrTestChannelPrefetchSuite; //!< ThreeGppChannelModelParam prefetch test suite
+
+}  // namespace ns3
@@ -0,0 +1,184 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/node.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/uniform-planar-array.h>
+#include <ns3/channel-condition-model.h>
+#include <ns3/three-gpp-channel-model-param.h>
+#include <ns3/nr-replay-channel-model.h>
+#include <ns3/nr-channel-recording.h>
+#include <ns3/double.h>
+#include <ns3/string.h>
+#include <ns3/pointer.h>
+#include <ns3/uinteger.h>
+
+/**
+ * \file nr-test-channel-replay.cc
+ * \ingroup test
+ *
+ * \brief This test records the channel matrices of ThreeGppChannelModelParam,
+ * and checks that NrReplayChannelModel serves the same matrices and
+ * parameters at the same times, and generates the links that were not
+ * recorded.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Record the channels of some links, and replay them
+ */
+class NrChannelReplayTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrChannelReplayTestCase ()
+    : TestCase ("Record and replay of the channel matrices")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief The channel matrices of the links at each request time
+   */
+  typedef std::vector<std::vector<MatrixBasedChannelModel::Complex3DVector>> Channels;
+
+  /**
+   * \brief The delays of the clusters of the links at each request time
+   */
+  typedef std::vector<std::vector<MatrixBasedChannelModel::DoubleVector>> Delays;
+
+  /**
+   * \brief Run a simulation that requests the channels of the gNB
+   * \param channelModel the channel model
+   * \param channels the channel matrices
+   * \param delays the delays of the clusters
+   */
+  void GetChannels (Ptr<ThreeGppChannelModel> channelModel, Channels *channels, Delays *delays);
+
+  std::vector<Ptr<MobilityModel>> m_mobility;   //!< The mobility models of the nodes
+  std::vector<Ptr<PhasedArrayModel>> m_antennas; //!< The antennas of the nodes
+};
+
+void
+NrChannelReplayTestCase::GetChannels (Ptr<ThreeGppChannelModel> channelModel, Channels *channels, Delays *delays)
+{
+  channelModel->SetAttribute ("Frequency", DoubleValue (28e9));
+  channelModel->SetAttribute ("Scenario", StringValue ("UMa"));
+  channelModel->SetAttribute ("ChannelConditionModel", PointerValue (CreateObject<AlwaysLosChannelConditionModel> ()));
+  channelModel->SetAttribute ("UpdatePeriod", TimeValue (MilliSeconds (10)));
+
+  auto requestChannels = [&] ()
+    {
+      channels->emplace_back ();
+      delays->emplace_back ();
+      for (uint32_t ue = 1; ue < m_mobility.size (); ++ue)
+        {
+          channels->back ().push_back (channelModel->GetChannel (m_mobility[0], m_mobility[ue],
+                                                                 m_antennas[0], m_antennas[ue])->m_channel);
+          delays->back ().push_back (channelModel->GetParams (m_mobility[0], m_mobility[ue])->m_delay);
+        }
+    };
+
+  // The second request is in the update period of the first one
+  for (uint32_t ms : {0, 5, 15})
+    {
+      Simulator::Schedule (MilliSeconds (ms), requestChannels);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+NrChannelReplayTestCase::DoRun ()
+{
+  // A gNB with a 4x4 array, and three UEs with a 2x1 array; the replay
+  // uses the same nodes and antennas, hence the same ids
+  for (uint32_t i = 0; i < 4; ++i)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<MobilityModel> mob = CreateObject<ConstantPositionMobilityModel> ();
+      mob->SetPosition (i == 0 ? Vector (0, 0, 25) : Vector (50.0 * i, 20.0 * i, 1.5));
+      node->AggregateObject (mob);
+      m_mobility.push_back (mob);
+      uint32_t size = i == 0 ? 4 : 2;
+      m_antennas.push_back (CreateObjectWithAttributes<UniformPlanarArray> ("NumColumns", UintegerValue (size),
+                                                                           "NumRows", UintegerValue (i == 0 ? 4 : 1)));
+    }
+
+  std::string fileName = CreateTempDirFilename ("nr-channel-replay.bin");
+  Ptr<ThreeGppChannelModelParam> recordModel = CreateObject<ThreeGppChannelModelParam> ();
+  recordModel->SetAttribute ("RecordFileName", StringValue (fileName));
+  recordModel->AssignStreams (1);
+  Channels recorded;
+  Delays recordedDelays;
+  GetChannels (recordModel, &recorded, &recordedDelays);
+  recordModel->Dispose ();
+
+  // Each link is generated at 0 and 15 ms
+  Ptr<NrChannelRecording> recording = Create<NrChannelRecording> ();
+  NS_TEST_ASSERT_MSG_EQ (recording->Open (fileName), true, "Could not open the recording");
+  NS_TEST_ASSERT_MSG_EQ (recording->GetNumRecords (), 6U, "Wrong number of records");
+  NS_TEST_ASSERT_MSG_EQ (recording->GetFrequency (), 28e9, "Wrong frequency of the recording");
+  recording->Close ();
+
+  // A different stream, so that a generated channel would differ
+  Ptr<NrReplayChannelModel> replayModel = CreateObject<NrReplayChannelModel> ();
+  replayModel->SetAttribute ("FileName", StringValue (fileName));
+  replayModel->AssignStreams (7);
+  Channels replayed;
+  Delays replayedDelays;
+  GetChannels (replayModel, &replayed, &replayedDelays);
+  NS_TEST_ASSERT_MSG_EQ ((replayed == recorded), true, "The replayed channels differ from the recorded ones");
+  NS_TEST_ASSERT_MSG_EQ ((replayedDelays == recordedDelays), true, "The replayed delays differ from the recorded ones");
+  NS_TEST_ASSERT_MSG_EQ ((replayed[0] == replayed[1]), true, "A link was updated in its update period");
+  NS_TEST_ASSERT_MSG_EQ ((replayed[1] != replayed[2]), true, "A link was not updated after its update period");
+  NS_TEST_ASSERT_MSG_EQ (replayModel->GetNumMisses (), 0U, "A recorded link was generated");
+
+  // A link that was not recorded is generated
+  Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix =
+    replayModel->GetChannel (m_mobility[1], m_mobility[2], m_antennas[1], m_antennas[2]);
+  NS_TEST_ASSERT_MSG_EQ (channelMatrix->m_channel.size (), 2U, "Wrong size of a generated channel");
+  NS_TEST_ASSERT_MSG_EQ (replayModel->GetNumMisses (), 1U, "A link that was not recorded was not counted");
+  replayModel->Dispose ();
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief The channel record and replay test suite
+ */
+class NrTestChannelReplay : public TestSuite
+{
+public:
+  NrTestChannelReplay () : TestSuite ("nr-test-channel-replay", UNIT)
+  {
+    AddTestCase (new NrChannelReplayTestCase (), QUICK);
+  }
+};
+
+static NrTestChannelReplay NrTestChannelReplaySuite; //!< Channel record and replay test suite
+
+}  // namespace ns3
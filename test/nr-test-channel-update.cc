@@ -0,0 +1,161 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/node.h>
+#include <ns3/constant-velocity-mobility-model.h>
+#include <ns3/uniform-planar-array.h>
+#include <ns3/channel-condition-model.h>
+#include <ns3/three-gpp-channel-model-param.h>
+#include <ns3/boolean.h>
+#include <ns3/double.h>
+#include <ns3/string.h>
+#include <ns3/pointer.h>
+#include <ns3/uinteger.h>
+
+/**
+ * \file nr-test-channel-update.cc
+ * \ingroup test
+ *
+ * \brief This test checks that, with the speed-adaptive update periods of
+ * ThreeGppChannelModelParam, a link between static nodes is never
+ * regenerated, and a link with a moving node is regenerated after it moved
+ * by the update distance, with and without prefetching.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Request the channels of a static and a moving UE, at some times
+ */
+class NrChannelUpdateTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrChannelUpdateTestCase ()
+    : TestCase ("Speed-adaptive update of the channel matrices")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief The channel matrices of the links at each request time
+   */
+  typedef std::vector<std::vector<MatrixBasedChannelModel::Complex3DVector>> Channels;
+
+  /**
+   * \brief Run a simulation that requests the channels
+   * \param numWorkers the number of prefetch workers
+   * \return the channel matrices
+   */
+  Channels GetChannels (uint32_t numWorkers);
+};
+
+NrChannelUpdateTestCase::Channels
+NrChannelUpdateTestCase::GetChannels (uint32_t numWorkers)
+{
+  Ptr<ThreeGppChannelModelParam> channelModel = CreateObject<ThreeGppChannelModelParam> ();
+  channelModel->SetAttribute ("Frequency", DoubleValue (28e9));
+  channelModel->SetAttribute ("Scenario", StringValue ("UMa"));
+  channelModel->SetAttribute ("ChannelConditionModel", PointerValue (CreateObject<AlwaysLosChannelConditionModel> ()));
+  channelModel->SetAttribute ("UpdatePeriod", TimeValue (MilliSeconds (10)));
+  channelModel->SetAttribute ("SpeedAdaptiveUpdate", BooleanValue (true));
+  channelModel->SetAttribute ("UpdateDistance", DoubleValue (1.0));
+  channelModel->SetAttribute ("NumPrefetchWorkers", UintegerValue (numWorkers));
+  channelModel->AssignStreams (1);
+
+  // A gNB, a static UE and a UE at 10 m/s, which moves by 1 m in 100 ms
+  std::vector<Ptr<MobilityModel>> mobility;
+  std::vector<Ptr<PhasedArrayModel>> antennas;
+  for (uint32_t i = 0; i < 3; ++i)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<ConstantVelocityMobilityModel> mob = CreateObject<ConstantVelocityMobilityModel> ();
+      mob->SetPosition (i == 0 ? Vector (0, 0, 25) : Vector (50.0 * i, 20.0 * i, 1.5));
+      mob->SetVelocity (i == 2 ? Vector (10.0, 0.0, 0.0) : Vector (0.0, 0.0, 0.0));
+      node->AggregateObject (mob);
+      mobility.push_back (mob);
+      antennas.push_back (CreateObjectWithAttributes<UniformPlanarArray> ("NumColumns", UintegerValue (2),
+                                                                         "NumRows", UintegerValue (2)));
+    }
+
+  Channels channels;
+  auto requestChannels = [&] ()
+    {
+      channels.emplace_back ();
+      for (uint32_t ue = 1; ue < 3; ++ue)
+        {
+          channels.back ().push_back (channelModel->GetChannel (mobility[0], mobility[ue],
+                                                                antennas[0], antennas[ue])->m_channel);
+        }
+    };
+
+  for (uint32_t ms : {0, 50, 150, 1000})
+    {
+      Simulator::Schedule (MilliSeconds (ms), requestChannels);
+    }
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (channelModel->GetLinkUpdatePeriod (mobility[0], mobility[1]), Time (0),
+                         "A static link has an update period");
+  NS_TEST_EXPECT_MSG_EQ (channelModel->GetLinkUpdatePeriod (mobility[0], mobility[2]), MilliSeconds (100),
+                         "Wrong update period of the moving link");
+  Simulator::Destroy ();
+
+  return channels;
+}
+
+void
+NrChannelUpdateTestCase::DoRun ()
+{
+  Channels lazy = GetChannels (0);
+  NS_TEST_ASSERT_MSG_EQ (lazy.size (), 4U, "Wrong number of requests");
+  for (uint32_t i = 1; i < 4; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((lazy[i][0] == lazy[0][0]), true, "The static link was updated");
+    }
+  NS_TEST_ASSERT_MSG_EQ ((lazy[0][1] == lazy[1][1]), true, "The moving link was updated before its update distance");
+  NS_TEST_ASSERT_MSG_EQ ((lazy[1][1] != lazy[2][1]), true, "The moving link was not updated after its update distance");
+  NS_TEST_ASSERT_MSG_EQ ((lazy[2][1] != lazy[3][1]), true, "The moving link was not updated after its update distance");
+
+  Channels prefetched = GetChannels (2);
+  NS_TEST_ASSERT_MSG_EQ ((prefetched == lazy), true, "Different channels with prefetching");
+}
+
+/**
+ * \ingroup test
+ * \brief The ThreeGppChannelModelParam speed-adaptive update test suite
+ */
+class NrTestChannelUpdate : public TestSuite
+{
+public:
+  NrTestChannelUpdate () : TestSuite ("nr-test-channel-update", UNIT)
+  {
+    AddTestCase (new NrChannelUpdateTestCase (), QUICK);
+  }
+};
+
+static NrTestChannelUpdate NrTestChannelUpdateSuite; //!< ThreeGppChannelModelParam speed-adaptive update test suite
+
+}  // namespace ns3
@@ -0,0 +1,205 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/network-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/nr-module.h>
+#include <ns3/antenna-module.h>
+
+/**
+ * \file nr-test-checkpoint.cc
+ * \ingroup test
+ *
+ * \brief This test saves the deployment of a scenario with
+ * NrCheckpointHelper, builds the same scenario with the UEs somewhere
+ * else, restores the deployment, and checks the positions, the attachment
+ * and the beamforming vectors of the restored scenario.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Save and restore a scenario of two gNBs and three UEs
+ */
+class NrCheckpointTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrCheckpointTestCase ()
+    : TestCase ("Save and restore the deployment of a scenario")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Install the devices of the scenario
+   * \param gnbPositions the position of each gNB
+   * \param uePositions the position of each UE
+   * \param gnbDevices the gNB devices
+   * \param ueDevices the UE devices
+   * \return the helper that installed the devices
+   */
+  Ptr<NrHelper> Build (const std::vector<Vector> &gnbPositions,
+                       const std::vector<Vector> &uePositions,
+                       NetDeviceContainer *gnbDevices, NetDeviceContainer *ueDevices);
+
+  /**
+   * \brief Get the vector of the beam manager of a gNB toward a UE
+   * \param gnb the gNB
+   * \param ue the UE
+   * \return the beamforming vector
+   */
+  static complexVector_t GetGnbBeam (const Ptr<NetDevice> &gnb, const Ptr<NetDevice> &ue);
+};
+
+Ptr<NrHelper>
+NrCheckpointTestCase::Build (const std::vector<Vector> &gnbPositions,
+                             const std::vector<Vector> &uePositions,
+                             NetDeviceContainer *gnbDevices, NetDeviceContainer *ueDevices)
+{
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (gnbPositions.size ());
+  ueNodes.Create (uePositions.size ());
+
+  Ptr<ListPositionAllocator> gnbAllocator = CreateObject<ListPositionAllocator> ();
+  for (const auto &pos : gnbPositions)
+    {
+      gnbAllocator->Add (pos);
+    }
+  Ptr<ListPositionAllocator> ueAllocator = CreateObject<ListPositionAllocator> ();
+  for (const auto &pos : uePositions)
+    {
+      ueAllocator->Add (pos);
+    }
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (gnbAllocator);
+  mobility.Install (gnbNodes);
+  mobility.SetPositionAllocator (ueAllocator);
+  mobility.Install (ueNodes);
+
+  Ptr<NrPointToPointEpcHelper> epcHelper = CreateObject<NrPointToPointEpcHelper> ();
+  Ptr<IdealBeamformingHelper> idealBeamformingHelper = CreateObject<IdealBeamformingHelper> ();
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  nrHelper->SetBeamformingHelper (idealBeamformingHelper);
+  nrHelper->SetEpcHelper (epcHelper);
+  idealBeamformingHelper->SetAttribute ("BeamformingMethod", TypeIdValue (DirectPathBeamforming::GetTypeId ()));
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (28e9, 100e6, 1, BandwidthPartInfo::UMi_StreetCanyon);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  nrHelper->SetUeAntennaAttribute ("NumRows", UintegerValue (2));
+  nrHelper->SetUeAntennaAttribute ("NumColumns", UintegerValue (2));
+  nrHelper->SetUeAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+  nrHelper->SetGnbAntennaAttribute ("NumRows", UintegerValue (4));
+  nrHelper->SetGnbAntennaAttribute ("NumColumns", UintegerValue (4));
+  nrHelper->SetGnbAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+
+  *gnbDevices = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  *ueDevices = nrHelper->InstallUeDevice (ueNodes, allBwps);
+
+  for (auto it = gnbDevices->Begin (); it != gnbDevices->End (); ++it)
+    {
+      DynamicCast<NrGnbNetDevice> (*it)->UpdateConfig ();
+    }
+  for (auto it = ueDevices->Begin (); it != ueDevices->End (); ++it)
+    {
+      DynamicCast<NrUeNetDevice> (*it)->UpdateConfig ();
+    }
+
+  InternetStackHelper internet;
+  internet.Install (ueNodes);
+  epcHelper->AssignUeIpv4Address (*ueDevices);
+
+  return nrHelper;
+}
+
+complexVector_t
+NrCheckpointTestCase::GetGnbBeam (const Ptr<NetDevice> &gnb, const Ptr<NetDevice> &ue)
+{
+  return DynamicCast<NrGnbNetDevice> (gnb)->GetPhy (0)->GetSpectrumPhy ()->GetBeamManager ()->GetBeamformingVector (ue);
+}
+
+void
+NrCheckpointTestCase::DoRun ()
+{
+  const std::string fileName = CreateTempDirFilename ("nr-checkpoint.txt");
+  const std::vector<Vector> gnbPositions {Vector (0, 0, 10), Vector (200, 0, 10)};
+  const std::vector<Vector> uePositions {Vector (10, 0, 1.5), Vector (190, 20, 1.5), Vector (60, -5, 1.5)};
+
+  NetDeviceContainer gnbDevices;
+  NetDeviceContainer ueDevices;
+  Ptr<NrHelper> nrHelper = Build (gnbPositions, uePositions, &gnbDevices, &ueDevices);
+  nrHelper->AttachToClosestEnb (ueDevices, gnbDevices);
+  NrCheckpointHelper::Save (fileName, gnbDevices, ueDevices, true);
+
+  const std::vector<uint32_t> servingGnb {0, 1, 0};
+  std::vector<complexVector_t> beams;
+  for (uint32_t i = 0; i < ueDevices.GetN (); ++i)
+    {
+      beams.push_back (GetGnbBeam (gnbDevices.Get (servingGnb[i]), ueDevices.Get (i)));
+    }
+  Simulator::Destroy ();
+
+  // The same scenario, with all the UEs far away and not attached
+  const std::vector<Vector> farPositions (uePositions.size (), Vector (500, 500, 1.5));
+  nrHelper = Build (gnbPositions, farPositions, &gnbDevices, &ueDevices);
+  NrCheckpointHelper::Restore (fileName, nrHelper, gnbDevices, ueDevices);
+
+  for (uint32_t i = 0; i < ueDevices.GetN (); ++i)
+    {
+      Ptr<NrUeNetDevice> ue = DynamicCast<NrUeNetDevice> (ueDevices.Get (i));
+      Vector pos = ue->GetNode ()->GetObject<MobilityModel> ()->GetPosition ();
+      NS_TEST_ASSERT_MSG_EQ (CalculateDistance (pos, uePositions[i]), 0.0, "Wrong position of the UE " << i);
+      NS_TEST_ASSERT_MSG_EQ (ue->GetTargetEnb (), gnbDevices.Get (servingGnb[i]),
+                             "Wrong gNB of the UE " << i);
+      NS_TEST_ASSERT_MSG_EQ ((GetGnbBeam (gnbDevices.Get (servingGnb[i]), ue) == beams[i]), true,
+                             "Wrong beamforming vector of the gNB toward the UE " << i);
+    }
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief The NrCheckpointHelper test suite
+ */
+class NrTestCheckpoint : public TestSuite
+{
+public:
+  NrTestCheckpoint () : TestSuite ("nr-test-checkpoint", SYSTEM)
+  {
+    AddTestCase (new NrCheckpointTestCase (), QUICK);
+  }
+};
+
+static NrTestCheckpoint NrTestCheckpointSuite; //!< NrCheckpointHelper test suite
+
+}  // namespace ns3
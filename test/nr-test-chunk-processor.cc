@@ -0,0 +1,136 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-chunk-processor.h>
+#include <ns3/spectrum-model.h>
+#include <ns3/spectrum-value.h>
+#include <algorithm>
+
+/**
+ * \file nr-test-chunk-processor.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrChunkProcessor reports the same average as
+ * LteChunkProcessor on the whole band, and on the evaluated RBs when it is
+ * restricted to some of them (0 on the other ones), across receptions.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Feed the same chunks to NrChunkProcessor and LteChunkProcessor
+ */
+class NrChunkProcessorTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrChunkProcessorTestCase ()
+    : TestCase ("NrChunkProcessor average on all or some RBs")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Store the average reported by NrChunkProcessor
+   * \param v the average
+   */
+  void NrAverage (const SpectrumValue &v)
+  {
+    m_nrAverage = v.Copy ();
+  }
+
+  /**
+   * \brief Store the average reported by LteChunkProcessor
+   * \param v the average
+   */
+  void LteAverage (const SpectrumValue &v)
+  {
+    m_lteAverage = v.Copy ();
+  }
+
+  Ptr<SpectrumValue> m_nrAverage;  //!< Last average of NrChunkProcessor
+  Ptr<SpectrumValue> m_lteAverage; //!< Last average of LteChunkProcessor
+};
+
+void
+NrChunkProcessorTestCase::DoRun ()
+{
+  std::vector<double> freqs;
+  for (uint32_t rb = 0; rb < 10; ++rb)
+    {
+      freqs.push_back (1e9 + rb * 180e3);
+    }
+  Ptr<const SpectrumModel> model = Create<SpectrumModel> (freqs);
+
+  Ptr<NrChunkProcessor> nr = Create<NrChunkProcessor> ();
+  nr->AddCallback (MakeCallback (&NrChunkProcessorTestCase::NrAverage, this));
+  Ptr<LteChunkProcessor> lte = Create<LteChunkProcessor> ();
+  lte->AddCallback (MakeCallback (&NrChunkProcessorTestCase::LteAverage, this));
+
+  // Whole band, some RBs, whole band again
+  std::vector<std::vector<int>> evaluatedRbs {{}, {2, 3, 7}, {}};
+  for (const auto & rbs : evaluatedRbs)
+    {
+      nr->SetEvaluatedRbs (rbs);
+      nr->Start ();
+      lte->Start ();
+      for (uint32_t chunk = 0; chunk < 3; ++chunk)
+        {
+          SpectrumValue sinr (model);
+          for (uint32_t rb = 0; rb < 10; ++rb)
+            {
+              sinr[rb] = 1.0 + rb * 0.5 + chunk * 3.0;
+            }
+          nr->EvaluateChunk (sinr, MicroSeconds (10 + chunk * 7));
+          lte->EvaluateChunk (sinr, MicroSeconds (10 + chunk * 7));
+        }
+      nr->End ();
+      lte->End ();
+
+      for (uint32_t rb = 0; rb < 10; ++rb)
+        {
+          bool evaluated = rbs.empty () || std::find (rbs.begin (), rbs.end (), static_cast<int> (rb)) != rbs.end ();
+          double expected = evaluated ? (*m_lteAverage)[rb] : 0.0;
+          NS_TEST_ASSERT_MSG_EQ_TOL ((*m_nrAverage)[rb], expected, 1e-12,
+                                     "Wrong average of RB " << rb << " with " << rbs.size () << " evaluated RBs");
+        }
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The NrChunkProcessor test suite
+ */
+class NrTestChunkProcessor : public TestSuite
+{
+public:
+  NrTestChunkProcessor () : TestSuite ("nr-test-chunk-processor", UNIT)
+  {
+    AddTestCase (new NrChunkProcessorTestCase (), QUICK);
+  }
+};
+
+static NrTestChunkProcessor NrTestChunkProcessorSuite; //!< NrChunkProcessor test suite
+
+}  // namespace ns3
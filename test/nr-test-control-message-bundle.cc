@@ -0,0 +1,125 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-control-message-bundle.h>
+
+/**
+ * \file nr-test-control-message-bundle.cc
+ * \ingroup test
+ *
+ * \brief This test checks that, for each RNTI, NrControlMessageBundle gives
+ * the broadcast messages and the DCIs of that RNTI in the order of
+ * transmission, that is what a UE used to keep by scanning the whole list.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Build a bundle of DCIs and broadcast messages, and check the messages of each RNTI
+ */
+class NrControlMessageBundleTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrControlMessageBundleTestCase ()
+    : TestCase ("Control message bundle indexed by RNTI")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Create a DCI
+   * \param rnti the RNTI
+   * \param format DL or UL
+   * \return the DCI message
+   */
+  static Ptr<NrControlMessage> CreateDci (uint16_t rnti, DciInfoElementTdma::DciFormat format);
+};
+
+Ptr<NrControlMessage>
+NrControlMessageBundleTestCase::CreateDci (uint16_t rnti, DciInfoElementTdma::DciFormat format)
+{
+  auto dci = std::make_shared<DciInfoElementTdma> (rnti, format, 1, 1, StreamVector<uint8_t> {1},
+                                                   StreamVector<uint32_t> {100},
+                                                   StreamVector<uint8_t> {1},
+                                                   StreamVector<uint8_t> {0},
+                                                   DciInfoElementTdma::DATA, 0, 1);
+  if (format == DciInfoElementTdma::DL)
+    {
+      return Create<NrDlDciMessage> (dci);
+    }
+  return Create<NrUlDciMessage> (dci);
+}
+
+void
+NrControlMessageBundleTestCase::DoRun ()
+{
+  std::list<Ptr<NrControlMessage> > msgs;
+  msgs.push_back (Create<NrMibMessage> ());
+  msgs.push_back (CreateDci (1, DciInfoElementTdma::DL));
+  msgs.push_back (CreateDci (2, DciInfoElementTdma::DL));
+  msgs.push_back (CreateDci (1, DciInfoElementTdma::UL));
+  msgs.push_back (CreateDci (0, DciInfoElementTdma::UL));
+  msgs.push_back (Create<NrSib1Message> ());
+
+  Ptr<const NrControlMessageBundle> bundle = Create<const NrControlMessageBundle> (msgs);
+
+  NS_TEST_ASSERT_MSG_EQ ((bundle->GetMessages () == msgs), true, "Wrong list of all the messages");
+
+  // What the UE PHY used to process: the messages that are not DCIs of the other UEs
+  for (uint16_t rnti : {1, 2, 3})
+    {
+      std::list<Ptr<NrControlMessage> > expected;
+      for (const auto & msg : msgs)
+        {
+          uint16_t msgRnti = NrControlMessageBundle::GetRnti (msg);
+          if (msgRnti == 0 || msgRnti == rnti)
+            {
+              expected.push_back (msg);
+            }
+        }
+      NS_TEST_ASSERT_MSG_EQ ((bundle->GetMessages (rnti) == expected), true,
+                             "Wrong messages of RNTI " << rnti);
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (bundle->GetMessages (1).size (), 5U, "Wrong number of messages of RNTI 1");
+  NS_TEST_ASSERT_MSG_EQ (bundle->GetMessages (3).size (), 3U, "Wrong number of broadcast messages");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrControlMessageBundle test suite
+ */
+class NrTestControlMessageBundle : public TestSuite
+{
+public:
+  NrTestControlMessageBundle () : TestSuite ("nr-test-control-message-bundle", UNIT)
+  {
+    AddTestCase (new NrControlMessageBundleTestCase (), QUICK);
+  }
+};
+
+static NrTestControlMessageBundle NrTestControlMessageBundleSuite; //!< NrControlMessageBundle test suite
+
+}  // namespace ns3
@@ -0,0 +1,315 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/nr-module.h>
+#include <ns3/nr-coupling-gain-engine.h>
+#include <ns3/cached-three-gpp-spectrum-propagation-loss-model.h>
+#include <ns3/nr-receiver-pruning-loss-model.h>
+
+/**
+ * \file nr-test-coupling-gain.cc
+ * \ingroup test
+ *
+ * \brief This test computes the table of a NrCouplingGainEngine for two gNBs
+ * and two UEs, and checks that the received PSDs that the spectrum model
+ * takes from it are identical to the ones it computes without the engine,
+ * that the beams outside the codebook are computed as usual, and that each
+ * UE is best served by the gNB next to it. It also checks that, with
+ * ReceiverPruning, the channel skips the receivers under the noise floor
+ * minus the margin, unless they are attached.
+ */
+namespace ns3 {
+
+/**
+ * \param antenna an antenna
+ * \return the quasi-omni beamforming vector of the antenna
+ */
+static PhasedArrayModel::ComplexVector
+GetQuasiOmniBfv (const Ptr<const UniformPlanarArray> &antenna)
+{
+  UintegerValue numRows;
+  UintegerValue numColumns;
+  antenna->GetAttribute ("NumRows", numRows);
+  antenna->GetAttribute ("NumColumns", numColumns);
+  return CreateQuasiOmniBfv (numRows.Get (), numColumns.Get ());
+}
+
+/**
+ * \ingroup test
+ * \brief Check the table of a NrCouplingGainEngine
+ */
+class NrCouplingGainTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param numWorkers the NumWorkers attribute of the engine
+   */
+  NrCouplingGainTestCase (uint32_t numWorkers)
+    : TestCase ("Coupling gains with " + std::to_string (numWorkers) + " workers"),
+      m_numWorkers (numWorkers)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  uint32_t m_numWorkers; //!< The NumWorkers attribute of the engine
+};
+
+/**
+ * \brief Install two gNBs 300 m apart, with a UE next to each of them
+ * \param nrHelper the helper
+ * \param gnbDevices the gNB devices
+ * \param ueDevices the UE devices, with a quasi-omni beam
+ */
+static void
+InstallDevices (const Ptr<NrHelper> &nrHelper, NetDeviceContainer *gnbDevices, NetDeviceContainer *ueDevices)
+{
+  Config::SetDefault ("ns3::ThreeGppChannelModel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (2);
+  ueNodes.Create (2);
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 10.0));
+  positionAlloc->Add (Vector (300.0, 0.0, 10.0));
+  positionAlloc->Add (Vector (30.0, 10.0, 1.5));
+  positionAlloc->Add (Vector (270.0, -10.0, 1.5));
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.Install (NodeContainer (gnbNodes, ueNodes));
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (3.5e9, 20e6, 1, BandwidthPartInfo::UMa_LoS);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+  nrHelper->SetGnbAntennaAttribute ("NumRows", UintegerValue (2));
+  nrHelper->SetGnbAntennaAttribute ("NumColumns", UintegerValue (4));
+
+  *gnbDevices = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  *ueDevices = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  int64_t randomStream = 1;
+  randomStream += nrHelper->AssignStreams (*gnbDevices, randomStream);
+  nrHelper->AssignStreams (*ueDevices, randomStream);
+
+  // The UEs keep a quasi-omni beam
+  for (auto it = ueDevices->Begin (); it != ueDevices->End (); ++it)
+    {
+      Ptr<UniformPlanarArray> antenna = DynamicCast<NrUeNetDevice> (*it)->GetPhy (0)->GetSpectrumPhy ()->GetAntenna ()->GetObject<UniformPlanarArray> ();
+      antenna->SetBeamformingVector (GetQuasiOmniBfv (antenna));
+    }
+}
+
+void
+NrCouplingGainTestCase::DoRun ()
+{
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  NetDeviceContainer gnbDevices;
+  NetDeviceContainer ueDevices;
+  InstallDevices (nrHelper, &gnbDevices, &ueDevices);
+
+  Ptr<NrCouplingGainEngine> engine = CreateObjectWithAttributes<NrCouplingGainEngine> ("NumWorkers", UintegerValue (m_numWorkers));
+  engine->Install (gnbDevices, ueDevices);
+  engine->Update ();
+
+  for (uint32_t g = 0; g < gnbDevices.GetN (); ++g)
+    {
+      Ptr<NrSpectrumPhy> gnbPhy = DynamicCast<NrGnbNetDevice> (gnbDevices.Get (g))->GetPhy (0)->GetSpectrumPhy ();
+      Ptr<UniformPlanarArray> gnbAntenna = gnbPhy->GetAntenna ()->GetObject<UniformPlanarArray> ();
+      Ptr<CachedThreeGppSpectrumPropagationLossModel> cached =
+        DynamicCast<CachedThreeGppSpectrumPropagationLossModel> (gnbPhy->GetSpectrumChannel ()->GetPhasedArraySpectrumPropagationLossModel ());
+      NS_TEST_ASSERT_MSG_EQ ((cached != nullptr), true, "No cached spectrum model");
+      Ptr<SpectrumValue> txPsd = Create<SpectrumValue> (gnbPhy->GetRxSpectrumModel ());
+      *txPsd = 1e-9;
+      NS_TEST_ASSERT_MSG_EQ (engine->GetNumBeams (g), 3U * 3U, "Wrong size of the codebook");
+
+      for (uint32_t u = 0; u < ueDevices.GetN (); ++u)
+        {
+          Ptr<NrSpectrumPhy> uePhy = DynamicCast<NrUeNetDevice> (ueDevices.Get (u))->GetPhy (0)->GetSpectrumPhy ();
+          Ptr<const PhasedArrayModel> ueAntenna = uePhy->GetAntenna ()->GetObject<PhasedArrayModel> ();
+
+          std::vector<double> meanGains;
+          for (uint32_t beam = 0; beam < engine->GetNumBeams (g); ++beam)
+            {
+              gnbAntenna->SetBeamformingVector (engine->GetBeam (g, beam));
+
+              // DL and UL, from the table
+              uint64_t hits = engine->GetNumHits ();
+              Ptr<SpectrumValue> dl = cached->DoCalcRxPowerSpectralDensity (txPsd, gnbPhy->GetMobility (), uePhy->GetMobility (),
+                                                                            gnbAntenna, ueAntenna);
+              Ptr<SpectrumValue> ul = cached->DoCalcRxPowerSpectralDensity (txPsd, uePhy->GetMobility (), gnbPhy->GetMobility (),
+                                                                            ueAntenna, gnbAntenna);
+              NS_TEST_ASSERT_MSG_EQ (engine->GetNumHits (), hits + 2, "The receptions were not found in the table");
+
+              // the same receptions, computed by the spectrum model
+              cached->SetCouplingGainEngine (nullptr);
+              Ptr<SpectrumValue> expected = cached->DoCalcRxPowerSpectralDensity (txPsd, gnbPhy->GetMobility (), uePhy->GetMobility (),
+                                                                                  gnbAntenna, ueAntenna);
+              cached->SetCouplingGainEngine (engine);
+
+              double sum = 0.0;
+              for (size_t i = 0; i < expected->GetValuesN (); ++i)
+                {
+                  NS_TEST_ASSERT_MSG_EQ ((*dl)[i], (*expected)[i], "Wrong DL PSD in band " << i << " of beam " << beam);
+                  NS_TEST_ASSERT_MSG_EQ ((*ul)[i], (*expected)[i], "Wrong UL PSD in band " << i << " of beam " << beam);
+                  sum += (*expected)[i] / 1e-9;
+                }
+              meanGains.push_back (sum / expected->GetValuesN ());
+            }
+
+          // The wideband gains of the beams differ as the received powers
+          for (uint32_t beam = 1; beam < meanGains.size (); ++beam)
+            {
+              NS_TEST_ASSERT_MSG_EQ_TOL (engine->GetCouplingGain (g, beam, u) - engine->GetCouplingGain (g, 0, u),
+                                         10 * std::log10 (meanGains[beam] / meanGains[0]), 1e-9,
+                                         "Wrong coupling gain of beam " << beam);
+            }
+          uint32_t best = static_cast<uint32_t> (std::max_element (meanGains.begin (), meanGains.end ()) - meanGains.begin ());
+          NS_TEST_ASSERT_MSG_EQ (engine->GetBestBeam (g, u), best, "Wrong best beam");
+        }
+
+      // A beam outside the codebook is computed by the spectrum model
+      gnbAntenna->SetBeamformingVector (GetQuasiOmniBfv (gnbAntenna));
+      uint64_t hits = engine->GetNumHits ();
+      Ptr<NrSpectrumPhy> uePhy = DynamicCast<NrUeNetDevice> (ueDevices.Get (0))->GetPhy (0)->GetSpectrumPhy ();
+      cached->DoCalcRxPowerSpectralDensity (txPsd, gnbPhy->GetMobility (), uePhy->GetMobility (),
+                                            gnbAntenna, uePhy->GetAntenna ()->GetObject<PhasedArrayModel> ());
+      NS_TEST_ASSERT_MSG_EQ (engine->GetNumHits (), hits, "A beam outside the codebook was found in the table");
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (engine->GetBestServer (ueDevices.Get (0)), gnbDevices.Get (0), "Wrong best server of UE 0");
+  NS_TEST_ASSERT_MSG_EQ (engine->GetBestServer (ueDevices.Get (1)), gnbDevices.Get (1), "Wrong best server of UE 1");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief Check the receivers pruned by a NrCouplingGainEngine
+ */
+class NrReceiverPruningTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrReceiverPruningTestCase ()
+    : TestCase ("Receiver pruning of the coupling gain engine")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrReceiverPruningTestCase::DoRun ()
+{
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  NetDeviceContainer gnbDevices;
+  NetDeviceContainer ueDevices;
+  InstallDevices (nrHelper, &gnbDevices, &ueDevices);
+
+  Ptr<NrCouplingGainEngine> engine = CreateObjectWithAttributes<NrCouplingGainEngine> ("ReceiverPruning", BooleanValue (true));
+  engine->Install (gnbDevices, ueDevices);
+
+  Ptr<NrGnbPhy> gnbPhy[2];
+  Ptr<NrUePhy> uePhy[2];
+  for (uint32_t i = 0; i < 2; ++i)
+    {
+      gnbPhy[i] = DynamicCast<NrGnbNetDevice> (gnbDevices.Get (i))->GetPhy (0);
+      uePhy[i] = DynamicCast<NrUeNetDevice> (ueDevices.Get (i))->GetPhy (0);
+    }
+  Ptr<SpectrumChannel> channel = gnbPhy[0]->GetSpectrumPhy ()->GetSpectrumChannel ();
+  DoubleValue maxLossDb;
+  channel->GetAttribute ("MaxLossDb", maxLossDb);
+  NS_TEST_ASSERT_MSG_LT (maxLossDb.Get (), 1000.0, "The channel would deliver the pruned signals");
+
+  // Whether the channel delivers the signals of a to b
+  auto delivered = [channel] (const Ptr<NrPhy> &a, const Ptr<NrPhy> &b)
+    {
+      return channel->GetPropagationLossModel ()->CalcRxPower (0.0, a->GetSpectrumPhy ()->GetMobility (),
+                                                               b->GetSpectrumPhy ()->GetMobility ()) > -999.0;
+    };
+  auto noiseFloorDbm = [] (const Ptr<NrPhy> &phy)
+    {
+      return -174.0 + 10 * std::log10 (phy->GetChannelBandwidth ()) + phy->GetNoiseFigure ();
+    };
+
+  // Nothing is pruned before the first update
+  NS_TEST_ASSERT_MSG_EQ (delivered (gnbPhy[1], uePhy[0]), true, "Pruned before the first update");
+  engine->Update ();
+
+  // A margin between the SNR of the UEs with their gNB, and with the other one
+  double snrNear = gnbPhy[0]->GetTxPower () + engine->GetBestCouplingGain (0, 0) - noiseFloorDbm (uePhy[0]);
+  double snrFar = gnbPhy[1]->GetTxPower () + engine->GetBestCouplingGain (1, 0) - noiseFloorDbm (uePhy[0]);
+  NS_TEST_ASSERT_MSG_GT (snrNear, snrFar, "The UE is not closer to its gNB");
+  engine->SetAttribute ("PruningMarginDb", DoubleValue (-(snrNear + snrFar) / 2));
+  engine->Update ();
+
+  uint64_t pruned = engine->GetReceiverPruning ()->GetNumPruned ();
+  NS_TEST_ASSERT_MSG_EQ (delivered (gnbPhy[0], uePhy[0]), true, "The UE near the gNB was pruned");
+  NS_TEST_ASSERT_MSG_EQ (delivered (gnbPhy[1], uePhy[0]), false, "The UE far from the gNB was not pruned");
+  NS_TEST_ASSERT_MSG_EQ (engine->GetReceiverPruning ()->GetNumPruned (), pruned + 1, "Wrong number of pruned receptions");
+
+  // In UL, with the powers and the noise of the UL
+  for (uint32_t g = 0; g < 2; ++g)
+    {
+      for (uint32_t u = 0; u < 2; ++u)
+        {
+          double snr = uePhy[u]->GetTxPower () + engine->GetBestCouplingGain (g, u) - noiseFloorDbm (gnbPhy[g]);
+          NS_TEST_ASSERT_MSG_EQ (delivered (uePhy[u], gnbPhy[g]), snr >= -(snrNear + snrFar) / 2,
+                                 "Wrong UL pruning of UE " << u << " towards gNB " << g);
+        }
+    }
+
+  // The pairs of UEs are not pruned, and the attached UE is always delivered
+  NS_TEST_ASSERT_MSG_EQ (delivered (uePhy[1], uePhy[0]), true, "A pair of UEs was pruned");
+  DynamicCast<NrUeNetDevice> (ueDevices.Get (0))->SetTargetEnb (DynamicCast<NrGnbNetDevice> (gnbDevices.Get (1)));
+  NS_TEST_ASSERT_MSG_EQ (delivered (gnbPhy[1], uePhy[0]), true, "The attached UE was pruned");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief The NrCouplingGainEngine test suite
+ */
+class NrTestCouplingGain : public TestSuite
+{
+public:
+  NrTestCouplingGain () : TestSuite ("nr-test-coupling-gain", UNIT)
+  {
+    AddTestCase (new NrCouplingGainTestCase (1), QUICK);
+    AddTestCase (new NrCouplingGainTestCase (3), QUICK);
+    AddTestCase (new NrReceiverPruningTestCase (), QUICK);
+  }
+};
+
+static NrTestCouplingGain NrTestCouplingGainSuite; //!< NrCouplingGainEngine test suite
+
+}  // namespace ns3
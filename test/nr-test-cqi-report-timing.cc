@@ -0,0 +1,340 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/applications-module.h>
+#include <ns3/point-to-point-module.h>
+#include <ns3/nr-module.h>
+#include <ns3/nr-mac-scheduler-cqi-management.h>
+#include <ns3/nr-mac-scheduler-ue-info-rr.h>
+
+/**
+ * \file nr-test-cqi-report-timing.cc
+ * \ingroup test
+ *
+ * \brief This test checks when the UEs send their DL CQI reports. With
+ * CqiReportPeriodicity, and DL traffic in every slot, the reports of each UE
+ * are sent in the slots at its CqiReportOffset modulo the period (plus the
+ * same control latency for all the UEs). With AperiodicCqiAge, the scheduler
+ * requests a report when the last one is older than the age, so that the
+ * reports are much more frequent than the periodic ones. The request logic
+ * of NrMacSchedulerCQIManagement is also checked alone.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the request of the aperiodic DL CQI reports
+ */
+class NrCqiRequestTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrCqiRequestTestCase ()
+    : TestCase ("Aperiodic DL CQI request")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrCqiRequestTestCase::DoRun ()
+{
+  const uint32_t maxAge = 3;
+
+  Ptr<NrAmc> amc = CreateObject<NrAmc> ();
+  NrMacSchedulerCQIManagement cqiManagement;
+  cqiManagement.InstallGetBwpIdFn ([] () { return 0; });
+  cqiManagement.InstallGetCellIdFn ([] () { return 1; });
+  cqiManagement.InstallGetStartMcsDlFn ([] () { return 0; });
+  cqiManagement.InstallGetStartMcsUlFn ([] () { return 0; });
+  cqiManagement.InstallGetNrAmcDlFn ([amc] () { return amc; });
+  cqiManagement.InstallGetNrAmcUlFn ([amc] () { return amc; });
+
+  auto ue = std::make_shared<NrMacSchedulerUeInfoRR> (1, BeamConfId (), [] () { return 1; });
+
+  // The first request waits for maxAge refreshes
+  for (uint32_t i = 0; i < maxAge; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (cqiManagement.RequestDlCqi (ue, maxAge), false,
+                             "Request after " << i << " refreshes");
+      cqiManagement.RefreshDlCqiMaps ();
+    }
+  NS_TEST_ASSERT_MSG_EQ (cqiManagement.RequestDlCqi (ue, maxAge), true, "No request of an old CQI");
+
+  // A request is not repeated while its report is awaited
+  NS_TEST_ASSERT_MSG_EQ (cqiManagement.RequestDlCqi (ue, maxAge), false, "Request repeated at once");
+  cqiManagement.RefreshDlCqiMaps ();
+  NS_TEST_ASSERT_MSG_EQ (cqiManagement.RequestDlCqi (ue, maxAge), false, "Request repeated too early");
+
+  // A report restarts the age of the CQI
+  DlCqiInfo info;
+  info.m_rnti = 1;
+  info.m_ri = 1;
+  info.m_cqiType = DlCqiInfo::WB;
+  info.m_wbCqi = StreamVector<uint8_t> (1, 9);
+  cqiManagement.DlWBCQIReported (info, ue, 100, static_cast<uint8_t> (amc->GetMaxMcs ()));
+  for (uint32_t i = 0; i < maxAge; ++i)
+    {
+      cqiManagement.RefreshDlCqiMaps ();
+      NS_TEST_ASSERT_MSG_EQ (cqiManagement.RequestDlCqi (ue, maxAge), i + 1 == maxAge,
+                             "Wrong request " << i + 1 << " refreshes after the report");
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief Check the slots of the DL CQI reports of UEs with DL traffic
+ */
+class NrCqiReportTimingTestCase : public TestCase
+{
+public:
+  /**
+   * \brief What the test case checks
+   */
+  enum Mode
+  {
+    PERIODIC,  //!< Periodic reports, at a different offset for each UE
+    APERIODIC  //!< Long period, with aperiodic requests
+  };
+
+  /**
+   * \brief Constructor
+   * \param mode what the test case checks
+   * \param name the name of the test case
+   */
+  NrCqiReportTimingTestCase (Mode mode, const std::string &name)
+    : TestCase (name),
+    m_mode (mode)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Record the DL CQI reports sent by the UEs
+   * \param sfn the slot of the transmission
+   * \param nodeId the cell ID
+   * \param rnti the RNTI of the UE
+   * \param bwpId the BWP ID
+   * \param msg the message
+   */
+  void TxedCtrlMsg (SfnSf sfn, uint16_t nodeId, uint16_t rnti, uint8_t bwpId, Ptr<NrControlMessage> msg);
+
+  Mode m_mode;                            //!< What the test case checks
+  const uint16_t m_periodicity {10};      //!< CqiReportPeriodicity in PERIODIC mode
+  const uint16_t m_longPeriodicity {80};  //!< CqiReportPeriodicity in APERIODIC mode
+  const uint32_t m_maxAge {10};           //!< AperiodicCqiAge in APERIODIC mode
+  const std::vector<uint16_t> m_offsets {0, 3}; //!< CqiReportOffset of each UE in PERIODIC mode
+  const Time m_checkStart {MilliSeconds (200)}; //!< Start of the checks, with traffic
+  const Time m_checkEnd {MilliSeconds (500)};   //!< End of the checks
+  std::map<uint16_t, std::vector<uint64_t> > m_cqiSlots; //!< Slots of the DL CQI reports of each RNTI
+};
+
+void
+NrCqiReportTimingTestCase::TxedCtrlMsg (SfnSf sfn, [[maybe_unused]] uint16_t nodeId,
+                                        uint16_t rnti, [[maybe_unused]] uint8_t bwpId,
+                                        Ptr<NrControlMessage> msg)
+{
+  Time now = Simulator::Now ();
+  if (msg->GetMessageType () == NrControlMessage::DL_CQI && now >= m_checkStart && now < m_checkEnd)
+    {
+      m_cqiSlots[rnti].push_back (sfn.Normalize ());
+    }
+}
+
+void
+NrCqiReportTimingTestCase::DoRun ()
+{
+  Config::SetDefault ("ns3::ThreeGppChannelModel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+
+  const uint32_t numUes = m_mode == PERIODIC ? m_offsets.size () : 1;
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (1);
+  ueNodes.Create (numUes);
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (gnbNodes);
+  mobility.Install (ueNodes);
+  gnbNodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (0, 0, 10));
+  for (uint32_t i = 0; i < numUes; ++i)
+    {
+      ueNodes.Get (i)->GetObject<MobilityModel> ()->SetPosition (Vector (20, 10.0 * i, 1.5));
+    }
+
+  Ptr<NrPointToPointEpcHelper> epcHelper = CreateObject<NrPointToPointEpcHelper> ();
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  nrHelper->SetEpcHelper (epcHelper);
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (2e9, 20e6, 1, BandwidthPartInfo::UMa_LoS);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  // Numerology 0: the slots are the subframes
+  nrHelper->SetGnbPhyAttribute ("Numerology", UintegerValue (0));
+  if (m_mode == PERIODIC)
+    {
+      nrHelper->SetUePhyAttribute ("CqiReportPeriodicity", UintegerValue (m_periodicity));
+    }
+  else
+    {
+      nrHelper->SetUePhyAttribute ("CqiReportPeriodicity", UintegerValue (m_longPeriodicity));
+      nrHelper->SetSchedulerAttribute ("AperiodicCqiAge", UintegerValue (m_maxAge));
+    }
+
+  NetDeviceContainer gnbDevices = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  NetDeviceContainer ueDevices = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  int64_t randomStream = 1;
+  randomStream += nrHelper->AssignStreams (gnbDevices, randomStream);
+  nrHelper->AssignStreams (ueDevices, randomStream);
+
+  std::vector<Ptr<NrUePhy> > uePhys;
+  for (uint32_t i = 0; i < numUes; ++i)
+    {
+      Ptr<NrUePhy> uePhy = nrHelper->GetUePhy (ueDevices.Get (i), 0);
+      uePhys.push_back (uePhy);
+      if (m_mode == PERIODIC)
+        {
+          uePhy->SetAttribute ("CqiReportOffset", UintegerValue (m_offsets.at (i)));
+        }
+      uePhy->TraceConnectWithoutContext ("UePhyTxedCtrlMsgsTrace",
+                                         MakeCallback (&NrCqiReportTimingTestCase::TxedCtrlMsg, this));
+    }
+
+  // A remote host that sends DL traffic in every slot to all the UEs
+  Ptr<Node> pgw = epcHelper->GetPgwNode ();
+  NodeContainer remoteHostContainer;
+  remoteHostContainer.Create (1);
+  Ptr<Node> remoteHost = remoteHostContainer.Get (0);
+  InternetStackHelper internet;
+  internet.Install (remoteHostContainer);
+  PointToPointHelper p2ph;
+  p2ph.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("100Gb/s")));
+  p2ph.SetDeviceAttribute ("Mtu", UintegerValue (2500));
+  p2ph.SetChannelAttribute ("Delay", TimeValue (Seconds (0.000)));
+  NetDeviceContainer internetDevices = p2ph.Install (pgw, remoteHost);
+  Ipv4AddressHelper ipv4h;
+  ipv4h.SetBase ("1.0.0.0", "255.0.0.0");
+  ipv4h.Assign (internetDevices);
+  Ipv4StaticRoutingHelper ipv4RoutingHelper;
+  Ptr<Ipv4StaticRouting> remoteHostStaticRouting = ipv4RoutingHelper.GetStaticRouting (remoteHost->GetObject<Ipv4> ());
+  remoteHostStaticRouting->AddNetworkRouteTo (Ipv4Address ("7.0.0.0"), Ipv4Mask ("255.0.0.0"), 1);
+
+  internet.Install (ueNodes);
+  Ipv4InterfaceContainer ueIpIface = epcHelper->AssignUeIpv4Address (ueDevices);
+  for (uint32_t i = 0; i < numUes; ++i)
+    {
+      Ptr<Ipv4StaticRouting> ueStaticRouting = ipv4RoutingHelper.GetStaticRouting (ueNodes.Get (i)->GetObject<Ipv4> ());
+      ueStaticRouting->SetDefaultRoute (epcHelper->GetUeDefaultGatewayAddress (), 1);
+      nrHelper->AttachToEnb (ueDevices.Get (i), gnbDevices.Get (0));
+    }
+
+  const uint16_t dlPort = 1234;
+  ApplicationContainer apps;
+  UdpServerHelper dlPacketSinkHelper (dlPort);
+  apps.Add (dlPacketSinkHelper.Install (ueNodes));
+  for (uint32_t i = 0; i < numUes; ++i)
+    {
+      UdpClientHelper dlClient (ueIpIface.GetAddress (i), dlPort);
+      dlClient.SetAttribute ("PacketSize", UintegerValue (1000));
+      dlClient.SetAttribute ("Interval", TimeValue (MicroSeconds (100)));
+      dlClient.SetAttribute ("MaxPackets", UintegerValue (0xFFFFFFFF));
+      apps.Add (dlClient.Install (remoteHost));
+    }
+  apps.Start (MilliSeconds (100));
+
+  Simulator::Stop (m_checkEnd);
+  Simulator::Run ();
+  std::vector<uint16_t> rntis;
+  for (const auto &uePhy : uePhys)
+    {
+      rntis.push_back (uePhy->GetRnti ());
+    }
+  uePhys.clear ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_cqiSlots.size (), numUes, "Some UE did not report a DL CQI");
+
+  const uint64_t checkedSlots = (m_checkEnd - m_checkStart).GetMilliSeconds ();
+  if (m_mode == PERIODIC)
+    {
+      // The reports of a UE are in the slots at its offset, plus the
+      // latency of the control messages, which is the same for all the UEs
+      std::vector<uint64_t> latency;
+      for (uint32_t ue = 0; ue < numUes; ++ue)
+        {
+          const std::vector<uint64_t> &slots = m_cqiSlots[rntis.at (ue)];
+          NS_TEST_ASSERT_MSG_GT_OR_EQ (slots.size (), checkedSlots / m_periodicity * 9 / 10,
+                                       "Too few DL CQI reports of UE " << ue);
+          for (size_t i = 1; i < slots.size (); ++i)
+            {
+              NS_TEST_ASSERT_MSG_EQ ((slots[i] - slots[i - 1]) % m_periodicity, 0U,
+                                     "DL CQI report " << i << " of UE " << ue << " out of period");
+            }
+          uint16_t offset = m_offsets.at (ue);
+          latency.push_back ((slots.front () + m_periodicity - offset % m_periodicity) % m_periodicity);
+        }
+      NS_TEST_ASSERT_MSG_EQ (latency.at (0), latency.at (1), "The DL CQI reports do not follow the offsets");
+    }
+  else
+    {
+      // Without the requests, a report every m_longPeriodicity slots
+      const std::vector<uint64_t> &slots = m_cqiSlots.begin ()->second;
+      NS_TEST_ASSERT_MSG_GT_OR_EQ (slots.size (), checkedSlots / (3 * m_maxAge),
+                                   "Too few aperiodic DL CQI reports");
+      for (size_t i = 1; i < slots.size (); ++i)
+        {
+          NS_TEST_ASSERT_MSG_LT_OR_EQ (slots[i] - slots[i - 1], 3 * m_maxAge,
+                                       "No aperiodic DL CQI report before " << i);
+        }
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The DL CQI report timing test suite
+ */
+class NrTestCqiReportTimingSuite : public TestSuite
+{
+public:
+  NrTestCqiReportTimingSuite () : TestSuite ("nr-test-cqi-report-timing", SYSTEM)
+  {
+    AddTestCase (new NrCqiRequestTestCase (), QUICK);
+    AddTestCase (new NrCqiReportTimingTestCase (NrCqiReportTimingTestCase::PERIODIC,
+                                                "Periodic DL CQI reports"), QUICK);
+    AddTestCase (new NrCqiReportTimingTestCase (NrCqiReportTimingTestCase::APERIODIC,
+                                                "Aperiodic DL CQI reports"), QUICK);
+  }
+};
+
+static NrTestCqiReportTimingSuite nrTestCqiReportTimingSuite; //!< DL CQI report timing test suite
+
+}  // namespace ns3
@@ -0,0 +1,120 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/node.h>
+#include <ns3/double.h>
+#include <ns3/boolean.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/multi-model-spectrum-channel.h>
+#include <ns3/three-gpp-propagation-loss-model.h>
+#include <ns3/distance-based-three-gpp-spectrum-propagation-loss-model.h>
+#include <ns3/nr-spectrum-value-helper.h>
+
+/**
+ * \file nr-test-distance-culling.cc
+ * \ingroup test
+ *
+ * \brief This test checks that DistanceBasedThreeGppSpectrumPropagationLossModel
+ * makes the spectrum channel skip the receivers out of range, keeping the
+ * path loss of the receivers in range, and that it gives a zero PSD out of
+ * range.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the path loss of a channel with culling, in and out of range
+ */
+class NrDistanceCullingTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrDistanceCullingTestCase ()
+    : TestCase ("Culling of the receivers out of range")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrDistanceCullingTestCase::DoRun ()
+{
+  std::vector<Ptr<MobilityModel>> mobility;
+  for (double x : {0.0, 200.0, 800.0})
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<MobilityModel> mob = CreateObject<ConstantPositionMobilityModel> ();
+      mob->SetPosition (Vector (x, 0, 10));
+      node->AggregateObject (mob);
+      mobility.push_back (mob);
+    }
+
+  Ptr<ThreeGppPropagationLossModel> pathloss = CreateObject<ThreeGppUmaPropagationLossModel> ();
+  pathloss->SetAttribute ("Frequency", DoubleValue (28e9));
+  pathloss->SetAttribute ("ShadowingEnabled", BooleanValue (false));
+  pathloss->SetChannelConditionModel (CreateObject<AlwaysLosChannelConditionModel> ());
+  double inRangeRxPower = pathloss->CalcRxPower (0, mobility[0], mobility[1]);
+
+  Ptr<MultiModelSpectrumChannel> channel = CreateObject<MultiModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (pathloss);
+  Ptr<DistanceBasedThreeGppSpectrumPropagationLossModel> model =
+    CreateObject<DistanceBasedThreeGppSpectrumPropagationLossModel> ();
+  model->SetMaxDistance (500);
+  model->CullOutOfRangeReceivers (channel);
+
+  NS_TEST_ASSERT_MSG_EQ (channel->GetPropagationLossModel (), pathloss, "The first model of the chain changed");
+
+  DoubleValue maxLossDb;
+  channel->GetAttribute ("MaxLossDb", maxLossDb);
+  double inRange = channel->GetPropagationLossModel ()->CalcRxPower (0, mobility[0], mobility[1]);
+  double outOfRange = channel->GetPropagationLossModel ()->CalcRxPower (0, mobility[0], mobility[2]);
+  NS_TEST_ASSERT_MSG_EQ_TOL (inRange, inRangeRxPower, 1e-9, "The path loss in range changed");
+  NS_TEST_ASSERT_MSG_LT (-inRange, maxLossDb.Get (), "A receiver in range is culled");
+  NS_TEST_ASSERT_MSG_GT (-outOfRange, maxLossDb.Get (), "A receiver out of range is not culled");
+
+  // Without culling, the receivers out of range get a zero PSD
+  Ptr<const SpectrumModel> sm = NrSpectrumValueHelper::GetSpectrumModel (10, 28e9, 120e3);
+  Ptr<SpectrumValue> txPsd = Create<SpectrumValue> (sm);
+  *txPsd = 1.0;
+  Ptr<SpectrumValue> rxPsd = model->DoCalcRxPowerSpectralDensity (txPsd, mobility[0], mobility[2], nullptr, nullptr);
+  NS_TEST_ASSERT_MSG_EQ (rxPsd->GetSpectrumModel (), sm, "Wrong spectrum model of the PSD");
+  NS_TEST_ASSERT_MSG_EQ (Sum (*rxPsd), 0.0, "The PSD out of range is not zero");
+}
+
+/**
+ * \ingroup test
+ * \brief The distance based culling test suite
+ */
+class NrTestDistanceCulling : public TestSuite
+{
+public:
+  NrTestDistanceCulling () : TestSuite ("nr-test-distance-culling", UNIT)
+  {
+    AddTestCase (new NrDistanceCullingTestCase (), QUICK);
+  }
+};
+
+static NrTestDistanceCulling NrTestDistanceCullingSuite; //!< Distance based culling test suite
+
+}  // namespace ns3
@@ -0,0 +1,128 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-distributed-helper.h>
+#include <algorithm>
+#include <limits>
+
+/**
+ * \file nr-test-distributed.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrDistributedHelper splits a grid of sites
+ * in clusters of the same size that do not overlap.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Partition a grid of sites
+ */
+class NrDistributedPartitionTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrDistributedPartitionTestCase ()
+    : TestCase ("Partition of the sites over the ranks")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrDistributedPartitionTestCase::DoRun ()
+{
+  // 6 x 4 sites, 500 m apart
+  std::vector<Vector> positions;
+  for (uint32_t i = 0; i < 6; ++i)
+    {
+      for (uint32_t j = 0; j < 4; ++j)
+        {
+          positions.push_back (Vector (500.0 * i, 500.0 * j, 25.0));
+        }
+    }
+
+  std::vector<uint32_t> clusters = NrDistributedHelper::Partition (positions, 4);
+  NS_TEST_ASSERT_MSG_EQ (clusters.size (), positions.size (), "Wrong number of sites");
+
+  struct Bounds
+  {
+    double xMin {std::numeric_limits<double>::max ()};
+    double xMax {std::numeric_limits<double>::lowest ()};
+    double yMin {std::numeric_limits<double>::max ()};
+    double yMax {std::numeric_limits<double>::lowest ()};
+    uint32_t numSites {0};
+  };
+  std::vector<Bounds> bounds (4);
+  for (uint32_t site = 0; site < positions.size (); ++site)
+    {
+      NS_TEST_ASSERT_MSG_LT (clusters[site], 4U, "Wrong cluster of the site " << site);
+      Bounds &b = bounds[clusters[site]];
+      b.xMin = std::min (b.xMin, positions[site].x);
+      b.xMax = std::max (b.xMax, positions[site].x);
+      b.yMin = std::min (b.yMin, positions[site].y);
+      b.yMax = std::max (b.yMax, positions[site].y);
+      ++b.numSites;
+    }
+  for (uint32_t c = 0; c < 4; ++c)
+    {
+      NS_TEST_ASSERT_MSG_EQ (bounds[c].numSites, 6U, "Unbalanced cluster " << c);
+      for (uint32_t o = c + 1; o < 4; ++o)
+        {
+          bool overlap = bounds[c].xMin <= bounds[o].xMax && bounds[o].xMin <= bounds[c].xMax
+            && bounds[c].yMin <= bounds[o].yMax && bounds[o].yMin <= bounds[c].yMax;
+          NS_TEST_ASSERT_MSG_EQ (overlap, false, "The clusters " << c << " and " << o << " overlap");
+        }
+    }
+
+  // A number of clusters that is not a power of two
+  clusters = NrDistributedHelper::Partition (positions, 3);
+  for (uint32_t c = 0; c < 3; ++c)
+    {
+      NS_TEST_ASSERT_MSG_EQ (std::count (clusters.begin (), clusters.end (), c), 8, "Unbalanced cluster " << c);
+    }
+
+  // Without MPI, this process simulates all the sites
+  NrDistributedHelper helper;
+  helper.Partition (positions);
+  NS_TEST_ASSERT_MSG_EQ (helper.GetNumRanks (), 1U, "Wrong number of ranks");
+  NS_TEST_ASSERT_MSG_EQ (helper.IsLocal (23), true, "A site is not local");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrDistributedHelper test suite
+ */
+class NrTestDistributed : public TestSuite
+{
+public:
+  NrTestDistributed () : TestSuite ("nr-test-distributed", UNIT)
+  {
+    AddTestCase (new NrDistributedPartitionTestCase (), QUICK);
+  }
+};
+
+static NrTestDistributed NrTestDistributedSuite; //!< NrDistributedHelper test suite
+
+}  // namespace ns3
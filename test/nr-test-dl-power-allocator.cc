@@ -0,0 +1,107 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-dl-power-allocator.h>
+#include <ns3/double.h>
+#include <cmath>
+#include <numeric>
+
+/**
+ * \file nr-test-dl-power-allocator.cc
+ * \ingroup test
+ *
+ * \brief This test checks that the DL power allocators keep the total
+ * power and the bounds of the weights, that the water-filling gives more
+ * power to the better RBGs, and that the cell-edge allocator boosts the RBGs
+ * of the cell-edge UEs.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Allocate the power of a transmission to three UEs
+ */
+class NrDlPowerAllocatorTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrDlPowerAllocatorTestCase ()
+    : TestCase ("Water-filling and cell-edge DL power allocation")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrDlPowerAllocatorTestCase::DoRun ()
+{
+  // Two RBGs of a UE at the cell edge (CQI 3), two of a UE in the middle
+  // (CQI 9) and four of a UE close to the gNB (CQI 15)
+  std::vector<NrDlPowerAllocator::RbgInfo> rbgs {
+    {1, 0.3, 3}, {1, 0.5, 3}, {2, 4.0, 9}, {2, 6.0, 9},
+    {3, 100.0, 15}, {3, 120.0, 15}, {3, 90.0, 15}, {3, 110.0, 15}};
+  std::vector<float> power;
+
+  Ptr<NrDlPowerAllocatorWaterFilling> waterFilling = CreateObject<NrDlPowerAllocatorWaterFilling> ();
+  waterFilling->AllocatePower (rbgs, &power);
+  NS_TEST_ASSERT_MSG_EQ (power.size (), rbgs.size (), "Wrong number of weights");
+  NS_TEST_ASSERT_MSG_EQ_TOL (std::accumulate (power.begin (), power.end (), 0.0), 8.0, 1e-4, "The total power changed");
+  for (size_t i = 0; i < power.size (); ++i)
+    {
+      NS_TEST_ASSERT_MSG_GT_OR_EQ (power[i], 0.25f - 1e-4f, "Weight below the minimum for the RBG " << i);
+      NS_TEST_ASSERT_MSG_LT_OR_EQ (power[i], 3.99f, "Weight above the maximum for the RBG " << i);
+    }
+  NS_TEST_ASSERT_MSG_LT (power[2], power[3], "The better RBG of the UE 2 has less power");
+  NS_TEST_ASSERT_MSG_LT (power[1], power[3], "The RBG of the UE 2 has less power than the one of the UE 1");
+
+  Ptr<NrDlPowerAllocatorCellEdge> cellEdge = CreateObject<NrDlPowerAllocatorCellEdge> ();
+  cellEdge->AllocatePower (rbgs, &power);
+  NS_TEST_ASSERT_MSG_EQ_TOL (std::accumulate (power.begin (), power.end (), 0.0), 8.0, 1e-4, "The total power changed");
+  NS_TEST_ASSERT_MSG_EQ_TOL (power[0], std::pow (10.0, 0.3), 1e-4, "The cell-edge RBG is not boosted");
+  NS_TEST_ASSERT_MSG_EQ_TOL (power[2], power[7], 1e-6, "The other RBGs have different weights");
+
+  // A boost that the other RBGs cannot pay for is reduced
+  cellEdge->SetAttribute ("Boost", DoubleValue (6.0));
+  cellEdge->SetAttribute ("MinPowerOffset", DoubleValue (-1.0));
+  cellEdge->AllocatePower (rbgs, &power);
+  NS_TEST_ASSERT_MSG_EQ_TOL (std::accumulate (power.begin (), power.end (), 0.0), 8.0, 1e-4, "The total power changed");
+  NS_TEST_ASSERT_MSG_EQ_TOL (power[2], std::pow (10.0, -0.1), 1e-4, "The other RBGs are not at the minimum");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrDlPowerAllocator test suite
+ */
+class NrTestDlPowerAllocator : public TestSuite
+{
+public:
+  NrTestDlPowerAllocator () : TestSuite ("nr-test-dl-power-allocator", UNIT)
+  {
+    AddTestCase (new NrDlPowerAllocatorTestCase (), QUICK);
+  }
+};
+
+static NrTestDlPowerAllocator NrTestDlPowerAllocatorSuite; //!< NrDlPowerAllocator test suite
+
+}  // namespace ns3
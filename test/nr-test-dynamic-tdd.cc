@@ -0,0 +1,95 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-dynamic-tdd-controller.h>
+#include <ns3/double.h>
+#include <ns3/string.h>
+
+/**
+ * \file nr-test-dynamic-tdd.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrDynamicTddController picks the candidate
+ * pattern whose share of DL slots follows the share of DL bytes, and that
+ * it keeps the current pattern within the hysteresis or without traffic.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Choose among three candidates for several buffer states
+ */
+class NrDynamicTddTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrDynamicTddTestCase ()
+    : TestCase ("Choice of the TDD pattern from the buffers")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrDynamicTddTestCase::DoRun ()
+{
+  auto dlHeavy = NrDynamicTddController::ParsePattern ("DL|DL|DL|DL|DL|DL|DL|S|UL|UL");
+  auto balanced = NrDynamicTddController::ParsePattern ("DL|DL|DL|DL|S|UL|UL|UL|UL|UL");
+  auto flexible = NrDynamicTddController::ParsePattern ("F|F|UL|UL");
+  NS_TEST_ASSERT_MSG_EQ_TOL (NrDynamicTddController::GetDlShare (dlHeavy), 0.8, 1e-9, "Wrong DL share");
+  NS_TEST_ASSERT_MSG_EQ_TOL (NrDynamicTddController::GetDlShare (flexible), 0.25, 1e-9, "Wrong DL share of F");
+
+  Ptr<NrDynamicTddController> controller = CreateObject<NrDynamicTddController> ();
+  controller->SetAttribute ("Candidates", StringValue ("DL|DL|DL|DL|DL|DL|DL|S|UL|UL;"
+                                                       "DL|DL|DL|DL|S|UL|UL|UL|UL|UL;"
+                                                       "F|F|UL|UL"));
+  controller->SetAttribute ("Hysteresis", DoubleValue (0.1));
+
+  NS_TEST_ASSERT_MSG_EQ (controller->ChoosePattern (0, 0, balanced), -1, "Change without traffic");
+  NS_TEST_ASSERT_MSG_EQ (controller->ChoosePattern (9000, 1000, balanced), 0, "The DL-heavy pattern is not chosen");
+  NS_TEST_ASSERT_MSG_EQ (controller->ChoosePattern (1000, 9000, balanced), 2, "The UL-heavy pattern is not chosen");
+  NS_TEST_ASSERT_MSG_EQ (controller->ChoosePattern (9000, 1000, dlHeavy), -1, "Change to the same pattern");
+  // 68% of DL bytes: the DL-heavy pattern is closer, but by less than the hysteresis
+  NS_TEST_ASSERT_MSG_EQ (controller->ChoosePattern (6800, 3200, balanced), -1, "Change within the hysteresis");
+
+  controller->SetAttribute ("Hysteresis", DoubleValue (0.0));
+  NS_TEST_ASSERT_MSG_EQ (controller->ChoosePattern (6800, 3200, balanced), 0, "No change without hysteresis");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrDynamicTddController test suite
+ */
+class NrTestDynamicTdd : public TestSuite
+{
+public:
+  NrTestDynamicTdd () : TestSuite ("nr-test-dynamic-tdd", UNIT)
+  {
+    AddTestCase (new NrDynamicTddTestCase (), QUICK);
+  }
+};
+
+static NrTestDynamicTdd NrTestDynamicTddSuite; //!< NrDynamicTddController test suite
+
+}  // namespace ns3
@@ -0,0 +1,194 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/nr-module.h>
+#include <ns3/nr-equivalence-checker.h>
+#include <functional>
+
+/**
+ * \file nr-test-equivalence.cc
+ * \ingroup test
+ *
+ * \brief This test runs a small full-buffer scenario with
+ * NrEquivalenceChecker: twice in the same mode, where the records must be
+ * identical, with the FastExp kernel of the EESM error models against
+ * ExactExp, where the KPIs must be within 1 %, and with the HARQ timer wheel
+ * of the scheduler against the scan of the processes, where the records must
+ * be identical.
+ */
+namespace ns3 {
+
+/**
+ * \brief One gNB and two UEs, with saturated RLC buffers in DL and UL
+ */
+static void
+BuildEquivalenceScenario ()
+{
+  Config::SetDefault ("ns3::ThreeGppChannelModel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (1);
+  ueNodes.Create (2);
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0.0, 0.0, 10.0));
+  positionAlloc->Add (Vector (40.0, 10.0, 1.5));
+  positionAlloc->Add (Vector (-120.0, 60.0, 1.5));
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.Install (NodeContainer (gnbNodes, ueNodes));
+
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  Ptr<IdealBeamformingHelper> beamformingHelper = CreateObject<IdealBeamformingHelper> ();
+  beamformingHelper->SetBeamformingMethod (DirectPathBeamforming::GetTypeId ());
+  nrHelper->SetBeamformingHelper (beamformingHelper);
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (3.5e9, 20e6, 1, BandwidthPartInfo::UMa_LoS);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  nrHelper->SetDlErrorModel ("ns3::NrEesmIrT1");
+  nrHelper->SetUlErrorModel ("ns3::NrEesmIrT1");
+  nrHelper->SetGnbDlAmcAttribute ("AmcModel", EnumValue (NrAmc::ErrorModel));
+  nrHelper->SetGnbUlAmcAttribute ("AmcModel", EnumValue (NrAmc::ErrorModel));
+
+  NetDeviceContainer gnbNetDev = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  NetDeviceContainer ueNetDev = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  int64_t randomStream = 1;
+  randomStream += nrHelper->AssignStreams (gnbNetDev, randomStream);
+  nrHelper->AssignStreams (ueNetDev, randomStream);
+  for (auto it = gnbNetDev.Begin (); it != gnbNetDev.End (); ++it)
+    {
+      DynamicCast<NrGnbNetDevice> (*it)->UpdateConfig ();
+    }
+  for (auto it = ueNetDev.Begin (); it != ueNetDev.End (); ++it)
+    {
+      DynamicCast<NrUeNetDevice> (*it)->UpdateConfig ();
+    }
+
+  // No EPC: the bearers use the saturation mode of the RLC
+  nrHelper->AttachToClosestEnb (ueNetDev, gnbNetDev);
+  nrHelper->ActivateDataRadioBearer (ueNetDev, EpsBearer (EpsBearer::NGBR_LOW_LAT_EMBB));
+
+  Simulator::Stop (MilliSeconds (100));
+}
+
+/**
+ * \ingroup test
+ * \brief Compare two runs of the scenario
+ */
+class NrEquivalenceTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param name the name of the test
+   * \param baseline the configuration of the baseline run
+   * \param alternative the configuration of the alternative run
+   * \param tolerance the tolerance of the KPIs
+   */
+  NrEquivalenceTestCase (const std::string &name, const std::function<void ()> &baseline,
+                         const std::function<void ()> &alternative, double tolerance)
+    : TestCase (name),
+      m_baseline (baseline),
+      m_alternative (alternative),
+      m_tolerance (tolerance)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  std::function<void ()> m_baseline;    //!< The configuration of the baseline run
+  std::function<void ()> m_alternative; //!< The configuration of the alternative run
+  double m_tolerance;                   //!< The tolerance of the KPIs
+};
+
+/**
+ * \brief Configure a run with an EESM kernel
+ * \param kernel the SinrExpKernel
+ * \return the configuration
+ */
+static std::function<void ()>
+WithKernel (const std::string &kernel)
+{
+  return [kernel] () { Config::SetDefault ("ns3::NrEesmErrorModel::SinrExpKernel", StringValue (kernel)); };
+}
+
+/**
+ * \brief Configure a run with a deadline of the HARQ retransmissions
+ * \param timerWheel whether the HARQ processes expire through the timer wheels
+ * \return the configuration
+ */
+static std::function<void ()>
+WithHarqDeadline (bool timerWheel)
+{
+  return [timerWheel] ()
+    {
+      Config::SetDefault ("ns3::NrMacSchedulerNs3::HarqRetxDeadline", UintegerValue (8));
+      Config::SetDefault ("ns3::NrMacSchedulerNs3::HarqTimerWheel", BooleanValue (timerWheel));
+    };
+}
+
+void
+NrEquivalenceTestCase::DoRun ()
+{
+  NrEquivalenceChecker checker;
+  checker.SetScenario (&BuildEquivalenceScenario);
+  checker.SetTolerance (m_tolerance);
+
+  NrEquivalenceChecker::Result result = checker.Run (m_baseline, m_alternative);
+
+  NS_TEST_ASSERT_MSG_GT (result.m_baseline[0][NrEquivalenceChecker::TBS], 0, "No DL TB received");
+  NS_TEST_ASSERT_MSG_GT (result.m_baseline[1][NrEquivalenceChecker::TBS], 0, "No UL TB received");
+  if (m_tolerance == 0)
+    {
+      NS_TEST_ASSERT_MSG_EQ (result.m_identical, true, "The runs differ: " << result.m_report);
+    }
+  NS_TEST_ASSERT_MSG_EQ (result.m_withinTolerance, true, "The KPIs differ: " << result.m_report);
+}
+
+/**
+ * \ingroup test
+ * \brief The equivalence harness test suite
+ */
+class NrTestEquivalence : public TestSuite
+{
+public:
+  NrTestEquivalence () : TestSuite ("nr-test-equivalence", SYSTEM)
+  {
+    AddTestCase (new NrEquivalenceTestCase ("Same mode twice", [] () {},
+                                            WithKernel ("ExactExp"), 0.0), QUICK);
+    AddTestCase (new NrEquivalenceTestCase ("FastExp against ExactExp", [] () {},
+                                            WithKernel ("FastExp"), 0.01), QUICK);
+    AddTestCase (new NrEquivalenceTestCase ("HARQ timer wheel against scan", WithHarqDeadline (false),
+                                            WithHarqDeadline (true), 0.0), QUICK);
+  }
+};
+
+static NrTestEquivalence NrTestEquivalenceSuite; //!< Equivalence harness test suite
+
+}  // namespace ns3
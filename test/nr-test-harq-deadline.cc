@@ -0,0 +1,126 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-mac-scheduler-harq-deadline.h>
+#include <tuple>
+
+/**
+ * \file nr-test-harq-deadline.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrMacSchedulerHarqDeadline erases the
+ * processes that waited their retransmission for the deadline or more,
+ * together with their feedback, and that it orders the others of a beam
+ * from the oldest, keeping the order of the feedbacks between equal timers.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Drop and sort the DL retransmissions of two UEs in the same beam
+ */
+class NrHarqDeadlineTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrHarqDeadlineTestCase ()
+    : TestCase ("HARQ retransmissions by deadline")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrHarqDeadlineTestCase::DoRun ()
+{
+  NrMacSchedulerHarqDeadline sched (8);
+  sched.InstallGetBwpIdFn ([] () { return 0; });
+  sched.InstallGetCellIdFn ([] () { return 1; });
+  sched.InstallGetBwInRBG ([] () { return 10; });
+
+  std::unordered_map<uint16_t, std::shared_ptr<NrMacSchedulerUeInfo> > ueMap;
+  std::vector<DlHarqInfo> feedbacks;
+
+  // (rnti, timer, symbols) of the processes 0 and 1 of each UE
+  const std::vector<std::tuple<uint16_t, uint8_t, uint8_t>> processes {{1, 2, 4}, {1, 5, 2},
+                                                                       {2, 5, 3}, {2, 9, 1}};
+  for (const auto & p : processes)
+    {
+      uint16_t rnti = std::get<0> (p);
+      if (ueMap.find (rnti) == ueMap.end ())
+        {
+          auto ue = std::make_shared<NrMacSchedulerUeInfo> (rnti, BeamConfId (), [] () { return 1; });
+          ue->m_dlHarq.SetMaxSize (16);
+          ueMap.emplace (rnti, ue);
+        }
+      auto dci = DciInfoElementTdma::Create (1, std::get<2> (p), DciInfoElementTdma::DL,
+                                             DciInfoElementTdma::DATA, NrBitset (10, true));
+      uint8_t id;
+      ueMap.at (rnti)->m_dlHarq.Insert (&id, HarqProcess (true, HarqProcess::RECEIVED_FEEDBACK,
+                                                          std::get<1> (p), dci));
+      DlHarqInfo feedback;
+      feedback.m_rnti = rnti;
+      feedback.m_harqProcessId = id;
+      feedback.m_harqStatus = {DlHarqInfo::NACK};
+      feedbacks.push_back (feedback);
+    }
+
+  sched.DropStaleDlHarq (&feedbacks, ueMap);
+  NS_TEST_ASSERT_MSG_EQ (feedbacks.size (), 3U, "Wrong number of feedbacks left");
+  NS_TEST_ASSERT_MSG_EQ (ueMap.at (2)->m_dlHarq.Get (1).m_active, false,
+                         "The process over the deadline was not erased");
+  NS_TEST_ASSERT_MSG_EQ (ueMap.at (2)->m_dlHarq.Get (0).m_active, true,
+                         "A process within the deadline was erased");
+  NS_TEST_ASSERT_MSG_EQ (feedbacks.at (2).m_rnti, 2, "The feedbacks changed order");
+
+  NrMacSchedulerNs3::ActiveHarqMap activeDlHarq;
+  for (const auto & feedback : feedbacks)
+    {
+      activeDlHarq[BeamConfId ()].emplace_back (ueMap.at (feedback.m_rnti)->m_dlHarq.Find (feedback.m_harqProcessId));
+    }
+  sched.SortDlHarq (&activeDlHarq);
+
+  const auto & sorted = activeDlHarq.at (BeamConfId ());
+  NS_TEST_ASSERT_MSG_EQ (sorted.size (), 3U, "Wrong number of retransmissions");
+  NS_TEST_ASSERT_MSG_EQ (+sorted.at (0)->second.m_dciElement->m_numSym, 2, "Wrong first retransmission");
+  NS_TEST_ASSERT_MSG_EQ (+sorted.at (1)->second.m_dciElement->m_numSym, 3, "Wrong second retransmission");
+  NS_TEST_ASSERT_MSG_EQ (+sorted.at (2)->second.m_dciElement->m_numSym, 4, "Wrong third retransmission");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrMacSchedulerHarqDeadline test suite
+ */
+class NrTestHarqDeadline : public TestSuite
+{
+public:
+  NrTestHarqDeadline () : TestSuite ("nr-test-harq-deadline", UNIT)
+  {
+    AddTestCase (new NrHarqDeadlineTestCase (), QUICK);
+  }
+};
+
+static NrTestHarqDeadline NrTestHarqDeadlineSuite; //!< NrMacSchedulerHarqDeadline test suite
+
+}  // namespace ns3
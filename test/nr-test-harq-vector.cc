@@ -0,0 +1,112 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-mac-harq-vector.h>
+
+/**
+ * \file nr-test-harq-vector.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrMacHarqVector hands out the lowest
+ * inactive process ID, and that the IDs are given back by Erase.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Fill, empty and refill a HARQ vector of a given size
+ */
+class NrHarqVectorTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param size the number of HARQ processes
+   */
+  NrHarqVectorTestCase (uint8_t size)
+    : TestCase ("HARQ vector with " + std::to_string (size) + " processes"),
+    m_size (size)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  uint8_t m_size; //!< Number of HARQ processes
+};
+
+void
+NrHarqVectorTestCase::DoRun ()
+{
+  NrMacHarqVector harq;
+  harq.SetMaxSize (m_size);
+  NS_TEST_ASSERT_MSG_EQ ((harq.Begin () == harq.End ()), true, "The processes should be created when first used");
+  HarqProcess process (true, HarqProcess::WAITING_FEEDBACK, 0, nullptr);
+  uint8_t id = 255;
+
+  for (uint32_t i = 0; i < m_size; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (harq.CanInsert (), true, "The vector is full too early");
+      NS_TEST_ASSERT_MSG_EQ (harq.Insert (&id, process), true, "Insert failed");
+      NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (id), i, "Insert did not use the lowest free ID");
+    }
+  NS_TEST_ASSERT_MSG_EQ (harq.Size (), static_cast<uint32_t> (m_size), "Wrong number of active processes");
+  NS_TEST_ASSERT_MSG_EQ (harq.CanInsert (), false, "The vector should be full");
+  NS_TEST_ASSERT_MSG_EQ (+harq.FirstAvailableId (), 255, "No ID should be available");
+
+  // Give back the IDs in reverse order: the lowest one is always picked first
+  for (int32_t i = m_size - 1; i >= 0; i -= 2)
+    {
+      harq.Erase (static_cast<uint8_t> (i));
+      NS_TEST_ASSERT_MSG_EQ (harq.Get (static_cast<uint8_t> (i)).m_active, false, "Erase did not reset the process");
+      NS_TEST_ASSERT_MSG_EQ (+harq.FirstAvailableId (), i, "Wrong first available ID");
+    }
+
+  uint32_t active = 0;
+  for (auto it = harq.Begin (); it != harq.End (); ++it)
+    {
+      NS_TEST_ASSERT_MSG_EQ (+it->first, it - harq.Begin (), "The processes are not sorted by ID");
+      active += it->second.m_active ? 1 : 0;
+    }
+  NS_TEST_ASSERT_MSG_EQ (active, harq.Size (), "Wrong number of active processes");
+
+  NS_TEST_ASSERT_MSG_EQ (harq.Insert (&id, process), true, "Insert failed");
+  NS_TEST_ASSERT_MSG_EQ (+id, (m_size - 1) % 2, "Insert did not use the lowest free ID");
+  NS_TEST_ASSERT_MSG_EQ ((harq.Find (m_size) == harq.End ()), true, "Find of an invalid ID");
+}
+
+/**
+ * \ingroup test
+ * \brief The HARQ vector test suite
+ */
+class NrTestHarqVector : public TestSuite
+{
+public:
+  NrTestHarqVector () : TestSuite ("nr-test-harq-vector", UNIT)
+  {
+    AddTestCase (new NrHarqVectorTestCase (16), QUICK);
+    AddTestCase (new NrHarqVectorTestCase (20), QUICK);
+    AddTestCase (new NrHarqVectorTestCase (200), QUICK);
+  }
+};
+
+static NrTestHarqVector NrTestHarqVectorSuite; //!< HARQ vector test suite
+
+}  // namespace ns3
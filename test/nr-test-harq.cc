@@ -22,9 +22,11 @@
 #include <ns3/nr-eesm-error-model.h>
 #include <ns3/nr-eesm-ir-t1.h>
 #include <ns3/nr-eesm-cc-t1.h>
+#include <ns3/nr-lte-mi-error-model.h>
 #include <ns3/ptr.h>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 /**
  * \file nr-test-harq.cc
@@ -166,6 +168,150 @@ TestHarqTestCase::DoRun ()
 
 }
 
+/**
+ * \brief Check the running sums of HARQ-CC over a full history
+ *
+ * The combined SINRs of three transmissions, the second and the third one
+ * with less and more RBs than the first one, are computed here by hand as
+ * per Chase Combining. The effective SINR of each retransmission must be
+ * the one of a first transmission that has the combined SINRs.
+ */
+class TestHarqCcHistoryTestCase : public TestCase
+{
+public:
+  TestHarqCcHistoryTestCase ()
+    : TestCase ("HARQ-CC running sums over a history of 3 receptions")
+  {}
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+TestHarqCcHistoryTestCase::DoRun ()
+{
+  const uint8_t mcs = 5;
+  const uint32_t tbSize = 256;
+  const uint32_t numRbs = 8;
+  NrSpectrumValueHelper helper;
+  Ptr<const SpectrumModel> model = helper.GetSpectrumModel (numRbs, 3.6e9, 15000);
+  Ptr<NrEesmCcT1> errorModel = CreateObject<NrEesmCcT1> ();
+
+  std::vector<std::vector<double>> sinrDb = {{1.0, 3.5, -2.0, 0.5, 2.0, 1.5, 0.0, 4.0},
+                                             {2.0, -1.0, 0.5, 1.0, 3.0, 2.5, -0.5, 1.0},
+                                             {0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0}};
+  std::vector<std::vector<int>> maps = {{1, 2, 4}, {6, 0}, {0, 2, 3, 5, 7}};
+
+  NrErrorModel::NrErrorModelHistory history;
+  std::vector<double> combined;
+  for (uint32_t tx = 0; tx < maps.size (); ++tx)
+    {
+      SpectrumValue sinr (model);
+      for (uint32_t i = 0; i < numRbs; ++i)
+        {
+          sinr[i] = std::pow (10.0, sinrDb.at (tx).at (i) / 10.0);
+        }
+
+      auto output = DynamicCast<NrEesmErrorModelOutput> (
+        errorModel->GetTbDecodificationStats (sinr, maps.at (tx), tbSize, mcs, history));
+      history.push_back (output);
+
+      // Combination by hand over all the tx
+      combined.assign (std::max (combined.size (), maps.at (tx).size ()), 0.0);
+      for (uint32_t j = 0; j < combined.size (); ++j)
+        {
+          combined[j] = 0.0;
+          for (uint32_t k = 0; k <= tx; ++k)
+            {
+              const std::vector<int> &map = maps.at (k);
+              combined[j] += std::pow (10.0, sinrDb.at (k).at (map.at (j % map.size ())) / 10.0);
+            }
+        }
+
+      SpectrumValue combinedSinr (model);
+      std::vector<int> combinedMap;
+      for (uint32_t j = 0; j < combined.size (); ++j)
+        {
+          combinedSinr[j] = combined[j];
+          combinedMap.push_back (static_cast<int> (j));
+        }
+      auto expected = DynamicCast<NrEesmErrorModelOutput> (
+        errorModel->GetTbDecodificationStats (combinedSinr, combinedMap, tbSize, mcs,
+                                              NrErrorModel::NrErrorModelHistory ()));
+
+      NS_TEST_ASSERT_MSG_EQ_TOL (output->m_sinrEff, expected->m_sinrEff, 1e-9,
+                                 "Wrong effective SINR of CC after the reception " << tx + 1);
+      NS_TEST_ASSERT_MSG_EQ (output->m_numRbSum, 3U + (tx > 0 ? 2 : 0) + (tx > 1 ? 5 : 0),
+                             "Wrong number of RBs of the HARQ process");
+    }
+}
+
+/**
+ * \brief Check that the outputs of the TBs evaluated at once are the ones
+ * evaluated one by one, with and without HARQ history, for EESM and MI
+ */
+class TestTbsDecodificationStatsTestCase : public TestCase
+{
+public:
+  TestTbsDecodificationStatsTestCase ()
+    : TestCase ("Error model outputs of several TBs at once")
+  {}
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+TestTbsDecodificationStatsTestCase::DoRun ()
+{
+  const uint32_t numRbs = 12;
+  NrSpectrumValueHelper helper;
+  Ptr<const SpectrumModel> model = helper.GetSpectrumModel (numRbs, 3.6e9, 15000);
+  SpectrumValue sinr (model);
+  for (uint32_t i = 0; i < numRbs; ++i)
+    {
+      sinr[i] = std::pow (10.0, (i % 5 - 1.0) / 2.0);
+    }
+
+  std::vector<Ptr<NrErrorModel>> errorModels = {CreateObject<NrEesmIrT1> (),
+                                                CreateObject<NrEesmCcT1> (),
+                                                CreateObject<NrLteMiErrorModel> ()};
+  std::vector<std::vector<int>> maps = {{0, 1, 2, 3}, {4, 5}, {6, 7, 8, 9, 10, 11}};
+  std::vector<uint32_t> sizes = {100, 20, 2000};
+  std::vector<uint8_t> mcs = {5, 0, 9};
+
+  for (const auto &errorModel : errorModels)
+    {
+      // The second TB is a retransmission
+      NrErrorModel::NrErrorModelHistory empty;
+      NrErrorModel::NrErrorModelHistory history;
+      history.push_back (errorModel->GetTbDecodificationStats (sinr, {1, 3}, sizes.at (1), mcs.at (1), empty));
+
+      std::vector<NrErrorModel::TbDecodeInput> tbs;
+      for (uint32_t i = 0; i < maps.size (); ++i)
+        {
+          NrErrorModel::TbDecodeInput tb;
+          tb.m_map = &maps.at (i);
+          tb.m_size = sizes.at (i);
+          tb.m_mcs = mcs.at (i);
+          tb.m_history = i == 1 ? &history : &empty;
+          tbs.push_back (tb);
+        }
+      std::vector<Ptr<NrErrorModelOutput>> outputs;
+      errorModel->GetTbsDecodificationStats (sinr, tbs, outputs);
+
+      NS_TEST_ASSERT_MSG_EQ (outputs.size (), tbs.size (), "Wrong number of outputs");
+      for (uint32_t i = 0; i < tbs.size (); ++i)
+        {
+          Ptr<NrErrorModelOutput> expected = errorModel->GetTbDecodificationStats (sinr, maps.at (i),
+                                                                                   sizes.at (i), mcs.at (i),
+                                                                                   *tbs.at (i).m_history);
+          NS_TEST_ASSERT_MSG_EQ (outputs.at (i)->m_tbler, expected->m_tbler,
+                                 "Wrong TBLER of the TB " << i << " of " << errorModel->GetInstanceTypeId ());
+        }
+    }
+}
+
 class TestHarq : public TestSuite
 {
 public:
@@ -187,6 +333,8 @@ public:
     uint16_t mcs = 5;
     uint16_t tbSize = 256;
     AddTestCase (new TestHarqTestCase (rxSinrDb, refEffSinrPerRx, mcs, tbSize, "HARQ test with 2 receptions"), QUICK);
+    AddTestCase (new TestHarqCcHistoryTestCase (), QUICK);
+    AddTestCase (new TestTbsDecodificationStatsTestCase (), QUICK);
   }
 };
 
@@ -0,0 +1,143 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/nr-icic-algorithm.h>
+#include <ns3/nr-phy-mac-common.h>
+#include <ns3/enum.h>
+#include <ns3/uinteger.h>
+#include <cmath>
+
+/**
+ * \file nr-test-icic.cc
+ * \ingroup test
+ *
+ * \brief This test checks the zones and the power of NrIcicFrequencyReuse
+ * in the Soft and Fractional modes, and that the cell-center UEs of a cell
+ * avoid the RBGs that a neighbour indicated as used with a high power.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Configure two cells with a reuse of 3 over 12 RBGs
+ */
+class NrIcicTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrIcicTestCase ()
+    : TestCase ("Soft and fractional frequency reuse")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrIcicTestCase::DoRun ()
+{
+  Ptr<NrIcicFrequencyReuse> soft = CreateObject<NrIcicFrequencyReuse> ();
+  soft->SetAttribute ("SubBand", UintegerValue (1));
+  soft->SetAttribute ("ExchangePeriod", UintegerValue (4));
+  soft->Configure (1, 12);
+
+  NS_TEST_ASSERT_MSG_EQ (soft->GetDlCellMask ().count (), 12U, "Soft reuse must use the whole band");
+  const NrBitset &edge = soft->GetDlUeMask (3);
+  const NrBitset &center = soft->GetDlUeMask (10);
+  for (uint32_t rbg = 0; rbg < 12; ++rbg)
+    {
+      bool inSubBand = rbg >= 4 && rbg < 8;
+      NS_TEST_ASSERT_MSG_EQ (edge.test (rbg), inSubBand, "Wrong edge zone at RBG " << rbg);
+      NS_TEST_ASSERT_MSG_EQ (center.test (rbg), !inSubBand, "Wrong center zone at RBG " << rbg);
+      NS_TEST_ASSERT_MSG_EQ_TOL (soft->GetDlRbgPower (rbg), std::pow (10.0, (inSubBand ? 3.0 : -3.0) / 10.0),
+                                 1e-6, "Wrong power at RBG " << rbg);
+    }
+
+  Ptr<NrIcicFrequencyReuse> fractional = CreateObject<NrIcicFrequencyReuse> ();
+  fractional->SetAttribute ("Mode", EnumValue (NrIcicFrequencyReuse::FRACTIONAL));
+  fractional->SetAttribute ("SubBand", UintegerValue (2));
+  fractional->Configure (2, 12);
+  // Center RBGs 0-5, sub-bands 6-7, 8-9 and 10-11
+  NS_TEST_ASSERT_MSG_EQ (fractional->GetDlCellMask ().count (), 8U, "Wrong RBGs of the fractional cell");
+  NS_TEST_ASSERT_MSG_EQ (fractional->GetDlCellMask ().test (7), false, "The sub-band of another cell is used");
+  NS_TEST_ASSERT_MSG_EQ (fractional->GetDlUeMask (0).count (), 2U, "Wrong edge zone");
+  NS_TEST_ASSERT_MSG_EQ (fractional->GetDlUeMask (0).test (10), true, "Wrong edge zone");
+  NS_TEST_ASSERT_MSG_EQ (fractional->GetDlUeMask (15).count (), 6U, "Wrong center zone");
+
+  // The soft cell uses its edge sub-band with a high power in every slot,
+  // and one center RBG in half of the slots
+  soft->AddNeighbour (fractional);
+  for (uint32_t slot = 0; slot < 4; ++slot)
+    {
+      SlotAllocInfo alloc (SfnSf (0, 0, slot, 0));
+      NrBitset mask (12);
+      for (uint32_t rbg = 4; rbg < 8; ++rbg)
+        {
+          mask.set (rbg);
+        }
+      if (slot % 2 == 0)
+        {
+          mask.set (1);
+        }
+      auto dci = std::make_shared<DciInfoElementTdma> (1, 12, DciInfoElementTdma::DL,
+                                                       DciInfoElementTdma::DATA, mask);
+      dci->m_rbgPower.assign (12, 1.0f);
+      for (uint32_t rbg = 4; rbg < 8; ++rbg)
+        {
+          dci->m_rbgPower[rbg] = soft->GetDlRbgPower (rbg);
+        }
+      alloc.m_varTtiAllocInfo.emplace_back (dci);
+      soft->NotifyDlSlot (alloc);
+    }
+  NS_TEST_ASSERT_MSG_EQ (fractional->GetNeighbourIndications ().size (), 0U, "The indication arrived without delay");
+
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (fractional->GetNeighbourIndications ().size (), 1U, "The indication did not arrive");
+  const auto &indication = fractional->GetNeighbourIndications ().at (1);
+  NS_TEST_ASSERT_MSG_EQ_TOL (indication.m_load.at (5), 1.0f, 1e-6f, "Wrong load of an edge RBG");
+  NS_TEST_ASSERT_MSG_EQ_TOL (indication.m_load.at (1), 0.5f, 1e-6f, "Wrong load of a center RBG");
+  NS_TEST_ASSERT_MSG_EQ (indication.m_highPower.count (), 4U, "Wrong high power RBGs");
+  NS_TEST_ASSERT_MSG_EQ (fractional->GetDlUeMask (15).count (), 4U, "The center UEs do not avoid the neighbour");
+  NS_TEST_ASSERT_MSG_EQ (fractional->GetDlUeMask (15).test (4), false, "The center UEs do not avoid the neighbour");
+  NS_TEST_ASSERT_MSG_EQ (fractional->GetDlUeMask (15).test (1), true, "A low power RBG is avoided");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief The NrIcicAlgorithm test suite
+ */
+class NrTestIcic : public TestSuite
+{
+public:
+  NrTestIcic () : TestSuite ("nr-test-icic", UNIT)
+  {
+    AddTestCase (new NrIcicTestCase (), QUICK);
+  }
+};
+
+static NrTestIcic NrTestIcicSuite; //!< NrIcicAlgorithm test suite
+
+}  // namespace ns3
@@ -0,0 +1,362 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/nr-module.h>
+#include <ns3/antenna-module.h>
+#include <ns3/three-gpp-spectrum-propagation-loss-model.h>
+#include <ns3/three-gpp-channel-model.h>
+#include <ns3/three-gpp-propagation-loss-model.h>
+
+/**
+ * \file nr-test-ideal-beamforming-methods.cc
+ * \ingroup test
+ *
+ * \brief This test checks the beamforming vectors of the ideal methods that
+ * work on the 3GPP channel matrix, between a gNB and a UE in line of sight.
+ * The vectors of OptimalCovMatrixBeamforming must have a unit norm, be
+ * reused while the channel is unchanged, and reach at least the long term
+ * gain of the best pair of beams of an exhaustive search over a 10 degrees
+ * azimuth-zenith grid. HierarchicalCellScanBeamforming, with a coarse step
+ * of 30 degrees refined to 10 degrees, must find the pair of that
+ * exhaustive search.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Install a gNB with a 4x4 array and a UE with a 2x2 array, both of
+ * isotropic elements, in line of sight at 28 GHz without shadowing
+ * \param uePosition the position of the UE; the gNB is at (0, 0, 10)
+ * \param [out] gnbPhy the spectrum PHY of the gNB
+ * \param [out] uePhy the spectrum PHY of the UE
+ * \return the helper, which must live as long as the devices
+ */
+static Ptr<NrHelper>
+InstallLosPair (const Vector &uePosition, Ptr<NrSpectrumPhy> *gnbPhy, Ptr<NrSpectrumPhy> *uePhy)
+{
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (1);
+  ueNodes.Create (1);
+
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  positionAlloc->Add (Vector (0, 0, 10));
+  positionAlloc->Add (uePosition);
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.Install (NodeContainer (gnbNodes, ueNodes));
+
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  CcBwpCreator::SimpleOperationBandConf bandConf (28e9, 100e6, 1, BandwidthPartInfo::UMa_LoS);
+  CcBwpCreator ccBwpCreator;
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  nrHelper->SetGnbAntennaAttribute ("NumRows", UintegerValue (4));
+  nrHelper->SetGnbAntennaAttribute ("NumColumns", UintegerValue (4));
+  nrHelper->SetGnbAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+  nrHelper->SetUeAntennaAttribute ("NumRows", UintegerValue (2));
+  nrHelper->SetUeAntennaAttribute ("NumColumns", UintegerValue (2));
+  nrHelper->SetUeAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+
+  NetDeviceContainer gnbDevs = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  NetDeviceContainer ueDevs = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  for (auto it = gnbDevs.Begin (); it != gnbDevs.End (); ++it)
+    {
+      DynamicCast<NrGnbNetDevice> (*it)->UpdateConfig ();
+    }
+  for (auto it = ueDevs.Begin (); it != ueDevs.End (); ++it)
+    {
+      DynamicCast<NrUeNetDevice> (*it)->UpdateConfig ();
+    }
+
+  *gnbPhy = nrHelper->GetGnbPhy (gnbDevs.Get (0), 0)->GetSpectrumPhy (0);
+  *uePhy = nrHelper->GetUePhy (ueDevs.Get (0), 0)->GetSpectrumPhy (0);
+
+  Ptr<SpectrumChannel> channel = (*gnbPhy)->GetSpectrumChannel ();
+  DynamicCast<ThreeGppPropagationLossModel> (channel->GetPropagationLossModel ())->AssignStreams (1);
+  Ptr<ThreeGppSpectrumPropagationLossModel> splm =
+    DynamicCast<ThreeGppSpectrumPropagationLossModel> (channel->GetPhasedArraySpectrumPropagationLossModel ());
+  DynamicCast<ThreeGppChannelModel> (splm->GetChannelModel ())->AssignStreams (1);
+  return nrHelper;
+}
+
+/**
+ * \ingroup test
+ * \param gnbPhy the spectrum PHY of the gNB
+ * \param uePhy the spectrum PHY of the UE
+ * \return the 3GPP channel matrix between them
+ */
+static Ptr<const MatrixBasedChannelModel::ChannelMatrix>
+GetChannelMatrix (const Ptr<NrSpectrumPhy> &gnbPhy, const Ptr<NrSpectrumPhy> &uePhy)
+{
+  Ptr<ThreeGppSpectrumPropagationLossModel> splm =
+    DynamicCast<ThreeGppSpectrumPropagationLossModel> (gnbPhy->GetSpectrumChannel ()->GetPhasedArraySpectrumPropagationLossModel ());
+  return splm->GetChannelModel ()->GetChannel (gnbPhy->GetMobility (), uePhy->GetMobility (),
+                                               gnbPhy->GetAntenna ()->GetObject<PhasedArrayModel> (),
+                                               uePhy->GetAntenna ()->GetObject<PhasedArrayModel> ());
+}
+
+/**
+ * \ingroup test
+ * \brief Long term gain of a pair of vectors, normalized to unit norms:
+ * \f$ \sum_c |w_{UE}^T H_c w_{gNB}|^2 / (|w_{UE}|^2 |w_{gNB}|^2) \f$
+ * \param channel the channel matrix
+ * \param gnbPhy the spectrum PHY of the gNB
+ * \param uePhy the spectrum PHY of the UE
+ * \param gnbW the vector of the gNB
+ * \param ueW the vector of the UE
+ * \return the gain
+ */
+static double
+GetLongTermGain (const Ptr<const MatrixBasedChannelModel::ChannelMatrix> &channel,
+                 const Ptr<NrSpectrumPhy> &gnbPhy, const Ptr<NrSpectrumPhy> &uePhy,
+                 const complexVector_t &gnbW, const complexVector_t &ueW)
+{
+  bool gnbIsS = !channel->IsReverse (gnbPhy->GetAntenna ()->GetObject<PhasedArrayModel> ()->GetId (),
+                                     uePhy->GetAntenna ()->GetObject<PhasedArrayModel> ()->GetId ());
+  const complexVector_t &sW = gnbIsS ? gnbW : ueW;
+  const complexVector_t &uW = gnbIsS ? ueW : gnbW;
+  const MatrixBasedChannelModel::Complex3DVector &h = channel->m_channel;
+
+  double gain = 0;
+  for (size_t c = 0; c < h.at (0).at (0).size (); ++c)
+    {
+      std::complex<double> sum (0, 0);
+      for (size_t u = 0; u < uW.size (); ++u)
+        {
+          for (size_t s = 0; s < sW.size (); ++s)
+            {
+              sum += uW[u] * h[u][s][c] * sW[s];
+            }
+        }
+      gain += std::norm (sum);
+    }
+  double sNorm = 0;
+  double uNorm = 0;
+  for (const auto &w : sW)
+    {
+      sNorm += std::norm (w);
+    }
+  for (const auto &w : uW)
+    {
+      uNorm += std::norm (w);
+    }
+  return gain / (sNorm * uNorm);
+}
+
+/**
+ * \ingroup test
+ * \brief The best pair of an exhaustive search over an azimuth-zenith grid
+ */
+struct NrGridSearchResult
+{
+  double m_gain {0};         //!< Long term gain of the pair
+  complexVector_t m_gnbW;    //!< Vector of the gNB
+  complexVector_t m_ueW;     //!< Vector of the UE
+};
+
+/**
+ * \ingroup test
+ * \brief Evaluate all the pairs of beams of the grid of
+ * HierarchicalCellScanBeamforming (azimuth -90 to 90, zenith 60 to 120
+ * degrees) with a given step
+ * \param channel the channel matrix
+ * \param gnbPhy the spectrum PHY of the gNB
+ * \param uePhy the spectrum PHY of the UE
+ * \param step the angle step, in degrees
+ * \return the best pair
+ */
+static NrGridSearchResult
+SearchGrid (const Ptr<const MatrixBasedChannelModel::ChannelMatrix> &channel,
+            const Ptr<NrSpectrumPhy> &gnbPhy, const Ptr<NrSpectrumPhy> &uePhy, double step)
+{
+  auto createBeams = [step] (const Ptr<const UniformPlanarArray> &antenna)
+    {
+      std::vector<complexVector_t> beams;
+      for (double azimuth = -90; azimuth < 90 + step / 2; azimuth += step)
+        {
+          for (double zenith = 60; zenith < 120 + step / 2; zenith += step)
+            {
+              beams.push_back (CreateDirectionalBfvAz (antenna, std::min (azimuth, 90.0),
+                                                       std::min (zenith, 120.0)));
+            }
+        }
+      return beams;
+    };
+  std::vector<complexVector_t> gnbBeams = createBeams (gnbPhy->GetAntenna ()->GetObject<UniformPlanarArray> ());
+  std::vector<complexVector_t> ueBeams = createBeams (uePhy->GetAntenna ()->GetObject<UniformPlanarArray> ());
+
+  NrGridSearchResult best;
+  best.m_gain = -1;
+  for (const auto &gnbW : gnbBeams)
+    {
+      for (const auto &ueW : ueBeams)
+        {
+          double gain = GetLongTermGain (channel, gnbPhy, uePhy, gnbW, ueW);
+          if (best.m_gain < gain)
+            {
+              best.m_gain = gain;
+              best.m_gnbW = gnbW;
+              best.m_ueW = ueW;
+            }
+        }
+    }
+  return best;
+}
+
+/**
+ * \ingroup test
+ * \brief Check the vectors of OptimalCovMatrixBeamforming against an
+ * exhaustive search of beams
+ */
+class NrOptimalCovMatrixBeamformingTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrOptimalCovMatrixBeamformingTestCase ()
+    : TestCase ("OptimalCovMatrixBeamforming in line of sight")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrOptimalCovMatrixBeamformingTestCase::DoRun ()
+{
+  for (const auto &uePosition : {Vector (30, 10, 1.5), Vector (40, -25, 1.5), Vector (-20, 60, 1.5)})
+    {
+      Ptr<NrSpectrumPhy> gnbPhy;
+      Ptr<NrSpectrumPhy> uePhy;
+      Ptr<NrHelper> nrHelper = InstallLosPair (uePosition, &gnbPhy, &uePhy);
+
+      Ptr<OptimalCovMatrixBeamforming> optimal = CreateObject<OptimalCovMatrixBeamforming> ();
+      BeamformingVectorPair bfvs = optimal->GetBeamformingVectors (gnbPhy, uePhy);
+      Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel = GetChannelMatrix (gnbPhy, uePhy);
+
+      NS_TEST_ASSERT_MSG_EQ (bfvs.first.first.size (), 16, "Wrong size of the gNB vector");
+      NS_TEST_ASSERT_MSG_EQ (bfvs.second.first.size (), 4, "Wrong size of the UE vector");
+      for (const auto &w : {bfvs.first.first, bfvs.second.first})
+        {
+          double norm = 0;
+          for (const auto &element : w)
+            {
+              norm += std::norm (element);
+            }
+          NS_TEST_ASSERT_MSG_EQ_TOL (norm, 1.0, 1e-9, "The vector has not a unit norm");
+        }
+
+      // The optimal vectors are at least as good as the best pair of beams
+      double gain = GetLongTermGain (channel, gnbPhy, uePhy, bfvs.first.first, bfvs.second.first);
+      NrGridSearchResult grid = SearchGrid (channel, gnbPhy, uePhy, 10);
+      NS_TEST_ASSERT_MSG_GT (grid.m_gain, 0, "No gain in line of sight");
+      NS_TEST_ASSERT_MSG_GT_OR_EQ (gain, grid.m_gain * (1 - 1e-6),
+                                   "The optimal vectors are worse than a pair of beams at " << uePosition);
+
+      // The channel is unchanged: the same vectors
+      BeamformingVectorPair again = optimal->GetBeamformingVectors (gnbPhy, uePhy);
+      NS_TEST_ASSERT_MSG_EQ ((again.first.first == bfvs.first.first && again.second.first == bfvs.second.first),
+                             true, "Different vectors for the same channel");
+
+      Simulator::Destroy ();
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief Check that HierarchicalCellScanBeamforming finds the beams of the
+ * exhaustive search at its fine step
+ */
+class NrHierarchicalCellScanBeamformingTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrHierarchicalCellScanBeamformingTestCase ()
+    : TestCase ("HierarchicalCellScanBeamforming against the exhaustive search")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrHierarchicalCellScanBeamformingTestCase::DoRun ()
+{
+  for (const auto &uePosition : {Vector (30, 10, 1.5), Vector (40, -25, 1.5), Vector (-20, 60, 1.5)})
+    {
+      Ptr<NrSpectrumPhy> gnbPhy;
+      Ptr<NrSpectrumPhy> uePhy;
+      Ptr<NrHelper> nrHelper = InstallLosPair (uePosition, &gnbPhy, &uePhy);
+
+      Ptr<HierarchicalCellScanBeamforming> hierarchical = CreateObject<HierarchicalCellScanBeamforming> ();
+      hierarchical->SetAttribute ("CoarseAngleStep", DoubleValue (30));
+      hierarchical->SetAttribute ("FineAngleStep", DoubleValue (10));
+      hierarchical->SetAttribute ("NumCandidates", UintegerValue (4));
+      BeamformingVectorPair bfvs = hierarchical->GetBeamformingVectors (gnbPhy, uePhy);
+      Ptr<const MatrixBasedChannelModel::ChannelMatrix> channel = GetChannelMatrix (gnbPhy, uePhy);
+
+      NrGridSearchResult grid = SearchGrid (channel, gnbPhy, uePhy, 10);
+      double gain = GetLongTermGain (channel, gnbPhy, uePhy, bfvs.first.first, bfvs.second.first);
+      NS_TEST_ASSERT_MSG_EQ_TOL (gain, grid.m_gain, grid.m_gain * 1e-9,
+                                 "The hierarchical search missed the best pair at " << uePosition);
+      NS_TEST_ASSERT_MSG_EQ ((bfvs.first.first == grid.m_gnbW), true,
+                             "Different gNB beam than the exhaustive search at " << uePosition);
+      NS_TEST_ASSERT_MSG_EQ ((bfvs.second.first == grid.m_ueW), true,
+                             "Different UE beam than the exhaustive search at " << uePosition);
+
+      // With the fine step as coarse step, it is the exhaustive search
+      hierarchical->SetAttribute ("CoarseAngleStep", DoubleValue (10));
+      BeamformingVectorPair exhaustive = hierarchical->GetBeamformingVectors (gnbPhy, uePhy);
+      NS_TEST_ASSERT_MSG_EQ ((exhaustive.first.first == grid.m_gnbW && exhaustive.second.first == grid.m_ueW),
+                             true, "The single stage search differs from the exhaustive search");
+
+      Simulator::Destroy ();
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The test suite of the ideal beamforming methods on the channel matrix
+ */
+class NrTestIdealBeamformingMethodsSuite : public TestSuite
+{
+public:
+  NrTestIdealBeamformingMethodsSuite () : TestSuite ("nr-test-ideal-beamforming-methods", SYSTEM)
+  {
+    AddTestCase (new NrOptimalCovMatrixBeamformingTestCase (), QUICK);
+    AddTestCase (new NrHierarchicalCellScanBeamformingTestCase (), QUICK);
+  }
+};
+
+static NrTestIdealBeamformingMethodsSuite nrTestIdealBeamformingMethodsSuite; //!< Ideal beamforming methods test suite
+
+}  // namespace ns3
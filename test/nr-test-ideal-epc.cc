@@ -0,0 +1,205 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/network-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/point-to-point-module.h>
+#include <ns3/nr-module.h>
+#include <ns3/antenna-module.h>
+
+/**
+ * \file nr-test-ideal-epc.cc
+ * \ingroup test
+ *
+ * \brief This test sends UDP packets between a remote host and a UE,
+ * through NrIdealEpcHelper, and checks that the packets of both directions
+ * are received, and that the DL packets take at least the delay of the core.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Send DL and UL packets through the ideal core
+ */
+class NrIdealEpcTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param coreDelay the delay of the core
+   */
+  NrIdealEpcTestCase (Time coreDelay)
+    : TestCase ("Ideal core with a delay of " + std::to_string (coreDelay.GetMilliSeconds ()) + " ms"),
+    m_coreDelay (coreDelay)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Receive the packets of a socket
+   * \param socket the socket
+   */
+  void Receive (Ptr<Socket> socket);
+
+  Time m_coreDelay;                 //!< The delay of the core
+  Time m_sendTime;                  //!< When the packets are sent
+  std::map<Ptr<Socket>, uint32_t> m_received; //!< Number of packets received by each socket
+  Time m_firstDlDelay;              //!< Delay of the first DL packet
+  Ptr<Socket> m_ueSink;             //!< The socket of the UE that receives the DL packets
+};
+
+void
+NrIdealEpcTestCase::Receive (Ptr<Socket> socket)
+{
+  while (socket->Recv ())
+    {
+      if (m_received[socket]++ == 0 && socket == m_ueSink)
+        {
+          m_firstDlDelay = Simulator::Now () - m_sendTime;
+        }
+    }
+}
+
+void
+NrIdealEpcTestCase::DoRun ()
+{
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (1);
+  ueNodes.Create (1);
+
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (0, 0, 10));
+  allocator->Add (Vector (20, 0, 1.5));
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (allocator);
+  mobility.Install (gnbNodes);
+  mobility.Install (ueNodes);
+
+  Ptr<NrIdealEpcHelper> epcHelper = CreateObject<NrIdealEpcHelper> ();
+  epcHelper->SetAttribute ("CoreDelay", TimeValue (m_coreDelay));
+  Ptr<IdealBeamformingHelper> idealBeamformingHelper = CreateObject<IdealBeamformingHelper> ();
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  nrHelper->SetBeamformingHelper (idealBeamformingHelper);
+  nrHelper->SetEpcHelper (epcHelper);
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (28e9, 100e6, 1, BandwidthPartInfo::UMi_StreetCanyon);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  nrHelper->SetUeAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+  nrHelper->SetGnbAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+
+  NetDeviceContainer gnbDevices = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  NetDeviceContainer ueDevices = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  DynamicCast<NrGnbNetDevice> (gnbDevices.Get (0))->UpdateConfig ();
+  DynamicCast<NrUeNetDevice> (ueDevices.Get (0))->UpdateConfig ();
+
+  // The remote host, connected to the PGW
+  NodeContainer remoteHostContainer;
+  remoteHostContainer.Create (1);
+  Ptr<Node> remoteHost = remoteHostContainer.Get (0);
+  InternetStackHelper internet;
+  internet.Install (remoteHostContainer);
+  PointToPointHelper p2ph;
+  p2ph.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("100Gb/s")));
+  p2ph.SetChannelAttribute ("Delay", TimeValue (Seconds (0)));
+  NetDeviceContainer internetDevices = p2ph.Install (epcHelper->GetPgwNode (), remoteHost);
+  Ipv4AddressHelper ipv4h;
+  ipv4h.SetBase ("1.0.0.0", "255.0.0.0");
+  Ipv4InterfaceContainer internetIpIfaces = ipv4h.Assign (internetDevices);
+  Ipv4StaticRoutingHelper ipv4RoutingHelper;
+  Ptr<Ipv4StaticRouting> remoteHostStaticRouting = ipv4RoutingHelper.GetStaticRouting (remoteHost->GetObject<Ipv4> ());
+  remoteHostStaticRouting->AddNetworkRouteTo (Ipv4Address ("7.0.0.0"), Ipv4Mask ("255.0.0.0"), 1);
+
+  internet.Install (ueNodes);
+  Ipv4InterfaceContainer ueIpIface = epcHelper->AssignUeIpv4Address (ueDevices);
+  Ptr<Ipv4StaticRouting> ueStaticRouting = ipv4RoutingHelper.GetStaticRouting (ueNodes.Get (0)->GetObject<Ipv4> ());
+  ueStaticRouting->SetDefaultRoute (epcHelper->GetUeDefaultGatewayAddress (), 1);
+
+  nrHelper->AttachToClosestEnb (ueDevices, gnbDevices);
+
+  // A sink on each side, and a sender on each side
+  const uint16_t port = 1234;
+  TypeId udpTid = UdpSocketFactory::GetTypeId ();
+  Ptr<Socket> ueSink = Socket::CreateSocket (ueNodes.Get (0), udpTid);
+  ueSink->Bind (InetSocketAddress (Ipv4Address::GetAny (), port));
+  ueSink->SetRecvCallback (MakeCallback (&NrIdealEpcTestCase::Receive, this));
+  Ptr<Socket> remoteSink = Socket::CreateSocket (remoteHost, udpTid);
+  remoteSink->Bind (InetSocketAddress (Ipv4Address::GetAny (), port));
+  remoteSink->SetRecvCallback (MakeCallback (&NrIdealEpcTestCase::Receive, this));
+  m_ueSink = ueSink;
+  m_received[ueSink] = 0;
+  m_received[remoteSink] = 0;
+
+  Ptr<Socket> remoteSender = Socket::CreateSocket (remoteHost, udpTid);
+  Ptr<Socket> ueSender = Socket::CreateSocket (ueNodes.Get (0), udpTid);
+  const uint32_t numPackets = 10;
+  m_sendTime = MilliSeconds (400);
+  for (uint32_t i = 0; i < numPackets; ++i)
+    {
+      Time t = m_sendTime + MilliSeconds (i);
+      Simulator::Schedule (t, [remoteSender, ueIpIface, port] ()
+        {
+          remoteSender->SendTo (Create<Packet> (100), 0, InetSocketAddress (ueIpIface.GetAddress (0), port));
+        });
+      Simulator::Schedule (t, [ueSender, internetIpIfaces, port] ()
+        {
+          ueSender->SendTo (Create<Packet> (100), 0, InetSocketAddress (internetIpIfaces.GetAddress (1), port));
+        });
+    }
+
+  Simulator::Stop (MilliSeconds (600));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_received[ueSink], numPackets, "Wrong number of DL packets received");
+  NS_TEST_ASSERT_MSG_EQ (m_received[remoteSink], numPackets, "Wrong number of UL packets received");
+  NS_TEST_ASSERT_MSG_GT_OR_EQ (m_firstDlDelay, m_coreDelay, "The DL packet did not take the delay of the core");
+
+  m_ueSink = nullptr;
+  m_received.clear ();
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief The NrIdealEpcHelper test suite
+ */
+class NrTestIdealEpc : public TestSuite
+{
+public:
+  NrTestIdealEpc () : TestSuite ("nr-test-ideal-epc", SYSTEM)
+  {
+    AddTestCase (new NrIdealEpcTestCase (Seconds (0)), QUICK);
+    AddTestCase (new NrIdealEpcTestCase (MilliSeconds (10)), QUICK);
+  }
+};
+
+static NrTestIdealEpc NrTestIdealEpcSuite; //!< NrIdealEpcHelper test suite
+
+}  // namespace ns3
@@ -0,0 +1,192 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/network-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/nr-module.h>
+#include <ns3/antenna-module.h>
+#include <set>
+
+/**
+ * \file nr-test-instant-attach.cc
+ * \ingroup test
+ *
+ * \brief This test attaches some UEs with and without the NrHelper attribute
+ * InstantAttach, and checks that in both cases all the UEs are connected,
+ * with an RNTI known by the gNB RRC, and that the
+ * instant attach does not connect them later than the random access over
+ * the air.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Attach the UEs in both modes, and compare the end states
+ */
+class NrInstantAttachTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrInstantAttachTestCase ()
+    : TestCase ("Instant attach and random access over the air")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Attach the UEs, and check their state at the end
+   * \param instantAttach the value of the InstantAttach attribute
+   * \return the time when the last UE got connected
+   */
+  Time Attach (bool instantAttach);
+
+  /**
+   * \brief A UE is connected
+   * \param imsi the IMSI of the UE
+   * \param cellId the cell
+   * \param rnti the RNTI of the UE
+   */
+  void ConnectionEstablished (uint64_t imsi, uint16_t cellId, uint16_t rnti);
+
+  uint32_t m_connected {0}; //!< Number of UEs connected
+  Time m_lastConnection;    //!< When the last UE got connected
+};
+
+void
+NrInstantAttachTestCase::ConnectionEstablished ([[maybe_unused]] uint64_t imsi,
+                                                [[maybe_unused]] uint16_t cellId,
+                                                [[maybe_unused]] uint16_t rnti)
+{
+  ++m_connected;
+  m_lastConnection = Simulator::Now ();
+}
+
+Time
+NrInstantAttachTestCase::Attach (bool instantAttach)
+{
+  const uint32_t numUes = 4;
+  m_connected = 0;
+  m_lastConnection = Seconds (0);
+
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (1);
+  ueNodes.Create (numUes);
+
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (0, 0, 10));
+  for (uint32_t i = 0; i < numUes; ++i)
+    {
+      allocator->Add (Vector (20, 10.0 * i, 1.5));
+    }
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (allocator);
+  mobility.Install (gnbNodes);
+  mobility.Install (ueNodes);
+
+  Ptr<IdealBeamformingHelper> idealBeamformingHelper = CreateObject<IdealBeamformingHelper> ();
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  nrHelper->SetBeamformingHelper (idealBeamformingHelper);
+  nrHelper->SetAttribute ("InstantAttach", BooleanValue (instantAttach));
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (28e9, 100e6, 1, BandwidthPartInfo::UMi_StreetCanyon);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  nrHelper->SetUeAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+  nrHelper->SetGnbAntennaAttribute ("AntennaElement", PointerValue (CreateObject<IsotropicAntennaModel> ()));
+
+  NetDeviceContainer gnbDevices = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  NetDeviceContainer ueDevices = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  DynamicCast<NrGnbNetDevice> (gnbDevices.Get (0))->UpdateConfig ();
+  for (uint32_t i = 0; i < numUes; ++i)
+    {
+      Ptr<NrUeNetDevice> ueDevice = DynamicCast<NrUeNetDevice> (ueDevices.Get (i));
+      ueDevice->UpdateConfig ();
+      ueDevice->GetRrc ()->TraceConnectWithoutContext ("ConnectionEstablished",
+                                                       MakeCallback (&NrInstantAttachTestCase::ConnectionEstablished, this));
+    }
+
+  nrHelper->AttachToClosestEnb (ueDevices, gnbDevices);
+  nrHelper->ActivateDataRadioBearer (ueDevices, EpsBearer (EpsBearer::NGBR_VIDEO_TCP_DEFAULT));
+
+  Simulator::Stop (MilliSeconds (300));
+  Simulator::Run ();
+
+  std::string mode = instantAttach ? " with instant attach" : " with random access over the air";
+  NS_TEST_EXPECT_MSG_EQ (m_connected, numUes, "Not all the UEs are connected" << mode);
+
+  Ptr<LteEnbRrc> gnbRrc = DynamicCast<NrGnbNetDevice> (gnbDevices.Get (0))->GetRrc ();
+  std::set<uint16_t> rntis;
+  for (uint32_t i = 0; i < numUes; ++i)
+    {
+      Ptr<LteUeRrc> ueRrc = DynamicCast<NrUeNetDevice> (ueDevices.Get (i))->GetRrc ();
+      uint16_t rnti = ueRrc->GetRnti ();
+      rntis.insert (rnti);
+      NS_TEST_EXPECT_MSG_EQ (ueRrc->GetState (), LteUeRrc::CONNECTED_NORMALLY,
+                             "UE " << i << " is not connected" << mode);
+      NS_TEST_EXPECT_MSG_EQ (gnbRrc->HasUeManager (rnti), true,
+                             "The gNB does not know the RNTI of UE " << i << mode);
+      if (gnbRrc->HasUeManager (rnti))
+        {
+          NS_TEST_EXPECT_MSG_EQ (gnbRrc->GetUeManager (rnti)->GetState (), UeManager::CONNECTED_NORMALLY,
+                                 "The gNB does not see UE " << i << " as connected" << mode);
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (rntis.size (), numUes, "Two UEs have the same RNTI" << mode);
+
+  Simulator::Destroy ();
+  return m_lastConnection;
+}
+
+void
+NrInstantAttachTestCase::DoRun ()
+{
+  Time overTheAir = Attach (false);
+  Time instant = Attach (true);
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (instant, overTheAir,
+                               "The instant attach connected the UEs later than the random access");
+}
+
+/**
+ * \ingroup test
+ * \brief The instant attach test suite
+ */
+class NrTestInstantAttach : public TestSuite
+{
+public:
+  NrTestInstantAttach () : TestSuite ("nr-test-instant-attach", SYSTEM)
+  {
+    AddTestCase (new NrInstantAttachTestCase (), QUICK);
+  }
+};
+
+static NrTestInstantAttach NrTestInstantAttachSuite; //!< Instant attach test suite
+
+}  // namespace ns3
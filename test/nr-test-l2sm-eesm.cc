@@ -23,14 +23,17 @@
 #include <ns3/nr-eesm-cc-t2.h>
 #include <ns3/nr-eesm-ir-t1.h>
 #include <ns3/nr-eesm-ir-t2.h>
+#include <ns3/nr-spectrum-value-helper.h>
 /**
  * \file nr-test-l2sm-eesm.cc
  * \ingroup test
  *
  * \brief This test validates specific functions of the NR PHY abstraction model.
- * The test checks two issues: 1) LDPC base graph (BG) selection works properly, and 2)
+ * The test checks four issues: 1) LDPC base graph (BG) selection works properly, 2)
  * BLER values are properly obtained from the BLER-SINR look up tables for different
- * block sizes, MCS Tables, BG types, and SINR values.
+ * block sizes, MCS Tables, BG types, and SINR values, 3) the FastExp kernel
+ * of the sum of exponential SINRs is within its accuracy bound, and 4) the Fit
+ * BLER mapping is close to the simulated points of the curves.
  *
  */
 namespace ns3 {
@@ -55,6 +58,9 @@ private:
   void TestMappingSinrBler2 (const Ptr<NrEesmErrorModel> &em);
   void TestBgType1 (const Ptr<NrEesmErrorModel> &em);
   void TestBgType2 (const Ptr<NrEesmErrorModel> &em);
+  void TestSinrExpKernel (const Ptr<NrEesmErrorModel> &em);
+  void TestBlerMappingFit (const Ptr<NrEesmErrorModel> &em);
+  void TestTbSegmentation (const Ptr<NrEesmErrorModel> &em);
 
   void TestEesmCcTable1 ();
   void TestEesmCcTable2 ();
@@ -187,6 +193,87 @@ NrL2smEesmTestCase::TestMappingSinrBler2 (const Ptr<NrEesmErrorModel> &em)
     }
 
 }
+void
+NrL2smEesmTestCase::TestSinrExpKernel (const Ptr<NrEesmErrorModel> &em)
+{
+  Ptr<const SpectrumModel> sm = NrSpectrumValueHelper::GetSpectrumModel (100, 2e9, 15000);
+  SpectrumValue sinr (sm);
+  std::vector<int> map;
+
+  // SINR from -20 dB to 40 dB (linear units), leaving some RBs out of the map
+  for (uint32_t rb = 0; rb < sm->GetNumBands (); ++rb)
+    {
+      sinr[rb] = std::pow (10.0, (-20.0 + 0.6 * rb) / 10.0);
+      if (rb % 3 != 0)
+        {
+          map.push_back (rb);
+        }
+    }
+
+  for (uint8_t mcs = 0; mcs <= em->GetMaxMcs (); ++mcs)
+    {
+      em->SetSinrExpKernel (NrEesmErrorModel::EXACT_EXP);
+      double exact = em->SinrExp (sinr, map, mcs);
+      em->SetSinrExpKernel (NrEesmErrorModel::FAST_EXP);
+      double fast = em->SinrExp (sinr, map, mcs);
+
+      NS_TEST_ASSERT_MSG_EQ_TOL (fast, exact, exact * 1e-8,
+                                 "TestSinrExpKernel: FastExp out of its accuracy bound for MCS " << +mcs);
+    }
+  em->SetSinrExpKernel (NrEesmErrorModel::EXACT_EXP);
+}
+
+void
+NrL2smEesmTestCase::TestBlerMappingFit (const Ptr<NrEesmErrorModel> &em)
+{
+  em->SetBlerMapping (NrEesmErrorModel::FIT);
+  for (uint8_t mcs = 0; mcs <= em->GetMaxMcs (); ++mcs)
+    {
+      for (uint32_t cbSize : {24U, 256U, 1000U, 3840U, 8448U})
+        {
+          NrEesmErrorModel::GraphType bg = em->GetBaseGraphType (cbSize, mcs);
+          NrEesmErrorModel::BlerCurve curve = em->GetBlerTable ()->GetCurve (bg, mcs, cbSize);
+          if (curve.m_cbSize == 0)
+            {
+              continue; // no simulated curve for this MCS
+            }
+          double previous = 1.0;
+          for (uint32_t i = 0; i < curve.m_size; ++i)
+            {
+              double bler = em->MappingSinrBler (std::pow (10.0, curve.m_sinrDb[i] / 10.0), mcs, cbSize);
+              NS_TEST_ASSERT_MSG_EQ_TOL (bler, curve.m_bler[i], 0.03,
+                                         "TestBlerMappingFit: fit too far from the curve of MCS " <<
+                                         +mcs << " CBS " << curve.m_cbSize << " at SINR " <<
+                                         curve.m_sinrDb[i] << " dB");
+              NS_TEST_ASSERT_MSG_LT_OR_EQ (bler, previous, "TestBlerMappingFit: the fit is not decreasing");
+              previous = bler;
+            }
+        }
+    }
+  em->SetBlerMapping (NrEesmErrorModel::INTERPOLATION);
+}
+
+void
+NrL2smEesmTestCase::TestTbSegmentation (const Ptr<NrEesmErrorModel> &em)
+{
+  // Twice, to check both the computed and the memoized segmentations
+  for (uint32_t run = 0; run < 2; ++run)
+    {
+      for (uint8_t mcs = 0; mcs <= em->GetMaxMcs (); mcs += 3)
+        {
+          for (uint32_t sizeBit : {40U, 292U, 1000U, 3824U, 8424U, 20000U, 100000U})
+            {
+              const NrEesmErrorModel::TbSegmentation &segmentation = em->GetTbSegmentation (sizeBit, mcs);
+              NrEesmErrorModel::GraphType bg = em->GetBaseGraphType (sizeBit, mcs);
+              std::pair<uint32_t, uint32_t> cbSeg = em->CodeBlockSegmentation (sizeBit + 24, bg);
+              NS_TEST_ASSERT_MSG_EQ (segmentation.m_bgType, bg, "TestTbSegmentation: wrong BG for " << sizeBit);
+              NS_TEST_ASSERT_MSG_EQ (segmentation.m_cbSize, cbSeg.first, "TestTbSegmentation: wrong K for " << sizeBit);
+              NS_TEST_ASSERT_MSG_EQ (segmentation.m_numCb, cbSeg.second, "TestTbSegmentation: wrong C for " << sizeBit);
+            }
+        }
+    }
+}
+
 void
 NrL2smEesmTestCase::TestEesmCcTable1 ()
 {
@@ -200,6 +287,9 @@ NrL2smEesmTestCase::TestEesmCcTable1 ()
   // Test here the functions:
   TestBgType1 (em);
   TestMappingSinrBler1 (em);
+  TestTbSegmentation (em);
+  TestSinrExpKernel (em);
+  TestBlerMappingFit (em);
 }
 
 void
@@ -215,6 +305,8 @@ NrL2smEesmTestCase::TestEesmCcTable2 ()
   // Test here the functions:
   TestBgType2 (em);
   TestMappingSinrBler2 (em);
+  TestSinrExpKernel (em);
+  TestBlerMappingFit (em);
 }
 
 void
@@ -230,6 +322,7 @@ NrL2smEesmTestCase::TestEesmIrTable1 ()
   // Test here the functions:
   TestBgType1 (em);
   TestMappingSinrBler1 (em);
+  TestTbSegmentation (em);
 }
 
 void
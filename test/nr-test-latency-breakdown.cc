@@ -0,0 +1,167 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/packet.h>
+#include <ns3/simulator.h>
+#include <ns3/lte-pdcp-tag.h>
+#include <ns3/nr-latency-tag.h>
+#include <ns3/nr-latency-breakdown-stats.h>
+
+/**
+ * \file nr-test-latency-breakdown.cc
+ * \ingroup test
+ *
+ * \brief This test stamps a PDU as the MACs do, at the first transmission
+ * and at two HARQ retransmissions, and checks its latency breakdown when
+ * it is decoded, and the histograms of NrLatencyBreakdownStats.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Stamp two PDUs, one with a PDCP timestamp, and decode them
+ */
+class NrLatencyBreakdownTestCase : public TestCase
+{
+public:
+  NrLatencyBreakdownTestCase ()
+    : TestCase ("Latency breakdown of a PDU with two retransmissions")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Give the PDCP timestamp to the SDU of the first PDU
+   */
+  void Enqueue ();
+
+  /**
+   * \brief First transmission of the PDUs
+   */
+  void FirstTx ();
+
+  /**
+   * \brief Retransmission of the first PDU
+   */
+  void Retx ();
+
+  /**
+   * \brief Decode a copy of the PDUs, and check the breakdown
+   */
+  void Decode ();
+
+  Ptr<Packet> m_pdu;         //!< PDU with a PDCP timestamp
+  Ptr<Packet> m_statusPdu;   //!< PDU without a PDCP timestamp
+  Ptr<NrLatencyBreakdownStats> m_stats; //!< The stats
+};
+
+void
+NrLatencyBreakdownTestCase::Enqueue ()
+{
+  PdcpTag pdcpTag (Simulator::Now ());
+  m_pdu->AddByteTag (pdcpTag);
+}
+
+void
+NrLatencyBreakdownTestCase::FirstTx ()
+{
+  NrLatencyTag::StampFirstTx (m_pdu);
+  NrLatencyTag::StampFirstTx (m_statusPdu);
+}
+
+void
+NrLatencyBreakdownTestCase::Retx ()
+{
+  NrLatencyTag::StampRetx (m_pdu);
+}
+
+void
+NrLatencyBreakdownTestCase::Decode ()
+{
+  NrLatencyBreakdown breakdown;
+  Ptr<Packet> copy = m_pdu->Copy ();
+  NS_TEST_ASSERT_MSG_EQ (NrLatencyTag::GetBreakdown (copy, &breakdown), true, "No latency tag");
+  NS_TEST_ASSERT_MSG_EQ (breakdown.m_queue, MilliSeconds (1), "Wrong queueing time");
+  NS_TEST_ASSERT_MSG_EQ (breakdown.m_harq, MilliSeconds (4), "Wrong HARQ time");
+  NS_TEST_ASSERT_MSG_EQ (breakdown.m_air, MilliSeconds (1), "Wrong air time");
+  NS_TEST_ASSERT_MSG_EQ (breakdown.m_total, MilliSeconds (6), "Wrong total latency");
+  NS_TEST_ASSERT_MSG_EQ (+breakdown.m_numTx, 3, "Wrong number of transmissions");
+  NS_TEST_ASSERT_MSG_EQ (NrLatencyTag::GetBreakdown (copy, &breakdown), false,
+                         "The tag was not removed");
+  breakdown.m_cellId = 1;
+  breakdown.m_rnti = 2;
+  breakdown.m_lcid = 4;
+  m_stats->Add (NrLatencyBreakdownStats::DL, breakdown);
+
+  NS_TEST_ASSERT_MSG_EQ (NrLatencyTag::GetBreakdown (m_statusPdu->Copy (), &breakdown), true,
+                         "No latency tag");
+  NS_TEST_ASSERT_MSG_EQ (breakdown.m_queue, Time (0), "Queueing time without PDCP timestamp");
+  NS_TEST_ASSERT_MSG_EQ (breakdown.m_total, MilliSeconds (5), "Wrong total latency");
+  m_stats->Add (NrLatencyBreakdownStats::DL, breakdown);
+}
+
+void
+NrLatencyBreakdownTestCase::DoRun ()
+{
+  m_pdu = Create<Packet> (100);
+  m_statusPdu = Create<Packet> (10);
+  m_stats = CreateObject<NrLatencyBreakdownStats> ();
+
+  Simulator::Schedule (MilliSeconds (0), &NrLatencyBreakdownTestCase::Enqueue, this);
+  Simulator::Schedule (MilliSeconds (1), &NrLatencyBreakdownTestCase::FirstTx, this);
+  Simulator::Schedule (MilliSeconds (3), &NrLatencyBreakdownTestCase::Retx, this);
+  Simulator::Schedule (MilliSeconds (5), &NrLatencyBreakdownTestCase::Retx, this);
+  Simulator::Schedule (MilliSeconds (6), &NrLatencyBreakdownTestCase::Decode, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  const NrLatencyBreakdownStats::Bearer *bearer = m_stats->GetBearer (1, 2, 4, NrLatencyBreakdownStats::DL);
+  NS_TEST_ASSERT_MSG_EQ ((bearer != nullptr), true, "No latencies for the bearer");
+  NS_TEST_ASSERT_MSG_EQ (bearer->m_pdus, 2, "Wrong number of PDUs");
+  NS_TEST_ASSERT_MSG_EQ (bearer->m_harqPdus, 1, "Wrong number of retransmitted PDUs");
+  const auto &total = bearer->m_histograms.at (NrLatencyBreakdownStats::TOTAL);
+  NS_TEST_ASSERT_MSG_EQ (total.m_max, MilliSeconds (6), "Wrong maximum latency");
+  // 125 us bins: 5 ms is in the bin 40, with the upper edge 5.125 ms
+  NS_TEST_ASSERT_MSG_EQ (m_stats->GetPercentile (total, 0.5), MicroSeconds (5125),
+                         "Wrong median latency");
+  NS_TEST_ASSERT_MSG_EQ (m_stats->GetPercentile (total, 0.99), MicroSeconds (6125),
+                         "Wrong 99th percentile of the latency");
+
+  m_stats->Dispose ();
+}
+
+/**
+ * \ingroup test
+ * \brief The latency breakdown test suite
+ */
+class NrTestLatencyBreakdown : public TestSuite
+{
+public:
+  NrTestLatencyBreakdown () : TestSuite ("nr-test-latency-breakdown", UNIT)
+  {
+    AddTestCase (new NrLatencyBreakdownTestCase, QUICK);
+  }
+};
+
+static NrTestLatencyBreakdown NrTestLatencyBreakdownSuite; //!< Latency breakdown test suite
+
+}  // namespace ns3
@@ -0,0 +1,204 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-mac-scheduler-lcg.h>
+#include <algorithm>
+
+/**
+ * \file nr-test-lcg.cc
+ * \ingroup test
+ *
+ * \brief This test checks that the total size and the list of the active LC
+ * that NrMacSchedulerLCG keeps updated are the same as the ones computed
+ * from all its LC, after RLC updates, BSRs and assignments of data, and
+ * that the earliest deadline is the one of the active LC with the oldest
+ * head of line data.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Update the LC of a LCG and check its total size and active LC
+ */
+class NrLcgTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrLcgTestCase ()
+    : TestCase ("LCG running total size and active LC")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Check the LCG against the sizes of all its LC
+   * \param lcg the LCG
+   * \param when description of the step, for the messages
+   */
+  void Check (const NrMacSchedulerLCG &lcg, const std::string &when);
+};
+
+void
+NrLcgTestCase::Check (const NrMacSchedulerLCG &lcg, const std::string &when)
+{
+  std::vector<uint8_t> lcIds = lcg.GetLCId ();
+  std::sort (lcIds.begin (), lcIds.end ());
+
+  uint32_t totalSize = 0;
+  std::vector<uint8_t> active;
+  for (uint8_t lcId : lcIds)
+    {
+      totalSize += lcg.GetTotalSizeOfLC (lcId);
+      if (lcg.GetTotalSizeOfLC (lcId) > 0)
+        {
+          active.push_back (lcId);
+        }
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetTotalSize (), totalSize, "Wrong total size " << when);
+  NS_TEST_ASSERT_MSG_EQ ((lcg.GetActiveLCId () == active), true, "Wrong active LC " << when);
+}
+
+void
+NrLcgTestCase::DoRun ()
+{
+  // Eight bearers in the same LCG, as in a UE with mixed traffic: LC 10 is
+  // delay critical (QCI 85, delay budget of 5 ms)
+  NrMacSchedulerLCG lcg (1);
+  for (uint8_t lcId = 3; lcId < 11; ++lcId)
+    {
+      LogicalChannelConfigListElement_s conf;
+      conf.m_logicalChannelIdentity = lcId;
+      conf.m_logicalChannelGroup = 1;
+      conf.m_direction = LogicalChannelConfigListElement_s::DIR_DL;
+      conf.m_qosBearerType = LogicalChannelConfigListElement_s::QBT_NON_GBR;
+      conf.m_qci = lcId == 10 ? 85 : 9;
+      lcg.Insert (std::unique_ptr<NrMacSchedulerLC> (new NrMacSchedulerLC (conf)));
+    }
+  Check (lcg, "after the insertion");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetActiveLCId ().empty (), true, "An LC without data is active");
+
+  // Only some LC have data, reported in any order
+  for (uint8_t lcId : {9, 4, 7})
+    {
+      NrMacSchedSapProvider::SchedDlRlcBufferReqParameters params;
+      params.m_rnti = 1;
+      params.m_logicalChannelIdentity = lcId;
+      params.m_rlcTransmissionQueueSize = 1000u * lcId;
+      params.m_rlcTransmissionQueueHolDelay = lcId;
+      params.m_rlcRetransmissionQueueSize = lcId == 4 ? 300 : 0;
+      params.m_rlcRetransmissionHolDelay = 0;
+      params.m_rlcStatusPduSize = lcId == 7 ? 20 : 0;
+      lcg.UpdateInfo (params);
+    }
+  Check (lcg, "after the RLC updates");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetActiveLCId ().size (), 3U, "Wrong number of active LC");
+
+  // QCI 9 has a delay budget of 300 ms, and LC 9 has the oldest data
+  Time delayBudget;
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetEarliestDeadline (&delayBudget), MilliSeconds (300 - 9), "Wrong earliest deadline");
+  NS_TEST_ASSERT_MSG_EQ (delayBudget, MilliSeconds (300), "Wrong delay budget");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetTotalSizeWithin (MilliSeconds (10)), 0U, "No delay critical LC has data");
+
+  // Only the data of LC 10 is within a delay budget of 10 ms
+  NrMacSchedSapProvider::SchedDlRlcBufferReqParameters critical;
+  critical.m_rnti = 1;
+  critical.m_logicalChannelIdentity = 10;
+  critical.m_rlcTransmissionQueueSize = 200;
+  critical.m_rlcTransmissionQueueHolDelay = 0;
+  critical.m_rlcRetransmissionQueueSize = 0;
+  critical.m_rlcRetransmissionHolDelay = 0;
+  critical.m_rlcStatusPduSize = 0;
+  lcg.UpdateInfo (critical);
+  Check (lcg, "after the delay critical update");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetTotalSizeWithin (MilliSeconds (10)), 200U, "Wrong size within 10 ms");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetTotalSizeWithin (MilliSeconds (300)), lcg.GetTotalSize (), "Wrong size within 300 ms");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetEarliestDeadline (), MilliSeconds (5), "Wrong earliest deadline");
+  lcg.AssignedData (10, 200, "DL");
+  Check (lcg, "after the delay critical transmission");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetTotalSizeWithin (MilliSeconds (10)), 0U, "The delay critical LC is not empty");
+
+  // The STATUS PDU of LC 7, the retransmission of LC 4, part of the queue of LC 9
+  lcg.AssignedData (7, 20, "DL");
+  Check (lcg, "after the STATUS PDU");
+  lcg.AssignedData (4, 300, "DL");
+  Check (lcg, "after the retransmission");
+  lcg.AssignedData (9, 5000, "DL");
+  Check (lcg, "after a partial transmission");
+
+  // Empty LC 4 and LC 7: only LC 9 stays active
+  lcg.AssignedData (4, 5000, "DL");
+  lcg.AssignedData (7, 8000, "DL");
+  Check (lcg, "after emptying two LC");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetActiveLCId ().size (), 1U, "Wrong number of active LC");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetEarliestDeadline (), MilliSeconds (300 - 9), "Wrong earliest deadline");
+
+  // An RLC update that empties the last LC
+  NrMacSchedSapProvider::SchedDlRlcBufferReqParameters params;
+  params.m_rnti = 1;
+  params.m_logicalChannelIdentity = 9;
+  params.m_rlcTransmissionQueueSize = 0;
+  params.m_rlcTransmissionQueueHolDelay = 0;
+  params.m_rlcRetransmissionQueueSize = 0;
+  params.m_rlcRetransmissionHolDelay = 0;
+  params.m_rlcStatusPduSize = 0;
+  lcg.UpdateInfo (params);
+  Check (lcg, "after emptying all the LC");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetTotalSize (), 0U, "The LCG is not empty");
+  NS_TEST_ASSERT_MSG_EQ (lcg.GetEarliestDeadline (), Time::Max (), "An empty LCG has a deadline");
+
+  // UL: one LC per LCG, updated with the BSR
+  NrMacSchedulerLCG ulLcg (2);
+  LogicalChannelConfigListElement_s conf;
+  conf.m_logicalChannelIdentity = 3;
+  conf.m_logicalChannelGroup = 2;
+  conf.m_direction = LogicalChannelConfigListElement_s::DIR_UL;
+  conf.m_qosBearerType = LogicalChannelConfigListElement_s::QBT_NON_GBR;
+  conf.m_qci = 9;
+  ulLcg.Insert (std::unique_ptr<NrMacSchedulerLC> (new NrMacSchedulerLC (conf)));
+  ulLcg.UpdateInfo (1500);
+  Check (ulLcg, "after a BSR");
+  NS_TEST_ASSERT_MSG_EQ (ulLcg.GetEarliestDeadline (), MilliSeconds (300), "Wrong UL deadline");
+  ulLcg.AssignedData (3, 600, "UL");
+  Check (ulLcg, "after an UL assignment");
+  ulLcg.UpdateInfo (0);
+  Check (ulLcg, "after an empty BSR");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrMacSchedulerLCG test suite
+ */
+class NrTestLcg : public TestSuite
+{
+public:
+  NrTestLcg () : TestSuite ("nr-test-lcg", UNIT)
+  {
+    AddTestCase (new NrLcgTestCase (), QUICK);
+  }
+};
+
+static NrTestLcg NrTestLcgSuite; //!< NrMacSchedulerLCG test suite
+
+}  // namespace ns3
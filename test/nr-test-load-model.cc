@@ -0,0 +1,172 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/nr-module.h>
+#include <ns3/nr-load-model-net-device.h>
+#include <ns3/nr-load-model-phy.h>
+#include <set>
+
+/**
+ * \file nr-test-load-model.cc
+ * \ingroup test
+ *
+ * \brief This test installs an interference-only gNB with NrHelper, and
+ * checks the slots it transmits: none in the UL slots of its pattern, the
+ * number of RBs of the FREQUENCY load mode, the fraction of slots of the
+ * TIME load mode, and the beams of the FIXED and RANDOM patterns.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the transmissions of a NrLoadModelPhy
+ */
+class NrLoadModelTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param name the name of the test
+   * \param loadMode the LoadMode attribute
+   * \param beamPattern the BeamPattern attribute
+   * \param pattern the TDD pattern
+   */
+  NrLoadModelTestCase (const std::string &name, const std::string &loadMode,
+                       const std::string &beamPattern, const std::string &pattern)
+    : TestCase (name),
+      m_loadMode (loadMode),
+      m_beamPattern (beamPattern),
+      m_pattern (pattern)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Record a transmission
+   * \param numRbs the number of active RBs
+   * \param beam the beam
+   */
+  void Tx (uint32_t numRbs, uint32_t beam);
+
+  std::string m_loadMode;     //!< The LoadMode attribute
+  std::string m_beamPattern;  //!< The BeamPattern attribute
+  std::string m_pattern;      //!< The TDD pattern
+  std::vector<uint32_t> m_rbs; //!< The RBs of each transmission
+  std::set<uint32_t> m_beams; //!< The beams used
+};
+
+void
+NrLoadModelTestCase::Tx (uint32_t numRbs, uint32_t beam)
+{
+  m_rbs.push_back (numRbs);
+  m_beams.insert (beam);
+}
+
+void
+NrLoadModelTestCase::DoRun ()
+{
+  const double loadFactor = 0.25;
+  const uint32_t numSlots = 400;
+
+  NodeContainer nodes;
+  nodes.Create (1);
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (nodes);
+
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (3.5e9, 20e6, 1, BandwidthPartInfo::UMa_LoS);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  nrHelper->SetLoadModelPhyAttribute ("LoadFactor", DoubleValue (loadFactor));
+  nrHelper->SetLoadModelPhyAttribute ("LoadMode", StringValue (m_loadMode));
+  nrHelper->SetLoadModelPhyAttribute ("BeamPattern", StringValue (m_beamPattern));
+  nrHelper->SetLoadModelPhyAttribute ("Pattern", StringValue (m_pattern));
+  NetDeviceContainer devices = nrHelper->InstallLoadModelDevice (nodes, allBwps);
+  nrHelper->AssignStreams (devices, 1);
+
+  Ptr<NrLoadModelNetDevice> device = DynamicCast<NrLoadModelNetDevice> (devices.Get (0));
+  NS_TEST_ASSERT_MSG_EQ ((device != nullptr), true, "No load model device");
+  NS_TEST_ASSERT_MSG_EQ (device->GetNumPhys (), 1, "One PHY per BWP expected");
+  Ptr<NrLoadModelPhy> phy = device->GetPhy (0);
+  phy->TraceConnectWithoutContext ("Tx", MakeCallback (&NrLoadModelTestCase::Tx, this));
+
+  Simulator::Stop (MilliSeconds (numSlots) - NanoSeconds (1));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // The TDD pattern alternates DL and UL slots
+  uint32_t numTxSlots = m_pattern.find ("UL") != std::string::npos ? numSlots / 2 : numSlots;
+
+  if (m_loadMode == "Frequency")
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_rbs.size (), numTxSlots, "Wrong number of transmitted slots");
+      uint32_t expectedRbs = static_cast<uint32_t> (std::round (loadFactor * phy->GetRbNum ()));
+      for (uint32_t rbs : m_rbs)
+        {
+          NS_TEST_ASSERT_MSG_EQ (rbs, expectedRbs, "Wrong number of RBs");
+        }
+    }
+  else
+    {
+      NS_TEST_ASSERT_MSG_EQ_TOL (static_cast<double> (m_rbs.size ()) / numTxSlots, loadFactor, 0.07,
+                                 "Wrong fraction of transmitted slots");
+      for (uint32_t rbs : m_rbs)
+        {
+          NS_TEST_ASSERT_MSG_EQ (rbs, phy->GetRbNum (), "Not all the RBs are used");
+        }
+    }
+
+  if (m_beamPattern == "Fixed")
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_beams.size (), 1, "More than one beam");
+    }
+  else
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_beams.size (), 8, "Not all the beams are used");
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The interference-only gNB test suite
+ */
+class NrTestLoadModel : public TestSuite
+{
+public:
+  NrTestLoadModel () : TestSuite ("nr-test-load-model", UNIT)
+  {
+    AddTestCase (new NrLoadModelTestCase ("Frequency load, fixed beam, TDD", "Frequency", "Fixed",
+                                          "DL|UL|DL|UL|DL|UL|DL|UL|DL|UL|"), QUICK);
+    AddTestCase (new NrLoadModelTestCase ("Time load, random beams, FDD", "Time", "Random",
+                                          "F|F|F|F|F|F|F|F|F|F|"), QUICK);
+  }
+};
+
+static NrTestLoadModel NrTestLoadModelSuite; //!< Interference-only gNB test suite
+
+}  // namespace ns3
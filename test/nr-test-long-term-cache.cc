@@ -0,0 +1,161 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/node.h>
+#include <ns3/double.h>
+#include <ns3/string.h>
+#include <ns3/pointer.h>
+#include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <ns3/constant-velocity-mobility-model.h>
+#include <ns3/uniform-planar-array.h>
+#include <ns3/channel-condition-model.h>
+#include <ns3/cached-three-gpp-spectrum-propagation-loss-model.h>
+#include <ns3/nr-spectrum-value-helper.h>
+
+/**
+ * \file nr-test-long-term-cache.cc
+ * \ingroup test
+ *
+ * \brief This test checks that CachedThreeGppSpectrumPropagationLossModel
+ * gives the same received PSD as ThreeGppSpectrumPropagationLossModel when
+ * a gNB alternates between beams and the UE moves, and that it computes
+ * the long term component of each pair of beams only once.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Compare the received PSDs of the cached and of the original model
+ */
+class NrLongTermCacheTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrLongTermCacheTestCase ()
+    : TestCase ("Long term component cache")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Create a spectrum propagation loss model
+   * \param model the model to configure
+   */
+  void Configure (Ptr<ThreeGppSpectrumPropagationLossModel> model);
+};
+
+void
+NrLongTermCacheTestCase::Configure (Ptr<ThreeGppSpectrumPropagationLossModel> model)
+{
+  model->SetChannelModelAttribute ("Frequency", DoubleValue (28e9));
+  model->SetChannelModelAttribute ("Scenario", StringValue ("UMa"));
+  model->SetChannelModelAttribute ("ChannelConditionModel", PointerValue (CreateObject<AlwaysLosChannelConditionModel> ()));
+  model->AssignStreams (1);
+}
+
+void
+NrLongTermCacheTestCase::DoRun ()
+{
+  std::vector<Ptr<MobilityModel>> mobility;
+  std::vector<Ptr<PhasedArrayModel>> antennas;
+  for (uint32_t i = 0; i < 2; ++i)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<ConstantVelocityMobilityModel> mob = CreateObject<ConstantVelocityMobilityModel> ();
+      mob->SetPosition (i == 0 ? Vector (0, 0, 25) : Vector (100, 30, 1.5));
+      mob->SetVelocity (i == 0 ? Vector (0, 0, 0) : Vector (-8, 12, 0));
+      node->AggregateObject (mob);
+      mobility.push_back (mob);
+      antennas.push_back (CreateObjectWithAttributes<UniformPlanarArray> ("NumColumns", UintegerValue (i == 0 ? 4 : 2),
+                                                                         "NumRows", UintegerValue (2)));
+    }
+
+  // Three beams of the gNB, a fixed beam of the UE
+  std::vector<PhasedArrayModel::ComplexVector> gnbBeams;
+  for (double phase : {0.0, 0.7, 1.9})
+    {
+      PhasedArrayModel::ComplexVector beam;
+      for (uint64_t i = 0; i < antennas[0]->GetNumberOfElements (); ++i)
+        {
+          beam.push_back (std::polar (1.0 / std::sqrt (antennas[0]->GetNumberOfElements ()), phase * i));
+        }
+      gnbBeams.push_back (beam);
+    }
+  antennas[1]->SetBeamformingVector (PhasedArrayModel::ComplexVector (antennas[1]->GetNumberOfElements (),
+                                                                      1.0 / std::sqrt (antennas[1]->GetNumberOfElements ())));
+
+  Ptr<ThreeGppSpectrumPropagationLossModel> original = CreateObject<ThreeGppSpectrumPropagationLossModel> ();
+  Configure (original);
+  Ptr<CachedThreeGppSpectrumPropagationLossModel> cached = CreateObject<CachedThreeGppSpectrumPropagationLossModel> ();
+  cached->SetLongTermCacheSize (2);
+  Configure (cached);
+
+  Ptr<const SpectrumModel> sm = NrSpectrumValueHelper::GetSpectrumModel (20, 28e9, 120e3);
+  Ptr<SpectrumValue> txPsd = Create<SpectrumValue> (sm);
+  *txPsd = 1e-9;
+
+  // With two entries, the beams 0 and 1 stay in the cache, the beam 2 evicts
+  // the least recently used one. One reception per ms, for the Doppler.
+  std::vector<uint32_t> sequence {0, 1, 0, 1, 1, 0, 2, 0, 1};
+  auto receive = [&] (uint32_t beam)
+    {
+      antennas[0]->SetBeamformingVector (gnbBeams[beam]);
+      // the two models have their own channel model, with the same streams
+      Ptr<SpectrumValue> expected = original->DoCalcRxPowerSpectralDensity (txPsd, mobility[0], mobility[1], antennas[0], antennas[1]);
+      Ptr<SpectrumValue> rxPsd = cached->DoCalcRxPowerSpectralDensity (txPsd, mobility[0], mobility[1], antennas[0], antennas[1]);
+      for (size_t i = 0; i < sm->GetNumBands (); ++i)
+        {
+          NS_TEST_ASSERT_MSG_EQ_TOL ((*rxPsd)[i], (*expected)[i], (*expected)[i] * 1e-12,
+                                     "Wrong rx PSD in band " << i << " with beam " << beam);
+        }
+    };
+  for (uint32_t step = 0; step < sequence.size (); ++step)
+    {
+      Simulator::Schedule (MilliSeconds (step), receive, sequence[step]);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // Misses: 0, 1, 2 (evicts 1), 1 (evicts 2)
+  NS_TEST_ASSERT_MSG_EQ (cached->GetLongTermCacheMisses (), 4U, "Wrong number of long term components computed");
+  NS_TEST_ASSERT_MSG_EQ (cached->GetLongTermCacheHits (), sequence.size () - 4, "Wrong number of cache hits");
+}
+
+/**
+ * \ingroup test
+ * \brief The CachedThreeGppSpectrumPropagationLossModel test suite
+ */
+class NrTestLongTermCache : public TestSuite
+{
+public:
+  NrTestLongTermCache () : TestSuite ("nr-test-long-term-cache", UNIT)
+  {
+    AddTestCase (new NrLongTermCacheTestCase (), QUICK);
+  }
+};
+
+static NrTestLongTermCache NrTestLongTermCacheSuite; //!< CachedThreeGppSpectrumPropagationLossModel test suite
+
+}  // namespace ns3
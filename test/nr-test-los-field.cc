@@ -0,0 +1,128 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/nr-los-field-channel-condition-model.h>
+#include <ns3/string.h>
+#include <cmath>
+
+/**
+ * \file nr-test-los-field.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrLosFieldChannelConditionModel gives the
+ * same condition in both directions of a link and to two models with the
+ * same configuration, that close UEs mostly share their condition, and
+ * that the store of the fields is emptied by Simulator::Destroy.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Query the LOS field of a site at the points of a grid
+ */
+class NrLosFieldTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrLosFieldTestCase ()
+    : TestCase ("Spatially consistent LOS condition")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrLosFieldTestCase::DoRun ()
+{
+  double pLos = NrLosFieldChannelConditionModel::GetLosProbability ("UMi-StreetCanyon", 100.0, 1.5);
+  NS_TEST_ASSERT_MSG_EQ_TOL (pLos, 0.18 + std::exp (-100.0 / 36.0) * 0.82, 1e-9, "Wrong UMi LOS probability");
+  NS_TEST_ASSERT_MSG_EQ (NrLosFieldChannelConditionModel::GetLosProbability ("UMa", 10.0, 1.5), 1.0,
+                         "Wrong UMa LOS probability");
+
+  Ptr<NrLosFieldChannelConditionModel> model = CreateObject<NrLosFieldChannelConditionModel> ();
+  model->SetAttribute ("Scenario", StringValue ("UMi-StreetCanyon"));
+  model->AssignStreams (1);
+  Ptr<NrLosFieldChannelConditionModel> copy = CreateObject<NrLosFieldChannelConditionModel> ();
+  copy->SetAttribute ("Scenario", StringValue ("UMi-StreetCanyon"));
+  copy->AssignStreams (2);
+
+  Ptr<ConstantPositionMobilityModel> gnb = CreateObject<ConstantPositionMobilityModel> ();
+  gnb->SetPosition (Vector (0.0, 0.0, 10.0));
+  Ptr<ConstantPositionMobilityModel> ue = CreateObject<ConstantPositionMobilityModel> ();
+
+  uint32_t numPoints = 0;
+  uint32_t numLos = 0;
+  uint32_t numChanges = 0;
+  bool previousLos = false;
+  for (double y = -400.0; y <= 400.0; y += 20.0)
+    {
+      for (double x = -400.0; x <= 400.0; x += 1.0)
+        {
+          ue->SetPosition (Vector (x, y, 1.5));
+          bool los = model->GetChannelCondition (gnb, ue)->GetLosCondition () == ChannelCondition::LOS;
+          NS_TEST_ASSERT_MSG_EQ (model->GetChannelCondition (ue, gnb)->GetLosCondition () == ChannelCondition::LOS, los,
+                                 "Different condition in the two directions at " << ue->GetPosition ());
+          NS_TEST_ASSERT_MSG_EQ (copy->GetChannelCondition (gnb, ue)->GetLosCondition () == ChannelCondition::LOS, los,
+                                 "Different condition for the copy at " << ue->GetPosition ());
+          if (std::hypot (x, y) <= 18.0)
+            {
+              NS_TEST_ASSERT_MSG_EQ (los, true, "NLOS below the breakpoint at " << ue->GetPosition ());
+            }
+          if (x > -400.0 && los != previousLos)
+            {
+              ++numChanges;
+            }
+          previousLos = los;
+          numLos += los ? 1 : 0;
+          ++numPoints;
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (NrLosFieldChannelConditionModel::GetNumFields (), 1U, "The field is not shared");
+  NS_TEST_ASSERT_MSG_GT (numLos, 0U, "No LOS point");
+  NS_TEST_ASSERT_MSG_LT (numLos, numPoints, "No NLOS point");
+  // the correlation distance is 50 m: UEs 1 m apart rarely differ
+  NS_TEST_ASSERT_MSG_LT (numChanges, numPoints / 10, "The condition is not spatially consistent");
+
+  Simulator::Destroy ();
+  NS_TEST_ASSERT_MSG_EQ (NrLosFieldChannelConditionModel::GetNumFields (), 0U, "The fields were not released");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrLosFieldChannelConditionModel test suite
+ */
+class NrTestLosField : public TestSuite
+{
+public:
+  NrTestLosField () : TestSuite ("nr-test-los-field", UNIT)
+  {
+    AddTestCase (new NrLosFieldTestCase (), QUICK);
+  }
+};
+
+static NrTestLosField NrTestLosFieldSuite; //!< NrLosFieldChannelConditionModel test suite
+
+}  // namespace ns3
@@ -0,0 +1,306 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/string.h>
+#include <ns3/enum.h>
+#include <ns3/nr-mac-scheduling-stats.h>
+#include <fstream>
+#include <sstream>
+#include <set>
+
+/**
+ * \file nr-test-mac-stats-aggregated.cc
+ * \ingroup test
+ *
+ * \brief This test checks the aggregated mode of NrMacSchedulingStats: with
+ * the mode Both, the per-slot totals and the per-UE summaries must match
+ * the sums of the per-allocation records written for the same allocations,
+ * and the throughput of a summary must be its bytes over SummaryInterval.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Compare the aggregated outputs of NrMacSchedulingStats with its
+ * per-allocation records
+ */
+class NrMacStatsAggregatedTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrMacStatsAggregatedTestCase ()
+    : TestCase ("Aggregated scheduling statistics against the per-allocation records")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Totals of a slot or of a UE
+   */
+  struct Totals
+  {
+    uint32_t m_allocations {0}; //!< Allocations
+    uint32_t m_rbgs {0};        //!< RBGs
+    uint64_t m_bytes {0};       //!< Bytes
+    uint64_t m_mcsSum {0};      //!< Sum of the MCS
+    uint32_t m_newTbs {0};      //!< New TBs
+    uint32_t m_harqTbs {0};     //!< HARQ retransmitted TBs
+    std::set<uint16_t> m_rntis; //!< UEs
+  };
+
+  /**
+   * \brief Notify the allocations of a slot, in both directions
+   * \param slot the slot, which is also its time in ms (numerology 0)
+   */
+  void NotifySlot (uint16_t slot);
+
+  /**
+   * \brief Read the data lines of a statistics file
+   * \param fileName the file
+   * \return the lines, without the header
+   */
+  static std::vector<std::string> ReadLines (const std::string &fileName);
+
+  Ptr<NrMacSchedulingStats> m_macStats; //!< The statistics
+  const uint16_t m_cellId {1};          //!< The cell
+  const uint16_t m_numUes {4};          //!< UEs, with RNTI 1 to 4 and IMSI RNTI + 100
+  const uint16_t m_numSlots {30};       //!< Slots with allocations
+  const Time m_summaryInterval {MilliSeconds (10)}; //!< SummaryInterval
+  std::map<std::tuple<std::string, uint16_t, uint8_t>, uint32_t> m_slotRbgs; //!< RBGs notified per direction, frame, subframe
+  std::map<std::pair<std::string, uint64_t>, uint32_t> m_ueRbgs; //!< RBGs notified per direction and IMSI
+};
+
+void
+NrMacStatsAggregatedTestCase::NotifySlot (uint16_t slot)
+{
+  for (bool isDl : {true, false})
+    {
+      for (uint16_t rnti = 1; rnti <= m_numUes; ++rnti)
+        {
+          // Not all the UEs in all the slots, fewer in UL, and two streams for some
+          if ((slot + rnti) % (isDl ? 3 : 4) == 0)
+            {
+              continue;
+            }
+          for (uint8_t stream = 0; stream < ((slot * rnti) % 5 == 0 ? 2 : 1); ++stream)
+            {
+              NrSchedulingCallbackInfo info;
+              info.m_frameNum = slot / 10;
+              info.m_subframeNum = static_cast<uint8_t> (slot % 10);
+              info.m_slotNum = 0;
+              info.m_symStart = static_cast<uint8_t> (1 + rnti);
+              info.m_numSym = 1;
+              info.m_streamId = stream;
+              info.m_rnti = rnti;
+              info.m_mcs = static_cast<uint8_t> ((slot * 7 + rnti * 3) % 28);
+              // A stream without TB is not an allocation
+              info.m_tbSize = (slot + rnti + stream) % 7 == 0 ? 0 : 100u * (rnti + slot % 3);
+              info.m_bwpId = 0;
+              info.m_ndi = (slot + rnti) % 4 == 1 ? 0 : 1;
+              info.m_rv = info.m_ndi == 1 ? 0 : 1;
+              info.m_harqId = static_cast<uint8_t> (slot % 16);
+              info.m_numRbg = static_cast<uint16_t> (1 + (slot + rnti) % 5);
+
+              uint64_t imsi = rnti + 100;
+              std::string direction = isDl ? "DL" : "UL";
+              if (info.m_tbSize > 0)
+                {
+                  m_slotRbgs[std::make_tuple (direction, info.m_frameNum, info.m_subframeNum)] += info.m_numRbg;
+                  m_ueRbgs[std::make_pair (direction, imsi)] += info.m_numRbg;
+                }
+              if (isDl)
+                {
+                  m_macStats->DlScheduling (m_cellId, imsi, info);
+                }
+              else
+                {
+                  m_macStats->UlScheduling (m_cellId, imsi, info);
+                }
+            }
+        }
+    }
+}
+
+std::vector<std::string>
+NrMacStatsAggregatedTestCase::ReadLines (const std::string &fileName)
+{
+  std::vector<std::string> lines;
+  std::ifstream file (fileName);
+  std::string line;
+  while (std::getline (file, line))
+    {
+      if (!line.empty () && line[0] != '%')
+        {
+          lines.push_back (line);
+        }
+    }
+  return lines;
+}
+
+void
+NrMacStatsAggregatedTestCase::DoRun ()
+{
+  std::string dlFileName = CreateTempDirFilename ("nr-test-mac-stats-dl.txt");
+  std::string ulFileName = CreateTempDirFilename ("nr-test-mac-stats-ul.txt");
+  std::string slotFileName = CreateTempDirFilename ("nr-test-mac-stats-slot.txt");
+  std::string ueFileName = CreateTempDirFilename ("nr-test-mac-stats-ue.txt");
+  m_macStats = CreateObject<NrMacSchedulingStats> ();
+  m_macStats->SetAttribute ("DlOutputFilename", StringValue (dlFileName));
+  m_macStats->SetAttribute ("UlOutputFilename", StringValue (ulFileName));
+  m_macStats->SetAttribute ("SlotOutputFilename", StringValue (slotFileName));
+  m_macStats->SetAttribute ("UeOutputFilename", StringValue (ueFileName));
+  m_macStats->SetAttribute ("Mode", EnumValue (NrMacSchedulingStats::BOTH));
+  m_macStats->SetAttribute ("SummaryInterval", TimeValue (m_summaryInterval));
+
+  for (uint16_t slot = 0; slot < m_numSlots; ++slot)
+    {
+      Simulator::Schedule (MilliSeconds (slot), &NrMacStatsAggregatedTestCase::NotifySlot, this, slot);
+    }
+  // The summaries run forever: the last one is written at the destroy
+  Simulator::Stop (MilliSeconds (m_numSlots + 5));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  m_macStats->Dispose ();
+  m_macStats = nullptr;
+
+  // The expected totals, from the per-allocation records with a TB
+  std::map<std::tuple<std::string, uint16_t, uint8_t>, Totals> slotExpected;
+  std::map<std::pair<std::string, uint64_t>, Totals> ueExpected;
+  for (const std::string direction : {"DL", "UL"})
+    {
+      for (const std::string &line : ReadLines (direction == "DL" ? dlFileName : ulFileName))
+        {
+          std::istringstream fields (line);
+          double time;
+          uint32_t cellId, bwpId, frame, subframe, slot, symStart, numSym, stream, harqId, ndi, rv, mcs, tbSize;
+          uint64_t imsi;
+          uint16_t rnti;
+          fields >> time >> cellId >> bwpId >> imsi >> rnti >> frame >> subframe >> slot >> symStart
+                 >> numSym >> stream >> harqId >> ndi >> rv >> mcs >> tbSize;
+          if (tbSize == 0)
+            {
+              continue;
+            }
+          auto slotKey = std::make_tuple (direction, static_cast<uint16_t> (frame), static_cast<uint8_t> (subframe));
+          for (Totals *totals : {&slotExpected[slotKey],
+                                 &ueExpected[std::make_pair (direction, imsi)]})
+            {
+              ++totals->m_allocations;
+              totals->m_bytes += tbSize;
+              totals->m_mcsSum += mcs;
+              totals->m_newTbs += ndi == 1 ? 1 : 0;
+              totals->m_harqTbs += ndi == 1 ? 0 : 1;
+              totals->m_rntis.insert (rnti);
+            }
+        }
+    }
+  NS_TEST_ASSERT_MSG_GT (slotExpected.size (), m_numSlots, "Too few per-allocation records");
+
+  // One line per slot and direction, with the totals of its records
+  std::vector<std::string> slotLines = ReadLines (slotFileName);
+  NS_TEST_ASSERT_MSG_EQ (slotLines.size (), slotExpected.size (), "Wrong number of slot lines");
+  for (const std::string &line : slotLines)
+    {
+      std::istringstream fields (line);
+      double time, meanMcs;
+      std::string direction;
+      uint32_t cellId, bwpId, frame, subframe, slot, numUe, numAlloc, numRbg, newTb, harqTb;
+      uint64_t bytes;
+      fields >> time >> cellId >> bwpId >> direction >> frame >> subframe >> slot >> numUe
+             >> numAlloc >> numRbg >> bytes >> meanMcs >> newTb >> harqTb;
+      auto key = std::make_tuple (direction, static_cast<uint16_t> (frame), static_cast<uint8_t> (subframe));
+      auto it = slotExpected.find (key);
+      NS_TEST_ASSERT_MSG_EQ ((it != slotExpected.end ()), true, "Slot line without records: " << line);
+      const Totals &expected = it->second;
+      NS_TEST_ASSERT_MSG_EQ_TOL (time, (frame * 10 + subframe) / 1000.0, 1e-9, "Wrong time: " << line);
+      NS_TEST_ASSERT_MSG_EQ (numUe, expected.m_rntis.size (), "Wrong number of UEs: " << line);
+      NS_TEST_ASSERT_MSG_EQ (numAlloc, expected.m_allocations, "Wrong number of allocations: " << line);
+      NS_TEST_ASSERT_MSG_EQ (numRbg, m_slotRbgs.at (key), "Wrong number of RBGs: " << line);
+      NS_TEST_ASSERT_MSG_EQ (bytes, expected.m_bytes, "Wrong bytes: " << line);
+      NS_TEST_ASSERT_MSG_EQ_TOL (meanMcs, static_cast<double> (expected.m_mcsSum) / expected.m_allocations,
+                                 1e-3, "Wrong mean MCS: " << line);
+      NS_TEST_ASSERT_MSG_EQ (newTb, expected.m_newTbs, "Wrong new TBs: " << line);
+      NS_TEST_ASSERT_MSG_EQ (harqTb, expected.m_harqTbs, "Wrong HARQ TBs: " << line);
+      slotExpected.erase (it);
+    }
+
+  // The summaries of a UE add up to its records
+  std::map<std::pair<std::string, uint64_t>, Totals> ueSummed;
+  for (const std::string &line : ReadLines (ueFileName))
+    {
+      std::istringstream fields (line);
+      double time, meanMcs, throughput;
+      std::string direction;
+      uint32_t cellId, bwpId, numAlloc, numRbg, newTb, harqTb;
+      uint64_t imsi, bytes;
+      uint16_t rnti;
+      fields >> time >> cellId >> bwpId >> direction >> imsi >> rnti >> numAlloc >> numRbg
+             >> bytes >> meanMcs >> newTb >> harqTb >> throughput;
+      NS_TEST_ASSERT_MSG_EQ (imsi, rnti + 100U, "Wrong IMSI of the RNTI: " << line);
+      Totals &summed = ueSummed[std::make_pair (direction, imsi)];
+      summed.m_allocations += numAlloc;
+      summed.m_rbgs += numRbg;
+      summed.m_bytes += bytes;
+      summed.m_mcsSum += static_cast<uint64_t> (std::llround (meanMcs * numAlloc));
+      summed.m_newTbs += newTb;
+      summed.m_harqTbs += harqTb;
+
+      // The periodic summaries cover a SummaryInterval
+      if (time <= m_numSlots / 1000.0 + 1e-9)
+        {
+          NS_TEST_ASSERT_MSG_EQ_TOL (throughput, bytes * 8.0 / m_summaryInterval.GetSeconds () / 1e6,
+                                     1e-3, "Wrong throughput: " << line);
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (ueSummed.size (), ueExpected.size (), "Wrong number of UEs in the summaries");
+  for (const auto &ue : ueExpected)
+    {
+      const Totals &summed = ueSummed[ue.first];
+      std::string what = ue.first.first + " of IMSI " + std::to_string (ue.first.second);
+      NS_TEST_ASSERT_MSG_EQ (summed.m_allocations, ue.second.m_allocations, "Wrong allocations " << what);
+      NS_TEST_ASSERT_MSG_EQ (summed.m_rbgs, m_ueRbgs.at (ue.first), "Wrong RBGs " << what);
+      NS_TEST_ASSERT_MSG_EQ (summed.m_bytes, ue.second.m_bytes, "Wrong bytes " << what);
+      NS_TEST_ASSERT_MSG_EQ (summed.m_mcsSum, ue.second.m_mcsSum, "Wrong MCS " << what);
+      NS_TEST_ASSERT_MSG_EQ (summed.m_newTbs, ue.second.m_newTbs, "Wrong new TBs " << what);
+      NS_TEST_ASSERT_MSG_EQ (summed.m_harqTbs, ue.second.m_harqTbs, "Wrong HARQ TBs " << what);
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The aggregated scheduling statistics test suite
+ */
+class NrTestMacStatsAggregatedSuite : public TestSuite
+{
+public:
+  NrTestMacStatsAggregatedSuite () : TestSuite ("nr-test-mac-stats-aggregated", UNIT)
+  {
+    AddTestCase (new NrMacStatsAggregatedTestCase (), QUICK);
+  }
+};
+
+static NrTestMacStatsAggregatedSuite nrTestMacStatsAggregatedSuite; //!< Aggregated scheduling statistics test suite
+
+}  // namespace ns3
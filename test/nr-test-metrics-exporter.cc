@@ -0,0 +1,88 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/string.h>
+#include <ns3/nr-metrics-exporter.h>
+
+/**
+ * \file nr-test-metrics-exporter.cc
+ * \ingroup test
+ *
+ * \brief This test runs an exporter without cells, and checks that the
+ * sample taken when the simulator is destroyed is formatted by the writer
+ * thread in the OpenMetrics text format.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the last sample of an exporter
+ */
+class NrMetricsExporterTestCase : public TestCase
+{
+public:
+  NrMetricsExporterTestCase ()
+    : TestCase ("Last sample of the metrics exporter")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrMetricsExporterTestCase::DoRun ()
+{
+  Ptr<NrMetricsExporter> exporter = CreateObject<NrMetricsExporter> ();
+  exporter->SetAttribute ("OutputFilename", StringValue (""));
+  exporter->Start ();
+
+  // The probes never end: the simulation has to be stopped
+  Simulator::Stop (MilliSeconds (100));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::string text = exporter->GetText ();
+  NS_TEST_ASSERT_MSG_NE (text.find ("nr_simulation_time_seconds 0.1\n"), std::string::npos,
+                         "Wrong simulation time");
+  NS_TEST_ASSERT_MSG_NE (text.find ("# TYPE nr_simulator_events counter\n"), std::string::npos,
+                         "No event counter");
+  NS_TEST_ASSERT_MSG_EQ (text.substr (text.size () - 6), "# EOF\n", "The text does not end with # EOF");
+
+  exporter->Dispose ();
+}
+
+/**
+ * \ingroup test
+ * \brief The metrics exporter test suite
+ */
+class NrTestMetricsExporter : public TestSuite
+{
+public:
+  NrTestMetricsExporter () : TestSuite ("nr-test-metrics-exporter", UNIT)
+  {
+    AddTestCase (new NrMetricsExporterTestCase, QUICK);
+  }
+};
+
+static NrTestMetricsExporter NrTestMetricsExporterSuite; //!< Metrics exporter test suite
+
+}  // namespace ns3
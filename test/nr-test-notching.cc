@@ -57,7 +57,11 @@ public:
   virtual void SetSlotAllocInfo (const SlotAllocInfo &slotAllocInfo) override;
   virtual void NotifyConnectionSuccessful () override;
   virtual uint32_t GetRbNum () const override;
-  virtual BeamConfId GetBeamConfId (uint8_t rnti) const override;
+  virtual uint8_t GetNumberOfStreams () const override;
+  virtual BeamConfId GetBeamConfId (uint16_t rnti) const override;
+  virtual double GetBeamCoupling (const BeamConfId &a, const BeamConfId &b) const override;
+  virtual void NotifyActivity () override;
+  virtual void PageUe (uint16_t rnti) override;
   void SetParams (uint32_t numOfUesPerBeam, uint32_t numOfBeams);
 
 private:
@@ -139,8 +143,21 @@ TestNotchingPhySapProvider::GetRbNum () const
   return 53;
 }
 
+uint8_t
+TestNotchingPhySapProvider::GetNumberOfStreams () const
+{
+  return 1;
+}
+
+double
+TestNotchingPhySapProvider::GetBeamCoupling ([[maybe_unused]] const BeamConfId &a,
+                                             [[maybe_unused]] const BeamConfId &b) const
+{
+  return -1.0;
+}
+
 BeamConfId
-TestNotchingPhySapProvider::GetBeamConfId (uint8_t rnti) const
+TestNotchingPhySapProvider::GetBeamConfId (uint16_t rnti) const
 {
   BeamId beamId = BeamId (0, 0.0);
   uint8_t rntiCnt = 1;
@@ -166,6 +183,14 @@ TestNotchingPhySapProvider::GetBeamConfId (uint8_t rnti) const
   return BeamConfId (beamId, BeamId::GetEmptyBeamId());
 }
 
+void
+TestNotchingPhySapProvider::NotifyActivity ()
+{}
+
+void
+TestNotchingPhySapProvider::PageUe ([[maybe_unused]] uint16_t rnti)
+{}
+
 
 class TestNotchingGnbMac : public NrGnbMac
 {
@@ -225,21 +250,15 @@ TestNotchingGnbMac::DoSchedConfigIndication (NrMacSchedSapUser::SchedConfigIndPa
 
       if (m_verboseMac)
         {
-          std::ostringstream oss;
-          for (auto & x: varTtiAllocInfo.m_dci->m_rbgBitmask)
-            {
-              oss << std::to_string (x) << " ";
-            }
-
           std::cout << "UE " << varTtiAllocInfo.m_dci->m_rnti << " assigned RBG" <<
-            " with mask: " << oss.str () << std::endl;
+            " with mask: " << varTtiAllocInfo.m_dci->m_rbgBitmask << std::endl;
         }
 
       NS_ASSERT_MSG (varTtiAllocInfo.m_dci->m_rbgBitmask.size () == m_inputMask.size (),
                      "dci bitmask is not of same size as the mask");
 
-      unsigned zeroes = std::count (varTtiAllocInfo.m_dci->m_rbgBitmask.begin (),
-                                    varTtiAllocInfo.m_dci->m_rbgBitmask.end (), 0);
+      unsigned zeroes = varTtiAllocInfo.m_dci->m_rbgBitmask.size () -
+        varTtiAllocInfo.m_dci->m_rbgBitmask.count ();
 
       NS_ASSERT_MSG (zeroes != m_inputMask.size (), "dci rbgBitmask is filled with zeros");
 
@@ -247,7 +266,7 @@ TestNotchingGnbMac::DoSchedConfigIndication (NrMacSchedSapUser::SchedConfigIndPa
         {
           if (m_inputMask[index] == 0)
             {
-              NS_ASSERT_MSG (varTtiAllocInfo.m_dci->m_rbgBitmask[index] == 0,
+              NS_ASSERT_MSG (!varTtiAllocInfo.m_dci->m_rbgBitmask.test (index),
                              "dci is diff from mask");
             }
 
@@ -0,0 +1,152 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-mac-scheduler-cqi-management.h>
+#include <ns3/nr-mac-scheduler-ue-info-rr.h>
+#include <ns3/nr-amc.h>
+
+/**
+ * \file nr-test-olla.cc
+ * \ingroup test
+ *
+ * \brief This test checks the outer loop link adaptation of
+ * NrMacSchedulerCQIManagement: the MCS back-off grows by the step down at
+ * each NACK and shrinks by the step up at each ACK, within the maximum
+ * offset, and the offset shifts the MCS of the next wide-band CQI.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the OLLA offset and its effect on the DL MCS
+ */
+class NrOllaTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrOllaTestCase ()
+    : TestCase ("OLLA offset on HARQ feedback")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrOllaTestCase::DoRun ()
+{
+  const double targetBler = 0.1;
+  const double stepDown = 0.5;
+  const double stepUp = stepDown * targetBler / (1.0 - targetBler);
+  const double maxOffset = 2.0;
+  const double tol = 1e-9;
+
+  Ptr<NrAmc> amc = CreateObject<NrAmc> ();
+  NrMacSchedulerCQIManagement cqiManagement;
+  cqiManagement.InstallGetBwpIdFn ([] () { return 0; });
+  cqiManagement.InstallGetCellIdFn ([] () { return 1; });
+  cqiManagement.InstallGetStartMcsDlFn ([] () { return 0; });
+  cqiManagement.InstallGetStartMcsUlFn ([] () { return 0; });
+  cqiManagement.InstallGetNrAmcDlFn ([amc] () { return amc; });
+  cqiManagement.InstallGetNrAmcUlFn ([amc] () { return amc; });
+
+  auto ue = std::make_shared<NrMacSchedulerUeInfoRR> (1, BeamConfId (), [] () { return 1; });
+
+  DlCqiInfo info;
+  info.m_rnti = 1;
+  info.m_ri = 1;
+  info.m_cqiType = DlCqiInfo::WB;
+  info.m_wbCqi = StreamVector<uint8_t> (1, 9);
+  const uint8_t maxDlMcs = static_cast<uint8_t> (amc->GetMaxMcs ());
+  const uint8_t mcs = amc->GetMcsFromCqi (9);
+
+  // Disabled (the default): the feedback does not change the offset
+  cqiManagement.DlHarqFeedback (ue, false);
+  cqiManagement.UlHarqFeedback (ue, false);
+  NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_dlOllaOffset, 0.0, tol, "The disabled OLLA changed the DL offset");
+  NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_ulOllaOffset, 0.0, tol, "The disabled OLLA changed the UL offset");
+
+  cqiManagement.ConfigureOlla (targetBler, stepDown, maxOffset);
+
+  // Each NACK grows the back-off (negative offset) by the step down, up to the maximum
+  for (uint32_t i = 1; i <= 3; ++i)
+    {
+      cqiManagement.DlHarqFeedback (ue, false);
+      NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_dlOllaOffset, -stepDown * i, tol, "Wrong DL offset after " << i << " NACK");
+    }
+  cqiManagement.DlHarqFeedback (ue, false);
+  cqiManagement.DlHarqFeedback (ue, false);
+  NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_dlOllaOffset, -maxOffset, tol, "The DL back-off exceeds the maximum");
+  NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_ulOllaOffset, 0.0, tol, "A DL NACK changed the UL offset");
+
+  // The largest back-off lowers the MCS of the next CQI by the maximum offset
+  cqiManagement.DlWBCQIReported (info, ue, 10, maxDlMcs);
+  NS_TEST_ASSERT_MSG_EQ (+ue->m_dlMcs.at (0), mcs - 2, "The DL back-off did not lower the MCS");
+
+  // Each ACK shrinks the back-off by the step up
+  cqiManagement.DlHarqFeedback (ue, true);
+  NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_dlOllaOffset, -maxOffset + stepUp, tol, "Wrong DL offset after an ACK");
+  for (uint32_t i = 1; i < 9; ++i)
+    {
+      cqiManagement.DlHarqFeedback (ue, true);
+    }
+  NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_dlOllaOffset, -maxOffset + stepDown, tol,
+                             "Nine ACK did not compensate one NACK at 10 % target BLER");
+
+  // Many ACK: the offset stops at the maximum, and the MCS at the maximum MCS
+  for (uint32_t i = 0; i < 100; ++i)
+    {
+      cqiManagement.DlHarqFeedback (ue, true);
+    }
+  NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_dlOllaOffset, maxOffset, tol, "The DL offset exceeds the maximum");
+  cqiManagement.DlWBCQIReported (info, ue, 10, maxDlMcs);
+  NS_TEST_ASSERT_MSG_EQ (+ue->m_dlMcs.at (0), mcs + 2, "The DL offset did not raise the MCS");
+  info.m_wbCqi = StreamVector<uint8_t> (1, 15);
+  cqiManagement.DlWBCQIReported (info, ue, 10, maxDlMcs);
+  NS_TEST_ASSERT_MSG_EQ (+ue->m_dlMcs.at (0), +std::min (maxDlMcs, amc->GetMcsFromCqi (15)),
+                         "The DL offset raised the MCS beyond the maximum");
+
+  // The UL offset follows the UL feedback only
+  cqiManagement.UlHarqFeedback (ue, false);
+  NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_ulOllaOffset, -stepDown, tol, "Wrong UL offset after a NACK");
+  cqiManagement.UlHarqFeedback (ue, true);
+  NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_ulOllaOffset, -stepDown + stepUp, tol, "Wrong UL offset after an ACK");
+  NS_TEST_ASSERT_MSG_EQ_TOL (ue->m_dlOllaOffset, maxOffset, tol, "The UL feedback changed the DL offset");
+}
+
+/**
+ * \ingroup test
+ * \brief The OLLA test suite
+ */
+class NrTestOllaSuite : public TestSuite
+{
+public:
+  NrTestOllaSuite () : TestSuite ("nr-test-olla", UNIT)
+  {
+    AddTestCase (new NrOllaTestCase (), QUICK);
+  }
+};
+
+static NrTestOllaSuite nrTestOllaSuite; //!< OLLA test suite
+
+}  // namespace ns3
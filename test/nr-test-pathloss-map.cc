@@ -0,0 +1,165 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/node.h>
+#include <ns3/boolean.h>
+#include <ns3/double.h>
+#include <ns3/uinteger.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/channel-condition-model.h>
+#include <ns3/three-gpp-propagation-loss-model.h>
+#include <ns3/nr-pathloss-map-propagation-loss-model.h>
+
+/**
+ * \file nr-test-pathloss-map.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrPathlossMapPropagationLossModel gives the
+ * loss of the 3GPP model on the points of its grid, close to it between
+ * them, and the loss of the 3GPP model out of the grid; and that its
+ * shadowing does not depend on the number of workers, and is smooth.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Compare the path loss maps with the 3GPP model
+ */
+class NrPathlossMapTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrPathlossMapTestCase ()
+    : TestCase ("Path loss maps of a UMa site")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \param position a position
+   * \return a node at the position, with its mobility model
+   */
+  static Ptr<MobilityModel> CreateMobility (const Vector &position);
+
+  /**
+   * \param model the 3GPP model
+   * \param site the site
+   * \param numWorkers the NumWorkers attribute
+   * \return the maps of the site, generated
+   */
+  static Ptr<NrPathlossMapPropagationLossModel> CreateMaps (const Ptr<ThreeGppPropagationLossModel> &model,
+                                                            const Ptr<MobilityModel> &site,
+                                                            uint32_t numWorkers);
+};
+
+Ptr<MobilityModel>
+NrPathlossMapTestCase::CreateMobility (const Vector &position)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<MobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (position);
+  node->AggregateObject (mobility);
+  return mobility;
+}
+
+Ptr<NrPathlossMapPropagationLossModel>
+NrPathlossMapTestCase::CreateMaps (const Ptr<ThreeGppPropagationLossModel> &model,
+                                   const Ptr<MobilityModel> &site, uint32_t numWorkers)
+{
+  Ptr<NrPathlossMapPropagationLossModel> maps =
+    CreateObjectWithAttributes<NrPathlossMapPropagationLossModel> ("XMin", DoubleValue (-200.0),
+                                                                   "XMax", DoubleValue (200.0),
+                                                                   "YMin", DoubleValue (-200.0),
+                                                                   "YMax", DoubleValue (200.0),
+                                                                   "Resolution", DoubleValue (10.0),
+                                                                   "NumWorkers", UintegerValue (numWorkers));
+  maps->SetPropagationLossModel (model);
+  maps->AssignStreams (1);
+  maps->AddSite (site);
+  maps->Generate ();
+  return maps;
+}
+
+void
+NrPathlossMapTestCase::DoRun ()
+{
+  Ptr<MobilityModel> site = CreateMobility (Vector (0.0, 0.0, 25.0));
+  Ptr<MobilityModel> onGrid = CreateMobility (Vector (50.0, 30.0, 1.5));
+  Ptr<MobilityModel> offGrid = CreateMobility (Vector (55.0, 33.0, 1.5));
+  Ptr<MobilityModel> outside = CreateMobility (Vector (300.0, 0.0, 1.5));
+  Ptr<MobilityModel> higher = CreateMobility (Vector (50.0, 30.0, 10.0));
+
+  Ptr<ThreeGppPropagationLossModel> model = CreateObject<ThreeGppUmaPropagationLossModel> ();
+  model->SetAttribute ("Frequency", DoubleValue (3.5e9));
+  model->SetAttribute ("ShadowingEnabled", BooleanValue (false));
+  model->SetChannelConditionModel (CreateObject<AlwaysLosChannelConditionModel> ());
+
+  Ptr<NrPathlossMapPropagationLossModel> maps = CreateMaps (model, site, 3);
+  NS_TEST_ASSERT_MSG_EQ (maps->GetNumSites (), 1U, "Wrong number of sites");
+  NS_TEST_ASSERT_MSG_EQ_TOL (maps->CalcRxPower (0.0, site, onGrid), model->CalcRxPower (0.0, site, onGrid), 1e-6,
+                             "Wrong loss on a point of the grid");
+  NS_TEST_ASSERT_MSG_EQ_TOL (maps->CalcRxPower (0.0, onGrid, site), model->CalcRxPower (0.0, site, onGrid), 1e-6,
+                             "Wrong loss on a point of the grid, in the other direction");
+  NS_TEST_ASSERT_MSG_EQ_TOL (maps->CalcRxPower (0.0, site, offGrid), model->CalcRxPower (0.0, site, offGrid), 0.2,
+                             "Wrong loss between the points of the grid");
+  NS_TEST_ASSERT_MSG_EQ (maps->GetNumMisses (), 0U, "A loss in the grid was not taken from the maps");
+
+  NS_TEST_ASSERT_MSG_EQ (maps->CalcRxPower (0.0, site, outside), model->CalcRxPower (0.0, site, outside),
+                         "Wrong loss out of the grid");
+  NS_TEST_ASSERT_MSG_EQ (maps->CalcRxPower (0.0, site, higher), model->CalcRxPower (0.0, site, higher),
+                         "Wrong loss above the grid");
+  NS_TEST_ASSERT_MSG_EQ (maps->GetNumMisses (), 2U, "The losses out of the grid were not computed by the 3GPP model");
+
+  // The shadowing fields are drawn serially, and interpolated
+  model->SetAttribute ("ShadowingEnabled", BooleanValue (true));
+  Ptr<NrPathlossMapPropagationLossModel> shadowed = CreateMaps (model, site, 1);
+  Ptr<NrPathlossMapPropagationLossModel> shadowedWorkers = CreateMaps (model, site, 4);
+  double rxPower = shadowed->CalcRxPower (0.0, site, offGrid);
+  NS_TEST_ASSERT_MSG_EQ (shadowedWorkers->CalcRxPower (0.0, site, offGrid), rxPower,
+                         "The maps depend on the number of workers");
+  NS_TEST_ASSERT_MSG_NE (rxPower, maps->CalcRxPower (0.0, site, offGrid), "No shadowing");
+  Ptr<MobilityModel> nextToOffGrid = CreateMobility (Vector (56.0, 33.0, 1.5));
+  NS_TEST_ASSERT_MSG_EQ_TOL (shadowed->CalcRxPower (0.0, site, nextToOffGrid), rxPower, 2.0,
+                             "The shadowing is not spatially consistent");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief The NrPathlossMapPropagationLossModel test suite
+ */
+class NrTestPathlossMap : public TestSuite
+{
+public:
+  NrTestPathlossMap () : TestSuite ("nr-test-pathloss-map", UNIT)
+  {
+    AddTestCase (new NrPathlossMapTestCase (), QUICK);
+  }
+};
+
+static NrTestPathlossMap NrTestPathlossMapSuite; //!< NrPathlossMapPropagationLossModel test suite
+
+}  // namespace ns3
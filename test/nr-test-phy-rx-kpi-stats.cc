@@ -0,0 +1,150 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-phy-rx-kpi-stats.h>
+
+#include <cmath>
+
+/**
+ * \file nr-test-phy-rx-kpi-stats.cc
+ * \ingroup test
+ *
+ * \brief This test checks the P-square quantile estimator against the
+ * exact quantiles of a permutation, and the counters and histograms that
+ * NrPhyRxKpiStats keeps for each UE and direction.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Estimate a quantile of a permutation of 0, 0.01, ..., 99.99
+ */
+class NrP2QuantileTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param p the quantile
+   */
+  NrP2QuantileTestCase (double p)
+    : TestCase ("P-square estimate of the quantile " + std::to_string (p)),
+    m_p (p)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  double m_p; //!< The quantile
+};
+
+void
+NrP2QuantileTestCase::DoRun ()
+{
+  NrP2Quantile quantile (m_p);
+  NS_TEST_ASSERT_MSG_EQ (std::isnan (quantile.Get ()), true, "Estimate without samples");
+
+  const uint32_t n = 10000;
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      // 7919 is prime, so this visits every value once, out of order
+      quantile.Add (((i * 7919) % n) / 100.0);
+    }
+  NS_TEST_ASSERT_MSG_EQ (quantile.GetCount (), n, "Wrong number of samples");
+  NS_TEST_ASSERT_MSG_EQ_TOL (quantile.Get (), m_p * 100, 0.5, "Wrong estimate");
+}
+
+/**
+ * \ingroup test
+ * \brief Feed NrPhyRxKpiStats with the receptions of two UEs
+ */
+class NrPhyRxKpiStatsTestCase : public TestCase
+{
+public:
+  NrPhyRxKpiStatsTestCase ()
+    : TestCase ("Per-UE KPIs of the receptions")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrPhyRxKpiStatsTestCase::DoRun ()
+{
+  Ptr<NrPhyRxKpiStats> stats = CreateObject<NrPhyRxKpiStats> ();
+
+  RxPacketTraceParams params;
+  params.m_cellId = 2;
+  params.m_rnti = 5;
+  params.m_tbSize = 1000;
+  params.m_mcs = 10;
+  params.m_sinr = 100; // 20 dB
+  for (uint32_t i = 0; i < 10; ++i)
+    {
+      params.m_corrupt = (i == 0);
+      stats->Add (NrPhyRxKpiStats::DL, params);
+    }
+  params.m_rnti = 6;
+  params.m_mcs = 40;      // Above the last MCS bin
+  params.m_sinr = 1e-5;   // Below the first SINR bin
+  params.m_corrupt = false;
+  stats->Add (NrPhyRxKpiStats::UL, params);
+
+  const NrPhyRxKpiStats::Kpi *kpi = stats->GetKpi (2, 5, NrPhyRxKpiStats::DL);
+  NS_TEST_ASSERT_MSG_EQ ((kpi != nullptr), true, "No KPIs for the DL of RNTI 5");
+  NS_TEST_ASSERT_MSG_EQ (kpi->m_tbs, 10, "Wrong number of TBs");
+  NS_TEST_ASSERT_MSG_EQ (kpi->m_corruptTbs, 1, "Wrong number of corrupted TBs");
+  NS_TEST_ASSERT_MSG_EQ (kpi->m_rxBytes, 9000, "Wrong number of bytes received");
+  NS_TEST_ASSERT_MSG_EQ (kpi->m_sinrHistogram.at (20 - NrPhyRxKpiStats::SINR_MIN_DB), 10, "Wrong SINR bin");
+  NS_TEST_ASSERT_MSG_EQ (kpi->m_mcsHistogram.at (10), 10, "Wrong MCS bin");
+  NS_TEST_ASSERT_MSG_EQ (kpi->m_tbsHistogram.at (9), 10, "Wrong TB size bin"); // 512 <= 1000 < 1024
+  NS_TEST_ASSERT_MSG_EQ_TOL (kpi->m_sinrP50.Get (), 20, 1e-9, "Wrong SINR median");
+
+  NS_TEST_ASSERT_MSG_EQ ((stats->GetKpi (2, 5, NrPhyRxKpiStats::UL) == nullptr), true, "Unexpected UL KPIs");
+  kpi = stats->GetKpi (2, 6, NrPhyRxKpiStats::UL);
+  NS_TEST_ASSERT_MSG_EQ ((kpi != nullptr), true, "No KPIs for the UL of RNTI 6");
+  NS_TEST_ASSERT_MSG_EQ (kpi->m_sinrHistogram.at (0), 1, "The low SINR is not in the first bin");
+  NS_TEST_ASSERT_MSG_EQ (kpi->m_mcsHistogram.at (NrPhyRxKpiStats::MCS_BINS - 1), 1,
+                         "The high MCS is not in the last bin");
+
+  stats->Dispose ();
+}
+
+/**
+ * \ingroup test
+ * \brief The PHY RX KPI test suite
+ */
+class NrTestPhyRxKpiStats : public TestSuite
+{
+public:
+  NrTestPhyRxKpiStats () : TestSuite ("nr-test-phy-rx-kpi-stats", UNIT)
+  {
+    AddTestCase (new NrP2QuantileTestCase (0.05), QUICK);
+    AddTestCase (new NrP2QuantileTestCase (0.5), QUICK);
+    AddTestCase (new NrP2QuantileTestCase (0.95), QUICK);
+    AddTestCase (new NrPhyRxKpiStatsTestCase, QUICK);
+  }
+};
+
+static NrTestPhyRxKpiStats NrTestPhyRxKpiStatsSuite; //!< PHY RX KPI test suite
+
+}  // namespace ns3
@@ -0,0 +1,133 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-spectrum-value-helper.h>
+
+#include <algorithm>
+
+/**
+ * \file nr-test-psd-bands.cc
+ * \ingroup test
+ *
+ * \brief This test checks that the TX PSDs over bands of more than one RB
+ * have the same power, in total and over each band, as the PSDs with one
+ * band per RB, also when the last band has less RBs than the others, and
+ * when the bandwidth has less RBs than a band.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Compare the PSDs with a given number of RBs per band to the PSDs
+ * with one band per RB
+ */
+class NrPsdBandsTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param rbsPerBand the number of RBs of each band
+   * \param numRbs the number of RBs of the bandwidth
+   */
+  NrPsdBandsTestCase (uint32_t rbsPerBand, uint32_t numRbs = 106)
+    : TestCase ("TX PSD with " + std::to_string (rbsPerBand) + " RBs per band and "
+                + std::to_string (numRbs) + " RBs"),
+    m_rbsPerBand (rbsPerBand),
+    m_numRbs (numRbs)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  uint32_t m_rbsPerBand; //!< Number of RBs of each band
+  uint32_t m_numRbs; //!< Number of RBs of the bandwidth
+};
+
+void
+NrPsdBandsTestCase::DoRun ()
+{
+  const uint32_t numRbs = m_numRbs;
+  const double scs = 15000;
+  Ptr<const SpectrumModel> rbModel = NrSpectrumValueHelper::GetSpectrumModel (numRbs, 2e9, scs);
+  Ptr<const SpectrumModel> bandModel = NrSpectrumValueHelper::GetSpectrumModel (numRbs, 2e9, scs, m_rbsPerBand);
+
+  uint32_t numBands = (numRbs + m_rbsPerBand - 1) / m_rbsPerBand;
+  NS_TEST_ASSERT_MSG_EQ (bandModel->GetNumBands (), numBands, "Wrong number of bands");
+  NS_TEST_ASSERT_MSG_EQ_TOL ((bandModel->End () - 1)->fh - bandModel->Begin ()->fl,
+                             (rbModel->End () - 1)->fh - rbModel->Begin ()->fl, 1e-3,
+                             "The bands do not cover the bandwidth");
+
+  // Some RBs of the first bands, and the last RB (in the shorter last band)
+  std::vector<int> activeRbs;
+  for (int rb : {0, 1, 5, 6, 7, 8, 20})
+    {
+      if (rb < static_cast<int> (numRbs) - 1)
+        {
+          activeRbs.push_back (rb);
+        }
+    }
+  activeRbs.push_back (static_cast<int> (numRbs - 1));
+
+  for (auto type : {NrSpectrumValueHelper::UNIFORM_POWER_ALLOCATION_BW,
+                    NrSpectrumValueHelper::UNIFORM_POWER_ALLOCATION_USED})
+    {
+      Ptr<SpectrumValue> rbPsd = NrSpectrumValueHelper::CreateTxPowerSpectralDensity (23, activeRbs, rbModel, type);
+      Ptr<SpectrumValue> bandPsd = NrSpectrumValueHelper::CreateTxPowerSpectralDensity (23, activeRbs, bandModel,
+                                                                                       type, m_rbsPerBand);
+      double rbPower = Integral (*rbPsd);
+      NS_TEST_ASSERT_MSG_EQ_TOL (Integral (*bandPsd), rbPower, rbPower * 1e-9, "Wrong total power");
+
+      for (uint32_t band = 0; band < numBands; ++band)
+        {
+          const BandInfo &info = *(bandModel->Begin () + band);
+          double expected = 0.0;
+          for (uint32_t rb = band * m_rbsPerBand; rb < std::min ((band + 1) * m_rbsPerBand, numRbs); ++rb)
+            {
+              expected += (*rbPsd)[rb] * scs * NrSpectrumValueHelper::SUBCARRIERS_PER_RB;
+            }
+          NS_TEST_ASSERT_MSG_EQ_TOL ((*bandPsd)[band] * (info.fh - info.fl), expected, rbPower * 1e-9,
+                                     "Wrong power of band " << band);
+        }
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The PSD bands test suite
+ */
+class NrTestPsdBands : public TestSuite
+{
+public:
+  NrTestPsdBands () : TestSuite ("nr-test-psd-bands", UNIT)
+  {
+    AddTestCase (new NrPsdBandsTestCase (1), QUICK);
+    AddTestCase (new NrPsdBandsTestCase (4), QUICK);
+    AddTestCase (new NrPsdBandsTestCase (8), QUICK);
+    AddTestCase (new NrPsdBandsTestCase (27), QUICK);
+    // A single band, with less RBs than RbsPerPsdBand
+    AddTestCase (new NrPsdBandsTestCase (8, 5), QUICK);
+    AddTestCase (new NrPsdBandsTestCase (27, 11), QUICK);
+  }
+};
+
+static NrTestPsdBands NrTestPsdBandsSuite; //!< PSD bands test suite
+
+}  // namespace ns3
@@ -0,0 +1,161 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-ue-phy.h>
+#include <ns3/nr-amc.h>
+#include <ns3/nr-spectrum-phy.h>
+#include <cmath>
+
+/**
+ * \file nr-test-rank-selection.cc
+ * \ingroup test
+ *
+ * \brief This test checks the rank indicator chosen by NrUePhy for its DL
+ * CQI reports: against RiSinrThreshold1 and RiSinrThreshold2, before and
+ * after the first report of rank 2 and with one stream not measured; the
+ * fixed rank; and, with CapacityBasedRi, the rank with the largest expected
+ * TBS, changed only beyond RiHysteresis.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the rank indicator selection of NrUePhy
+ */
+class NrRankSelectionTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrRankSelectionTestCase ()
+    : TestCase ("Rank indicator selection of the UE")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Create a UE PHY with two streams, 20 MHz and numerology 0
+   * \return the UE PHY
+   */
+  static Ptr<NrUePhy> CreatePhy ();
+
+  /**
+   * \brief Select the rank indicator of a report
+   * \param phy the UE PHY
+   * \param sinr0 the average SINR (dB) of the first stream, UINT32_MAX if not measured
+   * \param sinr1 the average SINR (dB) of the second stream, UINT32_MAX if not measured
+   * \return the rank indicator
+   */
+  static uint8_t SelectRi (const Ptr<NrUePhy> &phy, double sinr0, double sinr1);
+};
+
+Ptr<NrUePhy>
+NrRankSelectionTestCase::CreatePhy ()
+{
+  Ptr<NrUePhy> phy = CreateObject<NrUePhy> ();
+  phy->SetNumerology (0);
+  phy->SetChannelBandwidth (200);
+  phy->InstallSpectrumPhy (CreateObject<NrSpectrumPhy> ());
+  phy->InstallSpectrumPhy (CreateObject<NrSpectrumPhy> ());
+  phy->SetDlAmc (CreateObject<NrAmc> ());
+  phy->SetRiSinrThreshold1 (10.0);
+  phy->SetRiSinrThreshold2 (5.0);
+  return phy;
+}
+
+uint8_t
+NrRankSelectionTestCase::SelectRi (const Ptr<NrUePhy> &phy, double sinr0, double sinr1)
+{
+  // As MeasureDlCqi does for the capacity based selection
+  phy->m_reportDlSinrDb = {sinr0, sinr1};
+  return phy->SelectRi ({sinr0, sinr1});
+}
+
+void
+NrRankSelectionTestCase::DoRun ()
+{
+  const double none = UINT32_MAX;
+
+  // Before the first report of rank 2, only the first stream is measured,
+  // and rank 2 needs RiSinrThreshold1
+  Ptr<NrUePhy> phy = CreatePhy ();
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 9.0, none), 1, "Rank 2 below RiSinrThreshold1");
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 11.0, none), 2, "No rank 2 above RiSinrThreshold1");
+
+  // Both streams measured: one layer for each stream above RiSinrThreshold2
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 7.0, 6.0), 2, "No rank 2 with both streams above RiSinrThreshold2");
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 7.0, 3.0), 1, "Rank 2 with a stream below RiSinrThreshold2");
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 3.0, 2.0), 1, "Rank 0 or 2 with both streams below RiSinrThreshold2");
+
+  // One stream measured: back to rank 2 above RiSinrThreshold1
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, none, 11.0), 2, "No rank 2 above RiSinrThreshold1, second stream");
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 7.0, none), 1, "Rank 2 below RiSinrThreshold1, first stream");
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 3.0, none), 1, "Rank 0 or 2 below RiSinrThreshold2");
+
+  // The fixed rank ignores the SINR
+  phy->UseFixedRankIndicator (true);
+  phy->SetFixedRankIndicator (2);
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 0.0, none), 2, "The fixed rank was not used");
+
+  // Capacity based: find the lowest SINR with CQI 1, so that two layers at
+  // 70 % of it carry nothing, while a single layer with their sum does
+  phy = CreatePhy ();
+  phy->SetCapacityBasedRi (true);
+  Ptr<NrAmc> amc = CreateObject<NrAmc> ();
+  double cqi1SinrDb = -20.0;
+  while (amc->GetCqiFromSinrShannon (std::pow (10.0, cqi1SinrDb / 10.0)) == 0)
+    {
+      cqi1SinrDb += 0.1;
+      NS_TEST_ASSERT_MSG_LT (cqi1SinrDb, 30.0, "No SINR with CQI 1");
+    }
+  const double lowSinrDb = cqi1SinrDb + 10.0 * std::log10 (0.7);
+
+  // At high SINR, each of two layers with half the power carries the largest TBS
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 40.0, none), 2, "No rank 2 at high SINR");
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, lowSinrDb, lowSinrDb), 1, "No rank 1 at low SINR");
+
+  // The gain of rank 2 (twice the TBS) is below a hysteresis of 1000 %
+  phy->SetRiHysteresis (10.0);
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 40.0, none), 1, "The rank changed within the hysteresis");
+  phy->SetRiHysteresis (0.5);
+  NS_TEST_ASSERT_MSG_EQ (+SelectRi (phy, 40.0, none), 2, "The rank did not change beyond the hysteresis");
+
+  phy->Dispose ();
+}
+
+/**
+ * \ingroup test
+ * \brief The rank selection test suite
+ */
+class NrTestRankSelectionSuite : public TestSuite
+{
+public:
+  NrTestRankSelectionSuite () : TestSuite ("nr-test-rank-selection", UNIT)
+  {
+    AddTestCase (new NrRankSelectionTestCase (), QUICK);
+  }
+};
+
+static NrTestRankSelectionSuite nrTestRankSelectionSuite; //!< Rank selection test suite
+
+}  // namespace ns3
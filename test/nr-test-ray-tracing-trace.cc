@@ -0,0 +1,217 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/ray-tracing-trace.h>
+#include <ns3/ray-tracing-spectrum-propagation-loss-model.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/uniform-planar-array.h>
+#include <ns3/uinteger.h>
+#include <ns3/enum.h>
+#include <fstream>
+
+/**
+ * \file nr-test-ray-tracing-trace.cc
+ * \ingroup test
+ *
+ * \brief This test converts a small text ray-tracing trace, in the format of
+ * model/Raytracing, to the binary format, and checks the paths read by
+ * RayTracingTrace. It also checks that malformed files are rejected, and
+ * that RayTracingSpectrumPropagationLossModel applies the path gain of the
+ * nearest, or of the interpolated, trace samples.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Convert and read back a ray-tracing trace
+ */
+class RayTracingTraceTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  RayTracingTraceTestCase ()
+    : TestCase ("Ray-tracing trace conversion and mapping")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+RayTracingTraceTestCase::DoRun ()
+{
+  std::string textFile = CreateTempDirFilename ("nr-test-ray-tracing-trace.txt");
+  std::string binaryFile = CreateTempDirFilename ("nr-test-ray-tracing-trace.bin");
+
+  std::ofstream text (textFile.c_str ());
+  text << "2\n"
+          "470.27,624.29,\n"
+          "-110.99,-116.12,\n"
+          "2.58,4.09,\n"
+          "-1.42,-1.07,\n"
+          "93.4,-60.29,\n"
+          "1.42,1.07,\n"
+          "-86.6,-82.84,\n"
+          "1\n"
+          "500.391,\n"
+          "-127.562,\n"
+          "0,\n"
+          "-0.763898,\n"
+          "0,\n"
+          "0.763898,\n"
+          "-180,\n";
+  text.close ();
+
+  NS_TEST_ASSERT_MSG_EQ (RayTracingTrace::ConvertTextToBinary (textFile, binaryFile), true,
+                         "Could not convert the text trace");
+
+  RayTracingTrace trace;
+  NS_TEST_ASSERT_MSG_EQ (trace.Open (binaryFile), true, "Could not open the binary trace");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetNumSamples (), 2, "Wrong number of samples");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetNumPaths (0), 2, "Wrong number of paths of the first sample");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetNumPaths (1), 1, "Wrong number of paths of the second sample");
+
+  const RayTracingPath *paths = trace.GetPaths (0);
+  NS_TEST_ASSERT_MSG_EQ (paths[1].m_delay, 624.29, "Wrong delay");
+  NS_TEST_ASSERT_MSG_EQ (paths[1].m_pathGainDb, -116.12, "Wrong path gain");
+  NS_TEST_ASSERT_MSG_EQ (paths[1].m_phase, 4.09, "Wrong phase");
+  NS_TEST_ASSERT_MSG_EQ (paths[0].m_aodElevation, -1.42, "Wrong AoD elevation");
+  NS_TEST_ASSERT_MSG_EQ (paths[0].m_aodAzimuth, 93.4, "Wrong AoD azimuth");
+  NS_TEST_ASSERT_MSG_EQ (paths[0].m_aoaElevation, 1.42, "Wrong AoA elevation");
+  NS_TEST_ASSERT_MSG_EQ (paths[0].m_aoaAzimuth, -86.6, "Wrong AoA azimuth");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetPaths (1)[0].m_aoaAzimuth, -180.0, "Wrong AoA azimuth");
+  trace.Close ();
+  NS_TEST_ASSERT_MSG_EQ (trace.IsOpen (), false, "The trace is still open");
+
+  // The same paths, parsed in memory
+  NS_TEST_ASSERT_MSG_EQ (trace.OpenText (textFile), true, "Could not read the text trace");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetNumSamples (), 2, "Wrong number of samples in memory");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetNumPaths (0), 2, "Wrong number of paths in memory");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetPaths (0)[1].m_pathGainDb, -116.12, "Wrong path gain in memory");
+  NS_TEST_ASSERT_MSG_EQ (trace.GetPaths (1)[0].m_delay, 500.391, "Wrong delay in memory");
+  trace.Close ();
+  NS_TEST_ASSERT_MSG_EQ (trace.IsOpen (), false, "The trace is still open");
+
+  // A text trace is not a binary trace
+  NS_TEST_ASSERT_MSG_EQ (trace.Open (textFile), false, "A text trace was accepted");
+
+  // A sample with a missing value
+  std::ofstream malformed (textFile.c_str ());
+  malformed << "2\n1,2,\n3,\n";
+  malformed.close ();
+  NS_TEST_ASSERT_MSG_EQ (RayTracingTrace::ConvertTextToBinary (textFile, binaryFile), false,
+                         "A malformed text trace was converted");
+  NS_TEST_ASSERT_MSG_EQ (trace.OpenText (textFile), false, "A malformed text trace was read");
+}
+
+/**
+ * \ingroup test
+ * \brief Check the received power of the ray-tracing spectrum propagation
+ * loss model, with nearest-sample and linear interpolation
+ */
+class RayTracingSpectrumModelTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  RayTracingSpectrumModelTestCase ()
+    : TestCase ("Ray-tracing spectrum propagation loss model")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+RayTracingSpectrumModelTestCase::DoRun ()
+{
+  // Two samples with a single path, at 0 and at 10 m on the x axis
+  std::string textFile = CreateTempDirFilename ("nr-test-ray-tracing-model.txt");
+  std::ofstream text (textFile.c_str ());
+  text << "1\n0,\n-100,\n0,\n0,\n0,\n0,\n0,\n"
+          "1\n0,\n-110,\n0,\n0,\n0,\n0,\n0,\n";
+  text.close ();
+
+  // The binary conversion cannot be written there: the text is read in memory
+  Ptr<RayTracingSpectrumPropagationLossModel> model = CreateObject<RayTracingSpectrumPropagationLossModel> ();
+  model->SetAttribute ("CacheDirectory", StringValue (CreateTempDirFilename ("no-such-directory")));
+  model->SetAttribute ("TraceFile", StringValue (textFile));
+  model->SetAttribute ("RouteStart", VectorValue (Vector (0, 0, 1.5)));
+  model->SetAttribute ("RouteEnd", VectorValue (Vector (10, 0, 1.5)));
+
+  Ptr<MobilityModel> gnb = CreateObject<ConstantPositionMobilityModel> ();
+  gnb->SetPosition (Vector (0, 50, 10));
+  Ptr<MobilityModel> ue = CreateObject<ConstantPositionMobilityModel> ();
+  ue->SetPosition (Vector (4, 0, 1.5));
+
+  Ptr<UniformPlanarArray> gnbArray = CreateObject<UniformPlanarArray> ();
+  Ptr<UniformPlanarArray> ueArray = CreateObject<UniformPlanarArray> ();
+  for (const auto &array : {gnbArray, ueArray})
+    {
+      array->SetAttribute ("NumRows", UintegerValue (1));
+      array->SetAttribute ("NumColumns", UintegerValue (1));
+      array->SetBeamformingVector (PhasedArrayModel::ComplexVector (1, 1.0));
+    }
+
+  Ptr<const SpectrumModel> sm = Create<SpectrumModel> (std::vector<double> {28e9});
+  Ptr<SpectrumValue> txPsd = Create<SpectrumValue> (sm);
+  (*txPsd)[0] = 1.0;
+
+  // 4 m is sample index 0.4: the nearest sample is the first one
+  Ptr<SpectrumValue> rxPsd = model->DoCalcRxPowerSpectralDensity (txPsd, gnb, ue, gnbArray, ueArray);
+  NS_TEST_ASSERT_MSG_EQ_TOL ((*rxPsd)[0] / 1e-10, 1.0, 1e-9, "Wrong nearest-sample gain");
+
+  // The UE is the node on the route also when it transmits
+  rxPsd = model->DoCalcRxPowerSpectralDensity (txPsd, ue, gnb, ueArray, gnbArray);
+  NS_TEST_ASSERT_MSG_EQ_TOL ((*rxPsd)[0] / 1e-10, 1.0, 1e-9, "Wrong nearest-sample gain in UL");
+
+  model->SetAttribute ("Interpolation", EnumValue (RayTracingSpectrumPropagationLossModel::LINEAR));
+  rxPsd = model->DoCalcRxPowerSpectralDensity (txPsd, gnb, ue, gnbArray, ueArray);
+  NS_TEST_ASSERT_MSG_EQ_TOL ((*rxPsd)[0] / (0.6 * 1e-10 + 0.4 * 1e-11), 1.0, 1e-9,
+                             "Wrong interpolated gain");
+
+  // Positions beyond the route use the last sample
+  ue->SetPosition (Vector (20, 0, 1.5));
+  rxPsd = model->DoCalcRxPowerSpectralDensity (txPsd, gnb, ue, gnbArray, ueArray);
+  NS_TEST_ASSERT_MSG_EQ_TOL ((*rxPsd)[0] / 1e-11, 1.0, 1e-9, "Wrong gain after the end of the route");
+}
+
+/**
+ * \ingroup test
+ * \brief The ray-tracing trace test suite
+ */
+class NrTestRayTracingTrace : public TestSuite
+{
+public:
+  NrTestRayTracingTrace () : TestSuite ("nr-test-ray-tracing-trace", UNIT)
+  {
+    AddTestCase (new RayTracingTraceTestCase (), QUICK);
+    AddTestCase (new RayTracingSpectrumModelTestCase (), QUICK);
+  }
+};
+
+static NrTestRayTracingTrace NrTestRayTracingTraceSuite; //!< Ray-tracing trace test suite
+
+}  // namespace ns3
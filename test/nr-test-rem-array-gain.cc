@@ -0,0 +1,101 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-radio-environment-map-helper.h>
+#include <ns3/beamforming-vector.h>
+#include <ns3/uniform-planar-array.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/uinteger.h>
+
+/**
+ * \file nr-test-rem-array-gain.cc
+ * \ingroup test
+ *
+ * \brief This test checks the array gains of the analytic BEAM_SHAPE maps:
+ * a direct-path beam of N elements has a gain of N towards its target and
+ * less elsewhere, and the batch of directions gives the same gains as the
+ * directions one by one.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Array gains of a direct-path beam of a 4x4 array
+ */
+class NrRemArrayGainTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrRemArrayGainTestCase ()
+    : TestCase ("Array gains of the analytic BEAM_SHAPE maps")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrRemArrayGainTestCase::DoRun ()
+{
+  Ptr<UniformPlanarArray> antenna = CreateObject<UniformPlanarArray> ();
+  antenna->SetAttribute ("NumRows", UintegerValue (4));
+  antenna->SetAttribute ("NumColumns", UintegerValue (4));
+
+  Ptr<MobilityModel> gnb = CreateObject<ConstantPositionMobilityModel> ();
+  gnb->SetPosition (Vector (0, 0, 10));
+  Ptr<MobilityModel> ue = CreateObject<ConstantPositionMobilityModel> ();
+  ue->SetPosition (Vector (30, 40, 10));
+  antenna->SetBeamformingVector (CreateDirectPathBfv (gnb, ue, antenna));
+
+  std::vector<Vector> directions {Vector (0.6, 0.8, 0), Vector (0.8, -0.6, 0),
+                                  Vector (0, 0.6, 0.8), Vector (-1, 0, 0)};
+  std::vector<double> gains;
+  NrRadioEnvironmentMapHelper::CalcArrayGains (antenna, directions, &gains);
+  NS_TEST_ASSERT_MSG_EQ (gains.size (), directions.size (), "One gain per direction");
+  NS_TEST_ASSERT_MSG_EQ_TOL (gains[0], 16.0, 1e-9, "Gain of N towards the target");
+  for (size_t i = 1; i < directions.size (); ++i)
+    {
+      NS_TEST_ASSERT_MSG_LT (gains[i], 16.0 - 1e-6, "Lower gain away from the target");
+
+      std::vector<double> gain;
+      NrRadioEnvironmentMapHelper::CalcArrayGains (antenna, {directions[i]}, &gain);
+      NS_TEST_ASSERT_MSG_EQ_TOL (gain[0], gains[i], 1e-9, "Batch and single direction differ");
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The REM array gain test suite
+ */
+class NrTestRemArrayGain : public TestSuite
+{
+public:
+  NrTestRemArrayGain () : TestSuite ("nr-test-rem-array-gain", UNIT)
+  {
+    AddTestCase (new NrRemArrayGainTestCase (), QUICK);
+  }
+};
+
+static NrTestRemArrayGain NrTestRemArrayGainSuite; //!< REM array gain test suite
+
+}  // namespace ns3
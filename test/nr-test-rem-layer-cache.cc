@@ -0,0 +1,242 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/buildings-module.h>
+#include <ns3/nr-module.h>
+#include <ns3/system-path.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+/**
+ * \file nr-test-rem-layer-cache.cc
+ * \ingroup test
+ *
+ * \brief This test runs an AnalyticPathLoss BEAM_SHAPE map three times with
+ * the same LayerCacheDir. The second run, with the same configuration, reads
+ * the gain layer of the first one from the cache; the third one, with a
+ * building more, does not, and calculates its own layer.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the hits and misses of the cache of the gain layers
+ */
+class NrRemLayerCacheTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrRemLayerCacheTestCase ()
+    : TestCase ("Cache of the gain layers of the analytic BEAM_SHAPE maps")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Run the map of a gNB and a UE
+   * \param cacheDir the LayerCacheDir of the map
+   * \param withBuilding whether to add a building, out of the map
+   * \return the received power at each point of the map
+   */
+  std::vector<double> RunRem (const std::string &cacheDir, bool withBuilding) const;
+
+  /**
+   * \param cacheDir a cache directory
+   * \return the gain layers in the directory
+   */
+  static std::list<std::string> GetLayerFiles (const std::string &cacheDir);
+
+  const std::string m_simTag {"test-rem-layer-cache"}; //!< The SimTag of the maps
+};
+
+std::vector<double>
+NrRemLayerCacheTestCase::RunRem (const std::string &cacheDir, bool withBuilding) const
+{
+  Config::SetDefault ("ns3::ThreeGppChannelModel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (1);
+  ueNodes.Create (1);
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (gnbNodes);
+  mobility.Install (ueNodes);
+  gnbNodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (0, 0, 10));
+  ueNodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (10, 10, 1.5));
+
+  if (withBuilding)
+    {
+      Ptr<Building> building = CreateObject<Building> ();
+      building->SetBoundaries (Box (500, 520, 500, 520, 0, 20));
+    }
+
+  Ptr<NrPointToPointEpcHelper> epcHelper = CreateObject<NrPointToPointEpcHelper> ();
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  nrHelper->SetEpcHelper (epcHelper);
+
+  // Always in LOS, so that the building does not change the path loss
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (2e9, 20e6, 1, BandwidthPartInfo::UMa_LoS);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+  nrHelper->SetGnbAntennaAttribute ("NumRows", UintegerValue (2));
+  nrHelper->SetGnbAntennaAttribute ("NumColumns", UintegerValue (2));
+
+  NetDeviceContainer gnbDevices = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  NetDeviceContainer ueDevices = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  int64_t randomStream = 1;
+  randomStream += nrHelper->AssignStreams (gnbDevices, randomStream);
+  nrHelper->AssignStreams (ueDevices, randomStream);
+
+  InternetStackHelper internet;
+  internet.Install (ueNodes);
+  epcHelper->AssignUeIpv4Address (ueDevices);
+  nrHelper->AttachToEnb (ueDevices.Get (0), gnbDevices.Get (0));
+
+  Ptr<NrRadioEnvironmentMapHelper> remHelper = CreateObject<NrRadioEnvironmentMapHelper> ();
+  remHelper->SetMinX (-100);
+  remHelper->SetMaxX (100);
+  remHelper->SetResX (10);
+  remHelper->SetMinY (-100);
+  remHelper->SetMaxY (100);
+  remHelper->SetResY (10);
+  remHelper->SetZ (1.5);
+  remHelper->SetSimTag (m_simTag);
+  remHelper->SetRemMode (NrRadioEnvironmentMapHelper::BEAM_SHAPE);
+  remHelper->SetBeamShapeModel (NrRadioEnvironmentMapHelper::ANALYTIC_PATH_LOSS);
+  remHelper->SetAttribute ("LayerCacheDir", StringValue (cacheDir));
+
+  DynamicCast<NrGnbNetDevice> (gnbDevices.Get (0))->GetPhy (0)->GetSpectrumPhy ()->GetBeamManager ()->SetSector (0, 60);
+  DynamicCast<NrUeNetDevice> (ueDevices.Get (0))->GetPhy (0)->GetSpectrumPhy ()->GetBeamManager ()->ChangeToQuasiOmniBeamformingVector ();
+  remHelper->CreateRem (gnbDevices, ueDevices.Get (0), 0);
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::vector<double> rxPower;
+  std::ifstream inFile ("nr-rem-" + m_simTag + ".out");
+  double x, y, z, snr, sinr, power, sir;
+  while (inFile >> x >> y >> z >> snr >> sinr >> power >> sir)
+    {
+      rxPower.push_back (power);
+    }
+  return rxPower;
+}
+
+std::list<std::string>
+NrRemLayerCacheTestCase::GetLayerFiles (const std::string &cacheDir)
+{
+  std::list<std::string> layerFiles;
+  for (const auto &file : SystemPath::ReadFiles (cacheDir))
+    {
+      if (file.rfind ("nr-rem-layer-", 0) == 0 && file.size () > 4 && file.substr (file.size () - 4) == ".bin")
+        {
+          layerFiles.push_back (file);
+        }
+    }
+  return layerFiles;
+}
+
+void
+NrRemLayerCacheTestCase::DoRun ()
+{
+  std::string cacheDir = CreateTempDirFilename ("nr-test-rem-layer-cache");
+  SystemPath::MakeDirectories (cacheDir);
+
+  // First run: the layer of the gNB is calculated and saved
+  std::vector<double> firstPower = RunRem (cacheDir, false);
+  NS_TEST_ASSERT_MSG_EQ (firstPower.size (), 121U, "Wrong number of REM points");
+  std::list<std::string> layerFiles = GetLayerFiles (cacheDir);
+  NS_TEST_ASSERT_MSG_EQ (layerFiles.size (), 1U, "The layer of the gNB was not saved");
+
+  // Double the gains of the saved layer (key line, number of cells, gains),
+  // so that a map that reads it has 3 dB more power everywhere
+  std::string layerFile = SystemPath::Append (cacheDir, layerFiles.front ());
+  std::ifstream inFile (layerFile.c_str (), std::ios_base::in | std::ios_base::binary);
+  std::string content ((std::istreambuf_iterator<char> (inFile)), std::istreambuf_iterator<char> ());
+  inFile.close ();
+  size_t gainsBegin = content.find ('\n') + 1 + sizeof (uint64_t);
+  NS_TEST_ASSERT_MSG_EQ (content.size (), gainsBegin + 121 * sizeof (double), "Wrong size of the layer file");
+  for (size_t i = gainsBegin; i < content.size (); i += sizeof (double))
+    {
+      double gain;
+      content.copy (reinterpret_cast<char*> (&gain), sizeof (double), i);
+      gain *= 2;
+      content.replace (i, sizeof (double), reinterpret_cast<const char*> (&gain), sizeof (double));
+    }
+  std::ofstream outFile (layerFile.c_str (), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
+  outFile << content;
+  outFile.close ();
+
+  // Second run, same configuration: a hit
+  std::vector<double> secondPower = RunRem (cacheDir, false);
+  NS_TEST_ASSERT_MSG_EQ (secondPower.size (), firstPower.size (), "Wrong number of REM points");
+  for (size_t i = 0; i < secondPower.size (); ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ_TOL (secondPower[i], firstPower[i] + 10 * std::log10 (2.0), 1e-3,
+                                 "The layer was not read from the cache at point " << i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (GetLayerFiles (cacheDir).size (), 1U, "A hit must not save a layer");
+
+  // Third run, with a building: a miss, although the building changes
+  // nothing here
+  std::vector<double> thirdPower = RunRem (cacheDir, true);
+  NS_TEST_ASSERT_MSG_EQ (thirdPower.size (), firstPower.size (), "Wrong number of REM points");
+  for (size_t i = 0; i < thirdPower.size (); ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ_TOL (thirdPower[i], firstPower[i], 1e-3,
+                                 "The layer of the other buildings was read at point " << i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (GetLayerFiles (cacheDir).size (), 2U, "The layer with the building was not saved");
+
+  for (const auto &suffix : {".out", "-gnbs.txt", "-ues.txt", "-buildings.txt", "-plot-rem.gnuplot"})
+    {
+      std::remove (("nr-rem-" + m_simTag + suffix).c_str ());
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The REM layer cache test suite
+ */
+class NrTestRemLayerCacheSuite : public TestSuite
+{
+public:
+  NrTestRemLayerCacheSuite () : TestSuite ("nr-test-rem-layer-cache", SYSTEM)
+  {
+    AddTestCase (new NrRemLayerCacheTestCase (), QUICK);
+  }
+};
+
+static NrTestRemLayerCacheSuite nrTestRemLayerCacheSuite; //!< REM layer cache test suite
+
+}  // namespace ns3
@@ -0,0 +1,296 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/nr-module.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+/**
+ * \file nr-test-rem-tiles.cc
+ * \ingroup test
+ *
+ * \brief This test checks the tiled and the progressive REMs of
+ * NrRadioEnvironmentMapHelper, with PointStreamBase so that each point does
+ * not depend on the order of the evaluation. A run resumed from a truncated
+ * tile file gives the map of an uninterrupted run, with each tile saved
+ * once; a run with RefinementStep gives the values of a plain run at the
+ * points of the coarse grid.
+ */
+namespace ns3 {
+
+/**
+ * \brief Run a BEAM_SHAPE map of a gNB towards a UE
+ * \param simTag the SimTag of the map
+ * \param tileSize the TileSize of the map
+ * \param resumeTiles the ResumeTiles of the map
+ * \param refinementStep the RefinementStep of the map
+ * \return the lines of the map, in grid order
+ */
+static std::vector<std::string>
+RunTiledRem (const std::string &simTag, uint32_t tileSize, bool resumeTiles, uint32_t refinementStep)
+{
+  Config::SetDefault ("ns3::ThreeGppChannelModel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (1);
+  ueNodes.Create (1);
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (gnbNodes);
+  mobility.Install (ueNodes);
+  gnbNodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (0, 0, 10));
+  ueNodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (10, 10, 1.5));
+
+  Ptr<NrPointToPointEpcHelper> epcHelper = CreateObject<NrPointToPointEpcHelper> ();
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  nrHelper->SetEpcHelper (epcHelper);
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (2e9, 20e6, 1, BandwidthPartInfo::UMa);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+  nrHelper->SetGnbAntennaAttribute ("NumRows", UintegerValue (2));
+  nrHelper->SetGnbAntennaAttribute ("NumColumns", UintegerValue (2));
+
+  NetDeviceContainer gnbDevices = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  NetDeviceContainer ueDevices = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  int64_t randomStream = 1;
+  randomStream += nrHelper->AssignStreams (gnbDevices, randomStream);
+  nrHelper->AssignStreams (ueDevices, randomStream);
+
+  InternetStackHelper internet;
+  internet.Install (ueNodes);
+  epcHelper->AssignUeIpv4Address (ueDevices);
+  nrHelper->AttachToEnb (ueDevices.Get (0), gnbDevices.Get (0));
+
+  Ptr<NrRadioEnvironmentMapHelper> remHelper = CreateObject<NrRadioEnvironmentMapHelper> ();
+  remHelper->SetMinX (-100);
+  remHelper->SetMaxX (100);
+  remHelper->SetResX (10);
+  remHelper->SetMinY (-100);
+  remHelper->SetMaxY (100);
+  remHelper->SetResY (10);
+  remHelper->SetZ (1.5);
+  remHelper->SetSimTag (simTag);
+  remHelper->SetRemMode (NrRadioEnvironmentMapHelper::BEAM_SHAPE);
+  remHelper->SetAttribute ("PointStreamBase", IntegerValue (100000));
+  remHelper->SetAttribute ("TileSize", UintegerValue (tileSize));
+  remHelper->SetAttribute ("ResumeTiles", BooleanValue (resumeTiles));
+  remHelper->SetAttribute ("RefinementStep", UintegerValue (refinementStep));
+
+  DynamicCast<NrGnbNetDevice> (gnbDevices.Get (0))->GetPhy (0)->GetSpectrumPhy ()->GetBeamManager ()->SetSector (0, 60);
+  DynamicCast<NrUeNetDevice> (ueDevices.Get (0))->GetPhy (0)->GetSpectrumPhy ()->GetBeamManager ()->ChangeToQuasiOmniBeamformingVector ();
+  remHelper->CreateRem (gnbDevices, ueDevices.Get (0), 0);
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::vector<std::string> lines;
+  std::ifstream inFile ("nr-rem-" + simTag + ".out");
+  std::string line;
+  while (std::getline (inFile, line))
+    {
+      lines.push_back (line);
+    }
+  return lines;
+}
+
+/**
+ * \brief Remove the files of a map
+ * \param simTag the SimTag of the map
+ */
+static void
+RemoveRemFiles (const std::string &simTag)
+{
+  for (const auto &suffix : {".out", "-tiles.out", "-gnbs.txt", "-ues.txt", "-buildings.txt", "-plot-rem.gnuplot"})
+    {
+      std::remove (("nr-rem-" + simTag + suffix).c_str ());
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief Resume a tiled map from a truncated tile file
+ */
+class NrRemResumeTilesTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrRemResumeTilesTestCase ()
+    : TestCase ("Tiled REM resumed from a truncated tile file")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrRemResumeTilesTestCase::DoRun ()
+{
+  // 11 x 11 points in tiles of 4 x 4: 9 tiles
+  const std::string simTag = "test-rem-resume-tiles";
+  const std::string tileFileName = "nr-rem-" + simTag + "-tiles.out";
+  const uint32_t numTiles = 9;
+  std::vector<std::string> uninterrupted = RunTiledRem (simTag, 4, false, 0);
+  NS_TEST_ASSERT_MSG_EQ (uninterrupted.size (), 121U, "Wrong number of REM points");
+
+  // Keep the header, the first 3 tiles, and half of the 4th one (without
+  // its end line), as if the run had been interrupted
+  std::vector<std::string> tileLines;
+  std::ifstream inFile (tileFileName);
+  std::string line;
+  uint32_t numEnds = 0;
+  while (std::getline (inFile, line) && numEnds < 3)
+    {
+      tileLines.push_back (line);
+      numEnds += line.rfind ("end ", 0) == 0 ? 1 : 0;
+    }
+  tileLines.push_back (line);
+  for (uint32_t i = 0; i < 8 && std::getline (inFile, line); ++i)
+    {
+      tileLines.push_back (line);
+    }
+  inFile.close ();
+  NS_TEST_ASSERT_MSG_EQ (numEnds, 3U, "Too few tiles in " << tileFileName);
+  std::ofstream outFile (tileFileName, std::ios_base::out | std::ios_base::trunc);
+  for (const auto &l : tileLines)
+    {
+      outFile << l << "\n";
+    }
+  outFile.close ();
+
+  std::vector<std::string> resumed = RunTiledRem (simTag, 4, true, 0);
+  NS_TEST_ASSERT_MSG_EQ (resumed.size (), uninterrupted.size (), "Missing or duplicated REM points");
+  for (size_t i = 0; i < resumed.size (); ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (resumed[i], uninterrupted[i], "Wrong resumed REM point " << i);
+    }
+
+  // The tile file has each tile once, complete
+  inFile.open (tileFileName);
+  std::set<uint32_t> tiles;
+  numEnds = 0;
+  while (std::getline (inFile, line))
+    {
+      std::istringstream iss (line);
+      std::string keyword;
+      uint32_t tile;
+      if (iss >> keyword >> tile && keyword == "tile")
+        {
+          NS_TEST_ASSERT_MSG_EQ (tiles.insert (tile).second, true, "Tile " << tile << " saved twice");
+        }
+      numEnds += keyword == "end" ? 1 : 0;
+    }
+  NS_TEST_ASSERT_MSG_EQ (tiles.size (), numTiles, "Missing tiles in " << tileFileName);
+  NS_TEST_ASSERT_MSG_EQ (numEnds, numTiles, "Incomplete tiles in " << tileFileName);
+
+  RemoveRemFiles (simTag);
+}
+
+/**
+ * \ingroup test
+ * \brief Compare a progressive map to a plain one on the coarse grid
+ */
+class NrRemRefinementTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param tileSize the TileSize of the progressive map
+   */
+  NrRemRefinementTestCase (uint32_t tileSize)
+    : TestCase ("Progressive REM with tiles of " + std::to_string (tileSize)),
+    m_tileSize (tileSize)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  uint32_t m_tileSize; //!< The TileSize of the progressive map
+};
+
+void
+NrRemRefinementTestCase::DoRun ()
+{
+  const std::string simTag = "test-rem-refinement";
+  const uint32_t numPoints = 11;
+  const uint32_t step = 3;
+  std::vector<std::string> plain = RunTiledRem (simTag, 0, false, 0);
+  RemoveRemFiles (simTag);
+  std::vector<std::string> refined = RunTiledRem (simTag, m_tileSize, false, step);
+  RemoveRemFiles (simTag);
+  NS_TEST_ASSERT_MSG_EQ (plain.size (), numPoints * numPoints, "Wrong number of REM points");
+  NS_TEST_ASSERT_MSG_EQ (refined.size (), plain.size (), "Wrong number of refined REM points");
+
+  // Without tiles, the coarse grid is one line out of step, plus the last
+  // one; with tiles, the same within each tile
+  uint32_t block = m_tileSize == 0 ? numPoints : m_tileSize;
+  auto isCoarse = [block, numPoints, step] (uint32_t i)
+    {
+      uint32_t inBlock = i % block;
+      uint32_t blockEnd = std::min (i - inBlock + block, numPoints) - 1;
+      return inBlock % step == 0 || i == blockEnd;
+    };
+  uint32_t numCoarse = 0;
+  for (uint32_t x = 0; x < numPoints; ++x)
+    {
+      for (uint32_t y = 0; y < numPoints; ++y)
+        {
+          if (isCoarse (x) && isCoarse (y))
+            {
+              size_t i = x * numPoints + y;
+              NS_TEST_ASSERT_MSG_EQ (refined[i], plain[i], "Wrong value at the coarse point " << x << "," << y);
+              ++numCoarse;
+            }
+        }
+    }
+  NS_TEST_ASSERT_MSG_GT (numCoarse, 0U, "No coarse point");
+}
+
+/**
+ * \ingroup test
+ * \brief The tiled and progressive REM test suite
+ */
+class NrTestRemTilesSuite : public TestSuite
+{
+public:
+  NrTestRemTilesSuite () : TestSuite ("nr-test-rem-tiles", SYSTEM)
+  {
+    AddTestCase (new NrRemResumeTilesTestCase (), QUICK);
+    AddTestCase (new NrRemRefinementTestCase (0), QUICK);
+    AddTestCase (new NrRemRefinementTestCase (6), QUICK);
+  }
+};
+
+static NrTestRemTilesSuite nrTestRemTilesSuite; //!< Tiled and progressive REM test suite
+
+}  // namespace ns3
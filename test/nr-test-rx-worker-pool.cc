@@ -0,0 +1,259 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/nr-rx-worker-pool.h>
+#include <ns3/nr-spectrum-value-helper.h>
+#include <ns3/nr-eesm-ir-t1.h>
+#include <ns3/nr-eesm-cc-t1.h>
+#include <cmath>
+
+/**
+ * \file nr-test-rx-worker-pool.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrRxWorkerPool decodes the receptions that
+ * end at the same time together, and that their deliveries happen after
+ * all the ends, in the order of registration and with the context of the
+ * receiver, whatever the number of workers. It also decodes HARQ
+ * retransmissions with the shared IR and CC error models in the workers,
+ * which must give the outputs of the serial decoding.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief End the receptions of some fake receivers, and check the order of the calls
+ */
+class NrRxWorkerPoolTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param numWorkers the number of workers
+   */
+  NrRxWorkerPoolTestCase (uint32_t numWorkers)
+    : TestCase ("Rx worker pool with " + std::to_string (numWorkers) + " workers"),
+    m_numWorkers (numWorkers)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief End the reception of a receiver, as a NrSpectrumPhy does
+   * \param rx the receiver
+   */
+  void EndRx (uint32_t rx);
+
+  uint32_t m_numWorkers;          //!< Number of workers
+  std::string m_calls;            //!< The calls of the simulation thread, in order
+  std::vector<double> m_results;  //!< The result of each decoding
+};
+
+/**
+ * \brief A decoding that takes some time
+ * \param seed the input
+ * \return the output
+ */
+static double
+FakeDecode (uint32_t seed)
+{
+  double x = 0.0;
+  for (uint32_t i = 0; i < 100000; ++i)
+    {
+      x += std::cos (i * (seed + 1.0));
+    }
+  return x;
+}
+
+void
+NrRxWorkerPoolTestCase::EndRx (uint32_t rx)
+{
+  m_calls += "e" + std::to_string (rx) + "@" + std::to_string (Simulator::GetContext ()) + " ";
+  auto decode = [this, rx] ()
+    {
+      m_results.at (rx) = FakeDecode (rx);
+    };
+  auto deliver = [this, rx] ()
+    {
+      m_calls += "d" + std::to_string (rx) + "@" + std::to_string (Simulator::GetContext ()) + " ";
+    };
+  NrRxWorkerPool::Get ().AddRx (decode, deliver);
+}
+
+void
+NrRxWorkerPoolTestCase::DoRun ()
+{
+  NrRxWorkerPool::Get ().SetNumWorkers (m_numWorkers);
+
+  // The receivers 0, 1 and 2 end at 1 ms, the receiver 3 at 2 ms
+  const uint32_t numRx = 4;
+  m_results.assign (numRx, 0.0);
+  for (uint32_t rx = 0; rx < numRx; ++rx)
+    {
+      Simulator::ScheduleWithContext (rx, MilliSeconds (rx == 3 ? 2 : 1),
+                                      &NrRxWorkerPoolTestCase::EndRx, this, rx);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_calls, "e0@0 e1@1 e2@2 d0@0 d1@1 d2@2 e3@3 d3@3 ",
+                         "Wrong order of the calls");
+  for (uint32_t rx = 0; rx < numRx; ++rx)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_results.at (rx), FakeDecode (rx), "Wrong result of the decoding " << rx);
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief Decode the HARQ retransmissions of some receivers in the workers
+ */
+class NrRxHarqDecodeTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param numWorkers the number of workers
+   */
+  NrRxHarqDecodeTestCase (uint32_t numWorkers)
+    : TestCase ("HARQ-IR and HARQ-CC decoding with " + std::to_string (numWorkers) + " workers"),
+    m_numWorkers (numWorkers)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  uint32_t m_numWorkers; //!< Number of workers
+};
+
+void
+NrRxHarqDecodeTestCase::DoRun ()
+{
+  NrRxWorkerPool::Get ().SetNumWorkers (m_numWorkers);
+
+  const uint32_t numRbs = 24;
+  const uint32_t numRx = 16;
+  // All the receivers share the SpectrumModel, as the devices of a BWP do
+  Ptr<const SpectrumModel> model = NrSpectrumValueHelper::GetSpectrumModel (numRbs, 3.5e9, 15000);
+
+  for (const TypeId &type : {NrEesmIrT1::GetTypeId (), NrEesmCcT1::GetTypeId ()})
+    {
+      // The instance shared by the PHYs
+      Ptr<NrErrorModel> errorModel = NrErrorModel::GetShared (type);
+
+      // Each receiver gets a retransmission of its own TB: with more RBs than
+      // the first transmission for half of them, so that HARQ-CC combines
+      // them again
+      std::vector<SpectrumValue> sinrs;
+      std::vector<std::vector<int>> maps (numRx);
+      std::vector<NrErrorModel::NrErrorModelHistory> histories (numRx);
+      std::vector<std::vector<NrErrorModel::TbDecodeInput>> tbs (numRx);
+      std::vector<Ptr<NrErrorModelOutput>> expected;
+      for (uint32_t rx = 0; rx < numRx; ++rx)
+        {
+          SpectrumValue sinr (model);
+          for (uint32_t rb = 0; rb < numRbs; ++rb)
+            {
+              sinr[rb] = std::pow (10.0, ((rb * 7 + rx * 3) % 11 - 3.0) / 10.0);
+            }
+          sinrs.push_back (sinr);
+
+          const uint32_t size = 100 + 40 * rx;
+          const uint8_t mcs = static_cast<uint8_t> (4 + rx % 6);
+          std::vector<int> firstMap;
+          for (uint32_t rb = 0; rb < 4 + rx % 8; ++rb)
+            {
+              firstMap.push_back (static_cast<int> (rb));
+            }
+          for (uint32_t rb = 0; rb < (rx % 2 == 0 ? 2 : 12); ++rb)
+            {
+              maps[rx].push_back (static_cast<int> (numRbs - 1 - rb));
+            }
+          histories[rx].push_back (errorModel->GetTbDecodificationStats (sinr, firstMap, size, mcs,
+                                                                         NrErrorModel::NrErrorModelHistory ()));
+
+          NrErrorModel::TbDecodeInput tb;
+          tb.m_map = &maps[rx];
+          tb.m_size = size;
+          tb.m_mcs = mcs;
+          tb.m_history = &histories[rx];
+          tbs[rx].push_back (tb);
+          expected.push_back (errorModel->GetTbDecodificationStats (sinr, maps[rx], size, mcs,
+                                                                    histories[rx]));
+        }
+
+      // The SINRs are given to the workers as their values, as NrSpectrumPhy does
+      std::vector<NrSinrValues> sinrValues (sinrs.begin (), sinrs.end ());
+      std::vector<std::vector<Ptr<NrErrorModelOutput>>> outputs (numRx);
+      uint32_t delivered = 0;
+      NrErrorModel *em = PeekPointer (errorModel);
+      for (uint32_t rx = 0; rx < numRx; ++rx)
+        {
+          auto endRx = [em, rx, &sinrValues, &tbs, &outputs, &delivered] ()
+            {
+              NrRxWorkerPool::Get ().AddRx ([em, rx, &sinrValues, &tbs, &outputs] ()
+                                            {
+                                              em->GetTbsDecodificationStats (sinrValues[rx], tbs[rx],
+                                                                             outputs[rx]);
+                                            },
+                                            [&delivered] () { ++delivered; });
+            };
+          Simulator::ScheduleWithContext (rx, MilliSeconds (1), endRx);
+        }
+      Simulator::Run ();
+      Simulator::Destroy ();
+
+      NS_TEST_ASSERT_MSG_EQ (delivered, numRx, "Wrong number of deliveries");
+      for (uint32_t rx = 0; rx < numRx; ++rx)
+        {
+          NS_TEST_ASSERT_MSG_EQ (outputs[rx].size (), 1U, "Wrong number of outputs of " << rx);
+          auto output = DynamicCast<NrEesmErrorModelOutput> (outputs[rx].front ());
+          auto reference = DynamicCast<NrEesmErrorModelOutput> (expected[rx]);
+          NS_TEST_ASSERT_MSG_EQ (output->m_sinrEff, reference->m_sinrEff,
+                                 "Wrong effective SINR of " << rx << " with " << type.GetName ());
+          NS_TEST_ASSERT_MSG_EQ (output->m_tbler, reference->m_tbler,
+                                 "Wrong TBLER of " << rx << " with " << type.GetName ());
+        }
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The NrRxWorkerPool test suite
+ */
+class NrTestRxWorkerPool : public TestSuite
+{
+public:
+  NrTestRxWorkerPool () : TestSuite ("nr-test-rx-worker-pool", UNIT)
+  {
+    // The pool only increases its number of workers: serial first
+    AddTestCase (new NrRxWorkerPoolTestCase (1), QUICK);
+    AddTestCase (new NrRxWorkerPoolTestCase (4), QUICK);
+    AddTestCase (new NrRxHarqDecodeTestCase (4), QUICK);
+  }
+};
+
+static NrTestRxWorkerPool NrTestRxWorkerPoolSuite; //!< NrRxWorkerPool test suite
+
+}  // namespace ns3
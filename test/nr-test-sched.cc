@@ -168,6 +168,12 @@ public:
     return MilliSeconds (1);
   }
 
+  virtual double GetBeamCoupling ([[maybe_unused]] const BeamConfId &a,
+                                  [[maybe_unused]] const BeamConfId &b) const override
+  {
+    return -1.0;
+  }
+
 private:
   NrSchedGeneralTestCase *m_testCase;
 };
@@ -293,6 +299,10 @@ public:
     AddTestCase (new NrSchedGeneralTestCase ("ns3::NrMacSchedulerTdmaPF", "TdmaPF test"), QUICK);
     AddTestCase (new NrSchedGeneralTestCase ("ns3::NrMacSchedulerOfdmaRR", "OfdmaRR test"), QUICK);
     AddTestCase (new NrSchedGeneralTestCase ("ns3::NrMacSchedulerOfdmaPF", "OfdmaPF test"), QUICK);
+    AddTestCase (new NrSchedGeneralTestCase ("ns3::NrMacSchedulerTdmaQos", "TdmaQos test"), QUICK);
+    AddTestCase (new NrSchedGeneralTestCase ("ns3::NrMacSchedulerOfdmaQos", "OfdmaQos test"), QUICK);
+    AddTestCase (new NrSchedGeneralTestCase ("ns3::NrMacSchedulerTdmaEdf", "TdmaEdf test"), QUICK);
+    AddTestCase (new NrSchedGeneralTestCase ("ns3::NrMacSchedulerOfdmaEdf", "OfdmaEdf test"), QUICK);
   }
 };
 
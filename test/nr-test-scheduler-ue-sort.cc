@@ -0,0 +1,183 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-mac-scheduler-ue-info-rr.h>
+#include <ns3/nr-mac-scheduler-ue-info-mr.h>
+#include <algorithm>
+
+/**
+ * \file nr-test-scheduler-ue-sort.cc
+ * \ingroup test
+ *
+ * \brief This test pins the order in which the RR and MR schedulers sort
+ * their UEs: NrMacSchedulerUeInfoRR::RotateSort and
+ * NrMacSchedulerUeInfoMR::CountingSort keep the order of the UEs with the
+ * same metric, as std::stable_sort does, also with more than 16 UEs.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the RR and MR orderings of the UEs, with ties
+ */
+class NrSchedulerUeSortTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrSchedulerUeSortTestCase ()
+    : TestCase ("RR and MR sort of the UEs")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Create UEs with the given DL RBG and MCS
+   * \param rbg the DL RBG of each UE
+   * \param mcs the DL MCS of each UE (the same for all if it has one value)
+   * \return the UEs, whose RNTI is their index
+   */
+  static std::vector<NrMacSchedulerNs3::UePtrAndBufferReq>
+  CreateUes (const std::vector<uint32_t> &rbg, const std::vector<uint8_t> &mcs);
+
+  /**
+   * \param ueVector the UEs
+   * \return the RNTIs of the UEs, in their order
+   */
+  static std::vector<uint16_t> GetOrder (const std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> &ueVector);
+};
+
+std::vector<NrMacSchedulerNs3::UePtrAndBufferReq>
+NrSchedulerUeSortTestCase::CreateUes (const std::vector<uint32_t> &rbg, const std::vector<uint8_t> &mcs)
+{
+  std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> ueVector;
+  for (uint16_t i = 0; i < rbg.size (); ++i)
+    {
+      auto ue = std::make_shared<NrMacSchedulerUeInfoMR> (i, BeamConfId (), [] () { return 1; });
+      ue->m_dlRBG = rbg.at (i);
+      ue->m_dlMcs = StreamVector<uint8_t> (1, mcs.size () == 1 ? mcs.at (0) : mcs.at (i));
+      ueVector.emplace_back (ue, 1000);
+    }
+  return ueVector;
+}
+
+std::vector<uint16_t>
+NrSchedulerUeSortTestCase::GetOrder (const std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> &ueVector)
+{
+  std::vector<uint16_t> order;
+  for (const auto & ue : ueVector)
+    {
+      order.push_back (ue.first->m_rnti);
+    }
+  return order;
+}
+
+void
+NrSchedulerUeSortTestCase::DoRun ()
+{
+  const size_t numUes = 20;
+  std::vector<uint16_t> expected (numUes);
+
+  // RR, 20 UEs with the same RBG: the order does not change
+  auto ueVector = CreateUes (std::vector<uint32_t> (numUes, 0), {10});
+  NrMacSchedulerUeInfoRR::SortUeDl (&ueVector);
+  for (uint16_t i = 0; i < numUes; ++i)
+    {
+      expected[i] = i;
+    }
+  NS_TEST_ASSERT_MSG_EQ ((GetOrder (ueVector) == expected), true, "RR reordered UEs with the same RBG");
+
+  // The served UE goes before the first UE with as many RBG: 0 goes last,
+  // then 1 goes before 0, and so on
+  ueVector.front ().first->m_dlRBG++;
+  NrMacSchedulerUeInfoRR::SortUeDl (&ueVector);
+  ueVector.front ().first->m_dlRBG++;
+  NrMacSchedulerUeInfoRR::SortUeDl (&ueVector);
+  for (uint16_t i = 0; i < numUes - 2; ++i)
+    {
+      expected[i] = i + 2;
+    }
+  expected[numUes - 2] = 1;
+  expected[numUes - 1] = 0;
+  NS_TEST_ASSERT_MSG_EQ ((GetOrder (ueVector) == expected), true, "Wrong RR order after two RBG");
+
+  // RR, first sort of a vector with ties
+  ueVector = CreateUes ({2, 0, 1, 0, 2, 1}, {10});
+  NrMacSchedulerUeInfoRR::SortUeDl (&ueVector);
+  NS_TEST_ASSERT_MSG_EQ ((GetOrder (ueVector) == std::vector<uint16_t> {1, 3, 2, 5, 0, 4}), true,
+                         "Wrong RR order of a vector with ties");
+
+  // MR: the highest MCS first, then the fewest RBG
+  std::vector<NrMacSchedulerNs3::UePtrAndBufferReq> buffer;
+  ueVector = CreateUes ({0, 0, 0, 0, 1, 0}, {5, 7, 5, 7, 5, 6});
+  NrMacSchedulerUeInfoMR::SortUeDl (&ueVector, &buffer);
+  NS_TEST_ASSERT_MSG_EQ ((GetOrder (ueVector) == std::vector<uint16_t> {1, 3, 5, 0, 2, 4}), true,
+                         "Wrong MR order of a vector with ties");
+
+  // Both orderings are the one of std::stable_sort, with more than 16 UEs
+  // and many ties, also when the vector is sorted again after each RBG
+  std::vector<uint32_t> rbg (numUes * 2);
+  std::vector<uint8_t> mcs (numUes * 2);
+  for (size_t i = 0; i < rbg.size (); ++i)
+    {
+      rbg[i] = (i * 7) % 3;
+      mcs[i] = static_cast<uint8_t> (10 + (i * 5) % 4);
+    }
+  auto rrVector = CreateUes (rbg, mcs);
+  auto mrVector = CreateUes (rbg, mcs);
+  for (uint32_t round = 0; round < 50; ++round)
+    {
+      auto rrExpected = rrVector;
+      std::stable_sort (rrExpected.begin (), rrExpected.end (), NrMacSchedulerUeInfoRR::CompareUeWeightsDl);
+      NrMacSchedulerUeInfoRR::SortUeDl (&rrVector);
+      NS_TEST_ASSERT_MSG_EQ ((GetOrder (rrVector) == GetOrder (rrExpected)), true,
+                             "RR order is not the stable one at round " << round);
+
+      auto mrExpected = mrVector;
+      std::stable_sort (mrExpected.begin (), mrExpected.end (), NrMacSchedulerUeInfoMR::CompareUeWeightsDl);
+      NrMacSchedulerUeInfoMR::SortUeDl (&mrVector, &buffer);
+      NS_TEST_ASSERT_MSG_EQ ((GetOrder (mrVector) == GetOrder (mrExpected)), true,
+                             "MR order is not the stable one at round " << round);
+
+      // Serve the first UE, as the assignment loop does
+      rrVector.front ().first->m_dlRBG++;
+      mrVector.front ().first->m_dlRBG++;
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The RR and MR UE sort test suite
+ */
+class NrTestSchedulerUeSortSuite : public TestSuite
+{
+public:
+  NrTestSchedulerUeSortSuite () : TestSuite ("nr-test-scheduler-ue-sort", UNIT)
+  {
+    AddTestCase (new NrSchedulerUeSortTestCase (), QUICK);
+  }
+};
+
+static NrTestSchedulerUeSortSuite nrTestSchedulerUeSortSuite; //!< RR and MR UE sort test suite
+
+}  // namespace ns3
@@ -0,0 +1,156 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/nr-scheduling-worker-pool.h>
+#include <cmath>
+
+/**
+ * \file nr-test-scheduling-worker-pool.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrSchedulingWorkerPool runs the scheduler
+ * calls of the slots registered at the same time in rounds, and that
+ * the commits and the starts of the slots happen in the order of
+ * registration and with the context of who registered them, whatever the
+ * number of workers.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Register the slots of some fake cells, and check the order of the calls
+ */
+class NrSchedulingWorkerPoolTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param numWorkers the number of workers
+   */
+  NrSchedulingWorkerPoolTestCase (uint32_t numWorkers)
+    : TestCase ("Scheduling worker pool with " + std::to_string (numWorkers) + " workers"),
+    m_numWorkers (numWorkers)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Register the slot of a cell, as a gNB PHY does
+   * \param cell the cell
+   */
+  void AddSlot (uint32_t cell);
+
+  uint32_t m_numWorkers;          //!< Number of workers
+  std::string m_calls;            //!< The calls of the simulation thread, in order
+  std::vector<double> m_results;  //!< The result of each scheduler call
+};
+
+/**
+ * \brief A scheduler call that takes some time
+ * \param seed the input
+ * \return the output
+ */
+static double
+FakeScheduler (uint32_t seed)
+{
+  double x = 0.0;
+  for (uint32_t i = 0; i < 100000; ++i)
+    {
+      x += std::sin (i * (seed + 1.0));
+    }
+  return x;
+}
+
+void
+NrSchedulingWorkerPoolTestCase::AddSlot (uint32_t cell)
+{
+  // The cell 1 has one indication, the others two
+  std::vector<std::function<void ()>> indications;
+  for (uint32_t i = 0; i < (cell == 1 ? 1 : 2); ++i)
+    {
+      indications.emplace_back ([this, cell, i] ()
+        {
+          m_calls += "i" + std::to_string (cell) + std::to_string (i) + "@" +
+            std::to_string (Simulator::GetContext ()) + " ";
+          uint32_t task = cell * 2 + i;
+          auto schedule = [this, task] ()
+            {
+              m_results.at (task) = FakeScheduler (task);
+            };
+          auto commit = [this, cell, i] ()
+            {
+              m_calls += "c" + std::to_string (cell) + std::to_string (i) + "@" +
+                std::to_string (Simulator::GetContext ()) + " ";
+            };
+          NrSchedulingWorkerPool::Get ().AddTask (schedule, commit);
+        });
+    }
+  NrSchedulingWorkerPool::Get ().AddSlot (indications, [this, cell] ()
+    {
+      m_calls += "s" + std::to_string (cell) + "@" + std::to_string (Simulator::GetContext ()) + " ";
+    });
+}
+
+void
+NrSchedulingWorkerPoolTestCase::DoRun ()
+{
+  NrSchedulingWorkerPool::Get ().SetNumWorkers (m_numWorkers);
+
+  const uint32_t numCells = 3;
+  m_results.assign (numCells * 2, 0.0);
+  for (uint32_t cell = 0; cell < numCells; ++cell)
+    {
+      Simulator::ScheduleWithContext (cell, MilliSeconds (1),
+                                      &NrSchedulingWorkerPoolTestCase::AddSlot, this, cell);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_calls, "i00@0 i10@1 i20@2 c00@0 c10@1 c20@2 "
+                         "i01@0 i21@2 c01@0 c21@2 s0@0 s1@1 s2@2 ",
+                         "Wrong order of the calls");
+  for (uint32_t task = 0; task < m_results.size (); ++task)
+    {
+      double expected = task == 3 ? 0.0 : FakeScheduler (task);
+      NS_TEST_ASSERT_MSG_EQ (m_results.at (task), expected, "Wrong result of the task " << task);
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The NrSchedulingWorkerPool test suite
+ */
+class NrTestSchedulingWorkerPool : public TestSuite
+{
+public:
+  NrTestSchedulingWorkerPool () : TestSuite ("nr-test-scheduling-worker-pool", UNIT)
+  {
+    // The pool only increases its number of workers: serial first
+    AddTestCase (new NrSchedulingWorkerPoolTestCase (1), QUICK);
+    AddTestCase (new NrSchedulingWorkerPoolTestCase (4), QUICK);
+  }
+};
+
+static NrTestSchedulingWorkerPool NrTestSchedulingWorkerPoolSuite; //!< NrSchedulingWorkerPool test suite
+
+}  // namespace ns3
@@ -0,0 +1,97 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/config.h>
+#include <ns3/enum.h>
+#include <ns3/nr-eesm-ir-t1.h>
+#include <ns3/nr-eesm-cc-t1.h>
+
+/**
+ * \file nr-test-shared-error-model.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrErrorModel::GetShared gives the same
+ * instance for the same type and default values of the attributes, and a
+ * different one otherwise.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Get the shared error models of different configurations
+ */
+class NrSharedErrorModelTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrSharedErrorModelTestCase ()
+    : TestCase ("Shared error model of each configuration")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrSharedErrorModelTestCase::DoRun ()
+{
+  Ptr<NrErrorModel> irExact = NrErrorModel::GetShared (NrEesmIrT1::GetTypeId ());
+  NS_TEST_ASSERT_MSG_EQ (irExact, NrErrorModel::GetShared (NrEesmIrT1::GetTypeId ()),
+                         "The same configuration gives a different instance");
+  NS_TEST_ASSERT_MSG_NE (irExact, NrErrorModel::GetShared (NrEesmCcT1::GetTypeId ()),
+                         "Two types give the same instance");
+
+  // An attribute of the parent type is part of the configuration
+  Config::SetDefault ("ns3::NrEesmErrorModel::SinrExpKernel",
+                      EnumValue (NrEesmErrorModel::FAST_EXP));
+  Ptr<NrErrorModel> irFast = NrErrorModel::GetShared (NrEesmIrT1::GetTypeId ());
+  NS_TEST_ASSERT_MSG_NE (irExact, irFast, "Two attribute values give the same instance");
+  NS_TEST_ASSERT_MSG_EQ (irFast, NrErrorModel::GetShared (NrEesmIrT1::GetTypeId ()),
+                         "The same configuration gives a different instance");
+  EnumValue kernel;
+  irFast->GetAttribute ("SinrExpKernel", kernel);
+  NS_TEST_ASSERT_MSG_EQ (kernel.Get (), NrEesmErrorModel::FAST_EXP,
+                         "The shared instance does not have the default value");
+
+  Config::SetDefault ("ns3::NrEesmErrorModel::SinrExpKernel",
+                      EnumValue (NrEesmErrorModel::EXACT_EXP));
+  NS_TEST_ASSERT_MSG_EQ (irExact, NrErrorModel::GetShared (NrEesmIrT1::GetTypeId ()),
+                         "The first configuration gives a new instance");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrErrorModel::GetShared test suite
+ */
+class NrTestSharedErrorModel : public TestSuite
+{
+public:
+  NrTestSharedErrorModel () : TestSuite ("nr-test-shared-error-model", UNIT)
+  {
+    AddTestCase (new NrSharedErrorModelTestCase (), QUICK);
+  }
+};
+
+static NrTestSharedErrorModel NrTestSharedErrorModelSuite; //!< NrErrorModel::GetShared test suite
+
+}  // namespace ns3
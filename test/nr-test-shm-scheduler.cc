@@ -0,0 +1,135 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-scheduler-shm-interface.h>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * \file nr-test-shm-scheduler.cc
+ * \ingroup test
+ *
+ * \brief This test checks the exchange of NrSchedulerShmInterface: an agent
+ * thread answers to the states of the simulator side with a weight per UE,
+ * the simulator receives the decisions in order, and the wait times out
+ * when the agent does not answer.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Exchange states and decisions with an agent thread
+ */
+class NrShmSchedulerTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrShmSchedulerTestCase ()
+    : TestCase ("Exchange through the shared-memory scheduler interface")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrShmSchedulerTestCase::DoRun ()
+{
+  const std::string name = "/nr-test-shm-" + std::to_string (getpid ());
+  const uint64_t numStates = 100;
+  NrSchedulerShmInterface sim (name, NrSchedulerShmInterface::SIMULATOR);
+
+  // The agent gives to each UE a weight equal to its buffer
+  std::thread agentThread ([&name, numStates] ()
+    {
+      NrSchedulerShmInterface agent (name, NrSchedulerShmInterface::AGENT);
+      uint64_t seen = 0;
+      while (seen < numStates)
+        {
+          const NrShmRegion::State *state = agent.WaitState (seen, 10000000);
+          if (state == nullptr)
+            {
+              return;
+            }
+          seen = state->m_seq;
+          NrShmRegion::Decision *decision = agent.DecisionFor (seen);
+          decision->m_numUes = state->m_numUes;
+          for (uint32_t i = 0; i < state->m_numUes; ++i)
+            {
+              decision->m_ues[i].m_rnti = state->m_ues[i].m_rnti;
+              decision->m_ues[i].m_weight = static_cast<float> (state->m_ues[i].m_bufferBytes);
+            }
+          agent.PublishDecision (seen);
+        }
+    });
+
+  uint64_t answered = 0;
+  for (uint64_t i = 1; i <= numStates; ++i)
+    {
+      NrShmRegion::State *state = sim.NextState ();
+      state->m_direction = 0;
+      state->m_numUes = 2;
+      state->m_ues[0].m_rnti = 1;
+      state->m_ues[0].m_bufferBytes = static_cast<uint32_t> (i);
+      state->m_ues[1].m_rnti = 2;
+      state->m_ues[1].m_bufferBytes = static_cast<uint32_t> (2 * i);
+      uint64_t seq = sim.PublishState ();
+      NS_TEST_ASSERT_MSG_EQ (seq, i, "Wrong sequence number");
+
+      const NrShmRegion::Decision *decision = sim.WaitDecision (seq, 10000000);
+      NS_TEST_ASSERT_MSG_EQ ((decision != nullptr), true, "No decision from the agent");
+      if (decision != nullptr)
+        {
+          NS_TEST_ASSERT_MSG_EQ (decision->m_seq, seq, "Decision on another state");
+          NS_TEST_ASSERT_MSG_EQ (decision->m_numUes, 2U, "Wrong number of UEs");
+          NS_TEST_ASSERT_MSG_EQ (decision->m_ues[1].m_rnti, 2, "Wrong RNTI");
+          NS_TEST_ASSERT_MSG_EQ (decision->m_ues[1].m_weight, static_cast<float> (2 * i), "Wrong weight");
+          ++answered;
+        }
+    }
+  agentThread.join ();
+  NS_TEST_ASSERT_MSG_EQ (answered, numStates, "Not all the states were answered");
+
+  // Nobody answers anymore
+  sim.NextState ()->m_numUes = 0;
+  uint64_t seq = sim.PublishState ();
+  NS_TEST_ASSERT_MSG_EQ ((sim.WaitDecision (seq, 1000) == nullptr), true, "Decision without an agent");
+  NS_TEST_ASSERT_MSG_EQ (sim.GetLastDecision ()->m_seq, numStates, "Wrong last decision");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrSchedulerShmInterface test suite
+ */
+class NrTestShmScheduler : public TestSuite
+{
+public:
+  NrTestShmScheduler () : TestSuite ("nr-test-shm-scheduler", UNIT)
+  {
+    AddTestCase (new NrShmSchedulerTestCase (), QUICK);
+  }
+};
+
+static NrTestShmScheduler NrTestShmSchedulerSuite; //!< NrSchedulerShmInterface test suite
+
+}  // namespace ns3
@@ -0,0 +1,153 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-site-index.h>
+#include <ns3/random-variable-stream.h>
+#include <algorithm>
+
+/**
+ * \file nr-test-site-index.cc
+ * \ingroup test
+ *
+ * \brief This test checks that the nearest sites and the sites within a
+ * radius found by NrSiteIndex are the ones found by looping over all the
+ * sites, with random sites, sites on a line at the same distance and sites
+ * all in the same position, for different cell sizes.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Compare the queries of NrSiteIndex with a loop over all the sites
+ */
+class NrSiteIndexTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param cellSize the cell size of the index
+   */
+  NrSiteIndexTestCase (double cellSize)
+    : TestCase ("Site index with cell size " + std::to_string (cellSize)),
+    m_cellSize (cellSize)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Query the index in random points
+   * \param positions the sites
+   * \param name the name of the set of sites, for the messages
+   */
+  void Check (const std::vector<Vector> &positions, const std::string &name);
+
+  double m_cellSize;                     //!< Cell size of the index
+  Ptr<UniformRandomVariable> m_random;   //!< Random coordinates
+};
+
+void
+NrSiteIndexTestCase::Check (const std::vector<Vector> &positions, const std::string &name)
+{
+  NrSiteIndex index (positions, m_cellSize);
+  NS_TEST_ASSERT_MSG_EQ (index.GetN (), positions.size (), "Wrong number of sites for " << name);
+
+  for (uint32_t q = 0; q < 100; ++q)
+    {
+      Vector pos (m_random->GetValue (-3000, 3000), m_random->GetValue (-3000, 3000), 1.5);
+
+      // The sites by distance, and by index for the same distance
+      std::vector<std::pair<double, uint32_t>> all;
+      for (uint32_t site = 0; site < positions.size (); ++site)
+        {
+          all.emplace_back (CalculateDistance (pos, positions[site]), site);
+        }
+      std::sort (all.begin (), all.end ());
+
+      NS_TEST_ASSERT_MSG_EQ (index.FindNearest (pos), all.front ().second, "Wrong nearest site for " << name);
+
+      uint32_t k = 1 + q % 5;
+      std::vector<uint32_t> nearest = index.FindNearest (pos, k);
+      NS_TEST_ASSERT_MSG_EQ (nearest.size (), std::min<size_t> (k, positions.size ()),
+                             "Wrong number of nearest sites for " << name);
+      for (uint32_t i = 0; i < nearest.size (); ++i)
+        {
+          NS_TEST_ASSERT_MSG_EQ (nearest[i], all[i].second, "Wrong nearest site " << i << " for " << name);
+        }
+
+      double radius = m_random->GetValue (0, 1500);
+      std::vector<uint32_t> expected;
+      for (const auto &site : all)
+        {
+          if (site.first <= radius)
+            {
+              expected.push_back (site.second);
+            }
+        }
+      NS_TEST_ASSERT_MSG_EQ ((index.FindWithinRadius (pos, radius) == expected), true,
+                             "Wrong sites within " << radius << " m for " << name);
+    }
+}
+
+void
+NrSiteIndexTestCase::DoRun ()
+{
+  m_random = CreateObject<UniformRandomVariable> ();
+  m_random->SetStream (1);
+
+  std::vector<Vector> random;
+  for (uint32_t site = 0; site < 57; ++site)
+    {
+      random.emplace_back (m_random->GetValue (-1000, 1000), m_random->GetValue (-500, 500), 25.0);
+    }
+  Check (random, "random sites");
+
+  std::vector<Vector> line;
+  for (uint32_t site = 0; site < 20; ++site)
+    {
+      line.emplace_back ((site % 4) * 200.0, 0.0, 10.0);
+    }
+  Check (line, "sites on a line");
+
+  Check (std::vector<Vector> (7, Vector (5.0, 5.0, 0.0)), "sites in the same position");
+
+  random.emplace_back (1e6, 0.0, 25.0);
+  Check (random, "random sites and a far away site");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrSiteIndex test suite
+ */
+class NrTestSiteIndex : public TestSuite
+{
+public:
+  NrTestSiteIndex () : TestSuite ("nr-test-site-index", UNIT)
+  {
+    AddTestCase (new NrSiteIndexTestCase (0.0), QUICK);
+    AddTestCase (new NrSiteIndexTestCase (0.5), QUICK);
+    AddTestCase (new NrSiteIndexTestCase (400.0), QUICK);
+  }
+};
+
+static NrTestSiteIndex NrTestSiteIndexSuite; //!< NrSiteIndex test suite
+
+}  // namespace ns3
@@ -0,0 +1,138 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-slot-alloc-store.h>
+
+/**
+ * \file nr-test-slot-alloc-store.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrSlotAllocStore finds, merges and removes
+ * the allocations by slot, also when the slots stored are farther apart
+ * than its initial window.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Store the allocations of slots spaced by a given step
+ */
+class NrSlotAllocStoreTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param step the number of slots between two allocations
+   */
+  NrSlotAllocStoreTestCase (uint32_t step)
+    : TestCase ("Slot allocation store with allocations every " + std::to_string (step) + " slots"),
+    m_step (step)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \param sfnSf the slot
+   * \param symbols the number of allocated symbols
+   * \return an allocation of the slot
+   */
+  static SlotAllocInfo MakeAllocation (const SfnSf &sfnSf, uint32_t symbols)
+  {
+    SlotAllocInfo alloc (sfnSf);
+    alloc.m_numSymAlloc = symbols;
+    alloc.m_type = SlotAllocInfo::DL;
+    return alloc;
+  }
+
+  uint32_t m_step; //!< Number of slots between two allocations
+};
+
+void
+NrSlotAllocStoreTestCase::DoRun ()
+{
+  const uint32_t numAllocations = 6;
+  NrSlotAllocStore store (4);
+  SfnSf first (1023, 9, 1, 1);
+  std::vector<SfnSf> slots;
+
+  // Insert them in reverse order: the store keeps the slot order anyway
+  for (uint32_t i = 0; i < numAllocations; ++i)
+    {
+      slots.push_back (first.GetFutureSfnSf (i * m_step));
+    }
+  for (auto it = slots.rbegin (); it != slots.rend (); ++it)
+    {
+      store.Insert (MakeAllocation (*it, 1));
+    }
+  NS_TEST_ASSERT_MSG_EQ (store.Size (), numAllocations, "Wrong number of allocations");
+
+  for (const auto & slot : slots)
+    {
+      NS_TEST_ASSERT_MSG_EQ (store.Exists (slot), true, "Allocation not found");
+      NS_TEST_ASSERT_MSG_EQ (store.Peek (slot).m_sfnSf.Normalize (), slot.Normalize (), "Wrong allocation");
+    }
+  NS_TEST_ASSERT_MSG_EQ (store.Exists (first.GetFutureSfnSf (numAllocations * m_step)), false,
+                         "Allocation found for an empty slot");
+
+  // An allocation for a stored slot is merged with it
+  store.Insert (MakeAllocation (slots.at (1), 2));
+  NS_TEST_ASSERT_MSG_EQ (store.Size (), numAllocations, "The allocation was not merged");
+  NS_TEST_ASSERT_MSG_EQ (store.Peek (slots.at (1)).m_numSymAlloc, 3, "The allocation was not merged");
+
+  SlotAllocInfo head = store.RetrieveFirst ();
+  NS_TEST_ASSERT_MSG_EQ (head.m_sfnSf.Normalize (), slots.at (0).Normalize (), "Wrong first allocation");
+  NS_TEST_ASSERT_MSG_EQ (store.Exists (slots.at (0)), false, "The first allocation was not removed");
+
+  SlotAllocInfo last = store.Retrieve (slots.back ());
+  NS_TEST_ASSERT_MSG_EQ (last.m_sfnSf.Normalize (), slots.back ().Normalize (), "Wrong allocation retrieved");
+  NS_TEST_ASSERT_MSG_EQ (store.Size (), numAllocations - 2, "Wrong number of allocations");
+
+  store.DiscardBefore (slots.at (3));
+  NS_TEST_ASSERT_MSG_EQ (store.Size (), numAllocations - 4, "Wrong number of allocations after the discard");
+  NS_TEST_ASSERT_MSG_EQ (store.Exists (slots.at (2)), false, "Allocation not discarded");
+
+  std::vector<SlotAllocInfo> remaining = store.RetrieveAll ();
+  NS_TEST_ASSERT_MSG_EQ (remaining.size (), 2, "Wrong number of remaining allocations");
+  NS_TEST_ASSERT_MSG_EQ (remaining.at (0).m_sfnSf.Normalize (), slots.at (3).Normalize (), "Allocations not in slot order");
+  NS_TEST_ASSERT_MSG_EQ (remaining.at (1).m_sfnSf.Normalize (), slots.at (4).Normalize (), "Allocations not in slot order");
+  NS_TEST_ASSERT_MSG_EQ (store.Empty (), true, "The store should be empty");
+}
+
+/**
+ * \ingroup test
+ * \brief The slot allocation store test suite
+ */
+class NrTestSlotAllocStore : public TestSuite
+{
+public:
+  NrTestSlotAllocStore () : TestSuite ("nr-test-slot-alloc-store", UNIT)
+  {
+    AddTestCase (new NrSlotAllocStoreTestCase (1), QUICK);
+    AddTestCase (new NrSlotAllocStoreTestCase (3), QUICK);
+    AddTestCase (new NrSlotAllocStoreTestCase (4), QUICK);
+    AddTestCase (new NrSlotAllocStoreTestCase (37), QUICK);
+  }
+};
+
+static NrTestSlotAllocStore NrTestSlotAllocStoreSuite; //!< Slot allocation store test suite
+
+}  // namespace ns3
@@ -0,0 +1,155 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/nstime.h>
+#include <ns3/nr-slot-timing-engine.h>
+
+/**
+ * \file nr-test-slot-timing-engine.cc
+ * \ingroup test
+ *
+ * \brief This test checks NrSlotTimingEngine with three chains of slot
+ * boundaries, with the periods of the numerologies 0, 2 and 3: each
+ * boundary runs at its instant, in the order of the requests, with one
+ * simulator event per instant; a function scheduled for the same instant
+ * runs after all the others of that instant.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the instants, the order and the events of NrSlotTimingEngine
+ */
+class NrSlotTimingEngineTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrSlotTimingEngineTestCase ()
+    : TestCase ("Slot boundaries of three numerologies through NrSlotTimingEngine")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Schedule a boundary through the engine, and record the request
+   * \param id the chain of the boundary
+   * \param delay the delay of the boundary
+   * \param period the period of the chain, or zero for a single boundary
+   */
+  void Request (uint32_t id, const Time &delay, const Time &period);
+
+  /**
+   * \brief A slot boundary: record it, and request the next one of the chain
+   * \param id the chain of the boundary
+   * \param period the period of the chain, or zero for a single boundary
+   */
+  void Boundary (uint32_t id, const Time &period);
+
+  Ptr<NrSlotTimingEngine> m_engine;  //!< The engine
+  const Time m_end {MilliSeconds (10)}; //!< No boundary at or after this instant
+  const Time m_startSlot {MilliSeconds (2)}; //!< Instant of the boundary scheduled with delay 0
+  const uint32_t m_startSlotId {99};  //!< Chain of the boundary scheduled with delay 0
+  std::map<int64_t, std::vector<uint32_t> > m_requests; //!< Chains requested at each instant, in order
+  std::map<int64_t, std::vector<uint32_t> > m_runs;     //!< Chains run at each instant, in order
+  uint64_t m_numRequests {0};         //!< Boundaries requested
+};
+
+void
+NrSlotTimingEngineTestCase::Request (uint32_t id, const Time &delay, const Time &period)
+{
+  m_requests[(Simulator::Now () + delay).GetTimeStep ()].push_back (id);
+  ++m_numRequests;
+  m_engine->Schedule (delay, [this, id, period] () { Boundary (id, period); });
+}
+
+void
+NrSlotTimingEngineTestCase::Boundary (uint32_t id, const Time &period)
+{
+  m_runs[Simulator::Now ().GetTimeStep ()].push_back (id);
+
+  // As EndSlot does with StartSlot, the first chain schedules a function
+  // for this same instant
+  if (id == 0 && Simulator::Now () == m_startSlot)
+    {
+      Request (m_startSlotId, Seconds (0), Seconds (0));
+    }
+  if (period.IsStrictlyPositive () && Simulator::Now () + period < m_end)
+    {
+      Request (id, period, period);
+    }
+}
+
+void
+NrSlotTimingEngineTestCase::DoRun ()
+{
+  m_engine = CreateObject<NrSlotTimingEngine> ();
+
+  // The slot periods of the numerologies 0, 3 and 2
+  Request (0, Seconds (0), MicroSeconds (1000));
+  Request (1, Seconds (0), MicroSeconds (125));
+  Request (2, Seconds (0), MicroSeconds (250));
+
+  Simulator::Run ();
+
+  // Every boundary ran at its instant, in the order of the requests
+  NS_TEST_ASSERT_MSG_EQ (m_runs.size (), m_requests.size (), "Wrong number of instants");
+  for (const auto &instant : m_requests)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((m_runs[instant.first] == instant.second), true,
+                             "Wrong boundaries at " << TimeStep (instant.first).As (Time::US));
+    }
+
+  // The boundaries of the numerologies 0 and 2 are also boundaries of the
+  // numerology 3: one event per slot of numerology 3, plus the one of the
+  // function scheduled for the same instant, which ran last
+  const uint64_t instants = m_end.GetMicroSeconds () / 125;
+  NS_TEST_ASSERT_MSG_EQ (m_requests.size (), instants, "Wrong number of boundary instants");
+  NS_TEST_ASSERT_MSG_EQ (m_numRequests, instants + instants / 2 + instants / 8 + 1, "Wrong number of boundaries");
+  NS_TEST_ASSERT_MSG_EQ (m_engine->GetNumRuns (), m_numRequests, "Wrong number of boundaries run");
+  NS_TEST_ASSERT_MSG_EQ (m_engine->GetNumEvents (), instants + 1, "Wrong number of simulator events");
+  NS_TEST_ASSERT_MSG_EQ (m_runs[m_startSlot.GetTimeStep ()].back (), m_startSlotId,
+                         "The function scheduled for the same instant did not run last");
+
+  Simulator::Destroy ();
+  m_engine->Dispose ();
+  m_engine = nullptr;
+}
+
+/**
+ * \ingroup test
+ * \brief The slot timing engine test suite
+ */
+class NrTestSlotTimingEngineSuite : public TestSuite
+{
+public:
+  NrTestSlotTimingEngineSuite () : TestSuite ("nr-test-slot-timing-engine", UNIT)
+  {
+    AddTestCase (new NrSlotTimingEngineTestCase (), QUICK);
+  }
+};
+
+static NrTestSlotTimingEngineSuite nrTestSlotTimingEngineSuite; //!< Slot timing engine test suite
+
+}  // namespace ns3
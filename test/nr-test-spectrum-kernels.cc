@@ -0,0 +1,124 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-spectrum-kernels.h>
+#include <ns3/nr-spectrum-value-helper.h>
+#include <ns3/spectrum-value.h>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * \file nr-test-spectrum-kernels.cc
+ * \ingroup test
+ *
+ * \brief This test checks that the per-RB kernels give the same values as
+ * the element-by-element SpectrumValue operators, with a number of RBs
+ * that is not a multiple of the vector width.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Compare the kernels with the SpectrumValue operators
+ */
+class NrSpectrumKernelsTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrSpectrumKernelsTestCase ()
+    : TestCase ("Per-RB kernels against the SpectrumValue operators")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrSpectrumKernelsTestCase::DoRun ()
+{
+  const uint32_t numRbs = 51;
+  NrSpectrumValueHelper helper;
+  Ptr<const SpectrumModel> model = helper.GetSpectrumModel (numRbs, 3.6e9, 30000);
+  SpectrumValue signal (model);
+  SpectrumValue all (model);
+  SpectrumValue noise (model);
+  for (uint32_t rb = 0; rb < numRbs; ++rb)
+    {
+      signal[rb] = 1e-12 * (1.0 + std::sin (rb));
+      all[rb] = signal[rb] + 1e-13 * (rb % 7);
+      noise[rb] = 1e-14 * (1.0 + 0.1 * (rb % 3));
+    }
+
+  SpectrumValue expectedSinr = signal / (all - signal + noise);
+  SpectrumValue sinr (model);
+  NrSinrKernel (&(*signal.ConstValuesBegin ()), &(*all.ConstValuesBegin ()),
+                &(*noise.ConstValuesBegin ()), &(*sinr.ValuesBegin ()), numRbs);
+  for (uint32_t rb = 0; rb < numRbs; ++rb)
+    {
+      NS_TEST_ASSERT_MSG_EQ (sinr[rb], expectedSinr[rb], "Wrong SINR of the RB " << rb);
+    }
+
+  SpectrumValue expectedSum = signal + sinr * 0.25;
+  std::vector<double> sum (signal.ConstValuesBegin (), signal.ConstValuesEnd ());
+  NrScaledAddKernel (sum.data (), &(*sinr.ConstValuesBegin ()), 0.25, numRbs);
+  for (uint32_t rb = 0; rb < numRbs; ++rb)
+    {
+      NS_TEST_ASSERT_MSG_EQ (sum[rb], expectedSum[rb], "Wrong scaled sum of the RB " << rb);
+    }
+
+  double expectedSnr = Sum (signal / noise) / numRbs;
+  double snr = NrMeanRatioKernel (&(*signal.ConstValuesBegin ()), &(*noise.ConstValuesBegin ()), numRbs);
+  NS_TEST_ASSERT_MSG_EQ (snr, expectedSnr, "Wrong mean SNR");
+
+  std::vector<int> rbs = {3, 50, 0, 17, 9};
+  double expectedMean = 0.0;
+  double expectedMin = sinr[rbs.at (0)];
+  for (int rb : rbs)
+    {
+      expectedMean += sinr[rb];
+      expectedMin = std::min (expectedMin, sinr[rb]);
+    }
+  expectedMean /= rbs.size ();
+  double mean = 0.0;
+  double min = 0.0;
+  NrMeanMinOnRbsKernel (&(*sinr.ConstValuesBegin ()), rbs.data (), rbs.size (), &mean, &min);
+  NS_TEST_ASSERT_MSG_EQ (mean, expectedMean, "Wrong mean over the RBs");
+  NS_TEST_ASSERT_MSG_EQ (min, expectedMin, "Wrong minimum over the RBs");
+}
+
+/**
+ * \ingroup test
+ * \brief The per-RB kernels test suite
+ */
+class NrTestSpectrumKernels : public TestSuite
+{
+public:
+  NrTestSpectrumKernels () : TestSuite ("nr-test-spectrum-kernels", UNIT)
+  {
+    AddTestCase (new NrSpectrumKernelsTestCase (), QUICK);
+  }
+};
+
+static NrTestSpectrumKernels NrTestSpectrumKernelsSuite; //!< Per-RB kernels test suite
+
+}  // namespace ns3
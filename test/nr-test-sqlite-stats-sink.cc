@@ -0,0 +1,137 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-sqlite-stats-sink.h>
+#include <ns3/abort.h>
+
+/**
+ * \file nr-test-sqlite-stats-sink.cc
+ * \ingroup test
+ *
+ * \brief This test writes rows in two tables through NrSqliteStatsSink,
+ * with and without the writer thread, and with batch sizes that do not
+ * divide the number of rows. Then it checks the number of rows and their
+ * sum in the database, and that registering a table again deletes the rows
+ * of the same Seed/Run pair.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Write rows through the sink and read them back
+ */
+class NrSqliteStatsSinkTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param useWriterThread use the writer thread of the sink
+   */
+  NrSqliteStatsSinkTestCase (bool useWriterThread)
+    : TestCase (std::string ("SQLite stats sink ") +
+                (useWriterThread ? "with" : "without") + " writer thread"),
+    m_useWriterThread (useWriterThread)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Run a query that returns a single number
+   * \param db the database
+   * \param query the query
+   * \return the value of the first column of the first row
+   */
+  static double QueryValue (SQLiteOutput *db, const std::string &query);
+
+  bool m_useWriterThread; //!< Use the writer thread of the sink
+};
+
+double
+NrSqliteStatsSinkTestCase::QueryValue (SQLiteOutput *db, const std::string &query)
+{
+  sqlite3_stmt *stmt;
+  bool ret = db->SpinPrepare (&stmt, query);
+  NS_ABORT_IF (ret == false);
+  NS_ABORT_IF (sqlite3_step (stmt) != SQLITE_ROW);
+  double value = sqlite3_column_double (stmt, 0);
+  sqlite3_finalize (stmt);
+  return value;
+}
+
+void
+NrSqliteStatsSinkTestCase::DoRun ()
+{
+  SQLiteOutput db (CreateTempDirFilename ("nr-test-sqlite-stats-sink.db"));
+  const uint32_t rows = 10007;
+
+  for (uint32_t iteration = 0; iteration < 2; ++iteration)
+    {
+      NrSqliteStatsSink sink (&db, m_useWriterThread);
+      sink.SetRowsPerInsert (33);
+      sink.SetRowsPerCommit (1000);
+      sink.SetMaxQueuedRows (1500);
+
+      uint32_t sinr = sink.RegisterTable ("sinr", {"CellId INTEGER NOT NULL",
+                                                   "AvgSinr DOUBLE NOT NULL"});
+      uint32_t slot = sink.RegisterTable ("slot", {"Frame INTEGER NOT NULL",
+                                                   "Slot INTEGER NOT NULL",
+                                                   "UsedSym INTEGER NOT NULL"});
+      for (uint32_t i = 0; i < rows; ++i)
+        {
+          sink.Insert (sinr, {static_cast<uint16_t> (i % 7), 0.5 * i});
+          if (i % 3 == 0)
+            {
+              sink.Insert (slot, {i, static_cast<uint8_t> (i % 8), 14});
+            }
+        }
+      sink.Flush ();
+
+      // Registering the tables again at the second iteration must have
+      // deleted the rows written during the first one
+      NS_TEST_ASSERT_MSG_EQ (QueryValue (&db, "SELECT COUNT(*) FROM sinr;"), rows,
+                             "Wrong number of rows in sinr");
+      NS_TEST_ASSERT_MSG_EQ (QueryValue (&db, "SELECT COUNT(*) FROM slot;"), (rows + 2) / 3,
+                             "Wrong number of rows in slot");
+      NS_TEST_ASSERT_MSG_EQ (QueryValue (&db, "SELECT SUM(AvgSinr) FROM sinr;"),
+                             0.25 * rows * (rows - 1), "Wrong values in sinr");
+      NS_TEST_ASSERT_MSG_EQ (QueryValue (&db, "SELECT SUM(UsedSym) FROM slot;"),
+                             14 * ((rows + 2) / 3), "Wrong values in slot");
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The SQLite stats sink test suite
+ */
+class NrTestSqliteStatsSink : public TestSuite
+{
+public:
+  NrTestSqliteStatsSink () : TestSuite ("nr-test-sqlite-stats-sink", UNIT)
+  {
+    AddTestCase (new NrSqliteStatsSinkTestCase (false), QUICK);
+    AddTestCase (new NrSqliteStatsSinkTestCase (true), QUICK);
+  }
+};
+
+static NrTestSqliteStatsSink NrTestSqliteStatsSinkSuite; //!< SQLite stats sink test suite
+
+}  // namespace ns3
@@ -0,0 +1,206 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/nstime.h>
+#include <ns3/uinteger.h>
+#include <ns3/nr-mac-scheduler-srs-adaptive.h>
+#include <ns3/nr-mac-scheduler-ue-info-rr.h>
+
+/**
+ * \file nr-test-srs-adaptive.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrMacSchedulerSrsAdaptive adapts the SRS
+ * periodicity of each UE: a new UE, or a UE whose beam changed in the last
+ * MobilityWindow, sends its SRS at every occurrence of its offset; a static
+ * UE with data in its DL or UL buffers at one out of ActivePeriodicityFactor
+ * occurrences; and a static idle UE at one out of IdlePeriodicityFactor.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the SRS periodicity factor of static, moving, active and idle UEs
+ */
+class NrSrsAdaptiveTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrSrsAdaptiveTestCase ()
+    : TestCase ("Adaptive SRS periodicity")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Check the periodicity factor of a UE, and the occurrences in
+   * which it sends its SRS
+   * \param ue the UE
+   * \param expected the expected periodicity factor
+   * \param what the state of the UE, for the messages
+   */
+  void Check (const std::shared_ptr<NrMacSchedulerUeInfo> &ue, uint32_t expected, const std::string &what);
+
+  /**
+   * \brief Create a UE with an (empty) DL and UL LCG
+   * \param rnti the RNTI of the UE
+   * \return the UE
+   */
+  static std::shared_ptr<NrMacSchedulerUeInfo> CreateUe (uint16_t rnti);
+
+  /**
+   * \brief Set the data in the buffers of a UE
+   * \param ue the UE
+   * \param dlBytes the bytes in the DL buffer
+   * \param ulBytes the bytes in the UL buffer
+   */
+  static void SetBuffers (const std::shared_ptr<NrMacSchedulerUeInfo> &ue, uint32_t dlBytes, uint32_t ulBytes);
+
+  Ptr<NrMacSchedulerSrsAdaptive> m_srs; //!< The SRS algorithm
+  const uint32_t m_activeFactor {2};    //!< ActivePeriodicityFactor
+  const uint32_t m_idleFactor {8};      //!< IdlePeriodicityFactor
+  const Time m_window {MilliSeconds (200)}; //!< MobilityWindow
+};
+
+std::shared_ptr<NrMacSchedulerUeInfo>
+NrSrsAdaptiveTestCase::CreateUe (uint16_t rnti)
+{
+  auto ue = std::make_shared<NrMacSchedulerUeInfoRR> (rnti, BeamConfId (BeamId (1, 90.0), BeamId::GetEmptyBeamId ()),
+                                                      [] () { return 1; });
+  for (auto direction : {LogicalChannelConfigListElement_s::DIR_DL, LogicalChannelConfigListElement_s::DIR_UL})
+    {
+      LogicalChannelConfigListElement_s conf;
+      conf.m_logicalChannelIdentity = 3;
+      conf.m_logicalChannelGroup = 1;
+      conf.m_direction = direction;
+      conf.m_qosBearerType = LogicalChannelConfigListElement_s::QBT_NON_GBR;
+      conf.m_qci = 9;
+      LCGPtr lcg (new NrMacSchedulerLCG (1));
+      lcg->Insert (std::unique_ptr<NrMacSchedulerLC> (new NrMacSchedulerLC (conf)));
+      auto &lcgs = direction == LogicalChannelConfigListElement_s::DIR_DL ? ue->m_dlLCG : ue->m_ulLCG;
+      lcgs.emplace (1, std::move (lcg));
+    }
+  return ue;
+}
+
+void
+NrSrsAdaptiveTestCase::SetBuffers (const std::shared_ptr<NrMacSchedulerUeInfo> &ue, uint32_t dlBytes, uint32_t ulBytes)
+{
+  NrMacSchedSapProvider::SchedDlRlcBufferReqParameters params;
+  params.m_rnti = ue->m_rnti;
+  params.m_logicalChannelIdentity = 3;
+  params.m_rlcTransmissionQueueSize = dlBytes;
+  params.m_rlcTransmissionQueueHolDelay = 0;
+  params.m_rlcRetransmissionQueueSize = 0;
+  params.m_rlcRetransmissionHolDelay = 0;
+  params.m_rlcStatusPduSize = 0;
+  ue->m_dlLCG.at (1)->UpdateInfo (params);
+  ue->m_ulLCG.at (1)->UpdateInfo (ulBytes);
+}
+
+void
+NrSrsAdaptiveTestCase::Check (const std::shared_ptr<NrMacSchedulerUeInfo> &ue, uint32_t expected,
+                              const std::string &what)
+{
+  NS_TEST_EXPECT_MSG_EQ (m_srs->GetPeriodicityFactor (ue), expected,
+                         "Wrong periodicity factor of UE " << ue->m_rnti << " " << what <<
+                         " at " << Simulator::Now ().As (Time::MS));
+
+  // Over 16 occurrences of its offset, the UE sends 16 / factor SRS, at
+  // the occurrences multiple of the factor
+  uint32_t sent = 0;
+  for (uint32_t occurrence = 0; occurrence < 16; ++occurrence)
+    {
+      bool srs = m_srs->IsSrsOccurrence (ue, occurrence);
+      NS_TEST_EXPECT_MSG_EQ (srs, occurrence % expected == 0,
+                             "Wrong SRS at occurrence " << occurrence << " of UE " << ue->m_rnti << " " << what);
+      sent += srs ? 1 : 0;
+    }
+  NS_TEST_EXPECT_MSG_EQ (sent, 16 / expected, "Wrong number of SRS of UE " << ue->m_rnti << " " << what);
+}
+
+void
+NrSrsAdaptiveTestCase::DoRun ()
+{
+  m_srs = CreateObject<NrMacSchedulerSrsAdaptive> ();
+  m_srs->SetAttribute ("ActivePeriodicityFactor", UintegerValue (m_activeFactor));
+  m_srs->SetAttribute ("IdlePeriodicityFactor", UintegerValue (m_idleFactor));
+  m_srs->SetAttribute ("MobilityWindow", TimeValue (m_window));
+
+  auto ue = CreateUe (1);
+  auto other = CreateUe (2);
+
+  // A new UE counts as moving for a MobilityWindow
+  Simulator::Schedule (MilliSeconds (0), &NrSrsAdaptiveTestCase::Check, this, ue, 1, "new");
+  Simulator::Schedule (MilliSeconds (0), &NrSrsAdaptiveTestCase::Check, this, other, 1, "new");
+  Simulator::Schedule (m_window - MilliSeconds (10), &NrSrsAdaptiveTestCase::Check, this, ue, 1,
+                       "new, within the window");
+
+  // Static and idle, then with DL data, then with UL data only
+  Simulator::Schedule (MilliSeconds (250), &NrSrsAdaptiveTestCase::Check, this, ue, m_idleFactor, "static, idle");
+  Simulator::Schedule (MilliSeconds (260), &NrSrsAdaptiveTestCase::SetBuffers, ue, 1000, 0);
+  Simulator::Schedule (MilliSeconds (260), &NrSrsAdaptiveTestCase::Check, this, ue, m_activeFactor,
+                       "static, DL data");
+  Simulator::Schedule (MilliSeconds (270), &NrSrsAdaptiveTestCase::SetBuffers, ue, 0, 500);
+  Simulator::Schedule (MilliSeconds (270), &NrSrsAdaptiveTestCase::Check, this, ue, m_activeFactor,
+                       "static, UL data");
+
+  // A new beam: moving for a MobilityWindow from the change, whatever the data
+  Simulator::Schedule (MilliSeconds (280), [ue] ()
+                       { ue->m_beamConfId = BeamConfId (BeamId (2, 90.0), BeamId::GetEmptyBeamId ()); });
+  Simulator::Schedule (MilliSeconds (280), &NrSrsAdaptiveTestCase::Check, this, ue, 1, "moving");
+  Simulator::Schedule (MilliSeconds (280) + m_window - MilliSeconds (10), &NrSrsAdaptiveTestCase::Check,
+                       this, ue, 1, "moving, within the window");
+  Simulator::Schedule (MilliSeconds (280) + m_window + MilliSeconds (10), &NrSrsAdaptiveTestCase::Check,
+                       this, ue, m_activeFactor, "static again, UL data");
+  Simulator::Schedule (MilliSeconds (500), &NrSrsAdaptiveTestCase::SetBuffers, ue, 0, 0);
+  Simulator::Schedule (MilliSeconds (500), &NrSrsAdaptiveTestCase::Check, this, ue, m_idleFactor,
+                       "static again, idle");
+
+  // The other UE did not change
+  Simulator::Schedule (MilliSeconds (500), &NrSrsAdaptiveTestCase::Check, this, other, m_idleFactor,
+                       "static, idle");
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+  m_srs = nullptr;
+}
+
+/**
+ * \ingroup test
+ * \brief The adaptive SRS test suite
+ */
+class NrTestSrsAdaptiveSuite : public TestSuite
+{
+public:
+  NrTestSrsAdaptiveSuite () : TestSuite ("nr-test-srs-adaptive", UNIT)
+  {
+    AddTestCase (new NrSrsAdaptiveTestCase (), QUICK);
+  }
+};
+
+static NrTestSrsAdaptiveSuite nrTestSrsAdaptiveSuite; //!< Adaptive SRS test suite
+
+}  // namespace ns3
@@ -0,0 +1,345 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/string.h>
+#include <ns3/enum.h>
+#include <ns3/nr-trace-file.h>
+#include <ns3/nr-bearer-stats-calculator.h>
+#include <ns3/nr-mac-rx-trace.h>
+#include <ns3/nr-control-messages.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#ifdef NR_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef NR_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+/**
+ * \file nr-test-trace-compression.cc
+ * \ingroup test
+ *
+ * \brief This test writes text through NrTraceFile with each compression
+ * available in the build, decompresses the file with zlib or zstd, and
+ * compares the result with the text. The text spans several 64 KiB blocks,
+ * is flushed while written (a flush must not write a block), and is
+ * appended to in a second member or frame. It also checks the files of
+ * NrBearerStatsCalculator and NrMacRxTrace, which stay open during the
+ * simulation and are completed when closed.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Read a file written by NrTraceFile, and decompress it
+ * \param fileName the name of the file, with the extension
+ * \param compression the compression of the file
+ * \param [out] text the decompressed text
+ * \return false if the file could not be read or decompressed
+ */
+static bool
+ReadTraceFile (const std::string &fileName, NrTraceFile::Compression compression, std::string *text)
+{
+  std::ifstream file (fileName, std::ios_base::binary);
+  if (!file.is_open ())
+    {
+      return false;
+    }
+  std::string data ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+  text->clear ();
+  std::vector<char> out (16 * 1024);
+
+  if (compression == NrTraceFile::NONE)
+    {
+      *text = data;
+      return true;
+    }
+#ifdef NR_WITH_ZLIB
+  if (compression == NrTraceFile::GZIP)
+    {
+      z_stream zlib = z_stream ();
+      // 15 + 16: gzip header and trailer, as written by NrTraceFile
+      if (inflateInit2 (&zlib, 15 + 16) != Z_OK)
+        {
+          return false;
+        }
+      zlib.next_in = reinterpret_cast<Bytef *> (&data[0]);
+      zlib.avail_in = static_cast<uInt> (data.size ());
+      bool ok = true;
+      while (ok && zlib.avail_in > 0)
+        {
+          zlib.next_out = reinterpret_cast<Bytef *> (out.data ());
+          zlib.avail_out = static_cast<uInt> (out.size ());
+          int ret = inflate (&zlib, Z_NO_FLUSH);
+          text->append (out.data (), out.size () - zlib.avail_out);
+          if (ret == Z_STREAM_END)
+            {
+              // The next gzip member, if any, written in append mode
+              ok = inflateReset (&zlib) == Z_OK;
+            }
+          else
+            {
+              ok = ret == Z_OK;
+            }
+        }
+      inflateEnd (&zlib);
+      return ok;
+    }
+#endif
+#ifdef NR_WITH_ZSTD
+  if (compression == NrTraceFile::ZSTD)
+    {
+      ZSTD_DCtx *zstd = ZSTD_createDCtx ();
+      ZSTD_inBuffer in {data.data (), data.size (), 0};
+      size_t ret = 0;
+      while (in.pos < in.size)
+        {
+          ZSTD_outBuffer outBuf {out.data (), out.size (), 0};
+          ret = ZSTD_decompressStream (zstd, &outBuf, &in);
+          if (ZSTD_isError (ret))
+            {
+              break;
+            }
+          text->append (out.data (), outBuf.pos);
+        }
+      ZSTD_freeDCtx (zstd);
+      // 0: the last frame is complete
+      return ret == 0;
+    }
+#endif
+  return false;
+}
+
+/**
+ * \ingroup test
+ * \param fileName the name of a file
+ * \return the size of the file, or 0 if it does not exist
+ */
+static uint64_t
+GetFileSize (const std::string &fileName)
+{
+  std::ifstream file (fileName, std::ios_base::binary | std::ios_base::ate);
+  return file.is_open () ? static_cast<uint64_t> (file.tellg ()) : 0;
+}
+
+/**
+ * \ingroup test
+ * \param text a text
+ * \return the number of lines of the text
+ */
+static uint32_t
+CountLines (const std::string &text)
+{
+  std::istringstream stream (text);
+  std::string line;
+  uint32_t lines = 0;
+  while (std::getline (stream, line))
+    {
+      ++lines;
+    }
+  return lines;
+}
+
+/**
+ * \ingroup test
+ * \brief Write, append to and read back a file of NrTraceFile
+ */
+class NrTraceFileRoundTripTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param compression the compression of the file
+   */
+  NrTraceFileRoundTripTestCase (NrTraceFile::Compression compression)
+    : TestCase ("NrTraceFile round trip, compression " + std::to_string (compression)),
+    m_compression (compression)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  NrTraceFile::Compression m_compression; //!< Compression of the file
+};
+
+void
+NrTraceFileRoundTripTestCase::DoRun ()
+{
+  std::string baseName = CreateTempDirFilename ("nr-test-trace-compression.txt");
+  std::string fileName = baseName + NrTraceFile::GetExtension (m_compression);
+  std::ostringstream expected;
+
+  NrTraceFile file;
+  file.open (baseName, m_compression);
+  NS_TEST_ASSERT_MSG_EQ (file.is_open (), true, "File not open");
+  NS_TEST_ASSERT_MSG_EQ (file.GetCompression (), m_compression, "Wrong compression");
+
+  // A flush does not write a compressed block
+  file << "header\tline" << std::endl;
+  expected << "header\tline" << std::endl;
+  file.flush ();
+  if (m_compression != NrTraceFile::NONE)
+    {
+      NS_TEST_ASSERT_MSG_EQ (GetFileSize (fileName), 0, "A flush wrote a compressed block");
+    }
+
+  // About 550 KiB, in several blocks, flushed at each line
+  for (uint32_t i = 0; i < 20000; ++i)
+    {
+      file << i << "\t" << i * 0.25 << "\tsome trace text" << std::endl;
+      expected << i << "\t" << i * 0.25 << "\tsome trace text" << std::endl;
+    }
+  NS_TEST_ASSERT_MSG_EQ (file.good (), true, "Write error");
+  if (m_compression != NrTraceFile::NONE)
+    {
+      NS_TEST_ASSERT_MSG_GT (GetFileSize (fileName), 0, "No block written before the close");
+    }
+  file.close ();
+  NS_TEST_ASSERT_MSG_EQ (file.is_open (), false, "File still open");
+  NS_TEST_ASSERT_MSG_EQ (file.good (), true, "Close error");
+
+  std::string text;
+  NS_TEST_ASSERT_MSG_EQ (ReadTraceFile (fileName, m_compression, &text), true,
+                         "The file could not be decompressed");
+  NS_TEST_ASSERT_MSG_EQ ((text == expected.str ()), true, "Wrong text after the round trip");
+  if (m_compression != NrTraceFile::NONE)
+    {
+      NS_TEST_ASSERT_MSG_LT (GetFileSize (fileName), expected.str ().size (), "The file is not compressed");
+    }
+
+  // Append mode: a second gzip member or zstd frame, closed by the destructor
+  {
+    NrTraceFile appended;
+    appended.open (baseName, m_compression, std::ios_base::app);
+    NS_TEST_ASSERT_MSG_EQ (appended.is_open (), true, "File not open in append mode");
+    appended << "appended line" << std::endl;
+    expected << "appended line" << std::endl;
+  }
+  NS_TEST_ASSERT_MSG_EQ (ReadTraceFile (fileName, m_compression, &text), true,
+                         "The appended file could not be decompressed");
+  NS_TEST_ASSERT_MSG_EQ ((text == expected.str ()), true, "Wrong text after the append");
+
+  std::remove (fileName.c_str ());
+}
+
+/**
+ * \ingroup test
+ * \brief Check the compressed files of the bearer stats and of the MAC
+ * control messages, which are written when the files are closed
+ */
+class NrStatsCompressionTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param compression the compression of the files
+   */
+  NrStatsCompressionTestCase (NrTraceFile::Compression compression)
+    : TestCase ("Compressed stats files, compression " + std::to_string (compression)),
+    m_compression (compression)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  NrTraceFile::Compression m_compression; //!< Compression of the files
+};
+
+void
+NrStatsCompressionTestCase::DoRun ()
+{
+  std::string extension = NrTraceFile::GetExtension (m_compression);
+  std::string dlFileName = CreateTempDirFilename ("nr-test-trace-compression-dl.txt");
+  std::string ulFileName = CreateTempDirFilename ("nr-test-trace-compression-ul.txt");
+
+  Ptr<NrBearerStatsCalculator> stats = CreateObject<NrBearerStatsCalculator> ();
+  stats->SetAttribute ("DlRlcOutputFilename", StringValue (dlFileName));
+  stats->SetAttribute ("UlRlcOutputFilename", StringValue (ulFileName));
+  stats->SetAttribute ("Compression", EnumValue (m_compression));
+  stats->DlTxPdu (1, 7, 2, 3, 100);
+  stats->DlRxPdu (1, 7, 2, 3, 100, 1000);
+  stats->UlTxPdu (2, 8, 5, 4, 50);
+
+  // The pending output is written, and the files closed, at the disposal
+  stats->Dispose ();
+  std::string text;
+  NS_TEST_ASSERT_MSG_EQ (ReadTraceFile (dlFileName + extension, m_compression, &text), true,
+                         "The DL file could not be decompressed");
+  NS_TEST_ASSERT_MSG_EQ (CountLines (text), 2, "Wrong number of DL lines");
+  NS_TEST_ASSERT_MSG_EQ (text.compare (0, 10, "% start(s)"), 0, "Wrong DL header");
+  NS_TEST_ASSERT_MSG_EQ (ReadTraceFile (ulFileName + extension, m_compression, &text), true,
+                         "The UL file could not be decompressed");
+  NS_TEST_ASSERT_MSG_EQ (CountLines (text), 2, "Wrong number of UL lines");
+  std::remove ((dlFileName + extension).c_str ());
+  std::remove ((ulFileName + extension).c_str ());
+
+  // The MAC files stay open until the last NrMacRxTrace is destroyed; the
+  // text spans several blocks
+  std::string macFileName = "RxedGnbMacCtrlMsgsTrace.txt" + extension;
+  Ptr<NrMacRxTrace> macStats = CreateObject<NrMacRxTrace> ();
+  macStats->SetAttribute ("Compression", EnumValue (m_compression));
+  Ptr<const NrControlMessage> msg = Create<NrSRMessage> ();
+  const uint32_t numMsgs = 3000;
+  for (uint32_t i = 0; i < numMsgs; ++i)
+    {
+      NrMacRxTrace::RxedGnbMacCtrlMsgsCallback (macStats, "", SfnSf (i / 40, (i / 4) % 10, i % 4, 2),
+                                                1, 1 + i % 10, 0, msg);
+    }
+  macStats = nullptr;
+  NS_TEST_ASSERT_MSG_EQ (ReadTraceFile (macFileName, m_compression, &text), true,
+                         "The MAC file could not be decompressed");
+  NS_TEST_ASSERT_MSG_EQ (CountLines (text), numMsgs + 1, "Wrong number of MAC lines");
+  NS_TEST_ASSERT_MSG_EQ (text.compare (text.size () - 3, 3, "SR\n"), 0, "Wrong last MAC line");
+  std::remove (macFileName.c_str ());
+}
+
+/**
+ * \ingroup test
+ * \brief The compressed trace test suite
+ */
+class NrTestTraceCompressionSuite : public TestSuite
+{
+public:
+  NrTestTraceCompressionSuite () : TestSuite ("nr-test-trace-compression", UNIT)
+  {
+    std::vector<NrTraceFile::Compression> compressions {NrTraceFile::NONE};
+#ifdef NR_WITH_ZLIB
+    compressions.push_back (NrTraceFile::GZIP);
+#endif
+#ifdef NR_WITH_ZSTD
+    compressions.push_back (NrTraceFile::ZSTD);
+#endif
+    for (const auto & compression : compressions)
+      {
+        AddTestCase (new NrTraceFileRoundTripTestCase (compression), QUICK);
+        AddTestCase (new NrStatsCompressionTestCase (compression), QUICK);
+      }
+  }
+};
+
+static NrTestTraceCompressionSuite nrTestTraceCompressionSuite; //!< Compressed trace test suite
+
+}  // namespace ns3
@@ -0,0 +1,233 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/string.h>
+#include <ns3/nr-trace-filter.h>
+#include <ns3/nr-mac-scheduling-stats.h>
+#include <fstream>
+#include <sstream>
+
+/**
+ * \file nr-test-trace-filter.cc
+ * \ingroup test
+ *
+ * \brief This test checks the selection of NrTraceFilter (allow-lists of
+ * IMSIs, cells and BWPs, and sampling of the UEs), and that
+ * NrMacSchedulingStats writes the scheduling records of the selected UEs
+ * only.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the UEs, cells and BWPs selected by NrTraceFilter
+ */
+class NrTraceFilterSelectionTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrTraceFilterSelectionTestCase ()
+    : TestCase ("NrTraceFilter selection")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrTraceFilterSelectionTestCase::DoRun ()
+{
+  // Empty: everything is selected
+  NrTraceFilter filter;
+  NS_TEST_ASSERT_MSG_EQ (filter.FiltersImsi (), false, "An empty filter filters the UEs");
+  for (uint64_t imsi = 1; imsi < 10; ++imsi)
+    {
+      NS_TEST_ASSERT_MSG_EQ (filter.SelectsImsi (imsi), true, "An empty filter dropped IMSI " << imsi);
+    }
+  NS_TEST_ASSERT_MSG_EQ (filter.SelectsCell (7), true, "An empty filter dropped a cell");
+  NS_TEST_ASSERT_MSG_EQ (filter.SelectsBwp (3), true, "An empty filter dropped a BWP");
+
+  // One UE out of three: the IMSIs 1, 4, 7...
+  filter.m_samplingPeriod = 3;
+  NS_TEST_ASSERT_MSG_EQ (filter.FiltersImsi (), true, "The sampling does not filter the UEs");
+  for (uint64_t imsi = 1; imsi < 10; ++imsi)
+    {
+      NS_TEST_ASSERT_MSG_EQ (filter.SelectsImsi (imsi), (imsi - 1) % 3 == 0, "Wrong sampling of IMSI " << imsi);
+    }
+  NS_TEST_ASSERT_MSG_EQ (filter.SelectsImsi (0), false, "A UE without IMSI is selected");
+
+  // Both the list and the sampling must select the UE
+  filter.m_imsis = {4, 5};
+  for (uint64_t imsi = 1; imsi < 10; ++imsi)
+    {
+      NS_TEST_ASSERT_MSG_EQ (filter.SelectsImsi (imsi), imsi == 4, "Wrong selection of IMSI " << imsi);
+    }
+  filter.m_samplingPeriod = 1;
+  for (uint64_t imsi = 1; imsi < 10; ++imsi)
+    {
+      NS_TEST_ASSERT_MSG_EQ (filter.SelectsImsi (imsi), imsi == 4 || imsi == 5, "Wrong selection of IMSI " << imsi);
+    }
+
+  filter.m_cellIds = {1, 2};
+  filter.m_bwpIds = {0};
+  NS_TEST_ASSERT_MSG_EQ (filter.SelectsCell (2), true, "Selected cell dropped");
+  NS_TEST_ASSERT_MSG_EQ (filter.SelectsCell (3), false, "Other cell selected");
+  NS_TEST_ASSERT_MSG_EQ (filter.SelectsBwp (0), true, "Selected BWP dropped");
+  NS_TEST_ASSERT_MSG_EQ (filter.SelectsBwp (1), false, "Other BWP selected");
+}
+
+/**
+ * \ingroup test
+ * \brief Check that NrMacSchedulingStats writes the records of the selected UEs only
+ */
+class NrTraceFilterMacStatsTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param filterImsi true to select the IMSI 2 only
+   * \param name the name of the test case
+   */
+  NrTraceFilterMacStatsTestCase (bool filterImsi, const std::string &name)
+    : TestCase (name),
+    m_filterImsi (filterImsi)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Read the IMSI column of a scheduling statistics file
+   * \param fileName the file
+   * \return the IMSI of each record, in order
+   */
+  static std::vector<uint64_t> ReadImsis (const std::string &fileName);
+
+  bool m_filterImsi; //!< True to select the IMSI 2 only
+};
+
+std::vector<uint64_t>
+NrTraceFilterMacStatsTestCase::ReadImsis (const std::string &fileName)
+{
+  std::vector<uint64_t> imsis;
+  std::ifstream file (fileName);
+  std::string line;
+  while (std::getline (file, line))
+    {
+      if (line.empty () || line[0] == '%')
+        {
+          continue;
+        }
+      // time, cellId, bwpId, IMSI
+      std::istringstream fields (line);
+      double time;
+      uint32_t cellId;
+      uint32_t bwpId;
+      uint64_t imsi;
+      fields >> time >> cellId >> bwpId >> imsi;
+      imsis.push_back (imsi);
+    }
+  return imsis;
+}
+
+void
+NrTraceFilterMacStatsTestCase::DoRun ()
+{
+  std::string dlFileName = CreateTempDirFilename ("nr-test-trace-filter-dl.txt");
+  std::string ulFileName = CreateTempDirFilename ("nr-test-trace-filter-ul.txt");
+  Ptr<NrMacSchedulingStats> macStats = CreateObject<NrMacSchedulingStats> ();
+  macStats->SetAttribute ("DlOutputFilename", StringValue (dlFileName));
+  macStats->SetAttribute ("UlOutputFilename", StringValue (ulFileName));
+  if (m_filterImsi)
+    {
+      NrTraceFilter filter;
+      filter.m_imsis = {2};
+      macStats->SetTraceFilter (filter);
+    }
+
+  // The RNTIs 1, 2 and 3 of the cell 1 are the IMSIs 1, 2 and 3
+  const uint16_t cellId = 1;
+  for (uint16_t rnti = 1; rnti <= 3; ++rnti)
+    {
+      macStats->SetImsi (cellId, rnti, rnti);
+    }
+  for (uint16_t slot = 0; slot < 4; ++slot)
+    {
+      for (uint16_t rnti = 1; rnti <= 3; ++rnti)
+        {
+          NrSchedulingCallbackInfo info;
+          info.m_frameNum = 0;
+          info.m_subframeNum = 0;
+          info.m_slotNum = slot;
+          info.m_symStart = 1;
+          info.m_numSym = 4;
+          info.m_streamId = 0;
+          info.m_rnti = rnti;
+          info.m_mcs = 10;
+          info.m_tbSize = 1000;
+          info.m_bwpId = 0;
+          info.m_ndi = 1;
+          info.m_rv = 0;
+          info.m_harqId = 0;
+          info.m_numRbg = 5;
+          NrMacSchedulingStats::DlSchedulingCellCallback (macStats, cellId, info);
+          NrMacSchedulingStats::UlSchedulingCellCallback (macStats, cellId, info);
+        }
+    }
+  macStats->Dispose ();
+  macStats = nullptr;
+
+  std::vector<uint64_t> expected;
+  for (uint16_t slot = 0; slot < 4; ++slot)
+    {
+      for (uint64_t imsi = 1; imsi <= 3; ++imsi)
+        {
+          if (!m_filterImsi || imsi == 2)
+            {
+              expected.push_back (imsi);
+            }
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ ((ReadImsis (dlFileName) == expected), true, "Wrong DL records");
+  NS_TEST_ASSERT_MSG_EQ ((ReadImsis (ulFileName) == expected), true, "Wrong UL records");
+}
+
+/**
+ * \ingroup test
+ * \brief The trace filter test suite
+ */
+class NrTestTraceFilterSuite : public TestSuite
+{
+public:
+  NrTestTraceFilterSuite () : TestSuite ("nr-test-trace-filter", UNIT)
+  {
+    AddTestCase (new NrTraceFilterSelectionTestCase (), QUICK);
+    AddTestCase (new NrTraceFilterMacStatsTestCase (false, "Scheduling records without filter"), QUICK);
+    AddTestCase (new NrTraceFilterMacStatsTestCase (true, "Scheduling records of the selected UE"), QUICK);
+  }
+};
+
+static NrTestTraceFilterSuite nrTestTraceFilterSuite; //!< Trace filter test suite
+
+}  // namespace ns3
@@ -0,0 +1,292 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/core-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/nr-module.h>
+
+/**
+ * \file nr-test-ue-idle-monitoring.cc
+ * \ingroup test
+ *
+ * \brief This test checks the monitoring occasions of an idle UE (attribute
+ * IdleMonitoringPeriodicity of NrUePhy), without traffic after the attach:
+ * the UE receives only in the slots IdleMonitoringOffset modulo the period,
+ * its DL CQI reports are IdleCqiPeriodicity slots apart, and a WakeUp during
+ * an occasion keeps the UE awake until the inactivity timer expires again,
+ * after which the occasions restart at the same slots.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Check the monitoring occasions of an idle UE
+ */
+class NrUeIdleMonitoringTestCase : public TestCase
+{
+public:
+  /**
+   * \brief What the test case checks
+   */
+  enum Mode
+  {
+    OCCASIONS, //!< The slots of the occasions
+    CQI,       //!< The period of the DL CQI reports
+    WAKE_UP    //!< A WakeUp during an occasion
+  };
+
+  /**
+   * \brief Constructor
+   * \param mode what the test case checks
+   * \param name the name of the test case
+   */
+  NrUeIdleMonitoringTestCase (Mode mode, const std::string &name)
+    : TestCase (name),
+    m_mode (mode)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Sample the state of the UE in the middle of a slot
+   */
+  void Probe ();
+
+  /**
+   * \brief Record the DL CQI reports sent by the UE
+   * \param sfn the slot of the transmission
+   * \param nodeId the cell ID
+   * \param rnti the RNTI of the UE
+   * \param bwpId the BWP ID
+   * \param msg the message
+   */
+  void TxedCtrlMsg (SfnSf sfn, uint16_t nodeId, uint16_t rnti, uint8_t bwpId, Ptr<NrControlMessage> msg);
+
+  /**
+   * \brief Check that the occasions are one period apart, at the offset
+   * \param occasions the slots of the occasions
+   * \param what the occasions checked, for the messages
+   */
+  void CheckOccasions (const std::vector<uint64_t> &occasions, const std::string &what);
+
+  Mode m_mode;                          //!< What the test case checks
+  Ptr<NrUePhy> m_uePhy;                 //!< The PHY of the UE
+  const uint16_t m_periodicity {8};     //!< IdleMonitoringPeriodicity
+  const uint16_t m_offset {3};          //!< IdleMonitoringOffset
+  const uint16_t m_cqiPeriodicity {20}; //!< IdleCqiPeriodicity
+  const Time m_inactivityTimer {MilliSeconds (50)}; //!< InactivityTimer
+  const Time m_checkStart {MilliSeconds (300)};     //!< Start of the checks, once the UE is idle
+  Time m_wakeUpTime;                    //!< Moment of the WakeUp, in WAKE_UP mode
+  std::vector<uint64_t> m_occasions;    //!< Occasions seen before the WakeUp
+  std::vector<uint64_t> m_occasionsAfter; //!< Occasions seen once idle again after the WakeUp
+  std::vector<uint64_t> m_cqiSlots;     //!< Slots of the DL CQI reports
+  uint32_t m_idleProbes {0};            //!< Probes with the UE idle and not receiving
+  uint32_t m_awakeProbes {0};           //!< Probes with the UE awake
+};
+
+void
+NrUeIdleMonitoringTestCase::Probe ()
+{
+  Time now = Simulator::Now ();
+  bool idle = m_uePhy->IsIdle ();
+  bool rx = m_uePhy->GetSpectrumPhy ()->IsRxEnabled ();
+  uint64_t slot = m_uePhy->GetCurrentSfnSf ().Normalize ();
+
+  if (m_mode == WAKE_UP && !m_wakeUpTime.IsZero ())
+    {
+      if (now < m_wakeUpTime + m_inactivityTimer - MilliSeconds (2))
+        {
+          // Awake, and receiving, until the inactivity timer expires
+          NS_TEST_EXPECT_MSG_EQ (idle, false, "Idle at " << now << " after the WakeUp");
+          NS_TEST_EXPECT_MSG_EQ (rx, true, "Not receiving at " << now << " after the WakeUp");
+          ++m_awakeProbes;
+        }
+      else if (now > m_wakeUpTime + m_inactivityTimer + MilliSeconds (20) && idle && rx)
+        {
+          m_occasionsAfter.push_back (slot);
+        }
+      return;
+    }
+
+  if (idle && rx)
+    {
+      m_occasions.push_back (slot);
+      if (m_mode == WAKE_UP)
+        {
+          m_uePhy->WakeUp ();
+          m_wakeUpTime = now;
+          NS_TEST_EXPECT_MSG_EQ (m_uePhy->IsIdle (), false, "Still idle after the WakeUp");
+          NS_TEST_EXPECT_MSG_EQ (m_uePhy->GetSpectrumPhy ()->IsRxEnabled (), true, "Not receiving after the WakeUp");
+        }
+    }
+  else if (idle)
+    {
+      ++m_idleProbes;
+    }
+  else if (m_mode == OCCASIONS)
+    {
+      // Without traffic nor CQI reports, the UE runs only the occasions
+      NS_TEST_EXPECT_MSG_EQ (idle, true, "The UE woke up at " << now);
+    }
+}
+
+void
+NrUeIdleMonitoringTestCase::TxedCtrlMsg (SfnSf sfn, [[maybe_unused]] uint16_t nodeId,
+                                         [[maybe_unused]] uint16_t rnti, [[maybe_unused]] uint8_t bwpId,
+                                         Ptr<NrControlMessage> msg)
+{
+  if (msg->GetMessageType () == NrControlMessage::DL_CQI && Simulator::Now () >= m_checkStart)
+    {
+      m_cqiSlots.push_back (sfn.Normalize ());
+    }
+}
+
+void
+NrUeIdleMonitoringTestCase::CheckOccasions (const std::vector<uint64_t> &occasions, const std::string &what)
+{
+  NS_TEST_ASSERT_MSG_GT (occasions.size (), 2U, "Too few " << what);
+  for (size_t i = 0; i < occasions.size (); ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (occasions[i] % m_periodicity, m_offset, "Wrong slot of the " << what << " " << i);
+      if (i > 0)
+        {
+          NS_TEST_ASSERT_MSG_EQ (occasions[i] - occasions[i - 1], m_periodicity, "Missing " << what << " before " << i);
+        }
+    }
+}
+
+void
+NrUeIdleMonitoringTestCase::DoRun ()
+{
+  Config::SetDefault ("ns3::ThreeGppChannelModel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+
+  NodeContainer gnbNodes;
+  NodeContainer ueNodes;
+  gnbNodes.Create (1);
+  ueNodes.Create (1);
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.Install (gnbNodes);
+  mobility.Install (ueNodes);
+  gnbNodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (0, 0, 10));
+  ueNodes.Get (0)->GetObject<MobilityModel> ()->SetPosition (Vector (20, 0, 1.5));
+
+  Ptr<NrPointToPointEpcHelper> epcHelper = CreateObject<NrPointToPointEpcHelper> ();
+  Ptr<NrHelper> nrHelper = CreateObject<NrHelper> ();
+  nrHelper->SetEpcHelper (epcHelper);
+
+  CcBwpCreator ccBwpCreator;
+  CcBwpCreator::SimpleOperationBandConf bandConf (2e9, 20e6, 1, BandwidthPartInfo::UMa_LoS);
+  OperationBandInfo band = ccBwpCreator.CreateOperationBandContiguousCc (bandConf);
+  nrHelper->SetPathlossAttribute ("ShadowingEnabled", BooleanValue (false));
+  nrHelper->InitializeOperationBand (&band);
+  BandwidthPartInfoPtrVector allBwps = CcBwpCreator::GetAllBwps ({band});
+
+  // Numerology 0: the slots are the subframes, and the gNB sends the MIB
+  // or the SIB1 in the slots 0 modulo 5
+  nrHelper->SetGnbPhyAttribute ("Numerology", UintegerValue (0));
+  nrHelper->SetUePhyAttribute ("InactivityTimer", TimeValue (m_inactivityTimer));
+  if (m_mode == CQI)
+    {
+      // Occasions with a DL CTRL, so that each has a CQI to report
+      nrHelper->SetUePhyAttribute ("IdleMonitoringPeriodicity", UintegerValue (5));
+      nrHelper->SetUePhyAttribute ("IdleMonitoringOffset", UintegerValue (0));
+      nrHelper->SetUePhyAttribute ("IdleCqiPeriodicity", UintegerValue (m_cqiPeriodicity));
+    }
+  else
+    {
+      nrHelper->SetUePhyAttribute ("IdleMonitoringPeriodicity", UintegerValue (m_periodicity));
+      nrHelper->SetUePhyAttribute ("IdleMonitoringOffset", UintegerValue (m_offset));
+    }
+
+  NetDeviceContainer gnbDevices = nrHelper->InstallGnbDevice (gnbNodes, allBwps);
+  NetDeviceContainer ueDevices = nrHelper->InstallUeDevice (ueNodes, allBwps);
+  int64_t randomStream = 1;
+  randomStream += nrHelper->AssignStreams (gnbDevices, randomStream);
+  nrHelper->AssignStreams (ueDevices, randomStream);
+
+  InternetStackHelper internet;
+  internet.Install (ueNodes);
+  epcHelper->AssignUeIpv4Address (ueDevices);
+  nrHelper->AttachToEnb (ueDevices.Get (0), gnbDevices.Get (0));
+
+  m_uePhy = DynamicCast<NrUeNetDevice> (ueDevices.Get (0))->GetPhy (0);
+  m_uePhy->TraceConnectWithoutContext ("UePhyTxedCtrlMsgsTrace",
+                                       MakeCallback (&NrUeIdleMonitoringTestCase::TxedCtrlMsg, this));
+
+  // A probe in the middle of each slot
+  const Time end = MilliSeconds (700);
+  for (Time t = m_checkStart + MicroSeconds (500); t < end; t += MilliSeconds (1))
+    {
+      Simulator::Schedule (t, &NrUeIdleMonitoringTestCase::Probe, this);
+    }
+  Simulator::Stop (end);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  m_uePhy = nullptr;
+
+  NS_TEST_ASSERT_MSG_GT (m_idleProbes, 0U, "The UE never became idle");
+  if (m_mode == OCCASIONS)
+    {
+      CheckOccasions (m_occasions, "occasion");
+    }
+  else if (m_mode == CQI)
+    {
+      NS_TEST_ASSERT_MSG_GT (m_cqiSlots.size (), 2U, "Too few DL CQI reports");
+      for (size_t i = 1; i < m_cqiSlots.size (); ++i)
+        {
+          NS_TEST_ASSERT_MSG_EQ (m_cqiSlots[i] - m_cqiSlots[i - 1], m_cqiPeriodicity,
+                                 "Wrong interval before the DL CQI report " << i);
+        }
+    }
+  else
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_occasions.size (), 1U, "The WakeUp did not happen in the first occasion");
+      NS_TEST_ASSERT_MSG_GT (m_awakeProbes, 40U, "The UE did not stay awake");
+      CheckOccasions (m_occasionsAfter, "occasion after the WakeUp");
+      NS_TEST_ASSERT_MSG_EQ ((m_occasionsAfter.front () - m_occasions.front ()) % m_periodicity, 0U,
+                             "The occasions moved after the WakeUp");
+    }
+}
+
+/**
+ * \ingroup test
+ * \brief The UE idle monitoring test suite
+ */
+class NrTestUeIdleMonitoringSuite : public TestSuite
+{
+public:
+  NrTestUeIdleMonitoringSuite () : TestSuite ("nr-test-ue-idle-monitoring", SYSTEM)
+  {
+    AddTestCase (new NrUeIdleMonitoringTestCase (NrUeIdleMonitoringTestCase::OCCASIONS,
+                                                 "Monitoring occasions of an idle UE"), QUICK);
+    AddTestCase (new NrUeIdleMonitoringTestCase (NrUeIdleMonitoringTestCase::CQI,
+                                                 "DL CQI reports of an idle UE"), QUICK);
+    AddTestCase (new NrUeIdleMonitoringTestCase (NrUeIdleMonitoringTestCase::WAKE_UP,
+                                                 "WakeUp during a monitoring occasion"), QUICK);
+  }
+};
+
+static NrTestUeIdleMonitoringSuite nrTestUeIdleMonitoringSuite; //!< UE idle monitoring test suite
+
+}  // namespace ns3
@@ -0,0 +1,124 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-ue-lcp.h>
+
+/**
+ * \file nr-test-ue-lcp.cc
+ * \ingroup test
+ *
+ * \brief This test checks the logical channel prioritization of NrUeLcp:
+ * a low priority LC gets its prioritized bit rate under a saturating high
+ * priority LC, the buckets are capped at PBR * BSD, no fraction of byte is
+ * lost in the refill, and the LCs with the same priority share equally.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Grants of 1000 B every ms to two saturated LCs
+ */
+class NrUeLcpTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrUeLcpTestCase ()
+    : TestCase ("Logical channel prioritization with token buckets")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrUeLcpTestCase::DoRun ()
+{
+  NrUeLcp lcp;
+  // LC 1: priority 1, 10 B/ms up to 500 B; LC 2: priority 2, 100 B/ms up to 1000 B
+  lcp.AddLc (1, 1, 80, 50, 0);
+  lcp.AddLc (2, 2, 800, 10, 0);
+  const std::map<uint8_t, uint32_t> saturated = {{1, 100000}, {2, 100000}};
+
+  lcp.Refill (0);
+  auto alloc = lcp.Allocate (1000, saturated, 10);
+  NS_TEST_ASSERT_MSG_EQ (alloc.at (1), 1000U, "The highest priority does not take the rest");
+  NS_TEST_ASSERT_MSG_EQ (alloc.count (2), 0U, "The empty bucket of LC 2 was served");
+
+  // Under load, LC 2 gets exactly its PBR
+  uint64_t lc2Bytes = 0;
+  for (uint64_t ms = 1; ms <= 100; ++ms)
+    {
+      lcp.Refill (ms * 1000);
+      alloc = lcp.Allocate (1000, saturated, 10);
+      NS_TEST_ASSERT_MSG_EQ (alloc.at (1) + alloc.at (2), 1000U, "The grant is not fully used");
+      lc2Bytes += alloc.at (2);
+    }
+  NS_TEST_ASSERT_MSG_EQ (lc2Bytes, 10000U, "LC 2 does not get its prioritized bit rate");
+  NS_TEST_ASSERT_MSG_EQ (lcp.GetBucketBytes (2), 0, "The bucket of LC 2 is not emptied");
+
+  // Without grants, the buckets are capped at PBR * BSD
+  lcp.Refill (200000);
+  NS_TEST_ASSERT_MSG_EQ (lcp.GetBucketBytes (1), 500, "Wrong cap of the bucket of LC 1");
+  NS_TEST_ASSERT_MSG_EQ (lcp.GetBucketBytes (2), 1000, "Wrong cap of the bucket of LC 2");
+  alloc = lcp.Allocate (1200, saturated, 10);
+  NS_TEST_ASSERT_MSG_EQ (alloc.at (1), 500U, "LC 1 does not get its bucket first");
+  NS_TEST_ASSERT_MSG_EQ (alloc.at (2), 700U, "LC 2 does not get the rest of the grant");
+  NS_TEST_ASSERT_MSG_EQ (lcp.GetBucketBytes (2), 300, "Wrong bucket of LC 2 after the grant");
+
+  // 1 kbit/s: one bit per ms, one byte after 8 refills of 1 ms
+  NrUeLcp slow;
+  slow.AddLc (3, 1, 1, 1000, 0);
+  for (uint64_t ms = 1; ms <= 8; ++ms)
+    {
+      slow.Refill (ms * 1000);
+    }
+  NS_TEST_ASSERT_MSG_EQ (slow.GetBucketBytes (3), 1, "A fraction of byte was lost in the refill");
+
+  // Same priority, no PBR: equal share, and what one cannot use goes to the other
+  NrUeLcp equal;
+  equal.AddLc (4, 5, 0, 0, 0);
+  equal.AddLc (5, 5, 0, 0, 0);
+  alloc = equal.Allocate (100, {{4, 1000}, {5, 1000}}, 10);
+  NS_TEST_ASSERT_MSG_EQ (alloc.at (4), 50U, "Unequal share within a priority");
+  NS_TEST_ASSERT_MSG_EQ (alloc.at (5), 50U, "Unequal share within a priority");
+  alloc = equal.Allocate (100, {{4, 20}, {5, 1000}}, 10);
+  NS_TEST_ASSERT_MSG_EQ (alloc.at (4), 20U, "More than the data of the LC");
+  NS_TEST_ASSERT_MSG_EQ (alloc.at (5), 80U, "The share not used is not given back");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrUeLcp test suite
+ */
+class NrTestUeLcp : public TestSuite
+{
+public:
+  NrTestUeLcp () : TestSuite ("nr-test-ue-lcp", UNIT)
+  {
+    AddTestCase (new NrUeLcpTestCase (), QUICK);
+  }
+};
+
+static NrTestUeLcp NrTestUeLcpSuite; //!< NrUeLcp test suite
+
+}  // namespace ns3
@@ -0,0 +1,135 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/nr-mac-scheduler-ue-state-soa.h>
+
+/**
+ * \file nr-test-ue-state-soa.cc
+ * \ingroup test
+ *
+ * \brief This test checks the search of the UE of each RBG in
+ * NrMacSchedulerUeStateSoa, for the RR, MR and PF metrics, with a TB size
+ * of 100 bytes per RBG.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Assign RBG to the UEs of a state until they are satisfied
+ */
+class NrUeStateSoaTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrUeStateSoaTestCase ()
+    : TestCase ("Search of the UE of each RBG in the UE state arrays")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Assign RBG to the best UE, with 100 bytes each
+   * \param state the state
+   * \param rbg the RBG to assign
+   * \return the index of the UE of each RBG, GetSize () when all are satisfied
+   */
+  std::vector<size_t> Run (NrMacSchedulerUeStateSoa *state, uint32_t rbg);
+};
+
+std::vector<size_t>
+NrUeStateSoaTestCase::Run (NrMacSchedulerUeStateSoa *state, uint32_t rbg)
+{
+  std::vector<size_t> order;
+  state->Start ();
+  for (uint32_t i = 0; i < rbg; ++i)
+    {
+      size_t best = state->GetBest ();
+      order.push_back (best);
+      if (best == state->GetSize ())
+        {
+          break;
+        }
+      state->Assign (best, state->GetRbg (best) + 1, (state->GetRbg (best) + 1) * 100);
+    }
+  return order;
+}
+
+void
+NrUeStateSoaTestCase::DoRun ()
+{
+  // RR: one RBG each, in turn, until UE 1 is satisfied
+  NrMacSchedulerUeStateSoa rr (NrMacSchedulerUeStateSoa::RR, 1, 10);
+  rr.AddUe (10, 1000);
+  rr.AddUe (20, 150);
+  rr.AddUe (5, 1000);
+  std::vector<size_t> order = Run (&rr, 7);
+  NS_TEST_ASSERT_MSG_EQ ((order == std::vector<size_t> {0, 1, 2, 0, 1, 2, 0}), true, "Wrong RR order");
+  NS_TEST_ASSERT_MSG_EQ (rr.GetTbSize (1), 200U, "Wrong TB size of UE 1");
+
+  // MR: the highest MCS until it is satisfied, then the next
+  NrMacSchedulerUeStateSoa mr (NrMacSchedulerUeStateSoa::MR, 1, 10);
+  mr.AddUe (10, 1000);
+  mr.AddUe (20, 150);
+  mr.AddUe (5, 100);
+  order = Run (&mr, 20);
+  NS_TEST_ASSERT_MSG_EQ ((order == std::vector<size_t> {1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3}), true,
+                         "Wrong MR order");
+
+  // PF: the highest potential throughput first; then, the PF metric over
+  // the average throughput after the slot
+  NrMacSchedulerUeStateSoa pf (NrMacSchedulerUeStateSoa::PF, 10, 10);
+  pf.SetPfParameters (1.0, 10.0);
+  pf.AddUe (10, 100000);
+  pf.AddUe (10, 100000);
+  pf.SetPfInputs (0, 100.0, 1000.0);
+  pf.SetPfInputs (1, 50.0, 10.0);
+  order = Run (&pf, 2);
+  // UE 0 gets the first RBG (100 > 50); then UE 1 has a metric of 50 / 9,
+  // and UE 0 of 100 / 901
+  NS_TEST_ASSERT_MSG_EQ ((order == std::vector<size_t> {0, 1}), true, "Wrong PF order");
+
+  // Satisfied UEs are not served, and the minimum bytes apply
+  NrMacSchedulerUeStateSoa done (NrMacSchedulerUeStateSoa::RR, 1, 150);
+  done.AddUe (10, 0, 1, 100);
+  done.AddUe (10, 0, 2, 200);
+  order = Run (&done, 2);
+  NS_TEST_ASSERT_MSG_EQ ((order == std::vector<size_t> {0, 2}), true, "A satisfied UE was served");
+}
+
+/**
+ * \ingroup test
+ * \brief The UE state arrays test suite
+ */
+class NrTestUeStateSoa : public TestSuite
+{
+public:
+  NrTestUeStateSoa () : TestSuite ("nr-test-ue-state-soa", UNIT)
+  {
+    AddTestCase (new NrUeStateSoaTestCase (), QUICK);
+  }
+};
+
+static NrTestUeStateSoa NrTestUeStateSoaSuite; //!< UE state arrays test suite
+
+}  // namespace ns3
@@ -0,0 +1,138 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/packet.h>
+#include <ns3/packet-burst.h>
+#include <ns3/lte-radio-bearer-tag.h>
+#include <ns3/spectrum-value.h>
+#include <ns3/nr-spectrum-signal-parameters.h>
+#include <set>
+
+/**
+ * \file nr-test-ul-rx-reuse.cc
+ * \ingroup test
+ *
+ * \brief This test checks that the DATA signal parameters, created by the
+ * transmitter and copied by the channel at each transmission, take the
+ * memory of the released ones, and that the index of the packets by RNTI
+ * is refilled in its own memory.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Create and release the signal parameters of some slots
+ */
+class NrUlRxReuseTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrUlRxReuseTestCase ()
+    : TestCase ("Reuse of the memory of the DATA signals")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+/**
+ * \brief Create a burst with a packet for each RNTI
+ * \param rntis the RNTIs
+ * \return the burst
+ */
+static Ptr<PacketBurst>
+CreateBurst (const std::vector<uint16_t> &rntis)
+{
+  Ptr<PacketBurst> pb = CreateObject<PacketBurst> ();
+  for (uint16_t rnti : rntis)
+    {
+      Ptr<Packet> packet = Create<Packet> (10);
+      packet->AddPacketTag (LteRadioBearerTag (rnti, 1, 0));
+      pb->AddPacket (packet);
+    }
+  return pb;
+}
+
+void
+NrUlRxReuseTestCase::DoRun ()
+{
+  // The copies of the channel copy the PSD too
+  Ptr<SpectrumModel> model = Create<SpectrumModel> (std::vector<double> {1e9, 1.1e9});
+  Ptr<SpectrumValue> psd = Create<SpectrumValue> (model);
+
+  // Warm-up: a transmission copied for two receivers
+  std::set<const void *> warmUp;
+  {
+    Ptr<NrSpectrumSignalParametersDataFrame> tx = Create<NrSpectrumSignalParametersDataFrame> ();
+    tx->psd = psd;
+    Ptr<SpectrumSignalParameters> rx1 = tx->Copy ();
+    Ptr<SpectrumSignalParameters> rx2 = tx->Copy ();
+    warmUp = {PeekPointer (tx), PeekPointer (rx1), PeekPointer (rx2)};
+  }
+  NS_TEST_ASSERT_MSG_EQ (warmUp.size (), 3U, "The live parameters must not share memory");
+
+  // The next slots only take the memory released by the warm-up
+  for (uint32_t slot = 0; slot < 10; ++slot)
+    {
+      Ptr<NrSpectrumSignalParametersDataFrame> tx = Create<NrSpectrumSignalParametersDataFrame> ();
+      tx->psd = psd;
+      Ptr<SpectrumSignalParameters> rx1 = tx->Copy ();
+      Ptr<SpectrumSignalParameters> rx2 = tx->Copy ();
+      std::set<const void *> used = {PeekPointer (tx), PeekPointer (rx1), PeekPointer (rx2)};
+      NS_TEST_ASSERT_MSG_EQ ((used == warmUp), true, "The parameters of slot " << slot << " were allocated");
+    }
+
+  // The index is sorted by RNTI, in the order of the burst for the same RNTI
+  NrSpectrumSignalParametersDataFrame::PacketsByRnti index;
+  Ptr<PacketBurst> pb = CreateBurst ({3, 1, 3, 2});
+  NrSpectrumSignalParametersDataFrame::IndexPacketsByRnti (pb, &index);
+  NS_TEST_ASSERT_MSG_EQ (index.size (), 4U, "Wrong size of the index");
+  std::vector<Ptr<Packet>> packets (pb->Begin (), pb->End ());
+  NS_TEST_ASSERT_MSG_EQ (index.at (0).first, 1, "Wrong RNTI");
+  NS_TEST_ASSERT_MSG_EQ (index.at (1).first, 2, "Wrong RNTI");
+  NS_TEST_ASSERT_MSG_EQ ((index.at (2).second == packets.at (0)), true, "Wrong order of the packets of RNTI 3");
+  NS_TEST_ASSERT_MSG_EQ ((index.at (3).second == packets.at (2)), true, "Wrong order of the packets of RNTI 3");
+
+  // A burst of a UE is refilled in the same memory
+  const void *data = index.data ();
+  NrSpectrumSignalParametersDataFrame::IndexPacketsByRnti (CreateBurst ({5, 5}), &index);
+  NS_TEST_ASSERT_MSG_EQ (index.size (), 2U, "Wrong size of the index");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<const void *> (index.data ()), data, "The index was allocated again");
+}
+
+/**
+ * \ingroup test
+ * \brief The suite of the reuse of the memory of the UL receive path
+ */
+class NrTestUlRxReuse : public TestSuite
+{
+public:
+  NrTestUlRxReuse () : TestSuite ("nr-test-ul-rx-reuse", UNIT)
+  {
+    AddTestCase (new NrUlRxReuseTestCase (), QUICK);
+  }
+};
+
+static NrTestUlRxReuse NrTestUlRxReuseSuite; //!< Reuse of the memory of the UL receive path test suite
+
+}  // namespace ns3
@@ -0,0 +1,121 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/simulator.h>
+#include <ns3/nr-var-tti-timeline.h>
+
+/**
+ * \file nr-test-var-tti-timeline.cc
+ * \ingroup test
+ *
+ * \brief This test checks that NrVarTtiTimeline runs its functions in the
+ * order of the simulator events that they replace, with one simulator event
+ * per distinct time.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief The varTTIs of a slot, as a gNB PHY schedules them
+ */
+class NrVarTtiTimelineTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrVarTtiTimelineTestCase ()
+    : TestCase ("VarTTI timeline of a slot")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  /**
+   * \brief Start a varTTI, and schedule its end
+   * \param id the varTTI
+   * \param symbols the duration of the varTTI, in symbols
+   */
+  void StartVarTti (uint32_t id, uint32_t symbols);
+
+  /**
+   * \brief End a varTTI
+   * \param id the varTTI
+   */
+  void EndVarTti (uint32_t id);
+
+  NrVarTtiTimeline m_timeline; //!< The timeline
+  std::string m_calls;         //!< The calls, in order
+};
+
+void
+NrVarTtiTimelineTestCase::StartVarTti (uint32_t id, uint32_t symbols)
+{
+  m_calls += "s" + std::to_string (id) + "@" + std::to_string (Simulator::Now ().GetMicroSeconds ()) + " ";
+  m_timeline.Schedule (MicroSeconds (10 * symbols), std::bind (&NrVarTtiTimelineTestCase::EndVarTti, this, id));
+}
+
+void
+NrVarTtiTimelineTestCase::EndVarTti (uint32_t id)
+{
+  m_calls += "e" + std::to_string (id) + "@" + std::to_string (Simulator::Now ().GetMicroSeconds ()) + " ";
+}
+
+void
+NrVarTtiTimelineTestCase::DoRun ()
+{
+  // Symbols of 10 us: a CTRL varTTI of 1 symbol, then two DATA varTTIs of
+  // 6 symbols from the symbol 1, then one of 2 symbols from the symbol 7,
+  // all scheduled at the start of the slot
+  Simulator::Schedule (MicroSeconds (100), [this] ()
+    {
+      m_timeline.Schedule (MicroSeconds (0), std::bind (&NrVarTtiTimelineTestCase::StartVarTti, this, 0, 1));
+      m_timeline.Schedule (MicroSeconds (10), std::bind (&NrVarTtiTimelineTestCase::StartVarTti, this, 1, 6));
+      m_timeline.Schedule (MicroSeconds (10), std::bind (&NrVarTtiTimelineTestCase::StartVarTti, this, 2, 6));
+      m_timeline.Schedule (MicroSeconds (70), std::bind (&NrVarTtiTimelineTestCase::StartVarTti, this, 3, 2));
+    });
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // As with simulator events: the starts scheduled first run before the
+  // ends of the same time
+  NS_TEST_ASSERT_MSG_EQ (m_calls, "s0@100 s1@110 s2@110 e0@110 s3@170 e1@170 e2@170 e3@190 ",
+                         "Wrong order of the calls");
+  NS_TEST_ASSERT_MSG_EQ (m_timeline.GetNumRuns (), 8U, "Wrong number of functions run");
+  NS_TEST_ASSERT_MSG_EQ (m_timeline.GetNumEvents (), 4U, "Not one event per distinct time");
+}
+
+/**
+ * \ingroup test
+ * \brief The NrVarTtiTimeline test suite
+ */
+class NrTestVarTtiTimeline : public TestSuite
+{
+public:
+  NrTestVarTtiTimeline () : TestSuite ("nr-test-var-tti-timeline", UNIT)
+  {
+    AddTestCase (new NrVarTtiTimelineTestCase (), QUICK);
+  }
+};
+
+static NrTestVarTtiTimeline NrTestVarTtiTimelineSuite; //!< NrVarTtiTimeline test suite
+
+}  // namespace ns3
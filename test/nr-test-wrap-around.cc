@@ -0,0 +1,223 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/node-container.h>
+#include <ns3/mobility-helper.h>
+#include <ns3/position-allocator.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/propagation-loss-model.h>
+#include <ns3/nr-wrap-around-model.h>
+#include <cmath>
+
+/**
+ * \file nr-test-wrap-around.cc
+ * \ingroup test
+ *
+ * \brief This test checks the geometry of NrWrapAroundModel for the clusters
+ * of 7 and 19 sites: in the wrapped 7-site cluster every site is at one ISD
+ * from all the others, and in the 19-site one at most at two ISDs. It then
+ * checks that NrWrapAroundPropagationLossModel computes the loss of its
+ * model towards the nearest image of a site.
+ */
+namespace ns3 {
+
+/**
+ * \brief Create the sites of a cluster, on the lattice of HexagonalGridScenarioHelper
+ * \param isd the inter-site distance (m)
+ * \param numRings the number of rings around the central site (1 or 2)
+ * \return the nodes of the sites
+ */
+static NodeContainer
+CreateCluster (double isd, uint32_t numRings)
+{
+  Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+  const int32_t n = static_cast<int32_t> (numRings);
+  for (int32_t a = -n; a <= n; ++a)
+    {
+      for (int32_t b = -n; b <= n; ++b)
+        {
+          // e1 at 30 degrees, e2 at 90 degrees; the hexagonal distance is
+          // the number of rings
+          if (std::abs (a + b) <= n)
+            {
+              positionAlloc->Add (Vector (isd * a * std::cos (M_PI / 6),
+                                          isd * (a * std::sin (M_PI / 6) + b), 25.0));
+            }
+        }
+    }
+
+  NodeContainer sites;
+  sites.Create (positionAlloc->GetSize ());
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (positionAlloc);
+  mobility.Install (sites);
+  return sites;
+}
+
+/**
+ * \ingroup test
+ * \brief Check the offsets and the wrapped distances between the sites
+ */
+class NrWrapAroundGeometryTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param numSites the number of sites of the cluster
+   * \param maxDistance the maximum wrapped distance between two sites, in ISDs
+   */
+  NrWrapAroundGeometryTestCase (uint32_t numSites, double maxDistance)
+    : TestCase ("Wrap-around of " + std::to_string (numSites) + " sites"),
+      m_numSites (numSites),
+      m_maxDistance (maxDistance)
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+
+  uint32_t m_numSites;  //!< The number of sites of the cluster
+  double m_maxDistance; //!< The maximum wrapped distance between two sites, in ISDs
+};
+
+void
+NrWrapAroundGeometryTestCase::DoRun ()
+{
+  const double isd = 500.0;
+  NodeContainer sites = CreateCluster (isd, m_numSites == 7 ? 1 : 2);
+  NS_TEST_ASSERT_MSG_EQ (sites.GetN (), m_numSites, "Wrong cluster");
+
+  Ptr<NrWrapAroundModel> wrapAround = CreateObject<NrWrapAroundModel> ();
+  wrapAround->SetCluster (isd, m_numSites);
+  wrapAround->Install (sites);
+  NS_TEST_ASSERT_MSG_EQ (wrapAround->GetImageNodes ().GetN (), 6 * m_numSites, "Wrong number of copies");
+
+  for (const Vector &offset : wrapAround->GetImageOffsets ())
+    {
+      NS_TEST_ASSERT_MSG_EQ_TOL (offset.GetLength (), isd * std::sqrt (m_numSites), 1e-6,
+                                 "Wrong distance between the cluster and its copy");
+    }
+
+  for (uint32_t i = 0; i < sites.GetN (); ++i)
+    {
+      Ptr<MobilityModel> site = sites.Get (i)->GetObject<MobilityModel> ();
+      for (uint32_t j = 0; j < sites.GetN (); ++j)
+        {
+          Ptr<MobilityModel> other = sites.Get (j)->GetObject<MobilityModel> ();
+          Ptr<MobilityModel> image = wrapAround->GetNearestImage (PeekPointer (site), other->GetPosition ());
+          NS_TEST_ASSERT_MSG_EQ ((image != nullptr), true, "Site " << i << " not installed");
+          double distance = CalculateDistance (image->GetPosition (), other->GetPosition ());
+          if (i == j)
+            {
+              NS_TEST_ASSERT_MSG_EQ (image, site, "A site is not its own nearest image");
+              continue;
+            }
+          NS_TEST_ASSERT_MSG_GT_OR_EQ (distance, isd - 1e-6, "Copies " << i << " and " << j << " overlap");
+          NS_TEST_ASSERT_MSG_LT_OR_EQ (distance, m_maxDistance * isd + 1e-6,
+                                       "Sites " << i << " and " << j << " not wrapped");
+        }
+    }
+
+  Ptr<MobilityModel> ue = CreateObject<ConstantPositionMobilityModel> ();
+  NS_TEST_ASSERT_MSG_EQ ((wrapAround->GetNearestImage (PeekPointer (ue), Vector ()) == nullptr), true,
+                         "A node that is not a site has images");
+}
+
+/**
+ * \ingroup test
+ * \brief Check the loss of NrWrapAroundPropagationLossModel between a site
+ * and a UE at the opposite edge of the cluster
+ */
+class NrWrapAroundLossTestCase : public TestCase
+{
+public:
+  NrWrapAroundLossTestCase () : TestCase ("Wrapped path loss")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrWrapAroundLossTestCase::DoRun ()
+{
+  const double isd = 200.0;
+  NodeContainer sites = CreateCluster (isd, 1);
+  Ptr<NrWrapAroundModel> wrapAround = CreateObject<NrWrapAroundModel> ();
+  wrapAround->SetCluster (isd, 7);
+  wrapAround->Install (sites);
+
+  Ptr<PropagationLossModel> model = CreateObject<LogDistancePropagationLossModel> ();
+  Ptr<NrWrapAroundPropagationLossModel> wrapper = CreateObject<NrWrapAroundPropagationLossModel> ();
+  wrapper->SetPropagationLossModel (model);
+  wrapper->SetWrapAroundModel (wrapAround);
+  NS_TEST_ASSERT_MSG_EQ (NrWrapAroundPropagationLossModel::Unwrap (wrapper), model, "Wrong unwrapped model");
+  NS_TEST_ASSERT_MSG_EQ (NrWrapAroundPropagationLossModel::Unwrap (model), model, "Wrong unwrapped model");
+
+  // Site 0 of the first ring is at -150 degrees from the center. A UE
+  // beyond the site at +30 degrees is nearer to one of its copies
+  Ptr<MobilityModel> site;
+  for (uint32_t i = 0; i < sites.GetN (); ++i)
+    {
+      Ptr<MobilityModel> m = sites.Get (i)->GetObject<MobilityModel> ();
+      Vector p = m->GetPosition ();
+      if (p.x < -1 && p.y < -1 && std::abs (p.y - p.x * std::tan (M_PI / 6)) < 1e-6)
+        {
+          site = m;
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ ((site != nullptr), true, "Site at -150 degrees not found");
+
+  Ptr<MobilityModel> ue = CreateObject<ConstantPositionMobilityModel> ();
+  ue->SetPosition (Vector (1.2 * isd * std::cos (M_PI / 6), 1.2 * isd * std::sin (M_PI / 6), 1.5));
+  Ptr<MobilityModel> image = wrapAround->GetNearestImage (PeekPointer (site), ue->GetPosition ());
+  NS_TEST_ASSERT_MSG_NE (image, site, "The site is not wrapped");
+  NS_TEST_ASSERT_MSG_LT (CalculateDistance (image->GetPosition (), ue->GetPosition ()),
+                         CalculateDistance (site->GetPosition (), ue->GetPosition ()),
+                         "The image is not nearer than the site");
+
+  NS_TEST_ASSERT_MSG_EQ_TOL (wrapper->CalcRxPower (0.0, site, ue), model->CalcRxPower (0.0, image, ue),
+                             1e-9, "The loss is not computed towards the image (site first)");
+  NS_TEST_ASSERT_MSG_EQ_TOL (wrapper->CalcRxPower (0.0, ue, site), model->CalcRxPower (0.0, ue, image),
+                             1e-9, "The loss is not computed towards the image (site second)");
+  NS_TEST_ASSERT_MSG_GT (wrapper->CalcRxPower (0.0, site, ue), model->CalcRxPower (0.0, site, ue),
+                         "The wrapped loss is not lower");
+}
+
+/**
+ * \ingroup test
+ * \brief The wrap-around test suite
+ */
+class NrTestWrapAround : public TestSuite
+{
+public:
+  NrTestWrapAround () : TestSuite ("nr-test-wrap-around", UNIT)
+  {
+    AddTestCase (new NrWrapAroundGeometryTestCase (7, 1.0), QUICK);
+    AddTestCase (new NrWrapAroundGeometryTestCase (19, 2.0), QUICK);
+    AddTestCase (new NrWrapAroundLossTestCase (), QUICK);
+  }
+};
+
+static NrTestWrapAround NrTestWrapAroundSuite; //!< Wrap-around test suite
+
+}  // namespace ns3
@@ -0,0 +1,128 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <ns3/test.h>
+#include <ns3/xr-traffic-application.h>
+#include <ns3/internet-stack-helper.h>
+#include <ns3/inet-socket-address.h>
+#include <ns3/node.h>
+#include <ns3/packet.h>
+#include <ns3/simulator.h>
+
+/**
+ * \file nr-test-xr-traffic.cc
+ * \ingroup test
+ *
+ * \brief This test checks the frame-level statistics of XrTrafficSink: a
+ * frame complete within the budget, a frame that misses a packet, a frame
+ * of which nothing arrives, and a frame complete after the budget.
+ */
+namespace ns3 {
+
+/**
+ * \ingroup test
+ * \brief Feed the sink with the packets of four frames
+ */
+class NrXrTrafficTestCase : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   */
+  NrXrTrafficTestCase ()
+    : TestCase ("Frame-level statistics of the XR traffic")
+  {
+  }
+
+private:
+  virtual void DoRun (void) override;
+};
+
+void
+NrXrTrafficTestCase::DoRun ()
+{
+  XrFrameStats stats (MilliSeconds (1), 50);
+  for (uint32_t ms = 1; ms <= 100; ++ms)
+    {
+      stats.RecordFrame (MicroSeconds (ms * 100 - 50), ms <= 80);
+    }
+  NS_TEST_ASSERT_MSG_EQ (stats.GetFrames (), 100U, "Wrong number of frames");
+  NS_TEST_ASSERT_MSG_EQ_TOL (stats.GetReliability (), 0.8, 1e-9, "Wrong reliability");
+  NS_TEST_ASSERT_MSG_EQ (stats.GetLatencyPercentile (50.0), MilliSeconds (5), "Wrong median");
+  NS_TEST_ASSERT_MSG_EQ (stats.GetLatencyPercentile (99.0), MilliSeconds (10), "Wrong 99th percentile");
+  NS_TEST_ASSERT_MSG_EQ (stats.GetMeanLatency (), MicroSeconds (5000), "Wrong mean latency");
+
+  Ptr<Node> node = CreateObject<Node> ();
+  InternetStackHelper internet;
+  internet.Install (node);
+  Ptr<XrTrafficSink> sink = CreateObject<XrTrafficSink> ();
+  sink->SetAttribute ("Local", AddressValue (InetSocketAddress (Ipv4Address::GetAny (), 1234)));
+  sink->SetAttribute ("PacketDelayBudget", TimeValue (MilliSeconds (10)));
+  node->AddApplication (sink);
+  sink->SetStartTime (Seconds (0));
+  sink->SetStopTime (MilliSeconds (100));
+
+  auto send = [sink] (uint32_t frameId, uint16_t packetIndex, uint16_t numPackets, Time generation)
+    {
+      XrFrameHeader header;
+      header.m_frameId = frameId;
+      header.m_packetIndex = packetIndex;
+      header.m_numPackets = numPackets;
+      header.m_generation = generation;
+      Ptr<Packet> packet = Create<Packet> (100);
+      packet->AddHeader (header);
+      sink->ProcessPacket (packet);
+    };
+  // Frame 0: on time, in 5 ms
+  Simulator::Schedule (MilliSeconds (3), send, 0, 0, 2, MilliSeconds (0));
+  Simulator::Schedule (MilliSeconds (5), send, 0, 1, 2, MilliSeconds (0));
+  // Frame 1: a packet never arrives
+  Simulator::Schedule (MilliSeconds (20), send, 1, 0, 3, MilliSeconds (16));
+  Simulator::Schedule (MilliSeconds (22), send, 1, 1, 3, MilliSeconds (16));
+  // Frame 2: nothing arrives; frame 3: complete in 15 ms
+  Simulator::Schedule (MilliSeconds (65), send, 3, 0, 1, MilliSeconds (50));
+  // A packet of frame 0 that arrives again is ignored
+  Simulator::Schedule (MilliSeconds (70), send, 0, 1, 2, MilliSeconds (0));
+
+  Simulator::Run ();
+
+  const XrFrameStats &sinkStats = sink->GetStats ();
+  NS_TEST_ASSERT_MSG_EQ (sinkStats.GetFrames (), 4U, "Wrong number of frames");
+  NS_TEST_ASSERT_MSG_EQ (sinkStats.GetFramesOnTime (), 1U, "Wrong number of frames on time");
+  NS_TEST_ASSERT_MSG_EQ (sinkStats.GetMeanLatency (), MilliSeconds (10), "Wrong mean latency of the complete frames");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup test
+ * \brief The XR traffic test suite
+ */
+class NrTestXrTraffic : public TestSuite
+{
+public:
+  NrTestXrTraffic () : TestSuite ("nr-test-xr-traffic", UNIT)
+  {
+    AddTestCase (new NrXrTrafficTestCase (), QUICK);
+  }
+};
+
+static NrTestXrTraffic NrTestXrTrafficSuite; //!< XR traffic test suite
+
+}  // namespace ns3
@@ -0,0 +1,482 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#include "cached-three-gpp-spectrum-propagation-loss-model.h"
+#include "nr-coupling-gain-engine.h"
+#include "ns3/log.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/simulator.h"
+#include "ns3/nr-perf-profiler.h"
+#include "ns3/nr-counters.h"
+#include <algorithm>
+#include <functional>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CachedThreeGppSpectrumPropagationLossModel");
+NS_OBJECT_ENSURE_REGISTERED (CachedThreeGppSpectrumPropagationLossModel);
+
+CachedThreeGppSpectrumPropagationLossModel::CachedThreeGppSpectrumPropagationLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+CachedThreeGppSpectrumPropagationLossModel::~CachedThreeGppSpectrumPropagationLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+CachedThreeGppSpectrumPropagationLossModel::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_longTermCache.clear ();
+  m_wrapAround = nullptr;
+  m_couplingGains = nullptr;
+  ThreeGppSpectrumPropagationLossModel::DoDispose ();
+}
+
+TypeId
+CachedThreeGppSpectrumPropagationLossModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CachedThreeGppSpectrumPropagationLossModel")
+    .SetParent<ThreeGppSpectrumPropagationLossModel> ()
+    .SetGroupName ("Spectrum")
+    .AddConstructor<CachedThreeGppSpectrumPropagationLossModel> ()
+    .AddAttribute ("LongTermCacheSize",
+                   "The number of pairs of beamforming vectors whose long term component "
+                   "is kept for each pair of antennas.",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&CachedThreeGppSpectrumPropagationLossModel::SetLongTermCacheSize,
+                                         &CachedThreeGppSpectrumPropagationLossModel::GetLongTermCacheSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("LongTermCacheHits",
+                   "The number of long term components found in the cache.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&CachedThreeGppSpectrumPropagationLossModel::GetLongTermCacheHits),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("LongTermCacheMisses",
+                   "The number of long term components computed, because they were not in the cache.",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&CachedThreeGppSpectrumPropagationLossModel::GetLongTermCacheMisses),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("WrapAroundModel",
+                   "The wrap-around model of the links, if any: the channel is computed "
+                   "between the image of the site nearest to the other node.",
+                   PointerValue (),
+                   MakePointerAccessor (&CachedThreeGppSpectrumPropagationLossModel::SetWrapAroundModel),
+                   MakePointerChecker<NrWrapAroundModel> ())
+    ;
+  return tid;
+}
+
+void
+CachedThreeGppSpectrumPropagationLossModel::SetLongTermCacheSize (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  NS_ABORT_MSG_IF (size == 0, "The long term cache needs at least one entry");
+  m_longTermCacheSize = size;
+  for (auto &it : m_longTermCache)
+    {
+      it.second.m_entries.clear ();
+    }
+}
+
+uint32_t
+CachedThreeGppSpectrumPropagationLossModel::GetLongTermCacheSize () const
+{
+  return m_longTermCacheSize;
+}
+
+uint64_t
+CachedThreeGppSpectrumPropagationLossModel::GetLongTermCacheHits () const
+{
+  return m_longTermCacheHits;
+}
+
+uint64_t
+CachedThreeGppSpectrumPropagationLossModel::GetLongTermCacheMisses () const
+{
+  return m_longTermCacheMisses;
+}
+
+void
+CachedThreeGppSpectrumPropagationLossModel::SetWrapAroundModel (const Ptr<NrWrapAroundModel> &model)
+{
+  NS_LOG_FUNCTION (this << model);
+  m_wrapAround = model;
+}
+
+Ptr<NrWrapAroundModel>
+CachedThreeGppSpectrumPropagationLossModel::GetWrapAroundModel () const
+{
+  return m_wrapAround;
+}
+
+void
+CachedThreeGppSpectrumPropagationLossModel::SetCouplingGainEngine (const Ptr<const NrCouplingGainEngine> &engine)
+{
+  NS_LOG_FUNCTION (this << engine);
+  m_couplingGains = engine;
+}
+
+size_t
+CachedThreeGppSpectrumPropagationLossModel::HashBeamformingVector (const PhasedArrayModel::ComplexVector &w)
+{
+  size_t hash = w.size ();
+  std::hash<double> hasher;
+  for (const auto &value : w)
+    {
+      hash ^= hasher (value.real ()) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      hash ^= hasher (value.imag ()) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+  return hash;
+}
+
+Ptr<SpectrumValue>
+CachedThreeGppSpectrumPropagationLossModel::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
+                                                                          Ptr<const MobilityModel> a,
+                                                                          Ptr<const MobilityModel> b,
+                                                                          Ptr<const PhasedArrayModel> aPhasedArrayModel,
+                                                                          Ptr<const PhasedArrayModel> bPhasedArrayModel) const
+{
+  NS_LOG_FUNCTION (this);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::CHANNEL);
+
+  if (m_wrapAround != nullptr)
+    {
+      m_wrapAround->Wrap (&a, &b);
+    }
+
+  if (!m_vScattRead)
+    {
+      DoubleValue vScatt;
+      GetAttribute ("vScatt", vScatt);
+      m_vScatt = vScatt.Get ();
+      m_vScattRead = true;
+    }
+  if (m_vScatt != 0.0)
+    {
+      return ThreeGppSpectrumPropagationLossModel::DoCalcRxPowerSpectralDensity (txPsd, a, b, aPhasedArrayModel, bPhasedArrayModel);
+    }
+
+  uint32_t aId = aPhasedArrayModel->GetId (); // id of the phased array of the node a
+  uint32_t bId = bPhasedArrayModel->GetId (); // id of the phased array of the node b
+  NS_ASSERT_MSG (aId != bId, "The two nodes must be different from one another");
+  NS_ASSERT_MSG (a->GetDistanceFrom (b) > 0.0, "The position of a and b devices cannot be the same");
+
+  Ptr<SpectrumValue> rxPsd = Copy<SpectrumValue> (txPsd);
+  NrCounters::Add (NrCounters::SPECTRUM_VALUES);
+
+  // retrieve the channel matrix and the parameters of the channel
+  Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix = GetChannelModel ()->GetChannel (a, b, aPhasedArrayModel, bPhasedArrayModel);
+  Ptr<const MatrixBasedChannelModel::ChannelParams> channelParams = GetChannelModel ()->GetParams (a, b);
+
+  // get the precoding and combining vectors
+  const PhasedArrayModel::ComplexVector &aW = aPhasedArrayModel->GetBeamformingVector ();
+  const PhasedArrayModel::ComplexVector &bW = bPhasedArrayModel->GetBeamformingVector ();
+
+  // check if the channel matrix was generated considering a as the s-node and
+  // b as the u-node or viceversa
+  bool isReverse = channelMatrix->IsReverse (aId, bId);
+  const PhasedArrayModel::ComplexVector &sW = isReverse ? bW : aW;
+  const PhasedArrayModel::ComplexVector &uW = isReverse ? aW : bW;
+
+  // a static link whose beams are in the table of the engine
+  if (m_couplingGains != nullptr && a->GetVelocity ().GetLength () == 0 && b->GetVelocity ().GetLength () == 0)
+    {
+      const std::vector<double> *gains = m_couplingGains->FindBandGains (aId, bId, channelMatrix, sW, uW,
+                                                                          rxPsd->GetSpectrumModelUid ());
+      if (gains != nullptr)
+        {
+          size_t bIndex = 0;
+          for (auto vit = rxPsd->ValuesBegin (); vit != rxPsd->ValuesEnd (); ++vit, ++bIndex)
+            {
+              if ((*vit) != 0.00)
+                {
+                  *vit = (*vit) * (*gains)[bIndex];
+                }
+            }
+          return rxPsd;
+        }
+    }
+
+  // retrieve the long term component and the fading terms, and apply the
+  // beamforming gain
+  LongTermCache &cache = GetCache (aId, bId, channelMatrix);
+  const PhasedArrayModel::ComplexVector &longTerm = GetLongTerm (cache, sW, uW);
+  UpdateFadingTable (&cache.m_fading, *channelMatrix, *channelParams, *rxPsd);
+  CalcBeamformingGain (rxPsd, longTerm, cache.m_fading, a->GetVelocity (), b->GetVelocity ());
+
+  return rxPsd;
+}
+
+CachedThreeGppSpectrumPropagationLossModel::LongTermCache &
+CachedThreeGppSpectrumPropagationLossModel::GetCache (uint32_t aId, uint32_t bId,
+                                                      Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix) const
+{
+  LongTermCache &cache = m_longTermCache[MatrixBasedChannelModel::GetKey (aId, bId)];
+  if (cache.m_channel != channelMatrix || cache.m_generatedTime != channelMatrix->m_generatedTime)
+    {
+      NS_LOG_DEBUG ("The channel matrix was regenerated, dropping " << cache.m_entries.size () << " long term components");
+      NrCounters::Add (NrCounters::CHANNEL_MATRICES);
+      cache.m_channel = channelMatrix;
+      cache.m_generatedTime = channelMatrix->m_generatedTime;
+      cache.m_entries.clear ();
+      cache.m_fading.m_valid = false;
+    }
+  return cache;
+}
+
+const PhasedArrayModel::ComplexVector &
+CachedThreeGppSpectrumPropagationLossModel::GetLongTerm (LongTermCache &cache,
+                                                         const PhasedArrayModel::ComplexVector &sW,
+                                                         const PhasedArrayModel::ComplexVector &uW) const
+{
+  NS_LOG_FUNCTION (this);
+
+  ++m_useCounter;
+  size_t sHash = HashBeamformingVector (sW);
+  size_t uHash = HashBeamformingVector (uW);
+  for (auto &entry : cache.m_entries)
+    {
+      if (entry.m_sHash == sHash && entry.m_uHash == uHash && entry.m_sW == sW && entry.m_uW == uW)
+        {
+          NS_LOG_DEBUG ("found the long term component in the cache");
+          ++m_longTermCacheHits;
+          entry.m_lastUse = m_useCounter;
+          return entry.m_longTerm;
+        }
+    }
+
+  ++m_longTermCacheMisses;
+  LongTermEntry *entry = nullptr;
+  if (cache.m_entries.size () < m_longTermCacheSize)
+    {
+      cache.m_entries.emplace_back ();
+      entry = &cache.m_entries.back ();
+    }
+  else
+    {
+      entry = &*std::min_element (cache.m_entries.begin (), cache.m_entries.end (),
+                                  [] (const LongTermEntry &lhs, const LongTermEntry &rhs)
+                                    {
+                                      return lhs.m_lastUse < rhs.m_lastUse;
+                                    });
+    }
+  entry->m_sHash = sHash;
+  entry->m_uHash = uHash;
+  entry->m_sW = sW;
+  entry->m_uW = uW;
+  entry->m_lastUse = m_useCounter;
+  CalcLongTerm (*cache.m_channel, sW, uW, &entry->m_longTerm);
+  return entry->m_longTerm;
+}
+
+void
+CachedThreeGppSpectrumPropagationLossModel::CalcLongTerm (const MatrixBasedChannelModel::ChannelMatrix &channelMatrix,
+                                                          const PhasedArrayModel::ComplexVector &sW,
+                                                          const PhasedArrayModel::ComplexVector &uW,
+                                                          PhasedArrayModel::ComplexVector *longTerm)
+{
+  const MatrixBasedChannelModel::Complex3DVector &h = channelMatrix.m_channel;
+  size_t uSize = uW.size ();
+  size_t sSize = sW.size ();
+
+  NS_ASSERT (uSize == h.size ());
+  NS_ASSERT (sSize == h[0].size ());
+
+  size_t numCluster = h[0][0].size ();
+  longTerm->resize (numCluster);
+  for (size_t cIndex = 0; cIndex < numCluster; cIndex++)
+    {
+      std::complex<double> txSum (0, 0);
+      for (size_t sIndex = 0; sIndex < sSize; sIndex++)
+        {
+          std::complex<double> rxSum (0, 0);
+          for (size_t uIndex = 0; uIndex < uSize; uIndex++)
+            {
+              rxSum = rxSum + uW[uIndex] * h[uIndex][sIndex][cIndex];
+            }
+          txSum = txSum + sW[sIndex] * rxSum;
+        }
+      (*longTerm)[cIndex] = txSum;
+    }
+}
+
+void
+CachedThreeGppSpectrumPropagationLossModel::UpdateFadingTable (FadingTable *table,
+                                                               const MatrixBasedChannelModel::ChannelMatrix &channelMatrix,
+                                                               const MatrixBasedChannelModel::ChannelParams &channelParams,
+                                                               const SpectrumValue &psd)
+{
+  if (table->m_valid && table->m_spectrumModelUid == psd.GetSpectrumModelUid ())
+    {
+      return;
+    }
+
+  //channel[rx][tx][cluster]
+  size_t numCluster = channelMatrix.m_channel[0][0].size ();
+  size_t numBands = psd.GetValuesN ();
+
+  //check if channelParams structure is generated in direction s-to-u or u-to-s
+  bool isSameDirection = (channelParams.m_nodeIds == channelMatrix.m_nodeIds);
+
+  // if channel params is generated in the same direction in which we
+  // generate the channel matrix, angles and zenith of departure and arrival are ok,
+  // otherwise we need to flip angles and zeniths of departure and arrival
+  const MatrixBasedChannelModel::DoubleVector &zoa = channelParams.m_angle[isSameDirection ? MatrixBasedChannelModel::ZOA_INDEX : MatrixBasedChannelModel::ZOD_INDEX];
+  const MatrixBasedChannelModel::DoubleVector &zod = channelParams.m_angle[isSameDirection ? MatrixBasedChannelModel::ZOD_INDEX : MatrixBasedChannelModel::ZOA_INDEX];
+  const MatrixBasedChannelModel::DoubleVector &aoa = channelParams.m_angle[isSameDirection ? MatrixBasedChannelModel::AOA_INDEX : MatrixBasedChannelModel::AOD_INDEX];
+  const MatrixBasedChannelModel::DoubleVector &aod = channelParams.m_angle[isSameDirection ? MatrixBasedChannelModel::AOD_INDEX : MatrixBasedChannelModel::AOA_INDEX];
+
+  NS_ASSERT (numCluster <= zoa.size () && numCluster <= channelParams.m_delay.size ());
+
+  // The Doppler of each cluster is the projection of the speeds on the
+  // center angles of the cluster, that do not change until the channel is
+  // regenerated (the update of Doppler is simplified by only taking the
+  // center angle of each cluster in to consideration)
+  table->m_rxDir.resize (3 * numCluster);
+  table->m_txDir.resize (3 * numCluster);
+  for (size_t cIndex = 0; cIndex < numCluster; cIndex++)
+    {
+      table->m_rxDir[3 * cIndex] = sin (zoa[cIndex] * M_PI / 180) * cos (aoa[cIndex] * M_PI / 180);
+      table->m_rxDir[3 * cIndex + 1] = sin (zoa[cIndex] * M_PI / 180) * sin (aoa[cIndex] * M_PI / 180);
+      table->m_rxDir[3 * cIndex + 2] = cos (zoa[cIndex] * M_PI / 180);
+      table->m_txDir[3 * cIndex] = sin (zod[cIndex] * M_PI / 180) * cos (aod[cIndex] * M_PI / 180);
+      table->m_txDir[3 * cIndex + 1] = sin (zod[cIndex] * M_PI / 180) * sin (aod[cIndex] * M_PI / 180);
+      table->m_txDir[3 * cIndex + 2] = cos (zod[cIndex] * M_PI / 180);
+    }
+
+  // The propagation delay term of each cluster in each band
+  table->m_delayRe.resize (numCluster * numBands);
+  table->m_delayIm.resize (numCluster * numBands);
+  size_t bIndex = 0;
+  for (auto sbit = psd.ConstBandsBegin (); sbit != psd.ConstBandsEnd (); ++sbit, ++bIndex)
+    {
+      double fsb = (*sbit).fc; // center frequency of the sub-band
+      for (size_t cIndex = 0; cIndex < numCluster; cIndex++)
+        {
+          double delay = -2 * M_PI * fsb * (channelParams.m_delay[cIndex]);
+          table->m_delayRe[cIndex * numBands + bIndex] = cos (delay);
+          table->m_delayIm[cIndex * numBands + bIndex] = sin (delay);
+        }
+    }
+
+  table->m_numBands = numBands;
+  table->m_spectrumModelUid = psd.GetSpectrumModelUid ();
+  table->m_valid = true;
+}
+
+void
+CachedThreeGppSpectrumPropagationLossModel::CalcBeamformingGain (Ptr<SpectrumValue> rxPsd,
+                                                                 const PhasedArrayModel::ComplexVector &longTerm,
+                                                                 const FadingTable &table,
+                                                                 const Vector &sSpeed, const Vector &uSpeed) const
+{
+  NS_LOG_FUNCTION (this);
+
+  // compute the doppler term: the phase advances linearly with the time
+  double slotTime = Simulator::Now ().GetSeconds ();
+  double factor = 2 * M_PI * slotTime * GetFrequency () / 3e8;
+  SumClusters (longTerm, table, factor, sSpeed, uSpeed, &m_gainRe, &m_gainIm);
+
+  // apply the beamforming gain to the bands that carry power
+  size_t bIndex = 0;
+  for (auto vit = rxPsd->ValuesBegin (); vit != rxPsd->ValuesEnd (); ++vit, ++bIndex)
+    {
+      if ((*vit) != 0.00)
+        {
+          *vit = (*vit) * (m_gainRe[bIndex] * m_gainRe[bIndex] + m_gainIm[bIndex] * m_gainIm[bIndex]);
+        }
+    }
+}
+
+void
+CachedThreeGppSpectrumPropagationLossModel::SumClusters (const PhasedArrayModel::ComplexVector &longTerm,
+                                                         const FadingTable &table, double factor,
+                                                         const Vector &sSpeed, const Vector &uSpeed,
+                                                         std::vector<double> *gainRe, std::vector<double> *gainIm)
+{
+  size_t numCluster = table.m_rxDir.size () / 3;
+  size_t numBands = table.m_numBands;
+  NS_ASSERT (numCluster <= longTerm.size ());
+
+  // The gain of each band is the sum over the clusters of the long term
+  // component, times the Doppler term (the same for all the bands), times
+  // the delay term: summed cluster by cluster for all the bands at once,
+  // over contiguous doubles
+  gainRe->assign (numBands, 0.0);
+  gainIm->assign (numBands, 0.0);
+  for (size_t cIndex = 0; cIndex < numCluster; cIndex++)
+    {
+      const double *rxDir = &table.m_rxDir[3 * cIndex];
+      const double *txDir = &table.m_txDir[3 * cIndex];
+      double tempDoppler = factor * ((rxDir[0] * uSpeed.x + rxDir[1] * uSpeed.y + rxDir[2] * uSpeed.z)
+                                     + (txDir[0] * sSpeed.x + txDir[1] * sSpeed.y + txDir[2] * sSpeed.z));
+      std::complex<double> weight = longTerm[cIndex] * exp (std::complex<double> (0, tempDoppler));
+      double weightRe = weight.real ();
+      double weightIm = weight.imag ();
+
+      const double *delayRe = &table.m_delayRe[cIndex * numBands];
+      const double *delayIm = &table.m_delayIm[cIndex * numBands];
+      double *re = gainRe->data ();
+      double *im = gainIm->data ();
+      for (size_t bIndex = 0; bIndex < numBands; bIndex++)
+        {
+          re[bIndex] += weightRe * delayRe[bIndex] - weightIm * delayIm[bIndex];
+          im[bIndex] += weightRe * delayIm[bIndex] + weightIm * delayRe[bIndex];
+        }
+    }
+}
+
+void
+CachedThreeGppSpectrumPropagationLossModel::CalcStaticBandGains (const MatrixBasedChannelModel::ChannelMatrix &channelMatrix,
+                                                                 const MatrixBasedChannelModel::ChannelParams &channelParams,
+                                                                 const std::vector<PhasedArrayModel::ComplexVector> &beams,
+                                                                 const PhasedArrayModel::ComplexVector &otherW, bool beamsAreS,
+                                                                 const SpectrumValue &psd,
+                                                                 std::vector<std::vector<double>> *gains)
+{
+  FadingTable table;
+  UpdateFadingTable (&table, channelMatrix, channelParams, psd);
+
+  // Without speed, the Doppler term is 1 whatever the time
+  PhasedArrayModel::ComplexVector longTerm;
+  std::vector<double> gainRe;
+  std::vector<double> gainIm;
+  gains->resize (beams.size ());
+  for (size_t beam = 0; beam < beams.size (); ++beam)
+    {
+      CalcLongTerm (channelMatrix, beamsAreS ? beams[beam] : otherW, beamsAreS ? otherW : beams[beam], &longTerm);
+      SumClusters (longTerm, table, 0.0, Vector (), Vector (), &gainRe, &gainIm);
+      std::vector<double> &beamGains = (*gains)[beam];
+      beamGains.resize (gainRe.size ());
+      for (size_t bIndex = 0; bIndex < gainRe.size (); ++bIndex)
+        {
+          beamGains[bIndex] = gainRe[bIndex] * gainRe[bIndex] + gainIm[bIndex] * gainIm[bIndex];
+        }
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,313 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef CACHED_THREE_GPP_SPECTRUM_PROPAGATION_LOSS_H
+#define CACHED_THREE_GPP_SPECTRUM_PROPAGATION_LOSS_H
+
+#include "ns3/three-gpp-spectrum-propagation-loss-model.h"
+#include "nr-wrap-around-model.h"
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class NrCouplingGainEngine;
+
+/**
+ * \ingroup nr-utils
+ * \brief 3GPP Spectrum Propagation Loss Model that keeps the long term
+ * components of several pairs of beams
+ *
+ * ThreeGppSpectrumPropagationLossModel keeps, for each pair of antennas,
+ * the long term component (the projection of the beamforming vectors of the
+ * two antennas on each cluster of the channel matrix) of the last pair of
+ * beamforming vectors, and recomputes it when one of them changes. A gNB
+ * that changes beam to serve its UEs slot by slot makes every reception of
+ * an interfering UE, and often of a served one, miss that cache.
+ *
+ * This class keeps, for each pair of antennas, the long term components of
+ * up to LongTermCacheSize pairs of beamforming vectors, evicting the least
+ * recently used one, for the current generation of the channel matrix. The
+ * entries of a pair are dropped when its channel matrix is regenerated.
+ *
+ * The small scale fading is computed as in ThreeGppSpectrumPropagationLossModel,
+ * with the terms that only depend on the channel kept with the long term
+ * components: the delay term of each cluster in each band, and the
+ * projections of the cluster angles used for the Doppler. A reception then
+ * computes one Doppler phase per cluster, and sums the clusters for all the
+ * bands at once.
+ *
+ * When the attribute vScatt is not zero, the additional Doppler of the
+ * moving scatterers needs the random variable of the base class, and the
+ * received PSD is computed by ThreeGppSpectrumPropagationLossModel.
+ *
+ * With a WrapAroundModel, the channel of a link is computed between the
+ * image of the site nearest to the other node (see NrWrapAroundModel).
+ *
+ * With a NrCouplingGainEngine, the gain of each band of a link between two
+ * nodes that do not move is taken from the table of the engine when it has
+ * the pair of beams, for the current channel matrix: the result is the same
+ * as the one computed here, because the engine uses CalcStaticBandGains.
+ *
+ * \see ThreeGppSpectrumPropagationLossModel
+ */
+class CachedThreeGppSpectrumPropagationLossModel : public ThreeGppSpectrumPropagationLossModel
+{
+public:
+  /**
+   * Constructor
+   */
+  CachedThreeGppSpectrumPropagationLossModel ();
+
+  /**
+   * Destructor
+   */
+  virtual ~CachedThreeGppSpectrumPropagationLossModel ();
+
+  /**
+   * Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId ();
+
+  /**
+   * \brief Set the number of pairs of beamforming vectors kept for each pair of antennas
+   * \param size the number of pairs, at least 1
+   */
+  void SetLongTermCacheSize (uint32_t size);
+
+  /**
+   * \return the number of pairs of beamforming vectors kept for each pair of antennas
+   */
+  uint32_t GetLongTermCacheSize () const;
+
+  /**
+   * \return the number of long term components found in the cache
+   */
+  uint64_t GetLongTermCacheHits () const;
+
+  /**
+   * \return the number of long term components computed
+   */
+  uint64_t GetLongTermCacheMisses () const;
+
+  /**
+   * \brief Set the wrap-around model of the links
+   * \param model the wrap-around model, or nullptr for none
+   */
+  void SetWrapAroundModel (const Ptr<NrWrapAroundModel> &model);
+
+  /**
+   * \return the wrap-around model of the links, or nullptr
+   */
+  Ptr<NrWrapAroundModel> GetWrapAroundModel () const;
+
+  /**
+   * \brief Set the engine whose tables are used for the links between static nodes
+   * \param engine the engine, or nullptr for none
+   */
+  void SetCouplingGainEngine (const Ptr<const NrCouplingGainEngine> &engine);
+
+  /**
+   * \param w a beamforming vector
+   * \return the hash of the vector
+   */
+  static size_t HashBeamformingVector (const PhasedArrayModel::ComplexVector &w);
+
+  /**
+   * \brief Compute the gain of each band of a channel between two nodes
+   * that do not move, for several beams of one of them
+   *
+   * It is the factor that DoCalcRxPowerSpectralDensity applies to the bands
+   * of the PSD, computed in the same way, so that the results are identical.
+   * It only uses its arguments, and can be called by several threads for
+   * different channels. The arguments are references, so that the threads
+   * do not touch the reference counts of the channel and of the PSD, which
+   * are not atomic.
+   *
+   * \param channelMatrix the channel matrix H[u][s][n]
+   * \param channelParams the parameters of the channel
+   * \param beams the beamforming vectors of one antenna
+   * \param otherW the beamforming vector of the other antenna
+   * \param beamsAreS true if beams are the vectors of the s antenna
+   * \param psd a PSD with the bands
+   * \param gains the gain of each band, for each beam
+   */
+  static void CalcStaticBandGains (const MatrixBasedChannelModel::ChannelMatrix &channelMatrix,
+                                   const MatrixBasedChannelModel::ChannelParams &channelParams,
+                                   const std::vector<PhasedArrayModel::ComplexVector> &beams,
+                                   const PhasedArrayModel::ComplexVector &otherW, bool beamsAreS,
+                                   const SpectrumValue &psd,
+                                   std::vector<std::vector<double>> *gains);
+
+  /**
+   * \brief Computes the received PSD.
+   *
+   * This function computes the received PSD by applying the 3GPP fast fading
+   * model and the beamforming gain, as ThreeGppSpectrumPropagationLossModel,
+   * with the long term component taken from the cache when possible.
+   *
+   * \param txPsd tx PSD
+   * \param a first node mobility model
+   * \param b second node mobility model
+   * \param aPhasedArrayModel the antenna array of the first node
+   * \param bPhasedArrayModel the antenna array of the second node
+   * \return the received PSD
+   */
+  virtual Ptr<SpectrumValue> DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
+                                                           Ptr<const MobilityModel> a,
+                                                           Ptr<const MobilityModel> b,
+                                                           Ptr<const PhasedArrayModel> aPhasedArrayModel,
+                                                           Ptr<const PhasedArrayModel> bPhasedArrayModel) const override;
+
+protected:
+  void DoDispose () override;
+
+private:
+  /**
+   * \brief The long term component of a pair of beamforming vectors
+   */
+  struct LongTermEntry
+  {
+    size_t m_sHash {0};                      //!< Hash of m_sW
+    size_t m_uHash {0};                      //!< Hash of m_uW
+    PhasedArrayModel::ComplexVector m_sW;    //!< Beamforming vector of the s antenna
+    PhasedArrayModel::ComplexVector m_uW;    //!< Beamforming vector of the u antenna
+    PhasedArrayModel::ComplexVector m_longTerm; //!< Long term component of each cluster
+    uint64_t m_lastUse {0};                  //!< When the entry was last used
+  };
+
+  /**
+   * \brief The terms of the small scale fading of a channel that do not
+   * depend on the beams nor on the time
+   */
+  struct FadingTable
+  {
+    bool m_valid {false};                    //!< True if the table was filled for the channel
+    SpectrumModelUid_t m_spectrumModelUid {0}; //!< The spectrum model of the bands
+    size_t m_numBands {0};                   //!< Number of bands
+    std::vector<double> m_delayRe;           //!< Real part of the delay term, [cluster][band]
+    std::vector<double> m_delayIm;           //!< Imaginary part of the delay term, [cluster][band]
+    std::vector<double> m_rxDir;             //!< Projections of the arrival angles of each cluster on x, y, z
+    std::vector<double> m_txDir;             //!< Projections of the departure angles of each cluster on x, y, z
+  };
+
+  /**
+   * \brief The long term components and the fading table of a pair of antennas
+   */
+  struct LongTermCache
+  {
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> m_channel; //!< The channel matrix of the entries
+    Time m_generatedTime;                    //!< When m_channel was generated
+    std::vector<LongTermEntry> m_entries;    //!< The entries, in no particular order
+    FadingTable m_fading;                    //!< The fading terms of m_channel
+  };
+
+  /**
+   * \brief Get the cache of a pair of antennas, emptied if the channel
+   * matrix was regenerated
+   * \param aId the id of the antenna of the first node
+   * \param bId the id of the antenna of the second node
+   * \param channelMatrix the channel matrix of the two antennas
+   * \return the cache of the pair
+   */
+  LongTermCache & GetCache (uint32_t aId, uint32_t bId,
+                            Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix) const;
+
+  /**
+   * \brief Get the long term component of a pair of antennas, from the cache
+   * or computed and added to it
+   * \param cache the cache of the pair
+   * \param sW the beamforming vector of the s antenna
+   * \param uW the beamforming vector of the u antenna
+   * \return the long term component of each cluster
+   */
+  const PhasedArrayModel::ComplexVector & GetLongTerm (LongTermCache &cache,
+                                                       const PhasedArrayModel::ComplexVector &sW,
+                                                       const PhasedArrayModel::ComplexVector &uW) const;
+
+  /**
+   * \brief Fill the fading table of a channel for the bands of a PSD, if needed
+   * \param table the table
+   * \param channelMatrix the channel matrix
+   * \param channelParams the parameters of the channel
+   * \param psd a PSD with the bands
+   */
+  static void UpdateFadingTable (FadingTable *table,
+                                 const MatrixBasedChannelModel::ChannelMatrix &channelMatrix,
+                                 const MatrixBasedChannelModel::ChannelParams &channelParams,
+                                 const SpectrumValue &psd);
+
+  /**
+   * \brief Compute the long term component
+   * \param channelMatrix the channel matrix H[u][s][n]
+   * \param sW the beamforming vector of the s antenna
+   * \param uW the beamforming vector of the u antenna
+   * \param longTerm the long term component of each cluster
+   */
+  static void CalcLongTerm (const MatrixBasedChannelModel::ChannelMatrix &channelMatrix,
+                            const PhasedArrayModel::ComplexVector &sW,
+                            const PhasedArrayModel::ComplexVector &uW,
+                            PhasedArrayModel::ComplexVector *longTerm);
+
+  /**
+   * \brief Sum over the clusters the long term component, times the Doppler
+   * and the delay terms, for each band
+   * \param longTerm the long term component of each cluster
+   * \param table the fading table of the channel
+   * \param factor the Doppler factor, 2 pi t fc / c
+   * \param sSpeed the speed of the first node
+   * \param uSpeed the speed of the second node
+   * \param gainRe the real part of the gain of each band
+   * \param gainIm the imaginary part of the gain of each band
+   */
+  static void SumClusters (const PhasedArrayModel::ComplexVector &longTerm,
+                           const FadingTable &table, double factor,
+                           const Vector &sSpeed, const Vector &uSpeed,
+                           std::vector<double> *gainRe, std::vector<double> *gainIm);
+
+  /**
+   * \brief Apply the Doppler and delay of each cluster to the long term
+   * component, and the resulting gain to each band of the PSD
+   * \param rxPsd the PSD, a copy of the tx PSD
+   * \param longTerm the long term component of each cluster
+   * \param table the fading table of the channel, for the bands of rxPsd
+   * \param sSpeed the speed of the first node
+   * \param uSpeed the speed of the second node
+   */
+  void CalcBeamformingGain (Ptr<SpectrumValue> rxPsd,
+                            const PhasedArrayModel::ComplexVector &longTerm,
+                            const FadingTable &table,
+                            const Vector &sSpeed, const Vector &uSpeed) const;
+
+  uint32_t m_longTermCacheSize {8};          //!< Pairs of beamforming vectors kept for each pair of antennas
+  mutable std::unordered_map<uint64_t, LongTermCache> m_longTermCache; //!< The cache of each pair of antennas
+  mutable uint64_t m_longTermCacheHits {0};   //!< Long term components found in the cache
+  mutable uint64_t m_longTermCacheMisses {0}; //!< Long term components computed
+  mutable uint64_t m_useCounter {0};          //!< Counter of the uses of the cache, for the LRU eviction
+  mutable bool m_vScattRead {false};          //!< True when m_vScatt was read
+  mutable double m_vScatt {0.0};              //!< The attribute vScatt, read at the first reception
+  mutable std::vector<double> m_gainRe;      //!< Real part of the gain of each band, for the current reception
+  mutable std::vector<double> m_gainIm;      //!< Imaginary part of the gain of each band, for the current reception
+  Ptr<NrWrapAroundModel> m_wrapAround;       //!< The wrap-around model, if any
+  Ptr<const NrCouplingGainEngine> m_couplingGains; //!< The engine of the static links, if any
+};
+
+} // namespace ns3
+
+#endif /* CACHED_THREE_GPP_SPECTRUM_PROPAGATION_LOSS_H */
@@ -23,6 +23,11 @@
 #include "ns3/string.h"
 #include "ns3/simulator.h"
 #include "ns3/pointer.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/nr-perf-profiler.h"
+#include "ns3/nr-counters.h"
+#include "nr-wrap-around-model.h"
+#include <algorithm>
 
 namespace ns3 {
 
@@ -78,22 +83,52 @@ DistanceBasedThreeGppSpectrumPropagationLossModel::DoCalcRxPowerSpectralDensity
                                                                                  Ptr<const PhasedArrayModel> bPhasedArrayModel) const
 {
   NS_LOG_FUNCTION (this);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::CHANNEL);
   uint32_t aId = a->GetObject<Node> ()->GetId (); // id of the node a
   uint32_t bId = b->GetObject<Node> ()->GetId (); // id of the node b
 
-  Ptr<SpectrumValue> rxPsd = Copy<SpectrumValue> (txPsd);
   if (a->GetDistanceFrom (b) > m_maxDistance)
     {
       NS_LOG_LOGIC ("Distance between a: " << aId << "and  node b: "<<bId << " is higher than max allowed distance. Return 0 PSD.");
-      *rxPsd = 0.0;
-      return rxPsd;
+      // a new SpectrumValue is all zeros: no need to copy txPsd
+      NrCounters::Add (NrCounters::SPECTRUM_VALUES);
+      return Create<SpectrumValue> (txPsd->GetSpectrumModel ());
+    }
+
+  return ThreeGppSpectrumPropagationLossModel::DoCalcRxPowerSpectralDensity (txPsd, a, b, aPhasedArrayModel, bPhasedArrayModel);
+}
+
+void
+DistanceBasedThreeGppSpectrumPropagationLossModel::CullOutOfRangeReceivers (Ptr<SpectrumChannel> channel) const
+{
+  NS_LOG_FUNCTION (this << channel);
+
+  // RangePropagationLossModel gives -1000 dBm beyond its range, whatever the
+  // tx power: at the end of the chain, the loss of an out of range receiver
+  // is 1000 dB, that no real path loss reaches
+  Ptr<RangePropagationLossModel> range = CreateObject<RangePropagationLossModel> ();
+  range->SetAttribute ("MaxRange", DoubleValue (m_maxDistance));
+
+  // Add it at the end of the chain, so that the first model is still the
+  // one that the users of the channel expect; with wrap-around, at the end
+  // of the wrapped chain, so that the range is between the wrapped positions
+  Ptr<PropagationLossModel> last = NrWrapAroundPropagationLossModel::Unwrap (channel->GetPropagationLossModel ());
+  if (last == nullptr)
+    {
+      channel->AddPropagationLossModel (range);
     }
   else
     {
-      return ThreeGppSpectrumPropagationLossModel::DoCalcRxPowerSpectralDensity (txPsd, a, b, aPhasedArrayModel, bPhasedArrayModel);
+      while (last->GetNext () != nullptr)
+        {
+          last = last->GetNext ();
+        }
+      last->SetNext (range);
     }
 
-  return rxPsd;
+  DoubleValue maxLossDb;
+  channel->GetAttribute ("MaxLossDb", maxLossDb);
+  channel->SetAttribute ("MaxLossDb", DoubleValue (std::min (maxLossDb.Get (), m_cullingLossDb)));
 }
 
 
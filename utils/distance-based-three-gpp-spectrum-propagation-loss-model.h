@@ -20,6 +20,7 @@
 #define DISTANCE_BASED_THREE_GPP_SPECTRUM_PROPAGATION_LOSS_H
 
 #include "ns3/three-gpp-spectrum-propagation-loss-model.h"
+#include "ns3/spectrum-channel.h"
 
 namespace ns3 {
 
@@ -77,6 +78,8 @@ public:
    * \param aPhasedArrayModel the antenna array of the first node
    * \param bPhasedArrayModel the antenna array of the second node
    * \return the received PSD
+   *
+   * \see CullOutOfRangeReceivers
    */
   virtual Ptr<SpectrumValue> DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
                                                            Ptr<const MobilityModel> a,
@@ -84,8 +87,32 @@ public:
                                                            Ptr<const PhasedArrayModel> aPhasedArrayModel,
                                                            Ptr<const PhasedArrayModel> bPhasedArrayModel) const override;
 
+  /**
+   * \brief Make the channel skip the receivers that are out of range
+   *
+   * The spectrum channel computes the path loss of each receiver before the
+   * spectrum propagation loss, and does not deliver the signal (no StartRx)
+   * to the receivers whose loss is higher than its attribute MaxLossDb.
+   * This function adds at the end of the propagation loss chain of the
+   * channel a RangePropagationLossModel with the current max distance,
+   * and lowers MaxLossDb under the loss it gives beyond the range: the
+   * receivers that are out of range do not get the zero PSD anymore, and
+   * do not process it. Call it after the propagation loss model is added
+   * to the channel; a later change of the max distance does not update it.
+   *
+   * NrHelper calls it for the channels it creates with this model.
+   *
+   * \param channel the channel that uses this model
+   */
+  void CullOutOfRangeReceivers (Ptr<SpectrumChannel> channel) const;
+
 private:
 
+  /**
+   * The MaxLossDb set by CullOutOfRangeReceivers, under the 1000 dB loss of
+   * RangePropagationLossModel beyond its range
+   */
+  const double m_cullingLossDb {999.0};
   double m_maxDistance {1000}; //!< the maximum distance of the nodes a and b in order to calcluate fast fading and the beamforming gain
 };
 } // namespace ns3
@@ -0,0 +1,285 @@
+#!/usr/bin/env python3
+# -*- Mode: python; py-indent-offset: 4; indent-tabs-mode: nil; coding: utf-8; -*-
+#
+#   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+#
+#   This program is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License version 2 as
+#   published by the Free Software Foundation;
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program; if not, write to the Free Software
+#   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+#
+"""
+Generate the constexpr SINR-BLER tables of the EESM error models.
+
+The input is a text file with one simulated curve every three lines:
+
+    <base graph (1 or 2)> <MCS> <CB size>
+    <SINR (dB) of each point>
+    <BLER of each point>
+
+Empty lines and lines starting with '#' are ignored. Each (base graph, MCS)
+needs at least one curve; the MCSs without simulated data use the curve
+"0 / 0.0 / 0.0". The numbers are copied as they are written in the input.
+
+The output replaces, in the C++ file, the lines between the GENERATED_BEGIN
+and GENERATED_END markers with the flat arrays read by
+NrEesmErrorModel::BlerTable, and a constexpr BlerTable named after the table,
+with the prefix "Flat". Usage:
+
+    python3 utils/eesm-bler/generate-eesm-bler-tables.py \\
+        utils/eesm-bler/nr-eesm-t1-bler.txt model/nr-eesm-t1.cc BlerForSinr1
+
+Each curve is also fitted with BLER = 0.5 * erfc ((SINR - mean) / (sqrt (2) * std)),
+the analytic mapping of NrEesmErrorModel (BlerMapping = Fit), and the tool
+prints the maximum deviation of the fits from the simulated points. With
+--report, it only prints the deviations, without writing the output.
+"""
+
+import argparse
+import math
+import statistics
+import sys
+
+GENERATED_BEGIN = '// GENERATED_BEGIN by utils/eesm-bler/generate-eesm-bler-tables.py: do not edit\n'
+GENERATED_END = '// GENERATED_END\n'
+VALUES_PER_LINE = 8
+
+
+def read_curves(path):
+    """Read the curves, as a dictionary (base graph, MCS) -> {CB size: (SINR, BLER)}"""
+    with open(path) as f:
+        lines = [l.strip() for l in f if l.strip() and not l.startswith('#')]
+    if len(lines) % 3 != 0:
+        sys.exit('%s: the number of lines is not a multiple of 3' % path)
+
+    curves = {}
+    for i in range(0, len(lines), 3):
+        header = lines[i].split()
+        sinr = lines[i + 1].split()
+        bler = lines[i + 2].split()
+        if len(header) != 3:
+            sys.exit('%s: wrong curve header "%s"' % (path, lines[i]))
+        bg, mcs, cb_size = (int(v) for v in header)
+        if bg not in (1, 2):
+            sys.exit('%s: wrong base graph %d' % (path, bg))
+        if len(sinr) != len(bler) or not sinr:
+            sys.exit('%s: the curve %s has %d SINR and %d BLER points'
+                     % (path, lines[i], len(sinr), len(bler)))
+        if [float(v) for v in sinr] != sorted(float(v) for v in sinr):
+            sys.exit('%s: the SINR of the curve %s are not sorted' % (path, lines[i]))
+        row = curves.setdefault((bg - 1, mcs), {})
+        if cb_size in row:
+            sys.exit('%s: duplicated curve %s' % (path, lines[i]))
+        row[cb_size] = (sinr, bler)
+    return curves
+
+
+def fit_bler(sinr, bler):
+    """Fit the curve with 0.5 * erfc ((sinr - mean) / (sqrt (2) * std)), return (mean, std)
+
+    The first guess is the linear regression of the SINR over the inverse CDF
+    of the waterfall points (0 < BLER < 1); it is refined by Gauss-Newton
+    on the BLER of all the points. A curve without waterfall points is fitted
+    with a step (std = 0) between its last point with BLER >= 0.5 and the next
+    one.
+    """
+    x = [float(v) for v in sinr]
+    y = [float(v) for v in bler]
+    normal = statistics.NormalDist ()
+
+    waterfall = [(xi, normal.inv_cdf (1.0 - yi)) for xi, yi in zip(x, y) if 0.0 < yi < 1.0]
+    if len(waterfall) < 2:
+        below = [xi for xi, yi in zip(x, y) if yi >= 0.5]
+        above = [xi for xi, yi in zip(x, y) if yi < 0.5]
+        if below and above:
+            return (0.5 * (below[-1] + above[0]), 0.0)
+        return (x[-1] if below else x[0], 0.0)
+
+    # sinr = mean + std * z
+    zm = sum(z for _, z in waterfall) / len(waterfall)
+    xm = sum(xi for xi, _ in waterfall) / len(waterfall)
+    szz = sum((z - zm) ** 2 for _, z in waterfall)
+    std = max(sum((z - zm) * (xi - xm) for xi, z in waterfall) / szz, 1e-3) if szz > 0 else 1e-3
+    mean = xm - std * zm
+
+    for _ in range(50):
+        # residuals and Jacobian of 0.5 * erfc (t / sqrt (2)), with t = (x - mean) / std
+        jtj = [[0.0, 0.0], [0.0, 0.0]]
+        jtr = [0.0, 0.0]
+        for xi, yi in zip(x, y):
+            t = (xi - mean) / std
+            r = yi - 0.5 * math.erfc(t / math.sqrt(2))
+            d = math.exp(-0.5 * t * t) / math.sqrt(2 * math.pi)
+            j = (d / std, d * t / std)
+            for a in range(2):
+                jtr[a] += j[a] * r
+                for b in range(2):
+                    jtj[a][b] += j[a] * j[b]
+        det = jtj[0][0] * jtj[1][1] - jtj[0][1] * jtj[1][0]
+        if abs(det) < 1e-30:
+            break
+        dm = (jtj[1][1] * jtr[0] - jtj[0][1] * jtr[1]) / det
+        ds = (jtj[0][0] * jtr[1] - jtj[1][0] * jtr[0]) / det
+        mean += dm
+        std = max(std + ds, 1e-3)
+        if abs(dm) < 1e-9 and abs(ds) < 1e-9:
+            break
+    return (mean, std)
+
+
+def fit_deviation(sinr, bler, mean, std):
+    """Maximum absolute deviation of the fit from the points of the curve"""
+    deviation = 0.0
+    for xi, yi in zip(sinr, bler):
+        xi = float(xi)
+        if std > 0:
+            fit = 0.5 * math.erfc((xi - mean) / (math.sqrt(2) * std))
+        else:
+            fit = 1.0 if xi < mean else 0.0
+        deviation = max(deviation, abs(fit - float(yi)))
+    return deviation
+
+
+def report(curves, name):
+    """Print the maximum deviation of the fits, overall and of the worst curves"""
+    deviations = []
+    for (bg, mcs), row in sorted(curves.items()):
+        for cb_size, (sinr, bler) in sorted(row.items()):
+            if cb_size == 0:
+                continue
+            mean, std = fit_bler(sinr, bler)
+            deviations.append((fit_deviation(sinr, bler, mean, std), bg + 1, mcs, cb_size))
+    deviations.sort(reverse=True)
+    print('%s: %d fitted curves, max deviation %.4f, mean of the max deviation of each curve %.4f'
+          % (name, len(deviations), deviations[0][0],
+             sum(d[0] for d in deviations) / len(deviations)))
+    for deviation, bg, mcs, cb_size in deviations[:5]:
+        print('  BG TYPE %d, MCS %d, CBS %d: max deviation %.4f' % (bg, mcs, cb_size, deviation))
+
+
+def format_values(values, indent='  '):
+    """Format the values, VALUES_PER_LINE per line"""
+    out = []
+    for i in range(0, len(values), VALUES_PER_LINE):
+        out.append(indent + ', '.join(values[i:i + VALUES_PER_LINE]) + ',\n')
+    return ''.join(out)
+
+
+def generate(curves, name):
+    """Generate the C++ code of the flat table"""
+    num_bg = max(bg for bg, _ in curves) + 1
+    num_mcs = max(mcs for _, mcs in curves) + 1
+    for bg in range(num_bg):
+        for mcs in range(num_mcs):
+            if (bg, mcs) not in curves:
+                sys.exit('No curve for base graph %d and MCS %d' % (bg + 1, mcs))
+
+    row_offset = []
+    cb_sizes = []
+    point_offset = []
+    fit_mean = []
+    fit_std = []
+    sinr_code = ''
+    bler_code = ''
+    num_points = 0
+    for bg in range(num_bg):
+        for mcs in range(num_mcs):
+            row_offset.append(str(len(cb_sizes)))
+            for cb_size, (sinr, bler) in sorted(curves[(bg, mcs)].items()):
+                cb_sizes.append(str(cb_size))
+                point_offset.append(str(num_points))
+                num_points += len(sinr)
+                mean, std = fit_bler(sinr, bler)
+                fit_mean.append('%.6e' % mean)
+                fit_std.append('%.6e' % std)
+                comment = '  // BG TYPE %d, MCS %d, CBS %d\n' % (bg + 1, mcs, cb_size)
+                sinr_code += comment + format_values(sinr)
+                bler_code += comment + format_values(bler)
+    row_offset.append(str(len(cb_sizes)))
+    point_offset.append(str(num_points))
+    indent = ' ' * len('static constexpr NrEesmErrorModel::BlerTable Flat%s (' % name)
+
+    return (GENERATED_BEGIN +
+            '/**\n'
+            ' * \\brief First CB of each (base graph, MCS) of %s, plus the end\n'
+            ' */\n'
+            'static constexpr uint32_t %sRowOffset[] = {\n%s};\n\n'
+            '/**\n'
+            ' * \\brief Sorted CB sizes of each (base graph, MCS) of %s\n'
+            ' */\n'
+            'static constexpr uint32_t %sCbSize[] = {\n%s};\n\n'
+            '/**\n'
+            ' * \\brief First point of each CB of %s, plus the end\n'
+            ' */\n'
+            'static constexpr uint32_t %sPointOffset[] = {\n%s};\n\n'
+            '/**\n'
+            ' * \\brief Mean (dB) of the fit of each CB of %s\n'
+            ' */\n'
+            'static constexpr double %sFitMean[] = {\n%s};\n\n'
+            '/**\n'
+            ' * \\brief Standard deviation (dB) of the fit of each CB of %s (0 for a step)\n'
+            ' */\n'
+            'static constexpr double %sFitStdDev[] = {\n%s};\n\n'
+            '/**\n'
+            ' * \\brief SINR points (dB) of all the curves of %s\n'
+            ' */\n'
+            'static constexpr double %sSinrDb[] = {\n%s};\n\n'
+            '/**\n'
+            ' * \\brief BLER points of all the curves of %s\n'
+            ' */\n'
+            'static constexpr double %sBler[] = {\n%s};\n\n'
+            '/**\n'
+            ' * \\brief Flat layout of %s, shared by all the error models\n'
+            ' */\n'
+            'static constexpr NrEesmErrorModel::BlerTable Flat%s (%d, %d, %sRowOffset, %sCbSize,\n'
+            '%s%sPointOffset, %sSinrDb, %sBler,\n'
+            '%s%sFitMean, %sFitStdDev);\n'
+            % (name, name, format_values(row_offset),
+               name, name, format_values(cb_sizes),
+               name, name, format_values(point_offset),
+               name, name, format_values(fit_mean),
+               name, name, format_values(fit_std),
+               name, name, sinr_code,
+               name, name, bler_code,
+               name, name, num_bg, num_mcs, name, name, indent, name, name, name,
+               indent, name, name) +
+            GENERATED_END)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('input', help='text file with the curves')
+    parser.add_argument('output', help='C++ file with the GENERATED_BEGIN and GENERATED_END markers')
+    parser.add_argument('name', help='name of the table, e.g. BlerForSinr1')
+    parser.add_argument('--report', action='store_true',
+                        help='only print the deviation of the fits')
+    args = parser.parse_args()
+
+    curves = read_curves(args.input)
+    report(curves, args.name)
+    if args.report:
+        return
+
+    code = generate(curves, args.name)
+
+    with open(args.output) as f:
+        source = f.read()
+    begin = source.find(GENERATED_BEGIN)
+    end = source.find(GENERATED_END)
+    if begin < 0 or end < begin:
+        sys.exit('%s: no GENERATED_BEGIN and GENERATED_END markers' % args.output)
+    source = source[:begin] + code + source[end + len(GENERATED_END):]
+    with open(args.output, 'w') as f:
+        f.write(source)
+
+
+if __name__ == '__main__':
+    main()
@@ -27,6 +27,8 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/abort.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/tcp-socket-factory.h"
 #include "ns3/udp-socket-factory.h"
@@ -63,6 +65,14 @@ FileTransferApplication::GetTypeId (void)
                    TypeIdValue (TcpSocketFactory::GetTypeId ()),
                    MakeTypeIdAccessor (&FileTransferApplication::m_tid),
                    MakeTypeIdChecker ())
+    .AddAttribute ("ReuseSocket",
+                   "If true, the socket is opened by the first SendFile and "
+                   "kept for the following files, that are queued after the "
+                   "bytes not sent yet instead of being refused. FileSize "
+                   "cannot be zero then.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&FileTransferApplication::m_reuseSocket),
+                   MakeBooleanChecker ())
     .AddTraceSource ("Tx", "A new packet is created and is sent",
                      MakeTraceSourceAccessor (&FileTransferApplication::m_txTrace),
                      "ns3::Packet::TracedCallback")
@@ -119,12 +129,50 @@ bool
 FileTransferApplication::SendFile (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_reuseSocket)
+    {
+      return QueueFile ();
+    }
+
   if (m_socket)
     {
       NS_LOG_FUNCTION ("Socket exists; ignoring request");
       return false;
     }
   m_totBytes = 0;
+  OpenSocket ();
+  NS_LOG_LOGIC ("FileTransferApplication: Starting file transfer of size " << m_fileSize << " at time " << Simulator::Now ().GetSeconds ());
+  if (m_connected || m_tid == UdpSocketFactory::GetTypeId ())
+    {
+      SendData ();
+    }
+  return true;
+}
+
+bool
+FileTransferApplication::QueueFile (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_fileSize == 0, "FileTransferApplication with ReuseSocket needs a FileSize");
+
+  m_pendingBytes += m_fileSize;
+  NS_LOG_LOGIC ("FileTransferApplication: Queueing a file of size " << m_fileSize << ", "
+                << m_pendingBytes << " bytes to send");
+  if (!m_socket)
+    {
+      OpenSocket ();
+    }
+  if (m_connected || m_tid == UdpSocketFactory::GetTypeId ())
+    {
+      SendPendingData ();
+    }
+  return true;
+}
+
+void
+FileTransferApplication::OpenSocket (void)
+{
+  NS_LOG_FUNCTION (this);
   m_socket = Socket::CreateSocket (GetNode (), m_tid);
 
   if (Inet6SocketAddress::IsMatchingType (m_peer))
@@ -146,12 +194,6 @@ FileTransferApplication::SendFile (void)
   m_socket->SetCloseCallbacks (
     MakeCallback (&FileTransferApplication::CloseSucceeded, this),
     MakeCallback (&FileTransferApplication::CloseFailed, this));
-  NS_LOG_LOGIC ("FileTransferApplication: Starting file transfer of size " << m_fileSize << " at time " << Simulator::Now ().GetSeconds ());
-  if (m_connected || m_tid == UdpSocketFactory::GetTypeId ())
-    {
-      SendData ();
-    }
-  return true;
 }
 
 // Application Methods
@@ -181,6 +223,12 @@ void FileTransferApplication::SendData (void)
 {
   NS_LOG_FUNCTION (this);
 
+  if (m_reuseSocket)
+    {
+      SendPendingData ();
+      return;
+    }
+
   while (m_fileSize == 0 || m_totBytes < m_fileSize)
     { // Time to send more
       uint32_t toSend = m_sendSize;
@@ -218,6 +266,29 @@ void FileTransferApplication::SendData (void)
     }
 }
 
+void FileTransferApplication::SendPendingData (void)
+{
+  NS_LOG_FUNCTION (this << m_pendingBytes);
+
+  while (m_pendingBytes > 0)
+    {
+      uint32_t toSend = static_cast<uint32_t> (std::min<uint64_t> (m_sendSize, m_pendingBytes));
+      Ptr<Packet> packet = Create<Packet> (toSend);
+      m_txTrace (packet);
+      int actual = m_socket->Send (packet);
+      if (actual > 0)
+        {
+          m_totBytes += actual;
+          m_pendingBytes -= actual;
+        }
+      // As in SendData, the send callback calls again when there is room
+      if ((unsigned)actual != toSend)
+        {
+          break;
+        }
+    }
+}
+
 void FileTransferApplication::ConnectionSucceeded (Ptr<Socket> socket)
 {
   NS_LOG_FUNCTION (this << socket);
@@ -252,6 +323,12 @@ void FileTransferApplication::DataSend (Ptr<Socket>, uint32_t)
 {
   NS_LOG_FUNCTION (this);
 
+  if (m_reuseSocket && m_pendingBytes == 0)
+    {
+      // The UDP sockets call back after every packet: nothing to refill
+      return;
+    }
+
   if (m_connected || m_tid == UdpSocketFactory::GetTypeId ())
     { // Only send new data if the connection has completed
       NS_LOG_LOGIC ("FileTransferApplication DataSent callback triggers new SendData() call");
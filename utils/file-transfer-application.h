@@ -87,7 +87,7 @@ public:
 
   /**
    * \brief Get the total number of bytes that have been sent during this
-   *        object's lifetime.
+   *        object's lifetime (of the current file, without ReuseSocket).
    *
    * return the total number of bytes that have been sent
    */
@@ -98,6 +98,9 @@ public:
    *
    * return true if another file was started; false if the request
    *        didn't succeed (possibly because another transfer is ongoing)
+   *
+   * With ReuseSocket, the file is queued after the bytes of the previous
+   * files that are not sent yet, and the function always returns true.
    */
   bool SendFile (void);
 
@@ -119,6 +122,22 @@ private:
    */
   void SendData ();
 
+  /**
+   * \brief Open, bind and connect the socket, and set its callbacks
+   */
+  void OpenSocket (void);
+
+  /**
+   * \brief Queue a file on the reused socket, see the ReuseSocket attribute
+   * \return true
+   */
+  bool QueueFile (void);
+
+  /**
+   * \brief Send the queued bytes until the L4 transmission buffer is full
+   */
+  void SendPendingData (void);
+
   Ptr<Socket>     m_socket;       //!< Associated socket
   Address         m_peer;         //!< Peer address
   bool            m_connected;    //!< True if connected
@@ -126,6 +145,8 @@ private:
   uint32_t        m_fileSize;     //!< Limit total number of bytes sent
   uint32_t        m_totBytes;     //!< Total bytes sent so far
   TypeId          m_tid;          //!< The type of protocol to use.
+  bool            m_reuseSocket {false}; //!< The ReuseSocket attribute
+  uint64_t        m_pendingBytes {0};    //!< Queued bytes not sent yet, with ReuseSocket
 
   /// Traced Callback: sent packets
   TracedCallback<Ptr<const Packet> > m_txTrace;
@@ -0,0 +1,305 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-building-index.h"
+#include <ns3/log.h>
+#include <ns3/double.h>
+#include <ns3/simulator.h>
+#include <ns3/building-list.h>
+#include <ns3/mobility-model.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrBuildingIndex");
+NS_OBJECT_ENSURE_REGISTERED (NrBuildingsChannelConditionModel);
+
+/// The shared index of GetIndex
+static Ptr<const NrBuildingIndex> g_buildingIndex;
+/// The cell size of g_buildingIndex
+static double g_buildingIndexCellSize = 0.0;
+
+NrBuildingIndex::NrBuildingIndex (double cellSize)
+  : m_cellSize (cellSize)
+{
+  NS_LOG_FUNCTION (this << cellSize);
+  NS_ABORT_MSG_IF (cellSize <= 0.0, "The cell size must be positive");
+
+  m_xMin = m_yMin = std::numeric_limits<double>::max ();
+  m_xMax = m_yMax = std::numeric_limits<double>::lowest ();
+  for (BuildingList::Iterator it = BuildingList::Begin (); it != BuildingList::End (); ++it)
+    {
+      Box box = (*it)->GetBoundaries ();
+      m_buildings.push_back (*it);
+      m_boxes.push_back (box);
+      m_xMin = std::min (m_xMin, box.xMin);
+      m_xMax = std::max (m_xMax, box.xMax);
+      m_yMin = std::min (m_yMin, box.yMin);
+      m_yMax = std::max (m_yMax, box.yMax);
+    }
+  if (m_buildings.empty ())
+    {
+      return;
+    }
+
+  // at most 4M cells, of at least the given size
+  const double maxCells = 4194304.0;
+  double area = std::max (m_xMax - m_xMin, m_cellSize) * std::max (m_yMax - m_yMin, m_cellSize);
+  m_cellSize = std::max (m_cellSize, std::sqrt (area / maxCells));
+  m_numColumns = static_cast<uint32_t> (std::floor ((m_xMax - m_xMin) / m_cellSize)) + 1;
+  m_numRows = static_cast<uint32_t> (std::floor ((m_yMax - m_yMin) / m_cellSize)) + 1;
+  m_cells.resize (static_cast<size_t> (m_numColumns) * m_numRows);
+
+  // the boxes are widened by a small part of a cell, so that the rounding
+  // of the walk of IsLineOfSightBlocked near a corner does not miss them
+  const double margin = 0.01;
+  for (uint32_t i = 0; i < m_boxes.size (); ++i)
+    {
+      const Box &box = m_boxes[i];
+      uint32_t rowEnd = GetRow ((box.yMax - m_yMin) / m_cellSize + margin);
+      uint32_t columnEnd = GetColumn ((box.xMax - m_xMin) / m_cellSize + margin);
+      for (uint32_t row = GetRow ((box.yMin - m_yMin) / m_cellSize - margin); row <= rowEnd; ++row)
+        {
+          for (uint32_t column = GetColumn ((box.xMin - m_xMin) / m_cellSize - margin); column <= columnEnd; ++column)
+            {
+              m_cells[static_cast<size_t> (row) * m_numColumns + column].push_back (i);
+            }
+        }
+    }
+  NS_LOG_INFO ("Indexed " << m_buildings.size () << " buildings in " << m_numColumns << "x" << m_numRows
+                          << " cells of " << m_cellSize << " m");
+}
+
+Ptr<const NrBuildingIndex>
+NrBuildingIndex::GetIndex (double cellSize)
+{
+  if (g_buildingIndex == nullptr
+      || g_buildingIndexCellSize != cellSize
+      || g_buildingIndex->GetNumBuildings () != BuildingList::GetNBuildings ())
+    {
+      if (g_buildingIndex == nullptr)
+        {
+          Simulator::ScheduleDestroy (&NrBuildingIndex::ResetIndex);
+        }
+      g_buildingIndex = Create<NrBuildingIndex> (cellSize);
+      g_buildingIndexCellSize = cellSize;
+    }
+  return g_buildingIndex;
+}
+
+void
+NrBuildingIndex::ResetIndex ()
+{
+  g_buildingIndex = nullptr;
+}
+
+uint32_t
+NrBuildingIndex::GetNumBuildings () const
+{
+  return static_cast<uint32_t> (m_buildings.size ());
+}
+
+uint32_t
+NrBuildingIndex::GetColumn (double x) const
+{
+  return static_cast<uint32_t> (std::min (std::max (std::floor (x), 0.0), m_numColumns - 1.0));
+}
+
+uint32_t
+NrBuildingIndex::GetRow (double y) const
+{
+  return static_cast<uint32_t> (std::min (std::max (std::floor (y), 0.0), m_numRows - 1.0));
+}
+
+Ptr<Building>
+NrBuildingIndex::GetBuilding (const Vector &position) const
+{
+  if (m_buildings.empty ()
+      || position.x < m_xMin || position.x > m_xMax || position.y < m_yMin || position.y > m_yMax)
+    {
+      return nullptr;
+    }
+  size_t cell = static_cast<size_t> (GetRow ((position.y - m_yMin) / m_cellSize)) * m_numColumns
+    + GetColumn ((position.x - m_xMin) / m_cellSize);
+  for (uint32_t i : m_cells[cell])
+    {
+      if (m_boxes[i].IsInside (position))
+        {
+          return m_buildings[i];
+        }
+    }
+  return nullptr;
+}
+
+bool
+NrBuildingIndex::IsLineOfSightBlocked (const Vector &l1, const Vector &l2) const
+{
+  if (m_buildings.empty ())
+    {
+      return false;
+    }
+
+  // Clip the segment to the grid (Liang-Barsky), in the XY plane
+  double dx = l2.x - l1.x;
+  double dy = l2.y - l1.y;
+  double t0 = 0.0;
+  double t1 = 1.0;
+  auto clip = [&t0, &t1] (double p, double q)
+    {
+      if (p == 0.0)
+        {
+          return q >= 0.0;
+        }
+      double r = q / p;
+      if (p < 0.0)
+        {
+          if (r > t1)
+            {
+              return false;
+            }
+          t0 = std::max (t0, r);
+        }
+      else
+        {
+          if (r < t0)
+            {
+              return false;
+            }
+          t1 = std::min (t1, r);
+        }
+      return true;
+    };
+  if (!clip (-dx, l1.x - m_xMin) || !clip (dx, m_xMax - l1.x)
+      || !clip (-dy, l1.y - m_yMin) || !clip (dy, m_yMax - l1.y))
+    {
+      return false;
+    }
+
+  // Walk the cells crossed by the clipped segment, in order
+  double startX = (l1.x + t0 * dx - m_xMin) / m_cellSize;
+  double startY = (l1.y + t0 * dy - m_yMin) / m_cellSize;
+  double endX = (l1.x + t1 * dx - m_xMin) / m_cellSize;
+  double endY = (l1.y + t1 * dy - m_yMin) / m_cellSize;
+  uint32_t column = GetColumn (startX);
+  uint32_t row = GetRow (startY);
+  uint32_t endColumn = GetColumn (endX);
+  uint32_t endRow = GetRow (endY);
+  double lengthX = std::abs (endX - startX);
+  double lengthY = std::abs (endY - startY);
+  const double infinity = std::numeric_limits<double>::infinity ();
+  double deltaX = lengthX > 0.0 ? 1.0 / lengthX : infinity;
+  double deltaY = lengthY > 0.0 ? 1.0 / lengthY : infinity;
+  double nextX = lengthX > 0.0 ? (dx > 0.0 ? column + 1.0 - startX : startX - column) * deltaX : infinity;
+  double nextY = lengthY > 0.0 ? (dy > 0.0 ? row + 1.0 - startY : startY - row) * deltaY : infinity;
+
+  while (true)
+    {
+      for (uint32_t i : m_cells[static_cast<size_t> (row) * m_numColumns + column])
+        {
+          if (m_boxes[i].IsIntersect (l1, l2))
+            {
+              return true;
+            }
+        }
+      if (column == endColumn && row == endRow)
+        {
+          return false;
+        }
+      // each step moves towards the last cell, so the walk ends
+      if (row == endRow || (column != endColumn && nextX < nextY))
+        {
+          column = dx > 0.0 ? column + 1 : column - 1;
+          nextX += deltaX;
+        }
+      else
+        {
+          row = dy > 0.0 ? row + 1 : row - 1;
+          nextY += deltaY;
+        }
+    }
+}
+
+NrBuildingsChannelConditionModel::NrBuildingsChannelConditionModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrBuildingsChannelConditionModel::~NrBuildingsChannelConditionModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+NrBuildingsChannelConditionModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrBuildingsChannelConditionModel")
+    .SetParent<ChannelConditionModel> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrBuildingsChannelConditionModel> ()
+    .AddAttribute ("CellSize",
+                   "The size of the cells of the index of the buildings (m)",
+                   DoubleValue (20.0),
+                   MakeDoubleAccessor (&NrBuildingsChannelConditionModel::m_cellSize),
+                   MakeDoubleChecker<double> (0.0))
+    ;
+  return tid;
+}
+
+Ptr<ChannelCondition>
+NrBuildingsChannelConditionModel::GetChannelCondition (Ptr<const MobilityModel> a,
+                                                       Ptr<const MobilityModel> b) const
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<const NrBuildingIndex> index = NrBuildingIndex::GetIndex (m_cellSize);
+  Vector aPosition = a->GetPosition ();
+  Vector bPosition = b->GetPosition ();
+  Ptr<Building> aBuilding = index->GetBuilding (aPosition);
+  Ptr<Building> bBuilding = index->GetBuilding (bPosition);
+
+  Ptr<ChannelCondition> cond = CreateObject<ChannelCondition> ();
+  if (aBuilding == nullptr && bBuilding == nullptr)
+    {
+      cond->SetO2iCondition (ChannelCondition::O2iConditionValue::O2O);
+      bool blocked = index->IsLineOfSightBlocked (aPosition, bPosition);
+      cond->SetLosCondition (blocked ? ChannelCondition::LosConditionValue::NLOS
+                                     : ChannelCondition::LosConditionValue::LOS);
+    }
+  else if (aBuilding != nullptr && bBuilding != nullptr)
+    {
+      cond->SetO2iCondition (ChannelCondition::O2iConditionValue::I2I);
+      cond->SetLosCondition (aBuilding == bBuilding ? ChannelCondition::LosConditionValue::LOS
+                                                    : ChannelCondition::LosConditionValue::NLOS);
+    }
+  else
+    {
+      cond->SetO2iCondition (ChannelCondition::O2iConditionValue::O2I);
+      cond->SetLosCondition (ChannelCondition::LosConditionValue::NLOS);
+    }
+  return cond;
+}
+
+int64_t
+NrBuildingsChannelConditionModel::AssignStreams ([[maybe_unused]] int64_t stream)
+{
+  return 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,161 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_BUILDING_INDEX_H
+#define NR_BUILDING_INDEX_H
+
+#include <ns3/simple-ref-count.h>
+#include <ns3/channel-condition-model.h>
+#include <ns3/building.h>
+#include <ns3/box.h>
+#include <ns3/vector.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup nr-utils
+ * \brief A grid over the buildings of the BuildingList, to find the building
+ * of a position and the buildings that block a line of sight without going
+ * through the whole list
+ *
+ * Each cell of the grid (of CellSize meters) keeps the buildings whose
+ * boundaries overlap it, in the order of the BuildingList. GetBuilding only
+ * checks the buildings of the cell of the position, and
+ * IsLineOfSightBlocked the ones of the cells crossed by the segment, so that
+ * both cost about the same with thousands of buildings as with a few. Their
+ * results are the ones of MobilityBuildingInfo::MakeConsistent and
+ * BuildingsChannelConditionModel, which check all the buildings.
+ *
+ * The buildings must not change after the index is built. GetIndex shares
+ * one index between all its users, and builds it again when buildings are
+ * added, or after Simulator::Destroy.
+ */
+class NrBuildingIndex : public SimpleRefCount<NrBuildingIndex>
+{
+public:
+  /**
+   * \brief Index the buildings of the BuildingList
+   * \param cellSize the size of a cell of the grid (m); it is increased if
+   * the grid would have more than 4M cells
+   */
+  NrBuildingIndex (double cellSize);
+
+  /**
+   * \brief Get the shared index of the current buildings
+   * \param cellSize the size of a cell of the grid (m)
+   * \return the index
+   */
+  static Ptr<const NrBuildingIndex> GetIndex (double cellSize);
+
+  /**
+   * \return the number of buildings of the index
+   */
+  uint32_t GetNumBuildings () const;
+
+  /**
+   * \param position a position
+   * \return the first building of the BuildingList that contains the
+   * position, or nullptr if it is outdoor
+   */
+  Ptr<Building> GetBuilding (const Vector &position) const;
+
+  /**
+   * \param l1 an end of the segment
+   * \param l2 the other end of the segment
+   * \return true if a building intersects the segment
+   */
+  bool IsLineOfSightBlocked (const Vector &l1, const Vector &l2) const;
+
+private:
+  /**
+   * \brief Forget the shared index, at Simulator::Destroy
+   */
+  static void ResetIndex ();
+
+  /**
+   * \param x the X coordinate, in cells from the origin of the grid
+   * \return the column of the cell, clamped to the grid
+   */
+  uint32_t GetColumn (double x) const;
+
+  /**
+   * \param y the Y coordinate, in cells from the origin of the grid
+   * \return the row of the cell, clamped to the grid
+   */
+  uint32_t GetRow (double y) const;
+
+  std::vector<Ptr<Building>> m_buildings;   //!< The buildings, in the order of the BuildingList
+  std::vector<Box> m_boxes;                 //!< The boundaries of each building
+  double m_cellSize {0.0};                  //!< The size of a cell (m)
+  double m_xMin {0.0};                      //!< The minimum X of the grid
+  double m_xMax {0.0};                      //!< The maximum X of the grid
+  double m_yMin {0.0};                      //!< The minimum Y of the grid
+  double m_yMax {0.0};                      //!< The maximum Y of the grid
+  uint32_t m_numColumns {0};                //!< The number of cells along X
+  uint32_t m_numRows {0};                   //!< The number of cells along Y
+  std::vector<std::vector<uint32_t>> m_cells; //!< The buildings of each cell, at row * columns + column
+};
+
+/**
+ * \ingroup nr-utils
+ * \brief The channel condition of BuildingsChannelConditionModel, computed
+ * with a NrBuildingIndex
+ *
+ * The nodes are indoor when their position is in a building, as after
+ * MobilityBuildingInfo::MakeConsistent; they do not need a
+ * MobilityBuildingInfo. Two outdoor nodes are in LOS when no building
+ * intersects the segment between them, two indoor nodes when they are in
+ * the same building, and an outdoor and an indoor node are in NLOS (O2I).
+ *
+ * NrHelper uses it for the UMa_Buildings and UMi_Buildings scenarios.
+ */
+class NrBuildingsChannelConditionModel : public ChannelConditionModel
+{
+public:
+  NrBuildingsChannelConditionModel ();
+  ~NrBuildingsChannelConditionModel () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Computes the condition of the channel between a and b
+   * \param a mobility model
+   * \param b mobility model
+   * \return the condition of the channel between a and b
+   */
+  Ptr<ChannelCondition> GetChannelCondition (Ptr<const MobilityModel> a, Ptr<const MobilityModel> b) const override;
+
+  /**
+   * \brief The model does not use random variables
+   * \param stream the first stream
+   * \return 0
+   */
+  int64_t AssignStreams (int64_t stream) override;
+
+private:
+  double m_cellSize {20.0};                 //!< The cell size of the index (attribute)
+};
+
+} // namespace ns3
+
+#endif // NR_BUILDING_INDEX_H
@@ -0,0 +1,443 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-channel-recording.h"
+#include <ns3/log.h>
+#include <ns3/assert.h>
+#include <cstring>
+
+#if defined (__unix__) || defined (__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NR_CHANNEL_RECORDING_HAVE_MMAP 1
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrChannelRecording");
+
+static const char CHANNEL_RECORDING_MAGIC[4] = {'N', 'R', 'C', 'H'};
+static const uint16_t CHANNEL_RECORDING_VERSION = 1;
+static const uint32_t CHANNEL_RECORDING_BOM = 0x01020304;
+static const uint32_t CHANNEL_RECORDING_ANGLES = 4;
+
+/**
+ * \brief Header of a channel recording file
+ */
+struct NrChannelRecordingHeader
+{
+  char m_magic[4];       //!< "NRCH"
+  uint16_t m_version;    //!< Format version
+  uint16_t m_reserved1;  //!< Reserved, 0
+  uint32_t m_bom;        //!< Byte-order mark
+  uint32_t m_reserved2;  //!< Reserved, 0
+  double m_frequency;    //!< Frequency of the channel model (Hz)
+  uint64_t m_reserved3;  //!< Reserved, 0
+};
+
+/**
+ * \brief Header of a record, followed by its doubles: the delays, the
+ * angles (AOA, ZOA, AOD, ZOD) and the coefficients H[u][s][n]
+ */
+struct NrChannelRecordHeader
+{
+  int64_t m_generatedTime;       //!< Generation time of the matrix, in time steps
+  int64_t m_paramsGeneratedTime; //!< Generation time of the parameters, in time steps
+  uint32_t m_sAntennaId;         //!< Antenna of the s node
+  uint32_t m_uAntennaId;         //!< Antenna of the u node
+  uint32_t m_sNodeId;            //!< The s node of the matrix
+  uint32_t m_uNodeId;            //!< The u node of the matrix
+  uint32_t m_paramsSNodeId;      //!< The first node of the parameters
+  uint32_t m_paramsUNodeId;      //!< The second node of the parameters
+  uint32_t m_uSize;              //!< Number of elements of the u antenna
+  uint32_t m_sSize;              //!< Number of elements of the s antenna
+  uint32_t m_numClusters;        //!< Number of clusters of the matrix
+  uint32_t m_numDelays;          //!< Number of cluster delays
+  uint32_t m_numAngles[CHANNEL_RECORDING_ANGLES]; //!< Number of cluster angles, for each angle
+};
+
+static_assert (sizeof (NrChannelRecordingHeader) == 32, "Unexpected padding in NrChannelRecordingHeader");
+static_assert (sizeof (NrChannelRecordHeader) == 72, "Unexpected padding in NrChannelRecordHeader");
+
+/**
+ * \param header the header of a record
+ * \return the number of doubles of the record
+ */
+static uint64_t
+GetNumDoubles (const NrChannelRecordHeader &header)
+{
+  uint64_t n = header.m_numDelays;
+  for (uint32_t i = 0; i < CHANNEL_RECORDING_ANGLES; ++i)
+    {
+      n += header.m_numAngles[i];
+    }
+  return n + 2 * static_cast<uint64_t> (header.m_uSize) * header.m_sSize * header.m_numClusters;
+}
+
+NrChannelRecorder::~NrChannelRecorder ()
+{
+  Close ();
+}
+
+bool
+NrChannelRecorder::Open (const std::string &fileName, double frequency)
+{
+  NS_LOG_FUNCTION (this << fileName << frequency);
+  Close ();
+
+  m_out.open (fileName.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!m_out.is_open ())
+    {
+      NS_LOG_ERROR ("Could not open " << fileName);
+      return false;
+    }
+
+  NrChannelRecordingHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.m_magic, CHANNEL_RECORDING_MAGIC, sizeof (header.m_magic));
+  header.m_version = CHANNEL_RECORDING_VERSION;
+  header.m_bom = CHANNEL_RECORDING_BOM;
+  header.m_frequency = frequency;
+  m_out.write (reinterpret_cast<const char*> (&header), sizeof (header));
+  m_out.flush ();
+  if (!m_out)
+    {
+      NS_LOG_ERROR ("Could not write " << fileName);
+      Close ();
+      return false;
+    }
+  m_numRecords = 0;
+  return true;
+}
+
+void
+NrChannelRecorder::Close ()
+{
+  if (m_out.is_open ())
+    {
+      m_out.close ();
+    }
+  m_data.clear ();
+}
+
+bool
+NrChannelRecorder::IsOpen () const
+{
+  return m_out.is_open ();
+}
+
+bool
+NrChannelRecorder::Write (Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix,
+                          Ptr<const MatrixBasedChannelModel::ChannelParams> channelParams)
+{
+  NS_ASSERT (IsOpen ());
+  NS_ASSERT_MSG (channelParams->m_angle.size () == CHANNEL_RECORDING_ANGLES, "Unexpected number of angles");
+
+  const MatrixBasedChannelModel::Complex3DVector &h = channelMatrix->m_channel;
+  NrChannelRecordHeader header;
+  std::memset (&header, 0, sizeof (header));
+  header.m_generatedTime = channelMatrix->m_generatedTime.GetTimeStep ();
+  header.m_paramsGeneratedTime = channelParams->m_generatedTime.GetTimeStep ();
+  header.m_sAntennaId = channelMatrix->m_antennaPair.first;
+  header.m_uAntennaId = channelMatrix->m_antennaPair.second;
+  header.m_sNodeId = channelMatrix->m_nodeIds.first;
+  header.m_uNodeId = channelMatrix->m_nodeIds.second;
+  header.m_paramsSNodeId = channelParams->m_nodeIds.first;
+  header.m_paramsUNodeId = channelParams->m_nodeIds.second;
+  header.m_uSize = static_cast<uint32_t> (h.size ());
+  header.m_sSize = static_cast<uint32_t> (h.at (0).size ());
+  header.m_numClusters = static_cast<uint32_t> (h.at (0).at (0).size ());
+  header.m_numDelays = static_cast<uint32_t> (channelParams->m_delay.size ());
+
+  m_data.assign (channelParams->m_delay.begin (), channelParams->m_delay.end ());
+  for (uint32_t i = 0; i < CHANNEL_RECORDING_ANGLES; ++i)
+    {
+      header.m_numAngles[i] = static_cast<uint32_t> (channelParams->m_angle[i].size ());
+      m_data.insert (m_data.end (), channelParams->m_angle[i].begin (), channelParams->m_angle[i].end ());
+    }
+  for (const auto &uRow : h)
+    {
+      for (const auto &sRow : uRow)
+        {
+          NS_ASSERT (sRow.size () == header.m_numClusters);
+          for (const std::complex<double> &coefficient : sRow)
+            {
+              m_data.push_back (coefficient.real ());
+              m_data.push_back (coefficient.imag ());
+            }
+        }
+    }
+  NS_ASSERT (m_data.size () == GetNumDoubles (header));
+
+  m_out.write (reinterpret_cast<const char*> (&header), sizeof (header));
+  m_out.write (reinterpret_cast<const char*> (m_data.data ()), m_data.size () * sizeof (double));
+  m_out.flush ();
+  if (!m_out)
+    {
+      NS_LOG_ERROR ("Could not write a channel record");
+      return false;
+    }
+  ++m_numRecords;
+  return true;
+}
+
+uint32_t
+NrChannelRecorder::GetNumRecords () const
+{
+  return m_numRecords;
+}
+
+NrChannelRecording::~NrChannelRecording ()
+{
+  Close ();
+}
+
+bool
+NrChannelRecording::Open (const std::string &fileName)
+{
+  NS_LOG_FUNCTION (this << fileName);
+  Close ();
+
+#ifdef NR_CHANNEL_RECORDING_HAVE_MMAP
+  int fd = open (fileName.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      NS_LOG_ERROR ("Could not open " << fileName);
+      return false;
+    }
+  struct stat st;
+  if (fstat (fd, &st) != 0 || st.st_size < static_cast<off_t> (sizeof (NrChannelRecordingHeader)))
+    {
+      close (fd);
+      NS_LOG_ERROR (fileName << " is not a channel recording");
+      return false;
+    }
+  void *data = mmap (nullptr, static_cast<size_t> (st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    {
+      NS_LOG_ERROR ("Could not map " << fileName);
+      return false;
+    }
+  m_data = static_cast<const char*> (data);
+  m_size = static_cast<size_t> (st.st_size);
+  m_mapped = true;
+#else
+  std::ifstream in (fileName.c_str (), std::ios::in | std::ios::binary | std::ios::ate);
+  if (!in.is_open ())
+    {
+      NS_LOG_ERROR ("Could not open " << fileName);
+      return false;
+    }
+  m_size = static_cast<size_t> (in.tellg ());
+  // uint64_t storage keeps the doubles aligned, as in a mapped file
+  m_buffer.resize ((m_size + sizeof (uint64_t) - 1) / sizeof (uint64_t));
+  in.seekg (0);
+  in.read (reinterpret_cast<char*> (m_buffer.data ()), m_size);
+  m_data = reinterpret_cast<const char*> (m_buffer.data ());
+#endif
+
+  if (!Parse (fileName))
+    {
+      Close ();
+      return false;
+    }
+  return true;
+}
+
+bool
+NrChannelRecording::Parse (const std::string &fileName)
+{
+  if (m_size < sizeof (NrChannelRecordingHeader))
+    {
+      NS_LOG_ERROR (fileName << " is not a channel recording");
+      return false;
+    }
+
+  NrChannelRecordingHeader header;
+  std::memcpy (&header, m_data, sizeof (header));
+  if (std::memcmp (header.m_magic, CHANNEL_RECORDING_MAGIC, sizeof (header.m_magic)) != 0)
+    {
+      NS_LOG_ERROR (fileName << " is not a channel recording");
+      return false;
+    }
+  if (header.m_version != CHANNEL_RECORDING_VERSION)
+    {
+      NS_LOG_ERROR ("Unsupported channel recording version " << header.m_version);
+      return false;
+    }
+  if (header.m_bom != CHANNEL_RECORDING_BOM)
+    {
+      NS_LOG_ERROR (fileName << " was written on a host with a different byte order");
+      return false;
+    }
+  m_frequency = header.m_frequency;
+
+  // The records are read one after the other, as they have no index
+  uint64_t offset = sizeof (header);
+  while (offset < m_size)
+    {
+      if (m_size - offset < sizeof (NrChannelRecordHeader))
+        {
+          NS_LOG_ERROR (fileName << " has a truncated record at the end");
+          return false;
+        }
+      NrChannelRecordHeader record;
+      std::memcpy (&record, m_data + offset, sizeof (record));
+      uint64_t numDoubles = GetNumDoubles (record);
+      if (numDoubles > (m_size - offset - sizeof (record)) / sizeof (double))
+        {
+          NS_LOG_ERROR (fileName << " has a truncated record at the end");
+          return false;
+        }
+      m_records.push_back (offset);
+      offset += sizeof (record) + numDoubles * sizeof (double);
+    }
+  NS_LOG_INFO ("Opened " << m_records.size () << " channel records from " << fileName);
+  return true;
+}
+
+void
+NrChannelRecording::Close ()
+{
+#ifdef NR_CHANNEL_RECORDING_HAVE_MMAP
+  if (m_mapped)
+    {
+      munmap (const_cast<char*> (m_data), m_size);
+    }
+#endif
+  m_data = nullptr;
+  m_size = 0;
+  m_mapped = false;
+  m_buffer.clear ();
+  m_frequency = 0.0;
+  m_records.clear ();
+}
+
+bool
+NrChannelRecording::IsOpen () const
+{
+  return m_data != nullptr;
+}
+
+double
+NrChannelRecording::GetFrequency () const
+{
+  return m_frequency;
+}
+
+uint32_t
+NrChannelRecording::GetNumRecords () const
+{
+  return static_cast<uint32_t> (m_records.size ());
+}
+
+/**
+ * \param data the data of the file
+ * \param offset the offset of a record
+ * \return the header of the record
+ */
+static NrChannelRecordHeader
+GetRecordHeader (const char *data, uint64_t offset)
+{
+  NrChannelRecordHeader header;
+  std::memcpy (&header, data + offset, sizeof (header));
+  return header;
+}
+
+Time
+NrChannelRecording::GetGeneratedTime (uint32_t record) const
+{
+  NS_ASSERT_MSG (record < m_records.size (), "Record " << record << " out of range");
+  return TimeStep (GetRecordHeader (m_data, m_records[record]).m_generatedTime);
+}
+
+std::pair<uint32_t, uint32_t>
+NrChannelRecording::GetAntennaPair (uint32_t record) const
+{
+  NS_ASSERT_MSG (record < m_records.size (), "Record " << record << " out of range");
+  NrChannelRecordHeader header = GetRecordHeader (m_data, m_records[record]);
+  return std::make_pair (header.m_sAntennaId, header.m_uAntennaId);
+}
+
+std::pair<uint32_t, uint32_t>
+NrChannelRecording::GetParamsNodeIds (uint32_t record) const
+{
+  NS_ASSERT_MSG (record < m_records.size (), "Record " << record << " out of range");
+  NrChannelRecordHeader header = GetRecordHeader (m_data, m_records[record]);
+  return std::make_pair (header.m_paramsSNodeId, header.m_paramsUNodeId);
+}
+
+Ptr<MatrixBasedChannelModel::ChannelMatrix>
+NrChannelRecording::GetChannelMatrix (uint32_t record) const
+{
+  NS_ASSERT_MSG (record < m_records.size (), "Record " << record << " out of range");
+  NrChannelRecordHeader header = GetRecordHeader (m_data, m_records[record]);
+  const double *values = reinterpret_cast<const double*> (m_data + m_records[record] + sizeof (header));
+  values += header.m_numDelays;
+  for (uint32_t i = 0; i < CHANNEL_RECORDING_ANGLES; ++i)
+    {
+      values += header.m_numAngles[i];
+    }
+
+  Ptr<MatrixBasedChannelModel::ChannelMatrix> channelMatrix = Create<MatrixBasedChannelModel::ChannelMatrix> ();
+  channelMatrix->m_generatedTime = TimeStep (header.m_generatedTime);
+  channelMatrix->m_antennaPair = std::make_pair (header.m_sAntennaId, header.m_uAntennaId);
+  channelMatrix->m_nodeIds = std::make_pair (header.m_sNodeId, header.m_uNodeId);
+  MatrixBasedChannelModel::Complex3DVector &h = channelMatrix->m_channel;
+  h.resize (header.m_uSize);
+  for (auto &uRow : h)
+    {
+      uRow.resize (header.m_sSize);
+      for (auto &sRow : uRow)
+        {
+          sRow.resize (header.m_numClusters);
+          for (std::complex<double> &coefficient : sRow)
+            {
+              coefficient = std::complex<double> (values[0], values[1]);
+              values += 2;
+            }
+        }
+    }
+  return channelMatrix;
+}
+
+Ptr<MatrixBasedChannelModel::ChannelParams>
+NrChannelRecording::GetChannelParams (uint32_t record) const
+{
+  NS_ASSERT_MSG (record < m_records.size (), "Record " << record << " out of range");
+  NrChannelRecordHeader header = GetRecordHeader (m_data, m_records[record]);
+  const double *values = reinterpret_cast<const double*> (m_data + m_records[record] + sizeof (header));
+
+  Ptr<MatrixBasedChannelModel::ChannelParams> channelParams = Create<MatrixBasedChannelModel::ChannelParams> ();
+  channelParams->m_generatedTime = TimeStep (header.m_paramsGeneratedTime);
+  channelParams->m_nodeIds = std::make_pair (header.m_paramsSNodeId, header.m_paramsUNodeId);
+  channelParams->m_delay.assign (values, values + header.m_numDelays);
+  values += header.m_numDelays;
+  channelParams->m_angle.resize (CHANNEL_RECORDING_ANGLES);
+  for (uint32_t i = 0; i < CHANNEL_RECORDING_ANGLES; ++i)
+    {
+      channelParams->m_angle[i].assign (values, values + header.m_numAngles[i]);
+      values += header.m_numAngles[i];
+    }
+  return channelParams;
+}
+
+} // namespace ns3
@@ -0,0 +1,201 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_CHANNEL_RECORDING_H
+#define NR_CHANNEL_RECORDING_H
+
+#include <ns3/simple-ref-count.h>
+#include <ns3/nstime.h>
+#include <ns3/matrix-based-channel-model.h>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup nr-utils
+ * \brief Writes the channel realizations of a simulation to a binary file
+ *
+ * The file is made of a 32 bytes header (the magic string "NRCH", the
+ * format version (uint16_t), 2 reserved bytes, the byte-order mark
+ * 0x01020304 (uint32_t), 4 reserved bytes, the frequency of the channel
+ * model (double) and 8 reserved bytes), followed by one record per channel
+ * matrix, in the order in which they were written. A record is a 72 bytes
+ * header (see NrChannelRecording), the delays and the angles of the
+ * clusters of the channel parameters, and the coefficients H[u][s][n] of
+ * the matrix, as pairs of doubles. All the fields are 8 bytes aligned.
+ *
+ * The file has no trailer, and each record is flushed when it is written,
+ * so that a file is complete even if the recorder is never closed.
+ *
+ * ThreeGppChannelModelParam writes its channels with it when its attribute
+ * RecordFileName is set, and NrReplayChannelModel reads them back.
+ */
+class NrChannelRecorder
+{
+public:
+  NrChannelRecorder () = default;
+
+  /**
+   * \brief Destructor; closes the file
+   */
+  ~NrChannelRecorder ();
+
+  NrChannelRecorder (const NrChannelRecorder &) = delete;
+  NrChannelRecorder & operator= (const NrChannelRecorder &) = delete;
+
+  /**
+   * \brief Create a file, and write its header
+   * \param fileName the name of the file
+   * \param frequency the frequency of the channel model (Hz)
+   * \return false if the file could not be written
+   */
+  bool Open (const std::string &fileName, double frequency);
+
+  /**
+   * \brief Close the file
+   */
+  void Close ();
+
+  /**
+   * \return true if a file is open
+   */
+  bool IsOpen () const;
+
+  /**
+   * \brief Write a channel realization
+   * \param channelMatrix the channel matrix
+   * \param channelParams the parameters of the channel
+   * \return false if the record could not be written
+   */
+  bool Write (Ptr<const MatrixBasedChannelModel::ChannelMatrix> channelMatrix,
+              Ptr<const MatrixBasedChannelModel::ChannelParams> channelParams);
+
+  /**
+   * \return the number of records written
+   */
+  uint32_t GetNumRecords () const;
+
+private:
+  std::ofstream m_out;         //!< The file
+  std::vector<double> m_data;  //!< The doubles of the current record
+  uint32_t m_numRecords {0};   //!< The number of records written
+};
+
+/**
+ * \ingroup nr-utils
+ * \brief Read-only access to the channel realizations written by
+ * NrChannelRecorder
+ *
+ * Open maps the file in memory (where mmap is available, otherwise it reads
+ * it) and indexes its records; the matrices and parameters are only built
+ * when they are requested, so that the processes that replay the same file
+ * share its pages.
+ */
+class NrChannelRecording : public SimpleRefCount<NrChannelRecording>
+{
+public:
+  NrChannelRecording () = default;
+
+  /**
+   * \brief Destructor; unmaps the file
+   */
+  ~NrChannelRecording ();
+
+  NrChannelRecording (const NrChannelRecording &) = delete;
+  NrChannelRecording & operator= (const NrChannelRecording &) = delete;
+
+  /**
+   * \brief Open a file written by NrChannelRecorder
+   * \param fileName the name of the file
+   * \return false if the file could not be opened or is malformed
+   */
+  bool Open (const std::string &fileName);
+
+  /**
+   * \brief Close the file
+   */
+  void Close ();
+
+  /**
+   * \return true if a file is open
+   */
+  bool IsOpen () const;
+
+  /**
+   * \return the frequency of the recorded channel model (Hz)
+   */
+  double GetFrequency () const;
+
+  /**
+   * \return the number of records
+   */
+  uint32_t GetNumRecords () const;
+
+  /**
+   * \param record a record
+   * \return the time at which the channel matrix was generated
+   */
+  Time GetGeneratedTime (uint32_t record) const;
+
+  /**
+   * \param record a record
+   * \return the ids of the antennas of the s and u nodes of the matrix
+   */
+  std::pair<uint32_t, uint32_t> GetAntennaPair (uint32_t record) const;
+
+  /**
+   * \param record a record
+   * \return the ids of the nodes of the channel parameters
+   */
+  std::pair<uint32_t, uint32_t> GetParamsNodeIds (uint32_t record) const;
+
+  /**
+   * \param record a record
+   * \return a copy of the channel matrix
+   */
+  Ptr<MatrixBasedChannelModel::ChannelMatrix> GetChannelMatrix (uint32_t record) const;
+
+  /**
+   * \param record a record
+   * \return a copy of the delays and angles of the channel parameters
+   */
+  Ptr<MatrixBasedChannelModel::ChannelParams> GetChannelParams (uint32_t record) const;
+
+private:
+  /**
+   * \brief Check the header, and index the records
+   * \param fileName the name of the file, for the log
+   * \return true if the data is valid
+   */
+  bool Parse (const std::string &fileName);
+
+  const char *m_data {nullptr};          //!< File data
+  size_t m_size {0};                     //!< Size of the file data
+  bool m_mapped {false};                 //!< True if m_data is mapped
+  std::vector<uint64_t> m_buffer;        //!< File data, when it is not mapped
+  double m_frequency {0.0};              //!< The frequency of the recording
+  std::vector<uint64_t> m_records;       //!< The offset of each record
+};
+
+} // namespace ns3
+
+#endif // NR_CHANNEL_RECORDING_H
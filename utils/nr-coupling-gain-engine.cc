@@ -0,0 +1,556 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-coupling-gain-engine.h"
+#include "cached-three-gpp-spectrum-propagation-loss-model.h"
+#include "nr-wrap-around-model.h"
+#include "nr-receiver-pruning-loss-model.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+#include "ns3/uniform-planar-array.h"
+#include "ns3/nr-gnb-net-device.h"
+#include "ns3/nr-ue-net-device.h"
+#include "ns3/nr-gnb-phy.h"
+#include "ns3/nr-ue-phy.h"
+#include "ns3/nr-spectrum-phy.h"
+#include "ns3/nr-load-model-net-device.h"
+#include "ns3/nr-load-model-phy.h"
+#include "ns3/beamforming-vector.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrCouplingGainEngine");
+NS_OBJECT_ENSURE_REGISTERED (NrCouplingGainEngine);
+
+NrCouplingGainEngine::NrCouplingGainEngine ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrCouplingGainEngine::~NrCouplingGainEngine ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrCouplingGainEngine::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_updateEvent.Cancel ();
+  m_gnbs.clear ();
+  m_ues.clear ();
+  m_links.clear ();
+  m_linkIndex.clear ();
+  m_channelModel = nullptr;
+  m_wrapAround = nullptr;
+  m_spectrumModel = nullptr;
+  if (m_pruning != nullptr)
+    {
+      // The channel may keep the model in its chain
+      m_pruning->SetNodes ({}, {});
+      m_pruning->SetIntendedReceiverCallback (MakeNullCallback<bool, uint32_t, uint32_t> ());
+      m_pruning = nullptr;
+    }
+  Object::DoDispose ();
+}
+
+TypeId
+NrCouplingGainEngine::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrCouplingGainEngine")
+    .SetParent<Object> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrCouplingGainEngine> ()
+    .AddAttribute ("BeamSearchAngleStep",
+                   "Angle step of the codebook of the NrGnbNetDevice, as in CellScanBeamforming",
+                   DoubleValue (30),
+                   MakeDoubleAccessor (&NrCouplingGainEngine::m_beamSearchAngleStep),
+                   MakeDoubleChecker<double> (1.0))
+    .AddAttribute ("NumWorkers",
+                   "Number of threads that compute the table, the simulation thread included",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&NrCouplingGainEngine::m_numWorkers),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("StoreSubbands",
+                   "Keep the gain of each band, used by the spectrum model; otherwise only the "
+                   "wideband gains are kept",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&NrCouplingGainEngine::m_storeSubbands),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ReceiverPruning",
+                   "Add to the channel, at Install, a NrReceiverPruningLossModel with which the "
+                   "signals between a gNB and a UE that are not candidate receivers of each "
+                   "other, nor attached, are not delivered",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NrCouplingGainEngine::m_receiverPruning),
+                   MakeBooleanChecker ())
+    .AddAttribute ("PruningMarginDb",
+                   "Margin (dB) under the noise floor of a receiver above which the power "
+                   "received with the best coupling gain makes it a candidate, at each Update",
+                   DoubleValue (10.0),
+                   MakeDoubleAccessor (&NrCouplingGainEngine::m_pruningMarginDb),
+                   MakeDoubleChecker<double> ())
+    ;
+  return tid;
+}
+
+void
+NrCouplingGainEngine::Install (const NetDeviceContainer &gnbs, const NetDeviceContainer &ues, uint8_t bwpIndex)
+{
+  NS_LOG_FUNCTION (this << gnbs.GetN () << ues.GetN () << +bwpIndex);
+  NS_ABORT_MSG_IF (gnbs.GetN () == 0 || ues.GetN () == 0, "The engine needs gNBs and UEs");
+
+  Ptr<SpectrumChannel> channel;
+  m_gnbs.clear ();
+  for (auto it = gnbs.Begin (); it != gnbs.End (); ++it)
+    {
+      Gnb gnb;
+      gnb.m_device = *it;
+      Ptr<const UniformPlanarArray> antenna;
+      if (Ptr<NrGnbNetDevice> device = DynamicCast<NrGnbNetDevice> (*it))
+        {
+          Ptr<NrSpectrumPhy> phy = device->GetPhy (bwpIndex)->GetSpectrumPhy ();
+          gnb.m_phy = device->GetPhy (bwpIndex);
+          gnb.m_mobility = phy->GetMobility ();
+          antenna = phy->GetAntenna ()->GetObject<UniformPlanarArray> ();
+          channel = phy->GetSpectrumChannel ();
+          NS_ASSERT (m_spectrumModel == nullptr || m_spectrumModel->GetUid () == phy->GetRxSpectrumModel ()->GetUid ());
+          m_spectrumModel = phy->GetRxSpectrumModel ();
+
+          // Same beams, in the same order, as the gNB sweep of CellScanBeamforming
+          UintegerValue numRows;
+          antenna->GetAttribute ("NumRows", numRows);
+          for (double theta = 60; theta < 121; theta += m_beamSearchAngleStep)
+            {
+              for (uint16_t sector = 0; sector <= numRows.Get (); sector++)
+                {
+                  gnb.m_codebook.push_back (CreateDirectionalBfv (antenna, sector, theta));
+                }
+            }
+        }
+      else if (Ptr<NrLoadModelNetDevice> device = DynamicCast<NrLoadModelNetDevice> (*it))
+        {
+          Ptr<NrLoadModelPhy> phy = device->GetPhy (bwpIndex);
+          gnb.m_mobility = phy->GetMobility ();
+          antenna = phy->GetAntenna ()->GetObject<UniformPlanarArray> ();
+          channel = phy->GetSpectrumChannel ();
+          NS_ASSERT (m_spectrumModel == nullptr || m_spectrumModel->GetUid () == phy->GetRxSpectrumModel ()->GetUid ());
+          m_spectrumModel = phy->GetRxSpectrumModel ();
+          gnb.m_isServing = false;
+          gnb.m_codebook = phy->GetCodebook ();
+          DoubleValue txPower;
+          phy->GetAttribute ("TxPower", txPower);
+          gnb.m_txPowerDbm = txPower.Get ();
+        }
+      else
+        {
+          NS_ABORT_MSG ("Device " << (*it)->GetIfIndex () << " is not a NrGnbNetDevice nor a NrLoadModelNetDevice");
+        }
+
+      NS_ABORT_MSG_IF (antenna == nullptr, "The gNB antenna must be a UniformPlanarArray");
+      gnb.m_antenna = antenna;
+      gnb.m_pathloss = channel->GetPropagationLossModel ();
+      for (uint32_t beam = 0; beam < gnb.m_codebook.size (); ++beam)
+        {
+          gnb.m_beams.emplace (CachedThreeGppSpectrumPropagationLossModel::HashBeamformingVector (gnb.m_codebook[beam]), beam);
+        }
+      m_gnbs.push_back (std::move (gnb));
+    }
+
+  m_ues.clear ();
+  for (auto it = ues.Begin (); it != ues.End (); ++it)
+    {
+      Ptr<NrUeNetDevice> device = DynamicCast<NrUeNetDevice> (*it);
+      NS_ABORT_MSG_IF (device == nullptr, "Device " << (*it)->GetIfIndex () << " is not a NrUeNetDevice");
+      Ptr<NrSpectrumPhy> phy = device->GetPhy (bwpIndex)->GetSpectrumPhy ();
+      Ue ue;
+      ue.m_device = device;
+      ue.m_mobility = phy->GetMobility ();
+      ue.m_antenna = phy->GetAntenna ()->GetObject<PhasedArrayModel> ();
+      ue.m_phy = device->GetPhy (bwpIndex);
+      m_ues.push_back (ue);
+    }
+
+  Ptr<CachedThreeGppSpectrumPropagationLossModel> cached =
+    DynamicCast<CachedThreeGppSpectrumPropagationLossModel> (channel->GetPhasedArraySpectrumPropagationLossModel ());
+  NS_ABORT_MSG_IF (cached == nullptr, "The engine needs a CachedThreeGppSpectrumPropagationLossModel");
+  m_channelModel = cached->GetChannelModel ();
+  m_wrapAround = cached->GetWrapAroundModel ();
+  cached->SetCouplingGainEngine (Ptr<const NrCouplingGainEngine> (this));
+
+  m_links.assign (m_gnbs.size () * m_ues.size (), Link ());
+  m_linkIndex.clear ();
+  for (uint32_t g = 0; g < m_gnbs.size (); ++g)
+    {
+      for (uint32_t u = 0; u < m_ues.size (); ++u)
+        {
+          size_t index = g * m_ues.size () + u;
+          m_links[index].m_gnb = g;
+          m_linkIndex[MatrixBasedChannelModel::GetKey (m_gnbs[g].m_antenna->GetId (), m_ues[u].m_antenna->GetId ())] = index;
+        }
+    }
+
+  if (m_receiverPruning)
+    {
+      std::vector<Ptr<MobilityModel>> gnbMobility;
+      std::vector<Ptr<MobilityModel>> ueMobility;
+      for (const auto &gnb : m_gnbs)
+        {
+          gnbMobility.push_back (gnb.m_mobility);
+        }
+      for (const auto &ue : m_ues)
+        {
+          ueMobility.push_back (ue.m_mobility);
+        }
+      if (m_pruning == nullptr)
+        {
+          m_pruning = CreateObject<NrReceiverPruningLossModel> ();
+          m_pruning->AddToChannel (channel);
+          m_pruning->SetIntendedReceiverCallback (MakeCallback (&NrCouplingGainEngine::IsAttached, this));
+        }
+      // No receiver is pruned until the first Update
+      m_pruning->SetNodes (gnbMobility, ueMobility);
+    }
+}
+
+void
+NrCouplingGainEngine::Update ()
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_channelModel == nullptr, "Install must be called before Update");
+
+  // The channels, path losses and UE beams are read by the simulation
+  // thread, as the channel model and the objects are not thread-safe. The
+  // path losses are the ones of all the pairs, not pruned.
+  if (m_pruning != nullptr)
+    {
+      m_pruning->SetBypass (true);
+    }
+  for (uint32_t u = 0; u < m_ues.size (); ++u)
+    {
+      const Ue &ue = m_ues[u];
+      PhasedArrayModel::ComplexVector ueW = ue.m_antenna->GetBeamformingVector ();
+      if (ueW.empty ())
+        {
+          UintegerValue numRows;
+          UintegerValue numColumns;
+          ue.m_antenna->GetAttribute ("NumRows", numRows);
+          ue.m_antenna->GetAttribute ("NumColumns", numColumns);
+          ueW = CreateQuasiOmniBfv (numRows.Get (), numColumns.Get ());
+        }
+
+      for (uint32_t g = 0; g < m_gnbs.size (); ++g)
+        {
+          const Gnb &gnb = m_gnbs[g];
+          Link &link = m_links[g * m_ues.size () + u];
+          Ptr<const MobilityModel> a = gnb.m_mobility;
+          Ptr<const MobilityModel> b = ue.m_mobility;
+          if (m_wrapAround != nullptr)
+            {
+              m_wrapAround->Wrap (&a, &b);
+            }
+          link.m_channel = m_channelModel->GetChannel (a, b, gnb.m_antenna, ue.m_antenna);
+          link.m_params = m_channelModel->GetParams (a, b);
+          link.m_gnbIsS = !link.m_channel->IsReverse (gnb.m_antenna->GetId (), ue.m_antenna->GetId ());
+          link.m_ueW = ueW;
+          link.m_pathlossDb = gnb.m_pathloss != nullptr ? gnb.m_pathloss->CalcRxPower (0.0, gnb.m_mobility, ue.m_mobility) : 0.0;
+        }
+    }
+  if (m_pruning != nullptr)
+    {
+      m_pruning->SetBypass (false);
+    }
+
+  // The workers only see references to the channels and to the PSD, and
+  // never copy a Ptr, as the reference counts are not atomic
+  size_t numThreads = std::min<size_t> (m_numWorkers, m_links.size ());
+  const SpectrumValue psd (m_spectrumModel);
+
+  std::atomic<size_t> nextLink {0};
+  auto computeLinks = [this, &nextLink, &psd] ()
+    {
+      std::vector<std::vector<double>> gains;
+      for (size_t i = nextLink++; i < m_links.size (); i = nextLink++)
+        {
+          Link &link = m_links[i];
+          CachedThreeGppSpectrumPropagationLossModel::CalcStaticBandGains (*link.m_channel, *link.m_params,
+                                                                           m_gnbs[link.m_gnb].m_codebook,
+                                                                           link.m_ueW, link.m_gnbIsS,
+                                                                           psd, &gains);
+          link.m_meanGains.resize (gains.size ());
+          for (size_t beam = 0; beam < gains.size (); ++beam)
+            {
+              double sum = 0.0;
+              for (double gain : gains[beam])
+                {
+                  sum += gain;
+                }
+              link.m_meanGains[beam] = sum / gains[beam].size ();
+            }
+          if (m_storeSubbands)
+            {
+              link.m_bandGains.swap (gains);
+            }
+        }
+    };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < numThreads; i++)
+    {
+      threads.emplace_back (computeLinks);
+    }
+  computeLinks ();
+  for (auto &thread : threads)
+    {
+      thread.join ();
+    }
+  NS_LOG_INFO ("Computed " << m_links.size () << " links with " << numThreads << " threads");
+
+  UpdateReceiverPruning ();
+}
+
+void
+NrCouplingGainEngine::UpdateReceiverPruning ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_pruning == nullptr)
+    {
+      return;
+    }
+
+  // Thermal noise (-174 dBm/Hz) over the channel bandwidth, plus the noise figure
+  auto noiseFloorDbm = [] (const Ptr<const NrPhy> &phy)
+    {
+      return -174.0 + 10 * std::log10 (phy->GetChannelBandwidth ()) + phy->GetNoiseFigure ();
+    };
+
+  std::vector<double> ueTxPowerDbm;
+  std::vector<double> ueNoiseDbm;
+  for (const auto &ue : m_ues)
+    {
+      ueTxPowerDbm.push_back (ue.m_phy->GetTxPower ());
+      ueNoiseDbm.push_back (noiseFloorDbm (ue.m_phy));
+    }
+
+  uint32_t numCandidates = 0;
+  for (uint32_t g = 0; g < m_gnbs.size (); ++g)
+    {
+      const Gnb &gnb = m_gnbs[g];
+      double gnbTxPowerDbm = gnb.m_phy != nullptr ? gnb.m_phy->GetTxPower () : gnb.m_txPowerDbm;
+      double gnbNoiseDbm = gnb.m_phy != nullptr ? noiseFloorDbm (gnb.m_phy) : std::numeric_limits<double>::infinity ();
+      for (uint32_t u = 0; u < m_ues.size (); ++u)
+        {
+          double gain = GetBestCouplingGain (g, u);
+          bool downlink = gnbTxPowerDbm + gain >= ueNoiseDbm[u] - m_pruningMarginDb;
+          bool uplink = ueTxPowerDbm[u] + gain >= gnbNoiseDbm - m_pruningMarginDb;
+          m_pruning->SetCandidate (g, u, downlink, uplink);
+          numCandidates += downlink + uplink;
+        }
+    }
+  NS_LOG_INFO ("Candidate links: " << numCandidates << " out of " << 2 * m_links.size ());
+}
+
+bool
+NrCouplingGainEngine::IsAttached (uint32_t gnbIndex, uint32_t ueIndex) const
+{
+  const Gnb &gnb = m_gnbs[gnbIndex];
+  if (!gnb.m_isServing)
+    {
+      return false;
+    }
+  Ptr<const NrGnbNetDevice> target = StaticCast<const NrUeNetDevice> (m_ues[ueIndex].m_device)->GetTargetEnb ();
+  return target != nullptr && PeekPointer (target) == PeekPointer (gnb.m_device);
+}
+
+Ptr<NrReceiverPruningLossModel>
+NrCouplingGainEngine::GetReceiverPruning () const
+{
+  return m_pruning;
+}
+
+void
+NrCouplingGainEngine::Start (const Time &delay)
+{
+  NS_LOG_FUNCTION (this << delay);
+  m_updateEvent.Cancel ();
+  m_updateEvent = Simulator::Schedule (delay, &NrCouplingGainEngine::PeriodicUpdate, this);
+}
+
+void
+NrCouplingGainEngine::PeriodicUpdate ()
+{
+  NS_LOG_FUNCTION (this);
+  Update ();
+
+  TimeValue updatePeriod;
+  if (m_channelModel->GetAttributeFailSafe ("UpdatePeriod", updatePeriod) && !updatePeriod.Get ().IsZero ())
+    {
+      m_updateEvent = Simulator::Schedule (updatePeriod.Get (), &NrCouplingGainEngine::PeriodicUpdate, this);
+    }
+}
+
+uint32_t
+NrCouplingGainEngine::GetGnbIndex (const Ptr<const NetDevice> &gnb) const
+{
+  for (uint32_t g = 0; g < m_gnbs.size (); ++g)
+    {
+      if (m_gnbs[g].m_device == gnb)
+        {
+          return g;
+        }
+    }
+  NS_ABORT_MSG ("Device " << gnb->GetIfIndex () << " is not a gNB of the engine");
+  return 0;
+}
+
+uint32_t
+NrCouplingGainEngine::GetUeIndex (const Ptr<const NetDevice> &ue) const
+{
+  for (uint32_t u = 0; u < m_ues.size (); ++u)
+    {
+      if (m_ues[u].m_device == ue)
+        {
+          return u;
+        }
+    }
+  NS_ABORT_MSG ("Device " << ue->GetIfIndex () << " is not a UE of the engine");
+  return 0;
+}
+
+uint32_t
+NrCouplingGainEngine::GetNumBeams (uint32_t gnbIndex) const
+{
+  return static_cast<uint32_t> (m_gnbs.at (gnbIndex).m_codebook.size ());
+}
+
+const PhasedArrayModel::ComplexVector &
+NrCouplingGainEngine::GetBeam (uint32_t gnbIndex, uint32_t beam) const
+{
+  return m_gnbs.at (gnbIndex).m_codebook.at (beam);
+}
+
+const NrCouplingGainEngine::Link &
+NrCouplingGainEngine::GetLink (uint32_t gnbIndex, uint32_t ueIndex) const
+{
+  NS_ASSERT (gnbIndex < m_gnbs.size () && ueIndex < m_ues.size ());
+  const Link &link = m_links[gnbIndex * m_ues.size () + ueIndex];
+  NS_ABORT_MSG_IF (link.m_meanGains.empty (), "Update must be called before the queries");
+  return link;
+}
+
+double
+NrCouplingGainEngine::GetCouplingGain (uint32_t gnbIndex, uint32_t beam, uint32_t ueIndex) const
+{
+  const Link &link = GetLink (gnbIndex, ueIndex);
+  return link.m_pathlossDb + 10 * std::log10 (link.m_meanGains.at (beam));
+}
+
+uint32_t
+NrCouplingGainEngine::GetBestBeam (uint32_t gnbIndex, uint32_t ueIndex) const
+{
+  const Link &link = GetLink (gnbIndex, ueIndex);
+  return static_cast<uint32_t> (std::max_element (link.m_meanGains.begin (), link.m_meanGains.end ()) -
+                                link.m_meanGains.begin ());
+}
+
+double
+NrCouplingGainEngine::GetBestCouplingGain (uint32_t gnbIndex, uint32_t ueIndex) const
+{
+  return GetCouplingGain (gnbIndex, GetBestBeam (gnbIndex, ueIndex), ueIndex);
+}
+
+Ptr<NetDevice>
+NrCouplingGainEngine::GetBestServer (const Ptr<const NetDevice> &ue) const
+{
+  uint32_t ueIndex = GetUeIndex (ue);
+  Ptr<NetDevice> best;
+  double bestGain = -std::numeric_limits<double>::infinity ();
+  for (uint32_t g = 0; g < m_gnbs.size (); ++g)
+    {
+      if (!m_gnbs[g].m_isServing)
+        {
+          continue;
+        }
+      double gain = GetBestCouplingGain (g, ueIndex);
+      if (best == nullptr || gain > bestGain)
+        {
+          best = m_gnbs[g].m_device;
+          bestGain = gain;
+        }
+    }
+  NS_ABORT_MSG_IF (best == nullptr, "The engine has no serving gNB");
+  return best;
+}
+
+const std::vector<double> *
+NrCouplingGainEngine::FindBandGains (uint32_t aId, uint32_t bId,
+                                     const Ptr<const MatrixBasedChannelModel::ChannelMatrix> &channelMatrix,
+                                     const PhasedArrayModel::ComplexVector &sW,
+                                     const PhasedArrayModel::ComplexVector &uW,
+                                     SpectrumModelUid_t uid) const
+{
+  if (m_spectrumModel == nullptr || uid != m_spectrumModel->GetUid ())
+    {
+      return nullptr;
+    }
+  auto it = m_linkIndex.find (MatrixBasedChannelModel::GetKey (aId, bId));
+  if (it == m_linkIndex.end ())
+    {
+      return nullptr;
+    }
+
+  // The table is for a channel matrix and a beam of the UE
+  const Link &link = m_links[it->second];
+  if (link.m_channel != channelMatrix || link.m_bandGains.empty ())
+    {
+      return nullptr;
+    }
+  const PhasedArrayModel::ComplexVector &gnbW = link.m_gnbIsS ? sW : uW;
+  const PhasedArrayModel::ComplexVector &ueW = link.m_gnbIsS ? uW : sW;
+  if (ueW != link.m_ueW)
+    {
+      return nullptr;
+    }
+
+  const Gnb &gnb = m_gnbs[link.m_gnb];
+  auto beam = gnb.m_beams.find (CachedThreeGppSpectrumPropagationLossModel::HashBeamformingVector (gnbW));
+  if (beam == gnb.m_beams.end () || gnb.m_codebook[beam->second] != gnbW)
+    {
+      return nullptr;
+    }
+  ++m_numHits;
+  return &link.m_bandGains[beam->second];
+}
+
+uint64_t
+NrCouplingGainEngine::GetNumHits () const
+{
+  return m_numHits;
+}
+
+} // namespace ns3
@@ -0,0 +1,302 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_COUPLING_GAIN_ENGINE_H
+#define NR_COUPLING_GAIN_ENGINE_H
+
+#include <ns3/object.h>
+#include <ns3/event-id.h>
+#include <ns3/nstime.h>
+#include <ns3/net-device-container.h>
+#include <ns3/mobility-model.h>
+#include <ns3/spectrum-model.h>
+#include <ns3/propagation-loss-model.h>
+#include <ns3/matrix-based-channel-model.h>
+#include <ns3/phased-array-model.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class NrWrapAroundModel;
+class NrReceiverPruningLossModel;
+class NrPhy;
+
+/**
+ * \ingroup nr-utils
+ * \brief The coupling gains of every beam of a set of gNBs towards a set of
+ * UEs, computed at once for a static deployment
+ *
+ * For each gNB, each beam of its codebook and each UE, the engine keeps the
+ * gain of each band of the BWP (the factor that
+ * CachedThreeGppSpectrumPropagationLossModel applies to a PSD) and the
+ * wideband coupling gain, i.e. the path loss plus the mean gain over the
+ * bands. The codebook of a NrGnbNetDevice is the gNB sweep of
+ * CellScanBeamforming (with the same BeamSearchAngleStep), and the one of a
+ * NrLoadModelNetDevice is the codebook of its NrLoadModelPhy. The UEs use the
+ * beamforming vector they have when the table is computed (the quasi-omni
+ * vector if they have none).
+ *
+ * Update draws the channels of all the pairs and computes the table, in
+ * parallel over the pairs with NumWorkers threads, the simulation thread
+ * being one of them. Start schedules it, and repeats it every UpdatePeriod of
+ * the channel model. The table is used by:
+ * - CachedThreeGppSpectrumPropagationLossModel, for the receptions between
+ *   a gNB and a UE that do not move, when the beam of the gNB is in its
+ *   codebook, the beam of the UE is the one of the table, and the channel
+ *   matrix is the one of the table; the others are computed as usual. The
+ *   interference of the NrLoadModelPhy, whose beams are always in their
+ *   codebook, is served in full;
+ * - NrHelper::AttachToBestServer, which attaches each UE to the gNB with the
+ *   highest coupling gain over its beams;
+ * - with ReceiverPruning, a NrReceiverPruningLossModel that the engine adds
+ *   to the channel: a gNB and a UE are candidate receivers of each other
+ *   when the transmitter power plus the best coupling gain is above the
+ *   noise floor of the receiver minus PruningMarginDb. The channel does not
+ *   deliver the signals of a gNB to the UEs that are not its candidates nor
+ *   attached to it, and the other way around; the pairs of UEs and of gNBs
+ *   are not pruned. The candidates are set again at each Update, with the
+ *   transmitter powers of the PHYs at that time. An interference-only gNB
+ *   does not receive anything.
+ *
+ * The engine only works with a CachedThreeGppSpectrumPropagationLossModel
+ * (the default of NrHelper), without vScatt. Update draws the channels in its
+ * own order, so the random values of a simulation differ from the ones of
+ * the same simulation without the engine (but not their statistics).
+ *
+ * The table has gNBs x beams x UEs x bands doubles: set StoreSubbands to
+ * false to keep only the wideband gains, which are then not used by the
+ * spectrum model.
+ */
+class NrCouplingGainEngine : public Object
+{
+public:
+  NrCouplingGainEngine ();
+  ~NrCouplingGainEngine () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Set the devices of the table, and register the engine in the
+   * spectrum model of their channel
+   *
+   * The devices must have been installed by NrHelper, with the channels of
+   * the BWP.
+   *
+   * \param gnbs the NrGnbNetDevice and NrLoadModelNetDevice devices
+   * \param ues the NrUeNetDevice devices
+   * \param bwpIndex the index of the BWP of the devices
+   */
+  void Install (const NetDeviceContainer &gnbs, const NetDeviceContainer &ues, uint8_t bwpIndex = 0);
+
+  /**
+   * \brief Compute the table, for the current channels and UE beams
+   */
+  void Update ();
+
+  /**
+   * \brief Schedule Update, and its repetition every UpdatePeriod of the
+   * channel model (if not zero)
+   *
+   * The UEs should have their beams when it runs (e.g. after the attachment
+   * and the first beamforming).
+   *
+   * \param delay the time of the first Update, from now
+   */
+  void Start (const Time &delay);
+
+  /**
+   * \param gnb a gNB device
+   * \return the index of the gNB in the table
+   */
+  uint32_t GetGnbIndex (const Ptr<const NetDevice> &gnb) const;
+
+  /**
+   * \param ue a UE device
+   * \return the index of the UE in the table
+   */
+  uint32_t GetUeIndex (const Ptr<const NetDevice> &ue) const;
+
+  /**
+   * \param gnbIndex the index of a gNB
+   * \return the number of beams of its codebook
+   */
+  uint32_t GetNumBeams (uint32_t gnbIndex) const;
+
+  /**
+   * \param gnbIndex the index of a gNB
+   * \param beam a beam of its codebook
+   * \return the beamforming vector of the beam
+   */
+  const PhasedArrayModel::ComplexVector & GetBeam (uint32_t gnbIndex, uint32_t beam) const;
+
+  /**
+   * \param gnbIndex the index of a gNB
+   * \param beam a beam of its codebook
+   * \param ueIndex the index of a UE
+   * \return the wideband coupling gain (dB) of the beam towards the UE
+   */
+  double GetCouplingGain (uint32_t gnbIndex, uint32_t beam, uint32_t ueIndex) const;
+
+  /**
+   * \param gnbIndex the index of a gNB
+   * \param ueIndex the index of a UE
+   * \return the beam of the gNB with the highest coupling gain towards the UE
+   */
+  uint32_t GetBestBeam (uint32_t gnbIndex, uint32_t ueIndex) const;
+
+  /**
+   * \param gnbIndex the index of a gNB
+   * \param ueIndex the index of a UE
+   * \return the coupling gain (dB) of the best beam of the gNB towards the UE
+   */
+  double GetBestCouplingGain (uint32_t gnbIndex, uint32_t ueIndex) const;
+
+  /**
+   * \brief Get the NrGnbNetDevice with the highest coupling gain towards a UE
+   * \param ue a UE device
+   * \return the gNB device
+   */
+  Ptr<NetDevice> GetBestServer (const Ptr<const NetDevice> &ue) const;
+
+  /**
+   * \brief Get the gain of each band of a reception, if it is in the table
+   *
+   * Called by CachedThreeGppSpectrumPropagationLossModel for the receptions
+   * between two nodes that do not move.
+   *
+   * \param aId the id of the antenna of the first node
+   * \param bId the id of the antenna of the second node
+   * \param channelMatrix the current channel matrix of the two antennas
+   * \param sW the beamforming vector of the s antenna of the matrix
+   * \param uW the beamforming vector of the u antenna of the matrix
+   * \param uid the spectrum model of the PSD
+   * \return the gain of each band, or nullptr if the reception is not in the table
+   */
+  const std::vector<double> * FindBandGains (uint32_t aId, uint32_t bId,
+                                             const Ptr<const MatrixBasedChannelModel::ChannelMatrix> &channelMatrix,
+                                             const PhasedArrayModel::ComplexVector &sW,
+                                             const PhasedArrayModel::ComplexVector &uW,
+                                             SpectrumModelUid_t uid) const;
+
+  /**
+   * \return the number of receptions whose gains were found in the table
+   */
+  uint64_t GetNumHits () const;
+
+  /**
+   * \return the receiver pruning added to the channel, or nullptr without
+   * ReceiverPruning
+   */
+  Ptr<NrReceiverPruningLossModel> GetReceiverPruning () const;
+
+protected:
+  void DoDispose () override;
+
+private:
+  /**
+   * \brief A gNB of the table
+   */
+  struct Gnb
+  {
+    Ptr<NetDevice> m_device;                  //!< The device
+    Ptr<MobilityModel> m_mobility;            //!< The mobility model of the PHY
+    Ptr<const PhasedArrayModel> m_antenna;    //!< The antenna of the PHY
+    Ptr<PropagationLossModel> m_pathloss;     //!< The propagation loss model of the channel, or nullptr
+    bool m_isServing {true};                  //!< False for an interference-only gNB
+    Ptr<NrPhy> m_phy;                         //!< The PHY, or nullptr for an interference-only gNB
+    double m_txPowerDbm {0.0};                //!< The TX power of an interference-only gNB
+    std::vector<PhasedArrayModel::ComplexVector> m_codebook; //!< The beams
+    std::unordered_map<size_t, uint32_t> m_beams; //!< The index of each beam, by hash of its vector
+  };
+
+  /**
+   * \brief A UE of the table
+   */
+  struct Ue
+  {
+    Ptr<NetDevice> m_device;                  //!< The device
+    Ptr<MobilityModel> m_mobility;            //!< The mobility model of the PHY
+    Ptr<const PhasedArrayModel> m_antenna;    //!< The antenna of the PHY
+    Ptr<NrPhy> m_phy;                         //!< The PHY
+  };
+
+  /**
+   * \brief The gains of a pair of gNB and UE
+   */
+  struct Link
+  {
+    uint32_t m_gnb {0};                       //!< The index of the gNB
+    Ptr<const MatrixBasedChannelModel::ChannelMatrix> m_channel; //!< The channel matrix of the table
+    Ptr<const MatrixBasedChannelModel::ChannelParams> m_params;  //!< The parameters of the channel
+    bool m_gnbIsS {true};                     //!< True if the gNB is the s antenna of the matrix
+    PhasedArrayModel::ComplexVector m_ueW;    //!< The beam of the UE
+    double m_pathlossDb {0.0};                //!< The path loss gain (dB)
+    std::vector<double> m_meanGains;          //!< The mean gain over the bands, for each beam
+    std::vector<std::vector<double>> m_bandGains; //!< The gain of each band, for each beam, if stored
+  };
+
+  /**
+   * \brief Call Update, and schedule the next one
+   */
+  void PeriodicUpdate ();
+
+  /**
+   * \brief Set the candidate receivers of the receiver pruning, from the table
+   */
+  void UpdateReceiverPruning ();
+
+  /**
+   * \param gnbIndex the index of a gNB
+   * \param ueIndex the index of a UE
+   * \return true if the UE is attached to the gNB
+   */
+  bool IsAttached (uint32_t gnbIndex, uint32_t ueIndex) const;
+
+  /**
+   * \param gnbIndex the index of a gNB
+   * \param ueIndex the index of a UE
+   * \return the link of the pair
+   */
+  const Link & GetLink (uint32_t gnbIndex, uint32_t ueIndex) const;
+
+  double m_beamSearchAngleStep {30};          //!< The angle step of the gNB codebooks (attribute)
+  uint32_t m_numWorkers {1};                  //!< The number of threads of Update (attribute)
+  bool m_storeSubbands {true};                //!< True to keep the gain of each band (attribute)
+  bool m_receiverPruning {false};             //!< True to prune the receivers of the channel (attribute)
+  double m_pruningMarginDb {10.0};            //!< Margin under the noise floor of the candidates (attribute)
+  Ptr<NrReceiverPruningLossModel> m_pruning;  //!< The receiver pruning, with ReceiverPruning
+
+  std::vector<Gnb> m_gnbs;                    //!< The gNBs
+  std::vector<Ue> m_ues;                      //!< The UEs
+  std::vector<Link> m_links;                  //!< The links, at gNB index * UEs + UE index
+  std::unordered_map<uint64_t, size_t> m_linkIndex; //!< The link of each pair of antennas
+  Ptr<MatrixBasedChannelModel> m_channelModel; //!< The channel model
+  Ptr<NrWrapAroundModel> m_wrapAround;        //!< The wrap-around model of the spectrum model, if any
+  Ptr<const SpectrumModel> m_spectrumModel;   //!< The spectrum model of the BWP
+  EventId m_updateEvent;                      //!< The next periodic Update
+  mutable uint64_t m_numHits {0};             //!< Receptions found in the table
+};
+
+} // namespace ns3
+
+#endif // NR_COUPLING_GAIN_ENGINE_H
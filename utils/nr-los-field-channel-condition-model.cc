@@ -0,0 +1,309 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-los-field-channel-condition-model.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/double.h>
+#include <ns3/string.h>
+#include <ns3/simulator.h>
+#include <ns3/mobility-model.h>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <tuple>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrLosFieldChannelConditionModel");
+NS_OBJECT_ENSURE_REGISTERED (NrLosFieldChannelConditionModel);
+
+/// The key of a field in the store: scenario, correlation distance, range,
+/// resolution and position of the site
+typedef std::tuple<std::string, double, double, double, double, double, double> NrLosFieldKey;
+
+/// The fields shared by all the models
+static std::map<NrLosFieldKey, Ptr<const NrLosFieldChannelConditionModel::Field>> g_losFields;
+/// Protects g_losFields, which the models of several threads may fill
+static std::mutex g_losFieldsMutex;
+/// True once the reset of g_losFields is scheduled
+static bool g_losFieldsResetScheduled = false;
+
+NrLosFieldChannelConditionModel::NrLosFieldChannelConditionModel ()
+{
+  NS_LOG_FUNCTION (this);
+  m_normal = CreateObject<NormalRandomVariable> ();
+  m_normal->SetAttribute ("Mean", DoubleValue (0.0));
+  m_normal->SetAttribute ("Variance", DoubleValue (1.0));
+}
+
+NrLosFieldChannelConditionModel::~NrLosFieldChannelConditionModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+NrLosFieldChannelConditionModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrLosFieldChannelConditionModel")
+    .SetParent<ChannelConditionModel> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrLosFieldChannelConditionModel> ()
+    .AddAttribute ("Scenario",
+                   "The 3GPP scenario of the LOS probability (RMa, UMa, UMi-StreetCanyon, "
+                   "InH-OfficeOpen, InH-OfficeMixed)",
+                   StringValue ("UMa"),
+                   MakeStringAccessor (&NrLosFieldChannelConditionModel::m_scenario),
+                   MakeStringChecker ())
+    .AddAttribute ("CorrelationDistance",
+                   "The correlation distance of the LOS condition (m). 0 uses the "
+                   "one of TR 38.901 Table 7.6.3.1-2 for the scenario",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&NrLosFieldChannelConditionModel::m_correlationDistance),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("Range",
+                   "The distance from the site to the border of its field, along X and Y (m)",
+                   DoubleValue (1000.0),
+                   MakeDoubleAccessor (&NrLosFieldChannelConditionModel::m_range),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("Resolution",
+                   "The distance between the points of the fields (m)",
+                   DoubleValue (10.0),
+                   MakeDoubleAccessor (&NrLosFieldChannelConditionModel::m_resolution),
+                   MakeDoubleChecker<double> (0.0))
+    ;
+  return tid;
+}
+
+double
+NrLosFieldChannelConditionModel::GetLosProbability (const std::string &scenario, double distance2D, double hUt)
+{
+  // TR 38.901 Table 7.4.2-1
+  if (scenario == "RMa")
+    {
+      return distance2D <= 10.0 ? 1.0 : std::exp (-(distance2D - 10.0) / 1000.0);
+    }
+  if (scenario == "UMa")
+    {
+      if (distance2D <= 18.0)
+        {
+          return 1.0;
+        }
+      double c = hUt <= 13.0 ? 0.0 : std::pow ((hUt - 13.0) / 10.0, 1.5);
+      return (18.0 / distance2D + std::exp (-distance2D / 63.0) * (1.0 - 18.0 / distance2D))
+             * (1.0 + c * 5.0 / 4.0 * std::pow (distance2D / 100.0, 3.0) * std::exp (-distance2D / 150.0));
+    }
+  if (scenario == "UMi-StreetCanyon")
+    {
+      if (distance2D <= 18.0)
+        {
+          return 1.0;
+        }
+      return 18.0 / distance2D + std::exp (-distance2D / 36.0) * (1.0 - 18.0 / distance2D);
+    }
+  if (scenario == "InH-OfficeOpen")
+    {
+      if (distance2D <= 5.0)
+        {
+          return 1.0;
+        }
+      if (distance2D <= 49.0)
+        {
+          return std::exp (-(distance2D - 5.0) / 70.8);
+        }
+      return std::exp (-(distance2D - 49.0) / 211.7) * 0.54;
+    }
+  if (scenario == "InH-OfficeMixed")
+    {
+      if (distance2D <= 1.2)
+        {
+          return 1.0;
+        }
+      if (distance2D < 6.5)
+        {
+          return std::exp (-(distance2D - 1.2) / 4.7);
+        }
+      return std::exp (-(distance2D - 6.5) / 32.6) * 0.32;
+    }
+  NS_FATAL_ERROR ("Unknown scenario " << scenario);
+  return 0.0;
+}
+
+double
+NrLosFieldChannelConditionModel::GetCorrelationDistance () const
+{
+  if (m_correlationDistance > 0.0)
+    {
+      return m_correlationDistance;
+    }
+  // TR 38.901 Table 7.6.3.1-2, correlation distance of the LOS state
+  if (m_scenario == "RMa")
+    {
+      return 60.0;
+    }
+  if (m_scenario == "UMa" || m_scenario == "UMi-StreetCanyon")
+    {
+      return 50.0;
+    }
+  if (m_scenario == "InH-OfficeOpen" || m_scenario == "InH-OfficeMixed")
+    {
+      return 10.0;
+    }
+  NS_FATAL_ERROR ("Unknown scenario " << m_scenario);
+  return 0.0;
+}
+
+Ptr<ChannelCondition>
+NrLosFieldChannelConditionModel::GetChannelCondition (Ptr<const MobilityModel> a,
+                                                      Ptr<const MobilityModel> b) const
+{
+  NS_LOG_FUNCTION (this);
+
+  // the site is the higher end, or the first one in X and Y at the same
+  // height, so that the condition of a link does not depend on its direction
+  Vector aPosition = a->GetPosition ();
+  Vector bPosition = b->GetPosition ();
+  bool aIsSite = aPosition.z != bPosition.z ? aPosition.z > bPosition.z
+                                            : std::tie (aPosition.x, aPosition.y) <= std::tie (bPosition.x, bPosition.y);
+  Ptr<const MobilityModel> site = aIsSite ? a : b;
+  const Vector &ue = aIsSite ? bPosition : aPosition;
+
+  Ptr<const Field> field = GetField (site);
+  double distance2D = std::hypot (ue.x - field->m_site.x, ue.y - field->m_site.y);
+  double pLos = GetLosProbability (m_scenario, distance2D, ue.z);
+  double uniform = 0.5 * std::erfc (-GetValue (*field, ue) / std::sqrt (2.0));
+
+  Ptr<ChannelCondition> cond = CreateObject<ChannelCondition> ();
+  cond->SetO2iCondition (ChannelCondition::O2iConditionValue::O2O);
+  cond->SetLosCondition (uniform < pLos ? ChannelCondition::LosConditionValue::LOS
+                                        : ChannelCondition::LosConditionValue::NLOS);
+  return cond;
+}
+
+int64_t
+NrLosFieldChannelConditionModel::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_normal->SetStream (stream);
+  return 1;
+}
+
+void
+NrLosFieldChannelConditionModel::PrepareSite (Ptr<const MobilityModel> site) const
+{
+  NS_LOG_FUNCTION (this);
+  GetField (site);
+}
+
+uint32_t
+NrLosFieldChannelConditionModel::GetNumFields ()
+{
+  std::lock_guard<std::mutex> lock (g_losFieldsMutex);
+  return static_cast<uint32_t> (g_losFields.size ());
+}
+
+Ptr<const NrLosFieldChannelConditionModel::Field>
+NrLosFieldChannelConditionModel::GetField (Ptr<const MobilityModel> site) const
+{
+  Vector position = site->GetPosition ();
+  std::lock_guard<std::mutex> lock (g_losFieldsMutex);
+
+  auto cached = m_fields.find (PeekPointer (site));
+  if (cached != m_fields.end () && cached->second->m_site == position)
+    {
+      return cached->second;
+    }
+
+  NrLosFieldKey key (m_scenario, GetCorrelationDistance (), m_range, m_resolution,
+                     position.x, position.y, position.z);
+  auto it = g_losFields.find (key);
+  if (it == g_losFields.end ())
+    {
+      NS_ABORT_MSG_IF (m_resolution <= 0.0, "The resolution of the LOS field must be positive");
+      uint32_t half = std::max (1U, static_cast<uint32_t> (std::floor (m_range / m_resolution)));
+      uint32_t numPoints = 2 * half + 1;
+      std::vector<double> f (static_cast<size_t> (numPoints) * numPoints);
+      for (double &value : f)
+        {
+          value = m_normal->GetValue ();
+        }
+
+      // A first-order autoregressive filter along each axis keeps the unit
+      // variance, and gives the correlation exp (-dx / d) exp (-dy / d)
+      double rho = std::exp (-m_resolution / GetCorrelationDistance ());
+      double innovation = std::sqrt (1.0 - rho * rho);
+      for (uint32_t y = 0; y < numPoints; ++y)
+        {
+          for (uint32_t x = 1; x < numPoints; ++x)
+            {
+              size_t i = static_cast<size_t> (y) * numPoints + x;
+              f[i] = rho * f[i - 1] + innovation * f[i];
+            }
+        }
+      for (uint32_t y = 1; y < numPoints; ++y)
+        {
+          for (uint32_t x = 0; x < numPoints; ++x)
+            {
+              size_t i = static_cast<size_t> (y) * numPoints + x;
+              f[i] = rho * f[i - numPoints] + innovation * f[i];
+            }
+        }
+
+      Ptr<Field> field = Create<Field> ();
+      field->m_site = position;
+      field->m_values.assign (f.begin (), f.end ());
+      it = g_losFields.emplace (key, field).first;
+      NS_LOG_INFO ("LOS field of the site " << position << ", " << numPoints << "x" << numPoints << " points");
+
+      if (!g_losFieldsResetScheduled)
+        {
+          g_losFieldsResetScheduled = true;
+          Simulator::ScheduleDestroy (&NrLosFieldChannelConditionModel::ResetStore);
+        }
+    }
+  m_fields[PeekPointer (site)] = it->second;
+  return it->second;
+}
+
+double
+NrLosFieldChannelConditionModel::GetValue (const Field &field, const Vector &position) const
+{
+  uint32_t numPoints = static_cast<uint32_t> (std::lround (std::sqrt (static_cast<double> (field.m_values.size ()))));
+  double half = (numPoints - 1) / 2;
+  double u = std::min (std::max ((position.x - field.m_site.x) / m_resolution + half, 0.0), numPoints - 1.0);
+  double v = std::min (std::max ((position.y - field.m_site.y) / m_resolution + half, 0.0), numPoints - 1.0);
+  uint32_t x = std::min (static_cast<uint32_t> (u), numPoints - 2);
+  uint32_t y = std::min (static_cast<uint32_t> (v), numPoints - 2);
+  double fx = u - x;
+  double fy = v - y;
+
+  size_t i = static_cast<size_t> (y) * numPoints + x;
+  const std::vector<float> &f = field.m_values;
+  return (1.0 - fy) * ((1.0 - fx) * f[i] + fx * f[i + 1])
+         + fy * ((1.0 - fx) * f[i + numPoints] + fx * f[i + numPoints + 1]);
+}
+
+void
+NrLosFieldChannelConditionModel::ResetStore ()
+{
+  std::lock_guard<std::mutex> lock (g_losFieldsMutex);
+  g_losFields.clear ();
+  g_losFieldsResetScheduled = false;
+}
+
+} // namespace ns3
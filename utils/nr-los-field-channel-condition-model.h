@@ -0,0 +1,159 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_LOS_FIELD_CHANNEL_CONDITION_MODEL_H
+#define NR_LOS_FIELD_CHANNEL_CONDITION_MODEL_H
+
+#include <ns3/channel-condition-model.h>
+#include <ns3/random-variable-stream.h>
+#include <ns3/simple-ref-count.h>
+#include <ns3/vector.h>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup nr-utils
+ * \brief A spatially consistent 3GPP LOS condition, from a correlated
+ * random field around each site
+ *
+ * The site of a link is its higher end (the gNB), the other end is the UE.
+ * Around each site, a square grid of Range meters from the site, with a
+ * point every Resolution meters, holds a Gaussian random field with the
+ * correlation exp (-dx / d) exp (-dy / d), d being the LOS correlation
+ * distance of the scenario (TR 38.901 Table 7.6.3.1-2: 60 m in RMa, 50 m in
+ * UMa and UMi, 10 m in InH). The link is in LOS when the uniform value of
+ * the field at the UE, interpolated between the points of the grid, is
+ * lower than the LOS probability of TR 38.901 Table 7.4.2-1 at the 2D
+ * distance of the link. Close UEs then have the same condition, and a UE
+ * keeps its condition until it moves by about d; the UEs farther than
+ * Range use the field at the border of the grid.
+ *
+ * A query costs a few operations, and the memory is one grid per site,
+ * whatever the number of UEs and links. The grids are kept in a store
+ * shared by all the models with the same Scenario, CorrelationDistance,
+ * Range and Resolution, and found by the position of the site: the copies
+ * of the model made by NrRadioEnvironmentMapHelper see the same field as
+ * the simulation. The grid of a site is drawn by the first model that
+ * needs it, with its own random stream, and the store is emptied at
+ * Simulator::Destroy. The sites must not move.
+ *
+ * All the links are outdoor (O2O). NrHelper uses it for the RMa, UMa, UMi
+ * and InH scenarios when its SpatialLosField attribute is true.
+ */
+class NrLosFieldChannelConditionModel : public ChannelConditionModel
+{
+public:
+  NrLosFieldChannelConditionModel ();
+  ~NrLosFieldChannelConditionModel () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Computes the condition of the channel between a and b
+   * \param a mobility model
+   * \param b mobility model
+   * \return the condition of the channel between a and b
+   */
+  Ptr<ChannelCondition> GetChannelCondition (Ptr<const MobilityModel> a, Ptr<const MobilityModel> b) const override;
+
+  /**
+   * \brief Assign a stream to the normal variable that draws the fields
+   * \param stream the first stream
+   * \return 1
+   */
+  int64_t AssignStreams (int64_t stream) override;
+
+  /**
+   * \brief The LOS probability of TR 38.901 Table 7.4.2-1
+   * \param scenario the scenario (RMa, UMa, UMi-StreetCanyon,
+   * InH-OfficeOpen or InH-OfficeMixed)
+   * \param distance2D the 2D distance between the site and the UE (m)
+   * \param hUt the height of the UE (m)
+   * \return the LOS probability
+   */
+  static double GetLosProbability (const std::string &scenario, double distance2D, double hUt);
+
+  /**
+   * \brief Draw the field of a site, if it is not in the store yet
+   *
+   * The fields are otherwise drawn at the first query of each site; drawing
+   * them beforehand, from the simulation thread, keeps the draws in the
+   * same order when the queries come from several threads.
+   *
+   * \param site the mobility model of the site
+   */
+  void PrepareSite (Ptr<const MobilityModel> site) const;
+
+  /**
+   * \return the number of fields in the store, for all the configurations
+   */
+  static uint32_t GetNumFields ();
+
+  /**
+   * \brief The field around a site
+   */
+  struct Field : public SimpleRefCount<Field>
+  {
+    Vector m_site;                  //!< The position of the site
+    std::vector<float> m_values;    //!< The Gaussian values, at y * points + x
+  };
+
+private:
+  /**
+   * \return the correlation distance of the field (m)
+   */
+  double GetCorrelationDistance () const;
+
+  /**
+   * \brief Get the field of a site, from the cache of this model or the
+   * store, or draw it
+   * \param site the mobility model of the site
+   * \return the field
+   */
+  Ptr<const Field> GetField (Ptr<const MobilityModel> site) const;
+
+  /**
+   * \param field the field
+   * \param position the position of the UE
+   * \return the Gaussian value of the field at the position
+   */
+  double GetValue (const Field &field, const Vector &position) const;
+
+  /**
+   * \brief Forget the fields of the store, at Simulator::Destroy
+   */
+  static void ResetStore ();
+
+  std::string m_scenario;                   //!< The 3GPP scenario (attribute)
+  double m_correlationDistance {0.0};       //!< The correlation distance, 0 for the one of the scenario (attribute)
+  double m_range {1000.0};                  //!< The half-side of the grids (attribute)
+  double m_resolution {10.0};               //!< The distance between the points of the grids (attribute)
+  Ptr<NormalRandomVariable> m_normal;       //!< The variable that draws the fields
+  /// The fields already used by this model, by site
+  mutable std::map<const MobilityModel *, Ptr<const Field>> m_fields;
+};
+
+} // namespace ns3
+
+#endif // NR_LOS_FIELD_CHANNEL_CONDITION_MODEL_H
@@ -0,0 +1,432 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-pathloss-map-propagation-loss-model.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/boolean.h>
+#include <ns3/double.h>
+#include <ns3/pointer.h>
+#include <ns3/uinteger.h>
+#include <ns3/object-factory.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/three-gpp-propagation-loss-model.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrPathlossMapPropagationLossModel");
+NS_OBJECT_ENSURE_REGISTERED (NrPathlossMapPropagationLossModel);
+
+NrPathlossMapPropagationLossModel::NrPathlossMapPropagationLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+  m_normal = CreateObject<NormalRandomVariable> ();
+  m_normal->SetAttribute ("Mean", DoubleValue (0.0));
+  m_normal->SetAttribute ("Variance", DoubleValue (1.0));
+}
+
+NrPathlossMapPropagationLossModel::~NrPathlossMapPropagationLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrPathlossMapPropagationLossModel::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_model = nullptr;
+  m_3gppModel = nullptr;
+  m_conditionModel = nullptr;
+  m_sites.clear ();
+  m_siteIndex.clear ();
+  m_normal = nullptr;
+  PropagationLossModel::DoDispose ();
+}
+
+TypeId
+NrPathlossMapPropagationLossModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrPathlossMapPropagationLossModel")
+    .SetParent<PropagationLossModel> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrPathlossMapPropagationLossModel> ()
+    .AddAttribute ("PropagationLossModel",
+                   "The 3GPP model whose losses are rasterized",
+                   PointerValue (),
+                   MakePointerAccessor (&NrPathlossMapPropagationLossModel::SetPropagationLossModel,
+                                        &NrPathlossMapPropagationLossModel::GetPropagationLossModel),
+                   MakePointerChecker<PropagationLossModel> ())
+    .AddAttribute ("XMin",
+                   "The X coordinate of the first point of the grid (m)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&NrPathlossMapPropagationLossModel::m_xMin),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("XMax",
+                   "The maximum X coordinate of the grid (m)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&NrPathlossMapPropagationLossModel::m_xMax),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("YMin",
+                   "The Y coordinate of the first point of the grid (m)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&NrPathlossMapPropagationLossModel::m_yMin),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("YMax",
+                   "The maximum Y coordinate of the grid (m)",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&NrPathlossMapPropagationLossModel::m_yMax),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("Resolution",
+                   "The distance between two adjacent points of the grid (m)",
+                   DoubleValue (10.0),
+                   MakeDoubleAccessor (&NrPathlossMapPropagationLossModel::m_resolution),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("Height",
+                   "The height of the grid (m): the nodes at another height are "
+                   "computed by the wrapped model",
+                   DoubleValue (1.5),
+                   MakeDoubleAccessor (&NrPathlossMapPropagationLossModel::m_height),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("NumWorkers",
+                   "The number of threads that compute the maps, the simulation "
+                   "thread included",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&NrPathlossMapPropagationLossModel::m_numWorkers),
+                   MakeUintegerChecker<uint32_t> (1))
+    ;
+  return tid;
+}
+
+void
+NrPathlossMapPropagationLossModel::SetPropagationLossModel (const Ptr<PropagationLossModel> &model)
+{
+  NS_LOG_FUNCTION (this << model);
+  m_model = model;
+}
+
+Ptr<PropagationLossModel>
+NrPathlossMapPropagationLossModel::GetPropagationLossModel () const
+{
+  return m_model;
+}
+
+void
+NrPathlossMapPropagationLossModel::AddSite (const Ptr<MobilityModel> &site)
+{
+  NS_LOG_FUNCTION (this << site);
+  if (m_siteIndex.find (PeekPointer (site)) != m_siteIndex.end ())
+    {
+      return;
+    }
+  m_siteIndex.emplace (PeekPointer (site), static_cast<uint32_t> (m_sites.size ()));
+  Site newSite;
+  newSite.m_mobility = site;
+  m_sites.emplace_back (std::move (newSite));
+}
+
+uint32_t
+NrPathlossMapPropagationLossModel::GetNumSites () const
+{
+  return static_cast<uint32_t> (m_sites.size ());
+}
+
+uint64_t
+NrPathlossMapPropagationLossModel::GetNumMisses () const
+{
+  return m_numMisses;
+}
+
+void
+NrPathlossMapPropagationLossModel::Generate ()
+{
+  NS_LOG_FUNCTION (this << m_sites.size ());
+
+  m_3gppModel = DynamicCast<ThreeGppPropagationLossModel> (m_model);
+  NS_ABORT_MSG_IF (m_3gppModel == nullptr, "The path loss maps need a ThreeGppPropagationLossModel");
+  m_conditionModel = m_3gppModel->GetChannelConditionModel ();
+  NS_ABORT_MSG_IF (m_conditionModel == nullptr, "The path loss model has no channel condition model");
+
+  m_numX = static_cast<uint32_t> (std::floor ((m_xMax - m_xMin) / m_resolution)) + 1;
+  m_numY = static_cast<uint32_t> (std::floor ((m_yMax - m_yMin) / m_resolution)) + 1;
+  NS_ABORT_MSG_IF (m_xMax < m_xMin + m_resolution || m_yMax < m_yMin + m_resolution,
+                   "The grid of the path loss maps must have at least two points along each axis");
+
+  BooleanValue shadowing;
+  m_3gppModel->GetAttribute ("ShadowingEnabled", shadowing);
+  m_shadowing = shadowing.Get ();
+  // also checks that the scenario is supported
+  double correlationLos = GetShadowingCorrelationDistance (true);
+  double correlationNlos = GetShadowingCorrelationDistance (false);
+
+  for (auto &site : m_sites)
+    {
+      site.m_position = site.m_mobility->GetPosition ();
+    }
+  ComputeLosses ();
+
+  // The fields are drawn serially, site after site, so that they do not
+  // depend on the number of workers
+  for (auto &site : m_sites)
+    {
+      site.m_shadowingLos.clear ();
+      site.m_shadowingNlos.clear ();
+      if (m_shadowing)
+        {
+          DrawShadowingField (correlationLos, &site.m_shadowingLos);
+          DrawShadowingField (correlationNlos, &site.m_shadowingNlos);
+        }
+    }
+
+  m_generated = true;
+  NS_LOG_INFO ("Path loss maps of " << m_sites.size () << " sites, " << m_numX << "x" << m_numY << " points");
+}
+
+void
+NrPathlossMapPropagationLossModel::ComputeLosses ()
+{
+  NS_LOG_FUNCTION (this);
+
+  size_t numPoints = static_cast<size_t> (m_numX) * m_numY;
+  size_t numItems = numPoints * m_sites.size ();
+  for (auto &site : m_sites)
+    {
+      site.m_lossLos.assign (numPoints, 0.0);
+      site.m_lossNlos.assign (numPoints, 0.0);
+    }
+
+  // A copy of the wrapped model, without shadowing, and with a fixed
+  // condition
+  ObjectFactory factory;
+  factory.SetTypeId (m_3gppModel->GetInstanceTypeId ());
+  for (TypeId tid = m_3gppModel->GetInstanceTypeId (); ; tid = tid.GetParent ())
+    {
+      for (size_t i = 0; i < tid.GetAttributeN (); ++i)
+        {
+          TypeId::AttributeInformation info = tid.GetAttribute (i);
+          if (info.checker->GetValueTypeName () == "ns3::PointerValue")
+            {
+              continue;
+            }
+          Ptr<AttributeValue> value = info.checker->Create ();
+          m_3gppModel->GetAttribute (info.name, *value);
+          factory.Set (info.name, *value);
+        }
+      if (!tid.HasParent ())
+        {
+          break;
+        }
+    }
+  factory.Set ("ShadowingEnabled", BooleanValue (false));
+
+  // Each worker has its own objects, created here: the reference counts of
+  // the ns-3 objects are not atomic
+  struct Worker
+  {
+    Ptr<ThreeGppPropagationLossModel> m_los;  //!< The LOS model
+    Ptr<ThreeGppPropagationLossModel> m_nlos; //!< The NLOS model
+    Ptr<MobilityModel> m_site;                //!< The site
+    Ptr<MobilityModel> m_point;               //!< The point of the grid
+  };
+  size_t numThreads = std::max<size_t> (1, std::min<size_t> (m_numWorkers, numItems));
+  std::vector<Worker> workers (numThreads);
+  for (auto &worker : workers)
+    {
+      worker.m_los = factory.Create<ThreeGppPropagationLossModel> ();
+      worker.m_los->SetChannelConditionModel (CreateObject<AlwaysLosChannelConditionModel> ());
+      worker.m_nlos = factory.Create<ThreeGppPropagationLossModel> ();
+      worker.m_nlos->SetChannelConditionModel (CreateObject<NeverLosChannelConditionModel> ());
+      worker.m_site = CreateObject<ConstantPositionMobilityModel> ();
+      worker.m_point = CreateObject<ConstantPositionMobilityModel> ();
+    }
+
+  std::atomic<size_t> nextItem {0};
+  auto computeLosses = [this, &nextItem, numPoints, numItems] (Worker *worker)
+    {
+      for (size_t i = nextItem++; i < numItems; i = nextItem++)
+        {
+          Site &site = m_sites[i / numPoints];
+          size_t point = i % numPoints;
+          worker->m_site->SetPosition (site.m_position);
+          worker->m_point->SetPosition (Vector (m_xMin + (point % m_numX) * m_resolution,
+                                                m_yMin + (point / m_numX) * m_resolution,
+                                                m_height));
+          site.m_lossLos[point] = -worker->m_los->CalcRxPower (0.0, worker->m_site, worker->m_point);
+          site.m_lossNlos[point] = -worker->m_nlos->CalcRxPower (0.0, worker->m_site, worker->m_point);
+        }
+    };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < numThreads; ++i)
+    {
+      threads.emplace_back (computeLosses, &workers[i]);
+    }
+  computeLosses (&workers[0]);
+  for (auto &thread : threads)
+    {
+      thread.join ();
+    }
+}
+
+void
+NrPathlossMapPropagationLossModel::DrawShadowingField (double correlationDistance, std::vector<double> *field) const
+{
+  field->resize (static_cast<size_t> (m_numX) * m_numY);
+  for (double &value : *field)
+    {
+      value = m_normal->GetValue ();
+    }
+
+  // A first-order autoregressive filter along each axis keeps the unit
+  // variance, and gives the correlation exp (-dx / d) exp (-dy / d)
+  double rho = std::exp (-m_resolution / correlationDistance);
+  double innovation = std::sqrt (1.0 - rho * rho);
+  std::vector<double> &f = *field;
+  for (uint32_t y = 0; y < m_numY; ++y)
+    {
+      for (uint32_t x = 1; x < m_numX; ++x)
+        {
+          size_t i = static_cast<size_t> (y) * m_numX + x;
+          f[i] = rho * f[i - 1] + innovation * f[i];
+        }
+    }
+  for (uint32_t y = 1; y < m_numY; ++y)
+    {
+      for (uint32_t x = 0; x < m_numX; ++x)
+        {
+          size_t i = static_cast<size_t> (y) * m_numX + x;
+          f[i] = rho * f[i - m_numX] + innovation * f[i];
+        }
+    }
+}
+
+double
+NrPathlossMapPropagationLossModel::GetShadowingStd (bool los, const Site &site, const Vector &position) const
+{
+  // TR 38.901 Table 7.4.1-1, as in the ns-3 models
+  TypeId tid = m_3gppModel->GetInstanceTypeId ();
+  if (tid == ThreeGppRmaPropagationLossModel::GetTypeId ())
+    {
+      if (!los)
+        {
+          return 8.0;
+        }
+      double distance2D = std::hypot (position.x - site.m_position.x, position.y - site.m_position.y);
+      double breakpoint = 2 * M_PI * site.m_position.z * m_height * m_3gppModel->GetFrequency () / 3e8;
+      return distance2D <= breakpoint ? 4.0 : 6.0;
+    }
+  if (tid == ThreeGppUmaPropagationLossModel::GetTypeId ())
+    {
+      return los ? 4.0 : 6.0;
+    }
+  if (tid == ThreeGppUmiStreetCanyonPropagationLossModel::GetTypeId ())
+    {
+      return los ? 4.0 : 7.82;
+    }
+  return los ? 3.0 : 8.03;
+}
+
+double
+NrPathlossMapPropagationLossModel::GetShadowingCorrelationDistance (bool los) const
+{
+  // TR 38.901 Table 7.5-6
+  TypeId tid = m_3gppModel->GetInstanceTypeId ();
+  if (tid == ThreeGppRmaPropagationLossModel::GetTypeId ())
+    {
+      return los ? 37.0 : 120.0;
+    }
+  if (tid == ThreeGppUmaPropagationLossModel::GetTypeId ())
+    {
+      return los ? 37.0 : 50.0;
+    }
+  if (tid == ThreeGppUmiStreetCanyonPropagationLossModel::GetTypeId ())
+    {
+      return los ? 10.0 : 13.0;
+    }
+  NS_ABORT_MSG_IF (tid != ThreeGppIndoorOfficePropagationLossModel::GetTypeId (),
+                   "The path loss maps do not support " << tid.GetName ());
+  return los ? 10.0 : 6.0;
+}
+
+double
+NrPathlossMapPropagationLossModel::Interpolate (const std::vector<double> &raster, const Vector &position) const
+{
+  double fx = (position.x - m_xMin) / m_resolution;
+  double fy = (position.y - m_yMin) / m_resolution;
+  uint32_t ix = std::min (static_cast<uint32_t> (fx), m_numX - 2);
+  uint32_t iy = std::min (static_cast<uint32_t> (fy), m_numY - 2);
+  double tx = fx - ix;
+  double ty = fy - iy;
+  size_t i = static_cast<size_t> (iy) * m_numX + ix;
+  return (1 - ty) * ((1 - tx) * raster[i] + tx * raster[i + 1])
+    + ty * ((1 - tx) * raster[i + m_numX] + tx * raster[i + m_numX + 1]);
+}
+
+double
+NrPathlossMapPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a,
+                                                  Ptr<MobilityModel> b) const
+{
+  NS_ASSERT (m_model != nullptr);
+
+  if (m_generated)
+    {
+      Ptr<MobilityModel> other = b;
+      auto it = m_siteIndex.find (PeekPointer (a));
+      if (it == m_siteIndex.end ())
+        {
+          it = m_siteIndex.find (PeekPointer (b));
+          other = a;
+        }
+      Vector position = other->GetPosition ();
+      if (it != m_siteIndex.end ()
+          && position.x >= m_xMin && position.x <= m_xMin + (m_numX - 1) * m_resolution
+          && position.y >= m_yMin && position.y <= m_yMin + (m_numY - 1) * m_resolution
+          && std::abs (position.z - m_height) <= 0.01)
+        {
+          const Site &site = m_sites[it->second];
+          bool los = m_conditionModel->GetChannelCondition (a, b)->GetLosCondition () == ChannelCondition::LOS;
+          double lossDb = Interpolate (los ? site.m_lossLos : site.m_lossNlos, position);
+          if (m_shadowing)
+            {
+              lossDb += GetShadowingStd (los, site, position)
+                * Interpolate (los ? site.m_shadowingLos : site.m_shadowingNlos, position);
+            }
+
+          // the models chained after the wrapped one
+          double rxPowerDbm = txPowerDbm - lossDb;
+          Ptr<PropagationLossModel> next = m_model->GetNext ();
+          return next != nullptr ? next->CalcRxPower (rxPowerDbm, a, b) : rxPowerDbm;
+        }
+    }
+
+  ++m_numMisses;
+  return m_model->CalcRxPower (txPowerDbm, a, b);
+}
+
+int64_t
+NrPathlossMapPropagationLossModel::DoAssignStreams (int64_t stream)
+{
+  // The streams of the wrapped model are assigned through it (see NrHelper)
+  m_normal->SetStream (stream);
+  return 1;
+}
+
+} // namespace ns3
@@ -0,0 +1,191 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_PATHLOSS_MAP_PROPAGATION_LOSS_MODEL_H
+#define NR_PATHLOSS_MAP_PROPAGATION_LOSS_MODEL_H
+
+#include <ns3/propagation-loss-model.h>
+#include <ns3/channel-condition-model.h>
+#include <ns3/mobility-model.h>
+#include <ns3/random-variable-stream.h>
+#include <ns3/vector.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class ThreeGppPropagationLossModel;
+
+/**
+ * \ingroup nr-utils
+ * \brief A propagation loss model that takes the loss between static sites
+ * and the UEs from rasters, computed once from a 3GPP path loss model
+ *
+ * Generate computes, for each site (e.g. a gNB) and for each point of a
+ * regular grid over XMin..XMax x YMin..YMax at the height Height, the LOS and
+ * NLOS path loss of the wrapped ThreeGppPropagationLossModel, in parallel on
+ * NumWorkers threads (the simulation thread being one of them). When the
+ * shadowing of the wrapped model is enabled, it also draws for each site a
+ * LOS and a NLOS shadowing field over the grid, spatially consistent: its
+ * correlation decays exponentially with the distance, with the standard
+ * deviation and the correlation distance of TR 38.901 Table 7.5-6 for the
+ * scenario of the wrapped model (RMa, UMa, UMi-StreetCanyon or InH).
+ *
+ * Then, the loss between a site and a node in the grid at the height of the
+ * grid is the bilinear interpolation of the rasters of the site, for the
+ * channel condition of the pair given by the channel condition model of the
+ * wrapped model (the one of the fast fading, so that both keep the same
+ * condition). The moves of the UEs do not cost anything more than the
+ * lookup, and the shadowing changes smoothly along their path. The other
+ * links (between two sites, out of the grid, or at another height) are
+ * computed by the wrapped model. The models chained after the wrapped one
+ * (e.g. the cull of DistanceBasedThreeGppSpectrumPropagationLossModel) are
+ * applied in both cases.
+ *
+ * NrHelper::EnablePathlossMaps puts this model in front of the 3GPP path
+ * loss model of the channels, and NrHelper::GeneratePathlossMaps computes
+ * the maps of the gNBs. The sites must not move after Generate. The
+ * outdoor-to-indoor losses and the wrap-around are not supported.
+ */
+class NrPathlossMapPropagationLossModel : public PropagationLossModel
+{
+public:
+  NrPathlossMapPropagationLossModel ();
+  ~NrPathlossMapPropagationLossModel () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Set the 3GPP model whose losses are rasterized
+   * \param model the model
+   */
+  void SetPropagationLossModel (const Ptr<PropagationLossModel> &model);
+
+  /**
+   * \return the 3GPP model whose losses are rasterized
+   */
+  Ptr<PropagationLossModel> GetPropagationLossModel () const;
+
+  /**
+   * \brief Add a site, whose maps are computed by the next Generate
+   *
+   * A site that is already added is ignored.
+   *
+   * \param site the mobility model of the site
+   */
+  void AddSite (const Ptr<MobilityModel> &site);
+
+  /**
+   * \return the number of sites
+   */
+  uint32_t GetNumSites () const;
+
+  /**
+   * \brief Compute the maps of the sites
+   *
+   * The shadowing fields are drawn from the stream of this model, so it
+   * should be called after the streams are assigned.
+   */
+  void Generate ();
+
+  /**
+   * \return the number of losses computed by the wrapped model
+   */
+  uint64_t GetNumMisses () const;
+
+protected:
+  void DoDispose () override;
+
+private:
+  double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const override;
+  int64_t DoAssignStreams (int64_t stream) override;
+
+  /**
+   * \brief The maps of a site
+   */
+  struct Site
+  {
+    Ptr<MobilityModel> m_mobility;          //!< The mobility model of the site
+    Vector m_position;                      //!< The position of the site at Generate
+    std::vector<double> m_lossLos;          //!< The LOS path loss (dB) of each point
+    std::vector<double> m_lossNlos;         //!< The NLOS path loss (dB) of each point
+    std::vector<double> m_shadowingLos;     //!< The LOS shadowing field (unit variance) of each point, if enabled
+    std::vector<double> m_shadowingNlos;    //!< The NLOS shadowing field (unit variance) of each point, if enabled
+  };
+
+  /**
+   * \brief Compute the path loss of all the points of the sites, on the workers
+   */
+  void ComputeLosses ();
+
+  /**
+   * \brief Draw a spatially consistent field of unit variance over the grid
+   * \param correlationDistance the correlation distance (m)
+   * \param field the field
+   */
+  void DrawShadowingField (double correlationDistance, std::vector<double> *field) const;
+
+  /**
+   * \param los true for the LOS condition
+   * \param site the site
+   * \param position the position of the other node
+   * \return the standard deviation (dB) of the shadowing
+   */
+  double GetShadowingStd (bool los, const Site &site, const Vector &position) const;
+
+  /**
+   * \param los true for the LOS condition
+   * \return the correlation distance (m) of the shadowing
+   */
+  double GetShadowingCorrelationDistance (bool los) const;
+
+  /**
+   * \brief Interpolate a raster
+   * \param raster the raster
+   * \param position the position, in the grid
+   * \return the interpolated value
+   */
+  double Interpolate (const std::vector<double> &raster, const Vector &position) const;
+
+  Ptr<PropagationLossModel> m_model;          //!< The wrapped model
+  Ptr<ThreeGppPropagationLossModel> m_3gppModel; //!< The wrapped model, set by Generate
+  Ptr<ChannelConditionModel> m_conditionModel; //!< The channel condition model of the wrapped model
+  double m_xMin {0.0};                        //!< The X of the first point of the grid (attribute)
+  double m_xMax {0.0};                        //!< The maximum X of the grid (attribute)
+  double m_yMin {0.0};                        //!< The Y of the first point of the grid (attribute)
+  double m_yMax {0.0};                        //!< The maximum Y of the grid (attribute)
+  double m_resolution {10.0};                 //!< The distance between two points of the grid (attribute)
+  double m_height {1.5};                      //!< The height of the grid (attribute)
+  uint32_t m_numWorkers {1};                  //!< The number of threads of Generate (attribute)
+  uint32_t m_numX {0};                        //!< The number of points of the grid along X
+  uint32_t m_numY {0};                        //!< The number of points of the grid along Y
+  bool m_shadowing {false};                   //!< True if the wrapped model has shadowing
+  std::vector<Site> m_sites;                  //!< The sites
+  std::unordered_map<const MobilityModel *, uint32_t> m_siteIndex; //!< The index of each site
+  bool m_generated {false};                   //!< True once Generate has run
+  Ptr<NormalRandomVariable> m_normal;         //!< The shadowing fields
+  mutable uint64_t m_numMisses {0};           //!< Losses computed by the wrapped model
+};
+
+} // namespace ns3
+
+#endif // NR_PATHLOSS_MAP_PROPAGATION_LOSS_MODEL_H
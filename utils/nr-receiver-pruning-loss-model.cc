@@ -0,0 +1,172 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "nr-receiver-pruning-loss-model.h"
+#include <ns3/log.h>
+#include <ns3/double.h>
+#include <ns3/spectrum-channel.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrReceiverPruningLossModel");
+NS_OBJECT_ENSURE_REGISTERED (NrReceiverPruningLossModel);
+
+NrReceiverPruningLossModel::NrReceiverPruningLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrReceiverPruningLossModel::~NrReceiverPruningLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrReceiverPruningLossModel::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_gnbIndex.clear ();
+  m_ueIndex.clear ();
+  m_candidates.clear ();
+  m_intended = MakeNullCallback<bool, uint32_t, uint32_t> ();
+  PropagationLossModel::DoDispose ();
+}
+
+TypeId
+NrReceiverPruningLossModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrReceiverPruningLossModel")
+    .SetParent<PropagationLossModel> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrReceiverPruningLossModel> ()
+    ;
+  return tid;
+}
+
+void
+NrReceiverPruningLossModel::AddToChannel (const Ptr<SpectrumChannel> &channel)
+{
+  NS_LOG_FUNCTION (this << channel);
+
+  // At the end of the chain, where the mobility models are the ones given by
+  // the channel (a wrap-around model only wraps the models it contains)
+  Ptr<PropagationLossModel> last = channel->GetPropagationLossModel ();
+  if (last == nullptr)
+    {
+      channel->AddPropagationLossModel (this);
+    }
+  else
+    {
+      while (last->GetNext () != nullptr)
+        {
+          last = last->GetNext ();
+        }
+      last->SetNext (this);
+    }
+
+  DoubleValue maxLossDb;
+  channel->GetAttribute ("MaxLossDb", maxLossDb);
+  channel->SetAttribute ("MaxLossDb", DoubleValue (std::min (maxLossDb.Get (), m_pruningLossDb)));
+}
+
+void
+NrReceiverPruningLossModel::SetNodes (const std::vector<Ptr<MobilityModel>> &gnbs, const std::vector<Ptr<MobilityModel>> &ues)
+{
+  NS_LOG_FUNCTION (this << gnbs.size () << ues.size ());
+  m_gnbIndex.clear ();
+  m_ueIndex.clear ();
+  for (uint32_t g = 0; g < gnbs.size (); ++g)
+    {
+      m_gnbIndex.emplace (PeekPointer (gnbs[g]), g);
+    }
+  for (uint32_t u = 0; u < ues.size (); ++u)
+    {
+      m_ueIndex.emplace (PeekPointer (ues[u]), u);
+    }
+  m_candidates.assign (gnbs.size () * ues.size (), DOWNLINK | UPLINK);
+}
+
+void
+NrReceiverPruningLossModel::SetCandidate (uint32_t gnb, uint32_t ue, bool downlink, bool uplink)
+{
+  NS_ASSERT (gnb < m_gnbIndex.size () && ue < m_ueIndex.size ());
+  m_candidates[gnb * m_ueIndex.size () + ue] = (downlink ? DOWNLINK : 0) | (uplink ? UPLINK : 0);
+}
+
+void
+NrReceiverPruningLossModel::SetIntendedReceiverCallback (const Callback<bool, uint32_t, uint32_t> &cb)
+{
+  m_intended = cb;
+}
+
+void
+NrReceiverPruningLossModel::SetBypass (bool bypass)
+{
+  m_bypass = bypass;
+}
+
+uint64_t
+NrReceiverPruningLossModel::GetNumPruned () const
+{
+  return m_numPruned;
+}
+
+double
+NrReceiverPruningLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+  if (m_bypass)
+    {
+      return txPowerDbm;
+    }
+
+  // a is the transmitter and b the receiver
+  uint8_t direction = DOWNLINK;
+  auto gnbIt = m_gnbIndex.find (PeekPointer (a));
+  auto ueIt = m_ueIndex.find (PeekPointer (b));
+  if (gnbIt == m_gnbIndex.end () || ueIt == m_ueIndex.end ())
+    {
+      direction = UPLINK;
+      gnbIt = m_gnbIndex.find (PeekPointer (b));
+      ueIt = m_ueIndex.find (PeekPointer (a));
+      if (gnbIt == m_gnbIndex.end () || ueIt == m_ueIndex.end ())
+        {
+          return txPowerDbm;
+        }
+    }
+
+  if ((m_candidates[gnbIt->second * m_ueIndex.size () + ueIt->second] & direction) != 0
+      || (!m_intended.IsNull () && m_intended (gnbIt->second, ueIt->second)))
+    {
+      return txPowerDbm;
+    }
+
+  ++m_numPruned;
+  // As RangePropagationLossModel beyond its range: a loss that no real path
+  // loss reaches, over the MaxLossDb of the channel
+  return txPowerDbm - 1000.0;
+}
+
+int64_t
+NrReceiverPruningLossModel::DoAssignStreams ([[maybe_unused]] int64_t stream)
+{
+  return 0;
+}
+
+}  // namespace ns3
@@ -0,0 +1,134 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef NR_RECEIVER_PRUNING_LOSS_MODEL_H
+#define NR_RECEIVER_PRUNING_LOSS_MODEL_H
+
+#include <ns3/propagation-loss-model.h>
+#include <ns3/mobility-model.h>
+#include <ns3/callback.h>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+class SpectrumChannel;
+
+/**
+ * \ingroup nr-utils
+ * \brief A propagation loss model that makes the spectrum channel skip the
+ * receivers that are not candidates of a transmitter
+ *
+ * The spectrum channel computes the path loss of each receiver before the
+ * spectrum propagation loss (fast fading and beamforming gain), and does
+ * not deliver the signal to the receivers whose loss is higher than its
+ * attribute MaxLossDb. At the end of the propagation loss chain, this model
+ * adds a loss of 1000 dB between a gNB and a UE that are not candidates of
+ * each other in the direction of the transmission, unless the UE is
+ * attached to the gNB (the intended receiver). The other pairs of nodes
+ * (e.g., two UEs, or a node that is not set) are not changed.
+ *
+ * NrCouplingGainEngine, with its attribute ReceiverPruning, adds this model
+ * to the channel and sets the candidates at each of its updates.
+ */
+class NrReceiverPruningLossModel : public PropagationLossModel
+{
+public:
+  NrReceiverPruningLossModel ();
+  ~NrReceiverPruningLossModel () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Add the model at the end of the propagation loss chain of a
+   * channel, and lower the MaxLossDb of the channel under its loss
+   *
+   * The model is added after a wrap-around model, so that it sees the
+   * mobility models of the PHYs.
+   *
+   * \param channel the channel
+   */
+  void AddToChannel (const Ptr<SpectrumChannel> &channel);
+
+  /**
+   * \brief Set the nodes, by the mobility models of their PHYs: all the
+   * pairs are candidates until SetCandidate
+   * \param gnbs the mobility models of the gNBs
+   * \param ues the mobility models of the UEs
+   */
+  void SetNodes (const std::vector<Ptr<MobilityModel>> &gnbs, const std::vector<Ptr<MobilityModel>> &ues);
+
+  /**
+   * \brief Set whether a pair is a candidate in each direction
+   * \param gnb the index of the gNB
+   * \param ue the index of the UE
+   * \param downlink whether the UE is a candidate receiver of the gNB
+   * \param uplink whether the gNB is a candidate receiver of the UE
+   */
+  void SetCandidate (uint32_t gnb, uint32_t ue, bool downlink, bool uplink);
+
+  /**
+   * \brief Set the callback that tells whether a UE is attached to a gNB;
+   * it is called for the pairs that are not candidates
+   * \param cb the callback, with the index of the gNB and of the UE
+   */
+  void SetIntendedReceiverCallback (const Callback<bool, uint32_t, uint32_t> &cb);
+
+  /**
+   * \brief Do not prune any receiver, e.g. while the path losses of the
+   * candidates are computed through the chain
+   * \param bypass true to not prune
+   */
+  void SetBypass (bool bypass);
+
+  /**
+   * \return the number of receptions pruned so far
+   */
+  uint64_t GetNumPruned () const;
+
+protected:
+  void DoDispose () override;
+
+private:
+  double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const override;
+  int64_t DoAssignStreams (int64_t stream) override;
+
+  static const uint8_t DOWNLINK = 1; //!< Bit of the candidates in DL
+  static const uint8_t UPLINK = 2;   //!< Bit of the candidates in UL
+
+  /**
+   * The MaxLossDb set by AddToChannel, under the 1000 dB loss of the pruned
+   * receivers
+   */
+  const double m_pruningLossDb {999.0};
+  std::unordered_map<const MobilityModel *, uint32_t> m_gnbIndex; //!< The index of each gNB
+  std::unordered_map<const MobilityModel *, uint32_t> m_ueIndex;  //!< The index of each UE
+  std::vector<uint8_t> m_candidates;    //!< DOWNLINK and UPLINK bits, at gNB index * UEs + UE index
+  Callback<bool, uint32_t, uint32_t> m_intended; //!< Whether a UE is attached to a gNB
+  bool m_bypass {false};                //!< Do not prune
+  mutable uint64_t m_numPruned {0};     //!< Receptions pruned
+};
+
+} // namespace ns3
+
+#endif // NR_RECEIVER_PRUNING_LOSS_MODEL_H
@@ -0,0 +1,160 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-replay-channel-model.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/string.h>
+#include <ns3/simulator.h>
+#include <ns3/node.h>
+#include <ns3/mobility-model.h>
+#include <ns3/phased-array-model.h>
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrReplayChannelModel");
+
+NS_OBJECT_ENSURE_REGISTERED (NrReplayChannelModel);
+
+NrReplayChannelModel::NrReplayChannelModel () : ThreeGppChannelModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrReplayChannelModel::~NrReplayChannelModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TypeId
+NrReplayChannelModel::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::NrReplayChannelModel")
+    .SetGroupName ("Spectrum")
+    .SetParent<ThreeGppChannelModel> ()
+    .AddConstructor<NrReplayChannelModel> ()
+    .AddAttribute ("FileName",
+                   "The channel recording written by ThreeGppChannelModelParam.",
+                   StringValue (""),
+                   MakeStringAccessor (&NrReplayChannelModel::m_fileName),
+                   MakeStringChecker ())
+  ;
+  return tid;
+}
+
+void
+NrReplayChannelModel::DoDispose ()
+{
+  m_links.clear ();
+  m_nodeLinks.clear ();
+  m_recording = nullptr;
+  ThreeGppChannelModel::DoDispose ();
+}
+
+void
+NrReplayChannelModel::Load ()
+{
+  NS_LOG_FUNCTION (this << m_fileName);
+
+  m_recording = Create<NrChannelRecording> ();
+  NS_ABORT_MSG_IF (!m_recording->Open (m_fileName), "Could not open the channel recording " << m_fileName);
+  NS_ABORT_MSG_IF (std::abs (m_recording->GetFrequency () - GetFrequency ()) > 1e-3,
+                   "The channel recording " << m_fileName << " is at " << m_recording->GetFrequency ()
+                                            << " Hz, and the channel model at " << GetFrequency () << " Hz");
+
+  for (uint32_t record = 0; record < m_recording->GetNumRecords (); ++record)
+    {
+      std::pair<uint32_t, uint32_t> antennas = m_recording->GetAntennaPair (record);
+      Link &link = m_links[GetKey (antennas.first, antennas.second)];
+      Time time = m_recording->GetGeneratedTime (record);
+      // a pair is recorded in time order, but keep it sorted anyway
+      auto it = std::upper_bound (link.m_times.begin (), link.m_times.end (), time);
+      link.m_records.insert (link.m_records.begin () + (it - link.m_times.begin ()), record);
+      link.m_times.insert (it, time);
+    }
+  NS_LOG_INFO ("Replaying " << m_links.size () << " links from " << m_fileName);
+}
+
+Ptr<const MatrixBasedChannelModel::ChannelMatrix>
+NrReplayChannelModel::GetChannel (Ptr<const MobilityModel> aMob,
+                                  Ptr<const MobilityModel> bMob,
+                                  Ptr<const PhasedArrayModel> aAntenna,
+                                  Ptr<const PhasedArrayModel> bAntenna)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_recording == nullptr)
+    {
+      Load ();
+    }
+
+  auto it = m_links.find (GetKey (aAntenna->GetId (), bAntenna->GetId ()));
+  if (it == m_links.end ())
+    {
+      ++m_numMisses;
+      NS_LOG_WARN ("The antennas " << aAntenna->GetId () << " and " << bAntenna->GetId ()
+                                   << " are not in the recording: generating their channel");
+      return ThreeGppChannelModel::GetChannel (aMob, bMob, aAntenna, bAntenna);
+    }
+
+  // the last record generated at or before now, or the first one
+  Link &link = it->second;
+  auto next = std::upper_bound (link.m_times.begin (), link.m_times.end (), Simulator::Now ());
+  uint32_t current = next == link.m_times.begin () ? 0 : static_cast<uint32_t> (next - link.m_times.begin () - 1);
+  if (link.m_channel == nullptr || link.m_current != current)
+    {
+      uint32_t record = link.m_records[current];
+      Ptr<ChannelMatrix> channelMatrix = m_recording->GetChannelMatrix (record);
+      bool aIsS = channelMatrix->m_antennaPair.first == aAntenna->GetId ();
+      Ptr<const PhasedArrayModel> sAntenna = aIsS ? aAntenna : bAntenna;
+      Ptr<const PhasedArrayModel> uAntenna = aIsS ? bAntenna : aAntenna;
+      NS_ABORT_MSG_IF (channelMatrix->m_channel.size () != uAntenna->GetNumberOfElements ()
+                       || channelMatrix->m_channel.at (0).size () != sAntenna->GetNumberOfElements (),
+                       "The antennas " << aAntenna->GetId () << " and " << bAntenna->GetId ()
+                                       << " do not have the size they have in the recording");
+      link.m_channel = channelMatrix;
+      link.m_params = m_recording->GetChannelParams (record);
+      link.m_current = current;
+    }
+  m_nodeLinks[GetKey (aMob->GetObject<Node> ()->GetId (), bMob->GetObject<Node> ()->GetId ())] = it->first;
+  return link.m_channel;
+}
+
+Ptr<const MatrixBasedChannelModel::ChannelParams>
+NrReplayChannelModel::GetParams (Ptr<const MobilityModel> aMob,
+                                 Ptr<const MobilityModel> bMob) const
+{
+  NS_LOG_FUNCTION (this);
+
+  auto it = m_nodeLinks.find (GetKey (aMob->GetObject<Node> ()->GetId (), bMob->GetObject<Node> ()->GetId ()));
+  if (it == m_nodeLinks.end ())
+    {
+      return ThreeGppChannelModel::GetParams (aMob, bMob);
+    }
+  return m_links.at (it->second).m_params;
+}
+
+uint64_t
+NrReplayChannelModel::GetNumMisses () const
+{
+  return m_numMisses;
+}
+
+} // namespace ns3
@@ -0,0 +1,125 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_REPLAY_CHANNEL_MODEL_H
+#define NR_REPLAY_CHANNEL_MODEL_H
+
+#include <ns3/three-gpp-channel-model.h>
+#include <ns3/nr-channel-recording.h>
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup nr-utils
+ * \brief A channel model that serves the channel matrices recorded by
+ * ThreeGppChannelModelParam, instead of generating them
+ *
+ * Record a simulation with the attribute RecordFileName of
+ * ThreeGppChannelModelParam (set ThreeGppSpectrumPropagationLossModel::ChannelModel
+ * to it), then set FileName to the recording in the variants of the
+ * simulation: they see the same channels, and skip their generation. For
+ * each pair of antennas, GetChannel returns the last matrix recorded at or
+ * before the current time (the first one before it was recorded), so the
+ * matrices change at the same times as in the recorded simulation. The file
+ * is mapped in memory, and shared by the simulations that replay it.
+ *
+ * The recording identifies the links by the ids of the nodes and antennas,
+ * so the variants must create them in the same order. The pairs of antennas
+ * that are not in the recording are generated by ThreeGppChannelModel (see
+ * GetNumMisses). Only the channel matrices are recorded: the path loss, the
+ * shadowing and the channel condition are not, and only the delays and the
+ * angles of the clusters of the channel parameters are replayed, which is
+ * what CachedThreeGppSpectrumPropagationLossModel needs without vScatt.
+ */
+class NrReplayChannelModel : public ThreeGppChannelModel
+{
+public:
+  NrReplayChannelModel ();
+  ~NrReplayChannelModel () override;
+
+  /**
+   * \brief Get the type ID
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId ();
+
+  /**
+   * \brief Get the recorded channel matrix of two antennas at the current
+   * time, or generate it if it is not in the recording
+   *
+   * \param aMob mobility model of the a device
+   * \param bMob mobility model of the b device
+   * \param aAntenna antenna of the a device
+   * \param bAntenna antenna of the b device
+   * \return the channel matrix
+   */
+  Ptr<const ChannelMatrix> GetChannel (Ptr<const MobilityModel> aMob,
+                                       Ptr<const MobilityModel> bMob,
+                                       Ptr<const PhasedArrayModel> aAntenna,
+                                       Ptr<const PhasedArrayModel> bAntenna) override;
+
+  /**
+   * \brief Get the parameters of the last channel matrix returned for two
+   * nodes
+   *
+   * \param aMob mobility model of the a device
+   * \param bMob mobility model of the b device
+   * \return the channel parameters
+   */
+  Ptr<const ChannelParams> GetParams (Ptr<const MobilityModel> aMob,
+                                      Ptr<const MobilityModel> bMob) const override;
+
+  /**
+   * \return the number of requests that were not in the recording
+   */
+  uint64_t GetNumMisses () const;
+
+protected:
+  void DoDispose () override;
+
+private:
+  /**
+   * \brief The recorded matrices of a pair of antennas
+   */
+  struct Link
+  {
+    std::vector<uint32_t> m_records;          //!< The records, in the order of their generation time
+    std::vector<Time> m_times;                //!< The generation time of each record
+    uint32_t m_current {0};                   //!< The index of the record of m_channel
+    Ptr<const ChannelMatrix> m_channel;       //!< The last matrix returned, or nullptr
+    Ptr<const ChannelParams> m_params;        //!< The parameters of m_channel
+  };
+
+  /**
+   * \brief Open the recording, and index its records by pair of antennas
+   */
+  void Load ();
+
+  std::string m_fileName;                     //!< The recording (attribute)
+  Ptr<NrChannelRecording> m_recording;        //!< The recording, opened at the first request
+  std::unordered_map<uint64_t, Link> m_links; //!< The recorded links, by pair of antennas
+  std::unordered_map<uint64_t, uint64_t> m_nodeLinks; //!< The last link returned, by pair of nodes
+  uint64_t m_numMisses {0};                   //!< The requests that were not in the recording
+};
+
+} // namespace ns3
+
+#endif // NR_REPLAY_CHANNEL_MODEL_H
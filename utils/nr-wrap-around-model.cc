@@ -0,0 +1,285 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "nr-wrap-around-model.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/node.h>
+#include <ns3/pointer.h>
+#include <ns3/constant-position-mobility-model.h>
+#include "nr-pathloss-map-propagation-loss-model.h"
+#include <cmath>
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("NrWrapAroundModel");
+NS_OBJECT_ENSURE_REGISTERED (NrWrapAroundModel);
+NS_OBJECT_ENSURE_REGISTERED (NrWrapAroundPropagationLossModel);
+
+NrWrapAroundModel::NrWrapAroundModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrWrapAroundModel::~NrWrapAroundModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrWrapAroundModel::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_images.clear ();
+  m_imageNodes = NodeContainer ();
+  Object::DoDispose ();
+}
+
+TypeId
+NrWrapAroundModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrWrapAroundModel")
+    .SetParent<Object> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrWrapAroundModel> ()
+    ;
+  return tid;
+}
+
+void
+NrWrapAroundModel::SetCluster (double isd, uint32_t numSites)
+{
+  NS_LOG_FUNCTION (this << isd << numSites);
+  NS_ABORT_MSG_IF (isd <= 0, "The inter-site distance must be positive");
+
+  // A cluster of N = i^2 + ij + j^2 sites tiles the plane with the
+  // translations i * e1 + j * e2 of the lattice of the sites, and their
+  // rotations by multiples of 60 degrees
+  uint32_t i = 0;
+  uint32_t j = 0;
+  switch (numSites)
+    {
+    case 7:
+      i = 2;
+      j = 1;
+      break;
+    case 19:
+      i = 3;
+      j = 2;
+      break;
+    default:
+      NS_ABORT_MSG ("Wrap-around is only supported for clusters of 7 or 19 sites, not " << numSites);
+    }
+
+  const double e1Angle = M_PI / 6;
+  const double e2Angle = M_PI / 2;
+  double x = isd * (i * std::cos (e1Angle) + j * std::cos (e2Angle));
+  double y = isd * (i * std::sin (e1Angle) + j * std::sin (e2Angle));
+
+  m_offsets.clear ();
+  for (uint32_t k = 0; k < 6; ++k)
+    {
+      double rotation = k * M_PI / 3;
+      m_offsets.emplace_back (x * std::cos (rotation) - y * std::sin (rotation),
+                              x * std::sin (rotation) + y * std::cos (rotation),
+                              0.0);
+    }
+}
+
+const std::vector<Vector> &
+NrWrapAroundModel::GetImageOffsets () const
+{
+  return m_offsets;
+}
+
+void
+NrWrapAroundModel::Install (const NodeContainer &sites)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (m_offsets.empty (), "SetCluster must be called before Install");
+
+  for (auto it = sites.Begin (); it != sites.End (); ++it)
+    {
+      Ptr<MobilityModel> site = (*it)->GetObject<MobilityModel> ();
+      NS_ABORT_MSG_IF (site == nullptr, "Node " << (*it)->GetId () << " has no mobility model");
+      Images &images = m_images[PeekPointer (site)];
+      images[0] = site;
+      for (uint32_t k = 0; k < m_offsets.size (); ++k)
+        {
+          Ptr<Node> node = CreateObject<Node> ();
+          Ptr<MobilityModel> image = CreateObject<ConstantPositionMobilityModel> ();
+          image->SetPosition (site->GetPosition () + m_offsets[k]);
+          node->AggregateObject (image);
+          m_imageNodes.Add (node);
+          images[k + 1] = image;
+        }
+    }
+}
+
+NodeContainer
+NrWrapAroundModel::GetImageNodes () const
+{
+  return m_imageNodes;
+}
+
+Ptr<MobilityModel>
+NrWrapAroundModel::GetNearestImage (const MobilityModel *site, const Vector &position) const
+{
+  auto it = m_images.find (site);
+  if (it == m_images.end ())
+    {
+      return nullptr;
+    }
+
+  Ptr<MobilityModel> nearest;
+  double nearestDistance = std::numeric_limits<double>::max ();
+  for (const Ptr<MobilityModel> &image : it->second)
+    {
+      Vector p = image->GetPosition ();
+      double distance = (p.x - position.x) * (p.x - position.x) + (p.y - position.y) * (p.y - position.y);
+      if (distance < nearestDistance)
+        {
+          nearest = image;
+          nearestDistance = distance;
+        }
+    }
+  return nearest;
+}
+
+void
+NrWrapAroundModel::Wrap (Ptr<const MobilityModel> *a, Ptr<const MobilityModel> *b) const
+{
+  Ptr<MobilityModel> image = GetNearestImage (PeekPointer (*a), (*b)->GetPosition ());
+  if (image != nullptr)
+    {
+      *a = image;
+      return;
+    }
+  image = GetNearestImage (PeekPointer (*b), (*a)->GetPosition ());
+  if (image != nullptr)
+    {
+      *b = image;
+    }
+}
+
+NrWrapAroundPropagationLossModel::NrWrapAroundPropagationLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+NrWrapAroundPropagationLossModel::~NrWrapAroundPropagationLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+NrWrapAroundPropagationLossModel::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_model = nullptr;
+  m_wrapAround = nullptr;
+  PropagationLossModel::DoDispose ();
+}
+
+TypeId
+NrWrapAroundPropagationLossModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::NrWrapAroundPropagationLossModel")
+    .SetParent<PropagationLossModel> ()
+    .SetGroupName ("Nr")
+    .AddConstructor<NrWrapAroundPropagationLossModel> ()
+    .AddAttribute ("PropagationLossModel",
+                   "The model whose loss is computed between the wrapped positions",
+                   PointerValue (),
+                   MakePointerAccessor (&NrWrapAroundPropagationLossModel::SetPropagationLossModel,
+                                        &NrWrapAroundPropagationLossModel::GetPropagationLossModel),
+                   MakePointerChecker<PropagationLossModel> ())
+    .AddAttribute ("WrapAroundModel",
+                   "The wrap-around model",
+                   PointerValue (),
+                   MakePointerAccessor (&NrWrapAroundPropagationLossModel::m_wrapAround),
+                   MakePointerChecker<NrWrapAroundModel> ())
+    ;
+  return tid;
+}
+
+void
+NrWrapAroundPropagationLossModel::SetPropagationLossModel (const Ptr<PropagationLossModel> &model)
+{
+  NS_LOG_FUNCTION (this << model);
+  m_model = model;
+}
+
+Ptr<PropagationLossModel>
+NrWrapAroundPropagationLossModel::GetPropagationLossModel () const
+{
+  return m_model;
+}
+
+void
+NrWrapAroundPropagationLossModel::SetWrapAroundModel (const Ptr<NrWrapAroundModel> &model)
+{
+  NS_LOG_FUNCTION (this << model);
+  m_wrapAround = model;
+}
+
+Ptr<PropagationLossModel>
+NrWrapAroundPropagationLossModel::Unwrap (const Ptr<PropagationLossModel> &model)
+{
+  Ptr<NrWrapAroundPropagationLossModel> wrapper = DynamicCast<NrWrapAroundPropagationLossModel> (model);
+  if (wrapper != nullptr)
+    {
+      return wrapper->GetPropagationLossModel ();
+    }
+  Ptr<NrPathlossMapPropagationLossModel> maps = DynamicCast<NrPathlossMapPropagationLossModel> (model);
+  return maps != nullptr ? maps->GetPropagationLossModel () : model;
+}
+
+double
+NrWrapAroundPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a,
+                                                 Ptr<MobilityModel> b) const
+{
+  NS_ASSERT (m_model != nullptr);
+  if (m_wrapAround != nullptr)
+    {
+      Ptr<MobilityModel> image = m_wrapAround->GetNearestImage (PeekPointer (a), b->GetPosition ());
+      if (image != nullptr)
+        {
+          a = image;
+        }
+      else
+        {
+          image = m_wrapAround->GetNearestImage (PeekPointer (b), a->GetPosition ());
+          if (image != nullptr)
+            {
+              b = image;
+            }
+        }
+    }
+  return m_model->CalcRxPower (txPowerDbm, a, b);
+}
+
+int64_t
+NrWrapAroundPropagationLossModel::DoAssignStreams ([[maybe_unused]] int64_t stream)
+{
+  // The streams of the wrapped model are assigned through it (see NrHelper)
+  return 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,197 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef NR_WRAP_AROUND_MODEL_H
+#define NR_WRAP_AROUND_MODEL_H
+
+#include <ns3/object.h>
+#include <ns3/vector.h>
+#include <ns3/mobility-model.h>
+#include <ns3/node-container.h>
+#include <ns3/propagation-loss-model.h>
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup nr-utils
+ * \brief Wrap-around of a hexagonal cluster of sites, as in 3GPP TR 38.901
+ * and ITU-R M.2412
+ *
+ * The cluster (7 or 19 sites) is repeated in the six directions around it,
+ * and the link between a site and any other node uses the image of the site
+ * (the site itself or one of its six copies) that is the nearest to the
+ * node. The cells at the edge of the cluster are then surrounded by
+ * interferers as the central one, and the statistics of all the cells are
+ * those of an infinite deployment.
+ *
+ * Install creates, for each site, six nodes with a ConstantPositionMobilityModel
+ * at the positions of its copies. They have no device: they only give the
+ * channel models (which keep their state per pair of nodes) a different
+ * mobility model, and node, for each copy. The sites must not move.
+ *
+ * The propagation models see the wrapped positions through Wrap: the path
+ * loss and channel condition through NrWrapAroundPropagationLossModel, and
+ * the 3GPP channel through the WrapAroundModel attribute of
+ * CachedThreeGppSpectrumPropagationLossModel. NrHelper::SetWrapAroundModel
+ * sets both, and HexagonalGridScenarioHelper::GetWrapAroundModel gives the
+ * model of its deployment.
+ *
+ * The links that do not involve a site (e.g. between two UEs) are not
+ * wrapped. The MobilityBuildingInfo of the sites is not copied, so the
+ * models based on buildings are not supported.
+ */
+class NrWrapAroundModel : public Object
+{
+public:
+  NrWrapAroundModel ();
+  ~NrWrapAroundModel () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Set the geometry of the cluster
+   *
+   * The sites are on a hexagonal lattice of the given inter-site distance,
+   * with the first ring of sites at 30, 90, ... 330 degrees from the center,
+   * as in HexagonalGridScenarioHelper.
+   *
+   * \param isd the inter-site distance (m)
+   * \param numSites the number of sites of the cluster, 7 or 19
+   */
+  void SetCluster (double isd, uint32_t numSites);
+
+  /**
+   * \return the translations from the cluster to its six copies
+   */
+  const std::vector<Vector> & GetImageOffsets () const;
+
+  /**
+   * \brief Create the copies of some sites
+   *
+   * SetCluster must be called before.
+   *
+   * \param sites the nodes of the sites, with their mobility models
+   */
+  void Install (const NodeContainer &sites);
+
+  /**
+   * \return the nodes created for the copies of the sites
+   */
+  NodeContainer GetImageNodes () const;
+
+  /**
+   * \brief Get the image of a site nearest to a position
+   * \param site the mobility model of a site
+   * \param position the position of the other end of the link
+   * \return the mobility model of the image (site itself, or a copy), or
+   * nullptr if site is not a site of this model
+   */
+  Ptr<MobilityModel> GetNearestImage (const MobilityModel *site, const Vector &position) const;
+
+  /**
+   * \brief Replace the site of a link by its image nearest to the other end
+   *
+   * If both ends are sites, a is replaced.
+   *
+   * \param a the first end of the link
+   * \param b the second end of the link
+   */
+  void Wrap (Ptr<const MobilityModel> *a, Ptr<const MobilityModel> *b) const;
+
+protected:
+  void DoDispose () override;
+
+private:
+  /**
+   * \brief The mobility models of the copies of a site, the site itself first
+   */
+  typedef std::array<Ptr<MobilityModel>, 7> Images;
+
+  std::vector<Vector> m_offsets;  //!< Translations from the cluster to its copies
+  std::unordered_map<const MobilityModel *, Images> m_images; //!< The images of each site
+  NodeContainer m_imageNodes;     //!< The nodes of the copies
+};
+
+/**
+ * \ingroup nr-utils
+ * \brief A propagation loss model that computes the loss of another one
+ * between the wrapped positions of the two nodes
+ *
+ * NrHelper adds it to the spectrum channels, in front of the 3GPP path loss
+ * model of the BWP, when a wrap-around model is set. The models chained
+ * after the wrapped model (e.g. the cull of
+ * DistanceBasedThreeGppSpectrumPropagationLossModel) see the wrapped
+ * positions as well; the models chained after this one do not.
+ */
+class NrWrapAroundPropagationLossModel : public PropagationLossModel
+{
+public:
+  NrWrapAroundPropagationLossModel ();
+  ~NrWrapAroundPropagationLossModel () override;
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  /**
+   * \brief Set the model whose loss is computed between the wrapped positions
+   * \param model the model
+   */
+  void SetPropagationLossModel (const Ptr<PropagationLossModel> &model);
+
+  /**
+   * \return the model whose loss is computed between the wrapped positions
+   */
+  Ptr<PropagationLossModel> GetPropagationLossModel () const;
+
+  /**
+   * \brief Set the wrap-around model
+   * \param model the wrap-around model
+   */
+  void SetWrapAroundModel (const Ptr<NrWrapAroundModel> &model);
+
+  /**
+   * \param model a propagation loss model
+   * \return the model wrapped by model, if it is a NrWrapAroundPropagationLossModel
+   * or a NrPathlossMapPropagationLossModel, or model
+   */
+  static Ptr<PropagationLossModel> Unwrap (const Ptr<PropagationLossModel> &model);
+
+protected:
+  void DoDispose () override;
+
+private:
+  double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const override;
+  int64_t DoAssignStreams (int64_t stream) override;
+
+  Ptr<PropagationLossModel> m_model;      //!< The wrapped model
+  Ptr<NrWrapAroundModel> m_wrapAround;    //!< The wrap-around model
+};
+
+} // namespace ns3
+
+#endif // NR_WRAP_AROUND_MODEL_H
@@ -0,0 +1,398 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ray-tracing-spectrum-propagation-loss-model.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/string.h"
+#include "ns3/enum.h"
+#include "ns3/mobility-model.h"
+#include "ns3/angles.h"
+#include "ns3/nr-perf-profiler.h"
+#include "ns3/nr-counters.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RayTracingSpectrumPropagationLossModel");
+NS_OBJECT_ENSURE_REGISTERED (RayTracingSpectrumPropagationLossModel);
+
+RayTracingSpectrumPropagationLossModel::RayTracingSpectrumPropagationLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+RayTracingSpectrumPropagationLossModel::~RayTracingSpectrumPropagationLossModel ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+RayTracingSpectrumPropagationLossModel::DoDispose ()
+{
+  NS_LOG_FUNCTION (this);
+  m_trace = nullptr;
+  PhasedArraySpectrumPropagationLossModel::DoDispose ();
+}
+
+TypeId
+RayTracingSpectrumPropagationLossModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RayTracingSpectrumPropagationLossModel")
+    .SetParent<PhasedArraySpectrumPropagationLossModel> ()
+    .SetGroupName ("Spectrum")
+    .AddConstructor<RayTracingSpectrumPropagationLossModel> ()
+    .AddAttribute ("CacheDirectory",
+                   "The directory where the text traces are converted to the binary "
+                   "format. If empty, the temporary directory of the system (TMPDIR, TMP "
+                   "or TEMP, otherwise /tmp). It must be set before TraceFile.",
+                   StringValue (""),
+                   MakeStringAccessor (&RayTracingSpectrumPropagationLossModel::m_cacheDirectory),
+                   MakeStringChecker ())
+    .AddAttribute ("TraceFile",
+                   "The ray-tracing trace, in binary format, or in the text format of "
+                   "model/Raytracing (then converted, once, to a binary file in "
+                   "CacheDirectory, or parsed in memory if that file cannot be written).",
+                   StringValue (""),
+                   MakeStringAccessor (&RayTracingSpectrumPropagationLossModel::SetTraceFile,
+                                       &RayTracingSpectrumPropagationLossModel::GetTraceFile),
+                   MakeStringChecker ())
+    .AddAttribute ("RouteStart",
+                   "The position of the receiver at the first trace sample.",
+                   VectorValue (Vector (0, 0, 0)),
+                   MakeVectorAccessor (&RayTracingSpectrumPropagationLossModel::SetRouteStart,
+                                       &RayTracingSpectrumPropagationLossModel::GetRouteStart),
+                   MakeVectorChecker ())
+    .AddAttribute ("RouteEnd",
+                   "The position of the receiver at the last trace sample. The samples are "
+                   "evenly spaced between RouteStart and RouteEnd.",
+                   VectorValue (Vector (0, 0, 0)),
+                   MakeVectorAccessor (&RayTracingSpectrumPropagationLossModel::SetRouteEnd,
+                                       &RayTracingSpectrumPropagationLossModel::GetRouteEnd),
+                   MakeVectorChecker ())
+    .AddAttribute ("Interpolation",
+                   "How the trace samples are used between positions: Nearest uses the "
+                   "nearest sample, Linear interpolates the received PSD of the two nearest "
+                   "samples.",
+                   EnumValue (RayTracingSpectrumPropagationLossModel::NEAREST),
+                   MakeEnumAccessor (&RayTracingSpectrumPropagationLossModel::SetInterpolation,
+                                     &RayTracingSpectrumPropagationLossModel::GetInterpolation),
+                   MakeEnumChecker (RayTracingSpectrumPropagationLossModel::NEAREST, "Nearest",
+                                    RayTracingSpectrumPropagationLossModel::LINEAR, "Linear"))
+    ;
+  return tid;
+}
+
+void
+RayTracingSpectrumPropagationLossModel::SetTraceFile (const std::string &fileName)
+{
+  NS_LOG_FUNCTION (this << fileName);
+  m_traceFile = fileName;
+  if (fileName.empty ())
+    {
+      m_trace = nullptr;
+      return;
+    }
+
+  Ptr<RayTracingTrace> trace = Create<RayTracingTrace> ();
+  const std::string textSuffix = ".txt";
+  if (fileName.size () > textSuffix.size ()
+      && fileName.compare (fileName.size () - textSuffix.size (), textSuffix.size (), textSuffix) == 0)
+    {
+      std::string binaryFile = GetCacheFile (fileName);
+      bool cached = std::ifstream (binaryFile.c_str ()).good ();
+      if (!cached)
+        {
+          // Written under another name and then renamed, so that the
+          // processes that use the same cache never map a partial file
+          std::string tmpFile = binaryFile + "." + std::to_string (std::random_device () ());
+          NS_LOG_INFO ("Converting " << fileName << " to " << binaryFile);
+          cached = RayTracingTrace::ConvertTextToBinary (fileName, tmpFile)
+            && std::rename (tmpFile.c_str (), binaryFile.c_str ()) == 0;
+          std::remove (tmpFile.c_str ());
+        }
+      if (!cached || !trace->Open (binaryFile))
+        {
+          // The cache directory may be missing or read-only, or the file may
+          // not be a valid trace: the text is parsed again, in memory
+          NS_LOG_WARN ("Could not use " << binaryFile << ", reading " << fileName << " in memory");
+          NS_ABORT_MSG_IF (!trace->OpenText (fileName),
+                           "Could not read the ray-tracing trace " << fileName);
+        }
+    }
+  else
+    {
+      NS_ABORT_MSG_IF (!trace->Open (fileName), "Could not open the ray-tracing trace " << fileName);
+    }
+  NS_ABORT_MSG_IF (trace->GetNumSamples () == 0, "The ray-tracing trace " << fileName << " is empty");
+  m_trace = trace;
+}
+
+std::string
+RayTracingSpectrumPropagationLossModel::GetCacheFile (const std::string &fileName) const
+{
+  std::string dir = m_cacheDirectory;
+  for (const char *var : {"TMPDIR", "TMP", "TEMP"})
+    {
+      const char *value = std::getenv (var);
+      if (dir.empty () && value != nullptr)
+        {
+          dir = value;
+        }
+    }
+  if (dir.empty ())
+    {
+      dir = "/tmp";
+    }
+
+  std::ifstream in (fileName.c_str (), std::ios::in | std::ios::binary | std::ios::ate);
+  std::ostringstream key;
+  key << fileName << ":" << static_cast<int64_t> (in.tellg ());
+
+  std::string name = fileName.substr (fileName.find_last_of ("/\\") + 1);
+  std::ostringstream cacheFile;
+  cacheFile << dir << "/" << name << "." << std::hex << std::hash<std::string> () (key.str ())
+            << ".bin";
+  return cacheFile.str ();
+}
+
+std::string
+RayTracingSpectrumPropagationLossModel::GetTraceFile () const
+{
+  return m_traceFile;
+}
+
+void
+RayTracingSpectrumPropagationLossModel::SetTrace (Ptr<const RayTracingTrace> trace)
+{
+  NS_ABORT_MSG_IF (trace == nullptr || !trace->IsOpen (), "The ray-tracing trace is not open");
+  NS_ABORT_MSG_IF (trace->GetNumSamples () == 0, "The ray-tracing trace is empty");
+  m_trace = trace;
+}
+
+void
+RayTracingSpectrumPropagationLossModel::SetRouteStart (const Vector &start)
+{
+  m_routeStart = start;
+}
+
+Vector
+RayTracingSpectrumPropagationLossModel::GetRouteStart () const
+{
+  return m_routeStart;
+}
+
+void
+RayTracingSpectrumPropagationLossModel::SetRouteEnd (const Vector &end)
+{
+  m_routeEnd = end;
+}
+
+Vector
+RayTracingSpectrumPropagationLossModel::GetRouteEnd () const
+{
+  return m_routeEnd;
+}
+
+void
+RayTracingSpectrumPropagationLossModel::SetInterpolation (enum Interpolation interpolation)
+{
+  m_interpolation = interpolation;
+}
+
+RayTracingSpectrumPropagationLossModel::Interpolation
+RayTracingSpectrumPropagationLossModel::GetInterpolation () const
+{
+  return m_interpolation;
+}
+
+/**
+ * \brief Position of the projection of a point on a segment
+ * \param position the point
+ * \param start the start of the segment
+ * \param end the end of the segment
+ * \return the position of the projection, from 0 (start) to 1 (end)
+ */
+static double
+ProjectOnSegment (const Vector &position, const Vector &start, const Vector &end)
+{
+  Vector route = end - start;
+  double length2 = route.x * route.x + route.y * route.y + route.z * route.z;
+  if (length2 == 0)
+    {
+      return 0;
+    }
+  Vector p = position - start;
+  double t = (p.x * route.x + p.y * route.y + p.z * route.z) / length2;
+  return std::min (1.0, std::max (0.0, t));
+}
+
+double
+RayTracingSpectrumPropagationLossModel::GetSampleIndex (const Vector &position) const
+{
+  NS_ASSERT_MSG (m_trace, "No ray-tracing trace");
+  return ProjectOnSegment (position, m_routeStart, m_routeEnd) * (m_trace->GetNumSamples () - 1);
+}
+
+double
+RayTracingSpectrumPropagationLossModel::GetDistanceToRoute (const Vector &position) const
+{
+  double t = ProjectOnSegment (position, m_routeStart, m_routeEnd);
+  Vector route = m_routeEnd - m_routeStart;
+  Vector projection (m_routeStart.x + t * route.x,
+                     m_routeStart.y + t * route.y,
+                     m_routeStart.z + t * route.z);
+  return CalculateDistance (position, projection);
+}
+
+/**
+ * \brief Array factor of an antenna array in a direction
+ * \param array the antenna array
+ * \param azimuth the azimuth of the direction (rad)
+ * \param inclination the inclination of the direction (rad)
+ * \return the array factor, for the theta and phi polarizations
+ */
+static std::pair<std::complex<double>, std::complex<double> >
+GetArrayFactor (Ptr<const PhasedArrayModel> array, double azimuth, double inclination)
+{
+  PhasedArrayModel::ComplexVector w = array->GetBeamformingVector ();
+  NS_ASSERT_MSG (w.size () == array->GetNumberOfElements (), "Beamforming vector not configured");
+
+  double fieldPhi, fieldTheta;
+  std::tie (fieldPhi, fieldTheta) = array->GetElementFieldPattern (Angles (azimuth, inclination));
+
+  double dx = std::sin (inclination) * std::cos (azimuth);
+  double dy = std::sin (inclination) * std::sin (azimuth);
+  double dz = std::cos (inclination);
+  std::complex<double> sum (0, 0);
+  for (size_t k = 0; k < w.size (); ++k)
+    {
+      Vector loc = array->GetElementLocation (k);
+      double phase = 2 * M_PI * (dx * loc.x + dy * loc.y + dz * loc.z);
+      sum += w[k] * std::polar (1.0, phase);
+    }
+  return std::make_pair (sum * fieldTheta, sum * fieldPhi);
+}
+
+void
+RayTracingSpectrumPropagationLossModel::CalcBandGains (Ptr<const SpectrumValue> txPsd,
+                                                       uint32_t sample,
+                                                       Ptr<const PhasedArrayModel> txArray,
+                                                       Ptr<const PhasedArrayModel> rxArray,
+                                                       bool reverse,
+                                                       std::vector<double> *gains) const
+{
+  const RayTracingPath *paths = m_trace->GetPaths (sample);
+  uint32_t numPaths = m_trace->GetNumPaths (sample);
+
+  // Complex amplitude of each path (delay excluded), including the array
+  // factors of both ends
+  std::vector<std::complex<double> > amplitudes (numPaths);
+  for (uint32_t p = 0; p < numPaths; ++p)
+    {
+      const RayTracingPath &path = paths[p];
+      // The traces give elevations; the arrays use inclinations
+      double depAzimuth = DegreesToRadians (reverse ? path.m_aoaAzimuth : path.m_aodAzimuth);
+      double depInclination = DegreesToRadians (90 - (reverse ? path.m_aoaElevation : path.m_aodElevation));
+      double arrAzimuth = DegreesToRadians (reverse ? path.m_aodAzimuth : path.m_aoaAzimuth);
+      double arrInclination = DegreesToRadians (90 - (reverse ? path.m_aodElevation : path.m_aoaElevation));
+
+      auto txFactor = GetArrayFactor (txArray, depAzimuth, depInclination);
+      auto rxFactor = GetArrayFactor (rxArray, arrAzimuth, arrInclination);
+
+      double gain = std::pow (10.0, path.m_pathGainDb / 20.0);
+      amplitudes[p] = std::polar (gain, path.m_phase) *
+        (txFactor.first * rxFactor.first + txFactor.second * rxFactor.second);
+    }
+
+  gains->resize (txPsd->GetSpectrumModel ()->GetNumBands ());
+  size_t band = 0;
+  for (auto it = txPsd->ConstBandsBegin (); it != txPsd->ConstBandsEnd (); ++it, ++band)
+    {
+      std::complex<double> h (0, 0);
+      for (uint32_t p = 0; p < numPaths; ++p)
+        {
+          h += amplitudes[p] * std::polar (1.0, -2 * M_PI * it->fc * paths[p].m_delay * 1e-9);
+        }
+      gains->at (band) = std::norm (h);
+    }
+}
+
+Ptr<SpectrumValue>
+RayTracingSpectrumPropagationLossModel::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
+                                                                      Ptr<const MobilityModel> a,
+                                                                      Ptr<const MobilityModel> b,
+                                                                      Ptr<const PhasedArrayModel> aPhasedArrayModel,
+                                                                      Ptr<const PhasedArrayModel> bPhasedArrayModel) const
+{
+  NS_LOG_FUNCTION (this);
+  NrPerfProfilerScope profilerScope (NrPerfProfiler::CHANNEL);
+  NS_ABORT_MSG_IF (m_trace == nullptr, "The TraceFile attribute is not set");
+
+  // The traces are generated for a receiver on the route: when it is a, the
+  // transmitter, the departure and arrival angles are swapped
+  Vector aPos = a->GetPosition ();
+  Vector bPos = b->GetPosition ();
+  bool reverse = GetDistanceToRoute (aPos) < GetDistanceToRoute (bPos);
+  double index = GetSampleIndex (reverse ? aPos : bPos);
+
+  Ptr<SpectrumValue> rxPsd = Copy<SpectrumValue> (txPsd);
+  NrCounters::Add (NrCounters::SPECTRUM_VALUES);
+  std::vector<double> gains;
+
+  if (m_interpolation == NEAREST)
+    {
+      uint32_t sample = static_cast<uint32_t> (std::lround (index));
+      CalcBandGains (txPsd, sample, aPhasedArrayModel, bPhasedArrayModel, reverse, &gains);
+    }
+  else
+    {
+      uint32_t first = static_cast<uint32_t> (std::floor (index));
+      uint32_t second = std::min (first + 1, m_trace->GetNumSamples () - 1);
+      double weight = index - first;
+      CalcBandGains (txPsd, first, aPhasedArrayModel, bPhasedArrayModel, reverse, &gains);
+      if (weight > 0 && second != first)
+        {
+          std::vector<double> secondGains;
+          CalcBandGains (txPsd, second, aPhasedArrayModel, bPhasedArrayModel, reverse, &secondGains);
+          for (size_t i = 0; i < gains.size (); ++i)
+            {
+              gains[i] = (1 - weight) * gains[i] + weight * secondGains[i];
+            }
+        }
+    }
+
+  NS_LOG_LOGIC ("Sample index " << index << (reverse ? " (reverse link)" : ""));
+
+  size_t band = 0;
+  for (auto it = rxPsd->ValuesBegin (); it != rxPsd->ValuesEnd (); ++it, ++band)
+    {
+      *it *= gains.at (band);
+    }
+  return rxPsd;
+}
+
+}  // namespace ns3
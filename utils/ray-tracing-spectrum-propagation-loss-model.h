@@ -0,0 +1,214 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RAY_TRACING_SPECTRUM_PROPAGATION_LOSS_MODEL_H
+#define RAY_TRACING_SPECTRUM_PROPAGATION_LOSS_MODEL_H
+
+#include "ray-tracing-trace.h"
+#include <ns3/phased-array-spectrum-propagation-loss-model.h>
+#include <ns3/phased-array-model.h>
+#include <ns3/vector.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup nr-utils
+ * \brief Spectrum propagation loss model driven by a ray-tracing trace
+ *
+ * Instead of generating a 3GPP channel, this model reads the multipath
+ * components of the link from a RayTracingTrace. The trace samples are
+ * taken at evenly spaced positions of the receiver along a straight route,
+ * from RouteStart (the first sample) to RouteEnd (the last sample). For
+ * each link, the end closest to the route is projected on it, and the
+ * sample at that position is used; with the LINEAR interpolation, the
+ * received PSD is linearly interpolated between the two nearest samples.
+ * The angles of departure and arrival are swapped when the node on the
+ * route is the transmitter (channel reciprocity).
+ *
+ * The received PSD of each band, with band center frequency f, is
+ *
+ * \f$ |\sum_p g_p e^{j(\phi_p - 2 \pi f \tau_p)} A_{tx}(p) A_{rx}(p)|^2 \f$
+ *
+ * times the transmitted PSD, where g_p is the amplitude of the path gain,
+ * \f$ \phi_p \f$ its phase, \f$ \tau_p \f$ its delay, and A the array
+ * factor (beamforming vector, element positions and field pattern) of
+ * each antenna in the direction of the path.
+ *
+ * The path gains of the traces already include the path loss, so the
+ * channel should not apply another propagation loss model.
+ *
+ * \see RayTracingTrace
+ */
+class RayTracingSpectrumPropagationLossModel : public PhasedArraySpectrumPropagationLossModel
+{
+public:
+  /**
+   * \brief Interpolation of the trace samples between positions
+   */
+  enum Interpolation
+  {
+    NEAREST, //!< Use the nearest sample
+    LINEAR   //!< Linearly interpolate the received PSD of the two nearest samples
+  };
+
+  /**
+   * Constructor
+   */
+  RayTracingSpectrumPropagationLossModel ();
+
+  /**
+   * Destructor
+   */
+  virtual ~RayTracingSpectrumPropagationLossModel ();
+
+  /**
+   * Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId ();
+
+  /**
+   * \brief Sets the trace file and opens it
+   *
+   * A binary trace is mapped directly. A text trace (ending in .txt) is
+   * converted, once, to a binary file in the CacheDirectory, which is then
+   * reused. If that file cannot be written, the text is parsed in memory.
+   *
+   * \param fileName the trace file
+   */
+  void SetTraceFile (const std::string &fileName);
+
+  /**
+   * \brief Gets the trace file
+   * \return the trace file
+   */
+  std::string GetTraceFile () const;
+
+  /**
+   * \brief Sets an already opened trace, to be shared by several models
+   * \param trace the trace
+   */
+  void SetTrace (Ptr<const RayTracingTrace> trace);
+
+  /**
+   * \brief Sets the position of the first trace sample
+   * \param start the position
+   */
+  void SetRouteStart (const Vector &start);
+
+  /**
+   * \brief Gets the position of the first trace sample
+   * \return the position
+   */
+  Vector GetRouteStart () const;
+
+  /**
+   * \brief Sets the position of the last trace sample
+   * \param end the position
+   */
+  void SetRouteEnd (const Vector &end);
+
+  /**
+   * \brief Gets the position of the last trace sample
+   * \return the position
+   */
+  Vector GetRouteEnd () const;
+
+  /**
+   * \brief Sets the interpolation between samples
+   * \param interpolation the interpolation
+   */
+  void SetInterpolation (enum Interpolation interpolation);
+
+  /**
+   * \brief Gets the interpolation between samples
+   * \return the interpolation
+   */
+  enum Interpolation GetInterpolation () const;
+
+  /**
+   * \brief Gets the fractional sample index of a position of the route
+   * \param position the position, projected on the route
+   * \return the sample index, between 0 and the number of samples - 1
+   */
+  double GetSampleIndex (const Vector &position) const;
+
+  /**
+   * \brief Computes the received PSD.
+   *
+   * \param txPsd tx PSD
+   * \param a first node mobility model
+   * \param b second node mobility model
+   * \param aPhasedArrayModel the antenna array of the first node
+   * \param bPhasedArrayModel the antenna array of the second node
+   * \return the received PSD
+   */
+  virtual Ptr<SpectrumValue> DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
+                                                           Ptr<const MobilityModel> a,
+                                                           Ptr<const MobilityModel> b,
+                                                           Ptr<const PhasedArrayModel> aPhasedArrayModel,
+                                                           Ptr<const PhasedArrayModel> bPhasedArrayModel) const override;
+
+protected:
+  virtual void DoDispose () override;
+
+private:
+  /**
+   * \brief Computes the channel power gain of each band, for a trace sample
+   * \param txPsd the tx PSD, whose bands are used
+   * \param sample the trace sample
+   * \param txArray the antenna array of the transmitter
+   * \param rxArray the antenna array of the receiver
+   * \param reverse true if the transmitter is the node on the route
+   * \param gains the gain of each band
+   */
+  void CalcBandGains (Ptr<const SpectrumValue> txPsd, uint32_t sample,
+                      Ptr<const PhasedArrayModel> txArray,
+                      Ptr<const PhasedArrayModel> rxArray,
+                      bool reverse, std::vector<double> *gains) const;
+
+  /**
+   * \brief Computes the distance from a position to the route
+   * \param position the position
+   * \return the distance
+   */
+  double GetDistanceToRoute (const Vector &position) const;
+
+  /**
+   * \brief Gets the name of the binary conversion of a text trace
+   *
+   * The name is made of the name of the text trace and of a hash of its
+   * path and size, so that different traces with the same name, or a
+   * trace that was changed, do not use the same file.
+   *
+   * \param fileName the text trace
+   * \return the binary file in the CacheDirectory
+   */
+  std::string GetCacheFile (const std::string &fileName) const;
+
+  std::string m_traceFile;                   //!< The `TraceFile` attribute
+  std::string m_cacheDirectory;              //!< The `CacheDirectory` attribute
+  Ptr<const RayTracingTrace> m_trace;        //!< The trace
+  Vector m_routeStart {0, 0, 0};             //!< The `RouteStart` attribute
+  Vector m_routeEnd {0, 0, 0};               //!< The `RouteEnd` attribute
+  enum Interpolation m_interpolation {NEAREST}; //!< The `Interpolation` attribute
+};
+
+} // namespace ns3
+
+#endif /* RAY_TRACING_SPECTRUM_PROPAGATION_LOSS_MODEL_H */
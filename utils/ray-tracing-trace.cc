@@ -0,0 +1,413 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ray-tracing-trace.h"
+#include <ns3/log.h>
+#include <ns3/assert.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#if defined (__unix__) || defined (__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NR_RAY_TRACING_HAVE_MMAP 1
+#endif
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RayTracingTrace");
+
+static const char RAY_TRACING_MAGIC[4] = {'N', 'R', 'R', 'T'};
+static const uint16_t RAY_TRACING_VERSION = 1;
+static const uint16_t RAY_TRACING_FIELDS = sizeof (RayTracingPath) / sizeof (double);
+static const uint32_t RAY_TRACING_BOM = 0x01020304;
+
+/**
+ * \brief Header of a binary ray-tracing trace file
+ */
+struct RayTracingHeader
+{
+  char m_magic[4];       //!< "NRRT"
+  uint16_t m_version;    //!< Format version
+  uint16_t m_fields;     //!< Number of double fields of a path
+  uint32_t m_bom;        //!< Byte-order mark
+  uint32_t m_numSamples; //!< Number of samples
+  uint64_t m_numPaths;   //!< Total number of paths
+  uint64_t m_reserved;   //!< Reserved, 0
+};
+
+/**
+ * \brief Fields of a path, in the order of the lines of a text sample
+ */
+static double RayTracingPath::* const RAY_TRACING_PATH_FIELDS[] = {
+  &RayTracingPath::m_delay,
+  &RayTracingPath::m_pathGainDb,
+  &RayTracingPath::m_phase,
+  &RayTracingPath::m_aodElevation,
+  &RayTracingPath::m_aodAzimuth,
+  &RayTracingPath::m_aoaElevation,
+  &RayTracingPath::m_aoaAzimuth
+};
+
+static_assert (sizeof (RAY_TRACING_PATH_FIELDS) / sizeof (RAY_TRACING_PATH_FIELDS[0]) == RAY_TRACING_FIELDS,
+               "A field of RayTracingPath is not parsed");
+static_assert (sizeof (RayTracingHeader) == 32, "Unexpected padding in RayTracingHeader");
+static_assert (sizeof (RayTracingPath) == RAY_TRACING_FIELDS * sizeof (double),
+               "Unexpected padding in RayTracingPath");
+
+/**
+ * \brief Parse a line of comma-separated values
+ * \param line the line
+ * \param values the parsed values
+ * \return false if the line contains something that is not a number
+ */
+static bool
+ParseValues (const std::string &line, std::vector<double> *values)
+{
+  values->clear ();
+  const char *p = line.c_str ();
+  while (true)
+    {
+      while (*p == ' ' || *p == '\t' || *p == '\r')
+        {
+          ++p;
+        }
+      if (*p == '\0')
+        {
+          return true;
+        }
+      char *end = nullptr;
+      double v = std::strtod (p, &end);
+      if (end == p)
+        {
+          return false;
+        }
+      values->push_back (v);
+      p = end;
+      while (*p == ' ' || *p == '\t' || *p == '\r')
+        {
+          ++p;
+        }
+      if (*p == ',')
+        {
+          ++p;
+        }
+      else if (*p != '\0')
+        {
+          return false;
+        }
+    }
+}
+
+bool
+RayTracingTrace::ReadText (const std::string &textFileName, std::vector<uint64_t> *data)
+{
+  NS_LOG_FUNCTION (textFileName);
+
+  std::ifstream in (textFileName.c_str ());
+  if (!in.is_open ())
+    {
+      NS_LOG_ERROR ("Could not open " << textFileName);
+      return false;
+    }
+
+  std::vector<uint64_t> firstPath;
+  std::vector<RayTracingPath> paths;
+  std::vector<double> values;
+  std::string line;
+  uint64_t lineNumber = 0;
+
+  while (std::getline (in, line))
+    {
+      ++lineNumber;
+      if (!ParseValues (line, &values))
+        {
+          NS_LOG_ERROR (textFileName << ":" << lineNumber << ": not a list of numbers");
+          return false;
+        }
+      if (values.empty ())
+        {
+          continue;
+        }
+      if (values.size () != 1 || values[0] < 0 || values[0] != static_cast<uint32_t> (values[0]))
+        {
+          NS_LOG_ERROR (textFileName << ":" << lineNumber << ": expected the number of paths");
+          return false;
+        }
+
+      uint32_t numPaths = static_cast<uint32_t> (values[0]);
+      size_t first = paths.size ();
+      firstPath.push_back (first);
+      paths.resize (first + numPaths);
+
+      for (uint16_t field = 0; field < RAY_TRACING_FIELDS; ++field)
+        {
+          if (!std::getline (in, line))
+            {
+              NS_LOG_ERROR (textFileName << ": truncated sample at the end of the file");
+              return false;
+            }
+          ++lineNumber;
+          if (!ParseValues (line, &values) || values.size () != numPaths)
+            {
+              NS_LOG_ERROR (textFileName << ":" << lineNumber << ": expected " <<
+                            numPaths << " values");
+              return false;
+            }
+          for (uint32_t i = 0; i < numPaths; ++i)
+            {
+              paths[first + i].*RAY_TRACING_PATH_FIELDS[field] = values[i];
+            }
+        }
+    }
+  firstPath.push_back (paths.size ());
+
+  RayTracingHeader header;
+  std::memcpy (header.m_magic, RAY_TRACING_MAGIC, sizeof (header.m_magic));
+  header.m_version = RAY_TRACING_VERSION;
+  header.m_fields = RAY_TRACING_FIELDS;
+  header.m_bom = RAY_TRACING_BOM;
+  header.m_numSamples = static_cast<uint32_t> (firstPath.size () - 1);
+  header.m_numPaths = paths.size ();
+  header.m_reserved = 0;
+
+  // The header, the index and the paths are all made of 8 bytes words
+  size_t indexBytes = firstPath.size () * sizeof (uint64_t);
+  size_t pathBytes = paths.size () * sizeof (RayTracingPath);
+  data->resize ((sizeof (header) + indexBytes + pathBytes) / sizeof (uint64_t));
+  char *p = reinterpret_cast<char*> (data->data ());
+  std::memcpy (p, &header, sizeof (header));
+  std::memcpy (p + sizeof (header), firstPath.data (), indexBytes);
+  std::memcpy (p + sizeof (header) + indexBytes, paths.data (), pathBytes);
+
+  NS_LOG_INFO ("Read " << header.m_numSamples << " samples with " <<
+               header.m_numPaths << " paths from " << textFileName);
+  return true;
+}
+
+bool
+RayTracingTrace::ConvertTextToBinary (const std::string &textFileName,
+                                      const std::string &binaryFileName)
+{
+  NS_LOG_FUNCTION (textFileName << binaryFileName);
+
+  std::vector<uint64_t> data;
+  if (!ReadText (textFileName, &data))
+    {
+      return false;
+    }
+
+  std::ofstream out (binaryFileName.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!out.is_open ())
+    {
+      NS_LOG_ERROR ("Could not open " << binaryFileName);
+      return false;
+    }
+  out.write (reinterpret_cast<const char*> (data.data ()), data.size () * sizeof (uint64_t));
+  out.close ();
+  if (!out)
+    {
+      NS_LOG_ERROR ("Could not write " << binaryFileName);
+      return false;
+    }
+  return true;
+}
+
+RayTracingTrace::~RayTracingTrace ()
+{
+  Close ();
+}
+
+bool
+RayTracingTrace::Open (const std::string &fileName)
+{
+  NS_LOG_FUNCTION (this << fileName);
+  Close ();
+
+#ifdef NR_RAY_TRACING_HAVE_MMAP
+  int fd = open (fileName.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      NS_LOG_ERROR ("Could not open " << fileName);
+      return false;
+    }
+  struct stat st;
+  if (fstat (fd, &st) != 0 || st.st_size < static_cast<off_t> (sizeof (RayTracingHeader)))
+    {
+      close (fd);
+      NS_LOG_ERROR (fileName << " is not a binary ray-tracing trace");
+      return false;
+    }
+  void *data = mmap (nullptr, static_cast<size_t> (st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    {
+      NS_LOG_ERROR ("Could not map " << fileName);
+      return false;
+    }
+  m_data = static_cast<const char*> (data);
+  m_size = static_cast<size_t> (st.st_size);
+  m_mapped = true;
+#else
+  std::ifstream in (fileName.c_str (), std::ios::in | std::ios::binary | std::ios::ate);
+  if (!in.is_open ())
+    {
+      NS_LOG_ERROR ("Could not open " << fileName);
+      return false;
+    }
+  m_size = static_cast<size_t> (in.tellg ());
+  // uint64_t storage keeps the paths aligned, as in a mapped file
+  m_buffer.resize ((m_size + sizeof (uint64_t) - 1) / sizeof (uint64_t));
+  in.seekg (0);
+  in.read (reinterpret_cast<char*> (m_buffer.data ()), m_size);
+  m_data = reinterpret_cast<const char*> (m_buffer.data ());
+#endif
+
+  if (!Parse (fileName))
+    {
+      Close ();
+      return false;
+    }
+  return true;
+}
+
+bool
+RayTracingTrace::OpenText (const std::string &textFileName)
+{
+  NS_LOG_FUNCTION (this << textFileName);
+  Close ();
+
+  if (!ReadText (textFileName, &m_buffer))
+    {
+      Close ();
+      return false;
+    }
+  m_data = reinterpret_cast<const char*> (m_buffer.data ());
+  m_size = m_buffer.size () * sizeof (uint64_t);
+
+  if (!Parse (textFileName))
+    {
+      Close ();
+      return false;
+    }
+  return true;
+}
+
+bool
+RayTracingTrace::Parse (const std::string &fileName)
+{
+  if (m_size < sizeof (RayTracingHeader))
+    {
+      NS_LOG_ERROR (fileName << " is not a binary ray-tracing trace");
+      return false;
+    }
+
+  RayTracingHeader header;
+  std::memcpy (&header, m_data, sizeof (header));
+  if (std::memcmp (header.m_magic, RAY_TRACING_MAGIC, sizeof (header.m_magic)) != 0)
+    {
+      NS_LOG_ERROR (fileName << " is not a binary ray-tracing trace");
+      return false;
+    }
+  if (header.m_version != RAY_TRACING_VERSION || header.m_fields != RAY_TRACING_FIELDS)
+    {
+      NS_LOG_ERROR ("Unsupported ray-tracing trace version " << header.m_version);
+      return false;
+    }
+  if (header.m_bom != RAY_TRACING_BOM)
+    {
+      NS_LOG_ERROR (fileName << " was written on a host with a different byte order");
+      return false;
+    }
+
+  uint64_t indexSize = (static_cast<uint64_t> (header.m_numSamples) + 1) * sizeof (uint64_t);
+  if (header.m_numPaths > (m_size - sizeof (header)) / sizeof (RayTracingPath)
+      || m_size != sizeof (header) + indexSize + header.m_numPaths * sizeof (RayTracingPath))
+    {
+      NS_LOG_ERROR (fileName << " has a wrong size");
+      return false;
+    }
+
+  m_firstPath = reinterpret_cast<const uint64_t*> (m_data + sizeof (header));
+  m_paths = reinterpret_cast<const RayTracingPath*> (m_data + sizeof (header) + indexSize);
+  m_numSamples = header.m_numSamples;
+
+  for (uint32_t i = 0; i < m_numSamples; ++i)
+    {
+      if (m_firstPath[i] > m_firstPath[i + 1])
+        {
+          NS_LOG_ERROR (fileName << " has a malformed index");
+          return false;
+        }
+    }
+  if (m_firstPath[0] != 0 || m_firstPath[m_numSamples] != header.m_numPaths)
+    {
+      NS_LOG_ERROR (fileName << " has a malformed index");
+      return false;
+    }
+  return true;
+}
+
+void
+RayTracingTrace::Close ()
+{
+#ifdef NR_RAY_TRACING_HAVE_MMAP
+  if (m_mapped)
+    {
+      munmap (const_cast<char*> (m_data), m_size);
+    }
+#endif
+  m_data = nullptr;
+  m_size = 0;
+  m_mapped = false;
+  m_buffer.clear ();
+  m_numSamples = 0;
+  m_firstPath = nullptr;
+  m_paths = nullptr;
+}
+
+bool
+RayTracingTrace::IsOpen () const
+{
+  return m_data != nullptr;
+}
+
+uint32_t
+RayTracingTrace::GetNumSamples () const
+{
+  return m_numSamples;
+}
+
+uint32_t
+RayTracingTrace::GetNumPaths (uint32_t sample) const
+{
+  NS_ASSERT_MSG (sample < m_numSamples, "Sample " << sample << " out of range");
+  return static_cast<uint32_t> (m_firstPath[sample + 1] - m_firstPath[sample]);
+}
+
+const RayTracingPath *
+RayTracingTrace::GetPaths (uint32_t sample) const
+{
+  NS_ASSERT_MSG (sample < m_numSamples, "Sample " << sample << " out of range");
+  return m_paths + m_firstPath[sample];
+}
+
+} // namespace ns3
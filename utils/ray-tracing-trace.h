@@ -0,0 +1,179 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RAY_TRACING_TRACE_H
+#define RAY_TRACING_TRACE_H
+
+#include <ns3/simple-ref-count.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup nr-utils
+ * \brief A multipath component of a ray-tracing trace sample
+ *
+ * The fields are in the order of the lines of a sample in the text traces
+ * of model/Raytracing.
+ */
+struct RayTracingPath
+{
+  double m_delay;         //!< Propagation delay (ns)
+  double m_pathGainDb;    //!< Path gain (dB), i.e., the opposite of the path loss
+  double m_phase;         //!< Phase (rad)
+  double m_aodElevation;  //!< Elevation angle of departure (degrees)
+  double m_aodAzimuth;    //!< Azimuth angle of departure (degrees)
+  double m_aoaElevation;  //!< Elevation angle of arrival (degrees)
+  double m_aoaAzimuth;    //!< Azimuth angle of arrival (degrees)
+};
+
+/**
+ * \ingroup nr-utils
+ * \brief Read-only access to a ray-tracing trace in packed binary format
+ *
+ * The text traces shipped in model/Raytracing (traces.txt, traces10cm.txt,
+ * traces50cm.txt, Quadriga*.txt) are a sequence of samples, one per
+ * position of the receiver along its route. Each sample is a line with
+ * the number of paths N, followed by seven lines of N comma-separated
+ * values: delay, path gain, phase, AoD elevation, AoD azimuth,
+ * AoA elevation and AoA azimuth.
+ *
+ * ConvertTextToBinary converts them, once, to a binary file made of:
+ *
+ * - a 32 bytes header: the magic string "NRRT", the format version
+ * (uint16_t), the number of fields of a path (uint16_t), the byte-order
+ * mark 0x01020304 (uint32_t), the number of samples S (uint32_t), the
+ * total number of paths P (uint64_t) and 8 reserved bytes;
+ * - S + 1 uint64_t: the index of the first path of each sample, and P;
+ * - P RayTracingPath structures.
+ *
+ * Open maps the binary file in memory (where mmap is available, otherwise
+ * it reads it), so that the paths are accessed in place, without any
+ * parsing; the processes that use the same file share its pages. OpenText
+ * instead parses a text trace into the same layout, in memory.
+ *
+ * \code
+ *   RayTracingTrace::ConvertTextToBinary ("traces10cm.txt", "traces10cm.bin");
+ *   Ptr<RayTracingTrace> trace = Create<RayTracingTrace> ();
+ *   trace->Open ("traces10cm.bin");
+ *   for (uint32_t i = 0; i < trace->GetNumPaths (sample); ++i)
+ *     {
+ *       const RayTracingPath &path = trace->GetPaths (sample)[i];
+ *     }
+ * \endcode
+ */
+class RayTracingTrace : public SimpleRefCount<RayTracingTrace>
+{
+public:
+  RayTracingTrace () = default;
+
+  /**
+   * \brief Destructor; unmaps the file
+   */
+  ~RayTracingTrace ();
+
+  RayTracingTrace (const RayTracingTrace &) = delete;
+  RayTracingTrace & operator= (const RayTracingTrace &) = delete;
+
+  /**
+   * \brief Convert a text trace to the binary format
+   * \param textFileName the text trace
+   * \param binaryFileName the binary file to write
+   * \return false if the text trace could not be read or is malformed, or
+   * if the binary file could not be written
+   */
+  static bool ConvertTextToBinary (const std::string &textFileName,
+                                   const std::string &binaryFileName);
+
+  /**
+   * \brief Open a binary trace file
+   * \param fileName the name of the file
+   * \return false if the file could not be opened or if it is not a valid
+   * binary ray-tracing trace
+   */
+  bool Open (const std::string &fileName);
+
+  /**
+   * \brief Read a text trace, and keep it in memory in the binary format
+   *
+   * To be used when the binary file cannot be written: the text is parsed
+   * every time.
+   *
+   * \param textFileName the text trace
+   * \return false if the text trace could not be read or is malformed
+   */
+  bool OpenText (const std::string &textFileName);
+
+  /**
+   * \brief Close the file
+   */
+  void Close ();
+
+  /**
+   * \return true if a file is open
+   */
+  bool IsOpen () const;
+
+  /**
+   * \return the number of samples
+   */
+  uint32_t GetNumSamples () const;
+
+  /**
+   * \param sample the sample index
+   * \return the number of paths of the sample
+   */
+  uint32_t GetNumPaths (uint32_t sample) const;
+
+  /**
+   * \param sample the sample index
+   * \return the GetNumPaths (sample) paths of the sample
+   */
+  const RayTracingPath * GetPaths (uint32_t sample) const;
+
+private:
+  /**
+   * \brief Parse a text trace into the content of a binary file
+   * \param textFileName the text trace
+   * \param data the content of the binary file
+   * \return false if the text trace could not be read or is malformed
+   */
+  static bool ReadText (const std::string &textFileName, std::vector<uint64_t> *data);
+
+  /**
+   * \brief Check the header and the index of the file data, and set
+   * m_firstPath and m_paths
+   * \param fileName the name of the file, for the log
+   * \return true if the data is valid
+   */
+  bool Parse (const std::string &fileName);
+
+  const char *m_data {nullptr};          //!< File data
+  size_t m_size {0};                     //!< Size of the file data
+  bool m_mapped {false};                 //!< True if m_data is mapped
+  std::vector<uint64_t> m_buffer;        //!< File data, when it is not mapped or is parsed from text
+  uint32_t m_numSamples {0};             //!< Number of samples
+  const uint64_t *m_firstPath {nullptr}; //!< First path of each sample
+  const RayTracingPath *m_paths {nullptr}; //!< Paths of all the samples
+};
+
+} // namespace ns3
+
+#endif // RAY_TRACING_TRACE_H
@@ -30,11 +30,17 @@
 #include "ns3/string.h"
 #include "ns3/integer.h"
 #include <algorithm>
+#include <complex>
+#include <vector>
 #include <random>
 #include "ns3/log.h"
 #include <ns3/simulator.h>
 #include "ns3/mobility-model.h"
 #include "ns3/pointer.h"
+#include "ns3/uinteger.h"
+#include "ns3/abort.h"
+#include <atomic>
+#include <thread>
 
 namespace ns3 {
 
@@ -57,6 +63,11 @@ ThreeGppChannelModelParam::~ThreeGppChannelModelParam ()
 void
 ThreeGppChannelModelParam::DoDispose ()
 {
+  m_links.clear ();
+  m_linkIndex.clear ();
+  m_pendingChannels.clear ();
+  m_recorder.Close ();
+  m_recordedTimes.clear ();
   ThreeGppChannelModel::DoDispose();
 }
 
@@ -78,8 +89,50 @@ ThreeGppChannelModelParam::GetTypeId (void)
                    BooleanValue (true),
                    MakeBooleanAccessor (&ThreeGppChannelModelParam::m_parametrizedCorrelation),
                    MakeBooleanChecker ())
-
-
+    .AddAttribute ("NumPrefetchWorkers",
+                   "Number of threads that compute the channel matrices of the links "
+                   "whose update period is over, all together at the first request "
+                   "after it (the simulation thread is one of them). When 0, the "
+                   "channels are generated one by one when they are requested. Any "
+                   "value greater than 0 changes the results with respect to 0, as "
+                   "the links are regenerated at other instants and draw their "
+                   "random parameters in another order; the results do not depend "
+                   "on the value itself.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&ThreeGppChannelModelParam::SetNumPrefetchWorkers,
+                                         &ThreeGppChannelModelParam::GetNumPrefetchWorkers),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("RecordFileName",
+                   "The file in which the channel matrices are recorded, with the "
+                   "parameters of their clusters, for NrReplayChannelModel. A matrix "
+                   "is written the first time it is returned. Empty (default) to "
+                   "disable the recording.",
+                   StringValue (""),
+                   MakeStringAccessor (&ThreeGppChannelModelParam::m_recordFileName),
+                   MakeStringChecker ())
+    .AddAttribute ("SpeedAdaptiveUpdate",
+                   "If true, each link is regenerated when its ends have moved by "
+                   "UpdateDistance relative to each other, instead of after UpdatePeriod: "
+                   "the links between static nodes are only regenerated when their "
+                   "channel condition changes.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&ThreeGppChannelModelParam::SetSpeedAdaptiveUpdate,
+                                        &ThreeGppChannelModelParam::GetSpeedAdaptiveUpdate),
+                   MakeBooleanChecker ())
+    .AddAttribute ("UpdateDistance",
+                   "The distance (m) that the ends of a link may move relative to each "
+                   "other before it is regenerated, when SpeedAdaptiveUpdate is true. "
+                   "When 0, the correlation distance of TR 38.901 Table 7.6.3.1-2 for "
+                   "the scenario and the LOS condition of the link.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&ThreeGppChannelModelParam::SetUpdateDistance,
+                                       &ThreeGppChannelModelParam::GetUpdateDistance),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("MinUpdatePeriod",
+                   "The shortest update period of a link, when SpeedAdaptiveUpdate is true.",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&ThreeGppChannelModelParam::m_minUpdatePeriod),
+                   MakeTimeChecker ())
   ;
   return tid;
 }
@@ -90,6 +143,267 @@ ThreeGppChannelModelParam::SetRo (double ro)
   m_Ro = ro;
 }
 
+void
+ThreeGppChannelModelParam::SetNumPrefetchWorkers (uint32_t numWorkers)
+{
+  NS_LOG_FUNCTION (this << numWorkers);
+  m_numPrefetchWorkers = numWorkers;
+}
+
+uint32_t
+ThreeGppChannelModelParam::GetNumPrefetchWorkers () const
+{
+  return m_numPrefetchWorkers;
+}
+
+void
+ThreeGppChannelModelParam::SetSpeedAdaptiveUpdate (bool enabled)
+{
+  NS_LOG_FUNCTION (this << enabled);
+  m_speedAdaptiveUpdate = enabled;
+  m_baseUpdatePeriod = Time::Max ();
+}
+
+bool
+ThreeGppChannelModelParam::GetSpeedAdaptiveUpdate () const
+{
+  return m_speedAdaptiveUpdate;
+}
+
+void
+ThreeGppChannelModelParam::SetUpdateDistance (double distance)
+{
+  NS_LOG_FUNCTION (this << distance);
+  m_updateDistance = distance;
+}
+
+double
+ThreeGppChannelModelParam::GetUpdateDistance () const
+{
+  return m_updateDistance;
+}
+
+Time
+ThreeGppChannelModelParam::GetLinkUpdatePeriod (Ptr<const MobilityModel> aMob, Ptr<const MobilityModel> bMob) const
+{
+  if (!m_speedAdaptiveUpdate)
+    {
+      return GetUpdatePeriod ();
+    }
+
+  double speed = (aMob->GetVelocity () - bMob->GetVelocity ()).GetLength ();
+  if (speed == 0.0)
+    {
+      return Time (0);
+    }
+
+  double distance = m_updateDistance;
+  if (distance == 0.0)
+    {
+      // TR 38.901 Table 7.6.3.1-2, correlation distance of the cluster and
+      // ray specific random variables
+      bool los = GetChannelConditionModel ()->GetChannelCondition (aMob, bMob)->GetLosCondition ()
+        == ChannelCondition::LOS;
+      std::string scenario = GetScenario ();
+      if (scenario == "RMa")
+        {
+          distance = los ? 50.0 : 60.0;
+        }
+      else if (scenario == "UMa")
+        {
+          distance = los ? 40.0 : 50.0;
+        }
+      else if (scenario == "UMi-StreetCanyon")
+        {
+          distance = los ? 12.0 : 15.0;
+        }
+      else if (scenario == "InH-OfficeMixed" || scenario == "InH-OfficeOpen")
+        {
+          distance = 10.0;
+        }
+      else
+        {
+          NS_ABORT_MSG ("No correlation distance for the scenario " << scenario << ", set UpdateDistance");
+        }
+    }
+  return std::max (Seconds (distance / speed), m_minUpdatePeriod);
+}
+
+Ptr<const MatrixBasedChannelModel::ChannelMatrix>
+ThreeGppChannelModelParam::GetChannel (Ptr<const MobilityModel> aMob,
+                                       Ptr<const MobilityModel> bMob,
+                                       Ptr<const PhasedArrayModel> aAntenna,
+                                       Ptr<const PhasedArrayModel> bAntenna)
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<const ChannelMatrix> channelMatrix = m_numPrefetchWorkers == 0
+    ? GetLinkChannel (aMob, bMob, aAntenna, bAntenna)
+    : GetPrefetchedChannel (aMob, bMob, aAntenna, bAntenna);
+  if (!m_recordFileName.empty ())
+    {
+      RecordChannel (aMob, bMob, channelMatrix);
+    }
+  return channelMatrix;
+}
+
+Ptr<const MatrixBasedChannelModel::ChannelMatrix>
+ThreeGppChannelModelParam::GetLinkChannel (Ptr<const MobilityModel> aMob,
+                                           Ptr<const MobilityModel> bMob,
+                                           Ptr<const PhasedArrayModel> aAntenna,
+                                           Ptr<const PhasedArrayModel> bAntenna)
+{
+  if (m_speedAdaptiveUpdate)
+    {
+      // ThreeGppChannelModel compares the age of the parameters of the link
+      // with its UpdatePeriod, which is set to the period of this link
+      Time updatePeriod = GetLinkUpdatePeriod (aMob, bMob);
+      if (updatePeriod != m_baseUpdatePeriod)
+        {
+          SetAttribute ("UpdatePeriod", TimeValue (updatePeriod));
+          m_baseUpdatePeriod = updatePeriod;
+        }
+    }
+  return ThreeGppChannelModel::GetChannel (aMob, bMob, aAntenna, bAntenna);
+}
+
+Ptr<const MatrixBasedChannelModel::ChannelMatrix>
+ThreeGppChannelModelParam::GetPrefetchedChannel (Ptr<const MobilityModel> aMob,
+                                                 Ptr<const MobilityModel> bMob,
+                                                 Ptr<const PhasedArrayModel> aAntenna,
+                                                 Ptr<const PhasedArrayModel> bAntenna)
+{
+  // the links whose update period is over are regenerated all together, at
+  // the first request after the end of the earliest one
+  if (Simulator::Now () > m_nextPrefetch)
+    {
+      Prefetch ();
+    }
+
+  Ptr<const ChannelMatrix> channelMatrix = GetLinkChannel (aMob, bMob, aAntenna, bAntenna);
+
+  uint64_t key = GetKey (aAntenna->GetId (), bAntenna->GetId ());
+  auto it = m_linkIndex.find (key);
+  if (it == m_linkIndex.end ())
+    {
+      it = m_linkIndex.emplace (key, m_links.size ()).first;
+      Link link;
+      link.m_aMob = aMob;
+      link.m_bMob = bMob;
+      link.m_aAntenna = aAntenna;
+      link.m_bAntenna = bAntenna;
+      m_links.emplace_back (std::move (link));
+    }
+
+  // a link is also regenerated on request, e.g., when its channel condition changes
+  Link &link = m_links.at (it->second);
+  if (link.m_generatedTime != channelMatrix->m_generatedTime)
+    {
+      link.m_generatedTime = channelMatrix->m_generatedTime;
+      Time updatePeriod = GetLinkUpdatePeriod (aMob, bMob);
+      if (!updatePeriod.IsZero ())
+        {
+          m_nextPrefetch = std::min (m_nextPrefetch, link.m_generatedTime + updatePeriod);
+        }
+    }
+
+  return channelMatrix;
+}
+
+void
+ThreeGppChannelModelParam::RecordChannel (Ptr<const MobilityModel> aMob,
+                                          Ptr<const MobilityModel> bMob,
+                                          Ptr<const ChannelMatrix> channelMatrix)
+{
+  if (!m_recorder.IsOpen ())
+    {
+      NS_ABORT_MSG_IF (!m_recorder.Open (m_recordFileName, GetFrequency ()),
+                       "Could not create the channel recording " << m_recordFileName);
+    }
+
+  // a matrix is returned until it is updated: only new ones are written
+  uint64_t key = GetKey (channelMatrix->m_antennaPair.first, channelMatrix->m_antennaPair.second);
+  auto it = m_recordedTimes.find (key);
+  if (it != m_recordedTimes.end () && it->second == channelMatrix->m_generatedTime)
+    {
+      return;
+    }
+  m_recordedTimes[key] = channelMatrix->m_generatedTime;
+  NS_ABORT_MSG_IF (!m_recorder.Write (channelMatrix, GetParams (aMob, bMob)),
+                   "Could not write the channel recording " << m_recordFileName);
+}
+
+Time
+ThreeGppChannelModelParam::GetUpdatePeriod () const
+{
+  TimeValue updatePeriod;
+  GetAttribute ("UpdatePeriod", updatePeriod);
+  return updatePeriod.Get ();
+}
+
+void
+ThreeGppChannelModelParam::Prefetch ()
+{
+  NS_LOG_FUNCTION (this << m_links.size ());
+
+  m_nextPrefetch = Time::Max ();
+
+  // The parameters of the links are drawn here, serially and in the order in
+  // which the links were first requested, so that the random numbers do not
+  // depend on the number of workers. GetNewChannel only prepares the
+  // coefficients, that are computed afterwards on the workers.
+  m_prefetching = true;
+  for (auto &link : m_links)
+    {
+      Time updatePeriod = GetLinkUpdatePeriod (link.m_aMob, link.m_bMob);
+      if (updatePeriod.IsZero ())
+        {
+          continue;
+        }
+      if (Simulator::Now () - link.m_generatedTime > updatePeriod)
+        {
+          Ptr<const ChannelMatrix> channelMatrix = GetLinkChannel (link.m_aMob, link.m_bMob,
+                                                                   link.m_aAntenna, link.m_bAntenna);
+          link.m_generatedTime = channelMatrix->m_generatedTime;
+        }
+      m_nextPrefetch = std::min (m_nextPrefetch, link.m_generatedTime + updatePeriod);
+    }
+  m_prefetching = false;
+
+  ComputePendingChannels ();
+}
+
+void
+ThreeGppChannelModelParam::ComputePendingChannels ()
+{
+  NS_LOG_FUNCTION (this << m_pendingChannels.size ());
+
+  std::atomic<size_t> nextChannel {0};
+  auto computeChannels = [this, &nextChannel] ()
+    {
+      for (size_t i = nextChannel++; i < m_pendingChannels.size (); i = nextChannel++)
+        {
+          ComputeChannel (m_pendingChannels[i], &m_pendingChannels[i].m_matrix->m_channel);
+        }
+    };
+
+  // There is one prefetch per update period: the threads are created for
+  // each of them, and the simulation thread is one of the workers
+  std::vector<std::thread> threads;
+  size_t numThreads = std::min<size_t> (m_numPrefetchWorkers, m_pendingChannels.size ());
+  for (size_t i = 1; i < numThreads; i++)
+    {
+      threads.emplace_back (computeChannels);
+    }
+  computeChannels ();
+  for (auto &thread : threads)
+    {
+      thread.join ();
+    }
+
+  m_pendingChannels.clear ();
+}
+
 Ptr<MatrixBasedChannelModel::ChannelMatrix>
 ThreeGppChannelModelParam::GetNewChannel (Ptr<const ThreeGppChannelParams> channelParams,
                                      Ptr<const ParamsTable> table3gpp,
@@ -111,52 +425,48 @@ ThreeGppChannelModelParam::GetNewChannel (Ptr<const ThreeGppChannelParams> chann
   // check if channelParams structure is generated in direction s-to-u or u-to-s
   bool isSameDirection = (channelParams->m_nodeIds == channelMatrix->m_nodeIds);
 
-  MatrixBasedChannelModel::Double2DVector rayAodRadian;
-  MatrixBasedChannelModel::Double2DVector rayAoaRadian;
-  MatrixBasedChannelModel::Double2DVector rayZodRadian;
-  MatrixBasedChannelModel::Double2DVector rayZoaRadian;
+  ChannelJob job = PrepareChannel (channelParams, table3gpp, sMob, uMob, sAntenna, uAntenna, isSameDirection);
 
-  // if channel params is generated in the same direction in which we
-  // generate the channel matrix, angles and zenit od departure and arrival are ok,
-  // just set them to corresponding variable that will be used for the generation
-  // of channel matrix, otherwise we need to flip angles and zenits of departure and arrival
-  if (isSameDirection)
+  NS_LOG_DEBUG ("Husn (sAntenna, uAntenna):" << sAntenna->GetId () << ", " << uAntenna->GetId ());
+  if (m_prefetching)
     {
-      rayAodRadian = channelParams->m_rayAodRadian;
-      rayAoaRadian = channelParams->m_rayAoaRadian;
-      rayZodRadian = channelParams->m_rayZodRadian;
-      rayZoaRadian = channelParams->m_rayZoaRadian;
+      // computed with the other links of the prefetch, before it returns
+      job.m_matrix = channelMatrix;
+      m_pendingChannels.emplace_back (std::move (job));
     }
   else
     {
-      rayAodRadian = channelParams->m_rayAoaRadian;
-      rayAoaRadian = channelParams->m_rayAodRadian;
-      rayZodRadian = channelParams->m_rayZoaRadian;
-      rayZoaRadian = channelParams->m_rayZodRadian;
+      ComputeChannel (job, &channelMatrix->m_channel);
     }
+  return channelMatrix;
+}
 
-
-  //Step 11: Generate channel coefficients for each cluster n and each receiver
-  // and transmitter element pair u,s.
-
-  Complex3DVector H_NLOS; // channel coefficients H_NLOS [u][s][n],
-  // where u and s are receive and transmit antenna element, n is cluster index.
-  uint64_t uSize = uAntenna->GetNumberOfElements ();
-  uint64_t sSize = sAntenna->GetNumberOfElements ();
-
-  Complex3DVector H_usn;  //channel coffecient H_usn[u][s][n];
-  // NOTE Since each of the strongest 2 clusters are divided into 3 sub-clusters,
-  // the total cluster will be numReducedCLuster + 4.
-
-  H_usn.resize (uSize);
-  for (uint64_t uIndex = 0; uIndex < uSize; uIndex++)
-    {
-      H_usn[uIndex].resize (sSize);
-      for (uint64_t sIndex = 0; sIndex < sSize; sIndex++)
-        {
-          H_usn[uIndex][sIndex].resize (channelParams->m_reducedClusterNumber);
-        }
-    }
+ThreeGppChannelModelParam::ChannelJob
+ThreeGppChannelModelParam::PrepareChannel (Ptr<const ThreeGppChannelParams> channelParams,
+                                           Ptr<const ParamsTable> table3gpp,
+                                           const Ptr<const MobilityModel> sMob,
+                                           const Ptr<const MobilityModel> uMob,
+                                           Ptr<const PhasedArrayModel> sAntenna,
+                                           Ptr<const PhasedArrayModel> uAntenna,
+                                           bool isSameDirection) const
+{
+  // if channel params is generated in the same direction in which we
+  // generate the channel matrix, angles and zenit od departure and arrival are ok,
+  // just refer to them with the variables that will be used for the generation
+  // of channel matrix, otherwise we need to flip angles and zenits of departure and arrival
+  const MatrixBasedChannelModel::Double2DVector &rayAodRadian = isSameDirection ? channelParams->m_rayAodRadian : channelParams->m_rayAoaRadian;
+  const MatrixBasedChannelModel::Double2DVector &rayAoaRadian = isSameDirection ? channelParams->m_rayAoaRadian : channelParams->m_rayAodRadian;
+  const MatrixBasedChannelModel::Double2DVector &rayZodRadian = isSameDirection ? channelParams->m_rayZodRadian : channelParams->m_rayZoaRadian;
+  const MatrixBasedChannelModel::Double2DVector &rayZoaRadian = isSameDirection ? channelParams->m_rayZoaRadian : channelParams->m_rayZodRadian;
+
+  ChannelJob job;
+  job.m_uSize = uAntenna->GetNumberOfElements ();
+  job.m_sSize = sAntenna->GetNumberOfElements ();
+  job.m_numClusters = channelParams->m_reducedClusterNumber;
+  job.m_raysPerCluster = table3gpp->m_raysPerCluster;
+  job.m_cluster1st = channelParams->m_cluster1st;
+  job.m_cluster2nd = channelParams->m_cluster2nd;
+  size_t numRays = static_cast<size_t> (job.m_numClusters) * job.m_raysPerCluster;
 
   NS_ASSERT (channelParams->m_reducedClusterNumber <= channelParams->m_clusterPhase.size ());
   NS_ASSERT (channelParams->m_reducedClusterNumber <= channelParams->m_clusterPower.size ());
@@ -172,203 +482,305 @@ ThreeGppChannelModelParam::GetNewChannel (Ptr<const ThreeGppChannelParams> chann
   NS_ASSERT (table3gpp->m_raysPerCluster <= rayAoaRadian[0].size ());
   NS_ASSERT (table3gpp->m_raysPerCluster <= rayAodRadian[0].size ());
 
-  double x = sMob->GetPosition ().x - uMob->GetPosition ().x;
-  double y = sMob->GetPosition ().y - uMob->GetPosition ().y;
-  double distance2D = sqrt (x * x + y * y);
-  // NOTE we assume hUT = min (height(a), height(b)) and
-  // hBS = max (height (a), height (b))
-  double hUt = std::min (sMob->GetPosition ().z, uMob->GetPosition ().z);
-  double hBs = std::max (sMob->GetPosition ().z, uMob->GetPosition ().z);
-  // compute the 3D distance using eq. 7.4-1
-  double distance3D = std::sqrt (distance2D * distance2D + (hBs - hUt) * (hBs - hUt));
+  job.m_uLoc.resize (job.m_uSize);
+  for (uint64_t uIndex = 0; uIndex < job.m_uSize; uIndex++)
+    {
+      job.m_uLoc[uIndex] = uAntenna->GetElementLocation (uIndex);
+    }
+  job.m_sLoc.resize (job.m_sSize);
+  for (uint64_t sIndex = 0; sIndex < job.m_sSize; sIndex++)
+    {
+      job.m_sLoc[sIndex] = sAntenna->GetElementLocation (sIndex);
+    }
+
+  // The terms of each ray r = n * raysPerCluster + m that do not depend on
+  // the antenna elements, computed once: the directions of arrival and
+  // departure scaled by 2 pi (lambda_0 is accounted in the antenna spacing
+  // uLoc and sLoc), and the polarization term of (7.5-22), with the field
+  // patterns, the initial phases and Ro.
+  job.m_rxDirX.resize (numRays);
+  job.m_rxDirY.resize (numRays);
+  job.m_rxDirZ.resize (numRays);
+  job.m_txDirX.resize (numRays);
+  job.m_txDirY.resize (numRays);
+  job.m_txDirZ.resize (numRays);
+  job.m_polarization.resize (numRays);
+  for (uint8_t nIndex = 0; nIndex < job.m_numClusters; nIndex++)
+    {
+      for (uint8_t mIndex = 0; mIndex < job.m_raysPerCluster; mIndex++)
+        {
+          size_t r = static_cast<size_t> (nIndex) * job.m_raysPerCluster + mIndex;
+          double zoa = rayZoaRadian[nIndex][mIndex];
+          double aoa = rayAoaRadian[nIndex][mIndex];
+          double zod = rayZodRadian[nIndex][mIndex];
+          double aod = rayAodRadian[nIndex][mIndex];
+
+          job.m_rxDirX[r] = 2 * M_PI * sin (zoa) * cos (aoa);
+          job.m_rxDirY[r] = 2 * M_PI * sin (zoa) * sin (aoa);
+          job.m_rxDirZ[r] = 2 * M_PI * cos (zoa);
+          job.m_txDirX[r] = 2 * M_PI * sin (zod) * cos (aod);
+          job.m_txDirY[r] = 2 * M_PI * sin (zod) * sin (aod);
+          job.m_txDirZ[r] = 2 * M_PI * cos (zod);
+
+          double Ro = 0;
+          if (m_parametrizedCorrelation)
+            {
+              Ro = m_Ro;
+            }
+          else
+            {
+              double k = channelParams->m_crossPolarizationPowerRatios[nIndex][mIndex];
+              Ro = std::sqrt (1 / k);
+            }
 
-  Angles sAngle (uMob->GetPosition (), sMob->GetPosition ());
-  Angles uAngle (sMob->GetPosition (), uMob->GetPosition ());
+          double rxFieldPatternPhi, rxFieldPatternTheta, txFieldPatternPhi, txFieldPatternTheta;
+          std::tie (rxFieldPatternPhi, rxFieldPatternTheta) = uAntenna->GetElementFieldPattern (Angles (aoa, zoa));
+          std::tie (txFieldPatternPhi, txFieldPatternTheta) = sAntenna->GetElementFieldPattern (Angles (aod, zod));
 
-  // The following for loops computes the channel coefficients
+          const DoubleVector &initialPhase = channelParams->m_clusterPhase[nIndex][mIndex];
+          job.m_polarization[r] = exp (std::complex<double> (0, initialPhase[0])) * rxFieldPatternTheta * txFieldPatternTheta +
+            exp (std::complex<double> (0, initialPhase[1])) * Ro * rxFieldPatternTheta * txFieldPatternPhi +
+            exp (std::complex<double> (0, initialPhase[2])) * Ro * rxFieldPatternPhi * txFieldPatternTheta +
+            exp (std::complex<double> (0, initialPhase[3])) * rxFieldPatternPhi * txFieldPatternPhi;
+        }
+    }
+
+  job.m_clusterScale.resize (job.m_numClusters);
+  for (uint8_t nIndex = 0; nIndex < job.m_numClusters; nIndex++)
+    {
+      job.m_clusterScale[nIndex] = sqrt (channelParams->m_clusterPower[nIndex] / table3gpp->m_raysPerCluster);
+    }
+
+  job.m_los = (channelParams->m_losCondition == ChannelCondition::LOS);
+  if (job.m_los) //(7.5-29) && (7.5-30)
+    {
+      double x = sMob->GetPosition ().x - uMob->GetPosition ().x;
+      double y = sMob->GetPosition ().y - uMob->GetPosition ().y;
+      double distance2D = sqrt (x * x + y * y);
+      // NOTE we assume hUT = min (height(a), height(b)) and
+      // hBS = max (height (a), height (b))
+      double hUt = std::min (sMob->GetPosition ().z, uMob->GetPosition ().z);
+      double hBs = std::max (sMob->GetPosition ().z, uMob->GetPosition ().z);
+      // compute the 3D distance using eq. 7.4-1
+      double distance3D = std::sqrt (distance2D * distance2D + (hBs - hUt) * (hBs - hUt));
+
+      Angles sAngle (uMob->GetPosition (), sMob->GetPosition ());
+      Angles uAngle (sMob->GetPosition (), uMob->GetPosition ());
+
+      job.m_rxLosDir = Vector (2 * M_PI * sin (uAngle.GetInclination ()) * cos (uAngle.GetAzimuth ()),
+                               2 * M_PI * sin (uAngle.GetInclination ()) * sin (uAngle.GetAzimuth ()),
+                               2 * M_PI * cos (uAngle.GetInclination ()));
+      job.m_txLosDir = Vector (2 * M_PI * sin (sAngle.GetInclination ()) * cos (sAngle.GetAzimuth ()),
+                               2 * M_PI * sin (sAngle.GetInclination ()) * sin (sAngle.GetAzimuth ()),
+                               2 * M_PI * cos (sAngle.GetInclination ()));
+
+      double rxFieldPatternPhi, rxFieldPatternTheta, txFieldPatternPhi, txFieldPatternTheta;
+      std::tie (rxFieldPatternPhi, rxFieldPatternTheta) = uAntenna->GetElementFieldPattern (Angles (uAngle.GetAzimuth (), uAngle.GetInclination ()));
+      std::tie (txFieldPatternPhi, txFieldPatternTheta) = sAntenna->GetElementFieldPattern (Angles (sAngle.GetAzimuth (), sAngle.GetInclination ()));
+
+      double lambda = 3e8 / m_frequency; // the wavelength of the carrier frequency
+      job.m_losTerm = (rxFieldPatternTheta * txFieldPatternTheta - rxFieldPatternPhi * txFieldPatternPhi)
+        * exp (std::complex<double> (0, -2 * M_PI * distance3D / lambda));
+      job.m_kLinear = pow (10, channelParams->m_K_factor / 10);
+      // the LOS path should be attenuated if blockage is enabled.
+      job.m_losAttenuation = pow (10, channelParams->m_attenuation_dB[0] / 10);
+    }
+
+  return job;
+}
+
+void
+ThreeGppChannelModelParam::ComputeChannel (const ChannelJob &job, Complex3DVector *channel)
+{
+  //Step 11: Generate channel coefficients for each cluster n and each receiver
+  // and transmitter element pair u,s.
+
+  uint64_t uSize = job.m_uSize;
+  uint64_t sSize = job.m_sSize;
+  uint8_t numClusters = job.m_numClusters;
+  uint8_t raysPerCluster = job.m_raysPerCluster;
+  size_t numRays = static_cast<size_t> (numClusters) * raysPerCluster;
+
+  // NOTE Since each of the strongest 2 clusters are divided into 3 sub-clusters,
+  // the total cluster will be numReducedCLuster + 4: H_usn[u][s] holds the
+  // clusters, then the sub-clusters 2 and 3 of the strongest ones, in the
+  // order of their index.
+  std::vector<size_t> subClusterSlot (numClusters, 0);
+  size_t numSlots = numClusters;
+  for (uint8_t nIndex = 0; nIndex < numClusters; nIndex++)
+    {
+      if (nIndex == job.m_cluster1st || nIndex == job.m_cluster2nd)
+        {
+          subClusterSlot[nIndex] = numSlots;
+          numSlots += 2;
+        }
+    }
+
+  // The sub-cluster of each ray of the strongest clusters (7.5-28)
+  std::vector<uint8_t> subClusterOfRay (raysPerCluster, 0);
+  for (uint8_t mIndex = 0; mIndex < raysPerCluster; mIndex++)
+    {
+      switch (mIndex)
+        {
+          case 9:
+          case 10:
+          case 11:
+          case 12:
+          case 17:
+          case 18:
+            subClusterOfRay[mIndex] = 1;
+            break;
+          case 13:
+          case 14:
+          case 15:
+          case 16:
+            subClusterOfRay[mIndex] = 2;
+            break;
+          default:                      //case 1,2,3,4,5,6,7,8,19,20
+            subClusterOfRay[mIndex] = 0;
+            break;
+        }
+    }
+
+  // The phase term of each ray at each element, from the dot product of its
+  // direction with the element location. The receive terms, with the
+  // polarization folded in, are stored [u][r]; the transmit ones [r][s], in
+  // real and imaginary parts, so that the sum over the rays below is a loop
+  // over contiguous doubles for all the transmit elements at once.
+  std::vector<double> phases (numRays);
+  std::vector<std::complex<double>> rxTerms (uSize * numRays);
   for (uint64_t uIndex = 0; uIndex < uSize; uIndex++)
     {
-      Vector uLoc = uAntenna->GetElementLocation (uIndex);
+      const Vector &uLoc = job.m_uLoc[uIndex];
+      for (size_t r = 0; r < numRays; r++)
+        {
+          phases[r] = job.m_rxDirX[r] * uLoc.x + job.m_rxDirY[r] * uLoc.y + job.m_rxDirZ[r] * uLoc.z;
+        }
+      for (size_t r = 0; r < numRays; r++)
+        {
+          rxTerms[uIndex * numRays + r] = job.m_polarization[r] * std::polar (1.0, phases[r]);
+        }
+    }
 
-      for (uint64_t sIndex = 0; sIndex < sSize; sIndex++)
+  std::vector<double> txTermsRe (numRays * sSize);
+  std::vector<double> txTermsIm (numRays * sSize);
+  for (uint64_t sIndex = 0; sIndex < sSize; sIndex++)
+    {
+      const Vector &sLoc = job.m_sLoc[sIndex];
+      for (size_t r = 0; r < numRays; r++)
+        {
+          phases[r] = job.m_txDirX[r] * sLoc.x + job.m_txDirY[r] * sLoc.y + job.m_txDirZ[r] * sLoc.z;
+        }
+      for (size_t r = 0; r < numRays; r++)
         {
+          txTermsRe[r * sSize + sIndex] = cos (phases[r]);
+          txTermsIm[r * sSize + sIndex] = sin (phases[r]);
+        }
+    }
 
-          Vector sLoc = sAntenna->GetElementLocation (sIndex);
+  // channel coffecients H_usn[u][s][n], in a contiguous buffer
+  std::vector<std::complex<double>> H_usn (uSize * sSize * numSlots);
+  // the sums over the rays of the (sub-)clusters, for all the transmit elements
+  std::vector<double> sumRe (3 * sSize);
+  std::vector<double> sumIm (3 * sSize);
 
-          for (uint8_t nIndex = 0; nIndex < channelParams->m_reducedClusterNumber; nIndex++)
+  // The following for loops computes the channel coefficients
+  for (uint64_t uIndex = 0; uIndex < uSize; uIndex++)
+    {
+      for (uint8_t nIndex = 0; nIndex < numClusters; nIndex++)
+        {
+          //Compute the N-2 weakest cluster, assuming 0 slant angle and a
+          //polarization slant angle configured in the array (7.5-22), and
+          //the 3 sub-clusters of the strongest ones (7.5-28)
+          bool strongest = (nIndex == job.m_cluster1st || nIndex == job.m_cluster2nd);
+          std::fill (sumRe.begin (), sumRe.end (), 0.0);
+          std::fill (sumIm.begin (), sumIm.end (), 0.0);
+
+          for (uint8_t mIndex = 0; mIndex < raysPerCluster; mIndex++)
             {
-              //Compute the N-2 weakest cluster, assuming 0 slant angle and a
-              //polarization slant angle configured in the array (7.5-22)
-              if (nIndex != channelParams->m_cluster1st && nIndex != channelParams->m_cluster2nd)
+              size_t r = static_cast<size_t> (nIndex) * raysPerCluster + mIndex;
+              double rxRe = rxTerms[uIndex * numRays + r].real ();
+              double rxIm = rxTerms[uIndex * numRays + r].imag ();
+              const double *txRe = &txTermsRe[r * sSize];
+              const double *txIm = &txTermsIm[r * sSize];
+              size_t offset = strongest ? subClusterOfRay[mIndex] * sSize : 0;
+              double *accRe = &sumRe[offset];
+              double *accIm = &sumIm[offset];
+              // NOTE Doppler is computed in the CalcBeamformingGain function and is simplified to only account for the center angle of each cluster.
+              for (uint64_t sIndex = 0; sIndex < sSize; sIndex++)
                 {
-                  std::complex<double> rays (0,0);
-                  for (uint8_t mIndex = 0; mIndex < table3gpp->m_raysPerCluster; mIndex++)
-                    {
-                      DoubleVector initialPhase = channelParams->m_clusterPhase[nIndex][mIndex];
-
-                      double Ro = 0;
-                      if (m_parametrizedCorrelation)
-                        {
-                          Ro = m_Ro;
-                        }
-                      else
-                        {
-                          double k = channelParams->m_crossPolarizationPowerRatios[nIndex][mIndex];
-                          Ro = std::sqrt (1 / k);
-                        }
-
-                      //lambda_0 is accounted in the antenna spacing uLoc and sLoc.
-                      double rxPhaseDiff = 2 * M_PI * (sin (rayZoaRadian[nIndex][mIndex]) * cos (rayAoaRadian[nIndex][mIndex]) * uLoc.x
-                                                       + sin (rayZoaRadian[nIndex][mIndex]) * sin (rayAoaRadian[nIndex][mIndex]) * uLoc.y
-                                                       + cos (rayZoaRadian[nIndex][mIndex]) * uLoc.z);
-
-                      double txPhaseDiff = 2 * M_PI * (sin (rayZodRadian[nIndex][mIndex]) * cos (rayAodRadian[nIndex][mIndex]) * sLoc.x
-                                                       + sin (rayZodRadian[nIndex][mIndex]) * sin (rayAodRadian[nIndex][mIndex]) * sLoc.y
-                                                       + cos (rayZodRadian[nIndex][mIndex]) * sLoc.z);
-                      // NOTE Doppler is computed in the CalcBeamformingGain function and is simplified to only account for the center angle of each cluster.
-
-                      double rxFieldPatternPhi, rxFieldPatternTheta, txFieldPatternPhi, txFieldPatternTheta;
-                      std::tie (rxFieldPatternPhi, rxFieldPatternTheta) = uAntenna->GetElementFieldPattern (Angles (rayAoaRadian[nIndex][mIndex], rayZoaRadian[nIndex][mIndex]));
-                      std::tie (txFieldPatternPhi, txFieldPatternTheta) = sAntenna->GetElementFieldPattern (Angles (rayAodRadian[nIndex][mIndex], rayZodRadian[nIndex][mIndex]));
-
-                      rays += (exp (std::complex<double> (0, initialPhase[0])) * rxFieldPatternTheta * txFieldPatternTheta +
-                               +exp (std::complex<double> (0, initialPhase[1])) * Ro * rxFieldPatternTheta * txFieldPatternPhi +
-                               +exp (std::complex<double> (0, initialPhase[2])) * Ro * rxFieldPatternPhi * txFieldPatternTheta +
-                               +exp (std::complex<double> (0, initialPhase[3])) * rxFieldPatternPhi * txFieldPatternPhi)
-                        * exp (std::complex<double> (0, rxPhaseDiff))
-                        * exp (std::complex<double> (0, txPhaseDiff));
-                    }
-                  rays *= sqrt (channelParams->m_clusterPower[nIndex] / table3gpp->m_raysPerCluster);
-                  H_usn[uIndex][sIndex][nIndex] = rays;
-                }
-              else  //(7.5-28)
-                {
-                  std::complex<double> raysSub1 (0,0);
-                  std::complex<double> raysSub2 (0,0);
-                  std::complex<double> raysSub3 (0,0);
-
-                  for (uint8_t mIndex = 0; mIndex < table3gpp->m_raysPerCluster; mIndex++)
-                    {
-                      double Ro = 0;
-                      if (m_parametrizedCorrelation)
-                        {
-                          Ro = m_Ro;
-                        }
-                      else
-                        {
-                          double k = channelParams->m_crossPolarizationPowerRatios[nIndex][mIndex];
-                          Ro = std::sqrt (1 / k);
-                        }
-
-                      //ZML:Just remind me that the angle offsets for the 3 subclusters were not generated correctly.
-
-                      DoubleVector initialPhase = channelParams->m_clusterPhase[nIndex][mIndex];
-                      double rxPhaseDiff = 2 * M_PI * (sin (rayZoaRadian[nIndex][mIndex]) * cos (rayAoaRadian[nIndex][mIndex]) * uLoc.x
-                                                       + sin (rayZoaRadian[nIndex][mIndex]) * sin (rayAoaRadian[nIndex][mIndex]) * uLoc.y
-                                                       + cos (rayZoaRadian[nIndex][mIndex]) * uLoc.z);
-                      double txPhaseDiff = 2 * M_PI * (sin (rayZodRadian[nIndex][mIndex]) * cos (rayAodRadian[nIndex][mIndex]) * sLoc.x
-                                                       + sin (rayZodRadian[nIndex][mIndex]) * sin (rayAodRadian[nIndex][mIndex]) * sLoc.y
-                                                       + cos (rayZodRadian[nIndex][mIndex]) * sLoc.z);
-
-                      double rxFieldPatternPhi, rxFieldPatternTheta, txFieldPatternPhi, txFieldPatternTheta;
-                      std::tie (rxFieldPatternPhi, rxFieldPatternTheta) = uAntenna->GetElementFieldPattern (Angles (rayAoaRadian[nIndex][mIndex], rayZoaRadian[nIndex][mIndex]));
-                      std::tie (txFieldPatternPhi, txFieldPatternTheta) = sAntenna->GetElementFieldPattern (Angles (rayAodRadian[nIndex][mIndex], rayZodRadian[nIndex][mIndex]));
-
-                      switch (mIndex)
-                        {
-                          case 9:
-                          case 10:
-                          case 11:
-                          case 12:
-                          case 17:
-                          case 18:
-                            raysSub2 += (exp (std::complex<double> (0, initialPhase[0])) * rxFieldPatternTheta * txFieldPatternTheta +
-                                         +exp (std::complex<double> (0, initialPhase[1])) * Ro * rxFieldPatternTheta * txFieldPatternPhi +
-                                         +exp (std::complex<double> (0, initialPhase[2])) * Ro * rxFieldPatternPhi * txFieldPatternTheta +
-                                         +exp (std::complex<double> (0, initialPhase[3])) * rxFieldPatternPhi * txFieldPatternPhi)
-                              * exp (std::complex<double> (0, rxPhaseDiff))
-                              * exp (std::complex<double> (0, txPhaseDiff));
-                            break;
-                          case 13:
-                          case 14:
-                          case 15:
-                          case 16:
-                            raysSub3 += (exp (std::complex<double> (0, initialPhase[0])) * rxFieldPatternTheta * txFieldPatternTheta +
-                                         +exp (std::complex<double> (0, initialPhase[1])) * Ro * rxFieldPatternTheta * txFieldPatternPhi +
-                                         +exp (std::complex<double> (0, initialPhase[2])) * Ro * rxFieldPatternPhi * txFieldPatternTheta +
-                                         +exp (std::complex<double> (0, initialPhase[3])) * rxFieldPatternPhi * txFieldPatternPhi)
-                              * exp (std::complex<double> (0, rxPhaseDiff))
-                              * exp (std::complex<double> (0, txPhaseDiff));
-                            break;
-                          default:                      //case 1,2,3,4,5,6,7,8,19,20
-                            raysSub1 += (exp (std::complex<double> (0, initialPhase[0])) * rxFieldPatternTheta * txFieldPatternTheta +
-                                         +exp (std::complex<double> (0, initialPhase[1])) * Ro * rxFieldPatternTheta * txFieldPatternPhi +
-                                         +exp (std::complex<double> (0, initialPhase[2])) * Ro * rxFieldPatternPhi * txFieldPatternTheta +
-                                         +exp (std::complex<double> (0, initialPhase[3])) * rxFieldPatternPhi * txFieldPatternPhi)
-                              * exp (std::complex<double> (0, rxPhaseDiff))
-                              * exp (std::complex<double> (0, txPhaseDiff));
-                            break;
-                        }
-                    }
-                  raysSub1 *= sqrt (channelParams->m_clusterPower[nIndex] / table3gpp->m_raysPerCluster);
-                  raysSub2 *= sqrt (channelParams->m_clusterPower[nIndex] / table3gpp->m_raysPerCluster);
-                  raysSub3 *= sqrt (channelParams->m_clusterPower[nIndex] / table3gpp->m_raysPerCluster);
-                  H_usn[uIndex][sIndex][nIndex] = raysSub1;
-                  H_usn[uIndex][sIndex].push_back (raysSub2);
-                  H_usn[uIndex][sIndex].push_back (raysSub3);
-
-                  NS_LOG_DEBUG ("H_usn[uIndex][sIndex][nIndex]:"<< H_usn[uIndex][sIndex][nIndex]<< " uIndex:"<<uIndex<<", sIndex:"<<sIndex<<"nIndex:"<< +nIndex);
+                  accRe[sIndex] += rxRe * txRe[sIndex] - rxIm * txIm[sIndex];
+                  accIm[sIndex] += rxRe * txIm[sIndex] + rxIm * txRe[sIndex];
                 }
             }
-          if (channelParams->m_losCondition == ChannelCondition::LOS) //(7.5-29) && (7.5-30)
+
+          double clusterScale = job.m_clusterScale[nIndex];
+          for (uint64_t sIndex = 0; sIndex < sSize; sIndex++)
             {
-              std::complex<double> ray (0,0);
-              double rxPhaseDiff = 2 * M_PI * (sin (uAngle.GetInclination ()) * cos (uAngle.GetAzimuth ()) * uLoc.x
-                                               + sin (uAngle.GetInclination ()) * sin (uAngle.GetAzimuth ()) * uLoc.y
-                                               + cos (uAngle.GetInclination ()) * uLoc.z);
-              double txPhaseDiff = 2 * M_PI * (sin (sAngle.GetInclination ()) * cos (sAngle.GetAzimuth ()) * sLoc.x
-                                               + sin (sAngle.GetInclination ()) * sin (sAngle.GetAzimuth ()) * sLoc.y
-                                               + cos (sAngle.GetInclination ()) * sLoc.z);
-
-              double rxFieldPatternPhi, rxFieldPatternTheta, txFieldPatternPhi, txFieldPatternTheta;
-              std::tie (rxFieldPatternPhi, rxFieldPatternTheta) = uAntenna->GetElementFieldPattern (Angles (uAngle.GetAzimuth (), uAngle.GetInclination ()));
-              std::tie (txFieldPatternPhi, txFieldPatternTheta) = sAntenna->GetElementFieldPattern (Angles (sAngle.GetAzimuth (), sAngle.GetInclination ()));
-
-              double lambda = 3e8 / m_frequency; // the wavelength of the carrier frequency
-
-              ray = (rxFieldPatternTheta * txFieldPatternTheta - rxFieldPatternPhi * txFieldPatternPhi)
-                * exp (std::complex<double> (0, -2 * M_PI * distance3D / lambda))
-                * exp (std::complex<double> (0, rxPhaseDiff))
-                * exp (std::complex<double> (0, txPhaseDiff));
-
-              double K_linear = pow (10, channelParams->m_K_factor / 10);
-              // the LOS path should be attenuated if blockage is enabled.
-              H_usn[uIndex][sIndex][0] = sqrt (1 / (K_linear + 1)) * H_usn[uIndex][sIndex][0] + sqrt (K_linear / (1 + K_linear)) * ray / pow (10, channelParams->m_attenuation_dB[0] / 10);           //(7.5-30) for tau = tau1
-              double tempSize = H_usn[uIndex][sIndex].size ();
-              for (uint8_t nIndex = 1; nIndex < tempSize; nIndex++)
+              std::complex<double> *h = &H_usn[(uIndex * sSize + sIndex) * numSlots];
+              h[nIndex] = std::complex<double> (sumRe[sIndex], sumIm[sIndex]) * clusterScale;
+              if (strongest)
                 {
-                  H_usn[uIndex][sIndex][nIndex] *= sqrt (1 / (K_linear + 1)); //(7.5-30) for tau = tau2...taunN
-                  NS_LOG_DEBUG ("LOS H_usn[uIndex][sIndex][nIndex]:"<< H_usn[uIndex][sIndex][nIndex]<< " uIndex:"<<uIndex<<", sIndex:"<<sIndex<<"nIndex:"<< +nIndex);
+                  size_t slot = subClusterSlot[nIndex];
+                  h[slot] = std::complex<double> (sumRe[sSize + sIndex], sumIm[sSize + sIndex]) * clusterScale;
+                  h[slot + 1] = std::complex<double> (sumRe[2 * sSize + sIndex], sumIm[2 * sSize + sIndex]) * clusterScale;
+                  NS_LOG_DEBUG ("H_usn[uIndex][sIndex][nIndex]:"<< h[nIndex]<< " uIndex:"<<uIndex<<", sIndex:"<<sIndex<<"nIndex:"<< +nIndex);
                 }
-
             }
         }
     }
 
-  NS_LOG_DEBUG ("Husn (sAntenna, uAntenna):" << sAntenna->GetId () << ", " << uAntenna->GetId ());
-  for (auto& i:H_usn)
+  if (job.m_los) //(7.5-29) && (7.5-30)
     {
-      for (auto& j:i)
+      std::vector<std::complex<double>> rxLosTerms (uSize);
+      for (uint64_t uIndex = 0; uIndex < uSize; uIndex++)
+        {
+          const Vector &uLoc = job.m_uLoc[uIndex];
+          double rxPhaseDiff = job.m_rxLosDir.x * uLoc.x + job.m_rxLosDir.y * uLoc.y + job.m_rxLosDir.z * uLoc.z;
+          rxLosTerms[uIndex] = exp (std::complex<double> (0, rxPhaseDiff));
+        }
+      std::vector<std::complex<double>> txLosTerms (sSize);
+      for (uint64_t sIndex = 0; sIndex < sSize; sIndex++)
+        {
+          const Vector &sLoc = job.m_sLoc[sIndex];
+          double txPhaseDiff = job.m_txLosDir.x * sLoc.x + job.m_txLosDir.y * sLoc.y + job.m_txLosDir.z * sLoc.z;
+          txLosTerms[sIndex] = exp (std::complex<double> (0, txPhaseDiff));
+        }
+
+      double K_linear = job.m_kLinear;
+      for (uint64_t uIndex = 0; uIndex < uSize; uIndex++)
         {
-          for (auto& k:j)
+          for (uint64_t sIndex = 0; sIndex < sSize; sIndex++)
             {
-              NS_LOG_DEBUG (" " << k << ",");
+              std::complex<double> *h = &H_usn[(uIndex * sSize + sIndex) * numSlots];
+              std::complex<double> ray = job.m_losTerm * rxLosTerms[uIndex] * txLosTerms[sIndex];
+              h[0] = sqrt (1 / (K_linear + 1)) * h[0] + sqrt (K_linear / (1 + K_linear)) * ray / job.m_losAttenuation;           //(7.5-30) for tau = tau1
+              for (size_t nIndex = 1; nIndex < numSlots; nIndex++)
+                {
+                  h[nIndex] *= sqrt (1 / (K_linear + 1)); //(7.5-30) for tau = tau2...taunN
+                  NS_LOG_DEBUG ("LOS H_usn[uIndex][sIndex][nIndex]:"<< h[nIndex]<< " uIndex:"<<uIndex<<", sIndex:"<<sIndex<<"nIndex:"<< +nIndex);
+                }
             }
         }
     }
-  NS_LOG_INFO ("size of coefficient matrix =[" << H_usn.size () << "][" << H_usn[0].size () << "][" << H_usn[0][0].size () << "]");
-  channelMatrix->m_channel = H_usn;
-  return channelMatrix;
+
+  for (auto& k:H_usn)
+    {
+      NS_LOG_DEBUG (" " << k << ",");
+    }
+  NS_LOG_INFO ("size of coefficient matrix =[" << uSize << "][" << sSize << "][" << numSlots << "]");
+
+  // the channel matrix keeps the nested vectors read by the spectrum model
+  channel->resize (uSize);
+  for (uint64_t uIndex = 0; uIndex < uSize; uIndex++)
+    {
+      (*channel)[uIndex].resize (sSize);
+      for (uint64_t sIndex = 0; sIndex < sSize; sIndex++)
+        {
+          auto first = H_usn.begin () + (uIndex * sSize + sIndex) * numSlots;
+          (*channel)[uIndex][sIndex].assign (first, first + numSlots);
+        }
+    }
 }
 
 }  // namespace ns3
@@ -30,8 +30,11 @@
 #include <ns3/random-variable-stream.h>
 #include <ns3/boolean.h>
 #include <unordered_map>
+#include <complex>
+#include <vector>
 #include <ns3/channel-condition-model.h>
 #include <ns3/three-gpp-channel-model.h>
+#include "ns3/nr-channel-recording.h"
 
 namespace ns3 {
 
@@ -69,8 +72,214 @@ public:
 
   void SetRo (double ro);
 
+  /**
+   * \brief Set the number of threads that compute the channel matrices of a prefetch
+   *
+   * When greater than 0, the links whose update period is over are all
+   * regenerated at the first request after the end of the update period of
+   * one of them: their parameters are drawn serially, in the order in which
+   * the links were first requested, and their coefficients are computed on
+   * numWorkers threads, the simulation thread included. The channels do not
+   * depend on the number of workers. When 0 (default), each channel is
+   * generated when it is requested. Enabling the prefetch changes the
+   * results with respect to 0, as the links are regenerated at other
+   * instants and their parameters are drawn in another order.
+   *
+   * \param numWorkers the number of workers
+   */
+  void SetNumPrefetchWorkers (uint32_t numWorkers);
+
+  /**
+   * \return the number of threads that compute the channel matrices of a prefetch
+   */
+  uint32_t GetNumPrefetchWorkers () const;
+
+  /**
+   * \brief Set whether each link is regenerated after its own update period,
+   * from the relative speed of its ends
+   *
+   * When enabled, the UpdatePeriod attribute is replaced, for each link, by
+   * the time its ends take to move by the update distance relative to each
+   * other (see SetUpdateDistance), and not less than MinUpdatePeriod. The
+   * links between static nodes are then only regenerated when their channel
+   * condition changes, and the fast ones as often as their speed requires.
+   *
+   * \param enabled true to enable the speed-adaptive update periods
+   */
+  void SetSpeedAdaptiveUpdate (bool enabled);
+
+  /**
+   * \return true if the update period of each link depends on its speed
+   */
+  bool GetSpeedAdaptiveUpdate () const;
+
+  /**
+   * \brief Set the distance that the ends of a link may move relative to each
+   * other before it is regenerated, with the speed-adaptive update periods
+   *
+   * When 0 (default), it is the correlation distance of the cluster-specific
+   * parameters of TR 38.901 Table 7.6.3.1-2 for the scenario and the LOS
+   * condition of the link, which is only given for RMa, UMa,
+   * UMi-StreetCanyon and InH.
+   *
+   * \param distance the distance (m)
+   */
+  void SetUpdateDistance (double distance);
+
+  /**
+   * \return the distance that the ends of a link may move relative to each
+   * other before it is regenerated (m), 0 for the 38.901 correlation distance
+   */
+  double GetUpdateDistance () const;
+
+  /**
+   * \param aMob mobility model of the a device
+   * \param bMob mobility model of the b device
+   * \return the update period of the link between them, zero if it is not
+   * regenerated over time
+   */
+  Time GetLinkUpdatePeriod (Ptr<const MobilityModel> aMob, Ptr<const MobilityModel> bMob) const;
+
+  /**
+   * Looks for the channel matrix associated to the aMob and bMob pair in
+   * m_channelMap, as ThreeGppChannelModel::GetChannel, after regenerating
+   * all the links that are due for an update when prefetching is enabled,
+   * and writes it to the RecordFileName file if it is new
+   *
+   * \param aMob mobility model of the a device
+   * \param bMob mobility model of the b device
+   * \param aAntenna antenna of the a device
+   * \param bAntenna antenna of the b device
+   * \return the channel matrix
+   */
+  Ptr<const ChannelMatrix> GetChannel (Ptr<const MobilityModel> aMob,
+                                       Ptr<const MobilityModel> bMob,
+                                       Ptr<const PhasedArrayModel> aAntenna,
+                                       Ptr<const PhasedArrayModel> bAntenna) override;
 
 private:
+  /**
+   * \brief What is needed to compute the coefficients of a channel matrix,
+   * without touching any simulation object
+   */
+  struct ChannelJob
+  {
+    uint64_t m_uSize {0};                  //!< Number of elements of the array of node u
+    uint64_t m_sSize {0};                  //!< Number of elements of the array of node s
+    uint8_t m_numClusters {0};             //!< Number of clusters
+    uint8_t m_raysPerCluster {0};          //!< Number of rays per cluster
+    uint8_t m_cluster1st {0};              //!< Index of the strongest cluster
+    uint8_t m_cluster2nd {0};              //!< Index of the second strongest cluster
+    std::vector<Vector> m_uLoc;            //!< Location of the elements of node u
+    std::vector<Vector> m_sLoc;            //!< Location of the elements of node s
+    std::vector<double> m_rxDirX;          //!< Arrival direction of each ray, times 2 pi (x)
+    std::vector<double> m_rxDirY;          //!< Arrival direction of each ray, times 2 pi (y)
+    std::vector<double> m_rxDirZ;          //!< Arrival direction of each ray, times 2 pi (z)
+    std::vector<double> m_txDirX;          //!< Departure direction of each ray, times 2 pi (x)
+    std::vector<double> m_txDirY;          //!< Departure direction of each ray, times 2 pi (y)
+    std::vector<double> m_txDirZ;          //!< Departure direction of each ray, times 2 pi (z)
+    std::vector<std::complex<double>> m_polarization; //!< Polarization term of each ray
+    std::vector<double> m_clusterScale;    //!< Amplitude of the rays of each cluster
+    bool m_los {false};                    //!< True if the LOS component is added
+    Vector m_rxLosDir;                     //!< Arrival direction of the LOS path, times 2 pi
+    Vector m_txLosDir;                     //!< Departure direction of the LOS path, times 2 pi
+    std::complex<double> m_losTerm;        //!< Field pattern and phase term of the LOS path
+    double m_kLinear {0.0};                //!< Linear K factor
+    double m_losAttenuation {1.0};         //!< Linear attenuation of the LOS path
+    Ptr<ChannelMatrix> m_matrix;           //!< The matrix to fill, for a prefetch
+  };
+
+  /**
+   * \brief A link that was requested, to be regenerated by a prefetch
+   */
+  struct Link
+  {
+    Ptr<const MobilityModel> m_aMob;        //!< Mobility model of the a device
+    Ptr<const MobilityModel> m_bMob;        //!< Mobility model of the b device
+    Ptr<const PhasedArrayModel> m_aAntenna; //!< Antenna of the a device
+    Ptr<const PhasedArrayModel> m_bAntenna; //!< Antenna of the b device
+    Time m_generatedTime;                   //!< When its channel matrix was generated
+  };
+
+  /**
+   * \brief ThreeGppChannelModel::GetChannel, with the update period of the link
+   * \param aMob mobility model of the a device
+   * \param bMob mobility model of the b device
+   * \param aAntenna antenna of the a device
+   * \param bAntenna antenna of the b device
+   * \return the channel matrix
+   */
+  Ptr<const ChannelMatrix> GetLinkChannel (Ptr<const MobilityModel> aMob,
+                                           Ptr<const MobilityModel> bMob,
+                                           Ptr<const PhasedArrayModel> aAntenna,
+                                           Ptr<const PhasedArrayModel> bAntenna);
+
+  /**
+   * \brief GetChannel, when prefetching is enabled
+   * \param aMob mobility model of the a device
+   * \param bMob mobility model of the b device
+   * \param aAntenna antenna of the a device
+   * \param bAntenna antenna of the b device
+   * \return the channel matrix
+   */
+  Ptr<const ChannelMatrix> GetPrefetchedChannel (Ptr<const MobilityModel> aMob,
+                                                 Ptr<const MobilityModel> bMob,
+                                                 Ptr<const PhasedArrayModel> aAntenna,
+                                                 Ptr<const PhasedArrayModel> bAntenna);
+
+  /**
+   * \brief Write a channel matrix and its parameters to the recording, if it
+   * was not written yet
+   * \param aMob mobility model of the a device
+   * \param bMob mobility model of the b device
+   * \param channelMatrix the channel matrix returned for them
+   */
+  void RecordChannel (Ptr<const MobilityModel> aMob,
+                      Ptr<const MobilityModel> bMob,
+                      Ptr<const ChannelMatrix> channelMatrix);
+
+  /**
+   * \return the value of the attribute UpdatePeriod
+   */
+  Time GetUpdatePeriod () const;
+
+  /**
+   * \brief Regenerate all the links whose update period is over
+   */
+  void Prefetch ();
+
+  /**
+   * \brief Compute the coefficients of the channels prepared by a prefetch
+   * on the worker threads
+   */
+  void ComputePendingChannels ();
+
+  /**
+   * \brief Read from the simulation objects what is needed to compute the
+   * channel matrix, and compute the terms that do not depend on the elements
+   * \param channelParams the channel parameters
+   * \param table3gpp the 3gpp parameters table
+   * \param sMob the mobility model of node s
+   * \param uMob the mobility model of node u
+   * \param sAntenna the antenna array of node s
+   * \param uAntenna the antenna array of node u
+   * \param isSameDirection true if the parameters were generated from s to u
+   * \return the job that computes the channel matrix
+   */
+  ChannelJob PrepareChannel (Ptr<const ThreeGppChannelParams> channelParams,
+                             Ptr<const ParamsTable> table3gpp,
+                             const Ptr<const MobilityModel> sMob,
+                             const Ptr<const MobilityModel> uMob,
+                             Ptr<const PhasedArrayModel> sAntenna,
+                             Ptr<const PhasedArrayModel> uAntenna,
+                             bool isSameDirection) const;
+
+  /**
+   * \brief Compute the coefficients of a channel matrix. Thread safe.
+   * \param job the job prepared by PrepareChannel
+   * \param channel the coefficients H_usn[u][s][n]
+   */
+  static void ComputeChannel (const ChannelJob &job, Complex3DVector *channel);
 
   /**
    * Compute the channel matrix between two devices using the procedure
@@ -92,6 +301,22 @@ private:
 
   double m_Ro {1.0}; //!< cross polarization correlation parameter
   double m_parametrizedCorrelation {true}; //!< whether the parameter Ro will be used as correlation term
+
+  uint32_t m_numPrefetchWorkers {0};        //!< Number of threads of a prefetch, 0 to disable it
+  std::vector<Link> m_links;                //!< The links requested, in the order of the first request
+  std::unordered_map<uint64_t, size_t> m_linkIndex; //!< Index in m_links of each pair of antennas
+  Time m_nextPrefetch {Time::Max ()};       //!< After this time, a link is due for an update
+  bool m_prefetching {false};               //!< True while a prefetch draws the parameters
+  mutable std::vector<ChannelJob> m_pendingChannels; //!< Channels prepared by the current prefetch
+
+  bool m_speedAdaptiveUpdate {false};       //!< True if the update period of each link depends on its speed
+  double m_updateDistance {0.0};            //!< The relative move after which a link is regenerated (m), 0 for 38.901
+  Time m_minUpdatePeriod {MilliSeconds (1)}; //!< The shortest speed-adaptive update period (attribute)
+  Time m_baseUpdatePeriod {Time::Max ()};   //!< The update period last given to ThreeGppChannelModel
+
+  std::string m_recordFileName;             //!< The file of the recording, empty to disable it (attribute)
+  NrChannelRecorder m_recorder;             //!< The recording, opened at the first request
+  std::unordered_map<uint64_t, Time> m_recordedTimes; //!< Generation time of the last matrix written, for each pair of antennas
 };
 } // namespace ns3
 
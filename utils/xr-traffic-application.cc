@@ -0,0 +1,493 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "xr-traffic-application.h"
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/double.h>
+#include <ns3/inet-socket-address.h>
+#include <ns3/inet6-socket-address.h>
+#include <ns3/packet.h>
+#include <ns3/random-variable-stream.h>
+#include <ns3/simulator.h>
+#include <ns3/socket.h>
+#include <ns3/trace-source-accessor.h>
+#include <ns3/udp-socket-factory.h>
+#include <ns3/uinteger.h>
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("XrTrafficApplication");
+NS_OBJECT_ENSURE_REGISTERED (XrFrameHeader);
+NS_OBJECT_ENSURE_REGISTERED (XrTrafficApplication);
+NS_OBJECT_ENSURE_REGISTERED (XrTrafficSink);
+
+TypeId
+XrFrameHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::XrFrameHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<XrFrameHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+XrFrameHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+XrFrameHeader::GetSerializedSize (void) const
+{
+  return 16;
+}
+
+void
+XrFrameHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteHtonU32 (m_frameId);
+  start.WriteHtonU16 (m_packetIndex);
+  start.WriteHtonU16 (m_numPackets);
+  start.WriteHtonU64 (static_cast<uint64_t> (m_generation.GetTimeStep ()));
+}
+
+uint32_t
+XrFrameHeader::Deserialize (Buffer::Iterator start)
+{
+  m_frameId = start.ReadNtohU32 ();
+  m_packetIndex = start.ReadNtohU16 ();
+  m_numPackets = start.ReadNtohU16 ();
+  m_generation = TimeStep (static_cast<int64_t> (start.ReadNtohU64 ()));
+  return GetSerializedSize ();
+}
+
+void
+XrFrameHeader::Print (std::ostream &os) const
+{
+  os << "frame=" << m_frameId << " packet=" << m_packetIndex << "/" << m_numPackets
+     << " generation=" << m_generation.As (Time::MS);
+}
+
+// ------------------------------------------------------------------------
+
+XrFrameStats::XrFrameStats (Time binWidth, uint32_t numBins)
+  : m_binWidth (binWidth),
+    m_histogram (numBins, 0)
+{
+  NS_ABORT_MSG_IF (binWidth.IsZero () || numBins == 0, "Invalid histogram");
+}
+
+void
+XrFrameStats::RecordFrame (Time latency, bool onTime)
+{
+  int64_t bin = std::max<int64_t> (latency.GetTimeStep (), 0) / m_binWidth.GetTimeStep ();
+  ++m_histogram[std::min<int64_t> (bin, m_histogram.size () - 1)];
+  ++m_complete;
+  m_onTime += onTime ? 1 : 0;
+  m_latencySum += latency.GetTimeStep ();
+}
+
+void
+XrFrameStats::RecordLostFrames (uint64_t frames)
+{
+  m_lost += frames;
+}
+
+void
+XrFrameStats::Merge (const XrFrameStats &other)
+{
+  NS_ABORT_MSG_IF (other.m_binWidth != m_binWidth || other.m_histogram.size () != m_histogram.size (),
+                   "Merging statistics with different bins");
+  for (size_t i = 0; i < m_histogram.size (); ++i)
+    {
+      m_histogram[i] += other.m_histogram[i];
+    }
+  m_complete += other.m_complete;
+  m_onTime += other.m_onTime;
+  m_lost += other.m_lost;
+  m_latencySum += other.m_latencySum;
+}
+
+uint64_t
+XrFrameStats::GetFrames () const
+{
+  return m_complete + m_lost;
+}
+
+uint64_t
+XrFrameStats::GetFramesOnTime () const
+{
+  return m_onTime;
+}
+
+double
+XrFrameStats::GetReliability () const
+{
+  return GetFrames () == 0 ? 0.0 : static_cast<double> (m_onTime) / GetFrames ();
+}
+
+Time
+XrFrameStats::GetMeanLatency () const
+{
+  return m_complete == 0 ? Time (0) : TimeStep (m_latencySum / static_cast<int64_t> (m_complete));
+}
+
+Time
+XrFrameStats::GetLatencyPercentile (double percentile) const
+{
+  if (m_complete == 0)
+    {
+      return Time (0);
+    }
+  uint64_t target = static_cast<uint64_t> (std::ceil (percentile / 100.0 * m_complete));
+  target = std::max<uint64_t> (target, 1);
+  uint64_t count = 0;
+  for (size_t i = 0; i < m_histogram.size (); ++i)
+    {
+      count += m_histogram[i];
+      if (count >= target)
+        {
+          return m_binWidth * static_cast<int64_t> (i + 1);
+        }
+    }
+  return m_binWidth * static_cast<int64_t> (m_histogram.size ());
+}
+
+// ------------------------------------------------------------------------
+
+TypeId
+XrTrafficApplication::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::XrTrafficApplication")
+    .SetParent<Application> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<XrTrafficApplication> ()
+    .AddAttribute ("Remote", "The address of the destination",
+                   AddressValue (),
+                   MakeAddressAccessor (&XrTrafficApplication::m_peer),
+                   MakeAddressChecker ())
+    .AddAttribute ("Fps", "The frames per second",
+                   DoubleValue (60.0),
+                   MakeDoubleAccessor (&XrTrafficApplication::m_fps),
+                   MakeDoubleChecker<double> (0.1))
+    .AddAttribute ("DataRate", "The mean data rate",
+                   DataRateValue (DataRate ("30Mb/s")),
+                   MakeDataRateAccessor (&XrTrafficApplication::m_dataRate),
+                   MakeDataRateChecker ())
+    .AddAttribute ("FrameSizeStd", "The standard deviation of the frame size, relative to the mean",
+                   DoubleValue (0.105),
+                   MakeDoubleAccessor (&XrTrafficApplication::m_frameSizeStd),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("FrameSizeBound", "The maximum deviation of the frame size from the mean, relative to the mean",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&XrTrafficApplication::m_frameSizeBound),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("JitterStd", "The standard deviation of the jitter of the frames",
+                   TimeValue (MilliSeconds (2)),
+                   MakeTimeAccessor (&XrTrafficApplication::m_jitterStd),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("JitterBound", "The maximum jitter of the frames",
+                   TimeValue (MilliSeconds (4)),
+                   MakeTimeAccessor (&XrTrafficApplication::m_jitterBound),
+                   MakeTimeChecker (Time (0)))
+    .AddAttribute ("PacketSize", "The maximum size of a packet, XrFrameHeader included",
+                   UintegerValue (1500),
+                   MakeUintegerAccessor (&XrTrafficApplication::m_packetSize),
+                   MakeUintegerChecker<uint32_t> (17))
+    .AddTraceSource ("TxFrame", "A frame is generated and its packets are sent",
+                     MakeTraceSourceAccessor (&XrTrafficApplication::m_txFrameTrace),
+                     "ns3::XrTrafficApplication::FrameTracedCallback")
+  ;
+  return tid;
+}
+
+XrTrafficApplication::XrTrafficApplication ()
+{
+  NS_LOG_FUNCTION (this);
+  m_frameSize = CreateObject<NormalRandomVariable> ();
+  m_jitter = CreateObject<NormalRandomVariable> ();
+}
+
+XrTrafficApplication::~XrTrafficApplication ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+int64_t
+XrTrafficApplication::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_frameSize->SetStream (stream);
+  m_jitter->SetStream (stream + 1);
+  return 2;
+}
+
+void
+XrTrafficApplication::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_socket = nullptr;
+  Application::DoDispose ();
+}
+
+void
+XrTrafficApplication::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_frameSize->SetAttribute ("Mean", DoubleValue (1.0));
+  m_frameSize->SetAttribute ("Variance", DoubleValue (m_frameSizeStd * m_frameSizeStd));
+  m_frameSize->SetAttribute ("Bound", DoubleValue (m_frameSizeBound));
+  double jitterStd = m_jitterStd.GetSeconds ();
+  m_jitter->SetAttribute ("Mean", DoubleValue (0.0));
+  m_jitter->SetAttribute ("Variance", DoubleValue (jitterStd * jitterStd));
+  m_jitter->SetAttribute ("Bound", DoubleValue (m_jitterBound.GetSeconds ()));
+
+  m_socket = Socket::CreateSocket (GetNode (), UdpSocketFactory::GetTypeId ());
+  if (Inet6SocketAddress::IsMatchingType (m_peer))
+    {
+      m_socket->Bind6 ();
+    }
+  else
+    {
+      m_socket->Bind ();
+    }
+  m_socket->Connect (m_peer);
+  m_socket->ShutdownRecv ();
+
+  m_tickEvent = Simulator::ScheduleNow (&XrTrafficApplication::Tick, this);
+}
+
+void
+XrTrafficApplication::StopApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_tickEvent.Cancel ();
+  if (m_socket != nullptr)
+    {
+      m_socket->Close ();
+      m_socket = nullptr;
+    }
+}
+
+void
+XrTrafficApplication::Tick ()
+{
+  // The frame is sent in [0, 2 * JitterBound] from the tick, so that the
+  // negative jitter does not need a frame generated in the past
+  double jitter = m_jitterStd.IsZero () ? 0.0 : m_jitter->GetValue ();
+  Simulator::Schedule (m_jitterBound + Seconds (jitter), &XrTrafficApplication::SendFrame, this);
+  m_tickEvent = Simulator::Schedule (Seconds (1.0 / m_fps), &XrTrafficApplication::Tick, this);
+}
+
+void
+XrTrafficApplication::SendFrame ()
+{
+  if (m_socket == nullptr)
+    {
+      return;  // Stopped before the jitter of the last frame elapsed
+    }
+
+  double mean = static_cast<double> (m_dataRate.GetBitRate ()) / 8.0 / m_fps;
+  double factor = m_frameSizeStd > 0.0 ? m_frameSize->GetValue () : 1.0;
+  uint32_t bytes = std::max<uint32_t> (static_cast<uint32_t> (std::round (mean * factor)), 1);
+
+  XrFrameHeader header;
+  const uint32_t payload = m_packetSize - header.GetSerializedSize ();
+  const uint32_t numPackets = (bytes + payload - 1) / payload;
+  NS_ABORT_MSG_IF (numPackets > UINT16_MAX, "Frame of " << bytes << " B in too many packets");
+
+  header.m_frameId = m_nextFrameId++;
+  header.m_numPackets = static_cast<uint16_t> (numPackets);
+  header.m_generation = Simulator::Now ();
+  NS_LOG_INFO ("Frame " << header.m_frameId << " of " << bytes << " B in " << numPackets << " packets");
+  m_txFrameTrace (header.m_frameId, bytes);
+
+  uint32_t left = bytes;
+  for (uint32_t i = 0; i < numPackets; ++i)
+    {
+      header.m_packetIndex = static_cast<uint16_t> (i);
+      Ptr<Packet> packet = Create<Packet> (std::min (left, payload));
+      left -= std::min (left, payload);
+      packet->AddHeader (header);
+      m_socket->Send (packet);
+    }
+}
+
+// ------------------------------------------------------------------------
+
+TypeId
+XrTrafficSink::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::XrTrafficSink")
+    .SetParent<Application> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<XrTrafficSink> ()
+    .AddAttribute ("Local", "The address on which to bind the socket",
+                   AddressValue (),
+                   MakeAddressAccessor (&XrTrafficSink::m_local),
+                   MakeAddressChecker ())
+    .AddAttribute ("PacketDelayBudget", "The time within which a whole frame must arrive",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&XrTrafficSink::m_packetDelayBudget),
+                   MakeTimeChecker ())
+    .AddTraceSource ("RxFrame", "A frame is complete or lost",
+                     MakeTraceSourceAccessor (&XrTrafficSink::m_rxFrameTrace),
+                     "ns3::XrTrafficSink::FrameTracedCallback")
+  ;
+  return tid;
+}
+
+XrTrafficSink::XrTrafficSink ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+XrTrafficSink::~XrTrafficSink ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+XrTrafficSink::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_socket = nullptr;
+  Application::DoDispose ();
+}
+
+void
+XrTrafficSink::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_socket = Socket::CreateSocket (GetNode (), UdpSocketFactory::GetTypeId ());
+  if (m_socket->Bind (m_local) == -1)
+    {
+      NS_FATAL_ERROR ("Failed to bind the socket of XrTrafficSink");
+    }
+  m_socket->ShutdownSend ();
+  m_socket->SetRecvCallback (MakeCallback (&XrTrafficSink::HandleRead, this));
+}
+
+void
+XrTrafficSink::StopApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_socket != nullptr)
+    {
+      m_socket->Close ();
+      m_socket->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+      m_socket = nullptr;
+    }
+
+  for (const auto &it : m_pending)
+    {
+      m_rxFrameTrace (it.first, Time::Max (), false);
+    }
+  m_stats.RecordLostFrames (m_pending.size ());
+  m_pending.clear ();
+  uint64_t missing = std::count (m_seen.begin (), m_seen.end (), false);
+  m_stats.RecordLostFrames (missing);
+  NS_LOG_INFO ("Frames " << m_stats.GetFrames () << ", on time " << m_stats.GetFramesOnTime ()
+                         << ", never seen " << missing);
+}
+
+void
+XrTrafficSink::HandleRead (Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  Address from;
+  while ((packet = socket->RecvFrom (from)))
+    {
+      ProcessPacket (packet);
+    }
+}
+
+void
+XrTrafficSink::ProcessPacket (Ptr<const Packet> packet)
+{
+  const Time now = Simulator::Now ();
+  XrFrameHeader header;
+  packet->PeekHeader (header);
+
+  if (header.m_frameId >= m_seen.size ())
+    {
+      m_seen.resize (header.m_frameId + 1, false);
+    }
+
+  auto it = m_pending.find (header.m_frameId);
+  if (it == m_pending.end ())
+    {
+      if (m_seen[header.m_frameId])
+        {
+          // The frame was already complete or lost
+          ExpireFrames (now);
+          return;
+        }
+      m_seen[header.m_frameId] = true;
+      PendingFrame frame;
+      frame.m_numPackets = header.m_numPackets;
+      frame.m_generation = header.m_generation;
+      it = m_pending.emplace (header.m_frameId, frame).first;
+    }
+
+  if (++it->second.m_received >= it->second.m_numPackets)
+    {
+      Time latency = now - it->second.m_generation;
+      bool onTime = latency <= m_packetDelayBudget;
+      NS_LOG_LOGIC ("Frame " << it->first << " complete in " << latency.As (Time::MS));
+      m_stats.RecordFrame (latency, onTime);
+      m_rxFrameTrace (it->first, latency, onTime);
+      m_pending.erase (it);
+    }
+
+  ExpireFrames (now);
+}
+
+void
+XrTrafficSink::ExpireFrames (Time now)
+{
+  for (auto it = m_pending.begin (); it != m_pending.end (); )
+    {
+      if (now - it->second.m_generation > m_packetDelayBudget)
+        {
+          NS_LOG_LOGIC ("Frame " << it->first << " lost, " << it->second.m_received << " of "
+                                 << it->second.m_numPackets << " packets");
+          m_stats.RecordLostFrames (1);
+          m_rxFrameTrace (it->first, Time::Max (), false);
+          it = m_pending.erase (it);
+        }
+      else
+        {
+          ++it;
+        }
+    }
+}
+
+const XrFrameStats &
+XrTrafficSink::GetStats () const
+{
+  return m_stats;
+}
+
+} // namespace ns3
@@ -0,0 +1,296 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ *   Copyright (c) 2022 Centre Tecnologic de Telecomunicacions de Catalunya (CTTC)
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+#ifndef XR_TRAFFIC_APPLICATION_H
+#define XR_TRAFFIC_APPLICATION_H
+
+#include <ns3/address.h>
+#include <ns3/application.h>
+#include <ns3/data-rate.h>
+#include <ns3/event-id.h>
+#include <ns3/header.h>
+#include <ns3/nstime.h>
+#include <ns3/traced-callback.h>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+class Socket;
+class Packet;
+class NormalRandomVariable;
+
+/**
+ * \ingroup utils
+ * \brief Header of the packets of an XR frame
+ *
+ * Every packet of a frame carries the ID of the frame, its index in the
+ * frame, the number of packets of the frame and the time at which the
+ * frame was generated, so that the receiver can tell when the whole frame
+ * arrived.
+ */
+class XrFrameHeader : public Header
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  TypeId GetInstanceTypeId (void) const override;
+  uint32_t GetSerializedSize (void) const override;
+  void Serialize (Buffer::Iterator start) const override;
+  uint32_t Deserialize (Buffer::Iterator start) override;
+  void Print (std::ostream &os) const override;
+
+  uint32_t m_frameId {0};       //!< ID of the frame, from 0
+  uint16_t m_packetIndex {0};   //!< Index of the packet in the frame
+  uint16_t m_numPackets {0};    //!< Packets of the frame
+  Time m_generation;            //!< Time at which the frame was generated
+};
+
+/**
+ * \ingroup utils
+ * \brief Frame-level statistics of an XR flow, aggregated online
+ *
+ * A frame is on time when all its packets arrived within the packet delay
+ * budget from its generation. The latency of the complete frames is kept
+ * in a histogram, from which the percentiles are taken; the statistics of
+ * several flows can be merged.
+ */
+class XrFrameStats
+{
+public:
+  /**
+   * \brief Constructor
+   * \param binWidth the width of the bins of the latency histogram
+   * \param numBins the number of bins (the last one takes all the larger latencies)
+   */
+  XrFrameStats (Time binWidth = MicroSeconds (100), uint32_t numBins = 1000);
+
+  /**
+   * \brief Record a complete frame
+   * \param latency the time from the generation to the last packet
+   * \param onTime whether it is within the delay budget
+   */
+  void RecordFrame (Time latency, bool onTime);
+
+  /**
+   * \brief Record frames that did not arrive completely
+   * \param frames the number of frames
+   */
+  void RecordLostFrames (uint64_t frames);
+
+  /**
+   * \brief Add the statistics of another flow
+   * \param other the other statistics, with the same bins
+   */
+  void Merge (const XrFrameStats &other);
+
+  /**
+   * \return the frames recorded, complete or not
+   */
+  uint64_t GetFrames () const;
+
+  /**
+   * \return the frames on time
+   */
+  uint64_t GetFramesOnTime () const;
+
+  /**
+   * \return the share of frames on time, or 0 without frames
+   */
+  double GetReliability () const;
+
+  /**
+   * \return the mean latency of the complete frames
+   */
+  Time GetMeanLatency () const;
+
+  /**
+   * \param percentile the percentile, in [0, 100]
+   * \return the upper edge of the bin of the percentile of the latency of
+   * the complete frames
+   */
+  Time GetLatencyPercentile (double percentile) const;
+
+private:
+  Time m_binWidth;                   //!< Width of the bins of the histogram
+  std::vector<uint64_t> m_histogram; //!< Complete frames per latency bin
+  uint64_t m_complete {0};           //!< Complete frames
+  uint64_t m_onTime {0};             //!< Frames on time
+  uint64_t m_lost {0};               //!< Frames that did not arrive completely
+  int64_t m_latencySum {0};          //!< Sum of the latency of the complete frames (time steps)
+};
+
+/**
+ * \ingroup utils
+ * \brief XR or cloud gaming traffic of TR 38.838
+ *
+ * The application sends, over UDP, Fps frames per second. The size of a
+ * frame follows a truncated Gaussian distribution with mean DataRate / Fps,
+ * standard deviation FrameSizeStd times the mean, and bounded to
+ * FrameSizeBound times the mean around it. The frames arrive with a
+ * truncated Gaussian jitter of standard deviation JitterStd, bounded to
+ * JitterBound, around their nominal periodic time. Every frame is split in
+ * packets of at most PacketSize bytes, all sent at once, each carrying a
+ * XrFrameHeader. The receiver is XrTrafficSink.
+ */
+class XrTrafficApplication : public Application
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  XrTrafficApplication ();
+  ~XrTrafficApplication () override;
+
+  /**
+   * \brief Assign a fixed random variable stream number to the random variables
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \brief TracedCallback signature for the generation of a frame
+   * \param [in] frameId the ID of the frame
+   * \param [in] bytes the size of the frame
+   */
+  typedef void (* FrameTracedCallback) (uint32_t frameId, uint32_t bytes);
+
+protected:
+  void DoDispose (void) override;
+
+private:
+  void StartApplication (void) override;
+  void StopApplication (void) override;
+
+  /**
+   * \brief Schedule the next frame and the next tick, one period later
+   */
+  void Tick ();
+
+  /**
+   * \brief Generate a frame and send its packets
+   */
+  void SendFrame ();
+
+  Ptr<Socket> m_socket;                       //!< The UDP socket
+  Address m_peer;                             //!< Remote address (attribute)
+  double m_fps {60.0};                        //!< Frames per second (attribute)
+  DataRate m_dataRate;                        //!< Mean data rate (attribute)
+  double m_frameSizeStd {0.105};              //!< Relative std of the frame size (attribute)
+  double m_frameSizeBound {0.5};              //!< Relative bound of the frame size (attribute)
+  Time m_jitterStd;                           //!< Std of the jitter (attribute)
+  Time m_jitterBound;                         //!< Bound of the jitter (attribute)
+  uint32_t m_packetSize {1500};               //!< Maximum size of a packet (attribute)
+  Ptr<NormalRandomVariable> m_frameSize;      //!< Relative frame size
+  Ptr<NormalRandomVariable> m_jitter;         //!< Jitter, in s
+  uint32_t m_nextFrameId {0};                 //!< ID of the next frame
+  EventId m_tickEvent;                        //!< The next tick
+  TracedCallback<uint32_t, uint32_t> m_txFrameTrace; //!< Generation of a frame
+};
+
+/**
+ * \ingroup utils
+ * \brief Receiver of XrTrafficApplication, with frame-level statistics
+ *
+ * The sink reassembles the frames from the XrFrameHeader of their packets.
+ * A frame is complete when all its packets arrived; it is on time if that
+ * happened within PacketDelayBudget from its generation. The frames that
+ * are not complete when they exceed the budget are lost. When the
+ * application stops, the frames not complete and the frames of which no
+ * packet arrived (with an ID lower than the highest one seen) are lost
+ * too: stop the sink at least a budget after the source.
+ */
+class XrTrafficSink : public Application
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  XrTrafficSink ();
+  ~XrTrafficSink () override;
+
+  /**
+   * \brief Process a received packet
+   * \param packet the packet, starting with its XrFrameHeader
+   */
+  void ProcessPacket (Ptr<const Packet> packet);
+
+  /**
+   * \return the statistics of the frames so far
+   */
+  const XrFrameStats & GetStats () const;
+
+  /**
+   * \brief TracedCallback signature for the completion or loss of a frame
+   * \param [in] frameId the ID of the frame
+   * \param [in] latency the latency of the frame, or Time::Max () if it was lost
+   * \param [in] onTime whether the frame was on time
+   */
+  typedef void (* FrameTracedCallback) (uint32_t frameId, Time latency, bool onTime);
+
+protected:
+  void DoDispose (void) override;
+
+private:
+  void StartApplication (void) override;
+  void StopApplication (void) override;
+
+  /**
+   * \brief Receive the packets of the socket
+   * \param socket the socket
+   */
+  void HandleRead (Ptr<Socket> socket);
+
+  /**
+   * \brief Drop the incomplete frames over the budget
+   * \param now the current time
+   */
+  void ExpireFrames (Time now);
+
+  /**
+   * \brief A frame not complete yet
+   */
+  struct PendingFrame
+  {
+    uint16_t m_numPackets {0};   //!< Packets of the frame
+    uint16_t m_received {0};     //!< Packets received
+    Time m_generation;           //!< Generation time
+  };
+
+  Ptr<Socket> m_socket;                         //!< The UDP socket
+  Address m_local;                              //!< Local address (attribute)
+  Time m_packetDelayBudget;                     //!< Delay budget of a frame (attribute)
+  std::map<uint32_t, PendingFrame> m_pending;   //!< Frames not complete yet
+  std::vector<bool> m_seen;                     //!< Whether a packet of each frame arrived, by frame ID
+  XrFrameStats m_stats;                         //!< The statistics
+  TracedCallback<uint32_t, Time, bool> m_rxFrameTrace; //!< Completion or loss of a frame
+};
+
+} // namespace ns3
+
+#endif // XR_TRAFFIC_APPLICATION_H